@@ -1,12 +1,23 @@
 package com.retroarch.browser.retroactivity;
 
+import java.lang.reflect.Method;
+
 import com.retroarch.browser.preferences.util.UserPreferences;
 
+import android.content.Context;
+import android.os.Build;
+import android.util.Log;
+import android.view.Window;
+
 /**
  * Class which provides common methods for RetroActivity related classes.
  */
 public class RetroActivityCommon extends RetroActivityLocation
 {
+	// Newer than the SDK we build against, so looked up at runtime.
+	private Object hintSession = null;
+	private Method reportActualWorkDuration = null;
+
 	@Override
 	public void onLowMemory()
 	{
@@ -17,6 +28,88 @@ public class RetroActivityCommon extends RetroActivityLocation
 	{
 	}
 
+	/**
+	 * Called from native code when performance mode is toggled.
+	 * <p>
+	 * Asks for clocks the device can sustain (API 24), and opens an
+	 * ADPF hint session for the calling thread, which runs the core,
+	 * so PowerHAL boosts it to make targetNanos per frame (API 31).
+	 */
+	public void setPerformanceMode(final boolean enable, long targetNanos)
+	{
+		if (Build.VERSION.SDK_INT >= 24)
+		{
+			runOnUiThread(new Runnable() {
+				@Override
+				public void run() {
+					try {
+						Window.class.getMethod("setSustainedPerformanceMode", boolean.class)
+							.invoke(getWindow(), enable);
+					} catch (Exception e) {
+						Log.w("RetroActivity", "Sustained performance mode unavailable: " + e);
+					}
+				}
+			});
+		}
+
+		if (hintSession != null)
+		{
+			try {
+				hintSession.getClass().getMethod("close").invoke(hintSession);
+			} catch (Exception e) {
+			}
+		}
+		hintSession = null;
+		reportActualWorkDuration = null;
+
+		if (!enable || Build.VERSION.SDK_INT < 31)
+			return;
+
+		try {
+			Object manager = getSystemService("performance_hint");
+			Method create = manager.getClass().getMethod("createHintSession", int[].class, long.class);
+
+			hintSession = create.invoke(manager, new int[] { android.os.Process.myTid() }, targetNanos);
+			if (hintSession != null)
+				reportActualWorkDuration = hintSession.getClass().getMethod("reportActualWorkDuration", long.class);
+		} catch (Exception e) {
+			Log.w("RetroActivity", "Performance hint session unavailable: " + e);
+			hintSession = null;
+		}
+	}
+
+	/**
+	 * Called from native code after every frame with the time it took.
+	 */
+	public void reportFrameTime(long nanos)
+	{
+		if (reportActualWorkDuration == null || nanos <= 0)
+			return;
+
+		try {
+			reportActualWorkDuration.invoke(hintSession, nanos);
+		} catch (Exception e) {
+			reportActualWorkDuration = null;
+		}
+	}
+
+	/**
+	 * Returns the PowerManager.THERMAL_STATUS_* of the device (API 29),
+	 * 0 if it is not known.
+	 */
+	public int getThermalStatus()
+	{
+		if (Build.VERSION.SDK_INT < 29)
+			return 0;
+
+		try {
+			Object power = getSystemService(Context.POWER_SERVICE);
+			return (Integer)power.getClass().getMethod("getCurrentThermalStatus").invoke(power);
+		} catch (Exception e) {
+			return 0;
+		}
+	}
+
 	// Exiting cleanly from NDK seems to be nearly impossible.
 	// Have to use exit(0) to avoid weird things happening, even with runOnUiThread() approaches.
 	// Use a separate JNI function to explicitly trigger the readback.
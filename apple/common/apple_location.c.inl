@@ -1,6 +1,7 @@
 typedef struct apple_location
 {
-	void *empty;
+	/* locationSeq of the fix last handed out by get_position. */
+	unsigned read_seq;
 } applelocation_t;
 
 static void *apple_location_init(void)
@@ -50,17 +51,33 @@ static void apple_location_stop(void *data)
 static bool apple_location_get_position(void *data, double *lat, double *lon, double *horiz_accuracy,
       double *vert_accuracy)
 {
-	(void)data;
+	applelocation_t *applelocation = (applelocation_t*)data;
+   unsigned seq;
+   double la, lo, horiz, vert;
 
-   bool ret = [[RAGameView get] onLocationHasChanged];
+   do
+   {
+      seq = locationSeq;
+      __sync_synchronize();
 
-   if (!ret)
-      goto fail;
-	
-   *lat            = currentLatitude;
-   *lon            = currentLongitude;
-   *horiz_accuracy = currentHorizontalAccuracy;
-   *vert_accuracy  = currentVerticalAccuracy;
+      /* No fix since the last call. */
+      if ((seq & 1) || seq == applelocation->read_seq)
+         goto fail;
+
+      la    = currentLatitude;
+      lo    = currentLongitude;
+      horiz = currentHorizontalAccuracy;
+      vert  = currentVerticalAccuracy;
+
+      __sync_synchronize();
+   } while (seq != locationSeq);
+
+   applelocation->read_seq = seq;
+
+   *lat            = la;
+   *lon            = lo;
+   *horiz_accuracy = horiz;
+   *vert_accuracy  = vert;
    return true;
 
 fail:
@@ -1,29 +1,33 @@
 #include <CoreLocation/CoreLocation.h>
 
 static CLLocationManager *locationManager;
-static bool locationChanged;
-static CLLocationDegrees currentLatitude;
-static CLLocationDegrees currentLongitude;
-static CLLocationAccuracy currentHorizontalAccuracy;
-static CLLocationAccuracy currentVerticalAccuracy;
 
-- (bool)onLocationHasChanged
+/* Latest fix, written by the delegate only. locationSeq is odd
+ * while it is being written, so get_position can read it from
+ * any thread without a lock. */
+static volatile unsigned locationSeq;
+static volatile CLLocationDegrees currentLatitude;
+static volatile CLLocationDegrees currentLongitude;
+static volatile CLLocationAccuracy currentHorizontalAccuracy;
+static volatile CLLocationAccuracy currentVerticalAccuracy;
+
+static void apple_location_publish(CLLocation *location)
 {
-   bool hasChanged = locationChanged;
-    
-   if (hasChanged)
-      locationChanged = false;
-    
-   return hasChanged;
+   locationSeq++;
+   __sync_synchronize();
+
+   currentLatitude           = location.coordinate.latitude;
+   currentLongitude          = location.coordinate.longitude;
+   currentHorizontalAccuracy = location.horizontalAccuracy;
+   currentVerticalAccuracy   = location.verticalAccuracy;
+
+   __sync_synchronize();
+   locationSeq++;
 }
 
 - (void)locationManager:(CLLocationManager *)manager didUpdateToLocation:(CLLocation *)newLocation fromLocation:(CLLocation *)oldLocation
 {
-    locationChanged = true;
-    currentLatitude = newLocation.coordinate.latitude;
-    currentLongitude = newLocation.coordinate.longitude;
-    currentHorizontalAccuracy = newLocation.horizontalAccuracy;
-    currentVerticalAccuracy = newLocation.verticalAccuracy;
+    apple_location_publish(newLocation);
     RARCH_LOG("didUpdateToLocation - latitude %f, longitude %f\n", (float)currentLatitude, (float)currentLongitude);
 }
 
@@ -31,11 +35,7 @@ static CLLocationAccuracy currentVerticalAccuracy;
 {
     CLLocation *location = (CLLocation*)[locations objectAtIndex:([locations count] - 1)];
     
-    locationChanged = true;
-    currentLatitude  = [location coordinate].latitude;
-    currentLongitude = [location coordinate].longitude;
-    currentHorizontalAccuracy = location.horizontalAccuracy;
-    currentVerticalAccuracy = location.verticalAccuracy;
+    apple_location_publish(location);
     RARCH_LOG("didUpdateLocations - latitude %f, longitude %f\n", (float)currentLatitude, (float)currentLongitude);
 }
 
@@ -22,6 +22,13 @@
 #include "../driver.h"
 #include "../general.h"
 #include "../retroarch.h"
+#include "../settings.h"
+#include "../performance.h"
+#include "../intl/intl.h"
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 static const audio_driver_t *audio_drivers[] = {
 #ifdef HAVE_ALSA
@@ -82,6 +89,173 @@ static const audio_driver_t *audio_drivers[] = {
    NULL,
 };
 
+/**
+ * audio_driver_bytes_per_ms:
+ *
+ * Returns: amount of bytes the audio driver plays 
+ * in one millisecond.
+ **/
+static double audio_driver_bytes_per_ms(void)
+{
+   size_t sample_size = g_extern.audio_data.use_float ? 
+      sizeof(float) : sizeof(int16_t);
+   return g_settings.audio.out_rate * 2 * sample_size / 1000.0;
+}
+
+/**
+ * init_audio_rate_control:
+ *
+ * Converts the rate control target to a driver buffer 
+ * fill level, and resets the controller.
+ **/
+static void init_audio_rate_control(void)
+{
+   size_t size   = g_extern.audio_data.driver_buffer_size;
+   size_t target = size / 2;
+
+   if (g_settings.audio.rate_control_target)
+   {
+      target = g_settings.audio.rate_control_target *
+         audio_driver_bytes_per_ms();
+
+      /* Leave some room on both ends, the controller
+       * can't steer while the buffer is empty or full. */
+      target = max(size / 16, min(size - size / 16, target));
+   }
+
+   g_extern.audio_data.rate_control_target = target;
+   g_extern.audio_data.rate_control_error  = 0.0;
+   g_extern.audio_data.rate_control_drift  = 0.0;
+
+   RARCH_LOG("Audio rate control: targeting %.1f ms of %.1f ms buffer.\n",
+         target / audio_driver_bytes_per_ms(),
+         size / audio_driver_bytes_per_ms());
+}
+
+/* Latency auto-tuning starts out at this latency, in ms, 
+ * and never goes below it. */
+#define AUDIO_AUTOTUNE_MIN_LATENCY 16
+
+/* Raise latency by a quarter, but at least this many ms. */
+#define AUDIO_AUTOTUNE_STEP 8
+
+/* The driver buffer starts out empty, so writes right 
+ * after (re)init or a gap don't count as underruns. */
+#define AUDIO_AUTOTUNE_WARMUP_USEC 2000000
+
+/* Writes further apart than this mean the core wasn't running 
+ * (paused, menu, loading), the driver running dry is expected. */
+#define AUDIO_AUTOTUNE_MAX_GAP_USEC 100000
+
+/* A latency is kept after running this long without underruns. */
+#define AUDIO_AUTOTUNE_WINDOW_USEC 30000000
+
+/**
+ * audio_driver_open_latency:
+ *
+ * Returns: latency in milliseconds to open the audio driver with.
+ * With auto-tuning this is the learned latency, with 
+ * audio_latency as the upper bound.
+ **/
+static unsigned audio_driver_open_latency(void)
+{
+   unsigned latency = g_settings.audio.latency;
+
+   if (!g_settings.audio.latency_autotune)
+      return latency;
+
+   return min(latency, max(g_settings.audio.latency_autotuned,
+            AUDIO_AUTOTUNE_MIN_LATENCY));
+}
+
+/**
+ * audio_driver_autotune_check:
+ *
+ * Called before every write to the audio driver. Counts 
+ * the writes which find the driver buffer empty.
+ **/
+static void audio_driver_autotune_check(void)
+{
+   retro_time_t now  = rarch_get_time_usec();
+   retro_time_t last = g_extern.audio_data.autotune.last_write;
+
+   g_extern.audio_data.autotune.last_write = now;
+
+   if (driver.nonblock_state)
+      return;
+
+   if (!last || now - last > AUDIO_AUTOTUNE_MAX_GAP_USEC)
+   {
+      g_extern.audio_data.autotune.window_start = now;
+      return;
+   }
+
+   if (now - g_extern.audio_data.autotune.window_start <
+         AUDIO_AUTOTUNE_WARMUP_USEC)
+      return;
+
+   if (driver.audio->write_avail(driver.audio_data) >=
+         g_extern.audio_data.driver_buffer_size)
+      g_extern.audio_data.autotune.underruns++;
+}
+
+void audio_driver_autotune_update(void)
+{
+   unsigned latency, next;
+
+   if (!g_extern.audio_data.autotune.enable)
+      return;
+
+   latency = g_extern.audio_data.autotune.latency;
+
+   if (g_extern.audio_data.autotune.underruns)
+   {
+      next = min(latency + max(latency / 4, AUDIO_AUTOTUNE_STEP),
+            g_settings.audio.latency);
+
+      g_extern.audio_data.autotune.underruns = 0;
+      g_settings.audio.latency_autotuned     = next;
+
+      if (next <= latency)
+      {
+         RARCH_WARN("Audio latency auto-tuning: underruns at %u ms, which is already the audio_latency limit.\n",
+               latency);
+         g_extern.audio_data.autotune.enable = false;
+         return;
+      }
+
+      RARCH_LOG("Audio latency auto-tuning: underrun at %u ms, trying %u ms.\n",
+            latency, next);
+      rarch_main_command(RARCH_CMD_AUDIO_REINIT);
+      return;
+   }
+
+   if (g_extern.audio_data.autotune.settled ||
+         !g_extern.audio_data.autotune.window_start ||
+         g_extern.audio_data.autotune.last_write -
+         g_extern.audio_data.autotune.window_start <
+         AUDIO_AUTOTUNE_WINDOW_USEC)
+      return;
+
+   g_extern.audio_data.autotune.settled = true;
+
+   if (g_settings.audio.latency_autotuned == latency)
+      return;
+
+   g_settings.audio.latency_autotuned = latency;
+
+   RARCH_LOG("Audio latency auto-tuning: %u ms runs without underruns.\n",
+         latency);
+
+   if (g_settings.core_specific_config &&
+         *g_extern.core_specific_config_path)
+   {
+      if (config_save_file(g_extern.core_specific_config_path))
+         RARCH_LOG("Audio latency auto-tuning: saved to \"%s\".\n",
+               g_extern.core_specific_config_path);
+   }
+}
+
 /**
  * compute_audio_buffer_statistics:
  *
@@ -91,6 +265,7 @@ static const audio_driver_t *audio_drivers[] = {
 static void compute_audio_buffer_statistics(void)
 {
    unsigned i, low_water_size, high_water_size, avg, stddev;
+   unsigned max_free = 0, empty_count = 0;
    float avg_filled, deviation;
    uint64_t accum = 0, accum_var = 0;
    unsigned low_water_count = 0, high_water_count = 0;
@@ -120,10 +295,16 @@ static void compute_audio_buffer_statistics(void)
 
    for (i = 1; i < samples; i++)
    {
-      if (g_extern.measure_data.buffer_free_samples[i] >= low_water_size)
+      unsigned free_samples = g_extern.measure_data.buffer_free_samples[i];
+
+      if (free_samples >= low_water_size)
          low_water_count++;
-      else if (g_extern.measure_data.buffer_free_samples[i] <= high_water_size)
+      else if (free_samples <= high_water_size)
          high_water_count++;
+
+      if (free_samples >= g_extern.audio_data.driver_buffer_size)
+         empty_count++;
+      max_free = max(max_free, free_samples);
    }
 
    RARCH_LOG("Average audio buffer saturation: %.2f %%, standard deviation (percentage points): %.2f %%.\n",
@@ -131,6 +312,227 @@ static void compute_audio_buffer_statistics(void)
    RARCH_LOG("Amount of time spent close to underrun: %.2f %%. Close to blocking: %.2f %%.\n",
          (100.0 * low_water_count) / (samples - 1),
          (100.0 * high_water_count) / (samples - 1));
+
+   if (g_extern.audio_data.rate_control)
+   {
+      double bytes_per_ms = audio_driver_bytes_per_ms();
+
+      RARCH_LOG("Rate control: target %.1f ms, average %.1f ms, lowest %.1f ms, buffer ran empty %u times, estimated drift %.3f %%.\n",
+            g_extern.audio_data.rate_control_target / bytes_per_ms,
+            (g_extern.audio_data.driver_buffer_size - avg) / bytes_per_ms,
+            (g_extern.audio_data.driver_buffer_size - max_free) / bytes_per_ms,
+            empty_count,
+            g_extern.audio_data.rate_control_drift * 100.0);
+   }
+}
+
+/* Integral gain of rate control, relative to rate_control_delta. 
+ * A steady fill error of 10 % of the buffer moves the drift 
+ * estimate by 0.1 % of delta per write, so it settles within 
+ * a few seconds without pulling the pitch around. */
+#define RATE_CONTROL_INTEGRAL_GAIN (1.0 / 128.0)
+
+/* Low-pass of the fill error, the driver drains its buffer 
+ * in periods so a single reading is a sawtooth. */
+#define RATE_CONTROL_ERROR_SMOOTHING (1.0 / 8.0)
+
+/*
+ * readjust_audio_input_rate:
+ *
+ * Readjust the audio input rate.
+ *
+ * PI controller regulating the driver buffer fill towards 
+ * g_extern.audio_data.rate_control_target. The proportional term 
+ * corrects short-term fill errors, the integral term converges
+ * to the clock drift between core and audio device, so the buffer
+ * settles at the target instead of wherever the drift pushes it.
+ */
+static void readjust_audio_input_rate(void)
+{
+   int avail = driver.audio->write_avail(driver.audio_data);
+
+   //RARCH_LOG_OUTPUT("Audio buffer is %u%% full\n",
+   //      (unsigned)(100 - (avail * 100) / g_extern.audio_data.driver_buffer_size));
+
+   unsigned write_idx = g_extern.measure_data.buffer_free_samples_count++ &
+      (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
+   double   size      = g_extern.audio_data.driver_buffer_size;
+   double   max_delta = g_settings.audio.rate_control_delta;
+   double   fill      = size - avail;
+   /* Positive when the buffer is too empty, i.e. we need more output. */
+   double   error     = (g_extern.audio_data.rate_control_target - fill) / size;
+   double   adjust;
+
+   g_extern.audio_data.rate_control_error += RATE_CONTROL_ERROR_SMOOTHING *
+      (error - g_extern.audio_data.rate_control_error);
+
+   g_extern.audio_data.rate_control_drift += RATE_CONTROL_INTEGRAL_GAIN *
+      max_delta * error;
+   g_extern.audio_data.rate_control_drift = max(-max_delta,
+         min(max_delta, g_extern.audio_data.rate_control_drift));
+
+   /* Same proportional gain as a plain controller centered on 
+    * a half full buffer. */
+   adjust = 2.0 * max_delta * g_extern.audio_data.rate_control_error
+      + g_extern.audio_data.rate_control_drift;
+   adjust = 1.0 + max(-max_delta, min(max_delta, adjust));
+
+   g_extern.measure_data.buffer_free_samples[write_idx] = avail;
+   g_extern.audio_data.src_ratio = g_extern.audio_data.orig_src_ratio * adjust;
+
+   //RARCH_LOG_OUTPUT("New rate: %lf, Orig rate: %lf\n",
+   //      g_extern.audio_data.src_ratio, g_extern.audio_data.orig_src_ratio);
+}
+
+/**
+ * audio_flush_block:
+ * @data                 : pointer to float audio buffer.
+ * @frames               : amount of frames, at most AUDIO_BLOCK_FRAMES.
+ * @ratio                : resampling ratio.
+ *
+ * Resamples a block of audio, converts it to the format
+ * the audio driver expects and writes it to the audio driver.
+ *
+ * Returns: true (1) if audio samples were written to the audio
+ * driver, false (0) in case of an error.
+ **/
+static bool audio_flush_block(const float *data, unsigned frames,
+      double ratio)
+{
+   const void *output_data        = NULL;
+   unsigned output_frames         = 0;
+   size_t   output_size           = sizeof(float);
+   struct resampler_data src_data = {0};
+
+   src_data.data_in      = data;
+   src_data.input_frames = frames;
+   src_data.data_out     = g_extern.audio_data.outsamples;
+   src_data.ratio        = ratio;
+
+   RARCH_PERFORMANCE_INIT(resampler_proc);
+   RARCH_PERFORMANCE_START(resampler_proc);
+   rarch_resampler_process(driver.resampler,
+         driver.resampler_data, &src_data);
+   RARCH_PERFORMANCE_STOP(resampler_proc);
+
+   output_data   = g_extern.audio_data.outsamples;
+   output_frames = src_data.output_frames;
+
+   if (!output_frames)
+      return true;
+
+   if (!g_extern.audio_data.use_float)
+   {
+      RARCH_PERFORMANCE_INIT(audio_convert_float);
+      RARCH_PERFORMANCE_START(audio_convert_float);
+      audio_convert_float_to_s16(g_extern.audio_data.conv_block,
+            (const float*)output_data, output_frames * 2);
+      RARCH_PERFORMANCE_STOP(audio_convert_float);
+
+      output_data = g_extern.audio_data.conv_block;
+      output_size = sizeof(int16_t);
+   }
+
+   if (driver.audio->write(driver.audio_data, output_data,
+            output_frames * output_size * 2) < 0)
+   {
+      RARCH_ERR(RETRO_LOG_AUDIO_WRITE_FAILED);
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * audio_driver_flush:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ *
+ * Writes audio samples to audio driver. Will first
+ * perform DSP processing (if enabled) and resampling.
+ *
+ * All stages run over one block of AUDIO_BLOCK_FRAMES at a time,
+ * from s16 conversion to the driver write, so the intermediate
+ * float samples never leave the cache.
+ *
+ * Returns: true (1) if audio samples were written to the audio
+ * driver, false (0) in case of an error.
+ **/
+bool audio_driver_flush(const int16_t *data, size_t samples)
+{
+   size_t offset;
+   double ratio;
+   size_t frames = samples >> 1;
+
+   if (driver.recording_data)
+   {
+      struct ffemu_audio_data ffemu_data = {0};
+      ffemu_data.data                    = data;
+      ffemu_data.frames                  = samples / 2;
+
+      if (driver.recording && driver.recording->push_audio)
+         driver.recording->push_audio(driver.recording_data, &ffemu_data);
+   }
+
+   if (g_extern.is_paused || g_extern.audio_data.mute)
+      return true;
+   if (!driver.audio_active || !g_extern.audio_data.data)
+      return false;
+
+   if (g_extern.audio_data.autotune.enable)
+      audio_driver_autotune_check();
+
+   if (g_extern.audio_data.rate_control)
+      readjust_audio_input_rate();
+
+   ratio = g_extern.audio_data.src_ratio;
+   if (g_extern.is_slowmotion)
+      ratio *= g_settings.slowmotion_ratio;
+
+   for (offset = 0; offset < frames; offset += AUDIO_BLOCK_FRAMES)
+   {
+      unsigned i;
+      struct rarch_dsp_data dsp_data = {0};
+      unsigned block_frames = min(frames - offset, AUDIO_BLOCK_FRAMES);
+
+      RARCH_PERFORMANCE_INIT(audio_convert_s16);
+      RARCH_PERFORMANCE_START(audio_convert_s16);
+      audio_convert_s16_to_float(g_extern.audio_data.data,
+            data + offset * 2, block_frames * 2,
+            g_extern.audio_data.volume_gain);
+      RARCH_PERFORMANCE_STOP(audio_convert_s16);
+
+      dsp_data.input         = g_extern.audio_data.data;
+      dsp_data.input_frames  = block_frames;
+      dsp_data.output        = dsp_data.input;
+      dsp_data.output_frames = dsp_data.input_frames;
+
+      if (g_extern.audio_data.dsp)
+      {
+         RARCH_PERFORMANCE_INIT(audio_dsp);
+         RARCH_PERFORMANCE_START(audio_dsp);
+         rarch_dsp_filter_process(g_extern.audio_data.dsp, &dsp_data);
+         RARCH_PERFORMANCE_STOP(audio_dsp);
+
+         if (!dsp_data.output)
+         {
+            dsp_data.output        = dsp_data.input;
+            dsp_data.output_frames = dsp_data.input_frames;
+         }
+      }
+
+      /* Block based filters like EQ can return more frames
+       * than they were given. */
+      for (i = 0; i < dsp_data.output_frames; i += AUDIO_BLOCK_FRAMES)
+      {
+         if (!audio_flush_block(dsp_data.output + i * 2,
+                  min(dsp_data.output_frames - i, AUDIO_BLOCK_FRAMES),
+                  ratio))
+            return false;
+      }
+   }
+
+   return true;
 }
 
 /**
@@ -219,11 +621,103 @@ void find_audio_driver(void)
    }
 }
 
+#ifdef HAVE_THREADS
+static struct
+{
+   sthread_t *thread;
+   const audio_driver_t *drv;
+   void *data;
+   unsigned rate;
+   unsigned latency;
+   char device[PATH_MAX];
+} audio_open;
+
+static void audio_driver_open_thread(void *data)
+{
+   (void)data;
+
+   audio_open.data = audio_open.drv->init(*audio_open.device ?
+         audio_open.device : NULL, audio_open.rate, audio_open.latency);
+}
+
+void audio_driver_open_async(void)
+{
+   if (audio_open.thread || driver.audio_data || !g_settings.audio.enable
+         || g_extern.system.audio_callback.callback)
+      return;
+
+   find_audio_driver();
+   if (!driver.audio || !driver.audio->init_any_thread)
+      return;
+
+   audio_open.drv     = driver.audio;
+   audio_open.data    = NULL;
+   audio_open.rate    = g_settings.audio.out_rate;
+   audio_open.latency = audio_driver_open_latency();
+   strlcpy(audio_open.device, g_settings.audio.device,
+         sizeof(audio_open.device));
+
+   audio_open.thread  = sthread_create(audio_driver_open_thread, NULL);
+}
+
+/**
+ * audio_driver_open_join:
+ *
+ * Waits for an open started by audio_driver_open_async().
+ *
+ * Returns: true (1) if one was started with the current driver
+ * and settings, and @data is set to its handle, otherwise false (0).
+ * A handle opened with anything else is freed.
+ **/
+static bool audio_driver_open_join(void **data, unsigned latency)
+{
+   if (!audio_open.thread)
+      return false;
+
+   sthread_join(audio_open.thread);
+   audio_open.thread = NULL;
+
+   if (audio_open.drv == driver.audio
+         && audio_open.rate == g_settings.audio.out_rate
+         && audio_open.latency == latency
+         && !strcmp(audio_open.device, g_settings.audio.device))
+   {
+      *data = audio_open.data;
+      return true;
+   }
+
+   if (audio_open.data)
+      audio_open.drv->free(audio_open.data);
+   return false;
+}
+#else
+void audio_driver_open_async(void)
+{
+}
+#endif
+
+/* Accounted to RARCH_MEM_AUDIO by init_audio(). */
+static size_t audio_mem_size;
+
 void uninit_audio(void)
 {
+#ifdef HAVE_THREADS
+   /* Drivers torn down before init_audio() got to the open. */
+   if (audio_open.thread)
+   {
+      sthread_join(audio_open.thread);
+      audio_open.thread = NULL;
+      if (audio_open.data)
+         audio_open.drv->free(audio_open.data);
+   }
+#endif
+
    if (driver.audio_data && driver.audio)
       driver.audio->free(driver.audio_data);
 
+   rarch_mem_sub(RARCH_MEM_AUDIO, audio_mem_size);
+   audio_mem_size = 0;
+
    free(g_extern.audio_data.conv_outsamples);
    g_extern.audio_data.conv_outsamples = NULL;
    g_extern.audio_data.data_ptr        = 0;
@@ -246,6 +740,9 @@ void uninit_audio(void)
    free(g_extern.audio_data.outsamples);
    g_extern.audio_data.outsamples = NULL;
 
+   free(g_extern.audio_data.conv_block);
+   g_extern.audio_data.conv_block = NULL;
+
    rarch_main_command(RARCH_CMD_DSP_FILTER_DEINIT);
 
    compute_audio_buffer_statistics();
@@ -253,7 +750,9 @@ void uninit_audio(void)
 
 void init_audio(void)
 {
-   size_t outsamples_max, max_bufsamples = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
+   size_t outsamples_max, block_outsamples_max, block_mem_size;
+   size_t max_bufsamples = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
+   unsigned latency      = audio_driver_open_latency();
 
    audio_convert_init_simd();
 
@@ -280,6 +779,9 @@ void init_audio(void)
          malloc(max_bufsamples * sizeof(int16_t)));
    g_extern.audio_data.rewind_size             = max_bufsamples;
 
+   audio_mem_size = (outsamples_max + max_bufsamples) * sizeof(int16_t);
+   rarch_mem_add(RARCH_MEM_AUDIO, audio_mem_size);
+
    if (!g_settings.audio.enable)
    {
       driver.audio_active = false;
@@ -288,12 +790,14 @@ void init_audio(void)
 
    find_audio_driver();
 #ifdef HAVE_THREADS
-   if (g_extern.system.audio_callback.callback)
+   if (audio_driver_open_join(&driver.audio_data, latency))
+      RARCH_LOG("Audio device was opened during video init.\n");
+   else if (g_extern.system.audio_callback.callback)
    {
       RARCH_LOG("Starting threaded audio driver ...\n");
       if (!rarch_threaded_audio_init(&driver.audio, &driver.audio_data,
                *g_settings.audio.device ? g_settings.audio.device : NULL,
-               g_settings.audio.out_rate, g_settings.audio.latency,
+               g_settings.audio.out_rate, latency,
                driver.audio))
       {
          RARCH_ERR("Cannot open threaded audio driver ... Exiting ...\n");
@@ -305,7 +809,7 @@ void init_audio(void)
    {
       driver.audio_data = driver.audio->init(*g_settings.audio.device ?
             g_settings.audio.device : NULL,
-            g_settings.audio.out_rate, g_settings.audio.latency);
+            g_settings.audio.out_rate, latency);
    }
 
    if (!driver.audio_data)
@@ -346,15 +850,26 @@ void init_audio(void)
       driver.audio_active = false;
    }
 
+   /* audio_driver_flush() only ever holds one block of intermediate samples. */
    rarch_assert(g_extern.audio_data.data = (float*)
-         malloc(max_bufsamples * sizeof(float)));
+         malloc(AUDIO_BLOCK_FRAMES * 2 * sizeof(float)));
 
    g_extern.audio_data.data_ptr = 0;
 
    rarch_assert(g_settings.audio.out_rate <
          g_extern.audio_data.in_rate * AUDIO_MAX_RATIO);
+
+   block_outsamples_max = AUDIO_BLOCK_FRAMES * 2 * AUDIO_MAX_RATIO *
+      g_settings.slowmotion_ratio;
    rarch_assert(g_extern.audio_data.outsamples = (float*)
-         malloc(outsamples_max * sizeof(float)));
+         malloc(block_outsamples_max * sizeof(float)));
+   rarch_assert(g_extern.audio_data.conv_block = (int16_t*)
+         malloc(block_outsamples_max * sizeof(int16_t)));
+
+   block_mem_size = AUDIO_BLOCK_FRAMES * 2 * sizeof(float) +
+      block_outsamples_max * (sizeof(float) + sizeof(int16_t));
+   audio_mem_size += block_mem_size;
+   rarch_mem_add(RARCH_MEM_AUDIO, block_mem_size);
 
    g_extern.audio_data.rate_control = false;
    if (!g_extern.system.audio_callback.callback && driver.audio_active &&
@@ -365,11 +880,33 @@ void init_audio(void)
          g_extern.audio_data.driver_buffer_size = 
             driver.audio->buffer_size(driver.audio_data);
          g_extern.audio_data.rate_control = true;
+         init_audio_rate_control();
       }
       else
          RARCH_WARN("Audio rate control was desired, but driver does not support needed features.\n");
    }
 
+   g_extern.audio_data.autotune.enable       = false;
+   g_extern.audio_data.autotune.settled      = false;
+   g_extern.audio_data.autotune.latency      = latency;
+   g_extern.audio_data.autotune.underruns    = 0;
+   g_extern.audio_data.autotune.window_start = 0;
+   g_extern.audio_data.autotune.last_write   = 0;
+   if (!g_extern.system.audio_callback.callback && driver.audio_active &&
+         g_settings.audio.latency_autotune)
+   {
+      if (driver.audio->buffer_size && driver.audio->write_avail)
+      {
+         g_extern.audio_data.driver_buffer_size = 
+            driver.audio->buffer_size(driver.audio_data);
+         g_extern.audio_data.autotune.enable = true;
+         RARCH_LOG("Audio latency auto-tuning: opened driver with %u ms.\n",
+               latency);
+      }
+      else
+         RARCH_WARN("Audio latency auto-tuning was desired, but driver does not support needed features.\n");
+   }
+
    rarch_main_command(RARCH_CMD_DSP_FILTER_DEINIT);
 
    g_extern.measure_data.buffer_free_samples_count = 0;
@@ -55,6 +55,10 @@ typedef struct audio_driver
    size_t (*write_avail)(void *data);
 
    size_t (*buffer_size)(void *data);
+
+   /* Set if init() may be called off the main thread, so the
+    * device can be opened while the video driver comes up. */
+   bool init_any_thread;
 } audio_driver_t;
 
 extern audio_driver_t audio_rsound;
@@ -110,6 +114,38 @@ void uninit_audio(void);
 
 void init_audio(void);
 
+/**
+ * audio_driver_open_async:
+ *
+ * Starts opening the audio device on a worker thread, if the
+ * audio driver allows it. init_audio() picks the result up,
+ * so this goes anywhere before it, with the same settings.
+ **/
+void audio_driver_open_async(void);
+
+/**
+ * audio_driver_flush:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ *
+ * Writes audio samples to audio driver. Will first
+ * perform DSP processing (if enabled) and resampling.
+ *
+ * Returns: true (1) if audio samples were written to the audio
+ * driver, false (0) in case of an error.
+ **/
+bool audio_driver_flush(const int16_t *data, size_t samples);
+
+/**
+ * audio_driver_autotune_update:
+ *
+ * Called once per frame. Raises the driver latency when 
+ * the driver buffer ran dry, and keeps the latency once it 
+ * has run without underruns for a while, saving it to the 
+ * core-specific config if one is in use.
+ **/
+void audio_driver_autotune_update(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,11 @@
 #include <compat/posix_string.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+/* Chains of several filters are run over blocks of this many frames,
+ * so each block stays in L1 while it passes through the whole chain. */
+#define DSP_BLOCK_FRAMES 256
 
 struct rarch_dsp_plug
 {
@@ -50,6 +55,11 @@ struct rarch_dsp_filter
 
    struct rarch_dsp_instance *instances;
    unsigned num_instances;
+
+   /* Output of block processing for chains which
+    * do not work in place. */
+   float *block_output;
+   unsigned block_output_frames;
 };
 
 static const struct dspfilter_implementation *find_implementation(
@@ -285,28 +295,95 @@ void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
    if (dsp->conf)
       config_file_free(dsp->conf);
 
+   free(dsp->block_output);
    free(dsp);
 }
 
-void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
-      struct rarch_dsp_data *data)
+static void dsp_filter_run_chain(rarch_dsp_filter_t *dsp,
+      struct dspfilter_output *output, float *samples, unsigned frames)
 {
    unsigned i;
-   struct dspfilter_output output = {0};
-   struct dspfilter_input input   = {0};
+   struct dspfilter_input input = {0};
 
-   output.samples = data->input;
-   output.frames  = data->input_frames;
+   output->samples = samples;
+   output->frames  = frames;
 
    for (i = 0; i < dsp->num_instances; i++)
    {
-      input.samples = output.samples;
-      input.frames  = output.frames;
+      input.samples = output->samples;
+      input.frames  = output->frames;
       dsp->instances[i].impl->process(
-            dsp->instances[i].impl_data, &output, &input);
+            dsp->instances[i].impl_data, output, &input);
    }
+}
+
+static bool dsp_filter_reserve_output(rarch_dsp_filter_t *dsp,
+      unsigned frames)
+{
+   float *buf;
+
+   if (frames <= dsp->block_output_frames)
+      return true;
 
-   data->output        = output.samples;
-   data->output_frames = output.frames;
+   frames *= 2;
+   buf = (float*)realloc(dsp->block_output, frames * 2 * sizeof(float));
+   if (!buf)
+      return false;
+
+   dsp->block_output        = buf;
+   dsp->block_output_frames = frames;
+   return true;
 }
 
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+   unsigned offset;
+   unsigned frames_out = 0;
+   bool in_place       = true;
+   struct dspfilter_output output = {0};
+
+   if (dsp->num_instances < 2 || data->input_frames <= DSP_BLOCK_FRAMES)
+   {
+      dsp_filter_run_chain(dsp, &output, data->input, data->input_frames);
+      data->output        = output.samples;
+      data->output_frames = output.frames;
+      return;
+   }
+
+   for (offset = 0; offset < data->input_frames; offset += DSP_BLOCK_FRAMES)
+   {
+      float *block    = data->input + offset * 2;
+      unsigned frames = data->input_frames - offset;
+
+      if (frames > DSP_BLOCK_FRAMES)
+         frames = DSP_BLOCK_FRAMES;
+
+      dsp_filter_run_chain(dsp, &output, block, frames);
+
+      /* While every block comes back in place, the output
+       * is already where it belongs. */
+      if (in_place && output.samples == block && output.frames == frames)
+      {
+         frames_out += frames;
+         continue;
+      }
+
+      if (!dsp_filter_reserve_output(dsp, frames_out + output.frames))
+         break;
+
+      if (in_place)
+      {
+         memcpy(dsp->block_output, data->input,
+               frames_out * 2 * sizeof(float));
+         in_place = false;
+      }
+
+      memcpy(dsp->block_output + frames_out * 2, output.samples,
+            output.frames * 2 * sizeof(float));
+      frames_out += output.frames;
+   }
+
+   data->output        = in_place ? data->input : dsp->block_output;
+   data->output_frames = frames_out;
+}
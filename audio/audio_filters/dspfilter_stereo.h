@@ -0,0 +1,133 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DSPFILTER_STEREO_H__
+#define DSPFILTER_STEREO_H__
+
+#include <string.h>
+
+/* One stereo frame as a two-lane vector, so filters can run
+ * the left and right channel in lockstep.
+ *
+ * With GCC and clang this uses generic vector extensions, which map
+ * to a NEON D register on ARM and the low half of an SSE register
+ * on x86 without writing intrinsics for every platform.
+ * Other compilers get a plain struct with the same interface. */
+
+#if defined(__GNUC__)
+typedef float dspfilter_stereo_t __attribute__((vector_size(8)));
+
+static inline dspfilter_stereo_t stereo_set(float l, float r)
+{
+   dspfilter_stereo_t v = { l, r };
+   return v;
+}
+
+static inline float stereo_left(dspfilter_stereo_t v)
+{
+   return v[0];
+}
+
+static inline float stereo_right(dspfilter_stereo_t v)
+{
+   return v[1];
+}
+
+static inline dspfilter_stereo_t stereo_add(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return a + b;
+}
+
+static inline dspfilter_stereo_t stereo_sub(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return a - b;
+}
+
+static inline dspfilter_stereo_t stereo_mul(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return a * b;
+}
+#else
+typedef struct
+{
+   float l, r;
+} dspfilter_stereo_t;
+
+static inline dspfilter_stereo_t stereo_set(float l, float r)
+{
+   dspfilter_stereo_t v;
+   v.l = l;
+   v.r = r;
+   return v;
+}
+
+static inline float stereo_left(dspfilter_stereo_t v)
+{
+   return v.l;
+}
+
+static inline float stereo_right(dspfilter_stereo_t v)
+{
+   return v.r;
+}
+
+static inline dspfilter_stereo_t stereo_add(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return stereo_set(a.l + b.l, a.r + b.r);
+}
+
+static inline dspfilter_stereo_t stereo_sub(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return stereo_set(a.l - b.l, a.r - b.r);
+}
+
+static inline dspfilter_stereo_t stereo_mul(dspfilter_stereo_t a,
+      dspfilter_stereo_t b)
+{
+   return stereo_set(a.l * b.l, a.r * b.r);
+}
+#endif
+
+static inline dspfilter_stereo_t stereo_dup(float v)
+{
+   return stereo_set(v, v);
+}
+
+/* a * b + c */
+static inline dspfilter_stereo_t stereo_mad(dspfilter_stereo_t a,
+      dspfilter_stereo_t b, dspfilter_stereo_t c)
+{
+   return stereo_add(stereo_mul(a, b), c);
+}
+
+/* Loads and stores an interleaved LR frame. */
+static inline dspfilter_stereo_t stereo_load(const float *in)
+{
+   dspfilter_stereo_t v;
+   memcpy(&v, in, sizeof(v));
+   return v;
+}
+
+static inline void stereo_store(float *out, dspfilter_stereo_t v)
+{
+   memcpy(out, &v, sizeof(v));
+}
+
+#endif
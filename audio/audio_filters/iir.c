@@ -15,6 +15,7 @@
  */
 
 #include "dspfilter.h"
+#include "dspfilter_stereo.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,14 +43,12 @@ enum IIRFilter {
 
 struct iir_data
 {
+   /* Coefficients are normalized by a0 at init. */
    float b0, b1, b2;
-   float a0, a1, a2;
+   float a1, a2;
 
-   struct
-   {
-      float xn1, xn2;
-      float yn1, yn2;
-   } l, r;
+   /* Transposed direct form II state, both channels in lockstep. */
+   dspfilter_stereo_t z1, z2;
 };
 
 static void iir_free(void *data)
@@ -62,60 +61,36 @@ static void iir_process(void *data, struct dspfilter_output *output,
 {
    unsigned i;
    struct iir_data *iir = (struct iir_data*)data;
+   float *out;
+   dspfilter_stereo_t b0, b1, b2, a1, a2, z1, z2;
 
    output->samples = input->samples;
    output->frames  = input->frames;
 
-   float *out = output->samples;
-
-   float b0 = iir->b0;
-   float b1 = iir->b1;
-   float b2 = iir->b2;
-   float a0 = iir->a0;
-   float a1 = iir->a1;
-   float a2 = iir->a2;
+   out = output->samples;
 
-   float xn1_l = iir->l.xn1;
-   float xn2_l = iir->l.xn2;
-   float yn1_l = iir->l.yn1;
-   float yn2_l = iir->l.yn2;
+   b0 = stereo_dup(iir->b0);
+   b1 = stereo_dup(iir->b1);
+   b2 = stereo_dup(iir->b2);
+   a1 = stereo_dup(iir->a1);
+   a2 = stereo_dup(iir->a2);
 
-   float xn1_r = iir->r.xn1;
-   float xn2_r = iir->r.xn2;
-   float yn1_r = iir->r.yn1;
-   float yn2_r = iir->r.yn2;
+   z1 = iir->z1;
+   z2 = iir->z2;
 
    for (i = 0; i < input->frames; i++, out += 2)
    {
-      float in_l = out[0];
-      float in_r = out[1];
-
-      float l = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
+      dspfilter_stereo_t in = stereo_load(out);
+      dspfilter_stereo_t res = stereo_mad(b0, in, z1);
 
-      xn2_l = xn1_l;
-      xn1_l = in_l;
-      yn2_l = yn1_l;
-      yn1_l = l;
+      z1 = stereo_sub(stereo_mad(b1, in, z2), stereo_mul(a1, res));
+      z2 = stereo_sub(stereo_mul(b2, in), stereo_mul(a2, res));
 
-      xn2_r = xn1_r;
-      xn1_r = in_r;
-      yn2_r = yn1_r;
-      yn1_r = r;
-
-      out[0] = l;
-      out[1] = r;
+      stereo_store(out, res);
    }
 
-   iir->l.xn1 = xn1_l;
-   iir->l.xn2 = xn2_l;
-   iir->l.yn1 = yn1_l;
-   iir->l.yn2 = yn2_l;
-
-   iir->r.xn1 = xn1_r;
-   iir->r.xn2 = xn2_r;
-   iir->r.yn1 = yn1_r;
-   iir->r.yn2 = yn2_r;
+   iir->z1 = z1;
+   iir->z2 = z2;
 }
 
 #define CHECK(x) if (!strcmp(str, #x)) return x
@@ -305,12 +280,12 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   /* Normalize here so processing doesn't divide on every sample. */
+   iir->b0 = b0 / a0;
+   iir->b1 = b1 / a0;
+   iir->b2 = b2 / a0;
+   iir->a1 = a1 / a0;
+   iir->a2 = a2 / a0;
 }
 
 static void *iir_init(const struct dspfilter_info *info,
@@ -15,27 +15,35 @@
  */
 
 #include "dspfilter.h"
+#include "dspfilter_stereo.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Both channels use the same tunings and parameters,
+ * so the delay lines hold interleaved stereo frames and
+ * the left and right channel are processed in lockstep. */
+
 struct comb
 {
-   float *buffer;
+   dspfilter_stereo_t *buffer;
    unsigned bufsize;
    unsigned bufidx;
 
    float feedback;
-   float filterstore;
+   dspfilter_stereo_t filterstore;
    float damp1, damp2;
 };
 
-static inline float comb_process(struct comb *c, float input)
+static inline dspfilter_stereo_t comb_process(struct comb *c,
+      dspfilter_stereo_t input)
 {
-   float output = c->buffer[c->bufidx];
-   c->filterstore = (output * c->damp2) + (c->filterstore * c->damp1);
+   dspfilter_stereo_t output = c->buffer[c->bufidx];
+   c->filterstore = stereo_add(stereo_mul(output, stereo_dup(c->damp2)),
+         stereo_mul(c->filterstore, stereo_dup(c->damp1)));
 
-   c->buffer[c->bufidx] = input + (c->filterstore * c->feedback);
+   c->buffer[c->bufidx] = stereo_add(input,
+         stereo_mul(c->filterstore, stereo_dup(c->feedback)));
 
    c->bufidx++;
    if (c->bufidx >= c->bufsize)
@@ -46,17 +54,19 @@ static inline float comb_process(struct comb *c, float input)
 
 struct allpass
 {
-   float *buffer;
+   dspfilter_stereo_t *buffer;
    float feedback;
    unsigned bufsize;
    unsigned bufidx;
 };
 
-static inline float allpass_process(struct allpass *a, float input)
+static inline dspfilter_stereo_t allpass_process(struct allpass *a,
+      dspfilter_stereo_t input)
 {
-   float bufout = a->buffer[a->bufidx];
-   float output = -input + bufout;
-   a->buffer[a->bufidx] = input + bufout * a->feedback;
+   dspfilter_stereo_t bufout = a->buffer[a->bufidx];
+   dspfilter_stereo_t output = stereo_sub(bufout, input);
+   a->buffer[a->bufidx] = stereo_add(input,
+         stereo_mul(bufout, stereo_dup(a->feedback)));
 
    a->bufidx++;
    if (a->bufidx >= a->bufsize)
@@ -100,19 +110,19 @@ struct revmodel
    struct comb combL[numcombs];
    struct allpass allpassL[numallpasses];
 
-   float bufcombL1[combtuningL1];
-   float bufcombL2[combtuningL2];
-   float bufcombL3[combtuningL3];
-   float bufcombL4[combtuningL4];
-   float bufcombL5[combtuningL5];
-   float bufcombL6[combtuningL6];
-   float bufcombL7[combtuningL7];
-   float bufcombL8[combtuningL8];
+   dspfilter_stereo_t bufcombL1[combtuningL1];
+   dspfilter_stereo_t bufcombL2[combtuningL2];
+   dspfilter_stereo_t bufcombL3[combtuningL3];
+   dspfilter_stereo_t bufcombL4[combtuningL4];
+   dspfilter_stereo_t bufcombL5[combtuningL5];
+   dspfilter_stereo_t bufcombL6[combtuningL6];
+   dspfilter_stereo_t bufcombL7[combtuningL7];
+   dspfilter_stereo_t bufcombL8[combtuningL8];
 
-   float bufallpassL1[allpasstuningL1];
-   float bufallpassL2[allpasstuningL2];
-   float bufallpassL3[allpasstuningL3];
-   float bufallpassL4[allpasstuningL4];
+   dspfilter_stereo_t bufallpassL1[allpasstuningL1];
+   dspfilter_stereo_t bufallpassL2[allpasstuningL2];
+   dspfilter_stereo_t bufallpassL3[allpasstuningL3];
+   dspfilter_stereo_t bufallpassL4[allpasstuningL4];
 
    float gain;
    float roomsize, roomsize1;
@@ -123,19 +133,20 @@ struct revmodel
    float mode;
 };
 
-static float revmodel_process(struct revmodel *rev, float in)
+static dspfilter_stereo_t revmodel_process(struct revmodel *rev,
+      dspfilter_stereo_t in)
 {
    int i;
-   float mono_out = 0.0f;
-   float mono_in = in;
-   float input = mono_in * rev->gain;
+   dspfilter_stereo_t out = stereo_dup(0.0f);
+   dspfilter_stereo_t input = stereo_mul(in, stereo_dup(rev->gain));
    for (i = 0; i < numcombs; i++)
-      mono_out += comb_process(&rev->combL[i], input);
+      out = stereo_add(out, comb_process(&rev->combL[i], input));
 
    for (i = 0; i < numallpasses; i++)
-      mono_out = allpass_process(&rev->allpassL[i], mono_out);
+      out = allpass_process(&rev->allpassL[i], out);
 
-   return mono_in * rev->dry + mono_out * rev->wet1;
+   return stereo_add(stereo_mul(in, stereo_dup(rev->dry)),
+         stereo_mul(out, stereo_dup(rev->wet1)));
 }
 
 static void revmodel_update(struct revmodel *rev)
@@ -231,7 +242,7 @@ static void revmodel_init(struct revmodel *rev)
 
 struct reverb_data
 {
-   struct revmodel left, right;
+   struct revmodel rev;
 };
 
 static void reverb_free(void *data)
@@ -244,18 +255,14 @@ static void reverb_process(void *data, struct dspfilter_output *output,
 {
    unsigned i;
    struct reverb_data *rev = (struct reverb_data*)data;
+   float *out;
 
    output->samples = input->samples;
    output->frames  = input->frames;
-   float *out = output->samples;
+   out = output->samples;
 
    for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in[2] = { out[0], out[1] };
-
-      out[0] = revmodel_process(&rev->left, in[0]);
-      out[1] = revmodel_process(&rev->right, in[1]);
-   }
+      stereo_store(out, revmodel_process(&rev->rev, stereo_load(out)));
 }
 
 static void *reverb_init(const struct dspfilter_info *info,
@@ -272,20 +279,13 @@ static void *reverb_init(const struct dspfilter_info *info,
    config->get_float(userdata, "roomwidth", &roomwidth, 0.56f);
    config->get_float(userdata, "roomsize", &roomsize, 0.56f);
 
-   revmodel_init(&rev->left);
-   revmodel_init(&rev->right);
-
-   revmodel_setdamp(&rev->left, damping);
-   revmodel_setdry(&rev->left, drytime);
-   revmodel_setwet(&rev->left, wettime);
-   revmodel_setwidth(&rev->left, roomwidth);
-   revmodel_setroomsize(&rev->left, roomsize);
+   revmodel_init(&rev->rev);
 
-   revmodel_setdamp(&rev->right, damping);
-   revmodel_setdry(&rev->right, drytime);
-   revmodel_setwet(&rev->right, wettime);
-   revmodel_setwidth(&rev->right, roomwidth);
-   revmodel_setroomsize(&rev->right, roomsize);
+   revmodel_setdamp(&rev->rev, damping);
+   revmodel_setdry(&rev->rev, drytime);
+   revmodel_setwet(&rev->rev, wettime);
+   revmodel_setwidth(&rev->rev, roomwidth);
+   revmodel_setroomsize(&rev->rev, roomsize);
 
    return rev;
 }
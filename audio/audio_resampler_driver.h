@@ -46,6 +46,7 @@ extern "C" {
 #define RESAMPLER_SIMD_AVX2     (1 << 12)
 #define RESAMPLER_SIMD_VFPU     (1 << 13)
 #define RESAMPLER_SIMD_PS       (1 << 14)
+#define RESAMPLER_SIMD_FMA      (1 << 16)
 
 /* A bit-mask of all supported SIMD instruction sets.
  * Allows an implementation to pick different 
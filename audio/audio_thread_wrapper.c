@@ -29,7 +29,10 @@ typedef struct audio_thread
 
    sthread_t *thread;
    slock_t *lock;
-   scond_t *cond;
+   /* Wakes up the audio thread. */
+   sevent_t *event_thread;
+   /* Wakes up the caller waiting for initialization. */
+   sevent_t *event_init;
    bool alive;
    bool stopped;
    bool is_paused;
@@ -43,6 +46,14 @@ typedef struct audio_thread
    unsigned latency;
 } audio_thread_t;
 
+/* Called with thr->lock held, which is dropped while waiting. */
+static void audio_thread_wait(audio_thread_t *thr, sevent_t *event)
+{
+   slock_unlock(thr->lock);
+   sevent_wait(event);
+   slock_lock(thr->lock);
+}
+
 static void audio_thread_loop(void *data)
 {
    audio_thread_t *thr = (audio_thread_t*)data;
@@ -50,13 +61,16 @@ static void audio_thread_loop(void *data)
    if (!thr)
       return;
 
+   rarch_trace_thread_name("Audio");
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_AUDIO);
+
    RARCH_LOG("[Audio Thread]: Initializing audio driver.\n");
    thr->driver_data = thr->driver->init(thr->device, thr->out_rate, thr->latency);
    slock_lock(thr->lock);
    thr->inited = thr->driver_data ? 1 : -1;
    if (thr->inited > 0 && thr->driver->use_float)
       thr->use_float = thr->driver->use_float(thr->driver_data);
-   scond_signal(thr->cond);
+   sevent_signal(thr->event_init);
    slock_unlock(thr->lock);
 
    if (thr->inited < 0)
@@ -66,7 +80,7 @@ static void audio_thread_loop(void *data)
     * stop immediately after initialization. */
    slock_lock(thr->lock);
    while (thr->stopped)
-      scond_wait(thr->cond, thr->lock);
+      audio_thread_wait(thr, thr->event_thread);
    slock_unlock(thr->lock);
 
    RARCH_LOG("[Audio Thread]: Starting audio.\n");
@@ -77,7 +91,6 @@ static void audio_thread_loop(void *data)
 
       if (!thr->alive)
       {
-         scond_signal(thr->cond);
          slock_unlock(thr->lock);
          break;
       }
@@ -86,12 +99,16 @@ static void audio_thread_loop(void *data)
       {
          thr->driver->stop(thr->driver_data);
          while (thr->stopped)
-            scond_wait(thr->cond, thr->lock);
+            audio_thread_wait(thr, thr->event_thread);
          thr->driver->start(thr->driver_data);
       }
 
       slock_unlock(thr->lock);
+
+      RARCH_PERFORMANCE_INIT(audio_thread_callback);
+      RARCH_PERFORMANCE_START(audio_thread_callback);
       g_extern.system.audio_callback.callback();
+      RARCH_PERFORMANCE_STOP(audio_thread_callback);
    }
 
    RARCH_LOG("[Audio Thread]: Tearing down driver.\n");
@@ -105,7 +122,7 @@ static void audio_thread_block(audio_thread_t *thr)
 
    slock_lock(thr->lock);
    thr->stopped = true;
-   scond_signal(thr->cond);
+   sevent_signal(thr->event_thread);
    slock_unlock(thr->lock);
 }
 
@@ -116,7 +133,7 @@ static void audio_thread_unblock(audio_thread_t *thr)
 
    slock_lock(thr->lock);
    thr->stopped = false;
-   scond_signal(thr->cond);
+   sevent_signal(thr->event_thread);
    slock_unlock(thr->lock);
 }
 
@@ -132,7 +149,7 @@ static void audio_thread_free(void *data)
       slock_lock(thr->lock);
       thr->stopped = false;
       thr->alive = false;
-      scond_signal(thr->cond);
+      sevent_signal(thr->event_thread);
       slock_unlock(thr->lock);
 
       sthread_join(thr->thread);
@@ -140,8 +157,10 @@ static void audio_thread_free(void *data)
 
    if (thr->lock)
       slock_free(thr->lock);
-   if (thr->cond)
-      scond_free(thr->cond);
+   if (thr->event_thread)
+      sevent_free(thr->event_thread);
+   if (thr->event_init)
+      sevent_free(thr->event_init);
    free(thr);
 }
 
@@ -216,7 +235,7 @@ static ssize_t audio_thread_write(void *data, const void *buf, size_t size)
    {
       slock_lock(thr->lock);
       thr->alive = false;
-      scond_signal(thr->cond);
+      sevent_signal(thr->event_thread);
       slock_unlock(thr->lock);
    }
 
@@ -265,7 +284,9 @@ bool rarch_threaded_audio_init(const audio_driver_t **out_driver, void **out_dat
    thr->out_rate = audio_out_rate;
    thr->latency = latency;
 
-   if (!(thr->cond = scond_new()))
+   if (!(thr->event_thread = sevent_new(0)))
+      goto error;
+   if (!(thr->event_init = sevent_new(0)))
       goto error;
    if (!(thr->lock = slock_new()))
       goto error;
@@ -279,7 +300,7 @@ bool rarch_threaded_audio_init(const audio_driver_t **out_driver, void **out_dat
    /* Wait until thread has initialized (or failed) the driver. */
    slock_lock(thr->lock);
    while (!thr->inited)
-      scond_wait(thr->cond, thr->lock);
+      audio_thread_wait(thr, thr->event_init);
    slock_unlock(thr->lock);
 
    if (thr->inited < 0) /* Thread failed. */
@@ -309,4 +309,5 @@ audio_driver_t audio_alsa = {
    "alsa",
    alsa_write_avail,
    alsa_buffer_size,
+   true,
 };
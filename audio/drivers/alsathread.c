@@ -38,9 +38,8 @@ typedef struct alsa_thread
    size_t period_size;
    snd_pcm_uframes_t period_frames;
 
-   fifo_buffer_t *buffer;
+   fifo_spsc_buffer_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
    scond_t *cond;
    slock_t *cond_lock;
 } alsa_thread_t;
@@ -48,8 +47,11 @@ typedef struct alsa_thread
 static void alsa_worker_thread(void *data)
 {
    alsa_thread_t *alsa = (alsa_thread_t*)data;
+   uint8_t *buf;
 
-   uint8_t *buf = (uint8_t *)calloc(1, alsa->period_size);
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_AUDIO);
+
+   buf = (uint8_t *)calloc(1, alsa->period_size);
    if (!buf)
    {
       RARCH_ERR("failed to allocate audio buffer");
@@ -58,12 +60,10 @@ static void alsa_worker_thread(void *data)
 
    while (!alsa->thread_dead)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_read_avail(alsa->buffer);
+      size_t avail = fifo_spsc_read_avail(alsa->buffer);
       size_t fifo_size = min(alsa->period_size, avail);
-      fifo_read(alsa->buffer, buf, fifo_size);
+      fifo_spsc_read(alsa->buffer, buf, fifo_size);
       scond_signal(alsa->cond);
-      slock_unlock(alsa->fifo_lock);
 
       /* If underrun, fill rest with silence. */
       memset(buf + fifo_size, 0, alsa->period_size - fifo_size);
@@ -129,11 +129,9 @@ static void alsa_thread_free(void *data)
          sthread_join(alsa->worker_thread);
       }
       if (alsa->buffer)
-         fifo_free(alsa->buffer);
+         fifo_spsc_free(alsa->buffer);
       if (alsa->cond)
          scond_free(alsa->cond);
-      if (alsa->fifo_lock)
-         slock_free(alsa->fifo_lock);
       if (alsa->cond_lock)
          slock_free(alsa->cond_lock);
       if (alsa->pcm)
@@ -208,11 +206,10 @@ static void *alsa_thread_init(const char *device,
    snd_pcm_hw_params_free(params);
    snd_pcm_sw_params_free(sw_params);
 
-   alsa->fifo_lock = slock_new();
    alsa->cond_lock = slock_new();
    alsa->cond = scond_new();
-   alsa->buffer = fifo_new(alsa->buffer_size);
-   if (!alsa->fifo_lock || !alsa->cond_lock || !alsa->cond || !alsa->buffer)
+   alsa->buffer = fifo_spsc_new(alsa->buffer_size);
+   if (!alsa->cond_lock || !alsa->cond || !alsa->buffer)
       goto error;
 
    alsa->worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -246,11 +243,9 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
 
    if (alsa->nonblock)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_write_avail(alsa->buffer);
+      size_t avail = fifo_spsc_write_avail(alsa->buffer);
       size_t write_amt = min(avail, size);
-      fifo_write(alsa->buffer, buf, write_amt);
-      slock_unlock(alsa->fifo_lock);
+      fifo_spsc_write(alsa->buffer, buf, write_amt);
       return write_amt;
    }
    else
@@ -258,12 +253,10 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
       size_t written = 0;
       while (written < size && !alsa->thread_dead)
       {
-         slock_lock(alsa->fifo_lock);
-         size_t avail = fifo_write_avail(alsa->buffer);
+         size_t avail = fifo_spsc_write_avail(alsa->buffer);
 
          if (avail == 0)
          {
-            slock_unlock(alsa->fifo_lock);
             slock_lock(alsa->cond_lock);
             if (!alsa->thread_dead)
                scond_wait(alsa->cond, alsa->cond_lock);
@@ -272,8 +265,7 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
          else
          {
             size_t write_amt = min(size - written, avail);
-            fifo_write(alsa->buffer, (const char*)buf + written, write_amt);
-            slock_unlock(alsa->fifo_lock);
+            fifo_spsc_write(alsa->buffer, (const char*)buf + written, write_amt);
             written += write_amt;
          }
       }
@@ -319,10 +311,7 @@ static size_t alsa_thread_write_avail(void *data)
 
    if (alsa->thread_dead)
       return 0;
-   slock_lock(alsa->fifo_lock);
-   size_t val = fifo_write_avail(alsa->buffer);
-   slock_unlock(alsa->fifo_lock);
-   return val;
+   return fifo_spsc_write_avail(alsa->buffer);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -343,4 +332,5 @@ audio_driver_t audio_alsathread = {
    "alsathread",
    alsa_thread_write_avail,
    alsa_thread_buffer_size,
+   true,
 };
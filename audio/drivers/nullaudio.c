@@ -78,5 +78,6 @@ audio_driver_t audio_null = {
    null_audio_use_float,
    "null",
    NULL,
-   NULL
+   NULL,
+   true,
 };
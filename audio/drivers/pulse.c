@@ -342,4 +342,5 @@ audio_driver_t audio_pulse = {
    "pulse",
    pulse_write_avail,
    pulse_buffer_size,
+   true,
 };
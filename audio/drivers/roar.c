@@ -135,5 +135,6 @@ audio_driver_t audio_roar = {
    ra_use_float,
    "roar",
    NULL,
-   NULL
+   NULL,
+   true,
 };
@@ -226,4 +226,5 @@ audio_driver_t audio_rsound = {
    "rsound",
    rs_write_avail,
    rs_buffer_size,
+   true,
 };
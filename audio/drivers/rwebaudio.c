@@ -13,15 +13,109 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "../../driver.h"
 #include "../../general.h"
 
 #include "../../emscripten/RWebAudio.h"
 
+#ifdef HAVE_THREADS
+#include <retro_miscellaneous.h>
+#endif
+
 static bool rwebaudio_is_paused;
 
+#ifdef HAVE_THREADS
+/* With threads the heap is shared, so an AudioWorklet plays
+ * straight out of this ring, with no call into JavaScript
+ * per write. pos[0] is the frame read up to, moved by the
+ * worklet, pos[1] the frame written up to. */
+static struct
+{
+   bool enable;
+   bool nonblock;
+   float *ring;
+   unsigned frames;
+   int32_t pos[2];
+} rwebaudio_worklet;
+
+static bool rwebaudio_worklet_init(unsigned rate, unsigned latency)
+{
+   unsigned frames = next_pow2(latency * rate / 1000);
+
+   rwebaudio_worklet.ring = (float*)calloc(frames * 2, sizeof(float));
+   if (!rwebaudio_worklet.ring)
+      return false;
+
+   rwebaudio_worklet.frames   = frames;
+   rwebaudio_worklet.pos[0]   = 0;
+   rwebaudio_worklet.pos[1]   = 0;
+   rwebaudio_worklet.nonblock = false;
+   rwebaudio_worklet.enable   = true;
+
+   RWebAudioWorkletStart(rwebaudio_worklet.ring, frames,
+         rwebaudio_worklet.pos);
+   return true;
+}
+
+static size_t rwebaudio_worklet_avail(void)
+{
+   int32_t used = rwebaudio_worklet.pos[1] - rwebaudio_worklet.pos[0];
+   return rwebaudio_worklet.frames - used;
+}
+
+static ssize_t rwebaudio_worklet_write(const float *buf, size_t size)
+{
+   size_t frames  = size / (2 * sizeof(float));
+   size_t written = 0;
+   unsigned mask  = rwebaudio_worklet.frames - 1;
+
+   while (written < frames)
+   {
+      size_t avail = rwebaudio_worklet_avail();
+      int32_t pos  = rwebaudio_worklet.pos[1];
+      size_t i;
+
+      if (!avail)
+      {
+         if (rwebaudio_worklet.nonblock)
+            break;
+         rarch_sleep(1);
+         continue;
+      }
+
+      if (avail > frames - written)
+         avail = frames - written;
+
+      for (i = 0; i < avail; i++)
+      {
+         float *frame = &rwebaudio_worklet.ring[((pos + i) & mask) * 2];
+         frame[0]     = buf[(written + i) * 2];
+         frame[1]     = buf[(written + i) * 2 + 1];
+      }
+
+      __sync_synchronize();
+      rwebaudio_worklet.pos[1] = pos + (int32_t)avail;
+      written += avail;
+   }
+
+   return written * 2 * sizeof(float);
+}
+#endif
+
 static void rwebaudio_free(void *data)
 {
+#ifdef HAVE_THREADS
+   if (rwebaudio_worklet.enable)
+   {
+      RWebAudioWorkletFree();
+      free(rwebaudio_worklet.ring);
+      memset(&rwebaudio_worklet, 0, sizeof(rwebaudio_worklet));
+      return;
+   }
+#endif
    RWebAudioFree();
 }
 
@@ -30,6 +124,22 @@ static void *rwebaudio_init(const char *device, unsigned rate, unsigned latency)
    void *data;
    (void)device;
    (void)rate;
+
+#ifdef HAVE_THREADS
+   if (RWebAudioWorkletInit())
+   {
+      unsigned out_rate = RWebAudioSampleRate();
+
+      if (rwebaudio_worklet_init(out_rate, latency))
+      {
+         RARCH_LOG("[RWebAudio]: Playing through an AudioWorklet.\n");
+         g_settings.audio.out_rate = out_rate;
+         return (void*)1;
+      }
+      RWebAudioWorkletFree();
+   }
+#endif
+
    data = RWebAudioInit(latency);
 
    if (data)
@@ -40,6 +150,10 @@ static void *rwebaudio_init(const char *device, unsigned rate, unsigned latency)
 static ssize_t rwebaudio_write(void *data, const void *buf, size_t size)
 {
    (void)data;
+#ifdef HAVE_THREADS
+   if (rwebaudio_worklet.enable)
+      return rwebaudio_worklet_write((const float*)buf, size);
+#endif
    return RWebAudioWrite(buf, size);
 }
 
@@ -53,6 +167,9 @@ static bool rwebaudio_stop(void *data)
 static void rwebaudio_set_nonblock_state(void *data, bool state)
 {
    (void)data;
+#ifdef HAVE_THREADS
+   rwebaudio_worklet.nonblock = state;
+#endif
    RWebAudioSetNonblockState(state);
 }
 
@@ -78,12 +195,20 @@ static bool rwebaudio_use_float(void *data)
 static size_t rwebaudio_write_avail(void *data)
 {
    (void)data;
+#ifdef HAVE_THREADS
+   if (rwebaudio_worklet.enable)
+      return rwebaudio_worklet_avail() * 2 * sizeof(float);
+#endif
    return RWebAudioWriteAvail();
 }
 
 static size_t rwebaudio_buffer_size(void *data)
 {
    (void)data;
+#ifdef HAVE_THREADS
+   if (rwebaudio_worklet.enable)
+      return rwebaudio_worklet.frames * 2 * sizeof(float);
+#endif
    return RWebAudioBufferSize();
 }
 
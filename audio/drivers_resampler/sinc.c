@@ -32,6 +32,41 @@
 #include <xmmintrin.h>
 #endif
 
+/* AVX and FMA kernels are built with function-level target 
+ * attributes and picked at runtime from the CPU feature mask, 
+ * so they do not depend on the global compiler flags. */
+#if defined(__AVX__)
+#define SINC_HAVE_AVX
+#define SINC_TARGET_AVX
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__SSE__) \
+   && (defined(__clang__) || __GNUC__ > 4 || \
+         (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SINC_HAVE_AVX
+#define SINC_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+#if defined(__FMA__)
+#define SINC_HAVE_FMA
+#define SINC_TARGET_FMA
+#elif defined(SINC_HAVE_AVX) && defined(__GNUC__)
+#define SINC_HAVE_FMA
+#define SINC_TARGET_FMA __attribute__((target("avx,fma")))
+#endif
+
+#ifdef SINC_HAVE_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__ALTIVEC__)
+#include <altivec.h>
+#endif
+
+/* For the little amount of taps most quality levels use,
+ * SSE1 is faster than AVX for some reason.
+ * By increasing number of sinc taps, the AVX code is 
+ * clearly faster than SSE1, so only use it from here. */
+#define SINC_AVX_MIN_TAPS 64
+
 /* Rough SNR values for upsampling:
  * LOWEST: 40 dB
  * LOWER: 55 dB
@@ -48,7 +83,6 @@
 #define SINC_COEFF_LERP 0
 #define SUBPHASE_BITS 10
 #define SIDELOBES 2
-#define ENABLE_AVX 0
 #elif defined(SINC_LOWER_QUALITY)
 #define SINC_WINDOW_LANCZOS
 #define CUTOFF 0.98
@@ -56,7 +90,6 @@
 #define SUBPHASE_BITS 10
 #define SINC_COEFF_LERP 0
 #define SIDELOBES 4
-#define ENABLE_AVX 0
 #elif defined(SINC_HIGHER_QUALITY)
 #define SINC_WINDOW_KAISER
 #define SINC_WINDOW_KAISER_BETA 10.5
@@ -65,7 +98,6 @@
 #define SUBPHASE_BITS 14
 #define SINC_COEFF_LERP 1
 #define SIDELOBES 32
-#define ENABLE_AVX 1
 #elif defined(SINC_HIGHEST_QUALITY)
 #define SINC_WINDOW_KAISER
 #define SINC_WINDOW_KAISER_BETA 14.5
@@ -74,7 +106,6 @@
 #define SUBPHASE_BITS 14
 #define SINC_COEFF_LERP 1
 #define SIDELOBES 128
-#define ENABLE_AVX 1
 #else
 #define SINC_WINDOW_KAISER
 #define SINC_WINDOW_KAISER_BETA 5.5
@@ -83,17 +114,6 @@
 #define SUBPHASE_BITS 16
 #define SINC_COEFF_LERP 1
 #define SIDELOBES 8
-#define ENABLE_AVX 0
-#endif
-
-/* For the little amount of taps we're using,
- * SSE1 is faster than AVX for some reason.
- * AVX code is kept here though as by increasing number
- * of sinc taps, the AVX code is clearly faster than SSE1.
- */
-
-#if defined(__AVX__) && ENABLE_AVX
-#include <immintrin.h>
 #endif
 
 #define PHASES (1 << (PHASE_BITS + SUBPHASE_BITS))
@@ -102,9 +122,32 @@
 #define SUBPHASE_MASK ((1 << SUBPHASE_BITS) - 1)
 #define SUBPHASE_MOD (1.0f / (1 << SUBPHASE_BITS))
 
-typedef struct rarch_sinc_resampler
+/* Taps are stored in blocks of SINC_BLOCK. With coefficient lerp, 
+ * every block of coefficients is directly followed by its block of 
+ * deltas, so a kernel reads one phase as a single linear stream:
+ *
+ * { c0 .. c7, d0 .. d7, c8 .. c15, d8 .. d15, ... }
+ */
+#define SINC_BLOCK 8
+
+#if SINC_COEFF_LERP
+#define SINC_BLOCK_STRIDE (2 * SINC_BLOCK)
+#else
+#define SINC_BLOCK_STRIDE SINC_BLOCK
+#endif
+
+typedef struct rarch_sinc_resampler rarch_sinc_resampler_t;
+
+typedef void (*process_sinc_t)(rarch_sinc_resampler_t *resamp,
+      float *out_buffer);
+
+struct rarch_sinc_resampler
 {
-   float *phase_table;
+   process_sinc_t process;
+
+   /* Shared between all resamplers with the same 
+    * configuration, see sinc_table_acquire(). */
+   const float *phase_table;
    float *buffer_l;
    float *buffer_r;
 
@@ -113,11 +156,11 @@ typedef struct rarch_sinc_resampler
    unsigned ptr;
    uint32_t time;
 
-   /* A buffer for phase_table, buffer_l and buffer_r 
-    * are created in a single calloc().
+   /* A buffer for buffer_l and buffer_r 
+    * are created in a single allocation.
     * Ensure that we get as good cache locality as we can hope for. */
    float *main_buffer;
-} rarch_sinc_resampler_t;
+};
 
 static inline double sinc(double val)
 {
@@ -168,58 +211,57 @@ static inline double window_function(double idx)
 #error "No SINC window function defined."
 #endif
 
-static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
-      float *phase_table, int phases, int taps, bool calculate_delta)
+/* Offset of tap j in phase i, see SINC_BLOCK. */
+static inline size_t sinc_table_index(unsigned taps,
+      unsigned i, unsigned j)
 {
-   int i, j, p;
+   return i * taps * (SINC_BLOCK_STRIDE / SINC_BLOCK)
+      + (j / SINC_BLOCK) * SINC_BLOCK_STRIDE + (j % SINC_BLOCK);
+}
+
+static double sinc_value(double cutoff, double window_mod,
+      int n, int phases, int taps)
+{
+   double sidelobes    = taps / 2.0;
+   double window_phase = (double)n / (phases * taps); /* [0, 1]. */
+   double sinc_phase;
+
+   window_phase = 2.0 * window_phase - 1.0; /* [-1, 1] */
+   sinc_phase   = sidelobes * window_phase;
+
+   return cutoff * sinc(M_PI * sinc_phase * cutoff) * 
+      window_function(window_phase) / window_mod;
+}
+
+static void init_sinc_table(double cutoff, float *phase_table,
+      int phases, int taps, bool calculate_delta)
+{
+   int i, j;
    double window_mod = window_function(0.0); /* Need to normalize w(0) to 1.0. */
-   int stride = calculate_delta ? 2 : 1;
-   double sidelobes = taps / 2.0;
 
-   for (i = 0; i < phases; i++)
+   for (j = 0; j < taps; j++)
    {
-      for (j = 0; j < taps; j++)
-      {
-         double window_phase, sinc_phase;
-         float val;
-         int n = j * phases + i;
-         window_phase = (double)n / (phases * taps); /* [0, 1). */
-         window_phase = 2.0 * window_phase - 1.0; /* [-1, 1) */
-         sinc_phase = sidelobes * window_phase;
-
-         val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
-         phase_table[i * stride * taps + j] = val;
-      }
-   }
+      double val = sinc_value(cutoff, window_mod, j * phases, phases, taps);
 
-   if (calculate_delta)
-   {
-      int phase;
-      for (p = 0; p < phases - 1; p++)
+      for (i = 0; i < phases; i++)
       {
-         for (j = 0; j < taps; j++)
+         float *coeff = phase_table + sinc_table_index(taps, i, j);
+
+         *coeff = val;
+
+         if (!calculate_delta)
          {
-            float delta = phase_table[(p + 1) * stride * taps + j] - 
-               phase_table[p * stride * taps + j];
-            phase_table[(p * stride + 1) * taps + j] = delta;
+            if (i + 1 < phases)
+               val = sinc_value(cutoff, window_mod,
+                     j * phases + i + 1, phases, taps);
+            continue;
          }
-      }
 
-      phase = phases - 1;
-      for (j = 0; j < taps; j++)
-      {
-         float val, delta;
-         double window_phase, sinc_phase;
-         int n = j * phases + (phase + 1);
-         window_phase = (double)n / (phases * taps); /* (0, 1]. */
-         window_phase = 2.0 * window_phase - 1.0; /* (-1, 1] */
-         sinc_phase = sidelobes * window_phase;
-
-         val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
-         delta = (val - phase_table[phase * stride * taps + j]);
-         phase_table[(phase * stride + 1) * taps + j] = delta;
+         /* The delta of the last phase goes towards 
+          * the first phase of the next tap. */
+         val = sinc_value(cutoff, window_mod,
+               j * phases + i + 1, phases, taps);
+         coeff[SINC_BLOCK] = (float)val - *coeff;
       }
    }
 }
@@ -248,169 +290,391 @@ static void aligned_free__(void *ptr)
    free(p[-1]);
 }
 
-#if !(defined(__AVX__) && ENABLE_AVX) && !defined(__SSE__)
-static inline void process_sinc_C(rarch_sinc_resampler_t *resamp,
+/* Computing a table takes several milliseconds at the higher 
+ * quality levels, and the audio driver reinits the resampler 
+ * every time the refresh rate or the input rate changes. 
+ * Tables are kept process-wide per (cutoff, taps), shared 
+ * read-only between resamplers, and a few unused ones are 
+ * kept around for the next reinit.
+ *
+ * Resamplers are created and freed on the main thread only, 
+ * so the cache is not locked. */
+#define SINC_TABLE_CACHE_UNUSED 2
+
+struct sinc_table
+{
+   struct sinc_table *next;
+   float *table;
+   double cutoff;
+   unsigned taps;
+   unsigned refcount;
+};
+
+/* Most recently used first. */
+static struct sinc_table *sinc_tables;
+
+static void sinc_table_prune(void)
+{
+   unsigned unused = 0;
+   struct sinc_table **entry = &sinc_tables;
+
+   while (*entry)
+   {
+      struct sinc_table *table = *entry;
+
+      if (table->refcount || ++unused <= SINC_TABLE_CACHE_UNUSED)
+      {
+         entry = &table->next;
+         continue;
+      }
+
+      *entry = table->next;
+      aligned_free__(table->table);
+      free(table);
+   }
+}
+
+static const float *sinc_table_acquire(double cutoff, unsigned taps)
+{
+   size_t elems;
+   struct sinc_table *table;
+   struct sinc_table **entry = &sinc_tables;
+
+   for (; *entry; entry = &(*entry)->next)
+   {
+      table = *entry;
+      if (table->cutoff != cutoff || table->taps != taps)
+         continue;
+
+      /* Move to front. */
+      *entry          = table->next;
+      table->next     = sinc_tables;
+      sinc_tables     = table;
+      table->refcount++;
+      return table->table;
+   }
+
+   table = (struct sinc_table*)calloc(1, sizeof(*table));
+   if (!table)
+      return NULL;
+
+   elems = (1 << PHASE_BITS) * taps;
+#if SINC_COEFF_LERP
+   elems *= 2;
+#endif
+
+   table->table = (float*)aligned_alloc__(128, sizeof(float) * elems);
+   if (!table->table)
+   {
+      free(table);
+      return NULL;
+   }
+
+   init_sinc_table(cutoff, table->table,
+         1 << PHASE_BITS, taps, SINC_COEFF_LERP);
+
+   table->cutoff   = cutoff;
+   table->taps     = taps;
+   table->refcount = 1;
+   table->next     = sinc_tables;
+   sinc_tables     = table;
+
+   sinc_table_prune();
+   return table->table;
+}
+
+static void sinc_table_release(const float *phase_table)
+{
+   struct sinc_table *table;
+
+   for (table = sinc_tables; table; table = table->next)
+   {
+      if (table->table != phase_table)
+         continue;
+
+      table->refcount--;
+      break;
+   }
+
+   sinc_table_prune();
+}
+
+static inline const float *sinc_phase_table(
+      const rarch_sinc_resampler_t *resamp)
+{
+   unsigned phase = resamp->time >> SUBPHASE_BITS;
+   return resamp->phase_table + sinc_table_index(resamp->taps, phase, 0);
+}
+
+static void process_sinc_C(rarch_sinc_resampler_t *resamp,
       float *out_buffer)
 {
-   unsigned i;
+   unsigned i, j;
    float sum_l = 0.0f;
    float sum_r = 0.0f;
-   const float *buffer_l = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r = resamp->buffer_r + resamp->ptr;
-
-   unsigned taps  = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+   const float *phase_table = sinc_phase_table(resamp);
+   unsigned taps            = resamp->taps;
 #if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
    float delta = (float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
 #endif
 
-   for (i = 0; i < taps; i++)
+   for (i = 0; i < taps; i += SINC_BLOCK, phase_table += SINC_BLOCK_STRIDE)
    {
+      for (j = 0; j < SINC_BLOCK; j++)
+      {
 #if SINC_COEFF_LERP
-      float sinc_val = phase_table[i] + delta_table[i] * delta;
+         float sinc_val = phase_table[j] + phase_table[j + SINC_BLOCK] * delta;
 #else
-      float sinc_val = phase_table[i];
+         float sinc_val = phase_table[j];
 #endif
-      sum_l         += buffer_l[i] * sinc_val;
-      sum_r         += buffer_r[i] * sinc_val;
+         sum_l         += buffer_l[i + j] * sinc_val;
+         sum_r         += buffer_r[i + j] * sinc_val;
+      }
    }
 
    out_buffer[0] = sum_l;
    out_buffer[1] = sum_r;
 }
+
+#if defined(__SSE__)
+static inline void sinc_store_sse(float *out_buffer,
+      __m128 sum_l, __m128 sum_r)
+{
+   /* Them annoying shuffles.
+    * sum_l = { l3, l2, l1, l0 }
+    * sum_r = { r3, r2, r1, r0 }
+    */
+
+   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+            _MM_SHUFFLE(1, 0, 1, 0)),
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+
+   /* sum   = { r1, r0, l1, l0 } + { r3, r2, l3, l2 }
+    * sum   = { R1, R0, L1, L0 }
+    */
+
+   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+
+   /* sum   = {R1, R1, L1, L1 } + { R1, R0, L1, L0 }
+    * sum   = { X,  R,  X,  L } 
+    */
+
+   /* Store L */
+   _mm_store_ss(out_buffer + 0, sum);
+
+   /* movehl { X, R, X, L } == { X, R, X, R } */
+   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
+}
+
+static void process_sinc_sse(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
+{
+   unsigned i, j;
+   __m128 sum_l = _mm_setzero_ps();
+   __m128 sum_r = _mm_setzero_ps();
+
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+   const float *phase_table = sinc_phase_table(resamp);
+   unsigned taps            = resamp->taps;
+#if SINC_COEFF_LERP
+   __m128 delta = _mm_set1_ps((float)
+         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
 #endif
 
-#if defined(__AVX__) && ENABLE_AVX
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+   for (i = 0; i < taps; i += SINC_BLOCK, phase_table += SINC_BLOCK_STRIDE)
+   {
+      for (j = 0; j < SINC_BLOCK; j += 4)
+      {
+         __m128 buf_l = _mm_loadu_ps(buffer_l + i + j);
+         __m128 buf_r = _mm_loadu_ps(buffer_r + i + j);
+
+#if SINC_COEFF_LERP
+         __m128 deltas = _mm_load_ps(phase_table + j + SINC_BLOCK);
+         __m128 _sinc = _mm_add_ps(_mm_load_ps(phase_table + j),
+               _mm_mul_ps(deltas, delta));
+#else
+         __m128 _sinc = _mm_load_ps(phase_table + j);
+#endif
+         sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
+         sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      }
+   }
+
+   sinc_store_sse(out_buffer, sum_l, sum_r);
+}
+#endif
+
+#if defined(SINC_HAVE_AVX)
+SINC_TARGET_AVX
+static void process_sinc_avx(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
 {
    unsigned i;
    __m256 sum_l = _mm256_setzero_ps();
    __m256 sum_r = _mm256_setzero_ps();
 
-   const float *buffer_l = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r = resamp->buffer_r + resamp->ptr;
-
-   unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+   const float *phase_table = sinc_phase_table(resamp);
+   unsigned taps            = resamp->taps;
 #if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
    __m256 delta = _mm256_set1_ps((float)
          (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
 #endif
 
-   for (i = 0; i < taps; i += 8)
+   for (i = 0; i < taps; i += SINC_BLOCK, phase_table += SINC_BLOCK_STRIDE)
    {
       __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
       __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
 
 #if SINC_COEFF_LERP
-      __m256 deltas = _mm256_load_ps(delta_table + i);
-      __m256 sinc = _mm256_add_ps(_mm256_load_ps(phase_table + i),
+      __m256 deltas = _mm256_load_ps(phase_table + SINC_BLOCK);
+      __m256 sinc = _mm256_add_ps(_mm256_load_ps(phase_table),
             _mm256_mul_ps(deltas, delta));
 #else
-      __m256 sinc = _mm256_load_ps(phase_table + i);
+      __m256 sinc = _mm256_load_ps(phase_table);
 #endif
       sum_l       = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
       sum_r       = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
    }
 
-   /* hadd on AVX is weird, and acts on low-lanes 
-    * and high-lanes separately. */
-   __m256 res_l = _mm256_hadd_ps(sum_l, sum_l);
-   __m256 res_r = _mm256_hadd_ps(sum_r, sum_r);
-   res_l = _mm256_hadd_ps(res_l, res_l);
-   res_r = _mm256_hadd_ps(res_r, res_r);
-   res_l = _mm256_add_ps(_mm256_permute2f128_ps(res_l, res_l, 1), res_l);
-   res_r = _mm256_add_ps(_mm256_permute2f128_ps(res_r, res_r, 1), res_r);
-
-   /* This is optimized to mov %xmmN, [mem].
-    * There doesn't seem to be any _mm256_store_ss intrinsic. */
-   _mm_store_ss(out_buffer + 0, _mm256_extractf128_ps(res_l, 0));
-   _mm_store_ss(out_buffer + 1, _mm256_extractf128_ps(res_r, 0));
+   /* Fold the high lanes onto the low lanes, 
+    * the rest is the same as SSE. */
+   sinc_store_sse(out_buffer,
+         _mm_add_ps(_mm256_castps256_ps128(sum_l),
+            _mm256_extractf128_ps(sum_l, 1)),
+         _mm_add_ps(_mm256_castps256_ps128(sum_r),
+            _mm256_extractf128_ps(sum_r, 1)));
 }
-#elif defined(__SSE__)
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+#endif
+
+#if defined(SINC_HAVE_FMA)
+/* Both channels share one coefficient stream. Two sets of 
+ * accumulators hide the latency of the dependent FMAs. */
+SINC_TARGET_FMA
+static void process_sinc_fma(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
 {
    unsigned i;
-   __m128 sum_l = _mm_setzero_ps();
-   __m128 sum_r = _mm_setzero_ps();
-
-   const float *buffer_l = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r = resamp->buffer_r + resamp->ptr;
-
-   unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
+   __m256 sum_l0 = _mm256_setzero_ps();
+   __m256 sum_r0 = _mm256_setzero_ps();
+   __m256 sum_l1 = _mm256_setzero_ps();
+   __m256 sum_r1 = _mm256_setzero_ps();
+
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+   const float *phase_table = sinc_phase_table(resamp);
+   unsigned taps            = resamp->taps;
 #if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m128 delta = _mm_set1_ps((float)
+   __m256 delta = _mm256_set1_ps((float)
          (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
+#define SINC_FMA_COEFF(table) _mm256_fmadd_ps( \
+      _mm256_load_ps((table) + SINC_BLOCK), delta, _mm256_load_ps(table))
 #else
-   const float *phase_table = resamp->phase_table + phase * taps;
+#define SINC_FMA_COEFF(table) _mm256_load_ps(table)
 #endif
 
-   for (i = 0; i < taps; i += 4)
+   for (i = 0; i + 2 * SINC_BLOCK <= taps; i += 2 * SINC_BLOCK,
+         phase_table += 2 * SINC_BLOCK_STRIDE)
+   {
+      __m256 sinc0 = SINC_FMA_COEFF(phase_table);
+      __m256 sinc1 = SINC_FMA_COEFF(phase_table + SINC_BLOCK_STRIDE);
+
+      sum_l0 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i), sinc0, sum_l0);
+      sum_r0 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i), sinc0, sum_r0);
+      sum_l1 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i + SINC_BLOCK),
+            sinc1, sum_l1);
+      sum_r1 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i + SINC_BLOCK),
+            sinc1, sum_r1);
+   }
+
+   if (i < taps)
    {
-      __m128 buf_l = _mm_loadu_ps(buffer_l + i);
-      __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+      __m256 sinc0 = SINC_FMA_COEFF(phase_table);
 
-#if SINC_COEFF_LERP
-      __m128 deltas = _mm_load_ps(delta_table + i);
-      __m128 _sinc = _mm_add_ps(_mm_load_ps(phase_table + i),
-            _mm_mul_ps(deltas, delta));
-#else
-      __m128 _sinc = _mm_load_ps(phase_table + i);
-#endif
-      sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
-      sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      sum_l0 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i), sinc0, sum_l0);
+      sum_r0 = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i), sinc0, sum_r0);
    }
+#undef SINC_FMA_COEFF
 
-   /* Them annoying shuffles.
-    * sum_l = { l3, l2, l1, l0 }
-    * sum_r = { r3, r2, r1, r0 }
-    */
+   sum_l0 = _mm256_add_ps(sum_l0, sum_l1);
+   sum_r0 = _mm256_add_ps(sum_r0, sum_r1);
 
-   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
-            _MM_SHUFFLE(1, 0, 1, 0)),
-         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+   sinc_store_sse(out_buffer,
+         _mm_add_ps(_mm256_castps256_ps128(sum_l0),
+            _mm256_extractf128_ps(sum_l0, 1)),
+         _mm_add_ps(_mm256_castps256_ps128(sum_r0),
+            _mm256_extractf128_ps(sum_r0, 1)));
+}
+#endif
 
-   /* sum   = { r1, r0, l1, l0 } + { r3, r2, l3, l2 }
-    * sum   = { R1, R0, L1, L0 }
-    */
+#if defined(__ALTIVEC__)
+/* The history buffers are read at any offset. */
+static inline vector float sinc_load_unaligned_altivec(const float *ptr)
+{
+   return vec_perm(vec_ld(0, ptr), vec_ld(15, ptr), vec_lvsl(0, ptr));
+}
 
-   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+static inline float sinc_sum_altivec(vector float sum)
+{
+   float out;
 
-   /* sum   = {R1, R1, L1, L1 } + { R1, R0, L1, L0 }
-    * sum   = { X,  R,  X,  L } 
-    */
+   sum = vec_add(sum, vec_sld(sum, sum, 8));
+   sum = vec_add(sum, vec_sld(sum, sum, 4));
 
-   /* Store L */
-   _mm_store_ss(out_buffer + 0, sum);
+   /* Every element holds the sum now. */
+   vec_ste(sum, 0, &out);
+   return out;
+}
 
-   /* movehl { X, R, X, L } == { X, R, X, R } */
-   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
+static void process_sinc_altivec(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
+{
+   unsigned i, j;
+   const vector float zero  = (vector float)vec_splat_u32(0);
+   vector float sum_l       = zero;
+   vector float sum_r       = zero;
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+   const float *phase_table = sinc_phase_table(resamp);
+   unsigned taps            = resamp->taps;
+#if SINC_COEFF_LERP
+   float delta_val          = (float)
+      (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
+   const vector float delta = vec_splat(vec_lde(0, &delta_val), 0);
+#endif
+
+   for (i = 0; i < taps; i += SINC_BLOCK, phase_table += SINC_BLOCK_STRIDE)
+   {
+      for (j = 0; j < SINC_BLOCK; j += 4)
+      {
+         vector float buf_l = sinc_load_unaligned_altivec(buffer_l + i + j);
+         vector float buf_r = sinc_load_unaligned_altivec(buffer_r + i + j);
+
+#if SINC_COEFF_LERP
+         vector float sinc  = vec_madd(vec_ld(0, phase_table + j + SINC_BLOCK),
+               delta, vec_ld(0, phase_table + j));
+#else
+         vector float sinc  = vec_ld(0, phase_table + j);
+#endif
+         sum_l              = vec_madd(buf_l, sinc, sum_l);
+         sum_r              = vec_madd(buf_r, sinc, sum_r);
+      }
+   }
+
+   out_buffer[0] = sinc_sum_altivec(sum_l);
+   out_buffer[1] = sinc_sum_altivec(sum_r);
 }
-#elif defined(__ARM_NEON__)
+#endif
 
+#if defined(__ARM_NEON__)
 #if SINC_COEFF_LERP
 #error "NEON asm does not support SINC lerp."
 #endif
 
-/* Need to make this function pointer as Android doesn't 
- * have built-in targets for NEON and plain ARMv7a.
- */
-static void (*process_sinc_func)(rarch_sinc_resampler_t *resamp,
-      float *out_buffer);
-
 /* Assumes that taps >= 8, and that taps is a multiple of 8. */
 void process_sinc_neon_asm(float *out, const float *left, 
       const float *right, const float *coeff, unsigned taps);
@@ -421,14 +685,9 @@ static void process_sinc_neon(rarch_sinc_resampler_t *resamp,
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-   unsigned taps = resamp->taps;
-   const float *phase_table = resamp->phase_table + phase * taps;
-
-   process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, taps);
+   process_sinc_neon_asm(out_buffer, buffer_l, buffer_r,
+         sinc_phase_table(resamp), resamp->taps);
 }
-#else /* Plain ol' C99 */
-#define process_sinc_func process_sinc_C
 #endif
 
 static void resampler_sinc_process(void *re_, struct resampler_data *data)
@@ -460,7 +719,7 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
 
       while (re->time < PHASES)
       {
-         process_sinc_func(re, output);
+         re->process(re, output);
          output += 2;
          out_frames++;
          re->time += ratio;
@@ -474,15 +733,21 @@ static void resampler_sinc_free(void *re)
 {
    rarch_sinc_resampler_t *resampler = (rarch_sinc_resampler_t*)re;
    if (resampler)
-      aligned_free__(resampler->main_buffer);
+   {
+      if (resampler->phase_table)
+         sinc_table_release(resampler->phase_table);
+      if (resampler->main_buffer)
+         aligned_free__(resampler->main_buffer);
+   }
    free(resampler);
 }
 
 static void *resampler_sinc_new(const struct resampler_config *config,
       double bandwidth_mod, resampler_simd_mask_t mask)
 {
-   size_t phase_elems, elems;
+   size_t elems;
    double cutoff;
+   const char *ident = NULL;
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)
       calloc(1, sizeof(*re));
    (void)config;
@@ -503,44 +768,65 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
    }
 
-   /* Be SIMD-friendly. */
-#if (defined(__AVX__) && ENABLE_AVX) || defined(__ARM_NEON__)
-   re->taps = (re->taps + 7) & ~7;
-#else
-   re->taps = (re->taps + 3) & ~3;
-#endif
+   /* Be SIMD-friendly, kernels work on whole blocks. */
+   re->taps = (re->taps + SINC_BLOCK - 1) & ~(SINC_BLOCK - 1);
 
-   phase_elems = (1 << PHASE_BITS) * re->taps;
-#if SINC_COEFF_LERP
-   phase_elems *= 2;
-#endif
-   elems = phase_elems + 4 * re->taps;
+   elems = 4 * re->taps;
 
    re->main_buffer = (float*)
       aligned_alloc__(128, sizeof(float) * elems);
    if (!re->main_buffer)
       goto error;
 
-   re->phase_table = re->main_buffer;
-   re->buffer_l = re->main_buffer + phase_elems;
+   memset(re->main_buffer, 0, sizeof(float) * elems);
+   re->buffer_l = re->main_buffer;
    re->buffer_r = re->buffer_l + 2 * re->taps;
 
-   init_sinc_table(re, cutoff, re->phase_table,
-         1 << PHASE_BITS, re->taps, SINC_COEFF_LERP);
-
-#if defined(__AVX__) && ENABLE_AVX
-   RARCH_LOG("Sinc resampler [AVX]\n");
-#elif defined(__SSE__)
-   RARCH_LOG("Sinc resampler [SSE]\n");
-#elif defined(__ARM_NEON__)
-   process_sinc_func = mask & RESAMPLER_SIMD_NEON 
-      ? process_sinc_neon : process_sinc_C;
-   RARCH_LOG("Sinc resampler [%s]\n",
-         mask & RESAMPLER_SIMD_NEON ? "NEON" : "C");
-#else
-   RARCH_LOG("Sinc resampler [C]\n");
+   re->phase_table = sinc_table_acquire(cutoff, re->taps);
+   if (!re->phase_table)
+      goto error;
+
+   re->process = process_sinc_C;
+   ident       = "C";
+
+#if defined(__SSE__)
+   re->process = process_sinc_sse;
+   ident       = "SSE";
+#endif
+
+#if defined(SINC_HAVE_AVX)
+   if (re->taps >= SINC_AVX_MIN_TAPS && (mask & RESAMPLER_SIMD_AVX))
+   {
+      re->process = process_sinc_avx;
+      ident       = "AVX";
+
+#if defined(SINC_HAVE_FMA)
+      if (mask & RESAMPLER_SIMD_FMA)
+      {
+         re->process = process_sinc_fma;
+         ident       = "AVX+FMA";
+      }
+#endif
+   }
+#endif
+
+#if defined(__ALTIVEC__)
+   if (mask & RESAMPLER_SIMD_VMX)
+   {
+      re->process = process_sinc_altivec;
+      ident       = "AltiVec";
+   }
+#endif
+
+#if defined(__ARM_NEON__)
+   if (mask & RESAMPLER_SIMD_NEON)
+   {
+      re->process = process_sinc_neon;
+      ident       = "NEON";
+   }
 #endif
 
+   RARCH_LOG("Sinc resampler [%s]\n", ident);
    RARCH_LOG("SINC params (%u phase bits, %u taps).\n",
          PHASE_BITS, re->taps);
    return re;
@@ -0,0 +1,488 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Drives every compiled audio driver and resampler through
+ * audio_driver.c like a core running at a fixed frame rate with
+ * jittery frame pacing and a slightly wrong clock, and reports
+ * buffer occupancy, underruns and CPU cost of each combination.
+ *
+ * Built with "make audio-latency" from the top level directory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <errno.h>
+#include <string/string_list.h>
+
+#include "../../general.h"
+#include "../../driver.h"
+#include "../../retroarch.h"
+#include "../audio_driver.h"
+#include "../audio_dsp_filter.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct settings g_settings;
+struct global g_extern;
+driver_t driver;
+
+/* The harness runs without a frontend, a core or DSP plugins. */
+int find_driver_index(const char *label, const char *drv)
+{
+   unsigned i;
+
+   (void)label;
+
+   for (i = 0; audio_driver_find_handle(i); i++)
+      if (!strcasecmp(drv, audio_driver_find_ident(i)))
+         return i;
+
+   return -1;
+}
+
+bool rarch_main_command(unsigned action)
+{
+   (void)action;
+   return true;
+}
+
+bool config_save_file(const char *path)
+{
+   (void)path;
+   return false;
+}
+
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+   (void)dsp;
+   (void)data;
+}
+
+struct bench_config
+{
+   double in_rate;
+   unsigned out_rate;
+   double fps;
+   double jitter_ms;
+   double skew;
+   double seconds;
+   unsigned latency;
+   bool rate_control;
+   const char *csv_prefix;
+};
+
+struct bench_result
+{
+   bool has_stats;
+   unsigned frames;
+   unsigned underruns;
+   unsigned late_frames;
+   double fill_avg_ms;
+   double fill_min_ms;
+   double fill_max_ms;
+   double pipeline_ms_per_sec;
+   double cpu_percent;
+};
+
+static double bench_time(clockid_t clock)
+{
+   struct timespec ts;
+   clock_gettime(clock, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void bench_sleep_until(double deadline)
+{
+   struct timespec ts;
+   ts.tv_sec  = (time_t)deadline;
+   ts.tv_nsec = (long)((deadline - ts.tv_sec) * 1000000000.0);
+   while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+static void bench_init_settings(const struct bench_config *conf,
+      const char *drv, const char *resampler)
+{
+   FILE *log_file  = g_extern.log_file;
+   bool  verbosity = g_extern.verbosity;
+
+   memset(&g_extern, 0, sizeof(g_extern));
+   memset(&driver, 0, sizeof(driver));
+
+   g_extern.log_file                 = log_file;
+   g_extern.verbosity                = verbosity;
+   g_extern.audio_data.in_rate       = conf->in_rate;
+   g_extern.audio_data.volume_gain   = 1.0f;
+   driver.audio_active               = true;
+
+   g_settings.slowmotion_ratio       = 3.0f;
+   g_settings.audio.enable           = true;
+   g_settings.audio.sync             = true;
+   g_settings.audio.out_rate         = conf->out_rate;
+   g_settings.audio.latency          = conf->latency;
+   g_settings.audio.rate_control     = conf->rate_control;
+   g_settings.audio.rate_control_delta  = 0.005f;
+   g_settings.audio.rate_control_target = 0;
+   g_settings.audio.max_timing_skew  = 0.05f;
+   *g_settings.audio.device          = '\0';
+   strlcpy(g_settings.audio.driver, drv, sizeof(g_settings.audio.driver));
+   strlcpy(g_settings.audio.resampler, resampler,
+         sizeof(g_settings.audio.resampler));
+}
+
+/**
+ * bench_run:
+ * @conf                  : benchmark parameters.
+ * @drv                   : audio driver ident.
+ * @resampler             : resampler ident.
+ * @res                   : result of the run.
+ *
+ * Opens @drv with @resampler and pushes one video frame worth of
+ * a sine wave per frame. Frame deadlines run at conf->fps,
+ * sped up by conf->skew and moved by up to conf->jitter_ms.
+ * A frame which blocks in the driver past its deadline is
+ * counted as late and pushes the next deadlines back, like a
+ * frontend synchronized to audio.
+ *
+ * Returns: true (1) if the driver could be opened, otherwise false (0).
+ **/
+static bool bench_run(const struct bench_config *conf,
+      const char *drv, const char *resampler, struct bench_result *res)
+{
+   unsigned i;
+   FILE *csv = NULL;
+   int16_t *samples;
+   size_t buffer_size = 0;
+   double phase = 0.0, frame_acc = 0.0, fill_sum = 0.0;
+   double bytes_per_ms, wall_start, wall, cpu_start, pipeline_cpu = 0.0;
+   double period   = 1.0 / (conf->fps * (1.0 + conf->skew));
+   double deadline;
+   unsigned max_frames = (unsigned)(conf->in_rate / conf->fps) + 2;
+
+   memset(res, 0, sizeof(*res));
+   res->fill_min_ms = HUGE_VAL;
+
+   bench_init_settings(conf, drv, resampler);
+
+   /* rarch_fail() lands here if the driver can't be found. */
+   g_extern.error_in_init = true;
+   if (setjmp(g_extern.error_sjlj_context) > 0)
+      return false;
+
+   init_audio();
+   g_extern.error_in_init = false;
+
+   if (!driver.audio_active || !driver.audio_data)
+   {
+      uninit_audio();
+      return false;
+   }
+
+   samples = (int16_t*)malloc(max_frames * 2 * sizeof(int16_t));
+   if (!samples)
+   {
+      uninit_audio();
+      return false;
+   }
+
+   if (conf->csv_prefix)
+   {
+      char path[PATH_MAX_LENGTH];
+      snprintf(path, sizeof(path), "%s-%s-%s.csv",
+            conf->csv_prefix, drv, resampler);
+      csv = fopen(path, "w");
+      if (csv)
+         fprintf(csv, "time,fill_ms,ratio\n");
+   }
+
+   /* Occupancy is read even if rate control is off. */
+   res->has_stats = driver.audio->write_avail && driver.audio->buffer_size;
+   if (res->has_stats)
+      buffer_size = driver.audio->buffer_size(driver.audio_data);
+   bytes_per_ms   = g_settings.audio.out_rate * 2 *
+      (g_extern.audio_data.use_float ? sizeof(float) : sizeof(int16_t)) / 1000.0;
+
+   wall_start = bench_time(CLOCK_MONOTONIC);
+   cpu_start  = bench_time(CLOCK_PROCESS_CPUTIME_ID);
+   deadline   = wall_start;
+
+   while (bench_time(CLOCK_MONOTONIC) - wall_start < conf->seconds)
+   {
+      double cpu, now, target;
+      unsigned frames;
+
+      frame_acc += conf->in_rate / conf->fps;
+      frames     = (unsigned)frame_acc;
+      frame_acc -= frames;
+
+      for (i = 0; i < frames; i++)
+      {
+         int16_t s = (int16_t)(8000.0 * sin(phase));
+         samples[2 * i + 0] = s;
+         samples[2 * i + 1] = s;
+         phase += 2.0 * M_PI * 440.0 / conf->in_rate;
+      }
+      phase = fmod(phase, 2.0 * M_PI);
+
+      if (res->has_stats)
+      {
+         size_t avail = driver.audio->write_avail(driver.audio_data);
+         double fill  = (avail < buffer_size ? buffer_size - avail : 0) /
+            bytes_per_ms;
+
+         /* Skip the first frames, the buffer starts out empty. */
+         if (res->frames >= 8 && avail >= buffer_size)
+            res->underruns++;
+
+         fill_sum += fill;
+         res->fill_min_ms = min(res->fill_min_ms, fill);
+         res->fill_max_ms = max(res->fill_max_ms, fill);
+
+         if (csv)
+            fprintf(csv, "%.4f,%.3f,%.6f\n",
+                  bench_time(CLOCK_MONOTONIC) - wall_start, fill,
+                  g_extern.audio_data.src_ratio);
+      }
+
+      cpu = bench_time(CLOCK_THREAD_CPUTIME_ID);
+      if (!audio_driver_flush(samples, frames * 2))
+         break;
+      pipeline_cpu += bench_time(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+      res->frames++;
+
+      deadline += period;
+      target    = deadline + conf->jitter_ms / 1000.0 *
+         (2.0 * rand() / RAND_MAX - 1.0);
+      now       = bench_time(CLOCK_MONOTONIC);
+
+      if (now > deadline + period / 2)
+      {
+         res->late_frames++;
+         deadline = now;
+      }
+      else if (target > now)
+         bench_sleep_until(target);
+   }
+
+   wall = bench_time(CLOCK_MONOTONIC) - wall_start;
+   res->pipeline_ms_per_sec = 1000.0 * pipeline_cpu / wall;
+   res->cpu_percent = 100.0 *
+      (bench_time(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) / wall;
+   if (res->frames)
+      res->fill_avg_ms = fill_sum / res->frames;
+   if (!res->has_stats)
+      res->fill_min_ms = 0.0;
+
+   if (csv)
+      fclose(csv);
+   free(samples);
+   uninit_audio();
+   return true;
+}
+
+static void bench_print_result(const char *drv, const char *resampler,
+      const struct bench_result *res)
+{
+   if (!res->has_stats)
+   {
+      printf("%-12s %-8s %8s %8s %8s %9s %6u %10.3f %6.1f\n",
+            drv, resampler, "n/a", "n/a", "n/a", "n/a",
+            res->late_frames, res->pipeline_ms_per_sec, res->cpu_percent);
+      return;
+   }
+
+   printf("%-12s %-8s %8.1f %8.1f %8.1f %9u %6u %10.3f %6.1f\n",
+         drv, resampler, res->fill_avg_ms, res->fill_min_ms,
+         res->fill_max_ms, res->underruns, res->late_frames,
+         res->pipeline_ms_per_sec, res->cpu_percent);
+}
+
+static void print_help(const char *argv0)
+{
+   unsigned i;
+
+   printf("Usage: %s [options]\n", argv0);
+   printf("\t-d/--driver: Comma separated audio drivers. Default is all but null.\n");
+   printf("\t-r/--resampler: Comma separated resamplers. Default is \"sinc,CC,nearest\".\n");
+   printf("\t-t/--time: Seconds per driver and resampler. Default is 10.\n");
+   printf("\t-i/--in-rate: Core sample rate. Default is 32040.5.\n");
+   printf("\t-o/--out-rate: Driver sample rate. Default is 48000.\n");
+   printf("\t-f/--fps: Core frame rate. Default is 60.0988.\n");
+   printf("\t-j/--jitter: Frame pacing jitter in ms. Default is 2.\n");
+   printf("\t-s/--skew: Core clock error, relative. Default is 0.001.\n");
+   printf("\t-l/--latency: Audio latency in ms. Default is 64.\n");
+   printf("\t-n/--no-rate-control: Disable dynamic rate control.\n");
+   printf("\t-c/--csv: Write buffer occupancy over time to <prefix>-<driver>-<resampler>.csv.\n");
+   printf("\t-v/--verbose: Log from the audio drivers.\n");
+
+   printf("Available audio drivers:");
+   for (i = 0; audio_driver_find_handle(i); i++)
+      printf(" %s", audio_driver_find_ident(i));
+   printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   char drivers[1024] = {0};
+   char resamplers[256] = "sinc,CC,nearest";
+   struct string_list *drv_list = NULL, *resampler_list = NULL;
+   struct bench_config conf = {
+      32040.5, 48000, 60.0988, 2.0, 0.001, 10.0, 64, true, NULL,
+   };
+
+   const struct option opts[] = {
+      { "driver", 1, NULL, 'd' },
+      { "resampler", 1, NULL, 'r' },
+      { "time", 1, NULL, 't' },
+      { "in-rate", 1, NULL, 'i' },
+      { "out-rate", 1, NULL, 'o' },
+      { "fps", 1, NULL, 'f' },
+      { "jitter", 1, NULL, 'j' },
+      { "skew", 1, NULL, 's' },
+      { "latency", 1, NULL, 'l' },
+      { "no-rate-control", 0, NULL, 'n' },
+      { "csv", 1, NULL, 'c' },
+      { "verbose", 0, NULL, 'v' },
+      { "help", 0, NULL, 'h' },
+      { NULL, 0, NULL, 0 },
+   };
+
+   g_extern.log_file = stderr;
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "d:r:t:i:o:f:j:s:l:nc:vh", opts, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'd':
+            strlcpy(drivers, optarg, sizeof(drivers));
+            break;
+         case 'r':
+            strlcpy(resamplers, optarg, sizeof(resamplers));
+            break;
+         case 't':
+            conf.seconds = strtod(optarg, NULL);
+            break;
+         case 'i':
+            conf.in_rate = strtod(optarg, NULL);
+            break;
+         case 'o':
+            conf.out_rate = strtoul(optarg, NULL, 0);
+            break;
+         case 'f':
+            conf.fps = strtod(optarg, NULL);
+            break;
+         case 'j':
+            conf.jitter_ms = strtod(optarg, NULL);
+            break;
+         case 's':
+            conf.skew = strtod(optarg, NULL);
+            break;
+         case 'l':
+            conf.latency = strtoul(optarg, NULL, 0);
+            break;
+         case 'n':
+            conf.rate_control = false;
+            break;
+         case 'c':
+            conf.csv_prefix = optarg;
+            break;
+         case 'v':
+            g_extern.verbosity = true;
+            break;
+         case 'h':
+            print_help(argv[0]);
+            return 0;
+         default:
+            print_help(argv[0]);
+            return 1;
+      }
+   }
+
+   if (conf.in_rate <= 0.0 || conf.fps <= 0.0 || !conf.out_rate ||
+         conf.out_rate >= conf.in_rate * AUDIO_MAX_RATIO)
+   {
+      fprintf(stderr, "Invalid sample or frame rate.\n");
+      return 1;
+   }
+
+   if (!*drivers)
+   {
+      for (i = 0; audio_driver_find_handle(i); i++)
+      {
+         const char *ident = audio_driver_find_ident(i);
+         if (!strcmp(ident, "null"))
+            continue;
+         if (*drivers)
+            strlcat(drivers, ",", sizeof(drivers));
+         strlcat(drivers, ident, sizeof(drivers));
+      }
+   }
+
+   drv_list       = string_split(drivers, ",");
+   resampler_list = string_split(resamplers, ",");
+   if (!drv_list || !resampler_list)
+      return 1;
+
+   printf("Input %.2f Hz at %.4f fps, output %u Hz, %u ms latency, "
+         "%.1f ms jitter, %.3f %% clock skew, rate control %s.\n",
+         conf.in_rate, conf.fps, conf.out_rate, conf.latency,
+         conf.jitter_ms, conf.skew * 100.0, conf.rate_control ? "on" : "off");
+   printf("%-12s %-8s %8s %8s %8s %9s %6s %10s %6s\n",
+         "driver", "resamp", "fill ms", "min ms", "max ms",
+         "underrun", "late", "pipe ms/s", "cpu %");
+   fflush(stdout);
+
+   for (i = 0; i < drv_list->size; i++)
+   {
+      for (j = 0; j < resampler_list->size; j++)
+      {
+         struct bench_result res;
+         const char *drv = drv_list->elems[i].data;
+         const char *resampler = resampler_list->elems[j].data;
+
+         if (find_driver_index("audio_driver", drv) < 0)
+         {
+            printf("%-12s %-8s unknown driver.\n", drv, resampler);
+            fflush(stdout);
+            break;
+         }
+
+         if (!bench_run(&conf, drv, resampler, &res))
+         {
+            printf("%-12s %-8s failed to initialize.\n", drv, resampler);
+            fflush(stdout);
+            continue;
+         }
+
+         bench_print_result(drv, resampler, &res);
+         fflush(stdout);
+      }
+   }
+
+   string_list_free(drv_list);
+   string_list_free(resampler_list);
+   return 0;
+}
@@ -21,23 +21,61 @@
 #include <string.h>
 #include <stdio.h>
 #include "general.h"
+#include "file_ops.h"
+#include "hash.h"
+#include <file/file_path.h>
+
+#if !defined(_WIN32) && !defined(RARCH_CONSOLE)
+#define AUTOSAVE_PWRITE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* SRAM is compared and written back in blocks of this size. */
+#define AUTOSAVE_BLOCK_SIZE 4096
 
 struct autosave
 {
-   volatile bool quit;
+   /* Held by the main thread while the core runs. */
    slock_t *lock;
 
-   slock_t *cond_lock;
-   scond_t *cond;
-   sthread_t *thread;
-
+   /* SRAM as last seen by the scheduler, and the CRC of
+    * each block of it. Only the scheduler thread uses them. */
    void *buffer;
+   uint32_t *block_crc;
+   bool *dirty;
+   size_t num_blocks;
+
    const void *retro_buffer;
    const char *path;
    size_t bufsize;
    unsigned interval;
+
+#ifdef AUTOSAVE_PWRITE
+   /* Kept open in between saves. */
+   int fd;
+   char journal_path[PATH_MAX_LENGTH + 16];
+#endif
+   bool file_ready;
+   bool logged;
+
+   autosave_t *next;
 };
 
+/* One thread checks every autosave in turn. */
+static struct
+{
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *thread;
+   bool quit;
+
+   autosave_t *list;
+} autosave_scheduler;
+
 /**
  * autosave_lock:
  * @handle          : pointer to autosave object
@@ -60,64 +98,362 @@ static void autosave_unlock(autosave_t *handle)
    slock_unlock(handle->lock);
 }
 
+static size_t autosave_block_len(autosave_t *save, size_t block)
+{
+   size_t offset = block * AUTOSAVE_BLOCK_SIZE;
+
+   if (save->bufsize - offset < AUTOSAVE_BLOCK_SIZE)
+      return save->bufsize - offset;
+   return AUTOSAVE_BLOCK_SIZE;
+}
+
+#ifdef AUTOSAVE_PWRITE
+/* Dirty blocks go to a journal next to the save before they are
+ * written in place, so that a save cut short can be finished by
+ * autosave_recover(). The journal is the magic and the number of
+ * runs, then the offset, length and data of each run, then the
+ * CRC32 of all of it, all little endian. */
+#define AUTOSAVE_JOURNAL_MAGIC 0x4a534152 /* "RASJ" */
+
+static void autosave_put_le(uint8_t *out, uint64_t value, unsigned bytes)
+{
+   unsigned i;
+   for (i = 0; i < bytes; i++)
+      out[i] = (uint8_t)(value >> (i * 8));
+}
+
+static uint64_t autosave_get_le(const uint8_t *in, unsigned bytes)
+{
+   unsigned i;
+   uint64_t value = 0;
+   for (i = 0; i < bytes; i++)
+      value |= (uint64_t)in[i] << (i * 8);
+   return value;
+}
+
+static bool autosave_write_all(int fd, const void *data, size_t size,
+      uint32_t *crc)
+{
+   const uint8_t *ptr = (const uint8_t*)data;
+
+   *crc = crc32_update(*crc, ptr, size);
+
+   while (size)
+   {
+      ssize_t written = write(fd, ptr, size);
+
+      if (written < 0 && errno == EINTR)
+         continue;
+      if (written <= 0)
+         return false;
+
+      ptr  += written;
+      size -= written;
+   }
+
+   return true;
+}
+
+static bool autosave_sync(int fd)
+{
+#if defined(__linux__)
+   return fdatasync(fd) == 0;
+#else
+   return fsync(fd) == 0;
+#endif
+}
+
 /**
- * autosave_thread:
- * @data            : pointer to autosave object
+ * autosave_next_run:
+ * @save            : pointer to autosave object
+ * @block           : block to start looking from, moved past the run
+ * @offset          : byte offset of the run
+ * @len             : byte length of the run
+ *
+ * Finds the next run of dirty blocks.
  *
- * Callback function for (threaded) autosave.
+ * Returns: true (1) if there is one, otherwise false (0).
  **/
-static void autosave_thread(void *data)
+static bool autosave_next_run(autosave_t *save, size_t *block,
+      size_t *offset, size_t *len)
+{
+   while (*block < save->num_blocks && !save->dirty[*block])
+      (*block)++;
+
+   if (*block >= save->num_blocks)
+      return false;
+
+   *offset = *block * AUTOSAVE_BLOCK_SIZE;
+   *len    = 0;
+
+   while (*block < save->num_blocks && save->dirty[*block])
+      *len += autosave_block_len(save, (*block)++);
+
+   return true;
+}
+
+/**
+ * autosave_open:
+ * @save            : pointer to autosave object
+ *
+ * Opens the save file, sized to the SRAM. If the file did not
+ * have that size yet, everything is written on the first save.
+ *
+ * Returns: true (1) if the file is open, otherwise false (0).
+ **/
+static bool autosave_open(autosave_t *save)
+{
+   size_t i;
+   struct stat st;
+
+   if (save->file_ready)
+      return true;
+
+   save->fd = open(save->path, O_RDWR | O_CREAT, 0644);
+   if (save->fd < 0)
+      return false;
+
+   if (fstat(save->fd, &st) < 0 || (size_t)st.st_size != save->bufsize)
+   {
+      if (ftruncate(save->fd, save->bufsize) < 0)
+      {
+         close(save->fd);
+         save->fd = -1;
+         return false;
+      }
+#if defined(__linux__)
+      /* Reserve the blocks now, so a later save cannot
+       * fail halfway through for lack of space. */
+      posix_fallocate(save->fd, 0, save->bufsize);
+#endif
+
+      for (i = 0; i < save->num_blocks; i++)
+         save->dirty[i] = true;
+   }
+
+   save->file_ready = true;
+   return true;
+}
+
+static void autosave_close(autosave_t *save)
+{
+   if (save->fd >= 0)
+      close(save->fd);
+   save->fd         = -1;
+   save->file_ready = false;
+}
+
+/**
+ * autosave_journal_write:
+ * @save            : pointer to autosave object
+ *
+ * Writes the dirty blocks to the journal and syncs it.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool autosave_journal_write(autosave_t *save)
 {
-   bool first_log = true;
-   autosave_t *save = (autosave_t*)data;
+   uint8_t head[16];
+   size_t block = 0, offset, len;
+   uint32_t crc = 0, runs = 0;
+   bool ret = true;
+   int fd = open(save->journal_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+   if (fd < 0)
+      return false;
+
+   while (autosave_next_run(save, &block, &offset, &len))
+      runs++;
+
+   autosave_put_le(head, AUTOSAVE_JOURNAL_MAGIC, 4);
+   autosave_put_le(head + 4, runs, 4);
+   ret = autosave_write_all(fd, head, 8, &crc);
+
+   block = 0;
+   while (ret && autosave_next_run(save, &block, &offset, &len))
+   {
+      autosave_put_le(head, offset, 8);
+      autosave_put_le(head + 8, len, 8);
+      ret = autosave_write_all(fd, head, 16, &crc) &&
+         autosave_write_all(fd,
+               (const uint8_t*)save->buffer + offset, len, &crc);
+   }
 
-   while (!save->quit)
+   if (ret)
    {
-      bool differ = false;
+      uint32_t unused = 0;
+      autosave_put_le(head, crc, 4);
+      ret = autosave_write_all(fd, head, 4, &unused);
+   }
+
+   ret = ret && autosave_sync(fd);
+   close(fd);
+   return ret;
+}
+
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Journals the dirty blocks, then writes them back in place
+ * and syncs the file. Blocks which failed to write stay dirty
+ * for the next try.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool autosave_write(autosave_t *save)
+{
+   size_t block = 0, offset, len;
+   bool failed = false;
+
+   if (!autosave_open(save))
+      return false;
 
-      autosave_lock(save);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      autosave_unlock(save);
+   if (!autosave_journal_write(save))
+   {
+      unlink(save->journal_path);
+      return false;
+   }
 
-      if (differ)
+   while (autosave_next_run(save, &block, &offset, &len))
+   {
+      if (pwrite(save->fd, (const uint8_t*)save->buffer + offset,
+               len, offset) != (ssize_t)len)
       {
-         /* Should probably deal with this more elegantly. */
-         FILE *file = fopen(save->path, "wb");
-
-         if (file)
-         {
-            bool failed = false;
-
-            /* Avoid spamming down stderr ... */
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
-                     save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            failed |= fwrite(save->buffer, 1, save->bufsize, file)
-               != save->bufsize;
-            failed |= fflush(file) != 0;
-            failed |= fclose(file) != 0;
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
-         }
+         failed = true;
+         continue;
       }
 
-      slock_lock(save->cond_lock);
+      memset(save->dirty + offset / AUTOSAVE_BLOCK_SIZE, 0,
+            (block - offset / AUTOSAVE_BLOCK_SIZE) * sizeof(bool));
+   }
+
+   failed |= !autosave_sync(save->fd);
 
-      if (!save->quit)
-         scond_wait_timeout(save->cond, save->cond_lock,
-               save->interval * 1000000LL);
+   /* A failed save keeps its journal for autosave_recover(). */
+   if (failed)
+      autosave_close(save);
+   else
+      unlink(save->journal_path);
 
-      slock_unlock(save->cond_lock);
+   return !failed;
+}
+#else
+static void autosave_close(autosave_t *save)
+{
+   save->file_ready = false;
+}
+
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Without pwrite(), the whole SRAM is written through
+ * write_file_safe() whenever a block changed.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool autosave_write(autosave_t *save)
+{
+   save->file_ready = write_file_safe(save->path,
+         save->buffer, save->bufsize);
+
+   if (save->file_ready)
+      memset(save->dirty, 0, save->num_blocks * sizeof(bool));
+
+   return save->file_ready;
+}
+#endif
+
+/**
+ * autosave_check:
+ * @save            : pointer to autosave object
+ *
+ * Finds the blocks which changed since the last check by their
+ * CRC, copies them while the core is not running, and writes
+ * them back. CRC32 catches every change of up to 32 bits in a
+ * block, which covers the few bytes games usually change.
+ **/
+static void autosave_check(autosave_t *save)
+{
+   size_t i;
+   bool differ = false;
+   const uint8_t *retro_buffer = (const uint8_t*)save->retro_buffer;
+
+   autosave_lock(save);
+   for (i = 0; i < save->num_blocks; i++)
+   {
+      size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+      size_t len    = autosave_block_len(save, i);
+      uint32_t crc  = crc32_calculate(retro_buffer + offset, len);
+
+      if (crc == save->block_crc[i])
+         continue;
+
+      memcpy((uint8_t*)save->buffer + offset, retro_buffer + offset, len);
+      save->block_crc[i] = crc;
+      save->dirty[i]     = true;
+      differ             = true;
+   }
+   autosave_unlock(save);
+
+   /* Retries blocks a failed save left dirty. */
+   if (!differ && save->file_ready)
+      return;
+
+   for (i = 0; i < save->num_blocks && !differ; i++)
+      differ = save->dirty[i];
+
+   if (!differ)
+      return;
+
+   /* Avoid spamming down stderr ... */
+   if (!save->logged)
+   {
+      RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
+            save->path, save->interval);
+      save->logged = true;
+   }
+   else
+      RARCH_LOG("SRAM changed ... autosaving ...\n");
+
+   if (!autosave_write(save))
+      RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+}
+
+/**
+ * autosave_thread:
+ * @data            : unused
+ *
+ * Scheduler thread, checks every autosave each interval.
+ **/
+static void autosave_thread(void *data)
+{
+   (void)data;
+
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_AUTOSAVE);
+
+   slock_lock(autosave_scheduler.lock);
+
+   while (!autosave_scheduler.quit)
+   {
+      autosave_t *save;
+      unsigned interval = 0;
+
+      for (save = autosave_scheduler.list; save; save = save->next)
+      {
+         autosave_check(save);
+
+         if (!interval || save->interval < interval)
+            interval = save->interval;
+      }
+
+      if (!autosave_scheduler.quit)
+         scond_wait_timeout(autosave_scheduler.cond,
+               autosave_scheduler.lock, interval * 1000000LL);
    }
+
+   slock_unlock(autosave_scheduler.lock);
 }
 
 /**
@@ -135,30 +471,77 @@ static void autosave_thread(void *data)
 autosave_t *autosave_new(const char *path, const void *data, size_t size,
       unsigned interval)
 {
+   size_t i;
    autosave_t *handle = (autosave_t*)calloc(1, sizeof(*handle));
    if (!handle)
       return NULL;
 
-   handle->bufsize = size;
-   handle->interval = interval;
-   handle->path = path;
-   handle->buffer = malloc(size);
+   handle->bufsize      = size;
+   handle->interval     = interval;
+   handle->path         = path;
    handle->retro_buffer = data;
+   handle->num_blocks   = (size + AUTOSAVE_BLOCK_SIZE - 1) /
+      AUTOSAVE_BLOCK_SIZE;
+   handle->buffer       = malloc(size);
+   handle->block_crc    = (uint32_t*)malloc(
+         handle->num_blocks * sizeof(uint32_t));
+   handle->dirty        = (bool*)calloc(handle->num_blocks, sizeof(bool));
+   handle->lock         = slock_new();
+#ifdef AUTOSAVE_PWRITE
+   handle->fd           = -1;
+   snprintf(handle->journal_path, sizeof(handle->journal_path),
+         "%s.journal", path);
+#endif
+
+   if (!handle->buffer || !handle->block_crc || !handle->dirty
+         || !handle->lock)
+      goto error;
 
-   if (!handle->buffer)
-   {
-      free(handle);
-      return NULL;
-   }
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
+   for (i = 0; i < handle->num_blocks; i++)
+      handle->block_crc[i] = crc32_calculate(
+            (const uint8_t*)handle->buffer + i * AUTOSAVE_BLOCK_SIZE,
+            autosave_block_len(handle, i));
 
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
+   if (!autosave_scheduler.thread)
+   {
+      autosave_scheduler.quit = false;
+      autosave_scheduler.lock = slock_new();
+      autosave_scheduler.cond = scond_new();
+      if (!autosave_scheduler.lock || !autosave_scheduler.cond)
+         goto error;
+
+      autosave_scheduler.thread = sthread_create(autosave_thread, NULL);
+      if (!autosave_scheduler.thread)
+         goto error;
+   }
 
-   handle->thread = sthread_create(autosave_thread, handle);
+   slock_lock(autosave_scheduler.lock);
+   handle->next             = autosave_scheduler.list;
+   autosave_scheduler.list  = handle;
+   scond_signal(autosave_scheduler.cond);
+   slock_unlock(autosave_scheduler.lock);
 
    return handle;
+
+error:
+   if (!autosave_scheduler.thread)
+   {
+      if (autosave_scheduler.lock)
+         slock_free(autosave_scheduler.lock);
+      if (autosave_scheduler.cond)
+         scond_free(autosave_scheduler.cond);
+      autosave_scheduler.lock = NULL;
+      autosave_scheduler.cond = NULL;
+   }
+
+   if (handle->lock)
+      slock_free(handle->lock);
+   free(handle->buffer);
+   free(handle->block_crc);
+   free(handle->dirty);
+   free(handle);
+   return NULL;
 }
 
 /**
@@ -169,20 +552,45 @@ autosave_t *autosave_new(const char *path, const void *data, size_t size,
  **/
 void autosave_free(autosave_t *handle)
 {
+   autosave_t **link;
+   bool last = false;
+
    if (!handle)
       return;
 
-   slock_lock(handle->cond_lock);
-   handle->quit = true;
-   slock_unlock(handle->cond_lock);
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
+   /* Waits for a check which might be using it. */
+   slock_lock(autosave_scheduler.lock);
+   for (link = &autosave_scheduler.list; *link; link = &(*link)->next)
+   {
+      if (*link == handle)
+      {
+         *link = handle->next;
+         break;
+      }
+   }
+
+   last = !autosave_scheduler.list;
+   if (last)
+   {
+      autosave_scheduler.quit = true;
+      scond_signal(autosave_scheduler.cond);
+   }
+   slock_unlock(autosave_scheduler.lock);
+
+   if (last)
+   {
+      sthread_join(autosave_scheduler.thread);
+      slock_free(autosave_scheduler.lock);
+      scond_free(autosave_scheduler.cond);
+      memset(&autosave_scheduler, 0, sizeof(autosave_scheduler));
+   }
 
+   autosave_close(handle);
    slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
 
    free(handle->buffer);
+   free(handle->block_crc);
+   free(handle->dirty);
    free(handle);
 }
 
@@ -216,4 +624,83 @@ void unlock_autosave(void)
    }
 }
 
+/**
+ * autosave_recover:
+ * @path            : path to save file
+ *
+ * Finishes an autosave to @path which was cut short, from its
+ * journal. A journal which was not written in full is dropped,
+ * as the save itself was not touched yet then. Call before the
+ * save is loaded.
+ **/
+void autosave_recover(const char *path)
+{
+#ifdef AUTOSAVE_PWRITE
+   char journal_path[PATH_MAX_LENGTH + 16];
+   const uint8_t *journal;
+   uint64_t runs, i;
+   size_t pos = 8;
+   void *buf = NULL;
+   long size;
+   bool ret = false;
+   int fd = -1;
+
+   snprintf(journal_path, sizeof(journal_path), "%s.journal", path);
+   if (!path_file_exists(journal_path))
+      return;
+
+   size    = read_file(journal_path, &buf);
+   journal = (const uint8_t*)buf;
 
+   if (size < 12
+         || autosave_get_le(journal, 4) != AUTOSAVE_JOURNAL_MAGIC
+         || autosave_get_le(journal + size - 4, 4)
+         != crc32_calculate(journal, size - 4))
+   {
+      RARCH_WARN("Dropping incomplete autosave journal \"%s\".\n",
+            journal_path);
+      unlink(journal_path);
+      free(buf);
+      return;
+   }
+
+   runs = autosave_get_le(journal + 4, 4);
+   fd   = open(path, O_WRONLY | O_CREAT, 0644);
+   ret  = fd >= 0;
+
+   for (i = 0; ret && i < runs; i++)
+   {
+      uint64_t offset, len;
+
+      if (pos + 16 > (size_t)size - 4)
+         break;
+
+      offset = autosave_get_le(journal + pos, 8);
+      len    = autosave_get_le(journal + pos + 8, 8);
+      pos   += 16;
+
+      if (len > (size_t)size - 4 - pos)
+         break;
+
+      ret  = pwrite(fd, journal + pos, len, offset) == (ssize_t)len;
+      pos += len;
+   }
+
+   ret = ret && i == runs && autosave_sync(fd);
+   if (fd >= 0)
+      close(fd);
+
+   if (ret)
+   {
+      RARCH_LOG("Finished interrupted autosave to \"%s\".\n", path);
+      unlink(journal_path);
+   }
+   else
+      RARCH_ERR("Could not finish interrupted autosave to \"%s\".\n",
+            path);
+
+   free(buf);
+#else
+   (void)path;
+#endif
+}
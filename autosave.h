@@ -62,6 +62,15 @@ void lock_autosave(void);
  **/
 void unlock_autosave(void);
 
+/**
+ * autosave_recover:
+ * @path            : path to save file
+ *
+ * Finishes an autosave to @path which was cut short, from its
+ * journal. Call before the save is loaded.
+ **/
+void autosave_recover(const char *path);
+
 #ifdef __cplusplus
 }
 #endif
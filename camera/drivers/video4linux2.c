@@ -52,6 +52,9 @@ typedef struct video4linux
    unsigned height;
    size_t pitch;
 
+   /* The device gives XRGB8888 as is, so the core reads
+    * the mapped buffers rather than a converted copy. */
+   bool direct;
    struct scaler_ctx scaler;
    uint32_t *buffer_output;
    bool ready;
@@ -80,6 +83,34 @@ static int xioctl(int fd, int request, void *args)
    return r;
 }
 
+static bool has_format(video4linux_t *v4l, uint32_t pixelformat)
+{
+   struct v4l2_fmtdesc desc;
+
+   memset(&desc, 0, sizeof(desc));
+   desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+   for (; xioctl(v4l->fd, VIDIOC_ENUM_FMT, &desc) == 0; desc.index++)
+      if (desc.pixelformat == pixelformat)
+         return true;
+
+   return false;
+}
+
+/* Formats laid out in memory as XRGB8888 is, B, G, R, X. */
+static uint32_t direct_format(video4linux_t *v4l)
+{
+#ifdef V4L2_PIX_FMT_XBGR32
+   if (has_format(v4l, V4L2_PIX_FMT_XBGR32))
+      return V4L2_PIX_FMT_XBGR32;
+   if (has_format(v4l, V4L2_PIX_FMT_ABGR32))
+      return V4L2_PIX_FMT_ABGR32;
+#endif
+   if (has_format(v4l, V4L2_PIX_FMT_BGR32))
+      return V4L2_PIX_FMT_BGR32;
+   return 0;
+}
+
 static bool init_mmap(void *data)
 {
    struct v4l2_requestbuffers req;
@@ -152,6 +183,7 @@ static bool init_device(void *data)
    struct v4l2_cropcap cropcap;
    struct v4l2_crop crop;
    struct v4l2_format fmt;
+   uint32_t pixelformat;
    video4linux_t *v4l = (video4linux_t*)data;
 
    if (xioctl(v4l->fd, VIDIOC_QUERYCAP, &cap) < 0)
@@ -187,12 +219,17 @@ static bool init_device(void *data)
       xioctl(v4l->fd, VIDIOC_S_CROP, &crop);
    }
 
+   pixelformat = direct_format(v4l);
+   v4l->direct = pixelformat != 0;
+   if (!v4l->direct)
+      pixelformat = V4L2_PIX_FMT_YUYV;
+
    memset(&fmt, 0, sizeof(fmt));
 
    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
    fmt.fmt.pix.width  = v4l->width;
    fmt.fmt.pix.height = v4l->height;
-   fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+   fmt.fmt.pix.pixelformat = pixelformat;
    fmt.fmt.pix.field = V4L2_FIELD_NONE;
 
    if (xioctl(v4l->fd, VIDIOC_S_FMT, &fmt) < 0)
@@ -204,15 +241,17 @@ static bool init_device(void *data)
    /* VIDIOC_S_FMT may change width, height and pitch. */
    v4l->width = fmt.fmt.pix.width;
    v4l->height = fmt.fmt.pix.height;
-   v4l->pitch = max(fmt.fmt.pix.bytesperline, v4l->width * 2);
+   v4l->pitch = max(fmt.fmt.pix.bytesperline,
+         v4l->width * (v4l->direct ? 4 : 2));
 
    /* Sanity check to see if our assumptions are met.
     * It is possible to support whatever the device gives us,
     * but this dramatically increases complexity.
     */
-   if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV)
+   if (fmt.fmt.pix.pixelformat != pixelformat)
    {
-      RARCH_ERR("The V4L2 device doesn't support YUYV.\n");
+      RARCH_ERR("The V4L2 device doesn't support %s.\n",
+            v4l->direct ? "XRGB8888" : "YUYV");
       return false;
    }
 
@@ -223,7 +262,8 @@ static bool init_device(void *data)
       return false;
    }
 
-   RARCH_LOG("V4L2 device: %u x %u.\n", v4l->width, v4l->height);
+   RARCH_LOG("V4L2 device: %u x %u, %s.\n", v4l->width, v4l->height,
+         v4l->direct ? "XRGB8888" : "YUYV");
 
    return init_mmap(v4l);
 }
@@ -339,6 +379,9 @@ static void *v4l_init(const char *device, uint64_t caps,
    if (!init_device(v4l))
       goto error;
 
+   if (v4l->direct)
+      return v4l;
+
    v4l->buffer_output = (uint32_t*)
       malloc(v4l->width * v4l->height * sizeof(uint32_t));
 
@@ -369,36 +412,36 @@ error:
    return NULL;
 }
 
-static bool preprocess_image(void *data)
+/* Dequeues the newest frame the device has filled into @buf.
+ * Older ones are handed straight back, nobody would see them. */
+static bool dequeue_image(video4linux_t *v4l, struct v4l2_buffer *buf)
 {
-   video4linux_t *v4l = (video4linux_t*)data;
-   struct v4l2_buffer buf;
+   bool have_buf = false;
 
-   memset(&buf, 0, sizeof(buf));
+   for (;;)
+   {
+      struct v4l2_buffer next;
 
-   buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-   buf.memory = V4L2_MEMORY_MMAP;
+      memset(&next, 0, sizeof(next));
 
-   if (xioctl(v4l->fd, VIDIOC_DQBUF, &buf) == -1)
-   {
-      switch (errno)
+      next.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      next.memory = V4L2_MEMORY_MMAP;
+
+      if (xioctl(v4l->fd, VIDIOC_DQBUF, &next) == -1)
       {
-         case EAGAIN:
-            return false;
-         default:
+         if (errno != EAGAIN)
             RARCH_ERR("VIDIOC_DQBUF.\n");
-            return false;
+         return have_buf;
       }
-   }
 
-   rarch_assert(buf.index < v4l->n_buffers);
+      rarch_assert(next.index < v4l->n_buffers);
 
-   process_image(v4l, (const uint8_t*)v4l->buffers[buf.index].start);
+      if (have_buf && xioctl(v4l->fd, VIDIOC_QBUF, buf) == -1)
+         RARCH_ERR("VIDIOC_QBUF\n");
 
-   if (xioctl(v4l->fd, VIDIOC_QBUF, &buf) == -1)
-      RARCH_ERR("VIDIOC_QBUF\n");
-
-   return true;
+      *buf     = next;
+      have_buf = true;
+   }
 }
 
 static bool v4l_poll(void *data,
@@ -406,20 +449,37 @@ static bool v4l_poll(void *data,
       retro_camera_frame_opengl_texture_t frame_gl_cb)
 {
    video4linux_t *v4l = (video4linux_t*)data;
+   struct v4l2_buffer buf;
+   const uint8_t *image;
+
    if (!v4l->ready)
       return false;
 
    (void)frame_gl_cb;
 
-   if (preprocess_image(data))
+   if (!dequeue_image(v4l, &buf))
+      return false;
+
+   image = (const uint8_t*)v4l->buffers[buf.index].start;
+
+   /* The buffer stays ours until queued again. */
+   if (frame_raw_cb != NULL)
    {
-      if (frame_raw_cb != NULL)
+      if (v4l->direct)
+         frame_raw_cb((const uint32_t*)image, v4l->width,
+               v4l->height, v4l->pitch);
+      else
+      {
+         process_image(v4l, image);
          frame_raw_cb(v4l->buffer_output, v4l->width,
                v4l->height, v4l->width * 4);
-      return true;
+      }
    }
 
-   return false;
+   if (xioctl(v4l->fd, VIDIOC_QBUF, &buf) == -1)
+      RARCH_ERR("VIDIOC_QBUF\n");
+
+   return true;
 }
 
 camera_driver_t camera_v4l2 = {
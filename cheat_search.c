@@ -0,0 +1,447 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cheat_search.h"
+#include "general.h"
+#include "dynamic.h"
+#include "libretro.h"
+#include "performance.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Candidates are kept one bit per value, and filtered
+ * a 64-bit word of them at a time, so words without
+ * candidates left cost nothing. */
+#define CHEAT_SEARCH_WORD_BYTES(width) (64 * (width))
+
+typedef void (*cheat_search_func_t)(uint64_t *bits, size_t words,
+      const uint8_t *cur, const uint8_t *ref, size_t ref_step,
+      unsigned width, enum cheat_search_op op);
+
+struct cheat_search
+{
+   unsigned width;
+   size_t size;
+   size_t num;
+
+   uint64_t *bits;
+   size_t words;
+   size_t count;
+
+   /* RAM as of the last search, padded to whole words. */
+   uint8_t *prev;
+
+   cheat_search_func_t filter;
+};
+
+static inline uint32_t cheat_search_load(const uint8_t *data,
+      unsigned width)
+{
+   uint16_t v16;
+   uint32_t v32;
+
+   switch (width)
+   {
+      case 2:
+         memcpy(&v16, data, sizeof(v16));
+         return v16;
+      case 4:
+         memcpy(&v32, data, sizeof(v32));
+         return v32;
+   }
+
+   return *data;
+}
+
+static inline bool cheat_search_pass(uint32_t a, uint32_t b,
+      enum cheat_search_op op)
+{
+   switch (op)
+   {
+      case CHEAT_SEARCH_EQ:
+         return a == b;
+      case CHEAT_SEARCH_NE:
+         return a != b;
+      case CHEAT_SEARCH_GT:
+         return a > b;
+      case CHEAT_SEARCH_LT:
+         return a < b;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+static void cheat_search_filter_c(uint64_t *bits, size_t words,
+      const uint8_t *cur, const uint8_t *ref, size_t ref_step,
+      unsigned width, enum cheat_search_op op)
+{
+   size_t i;
+
+   for (i = 0; i < words; i++, cur += CHEAT_SEARCH_WORD_BYTES(width),
+         ref += ref_step)
+   {
+      unsigned j;
+      uint64_t mask = 0;
+
+      if (!bits[i])
+         continue;
+
+      for (j = 0; j < 64; j++)
+      {
+         if (!(bits[i] & ((uint64_t)1 << j)))
+            continue;
+
+         if (cheat_search_pass(cheat_search_load(cur + j * width, width),
+                  cheat_search_load(ref + j * width, width), op))
+            mask |= (uint64_t)1 << j;
+      }
+
+      bits[i] &= mask;
+   }
+}
+
+#if defined(__SSE2__)
+/* One bit per value in a and b, set if a == b or, for
+ * CHEAT_SEARCH_GT and CHEAT_SEARCH_LT, if a > b or a < b. */
+static inline unsigned cheat_search_cmp_sse2(__m128i a, __m128i b,
+      unsigned width, enum cheat_search_op op)
+{
+   __m128i m, bias;
+
+   switch (width)
+   {
+      case 1:
+         bias = _mm_set1_epi8((char)0x80);
+         break;
+      case 2:
+         bias = _mm_set1_epi16((short)0x8000);
+         break;
+      default:
+         bias = _mm_set1_epi32((int)0x80000000);
+         break;
+   }
+
+   /* SSE2 only compares signed, so flip the sign bits. */
+   if (op == CHEAT_SEARCH_LT)
+   {
+      __m128i tmp = a;
+      a  = b;
+      b  = tmp;
+      op = CHEAT_SEARCH_GT;
+   }
+
+   if (op == CHEAT_SEARCH_GT)
+   {
+      a = _mm_xor_si128(a, bias);
+      b = _mm_xor_si128(b, bias);
+   }
+
+   switch (width)
+   {
+      case 1:
+         m = op == CHEAT_SEARCH_GT ?
+            _mm_cmpgt_epi8(a, b) : _mm_cmpeq_epi8(a, b);
+         return _mm_movemask_epi8(m);
+      case 2:
+         m = op == CHEAT_SEARCH_GT ?
+            _mm_cmpgt_epi16(a, b) : _mm_cmpeq_epi16(a, b);
+         return _mm_movemask_epi8(
+               _mm_packs_epi16(m, _mm_setzero_si128())) & 0xff;
+      default:
+         m = op == CHEAT_SEARCH_GT ?
+            _mm_cmpgt_epi32(a, b) : _mm_cmpeq_epi32(a, b);
+         return _mm_movemask_ps(_mm_castsi128_ps(m));
+   }
+}
+
+static inline void cheat_search_filter_words_sse2(uint64_t *bits,
+      size_t words, const uint8_t *cur, const uint8_t *ref,
+      size_t ref_step, unsigned width, enum cheat_search_op op)
+{
+   size_t i;
+   unsigned per_vec = 16 / width;
+
+   for (i = 0; i < words; i++, cur += CHEAT_SEARCH_WORD_BYTES(width),
+         ref += ref_step)
+   {
+      unsigned j;
+      uint64_t mask = 0;
+
+      if (!bits[i])
+         continue;
+
+      for (j = 0; j < 4 * width; j++)
+      {
+         __m128i a = _mm_loadu_si128((const __m128i*)(cur + j * 16));
+         __m128i b = _mm_loadu_si128((const __m128i*)(ref +
+                  (ref_step ? j * 16 : 0)));
+
+         mask |= (uint64_t)cheat_search_cmp_sse2(a, b, width, op)
+            << (j * per_vec);
+      }
+
+      bits[i] &= op == CHEAT_SEARCH_NE ? ~mask : mask;
+   }
+}
+
+static void cheat_search_filter_sse2(uint64_t *bits, size_t words,
+      const uint8_t *cur, const uint8_t *ref, size_t ref_step,
+      unsigned width, enum cheat_search_op op)
+{
+   /* Constant widths, so the compares are picked at compile time. */
+   switch (width)
+   {
+      case 1:
+         cheat_search_filter_words_sse2(bits, words,
+               cur, ref, ref_step, 1, op);
+         break;
+      case 2:
+         cheat_search_filter_words_sse2(bits, words,
+               cur, ref, ref_step, 2, op);
+         break;
+      case 4:
+         cheat_search_filter_words_sse2(bits, words,
+               cur, ref, ref_step, 4, op);
+         break;
+   }
+}
+#endif
+
+struct cheat_search_scanner
+{
+   const char *ident;
+   uint64_t simd_mask;
+   cheat_search_func_t filter;
+};
+
+/* Ordered by preference, last match wins. */
+static const struct cheat_search_scanner cheat_search_scanners[] = {
+   { "c",    0,               cheat_search_filter_c    },
+#if defined(__SSE2__)
+   { "sse2", RETRO_SIMD_SSE2, cheat_search_filter_sse2 },
+#endif
+};
+
+static size_t cheat_search_popcount(const uint64_t *bits, size_t words)
+{
+   size_t i, count = 0;
+
+   for (i = 0; i < words; i++)
+   {
+#if defined(__GNUC__)
+      count += __builtin_popcountll(bits[i]);
+#else
+      uint64_t v = bits[i];
+      for (; v; count++)
+         v &= v - 1;
+#endif
+   }
+
+   return count;
+}
+
+cheat_search_t *cheat_search_new(unsigned bits)
+{
+   unsigned i;
+   uint64_t cpu;
+   const struct cheat_search_scanner *scanner = NULL;
+   cheat_search_t *handle = NULL;
+   const void *data = pretro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+   size_t size      = pretro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+
+   if (bits != 8 && bits != 16 && bits != 32)
+      return NULL;
+
+   if (!data || size < bits / 8)
+   {
+      RARCH_ERR("Cheat search: Core has no system RAM.\n");
+      return NULL;
+   }
+
+   handle = (cheat_search_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      return NULL;
+
+   handle->width = bits / 8;
+   handle->size  = size;
+   handle->num   = size / handle->width;
+   handle->words = (handle->num + 63) / 64;
+   handle->count = handle->num;
+   handle->bits  = (uint64_t*)malloc(handle->words * sizeof(uint64_t));
+   handle->prev  = (uint8_t*)calloc(handle->words,
+         CHEAT_SEARCH_WORD_BYTES(handle->width));
+
+   if (!handle->bits || !handle->prev)
+   {
+      cheat_search_free(handle);
+      return NULL;
+   }
+
+   memset(handle->bits, 0xff, handle->words * sizeof(uint64_t));
+   if (handle->num % 64)
+      handle->bits[handle->words - 1] =
+         ((uint64_t)1 << (handle->num % 64)) - 1;
+
+   memcpy(handle->prev, data, size);
+
+   cpu     = rarch_get_cpu_features();
+   scanner = &cheat_search_scanners[0];
+   for (i = 1; i < ARRAY_SIZE(cheat_search_scanners); i++)
+   {
+      if ((cpu & cheat_search_scanners[i].simd_mask) ==
+            cheat_search_scanners[i].simd_mask)
+         scanner = &cheat_search_scanners[i];
+   }
+
+   handle->filter = scanner->filter;
+   RARCH_LOG("Cheat search: %u KB of RAM, %u-bit values, "
+         "using \"%s\" scanner.\n", (unsigned)(size / 1024),
+         bits, scanner->ident);
+
+   return handle;
+}
+
+void cheat_search_free(cheat_search_t *handle)
+{
+   if (!handle)
+      return;
+
+   free(handle->bits);
+   free(handle->prev);
+   free(handle);
+}
+
+size_t cheat_search_filter(cheat_search_t *handle,
+      enum cheat_search_op op, uint32_t value)
+{
+   unsigned i;
+   uint8_t splat[CHEAT_SEARCH_WORD_BYTES(4)];
+   const uint8_t *ref = handle->prev;
+   size_t ref_step    = CHEAT_SEARCH_WORD_BYTES(handle->width);
+   size_t full        = handle->num / 64;
+   const uint8_t *cur = (const uint8_t*)
+      pretro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+
+   if (!cur || pretro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM)
+         != handle->size)
+      return handle->count;
+
+   if (op < CHEAT_SEARCH_UNCHANGED)
+   {
+      /* Compared against a word's worth of the value. */
+      for (i = 0; i < 64; i++)
+      {
+         uint16_t v16 = value;
+
+         switch (handle->width)
+         {
+            case 1:
+               splat[i] = (uint8_t)value;
+               break;
+            case 2:
+               memcpy(splat + i * 2, &v16, sizeof(v16));
+               break;
+            default:
+               memcpy(splat + i * 4, &value, sizeof(value));
+               break;
+         }
+      }
+
+      ref      = splat;
+      ref_step = 0;
+   }
+   else
+      op = (enum cheat_search_op)(op - CHEAT_SEARCH_UNCHANGED);
+
+   handle->filter(handle->bits, full, cur, ref, ref_step,
+         handle->width, op);
+
+   /* The last word may run past the end of RAM. */
+   if (full < handle->words)
+   {
+      uint8_t tail[CHEAT_SEARCH_WORD_BYTES(4)] = {0};
+      size_t offset = full * CHEAT_SEARCH_WORD_BYTES(handle->width);
+
+      memcpy(tail, cur + offset,
+            (handle->num - full * 64) * handle->width);
+      cheat_search_filter_c(handle->bits + full, 1, tail,
+            ref_step ? ref + offset : ref, ref_step, handle->width, op);
+   }
+
+   memcpy(handle->prev, cur, handle->size);
+
+   handle->count = cheat_search_popcount(handle->bits, handle->words);
+   return handle->count;
+}
+
+size_t cheat_search_count(const cheat_search_t *handle)
+{
+   return handle->count;
+}
+
+size_t cheat_search_matches(const cheat_search_t *handle,
+      size_t *addresses, uint32_t *values, size_t max)
+{
+   size_t i, count = 0;
+
+   for (i = 0; i < handle->words && count < max; i++)
+   {
+      uint64_t word = handle->bits[i];
+
+      while (word && count < max)
+      {
+         unsigned j = 0;
+         size_t address;
+
+         while (!(word & ((uint64_t)1 << j)))
+            j++;
+         word &= word - 1;
+
+         address = (i * 64 + j) * handle->width;
+         addresses[count] = address;
+         if (values)
+            values[count] = cheat_search_load(handle->prev + address,
+                  handle->width);
+         count++;
+      }
+   }
+
+   return count;
+}
+
+uint32_t cheat_search_value(const cheat_search_t *handle, size_t address)
+{
+   if (address + handle->width > handle->size)
+      return 0;
+
+   return cheat_search_load(handle->prev + address, handle->width);
+}
+
+bool cheat_search_add_cheat(const cheat_search_t *handle,
+      cheat_manager_t *cheat, size_t address, uint32_t value)
+{
+   if (address + handle->width > handle->size)
+      return false;
+
+   return cheat_manager_add_ram_cheat(cheat, address,
+         value, handle->width);
+}
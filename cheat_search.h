@@ -0,0 +1,118 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_CHEAT_SEARCH_H
+#define __RARCH_CHEAT_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+#include "cheats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum cheat_search_op
+{
+   /* Against the value passed to cheat_search_filter(). */
+   CHEAT_SEARCH_EQ = 0,
+   CHEAT_SEARCH_NE,
+   CHEAT_SEARCH_GT,
+   CHEAT_SEARCH_LT,
+
+   /* Against the RAM as of the previous search. */
+   CHEAT_SEARCH_UNCHANGED,
+   CHEAT_SEARCH_CHANGED,
+   CHEAT_SEARCH_INCREASED,
+   CHEAT_SEARCH_DECREASED
+};
+
+typedef struct cheat_search cheat_search_t;
+
+/**
+ * cheat_search_new:
+ * @bits                 : width of the values, 8, 16 or 32.
+ *
+ * Starts a search of the system RAM of the core. Every aligned
+ * value is a candidate to begin with. Values are compared as
+ * unsigned, in native byte order.
+ *
+ * Returns: new search, or NULL if the core has no system RAM.
+ **/
+cheat_search_t *cheat_search_new(unsigned bits);
+
+void cheat_search_free(cheat_search_t *handle);
+
+/**
+ * cheat_search_filter:
+ * @handle               : search handle.
+ * @op                   : comparison the candidates have to pass.
+ * @value                : value to compare to, for CHEAT_SEARCH_EQ
+ *                         to CHEAT_SEARCH_LT.
+ *
+ * Drops the candidates whose value in RAM does not pass @op,
+ * then takes the RAM as the base for the next search.
+ *
+ * Returns: number of candidates left.
+ **/
+size_t cheat_search_filter(cheat_search_t *handle,
+      enum cheat_search_op op, uint32_t value);
+
+size_t cheat_search_count(const cheat_search_t *handle);
+
+/**
+ * cheat_search_matches:
+ * @handle               : search handle.
+ * @addresses            : receives the byte offsets of candidates.
+ * @values               : receives their value as of the last search.
+ *                         Can be NULL.
+ * @max                  : size of @addresses and @values.
+ *
+ * Returns: number of candidates written, at most @max.
+ **/
+size_t cheat_search_matches(const cheat_search_t *handle,
+      size_t *addresses, uint32_t *values, size_t max);
+
+/**
+ * cheat_search_value:
+ * @handle               : search handle.
+ * @address              : byte offset in system RAM.
+ *
+ * Returns: value at @address as of the last search.
+ **/
+uint32_t cheat_search_value(const cheat_search_t *handle, size_t address);
+
+/**
+ * cheat_search_add_cheat:
+ * @handle               : search handle.
+ * @cheat                : cheat manager to add to.
+ * @address              : byte offset in system RAM.
+ * @value                : value to keep the RAM at.
+ *
+ * Adds an enabled cheat keeping the value at @address, with the
+ * width of the search.
+ *
+ * Returns: true (1) if the cheat was added, otherwise false (0).
+ **/
+bool cheat_search_add_cheat(const cheat_search_t *handle,
+      cheat_manager_t *cheat, size_t address, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -38,11 +38,99 @@ void cheat_manager_apply_cheats(cheat_manager_t *handle)
 
    for (i = 0; i < handle->size; i++)
    {
-      if (handle->cheats[i].state)
+      if (handle->cheats[i].state && !handle->cheats[i].ram)
          pretro_cheat_set(idx++, true, handle->cheats[i].code);
    }
 }
 
+static void cheat_manager_set_ram(struct item_cheat *cheat,
+      unsigned address, unsigned value, unsigned size)
+{
+   char code[64];
+
+   if (size != 2 && size != 4)
+      size = 1;
+   if (size < 4)
+      value &= (1u << (size * 8)) - 1;
+
+   snprintf(code, sizeof(code), "RAM 0x%06X = 0x%0*X",
+         address, size * 2, value);
+
+   free(cheat->code);
+   cheat->code    = strdup(code);
+   cheat->ram     = true;
+   cheat->address = address;
+   cheat->value   = value;
+   cheat->size    = size;
+}
+
+bool cheat_manager_add_ram_cheat(cheat_manager_t *handle,
+      unsigned address, unsigned value, unsigned size)
+{
+   struct item_cheat *cheat = NULL;
+
+   if (!handle)
+      return false;
+
+   if (handle->size >= handle->buf_size)
+   {
+      unsigned buf_size = handle->buf_size ? handle->buf_size * 2 : 8;
+      struct item_cheat *cheats = (struct item_cheat*)
+         realloc(handle->cheats, buf_size * sizeof(struct item_cheat));
+
+      if (!cheats)
+         return false;
+
+      handle->cheats   = cheats;
+      handle->buf_size = buf_size;
+   }
+
+   cheat = &handle->cheats[handle->size];
+   memset(cheat, 0, sizeof(*cheat));
+   cheat_manager_set_ram(cheat, address, value, size);
+   cheat->state = true;
+
+   handle->ptr = handle->size++;
+   cheat_manager_update(handle, handle->ptr);
+   return true;
+}
+
+void cheat_manager_apply_ram_cheats(cheat_manager_t *handle)
+{
+   unsigned i;
+   uint8_t *data = (uint8_t*)
+      pretro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+   size_t size   = pretro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+
+   if (!data)
+      return;
+
+   for (i = 0; i < handle->size; i++)
+   {
+      const struct item_cheat *cheat = &handle->cheats[i];
+      uint16_t v16 = cheat->value;
+      uint32_t v32 = cheat->value;
+
+      if (!cheat->ram || !cheat->state ||
+            cheat->address + cheat->size > size)
+         continue;
+
+      /* Native byte order, as the search compares them. */
+      switch (cheat->size)
+      {
+         case 2:
+            memcpy(data + cheat->address, &v16, sizeof(v16));
+            break;
+         case 4:
+            memcpy(data + cheat->address, &v32, sizeof(v32));
+            break;
+         default:
+            data[cheat->address] = (uint8_t)cheat->value;
+            break;
+      }
+   }
+}
+
 cheat_manager_t *cheat_manager_load(const char *path)
 {
    unsigned cheats = 0, i;
@@ -65,13 +153,18 @@ cheat_manager_t *cheat_manager_load(const char *path)
    for (i = 0; i < cheats; i++)
    {
       char key[64], desc_key[256], code_key[256], enable_key[256];
+      char address_key[256], value_key[256], size_key[256];
       char *tmp = NULL;
       bool tmp_bool = false;
+      unsigned address = 0, value = 0, size = 1;
 
       snprintf(key, sizeof(key), "cheat%u", i);
       snprintf(desc_key, sizeof(desc_key), "cheat%u_desc", i);
       snprintf(code_key, sizeof(code_key), "cheat%u_code", i);
       snprintf(enable_key, sizeof(enable_key), "cheat%u_enable", i);
+      snprintf(address_key, sizeof(address_key), "cheat%u_address", i);
+      snprintf(value_key, sizeof(value_key), "cheat%u_value", i);
+      snprintf(size_key, sizeof(size_key), "cheat%u_size", i);
 
       if (config_get_string(conf, desc_key, &tmp))
          cheat->cheats[i].desc   = strdup(tmp);
@@ -81,6 +174,14 @@ cheat_manager_t *cheat_manager_load(const char *path)
 
       if (config_get_bool(conf, enable_key, &tmp_bool))
          cheat->cheats[i].state  = tmp_bool;
+
+      /* RAM cheats, as added from a cheat search. */
+      if (config_get_hex(conf, address_key, &address))
+      {
+         config_get_hex(conf, value_key, &value);
+         config_get_uint(conf, size_key, &size);
+         cheat_manager_set_ram(&cheat->cheats[i], address, value, size);
+      }
    }
 
    config_file_free(conf);
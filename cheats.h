@@ -28,6 +28,13 @@ struct item_cheat
    char *desc;
    bool state;
    char *code;
+
+   /* Applied by the frontend, by writing value to
+    * system RAM every frame, instead of passed to the core. */
+   bool ram;
+   unsigned address;
+   unsigned value;
+   unsigned size;
 };
 
 struct cheat_manager
@@ -56,6 +63,29 @@ void cheat_manager_toggle(cheat_manager_t *handle);
 
 void cheat_manager_apply_cheats(cheat_manager_t *handle);
 
+/**
+ * cheat_manager_add_ram_cheat:
+ * @handle               : cheat manager.
+ * @address              : byte offset in system RAM.
+ * @value                : value to keep the RAM at.
+ * @size                 : size of the value in bytes, 1, 2 or 4.
+ *
+ * Adds an enabled RAM cheat.
+ *
+ * Returns: true (1) if the cheat was added, otherwise false (0).
+ **/
+bool cheat_manager_add_ram_cheat(cheat_manager_t *handle,
+      unsigned address, unsigned value, unsigned size);
+
+/**
+ * cheat_manager_apply_ram_cheats:
+ * @handle               : cheat manager.
+ *
+ * Writes the enabled RAM cheats to system RAM. Called before
+ * every frame, so the core cannot change the values back.
+ **/
+void cheat_manager_apply_ram_cheats(cheat_manager_t *handle);
+
 void cheat_manager_update(cheat_manager_t *handle, unsigned handle_idx);
 
 #ifdef __cplusplus
@@ -18,14 +18,20 @@
 
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
 #include "netplay_compat.h"
+#endif
+
+#ifdef HAVE_NETPLAY
 #include "netplay.h"
 #endif
 
 #include "general.h"
+#include "dynamic.h"
+#include "performance.h"
 #include "compat/strl.h"
 #include "compat/posix_string.h"
 #include <file/file_path.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef _WIN32
@@ -33,9 +39,65 @@
 #include <unistd.h>
 #endif
 
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY) && defined(HAVE_THREADS)
+#define HAVE_COMMAND_SERVER
+#include <rthreads/rthreads.h>
+#if !defined(_WIN32) && !defined(HAVE_SOCKET_LEGACY)
+#define HAVE_COMMAND_SERVER_UNIX
+#include <sys/un.h>
+#endif
+#endif
+
 #define DEFAULT_NETWORK_CMD_PORT 55355
 #define STDIN_BUF_SIZE 4096
 
+#ifdef HAVE_COMMAND_SERVER
+#define CMD_SERVER_MAX_CLIENTS 8
+#define CMD_SERVER_BUF_SIZE 4096
+/* Commands taken from one read of a client. */
+#define CMD_SERVER_MAX_BATCH 64
+
+struct cmd_reply_buf
+{
+   char *data;
+   size_t len;
+   size_t cap;
+};
+
+struct cmd_server_entry
+{
+   const char *line;
+   /* Acts on the emulator, so it runs on the main thread. */
+   bool main_thread;
+   bool ok;
+   struct cmd_reply_buf reply;
+};
+
+struct cmd_server_client
+{
+   int fd;
+   char buf[CMD_SERVER_BUF_SIZE];
+   size_t buf_ptr;
+};
+
+struct cmd_server
+{
+   int listen_fd;
+   char path[PATH_MAX_LENGTH];
+   struct cmd_server_client clients[CMD_SERVER_MAX_CLIENTS];
+
+   sthread_t *thread;
+   volatile bool quit;
+
+   /* A batch waiting for the main thread, under lock. */
+   slock_t *lock;
+   scond_t *cond;
+   volatile bool job_pending;
+   struct cmd_server_entry *job;
+   unsigned job_count;
+};
+#endif
+
 struct rarch_cmd
 {
 #ifdef HAVE_STDIN_CMD
@@ -48,9 +110,84 @@ struct rarch_cmd
    int net_fd;
 #endif
 
+#ifdef HAVE_COMMAND_SERVER
+   struct cmd_server *server;
+#endif
+
    bool state[RARCH_BIND_LIST_END];
 };
 
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+/* Sender of the network command we are handling right now,
+ * so that commands can answer it. */
+static int cmd_reply_fd = -1;
+static struct sockaddr_storage cmd_reply_addr;
+static socklen_t cmd_reply_addrlen;
+#endif
+
+#ifdef HAVE_COMMAND_SERVER
+/* Reply of the command server entry being run on the main thread. */
+static struct cmd_reply_buf *cmd_reply_sink;
+
+static void cmd_reply_write(struct cmd_reply_buf *reply,
+      const char *data, size_t len)
+{
+   if (reply->len + len + 1 > reply->cap)
+   {
+      size_t cap = reply->cap ? reply->cap : 256;
+      char *tmp;
+
+      while (reply->len + len + 1 > cap)
+         cap *= 2;
+
+      if (!(tmp = (char*)realloc(reply->data, cap)))
+         return;
+
+      reply->data = tmp;
+      reply->cap  = cap;
+   }
+
+   memcpy(reply->data + reply->len, data, len);
+   reply->len += len;
+   reply->data[reply->len] = '\0';
+}
+
+/* Adds msg as a line of its own. */
+static void cmd_reply_append(struct cmd_reply_buf *reply, const char *msg)
+{
+   cmd_reply_write(reply, msg, strlen(msg));
+   cmd_reply_write(reply, "\n", 1);
+}
+#endif
+
+/**
+ * cmd_reply:
+ * @msg                  : reply to send.
+ *
+ * Sends @msg back to the sender of the network command
+ * being handled. Does nothing for other commands.
+ **/
+static void cmd_reply(const char *msg)
+{
+#ifdef HAVE_COMMAND_SERVER
+   if (cmd_reply_sink)
+   {
+      cmd_reply_append(cmd_reply_sink, msg);
+      return;
+   }
+#endif
+
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+   if (cmd_reply_fd < 0)
+      return;
+
+   sendto(cmd_reply_fd, msg, strlen(msg), 0,
+         (const struct sockaddr*)&cmd_reply_addr, cmd_reply_addrlen);
+#else
+   (void)msg;
+#endif
+}
+
 static bool socket_nonblock(int fd)
 {
 #ifdef _WIN32
@@ -158,8 +295,17 @@ error:
    return NULL;
 }
 
+#ifdef HAVE_COMMAND_SERVER
+static void cmd_server_free(struct cmd_server *server);
+#endif
+
 void rarch_cmd_free(rarch_cmd_t *handle)
 {
+#ifdef HAVE_COMMAND_SERVER
+   if (handle && handle->server)
+      cmd_server_free(handle->server);
+#endif
+
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
    if (handle && handle->net_fd >= 0)
       close(handle->net_fd);
@@ -211,6 +357,9 @@ static const struct cmd_map map[] = {
    { "DISK_NEXT",              RARCH_DISK_NEXT },
    { "DISK_PREV",              RARCH_DISK_PREV },   
    { "GRAB_MOUSE_TOGGLE",      RARCH_GRAB_MOUSE_TOGGLE },
+   { "SAVE_REPLAY",            RARCH_SAVE_REPLAY },
+   { "LATENCY_TEST",           RARCH_LATENCY_TEST },
+   { "TRACE_DUMP",             RARCH_TRACE_DUMP },
    { "MENU_TOGGLE",            RARCH_MENU_TOGGLE },
    { "MENU_UP",                RETRO_DEVICE_ID_JOYPAD_UP },
    { "MENU_DOWN",              RETRO_DEVICE_ID_JOYPAD_DOWN },
@@ -246,8 +395,380 @@ static bool cmd_set_shader(const char *arg)
    return driver.video->set_shader(driver.video_data, type, arg);
 }
 
+static bool cmd_rewind_seek(const char *arg)
+{
+   char msg[PATH_MAX];
+   const void *buf = NULL;
+   unsigned entries = 0, count = 0;
+   double seconds = strtod(arg, NULL);
+   double frames_per_entry = g_settings.rewind_granularity ?
+      g_settings.rewind_granularity : 1;
+   double fps = g_extern.system.av_info.timing.fps;
+
+   if (!g_extern.state_manager || g_extern.bsv.movie || seconds <= 0.0)
+      return false;
+
+   if (fps <= 0.0)
+      fps = 60.0;
+
+   count = (unsigned)(seconds * fps / frames_per_entry + 0.5);
+   if (!count)
+      count = 1;
+
+   if (!state_manager_seek(g_extern.state_manager, count, &buf))
+      return false;
+
+   pretro_unserialize(buf, g_extern.state_size);
+
+   state_manager_capacity(g_extern.state_manager, &entries, NULL, NULL);
+
+   snprintf(msg, sizeof(msg), "Rewound %.1f s, %.1f s left in buffer.",
+         seconds, entries * frames_per_entry / fps);
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 120);
+   RARCH_LOG("%s\n", msg);
+
+   return true;
+}
+
+#ifdef HAVE_NETPLAY
+static bool cmd_netplay_stats(const char *arg)
+{
+   char msg[256];
+   struct netplay_stats stats;
+   netplay_t *netplay = (netplay_t*)driver.netplay_data;
+
+   (void)arg;
+
+   if (!netplay)
+      return false;
+
+   netplay_get_stats(netplay, &stats);
+
+   snprintf(msg, sizeof(msg),
+         "Netplay: RTT %u ms, jitter %u ms, %u/%u predictions missed, "
+         "%u rollbacks (deepest %u), %u frames/s resimulated, "
+         "stalled %u frames.",
+         stats.rtt_usec / 1000, stats.jitter_usec / 1000,
+         stats.mispredictions, stats.predictions,
+         stats.rollbacks, stats.max_rollback,
+         stats.resimulated_per_sec, stats.stalled);
+
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+   RARCH_LOG("%s\n", msg);
+   cmd_reply(msg);
+
+   return true;
+}
+#endif
+
+static bool cmd_perf_stats(const char *arg)
+{
+   char frame_time[256], iterate[256];
+
+   (void)arg;
+
+   if (!g_extern.perfcnt_enable)
+      return false;
+
+   rarch_perf_histogram_summary(&perf_histogram_frame_time,
+         frame_time, sizeof(frame_time));
+   rarch_perf_histogram_summary(&perf_histogram_iterate,
+         iterate, sizeof(iterate));
+
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, frame_time, 1, 180);
+   RARCH_LOG("%s\n", frame_time);
+   RARCH_LOG("%s\n", iterate);
+   cmd_reply(frame_time);
+   cmd_reply(iterate);
+
+   if (perf_histogram_gpu_time.count)
+   {
+      char gpu_time[256];
+
+      rarch_perf_histogram_summary(&perf_histogram_gpu_time,
+            gpu_time, sizeof(gpu_time));
+      RARCH_LOG("%s\n", gpu_time);
+      cmd_reply(gpu_time);
+   }
+
+   return true;
+}
+
+static bool cmd_perf_counters(const char *arg)
+{
+   unsigned i, count;
+   char msg[256];
+   struct rarch_perf_sample samples[MAX_COUNTERS * 2];
+
+   (void)arg;
+
+   if (!g_extern.perfcnt_enable)
+      return false;
+
+   count = rarch_perf_sample_get(samples, ARRAY_SIZE(samples));
+
+   for (i = 0; i < count; i++)
+   {
+      rarch_perf_sample_summary(&samples[i], msg, sizeof(msg));
+      RARCH_LOG("[PERF]: %s\n", msg);
+      cmd_reply(msg);
+   }
+
+   return true;
+}
+
+static bool cmd_record_stats(const char *arg)
+{
+   char msg[256];
+   struct ffemu_stats stats = {0};
+
+   (void)arg;
+
+   if (!driver.recording_data || !driver.recording 
+         || !driver.recording->get_stats)
+      return false;
+
+   driver.recording->get_stats(driver.recording_data, &stats);
+
+   snprintf(msg, sizeof(msg),
+         "Recording: %u frames queued (max %u), %u/%u KiB buffered, "
+         "%u dropped, blocked %u times for %u ms, "
+         "encode avg %.1f ms, p95 %.1f ms, max %.1f ms.",
+         stats.queued_frames, stats.max_queued_frames,
+         (unsigned)(stats.buffered_bytes >> 10),
+         (unsigned)(stats.buffer_size >> 10),
+         stats.dropped_frames, stats.blocked_frames,
+         (unsigned)(stats.blocked_usec / 1000),
+         stats.encode_usec_avg / 1000.0,
+         stats.encode_usec_p95 / 1000.0,
+         stats.encode_usec_max / 1000.0);
+
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+   RARCH_LOG("%s\n", msg);
+   cmd_reply(msg);
+
+   return true;
+}
+
+static bool cmd_memory_stats(const char *arg)
+{
+   unsigned i;
+   char msg[256];
+
+   (void)arg;
+
+   /* Ends with the total, RARCH_MEM_LAST. */
+   for (i = 0; i <= RARCH_MEM_LAST; i++)
+   {
+      rarch_mem_summary((enum rarch_mem_tag)i, msg, sizeof(msg));
+      RARCH_LOG("[Memory]: %s\n", msg);
+      cmd_reply(msg);
+   }
+
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+
+   return true;
+}
+
+static bool cmd_timeline_dump(const char *arg)
+{
+   char msg[PATH_MAX];
+
+   if (!rarch_timeline_dump(arg))
+   {
+      RARCH_ERR("Failed to write startup timeline to \"%s\".\n", arg);
+      return false;
+   }
+
+   snprintf(msg, sizeof(msg), "Startup timeline written to \"%s\".", arg);
+   RARCH_LOG("%s\n", msg);
+   cmd_reply(msg);
+
+   return true;
+}
+
+static bool cmd_trace_dump(const char *arg)
+{
+   char msg[PATH_MAX];
+
+   if (!rarch_trace_dump(arg))
+   {
+      RARCH_ERR("Failed to write trace to \"%s\".\n", arg);
+      return false;
+   }
+
+   snprintf(msg, sizeof(msg), "Trace written to \"%s\".", arg);
+   RARCH_LOG("%s\n", msg);
+   cmd_reply(msg);
+
+   return true;
+}
+
+/* Same restrictions as cheat files, see init_cheats(). */
+static bool cmd_cheats_allowed(void)
+{
+#ifdef HAVE_NETPLAY
+   if (driver.netplay_data)
+      return false;
+#endif
+   return !g_extern.bsv.movie;
+}
+
+static void cmd_cheat_search_report(void)
+{
+   char msg[256];
+
+   snprintf(msg, sizeof(msg), "Cheat search: %u matches.",
+         (unsigned)cheat_search_count(g_extern.cheat_search));
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 120);
+   RARCH_LOG("%s\n", msg);
+   cmd_reply(msg);
+}
+
+static bool cmd_cheat_search_new(const char *arg)
+{
+   cheat_search_t *search = NULL;
+
+   if (!cmd_cheats_allowed())
+      return false;
+
+   if (!(search = cheat_search_new(strtoul(arg, NULL, 0))))
+      return false;
+
+   cheat_search_free(g_extern.cheat_search);
+   g_extern.cheat_search = search;
+   cmd_cheat_search_report();
+
+   return true;
+}
+
+static const struct
+{
+   const char *str;
+   enum cheat_search_op op;
+} cheat_search_ops[] = {
+   { "eq",        CHEAT_SEARCH_EQ },
+   { "ne",        CHEAT_SEARCH_NE },
+   { "gt",        CHEAT_SEARCH_GT },
+   { "lt",        CHEAT_SEARCH_LT },
+   { "unchanged", CHEAT_SEARCH_UNCHANGED },
+   { "changed",   CHEAT_SEARCH_CHANGED },
+   { "increased", CHEAT_SEARCH_INCREASED },
+   { "decreased", CHEAT_SEARCH_DECREASED },
+};
+
+static bool cmd_cheat_search_filter(const char *arg)
+{
+   unsigned i;
+   uint32_t value    = 0;
+   bool has_value    = false;
+   const char *space = strchr(arg, ' ');
+   size_t len        = space ? (size_t)(space - arg) : strlen(arg);
+
+   if (!g_extern.cheat_search)
+      return false;
+
+   if (space)
+   {
+      char *end = NULL;
+
+      value     = (uint32_t)strtoul(space + 1, &end, 0);
+      has_value = end != space + 1;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(cheat_search_ops); i++)
+   {
+      if (strlen(cheat_search_ops[i].str) != len ||
+            strncmp(arg, cheat_search_ops[i].str, len) != 0)
+         continue;
+
+      /* The first four compare against a value. */
+      if (cheat_search_ops[i].op < CHEAT_SEARCH_UNCHANGED && !has_value)
+         return false;
+
+      cheat_search_filter(g_extern.cheat_search,
+            cheat_search_ops[i].op, value);
+      cmd_cheat_search_report();
+      return true;
+   }
+
+   return false;
+}
+
+static bool cmd_cheat_search_list(const char *arg)
+{
+   size_t i, count;
+   size_t addresses[32];
+   uint32_t values[32];
+
+   (void)arg;
+
+   if (!g_extern.cheat_search)
+      return false;
+
+   count = cheat_search_matches(g_extern.cheat_search,
+         addresses, values, ARRAY_SIZE(addresses));
+
+   for (i = 0; i < count; i++)
+   {
+      char msg[64];
+
+      snprintf(msg, sizeof(msg), "0x%06X 0x%X (%u)",
+            (unsigned)addresses[i], (unsigned)values[i],
+            (unsigned)values[i]);
+      cmd_reply(msg);
+   }
+
+   return true;
+}
+
+static bool cmd_cheat_search_add(const char *arg)
+{
+   size_t address;
+   uint32_t value;
+   char *end = NULL;
+
+   if (!g_extern.cheat_search || !cmd_cheats_allowed())
+      return false;
+
+   address = strtoul(arg, &end, 0);
+   if (end == arg)
+      return false;
+
+   /* Keeps the value as of the last search by default. */
+   value = *end ? (uint32_t)strtoul(end, NULL, 0) :
+      cheat_search_value(g_extern.cheat_search, address);
+
+   if (!g_extern.cheat && !(g_extern.cheat = cheat_manager_new(0)))
+      return false;
+
+   return cheat_search_add_cheat(g_extern.cheat_search, g_extern.cheat,
+         address, value);
+}
+
+/* Actions without an argument description take no argument. */
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", cmd_set_shader, "<shader path>" },
+   { "REWIND_SEEK", cmd_rewind_seek, "<seconds>" },
+   { "PERF_STATS", cmd_perf_stats, NULL },
+   { "PERF_COUNTERS", cmd_perf_counters, NULL },
+   { "RECORD_STATS", cmd_record_stats, NULL },
+   { "MEMORY_STATS", cmd_memory_stats, NULL },
+   { "TIMELINE_DUMP", cmd_timeline_dump, "<trace path>" },
+   { "TRACE_DUMP", cmd_trace_dump, "<trace path>" },
+   { "CHEAT_SEARCH_NEW", cmd_cheat_search_new, "<8|16|32>" },
+   { "CHEAT_SEARCH_FILTER", cmd_cheat_search_filter, "<op> [value]" },
+   { "CHEAT_SEARCH_LIST", cmd_cheat_search_list, NULL },
+   { "CHEAT_SEARCH_ADD", cmd_cheat_search_add, "<address> [value]" },
+#ifdef HAVE_NETPLAY
+   { "NETPLAY_STATS", cmd_netplay_stats, NULL },
+#endif
 };
 
 static bool command_get_arg(const char *tok,
@@ -275,11 +796,17 @@ static bool command_get_arg(const char *tok,
       if (str == tok)
       {
          const char *argument = str + strlen(action_map[i].str);
-         if (*argument != ' ')
+
+         if (!action_map[i].arg_desc)
+         {
+            if (*argument != '\0')
+               return false;
+         }
+         else if (*argument++ != ' ')
             return false;
 
          if (arg)
-            *arg = argument + 1;
+            *arg = argument;
 
          if (index)
             *index = i;
@@ -291,7 +818,7 @@ static bool command_get_arg(const char *tok,
    return false;
 }
 
-static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
+static bool parse_sub_msg(rarch_cmd_t *handle, const char *tok)
 {
    const char *arg = NULL;
    unsigned index  = 0;
@@ -301,13 +828,19 @@ static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
       if (arg)
       {
          if (!action_map[index].action(arg))
+         {
             RARCH_ERR("Command \"%s\" failed.\n", arg);
+            return false;
+         }
       }
       else
          handle->state[map[index].id] = true;
+
+      return true;
    }
-   else
-      RARCH_WARN("Unrecognized command \"%s\" received.\n", tok);
+
+   RARCH_WARN("Unrecognized command \"%s\" received.\n", tok);
+   return false;
 }
 
 static void parse_msg(rarch_cmd_t *handle, char *buf)
@@ -354,14 +887,19 @@ static void network_cmd_poll(rarch_cmd_t *handle)
    for (;;)
    {
       char buf[1024];
-      ssize_t ret = recvfrom(handle->net_fd, buf,
-            sizeof(buf) - 1, 0, NULL, NULL);
+      ssize_t ret;
+
+      cmd_reply_addrlen = sizeof(cmd_reply_addr);
+      ret = recvfrom(handle->net_fd, buf, sizeof(buf) - 1, 0,
+            (struct sockaddr*)&cmd_reply_addr, &cmd_reply_addrlen);
 
       if (ret <= 0)
          break;
 
       buf[ret] = '\0';
+      cmd_reply_fd = handle->net_fd;
       parse_msg(handle, buf);
+      cmd_reply_fd = -1;
    }
 }
 #endif
@@ -515,10 +1053,19 @@ static void stdin_cmd_poll(rarch_cmd_t *handle)
 }
 #endif
 
+#ifdef HAVE_COMMAND_SERVER
+static void cmd_server_run_job(rarch_cmd_t *handle);
+#endif
+
 void rarch_cmd_poll(rarch_cmd_t *handle)
 {
    memset(handle->state, 0, sizeof(handle->state));
 
+#ifdef HAVE_COMMAND_SERVER
+   if (handle->server && handle->server->job_pending)
+      cmd_server_run_job(handle);
+#endif
+
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
    network_cmd_poll(handle);
 #endif
@@ -598,7 +1145,8 @@ static bool verify_command(const char *cmd)
       RARCH_ERR("\t\t%s\n", map[i].str);
 
    for (i = 0; i < sizeof(action_map) / sizeof(action_map[0]); i++)
-      RARCH_ERR("\t\t%s %s\n", action_map[i].str, action_map[i].arg_desc);
+      RARCH_ERR("\t\t%s %s\n", action_map[i].str,
+            action_map[i].arg_desc ? action_map[i].arg_desc : "");
 
    return false;
 }
@@ -651,3 +1199,479 @@ bool network_cmd_send(const char *cmd_)
 #endif
 
 
+
+#ifdef HAVE_COMMAND_SERVER
+static float cmd_server_fps(void)
+{
+   unsigned i, count;
+   retro_time_t accum = 0;
+   uint64_t total     = g_extern.measure_data.frame_time_samples_count;
+
+   count = total < 64 ? (unsigned)total : 64;
+
+   for (i = 1; i <= count; i++)
+      accum += g_extern.measure_data.frame_time_samples[(total - i)
+         & (MEASURE_FRAME_TIME_SAMPLES_COUNT - 1)];
+
+   return accum > 0 ? count * 1000000.0f / accum : 0.0f;
+}
+
+/* Queries only read counters, so they are answered on the server
+ * thread. The numbers may be a frame old. */
+static bool cmd_query_status(struct cmd_reply_buf *reply)
+{
+   char msg[256];
+
+   snprintf(msg, sizeof(msg),
+         "fps %.2f, frames %u, paused %u, menu %u",
+         cmd_server_fps(), g_extern.frame_count,
+         (unsigned)g_extern.is_paused, (unsigned)g_extern.is_menu);
+   cmd_reply_append(reply, msg);
+   return true;
+}
+
+static bool cmd_query_perf_stats(struct cmd_reply_buf *reply)
+{
+   char msg[256];
+
+   if (!g_extern.perfcnt_enable)
+      return false;
+
+   rarch_perf_histogram_summary(&perf_histogram_frame_time,
+         msg, sizeof(msg));
+   cmd_reply_append(reply, msg);
+   rarch_perf_histogram_summary(&perf_histogram_iterate,
+         msg, sizeof(msg));
+   cmd_reply_append(reply, msg);
+
+   if (perf_histogram_gpu_time.count)
+   {
+      rarch_perf_histogram_summary(&perf_histogram_gpu_time,
+            msg, sizeof(msg));
+      cmd_reply_append(reply, msg);
+   }
+
+   return true;
+}
+
+static bool cmd_query_memory_stats(struct cmd_reply_buf *reply)
+{
+   unsigned i;
+   char msg[256];
+
+   for (i = 0; i <= RARCH_MEM_LAST; i++)
+   {
+      rarch_mem_summary((enum rarch_mem_tag)i, msg, sizeof(msg));
+      cmd_reply_append(reply, msg);
+   }
+
+   return true;
+}
+
+struct cmd_query_map
+{
+   const char *str;
+   bool (*query)(struct cmd_reply_buf *reply);
+};
+
+static const struct cmd_query_map query_map[] = {
+   { "STATUS", cmd_query_status },
+   { "PERF_STATS", cmd_query_perf_stats },
+   { "MEMORY_STATS", cmd_query_memory_stats },
+};
+
+static const struct cmd_query_map *cmd_server_find_query(const char *line)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+      if (strcmp(line, query_map[i].str) == 0)
+         return &query_map[i];
+
+   return NULL;
+}
+
+/* Main thread, from rarch_cmd_poll. */
+static void cmd_server_run_job(rarch_cmd_t *handle)
+{
+   unsigned i;
+   struct cmd_server *server = handle->server;
+
+   slock_lock(server->lock);
+
+   for (i = 0; i < server->job_count; i++)
+   {
+      struct cmd_server_entry *entry = &server->job[i];
+
+      if (!entry->main_thread)
+         continue;
+
+      cmd_reply_sink = &entry->reply;
+      entry->ok      = parse_sub_msg(handle, entry->line);
+      cmd_reply_sink = NULL;
+   }
+
+   server->job_pending = false;
+   scond_signal(server->cond);
+   slock_unlock(server->lock);
+}
+
+static bool cmd_server_send(int fd, const char *data, size_t len)
+{
+   while (len)
+   {
+      ssize_t ret = send(fd, CONST_CAST data, len, 0);
+
+      if (ret <= 0)
+         return false;
+
+      data += ret;
+      len  -= ret;
+   }
+
+   return true;
+}
+
+/* Runs the complete lines in lines, and answers them in one go. */
+static bool cmd_server_run_batch(struct cmd_server *server,
+      int fd, char *lines)
+{
+   unsigned i, count = 0;
+   bool need_main    = false;
+   bool ret          = true;
+   char *save        = NULL;
+   char *tok         = strtok_r(lines, "\n", &save);
+   struct cmd_server_entry entries[CMD_SERVER_MAX_BATCH];
+   struct cmd_reply_buf out = {0};
+
+   memset(entries, 0, sizeof(entries));
+
+   for (; tok && count < CMD_SERVER_MAX_BATCH;
+         tok = strtok_r(NULL, "\n", &save))
+   {
+      size_t len = strlen(tok);
+      struct cmd_server_entry *entry = &entries[count];
+
+      if (len && tok[len - 1] == '\r')
+         tok[--len] = '\0';
+      if (!len)
+         continue;
+
+      entry->line        = tok;
+      entry->main_thread = !cmd_server_find_query(tok)
+         && command_get_arg(tok, NULL, NULL);
+      need_main          = need_main || entry->main_thread;
+      count++;
+   }
+
+   if (need_main)
+   {
+      slock_lock(server->lock);
+      server->job         = entries;
+      server->job_count   = count;
+      server->job_pending = true;
+
+      while (server->job_pending && !server->quit)
+         scond_wait(server->cond, server->lock);
+
+      /* Shutting down, the main thread is not going to look at it. */
+      server->job_pending = false;
+      server->job         = NULL;
+      slock_unlock(server->lock);
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      struct cmd_server_entry *entry = &entries[i];
+      const struct cmd_query_map *query = cmd_server_find_query(entry->line);
+
+      if (query)
+         entry->ok = query->query(&entry->reply);
+      else if (!entry->main_thread)
+         cmd_reply_append(&entry->reply, "Unrecognized command.");
+
+      cmd_reply_write(&out, entry->reply.data, entry->reply.len);
+      cmd_reply_append(&out, entry->ok ? "OK" : "ERR");
+      free(entry->reply.data);
+   }
+
+   if (out.len)
+      ret = cmd_server_send(fd, out.data, out.len);
+
+   free(out.data);
+   return ret;
+}
+
+static void cmd_server_close_client(struct cmd_server_client *client)
+{
+   close(client->fd);
+   client->fd      = -1;
+   client->buf_ptr = 0;
+}
+
+static void cmd_server_accept(struct cmd_server *server)
+{
+   unsigned i;
+   int fd = accept(server->listen_fd, NULL, NULL);
+
+   if (fd < 0)
+      return;
+
+   for (i = 0; i < CMD_SERVER_MAX_CLIENTS; i++)
+   {
+      if (server->clients[i].fd >= 0)
+         continue;
+
+      server->clients[i].fd      = fd;
+      server->clients[i].buf_ptr = 0;
+      return;
+   }
+
+   RARCH_WARN("Command server: Too many clients, dropping one.\n");
+   close(fd);
+}
+
+static void cmd_server_read(struct cmd_server *server,
+      struct cmd_server_client *client)
+{
+   char *last_newline;
+   size_t msg_len;
+   ssize_t ret = recv(client->fd, client->buf + client->buf_ptr,
+         CMD_SERVER_BUF_SIZE - client->buf_ptr - 1, 0);
+
+   if (ret <= 0)
+   {
+      cmd_server_close_client(client);
+      return;
+   }
+
+   client->buf_ptr += ret;
+   client->buf[client->buf_ptr] = '\0';
+
+   last_newline = strrchr(client->buf, '\n');
+   if (!last_newline)
+   {
+      if (client->buf_ptr + 1 >= CMD_SERVER_BUF_SIZE)
+      {
+         cmd_server_send(client->fd, "ERR\n", 4);
+         client->buf_ptr = 0;
+      }
+      return;
+   }
+
+   *last_newline++ = '\0';
+   msg_len = last_newline - client->buf;
+
+   if (!cmd_server_run_batch(server, client->fd, client->buf))
+   {
+      cmd_server_close_client(client);
+      return;
+   }
+
+   memmove(client->buf, last_newline, client->buf_ptr - msg_len);
+   client->buf_ptr -= msg_len;
+}
+
+static void cmd_server_thread(void *data)
+{
+   struct cmd_server *server = (struct cmd_server*)data;
+
+   while (!server->quit)
+   {
+      unsigned i;
+      fd_set fds;
+      int max_fd = server->listen_fd;
+      /* Only to notice quit. */
+      struct timeval tv = {0, 100000};
+
+      FD_ZERO(&fds);
+      FD_SET(server->listen_fd, &fds);
+
+      for (i = 0; i < CMD_SERVER_MAX_CLIENTS; i++)
+      {
+         if (server->clients[i].fd < 0)
+            continue;
+
+         FD_SET(server->clients[i].fd, &fds);
+         if (server->clients[i].fd > max_fd)
+            max_fd = server->clients[i].fd;
+      }
+
+      if (select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+         continue;
+
+      if (FD_ISSET(server->listen_fd, &fds))
+         cmd_server_accept(server);
+
+      for (i = 0; i < CMD_SERVER_MAX_CLIENTS && !server->quit; i++)
+      {
+         if (server->clients[i].fd >= 0 &&
+               FD_ISSET(server->clients[i].fd, &fds))
+            cmd_server_read(server, &server->clients[i]);
+      }
+   }
+}
+
+static bool cmd_server_listen_tcp(struct cmd_server *server, uint16_t port)
+{
+   char port_buf[16];
+   struct addrinfo hints, *res = NULL;
+   int yes = 1;
+
+   memset(&hints, 0, sizeof(hints));
+#if defined(_WIN32) || defined(HAVE_SOCKET_LEGACY)
+   hints.ai_family   = AF_INET;
+#else
+   hints.ai_family   = AF_UNSPEC;
+#endif
+   hints.ai_socktype = SOCK_STREAM;
+   hints.ai_flags    = AI_PASSIVE;
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   if (getaddrinfo(NULL, port_buf, &hints, &res) < 0)
+      return false;
+
+   server->listen_fd = socket(res->ai_family,
+         res->ai_socktype, res->ai_protocol);
+   if (server->listen_fd < 0)
+      goto error;
+
+   setsockopt(server->listen_fd, SOL_SOCKET,
+         SO_REUSEADDR, CONST_CAST &yes, sizeof(int));
+
+   if (bind(server->listen_fd, res->ai_addr, res->ai_addrlen) < 0)
+   {
+      RARCH_ERR("Command server: Failed to bind port %hu.\n",
+            (unsigned short)port);
+      goto error;
+   }
+
+   freeaddrinfo(res);
+   RARCH_LOG("Command server listening on port %hu.\n",
+         (unsigned short)port);
+   return true;
+
+error:
+   freeaddrinfo(res);
+   return false;
+}
+
+#ifdef HAVE_COMMAND_SERVER_UNIX
+static bool cmd_server_listen_unix(struct cmd_server *server,
+      const char *path)
+{
+   struct sockaddr_un addr;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (strlcpy(addr.sun_path, path, sizeof(addr.sun_path))
+         >= sizeof(addr.sun_path))
+   {
+      RARCH_ERR("Command server: Socket path \"%s\" is too long.\n", path);
+      return false;
+   }
+
+   server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (server->listen_fd < 0)
+      return false;
+
+   /* Left over by an earlier run. */
+   unlink(path);
+
+   if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      RARCH_ERR("Command server: Failed to bind \"%s\".\n", path);
+      return false;
+   }
+
+   strlcpy(server->path, path, sizeof(server->path));
+   RARCH_LOG("Command server listening on \"%s\".\n", path);
+   return true;
+}
+#endif
+
+static void cmd_server_free(struct cmd_server *server)
+{
+   unsigned i;
+
+   if (server->thread)
+   {
+      slock_lock(server->lock);
+      server->quit = true;
+      scond_signal(server->cond);
+      slock_unlock(server->lock);
+
+      sthread_join(server->thread);
+   }
+
+   for (i = 0; i < CMD_SERVER_MAX_CLIENTS; i++)
+      if (server->clients[i].fd >= 0)
+         close(server->clients[i].fd);
+
+   if (server->listen_fd >= 0)
+      close(server->listen_fd);
+
+#ifdef HAVE_COMMAND_SERVER_UNIX
+   if (*server->path)
+      unlink(server->path);
+#endif
+
+   if (server->cond)
+      scond_free(server->cond);
+   if (server->lock)
+      slock_free(server->lock);
+   free(server);
+}
+#endif
+
+bool rarch_cmd_server_start(rarch_cmd_t *handle,
+      uint16_t port, const char *path)
+{
+#ifdef HAVE_COMMAND_SERVER
+   unsigned i;
+   bool listening            = false;
+   struct cmd_server *server = NULL;
+
+   if (handle->server || !network_init())
+      return false;
+
+   if (!(server = (struct cmd_server*)calloc(1, sizeof(*server))))
+      return false;
+
+   server->listen_fd = -1;
+   for (i = 0; i < CMD_SERVER_MAX_CLIENTS; i++)
+      server->clients[i].fd = -1;
+
+#ifdef HAVE_COMMAND_SERVER_UNIX
+   if (path && *path)
+      listening = cmd_server_listen_unix(server, path);
+   else
+#endif
+      listening = cmd_server_listen_tcp(server, port);
+
+   if (!listening || listen(server->listen_fd, 4) < 0
+         || !socket_nonblock(server->listen_fd))
+      goto error;
+
+   server->lock = slock_new();
+   server->cond = scond_new();
+   if (!server->lock || !server->cond)
+      goto error;
+
+   if (!(server->thread = sthread_create(cmd_server_thread, server)))
+      goto error;
+
+   handle->server = server;
+   return true;
+
+error:
+   RARCH_ERR("Failed to start command server.\n");
+   cmd_server_free(server);
+   return false;
+#else
+   (void)handle;
+   (void)port;
+   (void)path;
+   return false;
+#endif
+}
@@ -37,6 +37,22 @@ void rarch_cmd_free(rarch_cmd_t *handle);
 
 void rarch_cmd_poll(rarch_cmd_t *handle);
 
+/**
+ * rarch_cmd_server_start:
+ * @handle               : command handle.
+ * @port                 : TCP port to listen on.
+ * @path                 : Unix socket to listen on instead, if set.
+ *
+ * Starts the command server thread. Clients send the same commands
+ * as to the network and stdin interfaces, one per line, and every
+ * command is answered with its reply lines followed by "OK" or "ERR".
+ * Commands which act on the emulator are run by rarch_cmd_poll.
+ *
+ * Returns: true (1) if the server is running, otherwise false (0).
+ **/
+bool rarch_cmd_server_start(rarch_cmd_t *handle,
+      uint16_t port, const char *path);
+
 void rarch_cmd_set(rarch_cmd_t *handle, unsigned id);
 
 bool rarch_cmd_get(rarch_cmd_t *handle, unsigned id);
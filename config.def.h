@@ -372,11 +372,34 @@ static const bool hard_sync = false;
  */
 static const unsigned hard_sync_frames = 0;
 
+/* Hard syncs with no frames queued, then delays the next frame 
+ * by the measured CPU and GPU frame time, so that it completes 
+ * just before VSync. Requires hard_sync. */
+static const bool hard_sync_adaptive = false;
+
 /* Sets how many milliseconds to delay after VSync before running the core.
  * Can reduce latency at cost of higher risk of stuttering.
  */
 static const unsigned frame_delay = 0;
 
+/* Picks the frame delay from swap timing instead of video_frame_delay:
+ * grows it while the core finishes well before VSync, and backs off
+ * when VSyncs are missed. */
+static const bool frame_delay_auto = false;
+
+/* Runs the core this many frames ahead every frame, shows the
+ * last one, then rolls back with savestates. Hides the input lag
+ * of the core itself, at the cost of running it (N + 1) times 
+ * per frame. 0 disables run-ahead.
+ */
+static const unsigned runahead_frames = 0;
+
+/* Runs the speculative run-ahead frames in a second copy of
+ * the core, so the main instance never needs to roll back. 
+ * Keeps audio intact, but needs twice the memory. 
+ */
+static const bool runahead_secondary_instance = false;
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated 
  * ghosting. video_refresh_rate should still be configured as if it 
@@ -389,6 +412,12 @@ static bool black_frame_insertion = false;
  */
 static unsigned swap_interval = 1;
 
+/* Variable refresh rate (FreeSync, G-Sync). Presents frames at 
+ * the core's own rate and lets the display follow, instead of 
+ * bending the core's timing to video_refresh_rate.
+ * 0 = off, 1 = if the display reports support, 2 = always. */
+static unsigned video_vrr = 0;
+
 /* Threaded video. Will possibly increase performance significantly 
  * at the cost of worse synchronization and latency.
  */
@@ -397,6 +426,11 @@ static const bool video_threaded = false;
 /* Set to true if HW render cores should get their private context. */
 static const bool video_shared_context = false;
 
+/* Uploads frames that need a pixel format conversion 
+ * (RGB565 on GL without ES2 compatibility, XRGB8888 on GLES 
+ * without BGRA8888) as raw data, and converts them on the GPU. */
+static const bool video_gpu_pixel_unpack = false;
+
 /* Sets GC/Wii screen width. */
 static const unsigned video_viwidth = 640;
 
@@ -488,9 +522,18 @@ static const bool post_filter_record = false;
 /* Screenshots post-shaded GPU output if available. */
 static const bool gpu_screenshot = true;
 
+/* zlib level PNG screenshots are compressed at, from 0 to 9.
+ * Low levels save much faster, for slightly bigger files. */
+static const unsigned screenshot_compression_level = 1;
+
 /* Record post-shaded GPU output instead of raw game footage if available. */
 static const bool gpu_record = false;
 
+/* Seconds of gameplay kept encoded in memory, which the 
+ * save replay hotkey writes out. 0 disables the replay buffer. 
+ * Ignored while recording to a file. */
+static const unsigned replay_buffer = 0;
+
 /* OSD-messages. */
 static const bool font_enable = true;
 
@@ -510,6 +553,11 @@ static const float refresh_rate = 60/1.001;
 static const float refresh_rate = 59.95; 
 #endif
 
+/* Replaces refresh_rate with the rate measured from swap timing,
+ * once that estimate is stable, so audio rate control follows 
+ * the actual display. */
+static const bool refresh_rate_track = false;
+
 /* Allow games to set rotation. If false, rotation requests are 
  * honored, but ignored.
  * Used for setups where one manually rotates the monitor. */
@@ -544,6 +592,16 @@ static const bool rate_control = false;
  * is allowed to adjust input rate. */
 static const float rate_control_delta = 0.005;
 
+/* Target for the amount of audio kept in the driver buffer 
+ * by rate control, in milliseconds. 
+ * 0 keeps the buffer half full. */
+static const unsigned rate_control_target = 0;
+
+/* Learns the lowest audio latency which runs without underruns, 
+ * starting low and raising it as needed. audio_latency is 
+ * the upper bound. */
+static const bool audio_latency_autotune = false;
+
 /* Maximum timing skew. Defines how much adjust_system_rates
  * is allowed to adjust input rate. */
 static const float max_timing_skew = 0.05;
@@ -556,6 +614,18 @@ static const float audio_volume = 0.0;
 /* Enables displaying the current frames per second. */
 static const bool fps_show = false;
 
+/* Shows the GPU time of each shader pass on screen. 
+ * Needs GL_ARB_timer_query. */
+static const bool gpu_pass_stats_show = false;
+
+/* Shows the perf counters, RetroArch's and the core's, 
+ * which took the most time over the last second. 
+ * Needs perfcnt_enable and the GL driver. */
+static const bool perf_hud_show = false;
+
+/* How many counters the perf HUD shows. */
+static const unsigned perf_hud_count = 8;
+
 /* Enables use of rewind. This will incur some memory footprint 
  * depending on the save state buffer. */
 static const bool rewind_enable = false;
@@ -567,6 +637,20 @@ static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* Compresses rewind deltas on a separate thread, so the
+ * cost of a push no longer shows up in the frame time. */
+static const bool rewind_threaded = false;
+
+/* Stores every Nth rewind state in full. Allows seeking 
+ * far back without decoding every state in between, 
+ * at the cost of buffer space. 0 disables keyframes. */
+static const unsigned rewind_keyframe_interval = 0;
+
+/* LZ compresses rewind states on top of the delta encoding 
+ * while that pays off for the running core. Fits more rewind 
+ * time into the same buffer at some CPU cost. */
+static const bool rewind_compression = false;
+
 /* Pause gameplay when gameplay loses focus. */
 static const bool pause_nonactive = false;
 
@@ -588,6 +672,14 @@ static const bool block_sram_overwrite = false;
  * to the highest existing value. */
 static const bool savestate_auto_index = false;
 
+/* Compresses savestates with zlib when writing them.
+ * Compressed and uncompressed states both load either way. */
+static const bool savestate_compression = false;
+
+/* Saves a thumbnail (<state>.png) and metadata (<state>.meta)
+ * next to savestates, for the menu to preview slots with. */
+static const bool savestate_thumbnail_enable = false;
+
 /* Automatically saves a savestate at the end of RetroArch's lifetime.
  * The path is $SRAM_PATH.auto.
  * RetroArch will automatically load any savestate with this path on 
@@ -595,6 +687,12 @@ static const bool savestate_auto_index = false;
 static const bool savestate_auto_save = false;
 static const bool savestate_auto_load = false;
 
+/* Saves a resume snapshot of the running core and content on exit.
+ * Started without content, RetroArch then boots straight back into
+ * the snapshot, like a machine resuming from suspend. Meant for
+ * kiosks and cabinets. */
+static const bool resume_snapshot_enable = false;
+
 /* Slowmotion ratio. */
 static const float slowmotion_ratio = 3.0;
 
@@ -609,15 +707,37 @@ static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
 static const bool stdin_cmd_enable = false;
 
+/* Threaded TCP/Unix socket command server which replies to commands. */
+static const bool command_server_enable = false;
+static const uint16_t command_server_port = 55356;
+
 /* Number of entries that will be kept in content history playlist file. */
 static const unsigned default_content_history_size = 100;
 
 /* Show Menu start-up screen on boot. */
 static const bool menu_show_start_screen = true;
 
+/* Frames per second the menu is drawn at while nothing moves and
+ * the core is paused. Input brings it back to full rate right away.
+ * 0 always draws at full rate. */
+static const unsigned menu_idle_fps = 10;
+
 /* Log level for libretro cores (GET_LOG_INTERFACE). */
 static const unsigned libretro_log_level = 0;
 
+/* Writes the log from a thread, so logging does not
+ * hold up the frame. */
+static const bool log_async_enable = false;
+
+/* Megabytes of recently closed cores to keep loaded, so that
+ * switching back to them is quicker. 0 closes them right away. */
+static const unsigned libretro_warm_pool_size = 0;
+
+/* Asks the platform for clocks it can sustain, and lowers 
+ * rewind and shader quality while the device runs hot or 
+ * frames start to run late. */
+static const bool performance_mode = false;
+
 #ifndef RARCH_DEFAULT_PORT
 #define RARCH_DEFAULT_PORT 55435
 #endif
@@ -636,6 +756,19 @@ static const unsigned turbo_duty_cycle = 3;
  * gamepads, plug-and-play style. */
 static const bool input_autodetect_enable = true;
 
+/* Polls input on the core's first input query of a frame,
+ * rather than when the core asks for a poll. Cuts latency
+ * for cores which poll early and read input late. */
+static const bool input_poll_late = false;
+
+/* Joypad axis of user 1's pad a photodiode is wired to, 
+ * for the latency test to time when the display lights up. 
+ * -1 disables it. */
+static const int input_latency_test_axis = -1;
+
+/* Axis value from which the photodiode counts as lit. */
+static const int input_latency_test_threshold = 0x4000;
+
 /* Show the input descriptors set by the core instead 
  * of the default ones. */
 static const bool input_descriptor_label_show = true;
@@ -705,6 +838,9 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_DISK_NEXT,                RETRO_LBL_DISK_NEXT,            RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_DISK_PREV,                RETRO_LBL_DISK_PREV,            RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_GRAB_MOUSE_TOGGLE,        RETRO_LBL_GRAB_MOUSE_TOGGLE,    RETROK_F11,     NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_SAVE_REPLAY,              RETRO_LBL_SAVE_REPLAY,          RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_LATENCY_TEST,             RETRO_LBL_LATENCY_TEST,         RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_TRACE_DUMP,               RETRO_LBL_TRACE_DUMP,           RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_MENU_TOGGLE,              RETRO_LBL_MENU_TOGGLE,          RETROK_F1,      NO_BTN, 0, AXIS_NONE },
 };
 
@@ -14,6 +14,10 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "content.h"
 #include "file_ops.h"
 #include <file/file_path.h>
@@ -25,10 +29,21 @@
 #include "dynamic.h"
 #include "movie.h"
 #include "patch.h"
+#include "performance.h"
+#include "runahead.h"
 #include "compat/strl.h"
 #include "hash.h"
 #include "file_extract.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include "autosave.h"
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #ifdef _WIN32
 #ifdef _XBOX
 #include <xtl.h>
@@ -41,15 +56,67 @@
 #endif
 #endif
 
+/**
+ * read_content_data:
+ * @path         : path of the content file.
+ * @buf          : buffer to read the content file into.
+ * @map_size     : set to the size of the mapping when @buf is
+ *                 mapped, 0 when it is allocated.
+ *
+ * Maps the content file where that is possible, so that large
+ * content is not read up front and copied into the heap, and
+ * reads it into memory otherwise.
+ *
+ * Returns: size of the content file, -1 on error.
+ **/
+static long read_content_data(const char *path, void **buf, long *map_size)
+{
+   *map_size = 0;
+
+#ifdef HAVE_MMAP
+   *map_size = map_file(path, buf);
+   if (*map_size > 0)
+      return *map_size;
+   *map_size = 0;
+#endif
+
+   return read_file(path, buf);
+}
+
+/**
+ * free_content_data:
+ * @buf          : buffer from read_content_data().
+ * @map_size     : mapping size from read_content_data().
+ *
+ * Releases a buffer returned by read_content_data().
+ **/
+static void free_content_data(void *buf, long map_size)
+{
+#ifdef HAVE_MMAP
+   if (map_size)
+   {
+      unmap_file(buf, map_size);
+      return;
+   }
+#endif
+
+   free(buf);
+}
+
 /**
  * patch_content:
+ * @path         : path of the content file.
  * @buf          : buffer of the content file.
  * @size         : size   of the content file.
+ * @map_size     : mapping size of @buf, see read_content_data().
+ * @crc          : set to the CRC32 of the patched content.
  *
  * Apply patch to the content file in-memory.
  *
+ * Returns: true (1) if the content was patched, otherwise false (0).
  **/
-static void patch_content(uint8_t **buf, ssize_t *size)
+static bool patch_content(const char *path, uint8_t **buf, ssize_t *size,
+      long *map_size, uint32_t *crc)
 {
    size_t target_size;
 
@@ -74,7 +141,7 @@ static void patch_content(uint8_t **buf, ssize_t *size)
    if (g_extern.ups_pref + g_extern.bps_pref + g_extern.ips_pref > 1)
    {
       RARCH_WARN("Several patches are explicitly defined, ignoring all ...\n");
-      return;
+      return false;
    }
 
    if (allow_ups && *g_extern.ups_name
@@ -101,12 +168,42 @@ static void patch_content(uint8_t **buf, ssize_t *size)
    else
    {
       RARCH_LOG("Did not find a valid content patch.\n");
-      return;
+      return false;
    }
 
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
          patch_desc, patch_path);
 
+   /* IPS only overwrites bytes, which a mapping can take in 
+    * place. Only the pages it touches get copied. */
+   if (*map_size && func == ips_apply_patch)
+   {
+      target_size = ret_size;
+      err = func((const uint8_t*)patch_data, patch_size, ret_buf,
+            ret_size, ret_buf, &target_size, crc);
+
+      if (err == PATCH_SUCCESS)
+      {
+         RARCH_LOG("Content patched successfully (%s).\n", patch_desc);
+         *size = target_size;
+         free(patch_data);
+         return true;
+      }
+
+      /* It grows the content, or failed half way. Start over 
+       * from an untouched mapping. */
+      free_content_data(ret_buf, *map_size);
+      ret_size = read_content_data(path, (void**)&ret_buf, map_size);
+      if (ret_size <= 0)
+      {
+         RARCH_ERR("Could not read content file \"%s\".\n", path);
+         *buf  = NULL;
+         *size = -1;
+         free(patch_data);
+         return false;
+      }
+   }
+
    target_size = ret_size * 4; /* Just to be sure. */
 
    patched_content = (uint8_t*)malloc(target_size);
@@ -118,7 +215,7 @@ static void patch_content(uint8_t **buf, ssize_t *size)
    }
 
    err = func((const uint8_t*)patch_data, patch_size, ret_buf,
-         ret_size, patched_content, &target_size);
+         ret_size, patched_content, &target_size, crc);
 
    if (err == PATCH_SUCCESS)
    {
@@ -131,24 +228,33 @@ static void patch_content(uint8_t **buf, ssize_t *size)
 
    if (success)
    {
-      free(ret_buf);
+      free_content_data(ret_buf, *map_size);
+      *map_size = 0;
       *buf = patched_content;
       *size = target_size;
    }
+   else
+   {
+      free(patched_content);
+      *buf = ret_buf;
+      *size = ret_size;
+   }
 
    free(patch_data);
-   return;
+   return success;
 
 error:
    *buf = ret_buf;
    *size = ret_size;
    free(patch_data);
+   return false;
 }
 
 /**
  * read_content_file:
  * @path         : buffer of the content file.
  * @buf          : size   of the content file.
+ * @map_size     : mapping size of @buf, see read_content_data().
  *
  * Read the content file into memory. Also performs soft patching
  * (see patch_content function) in case soft patching has not been
@@ -156,22 +262,35 @@ error:
  *
  * Returns: size of the content file that has been read from.
  **/
-static ssize_t read_content_file(const char *path, void **buf)
+static ssize_t read_content_file(const char *path, void **buf,
+      long *map_size)
 {
    uint8_t *ret_buf = NULL;
    ssize_t ret = -1;
 
    RARCH_LOG("Loading content file: %s.\n", path);
-   ret = read_file(path, (void**) &ret_buf);
+   rarch_timeline_begin("read_content_data");
+   ret = read_content_data(path, (void**) &ret_buf, map_size);
+   rarch_timeline_end();
 
    if (ret <= 0)
       return ret;
 
-   /* Attempt to apply a patch. */
-   if (!g_extern.block_patch)
-      patch_content(&ret_buf, &ret);
-   
-   g_extern.content_crc = crc32_calculate(ret_buf, ret);
+   /* Attempt to apply a patch. Patching checksums the content 
+    * as it goes. */
+   rarch_timeline_begin("patch_content");
+   if (g_extern.block_patch || !patch_content(path, &ret_buf, &ret,
+            map_size, &g_extern.content_crc))
+   {
+      rarch_timeline_end();
+
+      if (ret <= 0)
+         return ret;
+
+      rarch_timeline_begin("crc32_calculate");
+      g_extern.content_crc = crc32_calculate(ret_buf, ret);
+   }
+   rarch_timeline_end();
 
    RARCH_LOG("CRC32: 0x%x .\n", (unsigned)g_extern.content_crc);
    *buf = ret_buf;
@@ -220,6 +339,423 @@ error:
    RARCH_WARN("Failed ... Cannot recover save file.\n");
 }
 
+/* Compressed states start with the magic and the size of the
+ * state, both little endian, followed by a zlib stream. */
+#define STATE_COMPRESSED_MAGIC       0x5a534152 /* "RASZ" */
+#define STATE_COMPRESSED_HEADER_SIZE 16
+
+enum save_job_type
+{
+   SAVE_JOB_STATE = 0,
+   SAVE_JOB_SRAM,
+   /* Metadata next to a state, see save_state_metadata(). */
+   SAVE_JOB_META,
+   /* Reads a state ahead of loading it. */
+   SAVE_JOB_PREFETCH
+};
+
+/* Saves wait in this queue for a thread to write them, so
+ * the frame does not wait on the disk. */
+struct save_job
+{
+   enum save_job_type type;
+   char path[PATH_MAX_LENGTH];
+   void *data;
+   size_t size;
+   int ram_type;
+   bool compress;
+
+   /* For SAVE_JOB_PREFETCH, under the writer lock. The thread
+    * frees a job which became stale before it was done. */
+   bool done;
+   bool stale;
+
+   struct save_job *next;
+};
+
+/* State read ahead by content_prefetch_state(). */
+static struct save_job *state_prefetch;
+
+#ifdef HAVE_THREADS
+static struct
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool quit;
+
+   struct save_job *head;
+   struct save_job *tail;
+} save_writer;
+#endif
+
+/**
+ * read_state_file:
+ * @path             : path of the state.
+ * @buf              : receives the state.
+ *
+ * Reads a state, decompressing it if it was saved compressed.
+ *
+ * Returns: size of the state, or -1 on failure.
+ **/
+static ssize_t read_state_file(const char *path, void **buf)
+{
+   uint64_t size = 0;
+   unsigned i;
+   const uint8_t *header = NULL;
+   ssize_t len = read_file(path, buf);
+
+   if (len < STATE_COMPRESSED_HEADER_SIZE)
+      return len;
+
+   header = (const uint8_t*)*buf;
+   if ((header[0] | (header[1] << 8) | (header[2] << 16) |
+            ((uint32_t)header[3] << 24)) != STATE_COMPRESSED_MAGIC)
+      return len;
+
+   for (i = 0; i < 8; i++)
+      size |= (uint64_t)header[8 + i] << (i * 8);
+
+#ifdef HAVE_ZLIB
+   {
+      uLongf out_len = (uLongf)size;
+      void *out      = malloc(size ? size : 1);
+
+      if (out && uncompress((Bytef*)out, &out_len,
+               header + STATE_COMPRESSED_HEADER_SIZE,
+               len - STATE_COMPRESSED_HEADER_SIZE) == Z_OK
+            && out_len == size)
+      {
+         free(*buf);
+         *buf = out;
+         return (ssize_t)size;
+      }
+
+      free(out);
+   }
+#endif
+
+   RARCH_ERR("Failed to decompress state \"%s\".\n", path);
+   free(*buf);
+   *buf = NULL;
+   return -1;
+}
+
+/**
+ * save_job_compress:
+ * @job              : state to compress.
+ *
+ * Replaces the data of the job with its compressed form,
+ * unless that does not come out smaller.
+ **/
+static void save_job_compress(struct save_job *job)
+{
+#ifdef HAVE_ZLIB_DEFLATE
+   unsigned i;
+   uLongf len   = compressBound(job->size);
+   uint8_t *out = (uint8_t*)malloc(STATE_COMPRESSED_HEADER_SIZE + len);
+
+   if (!out)
+      return;
+
+   if (compress2(out + STATE_COMPRESSED_HEADER_SIZE, &len,
+            (const Bytef*)job->data, job->size, Z_BEST_SPEED) != Z_OK
+         || len >= job->size)
+   {
+      free(out);
+      return;
+   }
+
+   memset(out, 0, STATE_COMPRESSED_HEADER_SIZE);
+   for (i = 0; i < 4; i++)
+      out[i]     = (STATE_COMPRESSED_MAGIC >> (i * 8)) & 0xff;
+   for (i = 0; i < 8; i++)
+      out[8 + i] = ((uint64_t)job->size >> (i * 8)) & 0xff;
+
+   free(job->data);
+   job->data = out;
+   job->size = STATE_COMPRESSED_HEADER_SIZE + len;
+#endif
+}
+
+/**
+ * save_job_prefetch:
+ * @job              : prefetch to carry out.
+ *
+ * Reads the state into the job and hands it back to the main
+ * thread, or frees it if it was dropped in the meantime.
+ **/
+static void save_job_prefetch(struct save_job *job)
+{
+   bool stale;
+   void *buf   = NULL;
+   ssize_t len = read_state_file(job->path, &buf);
+
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_lock(save_writer.lock);
+#endif
+   if (len >= 0)
+   {
+      job->data = buf;
+      job->size = len;
+   }
+   job->done = true;
+   stale     = job->stale;
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_unlock(save_writer.lock);
+#endif
+
+   if (stale)
+   {
+      free(job->data);
+      free(job);
+   }
+}
+
+/**
+ * save_job_write:
+ * @job              : save to write out.
+ *
+ * Writes out a save and frees it.
+ **/
+static void save_job_write(struct save_job *job)
+{
+   bool ret;
+
+   if (job->type == SAVE_JOB_PREFETCH)
+   {
+      save_job_prefetch(job);
+      return;
+   }
+
+   if (job->compress)
+      save_job_compress(job);
+
+   ret = write_file_safe(job->path, job->data, job->size);
+
+   if (job->type == SAVE_JOB_SRAM)
+   {
+      if (ret)
+         RARCH_LOG("Saved successfully to \"%s\".\n", job->path);
+      else
+      {
+         RARCH_ERR("Failed to save SRAM.\n");
+         RARCH_WARN("Attempting to recover ...\n");
+         dump_to_file_desperate(job->data, job->size, job->ram_type);
+      }
+   }
+   else if (!ret && job->type == SAVE_JOB_META)
+      RARCH_WARN("Failed to save state metadata to \"%s\".\n", job->path);
+   else if (!ret)
+      RARCH_ERR("Failed to save state to \"%s\".\n", job->path);
+
+   free(job->data);
+   free(job);
+}
+
+#ifdef HAVE_THREADS
+static void save_writer_thread(void *data)
+{
+   (void)data;
+
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_AUTOSAVE);
+
+   slock_lock(save_writer.lock);
+
+   for (;;)
+   {
+      struct save_job *job = save_writer.head;
+
+      if (!job)
+      {
+         if (save_writer.quit)
+            break;
+
+         scond_wait(save_writer.cond, save_writer.lock);
+         continue;
+      }
+
+      save_writer.head = job->next;
+      if (!save_writer.head)
+         save_writer.tail = NULL;
+
+      slock_unlock(save_writer.lock);
+      save_job_write(job);
+      slock_lock(save_writer.lock);
+   }
+
+   slock_unlock(save_writer.lock);
+}
+
+static bool save_writer_init(void)
+{
+   if (save_writer.thread)
+      return true;
+
+   save_writer.quit = false;
+   save_writer.lock = slock_new();
+   save_writer.cond = scond_new();
+
+   if (save_writer.lock && save_writer.cond)
+      save_writer.thread = sthread_create(save_writer_thread, NULL);
+
+   if (save_writer.thread)
+      return true;
+
+   if (save_writer.lock)
+      slock_free(save_writer.lock);
+   if (save_writer.cond)
+      scond_free(save_writer.cond);
+   save_writer.lock = NULL;
+   save_writer.cond = NULL;
+   return false;
+}
+#endif
+
+/**
+ * save_job_push:
+ * @job              : save to write out, owned by the queue
+ *                     from now on.
+ *
+ * Hands a save to the writer thread, or writes it out right
+ * away without threads.
+ **/
+static void save_job_push(struct save_job *job)
+{
+#ifdef HAVE_THREADS
+   if (save_writer_init())
+   {
+      slock_lock(save_writer.lock);
+      if (save_writer.tail)
+         save_writer.tail->next = job;
+      else
+         save_writer.head = job;
+      save_writer.tail = job;
+      scond_broadcast(save_writer.cond);
+      slock_unlock(save_writer.lock);
+      return;
+   }
+#endif
+
+   save_job_write(job);
+}
+
+/**
+ * save_job_new:
+ * @path             : path the save shall be written to.
+ * @size             : size of the save.
+ *
+ * Returns: new save job with room for @size bytes of data,
+ * or NULL if out of memory.
+ **/
+static struct save_job *save_job_new(const char *path, size_t size)
+{
+   struct save_job *job = (struct save_job*)calloc(1, sizeof(*job));
+   if (!job)
+      return NULL;
+
+   job->data = size ? malloc(size) : NULL;
+   if (size && !job->data)
+   {
+      free(job);
+      return NULL;
+   }
+
+   strlcpy(job->path, path, sizeof(job->path));
+   job->size = size;
+   return job;
+}
+
+/**
+ * content_flush_saves:
+ *
+ * Waits until all saves are written out and stops the
+ * writer thread.
+ **/
+void content_flush_saves(void)
+{
+#ifdef HAVE_THREADS
+   if (!save_writer.thread)
+      return;
+
+   slock_lock(save_writer.lock);
+   save_writer.quit = true;
+   scond_broadcast(save_writer.cond);
+   slock_unlock(save_writer.lock);
+
+   sthread_join(save_writer.thread);
+   slock_free(save_writer.lock);
+   scond_free(save_writer.cond);
+   memset(&save_writer, 0, sizeof(save_writer));
+#endif
+}
+
+/**
+ * state_prefetch_drop:
+ *
+ * Lets go of the state read ahead, if any.
+ **/
+static void state_prefetch_drop(void)
+{
+   struct save_job *job = state_prefetch;
+   bool done = true;
+
+   if (!job)
+      return;
+
+   state_prefetch = NULL;
+
+#ifdef HAVE_THREADS
+   if (save_writer.thread)
+   {
+      slock_lock(save_writer.lock);
+      done       = job->done;
+      job->stale = !done;
+      slock_unlock(save_writer.lock);
+   }
+#endif
+
+   if (done)
+   {
+      free(job->data);
+      free(job);
+   }
+}
+
+/**
+ * content_prefetch_state:
+ * @path             : path of the state, or NULL to drop
+ *                     the state read ahead.
+ *
+ * Reads and decompresses a state on the writer thread, for
+ * load_state() to pick up if it gets to load the same state.
+ **/
+void content_prefetch_state(const char *path)
+{
+#ifdef HAVE_THREADS
+   struct save_job *job = NULL;
+
+   if (path && state_prefetch && !strcmp(state_prefetch->path, path))
+      return;
+
+   state_prefetch_drop();
+
+   if (!path || !path_file_exists(path))
+      return;
+
+   if (!(job = save_job_new(path, 0)))
+      return;
+
+   job->type      = SAVE_JOB_PREFETCH;
+   state_prefetch = job;
+   save_job_push(job);
+#else
+   (void)path;
+#endif
+}
+
 struct sram_block
 {
    unsigned type;
@@ -227,18 +763,60 @@ struct sram_block
    size_t size;
 };
 
+/**
+ * save_state_metadata:
+ * @path      : path of the saved state.
+ * @size      : size of the state.
+ *
+ * Queues "<path>.meta", which tells what the state belongs
+ * to without loading it, in config file format.
+ **/
+static void save_state_metadata(const char *path, size_t size)
+{
+   char meta_path[PATH_MAX_LENGTH], buf[PATH_MAX_LENGTH * 2];
+   struct save_job *job = NULL;
+   const char *name     = g_extern.system.info.library_name;
+   const char *version  = g_extern.system.info.library_version;
+   int len;
+
+   len = snprintf(buf, sizeof(buf),
+         "core_name = \"%s\"\n"
+         "core_version = \"%s\"\n"
+         "content_path = \"%s\"\n"
+         "content_crc = \"0x%08x\"\n"
+         "state_size = \"%u\"\n"
+         "frame_count = \"%u\"\n"
+         "time = \"%lld\"\n",
+         name ? name : "", version ? version : "",
+         g_extern.fullpath, (unsigned)g_extern.content_crc,
+         (unsigned)size, g_extern.frame_count,
+         (long long)time(NULL));
+
+   if (len <= 0 || len >= (int)sizeof(buf))
+      return;
+
+   snprintf(meta_path, sizeof(meta_path), "%s.meta", path);
+
+   if (!(job = save_job_new(meta_path, len)))
+      return;
+
+   memcpy(job->data, buf, len);
+   job->type = SAVE_JOB_META;
+   save_job_push(job);
+}
+
 /**
  * save_state:
  * @path      : path of saved state that shall be written to.
  *
- * Save a state from memory to disk.
+ * Save a state from memory to disk. The state is written out
+ * by a thread, failing to write it is only logged.
  *
  * Returns: true if successful, false otherwise.
  **/
 bool save_state(const char *path)
 {
-   bool ret = false;
-   void *data = NULL;
+   struct save_job *job = NULL;
    size_t size = pretro_serialize_size();
 
    RARCH_LOG("Saving state: \"%s\".\n", path);
@@ -246,26 +824,34 @@ bool save_state(const char *path)
    if (size == 0)
       return false;
 
-   data = malloc(size);
+   /* Whatever was read ahead is about to be out of date. */
+   if (state_prefetch && !strcmp(state_prefetch->path, path))
+      state_prefetch_drop();
 
-   if (!data)
+   job = save_job_new(path, size);
+
+   if (!job)
    {
       RARCH_ERR("Failed to allocate memory for save state buffer.\n");
       return false;
    }
 
    RARCH_LOG("State size: %d bytes.\n", (int)size);
-   ret = pretro_serialize(data, size);
-
-   if (ret)
-      ret = write_file(path, data, size);
 
-   if (!ret)
+   if (!pretro_serialize(job->data, size))
+   {
       RARCH_ERR("Failed to save state to \"%s\".\n", path);
+      free(job->data);
+      free(job);
+      return false;
+   }
 
-   free(data);
+   job->compress = g_settings.savestate_compression;
+   save_job_push(job);
 
-   return ret;
+   if (g_settings.savestate_thumbnail_enable)
+      save_state_metadata(path, size);
+   return true;
 }
 
 /**
@@ -283,8 +869,21 @@ bool load_state(const char *path)
    bool ret = true;
    void *buf = NULL;
    struct sram_block *blocks = NULL;
+   ssize_t size = -1;
+
+   /* The state might still be on its way to the disk. */
+   content_flush_saves();
+
+   if (state_prefetch && !strcmp(state_prefetch->path, path))
+   {
+      buf  = state_prefetch->data;
+      size = state_prefetch->size;
+      state_prefetch->data = NULL;
+   }
+   state_prefetch_drop();
 
-   ssize_t size = read_file(path, &buf);
+   if (!buf)
+      size = read_state_file(path, &buf);
 
    RARCH_LOG("Loading state: \"%s\".\n", path);
 
@@ -366,6 +965,11 @@ void load_ram_file(const char *path, int type)
    if (size == 0 || !data)
       return;
 
+   content_flush_saves();
+#ifdef HAVE_THREADS
+   autosave_recover(path);
+#endif
+
    rc = read_file(path, &buf);
 
    if (rc > 0)
@@ -390,11 +994,13 @@ void load_ram_file(const char *path, int type)
  *
  * Save a RAM state from memory to disk.
  *
- * In case the file could not be written to, a fallback function
+ * The file is written by a thread, see save_job_write(). In
+ * case it could not be written to, a fallback function
  * 'dump_to_file_desperate' will be called.
  */
 void save_ram_file(const char *path, int type)
 {
+   struct save_job *job = NULL;
    size_t size = pretro_get_memory_size(type);
    void *data  = pretro_get_memory_data(type);
 
@@ -403,15 +1009,19 @@ void save_ram_file(const char *path, int type)
    if (size <= 0)
       return;
 
-   if (write_file(path, data, size))
+   job = save_job_new(path, size);
+   if (!job)
    {
-      RARCH_LOG("Saved successfully to \"%s\".\n", path);
+      RARCH_ERR("Failed to save SRAM.\n");
+      RARCH_WARN("Attempting to recover ...\n");
+      dump_to_file_desperate(data, size, type);
       return;
    }
 
-   RARCH_ERR("Failed to save SRAM.\n");
-   RARCH_WARN("Attempting to recover ...\n");
-   dump_to_file_desperate(data, size, type);
+   memcpy(job->data, data, size);
+   job->type     = SAVE_JOB_SRAM;
+   job->ram_type = type;
+   save_job_push(job);
 }
 
 /**
@@ -431,10 +1041,14 @@ static bool load_content(const struct retro_subsystem_info *special,
    struct string_list* additional_path_allocs = string_list_new();
    struct retro_game_info *info = (struct retro_game_info*)
       calloc(content->size, sizeof(*info));
+   /* Mapping sizes, see read_content_data(). */
+   long *map_sizes = (long*)calloc(content->size, sizeof(*map_sizes));
 
-   if (!info)
+   if (!info || !map_sizes)
    {
       string_list_free(additional_path_allocs);
+      free(info);
+      free(map_sizes);
       return false;
    }
 
@@ -462,8 +1076,8 @@ static bool load_content(const struct retro_subsystem_info *special,
          /* First content file is significant, attempt to do patching,
           * CRC checking, etc. */
          long size = (i == 0) ?
-            read_content_file(path, (void**)&info[i].data) :
-            read_file(path, (void**)&info[i].data);
+            read_content_file(path, (void**)&info[i].data, &map_sizes[i]) :
+            read_content_data(path, (void**)&info[i].data, &map_sizes[i]);
 
          if (size < 0)
          {
@@ -507,7 +1121,9 @@ static bool load_content(const struct retro_subsystem_info *special,
                attributes.i = 0;
                fill_pathname_join(new_path, new_basedir,
                      path_basename(path), sizeof(new_path));
+               rarch_timeline_begin("read_compressed_file");
                read_compressed_file(path,NULL,new_path);
+               rarch_timeline_end();
                string_list_append(additional_path_allocs,new_path, attributes);
                info[i].path =
                   additional_path_allocs->elems
@@ -526,19 +1142,25 @@ static bool load_content(const struct retro_subsystem_info *special,
       }
    }
 
+   rarch_timeline_begin("retro_load_game");
    if (special)
       ret = pretro_load_game_special(special->id, info, content->size);
    else
       ret = pretro_load_game(*content->elems[0].data ? info : NULL);
+   rarch_timeline_end();
 
    if (!ret)
       RARCH_ERR("Failed to load content.\n");
+   else
+      runahead_secondary_init(special,
+            *content->elems[0].data ? info : NULL, content->size);
 
 end:
    for (i = 0; i < content->size; i++)
-      free((void*)info[i].data);
+      free_content_data((void*)info[i].data, map_sizes[i]);
 
    string_list_free(additional_path_allocs);
+   free(map_sizes);
    if (info)
       free(info);
    return ret;
@@ -649,14 +1271,41 @@ bool init_content_file(void)
       if (ext && !strcasecmp(ext, "zip"))
       {
          char temporary_content[PATH_MAX_LENGTH];
+         bool extracted;
 
          strlcpy(temporary_content, content->elems[i].data,
                sizeof(temporary_content));
 
-         if (!zlib_extract_first_content_file(temporary_content,
-                  sizeof(temporary_content), valid_ext,
-                  *g_settings.extraction_directory ?
-                  g_settings.extraction_directory : NULL))
+         /* Cores that take a buffer get the content inflated
+          * into memory by load_content(), only cores which need
+          * a path get a temporary file. */
+         if (!(content->elems[i].attr.i & 2))
+         {
+            bool found;
+
+            rarch_timeline_begin("zlib_get_first_content_path");
+            found = zlib_get_first_content_path(temporary_content,
+                  sizeof(temporary_content), valid_ext);
+            rarch_timeline_end();
+
+            if (!found)
+            {
+               RARCH_ERR("Failed to find content in zipped file: %s.\n",
+                     temporary_content);
+               goto error;
+            }
+            string_list_set(content, i, temporary_content);
+            continue;
+         }
+
+         rarch_timeline_begin("zlib_extract_first_content_file");
+         extracted = zlib_extract_first_content_file(temporary_content,
+               sizeof(temporary_content), valid_ext,
+               *g_settings.extraction_directory ?
+               g_settings.extraction_directory : NULL);
+         rarch_timeline_end();
+
+         if (!extracted)
          {
             RARCH_ERR("Failed to extract content from zipped file: %s.\n",
                   temporary_content);
@@ -670,9 +1319,17 @@ bool init_content_file(void)
 #endif
 
    /* Set attr to need_fullpath as appropriate. */
+   rarch_timeline_begin("load_content");
    ret = load_content(special, content);
+   rarch_timeline_end();
 
 error:
+#ifdef HAVE_7ZIP
+   /* Blocks kept for reading several files out of one archive
+    * are of no more use once the content is loaded. */
+   compressed_7zip_cache_free();
+#endif
+
    g_extern.content_is_init = (ret) ? true : false;
 
    if (content)
@@ -43,7 +43,8 @@ bool load_state(const char *path);
  * save_state:
  * @path      : path of saved state that shall be written to.
  *
- * Save a state from memory to disk.
+ * Save a state from memory to disk. The state is written out
+ * by a thread, failing to write it is only logged.
  *
  * Returns: true if successful, false otherwise.
  **/
@@ -65,11 +66,31 @@ void load_ram_file(const char *path, int type);
  *
  * Save a RAM state from memory to disk.
  *
- * In case the file could not be written to, a fallback function
- * 'dump_to_file_desperate' will be called.
+ * The file is written by a thread. In case it could not be
+ * written to, a fallback function 'dump_to_file_desperate'
+ * will be called.
  */
 void save_ram_file(const char *path, int type);
 
+/**
+ * content_flush_saves:
+ *
+ * Waits until all saves are written out. Every save goes to a
+ * temporary file first which then replaces the old file, so a
+ * crash in between leaves the old save in place.
+ */
+void content_flush_saves(void);
+
+/**
+ * content_prefetch_state:
+ * @path             : path of the state, or NULL to drop
+ *                     the state read ahead.
+ *
+ * Reads and decompresses a state in the background, so that
+ * loading it right after does not wait on the disk.
+ */
+void content_prefetch_state(const char *path);
+
 /**
  * init_content_file:
  *
@@ -0,0 +1,870 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <file/dir_list.h>
+#include <file/file_path.h>
+#include <string/string_list.h>
+
+#include "content_scan.h"
+#include "file_ops.h"
+#include "file_extract.h"
+#include "hash.h"
+#include "general.h"
+#include "playlist.h"
+#include "retroarch.h"
+#include "rarchdb/rarchdb.h"
+
+/* Scanned playlists hold however many entries they get,
+ * up to this. */
+#define CONTENT_SCAN_PLAYLIST_MAX 65536
+
+#define CONTENT_SCAN_SHA1_SIZE 20
+
+/* Hashes of the files scanned last time, next to the playlists. */
+#define CONTENT_SCAN_CACHE_NAME "content_scan.cache"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+struct content_scan_file
+{
+   /* Plain path, or "archive.zip#file" for files in archives. */
+   char *path;
+   uint32_t crc;
+   uint8_t sha1[CONTENT_SCAN_SHA1_SIZE];
+   bool in_archive;
+   bool hashed;
+   /* Index into content_scan_state::databases, -1 if no match. */
+   int database;
+
+   /* What goes in the scan cache, for loose files. */
+   uint64_t size;
+   int64_t mtime;
+   bool has_crc;
+   bool has_sha1;
+};
+
+struct content_scan_cached
+{
+   char *path;
+   uint64_t size;
+   int64_t mtime;
+   uint32_t crc;
+   uint8_t sha1[CONTENT_SCAN_SHA1_SIZE];
+   bool has_sha1;
+};
+
+struct content_scan_database
+{
+   char path[PATH_MAX_LENGTH];
+   struct rarchdb db;
+   struct rarchdb_lookup crc;
+   struct rarchdb_lookup sha1;
+   bool has_crc;
+   bool has_sha1;
+   unsigned matches;
+};
+
+struct content_scan_state
+{
+   struct content_scan_file *files;
+   size_t count;
+   size_t cap;
+
+   struct content_scan_database *databases;
+   size_t num_databases;
+
+   /* Sorted by path. */
+   struct content_scan_cached *cache;
+   size_t cache_count;
+};
+
+static bool content_scan_add(struct content_scan_state *state,
+      const char *path, bool in_archive, uint32_t crc)
+{
+   struct content_scan_file *file = NULL;
+
+   if (state->count == state->cap)
+   {
+      size_t cap = state->cap ? state->cap * 2 : 256;
+      struct content_scan_file *files = (struct content_scan_file*)
+         realloc(state->files, cap * sizeof(*files));
+
+      if (!files)
+         return false;
+
+      state->files = files;
+      state->cap   = cap;
+   }
+
+   file = &state->files[state->count];
+   memset(file, 0, sizeof(*file));
+
+   file->path = strdup(path);
+   if (!file->path)
+      return false;
+
+   /* The central directory already has the CRC of archived files. */
+   file->in_archive = in_archive;
+   file->hashed     = in_archive;
+   file->crc        = crc;
+   file->database   = -1;
+
+   state->count++;
+   return true;
+}
+
+#ifdef HAVE_ZLIB
+struct content_scan_zip
+{
+   struct content_scan_state *state;
+   const char *archive;
+   bool ok;
+};
+
+static bool content_scan_zip_cb(const char *name, uint32_t size,
+      uint32_t crc32, void *userdata)
+{
+   char path[PATH_MAX_LENGTH];
+   struct content_scan_zip *zip = (struct content_scan_zip*)userdata;
+   size_t len = strlen(name);
+
+   /* Skips directories and empty files. */
+   if (!len || name[len - 1] == '/' || name[len - 1] == '\\' || !size)
+      return true;
+
+   snprintf(path, sizeof(path), "%s#%s", zip->archive, name);
+   zip->ok = content_scan_add(zip->state, path, true, crc32);
+   return zip->ok;
+}
+#endif
+
+static bool content_scan_walk(struct content_scan_state *state,
+      const char *dir)
+{
+   size_t i;
+   bool ret = true;
+   struct string_list *list = dir_list_new(dir, NULL, true);
+
+   if (!list)
+   {
+      RARCH_WARN("Could not open directory \"%s\".\n", dir);
+      return true;
+   }
+
+   for (i = 0; i < list->size && ret; i++)
+   {
+      const char *path = list->elems[i].data;
+
+      switch (list->elems[i].attr.i)
+      {
+         case RARCH_DIRECTORY:
+            ret = content_scan_walk(state, path);
+            break;
+         case RARCH_COMPRESSED_ARCHIVE:
+#ifdef HAVE_ZLIB
+            if (!strcasecmp(path_get_extension(path), "zip"))
+            {
+               struct content_scan_zip zip;
+
+               zip.state   = state;
+               zip.archive = path;
+               zip.ok      = true;
+
+               /* Unreadable archives are hashed as plain files. */
+               if (zlib_index_foreach(path, content_scan_zip_cb, &zip))
+               {
+                  ret = zip.ok;
+                  break;
+               }
+            }
+#endif
+            ret = content_scan_add(state, path, false, 0);
+            break;
+         default:
+            ret = content_scan_add(state, path, false, 0);
+            break;
+      }
+   }
+
+   dir_list_free(list);
+   return ret;
+}
+
+static int content_scan_cached_compare(const void *a, const void *b)
+{
+   return strcmp(((const struct content_scan_cached*)a)->path,
+         ((const struct content_scan_cached*)b)->path);
+}
+
+static const struct rmsgpack_dom_value *content_scan_cache_field(
+      const struct rmsgpack_dom_value *item, const char *name,
+      enum rmsgpack_dom_type type)
+{
+   struct rmsgpack_dom_value key;
+   const struct rmsgpack_dom_value *value;
+
+   key.type        = RDT_STRING;
+   key.string.len  = strlen(name);
+   key.string.buff = (char*)name;
+
+   value = rmsgpack_dom_value_map_value(item, &key);
+
+   /* Small integers come back unsigned, whatever they went in as. */
+   if (value && type == RDT_INT && value->type == RDT_UINT)
+      return value;
+   return value && value->type == type ? value : NULL;
+}
+
+/**
+ * content_scan_cache_load:
+ * @state                : scan to load the cache for.
+ * @cache_path           : path of the cache written by the
+ *                         last scan.
+ *
+ * A missing or unreadable cache just means hashing everything.
+ **/
+static void content_scan_cache_load(struct content_scan_state *state,
+      const char *cache_path)
+{
+   size_t cap = 0;
+   struct rarchdb db;
+   struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_arena arena;
+
+   if (!path_file_exists(cache_path) || rarchdb_open(cache_path, &db) != 0)
+      return;
+
+   rmsgpack_dom_arena_init(&arena);
+
+   while (rarchdb_read_item_view(&db, &arena, &item) == 0)
+   {
+      struct content_scan_cached *cached = NULL;
+      const struct rmsgpack_dom_value *path, *size, *mtime, *crc, *sha1;
+
+      path  = content_scan_cache_field(&item, "path", RDT_STRING);
+      size  = content_scan_cache_field(&item, "size", RDT_UINT);
+      mtime = content_scan_cache_field(&item, "mtime", RDT_INT);
+      crc   = content_scan_cache_field(&item, "crc", RDT_BINARY);
+      sha1  = content_scan_cache_field(&item, "sha1", RDT_BINARY);
+
+      rmsgpack_dom_arena_reset(&arena);
+
+      if (!path || !size || !mtime || !crc || crc->binary.len != 4
+            || (sha1 && sha1->binary.len != CONTENT_SCAN_SHA1_SIZE))
+         continue;
+
+      if (state->cache_count == cap)
+      {
+         size_t new_cap = cap ? cap * 2 : 256;
+         struct content_scan_cached *entries = (struct content_scan_cached*)
+            realloc(state->cache, new_cap * sizeof(*entries));
+
+         if (!entries)
+            break;
+
+         state->cache = entries;
+         cap          = new_cap;
+      }
+
+      cached = &state->cache[state->cache_count];
+      cached->path = (char*)malloc(path->string.len + 1);
+      if (!cached->path)
+         break;
+
+      memcpy(cached->path, path->string.buff, path->string.len);
+      cached->path[path->string.len] = '\0';
+      cached->size     = size->uint_;
+      cached->mtime    = mtime->int_;
+      cached->crc      = ((uint32_t)(uint8_t)crc->binary.buff[0] << 24)
+         | ((uint32_t)(uint8_t)crc->binary.buff[1] << 16)
+         | ((uint32_t)(uint8_t)crc->binary.buff[2] <<  8)
+         | ((uint32_t)(uint8_t)crc->binary.buff[3] <<  0);
+      cached->has_sha1 = sha1 != NULL;
+      if (sha1)
+         memcpy(cached->sha1, sha1->binary.buff, CONTENT_SCAN_SHA1_SIZE);
+
+      state->cache_count++;
+   }
+
+   rmsgpack_dom_arena_free(&arena);
+   rarchdb_close(&db);
+
+   qsort(state->cache, state->cache_count, sizeof(*state->cache),
+         content_scan_cached_compare);
+}
+
+static const struct content_scan_cached *content_scan_cache_find(
+      const struct content_scan_state *state,
+      const struct content_scan_file *file)
+{
+   struct content_scan_cached key;
+   const struct content_scan_cached *cached = NULL;
+
+   if (!state->cache_count)
+      return NULL;
+
+   key.path = file->path;
+   cached = (const struct content_scan_cached*)bsearch(&key, state->cache,
+         state->cache_count, sizeof(*state->cache),
+         content_scan_cached_compare);
+
+   if (!cached || cached->size != file->size || cached->mtime != file->mtime)
+      return NULL;
+   return cached;
+}
+
+struct content_scan_cache_writer
+{
+   const struct content_scan_state *state;
+   const char *dir;
+   size_t dir_len;
+   size_t file;
+   size_t cached;
+};
+
+static bool content_scan_cache_string(struct rmsgpack_dom_value *value,
+      const char *s)
+{
+   value->type        = RDT_STRING;
+   value->string.len  = strlen(s);
+   value->string.buff = strdup(s);
+   return value->string.buff != NULL;
+}
+
+static bool content_scan_cache_binary(struct rmsgpack_dom_value *value,
+      const void *data, uint32_t len)
+{
+   value->type        = RDT_BINARY;
+   value->binary.len  = len;
+   value->binary.buff = (char*)malloc(len);
+   if (!value->binary.buff)
+      return false;
+   memcpy(value->binary.buff, data, len);
+   return true;
+}
+
+static int content_scan_cache_item(struct rmsgpack_dom_value *out,
+      const char *path, uint64_t size, int64_t mtime, uint32_t crc,
+      const uint8_t *sha1)
+{
+   uint8_t crc_be[4];
+   struct rmsgpack_dom_pair *pairs = (struct rmsgpack_dom_pair*)
+      calloc(5, sizeof(*pairs));
+
+   out->type      = RDT_MAP;
+   out->map.len   = sha1 ? 5 : 4;
+   out->map.items = pairs;
+   if (!pairs)
+      return -ENOMEM;
+
+   crc_be[0] = crc >> 24;
+   crc_be[1] = crc >> 16;
+   crc_be[2] = crc >>  8;
+   crc_be[3] = crc >>  0;
+
+   pairs[1].value.type  = RDT_UINT;
+   pairs[1].value.uint_ = size;
+   pairs[2].value.type  = RDT_INT;
+   pairs[2].value.int_  = mtime;
+
+   if (!content_scan_cache_string(&pairs[0].key, "path")
+         || !content_scan_cache_string(&pairs[0].value, path)
+         || !content_scan_cache_string(&pairs[1].key, "size")
+         || !content_scan_cache_string(&pairs[2].key, "mtime")
+         || !content_scan_cache_string(&pairs[3].key, "crc")
+         || !content_scan_cache_binary(&pairs[3].value, crc_be, 4)
+         || (sha1 && (!content_scan_cache_string(&pairs[4].key, "sha1")
+               || !content_scan_cache_binary(&pairs[4].value, sha1,
+                  CONTENT_SCAN_SHA1_SIZE))))
+      goto error;
+
+   return 0;
+
+error:
+   /* Pairs not filled in yet are nil, which frees to nothing. */
+   out->map.len = 5;
+   rmsgpack_dom_value_free(out);
+   return -ENOMEM;
+}
+
+static bool content_scan_in_dir(const char *path, const char *dir,
+      size_t dir_len)
+{
+   if (!dir_len || strncmp(path, dir, dir_len))
+      return false;
+
+   return dir[dir_len - 1] == '/' || dir[dir_len - 1] == '\\'
+      || path[dir_len] == '/' || path[dir_len] == '\\';
+}
+
+/* Files of this scan first, then what the cache has from outside
+ * @dir. What was under @dir but is gone now is dropped. */
+static int content_scan_cache_next(void *ctx, struct rmsgpack_dom_value *out)
+{
+   struct content_scan_cache_writer *writer =
+      (struct content_scan_cache_writer*)ctx;
+   const struct content_scan_state *state = writer->state;
+
+   for (; writer->file < state->count; writer->file++)
+   {
+      const struct content_scan_file *file = &state->files[writer->file];
+
+      if (file->in_archive || !file->has_crc)
+         continue;
+
+      writer->file++;
+      return content_scan_cache_item(out, file->path, file->size,
+            file->mtime, file->crc, file->has_sha1 ? file->sha1 : NULL);
+   }
+
+   for (; writer->cached < state->cache_count; writer->cached++)
+   {
+      const struct content_scan_cached *cached =
+         &state->cache[writer->cached];
+
+      if (content_scan_in_dir(cached->path, writer->dir, writer->dir_len))
+         continue;
+
+      writer->cached++;
+      return content_scan_cache_item(out, cached->path, cached->size,
+            cached->mtime, cached->crc,
+            cached->has_sha1 ? cached->sha1 : NULL);
+   }
+
+   return 1;
+}
+
+/**
+ * content_scan_cache_save:
+ * @state                : finished scan.
+ * @dir                  : directory that was scanned.
+ * @cache_path           : path to write the cache to.
+ *
+ * Writes to a temporary file first, so that a failed write
+ * does not lose the cache as it was.
+ **/
+static void content_scan_cache_save(const struct content_scan_state *state,
+      const char *dir, const char *cache_path)
+{
+   int fd, rv;
+   char tmp_path[PATH_MAX_LENGTH];
+   struct content_scan_cache_writer writer = {0};
+
+   writer.state   = state;
+   writer.dir     = dir;
+   writer.dir_len = strlen(dir);
+
+   /* A cut short name would be renamed over the wrong file. */
+   if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path)
+         >= (int)sizeof(tmp_path))
+   {
+      RARCH_WARN("Could not write scan cache \"%s\".\n", cache_path);
+      return;
+   }
+
+   fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+   if (fd < 0)
+   {
+      RARCH_WARN("Could not write scan cache \"%s\".\n", tmp_path);
+      return;
+   }
+
+   rv = rarchdb_create(fd, content_scan_cache_next, &writer);
+   if (close(fd) != 0)
+      rv = -1;
+
+   remove(cache_path);
+   if (rv < 0 || rename(tmp_path, cache_path) != 0)
+   {
+      RARCH_WARN("Could not write scan cache \"%s\".\n", cache_path);
+      remove(tmp_path);
+   }
+}
+
+static void content_scan_hash_crc(void *userdata, unsigned index)
+{
+   long size;
+   void *data = NULL;
+   struct stat st;
+   const struct content_scan_cached *cached = NULL;
+   struct content_scan_state *state = (struct content_scan_state*)userdata;
+   struct content_scan_file *file = &state->files[index];
+
+   if (file->hashed)
+      return;
+
+   if (stat(file->path, &st) != 0)
+      return;
+
+   file->size  = st.st_size;
+   file->mtime = st.st_mtime;
+
+   /* Same size and time as last scan, taken to be the same file. */
+   cached = content_scan_cache_find(state, file);
+   if (cached)
+   {
+      file->crc      = cached->crc;
+      file->hashed   = true;
+      file->has_crc  = true;
+      file->has_sha1 = cached->has_sha1;
+      memcpy(file->sha1, cached->sha1, sizeof(file->sha1));
+      return;
+   }
+
+#ifdef HAVE_MMAP
+   size = map_file(file->path, &data);
+   if (size > 0)
+   {
+      file->crc     = crc32_calculate((const uint8_t*)data, size);
+      file->hashed  = true;
+      file->has_crc = true;
+      unmap_file(data, size);
+      return;
+   }
+#endif
+
+   size = read_file(file->path, &data);
+   if (size > 0)
+   {
+      file->crc     = crc32_calculate((const uint8_t*)data, size);
+      file->hashed  = true;
+      file->has_crc = true;
+   }
+   free(data);
+}
+
+static unsigned content_scan_hex(char c)
+{
+   if (c >= 'a')
+      return c - 'a' + 10;
+   if (c >= 'A')
+      return c - 'A' + 10;
+   return c - '0';
+}
+
+static void content_scan_hash_sha1(void *userdata, unsigned index)
+{
+   unsigned i;
+   char hex[CONTENT_SCAN_SHA1_SIZE * 2 + 1];
+   struct content_scan_file *file =
+      &((struct content_scan_state*)userdata)->files[index];
+
+   file->hashed = false;
+
+   /* Only loose files that matched nothing by CRC. */
+   if (file->in_archive || file->database >= 0)
+      return;
+
+   /* Taken from the scan cache, or by an earlier scan. */
+   if (file->has_sha1)
+   {
+      file->hashed = true;
+      return;
+   }
+
+   if (sha1_calculate(file->path, hex) != 0)
+      return;
+
+   for (i = 0; i < CONTENT_SCAN_SHA1_SIZE; i++)
+      file->sha1[i] = (content_scan_hex(hex[i * 2]) << 4)
+         | content_scan_hex(hex[i * 2 + 1]);
+   file->hashed   = true;
+   file->has_sha1 = true;
+}
+
+/**
+ * content_scan_hash:
+ *
+ * Runs @func over all files, on the thread pool where there
+ * is one. Every call only writes the file it is given.
+ **/
+static void content_scan_hash(struct content_scan_state *state,
+      void (*func)(void *userdata, unsigned index))
+{
+#ifdef HAVE_THREADS
+   sthread_pool_t *pool = rarch_get_thread_pool();
+
+   if (pool)
+   {
+      sthread_pool_parallel_for(pool, state->count, func, state);
+      return;
+   }
+#endif
+
+   {
+      size_t i;
+      for (i = 0; i < state->count; i++)
+         func(state, i);
+   }
+}
+
+static bool content_scan_open_databases(struct content_scan_state *state,
+      const char *database_dir)
+{
+   size_t i;
+   struct string_list *list = dir_list_new(database_dir, "rdb", false);
+
+   if (!list || !list->size)
+   {
+      RARCH_ERR("No databases found in \"%s\".\n", database_dir);
+      dir_list_free(list);
+      return false;
+   }
+
+   state->databases = (struct content_scan_database*)
+      calloc(list->size, sizeof(*state->databases));
+   if (!state->databases)
+   {
+      dir_list_free(list);
+      return false;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct content_scan_database *database =
+         &state->databases[state->num_databases];
+      const char *path = list->elems[i].data;
+
+      if (rarchdb_open(path, &database->db) != 0)
+      {
+         RARCH_WARN("Could not open database \"%s\".\n", path);
+         continue;
+      }
+
+      /* Indexes are read once, not for every lookup. */
+      database->has_crc  = rarchdb_lookup_open(&database->db,
+            "crc", &database->crc) == 0;
+      database->has_sha1 = rarchdb_lookup_open(&database->db,
+            "sha1", &database->sha1) == 0;
+
+      if (database->has_crc && database->crc.key_size != sizeof(uint32_t))
+      {
+         rarchdb_lookup_close(&database->crc);
+         database->has_crc = false;
+      }
+
+      if (database->has_sha1
+            && database->sha1.key_size != CONTENT_SCAN_SHA1_SIZE)
+      {
+         rarchdb_lookup_close(&database->sha1);
+         database->has_sha1 = false;
+      }
+
+      if (!database->has_crc && !database->has_sha1)
+      {
+         RARCH_WARN("Database \"%s\" has no crc or sha1 index.\n", path);
+         rarchdb_close(&database->db);
+         continue;
+      }
+
+      strlcpy(database->path, path, sizeof(database->path));
+      state->num_databases++;
+   }
+
+   dir_list_free(list);
+   return state->num_databases > 0;
+}
+
+static void content_scan_match(struct content_scan_state *state, bool sha1)
+{
+   size_t i, j;
+
+   for (i = 0; i < state->count; i++)
+   {
+      uint8_t crc[4];
+      struct content_scan_file *file = &state->files[i];
+
+      if (!file->hashed || file->database >= 0)
+         continue;
+
+      /* Indexes hold the CRC as it is written in DATs. */
+      crc[0] = file->crc >> 24;
+      crc[1] = file->crc >> 16;
+      crc[2] = file->crc >>  8;
+      crc[3] = file->crc >>  0;
+
+      for (j = 0; j < state->num_databases; j++)
+      {
+         uint64_t offset;
+         struct content_scan_database *database = &state->databases[j];
+         bool found = sha1 ?
+            database->has_sha1 &&
+            rarchdb_lookup_find(&database->sha1, file->sha1, &offset) == 0 :
+            database->has_crc &&
+            rarchdb_lookup_find(&database->crc, crc, &offset) == 0;
+
+         if (found)
+         {
+            file->database = j;
+            database->matches++;
+            break;
+         }
+      }
+   }
+}
+
+static void content_scan_write_playlists(struct content_scan_state *state,
+      const char *playlist_dir)
+{
+   size_t i, j;
+
+   for (i = 0; i < state->num_databases; i++)
+   {
+      char name[PATH_MAX_LENGTH], path[PATH_MAX_LENGTH];
+      content_playlist_t *playlist = NULL;
+      struct content_scan_database *database = &state->databases[i];
+
+      if (!database->matches)
+         continue;
+
+      fill_pathname_base(name, database->path, sizeof(name));
+      path_remove_extension(name);
+      strlcat(name, ".rpl", sizeof(name));
+      fill_pathname_join(path, playlist_dir, name, sizeof(path));
+
+      playlist = content_playlist_init(path, CONTENT_SCAN_PLAYLIST_MAX);
+      if (!playlist)
+         continue;
+
+      /* Pushed last to first, so that the playlist ends up in
+       * the order the files were found in. Which core runs them
+       * is left to be detected when they are loaded. */
+      for (j = state->count; j-- > 0; )
+      {
+         if (state->files[j].database == (int)i)
+            content_playlist_push(playlist, state->files[j].path,
+                  "DETECT", "DETECT");
+      }
+
+      RARCH_LOG("Matched %u files against \"%s\", playlist: %s.\n",
+            database->matches, database->path, path);
+
+      content_playlist_free(playlist);
+   }
+}
+
+/**
+ * content_scan_directory:
+ * @dir                  : directory to scan, including subdirectories.
+ * @database_dir         : directory of the .rdb databases to match
+ *                         content against.
+ * @playlist_dir         : directory to write the playlists to.
+ *
+ * Hashes every file under @dir, and every file inside the ZIP
+ * archives there, and looks the hashes up in the crc and sha1
+ * indexes of each database. Files are hashed in parallel, on
+ * the thread pool. Lookups go to indexes read into memory once.
+ *
+ * Hashes are kept in a scan cache in @playlist_dir, so files
+ * with the same size and modification time as last scan are not
+ * hashed again. Matches are looked up again every scan, the
+ * databases may have changed since.
+ *
+ * Returns: number of content files matched, -1 on error.
+ **/
+int content_scan_directory(const char *dir, const char *database_dir,
+      const char *playlist_dir)
+{
+   size_t i;
+   int matches = 0;
+   bool any_sha1 = false;
+   char cache_path[PATH_MAX_LENGTH];
+   struct content_scan_state state = {0};
+
+   fill_pathname_join(cache_path, playlist_dir, CONTENT_SCAN_CACHE_NAME,
+         sizeof(cache_path));
+
+   if (!content_scan_open_databases(&state, database_dir))
+   {
+      matches = -1;
+      goto end;
+   }
+
+   if (!content_scan_walk(&state, dir))
+   {
+      RARCH_ERR("Could not list content in \"%s\".\n", dir);
+      matches = -1;
+      goto end;
+   }
+
+   RARCH_LOG("Scanning %u files in \"%s\".\n", (unsigned)state.count, dir);
+
+   content_scan_cache_load(&state, cache_path);
+   content_scan_hash(&state, content_scan_hash_crc);
+   content_scan_match(&state, false);
+
+   for (i = 0; i < state.num_databases; i++)
+      any_sha1 = any_sha1 || state.databases[i].has_sha1;
+
+   /* SHA1 is slower to take, only for what the CRC did not find. */
+   if (any_sha1)
+   {
+      content_scan_hash(&state, content_scan_hash_sha1);
+      content_scan_match(&state, true);
+   }
+
+   content_scan_write_playlists(&state, playlist_dir);
+   content_scan_cache_save(&state, dir, cache_path);
+
+   for (i = 0; i < state.num_databases; i++)
+      matches += state.databases[i].matches;
+
+end:
+   for (i = 0; i < state.num_databases; i++)
+   {
+      struct content_scan_database *database = &state.databases[i];
+
+      if (database->has_crc)
+         rarchdb_lookup_close(&database->crc);
+      if (database->has_sha1)
+         rarchdb_lookup_close(&database->sha1);
+      rarchdb_close(&database->db);
+   }
+   free(state.databases);
+
+   for (i = 0; i < state.count; i++)
+      free(state.files[i].path);
+   free(state.files);
+
+   for (i = 0; i < state.cache_count; i++)
+      free(state.cache[i].path);
+   free(state.cache);
+
+   return matches;
+}
@@ -0,0 +1,47 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_CONTENT_SCAN_H
+#define __RARCH_CONTENT_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * content_scan_directory:
+ * @dir                  : directory to scan, including subdirectories.
+ * @database_dir         : directory of the .rdb databases to match
+ *                         content against.
+ * @playlist_dir         : directory to write the playlists to.
+ *
+ * Hashes every file under @dir, and every file inside the ZIP
+ * archives there, and looks the hashes up in the crc and sha1
+ * indexes of each database. Matches are added to a playlist
+ * named after the database they were found in, which is created
+ * if it does not exist yet. Files unchanged since the last scan
+ * take their hashes from the scan cache in @playlist_dir.
+ *
+ * Returns: number of content files matched, -1 on error.
+ **/
+int content_scan_directory(const char *dir, const char *database_dir,
+      const char *playlist_dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "core_info.h"
 #include "general.h"
+#include "retroarch.h"
 #include <file/file_path.h>
 #include "file_ext.h"
 #include "file_extract.h"
@@ -27,6 +28,49 @@
 #include "config.h"
 #endif
 
+#include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "file_ops.h"
+
+static void core_info_free_info(core_info_t *info)
+{
+   size_t j;
+
+   free(info->path);
+   free(info->info_path);
+   free(info->core_name);
+   free(info->systemname);
+   free(info->system_manufacturer);
+   free(info->display_name);
+   free(info->supported_extensions);
+   free(info->authors);
+   free(info->permissions);
+   free(info->licenses);
+   free(info->categories);
+   free(info->notes);
+   if (info->supported_extensions_list)
+      string_list_free(info->supported_extensions_list);
+   string_list_free(info->authors_list);
+   string_list_free(info->note_list);
+   string_list_free(info->permissions_list);
+   string_list_free(info->licenses_list);
+   string_list_free(info->categories_list);
+   config_file_free(info->data);
+
+   if (info->firmware)
+   {
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         free(info->firmware[j].path);
+         free(info->firmware[j].desc);
+      }
+   }
+   free(info->firmware);
+}
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -59,65 +103,299 @@ static void core_info_list_resolve_all_extensions(
    }
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+/* Cache of what core_info_list_new() reads from the .info files,
+ * valid while the core and info directories are unmodified:
+ *
+ *    "RCOREINF", version, count              (8, 4, 4 bytes)
+ *    core directory mtime, info dir mtime    (8, 8 bytes)
+ *    core directory, info directory          (strings)
+ *    count times:
+ *       path, info path, display name, core name, system name,
+ *       manufacturer, supported extensions   (strings)
+ *       supports_no_game, firmware count      (1, 4 bytes)
+ *
+ * Strings are a 2 byte length followed by the bytes, with the
+ * length 0xffff for NULL. Numbers are big endian. */
+#define CORE_INFO_CACHE_NAME    "retroarch-core-info.cache"
+#define CORE_INFO_CACHE_MAGIC   "RCOREINF"
+#define CORE_INFO_CACHE_VERSION 1
+#define CORE_INFO_CACHE_NULL    0xffff
+
+typedef struct core_info_cache_reader
 {
-   size_t i;
-   unsigned c;
+   const uint8_t *data;
+   size_t size;
+   size_t pos;
+   bool error;
+} core_info_cache_reader_t;
+
+static uint64_t core_info_cache_read_be(core_info_cache_reader_t *reader,
+      unsigned bytes)
+{
+   uint64_t val = 0;
 
-   if (!core_info_list)
-      return;
+   if (reader->size - reader->pos < bytes)
+   {
+      reader->error = true;
+      return 0;
+   }
 
-   for (i = 0; i < core_info_list->count; i++)
+   while (bytes--)
+      val = (val << 8) | reader->data[reader->pos++];
+   return val;
+}
+
+static char *core_info_cache_read_string(core_info_cache_reader_t *reader)
+{
+   char *str;
+   size_t len = core_info_cache_read_be(reader, 2);
+
+   if (reader->error || len == CORE_INFO_CACHE_NULL)
+      return NULL;
+
+   if (reader->size - reader->pos < len || !(str = (char*)malloc(len + 1)))
    {
-      unsigned count = 0;
-      core_info_t *info = (core_info_t*)&core_info_list->list[i];
+      reader->error = true;
+      return NULL;
+   }
 
-      if (!info->data)
-         continue;
+   memcpy(str, reader->data + reader->pos, len);
+   str[len]     = '\0';
+   reader->pos += len;
+   return str;
+}
 
-      if (!config_get_uint(info->data, "firmware_count", &count))
-         continue;
+static void core_info_cache_write_be(FILE *file, uint64_t val,
+      unsigned bytes)
+{
+   while (bytes--)
+      fputc((int)(val >> (bytes * 8)) & 0xff, file);
+}
 
-      info->firmware = (core_info_firmware_t*)
-         calloc(count, sizeof(*info->firmware));
+static void core_info_cache_write_string(FILE *file, const char *str)
+{
+   size_t len = str ? strlen(str) : CORE_INFO_CACHE_NULL;
 
-      if (!info->firmware)
-         continue;
+   /* Longer strings are cut, nothing in a .info file
+    * comes close. */
+   if (str && len >= CORE_INFO_CACHE_NULL)
+      len = CORE_INFO_CACHE_NULL - 1;
 
-      for (c = 0; c < count; c++)
-      {
-         char path_key[64], desc_key[64], opt_key[64];
+   core_info_cache_write_be(file, len, 2);
+   if (str)
+      fwrite(str, 1, len, file);
+}
 
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key, sizeof(opt_key), "firmware%u_opt", c);
+static uint64_t core_info_dir_mtime(const char *dir)
+{
+   struct stat st;
 
-         config_get_string(info->data, path_key, &info->firmware[c].path);
-         config_get_string(info->data, desc_key, &info->firmware[c].desc);
-         config_get_bool(info->data, opt_key , &info->firmware[c].optional);
-      }
+   if (stat(dir, &st) != 0)
+      return 0;
+   return (uint64_t)st.st_mtime;
+}
+
+static bool core_info_cache_string_matches(
+      core_info_cache_reader_t *reader, const char *str)
+{
+   char *cached = core_info_cache_read_string(reader);
+   bool match   = cached && !strcmp(cached, str);
+
+   free(cached);
+   return match;
+}
+
+/**
+ * core_info_cache_load:
+ * @core_info_list       : list to fill in.
+ * @cache_path           : path of the cache.
+ * @modules_path         : directory of the cores.
+ * @info_dir             : directory of the .info files.
+ *
+ * Fills in @core_info_list from the cache, if it was written
+ * for the same directories as they are now.
+ *
+ * Returns: true if the cache was used, otherwise false and
+ * @core_info_list is left empty.
+ **/
+static bool core_info_cache_load(core_info_list_t *core_info_list,
+      const char *cache_path, const char *modules_path,
+      const char *info_dir)
+{
+   size_t i, count;
+   void *buf = NULL;
+   core_info_cache_reader_t reader = {0};
+   long len = read_file(cache_path, &buf);
+
+   if (len < 0 || !buf)
+      return false;
+
+   reader.data = (const uint8_t*)buf;
+   reader.size = len;
+
+   if (reader.size < 8 || memcmp(reader.data, CORE_INFO_CACHE_MAGIC, 8))
+      goto error;
+   reader.pos = 8;
+
+   if (core_info_cache_read_be(&reader, 4) != CORE_INFO_CACHE_VERSION)
+      goto error;
+
+   count = core_info_cache_read_be(&reader, 4);
+
+   if (core_info_cache_read_be(&reader, 8) != core_info_dir_mtime(modules_path)
+         || core_info_cache_read_be(&reader, 8) != core_info_dir_mtime(info_dir)
+         || !core_info_cache_string_matches(&reader, modules_path)
+         || !core_info_cache_string_matches(&reader, info_dir))
+      goto error;
+
+   /* Every core takes at least 19 bytes. */
+   if (count > (reader.size - reader.pos) / 19)
+      goto error;
+
+   core_info_list->list = (core_info_t*)calloc(count,
+         sizeof(*core_info_list->list));
+   if (count && !core_info_list->list)
+      goto error;
+   core_info_list->count = count;
+
+   for (i = 0; i < count && !reader.error; i++)
+   {
+      core_info_t *info = &core_info_list->list[i];
+
+      info->path                 = core_info_cache_read_string(&reader);
+      info->info_path            = core_info_cache_read_string(&reader);
+      info->display_name         = core_info_cache_read_string(&reader);
+      info->core_name            = core_info_cache_read_string(&reader);
+      info->systemname           = core_info_cache_read_string(&reader);
+      info->system_manufacturer  = core_info_cache_read_string(&reader);
+      info->supported_extensions = core_info_cache_read_string(&reader);
+      info->supports_no_game     = core_info_cache_read_be(&reader, 1);
+      info->firmware_count       = core_info_cache_read_be(&reader, 4);
+
+      if (!info->path || !info->display_name)
+         reader.error = true;
+
+      if (info->supported_extensions)
+         info->supported_extensions_list =
+            string_split(info->supported_extensions, "|");
    }
+
+   if (reader.error)
+      goto error;
+
+   free(buf);
+   return true;
+
+error:
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_free_info(&core_info_list->list[i]);
+   free(core_info_list->list);
+   core_info_list->list  = NULL;
+   core_info_list->count = 0;
+   free(buf);
+   return false;
 }
 
-core_info_list_t *core_info_list_new(const char *modules_path)
+/**
+ * core_info_cache_save:
+ * @core_info_list       : list just read from the .info files.
+ * @cache_path           : path of the cache.
+ * @modules_path         : directory of the cores.
+ * @info_dir             : directory of the .info files.
+ * @modules_mtime        : mtime of @modules_path before it was read.
+ * @info_mtime           : mtime of @info_dir before it was read.
+ **/
+static void core_info_cache_save(const core_info_list_t *core_info_list,
+      const char *cache_path, const char *modules_path,
+      const char *info_dir, uint64_t modules_mtime, uint64_t info_mtime)
+{
+   size_t i;
+   char tmp_path[PATH_MAX_LENGTH];
+   bool ok             = false;
+   FILE *file          = NULL;
+   uint64_t now        = (uint64_t)time(NULL);
+
+   /* mtimes only have a resolution of a second. A change later
+    * in the same second as the directory was read would go
+    * unnoticed, so the next run writes the cache instead. */
+   if (modules_mtime >= now || info_mtime >= now)
+      return;
+
+   /* Per process, so instances sharing the cache never
+    * write into the same file. */
+   file_tmp_path(tmp_path, cache_path, sizeof(tmp_path));
+   file = fopen(tmp_path, "wb");
+   if (!file)
+      return;
+
+   fwrite(CORE_INFO_CACHE_MAGIC, 1, 8, file);
+   core_info_cache_write_be(file, CORE_INFO_CACHE_VERSION, 4);
+   core_info_cache_write_be(file, core_info_list->count, 4);
+   core_info_cache_write_be(file, modules_mtime, 8);
+   core_info_cache_write_be(file, info_mtime, 8);
+   core_info_cache_write_string(file, modules_path);
+   core_info_cache_write_string(file, info_dir);
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+
+      core_info_cache_write_string(file, info->path);
+      core_info_cache_write_string(file, info->info_path);
+      core_info_cache_write_string(file, info->display_name);
+      core_info_cache_write_string(file, info->core_name);
+      core_info_cache_write_string(file, info->systemname);
+      core_info_cache_write_string(file, info->system_manufacturer);
+      core_info_cache_write_string(file, info->supported_extensions);
+      core_info_cache_write_be(file, info->supports_no_game, 1);
+      core_info_cache_write_be(file, info->firmware_count, 4);
+   }
+
+   ok = !ferror(file);
+   if (fclose(file) != 0)
+      ok = false;
+
+   if (ok)
+   {
+      remove(cache_path);
+      ok = rename(tmp_path, cache_path) == 0;
+   }
+
+   if (!ok)
+   {
+      RARCH_WARN("Could not write core info cache \"%s\".\n", cache_path);
+      remove(tmp_path);
+   }
+}
+
+/**
+ * core_info_list_scan:
+ * @core_info_list       : list to fill in.
+ * @modules_path         : directory of the cores.
+ * @info_dir             : directory of the .info files.
+ *
+ * Reads what the list keeps of every core in @modules_path
+ * from its .info file.
+ *
+ * Returns: false if @modules_path could not be read.
+ **/
+static bool core_info_list_scan(core_info_list_t *core_info_list,
+      const char *modules_path, const char *info_dir)
 {
    size_t i;
    core_info_t *core_info = NULL;
-   core_info_list_t *core_info_list = NULL;
    struct string_list *contents = (struct string_list*)
       dir_list_new(modules_path, EXT_EXECUTABLES, false);
 
    if (!contents)
-      return NULL;
-
-   core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
-   if (!core_info_list)
-      goto error;
+      return false;
 
    core_info = (core_info_t*)calloc(contents->size, sizeof(*core_info));
    if (!core_info)
-      goto error;
+   {
+      dir_list_free(contents);
+      return false;
+   }
 
    core_info_list->list = core_info;
    core_info_list->count = contents->size;
@@ -125,6 +403,7 @@ core_info_list_t *core_info_list_new(const char *modules_path)
    for (i = 0; i < contents->size; i++)
    {
       char info_path_base[PATH_MAX_LENGTH], info_path[PATH_MAX_LENGTH];
+      config_file_t *conf = NULL;
       core_info[i].path = strdup(contents->elems[i].data);
 
       if (!core_info[i].path)
@@ -142,122 +421,332 @@ core_info_list_t *core_info_list_new(const char *modules_path)
 
       strlcat(info_path_base, ".info", sizeof(info_path_base));
 
-      fill_pathname_join(info_path, (*g_settings.libretro_info_path) ?
-            g_settings.libretro_info_path : modules_path,
+      fill_pathname_join(info_path, info_dir,
             info_path_base, sizeof(info_path));
 
-      core_info[i].data = config_file_new(info_path);
+      conf = config_file_new(info_path);
 
-      if (core_info[i].data)
+      if (conf)
       {
          unsigned count = 0;
-         config_get_string(core_info[i].data, "display_name",
+         core_info[i].info_path = strdup(info_path);
+         config_get_string(conf, "display_name",
                &core_info[i].display_name);
-         config_get_string(core_info[i].data, "corename",
+         config_get_string(conf, "corename",
                &core_info[i].core_name);
-         config_get_string(core_info[i].data, "systemname",
+         config_get_string(conf, "systemname",
                &core_info[i].systemname);
-         config_get_string(core_info[i].data, "manufacturer",
+         config_get_string(conf, "manufacturer",
                &core_info[i].system_manufacturer);
-         config_get_uint(core_info[i].data, "firmware_count", &count);
+         config_get_uint(conf, "firmware_count", &count);
          core_info[i].firmware_count = count;
-         if (config_get_string(core_info[i].data, "supported_extensions",
+         if (config_get_string(conf, "supported_extensions",
                   &core_info[i].supported_extensions) &&
                core_info[i].supported_extensions)
             core_info[i].supported_extensions_list =
                string_split(core_info[i].supported_extensions, "|");
 
-         if (config_get_string(core_info[i].data, "authors",
-                  &core_info[i].authors) &&
-               core_info[i].authors)
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-         if (config_get_string(core_info[i].data, "permissions",
-                  &core_info[i].permissions) &&
-               core_info[i].permissions)
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-         if (config_get_string(core_info[i].data, "license",
-                  &core_info[i].licenses) &&
-               core_info[i].licenses)
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-         if (config_get_string(core_info[i].data, "categories",
-                  &core_info[i].categories) &&
-               core_info[i].categories)
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-         if (config_get_string(core_info[i].data, "notes",
-                  &core_info[i].notes) &&
-               core_info[i].notes)
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-         config_get_bool(core_info[i].data, "supports_no_game",
+         config_get_bool(conf, "supports_no_game",
                &core_info[i].supports_no_game);
+         config_file_free(conf);
       }
 
       if (!core_info[i].display_name)
          core_info[i].display_name = strdup(path_basename(core_info[i].path));
    }
 
-   core_info_list_resolve_all_extensions(core_info_list);
-   core_info_list_resolve_all_firmware(core_info_list);
-
    dir_list_free(contents);
-   return core_info_list;
-
-error:
-   if (contents)
-      dir_list_free(contents);
-   core_info_list_free(core_info_list);
-   return NULL;
+   return true;
 }
 
-void core_info_list_free(core_info_list_t *core_info_list)
+/**
+ * core_info_load_details:
+ * @info                 : core info to complete.
+ *
+ * Reads the fields the list is made without from the .info file
+ * of @info, the first time it is called for it.
+ **/
+static void core_info_load_details(core_info_t *info)
 {
-   size_t i, j;
+   unsigned c;
 
-   if (!core_info_list)
+   if (info->details_loaded)
       return;
+   info->details_loaded = true;
+
+   if (!info->info_path || !(info->data = config_file_new(info->info_path)))
+   {
+      info->firmware_count = 0;
+      return;
+   }
+
+   if (config_get_string(info->data, "authors",
+            &info->authors) && info->authors)
+      info->authors_list = string_split(info->authors, "|");
+
+   if (config_get_string(info->data, "permissions",
+            &info->permissions) && info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+
+   if (config_get_string(info->data, "license",
+            &info->licenses) && info->licenses)
+      info->licenses_list = string_split(info->licenses, "|");
+
+   if (config_get_string(info->data, "categories",
+            &info->categories) && info->categories)
+      info->categories_list = string_split(info->categories, "|");
+
+   if (config_get_string(info->data, "notes",
+            &info->notes) && info->notes)
+      info->note_list = string_split(info->notes, "|");
+
+   if (!info->firmware_count)
+      return;
+
+   info->firmware = (core_info_firmware_t*)
+      calloc(info->firmware_count, sizeof(*info->firmware));
+
+   if (!info->firmware)
+   {
+      info->firmware_count = 0;
+      return;
+   }
+
+   for (c = 0; c < info->firmware_count; c++)
+   {
+      char path_key[64], desc_key[64], opt_key[64];
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key, sizeof(opt_key), "firmware%u_opt", c);
+
+      config_get_string(info->data, path_key, &info->firmware[c].path);
+      config_get_string(info->data, desc_key, &info->firmware[c].desc);
+      config_get_bool(info->data, opt_key , &info->firmware[c].optional);
+   }
+}
+
+/* Cores supporting an extension, as one bit per core id. */
+struct core_info_ext
+{
+   char *ext;
+   uint32_t *cores;
+};
+
+#define CORE_INFO_WORDS(count) (((count) + 31) / 32)
+
+/* FNV-1a, case insensitive like extension matching. */
+static uint32_t core_info_ext_hash(const char *ext)
+{
+   uint32_t hash = 2166136261u;
+
+   while (*ext)
+   {
+      hash ^= (uint8_t)tolower((unsigned char)*ext++);
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+/**
+ * core_info_ext_find:
+ * @core_info_list       : core info list.
+ * @ext                  : extension, without leading period.
+ *
+ * Returns: slot of @ext in the extension index, which is
+ * empty if no core supports it.
+ **/
+static struct core_info_ext *core_info_ext_find(
+      const core_info_list_t *core_info_list, const char *ext)
+{
+   size_t i = core_info_ext_hash(ext) & core_info_list->ext_index_mask;
+
+   for (;; i = (i + 1) & core_info_list->ext_index_mask)
+   {
+      struct core_info_ext *slot = &core_info_list->ext_index[i];
+
+      if (!slot->ext || !strcasecmp(slot->ext, ext))
+         return slot;
+   }
+}
+
+static int core_info_name_cmp(const void *a_, const void *b_)
+{
+   const core_info_t *a = (const core_info_t*)a_;
+   const core_info_t *b = (const core_info_t*)b_;
+
+   return strcasecmp(a->display_name, b->display_name);
+}
+
+/**
+ * core_info_list_index_extensions:
+ * @core_info_list       : core info list.
+ *
+ * Sorts the list by display name, numbers the cores in that
+ * order and indexes them by the extensions they support.
+ *
+ * Returns: false if memory ran out.
+ **/
+static bool core_info_list_index_extensions(core_info_list_t *core_info_list)
+{
+   size_t i, j, size = 16, exts = 0;
+   size_t words = CORE_INFO_WORDS(core_info_list->count);
+
+   qsort(core_info_list->list, core_info_list->count,
+         sizeof(core_info_t), core_info_name_cmp);
 
    for (i = 0; i < core_info_list->count; i++)
    {
-      core_info_t *info = (core_info_t*)&core_info_list->list[i];
+      core_info_list->list[i].id = i;
+      if (core_info_list->list[i].supported_extensions_list)
+         exts += core_info_list->list[i].supported_extensions_list->size;
+   }
 
-      if (!info)
+   /* Keeps the table at most half full. */
+   while (size < exts * 2)
+      size <<= 1;
+
+   core_info_list->ext_index      = (struct core_info_ext*)
+      calloc(size, sizeof(*core_info_list->ext_index));
+   core_info_list->ext_index_mask = size - 1;
+   core_info_list->ext_query      = (uint32_t*)
+      calloc(words + 1, sizeof(uint32_t));
+   core_info_list->by_id          = (core_info_t*)
+      calloc(core_info_list->count + 1, sizeof(core_info_t));
+
+   if (!core_info_list->ext_index || !core_info_list->ext_query
+         || !core_info_list->by_id)
+      return false;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *list =
+         core_info_list->list[i].supported_extensions_list;
+
+      if (!list)
          continue;
 
-      free(info->path);
-      free(info->systemname);
-      free(info->system_manufacturer);
-      free(info->display_name);
-      free(info->supported_extensions);
-      free(info->authors);
-      free(info->permissions);
-      free(info->licenses);
-      free(info->categories);
-      free(info->notes);
-      if (info->supported_extensions_list)
-         string_list_free(info->supported_extensions_list);
-      string_list_free(info->authors_list);
-      string_list_free(info->note_list);
-      string_list_free(info->permissions_list);
-      string_list_free(info->licenses_list);
-      string_list_free(info->categories_list);
-      config_file_free(info->data);
+      for (j = 0; j < list->size; j++)
+      {
+         struct core_info_ext *slot = NULL;
+         const char *ext            = list->elems[j].data;
+
+         /* Extensions match with or without a period. */
+         if (*ext == '.')
+            ext++;
+
+         slot = core_info_ext_find(core_info_list, ext);
+
+         if (!slot->ext)
+         {
+            slot->ext   = strdup(ext);
+            slot->cores = (uint32_t*)calloc(words, sizeof(uint32_t));
+            if (!slot->ext || !slot->cores)
+            {
+               free(slot->ext);
+               free(slot->cores);
+               slot->ext = NULL;
+               return false;
+            }
+         }
+
+         slot->cores[i >> 5] |= 1u << (i & 31);
+      }
+   }
+
+   return true;
+}
 
-      for (j = 0; j < info->firmware_count; j++)
+static void core_info_list_free_extensions(core_info_list_t *core_info_list)
+{
+   size_t i;
+
+   if (core_info_list->ext_index)
+   {
+      for (i = 0; i <= core_info_list->ext_index_mask; i++)
       {
-         free(info->firmware[j].path);
-         free(info->firmware[j].desc);
+         free(core_info_list->ext_index[i].ext);
+         free(core_info_list->ext_index[i].cores);
       }
-      free(info->firmware);
    }
 
+   free(core_info_list->ext_index);
+   free(core_info_list->ext_query);
+   free(core_info_list->by_id);
+}
+
+/* Adds the cores supporting the extension of @path to
+ * the query. */
+static void core_info_list_query_path(core_info_list_t *core_info_list,
+      const char *path)
+{
+   size_t i;
+   const struct core_info_ext *slot = core_info_ext_find(core_info_list,
+         path_get_extension(path));
+
+   if (!slot->ext)
+      return;
+
+   for (i = 0; i < CORE_INFO_WORDS(core_info_list->count); i++)
+      core_info_list->ext_query[i] |= slot->cores[i];
+}
+
+core_info_list_t *core_info_list_new(const char *modules_path)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   uint64_t modules_mtime, info_mtime;
+   bool use_cache               = false;
+   const char *info_dir         = (*g_settings.libretro_info_path) ?
+      g_settings.libretro_info_path : modules_path;
+   core_info_list_t *core_info_list = (core_info_list_t*)
+      calloc(1, sizeof(*core_info_list));
+
+   if (!core_info_list)
+      return NULL;
+
+#ifndef RARCH_CONSOLE
+   use_cache = rarch_cache_path(cache_path, sizeof(cache_path),
+         CORE_INFO_CACHE_NAME);
+#endif
+
+   if (!use_cache || !core_info_cache_load(core_info_list, cache_path,
+            modules_path, info_dir))
+   {
+      modules_mtime = core_info_dir_mtime(modules_path);
+      info_mtime    = core_info_dir_mtime(info_dir);
+
+      if (!core_info_list_scan(core_info_list, modules_path, info_dir))
+         goto error;
+
+      if (use_cache)
+         core_info_cache_save(core_info_list, cache_path,
+               modules_path, info_dir, modules_mtime, info_mtime);
+   }
+
+   core_info_list_resolve_all_extensions(core_info_list);
+
+   if (!core_info_list_index_extensions(core_info_list))
+      goto error;
+
+   return core_info_list;
+
+error:
+   core_info_list_free(core_info_list);
+   return NULL;
+}
+
+void core_info_list_free(core_info_list_t *core_info_list)
+{
+   size_t i;
+
+   if (!core_info_list)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_free_info(&core_info_list->list[i]);
+
+   core_info_list_free_extensions(core_info_list);
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
@@ -271,7 +760,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-      num += !!core_info_list->list[i].data;
+      num += !!core_info_list->list[i].info_path;
 
    return num;
 }
@@ -309,9 +798,10 @@ bool core_info_list_get_info(core_info_list_t *core_info_list,
 
    for (i = 0; i < core_info_list->count; i++)
    {
-      const core_info_t *info = &core_info_list->list[i];
+      core_info_t *info = &core_info_list->list[i];
       if (!strcmp(path_basename(info->path), path_basename(path)))
       {
+         core_info_load_details(info);
          *out_info = *info;
          return true;
       }
@@ -341,6 +831,7 @@ bool core_info_list_get_by_id(core_info_list_t *core_info_list,
 
       if (!strcmp(core_id, info->path))
       {
+         core_info_load_details(info);
          *out_info = *info;
          return true;
       }
@@ -378,71 +869,59 @@ const char *core_info_list_get_all_extensions(core_info_list_t *core_info_list)
    return core_info_list->all_ext;
 }
 
-/* qsort_r() is not in standard C, sadly. */
-static const char *core_info_tmp_path;
-static const struct string_list *core_info_tmp_list;
-
-static int core_info_qsort_cmp(const void *a_, const void *b_)
-{
-   const core_info_t *a = (const core_info_t*)a_;
-   const core_info_t *b = (const core_info_t*)b_;
-   int support_a        = core_info_does_support_any_file(a, core_info_tmp_list) ||
-      core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        = core_info_does_support_any_file(b, core_info_tmp_list) ||
-      core_info_does_support_file(b, core_info_tmp_path);
-
-   if (support_a != support_b)
-      return support_b - support_a;
-   return strcasecmp(a->display_name, b->display_name);
-}
-
 void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
       const char *path, const core_info_t **infos, size_t *num_infos)
 {
+   size_t i, supported = 0, unsupported;
    struct string_list *list = NULL;
-   size_t supported = 0, i;
 
    if (!core_info_list)
       return;
 
    (void)list;
 
-   core_info_tmp_path = path;
+   memset(core_info_list->ext_query, 0,
+         CORE_INFO_WORDS(core_info_list->count) * sizeof(uint32_t));
+
+   core_info_list_query_path(core_info_list, path);
 
 #ifdef HAVE_ZLIB
    if (!strcasecmp(path_get_extension(path), "zip"))
       list = zlib_get_file_list(path);
-   core_info_tmp_list = list;
-#endif
 
-   /* Let supported core come first in list so we can return 
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
+   if (list)
+   {
+      for (i = 0; i < list->size; i++)
+         core_info_list_query_path(core_info_list, list->elems[i].data);
+      string_list_free(list);
+   }
+#endif
 
-   for (i = 0; i < core_info_list->count; i++, supported++)
+   for (i = 0; i < CORE_INFO_WORDS(core_info_list->count); i++)
    {
-      const core_info_t *core = &core_info_list->list[i];
+      uint32_t word = core_info_list->ext_query[i];
 
-      if (!core)
-         continue;
+      for (; word; word &= word - 1)
+         supported++;
+   }
 
-      if (core_info_does_support_file(core, path))
-         continue;
+   /* Let supported cores come first in list, by name like
+    * the rest, so we can return a pointer to them. */
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_list->by_id[core_info_list->list[i].id] =
+         core_info_list->list[i];
 
-#ifdef HAVE_ZLIB
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
+   unsupported = supported;
+   supported   = 0;
 
-      break;
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      if ((core_info_list->ext_query[i >> 5] >> (i & 31)) & 1)
+         core_info_list->list[supported++] = core_info_list->by_id[i];
+      else
+         core_info_list->list[unsupported++] = core_info_list->by_id[i];
    }
 
-#ifdef HAVE_ZLIB
-   if (list)
-      string_list_free(list);
-#endif
-
    *infos = core_info_list->list;
    *num_infos = supported;
 }
@@ -461,7 +940,10 @@ static core_info_t *find_core_info(core_info_list_t *list,
       if (!info->path)
          continue;
       if (!strcmp(info->path, core))
+      {
+         core_info_load_details(info);
          return info;
+      }
    }
 
    return NULL;
@@ -20,6 +20,7 @@
 
 #include <file/config_file.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,9 +36,16 @@ typedef struct
    bool optional;
 } core_info_firmware_t;
 
+/* Authors, permissions, licenses, categories, notes, firmware
+ * and data are read from the .info file only once a core is
+ * looked up with core_info_list_get_info() or one of the firmware
+ * functions. The rest is filled in when the list is made, from
+ * the core info cache if it is up to date. */
 typedef struct
 {
    char *path;
+   /* NULL if the core has no .info file. */
+   char *info_path;
    config_file_t *data;
    char *display_name;
    char *core_name;
@@ -59,6 +67,10 @@ typedef struct
    core_info_firmware_t *firmware;
    size_t firmware_count;
    bool supports_no_game;
+   bool details_loaded;
+   /* Position by display name, which the extension index
+    * refers to cores by. */
+   size_t id;
    void *userdata;
 } core_info_t;
 
@@ -67,6 +79,14 @@ typedef struct
    core_info_t *list;
    size_t count;
    char *all_ext;
+
+   /* Open addressed table from extension to the cores
+    * supporting it, see core_info.c. */
+   struct core_info_ext *ext_index;
+   size_t ext_index_mask;
+   /* Scratch space of get_supported_cores. */
+   uint32_t *ext_query;
+   core_info_t *by_id;
 } core_info_list_t;
 
 core_info_list_t *core_info_list_new(const char *modules_path);
@@ -15,6 +15,7 @@
  */
 
 #include "core_options.h"
+#include <stdint.h>
 #include <string.h>
 #include <file/config_file.h>
 #include <file/dir_list.h>
@@ -22,12 +23,20 @@
 #include <compat/strl.h>
 #include <retro_miscellaneous.h>
 
+#define CORE_OPTION_NONE ((size_t)-1)
+
+#define CORE_OPTION_DIRTY_BITS (8 * sizeof(uint32_t))
+
 struct core_option
 {
    char *desc;
    char *key;
    struct string_list *vals;
    size_t index;
+
+   uint32_t hash;
+   /* Next option in the same hash bucket. */
+   size_t hash_next;
 };
 
 struct core_option_manager
@@ -38,8 +47,59 @@ struct core_option_manager
    struct core_option *opts;
    size_t size;
    bool updated;
+
+   /* Heads of the hash chains, by key. */
+   size_t *buckets;
+   size_t bucket_mask;
+
+   /* One bit per option whose value the config file
+    * does not have yet. */
+   uint32_t *dirty;
 };
 
+/* FNV-1a. */
+static uint32_t core_option_hash(const char *key)
+{
+   uint32_t hash = 2166136261u;
+
+   for (; *key; key++)
+      hash = (hash ^ (uint8_t)*key) * 16777619u;
+   return hash;
+}
+
+static void core_option_set_dirty(core_option_manager_t *opt, size_t idx)
+{
+   opt->dirty[idx / CORE_OPTION_DIRTY_BITS] |=
+      (uint32_t)1 << (idx % CORE_OPTION_DIRTY_BITS);
+}
+
+static void core_option_clear_dirty(core_option_manager_t *opt, size_t idx)
+{
+   opt->dirty[idx / CORE_OPTION_DIRTY_BITS] &=
+      ~((uint32_t)1 << (idx % CORE_OPTION_DIRTY_BITS));
+}
+
+static bool core_option_is_dirty(core_option_manager_t *opt, size_t idx)
+{
+   return opt->dirty[idx / CORE_OPTION_DIRTY_BITS] &
+      ((uint32_t)1 << (idx % CORE_OPTION_DIRTY_BITS));
+}
+
+/* Moves option @idx to value @val_idx. Only a value which
+ * actually changes is reported to the core and written out. */
+static void core_option_change(core_option_manager_t *opt,
+      size_t idx, size_t val_idx)
+{
+   struct core_option *option = &opt->opts[idx];
+
+   if (option->index == val_idx)
+      return;
+
+   option->index = val_idx;
+   core_option_set_dirty(opt, idx);
+   opt->updated  = true;
+}
+
 void core_option_free(core_option_manager_t *opt)
 {
    size_t i;
@@ -56,16 +116,21 @@ void core_option_free(core_option_manager_t *opt)
    if (opt->conf)
       config_file_free(opt->conf);
    free(opt->opts);
+   free(opt->buckets);
+   free(opt->dirty);
    free(opt);
 }
 
 void core_option_get(core_option_manager_t *opt, struct retro_variable *var)
 {
    size_t i;
+   uint32_t hash = core_option_hash(var->key);
+
    opt->updated = false;
-   for (i = 0; i < opt->size; i++)
+   for (i = opt->buckets[hash & opt->bucket_mask];
+         i != CORE_OPTION_NONE; i = opt->opts[i].hash_next)
    {
-      if (strcmp(opt->opts[i].key, var->key) == 0)
+      if (opt->opts[i].hash == hash && !strcmp(opt->opts[i].key, var->key))
       {
          var->value = core_option_get_val(opt, i);
          return;
@@ -87,6 +152,7 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
       return false;
 
    option->key = strdup(var->key);
+   option->hash = core_option_hash(var->key);
 
    value = strdup(var->value);
    desc_end = strstr(value, "; ");
@@ -109,6 +175,10 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
       return false;
    }
 
+   /* Written out on flush unless the config file already
+    * holds one of the values. */
+   core_option_set_dirty(opt, idx);
+
    if (config_get_string(opt->conf, option->key, &config_val))
    {
       for (i = 0; i < option->vals->size; i++)
@@ -116,6 +186,7 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
          if (strcmp(option->vals->elems[i].data, config_val) == 0)
          {
             option->index = i;
+            core_option_clear_dirty(opt, idx);
             break;
          }
       }
@@ -132,7 +203,7 @@ core_option_manager_t *core_option_new(const char *conf_path,
       const struct retro_variable *vars)
 {
    const struct retro_variable *var;
-   size_t size = 0;
+   size_t i, size = 0, buckets = 1;
    core_option_manager_t *opt = (core_option_manager_t*)
       calloc(1, sizeof(*opt));
    if (!opt)
@@ -151,17 +222,33 @@ core_option_manager_t *core_option_new(const char *conf_path,
    for (var = vars; var->key && var->value; var++)
       size++;
 
-   opt->opts = (struct core_option*)calloc(size, sizeof(*opt->opts));
-   if (!opt->opts)
+   while (buckets < size)
+      buckets <<= 1;
+
+   opt->opts    = (struct core_option*)calloc(size, sizeof(*opt->opts));
+   opt->buckets = (size_t*)malloc(buckets * sizeof(size_t));
+   opt->dirty   = (uint32_t*)calloc(size / CORE_OPTION_DIRTY_BITS + 1,
+         sizeof(uint32_t));
+   if (!opt->opts || !opt->buckets || !opt->dirty)
       goto error;
 
+   for (i = 0; i < buckets; i++)
+      opt->buckets[i] = CORE_OPTION_NONE;
+   opt->bucket_mask = buckets - 1;
+
    opt->size = size;
 
    size = 0;
    for (var = vars; var->key && var->value; size++, var++)
    {
+      size_t *bucket;
+
       if (!parse_variable(opt, size, var))
          goto error;
+
+      bucket = &opt->buckets[opt->opts[size].hash & opt->bucket_mask];
+      opt->opts[size].hash_next = *bucket;
+      *bucket                   = size;
    }
 
    return opt;
@@ -181,13 +268,26 @@ bool core_option_updated(core_option_manager_t *opt)
 void core_option_flush(core_option_manager_t *opt)
 {
    size_t i;
+   bool dirty = false;
+
    for (i = 0; i < opt->size; i++)
    {
-      struct core_option *option = (struct core_option*)&opt->opts[i];
-      if (option)
-         config_set_string(opt->conf, option->key, core_option_get_val(opt, i));
+      if (!core_option_is_dirty(opt, i))
+         continue;
+
+      config_set_string(opt->conf, opt->opts[i].key,
+            core_option_get_val(opt, i));
+      dirty = true;
    }
+
+   /* Cores setting their variables again every so often
+    * should not rewrite the file each time. */
+   if (!dirty)
+      return;
+
    config_file_write(opt->conf, opt->conf_path);
+   memset(opt->dirty, 0,
+         (opt->size / CORE_OPTION_DIRTY_BITS + 1) * sizeof(uint32_t));
 }
 
 /**
@@ -254,8 +354,7 @@ void core_option_set_val(core_option_manager_t *opt,
    if (!option)
       return;
 
-   option->index = val_idx % option->vals->size;
-   opt->updated = true;
+   core_option_change(opt, idx, val_idx % option->vals->size);
 }
 
 /**
@@ -273,8 +372,7 @@ void core_option_next(core_option_manager_t *opt, size_t idx)
    if (!option)
       return;
 
-   option->index = (option->index + 1) % option->vals->size;
-   opt->updated = true;
+   core_option_change(opt, idx, (option->index + 1) % option->vals->size);
 }
 
 /**
@@ -293,9 +391,8 @@ void core_option_prev(core_option_manager_t *opt, size_t idx)
    if (!option)
       return;
 
-   option->index = (option->index + option->vals->size - 1) %
-      option->vals->size;
-   opt->updated = true;
+   core_option_change(opt, idx, (option->index + option->vals->size - 1) %
+         option->vals->size);
 }
 
 /**
@@ -310,6 +407,5 @@ void core_option_set_default(core_option_manager_t *opt, size_t idx)
    if (!opt)
       return;
 
-   opt->opts[idx].index = 0;
-   opt->updated = true;
+   core_option_change(opt, idx, 0);
 }
@@ -20,9 +20,13 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <sys/stat.h>
+#include <time.h>
+
 #include <string.h>
 #include <retro_miscellaneous.h>
 #include <file/file_path.h>
+#include <compat/strl.h>
 #include "7zip_support.h"
 
 #include "../deps/7zip/7z.h"
@@ -30,13 +34,32 @@
 #include "../deps/7zip/7zCrc.h"
 #include "../deps/7zip/7zFile.h"
 #include "../deps/7zip/7zVersion.h"
+#include "../deps/7zip/LzmaDec.h"
+#include "../deps/7zip/Lzma2Dec.h"
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include "../performance.h"
+#endif
 
 /* Undefined at the end of the file
  * Don't use outside of this file
  */
 #define RARCH_ZIP_SUPPORT_BUFFER_SIZE_MAX 16384
 
+/* Solid blocks up to this size are decoded whole and kept, so
+ * that reading several files out of one block decodes it once.
+ * Bigger blocks are streamed and only decoded up to the end of
+ * the file read from them. */
+#define SEVENZIP_BLOCK_CACHE_SIZE   (64 * 1024 * 1024)
+#define SEVENZIP_BLOCK_CACHE_BLOCKS 4
+
+#define SEVENZIP_METHOD_COPY  0
+#define SEVENZIP_METHOD_LZMA2 0x21
+#define SEVENZIP_METHOD_LZMA  0x30101
+
 static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+static ISzAlloc g_AllocTemp = { SzAllocTemp, SzFreeTemp };
 
 static int Buf_EnsureSize(CBuf *dest, size_t size)
 {
@@ -167,294 +190,836 @@ static SRes ConvertUtf16toCharString(const uint16_t *s, char *outstring)
    return res;
 }
 
-/* Extract the relative path relative_path from a 7z archive 
- * archive_path and allocate a buf for it to write it in.
- * If optional_outfile is set, extract to that instead and don't alloc buffer.
- */
-int read_7zip_file(const char * archive_path,
-      const char *relative_path, void **buf, const char* optional_outfile)
+static void sevenzip_log_error(SRes res)
+{
+   if (res == SZ_ERROR_UNSUPPORTED)
+      RARCH_ERR("7Zip decoder doesn't support this archive\n");
+   else if (res == SZ_ERROR_MEM)
+      RARCH_ERR("7Zip decoder could not allocate memory\n");
+   else if (res == SZ_ERROR_CRC)
+      RARCH_ERR("7Zip decoder encountered a CRC error in the archive\n");
+   else
+      RARCH_ERR("\nUnspecified error in 7-ZIP archive, error number was: #%d\n", res);
+}
+
+struct sevenzip_block
+{
+   uint8_t *data;
+   size_t size;
+   uint32_t folder;
+   unsigned last_used;
+};
+
+/* The last archive used stays open with its parsed header,
+ * along with the blocks decoded from it. Only used from the main
+ * thread. */
+static struct
 {
-   CFileInStream archiveStream;
-   CLookToRead lookStream;
+   bool open;
+   char path[PATH_MAX_LENGTH];
+   time_t mtime;
+   off_t size;
+
+   CFileInStream archive_stream;
+   CLookToRead look_stream;
    CSzArEx db;
+
+   struct sevenzip_block blocks[SEVENZIP_BLOCK_CACHE_BLOCKS];
+   size_t blocks_size;
+   unsigned clock;
+} sevenzip_cache;
+
+/**
+ * compressed_7zip_cache_free:
+ *
+ * Closes the archive kept open by read_7zip_file() and
+ * compressed_7zip_file_list_new(), and frees the blocks
+ * decoded from it.
+ **/
+void compressed_7zip_cache_free(void)
+{
+   unsigned i;
+
+   if (!sevenzip_cache.open)
+      return;
+
+   for (i = 0; i < SEVENZIP_BLOCK_CACHE_BLOCKS; i++)
+      free(sevenzip_cache.blocks[i].data);
+
+   SzArEx_Free(&sevenzip_cache.db, &g_Alloc);
+   File_Close(&sevenzip_cache.archive_stream.file);
+
+   memset(&sevenzip_cache, 0, sizeof(sevenzip_cache));
+}
+
+static CSzArEx *sevenzip_archive_open(const char *path)
+{
+   struct stat st;
    SRes res;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
-   uint16_t *temp = NULL;
-   size_t tempSize = 0;
-   long outsize = -1;
-   bool file_found = false;
-
-   /*These are the allocation routines.
-    * Currently using the non-standard 7zip choices. */
-   allocImp.Alloc = SzAlloc;
-   allocImp.Free = SzFree;
-   allocTempImp.Alloc = SzAllocTemp;
-   allocTempImp.Free = SzFreeTemp;
-
-   if (InFile_Open(&archiveStream.file, archive_path))
+
+   if (stat(path, &st) != 0)
    {
-      RARCH_ERR("Could not open %s as 7z archive\n.",archive_path);
-      return -1;
+      RARCH_ERR("Could not open %s as 7z archive.\n", path);
+      return NULL;
    }
-   else
+
+   if (sevenzip_cache.open && !strcmp(sevenzip_cache.path, path)
+         && sevenzip_cache.mtime == st.st_mtime
+         && sevenzip_cache.size == st.st_size)
+      return &sevenzip_cache.db;
+
+   compressed_7zip_cache_free();
+
+   if (InFile_Open(&sevenzip_cache.archive_stream.file, path))
    {
-      RARCH_LOG_OUTPUT("Openend archive %s. Now trying to extract %s\n",
-            archive_path,relative_path);
+      RARCH_ERR("Could not open %s as 7z archive.\n", path);
+      return NULL;
    }
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead_CreateVTable(&lookStream, False);
-   lookStream.realStream = &archiveStream.s;
-   LookToRead_Init(&lookStream);
+
+   FileInStream_CreateVTable(&sevenzip_cache.archive_stream);
+   LookToRead_CreateVTable(&sevenzip_cache.look_stream, False);
+   sevenzip_cache.look_stream.realStream = &sevenzip_cache.archive_stream.s;
+   LookToRead_Init(&sevenzip_cache.look_stream);
    CrcGenerateTable();
-   SzArEx_Init(&db);
-   res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
+   SzArEx_Init(&sevenzip_cache.db);
+
+   res = SzArEx_Open(&sevenzip_cache.db, &sevenzip_cache.look_stream.s,
+         &g_Alloc, &g_AllocTemp);
+   if (res != SZ_OK)
+   {
+      sevenzip_log_error(res);
+      SzArEx_Free(&sevenzip_cache.db, &g_Alloc);
+      File_Close(&sevenzip_cache.archive_stream.file);
+      return NULL;
+   }
+
+   strlcpy(sevenzip_cache.path, path, sizeof(sevenzip_cache.path));
+   sevenzip_cache.mtime = st.st_mtime;
+   sevenzip_cache.size  = st.st_size;
+   sevenzip_cache.open  = true;
+
+   return &sevenzip_cache.db;
+}
+
+static bool sevenzip_get_file_name(const CSzArEx *db, uint32_t index,
+      uint16_t **temp, size_t *temp_size, char *name)
+{
+   size_t len = SzArEx_GetFileNameUtf16(db, index, NULL);
+
+   if (len > *temp_size)
+   {
+      free(*temp);
+      *temp_size = len;
+      *temp = (uint16_t*)malloc(len * sizeof(**temp));
+      if (!*temp)
+      {
+         *temp_size = 0;
+         return false;
+      }
+   }
+
+   SzArEx_GetFileNameUtf16(db, index, *temp);
+   return ConvertUtf16toCharString(*temp, name) == SZ_OK;
+}
+
+struct sevenzip_output
+{
+   uint8_t *data;
+   FILE *file;
+   size_t pos;
+   uint32_t crc;
+};
+
+static SRes sevenzip_output_write(struct sevenzip_output *out,
+      const uint8_t *data, size_t size)
+{
+   out->crc = CrcUpdate(out->crc, data, size);
+
+   if (out->data)
+      memcpy(out->data + out->pos, data, size);
+   else if (fwrite(data, 1, size, out->file) != size)
+      return SZ_ERROR_WRITE;
+
+   out->pos += size;
+   return SZ_OK;
+}
+
+#ifdef HAVE_THREADS
+struct sevenzip_lzma2_job
+{
+   const uint8_t *in;
+   size_t in_size;
+   uint8_t *out;
+   size_t out_size;
+   uint8_t prop;
+   SRes res;
+};
+
+static void sevenzip_lzma2_job_run(void *data)
+{
+   CLzma2Dec state;
+   ELzmaStatus status;
+   struct sevenzip_lzma2_job *job = (struct sevenzip_lzma2_job*)data;
+   size_t in_size = job->in_size;
+
+   Lzma2Dec_Construct(&state);
+   job->res = Lzma2Dec_AllocateProbs(&state, job->prop, &g_Alloc);
+   if (job->res != SZ_OK)
+      return;
+
+   state.decoder.dic        = job->out;
+   state.decoder.dicBufSize = job->out_size;
+   Lzma2Dec_Init(&state);
+
+   job->res = Lzma2Dec_DecodeToDic(&state, job->out_size,
+         job->in, &in_size, LZMA_FINISH_ANY, &status);
+
+   if (job->res == SZ_OK && state.decoder.dicPos != job->out_size)
+      job->res = SZ_ERROR_DATA;
+
+   Lzma2Dec_FreeProbs(&state, &g_Alloc);
+}
+
+/**
+ * sevenzip_decode_lzma2_mt:
+ *
+ * Decodes an LZMA2 block on several threads. Every chunk that
+ * resets the dictionary starts a stretch that does not depend on
+ * anything before it, which the multithreaded 7-Zip encoder
+ * writes one of per block it compresses. Those stretches are
+ * split between threads.
+ *
+ * Returns: SZ_ERROR_UNSUPPORTED if the block is not a single
+ * LZMA2 stream, which leaves it to SzFolder_Decode().
+ **/
+static SRes sevenzip_decode_lzma2_mt(const CSzFolder *folder,
+      const uint64_t *pack_sizes, uint64_t start,
+      uint8_t *out, size_t out_size)
+{
+   size_t pos = 0, out_pos = 0, count = 0, capacity = 0;
+   unsigned i, num_jobs, cores = rarch_get_cpu_cores();
+   struct sevenzip_lzma2_job *jobs = NULL;
+   sthread_t **threads             = NULL;
+   size_t *in_starts               = NULL;
+   size_t *out_starts              = NULL;
+   uint8_t *in                     = NULL;
+   size_t in_size                  = (size_t)pack_sizes[0];
+   SRes res                        = SZ_OK;
+
+   if (cores < 2 || folder->NumCoders != 1 || folder->NumPackStreams != 1
+         || folder->Coders[0].MethodID != SEVENZIP_METHOD_LZMA2
+         || folder->Coders[0].Props.size != 1
+         || in_size != pack_sizes[0])
+      return SZ_ERROR_UNSUPPORTED;
+
+   in = (uint8_t*)malloc(in_size ? in_size : 1);
+   if (!in)
+      return SZ_ERROR_MEM;
+
+   res = LookInStream_SeekTo(&sevenzip_cache.look_stream.s, start);
    if (res == SZ_OK)
+      res = LookInStream_Read(&sevenzip_cache.look_stream.s, in, in_size);
+   if (res != SZ_OK)
+      goto end;
+
+   /* Chunk headers give both sizes, so the stretches can be
+    * found without decoding anything. */
+   while (pos < in_size && in[pos])
    {
-      uint32_t i;
-      uint32_t blockIndex = 0xFFFFFFFF;
-      uint8_t *outBuffer = 0;
-      size_t outBufferSize = 0;
+      uint8_t control = in[pos];
+      size_t unpacked, packed, header;
+      bool reset;
+
+      if (pos + 3 > in_size)
+         break;
 
-      for (i = 0; i < db.db.NumFiles; i++)
+      if (control == 1 || control == 2)
       {
-         size_t offset = 0;
-         size_t outSizeProcessed = 0;
-         const CSzFileItem *f = db.db.Files + i;
-         size_t len;
-         if (f->IsDir)
-         {
-            /* We skip over everything which is not a directory. 
-             * FIXME: Why continue then if f->IsDir is true?*/
-            continue;
-         }
+         unpacked = ((in[pos + 1] << 8) | in[pos + 2]) + 1;
+         packed   = unpacked;
+         header   = 3;
+         reset    = control == 1;
+      }
+      else if (control >= 0x80 && pos + 5 <= in_size)
+      {
+         unpacked = (((control & 0x1f) << 16)
+               | (in[pos + 1] << 8) | in[pos + 2]) + 1;
+         packed   = ((in[pos + 3] << 8) | in[pos + 4]) + 1;
+         header   = control >= 0xc0 ? 6 : 5;
+         reset    = control >= 0xe0;
+      }
+      else
+         break;
 
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
-         if (len > tempSize)
+      if (reset || !count)
+      {
+         if (count == capacity)
          {
-            free(temp);
-            tempSize = len;
-            temp = (uint16_t *)malloc(tempSize * sizeof(temp[0]));
-            if (temp == 0)
+            size_t *new_in, *new_out;
+
+            capacity = capacity ? capacity * 2 : 16;
+            new_in   = (size_t*)realloc(in_starts,
+                  capacity * sizeof(*in_starts));
+            if (new_in)
+               in_starts = new_in;
+            new_out  = (size_t*)realloc(out_starts,
+                  capacity * sizeof(*out_starts));
+            if (new_out)
+               out_starts = new_out;
+            if (!new_in || !new_out)
             {
                res = SZ_ERROR_MEM;
-               break;
+               goto end;
             }
          }
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         char infile[PATH_MAX_LENGTH];
-         res = ConvertUtf16toCharString(temp,infile);
 
-         uint64_t filesize = f->Size;
+         in_starts[count]  = pos;
+         out_starts[count] = out_pos;
+         count++;
+      }
 
-         (void)filesize;
+      pos     += header + packed;
+      out_pos += unpacked;
+   }
 
-         if (strcmp(infile,relative_path) == 0)
-         {
-            /* C LZMA SDK does not support chunked extraction - see here:
-             * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
-             * */
-            file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.s, i,&blockIndex,
-                  &outBuffer, &outBufferSize,&offset, &outSizeProcessed,
-                  &allocImp, &allocTempImp);
-            if (res != SZ_OK)
-            {
-               break; /* This goes to the error section. */
-            }
-            outsize = outSizeProcessed;
-            if (optional_outfile != NULL)
-            {
-               FILE* outsink = fopen(optional_outfile,"wb");
-               if (outsink == NULL)
-               {
-                  RARCH_ERR("Could not open outfilepath %s.\n",
-                        optional_outfile);
-                  IAlloc_Free(&allocImp, outBuffer);
-                  SzArEx_Free(&db, &allocImp);
-                  free(temp);
-                  File_Close(&archiveStream.file);
-                  return -1;
-               }
-               fwrite(outBuffer+offset,1,outsize,outsink);
-               fclose(outsink);
-            }
-            else
-            {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc(outsize + 1);
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,outBuffer+offset,outsize);
-            }
-            IAlloc_Free(&allocImp, outBuffer);
-            break;
-         }
-      }
+   if (!count || out_pos != out_size || pos > in_size)
+   {
+      res = SZ_ERROR_DATA;
+      goto end;
    }
-   SzArEx_Free(&db, &allocImp);
-   free(temp);
 
-   File_Close(&archiveStream.file);
+   num_jobs = count < cores ? count : cores;
+   jobs     = (struct sevenzip_lzma2_job*)calloc(num_jobs, sizeof(*jobs));
+   threads  = (sthread_t**)calloc(num_jobs, sizeof(*threads));
+   if (!jobs || !threads)
+   {
+      res = SZ_ERROR_MEM;
+      goto end;
+   }
 
-   if (res == SZ_OK && file_found == true)
-      return outsize;
+   for (i = 0; i < num_jobs; i++)
+   {
+      size_t first = count * i / num_jobs;
+      size_t last  = count * (i + 1) / num_jobs;
 
-   /* Error handling */
-   if (!file_found)
-      RARCH_ERR("File %s not found in %s\n",relative_path,archive_path);
-   else if (res == SZ_ERROR_UNSUPPORTED)
-      RARCH_ERR("7Zip decoder doesn't support this archive\n");
-   else if (res == SZ_ERROR_MEM)
-      RARCH_ERR("7Zip decoder could not allocate memory\n");
-   else if (res == SZ_ERROR_CRC)
-      RARCH_ERR("7Zip decoder encountered a CRC error in the archive\n");
-   else
-      RARCH_ERR("\nUnspecified error in 7-ZIP archive, error number was: #%d\n", res);
-   return -1;
+      jobs[i].in       = in + in_starts[first];
+      jobs[i].in_size  = (last < count ? in_starts[last] : in_size)
+         - in_starts[first];
+      jobs[i].out      = out + out_starts[first];
+      jobs[i].out_size = (last < count ? out_starts[last] : out_size)
+         - out_starts[first];
+      jobs[i].prop     = folder->Coders[0].Props.data[0];
+
+      if (i)
+         threads[i] = sthread_create(sevenzip_lzma2_job_run, &jobs[i]);
+   }
+
+   sevenzip_lzma2_job_run(&jobs[0]);
+
+   for (i = 1; i < num_jobs; i++)
+   {
+      if (threads[i])
+         sthread_join(threads[i]);
+      else
+         sevenzip_lzma2_job_run(&jobs[i]);
+   }
+
+   for (i = 0; i < num_jobs && res == SZ_OK; i++)
+      res = jobs[i].res;
+
+end:
+   free(jobs);
+   free(threads);
+   free(in_starts);
+   free(out_starts);
+   free(in);
+   return res;
 }
+#endif
 
-struct string_list *compressed_7zip_file_list_new(const char *path,
-      const char* ext)
+static SRes sevenzip_decode_block(const CSzArEx *db, uint32_t folder_index,
+      uint8_t **data, size_t *size)
 {
+   const CSzFolder *folder  = db->db.Folders + folder_index;
+   const uint64_t *pack_sizes = db->db.PackSizes +
+      db->FolderStartPackStreamIndex[folder_index];
+   uint64_t unpack_size     = SzFolder_GetUnpackSize((CSzFolder*)folder);
+   uint64_t start           = SzArEx_GetFolderStreamPos(db, folder_index, 0);
+   SRes res                 = SZ_ERROR_UNSUPPORTED;
 
-   struct string_list *ext_list = NULL;
-   struct string_list *list = string_list_new();
-   if (!list)
+   *data = NULL;
+   *size = (size_t)unpack_size;
+
+   if (*size != unpack_size)
+      return SZ_ERROR_MEM;
+
+   *data = (uint8_t*)malloc(*size ? *size : 1);
+   if (!*data)
+      return SZ_ERROR_MEM;
+
+#ifdef HAVE_THREADS
+   res = sevenzip_decode_lzma2_mt(folder, pack_sizes, start, *data, *size);
+#endif
+
+   if (res == SZ_ERROR_UNSUPPORTED)
+   {
+      res = LookInStream_SeekTo(&sevenzip_cache.look_stream.s, start);
+      if (res == SZ_OK)
+         res = SzFolder_Decode(folder, pack_sizes,
+               &sevenzip_cache.look_stream.s, start,
+               *data, *size, &g_AllocTemp);
+   }
+
+   if (res == SZ_OK && folder->UnpackCRCDefined
+         && CrcCalc(*data, *size) != folder->UnpackCRC)
+      res = SZ_ERROR_CRC;
+
+   if (res != SZ_OK)
+   {
+      free(*data);
+      *data = NULL;
+   }
+
+   return res;
+}
+
+static struct sevenzip_block *sevenzip_block_get(const CSzArEx *db,
+      uint32_t folder_index, SRes *res)
+{
+   unsigned i;
+   uint8_t *data = NULL;
+   size_t size   = 0;
+   struct sevenzip_block *slot = NULL;
+
+   for (i = 0; i < SEVENZIP_BLOCK_CACHE_BLOCKS; i++)
+   {
+      struct sevenzip_block *block = &sevenzip_cache.blocks[i];
+
+      if (block->data && block->folder == folder_index)
+      {
+         block->last_used = ++sevenzip_cache.clock;
+         return block;
+      }
+   }
+
+   *res = sevenzip_decode_block(db, folder_index, &data, &size);
+   if (*res != SZ_OK)
       return NULL;
 
-   if (ext)
-      ext_list = string_split(ext, "|");
+   /* Evict the least recently used blocks until it fits. */
+   for (;;)
+   {
+      struct sevenzip_block *oldest = NULL;
 
-   /* 7Zip part begin */
-   CFileInStream archiveStream;
-   CLookToRead lookStream;
-   CSzArEx db;
-   SRes res;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
-   uint16_t *temp = NULL;
-   size_t tempSize = 0;
-   long outsize = -1;
-
-   (void)outsize;
-
-   /* These are the allocation routines - currently using 
-    * the non-standard 7zip choices. */
-   allocImp.Alloc = SzAlloc;
-   allocImp.Free = SzFree;
-   allocTempImp.Alloc = SzAllocTemp;
-   allocTempImp.Free = SzFreeTemp;
-
-   if (InFile_Open(&archiveStream.file, path))
+      slot = NULL;
+      for (i = 0; i < SEVENZIP_BLOCK_CACHE_BLOCKS; i++)
+      {
+         struct sevenzip_block *block = &sevenzip_cache.blocks[i];
+
+         if (!block->data)
+            slot = block;
+         else if (!oldest || block->last_used < oldest->last_used)
+            oldest = block;
+      }
+
+      if (slot && sevenzip_cache.blocks_size + size
+            <= SEVENZIP_BLOCK_CACHE_SIZE)
+         break;
+
+      sevenzip_cache.blocks_size -= oldest->size;
+      free(oldest->data);
+      memset(oldest, 0, sizeof(*oldest));
+   }
+
+   slot->data      = data;
+   slot->size      = size;
+   slot->folder    = folder_index;
+   slot->last_used = ++sevenzip_cache.clock;
+   sevenzip_cache.blocks_size += size;
+
+   return slot;
+}
+
+static uint32_t sevenzip_dictionary_size(const CSzCoderInfo *coder)
+{
+   const uint8_t *props = coder->Props.data;
+
+   if (coder->MethodID == SEVENZIP_METHOD_LZMA2)
    {
-      RARCH_ERR("Could not open %s as 7z archive.\n",path);
-      goto error;
+      if (coder->Props.size != 1 || props[0] > 40)
+         return 0;
+      if (props[0] == 40)
+         return 0xffffffff;
+      return (2 | (props[0] & 1)) << (props[0] / 2 + 11);
    }
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead_CreateVTable(&lookStream, False);
-   lookStream.realStream = &archiveStream.s;
-   LookToRead_Init(&lookStream);
-   CrcGenerateTable();
-   SzArEx_Init(&db);
-   res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
+
+   if (coder->Props.size < LZMA_PROPS_SIZE)
+      return 0;
+   return props[1] | (props[2] << 8) | (props[3] << 16)
+      | ((uint32_t)props[4] << 24);
+}
+
+/**
+ * sevenzip_stream_file:
+ * @db                          : the archive.
+ * @folder_index                : block the file is in.
+ * @offset                      : offset of the file in the block.
+ * @size                        : size of the file.
+ * @out                         : where the file goes.
+ *
+ * Decodes a block up to the end of one file in it, in chunks,
+ * through a dictionary no bigger than the block. Everything
+ * before the file is decoded and dropped, everything after it
+ * is not decoded at all.
+ *
+ * Returns: SZ_ERROR_UNSUPPORTED unless the block is a single
+ * LZMA, LZMA2 or stored stream.
+ **/
+static SRes sevenzip_stream_file(const CSzArEx *db, uint32_t folder_index,
+      uint64_t offset, uint64_t size, struct sevenzip_output *out)
+{
+   CLzmaDec lzma;
+   CLzma2Dec lzma2;
+   uint8_t chunk[RARCH_ZIP_SUPPORT_BUFFER_SIZE_MAX];
+   const CSzFolder *folder   = db->db.Folders + folder_index;
+   const CSzCoderInfo *coder = folder->Coders;
+   ILookInStream *stream     = &sevenzip_cache.look_stream.s;
+   uint64_t start            = SzArEx_GetFolderStreamPos(db, folder_index, 0);
+   uint64_t in_left          = db->db.PackSizes[
+      db->FolderStartPackStreamIndex[folder_index]];
+   uint64_t produced         = 0;
+   uint64_t needed           = offset + size;
+   uint64_t dic_size         = 0;
+   uint8_t *dic              = NULL;
+   SRes res                  = SZ_OK;
+
+   if (folder->NumCoders != 1 || folder->NumPackStreams != 1)
+      return SZ_ERROR_UNSUPPORTED;
+
+   if (coder->MethodID == SEVENZIP_METHOD_COPY)
+   {
+      RINOK(LookInStream_SeekTo(stream, start + offset));
+
+      while (size && res == SZ_OK)
+      {
+         size_t len = size < sizeof(chunk) ? (size_t)size : sizeof(chunk);
+
+         res = LookInStream_Read(stream, chunk, len);
+         if (res == SZ_OK)
+            res = sevenzip_output_write(out, chunk, len);
+         size -= len;
+      }
+
+      return res;
+   }
+
+   if (coder->MethodID != SEVENZIP_METHOD_LZMA
+         && coder->MethodID != SEVENZIP_METHOD_LZMA2)
+      return SZ_ERROR_UNSUPPORTED;
+
+   /* Nothing ever refers back further than the block goes. */
+   dic_size = sevenzip_dictionary_size(coder);
+   if (!dic_size)
+      return SZ_ERROR_UNSUPPORTED;
+   dic_size = min(dic_size, SzFolder_GetUnpackSize((CSzFolder*)folder));
+   dic_size = max(dic_size, 1);
+   if ((size_t)dic_size != dic_size)
+      return SZ_ERROR_MEM;
+
+   dic = (uint8_t*)malloc((size_t)dic_size);
+   if (!dic)
+      return SZ_ERROR_MEM;
+
+   if (coder->MethodID == SEVENZIP_METHOD_LZMA)
+   {
+      LzmaDec_Construct(&lzma);
+      res = LzmaDec_AllocateProbs(&lzma, coder->Props.data,
+            (unsigned)coder->Props.size, &g_AllocTemp);
+      lzma.dic        = dic;
+      lzma.dicBufSize = (size_t)dic_size;
+      if (res == SZ_OK)
+         LzmaDec_Init(&lzma);
+   }
+   else
+   {
+      Lzma2Dec_Construct(&lzma2);
+      res = Lzma2Dec_AllocateProbs(&lzma2, coder->Props.data[0],
+            &g_AllocTemp);
+      lzma2.decoder.dic        = dic;
+      lzma2.decoder.dicBufSize = (size_t)dic_size;
+      if (res == SZ_OK)
+         Lzma2Dec_Init(&lzma2);
+   }
+
    if (res == SZ_OK)
+      res = LookInStream_SeekTo(stream, start);
+
+   while (res == SZ_OK && produced < needed)
    {
-      uint32_t i;
-      uint32_t blockIndex = 0xFFFFFFFF;
-      uint8_t *outBuffer = 0;
-      size_t outBufferSize = 0;
+      ELzmaStatus status;
+      const void *in_buf = NULL;
+      size_t look        = in_left < (1 << 18) ? (size_t)in_left : (1 << 18);
+      size_t in_len, out_len;
+
+      res = stream->Look(stream, &in_buf, &look);
+      if (res != SZ_OK)
+         break;
+
+      in_len  = look;
+      out_len = needed - produced < sizeof(chunk) ?
+         (size_t)(needed - produced) : sizeof(chunk);
+
+      if (coder->MethodID == SEVENZIP_METHOD_LZMA)
+         res = LzmaDec_DecodeToBuf(&lzma, chunk, &out_len,
+               (const uint8_t*)in_buf, &in_len, LZMA_FINISH_ANY, &status);
+      else
+         res = Lzma2Dec_DecodeToBuf(&lzma2, chunk, &out_len,
+               (const uint8_t*)in_buf, &in_len, LZMA_FINISH_ANY, &status);
+      if (res != SZ_OK)
+         break;
+
+      res = stream->Skip(stream, in_len);
+      in_left -= in_len;
 
-      (void)blockIndex;
-      (void)outBufferSize;
-      (void)outBuffer;
+      if (!out_len && !in_len)
+         res = SZ_ERROR_DATA;
 
-      for (i = 0; i < db.db.NumFiles; i++)
+      /* Only the part that belongs to the file is kept. */
+      if (res == SZ_OK && produced + out_len > offset)
       {
-         size_t offset = 0;
-         size_t outSizeProcessed = 0;
-         const CSzFileItem *f = db.db.Files + i;
-         size_t len = 0;
+         size_t skip = produced < offset ? (size_t)(offset - produced) : 0;
+         res = sevenzip_output_write(out, chunk + skip, out_len - skip);
+      }
 
-         (void)offset;
-         (void)outSizeProcessed;
+      produced += out_len;
+   }
 
-         if (f->IsDir)
-         {
-            /* we skip over everything, which is a directory. */
-            continue;
-         }
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
-         if (len > tempSize)
-         {
-            free(temp);
-            tempSize = len;
-            temp = (uint16_t *)malloc(tempSize * sizeof(temp[0]));
-            if (temp == 0)
-            {
-               res = SZ_ERROR_MEM;
-               break;
-            }
-         }
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         char infile[PATH_MAX_LENGTH];
-         res = ConvertUtf16toCharString(temp, infile);
+   if (coder->MethodID == SEVENZIP_METHOD_LZMA)
+      LzmaDec_FreeProbs(&lzma, &g_AllocTemp);
+   else
+      Lzma2Dec_FreeProbs(&lzma2, &g_AllocTemp);
+   free(dic);
+
+   return res;
+}
+
+static SRes sevenzip_extract(const CSzArEx *db, uint32_t file_index,
+      struct sevenzip_output *out)
+{
+   uint32_t i;
+   uint64_t offset = 0, block_size;
+   struct sevenzip_block *block = NULL;
+   const CSzFileItem *file      = db->db.Files + file_index;
+   uint32_t folder_index        = db->FileIndexToFolderIndexMap[file_index];
+   SRes res                     = SZ_OK;
+
+   out->crc = CRC_INIT_VAL;
+
+   /* Empty files are not stored in any block. */
+   if (folder_index == (uint32_t)-1)
+      goto end;
+
+   for (i = db->FolderStartFileIndex[folder_index]; i < file_index; i++)
+      offset += db->db.Files[i].Size;
+
+   block_size = SzFolder_GetUnpackSize(db->db.Folders + folder_index);
+   if (offset + file->Size > block_size)
+      return SZ_ERROR_FAIL;
+
+   if (block_size <= SEVENZIP_BLOCK_CACHE_SIZE)
+   {
+      block = sevenzip_block_get(db, folder_index, &res);
+      if (!block)
+         return res;
+      res = sevenzip_output_write(out, block->data + offset,
+            (size_t)file->Size);
+   }
+   else
+   {
+      res = sevenzip_stream_file(db, folder_index, offset, file->Size, out);
+
+      if (res == SZ_ERROR_UNSUPPORTED)
+      {
+         /* Filters and multi-stream blocks only decode whole. */
+         uint8_t *data = NULL;
+         size_t size   = 0;
+
+         res = sevenzip_decode_block(db, folder_index, &data, &size);
+         if (res == SZ_OK)
+            res = sevenzip_output_write(out, data + offset,
+                  (size_t)file->Size);
+         free(data);
+      }
+   }
+
+end:
+   if (res == SZ_OK && file->CrcDefined
+         && CRC_GET_DIGEST(out->crc) != file->Crc)
+      res = SZ_ERROR_CRC;
 
-         const char *file_ext = path_get_extension(infile);
-         bool supported_by_core  = false;
+   return res;
+}
 
-         union string_list_elem_attr attr;
+/* Extract the relative path relative_path from a 7z archive 
+ * archive_path and allocate a buf for it to write it in.
+ * If optional_outfile is set, extract to that instead and don't alloc buffer.
+ */
+int read_7zip_file(const char * archive_path,
+      const char *relative_path, void **buf, const char* optional_outfile)
+{
+   uint32_t i;
+   struct sevenzip_output out = {0};
+   uint16_t *temp    = NULL;
+   size_t temp_size  = 0;
+   bool file_found   = false;
+   const CSzArEx *db = sevenzip_archive_open(archive_path);
+   uint64_t size     = 0;
+   SRes res          = SZ_OK;
 
-         if (string_list_find_elem_prefix(ext_list, ".", file_ext))
-            supported_by_core = true;
+   if (!db)
+      return -1;
 
-         /*
-          * Currently we only support files without subdirs in the archives.
-          * Folders are not supported (differences between win and lin.
-          * Archives within archives should imho never be supported.
-          */
+   RARCH_LOG_OUTPUT("Openend archive %s. Now trying to extract %s\n",
+         archive_path,relative_path);
 
-         if (!supported_by_core)
-            continue;
+   for (i = 0; i < db->db.NumFiles; i++)
+   {
+      char infile[PATH_MAX_LENGTH];
 
-         attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
+      if (db->db.Files[i].IsDir)
+         continue;
 
-         if (!string_list_append(list, infile, attr))
-            goto error;
+      if (!sevenzip_get_file_name(db, i, &temp, &temp_size, infile))
+      {
+         res = SZ_ERROR_MEM;
+         break;
+      }
 
+      if (strcmp(infile, relative_path) == 0)
+      {
+         file_found = true;
+         break;
       }
    }
-   SzArEx_Free(&db, &allocImp);
+
    free(temp);
-   File_Close(&archiveStream.file);
 
-   if (res != SZ_OK)
+   if (!file_found)
    {
-      /* Error handling */
-      if (res == SZ_ERROR_UNSUPPORTED)
-         RARCH_ERR("7Zip decoder doesn't support this archive. \n");
-      else if (res == SZ_ERROR_MEM)
-         RARCH_ERR("7Zip decoder could not allocate memory. \n");
-      else if (res == SZ_ERROR_CRC)
-         RARCH_ERR("7Zip decoder encountered a CRC error in the archive. \n");
+      if (res == SZ_OK)
+         RARCH_ERR("File %s not found in %s\n",relative_path,archive_path);
       else
-         RARCH_ERR(
-               "\nUnspecified error in 7-ZIP archive, error number was: #%d. \n",
-               res);
+         sevenzip_log_error(res);
+      return -1;
+   }
+
+   size = db->db.Files[i].Size;
+   if ((size_t)size != size || (long)size < 0)
+   {
+      sevenzip_log_error(SZ_ERROR_MEM);
+      return -1;
+   }
+
+   if (optional_outfile != NULL)
+   {
+      out.file = fopen(optional_outfile, "wb");
+      if (!out.file)
+      {
+         RARCH_ERR("Could not open outfilepath %s.\n", optional_outfile);
+         return -1;
+      }
+   }
+   else
+   {
+      /* RetroArch expects a \0 at the end. */
+      out.data = (uint8_t*)malloc((size_t)size + 1);
+      if (!out.data)
+      {
+         sevenzip_log_error(SZ_ERROR_MEM);
+         return -1;
+      }
+      out.data[size] = '\0';
+   }
+
+   res = sevenzip_extract(db, i, &out);
+
+   if (out.file)
+      fclose(out.file);
+
+   if (res != SZ_OK)
+   {
+      sevenzip_log_error(res);
+      free(out.data);
+      return -1;
+   }
+
+   if (out.data)
+      *buf = out.data;
+   return (int)size;
+}
+
+struct string_list *compressed_7zip_file_list_new(const char *path,
+      const char* ext)
+{
+   uint32_t i;
+   uint16_t *temp               = NULL;
+   size_t temp_size             = 0;
+   struct string_list *ext_list = NULL;
+   const CSzArEx *db            = NULL;
+   struct string_list *list     = string_list_new_arena();
+
+   if (!list)
+      return NULL;
+
+   if (ext)
+      ext_list = string_split(ext, "|");
+
+   db = sevenzip_archive_open(path);
+   if (!db)
       goto error;
+
+   for (i = 0; i < db->db.NumFiles; i++)
+   {
+      union string_list_elem_attr attr;
+      char infile[PATH_MAX_LENGTH];
+      const char *file_ext = NULL;
+
+      if (db->db.Files[i].IsDir)
+      {
+         /* we skip over everything, which is a directory. */
+         continue;
+      }
+
+      if (!sevenzip_get_file_name(db, i, &temp, &temp_size, infile))
+      {
+         sevenzip_log_error(SZ_ERROR_MEM);
+         goto error;
+      }
+
+      file_ext = path_get_extension(infile);
+
+      /*
+       * Currently we only support files without subdirs in the archives.
+       * Folders are not supported (differences between win and lin.
+       * Archives within archives should imho never be supported.
+       */
+
+      if (!string_list_find_elem_prefix(ext_list, ".", file_ext))
+         continue;
+
+      attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
+
+      if (!string_list_append(list, infile, attr))
+         goto error;
    }
 
+   free(temp);
    string_list_free(ext_list);
    return list;
 
 error:
    RARCH_ERR("Failed to open compressed_file: \"%s\"\n", path);
-   SzArEx_Free(&db, &allocImp);
    free(temp);
-   File_Close(&archiveStream.file);
    string_list_free(list);
    string_list_free(ext_list);
    return NULL;
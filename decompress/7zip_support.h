@@ -27,6 +27,8 @@ int read_7zip_file(const char * archive_path,
 struct string_list *compressed_7zip_file_list_new(const char *path,
       const char* ext);
 
+void compressed_7zip_cache_free(void);
+
 #ifdef __cplusplus
 }
 #endif
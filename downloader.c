@@ -0,0 +1,469 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Downloads many files at once over a net_http pool. Each file is
+ * checked and unpacked as it streams in, so that it is ready as
+ * soon as its last byte arrives. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <compat/posix_string.h>
+#include <file/file_path.h>
+
+#include "downloader.h"
+#include "net_http.h"
+#include "hash.h"
+#include "general.h"
+
+#ifdef HAVE_ZLIB
+#include "file_extract.h"
+#endif
+
+#define DOWNLOADER_DEFAULT_PARALLEL 8
+#define DOWNLOADER_MAX_ATTEMPTS     3
+
+struct downloader_item
+{
+   char *url;
+   char path[PATH_MAX_LENGTH];
+   char part[PATH_MAX_LENGTH];
+   char sha256[65];
+   char extract_dir[PATH_MAX_LENGTH];
+
+   downloader_cb_t cb;
+   void *userdata;
+   downloader_t *handle;
+
+   net_http_transfer_t *transfer;
+   unsigned attempts;
+   FILE *file;
+   /* What @part holds. */
+   size_t written;
+
+   struct sha256_ctx sha;
+#ifdef HAVE_ZLIB
+   zlib_stream_extract_t *extract;
+#endif
+
+   struct downloader_item *next;
+};
+
+struct downloader
+{
+   net_http_pool_t *pool;
+   unsigned max_parallel;
+   unsigned active;
+   struct downloader_item *queue;
+   struct downloader_progress progress;
+};
+
+static void downloader_item_reset(struct downloader_item *item)
+{
+   if (item->file)
+      fclose(item->file);
+   item->file = NULL;
+
+#ifdef HAVE_ZLIB
+   zlib_stream_extract_free(item->extract);
+   item->extract = NULL;
+#endif
+}
+
+static void downloader_item_free(struct downloader_item *item)
+{
+   downloader_item_reset(item);
+   free(item->url);
+   free(item);
+}
+
+static bool downloader_item_feed(struct downloader_item *item,
+      const uint8_t *data, size_t len)
+{
+   if (*item->sha256)
+      sha256_update(&item->sha, data, len);
+
+#ifdef HAVE_ZLIB
+   if (item->extract && !zlib_stream_extract_push(item->extract, data, len))
+      return false;
+#endif
+
+   return true;
+}
+
+/**
+ * downloader_item_open:
+ * @item                 : download.
+ * @resume               : whether to carry on with @item->part.
+ *
+ * Gets @item->part ready for writing. A resumed part is run
+ * through the checksum and the extraction first, so that
+ * both carry on as if it had just been downloaded.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool downloader_item_open(struct downloader_item *item, bool resume)
+{
+   downloader_item_reset(item);
+
+   if (*item->sha256)
+      sha256_begin(&item->sha);
+
+#ifdef HAVE_ZLIB
+   if (*item->extract_dir)
+   {
+      item->extract = zlib_stream_extract_new(item->extract_dir);
+      if (!item->extract)
+         return false;
+   }
+#endif
+
+   if (resume)
+   {
+      uint8_t buf[64 * 1024];
+      size_t left = item->written;
+      FILE *file  = fopen(item->part, "rb");
+
+      if (!file)
+         return false;
+
+      while (left)
+      {
+         size_t len = left < sizeof(buf) ? left : sizeof(buf);
+
+         if (fread(buf, 1, len, file) != len
+               || !downloader_item_feed(item, buf, len))
+         {
+            fclose(file);
+            return false;
+         }
+         left -= len;
+      }
+
+      fclose(file);
+   }
+   else
+   {
+      char dir[PATH_MAX_LENGTH];
+
+      /* Provisioning starts out from an empty tree. */
+      strlcpy(dir, item->part, sizeof(dir));
+      path_basedir(dir);
+      if (*dir && !path_is_directory(dir) && !path_mkdir(dir))
+         return false;
+
+      item->written = 0;
+   }
+
+   item->file = fopen(item->part, resume ? "ab" : "wb");
+   return item->file != NULL;
+}
+
+static bool downloader_write(void *userdata, size_t offset,
+      const char *data, size_t len, size_t total)
+{
+   struct downloader_item *item = (struct downloader_item*)userdata;
+
+   (void)total;
+
+   if (!item->file)
+   {
+      /* Either the range was honoured, or it all comes again. */
+      if (offset != 0 && offset != item->written)
+         return false;
+      if (!downloader_item_open(item, offset != 0))
+         return false;
+   }
+
+   if (offset != item->written)
+      return false;
+
+   if (fwrite(data, 1, len, item->file) != len
+         || !downloader_item_feed(item, (const uint8_t*)data, len))
+      return false;
+
+   item->written                += len;
+   item->handle->progress.bytes += len;
+   return true;
+}
+
+static void downloader_start(downloader_t *handle,
+      struct downloader_item *item);
+
+static void downloader_finish(downloader_t *handle,
+      struct downloader_item *item, bool ok)
+{
+   struct downloader_item **link;
+
+   for (link = &handle->queue; *link; link = &(*link)->next)
+   {
+      if (*link != item)
+         continue;
+      *link = item->next;
+      break;
+   }
+
+   if (ok)
+      handle->progress.files_done++;
+   else
+      handle->progress.files_failed++;
+
+   if (item->cb)
+      item->cb(item->userdata, item->path, ok);
+
+   downloader_item_free(item);
+}
+
+/* Returns: true (1) if the finished part checks out. */
+static bool downloader_verify(struct downloader_item *item)
+{
+   bool ok = fclose(item->file) == 0;
+
+   item->file = NULL;
+
+   if (ok && *item->sha256)
+   {
+      char sha[65];
+
+      sha256_end(&item->sha, sha);
+      if (strcasecmp(sha, item->sha256))
+      {
+         RARCH_ERR("[Downloader]: SHA-256 mismatch for \"%s\".\n",
+               item->path);
+         return false;
+      }
+   }
+
+#ifdef HAVE_ZLIB
+   if (ok && item->extract
+         && !zlib_stream_extract_end(item->extract, item->part))
+   {
+      RARCH_ERR("[Downloader]: Could not extract \"%s\".\n", item->path);
+      return false;
+   }
+#endif
+
+   return ok;
+}
+
+static void downloader_done(void *userdata,
+      int status, const char *data, size_t len)
+{
+   struct downloader_item *item = (struct downloader_item*)userdata;
+   downloader_t *handle         = item->handle;
+
+   (void)data;
+   (void)len;
+
+   item->transfer = NULL;
+   handle->active--;
+
+   if (status >= 200 && status < 300)
+   {
+      /* An empty body never got to downloader_write(). */
+      if (!item->file && !downloader_item_open(item, false))
+         status = NET_HTTP_ERROR_FILE;
+      else if (!downloader_verify(item))
+      {
+         /* Nothing to resume from a broken file. */
+         remove(item->part);
+         item->written = 0;
+         status        = NET_HTTP_ERROR_FILE;
+      }
+      else
+      {
+#ifdef _WIN32
+         remove(item->path);
+#endif
+         if (rename(item->part, item->path) == 0)
+         {
+            downloader_finish(handle, item, true);
+            return;
+         }
+         status = NET_HTTP_ERROR_FILE;
+      }
+   }
+
+   downloader_item_reset(item);
+
+   /* 416: the part does not fit the file anymore. */
+   if (status == 416)
+   {
+      remove(item->part);
+      item->written = 0;
+   }
+
+   /* Aborted means we could not take the data, which
+    * would not go any better the next time. */
+   if (status != NET_HTTP_ERROR_ABORTED
+         && (status < 0 || status == 416 || status >= 500)
+         && ++item->attempts < DOWNLOADER_MAX_ATTEMPTS)
+   {
+      RARCH_WARN("[Downloader]: Retrying \"%s\" (%d).\n", item->url, status);
+      downloader_start(handle, item);
+      return;
+   }
+
+   RARCH_ERR("[Downloader]: Failed to download \"%s\" (%d).\n",
+         item->url, status);
+   downloader_finish(handle, item, false);
+}
+
+static void downloader_start(downloader_t *handle,
+      struct downloader_item *item)
+{
+   FILE *file = fopen(item->part, "rb");
+
+   item->written = 0;
+   if (file)
+   {
+      if (fseek(file, 0, SEEK_END) == 0)
+      {
+         long size = ftell(file);
+         if (size > 0)
+            item->written = size;
+      }
+      fclose(file);
+   }
+
+   if (item->written)
+      RARCH_LOG("[Downloader]: Resuming \"%s\" at %u bytes.\n",
+            item->path, (unsigned)item->written);
+
+   item->transfer = net_http_get_range(handle->pool, item->url,
+         item->written, downloader_write, downloader_done, item);
+   if (!item->transfer)
+   {
+      downloader_finish(handle, item, false);
+      return;
+   }
+
+   handle->active++;
+}
+
+downloader_t *downloader_new(unsigned max_parallel)
+{
+   downloader_t *handle = (downloader_t*)calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   handle->pool = net_http_pool_new();
+   if (!handle->pool)
+   {
+      free(handle);
+      return NULL;
+   }
+
+   handle->max_parallel = max_parallel
+      ? max_parallel : DOWNLOADER_DEFAULT_PARALLEL;
+   return handle;
+}
+
+void downloader_free(downloader_t *handle)
+{
+   if (!handle)
+      return;
+
+   /* Takes the transfers along, without calling back. */
+   net_http_pool_free(handle->pool);
+
+   while (handle->queue)
+   {
+      struct downloader_item *item = handle->queue;
+      handle->queue                = item->next;
+      downloader_item_free(item);
+   }
+
+   free(handle);
+}
+
+bool downloader_add(downloader_t *handle, const char *url,
+      const char *path, const char *sha256, const char *extract_dir,
+      downloader_cb_t cb, void *userdata)
+{
+   struct downloader_item *item, **last;
+
+   if (!handle || !url || !path)
+      return false;
+
+#ifndef HAVE_ZLIB
+   if (extract_dir)
+      return false;
+#endif
+
+   if (sha256 && strlen(sha256) != 64)
+      return false;
+
+   item = (struct downloader_item*)calloc(1, sizeof(*item));
+   if (!item)
+      return false;
+
+   item->url = strdup(url);
+   if (!item->url)
+   {
+      free(item);
+      return false;
+   }
+
+   strlcpy(item->path, path, sizeof(item->path));
+   snprintf(item->part, sizeof(item->part), "%s.part", path);
+   if (sha256)
+      strlcpy(item->sha256, sha256, sizeof(item->sha256));
+   if (extract_dir)
+      strlcpy(item->extract_dir, extract_dir, sizeof(item->extract_dir));
+
+   item->cb       = cb;
+   item->userdata = userdata;
+   item->handle   = handle;
+
+   /* First come, first served. */
+   for (last = &handle->queue; *last; last = &(*last)->next);
+   *last = item;
+
+   handle->progress.files_total++;
+   return true;
+}
+
+bool downloader_poll(downloader_t *handle, unsigned timeout_ms)
+{
+   struct downloader_item *item;
+
+   if (!handle)
+      return false;
+
+   item = handle->queue;
+   while (item && handle->active < handle->max_parallel)
+   {
+      struct downloader_item *next = item->next;
+
+      /* Failing to start takes it off the queue. */
+      if (!item->transfer)
+         downloader_start(handle, item);
+      item = next;
+   }
+
+   net_http_pool_poll(handle->pool, timeout_ms);
+   return handle->queue != NULL;
+}
+
+void downloader_get_progress(const downloader_t *handle,
+      struct downloader_progress *progress)
+{
+   *progress = handle->progress;
+}
@@ -0,0 +1,97 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_DOWNLOADER_H
+#define __RARCH_DOWNLOADER_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct downloader downloader_t;
+
+/* Called once per file, @ok telling whether it is in place. */
+typedef void (*downloader_cb_t)(void *userdata, const char *path, bool ok);
+
+struct downloader_progress
+{
+   unsigned files_total;
+   unsigned files_done;
+   unsigned files_failed;
+   /* Downloaded by this downloader, resumed parts not included. */
+   uint64_t bytes;
+};
+
+/**
+ * downloader_new:
+ * @max_parallel         : transfers to run at once, 0 for the default.
+ *
+ * Returns: new downloader, or NULL on failure.
+ **/
+downloader_t *downloader_new(unsigned max_parallel);
+
+/**
+ * downloader_free:
+ * @handle               : downloader handle.
+ *
+ * Stops whatever is left. Partial files stay, so that a later
+ * downloader resumes them.
+ **/
+void downloader_free(downloader_t *handle);
+
+/**
+ * downloader_add:
+ * @handle               : downloader handle.
+ * @url                  : http:// URL of the file.
+ * @path                 : where the file goes.
+ * @sha256               : SHA-256 the file must have, as hex, or NULL.
+ * @extract_dir          : directory to unpack the file to as a ZIP
+ *                         archive while it downloads, or NULL.
+ * @cb                   : called once the file is done. Can be NULL.
+ * @userdata             : passed to @cb.
+ *
+ * Queues a file. It is downloaded to @path.part first, which is
+ * resumed with a range request if it is already there, and only
+ * renamed to @path once it checked out.
+ *
+ * Returns: true (1) if queued, otherwise false (0).
+ **/
+bool downloader_add(downloader_t *handle, const char *url,
+      const char *path, const char *sha256, const char *extract_dir,
+      downloader_cb_t cb, void *userdata);
+
+/**
+ * downloader_poll:
+ * @handle               : downloader handle.
+ * @timeout_ms           : how long to wait for the network.
+ *
+ * Moves the downloads along, see net_http_pool_poll().
+ *
+ * Returns: true (1) if files are left, otherwise false (0).
+ **/
+bool downloader_poll(downloader_t *handle, unsigned timeout_ms);
+
+void downloader_get_progress(const downloader_t *handle,
+      struct downloader_progress *progress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,11 +17,13 @@
 #include "driver.h"
 #include "general.h"
 #include "retroarch.h"
+#include "performance.h"
 #include <stdint.h>
 #include <string.h>
 #include "compat/posix_string.h"
 #include "gfx/video_thread_wrapper.h"
 #include "gfx/gfx_common.h"
+#include "gfx/video_pacer.h"
 
 #ifdef HAVE_X11
 #include "gfx/drivers_context/x11_common.h"
@@ -209,13 +211,23 @@ static void adjust_system_rates(void)
       (const struct retro_system_timing*)&g_extern.system.av_info.timing;
 
    g_extern.system.force_nonblock = false;
+   g_extern.system.vrr = g_settings.video.vrr == VIDEO_VRR_ON ||
+      (g_settings.video.vrr == VIDEO_VRR_AUTO && driver.display_vrr);
 
    if (info->fps <= 0.0 || info->sample_rate <= 0.0)
       return;
 
    timing_skew = fabs(1.0f - info->fps / g_settings.video.refresh_rate);
 
-   if (timing_skew > g_settings.audio.max_timing_skew)
+   if (g_extern.system.vrr)
+   {
+      /* The display follows the frames we present at the 
+       * core's rate, so audio plays at the core's rate too. */
+      RARCH_LOG("Variable refresh, presenting at %.4f Hz.\n",
+            (float)info->fps);
+      g_extern.audio_data.in_rate = info->sample_rate;
+   }
+   else if (timing_skew > g_settings.audio.max_timing_skew)
    {
       /* We don't want to adjust pitch too much. If we have extreme cases,
        * just don't readjust at all. */
@@ -594,6 +606,8 @@ static void init_video_input(void)
    /* Need to grab the "real" video driver interface on a reinit. */
    find_video_driver();
 
+   driver.display_vrr = false;
+
 #ifdef HAVE_THREADS
    if (g_settings.video.threaded && !g_extern.system.hw_render_callback.context_type)
    {
@@ -676,6 +690,7 @@ static void init_video_input(void)
    rarch_main_command(RARCH_CMD_OVERLAY_INIT);
 
    g_extern.measure_data.frame_time_samples_count = 0;
+   video_pacer_reset();
 
    g_extern.frame_cache.width = 4;
    g_extern.frame_cache.height = 4;
@@ -715,25 +730,46 @@ void init_drivers(int flags)
    driver.menu_data_own = true;
 #endif
 
+   rarch_timeline_begin("init_drivers");
+
    if (flags & (DRIVER_VIDEO | DRIVER_AUDIO))
       adjust_system_rates();
 
+   /* Opening the audio device does not depend on video,
+    * so it can go on while the video driver comes up. */
+   if ((flags & DRIVER_AUDIO) && (flags & DRIVER_VIDEO))
+      audio_driver_open_async();
+
    if (flags & DRIVER_VIDEO)
    {
       g_extern.frame_count = 0;
 
+      rarch_timeline_begin("init_video_input");
       init_video_input();
+      rarch_timeline_end();
+
+      /* Whether the display does VRR is only known now. */
+      if (g_settings.video.vrr == VIDEO_VRR_AUTO)
+         adjust_system_rates();
 
       if (!driver.video_cache_context_ack
             && g_extern.system.hw_render_callback.context_reset)
+      {
+         rarch_timeline_begin("context_reset");
          g_extern.system.hw_render_callback.context_reset();
+         rarch_timeline_end();
+      }
       driver.video_cache_context_ack = false;
 
       g_extern.system.frame_time_last = 0;
    }
 
    if (flags & DRIVER_AUDIO)
+   {
+      rarch_timeline_begin("init_audio");
       init_audio();
+      rarch_timeline_end();
+   }
 
    /* Only initialize camera driver if we're ever going to use it. */
    if ((flags & DRIVER_CAMERA) && driver.camera_active)
@@ -749,10 +785,12 @@ void init_drivers(int flags)
 #ifdef HAVE_MENU
    if (flags & DRIVER_MENU)
    {
+      rarch_timeline_begin("init_menu");
       init_menu();
 
       if (driver.menu && driver.menu_ctx && driver.menu_ctx->context_reset)
          driver.menu_ctx->context_reset(driver.menu);
+      rarch_timeline_end();
    }
 #endif
 
@@ -762,6 +800,8 @@ void init_drivers(int flags)
       if (driver.nonblock_state)
          driver_set_nonblock_state(driver.nonblock_state);
    }
+
+   rarch_timeline_end();
 }
 
 /**
@@ -58,6 +58,10 @@ extern "C" {
 
 #define AUDIO_MAX_RATIO 16
 
+/* audio_driver_flush() converts, filters and resamples audio in blocks
+ * of this many frames, so intermediate samples stay in cache. */
+#define AUDIO_BLOCK_FRAMES 256
+
 /* Specialized _POINTER that targets the full screen regardless of viewport.
  * Should not be used by a libretro implementation as coordinates returned
  * make no sense.
@@ -124,6 +128,9 @@ enum
    RARCH_DISK_NEXT,
    RARCH_DISK_PREV,
    RARCH_GRAB_MOUSE_TOGGLE,
+   RARCH_SAVE_REPLAY,
+   RARCH_LATENCY_TEST,
+   RARCH_TRACE_DUMP,
 
    RARCH_MENU_TOGGLE,
 
@@ -163,6 +170,15 @@ enum analog_dpad_mode
    ANALOG_DPAD_LAST
 };
 
+/* Values of video_vrr. */
+enum video_vrr_mode
+{
+   VIDEO_VRR_OFF = 0,
+   /* Only if the context driver detects a VRR display. */
+   VIDEO_VRR_AUTO,
+   VIDEO_VRR_ON
+};
+
 /* Flags for init_drivers/uninit_drivers */
 enum
 {
@@ -287,6 +303,10 @@ typedef struct driver
     * TODO: Refactor this better. */
    bool gfx_use_rgba;
 
+   /* Set by the video driver if the display is known to 
+    * refresh whenever a frame is presented (VRR). */
+   bool display_vrr;
+
 #ifdef HAVE_OVERLAY
    input_overlay_t *overlay;
    input_overlay_state_t overlay_state;
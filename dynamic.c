@@ -40,6 +40,15 @@
 #endif
 #endif
 
+#ifdef HAVE_DYNAMIC
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <link.h>
+#endif
+#endif
+
 #ifdef HAVE_DYNAMIC
 #undef SYM
 #define SYM(x) do { \
@@ -49,6 +58,9 @@
 } while (0)
 
 static dylib_t lib_handle;
+/* Path lib_handle was loaded from, g_settings.libretro may 
+ * already name the next core by the time it is closed. */
+static char lib_path[PATH_MAX_LENGTH];
 #else
 #define SYM(x) p##x = x
 #endif
@@ -260,6 +272,218 @@ libretro_find_controller_description(
    return NULL;
 }
 
+#ifdef HAVE_DYNAMIC
+/* Cores kept loaded after switching away from them, so that 
+ * switching back skips loading and relocating the library. */
+#define LIBRETRO_POOL_MAX 8
+
+static struct libretro_pool_entry
+{
+   char path[PATH_MAX_LENGTH];
+   dylib_t handle;
+   size_t size;
+   unsigned last_used;
+} libretro_pool[LIBRETRO_POOL_MAX];
+
+static unsigned libretro_pool_clock;
+
+#if defined(__linux__)
+struct libretro_pool_phdr_query
+{
+   uintptr_t addr;
+   size_t size;
+};
+
+static int libretro_pool_phdr_cb(struct dl_phdr_info *info,
+      size_t info_size, void *data)
+{
+   unsigned i;
+   size_t size = 0;
+   bool found  = false;
+   struct libretro_pool_phdr_query *query =
+      (struct libretro_pool_phdr_query*)data;
+
+   (void)info_size;
+
+   for (i = 0; i < info->dlpi_phnum; i++)
+   {
+      uintptr_t start = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+
+      if (info->dlpi_phdr[i].p_type != PT_LOAD)
+         continue;
+
+      size += info->dlpi_phdr[i].p_memsz;
+      if (query->addr >= start
+            && query->addr < start + info->dlpi_phdr[i].p_memsz)
+         found = true;
+   }
+
+   if (!found)
+      return 0;
+
+   query->size = size;
+   return 1;
+}
+#endif
+
+/**
+ * libretro_pool_core_size:
+ * @path                         : Path the core was loaded from.
+ *
+ * Estimates the memory the currently loaded core holds on to,
+ * its code and static data. What it allocates is expected to
+ * be freed by retro_deinit().
+ *
+ * Returns: size in bytes.
+ **/
+static size_t libretro_pool_core_size(const char *path)
+{
+   struct stat st;
+#if defined(__linux__)
+   Dl_info info;
+   struct libretro_pool_phdr_query query = {0};
+   void *sym = NULL;
+
+   memcpy(&sym, &pretro_init, sizeof(sym));
+
+   if (dladdr(sym, &info) && info.dli_fbase)
+   {
+      query.addr = (uintptr_t)sym;
+      if (dl_iterate_phdr(libretro_pool_phdr_cb, &query) && query.size)
+         return query.size;
+   }
+#endif
+
+   if (stat(path, &st) == 0)
+      return st.st_size;
+   return 0;
+}
+
+/**
+ * libretro_pool_trim:
+ * @budget                       : Bytes the pool may hold.
+ *
+ * Closes the least recently used cores until the pool
+ * fits in @budget.
+ **/
+static void libretro_pool_trim(size_t budget)
+{
+   for (;;)
+   {
+      unsigned i;
+      size_t total = 0;
+      struct libretro_pool_entry *oldest = NULL;
+
+      for (i = 0; i < LIBRETRO_POOL_MAX; i++)
+      {
+         if (!libretro_pool[i].handle)
+            continue;
+
+         total += libretro_pool[i].size;
+         if (!oldest || libretro_pool[i].last_used < oldest->last_used)
+            oldest = &libretro_pool[i];
+      }
+
+      if (!oldest || total <= budget)
+         return;
+
+      RARCH_LOG("Closing pooled core: \"%s\".\n", oldest->path);
+      dylib_close(oldest->handle);
+      memset(oldest, 0, sizeof(*oldest));
+   }
+}
+
+/**
+ * libretro_pool_put:
+ *
+ * Moves the current core to the warm pool instead of closing
+ * it, if the pool is enabled and it fits.
+ *
+ * Returns: true (1) if the pool took it, otherwise false (0).
+ **/
+static bool libretro_pool_put(void)
+{
+   unsigned i;
+   size_t budget = (size_t)g_settings.libretro_warm_pool_size << 20;
+   struct libretro_pool_entry *entry = NULL;
+   size_t size = 0;
+
+   if (!budget)
+   {
+      libretro_pool_trim(0);
+      return false;
+   }
+
+   size = libretro_pool_core_size(lib_path);
+   if (size > budget)
+      return false;
+
+   libretro_pool_trim(budget - size);
+
+   /* Take a free slot, or else the least recently used one. */
+   for (i = 0; i < LIBRETRO_POOL_MAX; i++)
+   {
+      if (!libretro_pool[i].handle)
+      {
+         entry = &libretro_pool[i];
+         break;
+      }
+
+      if (!entry || libretro_pool[i].last_used < entry->last_used)
+         entry = &libretro_pool[i];
+   }
+
+   if (entry->handle)
+   {
+      RARCH_LOG("Closing pooled core: \"%s\".\n", entry->path);
+      dylib_close(entry->handle);
+   }
+
+   strlcpy(entry->path, lib_path, sizeof(entry->path));
+   entry->handle    = lib_handle;
+   entry->size      = size;
+   entry->last_used = ++libretro_pool_clock;
+   return true;
+}
+
+/**
+ * libretro_pool_take:
+ * @path                         : Path to the core library.
+ *
+ * Returns: handle of @path from the warm pool, which no longer
+ * holds it, or NULL if it is not there.
+ **/
+static dylib_t libretro_pool_take(const char *path)
+{
+   unsigned i;
+
+   for (i = 0; i < LIBRETRO_POOL_MAX; i++)
+   {
+      dylib_t handle = libretro_pool[i].handle;
+
+      if (!handle || strcmp(libretro_pool[i].path, path))
+         continue;
+
+      memset(&libretro_pool[i], 0, sizeof(libretro_pool[i]));
+      return handle;
+   }
+
+   return NULL;
+}
+#endif
+
+/**
+ * libretro_pool_free:
+ *
+ * Closes all cores kept in the warm pool.
+ **/
+void libretro_pool_free(void)
+{
+#ifdef HAVE_DYNAMIC
+   libretro_pool_trim(0);
+#endif
+}
+
 static void load_symbols(bool is_dummy)
 {
    if (is_dummy)
@@ -307,9 +531,17 @@ static void load_symbols(bool is_dummy)
       path_resolve_realpath(g_settings.libretro,
             sizeof(g_settings.libretro));
 
-      RARCH_LOG("Loading dynamic libretro from: \"%s\"\n",
-            g_settings.libretro);
-      lib_handle = dylib_load(g_settings.libretro);
+      if ((lib_handle = libretro_pool_take(g_settings.libretro)))
+         RARCH_LOG("Reusing pooled libretro from: \"%s\"\n",
+               g_settings.libretro);
+      else
+      {
+         RARCH_LOG("Loading dynamic libretro from: \"%s\"\n",
+               g_settings.libretro);
+         lib_handle = dylib_load(g_settings.libretro);
+      }
+
+      strlcpy(lib_path, g_settings.libretro, sizeof(lib_path));
       if (!lib_handle)
       {
          RARCH_ERR("Failed to open dynamic library: \"%s\"\n",
@@ -354,6 +586,88 @@ static void load_symbols(bool is_dummy)
    }
 }
 
+#ifdef HAVE_DYNAMIC
+#define SYM_INSTANCE(core, x) do { \
+   function_t func = dylib_proc(core->handle, #x); \
+   memcpy(&core->x, &func, sizeof(func)); \
+   if (core->x == NULL) { RARCH_ERR("Failed to load symbol: \"%s\"\n", #x); goto error; } \
+} while (0)
+#endif
+
+/**
+ * libretro_load_instance:
+ * @core                         : Instance to fill in.
+ * @path                         : Path to libretro core library.
+ *
+ * Opens @path with a handle of its own and loads its symbols
+ * into @core. Unlike init_libretro_sym(), failure is not fatal.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool libretro_load_instance(struct retro_core_instance *core,
+      const char *path)
+{
+#ifdef HAVE_DYNAMIC
+   memset(core, 0, sizeof(*core));
+
+   core->handle = dylib_load(path);
+   if (!core->handle)
+      return false;
+
+   SYM_INSTANCE(core, retro_init);
+   SYM_INSTANCE(core, retro_deinit);
+
+   SYM_INSTANCE(core, retro_api_version);
+   SYM_INSTANCE(core, retro_get_system_info);
+   SYM_INSTANCE(core, retro_get_system_av_info);
+
+   SYM_INSTANCE(core, retro_set_environment);
+   SYM_INSTANCE(core, retro_set_video_refresh);
+   SYM_INSTANCE(core, retro_set_audio_sample);
+   SYM_INSTANCE(core, retro_set_audio_sample_batch);
+   SYM_INSTANCE(core, retro_set_input_poll);
+   SYM_INSTANCE(core, retro_set_input_state);
+
+   SYM_INSTANCE(core, retro_set_controller_port_device);
+
+   SYM_INSTANCE(core, retro_reset);
+   SYM_INSTANCE(core, retro_run);
+
+   SYM_INSTANCE(core, retro_serialize_size);
+   SYM_INSTANCE(core, retro_serialize);
+   SYM_INSTANCE(core, retro_unserialize);
+
+   SYM_INSTANCE(core, retro_load_game);
+   SYM_INSTANCE(core, retro_load_game_special);
+   SYM_INSTANCE(core, retro_unload_game);
+
+   return true;
+
+error:
+   libretro_unload_instance(core);
+#else
+   (void)core;
+   (void)path;
+   RARCH_ERR("Cannot load a second core instance without dynamic loading support.\n");
+#endif
+   return false;
+}
+
+/**
+ * libretro_unload_instance:
+ * @core                         : Instance to free.
+ *
+ * Closes the library handle of @core and clears its symbols.
+ **/
+void libretro_unload_instance(struct retro_core_instance *core)
+{
+#ifdef HAVE_DYNAMIC
+   if (core->handle)
+      dylib_close(core->handle);
+#endif
+   memset(core, 0, sizeof(*core));
+}
+
 /**
  * libretro_get_current_core_pathname:
  * @name                         : Sanitized name of libretro core.
@@ -427,7 +741,7 @@ void init_libretro_sym(bool dummy)
 void uninit_libretro_sym(void)
 {
 #ifdef HAVE_DYNAMIC
-   if (lib_handle)
+   if (lib_handle && !libretro_pool_put())
       dylib_close(lib_handle);
    lib_handle = NULL;
 #endif
@@ -1151,6 +1465,24 @@ bool rarch_environment_cb(unsigned cmd, void *data)
          break;
       }
 
+      case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+      {
+         struct retro_framebuffer *fb = (struct retro_framebuffer*)data;
+
+         /* Called every frame, so do not log. Softfiltered 
+          * frames never reach the driver as they are. */
+         if (g_extern.filter.filter || !driver.video_poke
+               || !driver.video_poke->get_current_software_framebuffer)
+            return false;
+
+         if (!driver.video_poke->get_current_software_framebuffer(
+                  driver.video_data, fb))
+            return false;
+
+         fb->format = g_extern.system.pix_fmt;
+         break;
+      }
+
       /* Private extensions for internal use, not part of libretro API. */
       case RETRO_ENVIRONMENT_SET_LIBRETRO_PATH:
          RARCH_LOG("Environ (Private) SET_LIBRETRO_PATH.\n");
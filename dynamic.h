@@ -41,6 +41,8 @@ void init_libretro_sym(bool dummy);
 
 void uninit_libretro_sym(void);
 
+void libretro_pool_free(void);
+
 #ifdef NEED_DYNAMIC
 /**
  * dylib_load:
@@ -125,6 +127,61 @@ const struct retro_controller_description *
    libretro_find_controller_description(
          const struct retro_controller_info *info, unsigned id);
 
+/* A core loaded through its own library handle, independent
+ * of the pretro_* symbols. Used where a second copy of the
+ * running core is needed. */
+struct retro_core_instance
+{
+   dylib_t handle;
+
+   void (*retro_init)(void);
+   void (*retro_deinit)(void);
+   unsigned (*retro_api_version)(void);
+   void (*retro_get_system_info)(struct retro_system_info*);
+   void (*retro_get_system_av_info)(struct retro_system_av_info*);
+   void (*retro_set_environment)(retro_environment_t);
+   void (*retro_set_video_refresh)(retro_video_refresh_t);
+   void (*retro_set_audio_sample)(retro_audio_sample_t);
+   void (*retro_set_audio_sample_batch)(retro_audio_sample_batch_t);
+   void (*retro_set_input_poll)(retro_input_poll_t);
+   void (*retro_set_input_state)(retro_input_state_t);
+   void (*retro_set_controller_port_device)(unsigned, unsigned);
+   void (*retro_reset)(void);
+   void (*retro_run)(void);
+   size_t (*retro_serialize_size)(void);
+   bool (*retro_serialize)(void*, size_t);
+   bool (*retro_unserialize)(const void*, size_t);
+   bool (*retro_load_game)(const struct retro_game_info*);
+   bool (*retro_load_game_special)(unsigned,
+         const struct retro_game_info*, size_t);
+   void (*retro_unload_game)(void);
+};
+
+/**
+ * libretro_load_instance:
+ * @core                         : Instance to fill in.
+ * @path                         : Path to libretro core library.
+ *
+ * Opens @path with a handle of its own and loads its symbols
+ * into @core. Unlike init_libretro_sym(), failure is not fatal.
+ *
+ * The dynamic linker hands out the same handle when a library
+ * is opened twice, so @path must not be the currently 
+ * running core if an independent instance is wanted.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool libretro_load_instance(struct retro_core_instance *core,
+      const char *path);
+
+/**
+ * libretro_unload_instance:
+ * @core                         : Instance to free.
+ *
+ * Closes the library handle of @core and clears its symbols.
+ **/
+void libretro_unload_instance(struct retro_core_instance *core);
+
 extern void (*pretro_init)(void);
 
 extern void (*pretro_deinit)(void);
@@ -14,6 +14,7 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <boolean.h>
 
@@ -26,3 +27,7 @@ void RWebAudioSetNonblockState(bool state);
 void RWebAudioFree(void);
 size_t RWebAudioWriteAvail(void);
 size_t RWebAudioBufferSize(void);
+
+bool RWebAudioWorkletInit(void);
+void RWebAudioWorkletStart(float *ring, unsigned frames, int32_t *pos);
+void RWebAudioWorkletFree(void);
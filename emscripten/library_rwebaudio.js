@@ -74,9 +74,39 @@ var LibraryRWebAudio = {
          do {
             RA.process();
          } while (RA.bufIndex === RA.numBuffers - 1);
-      }
+      },
+
+      workletNode: null,
+
+      // Plays from a ring in the shared heap. pos holds the read
+      // and write frame counters, only the read one is moved here.
+      workletSource:
+         "class RetroArchAudio extends AudioWorkletProcessor {\n" +
+         "   constructor(options) {\n" +
+         "      super();\n" +
+         "      var o = options.processorOptions;\n" +
+         "      this.ring = new Float32Array(o.heap, o.ring, o.frames * 2);\n" +
+         "      this.pos = new Int32Array(o.heap, o.pos, 2);\n" +
+         "      this.mask = o.frames - 1;\n" +
+         "   }\n" +
+         "   process(inputs, outputs) {\n" +
+         "      var left = outputs[0][0], right = outputs[0][1];\n" +
+         "      var read = Atomics.load(this.pos, 0);\n" +
+         "      var avail = (Atomics.load(this.pos, 1) - read) | 0;\n" +
+         "      var count = Math.min(avail, left.length);\n" +
+         "      for (var i = 0; i < count; i++) {\n" +
+         "         var index = ((read + i) & this.mask) * 2;\n" +
+         "         left[i] = this.ring[index];\n" +
+         "         right[i] = this.ring[index + 1];\n" +
+         "      }\n" +
+         "      Atomics.store(this.pos, 0, (read + count) | 0);\n" +
+         "      return true;\n" +
+         "   }\n" +
+         "}\n" +
+         "registerProcessor('retroarch-audio', RetroArchAudio);\n"
    },
 
+   RWebAudioInit__proxy: 'sync',
    RWebAudioInit: function(latency) {
       var ac = window['AudioContext'] || window['webkitAudioContext'];
 
@@ -98,10 +128,57 @@ var LibraryRWebAudio = {
       return 1;
    },
    
+   RWebAudioWorkletInit__proxy: 'sync',
+   RWebAudioWorkletInit: function() {
+      var ac = window['AudioContext'] || window['webkitAudioContext'];
+
+      if (!ac || !ac.prototype.hasOwnProperty('audioWorklet') ||
+            typeof SharedArrayBuffer === 'undefined' ||
+            !(HEAPF32.buffer instanceof SharedArrayBuffer))
+         return 0;
+
+      RA.context = new ac();
+      return 1;
+   },
+
+   RWebAudioWorkletStart__proxy: 'sync',
+   RWebAudioWorkletStart: function(ring, frames, pos) {
+      var url = URL.createObjectURL(new Blob([RA.workletSource],
+               { type: 'application/javascript' }));
+
+      // Frames are only produced once the node plays them.
+      Module["pauseMainLoop"]();
+      RA.context.audioWorklet.addModule(url).then(function() {
+         RA.workletNode = new AudioWorkletNode(RA.context, 'retroarch-audio', {
+            numberOfInputs: 0,
+            outputChannelCount: [2],
+            processorOptions: {
+               heap: HEAPF32.buffer, ring: ring, frames: frames, pos: pos
+            }
+         });
+         RA.workletNode.connect(RA.context.destination);
+         URL.revokeObjectURL(url);
+         Module["resumeMainLoop"]();
+      }, function(err) {
+         Module.printErr('RWebAudio: Could not load the AudioWorklet: ' + err);
+         Module["resumeMainLoop"]();
+      });
+   },
+
+   RWebAudioWorkletFree__proxy: 'sync',
+   RWebAudioWorkletFree: function() {
+      if (RA.workletNode) RA.workletNode.disconnect();
+      RA.workletNode = null;
+      if (RA.context) RA.context.close();
+      RA.context = null;
+   },
+
+   RWebAudioSampleRate__proxy: 'sync',
    RWebAudioSampleRate: function() {
       return RA.context.sampleRate;
    },
 
+   RWebAudioWrite__proxy: 'sync',
    RWebAudioWrite: function (buf, size) {
       RA.process();
       var samples = size / 8;
@@ -125,30 +202,36 @@ var LibraryRWebAudio = {
       return count * 8;
    },
 
+   RWebAudioStop__proxy: 'sync',
    RWebAudioStop: function() {
       RA.bufIndex = 0;
       RA.bufOffset = 0;
       return true;
    },
 
+   RWebAudioStart__proxy: 'sync',
    RWebAudioStart: function() {
       return true;
    },
 
+   RWebAudioSetNonblockState__proxy: 'sync',
    RWebAudioSetNonblockState: function(state) {
       RA.nonblock = state;
    },
 
+   RWebAudioFree__proxy: 'sync',
    RWebAudioFree: function() {
       RA.bufIndex = 0;
       RA.bufOffset = 0;
       return;
    },
 
+   RWebAudioBufferSize__proxy: 'sync',
    RWebAudioBufferSize: function() {
       return RA.numBuffers * RA.BUFFER_SIZE + RA.BUFFER_SIZE;
    },
 
+   RWebAudioWriteAvail__proxy: 'sync',
    RWebAudioWriteAvail: function() {
       RA.process();
       return ((RA.numBuffers - RA.bufIndex) * RA.BUFFER_SIZE - RA.bufOffset) * 8;
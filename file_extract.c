@@ -23,6 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <zlib.h>
 
@@ -43,7 +46,6 @@ struct zlib_file_backend
 
 #ifdef HAVE_MMAP
 #include <sys/mman.h>
-#include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
@@ -204,7 +206,7 @@ static uint32_t read_le(const uint8_t *data, unsigned size)
 
    size *= 8;
    for (i = 0; i < size; i += 8)
-      val |= *data++ << i;
+      val |= (uint32_t)*data++ << i;
 
    return val;
 }
@@ -358,77 +360,545 @@ end:
    return ret;
 }
 
-struct zip_extract_userdata
+/* Central directories of recently used archives are kept
+ * parsed, so browsing and loading from an archive does not walk
+ * it again for every query. Entries are found by name with a
+ * binary search and extracted on their own, by seeking to them.
+ * Only used from the main thread, like everything else here. */
+
+#define ZLIB_INDEX_CACHE_SIZE 4
+#define ZLIB_INDEX_CHUNK_SIZE (64 * 1024)
+
+struct zlib_index_entry
 {
-   char *zip_path;
-   const char *extraction_directory;
-   size_t zip_path_size;
-   struct string_list *ext;
-   bool found_content;
+   const char *name;
+   uint32_t offset; /* Of the local file header. */
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+   unsigned cmode;
 };
 
-static bool zip_extract_cb(const char *name, const uint8_t *cdata,
-      unsigned cmode, uint32_t csize, uint32_t size,
-      uint32_t checksum, void *userdata)
+struct zlib_index
 {
-   struct zip_extract_userdata *data = (struct zip_extract_userdata*)userdata;
+   char path[PATH_MAX_LENGTH];
+   time_t mtime;
+   off_t file_size;
+   unsigned last_used;
+
+   /* In archive order. */
+   struct zlib_index_entry *entries;
+   /* By name, for zlib_index_find(). */
+   struct zlib_index_entry **sorted;
+   size_t count;
+   char *names;
+};
 
-   /* Extract first content that matches our list. */
-   const char *ext = path_get_extension(name);
+static struct zlib_index *zlib_index_cache[ZLIB_INDEX_CACHE_SIZE];
+static unsigned zlib_index_clock;
 
-   if (ext && string_list_find_elem(data->ext, ext))
+static void zlib_index_free(struct zlib_index *index)
+{
+   if (!index)
+      return;
+
+   free(index->entries);
+   free(index->sorted);
+   free(index->names);
+   free(index);
+}
+
+static int zlib_index_compare(const void *a, const void *b)
+{
+   const struct zlib_index_entry *entry_a =
+      *(const struct zlib_index_entry**)a;
+   const struct zlib_index_entry *entry_b =
+      *(const struct zlib_index_entry**)b;
+
+   return strcmp(entry_a->name, entry_b->name);
+}
+
+static bool zlib_index_read_at(FILE *file, long offset,
+      void *data, size_t size)
+{
+   if (fseek(file, offset, SEEK_SET) != 0)
+      return false;
+   return fread(data, 1, size, file) == size;
+}
+
+/**
+ * zlib_index_parse:
+ * @path                        : filename path of archive.
+ * @st                          : stat() of the archive.
+ *
+ * Reads the central directory of a ZIP archive. Nothing but the
+ * end of central directory record and the directory itself is
+ * read.
+ *
+ * Returns: index on success, otherwise NULL.
+ **/
+static struct zlib_index *zlib_index_parse(const char *path,
+      const struct stat *st)
+{
+   size_t tail_size, names_size = 0;
+   uint32_t directory_size, directory_offset;
+   unsigned count;
+   const uint8_t *footer          = NULL;
+   uint8_t *tail                  = NULL;
+   uint8_t *directory             = NULL;
+   const uint8_t *record          = NULL;
+   struct zlib_index *index       = NULL;
+   FILE *file                     = NULL;
+
+   if (st->st_size < 22)
+      return NULL;
+
+   file = fopen(path, "rb");
+   if (!file)
+      return NULL;
+
+   /* The end record is followed by at most a 64K comment. */
+   tail_size = st->st_size < 22 + 0xffff ? (size_t)st->st_size : 22 + 0xffff;
+   tail      = (uint8_t*)malloc(tail_size);
+   if (!tail || !zlib_index_read_at(file,
+            (long)(st->st_size - tail_size), tail, tail_size))
+      goto error;
+
+   for (footer = tail + tail_size - 22; ; footer--)
    {
-      char new_path[PATH_MAX_LENGTH];
+      if (read_le(footer, 4) == 0x06054b50
+            && footer + 22 + read_le(footer + 20, 2) == tail + tail_size)
+         break;
+      if (footer == tail)
+         goto error;
+   }
 
-      if (data->extraction_directory)
-         fill_pathname_join(new_path, data->extraction_directory,
-               path_basename(name), sizeof(new_path));
-      else
-         fill_pathname_resolve_relative(new_path, data->zip_path,
-               path_basename(name), sizeof(new_path));
+   count            = read_le(footer + 10, 2);
+   directory_size   = read_le(footer + 12, 4);
+   directory_offset = read_le(footer + 16, 4);
+
+   if ((off_t)directory_offset + directory_size > st->st_size)
+      goto error;
+
+   directory = (uint8_t*)malloc(directory_size);
+   index     = (struct zlib_index*)calloc(1, sizeof(*index));
+   if (!directory || !index || !zlib_index_read_at(file,
+            directory_offset, directory, directory_size))
+      goto error;
+
+   index->entries = (struct zlib_index_entry*)
+      calloc(count + 1, sizeof(*index->entries));
+   index->sorted  = (struct zlib_index_entry**)
+      calloc(count + 1, sizeof(*index->sorted));
+   /* Names are shorter than the records holding them. */
+   index->names   = (char*)malloc(directory_size + 1);
+   if (!index->entries || !index->sorted || !index->names)
+      goto error;
+
+   for (record = directory; index->count < count; )
+   {
+      struct zlib_index_entry *entry = &index->entries[index->count];
+      unsigned namelength, extralength, commentlength;
+
+      if (record + 46 > directory + directory_size
+            || read_le(record + 0, 4) != 0x02014b50)
+         break;
+
+      namelength    = read_le(record + 28, 2);
+      extralength   = read_le(record + 30, 2);
+      commentlength = read_le(record + 32, 2);
+
+      if (record + 46 + namelength > directory + directory_size)
+         break;
+
+      entry->cmode  = read_le(record + 10, 2);
+      entry->crc32  = read_le(record + 16, 4);
+      entry->csize  = read_le(record + 20, 4);
+      entry->size   = read_le(record + 24, 4);
+      entry->offset = read_le(record + 42, 4);
+
+      memcpy(index->names + names_size, record + 46, namelength);
+      index->names[names_size + namelength] = '\0';
+      entry->name = index->names + names_size;
+      names_size += namelength + 1;
 
-      switch (cmode)
+      index->sorted[index->count++] = entry;
+      record += 46 + namelength + extralength + commentlength;
+   }
+
+   qsort(index->sorted, index->count, sizeof(*index->sorted),
+         zlib_index_compare);
+
+   strlcpy(index->path, path, sizeof(index->path));
+   index->mtime     = st->st_mtime;
+   index->file_size = st->st_size;
+
+   free(tail);
+   free(directory);
+   fclose(file);
+   return index;
+
+error:
+   RARCH_ERR("Could not read ZIP central directory of %s.\n", path);
+   zlib_index_free(index);
+   free(tail);
+   free(directory);
+   fclose(file);
+   return NULL;
+}
+
+/**
+ * zlib_index_get:
+ * @path                        : filename path of archive.
+ *
+ * Looks up the index of an archive in the cache, parsing it
+ * if it is not there or the archive changed on disk. The index
+ * stays valid until the next call.
+ *
+ * Returns: index on success, otherwise NULL.
+ **/
+static struct zlib_index *zlib_index_get(const char *path)
+{
+   unsigned i, slot = 0;
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return NULL;
+
+   for (i = 0; i < ZLIB_INDEX_CACHE_SIZE; i++)
+   {
+      struct zlib_index *index = zlib_index_cache[i];
+
+      if (!index)
       {
-         /* Uncompressed. */
-         case 0:
-            data->found_content = write_file(new_path, cdata, size);
-            return false;
-         /* Deflate. */
-         case 8:
-            if (zlib_inflate_data_to_file(new_path, cdata, csize, size, checksum))
+         slot = i;
+         continue;
+      }
+
+      if (!strcmp(index->path, path))
+      {
+         if (index->mtime == st.st_mtime && index->file_size == st.st_size)
+         {
+            index->last_used = ++zlib_index_clock;
+            return index;
+         }
+
+         /* Changed since, parse it again. */
+         slot = i;
+         break;
+      }
+
+      if (zlib_index_cache[slot] &&
+            index->last_used < zlib_index_cache[slot]->last_used)
+         slot = i;
+   }
+
+   zlib_index_free(zlib_index_cache[slot]);
+   zlib_index_cache[slot] = zlib_index_parse(path, &st);
+
+   if (zlib_index_cache[slot])
+      zlib_index_cache[slot]->last_used = ++zlib_index_clock;
+   return zlib_index_cache[slot];
+}
+
+static const struct zlib_index_entry *zlib_index_find(
+      const struct zlib_index *index, const char *name)
+{
+   struct zlib_index_entry key, *key_ptr = &key;
+   struct zlib_index_entry **found = NULL;
+
+   key.name = name;
+   found = (struct zlib_index_entry**)bsearch(&key_ptr, index->sorted,
+         index->count, sizeof(*index->sorted), zlib_index_compare);
+
+   return found ? *found : NULL;
+}
+
+/**
+ * zlib_index_extract:
+ * @file                        : the archive.
+ * @entry                       : entry to extract.
+ * @out_data                    : buffer of entry->size + 1 bytes
+ *                                to extract to, or NULL.
+ * @out_file                    : file to extract to if @out_data
+ *                                is NULL.
+ *
+ * Reads, inflates and checks one entry, in chunks.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool zlib_index_extract(FILE *file,
+      const struct zlib_index_entry *entry,
+      uint8_t *out_data, FILE *out_file)
+{
+   uint8_t header[30];
+   uint32_t remaining = entry->csize, checksum = 0, written = 0;
+   z_stream stream    = {0};
+   uint8_t *in_chunk  = NULL;
+   uint8_t *out_chunk = NULL;
+   bool ret           = false;
+   int z_ret          = Z_OK;
+
+   if (entry->cmode != 0 && entry->cmode != 8)
+   {
+      RARCH_ERR("Unsupported ZIP compression method %u.\n", entry->cmode);
+      return false;
+   }
+
+   if (!zlib_index_read_at(file, entry->offset, header, sizeof(header))
+         || read_le(header, 4) != 0x04034b50)
+      return false;
+
+   if (fseek(file, (long)entry->offset + 30 + read_le(header + 26, 2)
+            + read_le(header + 28, 2), SEEK_SET) != 0)
+      return false;
+
+   in_chunk = (uint8_t*)malloc(ZLIB_INDEX_CHUNK_SIZE);
+   if (!out_data)
+      out_chunk = (uint8_t*)malloc(ZLIB_INDEX_CHUNK_SIZE);
+   if (!in_chunk || (!out_data && !out_chunk))
+      goto end;
+
+   if (entry->cmode == 8 && inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+      goto end;
+
+   while (remaining || (entry->cmode == 8 && z_ret != Z_STREAM_END))
+   {
+      size_t in_size = remaining < ZLIB_INDEX_CHUNK_SIZE ?
+         remaining : ZLIB_INDEX_CHUNK_SIZE;
+
+      if (fread(in_chunk, 1, in_size, file) != in_size)
+         break;
+      remaining -= in_size;
+
+      stream.next_in  = in_chunk;
+      stream.avail_in = in_size;
+
+      do
+      {
+         uint8_t *out  = out_data ? out_data + written : out_chunk;
+         /* One byte spare, to tell an oversized entry apart. */
+         uInt out_size = out_data ? entry->size + 1 - written :
+            ZLIB_INDEX_CHUNK_SIZE;
+         uInt produced;
+
+         if (entry->cmode == 0)
+         {
+            produced = stream.avail_in < out_size ?
+               stream.avail_in : out_size;
+            memcpy(out, stream.next_in, produced);
+            stream.next_in  += produced;
+            stream.avail_in -= produced;
+         }
+         else
+         {
+            stream.next_out  = out;
+            stream.avail_out = out_size;
+            z_ret = inflate(&stream, Z_NO_FLUSH);
+            if (z_ret == Z_BUF_ERROR)
             {
-               strlcpy(data->zip_path, new_path, data->zip_path_size);
-               data->found_content = true;
-               return false;
+               /* Needs more input. */
+               z_ret = Z_OK;
+               break;
             }
-            return false;
+            if (z_ret != Z_OK && z_ret != Z_STREAM_END)
+               goto end;
+            produced = out_size - stream.avail_out;
+         }
+
+         if (!produced)
+         {
+            /* A stored entry or the output is over. */
+            if (stream.avail_in)
+               goto end;
+            break;
+         }
 
-         default:
-            return false;
+         checksum = crc32_update(checksum, out, produced);
+         written += produced;
+
+         if (!out_data && fwrite(out, 1, produced, out_file) != produced)
+            goto end;
+      } while (stream.avail_in || (entry->cmode == 8
+               && !stream.avail_out && z_ret != Z_STREAM_END));
+
+      if (!in_size)
+         break;
+   }
+
+   if (written != entry->size)
+      goto end;
+
+   if (checksum != entry->crc32)
+      RARCH_WARN("File CRC differs from ZIP CRC. File: 0x%x, ZIP: 0x%x.\n",
+            (unsigned)checksum, (unsigned)entry->crc32);
+
+   ret = true;
+
+end:
+   if (entry->cmode == 8)
+      inflateEnd(&stream);
+   free(in_chunk);
+   free(out_chunk);
+   return ret;
+}
+
+/**
+ * zlib_index_foreach:
+ * @path                        : filename path of archive.
+ * @cb                          : called for each entry in archive
+ *                                order, returns false to stop.
+ * @userdata                    : userdata to pass to @cb.
+ *
+ * Enumerates the entries of an archive from its cached index.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool zlib_index_foreach(const char *path, zlib_index_cb cb, void *userdata)
+{
+   size_t i;
+   struct zlib_index *index = zlib_index_get(path);
+
+   if (!index)
+      return false;
+
+   for (i = 0; i < index->count; i++)
+   {
+      const struct zlib_index_entry *entry = &index->entries[i];
+      if (!cb(entry->name, entry->size, entry->crc32, userdata))
+         break;
+   }
+
+   return true;
+}
+
+/**
+ * zlib_index_read_file:
+ * @path                        : filename path of archive.
+ * @name                        : entry to extract.
+ * @buf                         : set to the extracted entry, which
+ *                                needs to be freed manually. 
+ *                                Not used if @optional_outfile is set.
+ * @optional_outfile            : file to extract to instead.
+ *
+ * Extracts one entry of an archive, found through its cached
+ * index.
+ *
+ * Returns: size of the entry, 0 when extracted to
+ * @optional_outfile, -1 on error.
+ **/
+long zlib_index_read_file(const char *path, const char *name,
+      void **buf, const char *optional_outfile)
+{
+   const struct zlib_index_entry *entry = NULL;
+   struct zlib_index *index = zlib_index_get(path);
+   uint8_t *data = NULL;
+   FILE *file = NULL, *out_file = NULL;
+   long ret = -1;
+
+   if (!index)
+      return -1;
+
+   entry = zlib_index_find(index, name);
+   if (!entry)
+   {
+      RARCH_ERR("File %s not found in %s\n", name, path);
+      return -1;
+   }
+
+   file = fopen(path, "rb");
+   if (!file)
+   {
+      RARCH_ERR("Could not open ZIP file %s.\n", path);
+      return -1;
+   }
+
+   if (optional_outfile)
+   {
+      out_file = fopen(optional_outfile, "wb");
+      if (!out_file)
+      {
+         RARCH_ERR("Could not open outfilepath %s.\n", optional_outfile);
+         goto end;
       }
    }
+   else
+   {
+      data = (uint8_t*)malloc(entry->size + 1);
+      if (!data)
+         goto end;
+   }
+
+   if (!zlib_index_extract(file, entry, data, out_file))
+   {
+      RARCH_ERR("The file %s in %s could not be read.\n", name, path);
+      goto end;
+   }
+
+   if (data)
+   {
+      /* Terminated, like read_file() does. */
+      data[entry->size] = '\0';
+      *buf = data;
+      data = NULL;
+      ret  = entry->size;
+   }
+   else
+      ret = 0;
+
+end:
+   free(data);
+   if (out_file)
+      fclose(out_file);
+   fclose(file);
+   return ret;
+}
+
+struct zip_extract_userdata
+{
+   char name[PATH_MAX_LENGTH];
+   struct string_list *ext;
+   bool found_content;
+};
+
+static bool zip_extract_cb(const char *name, uint32_t size,
+      uint32_t crc32, void *userdata)
+{
+   struct zip_extract_userdata *data = (struct zip_extract_userdata*)userdata;
+
+   /* Extract first content that matches our list. */
+   const char *ext = path_get_extension(name);
+
+   (void)size;
+   (void)crc32;
+
+   if (ext && string_list_find_elem(data->ext, ext))
+   {
+      strlcpy(data->name, name, sizeof(data->name));
+      data->found_content = true;
+      return false;
+   }
 
    return true;
 }
 
 /**
- * zlib_extract_first_content_file:
+ * zlib_find_first_content_file:
  * @zip_path                    : filename path to ZIP archive.
- * @zip_path_size               : size of ZIP archive.
  * @valid_exts                  : valid extensions for a content file.
- * @extraction_directory        : the directory to extract temporary
- *                                unzipped content to.
+ * @name                        : set to the name of the entry.
+ * @name_size                   : size of @name.
  *
- * Extract first content file from archive.
+ * Finds the first content file in archive order.
  *
  * Returns : true (1) on success, otherwise false (0).
  **/
-bool zlib_extract_first_content_file(char *zip_path, size_t zip_path_size,
-      const char *valid_exts, const char *extraction_directory)
+static bool zlib_find_first_content_file(const char *zip_path,
+      const char *valid_exts, char *name, size_t name_size)
 {
    struct string_list *list;
    bool ret = true;
-   struct zip_extract_userdata userdata = {0};
+   struct zip_extract_userdata userdata = {{0}};
 
    if (!valid_exts)
    {
@@ -440,12 +910,9 @@ bool zlib_extract_first_content_file(char *zip_path, size_t zip_path_size,
    if (!list)
       GOTO_END_ERROR();
 
-   userdata.zip_path = zip_path;
-   userdata.zip_path_size = zip_path_size;
-   userdata.extraction_directory = extraction_directory;
    userdata.ext = list;
 
-   if (!zlib_parse_file(zip_path, zip_extract_cb, &userdata))
+   if (!zlib_index_foreach(zip_path, zip_extract_cb, &userdata))
    {
       RARCH_ERR("Parsing ZIP failed.\n");
       GOTO_END_ERROR();
@@ -457,24 +924,82 @@ bool zlib_extract_first_content_file(char *zip_path, size_t zip_path_size,
       GOTO_END_ERROR();
    }
 
+   strlcpy(name, userdata.name, name_size);
+
 end:
    if (list)
       string_list_free(list);
    return ret;
 }
 
-static bool zlib_get_file_list_cb(const char *path, const uint8_t *cdata,
-      unsigned cmode, uint32_t csize, uint32_t size, uint32_t checksum,
-      void *userdata)
+/**
+ * zlib_extract_first_content_file:
+ * @zip_path                    : filename path to ZIP archive.
+ * @zip_path_size               : size of ZIP archive.
+ * @valid_exts                  : valid extensions for a content file.
+ * @extraction_directory        : the directory to extract temporary
+ *                                unzipped content to.
+ *
+ * Extract first content file from archive.
+ *
+ * Returns : true (1) on success, otherwise false (0).
+ **/
+bool zlib_extract_first_content_file(char *zip_path, size_t zip_path_size,
+      const char *valid_exts, const char *extraction_directory)
+{
+   char name[PATH_MAX_LENGTH], new_path[PATH_MAX_LENGTH];
+
+   if (!zlib_find_first_content_file(zip_path, valid_exts,
+            name, sizeof(name)))
+      return false;
+
+   if (extraction_directory)
+      fill_pathname_join(new_path, extraction_directory,
+            path_basename(name), sizeof(new_path));
+   else
+      fill_pathname_resolve_relative(new_path, zip_path,
+            path_basename(name), sizeof(new_path));
+
+   if (zlib_index_read_file(zip_path, name, NULL, new_path) < 0)
+      return false;
+
+   strlcpy(zip_path, new_path, zip_path_size);
+   return true;
+}
+
+/**
+ * zlib_get_first_content_path:
+ * @zip_path                    : filename path to ZIP archive.
+ * @zip_path_size               : size of ZIP archive.
+ * @valid_exts                  : valid extensions for a content file.
+ *
+ * Points @zip_path at the first content file inside the archive,
+ * as "archive.zip#file", which read_file() then inflates straight
+ * into memory. Nothing is extracted to disk.
+ *
+ * Returns : true (1) on success, otherwise false (0).
+ **/
+bool zlib_get_first_content_path(char *zip_path, size_t zip_path_size,
+      const char *valid_exts)
+{
+   char name[PATH_MAX_LENGTH];
+
+   if (!zlib_find_first_content_file(zip_path, valid_exts,
+            name, sizeof(name)))
+      return false;
+
+   strlcat(zip_path, "#", zip_path_size);
+   return strlcat(zip_path, name, zip_path_size) < zip_path_size;
+}
+
+static bool zlib_get_file_list_cb(const char *path, uint32_t size,
+      uint32_t crc32, void *userdata)
 {
    union string_list_elem_attr attr;
    struct string_list *list = (struct string_list*)userdata;
 
-   (void)cdata;
-   (void)cmode;
-   (void)csize;
    (void)size;
-   (void)checksum;
+   (void)crc32;
 
    memset(&attr, 0, sizeof(attr));
 
@@ -489,12 +1014,12 @@ static bool zlib_get_file_list_cb(const char *path, const uint8_t *cdata,
  **/
 struct string_list *zlib_get_file_list(const char *path)
 {
-   struct string_list *list = string_list_new();
+   struct string_list *list = string_list_new_arena();
 
    if (!list)
       return NULL;
 
-   if (!zlib_parse_file(path, zlib_get_file_list_cb, list))
+   if (!zlib_index_foreach(path, zlib_get_file_list_cb, list))
    {
       RARCH_ERR("Parsing ZIP failed.\n");
       string_list_free(list);
@@ -521,3 +1046,460 @@ struct string_list *compressed_file_list_new(const char *path,
 #endif
    return NULL;
 }
+
+enum zlib_stream_state
+{
+   ZLIB_STREAM_HEADER = 0,
+   ZLIB_STREAM_DATA,
+   ZLIB_STREAM_DESCRIPTOR,
+   ZLIB_STREAM_DONE,
+   /* Left to zlib_stream_extract_end(), from the central directory. */
+   ZLIB_STREAM_DEFERRED,
+   ZLIB_STREAM_ERROR
+};
+
+#define ZIP_LOCAL_HEADER_SIG   0x04034b50
+#define ZIP_DESCRIPTOR_SIG     0x08074b50
+#define ZIP_CENTRAL_HEADER_SIG 0x02014b50
+#define ZIP_END_SIG            0x06054b50
+
+/* Set when sizes and CRC follow the data instead. */
+#define ZIP_FLAG_DESCRIPTOR    (1 << 3)
+
+struct zlib_stream_extract
+{
+   enum zlib_stream_state state;
+   char dir[PATH_MAX_LENGTH];
+
+   /* Local header or data descriptor being put together. */
+   uint8_t *head;
+   size_t head_len;
+   size_t head_need;
+   size_t head_cap;
+
+   /* Entry being extracted. */
+   char path[PATH_MAX_LENGTH];
+   FILE *file;
+   unsigned flags;
+   unsigned method;
+   uint32_t crc;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t real_crc;
+   uint32_t real_size;
+   bool inflating;
+   z_stream stream;
+   uint8_t out[64 * 1024];
+};
+
+zlib_stream_extract_t *zlib_stream_extract_new(const char *dir)
+{
+   zlib_stream_extract_t *handle = (zlib_stream_extract_t*)
+      calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   strlcpy(handle->dir, dir, sizeof(handle->dir));
+   handle->head_need = 4;
+   return handle;
+}
+
+static bool zlib_stream_close(zlib_stream_extract_t *handle, bool ok)
+{
+   if (handle->inflating)
+      inflateEnd(&handle->stream);
+   handle->inflating = false;
+
+   if (handle->file)
+   {
+      if (fclose(handle->file) != 0)
+         ok = false;
+      handle->file = NULL;
+
+      if (!ok)
+         remove(handle->path);
+   }
+
+   return ok;
+}
+
+static void zlib_stream_fail(zlib_stream_extract_t *handle, const char *why)
+{
+   RARCH_ERR("Failed to extract \"%s\": %s.\n", handle->path, why);
+   zlib_stream_close(handle, false);
+   handle->state = ZLIB_STREAM_ERROR;
+}
+
+static bool zlib_stream_write(zlib_stream_extract_t *handle,
+      const uint8_t *data, size_t len)
+{
+   if (fwrite(data, 1, len, handle->file) != len)
+   {
+      zlib_stream_fail(handle, "write error");
+      return false;
+   }
+
+   handle->real_crc   = crc32_update(handle->real_crc, data, len);
+   handle->real_size += len;
+   return true;
+}
+
+/* Keeps entries from writing anywhere but under the directory. */
+static bool zlib_stream_name_valid(const char *name)
+{
+   const char *part;
+
+   if (!*name || *name == '/' || strchr(name, '\\') || strchr(name, ':'))
+      return false;
+
+   for (part = name; part; part = strchr(part, '/'))
+   {
+      if (*part == '/')
+         part++;
+      if (part[0] == '.' && part[1] == '.' && (!part[2] || part[2] == '/'))
+         return false;
+   }
+
+   return true;
+}
+
+static bool zlib_stream_mkdir_parent(const char *path)
+{
+   char parent[PATH_MAX_LENGTH];
+
+   strlcpy(parent, path, sizeof(parent));
+   path_basedir(parent);
+   return !*parent || path_is_directory(parent) || path_mkdir(parent);
+}
+
+static void zlib_stream_entry_end(zlib_stream_extract_t *handle)
+{
+   if (handle->real_crc != handle->crc || handle->real_size != handle->size)
+   {
+      zlib_stream_fail(handle, "CRC or size mismatch");
+      return;
+   }
+
+   if (!zlib_stream_close(handle, true))
+   {
+      handle->state = ZLIB_STREAM_ERROR;
+      return;
+   }
+
+   handle->state     = ZLIB_STREAM_HEADER;
+   handle->head_len  = 0;
+   handle->head_need = 4;
+}
+
+static void zlib_stream_entry_begin(zlib_stream_extract_t *handle)
+{
+   char name[PATH_MAX_LENGTH];
+   const uint8_t *head = handle->head;
+   unsigned name_len   = read_le(head + 26, 2);
+
+   handle->flags     = read_le(head + 6, 2);
+   handle->method    = read_le(head + 8, 2);
+   handle->crc       = read_le(head + 14, 4);
+   handle->csize     = read_le(head + 18, 4);
+   handle->size      = read_le(head + 22, 4);
+   handle->real_crc  = 0;
+   handle->real_size = 0;
+
+   if (name_len >= sizeof(name))
+      name_len = sizeof(name) - 1;
+   memcpy(name, head + 30, name_len);
+   name[name_len] = '\0';
+   fill_pathname_join(handle->path, handle->dir, name, sizeof(handle->path));
+
+   if (!zlib_stream_name_valid(name))
+   {
+      zlib_stream_fail(handle, "bad file name");
+      return;
+   }
+
+   if (handle->flags & 1)
+   {
+      zlib_stream_fail(handle, "encrypted");
+      return;
+   }
+
+   if (name[name_len - 1] == '/')
+   {
+      if (!path_is_directory(handle->path) && !path_mkdir(handle->path))
+      {
+         handle->state = ZLIB_STREAM_ERROR;
+         return;
+      }
+
+      /* Directories have no data, but may still have a descriptor. */
+      handle->head_len  = 0;
+      handle->head_need = 4;
+      if (handle->flags & ZIP_FLAG_DESCRIPTOR)
+         handle->state = ZLIB_STREAM_DESCRIPTOR;
+      return;
+   }
+
+   /* Stored data has nothing telling where it stops when
+    * the sizes come after it, and ZIP64 is not handled. */
+   if ((handle->method != 0 && handle->method != 8)
+         || (handle->method == 0 && (handle->flags & ZIP_FLAG_DESCRIPTOR))
+         || handle->csize == 0xffffffff || handle->size == 0xffffffff)
+   {
+      RARCH_WARN("Cannot extract \"%s\" as it comes in, "
+            "waiting for the whole archive.\n", handle->path);
+      handle->state = ZLIB_STREAM_DEFERRED;
+      return;
+   }
+
+   if (!zlib_stream_mkdir_parent(handle->path))
+   {
+      handle->state = ZLIB_STREAM_ERROR;
+      return;
+   }
+
+   handle->file = fopen(handle->path, "wb");
+   if (!handle->file)
+   {
+      zlib_stream_fail(handle, "cannot open file");
+      return;
+   }
+
+   if (handle->method == 8)
+   {
+      memset(&handle->stream, 0, sizeof(handle->stream));
+      if (inflateInit2(&handle->stream, -MAX_WBITS) != Z_OK)
+      {
+         zlib_stream_fail(handle, "inflateInit2() failed");
+         return;
+      }
+      handle->inflating = true;
+   }
+
+   handle->state = ZLIB_STREAM_DATA;
+
+   if (handle->method == 0 && !handle->csize)
+      zlib_stream_entry_end(handle);
+}
+
+/* Returns how much of @data the entry took. */
+static size_t zlib_stream_data(zlib_stream_extract_t *handle,
+      const uint8_t *data, size_t len)
+{
+   int ret;
+   size_t avail = len;
+
+   if (!(handle->flags & ZIP_FLAG_DESCRIPTOR) && avail > handle->csize)
+      avail = handle->csize;
+
+   if (handle->method == 0)
+   {
+      if (!zlib_stream_write(handle, data, avail))
+         return 0;
+      handle->csize -= avail;
+      if (!handle->csize)
+         zlib_stream_entry_end(handle);
+      return avail;
+   }
+
+   handle->stream.next_in  = (uint8_t*)data;
+   handle->stream.avail_in = avail;
+
+   do
+   {
+      handle->stream.next_out  = handle->out;
+      handle->stream.avail_out = sizeof(handle->out);
+
+      ret = inflate(&handle->stream, Z_NO_FLUSH);
+      if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+      {
+         zlib_stream_fail(handle, "corrupt data");
+         return 0;
+      }
+
+      if (!zlib_stream_write(handle, handle->out,
+               sizeof(handle->out) - handle->stream.avail_out))
+         return 0;
+   } while (ret != Z_STREAM_END
+         && (handle->stream.avail_in || !handle->stream.avail_out));
+
+   avail -= handle->stream.avail_in;
+   if (!(handle->flags & ZIP_FLAG_DESCRIPTOR))
+      handle->csize -= avail;
+
+   if (ret == Z_STREAM_END)
+   {
+      inflateEnd(&handle->stream);
+      handle->inflating = false;
+
+      if (handle->flags & ZIP_FLAG_DESCRIPTOR)
+      {
+         handle->state     = ZLIB_STREAM_DESCRIPTOR;
+         handle->head_len  = 0;
+         handle->head_need = 4;
+      }
+      else if (handle->csize)
+         zlib_stream_fail(handle, "data past the end of the stream");
+      else
+         zlib_stream_entry_end(handle);
+   }
+   else if (!(handle->flags & ZIP_FLAG_DESCRIPTOR) && !handle->csize)
+      zlib_stream_fail(handle, "truncated data");
+
+   return avail;
+}
+
+/* A local header or data descriptor is complete. */
+static void zlib_stream_head(zlib_stream_extract_t *handle)
+{
+   uint32_t sig = read_le(handle->head, 4);
+
+   if (handle->state == ZLIB_STREAM_DESCRIPTOR)
+   {
+      unsigned offset = (sig == ZIP_DESCRIPTOR_SIG) ? 4 : 0;
+
+      if (handle->head_len < 12u + offset)
+      {
+         handle->head_need = 12 + offset;
+         return;
+      }
+
+      handle->crc  = read_le(handle->head + offset, 4);
+      handle->size = read_le(handle->head + offset + 8, 4);
+      zlib_stream_entry_end(handle);
+      return;
+   }
+
+   if (handle->head_len == 4)
+   {
+      /* The central directory has nothing we need. */
+      if (sig == ZIP_CENTRAL_HEADER_SIG || sig == ZIP_END_SIG)
+         handle->state = ZLIB_STREAM_DONE;
+      else if (sig != ZIP_LOCAL_HEADER_SIG)
+         zlib_stream_fail(handle, "not a ZIP archive");
+      else
+         handle->head_need = 30;
+      return;
+   }
+
+   if (handle->head_len == 30)
+   {
+      handle->head_need = 30 + read_le(handle->head + 26, 2)
+         + read_le(handle->head + 28, 2);
+      if (handle->head_need > 30)
+         return;
+   }
+
+   zlib_stream_entry_begin(handle);
+}
+
+bool zlib_stream_extract_push(zlib_stream_extract_t *handle,
+      const uint8_t *data, size_t len)
+{
+   while (len)
+   {
+      size_t used;
+
+      switch (handle->state)
+      {
+         case ZLIB_STREAM_HEADER:
+         case ZLIB_STREAM_DESCRIPTOR:
+            if (handle->head_need > handle->head_cap)
+            {
+               uint8_t *head = (uint8_t*)realloc(handle->head,
+                     handle->head_need);
+               if (!head)
+               {
+                  handle->state = ZLIB_STREAM_ERROR;
+                  return false;
+               }
+               handle->head     = head;
+               handle->head_cap = handle->head_need;
+            }
+
+            used = handle->head_need - handle->head_len;
+            if (used > len)
+               used = len;
+            memcpy(handle->head + handle->head_len, data, used);
+            handle->head_len += used;
+
+            if (handle->head_len == handle->head_need)
+               zlib_stream_head(handle);
+            break;
+
+         case ZLIB_STREAM_DATA:
+            used = zlib_stream_data(handle, data, len);
+            break;
+
+         case ZLIB_STREAM_DONE:
+         case ZLIB_STREAM_DEFERRED:
+            return true;
+
+         default:
+            return false;
+      }
+
+      data += used;
+      len  -= used;
+   }
+
+   return handle->state != ZLIB_STREAM_ERROR;
+}
+
+static bool zlib_stream_deferred_cb(const char *name, const uint8_t *cdata,
+      unsigned cmode, uint32_t csize, uint32_t size, uint32_t crc32,
+      void *userdata)
+{
+   bool ok = false;
+   zlib_stream_extract_t *handle = (zlib_stream_extract_t*)userdata;
+
+   fill_pathname_join(handle->path, handle->dir, name, sizeof(handle->path));
+
+   if (!zlib_stream_name_valid(name))
+   {
+      zlib_stream_fail(handle, "bad file name");
+      return false;
+   }
+
+   if (name[strlen(name) - 1] == '/')
+      ok = path_is_directory(handle->path) || path_mkdir(handle->path);
+   else if (zlib_stream_mkdir_parent(handle->path))
+   {
+      if (cmode == 0)
+         ok = write_file(handle->path, cdata, size);
+      else if (cmode == 8)
+         ok = zlib_inflate_data_to_file(handle->path, cdata,
+               csize, size, crc32);
+   }
+
+   if (!ok)
+   {
+      zlib_stream_fail(handle, "cannot extract");
+      return false;
+   }
+
+   return true;
+}
+
+bool zlib_stream_extract_end(zlib_stream_extract_t *handle, const char *path)
+{
+   if (!handle)
+      return false;
+
+   /* Files already out are simply written again. */
+   if (handle->state == ZLIB_STREAM_DEFERRED && path)
+      return zlib_parse_file(path, zlib_stream_deferred_cb, handle)
+         && handle->state != ZLIB_STREAM_ERROR;
+
+   return handle->state == ZLIB_STREAM_DONE;
+}
+
+void zlib_stream_extract_free(zlib_stream_extract_t *handle)
+{
+   if (!handle)
+      return;
+
+   zlib_stream_close(handle, false);
+   free(handle->head);
+   free(handle);
+}
@@ -47,6 +47,44 @@ typedef bool (*zlib_file_cb)(const char *name,
  **/
 bool zlib_parse_file(const char *file, zlib_file_cb file_cb, void *userdata);
 
+/* Returns true when enumeration should continue. False to stop. */
+typedef bool (*zlib_index_cb)(const char *name, uint32_t size,
+      uint32_t crc32, void *userdata);
+
+/**
+ * zlib_index_foreach:
+ * @path                        : filename path of archive.
+ * @cb                          : called for each entry in archive
+ *                                order, returns false to stop.
+ * @userdata                    : userdata to pass to @cb.
+ *
+ * Enumerates the entries of an archive. The central directory
+ * is only read on first use and kept until the archive changes,
+ * unlike zlib_parse_file(), which maps and walks the whole file
+ * each time.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool zlib_index_foreach(const char *path, zlib_index_cb cb, void *userdata);
+
+/**
+ * zlib_index_read_file:
+ * @path                        : filename path of archive.
+ * @name                        : entry to extract.
+ * @buf                         : set to the extracted entry, which
+ *                                needs to be freed manually. 
+ *                                Not used if @optional_outfile is set.
+ * @optional_outfile            : file to extract to instead.
+ *
+ * Extracts one entry of an archive, looked up by name and read
+ * on its own, without going through the other entries.
+ *
+ * Returns: size of the entry, 0 when extracted to
+ * @optional_outfile, -1 on error.
+ **/
+long zlib_index_read_file(const char *path, const char *name,
+      void **buf, const char *optional_outfile);
+
 /**
  * zlib_extract_first_content_file:
  * @zip_path                    : filename path to ZIP archive.
@@ -62,6 +100,21 @@ bool zlib_parse_file(const char *file, zlib_file_cb file_cb, void *userdata);
 bool zlib_extract_first_content_file(char *zip_path, size_t zip_path_size, 
       const char *valid_exts, const char *extraction_dir);
 
+/**
+ * zlib_get_first_content_path:
+ * @zip_path                    : filename path to ZIP archive.
+ * @zip_path_size               : size of ZIP archive.
+ * @valid_exts                  : valid extensions for a content file.
+ *
+ * Points @zip_path at the first content file inside the archive,
+ * as "archive.zip#file", so that it is inflated straight into
+ * memory when read instead of extracted to disk.
+ *
+ * Returns : true (1) on success, otherwise false (0).
+ **/
+bool zlib_get_first_content_path(char *zip_path, size_t zip_path_size,
+      const char *valid_exts);
+
 /**
  * zlib_get_file_list:
  * @path                        : filename path of archive
@@ -85,5 +138,48 @@ struct string_list *zlib_get_file_list(const char *path);
 bool zlib_inflate_data_to_file(const char *path, const uint8_t *data,
       uint32_t csize, uint32_t size, uint32_t crc32);
 
+typedef struct zlib_stream_extract zlib_stream_extract_t;
+
+/**
+ * zlib_stream_extract_new:
+ * @dir                         : directory to extract to.
+ *
+ * Extracts a ZIP archive as it comes in, going by the local
+ * headers instead of the central directory at the end, so that
+ * an archive can be unpacked while it is still downloading.
+ *
+ * Returns: handle, or NULL on failure.
+ **/
+zlib_stream_extract_t *zlib_stream_extract_new(const char *dir);
+
+/**
+ * zlib_stream_extract_push:
+ * @handle                      : extraction handle.
+ * @data                        : next bytes of the archive.
+ * @len                         : size of @data.
+ *
+ * Returns: false (0) once the archive turned out to be
+ * broken or a file could not be written, otherwise true (1).
+ **/
+bool zlib_stream_extract_push(zlib_stream_extract_t *handle,
+      const uint8_t *data, size_t len);
+
+/**
+ * zlib_stream_extract_end:
+ * @handle                      : extraction handle.
+ * @path                        : the whole archive, or NULL.
+ *
+ * Entries which cannot be told apart in a stream, stored ones
+ * with their sizes after the data, are extracted from @path here,
+ * by way of the central directory.
+ *
+ * Returns: true (1) if every file of the archive came out
+ * whole, otherwise false (0).
+ **/
+bool zlib_stream_extract_end(zlib_stream_extract_t *handle,
+      const char *path);
+
+void zlib_stream_extract_free(zlib_stream_extract_t *handle);
+
 #endif
 
@@ -14,6 +14,10 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "file_ops.h"
 #include <file/file_path.h>
 #include <stdlib.h>
@@ -62,9 +66,15 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
 /**
  * write_file:
  * @path             : path to file.
@@ -87,6 +97,112 @@ bool write_file(const char *path, const void *data, size_t size)
    return ret;
 }
 
+/**
+ * file_tmp_path:
+ * @s                : output path.
+ * @path             : path of the file to be replaced.
+ * @len              : size of @s.
+ *
+ * Names a temporary file next to @path to write to and then
+ * rename over @path. The name is unique to the process, so
+ * processes replacing the same file never share one.
+ */
+void file_tmp_path(char *s, const char *path, size_t len)
+{
+#if defined(__CELLOS_LV2__) || defined(_XBOX) || defined(RARCH_CONSOLE)
+   snprintf(s, len, "%s.tmp", path);
+#elif defined(_WIN32)
+   snprintf(s, len, "%s.%lu.tmp", path,
+         (unsigned long)GetCurrentProcessId());
+#else
+   snprintf(s, len, "%s.%ld.tmp", path, (long)getpid());
+#endif
+}
+
+/**
+ * write_file_safe:
+ * @path             : path to file.
+ * @data             : contents to write to the file.
+ * @size             : size of the contents.
+ *
+ * Writes data to a temporary file next to @path, flushes it to
+ * disk and renames it over @path. Whatever happens in between,
+ * @path holds either the old or the new contents in full.
+ *
+ * Returns: true (1) on success, false (0) otherwise.
+ */
+bool write_file_safe(const char *path, const void *data, size_t size)
+{
+#if defined(__CELLOS_LV2__) || defined(_XBOX) || defined(RARCH_CONSOLE)
+   return write_file(path, data, size);
+#else
+   char tmp_path[PATH_MAX_LENGTH];
+   bool ret = false;
+
+   file_tmp_path(tmp_path, path, sizeof(tmp_path));
+
+#ifdef _WIN32
+   {
+      FILE *file = fopen(tmp_path, "wb");
+      if (!file)
+         return false;
+
+      ret = fwrite(data, 1, size, file) == size;
+      ret = ret && fflush(file) == 0 && _commit(_fileno(file)) == 0;
+      fclose(file);
+
+      ret = ret && MoveFileEx(tmp_path, path,
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+   }
+#else
+   {
+      const uint8_t *ptr = (const uint8_t*)data;
+      int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+         return false;
+
+      ret = true;
+      while (size && ret)
+      {
+         ssize_t written = write(fd, ptr, size);
+
+         if (written < 0 && errno == EINTR)
+            continue;
+
+         ret   = written > 0;
+         ptr  += ret ? written : 0;
+         size -= ret ? written : 0;
+      }
+
+      ret = ret && fsync(fd) == 0;
+      ret = (close(fd) == 0) && ret;
+      ret = ret && rename(tmp_path, path) == 0;
+
+      if (ret)
+      {
+         /* Makes the rename itself survive a power cut. */
+         char dir[PATH_MAX_LENGTH];
+
+         strlcpy(dir, path, sizeof(dir));
+         path_basedir(dir);
+
+         fd = open(dir, O_RDONLY);
+         if (fd >= 0)
+         {
+            fsync(fd);
+            close(fd);
+         }
+      }
+   }
+#endif
+
+   if (!ret)
+      remove(tmp_path);
+
+   return ret;
+#endif
+}
+
 /**
  * write_empty_file:
  * @path             : path to file.
@@ -239,6 +355,59 @@ long read_file(const char *path, void **buf)
    return read_generic_file(path,buf);
 }
 
+#ifdef HAVE_MMAP
+/**
+ * map_file:
+ * @path             : path to file.
+ * @buf              : mapping of the file. Needs to be released
+ *                     with unmap_file().
+ *
+ * Maps a plain file into memory instead of reading it. The
+ * mapping is private: writes to it copy the pages they touch
+ * and never reach the file.
+ *
+ * Returns: size of the mapping, -1 if the file can not be mapped,
+ * which includes empty files and files inside archives.
+ */
+long map_file(const char *path, void **buf)
+{
+   struct stat fds;
+   void *data = MAP_FAILED;
+   int fd     = open(path, O_RDONLY);
+
+   *buf = NULL;
+
+   if (fd < 0)
+      return -1;
+
+   if (fstat(fd, &fds) == 0 && S_ISREG(fds.st_mode) && fds.st_size > 0)
+      data = mmap(NULL, fds.st_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, fd, 0);
+
+   /* The mapping holds on to the file by itself. */
+   close(fd);
+
+   if (data == MAP_FAILED)
+      return -1;
+
+   *buf = data;
+   return fds.st_size;
+}
+
+/**
+ * unmap_file:
+ * @buf              : mapping from map_file().
+ * @size             : size map_file() returned.
+ *
+ * Releases a mapping made by map_file().
+ */
+void unmap_file(void *buf, long size)
+{
+   if (buf)
+      munmap(buf, size);
+}
+#endif
+
 /**
  * read_file_string:
  * @path             : path to file to be read from.
@@ -35,10 +35,20 @@ long read_compressed_file(const char * path, void **buf,
 
 long read_file(const char *path, void **buf);
 
+#ifdef HAVE_MMAP
+long map_file(const char *path, void **buf);
+
+void unmap_file(void *buf, long size);
+#endif
+
 bool read_file_string(const char *path, char **buf);
 
 bool write_file(const char *path, const void *buf, size_t size);
 
+bool write_file_safe(const char *path, const void *buf, size_t size);
+
+void file_tmp_path(char *s, const char *path, size_t len);
+
 bool write_empty_file(const char *path);
 
 struct string_list *compressed_file_list_new(const char *filename,
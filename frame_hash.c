@@ -0,0 +1,206 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_hash.h"
+#include "hash.h"
+#include "general.h"
+#include "performance.h"
+
+static struct
+{
+   bool active;
+   FILE *record;
+
+   /* Golden hashes, indexed by frame. */
+   uint32_t *golden;
+   unsigned golden_count;
+
+   unsigned frames;
+   unsigned mismatches;
+   unsigned first_mismatch;
+   uint32_t last_crc;
+   retro_time_t last_time;
+} frame_hash;
+
+static bool frame_hash_has_failed;
+
+static bool frame_hash_load(const char *path)
+{
+   char line[128];
+   unsigned capacity = 0;
+   FILE *file = fopen(path, "r");
+
+   if (!file)
+   {
+      RARCH_ERR("[Frame hash]: Could not open \"%s\".\n", path);
+      return false;
+   }
+
+   while (fgets(line, sizeof(line), file))
+   {
+      unsigned frame, crc;
+
+      if (sscanf(line, "%u %x", &frame, &crc) != 2)
+         continue;
+
+      if (frame >= capacity)
+      {
+         unsigned new_capacity = capacity ? capacity * 2 : 1024;
+         uint32_t *golden;
+
+         while (new_capacity <= frame)
+            new_capacity *= 2;
+
+         golden = (uint32_t*)realloc(frame_hash.golden,
+               new_capacity * sizeof(*golden));
+         if (!golden)
+         {
+            fclose(file);
+            return false;
+         }
+
+         /* Frames the file skips never match. */
+         memset(golden + capacity, 0,
+               (new_capacity - capacity) * sizeof(*golden));
+         frame_hash.golden = golden;
+         capacity          = new_capacity;
+      }
+
+      frame_hash.golden[frame] = crc;
+      if (frame >= frame_hash.golden_count)
+         frame_hash.golden_count = frame + 1;
+   }
+
+   fclose(file);
+   RARCH_LOG("[Frame hash]: Checking against %u frames of \"%s\".\n",
+         frame_hash.golden_count, path);
+   return true;
+}
+
+bool frame_hash_init(const char *record_path, const char *check_path)
+{
+   frame_hash_deinit();
+   memset(&frame_hash, 0, sizeof(frame_hash));
+   frame_hash_has_failed = false;
+
+   if (check_path && *check_path && !frame_hash_load(check_path))
+      goto error;
+
+   if (record_path && *record_path)
+   {
+      frame_hash.record = fopen(record_path, "w");
+      if (!frame_hash.record)
+      {
+         RARCH_ERR("[Frame hash]: Could not write \"%s\".\n", record_path);
+         goto error;
+      }
+   }
+
+   frame_hash.active = frame_hash.record || frame_hash.golden_count;
+   return true;
+
+error:
+   frame_hash_deinit();
+   return false;
+}
+
+void frame_hash_deinit(void)
+{
+   if (frame_hash.active && frame_hash.golden_count)
+   {
+      if (frame_hash.frames < frame_hash.golden_count)
+      {
+         RARCH_ERR("[Frame hash]: Stopped after %u of %u frames.\n",
+               frame_hash.frames, frame_hash.golden_count);
+         frame_hash_has_failed = true;
+      }
+
+      if (frame_hash.mismatches)
+         RARCH_ERR("[Frame hash]: %u of %u frames differ, first at frame %u.\n",
+               frame_hash.mismatches, frame_hash.frames,
+               frame_hash.first_mismatch);
+      else if (!frame_hash_has_failed)
+         RARCH_LOG("[Frame hash]: All %u frames match.\n", frame_hash.frames);
+   }
+
+   if (frame_hash.record)
+      fclose(frame_hash.record);
+   free(frame_hash.golden);
+
+   frame_hash.record       = NULL;
+   frame_hash.golden       = NULL;
+   frame_hash.golden_count = 0;
+   frame_hash.active       = false;
+}
+
+void frame_hash_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch, unsigned bpp)
+{
+   unsigned y;
+   uint32_t crc;
+   retro_time_t now, delta = 0;
+   const uint8_t *row = (const uint8_t*)data;
+
+   if (!frame_hash.active)
+      return;
+
+   /* A dupe shows the same as last time. */
+   if (!data)
+      crc = frame_hash.last_crc;
+   else if (data == RETRO_HW_FRAME_BUFFER_VALID)
+      crc = 0;
+   else
+   {
+      crc = 0;
+      for (y = 0; y < height; y++, row += pitch)
+         crc = crc32_update(crc, row, width * bpp);
+   }
+
+   now = rarch_get_time_usec();
+   if (frame_hash.last_time)
+      delta = now - frame_hash.last_time;
+   frame_hash.last_time = now;
+   frame_hash.last_crc  = crc;
+
+   if (frame_hash.frames < frame_hash.golden_count
+         && frame_hash.golden[frame_hash.frames] != crc)
+   {
+      if (!frame_hash.mismatches)
+      {
+         frame_hash.first_mismatch = frame_hash.frames;
+         RARCH_ERR("[Frame hash]: Frame %u is %08x, expected %08x.\n",
+               frame_hash.frames, (unsigned)crc,
+               (unsigned)frame_hash.golden[frame_hash.frames]);
+      }
+      frame_hash.mismatches++;
+      frame_hash_has_failed = true;
+   }
+
+   if (frame_hash.record)
+      fprintf(frame_hash.record, "%u %08x %u\n", frame_hash.frames,
+            (unsigned)crc, (unsigned)delta);
+
+   frame_hash.frames++;
+}
+
+bool frame_hash_failed(void)
+{
+   return frame_hash_has_failed;
+}
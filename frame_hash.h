@@ -0,0 +1,75 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FRAME_HASH_H
+#define __RARCH_FRAME_HASH_H
+
+#include <stddef.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * frame_hash_init:
+ * @record_path          : file to write the hash and time of every
+ *                         frame to, or NULL.
+ * @check_path           : file written by an earlier run to compare
+ *                         the hashes against, or NULL.
+ *
+ * Starts hashing every frame the core outputs, to catch replays
+ * of the same BSV movie going differently than before. Files hold
+ * one "<frame> <crc32> <usec>" line per frame.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool frame_hash_init(const char *record_path, const char *check_path);
+
+/**
+ * frame_hash_deinit:
+ *
+ * Logs how the run compared and closes the files.
+ **/
+void frame_hash_deinit(void);
+
+/**
+ * frame_hash_frame:
+ * @data                 : frame from the core, NULL for a dupe.
+ * @width                : width of the frame.
+ * @height               : height of the frame.
+ * @pitch                : pitch of the frame.
+ * @bpp                  : bytes per pixel.
+ *
+ * Hashes a frame, before any filter touches it. Only the visible
+ * part of every row counts, not the padding up to @pitch.
+ **/
+void frame_hash_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch, unsigned bpp);
+
+/**
+ * frame_hash_failed:
+ *
+ * Returns: true (1) if a checked frame differed from its golden
+ * hash, or the run ended before all of them were checked.
+ **/
+bool frame_hash_failed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
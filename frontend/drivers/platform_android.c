@@ -741,6 +741,12 @@ static void frontend_android_init(void *data)
          "getIntent", "()Landroid/content/Intent;");
    GET_METHOD_ID(env, android_app->onRetroArchExit, class,
          "onRetroArchExit", "()V");
+   GET_METHOD_ID(env, android_app->setPerformanceMode, class,
+         "setPerformanceMode", "(ZJ)V");
+   GET_METHOD_ID(env, android_app->reportFrameTime, class,
+         "reportFrameTime", "(J)V");
+   GET_METHOD_ID(env, android_app->getThermalStatus, class,
+         "getThermalStatus", "()I");
    CALL_OBJ_METHOD(env, obj, android_app->activity->clazz,
          android_app->getIntent);
 
@@ -796,6 +802,54 @@ static int frontend_android_get_rating(void)
    return -1;
 }
 
+/* Sustained performance mode, and an ADPF hint session for
+ * the thread running the core, see RetroActivityCommon. */
+static void frontend_android_set_performance_mode(bool enable,
+      int64_t frame_time)
+{
+   JNIEnv *env = jni_thread_getenv();
+   struct android_app *android_app = (struct android_app*)g_android;
+
+   if (!env || !android_app || !android_app->setPerformanceMode)
+      return;
+
+   CALL_VOID_METHOD_PARAM(env, android_app->activity->clazz,
+         android_app->setPerformanceMode, (jboolean)enable,
+         (jlong)(frame_time * 1000));
+}
+
+static void frontend_android_report_frame_time(int64_t work_time)
+{
+   JNIEnv *env = jni_thread_getenv();
+   struct android_app *android_app = (struct android_app*)g_android;
+
+   if (!env || !android_app || !android_app->reportFrameTime)
+      return;
+
+   CALL_VOID_METHOD_PARAM(env, android_app->activity->clazz,
+         android_app->reportFrameTime, (jlong)(work_time * 1000));
+}
+
+static enum frontend_thermal_state frontend_android_get_thermal_state(void)
+{
+   jint status = 0;
+   JNIEnv *env = jni_thread_getenv();
+   struct android_app *android_app = (struct android_app*)g_android;
+
+   if (!env || !android_app || !android_app->getThermalStatus)
+      return FRONTEND_THERMAL_NONE;
+
+   CALL_INT_METHOD(env, status, android_app->activity->clazz,
+         android_app->getThermalStatus);
+
+   /* PowerManager.THERMAL_STATUS_*, SEVERE and up alike. */
+   if (status >= FRONTEND_THERMAL_SEVERE)
+      return FRONTEND_THERMAL_SEVERE;
+   if (status < 0)
+      return FRONTEND_THERMAL_NONE;
+   return (enum frontend_thermal_state)status;
+}
+
 const frontend_ctx_driver_t frontend_ctx_android = {
    frontend_android_get_environment_settings, /* get_environment_settings */
    frontend_android_init,        /* init */
@@ -809,4 +863,8 @@ const frontend_ctx_driver_t frontend_ctx_android = {
    frontend_android_get_rating,  /* get_rating */
    NULL,                         /* load_content */
    "android",
+   NULL,                         /* get_video_driver */
+   frontend_android_set_performance_mode,
+   frontend_android_report_frame_time,
+   frontend_android_get_thermal_state,
 };
@@ -57,6 +57,9 @@ struct android_app
    jmethodID getPendingIntentLibretroPath;
    jmethodID getPendingIntentFullPath;
    jmethodID getPendingIntentIME;
+   jmethodID setPerformanceMode;
+   jmethodID reportFrameTime;
+   jmethodID getThermalStatus;
 };
 
 enum {
@@ -21,6 +21,8 @@
 #include "../settings.h"
 #include "../retroarch.h"
 #include "../runloop.h"
+#include "../dynamic.h"
+#include "../frame_hash.h"
 #include <file/file_path.h>
 
 #if defined(RARCH_CONSOLE) || defined(RARCH_MOBILE)
@@ -98,12 +100,21 @@ void main_exit(args_type() args)
       rarch_main_deinit();
    }
 
+   /* The configs saved above were written out during deinit. */
+   config_save_flush(NULL);
+   libretro_pool_free();
+
    rarch_main_command(RARCH_CMD_PERFCNT_REPORT_FRONTEND_LOG);
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
 #endif
 
+#if defined(HAVE_THREADS) && defined(__GNUC__)
+   /* Before the frontend closes the log file. */
+   rarch_log_async_deinit();
+#endif
+
    if (driver.frontend_ctx && driver.frontend_ctx->deinit)
       driver.frontend_ctx->deinit(args);
 
@@ -298,6 +309,10 @@ returntype main_entry(signature())
    while (rarch_main_iterate() != -1);
 
    main_exit(args);
+
+   /* Lets scripts tell a replay that went differently. */
+   if (frame_hash_failed())
+      exit(1);
 #endif
 
    returnfunc();
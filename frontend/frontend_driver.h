@@ -18,6 +18,7 @@
 #define __FRONTEND_DRIVER_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <boolean.h>
 
 #ifdef HAVE_CONFIG_H
@@ -32,6 +33,16 @@ typedef void (*environment_get_t)(int *argc, char *argv[], void *args,
    void *params_data);
 typedef void (*process_args_t)(int *argc, char *argv[]);
 
+/* How hot the platform says the device runs. */
+enum frontend_thermal_state
+{
+   FRONTEND_THERMAL_NONE = 0,
+   FRONTEND_THERMAL_LIGHT,
+   /* Performance is being throttled. */
+   FRONTEND_THERMAL_MODERATE,
+   FRONTEND_THERMAL_SEVERE
+};
+
 typedef struct frontend_ctx_driver
 {
    environment_get_t environment_get;
@@ -50,6 +61,12 @@ typedef struct frontend_ctx_driver
    const char *ident;
 
    const struct video_driver *(*get_video_driver)(void);
+
+   /* Performance mode, see perf_governor.h. Times are in
+    * microseconds, frame_time is the target time of a frame. */
+   void (*set_performance_mode)(bool enable, int64_t frame_time);
+   void (*report_frame_time)(int64_t work_time);
+   enum frontend_thermal_state (*get_thermal_state)(void);
 } frontend_ctx_driver_t;
 
 extern const frontend_ctx_driver_t frontend_ctx_gx;
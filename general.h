@@ -27,6 +27,7 @@
 #include "movie.h"
 #include "autosave.h"
 #include "cheats.h"
+#include "cheat_search.h"
 #include "audio/audio_dsp_filter.h"
 #include <compat/strl.h>
 #include "core_options.h"
@@ -35,6 +36,7 @@
 #include "gfx/video_filter.h"
 
 #include "playlist.h"
+#include "thread_role.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -146,8 +148,12 @@ struct settings
       bool hard_sync;
       bool black_frame_insertion;
       unsigned swap_interval;
+      unsigned vrr;
       unsigned hard_sync_frames;
+      bool hard_sync_adaptive;
+      bool gpu_pass_stats_show;
       unsigned frame_delay;
+      bool frame_delay_auto;
 #ifdef GEKKO
       unsigned viwidth;
       bool vfilter;
@@ -166,10 +172,12 @@ struct settings
 
       char softfilter_plugin[PATH_MAX_LENGTH];
       float refresh_rate;
+      bool refresh_rate_track;
       bool threaded;
 
       char filter_dir[PATH_MAX_LENGTH];
       char shader_dir[PATH_MAX_LENGTH];
+      char shader_cache_dir[PATH_MAX_LENGTH];
 
       char font_path[PATH_MAX_LENGTH];
       float font_size;
@@ -185,10 +193,12 @@ struct settings
       bool post_filter_record;
       bool gpu_record;
       bool gpu_screenshot;
+      unsigned screenshot_compression_level;
 
       bool allow_rotate;
       bool shared_context;
       bool force_srgb_disable;
+      bool gpu_pixel_unpack;
    } video;
 
 #ifdef HAVE_MENU
@@ -197,6 +207,7 @@ struct settings
       char driver[32];
       bool pause_libretro;
       bool mouse_enable;
+      unsigned idle_fps;
       struct
       {
          struct
@@ -253,6 +264,10 @@ struct settings
 
       bool rate_control;
       float rate_control_delta;
+      unsigned rate_control_target;
+      bool latency_autotune;
+      /* Latency learned by audio_driver_autotune_update(), 0 if none. */
+      unsigned latency_autotuned;
       float max_timing_skew;
       float volume; /* dB scale. */
       char resampler[32];
@@ -284,6 +299,9 @@ struct settings
       char device_names[MAX_USERS][64];
       bool autodetect_enable;
       bool netplay_client_swap_input;
+      bool poll_late;
+      int latency_test_axis;
+      int latency_test_threshold;
 
       unsigned turbo_period;
       unsigned turbo_duty_cycle;
@@ -314,6 +332,9 @@ struct settings
    char libretro[PATH_MAX_LENGTH];
    char libretro_directory[PATH_MAX_LENGTH];
    unsigned libretro_log_level;
+   bool log_async_enable;
+   unsigned libretro_warm_pool_size;
+   bool performance_mode;
    char libretro_info_path[PATH_MAX_LENGTH];
    char content_database[PATH_MAX_LENGTH];
    char cheat_database[PATH_MAX_LENGTH];
@@ -321,15 +342,26 @@ struct settings
 
    char resampler_directory[PATH_MAX_LENGTH];
    char screenshot_directory[PATH_MAX_LENGTH];
+   char replay_directory[PATH_MAX_LENGTH];
    char system_directory[PATH_MAX_LENGTH];
 
    char extraction_directory[PATH_MAX_LENGTH];
+   char cache_directory[PATH_MAX_LENGTH];
    char playlist_directory[PATH_MAX_LENGTH];
 
    bool history_list_enable;
    bool rewind_enable;
    size_t rewind_buffer_size;
    unsigned rewind_granularity;
+   bool rewind_threaded;
+   unsigned rewind_keyframe_interval;
+   bool rewind_compression;
+
+   /* Seconds kept by the recorder for RARCH_CMD_SAVE_REPLAY. */
+   unsigned replay_buffer;
+
+   unsigned runahead_frames;
+   bool runahead_secondary_instance;
 
    float slowmotion_ratio;
    float fastforward_ratio;
@@ -340,24 +372,46 @@ struct settings
 
    bool block_sram_overwrite;
    bool savestate_auto_index;
+   bool savestate_compression;
+   bool savestate_thumbnail_enable;
    bool savestate_auto_save;
    bool savestate_auto_load;
+   bool resume_snapshot_enable;
+   char resume_snapshot_path[PATH_MAX_LENGTH];
 
    bool network_cmd_enable;
    uint16_t network_cmd_port;
    bool stdin_cmd_enable;
 
+   bool command_server_enable;
+   uint16_t command_server_port;
+   char command_server_path[PATH_MAX_LENGTH];
+
+   /* Name of the shared memory core RAM is published to. */
+   char memory_share_name[64];
+
    char content_directory[PATH_MAX_LENGTH];
    char assets_directory[PATH_MAX_LENGTH];
    char menu_config_directory[PATH_MAX_LENGTH];
 #if defined(HAVE_MENU)
    char menu_content_directory[PATH_MAX_LENGTH];
+   char menu_image_cache_directory[PATH_MAX_LENGTH];
    bool menu_show_start_screen;
 #endif
    bool fps_show;
+   bool perf_hud_show;
+   unsigned perf_hud_count;
    bool fps_monitor_enable;
    bool load_dummy_on_core_shutdown;
 
+   struct
+   {
+      /* "default", "low", "normal", "high" or "realtime". */
+      char priority[RARCH_THREAD_ROLE_LAST][16];
+      /* CPUs, e.g. "0,2-3". Empty runs on any CPU. */
+      char affinity[RARCH_THREAD_ROLE_LAST][64];
+   } thread;
+
    bool core_specific_config;
 
    char username[32];
@@ -435,12 +489,23 @@ struct global
 
    /* For --subsystem content. */
    char subsystem[PATH_MAX_LENGTH];
+
+   /* Set by --scan, scanned for content instead of running. */
+   char scan_dir[PATH_MAX_LENGTH];
    struct string_list *subsystem_fullpaths;
 
    char savefile_name[PATH_MAX_LENGTH];
    char savestate_name[PATH_MAX_LENGTH];
    char cheatfile_name[PATH_MAX_LENGTH];
 
+   /* Set while the content of a resume snapshot is being
+    * loaded, for its state to be restored once it is. */
+   struct
+   {
+      bool pending;
+      uint32_t state_crc;
+   } resume;
+
    /* Used on reentrancy to use a savestate dir. */
    char savefile_dir[PATH_MAX_LENGTH];
    char savestate_dir[PATH_MAX_LENGTH];
@@ -481,6 +546,9 @@ struct global
 
       bool block_extract;
       bool force_nonblock;
+      /* Frames are presented at the core's rate on a variable 
+       * refresh display, see video_vrr. */
+      bool vrr;
       bool no_content;
 
       const char *input_desc_btn[MAX_USERS][RARCH_FIRST_META_KEY];
@@ -524,6 +592,8 @@ struct global
 
       float *outsamples;
       int16_t *conv_outsamples;
+      /* Block sized s16 output of audio_driver_flush(). */
+      int16_t *conv_block;
 
       int16_t *rewind_buf;
       size_t rewind_ptr;
@@ -535,6 +605,24 @@ struct global
       double orig_src_ratio;
       size_t driver_buffer_size;
 
+      /* Rate control state, see readjust_audio_input_rate(). 
+       * Buffer fill target in bytes, low-passed fill error, 
+       * and the integrated clock drift estimate. */
+      size_t rate_control_target;
+      double rate_control_error;
+      double rate_control_drift;
+
+      /* Latency auto-tuning state, see audio_driver_autotune_update(). */
+      struct
+      {
+         bool enable;
+         bool settled;
+         unsigned latency;
+         unsigned underruns;
+         retro_time_t window_start;
+         retro_time_t last_write;
+      } autotune;
+
       float volume_gain;
    } audio_data;
 
@@ -574,6 +662,14 @@ struct global
    size_t state_size;
    bool frame_is_reverse;
 
+   /* Run-ahead support. */
+   struct
+   {
+      void *buffer;
+      size_t size;
+      bool failed;
+   } runahead;
+
    /* Movie playback/recording support. */
    struct
    {
@@ -621,6 +717,7 @@ struct global
    bool netplay_is_spectate;
    unsigned netplay_sync_frames;
    unsigned netplay_port;
+   unsigned netplay_relay_port;
 #endif
 
    /* Recording. */
@@ -633,6 +730,11 @@ struct global
    uint8_t *record_gpu_buffer;
    size_t record_gpu_width;
    size_t record_gpu_height;
+   /* GPU recording reads the video driver's mapped readbacks, 
+    * record_gpu_buffer is not used. */
+   bool record_gpu_mapped;
+   /* Recording only feeds the replay buffer, nothing goes to record_path. */
+   bool record_replay;
 
    struct
    {
@@ -645,6 +747,25 @@ struct global
    unsigned frame_count;
    unsigned max_frames;
 
+   /* See --hash-record and --hash-check. */
+   char frame_hash_record_path[PATH_MAX_LENGTH];
+   char frame_hash_check_path[PATH_MAX_LENGTH];
+
+   /* Headless benchmark, see --benchmark. */
+   struct
+   {
+      bool enable;
+      /* Set while retro_run() runs. */
+      bool in_core;
+      unsigned frames;
+      retro_time_t start;
+      retro_time_t end;
+      /* In retro_run(), frontend callbacks included. */
+      retro_time_t core;
+      /* In frontend callbacks called from retro_run(). */
+      retro_time_t callbacks;
+   } benchmark;
+
    char title_buf[64];
 
    struct
@@ -660,6 +781,7 @@ struct global
    } filter_dir;
 
    cheat_manager_t *cheat;
+   cheat_search_t *cheat_search;
 
    bool block_config_read;
 
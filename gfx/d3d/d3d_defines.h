@@ -32,6 +32,7 @@
 #define LPDIRECT3DPIXELSHADER          LPDIRECT3DPIXELSHADER9
 #define LPDIRECT3DSURFACE              LPDIRECT3DSURFACE9
 #define LPDIRECT3DVERTEXDECLARATION    LPDIRECT3DVERTEXDECLARATION9
+#define LPDIRECT3DSTATEBLOCK           LPDIRECT3DSTATEBLOCK9
 #define LPDIRECT3DVOLUMETEXTURE        LPDIRECT3DVOLUMETEXTURE9
 #define LPDIRECT3DRESOURCE             LPDIRECT3DRESOURCE9
 #define D3DVERTEXELEMENT               D3DVERTEXELEMENT9
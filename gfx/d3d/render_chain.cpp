@@ -33,6 +33,74 @@ static inline D3DTEXTUREFILTERTYPE translate_filter(bool smooth)
 #include "render_chain_cg.h"
 #endif
 
+/* Pass N renders into the texture of pass N + 1. */
+static D3DFORMAT renderchain_target_format(renderchain_t *chain,
+      unsigned pass_index)
+{
+   return chain->passes[pass_index - 1].info.pass->fbo.fp_fbo ?
+      D3DFMT_A32B32G32R32F : D3DFMT_A8R8G8B8;
+}
+
+static LPDIRECT3DTEXTURE renderchain_acquire_target(renderchain_t *chain,
+      unsigned width, unsigned height, D3DFORMAT fmt)
+{
+   LPDIRECT3DDEVICE d3dr = chain->dev;
+   LPDIRECT3DTEXTURE tex;
+
+   for (unsigned i = 0; i < chain->target_pool.size(); i++)
+   {
+      const pooled_target *target = &chain->target_pool[i];
+
+      if (target->width == width && target->height == height
+            && target->fmt == fmt)
+      {
+         tex = target->tex;
+         chain->target_pool.erase(chain->target_pool.begin() + i);
+         RARCH_LOG("[D3D]: Reusing %ux%u render target.\n", width, height);
+         return tex;
+      }
+   }
+
+   tex = (LPDIRECT3DTEXTURE)d3d_texture_new(d3dr, NULL,
+         width, height, 1, D3DUSAGE_RENDERTARGET, fmt,
+         D3DPOOL_DEFAULT, 0, 0, 0, NULL, NULL);
+
+   if (!tex)
+      return NULL;
+
+   d3d_set_texture(d3dr, 0, tex);
+   d3d_set_sampler_address_u(d3dr, 0, D3DTADDRESS_BORDER);
+   d3d_set_sampler_address_v(d3dr, 0, D3DTADDRESS_BORDER);
+   d3d_set_texture(d3dr, 0, NULL);
+   return tex;
+}
+
+static void renderchain_release_target(renderchain_t *chain,
+      LPDIRECT3DTEXTURE tex, unsigned width, unsigned height, D3DFORMAT fmt)
+{
+   pooled_target target = { tex, width, height, fmt };
+
+   if (!tex)
+      return;
+
+   if (chain->target_pool.size() >= MAX_POOLED_TARGETS)
+   {
+      d3d_texture_free(chain->target_pool.front().tex);
+      chain->target_pool.erase(chain->target_pool.begin());
+   }
+
+   chain->target_pool.push_back(target);
+}
+
+static void renderchain_free_state_block(Pass *pass)
+{
+#ifdef HAVE_D3D9
+   if (pass->state_block)
+      pass->state_block->Release();
+   pass->state_block = NULL;
+#endif
+}
+
 void renderchain_free(void *data)
 {
    renderchain_t *chain = (renderchain_t*)data;
@@ -88,8 +156,10 @@ void renderchain_clear(void *data)
 
    if (chain->passes[0].vertex_decl)
       chain->passes[0].vertex_decl->Release();
+   renderchain_free_state_block(&chain->passes[0]);
    for (unsigned i = 1; i < chain->passes.size(); i++)
    {
+      renderchain_free_state_block(&chain->passes[i]);
       if (chain->passes[i].tex)
          d3d_texture_free(chain->passes[i].tex);
       if (chain->passes[i].vertex_buf)
@@ -105,8 +175,12 @@ void renderchain_clear(void *data)
          d3d_texture_free(chain->luts[i].tex);
    }
 
+   for (unsigned i = 0; i < chain->target_pool.size(); i++)
+      d3d_texture_free(chain->target_pool[i].tex);
+
    chain->passes.clear();
    chain->luts.clear();
+   chain->target_pool.clear();
 }
 
 void renderchain_set_final_viewport(void *data,
@@ -120,30 +194,28 @@ bool renderchain_set_pass_size(void *data, unsigned pass_index,
       unsigned width, unsigned height)
 {
    renderchain_t *chain = (renderchain_t*)data;
-   LPDIRECT3DDEVICE d3dr = chain->dev;
    Pass *pass = (Pass*)&chain->passes[pass_index];
    if (width != pass->info.tex_w || height != pass->info.tex_h)
    {
-      d3d_texture_free(pass->tex);
+      D3DFORMAT fmt = pass_index ?
+         renderchain_target_format(chain, pass_index) : D3DFMT_A8R8G8B8;
+
+      /* The first pass draws from the frame textures, those
+       * are no render targets to keep. */
+      if (pass_index)
+         renderchain_release_target(chain, pass->tex,
+               pass->info.tex_w, pass->info.tex_h, fmt);
+      else
+         d3d_texture_free(pass->tex);
+      renderchain_free_state_block(pass);
 
       pass->info.tex_w = width;
       pass->info.tex_h = height;
 
-      pass->tex = (LPDIRECT3DTEXTURE)d3d_texture_new(
-      d3dr, NULL, width, height, 1,
-         D3DUSAGE_RENDERTARGET,
-         chain->passes.back().info.pass->fbo.fp_fbo ? 
-         D3DFMT_A32B32G32R32F : D3DFMT_A8R8G8B8,
-         D3DPOOL_DEFAULT, 0, 0, 0,
-         NULL, NULL);
+      pass->tex = renderchain_acquire_target(chain, width, height, fmt);
       
       if (!pass->tex)
          return false;
-
-      d3d_set_texture(d3dr, 0, pass->tex);
-      d3d_set_sampler_address_u(d3dr, 0, D3DTADDRESS_BORDER);
-      d3d_set_sampler_address_v(d3dr, 0, D3DTADDRESS_BORDER);
-      d3d_set_texture(d3dr, 0, NULL);
    }
 
    return true;
@@ -157,6 +229,9 @@ bool renderchain_add_pass(void *data, const LinkInfo *info)
    pass.info = *info;
    pass.last_width = 0;
    pass.last_height = 0;
+#ifdef HAVE_D3D9
+   pass.state_block = NULL;
+#endif
 
    renderchain_compile_shaders(chain, pass.fPrg, 
          pass.vPrg, info->pass->source.path);
@@ -171,20 +246,12 @@ bool renderchain_add_pass(void *data, const LinkInfo *info)
    if (!pass.vertex_buf)
       return false;
 
-   pass.tex = d3d_texture_new(d3dr, NULL, info->tex_w, info->tex_h, 1,
-               D3DUSAGE_RENDERTARGET,
-               chain->passes.back().info.pass->fbo.fp_fbo 
-               ? D3DFMT_A32B32G32R32F : D3DFMT_A8R8G8B8,
-               D3DPOOL_DEFAULT, 0, 0, 0, NULL, NULL);
+   pass.tex = renderchain_acquire_target(chain, info->tex_w, info->tex_h,
+         renderchain_target_format(chain, chain->passes.size()));
 
    if (!pass.tex)
       return false;
 
-   d3d_set_texture(d3dr, 0, pass.tex);
-   d3d_set_sampler_address_u(d3dr, 0, D3DTADDRESS_BORDER);
-   d3d_set_sampler_address_v(d3dr, 0, D3DTADDRESS_BORDER);
-   d3d_set_texture(d3dr, 0, NULL);
-
    chain->passes.push_back(pass);
 
    renderchain_log_info(chain, info);
@@ -357,6 +424,9 @@ bool renderchain_create_first_pass(void *data, const LinkInfo *info,
    pass.info = *info;
    pass.last_width = 0;
    pass.last_height = 0;
+#ifdef HAVE_D3D9
+   pass.state_block = NULL;
+#endif
 
    chain->prev.ptr = 0;
    for (unsigned i = 0; i < TEXTURES; i++)
@@ -552,13 +622,21 @@ void renderchain_blit_to_texture(void *data, const void *frame,
       &d3dlr, frame, width, height, pitch);
 }
 
-void renderchain_render_pass(void *data, Pass *pass, unsigned pass_index)
+static void renderchain_set_pass_resources(renderchain_t *chain, Pass *pass)
 {
-   renderchain_t *chain = (renderchain_t*)data;
    LPDIRECT3DDEVICE d3dr = (LPDIRECT3DDEVICE)chain->dev;
-   renderchain_set_shaders(chain, pass->fPrg, pass->vPrg);
 
    d3d_set_texture(d3dr, 0, pass->tex);
+   for (unsigned i = 0; i < 4; i++)
+      d3d_set_stream_source(d3dr, i,
+            pass->vertex_buf, 0, sizeof(Vertex));
+}
+
+/* What a pass sets the same every frame. */
+static void renderchain_set_pass_state(renderchain_t *chain, Pass *pass)
+{
+   LPDIRECT3DDEVICE d3dr = (LPDIRECT3DDEVICE)chain->dev;
+
    d3d_set_sampler_minfilter(d3dr, 0,
          translate_filter(pass->info.pass->filter));
    d3d_set_sampler_magfilter(d3dr, 0,
@@ -569,9 +647,34 @@ void renderchain_render_pass(void *data, Pass *pass, unsigned pass_index)
 #else
    d3dr->SetVertexDeclaration(pass->vertex_decl);
 #endif
-   for (unsigned i = 0; i < 4; i++)
-      d3d_set_stream_source(d3dr, i,
-            pass->vertex_buf, 0, sizeof(Vertex));
+
+   if (pass != &chain->passes[0])
+      renderchain_set_pass_resources(chain, pass);
+}
+
+void renderchain_render_pass(void *data, Pass *pass, unsigned pass_index)
+{
+   renderchain_t *chain = (renderchain_t*)data;
+   LPDIRECT3DDEVICE d3dr = (LPDIRECT3DDEVICE)chain->dev;
+   renderchain_set_shaders(chain, pass->fPrg, pass->vPrg);
+
+#ifdef HAVE_D3D9
+   if (!pass->state_block && SUCCEEDED(d3dr->BeginStateBlock()))
+   {
+      renderchain_set_pass_state(chain, pass);
+      if (FAILED(d3dr->EndStateBlock(&pass->state_block)))
+         pass->state_block = NULL;
+   }
+
+   if (pass->state_block)
+      pass->state_block->Apply();
+   else
+#endif
+      renderchain_set_pass_state(chain, pass);
+
+   /* The first pass draws from another frame texture each frame. */
+   if (pass == &chain->passes[0])
+      renderchain_set_pass_resources(chain, pass);
 
    renderchain_bind_orig(chain, pass);
    renderchain_bind_prev(chain, pass);
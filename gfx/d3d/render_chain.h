@@ -43,6 +43,10 @@ enum PixelFormat
 
 #define MAX_VARIABLES 64
 
+/* Render targets kept around after a resize, for when a
+ * pass needs that size and format again. */
+#define MAX_POOLED_TARGETS 8
+
 enum
 {
    TEXTURES = 8,
@@ -60,10 +64,20 @@ struct Pass
    unsigned last_width, last_height;
 #ifdef HAVE_D3D9
    LPDIRECT3DVERTEXDECLARATION vertex_decl;
+   /* What the pass sets the same every frame, recorded
+    * the first time it renders. */
+   LPDIRECT3DSTATEBLOCK state_block;
 #endif
    std::vector<unsigned> attrib_map;
 };
 
+struct pooled_target
+{
+   LPDIRECT3DTEXTURE tex;
+   unsigned width, height;
+   D3DFORMAT fmt;
+};
+
 struct lut_info
 {
    LPDIRECT3DTEXTURE tex;
@@ -99,6 +113,7 @@ typedef struct renderchain
    unsigned frame_count;
    std::vector<unsigned> bound_tex;
    std::vector<unsigned> bound_vert;
+   std::vector<pooled_target> target_pool;
 } renderchain_t;
 
 void renderchain_free(void *data);
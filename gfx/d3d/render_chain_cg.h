@@ -224,8 +224,12 @@ void renderchain_bind_tracker(void *data, Pass *pass, unsigned pass_index)
       chain->uniform_cnt = state_tracker_get_uniform(chain->tracker,
             chain->uniform_info, MAX_VARIABLES, chain->frame_count);
 
+   /* Every pass got the value last frame if it is unchanged. */
    for (unsigned i = 0; i < chain->uniform_cnt; i++)
    {
+      if (!chain->uniform_info[i].changed)
+         continue;
+
       set_cg_param(pass->fPrg, chain->uniform_info[i].id,
             chain->uniform_info[i].value);
       set_cg_param(pass->vPrg, chain->uniform_info[i].id,
@@ -121,11 +121,20 @@ static inline bool gl_query_extension(gl_t *gl, const char *ext)
       ret = str && strstr(str, ext);
    }
 
+#ifndef RARCH_CONSOLE
+   if (ret)
+      rglgen_resolve_extension(ext);
+#endif
+
    RARCH_LOG("Querying GL extension: %s => %s\n",
          ext, ret ? "exists" : "doesn't exist");
    return ret;
 }
 
+#ifdef HAVE_GLSL
+static void gl_swap_pending_shader(gl_t *gl);
+#endif
+
 #ifdef HAVE_OVERLAY
 static void gl_render_overlay(void *data);
 static void gl_overlay_vertex_geom(void *data,
@@ -143,9 +152,10 @@ static void gl_overlay_tex_geom(void *data,
    coords[7] = yamt
 
 #if defined(HAVE_EGL) && defined(HAVE_OPENGLES2)
-static bool check_eglimage_proc(void)
+static bool check_eglimage_proc(gl_t *gl)
 {
-   return glEGLImageTargetTexture2DOES != NULL;
+   return gl_query_extension(gl, "OES_EGL_image")
+      && glEGLImageTargetTexture2DOES != NULL;
 }
 #endif
 
@@ -159,6 +169,190 @@ static bool check_sync_proc(gl_t *gl)
 }
 #endif
 
+#ifdef HAVE_GL_SYNC
+static bool gl_gpu_time_wanted(void)
+{
+   return g_extern.perfcnt_enable || g_settings.video.hard_sync_adaptive
+      || g_settings.video.gpu_pass_stats_show;
+}
+
+static void gl_gpu_time_mark(gl_t *gl)
+{
+   struct gl_gpu_time_frame *frame = &gl->gpu_time_frames[
+      (gl->gpu_time_index + gl->gpu_time_pending) % GL_GPU_TIME_QUERIES];
+
+   if (frame->marks < GL_GPU_TIME_MARKS)
+      glQueryCounter(frame->queries[frame->marks++], GL_TIMESTAMP);
+}
+
+static void gl_gpu_time_begin(gl_t *gl)
+{
+   struct gl_gpu_time_frame *frame;
+
+   if (!gl->have_timer_query || gl->gpu_time_pending >= GL_GPU_TIME_QUERIES
+         || !gl_gpu_time_wanted())
+      return;
+
+   frame = &gl->gpu_time_frames[
+      (gl->gpu_time_index + gl->gpu_time_pending) % GL_GPU_TIME_QUERIES];
+   frame->marks  = 0;
+   frame->passes = 0;
+   frame->menu   = false;
+
+   gl->gpu_time_active = true;
+   gl_gpu_time_mark(gl);
+}
+
+/* Ends the GPU time of one shader pass. */
+static void gl_gpu_time_pass(gl_t *gl)
+{
+   if (!gl->gpu_time_active)
+      return;
+
+   gl_gpu_time_mark(gl);
+   gl->gpu_time_frames[(gl->gpu_time_index + gl->gpu_time_pending) %
+      GL_GPU_TIME_QUERIES].passes++;
+}
+
+/* Ends the GPU time of the menu texture, drawn after all passes. */
+static void gl_gpu_time_menu(gl_t *gl)
+{
+   if (!gl->gpu_time_active)
+      return;
+
+   gl_gpu_time_mark(gl);
+   gl->gpu_time_frames[(gl->gpu_time_index + gl->gpu_time_pending) %
+      GL_GPU_TIME_QUERIES].menu = true;
+}
+
+static void gl_gpu_time_end(gl_t *gl)
+{
+   if (!gl->gpu_time_active)
+      return;
+
+   gl_gpu_time_mark(gl);
+   gl->gpu_time_active = false;
+   gl->gpu_time_pending++;
+}
+
+/* Collects the frames whose timestamps have all landed, oldest first. */
+static void gl_gpu_time_collect(gl_t *gl)
+{
+   while (gl->gpu_time_pending)
+   {
+      unsigned i;
+      GLint available = 0;
+      GLuint64 stamps[GL_GPU_TIME_MARKS];
+      struct gl_gpu_time_frame *frame =
+         &gl->gpu_time_frames[gl->gpu_time_index];
+
+      glGetQueryObjectiv(frame->queries[frame->marks - 1],
+            GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+         break;
+
+      for (i = 0; i < frame->marks; i++)
+         glGetQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &stamps[i]);
+
+      gl->gpu_time_index = (gl->gpu_time_index + 1) % GL_GPU_TIME_QUERIES;
+      gl->gpu_time_pending--;
+
+      gl->gpu_time        = (stamps[frame->marks - 1] - stamps[0]) / 1000;
+      gl->gpu_time_passes = frame->passes;
+      for (i = 0; i < frame->passes; i++)
+         gl->gpu_time_pass[i] = (stamps[i + 1] - stamps[i]) / 1000;
+      gl->gpu_time_menu = frame->menu ?
+         (stamps[frame->passes + 1] - stamps[frame->passes]) / 1000 : 0;
+
+      if (!g_extern.perfcnt_enable)
+         continue;
+
+      rarch_perf_histogram_add(&perf_histogram_gpu_time, gl->gpu_time);
+      for (i = 0; i < frame->passes && i < PERF_GPU_PASSES; i++)
+         rarch_perf_histogram_add(&perf_histogram_gpu_pass[i],
+               gl->gpu_time_pass[i]);
+      if (frame->menu)
+         rarch_perf_histogram_add(&perf_histogram_gpu_menu,
+               gl->gpu_time_menu);
+   }
+}
+
+/* Draws the last collected GPU times at the top of the screen. */
+static void gl_render_gpu_pass_stats(gl_t *gl)
+{
+   unsigned i;
+   char msg[256];
+   size_t len;
+   struct font_params params = {0};
+
+   if (!gl->font_driver || !gl->font_handle)
+      return;
+
+   if (!gl->have_timer_query)
+      strlcpy(msg, "GPU: timer queries not supported", sizeof(msg));
+   else
+   {
+      len = snprintf(msg, sizeof(msg), "GPU: %.2f ms ||",
+            gl->gpu_time / 1000.0);
+      for (i = 0; i < gl->gpu_time_passes && len < sizeof(msg); i++)
+         len += snprintf(msg + len, sizeof(msg) - len, " #%u %.2f",
+               i + 1, gl->gpu_time_pass[i] / 1000.0);
+      if (gl->gpu_time_menu && len < sizeof(msg))
+         snprintf(msg + len, sizeof(msg) - len, " || Menu %.2f",
+               gl->gpu_time_menu / 1000.0);
+   }
+
+   params.x        = g_settings.video.msg_pos_x;
+   params.y        = 0.92f;
+   params.scale    = 0.8f;
+   params.color    = FONT_COLOR_RGBA(255, 255, 0, 255);
+   params.drop_x   = -2;
+   params.drop_y   = -2;
+   params.drop_mod = 0.3f;
+
+   gl->font_driver->render_msg(gl->font_handle, msg, &params);
+}
+#endif
+
+/* Draws the perf counters which took the most time over the
+ * last second, one per line, below the GPU times. */
+static void gl_render_perf_hud(gl_t *gl)
+{
+   unsigned i, count;
+   char msg[256];
+   struct rarch_perf_sample samples[PERF_HUD_LINES];
+   struct font_params params = {0};
+
+   if (!gl->font_driver || !gl->font_handle)
+      return;
+
+   params.x        = g_settings.video.msg_pos_x;
+   params.y        = 0.86f;
+   params.scale    = 0.7f;
+   params.color    = FONT_COLOR_RGBA(0, 255, 255, 255);
+   params.drop_x   = -2;
+   params.drop_y   = -2;
+   params.drop_mod = 0.3f;
+
+   if (!g_extern.perfcnt_enable)
+   {
+      gl->font_driver->render_msg(gl->font_handle,
+            "Perf HUD: performance counters are disabled", &params);
+      return;
+   }
+
+   count = rarch_perf_sample_get(samples,
+         g_settings.perf_hud_count < PERF_HUD_LINES
+         ? g_settings.perf_hud_count : PERF_HUD_LINES);
+
+   for (i = 0; i < count; i++)
+   {
+      rarch_perf_sample_summary(&samples[i], msg, sizeof(msg));
+      gl->font_driver->render_msg(gl->font_handle, msg, &params);
+      params.y -= 0.05f;
+   }
+}
+
 #ifndef HAVE_OPENGLES
 static bool init_vao(gl_t *gl)
 {
@@ -438,6 +632,97 @@ static void gl_compute_fbo_geometry(gl_t *gl, unsigned width, unsigned height,
    }
 }
 
+/**
+ * gl_update_mem_stats:
+ * @gl                    : GL driver handle.
+ *
+ * Estimates the video memory taken by the frame textures, FBOs
+ * and upload buffers, and accounts it to RARCH_MEM_VIDEO in place
+ * of the previous estimate.
+ **/
+static void gl_update_mem_stats(gl_t *gl)
+{
+   int i;
+   size_t size = (size_t)gl->textures * gl->tex_w * gl->tex_h *
+      gl->base_size;
+
+   if (gl->fbo_inited)
+   {
+      for (i = 0; i < gl->fbo_pass; i++)
+      {
+         unsigned bpp = 4;
+
+         if (gl->fbo_scale[i].fp_fbo && gl->has_fp_fbo)
+            bpp = 16;
+         else if (gl->fbo_scale[i].format == RARCH_FBO_FORMAT_RGB565 ||
+               gl->fbo_scale[i].format == RARCH_FBO_FORMAT_RGBA4444)
+            bpp = 2;
+
+         size += (size_t)gl->fbo_rect[i].width *
+            gl->fbo_rect[i].height * bpp;
+      }
+   }
+
+#ifdef HAVE_GL_SYNC
+   if (gl->upload_ring_enable)
+      size += GL_UPLOAD_RING_SIZE * gl->upload_slot_size;
+#endif
+
+   rarch_mem_sub(RARCH_MEM_VIDEO, gl->mem_size);
+   rarch_mem_add(RARCH_MEM_VIDEO, size);
+   gl->mem_size = size;
+}
+
+/* Allocates pass #i as the packed format its preset asks for.
+ * Returns false, with the pass set back to the default format,
+ * if the preset asks for none or the GPU cannot render to it. */
+static bool gl_fbo_tex_image_packed(gl_t *gl, int i)
+{
+   GLenum internal_fmt, fmt, type;
+   enum gfx_fbo_format format = gl->fbo_scale[i].format;
+
+   switch (format)
+   {
+      case RARCH_FBO_FORMAT_RGB565:
+#ifdef HAVE_OPENGLES
+         internal_fmt = GL_RGB;
+#else
+         internal_fmt = gl->have_es2_compat ? GL_RGB565 : GL_RGB5;
+#endif
+         fmt  = GL_RGB;
+         type = GL_UNSIGNED_SHORT_5_6_5;
+         break;
+      case RARCH_FBO_FORMAT_RGBA4444:
+#ifdef HAVE_OPENGLES
+         internal_fmt = GL_RGBA;
+#else
+         internal_fmt = GL_RGBA4;
+#endif
+         fmt  = GL_RGBA;
+         type = GL_UNSIGNED_SHORT_4_4_4_4;
+         break;
+      case RARCH_FBO_FORMAT_RGB10_A2:
+         if (!gl->has_rgb10_a2_fbo)
+         {
+            RARCH_WARN("[GL]: RGB10_A2 FBO was requested, but is not supported. Falling back to RGBA8.\n");
+            gl->fbo_scale[i].format = RARCH_FBO_FORMAT_DEFAULT;
+            return false;
+         }
+         internal_fmt = GL_RGB10_A2;
+         fmt  = GL_RGBA;
+         type = GL_UNSIGNED_INT_2_10_10_10_REV;
+         break;
+      default:
+         return false;
+   }
+
+   RARCH_LOG("[GL]: FBO pass #%d is %s.\n", i,
+         gfx_shader_fbo_format_to_str(format));
+   glTexImage2D(GL_TEXTURE_2D, 0, internal_fmt,
+         gl->fbo_rect[i].width, gl->fbo_rect[i].height, 0,
+         fmt, type, NULL);
+   return true;
+}
 
 static void gl_create_fbo_textures(gl_t *gl)
 {
@@ -488,6 +773,13 @@ static void gl_create_fbo_textures(gl_t *gl)
       if (g_settings.video.force_srgb_disable)
          srgb_fbo = false;
 
+      if ((fp_fbo || srgb_fbo) &&
+            gl->fbo_scale[i].format != RARCH_FBO_FORMAT_DEFAULT)
+      {
+         RARCH_WARN("[GL]: FBO pass #%d is floating-point or sRGB, ignoring its framebuffer format.\n", i);
+         gl->fbo_scale[i].format = RARCH_FBO_FORMAT_DEFAULT;
+      }
+
    #ifndef HAVE_OPENGLES2
       if (fp_fbo && gl->has_fp_fbo)
       {
@@ -520,6 +812,7 @@ static void gl_create_fbo_textures(gl_t *gl)
          }
          else
       #endif
+         if (!gl_fbo_tex_image_packed(gl, i))
          {
          #ifdef HAVE_OPENGLES2
             glTexImage2D(GL_TEXTURE_2D,
@@ -556,6 +849,27 @@ static bool gl_create_fbo_targets(gl_t *gl)
             RARCH_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gl->fbo_texture[i], 0);
 
       GLenum status = glCheckFramebufferStatus(RARCH_GL_FRAMEBUFFER);
+      if (status != RARCH_GL_FRAMEBUFFER_COMPLETE &&
+            gl->fbo_scale[i].format != RARCH_FBO_FORMAT_DEFAULT)
+      {
+         /* Drivers may still refuse to render to a packed format. */
+         RARCH_WARN("[GL]: FBO pass #%d is incomplete as %s, falling back to RGBA8.\n",
+               i, gfx_shader_fbo_format_to_str(gl->fbo_scale[i].format));
+         gl->fbo_scale[i].format = RARCH_FBO_FORMAT_DEFAULT;
+
+         glBindTexture(GL_TEXTURE_2D, gl->fbo_texture[i]);
+         glTexImage2D(GL_TEXTURE_2D,
+               0, RARCH_GL_INTERNAL_FORMAT32,
+               gl->fbo_rect[i].width, gl->fbo_rect[i].height, 0,
+               RARCH_GL_TEXTURE_TYPE32, RARCH_GL_FORMAT32, NULL);
+         glBindTexture(GL_TEXTURE_2D, 0);
+
+         glFramebufferTexture2D(RARCH_GL_FRAMEBUFFER,
+               RARCH_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+               gl->fbo_texture[i], 0);
+         status = glCheckFramebufferStatus(RARCH_GL_FRAMEBUFFER);
+      }
+
       if (status != RARCH_GL_FRAMEBUFFER_COMPLETE)
          goto error;
    }
@@ -579,6 +893,7 @@ static void gl_deinit_fbo(gl_t *gl)
    memset(gl->fbo, 0, sizeof(gl->fbo));
    gl->fbo_inited = false;
    gl->fbo_pass = 0;
+   gl_update_mem_stats(gl);
 }
 
 /* Set up render to texture. */
@@ -587,7 +902,16 @@ static void gl_init_fbo(gl_t *gl, unsigned width, unsigned height)
 {
    int i;
 
-   if (!gl || gl->shader->num_shaders() == 0)
+   if (!gl)
+      return;
+
+#if defined(HAVE_MENU)
+   /* A new chain has none of the frame in it yet. */
+   gl->frame_reusable = false;
+#endif
+   gl->dupe_reusable = false;
+
+   if (gl->shader->num_shaders() == 0)
       return;
 
    struct gfx_fbo_scale scale, scale_last;
@@ -650,6 +974,7 @@ static void gl_init_fbo(gl_t *gl, unsigned width, unsigned height)
    }
 
    gl->fbo_inited = true;
+   gl_update_mem_stats(gl);
 }
 
 #ifndef HAVE_GCMGL
@@ -767,6 +1092,8 @@ static void gl_set_projection(gl_t *gl, struct gl_ortho *ortho, bool allow_rotat
 {
    math_matrix_4x4 rot;
 
+   gl->vp_key.valid = false;
+
    /* Calculate projection. */
    matrix_4x4_ortho(&gl->mvp_no_rot, ortho->left, ortho->right,
          ortho->bottom, ortho->top, ortho->znear, ortho->zfar);
@@ -781,13 +1108,59 @@ static void gl_set_projection(gl_t *gl, struct gl_ortho *ortho, bool allow_rotat
    matrix_4x4_multiply(&gl->mvp, &rot, &gl->mvp_no_rot);
 }
 
+/* Sets gl->vp_key to the arguments, returns true if they
+ * are what vp and mvp were computed from already. */
+static bool gl_viewport_key_update(gl_t *gl, unsigned width,
+      unsigned height, bool force_full, bool allow_rotate)
+{
+   const struct rarch_viewport *custom =
+      &g_extern.console.screen.viewports.custom_vp;
+   bool same = gl->vp_key.valid
+      && gl->vp_key.width            == width
+      && gl->vp_key.height           == height
+      && gl->vp_key.force_full       == force_full
+      && gl->vp_key.allow_rotate     == allow_rotate
+      && gl->vp_key.scale_integer    == g_settings.video.scale_integer
+      && gl->vp_key.keep_aspect      == gl->keep_aspect
+      && gl->vp_key.win_height       == gl->win_height
+      && gl->vp_key.aspect_ratio_idx == g_settings.video.aspect_ratio_idx
+      && gl->vp_key.aspect_ratio     == g_extern.system.aspect_ratio
+      && gl->vp_key.custom.x         == custom->x
+      && gl->vp_key.custom.y         == custom->y
+      && gl->vp_key.custom.width     == custom->width
+      && gl->vp_key.custom.height    == custom->height;
+
+   gl->vp_key.width            = width;
+   gl->vp_key.height           = height;
+   gl->vp_key.force_full       = force_full;
+   gl->vp_key.allow_rotate     = allow_rotate;
+   gl->vp_key.scale_integer    = g_settings.video.scale_integer;
+   gl->vp_key.keep_aspect      = gl->keep_aspect;
+   gl->vp_key.win_height       = gl->win_height;
+   gl->vp_key.aspect_ratio_idx = g_settings.video.aspect_ratio_idx;
+   gl->vp_key.aspect_ratio     = g_extern.system.aspect_ratio;
+   gl->vp_key.custom           = *custom;
+
+   return same;
+}
+
 void gl_set_viewport(gl_t *gl, unsigned width,
       unsigned height, bool force_full, bool allow_rotate)
 {
    int x = 0, y = 0;
-   float device_aspect = (float)width / height;
+   float device_aspect;
    struct gl_ortho ortho = {0, 1, 0, 1, -1, 1};
 
+   /* Called every frame on some paths, only the GL state
+    * needs setting again then. */
+   if (gl_viewport_key_update(gl, width, height, force_full, allow_rotate))
+   {
+      glViewport(gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+      return;
+   }
+
+   device_aspect = (float)width / height;
+
    if (gl->ctx_driver->translate_aspect)
       device_aspect = gl->ctx_driver->translate_aspect(gl, width, height);
 
@@ -860,6 +1233,7 @@ void gl_set_viewport(gl_t *gl, unsigned width,
 
    glViewport(gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
    gl_set_projection(gl, &ortho, allow_rotate);
+   gl->vp_key.valid = true;
 
    /* Set last backbuffer viewport. */
    if (!force_full)
@@ -931,12 +1305,13 @@ static void gl_check_fbo_dimensions(gl_t *gl)
          glBindFramebuffer(RARCH_GL_FRAMEBUFFER, gl->fbo[i]);
          glBindTexture(GL_TEXTURE_2D, gl->fbo_texture[i]);
 
-         glTexImage2D(GL_TEXTURE_2D,
-               0, RARCH_GL_INTERNAL_FORMAT32,
-               gl->fbo_rect[i].width,
-               gl->fbo_rect[i].height,
-               0, RARCH_GL_TEXTURE_TYPE32,
-               RARCH_GL_FORMAT32, NULL);
+         if (!gl_fbo_tex_image_packed(gl, i))
+            glTexImage2D(GL_TEXTURE_2D,
+                  0, RARCH_GL_INTERNAL_FORMAT32,
+                  gl->fbo_rect[i].width,
+                  gl->fbo_rect[i].height,
+                  0, RARCH_GL_TEXTURE_TYPE32,
+                  RARCH_GL_FORMAT32, NULL);
 
          glFramebufferTexture2D(RARCH_GL_FRAMEBUFFER,
                RARCH_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
@@ -948,12 +1323,22 @@ static void gl_check_fbo_dimensions(gl_t *gl)
 
          RARCH_LOG("[GL]: Recreating FBO texture #%d: %ux%u\n",
                i, gl->fbo_rect[i].width, gl->fbo_rect[i].height);
+         gl_update_mem_stats(gl);
       }
    }
 }
 
+/**
+ * gl_frame_fbo:
+ * @gl                      : GL handle.
+ * @tex_info                : input to the first pass.
+ * @last_pass_only          : the FBOs still hold this frame,
+ *                            only draw the pass to the screen.
+ *
+ * Renders the passes after the first one.
+ **/
 static void gl_frame_fbo(gl_t *gl,
-      const struct gl_tex_info *tex_info)
+      const struct gl_tex_info *tex_info, bool last_pass_only)
 {
    const struct gl_fbo_rect *prev_rect;
    const struct gl_fbo_rect *rect;
@@ -988,6 +1373,9 @@ static void gl_frame_fbo(gl_t *gl,
       memcpy(fbo_info->coord, fbo_tex_coords, sizeof(fbo_tex_coords));
       fbo_tex_info_cnt++;
 
+      if (last_pass_only)
+         continue;
+
       glBindFramebuffer(RARCH_GL_FRAMEBUFFER, gl->fbo[i]);
 
       gl->shader->use(gl, i + 1);
@@ -1009,6 +1397,9 @@ static void gl_frame_fbo(gl_t *gl,
       gl->shader->set_coords(&gl->coords);
       gl->shader->set_mvp(gl, &gl->mvp);
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+#ifdef HAVE_GL_SYNC
+      gl_gpu_time_pass(gl);
+#endif
    }
 
 #if defined(GL_FRAMEBUFFER_SRGB) && !defined(HAVE_OPENGLES)
@@ -1056,6 +1447,9 @@ static void gl_frame_fbo(gl_t *gl,
    gl->shader->set_coords(&gl->coords);
    gl->shader->set_mvp(gl, &gl->mvp);
    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+#ifdef HAVE_GL_SYNC
+   gl_gpu_time_pass(gl);
+#endif
 
    gl->coords.tex_coord = gl->tex_info.coord;
 }
@@ -1159,6 +1553,285 @@ static inline void gl_convert_frame_argb8888_abgr8888(gl_t *gl,
 }
 #endif
 
+#ifdef HAVE_GL_UNPACK
+static const char *gl_unpack_vertex =
+   "attribute vec2 VertexCoord;\n"
+   "uniform vec2 TexScale;\n"
+   "varying vec2 tex;\n"
+   "void main()\n"
+   "{\n"
+   "   tex = (VertexCoord * 0.5 + 0.5) * TexScale;\n"
+   "   gl_Position = vec4(VertexCoord, 0.0, 1.0);\n"
+   "}\n";
+
+#define GL_UNPACK_FRAGMENT_HEADER \
+   "#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)\n" \
+   "precision highp float;\n" \
+   "#elif defined(GL_ES)\n" \
+   "precision mediump float;\n" \
+   "#endif\n" \
+   "uniform sampler2D Texture;\n" \
+   "varying vec2 tex;\n"
+
+/* RGB565 uploaded as luminance/alpha, low byte in L. 
+ * Only exact power of two steps, so no bit operations 
+ * are needed and the result matches the CPU conversion. */
+static const char *gl_unpack_fragment_rgb565 =
+   GL_UNPACK_FRAGMENT_HEADER
+   "void main()\n"
+   "{\n"
+   "   vec2 c  = floor(texture2D(Texture, tex).ra * 255.0 + 0.5);\n"
+   "   float r = floor(c.y / 8.0);\n"
+   "   float g = mod(c.y, 8.0) * 8.0 + floor(c.x / 32.0);\n"
+   "   float b = mod(c.x, 32.0);\n"
+   "   gl_FragColor = vec4(vec3(r * 8.0 + floor(r / 4.0),\n"
+   "         g * 4.0 + floor(g / 16.0), b * 8.0 + floor(b / 4.0)) / 255.0, 1.0);\n"
+   "}\n";
+
+/* XRGB8888 uploaded as RGBA bytes, which puts blue in R. */
+static const char *gl_unpack_fragment_xrgb8888 =
+   GL_UNPACK_FRAGMENT_HEADER
+   "void main()\n"
+   "{\n"
+   "   gl_FragColor = vec4(texture2D(Texture, tex).bgr, 1.0);\n"
+   "}\n";
+
+static GLuint gl_unpack_compile(GLenum type, const char *source)
+{
+   GLint status  = 0;
+   GLuint shader = glCreateShader(type);
+
+   glShaderSource(shader, 1, &source, NULL);
+   glCompileShader(shader);
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+   if (!status)
+   {
+      glDeleteShader(shader);
+      return 0;
+   }
+
+   return shader;
+}
+
+static GLuint gl_unpack_link(const char *fragment)
+{
+   GLint status  = 0;
+   GLuint prog   = 0;
+   GLuint vert   = gl_unpack_compile(GL_VERTEX_SHADER, gl_unpack_vertex);
+   GLuint frag   = gl_unpack_compile(GL_FRAGMENT_SHADER, fragment);
+
+   if (vert && frag)
+   {
+      prog = glCreateProgram();
+      glAttachShader(prog, vert);
+      glAttachShader(prog, frag);
+      glBindAttribLocation(prog, 0, "VertexCoord");
+      glLinkProgram(prog);
+      glGetProgramiv(prog, GL_LINK_STATUS, &status);
+
+      if (!status)
+      {
+         glDeleteProgram(prog);
+         prog = 0;
+      }
+   }
+
+   /* Flagged for deletion, freed along with the program. */
+   if (vert)
+      glDeleteShader(vert);
+   if (frag)
+      glDeleteShader(frag);
+
+   return prog;
+}
+
+static void gl_deinit_unpack(gl_t *gl)
+{
+   if (!gl->unpack_enable)
+      return;
+
+   glDeleteFramebuffers(gl->textures, gl->unpack_fbo);
+   glDeleteTextures(1, &gl->unpack_texture);
+   glDeleteBuffers(1, &gl->unpack_vbo);
+   glDeleteProgram(gl->unpack_program);
+
+   memset(gl->unpack_fbo, 0, sizeof(gl->unpack_fbo));
+   gl->unpack_texture = 0;
+   gl->unpack_vbo     = 0;
+   gl->unpack_program = 0;
+   gl->unpack_enable  = false;
+}
+
+/**
+ * gl_init_unpack:
+ * @gl                   : GL driver handle.
+ *
+ * Sets up GPU conversion for the frame uploads which 
+ * would otherwise be converted on the CPU: RGB565 on 
+ * desktop GL without ARB_ES2_compatibility and XRGB8888 
+ * on GLES without BGRA8888. Core contexts keep the CPU 
+ * path, the shaders above are written for legacy GLSL.
+ **/
+static void gl_init_unpack(gl_t *gl)
+{
+   unsigned i;
+   const char *fragment = NULL;
+   static const GLfloat quad[] = {
+      -1.0f, -1.0f,
+       1.0f, -1.0f,
+      -1.0f,  1.0f,
+       1.0f,  1.0f,
+   };
+
+   gl->unpack_enable = false;
+
+   if (!g_settings.video.gpu_pixel_unpack || gl->hw_render_use
+         || gl->egl_images || gl->core_context)
+      return;
+
+#ifdef HAVE_OPENGLES
+   if (gl->base_size != sizeof(uint32_t) || !driver.gfx_use_rgba)
+      return;
+   gl->unpack_fmt = GL_RGBA;
+   fragment       = gl_unpack_fragment_xrgb8888;
+#else
+   if (gl->base_size != sizeof(uint16_t) || gl->have_es2_compat)
+      return;
+   gl->unpack_fmt = GL_LUMINANCE_ALPHA;
+   fragment       = gl_unpack_fragment_rgb565;
+#endif
+
+   if (!check_fbo_proc(gl))
+      return;
+
+   gl->unpack_program = gl_unpack_link(fragment);
+   if (!gl->unpack_program)
+   {
+      RARCH_WARN("[GL]: Failed to build pixel unpack shader, converting on the CPU.\n");
+      return;
+   }
+   gl->unpack_scale = glGetUniformLocation(gl->unpack_program, "TexScale");
+
+   glGenBuffers(1, &gl->unpack_vbo);
+   glBindBuffer(GL_ARRAY_BUFFER, gl->unpack_vbo);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glGenTextures(1, &gl->unpack_texture);
+   glBindTexture(GL_TEXTURE_2D, gl->unpack_texture);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexImage2D(GL_TEXTURE_2D, 0, gl->unpack_fmt, gl->tex_w, gl->tex_h,
+         0, gl->unpack_fmt, GL_UNSIGNED_BYTE, NULL);
+
+   gl->unpack_enable = true;
+
+   glGenFramebuffers(gl->textures, gl->unpack_fbo);
+   for (i = 0; i < gl->textures; i++)
+   {
+      glBindFramebuffer(RARCH_GL_FRAMEBUFFER, gl->unpack_fbo[i]);
+      glFramebufferTexture2D(RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, gl->texture[i], 0);
+
+      if (glCheckFramebufferStatus(RARCH_GL_FRAMEBUFFER) 
+            != RARCH_GL_FRAMEBUFFER_COMPLETE)
+      {
+         /* GLES without OES_rgb8_rgba8 can not render to RGBA. */
+         RARCH_WARN("[GL]: Can not render to frame textures, converting on the CPU.\n");
+         gl_bind_backbuffer();
+         gl_deinit_unpack(gl);
+         glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+         return;
+      }
+   }
+
+   gl_bind_backbuffer();
+   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+
+   RARCH_LOG("[GL]: Converting %s frames on the GPU.\n",
+         gl->base_size == sizeof(uint32_t) ? "XRGB8888" : "RGB565");
+}
+
+/**
+ * gl_unpack_copy_frame:
+ * @gl                   : GL driver handle.
+ * @frame                : raw frame.
+ * @width                : width of the frame.
+ * @height               : height of the frame.
+ * @pitch                : pitch of the frame, in bytes.
+ *
+ * Uploads @frame as it is and renders the conversion 
+ * into the current frame texture. Leaves program, 
+ * framebuffer and viewport as they were.
+ **/
+static void gl_unpack_copy_frame(gl_t *gl, const void *frame,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   GLint prog = 0, fbo = 0, vp[4];
+   const GLvoid *data_buf = frame;
+
+   glBindTexture(GL_TEXTURE_2D, gl->unpack_texture);
+
+#ifdef HAVE_OPENGLES
+   if (!gl->support_unpack_row_length)
+   {
+      unsigned line_bytes = width * gl->base_size;
+
+      if (pitch != line_bytes)
+      {
+         unsigned h;
+         uint8_t *dst       = (uint8_t*)gl->conv_buffer;
+         const uint8_t *src = (const uint8_t*)frame;
+
+         for (h = 0; h < height; h++, src += pitch, dst += line_bytes)
+            memcpy(dst, src, line_bytes);
+
+         data_buf = gl->conv_buffer;
+      }
+      glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(line_bytes));
+   }
+   else
+#endif
+   {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(pitch));
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / gl->base_size);
+   }
+
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+         gl->unpack_fmt, GL_UNSIGNED_BYTE, data_buf);
+
+#ifdef HAVE_OPENGLES
+   if (gl->support_unpack_row_length)
+#endif
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+   glGetIntegerv(GL_CURRENT_PROGRAM, &prog);
+   glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbo);
+   glGetIntegerv(GL_VIEWPORT, vp);
+
+   glBindFramebuffer(RARCH_GL_FRAMEBUFFER, gl->unpack_fbo[gl->tex_index]);
+   glViewport(0, 0, width, height);
+   glUseProgram(gl->unpack_program);
+   glUniform2f(gl->unpack_scale,
+         (GLfloat)width / gl->tex_w, (GLfloat)height / gl->tex_h);
+
+   glBindBuffer(GL_ARRAY_BUFFER, gl->unpack_vbo);
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glDisableVertexAttribArray(0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glUseProgram(prog);
+   glBindFramebuffer(RARCH_GL_FRAMEBUFFER, fbo);
+   glViewport(vp[0], vp[1], vp[2], vp[3]);
+   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+}
+#endif
+
 static void gl_init_textures_data(gl_t *gl)
 {
    unsigned i;
@@ -1168,6 +1841,9 @@ static void gl_init_textures_data(gl_t *gl)
       gl->last_height[i] = gl->tex_h;
    }
 
+   gl->prev_info_index = 0;
+   gl->prev_info       = gl->prev_info_ring;
+
    for (i = 0; i < gl->textures; i++)
    {
       gl->prev_info[i].tex           = gl->texture[0];
@@ -1176,6 +1852,7 @@ static void gl_init_textures_data(gl_t *gl)
       gl->prev_info[i].input_size[1] = gl->tex_h;
       gl->prev_info[i].tex_size[1]   = gl->tex_h;
       memcpy(gl->prev_info[i].coord, tex_coords, sizeof(tex_coords)); 
+      gl->prev_info[i + MAX_TEXTURES] = gl->prev_info[i];
    }
 }
 
@@ -1184,7 +1861,7 @@ static void gl_init_textures(gl_t *gl, const video_info_t *video)
    unsigned i;
 #if defined(HAVE_EGL) && defined(HAVE_OPENGLES2)
    // Use regular textures if we use HW render.
-   gl->egl_images = !gl->hw_render_use && check_eglimage_proc() &&
+   gl->egl_images = !gl->hw_render_use && check_eglimage_proc(gl) &&
       gl->ctx_driver->init_egl_image_buffer
       && gl->ctx_driver->init_egl_image_buffer(gl, video);
 #else
@@ -1258,13 +1935,204 @@ static void gl_init_textures(gl_t *gl, const video_info_t *video)
 #endif
    }
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+   gl_update_mem_stats(gl);
 }
 
-static inline void gl_copy_frame(gl_t *gl, const void *frame,
-      unsigned width, unsigned height, unsigned pitch)
+#ifdef HAVE_GL_SYNC
+static void gl_init_upload_ring(gl_t *gl)
+{
+   size_t size;
+   GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+      GL_MAP_COHERENT_BIT;
+
+   gl->upload_ring_enable = false;
+
+   if (gl->hw_render_use || !gl->have_sync)
+      return;
+
+#ifdef HAVE_GL_UNPACK
+   /* Raw frames go to the unpack texture instead. */
+   if (gl->unpack_enable)
+      return;
+#endif
+
+   if (!gl_query_extension(gl, "ARB_buffer_storage")
+         || !glBufferStorage || !glMapBufferRange)
+      return;
+
+   /* A slot holds a full texture at 32 bits per pixel, which 
+    * also fits RGB565 frames converted for desktop GL. */
+   gl->upload_slot_size = gl->tex_w * gl->tex_h * sizeof(uint32_t);
+   size = gl->upload_slot_size * GL_UPLOAD_RING_SIZE;
+
+   glGenBuffers(1, &gl->upload_pbo);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo);
+   glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+   gl->upload_ptr = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+         0, size, flags);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   if (!gl->upload_ptr)
+   {
+      RARCH_WARN("[GL]: Failed to map upload buffer, using glTexSubImage2D.\n");
+      glDeleteBuffers(1, &gl->upload_pbo);
+      gl->upload_pbo = 0;
+      return;
+   }
+
+   memset(gl->upload_fences, 0, sizeof(gl->upload_fences));
+   gl->upload_index       = 0;
+   gl->upload_ring_enable = true;
+
+   RARCH_LOG("[GL]: Streaming frame uploads through %u persistently mapped buffers.\n",
+         GL_UPLOAD_RING_SIZE);
+}
+
+static void gl_deinit_upload_ring(gl_t *gl)
+{
+   unsigned i;
+
+   if (!gl->upload_ring_enable)
+      return;
+
+   for (i = 0; i < GL_UPLOAD_RING_SIZE; i++)
+   {
+      if (gl->upload_fences[i])
+         glDeleteSync(gl->upload_fences[i]);
+      gl->upload_fences[i] = NULL;
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   glDeleteBuffers(1, &gl->upload_pbo);
+
+   gl->upload_pbo         = 0;
+   gl->upload_ptr         = NULL;
+   gl->upload_ring_enable = false;
+}
+
+/* Waits until the GPU is done reading the current slot. */
+static uint8_t *gl_upload_ring_slot(gl_t *gl)
+{
+   GLsync *fence = &gl->upload_fences[gl->upload_index];
+
+   if (*fence)
+   {
+      glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      glDeleteSync(*fence);
+      *fence = NULL;
+   }
+
+   return gl->upload_ptr + gl->upload_index * gl->upload_slot_size;
+}
+
+static void gl_upload_ring_copy(gl_t *gl, const void *frame,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned out_pitch;
+   uint8_t *slot = gl_upload_ring_slot(gl);
+
+   if (gl->base_size == 2 && !gl->have_es2_compat)
+   {
+      /* Convert to 32-bit textures on desktop GL. */
+      gl_convert_frame_rgb16_32(gl, slot, frame, width, height, pitch);
+      out_pitch = width * sizeof(uint32_t);
+   }
+   else
+   {
+      out_pitch = width * gl->base_size;
+
+      /* Frames rendered through GET_CURRENT_SOFTWARE_FRAMEBUFFER 
+       * are in the slot already. */
+      if (frame != slot)
+      {
+         unsigned h;
+         const uint8_t *src = (const uint8_t*)frame;
+         uint8_t *dst       = slot;
+
+         if (pitch == out_pitch)
+            memcpy(dst, src, pitch * height);
+         else
+            for (h = 0; h < height; h++, src += pitch, dst += out_pitch)
+               memcpy(dst, src, out_pitch);
+      }
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(out_pitch));
+   glTexSubImage2D(GL_TEXTURE_2D,
+         0, 0, 0, width, height, gl->texture_type,
+         gl->texture_fmt,
+         (const GLvoid*)(uintptr_t)(gl->upload_index * gl->upload_slot_size));
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   gl->upload_fences[gl->upload_index] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   gl->upload_index = (gl->upload_index + 1) % GL_UPLOAD_RING_SIZE;
+}
+#endif
+
+#ifdef HAVE_GL_SYNC
+/* Safety margin left before VSync by adaptive hard sync. */
+#define GL_ADAPTIVE_SYNC_MARGIN_USEC 2000
+
+/**
+ * gl_adaptive_sync_delay:
+ * @gl                   : GL driver handle.
+ *
+ * Called right after hard sync, with the GPU idle and the 
+ * swap just done. Sleeps so that the next frame, CPU and 
+ * GPU work together, completes just before the next VSync.
+ * The work estimate jumps up to new peaks and decays slowly.
+ **/
+static void gl_adaptive_sync_delay(gl_t *gl)
+{
+   retro_time_t period, delay;
+
+   if (driver.nonblock_state || g_settings.video.refresh_rate <= 0.0f)
+   {
+      gl->sync_end = 0;
+      return;
+   }
+
+   period = (retro_time_t)(1000000.0 / g_settings.video.refresh_rate);
+
+   if (gl->sync_end)
+   {
+      retro_time_t work = gl->swap_time - gl->sync_end + gl->gpu_time;
+
+      if (work > gl->sync_work)
+         gl->sync_work = work;
+      else
+         gl->sync_work -= (gl->sync_work - work) / 32;
+   }
+   else
+      gl->sync_work = period;
+
+   delay = period - gl->sync_work - GL_ADAPTIVE_SYNC_MARGIN_USEC;
+   if (delay >= 1000)
+      rarch_sleep((unsigned)(delay / 1000));
+
+   gl->sync_end = rarch_get_time_usec();
+}
+#endif
+
+static inline void gl_copy_frame(gl_t *gl, const void *frame,
+      unsigned width, unsigned height, unsigned pitch)
 {
    RARCH_PERFORMANCE_INIT(copy_frame);
    RARCH_PERFORMANCE_START(copy_frame);
+
+#ifdef HAVE_GL_UNPACK
+   if (gl->unpack_enable)
+   {
+      gl_unpack_copy_frame(gl, frame, width, height, pitch);
+      RARCH_PERFORMANCE_STOP(copy_frame);
+      return;
+   }
+#endif
+
 #if defined(HAVE_OPENGLES2)
 #if defined(HAVE_EGL)
    if (gl->egl_images)
@@ -1349,6 +2217,16 @@ static inline void gl_copy_frame(gl_t *gl, const void *frame,
    glUnmapBuffer(GL_TEXTURE_REFERENCE_BUFFER_SCE);
 #else
    const GLvoid *data_buf = frame;
+
+#ifdef HAVE_GL_SYNC
+   if (gl->upload_ring_enable)
+   {
+      gl_upload_ring_copy(gl, frame, width, height, pitch);
+      RARCH_PERFORMANCE_STOP(copy_frame);
+      return;
+   }
+#endif
+
    glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(pitch));
 
    if (gl->base_size == 2 && !gl->have_es2_compat)
@@ -1373,10 +2251,12 @@ static inline void gl_copy_frame(gl_t *gl, const void *frame,
 static inline void gl_set_prev_texture(gl_t *gl,
       const struct gl_tex_info *tex_info)
 {
-   memmove(gl->prev_info + 1, gl->prev_info,
-         sizeof(*tex_info) * (gl->textures - 1));
-   memcpy(&gl->prev_info[0], tex_info,
-         sizeof(*tex_info));
+   unsigned index = (gl->prev_info_index + MAX_TEXTURES - 1) % MAX_TEXTURES;
+
+   gl->prev_info_ring[index]                = *tex_info;
+   gl->prev_info_ring[index + MAX_TEXTURES] = *tex_info;
+   gl->prev_info_index = index;
+   gl->prev_info       = gl->prev_info_ring + index;
 }
 
 static inline void gl_set_shader_viewport(gl_t *gl, unsigned shader)
@@ -1385,15 +2265,69 @@ static inline void gl_set_shader_viewport(gl_t *gl, unsigned shader)
    gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
 }
 
+#ifdef HAVE_GL_ASYNC_READBACK
+/* The PBO written GL_PBO_READBACK_DEPTH frames ago. */
+static inline unsigned gl_pbo_read_slot(gl_t *gl)
+{
+   return (gl->pbo_readback_index + gl->pbo_readback_count 
+         - GL_PBO_READBACK_DEPTH) % gl->pbo_readback_count;
+}
+#endif
+
+#ifdef HAVE_GL_MAPPED_READBACK
+static void gl_pbo_release(void *userdata)
+{
+   struct gl_pbo_mapping *mapping = (struct gl_pbo_mapping*)userdata;
+   gl_t *gl                       = mapping->gl;
+
+   slock_lock(gl->pbo_readback_lock);
+   mapping->released = true;
+   scond_signal(gl->pbo_readback_cond);
+   slock_unlock(gl->pbo_readback_lock);
+}
+
+/**
+ * gl_pbo_reclaim:
+ * @gl                      : GL handle.
+ * @slot                    : Readback PBO index.
+ *
+ * Unmaps a PBO lent out by gl_read_viewport_mapped(), 
+ * waiting for the recorder to release it first.
+ **/
+static void gl_pbo_reclaim(gl_t *gl, unsigned slot)
+{
+   struct gl_pbo_mapping *mapping = &gl->pbo_readback_mapping[slot];
+
+   if (!mapping->mapped)
+      return;
+
+   slock_lock(gl->pbo_readback_lock);
+   while (!mapping->released)
+      scond_wait(gl->pbo_readback_cond, gl->pbo_readback_lock);
+   slock_unlock(gl->pbo_readback_lock);
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[slot]);
+   glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   mapping->mapped   = false;
+   mapping->released = false;
+}
+#endif
+
 #if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_MENU)
 static void gl_pbo_async_readback(gl_t *gl)
 {
-   glBindBuffer(GL_PIXEL_PACK_BUFFER,
-         gl->pbo_readback[gl->pbo_readback_index++]);
-   gl->pbo_readback_index &= 3;
+   unsigned slot = gl->pbo_readback_index++;
+   gl->pbo_readback_index %= gl->pbo_readback_count;
+
+#ifdef HAVE_GL_MAPPED_READBACK
+   gl_pbo_reclaim(gl, slot);
+#endif
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[slot]);
 
-   /* 4 frames back, we can readback. */
-   gl->pbo_readback_valid[gl->pbo_readback_index] = true;
+   /* GL_PBO_READBACK_DEPTH frames back, we can readback. */
+   gl->pbo_readback_valid[gl_pbo_read_slot(gl)] = true;
 
    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
    glPixelStorei(GL_PACK_ALIGNMENT,
@@ -1418,6 +2352,99 @@ static void gl_pbo_async_readback(gl_t *gl)
 }
 #endif
 
+#ifdef HAVE_GL_SYNC
+/* Reads the finished viewport into the screenshot PBO and 
+ * fences it. Nothing waits for the readback here, a later 
+ * frame collects it in gl_screenshot_collect(). */
+static void gl_screenshot_readback(gl_t *gl)
+{
+   size_t size = gl->vp.width * gl->vp.height * sizeof(uint32_t);
+
+   gl->screenshot_request = false;
+
+   if (!gl->screenshot_pbo)
+      glGenBuffers(1, &gl->screenshot_pbo);
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->screenshot_pbo);
+   if (size != gl->screenshot_pbo_size)
+   {
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+      gl->screenshot_pbo_size = size;
+   }
+
+   glPixelStorei(GL_PACK_ALIGNMENT, 4);
+   glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+   glReadBuffer(GL_BACK);
+   glReadPixels(gl->vp.x, gl->vp.y,
+         gl->vp.width, gl->vp.height,
+         GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   gl->screenshot_width  = gl->vp.width;
+   gl->screenshot_height = gl->vp.height;
+   gl->screenshot_fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/* Hands a finished screenshot readback over to its callback. 
+ * Unless @block is set, returns right away if the GPU 
+ * has not gotten to it yet. */
+static void gl_screenshot_collect(gl_t *gl, bool block)
+{
+   GLenum ret;
+   int pitch;
+   size_t size;
+   void *buffer       = NULL;
+   const uint8_t *ptr = NULL;
+
+   if (!gl->screenshot_fence)
+      return;
+
+   ret = glClientWaitSync(gl->screenshot_fence,
+         GL_SYNC_FLUSH_COMMANDS_BIT, block ? 1000000000 : 0);
+   if (ret == GL_TIMEOUT_EXPIRED && !block)
+      return;
+
+   glDeleteSync(gl->screenshot_fence);
+   gl->screenshot_fence = NULL;
+
+   pitch = gl->screenshot_width * sizeof(uint32_t);
+   size  = pitch * gl->screenshot_height;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->screenshot_pbo);
+   ptr = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+         0, size, GL_MAP_READ_BIT);
+   if (ptr)
+   {
+      /* Copy out so the encoder can run off the GL thread. */
+      buffer = malloc(size);
+      if (buffer)
+         memcpy(buffer, ptr, size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+   }
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   if (!buffer)
+   {
+      RARCH_ERR("[GL]: Failed to map screenshot readback buffer.\n");
+      return;
+   }
+
+   gl->screenshot_cb(buffer, gl->screenshot_width,
+         gl->screenshot_height, pitch);
+}
+
+static void gl_deinit_screenshot(gl_t *gl)
+{
+   gl_screenshot_collect(gl, true);
+
+   if (gl->screenshot_pbo)
+      glDeleteBuffers(1, &gl->screenshot_pbo);
+   gl->screenshot_pbo      = 0;
+   gl->screenshot_pbo_size = 0;
+   gl->screenshot_request  = false;
+}
+#endif
+
 #if defined(HAVE_MENU)
 static inline void gl_draw_texture(gl_t *gl)
 {
@@ -1459,10 +2486,173 @@ static inline void gl_draw_texture(gl_t *gl)
 }
 #endif
 
+/* Depth and stencil are only of use while a frame is drawn.
+ * Without this, tiled GPUs write them out to memory. */
+static void gl_invalidate_depth_stencil(gl_t *gl, bool backbuffer)
+{
+   static const GLenum backbuffer_attachments[] = {
+      GL_DEPTH, GL_STENCIL,
+   };
+   static const GLenum fbo_attachments[] = {
+      RARCH_GL_DEPTH_ATTACHMENT, RARCH_GL_STENCIL_ATTACHMENT,
+   };
+
+   if (!gl->invalidate_framebuffer)
+      return;
+
+#ifdef IOS
+   /* The game view is a frame buffer object. */
+   backbuffer = false;
+#endif
+
+   gl->invalidate_framebuffer(RARCH_GL_FRAMEBUFFER, 2,
+         backbuffer ? backbuffer_attachments : fbo_attachments);
+}
+
+#ifdef HAVE_GL_SYNC
+/* Called in the core's context after it ran. With the core on
+ * a shared context, its frame is only seen by the frontend's
+ * context through a fence. */
+static GLsync gl_hw_render_frame_done(gl_t *gl, const void *frame)
+{
+   GLsync fence;
+
+   if (!gl->shared_context_use || !gl->have_sync
+         || frame != RETRO_HW_FRAME_BUFFER_VALID)
+      return NULL;
+
+   fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   /* Other contexts can only wait on a flushed fence. */
+   glFlush();
+   return fence;
+}
+
+/* Hands the context back to the core. The FBO the core renders
+ * into next was drawn from a frame ago, the GPU waits for that
+ * to be done first rather than the core stalling on it. */
+static void gl_hw_render_release(gl_t *gl)
+{
+   unsigned next = (gl->tex_index + 1) % gl->textures;
+
+   if (gl->shared_context_use && gl->have_sync && gl->hw_render_fbo_init)
+   {
+      if (gl->hw_render_release[gl->tex_index])
+         glDeleteSync(gl->hw_render_release[gl->tex_index]);
+      gl->hw_render_release[gl->tex_index] =
+         glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glFlush();
+   }
+
+   context_bind_hw_render(gl, true);
+
+   if (gl->hw_render_release[next])
+   {
+      glWaitSync(gl->hw_render_release[next], 0, GL_TIMEOUT_IGNORED);
+      glDeleteSync(gl->hw_render_release[next]);
+      gl->hw_render_release[next] = NULL;
+   }
+}
+#endif
+
+/* Whether the chain makes the same output of the same input
+ * and history, frame after frame. */
+static bool gl_shader_chain_static(gl_t *gl)
+{
+   unsigned i;
+   const struct gfx_shader *shader = gl->shader->get_current_shader();
+
+   if (gl->shader->get_prev_textures())
+      return false;
+   if (!shader)
+      return true;
+   if (shader->time_dependent || shader->variables)
+      return false;
+
+   for (i = 0; i < shader->passes; i++)
+      if (shader->pass[i].frame_count_mod)
+         return false;
+
+   return true;
+}
+
+#ifdef HAVE_FBO
+/* The stock shader only samples the frame, so with integer
+ * scaling a blit gives the same picture without any of the
+ * shader and vertex state. */
+static bool gl_frame_can_blit(gl_t *gl)
+{
+   const struct gfx_shader *shader;
+
+   if (!gl->blit_framebuffer || gl->fbo_inited || gl->rotation
+         || gl->tex_mipmap || !g_settings.video.scale_integer)
+      return false;
+
+   shader = gl->shader->get_current_shader();
+   return !shader || (shader->passes == 1
+         && !*shader->pass[0].source.path
+         && shader->pass[0].filter == RARCH_FILTER_UNSPEC);
+}
+
+static bool gl_frame_blit(gl_t *gl, unsigned width, unsigned height)
+{
+   GLint y0 = gl->vp.y + gl->vp.height;
+   GLint y1 = gl->vp.y;
+
+   if (gl->hw_render_fbo_init)
+   {
+      glBindFramebuffer(GL_READ_FRAMEBUFFER,
+            gl->hw_render_fbo[gl->tex_index]);
+
+      if (g_extern.system.hw_render_callback.bottom_left_origin)
+      {
+         y0 = gl->vp.y;
+         y1 = gl->vp.y + gl->vp.height;
+      }
+   }
+   else
+   {
+      if (!gl->blit_fbo)
+         glGenFramebuffers(1, &gl->blit_fbo);
+
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, gl->blit_fbo);
+      glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, gl->texture[gl->tex_index], 0);
+
+      /* Not every texture format can be read from. */
+      if (!gl->blit_fbo_checked)
+      {
+         gl->blit_fbo_checked = true;
+
+         if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) !=
+               GL_FRAMEBUFFER_COMPLETE)
+         {
+            RARCH_WARN("[GL]: Cannot blit from frame textures, drawing them.\n");
+            gl->blit_framebuffer = NULL;
+            gl_bind_backbuffer();
+            return false;
+         }
+      }
+   }
+
+   gl->blit_framebuffer(0, 0, width, height,
+         gl->vp.x, y0, gl->vp.x + gl->vp.width, y1,
+         GL_COLOR_BUFFER_BIT,
+         g_settings.video.smooth ? GL_LINEAR : GL_NEAREST);
+
+   gl_bind_backbuffer();
+   return true;
+}
+#endif
+
 static bool gl_frame(void *data, const void *frame,
       unsigned width, unsigned height, unsigned pitch, const char *msg)
 {
+   bool reuse_frame        = false;
+   bool latency_test_frame = false;
    gl_t *gl = (gl_t*)data;
+#ifdef HAVE_GL_SYNC
+   GLsync hw_frame_fence   = NULL;
+#endif
 
    RARCH_PERFORMANCE_INIT(frame_run);
    RARCH_PERFORMANCE_START(frame_run);
@@ -1470,13 +2660,48 @@ static bool gl_frame(void *data, const void *frame,
    if (!gl)
       return true;
 
+#ifdef HAVE_FBO
+   /* Still in the core's context, which owns the FBO. */
+   if (gl->hw_render_depth_init && frame == RETRO_HW_FRAME_BUFFER_VALID)
+   {
+      glBindFramebuffer(RARCH_GL_FRAMEBUFFER,
+            gl->hw_render_fbo[gl->tex_index]);
+      gl_invalidate_depth_stencil(gl, false);
+   }
+#endif
+
+#ifdef HAVE_GL_SYNC
+   /* Still in the core's context. */
+   hw_frame_fence = gl_hw_render_frame_done(gl, frame);
+#endif
+
    context_bind_hw_render(gl, false);
 
+#ifdef HAVE_GL_SYNC
+   /* The GPU, not the CPU, waits for the core's frame. */
+   if (hw_frame_fence)
+   {
+      glWaitSync(hw_frame_fence, 0, GL_TIMEOUT_IGNORED);
+      glDeleteSync(hw_frame_fence);
+   }
+#endif
+
 #ifndef HAVE_OPENGLES
    if (gl->core_context)
       glBindVertexArray(gl->vao);
 #endif
 
+#ifdef HAVE_GL_SYNC
+   gl_gpu_time_begin(gl);
+   gl_screenshot_collect(gl, false);
+#endif
+
+#ifdef HAVE_GLSL
+   /* Swap in a new shader chain at the frame boundary. */
+   if (gl->shader_pending && gl_glsl_async_ready(gl->shader_pending))
+      gl_swap_pending_shader(gl);
+#endif
+
    gl->shader->use(gl, 1);
 
 #ifdef IOS
@@ -1498,6 +2723,10 @@ static bool gl_frame(void *data, const void *frame,
    {
       gl->should_resize = false;
       gl->ctx_driver->set_resize(gl, gl->win_width, gl->win_height);
+#if defined(HAVE_MENU)
+      gl->frame_reusable = false;
+#endif
+      gl->dupe_reusable = false;
 
 #ifdef HAVE_FBO
       if (gl->fbo_inited)
@@ -1513,12 +2742,31 @@ static bool gl_frame(void *data, const void *frame,
          gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
    }
 
-   gl->tex_index = frame ?
+#if defined(HAVE_MENU)
+   /* Over a paused core, the menu pushes the same frame every
+    * time it is drawn. The textures and FBOs still hold what the
+    * shader chain made of it, so only the pass to the screen has
+    * to be drawn again, rather than uploading and running the
+    * whole chain. */
+   reuse_frame = g_extern.is_menu && g_settings.menu.pause_libretro
+      && gl->frame_reusable && frame == gl->reuse_frame
+      && width == gl->reuse_width && height == gl->reuse_height
+      && pitch == gl->reuse_pitch;
+#endif
+
+   /* A dupe leaves input and history as they were, so unless
+    * the chain changes its output over time anyway, what it
+    * made of the last frame can be shown again. */
+   if (!frame && gl->dupe_reusable && gl_shader_chain_static(gl))
+      reuse_frame = true;
+   gl->frame_repeated = reuse_frame;
+
+   gl->tex_index = (frame && !reuse_frame) ?
       ((gl->tex_index + 1) % gl->textures) : (gl->tex_index);
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
 
    /* Can be NULL for frame dupe / NULL render. */
-   if (frame) 
+   if (frame && !reuse_frame) 
    {
 #ifdef HAVE_FBO
       if (!gl->hw_render_fbo_init)
@@ -1567,25 +2815,61 @@ static bool gl_frame(void *data, const void *frame,
    gl->tex_info.tex_size[0]   = gl->tex_w;
    gl->tex_info.tex_size[1]   = gl->tex_h;
 
-   glClear(GL_COLOR_BUFFER_BIT);
+#ifdef HAVE_FBO
+   if (!reuse_frame || !gl->fbo_inited)
+#endif
+   {
+      bool blitted = false;
 
-   gl->shader->set_params(gl, width, height,
-         gl->tex_w, gl->tex_h,
-         gl->vp.width, gl->vp.height,
-         g_extern.frame_count, 
-         &gl->tex_info, gl->prev_info, NULL, 0);
+      glClear(GL_COLOR_BUFFER_BIT);
 
-   gl->coords.vertices = 4;
-   gl->shader->set_coords(&gl->coords);
-   gl->shader->set_mvp(gl, &gl->mvp);
-   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+#ifdef HAVE_FBO
+      if (gl_frame_can_blit(gl))
+         blitted = gl_frame_blit(gl, width, height);
+#endif
+
+      if (!blitted)
+      {
+         gl->shader->set_params(gl, width, height,
+               gl->tex_w, gl->tex_h,
+               gl->vp.width, gl->vp.height,
+               g_extern.frame_count, 
+               &gl->tex_info, gl->prev_info, NULL, 0);
+
+         gl->coords.vertices = 4;
+         gl->shader->set_coords(&gl->coords);
+         gl->shader->set_mvp(gl, &gl->mvp);
+         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      }
+#ifdef HAVE_GL_SYNC
+      gl_gpu_time_pass(gl);
+#endif
+   }
 
 #ifdef HAVE_FBO
    if (gl->fbo_inited)
-      gl_frame_fbo(gl, &gl->tex_info);
+      gl_frame_fbo(gl, &gl->tex_info, reuse_frame);
 #endif
 
-   gl_set_prev_texture(gl, &gl->tex_info);
+   if (!reuse_frame)
+      gl_set_prev_texture(gl, &gl->tex_info);
+
+#if defined(HAVE_MENU)
+   /* Only frames the menu pushed, the core could have drawn
+    * into the same buffer since the last one that got here. */
+   gl->frame_reusable = g_extern.is_menu;
+   gl->reuse_frame    = frame;
+   gl->reuse_width    = width;
+   gl->reuse_height   = height;
+   gl->reuse_pitch    = pitch;
+#endif
+   gl->dupe_reusable  = true;
+
+#ifdef HAVE_GL_SYNC
+   /* Read back before the menu and OSD are drawn on top. */
+   if (gl->screenshot_request)
+      gl_screenshot_readback(gl);
+#endif
 
 #if defined(HAVE_MENU)
    if (g_extern.is_menu
@@ -1594,11 +2878,24 @@ static bool gl_frame(void *data, const void *frame,
 
    if (gl->menu_texture_enable)
       gl_draw_texture(gl);
+
+#ifdef HAVE_GL_SYNC
+   if (g_extern.is_menu || gl->menu_texture_enable)
+      gl_gpu_time_menu(gl);
+#endif
 #endif
 
    if (msg && gl->font_driver && gl->font_handle)
       gl->font_driver->render_msg(gl->font_handle, msg, NULL);
 
+#ifdef HAVE_GL_SYNC
+   if (g_settings.video.gpu_pass_stats_show)
+      gl_render_gpu_pass_stats(gl);
+#endif
+
+   if (g_settings.perf_hud_show)
+      gl_render_perf_hud(gl);
+
 #ifdef HAVE_OVERLAY
    if (gl->overlay_enable)
       gl_render_overlay(gl);
@@ -1641,6 +2938,11 @@ static bool gl_frame(void *data, const void *frame,
 #endif
 #endif
 #endif
+#ifdef HAVE_GL_SYNC
+   gl_gpu_time_end(gl);
+   gl->swap_time = rarch_get_time_usec();
+#endif
+
    /* Disable BFI during fast forward, slow-motion,
     * and pause to prevent flicker. */
    if (g_settings.video.black_frame_insertion &&
@@ -1651,19 +2953,31 @@ static bool gl_frame(void *data, const void *frame,
       glClear(GL_COLOR_BUFFER_BIT);
    }
 
+   latency_test_frame = rarch_latency_test_swap_begin();
+   gl_invalidate_depth_stencil(gl, true);
    gl->ctx_driver->swap_buffers(gl);
    g_extern.frame_count++;
 
+   if (latency_test_frame)
+   {
+      /* Wait for the swap, to time when it is done. */
+      glFinish();
+      rarch_latency_test_swap_end();
+   }
+
 #ifdef HAVE_GL_SYNC
    if (g_settings.video.hard_sync && gl->have_sync)
    {
+      unsigned max_frames = g_settings.video.hard_sync_adaptive ?
+         0 : g_settings.video.hard_sync_frames;
+
       RARCH_PERFORMANCE_INIT(gl_fence);
       RARCH_PERFORMANCE_START(gl_fence);
       glClear(GL_COLOR_BUFFER_BIT);
       gl->fences[gl->fence_count++] = 
          glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
-      while (gl->fence_count > g_settings.video.hard_sync_frames)
+      while (gl->fence_count > max_frames)
       {
          glClientWaitSync(gl->fences[0],
                GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
@@ -1675,7 +2989,15 @@ static bool gl_frame(void *data, const void *frame,
       }
 
       RARCH_PERFORMANCE_STOP(gl_fence);
+
+      /* Without frames queued, this frame's query is ready now. */
+      gl_gpu_time_collect(gl);
+
+      if (g_settings.video.hard_sync_adaptive)
+         gl_adaptive_sync_delay(gl);
    }
+   else
+      gl_gpu_time_collect(gl);
 #endif
 
 #ifndef HAVE_OPENGLES
@@ -1683,7 +3005,11 @@ static bool gl_frame(void *data, const void *frame,
       glBindVertexArray(0);
 #endif
 
+#ifdef HAVE_GL_SYNC
+   gl_hw_render_release(gl);
+#else
    context_bind_hw_render(gl, true);
+#endif
 
    return true;
 }
@@ -1694,17 +3020,22 @@ static void gl_free_overlay(gl_t *gl)
    if (!gl)
       return;
 
-   glDeleteTextures(gl->overlays, gl->overlay_tex);
+   if (gl->overlay_tex)
+      glDeleteTextures(gl->overlay_textures, gl->overlay_tex);
 
    free(gl->overlay_tex);
+   free(gl->overlay_atlas_rect);
    free(gl->overlay_vertex_coord);
    free(gl->overlay_tex_coord);
    free(gl->overlay_color_coord);
    gl->overlay_tex = NULL;
+   gl->overlay_atlas_rect = NULL;
    gl->overlay_vertex_coord = NULL;
    gl->overlay_tex_coord = NULL;
    gl->overlay_color_coord = NULL;
    gl->overlays = 0;
+   gl->overlay_textures = 0;
+   gl->overlay_atlas = false;
 }
 #endif
 
@@ -1728,19 +3059,46 @@ static void gl_free(void *data)
          glDeleteSync(gl->fences[i]);
       }
       gl->fence_count = 0;
+
+      for (i = 0; i < MAX_TEXTURES; i++)
+         if (gl->hw_render_release[i])
+            glDeleteSync(gl->hw_render_release[i]);
+   }
+
+   gl_deinit_upload_ring(gl);
+   gl_deinit_screenshot(gl);
+
+   if (gl->have_timer_query)
+   {
+      unsigned i;
+      for (i = 0; i < GL_GPU_TIME_QUERIES; i++)
+         glDeleteQueries(GL_GPU_TIME_MARKS, gl->gpu_time_frames[i].queries);
    }
 #endif
 
    if (gl->font_driver && gl->font_handle)
       gl->font_driver->free(gl->font_handle);
+#ifdef HAVE_GLSL
+   gl_glsl_async_free(gl->shader_pending);
+   gl->shader_pending = NULL;
+#endif
    gl_shader_deinit(gl);
 
 #ifndef NO_GL_FF_VERTEX
    gl_disable_client_arrays(gl);
 #endif
 
+#ifdef HAVE_GL_UNPACK
+   gl_deinit_unpack(gl);
+#endif
+
    glDeleteTextures(gl->textures, gl->texture);
 
+#ifdef HAVE_FBO
+   if (gl->blit_fbo)
+      glDeleteFramebuffers(1, &gl->blit_fbo);
+#endif
+
 #if defined(HAVE_MENU)
    if (gl->menu_texture)
       glDeleteTextures(1, &gl->menu_texture);
@@ -1760,7 +3118,14 @@ static void gl_free(void *data)
 #ifdef HAVE_GL_ASYNC_READBACK
    if (gl->pbo_readback_enable)
    {
-      glDeleteBuffers(4, gl->pbo_readback);
+#ifdef HAVE_GL_MAPPED_READBACK
+      unsigned i;
+      for (i = 0; i < gl->pbo_readback_count; i++)
+         gl_pbo_reclaim(gl, i);
+      slock_free(gl->pbo_readback_lock);
+      scond_free(gl->pbo_readback_cond);
+#endif
+      glDeleteBuffers(gl->pbo_readback_count, gl->pbo_readback);
       scaler_ctx_gen_reset(&gl->pbo_readback_scaler);
    }
 #endif
@@ -1782,6 +3147,8 @@ static void gl_free(void *data)
 
    gl->ctx_driver->destroy(gl);
 
+   rarch_mem_sub(RARCH_MEM_VIDEO, gl->mem_size);
+
    free(gl->empty_buf);
    free(gl->conv_buffer);
    free(gl);
@@ -1831,12 +3198,36 @@ static bool resolve_extensions(gl_t *gl)
       RARCH_LOG("[GL]: ATI card detected, skipping check for GL_RGB565 support.\n");
    else
       gl->have_es2_compat = gl_query_extension(gl, "ARB_ES2_compatibility");
+
+   if (gl_query_extension(gl, "ARB_invalidate_subdata"))
+      gl->invalidate_framebuffer = (gl_invalidate_framebuffer_t)
+         gl->ctx_driver->get_proc_address("glInvalidateFramebuffer");
+
+#ifdef HAVE_FBO
+   if (gl->core_context || gl_query_extension(gl, "ARB_framebuffer_object"))
+      gl->blit_framebuffer = (gl_blit_framebuffer_t)
+         gl->ctx_driver->get_proc_address("glBlitFramebuffer");
+#endif
+#endif
+
+#ifdef HAVE_GLSL
+   gl->have_parallel_compile = gl_query_extension(gl, "parallel_shader_compile");
 #endif
 
 #ifdef HAVE_GL_SYNC
    gl->have_sync = check_sync_proc(gl);
    if (gl->have_sync && g_settings.video.hard_sync)
       RARCH_LOG("[GL]: Using ARB_sync to reduce latency.\n");
+
+   gl->have_timer_query = gl_query_extension(gl, "ARB_timer_query")
+      && glGenQueries && glDeleteQueries && glQueryCounter
+      && glGetQueryObjectiv && glGetQueryObjectui64v;
+   if (gl->have_timer_query)
+   {
+      unsigned i;
+      for (i = 0; i < GL_GPU_TIME_QUERIES; i++)
+         glGenQueries(GL_GPU_TIME_MARKS, gl->gpu_time_frames[i].queries);
+   }
 #endif
 
    driver.gfx_use_rgba = false;
@@ -1874,6 +3265,19 @@ static bool resolve_extensions(gl_t *gl)
    /* No extensions for float FBO currently. */
    gl->has_srgb_fbo = gles3 || gl_query_extension(gl, "EXT_sRGB");
    gl->has_srgb_fbo_gles3 = gles3;
+   gl->has_rgb10_a2_fbo = gles3;
+
+   if (gles3)
+      gl->invalidate_framebuffer = (gl_invalidate_framebuffer_t)
+         gl->ctx_driver->get_proc_address("glInvalidateFramebuffer");
+#ifdef HAVE_FBO
+   if (gles3)
+      gl->blit_framebuffer = (gl_blit_framebuffer_t)
+         gl->ctx_driver->get_proc_address("glBlitFramebuffer");
+#endif
+   else if (gl_query_extension(gl, "EXT_discard_framebuffer"))
+      gl->invalidate_framebuffer = (gl_invalidate_framebuffer_t)
+         gl->ctx_driver->get_proc_address("glDiscardFramebufferEXT");
 #else
 #ifdef HAVE_FBO
    /* Float FBO is core in 3.2. */
@@ -1885,6 +3289,7 @@ static bool resolve_extensions(gl_t *gl)
    gl->has_srgb_fbo = gl->core_context || 
       (gl_query_extension(gl, "EXT_texture_sRGB")
        && gl_query_extension(gl, "ARB_framebuffer_sRGB"));
+   gl->has_rgb10_a2_fbo = true;
 #endif
 #endif
 
@@ -1970,8 +3375,19 @@ static void gl_init_pbo_readback(gl_t *gl)
 
    RARCH_LOG("[GL]: Async PBO readback enabled.\n");
 
-   glGenBuffers(4, gl->pbo_readback);
-   for (i = 0; i < 4; i++)
+   /* Mapped PBOs are held by the recorder for a while, 
+    * keep spare ones around to read back into meanwhile. */
+   gl->pbo_readback_count = GL_PBO_READBACK_MAX;
+
+#ifdef HAVE_GL_MAPPED_READBACK
+   gl->pbo_readback_lock = slock_new();
+   gl->pbo_readback_cond = scond_new();
+   for (i = 0; i < gl->pbo_readback_count; i++)
+      gl->pbo_readback_mapping[i].gl = gl;
+#endif
+
+   glGenBuffers(gl->pbo_readback_count, gl->pbo_readback);
+   for (i = 0; i < gl->pbo_readback_count; i++)
    {
       glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[i]);
       glBufferData(GL_PIXEL_PACK_BUFFER, gl->vp.width * 
@@ -1996,7 +3412,11 @@ static void gl_init_pbo_readback(gl_t *gl)
    {
       gl->pbo_readback_enable = false;
       RARCH_ERR("Failed to initialize pixel conversion for PBO.\n");
-      glDeleteBuffers(4, gl->pbo_readback);
+#ifdef HAVE_GL_MAPPED_READBACK
+      slock_free(gl->pbo_readback_lock);
+      scond_free(gl->pbo_readback_cond);
+#endif
+      glDeleteBuffers(gl->pbo_readback_count, gl->pbo_readback);
    }
 #endif
 }
@@ -2176,6 +3596,7 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
 {
    unsigned win_width, win_height;
    bool force_smooth                  = false;
+   bool shader_ok                     = false;
    gl_t *gl                           = NULL;
    const gfx_ctx_driver_t *ctx_driver = NULL;
    const char *vendor                 = NULL;
@@ -2223,6 +3644,10 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
       return NULL;
    }
 
+   if (gl->ctx_driver->set_vrr)
+      driver.display_vrr = gl->ctx_driver->set_vrr(gl,
+            g_settings.video.vrr != VIDEO_VRR_OFF);
+
    /* Clear out potential error flags in case we use cached context. */
    glGetError(); 
 
@@ -2234,7 +3659,8 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
    RARCH_LOG("[GL]: Version: %s.\n", version);
 
 #ifndef RARCH_CONSOLE
-   rglgen_resolve_symbols(gl->ctx_driver->get_proc_address);
+   /* Extension entry points follow as gl_query_extension() finds them. */
+   rglgen_resolve_core_symbols(gl->ctx_driver->get_proc_address);
 #endif
 
    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -2280,8 +3706,10 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
    if (gl->hw_render_use)
    {
       /* All on GPU, no need to excessively
-       * create textures. */
-      gl->textures = 1;
+       * create textures. On its own context, the core renders
+       * the next frame into a second one while the frontend
+       * still draws from the last. */
+      gl->textures = gl->shared_context_use ? 2 : 1;
 #ifdef GL_DEBUG
       context_bind_hw_render(gl, true);
       gl_begin_debug(gl);
@@ -2305,7 +3733,11 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
             gl->shader->ident);
    }
 
-   if (!gl_shader_init(gl))
+   rarch_timeline_begin("gl_shader_init");
+   shader_ok = gl_shader_init(gl);
+   rarch_timeline_end();
+
+   if (!shader_ok)
    {
       RARCH_ERR("[GL]: Shader initialization failed.\n");
       gl->ctx_driver->destroy(gl);
@@ -2382,6 +3814,14 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
    gl_init_textures(gl, video);
    gl_init_textures_data(gl);
 
+#ifdef HAVE_GL_UNPACK
+   gl_init_unpack(gl);
+#endif
+
+#ifdef HAVE_GL_SYNC
+   gl_init_upload_ring(gl);
+#endif
+
 #ifdef HAVE_FBO
    gl_init_fbo(gl, gl->tex_w, gl->tex_h);
 
@@ -2415,11 +3855,14 @@ static void *gl_init(const video_info_t *video, const input_driver_t **input, vo
 
    if (!gl_check_error())
    {
+      rarch_mem_sub(RARCH_MEM_VIDEO, gl->mem_size);
       gl->ctx_driver->destroy(gl);
       free(gl);
       return NULL;
    }
 
+   gl_update_mem_stats(gl);
+
    context_bind_hw_render(gl, true);
    return gl;
 }
@@ -2477,34 +3920,113 @@ static void gl_update_tex_filter_frame(gl_t *gl)
       smooth = g_settings.video.smooth;
    wrap_mode = gl_wrap_type_to_enum(gl->shader->wrap_type(1));
 
-   gl->tex_mipmap = gl->shader->mipmap_input(1);
+   gl->tex_mipmap = gl->shader->mipmap_input(1);
+
+   gl->video_info.smooth = smooth;
+   new_filt = gl->tex_mipmap ? (smooth ? 
+         GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST) 
+      : (smooth ? GL_LINEAR : GL_NEAREST);
+   if (new_filt == gl->tex_min_filter && wrap_mode == gl->wrap_mode)
+      return;
+
+   gl->tex_min_filter = new_filt;
+   gl->tex_mag_filter = min_filter_to_mag(gl->tex_min_filter);
+
+   gl->wrap_mode = wrap_mode;
+   for (i = 0; i < gl->textures; i++)
+   {
+      if (!gl->texture[i])
+         continue;
+
+      glBindTexture(GL_TEXTURE_2D, gl->texture[i]);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, gl->wrap_mode);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, gl->wrap_mode);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl->tex_mag_filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl->tex_min_filter);
+   }
+
+   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+   context_bind_hw_render(gl, true);
+}
+
+#if defined(HAVE_GLSL) || defined(HAVE_CG)
+/* Sets up the textures and FBOs a newly initialized 
+ * shader chain needs. */
+static void gl_set_shader_finish(gl_t *gl)
+{
+   gl_update_tex_filter_frame(gl);
+
+   if (gl->shader)
+   {
+      unsigned textures = gl->shader->get_prev_textures() + 1;
+
+      if (textures > gl->textures) // Have to reinit a bit.
+      {
+#if defined(HAVE_FBO) && !defined(HAVE_GCMGL)
+         gl_deinit_hw_render(gl);
+#endif
+#ifdef HAVE_GL_UNPACK
+         gl_deinit_unpack(gl);
+#endif
+
+         glDeleteTextures(gl->textures, gl->texture);
+#if defined(HAVE_PSGL)
+         glBindBuffer(GL_TEXTURE_REFERENCE_BUFFER_SCE, 0);
+         glDeleteBuffers(1, &gl->pbo);
+#endif
+         gl->textures = textures;
+         RARCH_LOG("[GL]: Using %u textures.\n", gl->textures);
+         gl->tex_index = 0;
+         gl_init_textures(gl, &gl->video_info);
+         gl_init_textures_data(gl);
+#ifdef HAVE_GL_UNPACK
+         gl_init_unpack(gl);
+#endif
+
+#if defined(HAVE_FBO) && !defined(HAVE_GCMGL)
+         if (gl->hw_render_use)
+            gl_init_hw_render(gl, gl->tex_w, gl->tex_h);
+#endif
+      }
+   }
+
+#ifdef HAVE_FBO
+   gl_init_fbo(gl, gl->tex_w, gl->tex_h);
+#endif
+
+   /* Apparently need to set viewport for passes when we aren't using FBOs. */
+   gl_set_shader_viewport(gl, 0);
+   gl_set_shader_viewport(gl, 1);
+}
+#endif
+
+#ifdef HAVE_GLSL
+static void gl_swap_pending_shader(gl_t *gl)
+{
+   void *pending      = gl->shader_pending;
+   gl->shader_pending = NULL;
 
-   gl->video_info.smooth = smooth;
-   new_filt = gl->tex_mipmap ? (smooth ? 
-         GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST) 
-      : (smooth ? GL_LINEAR : GL_NEAREST);
-   if (new_filt == gl->tex_min_filter && wrap_mode == gl->wrap_mode)
+   if (!gl_glsl_async_finish(pending))
+   {
+      RARCH_WARN("[GL]: Failed to set multipass shader. Keeping the current one.\n");
       return;
+   }
 
-   gl->tex_min_filter = new_filt;
-   gl->tex_mag_filter = min_filter_to_mag(gl->tex_min_filter);
+   gl_shader_deinit(gl);
+   gl->shader = &gl_glsl_backend;
 
-   gl->wrap_mode = wrap_mode;
-   for (i = 0; i < gl->textures; i++)
-   {
-      if (!gl->texture[i])
-         continue;
+#ifdef HAVE_FBO
+   gl_deinit_fbo(gl);
+   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+#endif
 
-      glBindTexture(GL_TEXTURE_2D, gl->texture[i]);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, gl->wrap_mode);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, gl->wrap_mode);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl->tex_mag_filter);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl->tex_min_filter);
-   }
+   gl_glsl_async_install(pending);
+   gl_set_shader_finish(gl);
 
-   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
-   context_bind_hw_render(gl, true);
+   /* Still inside the frame, keep our context bound. */
+   context_bind_hw_render(gl, false);
 }
+#endif
 
 static bool gl_set_shader(void *data,
       enum rarch_shader_type type, const char *path)
@@ -2520,6 +4042,29 @@ static bool gl_set_shader(void *data,
    if (type == RARCH_SHADER_NONE)
       return false;
 
+#ifdef HAVE_GLSL
+   /* GLSL to GLSL keeps the running chain until the new one is built. */
+   if (type == RARCH_SHADER_GLSL && gl->shader == &gl_glsl_backend)
+   {
+      void *pending = gl_glsl_init_async(path, gl->have_parallel_compile);
+
+      if (!pending)
+      {
+         RARCH_WARN("[GL]: Failed to set multipass shader. Keeping the current one.\n");
+         context_bind_hw_render(gl, true);
+         return false;
+      }
+
+      gl_glsl_async_free(gl->shader_pending);
+      gl->shader_pending = pending;
+      context_bind_hw_render(gl, true);
+      return true;
+   }
+
+   gl_glsl_async_free(gl->shader_pending);
+   gl->shader_pending = NULL;
+#endif
+
    gl_shader_deinit(gl);
 
    switch (type)
@@ -2562,43 +4107,7 @@ static bool gl_set_shader(void *data,
       return false;
    }
 
-   gl_update_tex_filter_frame(gl);
-
-   if (gl->shader)
-   {
-      unsigned textures = gl->shader->get_prev_textures() + 1;
-
-      if (textures > gl->textures) // Have to reinit a bit.
-      {
-#if defined(HAVE_FBO) && !defined(HAVE_GCMGL)
-         gl_deinit_hw_render(gl);
-#endif
-
-         glDeleteTextures(gl->textures, gl->texture);
-#if defined(HAVE_PSGL)
-         glBindBuffer(GL_TEXTURE_REFERENCE_BUFFER_SCE, 0);
-         glDeleteBuffers(1, &gl->pbo);
-#endif
-         gl->textures = textures;
-         RARCH_LOG("[GL]: Using %u textures.\n", gl->textures);
-         gl->tex_index = 0;
-         gl_init_textures(gl, &gl->video_info);
-         gl_init_textures_data(gl);
-
-#if defined(HAVE_FBO) && !defined(HAVE_GCMGL)
-         if (gl->hw_render_use)
-            gl_init_hw_render(gl, gl->tex_w, gl->tex_h);
-#endif
-      }
-   }
-
-#ifdef HAVE_FBO
-   gl_init_fbo(gl, gl->tex_w, gl->tex_h);
-#endif
-
-   /* Apparently need to set viewport for passes when we aren't using FBOs. */
-   gl_set_shader_viewport(gl, 0);
-   gl_set_shader_viewport(gl, 1);
+   gl_set_shader_finish(gl);
    context_bind_hw_render(gl, true);
    return true;
 #else
@@ -2644,17 +4153,18 @@ static bool gl_read_viewport(void *data, uint8_t *buffer)
    if (gl->pbo_readback_enable)
    {
       const uint8_t *ptr  = NULL;
+      unsigned slot       = gl_pbo_read_slot(gl);
 
       /* Don't readback if we're in menu mode. */
-      if (!gl->pbo_readback_valid[gl->pbo_readback_index]) 
+      if (!gl->pbo_readback_valid[slot]) 
       {
          /* We haven't buffered up enough frames yet, come back later. */
          context_bind_hw_render(gl, true);
          return false;
       }
 
-      gl->pbo_readback_valid[gl->pbo_readback_index] = false;
-      glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[gl->pbo_readback_index]);
+      gl->pbo_readback_valid[slot] = false;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[slot]);
 #ifdef HAVE_OPENGLES3
       /* Slower path, but should work on all implementations at least. */
       num_pixels = gl->vp.width * gl->vp.height;
@@ -2744,7 +4254,268 @@ static bool gl_read_viewport(void *data, uint8_t *buffer)
 }
 #endif
 
+#ifdef HAVE_GL_MAPPED_READBACK
+/**
+ * gl_read_viewport_mapped:
+ * @data                    : GL handle.
+ * @frame                   : Receives the mapped frame.
+ *
+ * Maps the oldest async readback PBO and lends it out
+ * instead of copying it. It stays mapped until released, 
+ * the readback going into it next waits for that.
+ *
+ * Returns: true (1) if a frame was mapped, otherwise false (0).
+ * With NULL @frame, whether async readbacks are running.
+ **/
+static bool gl_read_viewport_mapped(void *data,
+      struct video_mapped_frame *frame)
+{
+   unsigned slot;
+   const uint8_t *ptr = NULL;
+   gl_t *gl           = (gl_t*)data;
+   size_t pitch;
+
+   if (!gl || !gl->pbo_readback_enable)
+      return false;
+   if (!frame)
+      return true;
+
+   slot = gl_pbo_read_slot(gl);
+   /* We haven't buffered up enough frames yet, come back later. */
+   if (!gl->pbo_readback_valid[slot])
+      return false;
+
+   context_bind_hw_render(gl, false);
+
+   gl->pbo_readback_valid[slot] = false;
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, gl->pbo_readback[slot]);
+   ptr = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   context_bind_hw_render(gl, true);
+
+   if (!ptr)
+   {
+      RARCH_ERR("[GL]: Failed to map pixel unpack buffer.\n");
+      return false;
+   }
+
+   gl->pbo_readback_mapping[slot].mapped = true;
+
+   /* Rows are tightly packed and bottom-up. */
+   pitch           = gl->vp.width * sizeof(uint32_t);
+   frame->data     = ptr + (gl->vp.height - 1) * pitch;
+   frame->width    = gl->vp.width;
+   frame->height   = gl->vp.height;
+   frame->pitch    = -(int)pitch;
+   frame->release  = gl_pbo_release;
+   frame->userdata = &gl->pbo_readback_mapping[slot];
+   return true;
+}
+#endif
+
 #ifdef HAVE_OVERLAY
+/* Images are padded by a border of repeated edge texels, 
+ * so linear filtering never picks up their neighbours. */
+#define GL_OVERLAY_ATLAS_BORDER 1
+
+static void gl_overlay_set_texture_params(void)
+{
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
+
+static void gl_overlay_upload(unsigned width, unsigned height,
+      const uint32_t *pixels)
+{
+   glPixelStorei(GL_UNPACK_ALIGNMENT,
+         get_alignment(width * sizeof(uint32_t)));
+
+   glTexImage2D(GL_TEXTURE_2D, 0, driver.gfx_use_rgba ? 
+         GL_RGBA : RARCH_GL_INTERNAL_FORMAT32,
+         width, height, 0,
+         driver.gfx_use_rgba ? GL_RGBA : RARCH_GL_TEXTURE_TYPE32,
+         RARCH_GL_FORMAT32, pixels);
+}
+
+/**
+ * gl_overlay_atlas_pack:
+ * @images                  : overlay images.
+ * @num_images              : number of overlay images.
+ * @atlas_width             : width of the atlas to pack into.
+ * @max_height              : largest height the atlas may have.
+ * @pos                     : receives the top-left corner of 
+ *                            every padded image, as x, y pairs.
+ *
+ * Packs the images into shelves, tallest first.
+ *
+ * Returns: height of the atlas, or 0 if it does not fit.
+ **/
+static unsigned gl_overlay_atlas_pack(const struct texture_image *images,
+      unsigned num_images, unsigned atlas_width, unsigned max_height,
+      unsigned *pos)
+{
+   unsigned i, j;
+   unsigned x = 0, y = 0, shelf_height = 0;
+   unsigned *order = (unsigned*)malloc(num_images * sizeof(*order));
+
+   if (!order)
+      return 0;
+
+   for (i = 0; i < num_images; i++)
+   {
+      unsigned idx = i;
+
+      for (j = i; j > 0 && images[order[j - 1]].height < images[idx].height; j--)
+         order[j] = order[j - 1];
+      order[j] = idx;
+   }
+
+   for (i = 0; i < num_images; i++)
+   {
+      unsigned idx = order[i];
+      unsigned w   = images[idx].width  + 2 * GL_OVERLAY_ATLAS_BORDER;
+      unsigned h   = images[idx].height + 2 * GL_OVERLAY_ATLAS_BORDER;
+
+      if (w > atlas_width)
+         break;
+
+      if (x + w > atlas_width)
+      {
+         y += shelf_height;
+         x = 0;
+         shelf_height = 0;
+      }
+
+      if (y + h > max_height)
+         break;
+
+      pos[2 * idx + 0] = x;
+      pos[2 * idx + 1] = y;
+      x += w;
+      if (h > shelf_height)
+         shelf_height = h;
+   }
+
+   free(order);
+
+   if (i < num_images)
+      return 0;
+   return y + shelf_height;
+}
+
+static void gl_overlay_atlas_blit(uint32_t *atlas, unsigned atlas_width,
+      const struct texture_image *image, unsigned x, unsigned y)
+{
+   unsigned i, j;
+   unsigned w = image->width + 2 * GL_OVERLAY_ATLAS_BORDER;
+   unsigned h = image->height + 2 * GL_OVERLAY_ATLAS_BORDER;
+
+   if (!image->width || !image->height)
+      return;
+
+   for (j = 0; j < h; j++)
+   {
+      unsigned src_y = j < GL_OVERLAY_ATLAS_BORDER ? 0 :
+         min(j - GL_OVERLAY_ATLAS_BORDER, image->height - 1);
+      const uint32_t *src = image->pixels + src_y * image->width;
+      uint32_t *dst = atlas + (y + j) * atlas_width + x;
+
+      for (i = 0; i < GL_OVERLAY_ATLAS_BORDER; i++)
+      {
+         dst[i] = src[0];
+         dst[w - 1 - i] = src[image->width - 1];
+      }
+      memcpy(dst + GL_OVERLAY_ATLAS_BORDER, src,
+            image->width * sizeof(uint32_t));
+   }
+}
+
+/**
+ * gl_overlay_load_atlas:
+ * @gl                      : pointer to GL driver object.
+ * @images                  : overlay images.
+ * @num_images              : number of overlay images.
+ *
+ * Packs all images into a single texture so the 
+ * overlay can be drawn with one call.
+ *
+ * Returns: true (1) if the atlas was created, otherwise false (0).
+ **/
+static bool gl_overlay_load_atlas(gl_t *gl,
+      const struct texture_image *images, unsigned num_images)
+{
+   unsigned i;
+   GLint max_size = 0;
+   unsigned width = 0, height = 0, max_width = 0;
+   size_t area = 0;
+   uint32_t *atlas = NULL;
+   unsigned *pos = (unsigned*)calloc(2 * num_images, sizeof(*pos));
+
+   if (!pos)
+      return false;
+
+   glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+   for (i = 0; i < num_images; i++)
+   {
+      unsigned w = images[i].width  + 2 * GL_OVERLAY_ATLAS_BORDER;
+      unsigned h = images[i].height + 2 * GL_OVERLAY_ATLAS_BORDER;
+      area += w * h;
+      if (w > max_width)
+         max_width = w;
+   }
+
+   /* Start out square and widen until everything fits. */
+   for (width = next_pow2(max(max_width, (unsigned)sqrt(area)));
+         width <= (unsigned)max_size; width *= 2)
+   {
+      height = gl_overlay_atlas_pack(images, num_images,
+            width, max_size, pos);
+      if (height)
+         break;
+   }
+
+   if (!height)
+      goto error;
+
+   atlas = (uint32_t*)calloc(width * height, sizeof(*atlas));
+   if (!atlas)
+      goto error;
+
+   for (i = 0; i < num_images; i++)
+   {
+      GLfloat *rect = &gl->overlay_atlas_rect[4 * i];
+
+      gl_overlay_atlas_blit(atlas, width, &images[i],
+            pos[2 * i + 0], pos[2 * i + 1]);
+
+      rect[0] = (GLfloat)(pos[2 * i + 0] + GL_OVERLAY_ATLAS_BORDER) / width;
+      rect[1] = (GLfloat)(pos[2 * i + 1] + GL_OVERLAY_ATLAS_BORDER) / height;
+      rect[2] = (GLfloat)images[i].width / width;
+      rect[3] = (GLfloat)images[i].height / height;
+   }
+
+   gl->overlay_textures = 1;
+   glGenTextures(1, gl->overlay_tex);
+   glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[0]);
+   gl_overlay_set_texture_params();
+   gl_overlay_upload(width, height, atlas);
+
+   RARCH_LOG("[GL]: Packed %u overlay images into a %ux%u atlas.\n",
+         num_images, width, height);
+
+   free(atlas);
+   free(pos);
+   return true;
+
+error:
+   free(pos);
+   return false;
+}
+
 static void gl_free_overlay(gl_t *gl);
 static bool gl_overlay_load(void *data, 
       const struct texture_image *images, unsigned num_images)
@@ -2759,70 +4530,92 @@ static bool gl_overlay_load(void *data,
 
    gl_free_overlay(gl);
    gl->overlay_tex = (GLuint*)calloc(num_images, sizeof(*gl->overlay_tex));
-   if (!gl->overlay_tex)
+   gl->overlay_atlas_rect = (GLfloat*)calloc(4 * num_images, sizeof(GLfloat));
+   if (!gl->overlay_tex || !gl->overlay_atlas_rect)
    {
+      gl_free_overlay(gl);
       context_bind_hw_render(gl, true);
       return false;
    }
 
-   gl->overlay_vertex_coord = (GLfloat*)calloc(2 * 4 * num_images, sizeof(GLfloat));
-   gl->overlay_tex_coord    = (GLfloat*)calloc(2 * 4 * num_images, sizeof(GLfloat));
-   gl->overlay_color_coord  = (GLfloat*)calloc(4 * 4 * num_images, sizeof(GLfloat));
+   gl->overlay_vertex_coord = (GLfloat*)calloc(2 * 6 * num_images, sizeof(GLfloat));
+   gl->overlay_tex_coord    = (GLfloat*)calloc(2 * 6 * num_images, sizeof(GLfloat));
+   gl->overlay_color_coord  = (GLfloat*)calloc(4 * 6 * num_images, sizeof(GLfloat));
    if (!gl->overlay_vertex_coord || !gl->overlay_tex_coord || !gl->overlay_color_coord)
+   {
+      gl_free_overlay(gl);
+      context_bind_hw_render(gl, true);
       return false;
+   }
 
    gl->overlays = num_images;
-   glGenTextures(num_images, gl->overlay_tex);
+   gl->overlay_atlas = gl_overlay_load_atlas(gl, images, num_images);
 
-   for (i = 0; i < num_images; i++)
+   if (!gl->overlay_atlas)
    {
-      glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[i]);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      /* Too large for one texture, fall back to one per image. */
+      gl->overlay_textures = num_images;
+      glGenTextures(num_images, gl->overlay_tex);
+
+      for (i = 0; i < num_images; i++)
+      {
+         GLfloat *rect = &gl->overlay_atlas_rect[4 * i];
 
-      glPixelStorei(GL_UNPACK_ALIGNMENT,
-            get_alignment(images[i].width * sizeof(uint32_t)));
+         glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[i]);
+         gl_overlay_set_texture_params();
+         gl_overlay_upload(images[i].width, images[i].height,
+               images[i].pixels);
 
-      glTexImage2D(GL_TEXTURE_2D, 0, driver.gfx_use_rgba ? 
-            GL_RGBA : RARCH_GL_INTERNAL_FORMAT32,
-            images[i].width, images[i].height, 0,
-            driver.gfx_use_rgba ? GL_RGBA : RARCH_GL_TEXTURE_TYPE32,
-            RARCH_GL_FORMAT32, images[i].pixels);
+         rect[0] = 0.0f;
+         rect[1] = 0.0f;
+         rect[2] = 1.0f;
+         rect[3] = 1.0f;
+      }
+   }
 
+   for (i = 0; i < num_images; i++)
+   {
       /* Default. Stretch to whole screen. */
       gl_overlay_tex_geom(gl, i, 0, 0, 1, 1);
       gl_overlay_vertex_geom(gl, i, 0, 0, 1, 1);
 
-      for (j = 0; j < 16; j++)
-         gl->overlay_color_coord[16 * i + j] = 1.0f;
+      for (j = 0; j < 24; j++)
+         gl->overlay_color_coord[24 * i + j] = 1.0f;
    }
 
    context_bind_hw_render(gl, true);
    return true;
 }
 
+/* Writes a quad as two triangles, in the corner order 
+ * a triangle strip would use. */
+static void gl_overlay_set_quad(GLfloat *coord,
+      GLfloat x, GLfloat y, GLfloat w, GLfloat h)
+{
+   coord[ 0] = x;     coord[ 1] = y;
+   coord[ 2] = x + w; coord[ 3] = y;
+   coord[ 4] = x;     coord[ 5] = y + h;
+   coord[ 6] = x;     coord[ 7] = y + h;
+   coord[ 8] = x + w; coord[ 9] = y;
+   coord[10] = x + w; coord[11] = y + h;
+}
+
 static void gl_overlay_tex_geom(void *data,
       unsigned image,
       GLfloat x, GLfloat y,
       GLfloat w, GLfloat h)
 {
-   GLfloat *tex = NULL;
+   const GLfloat *rect = NULL;
    gl_t *gl = (gl_t*)data;
 
-   if (!gl)
-      return;
-
-   tex = (GLfloat*)&gl->overlay_tex_coord[image * 8];
-
-   if (!tex)
+   if (!gl || image >= gl->overlays)
       return;
 
-   tex[0] = x;     tex[1] = y;
-   tex[2] = x + w; tex[3] = y;
-   tex[4] = x;     tex[5] = y + h;
-   tex[6] = x + w; tex[7] = y + h;
+   /* Map into the part of the atlas the image lives in. */
+   rect = &gl->overlay_atlas_rect[image * 4];
+   gl_overlay_set_quad(&gl->overlay_tex_coord[image * 12],
+         rect[0] + x * rect[2], rect[1] + y * rect[3],
+         w * rect[2], h * rect[3]);
 }
 
 static void gl_overlay_vertex_geom(void *data,
@@ -2830,25 +4623,17 @@ static void gl_overlay_vertex_geom(void *data,
       float x, float y,
       float w, float h)
 {
-   GLfloat *vertex = NULL;
    gl_t *gl = (gl_t*)data;
 
-   if (!gl)
+   if (!gl || image >= gl->overlays)
       return;
 
-   vertex = (GLfloat*)&gl->overlay_vertex_coord[image * 8];
-
    /* Flipped, so we preserve top-down semantics. */
    y = 1.0f - y;
    h = -h;
 
-   if (!vertex)
-      return;
-
-   vertex[0] = x;     vertex[1] = y;
-   vertex[2] = x + w; vertex[3] = y;
-   vertex[4] = x;     vertex[5] = y + h;
-   vertex[6] = x + w; vertex[7] = y + h;
+   gl_overlay_set_quad(&gl->overlay_vertex_coord[image * 12],
+         x, y, w, h);
 }
 
 static void gl_overlay_enable(void *data, bool state)
@@ -2878,15 +4663,17 @@ static void gl_overlay_set_alpha(void *data, unsigned image, float mod)
    if (!gl)
       return;
 
-   color = (GLfloat*)&gl->overlay_color_coord[image * 16];
-
-   if (!color)
+   if (image >= gl->overlays)
       return;
 
+   color = (GLfloat*)&gl->overlay_color_coord[image * 24];
+
    color[ 0 + 3] = mod;
    color[ 4 + 3] = mod;
    color[ 8 + 3] = mod;
    color[12 + 3] = mod;
+   color[16 + 3] = mod;
+   color[20 + 3] = mod;
 }
 
 static void gl_render_overlay(void *data)
@@ -2906,14 +4693,22 @@ static void gl_render_overlay(void *data)
    gl->coords.vertex    = gl->overlay_vertex_coord;
    gl->coords.tex_coord = gl->overlay_tex_coord;
    gl->coords.color     = gl->overlay_color_coord;
-   gl->coords.vertices  = 4 * gl->overlays;
+   gl->coords.vertices  = 6 * gl->overlays;
    gl->shader->set_coords(&gl->coords);
    gl->shader->set_mvp(gl, &gl->mvp_no_rot);
 
-   for (i = 0; i < gl->overlays; i++)
+   if (gl->overlay_atlas)
+   {
+      glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[0]);
+      glDrawArrays(GL_TRIANGLES, 0, 6 * gl->overlays);
+   }
+   else
    {
-      glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[i]);
-      glDrawArrays(GL_TRIANGLE_STRIP, 4 * i, 4);
+      for (i = 0; i < gl->overlays; i++)
+      {
+         glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[i]);
+         glDrawArrays(GL_TRIANGLES, 6 * i, 6);
+      }
    }
 
    glDisable(GL_BLEND);
@@ -3081,6 +4876,12 @@ static void gl_show_mouse(void *data, bool state)
       gl->ctx_driver->show_mouse(gl, state);
 }
 
+static bool gl_frame_repeated(void *data)
+{
+   gl_t *gl = (gl_t*)data;
+   return gl && gl->frame_repeated;
+}
+
 static struct gfx_shader *gl_get_current_shader(void *data)
 {
    gl_t *gl = (gl_t*)data;
@@ -3088,6 +4889,49 @@ static struct gfx_shader *gl_get_current_shader(void *data)
 }
 
 
+#ifdef HAVE_GL_SYNC
+/* Hands out the next upload ring slot, so the core renders 
+ * straight into mapped memory and gl_copy_frame() only issues 
+ * the upload from it. */
+static bool gl_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   gl_t *gl = (gl_t*)data;
+
+   if (!gl || !gl->upload_ring_enable)
+      return false;
+
+   /* RGB565 frames still need converting on desktop GL, and 
+    * the mapping is write-combined, so reading it back is slow. */
+   if ((gl->base_size == 2 && !gl->have_es2_compat)
+         || (framebuffer->access_flags & RETRO_MEMORY_ACCESS_READ))
+      return false;
+
+   if (!framebuffer->width || framebuffer->width > gl->tex_w
+         || !framebuffer->height || framebuffer->height > gl->tex_h)
+      return false;
+
+   framebuffer->data         = gl_upload_ring_slot(gl);
+   framebuffer->pitch        = framebuffer->width * gl->base_size;
+   framebuffer->memory_flags = 0;
+   return true;
+}
+
+static bool gl_read_viewport_async(void *data, video_viewport_read_cb_t cb)
+{
+   gl_t *gl = (gl_t*)data;
+
+   /* One screenshot in flight at a time. */
+   if (!gl || !gl->have_sync || !cb
+         || gl->screenshot_request || gl->screenshot_fence)
+      return false;
+
+   gl->screenshot_request = true;
+   gl->screenshot_cb      = cb;
+   return true;
+}
+#endif
+
 static const video_poke_interface_t gl_poke_interface = {
    NULL,
 #ifdef HAVE_FBO
@@ -3106,6 +4950,19 @@ static const video_poke_interface_t gl_poke_interface = {
    NULL,
 
    gl_get_current_shader,
+#ifdef HAVE_GL_SYNC
+   gl_get_current_software_framebuffer,
+   gl_read_viewport_async,
+#else
+   NULL,
+   NULL,
+#endif
+#ifdef HAVE_GL_MAPPED_READBACK
+   gl_read_viewport_mapped,
+#else
+   NULL,
+#endif
+   gl_frame_repeated,
 };
 
 static void gl_get_poke_interface(void *data,
@@ -529,6 +529,11 @@ static void *gx_init(const video_info_t *video,
 
 #define ASM_BLITTER
 
+/* Tiles are written whole, 32 bytes each at 16bpp and 64 at 32bpp.
+ * Zeroing a tile's cache lines first spares reading them in from
+ * memory just to overwrite them. */
+#define GX_DCBZ(ptr) asm volatile ("dcbz 0, %0" : : "b" (ptr) : "memory")
+
 #ifdef ASM_BLITTER
 
 static void update_texture_asm(const uint32_t *src, const uint32_t *dst,
@@ -554,7 +559,9 @@ static void update_texture_asm(const uint32_t *src, const uint32_t *dst,
       "2:   mtctr    %[width]                            \n"
       "     mr       %[tmp0],    %[src]                  \n"
 
-      "1:   lwz      %[tmp1],    0(%[src])               \n"
+      "1:   addi     %[tmp1],    %[dst],     8           \n"
+      "     dcbz     0,          %[tmp1]                 \n"
+      "     lwz      %[tmp1],    0(%[src])               \n"
       "     stwu     %[tmp1],    8(%[dst])               \n"
       "     lwz      %[tmp2],    4(%[src])               \n"
       "     stwu     %[tmp2],    8(%[tmp3])              \n"
@@ -596,7 +603,7 @@ static void update_texture_asm(const uint32_t *src, const uint32_t *dst,
          [width]  "b"   (width),
          [height] "b"   (height),
          [pitch]  "b"   (pitch)
-      :  "cc"
+      :  "cc", "memory"
    );
 }
 
@@ -608,6 +615,8 @@ static void update_texture_asm(const uint32_t *src, const uint32_t *dst,
    uint32_t *tmp_dst = dst; \
    for (unsigned x = 0; x < width2 >> 1; x++, tmp_src += 2, tmp_dst += 8) \
    { \
+      if (off == 0) \
+         GX_DCBZ(tmp_dst); \
       tmp_dst[ 0 + off] = BLIT_LINE_16_CONV(tmp_src[0]); \
       tmp_dst[ 1 + off] = BLIT_LINE_16_CONV(tmp_src[1]); \
    } \
@@ -620,6 +629,11 @@ static void update_texture_asm(const uint32_t *src, const uint32_t *dst,
    uint16_t *tmp_dst = dst; \
    for (unsigned x = 0; x < width2 >> 3; x++, tmp_src += 8, tmp_dst += 32) \
    { \
+      if (off == 0) \
+      { \
+         GX_DCBZ(tmp_dst); \
+         GX_DCBZ(tmp_dst + 16); \
+      } \
       tmp_dst[  0 + off] = tmp_src[0] | 0xFF00; \
       tmp_dst[ 16 + off] = tmp_src[1]; \
       tmp_dst[  1 + off] = tmp_src[2] | 0xFF00; \
@@ -956,12 +970,13 @@ static bool gx_frame(void *data, const void *frame,
       RARCH_PERFORMANCE_STOP(gx_frame_convert);
    }
 
-   if (gx->menu_texture_enable && gx->menu_data)
+   if (gx->menu_texture_enable && gx->menu_data && gx->menu_data_dirty)
    {
       convert_texture16(gx->menu_data, menu_tex.data,
             driver.menu->width, driver.menu->height, driver.menu->width * 2);
       DCFlushRange(menu_tex.data,
             driver.menu->width * driver.menu->height * 2);
+      gx->menu_data_dirty = false;
    }
 
    __GX_InvalidateTexAll(__gx);
@@ -1091,7 +1106,10 @@ static void gx_set_texture_frame(void *data, const void *frame,
    gx_video_t *gx = (gx_video_t*)data;
 
    if (gx)
-      gx->menu_data = (uint32_t*)frame;
+   {
+      gx->menu_data       = (uint32_t*)frame;
+      gx->menu_data_dirty = true;
+   }
 }
 
 static void gx_set_texture_enable(void *data, bool enable, bool full_screen)
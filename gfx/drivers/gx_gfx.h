@@ -33,6 +33,8 @@ typedef struct gx_video
    bool double_strike;
    bool rgb32;
    uint32_t *menu_data; /* FIXME: Should be const uint16_t*. */
+   /* menu_data was set since it was last converted. */
+   bool menu_data_dirty;
    bool menu_texture_enable;
    rarch_viewport_t vp;
    unsigned scale;
@@ -110,13 +110,17 @@ static void sdl2_init_font(sdl2_video_t *vid, const char *font_path,
       return;
    }
 
+   /* The texture is only made once, so every glyph
+    * has to be in the atlas before. */
+   for (i = 0; i < 256; i++)
+      vid->font_driver->get_glyph(vid->font_data, i);
+
    const struct font_atlas *atlas = vid->font_driver->get_atlas(vid->font_data);
 
    SDL_Surface *tmp = SDL_CreateRGBSurfaceFrom(atlas->buffer, atlas->width,
                                                atlas->height, 8, atlas->width,
                                                0, 0, 0, 0);
    SDL_Color colors[256];
-   int i;
 
    for (i = 0; i < 256; ++i)
    {
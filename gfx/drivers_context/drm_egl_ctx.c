@@ -35,6 +35,7 @@
 #include <sched.h>
 #include <sys/time.h>
 #include <math.h>
+#include <string.h>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
@@ -61,6 +62,7 @@ typedef struct gfx_ctx_drm_egl_data
    unsigned g_fb_width;
    unsigned g_fb_height;
    unsigned g_interval;
+   bool g_vrr;
 
    drmModeModeInfo *g_drm_mode;
    drmModeCrtcPtr g_orig_crtc;
@@ -323,6 +325,84 @@ static void free_drm_resources(gfx_ctx_drm_egl_data_t *drm)
    drm->g_drm_fd      = -1;
 }
 
+/**
+ * drm_get_property:
+ * @fd                   : DRM device.
+ * @obj                  : object to look at.
+ * @type                 : type of @obj, DRM_MODE_OBJECT_*.
+ * @name                 : name of the property.
+ * @value                : set to the value of the property, or NULL.
+ *
+ * Returns: id of the property, or 0 if @obj does not have it.
+ **/
+static uint32_t drm_get_property(int fd, uint32_t obj, uint32_t type,
+      const char *name, uint64_t *value)
+{
+   uint32_t i, id = 0;
+   drmModeObjectPropertiesPtr props =
+      drmModeObjectGetProperties(fd, obj, type);
+
+   if (!props)
+      return 0;
+
+   for (i = 0; i < props->count_props && !id; i++)
+   {
+      drmModePropertyPtr prop = drmModeGetProperty(fd, props->props[i]);
+
+      if (!prop)
+         continue;
+
+      if (!strcmp(prop->name, name))
+      {
+         id = prop->prop_id;
+         if (value)
+            *value = props->prop_values[i];
+      }
+      drmModeFreeProperty(prop);
+   }
+
+   drmModeFreeObjectProperties(props);
+   return id;
+}
+
+static bool drm_set_vrr(gfx_ctx_drm_egl_data_t *drm, bool enable)
+{
+   uint32_t prop = drm_get_property(drm->g_drm_fd, drm->g_crtc_id,
+         DRM_MODE_OBJECT_CRTC, "VRR_ENABLED", NULL);
+
+   return prop && drmModeObjectSetProperty(drm->g_drm_fd,
+         drm->g_crtc_id, DRM_MODE_OBJECT_CRTC, prop, enable) == 0;
+}
+
+static bool gfx_ctx_drm_egl_set_vrr(void *data, bool enable)
+{
+   uint64_t capable = 0;
+   gfx_ctx_drm_egl_data_t *drm = (gfx_ctx_drm_egl_data_t*)driver.video_context_data;
+
+   (void)data;
+
+   if (!drm || drm->g_drm_fd < 0 || !drm->g_crtc_id)
+      return false;
+
+   if (!drm_get_property(drm->g_drm_fd, drm->g_connector_id,
+            DRM_MODE_OBJECT_CONNECTOR, "vrr_capable", &capable) || !capable)
+   {
+      if (enable)
+         RARCH_LOG("[KMS/EGL]: Display does not do variable refresh.\n");
+      return false;
+   }
+
+   if (enable != drm->g_vrr && !drm_set_vrr(drm, enable))
+   {
+      RARCH_WARN("[KMS/EGL]: Could not %s variable refresh.\n",
+            enable ? "enable" : "disable");
+      return false;
+   }
+
+   drm->g_vrr = enable;
+   return true;
+}
+
 static void gfx_ctx_drm_egl_destroy_resources(gfx_ctx_drm_egl_data_t *drm)
 {
    if (!drm)
@@ -333,6 +413,11 @@ static void gfx_ctx_drm_egl_destroy_resources(gfx_ctx_drm_egl_data_t *drm)
    if (waiting_for_flip)
       wait_flip(true);
 
+   /* The console after us does not expect it. */
+   if (drm->g_vrr)
+      drm_set_vrr(drm, false);
+   drm->g_vrr = false;
+
    if (drm->g_egl_dpy)
    {
       if (drm->g_egl_ctx)
@@ -963,5 +1048,6 @@ const gfx_ctx_driver_t gfx_ctx_drm_egl = {
    NULL,
    "kms-egl",
    gfx_ctx_drm_egl_bind_hw_render,
+   gfx_ctx_drm_egl_set_vrr,
 };
 
@@ -17,6 +17,8 @@
 #include "../../driver.h"
 #include "../gl_common.h"
 #include "../gfx_common.h"
+#include "../video_pacer.h"
+#include "../../performance.h"
 #include "x11_common.h"
 
 #include <signal.h>
@@ -28,6 +30,8 @@
 
 static int (*g_pglSwapInterval)(int);
 static void (*g_pglSwapIntervalEXT)(Display*, GLXDrawable, int);
+static Bool (*g_pglGetSyncValuesOML)(Display*, GLXDrawable,
+      int64_t*, int64_t*, int64_t*);
 
 typedef struct gfx_ctx_glx_data
 {
@@ -177,6 +181,19 @@ static void gfx_ctx_glx_swap_buffers(void *data)
 
    if (glx->g_is_double)
       glXSwapBuffers(glx->g_dpy, glx->g_glx_win);
+
+   /* Time stamp of the last vblank, for the frame pacer. UST is 
+    * CLOCK_MONOTONIC in practice, but the spec does not promise it,
+    * so ignore it if it's not close to our own clock. */
+   if (g_pglGetSyncValuesOML)
+   {
+      int64_t ust = 0, msc = 0, sbc = 0;
+      retro_time_t now = rarch_get_time_usec();
+
+      if (g_pglGetSyncValuesOML(glx->g_dpy, glx->g_glx_win, &ust, &msc, &sbc)
+            && ust <= now && now - ust < 1000000)
+         video_pacer_set_present_time(ust, msc);
+   }
 }
 
 static void gfx_ctx_glx_set_resize(void *data,
@@ -304,6 +321,7 @@ static void ctx_glx_destroy_resources(gfx_ctx_glx_data_t *glx)
 
    g_pglSwapInterval = NULL;
    g_pglSwapIntervalEXT = NULL;
+   g_pglGetSyncValuesOML = NULL;
    g_major = g_minor = 0;
    glx->g_core = false;
 }
@@ -587,6 +605,16 @@ static bool gfx_ctx_glx_set_video_mode(void *data,
          RARCH_WARN("[GLX]: Cannot find swap interval call.\n");
       else
          RARCH_LOG("[GLX]: Found swap function: %s.\n", swap_func);
+
+      if (strstr(glXQueryExtensionsString(glx->g_dpy,
+                  DefaultScreen(glx->g_dpy)),
+               "GLX_OML_sync_control"))
+         g_pglGetSyncValuesOML = (Bool (*)(Display*, GLXDrawable,
+                  int64_t*, int64_t*, int64_t*))
+            glXGetProcAddress((const GLubyte*)"glXGetSyncValuesOML");
+
+      if (g_pglGetSyncValuesOML)
+         RARCH_LOG("[GLX]: Using GLX_OML_sync_control for swap timing.\n");
    }
    else
       RARCH_WARN("[GLX]: Context is not double buffered!.\n");
@@ -715,6 +743,22 @@ static void gfx_ctx_glx_bind_hw_render(void *data, bool enable)
          glx->g_glx_win, enable ? glx->g_hw_ctx : glx->g_ctx);
 }
 
+static bool gfx_ctx_glx_set_vrr(void *data, bool enable)
+{
+   gfx_ctx_glx_data_t *glx = (gfx_ctx_glx_data_t*)driver.video_context_data;
+
+   (void)data;
+
+   if (!glx || !glx->g_win)
+      return false;
+
+   x11_set_vrr(glx->g_dpy, glx->g_win, enable);
+
+   /* Without RandR, X11 does not tell whether the display 
+    * does variable refresh. */
+   return false;
+}
+
 const gfx_ctx_driver_t gfx_ctx_glx = {
    gfx_ctx_glx_init,
    gfx_ctx_glx_destroy,
@@ -739,5 +783,6 @@ const gfx_ctx_driver_t gfx_ctx_glx = {
    "glx",
 
    gfx_ctx_glx_bind_hw_render,
+   gfx_ctx_glx_set_vrr,
 };
 
@@ -135,6 +135,17 @@ void x11_suspend_screensaver(Window wnd)
       RARCH_WARN("Could not suspend screen saver.\n");
 }
 
+/* Mesa only flips at variable rate for windows asking for it
+ * this way. NVIDIA goes by its own driver settings. */
+void x11_set_vrr(Display *dpy, Window win, bool enable)
+{
+   long value = enable;
+   Atom atom  = XInternAtom(dpy, "_VARIABLE_REFRESH", False);
+
+   XChangeProperty(dpy, win, atom, XA_CARDINAL, 32, PropModeReplace,
+         (const unsigned char*)&value, 1);
+}
+
 static bool get_video_mode(Display *dpy, unsigned width, unsigned height,
       XF86VidModeModeInfo *mode, XF86VidModeModeInfo *desktop_mode)
 {
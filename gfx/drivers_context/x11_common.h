@@ -34,6 +34,7 @@
 void x11_show_mouse(Display *dpy, Window win, bool state);
 void x11_windowed_fullscreen(Display *dpy, Window win);
 void x11_suspend_screensaver(Window win);
+void x11_set_vrr(Display *dpy, Window win, bool enable);
 bool x11_enter_fullscreen(Display *dpy, unsigned width, unsigned height, XF86VidModeModeInfo *desktop_mode);
 void x11_exit_fullscreen(Display *dpy, XF86VidModeModeInfo *desktop_mode);
 void x11_move_window(Display *dpy, Window win, int x, int y, unsigned width, unsigned height);
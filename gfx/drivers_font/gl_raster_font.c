@@ -17,35 +17,83 @@
 #include "../gfx_common.h"
 #include "../gl_common.h"
 #include "../video_shader_driver.h"
+#include "../../performance.h"
 
-#define emit(c, vx, vy) do { \
-   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
-   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
-   font_tex_coords[ 2 * (6 * i + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
-   font_tex_coords[ 2 * (6 * i + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
-   font_color[      4 * (6 * i + c) + 0] = color[0]; \
-   font_color[      4 * (6 * i + c) + 1] = color[1]; \
-   font_color[      4 * (6 * i + c) + 2] = color[2]; \
-   font_color[      4 * (6 * i + c) + 3] = color[3]; \
-} while(0)
+/* Messages laid out lately, by hash of their text. */
+#define GL_RASTER_LAYOUTS 256
 
-#define MAX_MSG_LEN_CHUNK 64
+/* Glyph quads of a message, in font pixels from where it starts,
+ * with texture coordinates. Menus draw the same labels frame after
+ * frame, which then only need moving into place. */
+struct gl_raster_layout
+{
+   char *msg;
+   uint32_t hash;
+   /* x, y, width, height, u0, v0, u1, v1 for each glyph. */
+   GLfloat *quads;
+   unsigned count;
+};
 
 typedef struct
 {
    gl_t *gl;
    GLuint tex;
    unsigned tex_width, tex_height;
+   /* Texture and renderer atlas, accounted to RARCH_MEM_VIDEO. */
+   size_t mem_size;
 
    const font_renderer_driver_t *font_driver;
    void *font_data;
+   /* Atlas generation the texture has. */
+   unsigned atlas_generation;
+
+   struct gl_raster_layout layouts[GL_RASTER_LAYOUTS];
+
+   /* Quads of all messages since begin_batch, drawn at once
+    * by flush. Outside a batch they are drawn right away. */
+   struct
+   {
+      GLfloat *vertex;
+      GLfloat *tex_coord;
+      GLfloat *color;
+      unsigned vertices;
+      unsigned capacity;
+
+      bool active;
+      bool full_screen;
+   } batch;
 } gl_raster_t;
 
+static void gl_raster_font_upload_atlas(gl_raster_t *font,
+      const struct font_atlas *atlas)
+{
+   unsigned i;
+   uint8_t       *dst = NULL;
+   const uint8_t *src = atlas->buffer;
+   uint8_t *tmp_buffer = (uint8_t*)malloc(atlas->width * atlas->height * 4);
+
+   if (!tmp_buffer)
+      return;
+
+   for (i = 0, dst = tmp_buffer; i < atlas->width * atlas->height; i++)
+   {
+      *dst++ = 0xff;
+      *dst++ = 0xff;
+      *dst++ = 0xff;
+      *dst++ = *src++;
+   }
+
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, atlas->width,
+         atlas->height, GL_RGBA, GL_UNSIGNED_BYTE, tmp_buffer);
+   free(tmp_buffer);
+
+   font->atlas_generation = atlas->generation;
+}
+
 static void *gl_raster_font_init_font(void *gl_data,
       const char *font_path, float font_size)
 {
    unsigned width, height;
-   uint8_t *tmp_buffer;
    const struct font_atlas *atlas = NULL;
    gl_raster_t *font = (gl_raster_t*)calloc(1, sizeof(*font));
 
@@ -80,29 +128,15 @@ static void *gl_raster_font_init_font(void *gl_data,
    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
          0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-   tmp_buffer = (uint8_t*)malloc(atlas->width * atlas->height * 4);
-
-   if (tmp_buffer)
-   {
-      unsigned i;
-      uint8_t       *dst = tmp_buffer;
-      const uint8_t *src = atlas->buffer;
-
-      for (i = 0; i < atlas->width * atlas->height; i++)
-      {
-         *dst++ = 0xff;
-         *dst++ = 0xff;
-         *dst++ = 0xff;
-         *dst++ = *src++;
-      }
-
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, atlas->width,
-            atlas->height, GL_RGBA, GL_UNSIGNED_BYTE, tmp_buffer);
-      free(tmp_buffer);
-   }
+   /* Glyphs get added as they are first used,
+    * which uploads it again. */
+   gl_raster_font_upload_atlas(font, atlas);
 
    font->tex_width  = width;
    font->tex_height = height;
+   font->mem_size   = (size_t)width * height * 4 +
+      atlas->width * atlas->height;
+   rarch_mem_add(RARCH_MEM_VIDEO, font->mem_size);
 
    glBindTexture(GL_TEXTURE_2D, font->gl->texture[font->gl->tex_index]);
    return font;
@@ -110,6 +144,7 @@ static void *gl_raster_font_init_font(void *gl_data,
 
 static void gl_raster_font_free_font(void *data)
 {
+   unsigned i;
    gl_raster_t *font = (gl_raster_t*)data;
    if (!font)
       return;
@@ -117,85 +152,87 @@ static void gl_raster_font_free_font(void *data)
    if (font->font_driver && font->font_data)
       font->font_driver->free(font->font_data);
 
+   for (i = 0; i < GL_RASTER_LAYOUTS; i++)
+   {
+      free(font->layouts[i].msg);
+      free(font->layouts[i].quads);
+   }
+
    glDeleteTextures(1, &font->tex);
+   rarch_mem_sub(RARCH_MEM_VIDEO, font->mem_size);
+   free(font->batch.vertex);
+   free(font->batch.tex_coord);
+   free(font->batch.color);
    free(font);
 }
 
+static bool gl_raster_font_reserve(gl_raster_t *font, unsigned vertices)
+{
+   GLfloat *vertex, *tex_coord, *color;
+   unsigned capacity = font->batch.capacity ? font->batch.capacity : 6 * 64;
+
+   if (font->batch.vertices + vertices <= font->batch.capacity)
+      return true;
+
+   while (capacity < font->batch.vertices + vertices)
+      capacity *= 2;
+
+   vertex    = (GLfloat*)realloc(font->batch.vertex,
+         2 * capacity * sizeof(GLfloat));
+   if (vertex)
+      font->batch.vertex = vertex;
+   tex_coord = (GLfloat*)realloc(font->batch.tex_coord,
+         2 * capacity * sizeof(GLfloat));
+   if (tex_coord)
+      font->batch.tex_coord = tex_coord;
+   color     = (GLfloat*)realloc(font->batch.color,
+         4 * capacity * sizeof(GLfloat));
+   if (color)
+      font->batch.color = color;
+
+   if (!vertex || !tex_coord || !color)
+      return false;
+
+   rarch_mem_add(RARCH_MEM_VIDEO,
+         8 * (capacity - font->batch.capacity) * sizeof(GLfloat));
+   font->mem_size      += 8 * (capacity - font->batch.capacity) * sizeof(GLfloat);
+   font->batch.capacity = capacity;
+   return true;
+}
 
-static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
-      const GLfloat color[4], GLfloat pos_x, GLfloat pos_y)
+static void gl_raster_font_draw_batch(gl_raster_t *font)
 {
-   int x, y, delta_x, delta_y;
-   float inv_tex_size_x, inv_tex_size_y, inv_win_width, inv_win_height;
-   unsigned i, msg_len_full, msg_len;
-   GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK]; 
-   GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
+   const struct font_atlas *atlas = NULL;
    gl_t *gl = font->gl;
 
+   if (!font->batch.vertices)
+      return;
+
    glBindTexture(GL_TEXTURE_2D, font->tex);
 
-   msg_len_full   = strlen(msg);
-   msg_len        = min(msg_len_full, MAX_MSG_LEN_CHUNK);
+   atlas = font->font_driver->get_atlas(font->font_data);
+   if (atlas->generation != font->atlas_generation)
+      gl_raster_font_upload_atlas(font, atlas);
 
-   x              = roundf(pos_x * gl->vp.width);
-   y              = roundf(pos_y * gl->vp.height);
-   delta_x        = 0;
-   delta_y        = 0;
+   gl_set_viewport(gl, gl->win_width, gl->win_height,
+         font->batch.full_screen, false);
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glBlendEquation(GL_FUNC_ADD);
 
-   inv_tex_size_x = 1.0f / font->tex_width;
-   inv_tex_size_y = 1.0f / font->tex_height;
-   inv_win_width  = 1.0f / font->gl->vp.width;
-   inv_win_height = 1.0f / font->gl->vp.height;
+   /* Rebind shaders so attrib cache gets reset. */
+   if (gl->shader && gl->shader->use)
+      gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
 
-   while (msg_len_full)
-   {
-      /* Rebind shaders so attrib cache gets reset. */
-      if (gl->shader && gl->shader->use)
-         gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
-
-      for (i = 0; i < msg_len; i++)
-      {
-         int off_x, off_y, tex_x, tex_y, width, height;
-         const struct font_glyph *glyph = 
-            font->font_driver->get_glyph(font->font_data, (uint8_t)msg[i]);
-         if (!glyph)
-            glyph = font->font_driver->get_glyph(font->font_data, '?'); /* Do something smarter here ... */
-         if (!glyph)
-            continue;
-
-         off_x  = glyph->draw_offset_x;
-         off_y  = glyph->draw_offset_y;
-         tex_x  = glyph->atlas_offset_x;
-         tex_y  = glyph->atlas_offset_y;
-         width  = glyph->width;
-         height = glyph->height;
-
-         emit(0, 0, 1); /* Bottom-left */
-         emit(1, 1, 1); /* Bottom-right */
-         emit(2, 0, 0); /* Top-left */
-
-         emit(3, 1, 0); /* Top-right */
-         emit(4, 0, 0); /* Top-left */
-         emit(5, 1, 1); /* Bottom-right */
-#undef emit
+   gl->coords.tex_coord = font->batch.tex_coord;
+   gl->coords.vertex    = font->batch.vertex;
+   gl->coords.color     = font->batch.color;
+   gl->coords.vertices  = font->batch.vertices;
+   gl->shader->set_coords(&gl->coords);
+   gl->shader->set_mvp(gl, &gl->mvp_no_rot);
+   glDrawArrays(GL_TRIANGLES, 0, font->batch.vertices);
 
-         delta_x += glyph->advance_x;
-         delta_y -= glyph->advance_y;
-      }
-
-      gl->coords.tex_coord = font_tex_coords;
-      gl->coords.vertex    = font_vertex;
-      gl->coords.color     = font_color;
-      gl->coords.vertices  = 6 * msg_len;
-      gl->shader->set_coords(&gl->coords);
-      gl->shader->set_mvp(gl, &gl->mvp_no_rot);
-      glDrawArrays(GL_TRIANGLES, 0, 6 * msg_len);
-
-      msg_len_full -= msg_len;
-      msg += msg_len;
-      msg_len = min(msg_len_full, MAX_MSG_LEN_CHUNK);
-   }
+   font->batch.vertices = 0;
 
    /* Post - Go back to old rendering path. */
    gl->coords.vertex    = gl->vertex_ptr;
@@ -203,6 +240,143 @@ static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
    gl->coords.color     = gl->white_color_ptr;
    gl->coords.vertices  = 4;
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+
+   glDisable(GL_BLEND);
+   gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
+}
+
+/**
+ * gl_raster_font_layout:
+ * @font                    : font handle.
+ * @msg                     : message.
+ *
+ * Lays out @msg, unless it was among the last messages drawn.
+ * Glyphs stay where they are in the atlas once added, and
+ * the layout is in font pixels, so it does not go stale
+ * when the viewport changes.
+ *
+ * Returns: layout of @msg, or NULL in case of error.
+ **/
+static const struct gl_raster_layout *gl_raster_font_layout(
+      gl_raster_t *font, const char *msg)
+{
+   int delta_x = 0, delta_y = 0;
+   size_t msg_len;
+   const char *c;
+   GLfloat *quad;
+   float inv_tex_size_x, inv_tex_size_y;
+   uint32_t hash = 2166136261u;
+   struct gl_raster_layout *layout = NULL;
+
+   for (c = msg; *c; c++)
+      hash = (hash ^ (uint8_t)*c) * 16777619u;
+   msg_len = c - msg;
+
+   layout = &font->layouts[hash & (GL_RASTER_LAYOUTS - 1)];
+   if (layout->msg && layout->hash == hash && !strcmp(layout->msg, msg))
+      return layout;
+
+   free(layout->msg);
+   free(layout->quads);
+   layout->hash  = hash;
+   layout->count = 0;
+   layout->msg   = strdup(msg);
+   layout->quads = (GLfloat*)malloc((msg_len + 1) * 8 * sizeof(GLfloat));
+
+   if (!layout->msg || !layout->quads)
+   {
+      free(layout->msg);
+      free(layout->quads);
+      layout->msg   = NULL;
+      layout->quads = NULL;
+      return NULL;
+   }
+
+   inv_tex_size_x = 1.0f / font->tex_width;
+   inv_tex_size_y = 1.0f / font->tex_height;
+
+   for (quad = layout->quads; *msg; msg++)
+   {
+      const struct font_glyph *glyph = 
+         font->font_driver->get_glyph(font->font_data, (uint8_t)*msg);
+      if (!glyph)
+         glyph = font->font_driver->get_glyph(font->font_data, '?'); /* Do something smarter here ... */
+      if (!glyph)
+         continue;
+
+      quad[0] = delta_x + glyph->draw_offset_x;
+      quad[1] = delta_y - glyph->draw_offset_y;
+      quad[2] = glyph->width;
+      quad[3] = glyph->height;
+      quad[4] = glyph->atlas_offset_x * inv_tex_size_x;
+      quad[5] = glyph->atlas_offset_y * inv_tex_size_y;
+      quad[6] = (glyph->atlas_offset_x + glyph->width)  * inv_tex_size_x;
+      quad[7] = (glyph->atlas_offset_y + glyph->height) * inv_tex_size_y;
+
+      delta_x += glyph->advance_x;
+      delta_y -= glyph->advance_y;
+      quad    += 8;
+      layout->count++;
+   }
+
+   return layout;
+}
+
+#define emit(c, vx, vy, u, v) do { \
+   font_vertex[     2 * (6 * i + c) + 0] = vx; \
+   font_vertex[     2 * (6 * i + c) + 1] = vy; \
+   font_tex_coords[ 2 * (6 * i + c) + 0] = u; \
+   font_tex_coords[ 2 * (6 * i + c) + 1] = v; \
+   font_color[      4 * (6 * i + c) + 0] = color[0]; \
+   font_color[      4 * (6 * i + c) + 1] = color[1]; \
+   font_color[      4 * (6 * i + c) + 2] = color[2]; \
+   font_color[      4 * (6 * i + c) + 3] = color[3]; \
+} while(0)
+
+/* Coordinates are relative to the viewport, so it has to be
+ * set up for the message before. */
+static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
+      const GLfloat color[4], GLfloat pos_x, GLfloat pos_y)
+{
+   int x, y;
+   float inv_win_width, inv_win_height;
+   unsigned i;
+   GLfloat *font_tex_coords, *font_vertex, *font_color;
+   gl_t *gl = font->gl;
+   const struct gl_raster_layout *layout = gl_raster_font_layout(font, msg);
+
+   if (!layout || !gl_raster_font_reserve(font, 6 * layout->count))
+      return;
+
+   font_tex_coords = font->batch.tex_coord + 2 * font->batch.vertices;
+   font_vertex     = font->batch.vertex    + 2 * font->batch.vertices;
+   font_color      = font->batch.color     + 4 * font->batch.vertices;
+
+   x              = roundf(pos_x * gl->vp.width);
+   y              = roundf(pos_y * gl->vp.height);
+
+   inv_win_width  = 1.0f / font->gl->vp.width;
+   inv_win_height = 1.0f / font->gl->vp.height;
+
+   for (i = 0; i < layout->count; i++)
+   {
+      const GLfloat *quad = layout->quads + 8 * i;
+      GLfloat left   = (x + quad[0] * scale) * inv_win_width;
+      GLfloat right  = (x + (quad[0] + quad[2]) * scale) * inv_win_width;
+      GLfloat top    = (y + quad[1] * scale) * inv_win_height;
+      GLfloat bottom = (y + (quad[1] - quad[3]) * scale) * inv_win_height;
+
+      emit(0, left,  bottom, quad[4], quad[7]); /* Bottom-left */
+      emit(1, right, bottom, quad[6], quad[7]); /* Bottom-right */
+      emit(2, left,  top,    quad[4], quad[5]); /* Top-left */
+
+      emit(3, right, top,    quad[6], quad[5]); /* Top-right */
+      emit(4, left,  top,    quad[4], quad[5]); /* Top-left */
+      emit(5, right, bottom, quad[6], quad[7]); /* Bottom-right */
+   }
+#undef emit
+
+   font->batch.vertices += 6 * i;
 }
 
 static void gl_raster_font_render_msg(void *data, const char *msg,
@@ -256,11 +430,13 @@ static void gl_raster_font_render_msg(void *data, const char *msg,
       drop_mod = 0.3f;
    }
 
+   /* A batch only has one viewport. */
+   if (full_screen != font->batch.full_screen)
+      gl_raster_font_draw_batch(font);
+   font->batch.full_screen = full_screen;
+
    gl_set_viewport(gl, gl->win_width, gl->win_height,
          full_screen, false);
-   glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-   glBlendEquation(GL_FUNC_ADD);
 
    if (drop_x || drop_y)
    {
@@ -275,8 +451,29 @@ static void gl_raster_font_render_msg(void *data, const char *msg,
    }
    render_message(font, msg, scale, color, x, y);
 
-   glDisable(GL_BLEND);
-   gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
+   if (!font->batch.active)
+      gl_raster_font_draw_batch(font);
+   else
+      gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
+}
+
+static void gl_raster_font_begin_batch(void *data)
+{
+   gl_raster_t *font = (gl_raster_t*)data;
+
+   if (font)
+      font->batch.active = true;
+}
+
+static void gl_raster_font_flush(void *data)
+{
+   gl_raster_t *font = (gl_raster_t*)data;
+
+   if (!font)
+      return;
+
+   gl_raster_font_draw_batch(font);
+   font->batch.active = false;
 }
 
 static const struct font_glyph *gl_raster_font_get_glyph(
@@ -286,7 +483,7 @@ static const struct font_glyph *gl_raster_font_get_glyph(
 
    if (!font)
       return NULL;
-   return font->font_driver->get_glyph((void*)font->font_driver, code);
+   return font->font_driver->get_glyph(font->font_data, code);
 }
 
 gl_font_renderer_t gl_raster_font = {
@@ -295,4 +492,6 @@ gl_font_renderer_t gl_raster_font = {
    gl_raster_font_render_msg,
    "GL raster",
    gl_raster_font_get_glyph,
+   gl_raster_font_begin_batch,
+   gl_raster_font_flush,
 };
@@ -101,4 +101,7 @@ gl_font_renderer_t libdbg_font = {
    libdbg_font_deinit_font,
    libdbg_font_render_msg,
    "GL raster",
+   NULL,
+   NULL,
+   NULL,
 };
@@ -21,15 +21,12 @@
 #include <math.h>
 #include <boolean.h>
 
-#define ATLAS_COLS 16
-#define ATLAS_ROWS 16
-#define ATLAS_SIZE (ATLAS_COLS * ATLAS_ROWS)
+#define ATLAS_SIZE 256
 
 typedef struct bm_renderer
 {
    unsigned scale_factor;
-   struct font_glyph glyphs[ATLAS_SIZE];
-   struct font_atlas atlas;
+   struct font_glyph_cache cache;
 } bm_renderer_t;
 
 static const struct font_atlas *font_renderer_bmp_get_atlas(void *data)
@@ -37,7 +34,7 @@ static const struct font_atlas *font_renderer_bmp_get_atlas(void *data)
    bm_renderer_t *handle = (bm_renderer_t*)data;
    if (!handle)
       return NULL;
-   return &handle->atlas;
+   return &handle->cache.atlas;
 }
 
 static const struct font_glyph *font_renderer_bmp_get_glyph(
@@ -46,15 +43,18 @@ static const struct font_glyph *font_renderer_bmp_get_glyph(
    bm_renderer_t *handle = (bm_renderer_t*)data;
    if (!handle)
       return NULL;
-   return code < ATLAS_SIZE ? &handle->glyphs[code] : NULL;
+   return font_glyph_cache_get(&handle->cache, code);
 }
 
-static void char_to_texture(bm_renderer_t *handle, uint8_t letter,
-      unsigned atlas_x, unsigned atlas_y)
+static bool char_to_texture(void *data, uint32_t letter,
+      struct font_glyph *glyph, uint8_t *target, unsigned pitch,
+      unsigned max_width, unsigned max_height)
 {
    unsigned y, x, xo, yo;
-   uint8_t *target = handle->atlas.buffer + atlas_x + 
-      atlas_y * handle->atlas.width;
+   bm_renderer_t *handle = (bm_renderer_t*)data;
+
+   (void)max_width;
+   (void)max_height;
 
    for (y = 0; y < FONT_HEIGHT; y++)
    {
@@ -67,18 +67,26 @@ static void char_to_texture(bm_renderer_t *handle, uint8_t letter,
          uint8_t *dst        = target;
 
          dst += x * handle->scale_factor;
-         dst += y * handle->scale_factor * handle->atlas.width;
+         dst += y * handle->scale_factor * pitch;
 
          for (yo = 0; yo < handle->scale_factor; yo++)
             for (xo = 0; xo < handle->scale_factor; xo++)
-               dst[xo + yo * handle->atlas.width] = col;
+               dst[xo + yo * pitch] = col;
       }
    }
+
+   glyph->width         = FONT_WIDTH * handle->scale_factor;
+   glyph->height        = FONT_HEIGHT * handle->scale_factor;
+   glyph->draw_offset_x = 0;
+   glyph->draw_offset_y = -FONT_HEIGHT_BASELINE * (int)handle->scale_factor;
+   glyph->advance_x     = (FONT_WIDTH + 1) * handle->scale_factor;
+   glyph->advance_y     = 0;
+
+   return true;
 }
 
 static void *font_renderer_bmp_init(const char *font_path, float font_size)
 {
-   unsigned i;
    bm_renderer_t *handle = (bm_renderer_t*)calloc(1, sizeof(*handle));
 
    if (!handle)
@@ -90,25 +98,13 @@ static void *font_renderer_bmp_init(const char *font_path, float font_size)
    if (!handle->scale_factor)
       handle->scale_factor = 1;
 
-   handle->atlas.width  = FONT_WIDTH * handle->scale_factor * ATLAS_COLS;
-   handle->atlas.height = FONT_HEIGHT * handle->scale_factor * ATLAS_ROWS;
-   handle->atlas.buffer = (uint8_t*)calloc(handle->atlas.width * handle->atlas.height, 1);
-
-   for (i = 0; i < ATLAS_SIZE; i++)
+   if (!font_glyph_cache_init(&handle->cache, ATLAS_SIZE,
+            FONT_WIDTH * handle->scale_factor,
+            FONT_HEIGHT * handle->scale_factor,
+            char_to_texture, handle))
    {
-      unsigned x = (i % ATLAS_COLS) * handle->scale_factor * FONT_WIDTH;
-      unsigned y = (i / ATLAS_COLS) * handle->scale_factor * FONT_HEIGHT;
-
-      char_to_texture(handle, i, x, y);
-
-      handle->glyphs[i].width = FONT_WIDTH * handle->scale_factor;
-      handle->glyphs[i].height = FONT_HEIGHT * handle->scale_factor;
-      handle->glyphs[i].atlas_offset_x = x;
-      handle->glyphs[i].atlas_offset_y = y;
-      handle->glyphs[i].draw_offset_x  = 0;
-      handle->glyphs[i].draw_offset_y  = -FONT_HEIGHT_BASELINE * (int)handle->scale_factor;
-      handle->glyphs[i].advance_x = (FONT_WIDTH + 1) * handle->scale_factor;
-      handle->glyphs[i].advance_y = 0;
+      free(handle);
+      return NULL;
    }
 
    return handle;
@@ -119,7 +115,7 @@ static void font_renderer_bmp_free(void *data)
    bm_renderer_t *handle = (bm_renderer_t*)data;
    if (!handle)
       return;
-   free(handle->atlas.buffer);
+   font_glyph_cache_free(&handle->cache);
    free(handle);
 }
 
@@ -23,18 +23,16 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 
-#define ATLAS_ROWS 8
-#define ATLAS_COLS 16
-#define ATLAS_SIZE (ATLAS_ROWS * ATLAS_COLS)
+#define ATLAS_SIZE 128
 
 typedef struct freetype_renderer
 {
    FT_Library lib;
    FT_Face face;
 
-   struct font_atlas atlas;
-   struct font_glyph glyphs[ATLAS_SIZE];
+   struct font_glyph_cache cache;
 } font_renderer_t;
 
 static const struct font_atlas *font_renderer_ft_get_atlas(void *data)
@@ -42,7 +40,7 @@ static const struct font_atlas *font_renderer_ft_get_atlas(void *data)
    font_renderer_t *handle = (font_renderer_t*)data;
    if (!handle)
       return NULL;
-   return &handle->atlas;
+   return &handle->cache.atlas;
 }
 
 static const struct font_glyph *font_renderer_ft_get_glyph(
@@ -51,7 +49,7 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    font_renderer_t *handle = (font_renderer_t*)data;
    if (!handle)
       return NULL;
-   return code < ATLAS_SIZE ? &handle->glyphs[code] : NULL;
+   return font_glyph_cache_get(&handle->cache, code);
 }
 
 static void font_renderer_ft_free(void *data)
@@ -60,7 +58,7 @@ static void font_renderer_ft_free(void *data)
    if (!handle)
       return;
 
-   free(handle->atlas.buffer);
+   font_glyph_cache_free(&handle->cache);
 
    if (handle->face)
       FT_Done_Face(handle->face);
@@ -69,98 +67,80 @@ static void font_renderer_ft_free(void *data)
    free(handle);
 }
 
-static bool font_renderer_create_atlas(font_renderer_t *handle)
+static bool font_renderer_ft_render_glyph(void *data, uint32_t code,
+      struct font_glyph *glyph, uint8_t *dst, unsigned pitch,
+      unsigned max_width, unsigned max_height)
 {
-   unsigned i;
-   bool ret = true;
-
-   uint8_t *buffer[ATLAS_SIZE] = {NULL};
-   unsigned pitches[ATLAS_SIZE] = {0};
-
-   unsigned max_width = 0;
-   unsigned max_height = 0;
-
-   for (i = 0; i < ATLAS_SIZE; i++)
-   {
-      struct font_glyph *glyph = &handle->glyphs[i];
-
-      if (!glyph)
-         continue;
-
-      if (FT_Load_Char(handle->face, i, FT_LOAD_RENDER))
-      {
-         ret = false;
-         goto end;
-      }
-
-      FT_Render_Glyph(handle->face->glyph, FT_RENDER_MODE_NORMAL);
-      FT_GlyphSlot slot = handle->face->glyph;
+   unsigned r, c;
+   const uint8_t *src    = NULL;
+   FT_GlyphSlot slot     = NULL;
+   font_renderer_t *handle = (font_renderer_t*)data;
 
-      /* Some glyphs can be blank. */
-      buffer[i] = (uint8_t*)calloc(slot->bitmap.rows * slot->bitmap.pitch, 1);
+   if (FT_Load_Char(handle->face, code, FT_LOAD_RENDER))
+      return false;
 
-      glyph->width = slot->bitmap.width;
-      glyph->height = slot->bitmap.rows;
-      pitches[i] = slot->bitmap.pitch;
+   slot = handle->face->glyph;
 
-      glyph->advance_x = slot->advance.x >> 6;
-      glyph->advance_y = slot->advance.y >> 6;
-      glyph->draw_offset_x = slot->bitmap_left;
-      glyph->draw_offset_y = -slot->bitmap_top;
+   glyph->width         = min((unsigned)slot->bitmap.width, max_width);
+   glyph->height        = min((unsigned)slot->bitmap.rows, max_height);
+   glyph->advance_x     = slot->advance.x >> 6;
+   glyph->advance_y     = slot->advance.y >> 6;
+   glyph->draw_offset_x = slot->bitmap_left;
+   glyph->draw_offset_y = -slot->bitmap_top;
 
-      if (buffer[i])
-         memcpy(buffer[i], slot->bitmap.buffer,
-               slot->bitmap.rows * pitches[i]);
-      max_width = max(max_width, (unsigned)slot->bitmap.width);
-      max_height = max(max_height, (unsigned)slot->bitmap.rows);
-   }
+   /* Some glyphs can be blank. */
+   src = (const uint8_t*)slot->bitmap.buffer;
+   if (src)
+      for (r = 0; r < glyph->height;
+            r++, dst += pitch, src += slot->bitmap.pitch)
+         for (c = 0; c < glyph->width; c++)
+            dst[c] = src[c];
 
-   handle->atlas.width = max_width * ATLAS_COLS;
-   handle->atlas.height = max_height * ATLAS_ROWS;
+   return true;
+}
 
-   handle->atlas.buffer = (uint8_t*)
-      calloc(handle->atlas.width * handle->atlas.height, 1);
+/* Cells have to fit any glyph before they are rendered. Loading
+ * one without rendering is cheap and its outline box, snapped to
+ * whole pixels, is what rendering it comes up with. */
+static void font_renderer_ft_cell_size(font_renderer_t *handle,
+      unsigned *width, unsigned *height)
+{
+   unsigned i;
+   FT_GlyphSlot slot = handle->face->glyph;
 
-   if (!handle->atlas.buffer)
-   {
-      ret = false;
-      goto end;
-   }
+   *width  = 0;
+   *height = 0;
 
-   /* Blit our texture atlas. */
    for (i = 0; i < ATLAS_SIZE; i++)
    {
-      unsigned r, c;
-      uint8_t *dst      = NULL;
-      unsigned offset_x = (i % ATLAS_COLS) * max_width;
-      unsigned offset_y = (i / ATLAS_COLS) * max_height;
-
-      handle->glyphs[i].atlas_offset_x = offset_x;
-      handle->glyphs[i].atlas_offset_y = offset_y;
+      unsigned w, h;
 
-      dst = (uint8_t*)handle->atlas.buffer;
-      dst += offset_x + offset_y * handle->atlas.width;
+      if (FT_Load_Char(handle->face, i, FT_LOAD_DEFAULT))
+         continue;
 
-      if (buffer[i])
+      if (slot->format == FT_GLYPH_FORMAT_OUTLINE)
       {
-         const uint8_t *src = (const uint8_t*)buffer[i];
+         FT_BBox box;
 
-         for (r = 0; r < handle->glyphs[i].height;
-               r++, dst += handle->atlas.width, src += pitches[i])
-            for (c = 0; c < handle->glyphs[i].width; c++)
-               dst[c] = src[c];
+         FT_Outline_Get_CBox(&slot->outline, &box);
+         w = ((box.xMax + 63) >> 6) - (box.xMin >> 6);
+         h = ((box.yMax + 63) >> 6) - (box.yMin >> 6);
+      }
+      else
+      {
+         w = slot->bitmap.width;
+         h = slot->bitmap.rows;
       }
-   }
 
-end:
-   for (i = 0; i < ATLAS_SIZE; i++)
-      free(buffer[i]);
-   return ret;
+      *width  = max(*width, w);
+      *height = max(*height, h);
+   }
 }
 
 static void *font_renderer_ft_init(const char *font_path, float font_size)
 {
    FT_Error err;
+   unsigned cell_width, cell_height;
 
    font_renderer_t *handle = (font_renderer_t*)
       calloc(1, sizeof(*handle));
@@ -180,7 +160,10 @@ static void *font_renderer_ft_init(const char *font_path, float font_size)
    if (err)
       goto error;
 
-   if (!font_renderer_create_atlas(handle))
+   font_renderer_ft_cell_size(handle, &cell_width, &cell_height);
+
+   if (!font_glyph_cache_init(&handle->cache, ATLAS_SIZE,
+            cell_width, cell_height, font_renderer_ft_render_glyph, handle))
       goto error;
 
    return handle;
@@ -135,6 +135,10 @@ struct cg_program
    CGparameter frame_dir_v;
    CGparameter mvp;
 
+   /* Tracked state, in the order of cg_shader->variable. */
+   CGparameter state_v[MAX_VARIABLES];
+   CGparameter state_f[MAX_VARIABLES];
+
    struct cg_fbo_params fbo[GFX_MAX_SHADERS];
    struct cg_fbo_params orig;
    struct cg_fbo_params prev[PREV_TEXTURES];
@@ -394,14 +398,16 @@ static void gl_cg_set_params(void *data, unsigned width, unsigned height,
          cnt = state_tracker_get_uniform(cg->state_tracker, tracker_info,
                MAX_VARIABLES, frame_count);
 
+      /* Every pass got the value last frame if it is unchanged. */
       for (i = 0; i < cnt; i++)
       {
-         CGparameter param_v = cgGetNamedParameter(
-               cg->prg[cg->active_idx].vprg, tracker_info[i].id);
-         CGparameter param_f = cgGetNamedParameter(
-               cg->prg[cg->active_idx].fprg, tracker_info[i].id);
-         set_param_1f(param_v, tracker_info[i].value);
-         set_param_1f(param_f, tracker_info[i].value);
+         if (!tracker_info[i].changed)
+            continue;
+
+         set_param_1f(cg->prg[cg->active_idx].state_v[i],
+               tracker_info[i].value);
+         set_param_1f(cg->prg[cg->active_idx].state_f[i],
+               tracker_info[i].value);
       }
    }
 }
@@ -814,6 +820,14 @@ static void set_program_attributes(cg_shader_data_t *cg, unsigned i)
    if (!cg->prg[i].mvp)
       cg->prg[i].mvp = cgGetNamedParameter(cg->prg[i].vprg, "IN.mvp_matrix");
 
+   for (j = 0; j < cg->cg_shader->variables && j < MAX_VARIABLES; j++)
+   {
+      cg->prg[i].state_v[j] = cgGetNamedParameter(cg->prg[i].vprg,
+            cg->cg_shader->variable[j].id);
+      cg->prg[i].state_f[j] = cgGetNamedParameter(cg->prg[i].fprg,
+            cg->cg_shader->variable[j].id);
+   }
+
    cg->prg[i].orig.tex = cgGetNamedParameter(cg->prg[i].fprg, "ORIG.texture");
    cg->prg[i].orig.vid_size_v = cgGetNamedParameter(cg->prg[i].vprg, "ORIG.video_size");
    cg->prg[i].orig.vid_size_f = cgGetNamedParameter(cg->prg[i].fprg, "ORIG.video_size");
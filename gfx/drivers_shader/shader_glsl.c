@@ -16,12 +16,14 @@
 #include <string.h>
 #include <file/file_path.h>
 #include "../../general.h"
+#include "../../retroarch.h"
 #include "shader_glsl.h"
 #include <compat/strl.h>
 #include <compat/posix_string.h>
 #include "../video_state_tracker.h"
 #include "../../dynamic.h"
 #include "../../file_ops.h"
+#include "../../hash.h"
 
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
@@ -41,6 +43,64 @@
 
 #define PREV_TEXTURES (MAX_TEXTURES - 1)
 
+/* Texture units set_params can bind: LUTs, original,
+ * every pass and the previous frames. Unit 0 is left to gl.c. */
+#define GLSL_MAX_TEXUNITS (1 + GFX_MAX_TEXTURES + 1 + GFX_MAX_SHADERS + PREV_TEXTURES)
+#define GLSL_TEXTURE_UNKNOWN ((GLuint)-1)
+
+/* Direct-mapped by uniform location, must be a power of two. */
+#define GLSL_UNIFORM_CACHE_SIZE 64
+
+/* Geometry with more than a quad (menu, fonts, overlays) is 
+ * streamed through one orphaned buffer of this size. */
+#define GLSL_STREAM_VBO_SIZE (64 * 1024)
+
+#if !defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES3)
+#define HAVE_GLSL_FRAME_BLOCK
+#endif
+
+/* Core profile shaders can read the uniforms shared by all passes
+ * from one uniform buffer, filled once per frame. A shader opts in
+ * by putting RARCH_FRAME_BLOCK at global scope, which expands to:
+ *
+ * layout(std140) uniform RetroArchFrameBlock {
+ *    vec4 RetroArchOrigSize;          xy: InputSize, zw: TextureSize
+ *    vec4 RetroArchPrevSize[PREV_TEXTURES];  same, for Prev, Prev1, ...
+ *    vec4 RetroArchFrame;             x: FrameCount, y: FrameDirection
+ *    vec4 RetroArchParameters[GFX_MAX_PARAMETERS / 4];
+ *    vec4 RetroArchState[GFX_MAX_VARIABLES / 4];
+ * };
+ *
+ * Each #pragma parameter and state variable also gets a 
+ * RARCH_PARAM_<id> or RARCH_STATE_<id> define for its element. 
+ * FrameCount is not reduced by frame_count_mod here. */
+#define GLSL_FRAME_BLOCK_NAME "RetroArchFrameBlock"
+#define GLSL_FRAME_BLOCK_BINDING 0
+
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
+/* A program whose compile and link may still be running. */
+struct glsl_program_build
+{
+   GLuint prog;
+   GLuint vert;
+   GLuint frag;
+   bool has_source;
+   bool cache;
+   bool cached;
+   char cache_path[PATH_MAX_LENGTH];
+};
+
+struct glsl_frame_block
+{
+   GLfloat orig_size[4];
+   GLfloat prev_size[PREV_TEXTURES][4];
+   GLfloat frame[4];
+   GLfloat parameters[GFX_MAX_PARAMETERS];
+   GLfloat state[GFX_MAX_VARIABLES];
+};
 
 /* Cache the VBO. */
 struct cache_vbo
@@ -92,6 +152,27 @@ struct shader_uniforms
    struct shader_uniforms_frame orig;
    struct shader_uniforms_frame pass[GFX_MAX_SHADERS];
    struct shader_uniforms_frame prev[PREV_TEXTURES];
+
+   int parameters[GFX_MAX_PARAMETERS];
+   int state[GFX_MAX_VARIABLES];
+};
+
+/* Last value uploaded to a uniform location of a program. */
+struct glsl_uniform_cache
+{
+   GLint location;
+   GLfloat value[2];
+};
+
+/* What glsl last set on the GL context. Only valid within
+ * one video frame, as the core may touch any state in between. */
+struct glsl_state_shadow
+{
+   bool valid;
+   unsigned frame_count;
+   GLuint program;
+   unsigned active_texunit;
+   GLuint textures[GLSL_MAX_TEXUNITS];
 };
 
 
@@ -215,12 +296,56 @@ typedef struct glsl_shader_data
    GLuint gl_teximage[GFX_MAX_TEXTURES];
    GLint gl_attribs[PREV_TEXTURES + 1 + 4 + GFX_MAX_SHADERS];
    state_tracker_t *gl_state_tracker;
+   struct glsl_state_shadow shadow;
+   struct glsl_uniform_cache uniform_cache[GFX_MAX_SHADERS][GLSL_UNIFORM_CACHE_SIZE];
+   unsigned uniform_cache_index[GFX_MAX_SHADERS];
+   char glsl_frame_define[16 * 1024];
+   GLuint frame_block_ubo;
+   bool frame_block;
+   struct glsl_program_build builds[GFX_MAX_SHADERS];
+   bool poll_builds;
+
+   GLuint vbo_stream;
+   size_t vbo_stream_size;
+   size_t vbo_stream_offset;
+   /* Scratch space set_coords packs large draws into. */
+   GLfloat *coords_buffer;
+   size_t coords_buffer_elems;
 } glsl_shader_data_t;
 
 static bool glsl_core;
 static unsigned glsl_major;
 static unsigned glsl_minor;
 
+#if defined(HAVE_OPENGLES2)
+#define glsl_get_program_binary glGetProgramBinaryOES
+#define glsl_program_binary glProgramBinaryOES
+#define GLSL_NUM_PROGRAM_BINARY_FORMATS GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GLSL_PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH_OES
+#else
+#define glsl_get_program_binary glGetProgramBinary
+#define glsl_program_binary glProgramBinary
+#define GLSL_NUM_PROGRAM_BINARY_FORMATS GL_NUM_PROGRAM_BINARY_FORMATS
+#define GLSL_PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH
+#endif
+
+/* Linked programs are cached on disk as driver binaries. 
+ * Files are named after a hash of the full shader source 
+ * and the GL driver strings, so a changed shader or driver 
+ * simply misses the cache. */
+#define GLSL_CACHE_MAGIC 0x50425352 /* "RSBP" */
+
+struct glsl_cache_header
+{
+   uint32_t magic;
+   uint32_t format;
+   uint32_t size;
+};
+
+static bool glsl_cache_enable;
+static char glsl_cache_dir[PATH_MAX_LENGTH];
+static char glsl_cache_driver[1024];
+
 static GLint get_uniform(glsl_shader_data_t *glsl,
       GLuint prog, const char *base)
 {
@@ -311,40 +436,57 @@ static void print_linker_log(GLuint obj)
    free(info_log);
 }
 
-static bool compile_shader(glsl_shader_data_t *glsl,
-      GLuint shader,
-      const char *define, const char *program)
+/* Core contexts need a #version line
+ * if the shader doesn't bring its own. */
+static void glsl_version_define(char *version, size_t size,
+      const char *program)
 {
-   char version[32] = {0};
-   if (glsl_core && !strstr(program, "#version"))
-   {
-      unsigned version_no = 0;
-      unsigned gl_ver = glsl_major * 100 + glsl_minor * 10;
+   unsigned version_no = 0;
+   unsigned gl_ver = glsl_major * 100 + glsl_minor * 10;
 
-      switch (gl_ver)
-      {
-         case 300:
-            version_no = 130;
-            break;
-         case 310:
-            version_no = 140;
-            break;
-         case 320:
-            version_no = 150;
-            break;
-         default:
-            version_no = gl_ver;
-            break;
-      }
+   *version = '\0';
+   if (!glsl_core || !program || strstr(program, "#version"))
+      return;
 
-      snprintf(version, sizeof(version), "#version %u\n", version_no);
-      RARCH_LOG("[GL]: Using GLSL version %u.\n", version_no);
+   switch (gl_ver)
+   {
+      case 300:
+         version_no = 130;
+         break;
+      case 310:
+         version_no = 140;
+         break;
+      case 320:
+         version_no = 150;
+         break;
+      default:
+         version_no = gl_ver;
+         break;
    }
 
-   const char *source[] = { version, define, glsl->glsl_alias_define, program };
+   snprintf(version, size, "#version %u\n", version_no);
+}
+
+/* Compiling and linking are only issued here, the status is 
+ * queried later so a driver can work on all passes at once. */
+static void compile_shader(glsl_shader_data_t *glsl,
+      GLuint shader,
+      const char *define, const char *program)
+{
+   char version[32];
+
+   glsl_version_define(version, sizeof(version), program);
+   if (*version)
+      RARCH_LOG("[GL]: Using GLSL %s", version + 1);
+
+   const char *source[] = { version, define, glsl->glsl_alias_define,
+      glsl->glsl_frame_define, program };
    glShaderSource(shader, ARRAY_SIZE(source), source, NULL);
    glCompileShader(shader);
+}
 
+static bool check_shader(GLuint shader)
+{
    GLint status;
    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
    print_shader_log(shader);
@@ -354,8 +496,6 @@ static bool compile_shader(glsl_shader_data_t *glsl,
 
 static bool link_program(GLuint prog)
 {
-   glLinkProgram(prog);
-
    GLint status;
    glGetProgramiv(prog, GL_LINK_STATUS, &status);
    print_linker_log(prog);
@@ -367,69 +507,316 @@ static bool link_program(GLuint prog)
    return true;
 }
 
-static GLuint compile_program(glsl_shader_data_t *glsl,
-      const char *vertex,
-      const char *fragment, unsigned i)
+static void glsl_cache_init(void)
 {
-   GLuint vert = 0, frag = 0, prog = glCreateProgram();
-   if (!prog)
-      return 0;
+   GLint formats       = 0;
+   const char *vendor   = (const char*)glGetString(GL_VENDOR);
+   const char *renderer = (const char*)glGetString(GL_RENDERER);
+   const char *version  = (const char*)glGetString(GL_VERSION);
+
+   glsl_cache_enable = false;
+
+#if defined(HAVE_OPENGLES2) && !defined(RARCH_CONSOLE)
+   rglgen_resolve_extension("OES_get_program_binary");
+#endif
+
+   if (!glsl_get_program_binary || !glsl_program_binary)
+      return;
+#ifndef HAVE_OPENGLES2
+   if (!glProgramParameteri)
+      return;
+#endif
+
+   glGetIntegerv(GLSL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+   if (formats <= 0)
+      return;
+
+   if (*g_settings.video.shader_cache_dir)
+      strlcpy(glsl_cache_dir, g_settings.video.shader_cache_dir,
+            sizeof(glsl_cache_dir));
+   else if (!rarch_cache_path(glsl_cache_dir, sizeof(glsl_cache_dir),
+            "shader_cache"))
+      return;
+
+   if (!path_is_directory(glsl_cache_dir) && !path_mkdir(glsl_cache_dir))
+   {
+      RARCH_WARN("[GL]: Cannot create shader cache directory \"%s\".\n",
+            glsl_cache_dir);
+      return;
+   }
+
+   snprintf(glsl_cache_driver, sizeof(glsl_cache_driver), "%s\n%s\n%s\n",
+         vendor ? vendor : "", renderer ? renderer : "",
+         version ? version : "");
+   glsl_cache_enable = true;
+}
+
+/* Builds the cache file path of a program from everything 
+ * which goes into compiling it. */
+static bool glsl_cache_path(glsl_shader_data_t *glsl, char *path, size_t size,
+      const char *vertex, const char *fragment)
+{
+   char hash[65], name[80];
+   const char *parts[7];
+   size_t len = 0, i, pos = 0;
+   char *buf;
+   char version_vert[32], version_frag[32];
+
+   glsl_version_define(version_vert, sizeof(version_vert), vertex);
+   glsl_version_define(version_frag, sizeof(version_frag), fragment);
+
+   parts[0] = glsl_cache_driver;
+   parts[1] = glsl->glsl_alias_define;
+   parts[2] = glsl->glsl_frame_define;
+   parts[3] = version_vert;
+   parts[4] = vertex ? vertex : "";
+   parts[5] = version_frag;
+   parts[6] = fragment ? fragment : "";
+
+   /* Keep a separator between parts, so moving
+    * text from one to the next changes the hash. */
+   for (i = 0; i < ARRAY_SIZE(parts); i++)
+      len += strlen(parts[i]) + 1;
+
+   buf = (char*)malloc(len);
+   if (!buf)
+      return false;
+
+   for (i = 0; i < ARRAY_SIZE(parts); i++)
+   {
+      size_t part_len = strlen(parts[i]);
+      memcpy(buf + pos, parts[i], part_len);
+      pos += part_len;
+      buf[pos++] = '\0';
+   }
+
+   sha256_hash(hash, (const uint8_t*)buf, len);
+   free(buf);
+
+   snprintf(name, sizeof(name), "%s.bin", hash);
+   fill_pathname_join(path, glsl_cache_dir, name, size);
+   return true;
+}
+
+static bool glsl_cache_load(GLuint prog, const char *path)
+{
+   GLint status = GL_FALSE;
+   void *buf    = NULL;
+   long len     = read_file(path, &buf);
+   const struct glsl_cache_header *header =
+      (const struct glsl_cache_header*)buf;
+
+   if (len < (long)sizeof(*header) || header->magic != GLSL_CACHE_MAGIC
+         || header->size != len - sizeof(*header))
+   {
+      free(buf);
+      return false;
+   }
+
+   glsl_program_binary(prog, header->format, header + 1, header->size);
+   glGetProgramiv(prog, GL_LINK_STATUS, &status);
+   free(buf);
+
+   if (status != GL_TRUE)
+   {
+      /* The driver refused the binary, e.g. after an update 
+       * which kept its version string. Clear the error and 
+       * compile the program from source instead. */
+      while (glGetError() != GL_NO_ERROR);
+      return false;
+   }
+
+   return true;
+}
+
+static void glsl_cache_store(GLuint prog, const char *path)
+{
+   GLint size      = 0;
+   GLsizei written = 0;
+   GLenum format   = 0;
+   struct glsl_cache_header *header = NULL;
+
+   glGetProgramiv(prog, GLSL_PROGRAM_BINARY_LENGTH, &size);
+   if (size <= 0)
+      return;
+
+   header = (struct glsl_cache_header*)malloc(sizeof(*header) + size);
+   if (!header)
+      return;
+
+   glsl_get_program_binary(prog, size, &written, &format, header + 1);
+
+   header->magic  = GLSL_CACHE_MAGIC;
+   header->format = format;
+   header->size   = written;
+
+   /* Other instances may load the same file meanwhile. */
+   if (written <= 0 ||
+         !write_file_safe(path, header, sizeof(*header) + written))
+      RARCH_WARN("[GL]: Failed to write shader cache \"%s\".\n", path);
+
+   free(header);
+}
+
+static bool compile_program_begin(glsl_shader_data_t *glsl,
+      const char *vertex, const char *fragment,
+      unsigned i, struct glsl_program_build *build)
+{
+   memset(build, 0, sizeof(*build));
+
+   build->prog = glCreateProgram();
+   if (!build->prog)
+      return false;
+
+   build->has_source = vertex || fragment;
+
+   if (glsl_cache_enable && build->has_source)
+      build->cache = glsl_cache_path(glsl, build->cache_path,
+            sizeof(build->cache_path), vertex, fragment);
+
+   if (build->cache)
+   {
+      build->cached = glsl_cache_load(build->prog, build->cache_path);
+      if (build->cached)
+         RARCH_LOG("Loaded GLSL program #%u from shader cache.\n", i);
+#ifndef HAVE_OPENGLES2
+      else
+         glProgramParameteri(build->prog,
+               GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+   }
+
+   if (build->cached)
+      return true;
 
    if (vertex)
    {
       RARCH_LOG("Found GLSL vertex shader.\n");
-      vert = glCreateShader(GL_VERTEX_SHADER);
-      if (!compile_shader(
-               glsl,
-               vert, "#define VERTEX\n#define PARAMETER_UNIFORM\n", vertex))
-      {
-         RARCH_ERR("Failed to compile vertex shader #%u\n", i);
-         return 0;
-      }
-
-      glAttachShader(prog, vert);
+      build->vert = glCreateShader(GL_VERTEX_SHADER);
+      compile_shader(glsl, build->vert,
+            "#define VERTEX\n#define PARAMETER_UNIFORM\n", vertex);
+      glAttachShader(build->prog, build->vert);
    }
 
    if (fragment)
    {
       RARCH_LOG("Found GLSL fragment shader.\n");
-      frag = glCreateShader(GL_FRAGMENT_SHADER);
-      if (!compile_shader(glsl, frag,
-               "#define FRAGMENT\n#define PARAMETER_UNIFORM\n", fragment))
-      {
-         RARCH_ERR("Failed to compile fragment shader #%u\n", i);
-         return 0;
-      }
-
-      glAttachShader(prog, frag);
+      build->frag = glCreateShader(GL_FRAGMENT_SHADER);
+      compile_shader(glsl, build->frag,
+            "#define FRAGMENT\n#define PARAMETER_UNIFORM\n", fragment);
+      glAttachShader(build->prog, build->frag);
    }
 
-   if (vertex || fragment)
+   if (build->has_source)
    {
       RARCH_LOG("Linking GLSL program.\n");
-      if (!link_program(prog))
+      glLinkProgram(build->prog);
+   }
+
+   return true;
+}
+
+/**
+ * compile_program_ready:
+ * @build                   : Program started by compile_program_begin().
+ *
+ * Returns: false (0) while the driver is still compiling 
+ * or linking @build in the background, otherwise true (1).
+ **/
+static bool compile_program_ready(const struct glsl_program_build *build)
+{
+   GLint done = GL_TRUE;
+
+   if (build->prog && build->has_source && !build->cached)
+      glGetProgramiv(build->prog, GL_COMPLETION_STATUS_ARB, &done);
+
+   return done == GL_TRUE;
+}
+
+static GLuint compile_program_end(glsl_shader_data_t *glsl,
+      struct glsl_program_build *build, unsigned i)
+{
+   GLuint prog = build->prog;
+
+   if (!prog)
+      return 0;
+
+   if (!build->cached && build->has_source)
+   {
+      bool ok = true;
+
+      if (build->vert && !check_shader(build->vert))
+      {
+         RARCH_ERR("Failed to compile vertex shader #%u\n", i);
+         ok = false;
+      }
+
+      if (ok && build->frag && !check_shader(build->frag))
+      {
+         RARCH_ERR("Failed to compile fragment shader #%u\n", i);
+         ok = false;
+      }
+
+      if (ok && !link_program(prog))
       {
          RARCH_ERR("Failed to link program #%u.\n", i);
-         return 0;
+         ok = false;
       }
 
       /* Clean up dead memory. We're not going to relink the program.
        * Detaching first seems to kill some mobile drivers 
        * (according to the intertubes anyways). */
-      if (vert)
-         glDeleteShader(vert);
-      if (frag)
-         glDeleteShader(frag);
+      if (build->vert)
+         glDeleteShader(build->vert);
+      if (build->frag)
+         glDeleteShader(build->frag);
+      build->vert = build->frag = 0;
+
+      if (!ok)
+      {
+         glDeleteProgram(prog);
+         build->prog = 0;
+         return 0;
+      }
+
+      if (build->cache)
+         glsl_cache_store(prog, build->cache_path);
+   }
 
+   if (build->has_source)
+   {
       glUseProgram(prog);
       GLint location = get_uniform(glsl, prog, "Texture");
       glUniform1i(location, 0);
       glUseProgram(0);
    }
 
+   build->prog = 0;
    return prog;
 }
 
+static void compile_program_abort(struct glsl_program_build *build)
+{
+   if (build->vert)
+      glDeleteShader(build->vert);
+   if (build->frag)
+      glDeleteShader(build->frag);
+   if (build->prog)
+      glDeleteProgram(build->prog);
+   memset(build, 0, sizeof(*build));
+}
+
+static GLuint compile_program(glsl_shader_data_t *glsl,
+      const char *vertex,
+      const char *fragment, unsigned i)
+{
+   struct glsl_program_build build;
+
+   if (!compile_program_begin(glsl, vertex, fragment, i, &build))
+      return 0;
+   return compile_program_end(glsl, &build, i);
+}
+
 static bool load_source_path(struct gfx_shader_pass *pass,
       const char *path)
 {
@@ -440,7 +827,7 @@ static bool load_source_path(struct gfx_shader_pass *pass,
    return pass->source.string.fragment && pass->source.string.vertex;
 }
 
-static bool compile_programs(glsl_shader_data_t *glsl, GLuint *gl_prog)
+static bool compile_programs_begin(glsl_shader_data_t *glsl)
 {
    unsigned i;
 
@@ -465,11 +852,41 @@ static bool compile_programs(glsl_shader_data_t *glsl, GLuint *gl_prog)
       vertex   = pass->source.string.vertex;
       fragment = pass->source.string.fragment;
 
-      gl_prog[i] = compile_program(glsl, vertex, fragment, i);
+      if (!compile_program_begin(glsl, vertex, fragment, i + 1,
+               &glsl->builds[i]))
+      {
+         RARCH_ERR("Failed to create GL program #%u.\n", i + 1);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool compile_programs_ready(glsl_shader_data_t *glsl)
+{
+   unsigned i;
+
+   for (i = 0; i < glsl->glsl_shader->passes; i++)
+   {
+      if (!compile_program_ready(&glsl->builds[i]))
+         return false;
+   }
+
+   return true;
+}
+
+static bool compile_programs_end(glsl_shader_data_t *glsl, GLuint *gl_prog)
+{
+   unsigned i;
+
+   for (i = 0; i < glsl->glsl_shader->passes; i++)
+   {
+      gl_prog[i] = compile_program_end(glsl, &glsl->builds[i], i + 1);
 
       if (!gl_prog[i])
       {
-         RARCH_ERR("Failed to create GL program #%u.\n", i);
+         RARCH_ERR("Failed to create GL program #%u.\n", i + 1);
          return false;
       }
    }
@@ -510,18 +927,13 @@ static void gl_glsl_set_vbo(GLfloat **buffer, size_t *buffer_elems,
    }
 }
 
-static void gl_glsl_set_attribs(glsl_shader_data_t *glsl,
-      GLuint vbo,
-      GLfloat **buffer, size_t *buffer_elems,
-      const GLfloat *data, size_t elems,
-      const struct glsl_attrib *attrs, size_t num_attrs)
+/* Points the attribs at the bound array buffer, 
+ * @base bytes into it. */
+static void gl_glsl_enable_attribs(glsl_shader_data_t *glsl,
+      size_t base, const struct glsl_attrib *attrs, size_t num_attrs)
 {
    size_t i;
 
-   glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-   gl_glsl_set_vbo(buffer, buffer_elems, data, elems);
-
    for (i = 0; i < num_attrs; i++)
    {
       GLint loc = attrs[i].loc;
@@ -530,12 +942,59 @@ static void gl_glsl_set_attribs(glsl_shader_data_t *glsl,
       {
          glEnableVertexAttribArray(loc);
          glVertexAttribPointer(loc, attrs[i].size, GL_FLOAT, GL_FALSE, 0,
-               (const GLvoid*)(uintptr_t)attrs[i].offset);
+               (const GLvoid*)(uintptr_t)(base + attrs[i].offset));
          glsl->gl_attribs[glsl->gl_attrib_index++] = loc;
       }
       else
          RARCH_WARN("Attrib array buffer was overflown!\n");
    }
+}
+
+static void gl_glsl_set_attribs(glsl_shader_data_t *glsl,
+      GLuint vbo,
+      GLfloat **buffer, size_t *buffer_elems,
+      const GLfloat *data, size_t elems,
+      const struct glsl_attrib *attrs, size_t num_attrs)
+{
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+   gl_glsl_set_vbo(buffer, buffer_elems, data, elems);
+   gl_glsl_enable_attribs(glsl, 0, attrs, num_attrs);
+
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * gl_glsl_stream_attribs:
+ * @glsl                    : pointer to GLSL shader data.
+ * @data                    : attrib data to upload.
+ * @elems                   : number of floats in @data.
+ * @attrs                   : attribs to point into @data.
+ * @num_attrs               : number of attribs.
+ *
+ * Appends @data to the streaming VBO. Once the buffer is 
+ * full its store is orphaned, so the driver hands out fresh 
+ * memory instead of waiting for draws still reading the old one.
+ **/
+static void gl_glsl_stream_attribs(glsl_shader_data_t *glsl,
+      const GLfloat *data, size_t elems,
+      const struct glsl_attrib *attrs, size_t num_attrs)
+{
+   size_t size = elems * sizeof(GLfloat);
+
+   glBindBuffer(GL_ARRAY_BUFFER, glsl->vbo_stream);
+
+   if (glsl->vbo_stream_offset + size > glsl->vbo_stream_size)
+   {
+      glsl->vbo_stream_size = max(GLSL_STREAM_VBO_SIZE, size);
+      glBufferData(GL_ARRAY_BUFFER, glsl->vbo_stream_size,
+            NULL, GL_STREAM_DRAW);
+      glsl->vbo_stream_offset = 0;
+   }
+
+   glBufferSubData(GL_ARRAY_BUFFER, glsl->vbo_stream_offset, size, data);
+   gl_glsl_enable_attribs(glsl, glsl->vbo_stream_offset, attrs, num_attrs);
+   glsl->vbo_stream_offset += (size + 15) & ~15;
 
    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -624,9 +1083,247 @@ static void find_uniforms(glsl_shader_data_t *glsl,
       find_uniforms_frame(glsl, prog, &uni->prev[i], frame_base);
    }
 
+   for (i = 0; i < glsl->glsl_shader->num_parameters; i++)
+      uni->parameters[i] = glGetUniformLocation(prog,
+            glsl->glsl_shader->parameters[i].id);
+
+   /* State tracker uniforms come back in variable order. */
+   for (i = 0; i < glsl->glsl_shader->variables; i++)
+      uni->state[i] = glGetUniformLocation(prog,
+            glsl->glsl_shader->variable[i].id);
+
+#ifdef HAVE_GLSL_FRAME_BLOCK
+   if (*glsl->glsl_frame_define)
+   {
+      GLuint block = glGetUniformBlockIndex(prog, GLSL_FRAME_BLOCK_NAME);
+
+      if (block != GL_INVALID_INDEX)
+      {
+         glUniformBlockBinding(prog, block, GLSL_FRAME_BLOCK_BINDING);
+         glsl->frame_block = true;
+      }
+   }
+#endif
+
    glUseProgram(0);
 }
 
+#ifdef HAVE_GLSL_FRAME_BLOCK
+static void gl_glsl_init_frame_define(glsl_shader_data_t *glsl)
+{
+   unsigned i;
+   char define[256];
+   static const char components[] = "xyzw";
+   char *out   = glsl->glsl_frame_define;
+   size_t size = sizeof(glsl->glsl_frame_define);
+
+   *out = '\0';
+
+   /* Uniform blocks need GLSL 1.40. */
+   if (!glsl_core || glsl_major * 100 + glsl_minor * 10 < 310 ||
+         !glGetUniformBlockIndex || !glUniformBlockBinding || !glBindBufferBase)
+      return;
+
+   snprintf(define, sizeof(define),
+         "#define RARCH_FRAME_BLOCK layout(std140) uniform %s { "
+         "vec4 RetroArchOrigSize; vec4 RetroArchPrevSize[%u]; "
+         "vec4 RetroArchFrame; vec4 RetroArchParameters[%u]; "
+         "vec4 RetroArchState[%u]; };\n",
+         GLSL_FRAME_BLOCK_NAME, PREV_TEXTURES,
+         GFX_MAX_PARAMETERS / 4, GFX_MAX_VARIABLES / 4);
+   strlcat(out, define, size);
+
+   for (i = 0; i < glsl->glsl_shader->num_parameters; i++)
+   {
+      snprintf(define, sizeof(define),
+            "#define RARCH_PARAM_%s RetroArchParameters[%u].%c\n",
+            glsl->glsl_shader->parameters[i].id, i / 4, components[i % 4]);
+      strlcat(out, define, size);
+   }
+
+   for (i = 0; i < glsl->glsl_shader->variables; i++)
+   {
+      snprintf(define, sizeof(define),
+            "#define RARCH_STATE_%s RetroArchState[%u].%c\n",
+            glsl->glsl_shader->variable[i].id, i / 4, components[i % 4]);
+      strlcat(out, define, size);
+   }
+}
+
+static void gl_glsl_init_frame_block(glsl_shader_data_t *glsl)
+{
+   if (!glsl->frame_block)
+      return;
+
+   glGenBuffers(1, &glsl->frame_block_ubo);
+   glBindBuffer(GL_UNIFORM_BUFFER, glsl->frame_block_ubo);
+   glBufferData(GL_UNIFORM_BUFFER, sizeof(struct glsl_frame_block),
+         NULL, GL_STREAM_DRAW);
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+   RARCH_LOG("[GL]: Using uniform buffer for frame uniforms.\n");
+}
+
+static void gl_glsl_update_frame_block(glsl_shader_data_t *glsl,
+      const struct gl_tex_info *info, const struct gl_tex_info *prev_info,
+      unsigned frame_count,
+      const struct state_tracker_uniform *state_info, unsigned state_cnt)
+{
+   unsigned i;
+   struct glsl_frame_block block = {{0}};
+
+   memcpy(block.orig_size, info->input_size, 2 * sizeof(GLfloat));
+   memcpy(block.orig_size + 2, info->tex_size, 2 * sizeof(GLfloat));
+
+   for (i = 0; i < PREV_TEXTURES; i++)
+   {
+      memcpy(block.prev_size[i], prev_info[i].input_size, 2 * sizeof(GLfloat));
+      memcpy(block.prev_size[i] + 2, prev_info[i].tex_size, 2 * sizeof(GLfloat));
+   }
+
+   block.frame[0] = (GLfloat)frame_count;
+   block.frame[1] = g_extern.frame_is_reverse ? -1.0f : 1.0f;
+
+   for (i = 0; i < glsl->glsl_shader->num_parameters; i++)
+      block.parameters[i] = glsl->glsl_shader->parameters[i].current;
+
+   for (i = 0; i < state_cnt; i++)
+      block.state[i] = state_info[i].value;
+
+   /* Rebound every frame, the core may use binding points too. */
+   glBindBufferBase(GL_UNIFORM_BUFFER, GLSL_FRAME_BLOCK_BINDING,
+         glsl->frame_block_ubo);
+   glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+#endif
+
+static void gl_glsl_init_uniform_cache(glsl_shader_data_t *glsl)
+{
+   unsigned i, j;
+
+   for (i = 0; i < GFX_MAX_SHADERS; i++)
+   {
+      for (j = 0; j < GLSL_UNIFORM_CACHE_SIZE; j++)
+         glsl->uniform_cache[i][j].location = -1;
+
+      /* Passes aliasing the same program must share 
+       * its cache, uniform values belong to the program. */
+      glsl->uniform_cache_index[i] = i;
+      for (j = 0; j < i; j++)
+      {
+         if (glsl->gl_program[j] == glsl->gl_program[i])
+         {
+            glsl->uniform_cache_index[i] = j;
+            break;
+         }
+      }
+   }
+
+   glsl->shadow.valid = false;
+}
+
+/**
+ * gl_glsl_uniform_changed:
+ * @glsl                    : GLSL shader handle.
+ * @location                : Uniform location in the active program.
+ * @value                   : New value, at most two floats in size.
+ * @size                    : Size of @value in bytes.
+ *
+ * Records @value as the current value of @location.
+ *
+ * Returns: true (1) if the uniform has to be uploaded,
+ * otherwise false (0).
+ **/
+static bool gl_glsl_uniform_changed(glsl_shader_data_t *glsl,
+      GLint location, const void *value, size_t size)
+{
+   struct glsl_uniform_cache *entry = NULL;
+
+   if (location < 0)
+      return false;
+
+   entry = &glsl->uniform_cache
+      [glsl->uniform_cache_index[glsl->glsl_active_index]]
+      [location & (GLSL_UNIFORM_CACHE_SIZE - 1)];
+
+   if (entry->location == location && !memcmp(entry->value, value, size))
+      return false;
+
+   entry->location = location;
+   memset(entry->value, 0, sizeof(entry->value));
+   memcpy(entry->value, value, size);
+   return true;
+}
+
+static void gl_glsl_uniform1i(glsl_shader_data_t *glsl,
+      GLint location, GLint value)
+{
+   if (gl_glsl_uniform_changed(glsl, location, &value, sizeof(value)))
+      glUniform1i(location, value);
+}
+
+static void gl_glsl_uniform1f(glsl_shader_data_t *glsl,
+      GLint location, GLfloat value)
+{
+   if (gl_glsl_uniform_changed(glsl, location, &value, sizeof(value)))
+      glUniform1f(location, value);
+}
+
+static void gl_glsl_uniform2fv(glsl_shader_data_t *glsl,
+      GLint location, const GLfloat *value)
+{
+   if (gl_glsl_uniform_changed(glsl, location, value, 2 * sizeof(GLfloat)))
+      glUniform2fv(location, 1, value);
+}
+
+/**
+ * gl_glsl_bind_texture:
+ * @glsl                    : GLSL shader handle.
+ * @tex                     : Texture to bind.
+ * @claimed                 : Units already used by the current pass.
+ * @texunit                 : Next unit to bind to, advanced as used.
+ *
+ * Finds a texture unit for @tex. A texture which is still bound
+ * from an earlier pass keeps its unit, so history and pass 
+ * textures are bound once per frame rather than once per pass.
+ *
+ * Returns: texture unit @tex is bound to.
+ **/
+static unsigned gl_glsl_bind_texture(glsl_shader_data_t *glsl,
+      GLuint tex, uint64_t *claimed, unsigned *texunit)
+{
+   unsigned unit;
+   struct glsl_state_shadow *shadow = &glsl->shadow;
+
+   for (unit = 1; unit < GLSL_MAX_TEXUNITS; unit++)
+   {
+      if (shadow->textures[unit] == tex)
+      {
+         *claimed |= UINT64_C(1) << unit;
+         return unit;
+      }
+   }
+
+   while (*texunit < GLSL_MAX_TEXUNITS && (*claimed & (UINT64_C(1) << *texunit)))
+      (*texunit)++;
+   unit = (*texunit)++;
+
+   if (shadow->active_texunit != unit)
+   {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      shadow->active_texunit = unit;
+   }
+   glBindTexture(GL_TEXTURE_2D, tex);
+
+   if (unit < GLSL_MAX_TEXUNITS)
+   {
+      shadow->textures[unit] = tex;
+      *claimed |= UINT64_C(1) << unit;
+   }
+   return unit;
+}
+
 static void gl_glsl_deinit_shader(glsl_shader_data_t *glsl)
 {
    unsigned i;
@@ -653,6 +1350,9 @@ static void gl_glsl_destroy_resources(glsl_shader_data_t *glsl)
       return;
 
    glUseProgram(0);
+   for (i = 0; i < GFX_MAX_SHADERS; i++)
+      compile_program_abort(&glsl->builds[i]);
+
    for (i = 0; i < GFX_MAX_SHADERS; i++)
    {
       if (glsl->gl_program[i] == 0 || (i && glsl->gl_program[i] == glsl->gl_program[0]))
@@ -686,6 +1386,20 @@ static void gl_glsl_destroy_resources(glsl_shader_data_t *glsl)
       free(glsl->glsl_vbo[i].buffer_primary);
       free(glsl->glsl_vbo[i].buffer_secondary);
    }
+
+   if (glsl->vbo_stream)
+      glDeleteBuffers(1, &glsl->vbo_stream);
+   glsl->vbo_stream          = 0;
+   glsl->vbo_stream_size     = 0;
+   glsl->vbo_stream_offset   = 0;
+   free(glsl->coords_buffer);
+   glsl->coords_buffer       = NULL;
+   glsl->coords_buffer_elems = 0;
+
+   if (glsl->frame_block_ubo)
+      glDeleteBuffers(1, &glsl->frame_block_ubo);
+   glsl->frame_block_ubo = 0;
+   glsl->frame_block     = false;
    memset(&glsl->glsl_vbo, 0, sizeof(glsl->glsl_vbo));
 }
 
@@ -703,7 +1417,18 @@ static void gl_glsl_deinit(void)
    driver.video_shader_data = NULL;
 }
 
-static bool gl_glsl_init(void *data, const char *path)
+/**
+ * gl_glsl_init_begin:
+ * @path                    : Path to shader or preset, NULL for stock.
+ *
+ * Parses the shader, compiles the stock program and issues
+ * compiling and linking of every pass, without waiting on 
+ * the driver for the passes.
+ *
+ * Returns: GLSL shader handle to complete with gl_glsl_init_end(),
+ * or NULL on error.
+ **/
+static glsl_shader_data_t *gl_glsl_init_begin(const char *path)
 {
    unsigned i;
    config_file_t *conf        = NULL;
@@ -711,12 +1436,10 @@ static bool gl_glsl_init(void *data, const char *path)
    const char *stock_vertex   = NULL;
    const char *stock_fragment = NULL;
 
-   (void)data;
-
    glsl = (glsl_shader_data_t*)calloc(1, sizeof(glsl_shader_data_t));
 
    if (!glsl)
-      return false;
+      return NULL;
 
 #ifndef HAVE_OPENGLES2
    RARCH_LOG("Checking GLSL shader support ...\n");
@@ -737,7 +1460,7 @@ static bool gl_glsl_init(void *data, const char *path)
    {
       RARCH_ERR("GLSL shaders aren't supported by your OpenGL driver.\n");
       free(glsl);
-      return false;
+      return NULL;
    }
 #endif
 
@@ -745,7 +1468,7 @@ static bool gl_glsl_init(void *data, const char *path)
    if (!glsl->glsl_shader)
    {
       free(glsl);
-      return false;
+      return NULL;
    }
 
    if (path)
@@ -778,7 +1501,7 @@ static bool gl_glsl_init(void *data, const char *path)
          RARCH_ERR("[GL]: Failed to parse GLSL shader.\n");
          free(glsl->glsl_shader);
          free(glsl);
-         return false;
+         return NULL;
       }
    }
    else
@@ -840,21 +1563,55 @@ static bool gl_glsl_init(void *data, const char *path)
       }
    }
 
+#ifdef HAVE_GLSL_FRAME_BLOCK
+   gl_glsl_init_frame_define(glsl);
+#endif
+
+   glsl_cache_init();
+
    if (!(glsl->gl_program[0] = compile_program(glsl, stock_vertex, stock_fragment, 0)))
    {
       RARCH_ERR("GLSL stock programs failed to compile.\n");
       goto error;
    }
 
-   if (!compile_programs(glsl, &glsl->gl_program[1]))
+   if (!compile_programs_begin(glsl))
       goto error;
 
+   /* Decoded while the passes compile. */
    if (!gl_load_luts(glsl->glsl_shader, glsl->gl_teximage))
    {
       RARCH_ERR("[GL]: Failed to load LUTs.\n");
       goto error;
    }
 
+   return glsl;
+
+error:
+   gl_glsl_destroy_resources(glsl);
+
+   if (glsl)
+      free(glsl);
+
+   return NULL;
+}
+
+/**
+ * gl_glsl_init_end:
+ * @glsl                    : GLSL shader handle from gl_glsl_init_begin().
+ *
+ * Waits for the passes to link and sets up everything 
+ * that depends on the linked programs. Frees @glsl on error.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool gl_glsl_init_end(glsl_shader_data_t *glsl)
+{
+   unsigned i;
+
+   if (!compile_programs_end(glsl, &glsl->gl_program[1]))
+      goto error;
+
    for (i = 0; i <= glsl->glsl_shader->passes; i++)
       find_uniforms(glsl, i, glsl->gl_program[i], &glsl->gl_uniforms[i]);
 
@@ -904,14 +1661,17 @@ static bool gl_glsl_init(void *data, const char *path)
    }
 
    gl_glsl_reset_attrib(glsl);
+   gl_glsl_init_uniform_cache(glsl);
+#ifdef HAVE_GLSL_FRAME_BLOCK
+   gl_glsl_init_frame_block(glsl);
+#endif
 
    for (i = 0; i < GFX_MAX_SHADERS; i++)
    {
       glGenBuffers(1, &glsl->glsl_vbo[i].vbo_primary);
       glGenBuffers(1, &glsl->glsl_vbo[i].vbo_secondary);
    }
-
-   driver.video_shader_data = glsl;
+   glGenBuffers(1, &glsl->vbo_stream);
 
    return true;
 
@@ -924,6 +1684,58 @@ error:
    return false;
 }
 
+static bool gl_glsl_init(void *data, const char *path)
+{
+   glsl_shader_data_t *glsl = gl_glsl_init_begin(path);
+
+   (void)data;
+
+   if (!glsl || !gl_glsl_init_end(glsl))
+      return false;
+
+   driver.video_shader_data = glsl;
+   return true;
+}
+
+void *gl_glsl_init_async(const char *path, bool poll)
+{
+   glsl_shader_data_t *glsl = gl_glsl_init_begin(path);
+
+   if (glsl)
+      glsl->poll_builds = poll;
+   return glsl;
+}
+
+bool gl_glsl_async_ready(void *data)
+{
+   glsl_shader_data_t *glsl = (glsl_shader_data_t*)data;
+
+   if (!glsl->poll_builds)
+      return true;
+   return compile_programs_ready(glsl);
+}
+
+bool gl_glsl_async_finish(void *data)
+{
+   return gl_glsl_init_end((glsl_shader_data_t*)data);
+}
+
+void gl_glsl_async_install(void *data)
+{
+   driver.video_shader_data = data;
+}
+
+void gl_glsl_async_free(void *data)
+{
+   glsl_shader_data_t *glsl = (glsl_shader_data_t*)data;
+
+   if (!glsl)
+      return;
+
+   gl_glsl_destroy_resources(glsl);
+   free(glsl);
+}
+
 static void gl_glsl_set_params(void *data, unsigned width, unsigned height, 
       unsigned tex_width, unsigned tex_height, 
       unsigned out_width, unsigned out_height,
@@ -935,7 +1747,11 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
    GLfloat buffer[512];
    struct glsl_attrib attribs[32];
    float input_size[2], output_size[2], texture_size[2];
-   unsigned i, texunit = 1;
+   static struct state_tracker_uniform state_info[GFX_MAX_VARIABLES];
+   static unsigned state_cnt = 0;
+   unsigned i, unit, texunit = 1;
+   uint64_t texunits_claimed = 0;
+   unsigned frame_count_total = frame_count;
    const struct shader_uniforms *uni = NULL;
    size_t size = 0, attribs_size = 0;
    const struct gl_tex_info *info = (const struct gl_tex_info*)_info;
@@ -950,6 +1766,7 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
    uni = (const struct shader_uniforms*)&glsl->gl_uniforms[glsl->glsl_active_index];
 
    (void)data;
+   (void)frame_count_total;
 
    if (glsl->gl_program[glsl->glsl_active_index] == 0)
       return;
@@ -961,14 +1778,9 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
    texture_size[0] = (float)tex_width;
    texture_size[1] = (float)tex_height;
 
-   if (uni->input_size >= 0)
-      glUniform2fv(uni->input_size, 1, input_size);
-
-   if (uni->output_size >= 0)
-      glUniform2fv(uni->output_size, 1, output_size);
-
-   if (uni->texture_size >= 0)
-      glUniform2fv(uni->texture_size, 1, texture_size);
+   gl_glsl_uniform2fv(glsl, uni->input_size, input_size);
+   gl_glsl_uniform2fv(glsl, uni->output_size, output_size);
+   gl_glsl_uniform2fv(glsl, uni->texture_size, texture_size);
 
    if (uni->frame_count >= 0 && glsl->glsl_active_index)
    {
@@ -976,23 +1788,21 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
 
       if (modulo)
          frame_count %= modulo;
-      glUniform1i(uni->frame_count, frame_count);
+      gl_glsl_uniform1i(glsl, uni->frame_count, frame_count);
    }
 
-   if (uni->frame_direction >= 0)
-      glUniform1i(uni->frame_direction, g_extern.frame_is_reverse ? -1 : 1);
-
+   gl_glsl_uniform1i(glsl, uni->frame_direction,
+         g_extern.frame_is_reverse ? -1 : 1);
 
    for (i = 0; i < glsl->glsl_shader->luts; i++)
    {
       if (uni->lut_texture[i] < 0)
          continue;
 
-      /* Have to rebind as HW render could override this. */
-      glActiveTexture(GL_TEXTURE0 + texunit);
-      glBindTexture(GL_TEXTURE_2D, glsl->gl_teximage[i]);
-      glUniform1i(uni->lut_texture[i], texunit);
-      texunit++;
+      /* Bound once per frame, as HW render could override this. */
+      unit = gl_glsl_bind_texture(glsl, glsl->gl_teximage[i],
+            &texunits_claimed, &texunit);
+      gl_glsl_uniform1i(glsl, uni->lut_texture[i], unit);
    }
 
    /* Set original texture. */
@@ -1001,17 +1811,13 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
       if (uni->orig.texture >= 0)
       {
          /* Bind original texture. */
-         glActiveTexture(GL_TEXTURE0 + texunit);
-         glUniform1i(uni->orig.texture, texunit);
-         glBindTexture(GL_TEXTURE_2D, info->tex);
-         texunit++;
+         unit = gl_glsl_bind_texture(glsl, info->tex,
+               &texunits_claimed, &texunit);
+         gl_glsl_uniform1i(glsl, uni->orig.texture, unit);
       }
 
-      if (uni->orig.texture_size >= 0)
-         glUniform2fv(uni->orig.texture_size, 1, info->tex_size);
-
-      if (uni->orig.input_size >= 0)
-         glUniform2fv(uni->orig.input_size, 1, info->input_size);
+      gl_glsl_uniform2fv(glsl, uni->orig.texture_size, info->tex_size);
+      gl_glsl_uniform2fv(glsl, uni->orig.input_size, info->input_size);
 
       /* Pass texture coordinates. */
       if (uni->orig.tex_coord >= 0)
@@ -1029,19 +1835,17 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
       /* Bind FBO textures. */
       for (i = 0; i < fbo_info_cnt; i++)
       {
-         if (uni->pass[i].texture)
+         if (uni->pass[i].texture >= 0)
          {
-            glActiveTexture(GL_TEXTURE0 + texunit);
-            glBindTexture(GL_TEXTURE_2D, fbo_info[i].tex);
-            glUniform1i(uni->pass[i].texture, texunit);
-            texunit++;
+            unit = gl_glsl_bind_texture(glsl, fbo_info[i].tex,
+                  &texunits_claimed, &texunit);
+            gl_glsl_uniform1i(glsl, uni->pass[i].texture, unit);
          }
 
-         if (uni->pass[i].texture_size >= 0)
-            glUniform2fv(uni->pass[i].texture_size, 1, fbo_info[i].tex_size);
-
-         if (uni->pass[i].input_size >= 0)
-            glUniform2fv(uni->pass[i].input_size, 1, fbo_info[i].input_size);
+         gl_glsl_uniform2fv(glsl, uni->pass[i].texture_size,
+               fbo_info[i].tex_size);
+         gl_glsl_uniform2fv(glsl, uni->pass[i].input_size,
+               fbo_info[i].input_size);
 
          if (uni->pass[i].tex_coord >= 0)
          {
@@ -1062,17 +1866,15 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
    {
       if (uni->prev[i].texture >= 0)
       {
-         glActiveTexture(GL_TEXTURE0 + texunit);
-         glBindTexture(GL_TEXTURE_2D, prev_info[i].tex);
-         glUniform1i(uni->prev[i].texture, texunit);
-         texunit++;
+         unit = gl_glsl_bind_texture(glsl, prev_info[i].tex,
+               &texunits_claimed, &texunit);
+         gl_glsl_uniform1i(glsl, uni->prev[i].texture, unit);
       }
 
-      if (uni->prev[i].texture_size >= 0)
-         glUniform2fv(uni->prev[i].texture_size, 1, prev_info[i].tex_size);
-
-      if (uni->prev[i].input_size >= 0)
-         glUniform2fv(uni->prev[i].input_size, 1, prev_info[i].input_size);
+      gl_glsl_uniform2fv(glsl, uni->prev[i].texture_size,
+            prev_info[i].tex_size);
+      gl_glsl_uniform2fv(glsl, uni->prev[i].input_size,
+            prev_info[i].input_size);
 
       /* Pass texture coordinates. */
       if (uni->prev[i].tex_coord >= 0)
@@ -1096,35 +1898,34 @@ static void gl_glsl_set_params(void *data, unsigned width, unsigned height,
             buffer, size, attribs, attribs_size);
    }
 
-   glActiveTexture(GL_TEXTURE0);
+   if (glsl->shadow.active_texunit != 0)
+   {
+      glActiveTexture(GL_TEXTURE0);
+      glsl->shadow.active_texunit = 0;
+   }
 
    /* #pragma parameters. */
    for (i = 0; i < glsl->glsl_shader->num_parameters; i++)
-   {
-      int location = glGetUniformLocation(
-            glsl->gl_program[glsl->glsl_active_index],
-            glsl->glsl_shader->parameters[i].id);
-      glUniform1f(location, glsl->glsl_shader->parameters[i].current);
-   }
+      gl_glsl_uniform1f(glsl, uni->parameters[i],
+            glsl->glsl_shader->parameters[i].current);
 
    /* Set state parameters. */
    if (glsl->gl_state_tracker)
    {
-      static struct state_tracker_uniform state_info[GFX_MAX_VARIABLES];
-      static unsigned cnt = 0;
-
       if (glsl->glsl_active_index == 1)
-         cnt = state_tracker_get_uniform(glsl->gl_state_tracker, state_info,
-               GFX_MAX_VARIABLES, frame_count);
+         state_cnt = state_tracker_get_uniform(glsl->gl_state_tracker,
+               state_info, GFX_MAX_VARIABLES, frame_count);
 
-      for (i = 0; i < cnt; i++)
-      {
-         int location = glGetUniformLocation(
-               glsl->gl_program[glsl->glsl_active_index],
-               state_info[i].id);
-         glUniform1f(location, state_info[i].value);
-      }
+      for (i = 0; i < state_cnt; i++)
+         gl_glsl_uniform1f(glsl, uni->state[i], state_info[i].value);
    }
+
+#ifdef HAVE_GLSL_FRAME_BLOCK
+   /* The first pass runs once per frame. */
+   if (glsl->frame_block && glsl->glsl_active_index == 1)
+      gl_glsl_update_frame_block(glsl, info, prev_info, frame_count_total,
+            state_info, glsl->gl_state_tracker ? state_cnt : 0);
+#endif
 }
 
 static bool gl_glsl_set_mvp(void *data, const math_matrix_4x4 *mat)
@@ -1171,15 +1972,27 @@ static bool gl_glsl_set_coords(const void *data)
 
    buffer = short_buffer;
    if (coords->vertices > 4)
-      buffer = (GLfloat*)calloc(coords->vertices * 
-            (2 + 2 + 4 + 2), sizeof(*buffer));
-
-   if (!buffer)
    {
+      size_t elems = coords->vertices * (2 + 2 + 4 + 2);
+
+      if (elems > glsl->coords_buffer_elems)
+      {
+         GLfloat *new_buffer = (GLfloat*)realloc(glsl->coords_buffer,
+               elems * sizeof(*new_buffer));
+
+         if (!new_buffer)
+         {
 #ifndef NO_GL_FF_VERTEX
-      gl_ff_vertex(coords);
+            gl_ff_vertex(coords);
 #endif
-      return false;
+            return false;
+         }
+
+         glsl->coords_buffer       = new_buffer;
+         glsl->coords_buffer_elems = elems;
+      }
+
+      buffer = glsl->coords_buffer;
    }
 
    attr = attribs;
@@ -1237,7 +2050,11 @@ static bool gl_glsl_set_coords(const void *data)
       size += 2 * coords->vertices;
    }
 
-   if (size)
+   /* Quads stay in the per-pass VBO, which only changes 
+    * when the pass geometry does. */
+   if (size && coords->vertices > 4)
+      gl_glsl_stream_attribs(glsl, buffer, size, attribs, attribs_size);
+   else if (size)
    {
       gl_glsl_set_attribs(glsl,
             glsl->glsl_vbo[glsl->glsl_active_index].vbo_primary,
@@ -1247,9 +2064,6 @@ static bool gl_glsl_set_coords(const void *data)
             attribs, attribs_size);
    }
 
-   if (buffer != short_buffer)
-      free(buffer);
-
    return true;
 }
 
@@ -1264,8 +2078,26 @@ static void gl_glsl_use(void *data, unsigned idx)
 
    gl_glsl_reset_attrib(glsl);
 
+   /* The first use of a frame follows the core, 
+    * which may have changed any GL state. */
+   if (!glsl->shadow.valid || glsl->shadow.frame_count != g_extern.frame_count)
+   {
+      unsigned i;
+
+      glsl->shadow.valid          = true;
+      glsl->shadow.frame_count    = g_extern.frame_count;
+      glsl->shadow.program        = 0;
+      glsl->shadow.active_texunit = GLSL_MAX_TEXUNITS;
+      for (i = 0; i < GLSL_MAX_TEXUNITS; i++)
+         glsl->shadow.textures[i] = GLSL_TEXTURE_UNKNOWN;
+
+      glUseProgram(glsl->gl_program[idx]);
+   }
+   else if (glsl->shadow.program != glsl->gl_program[idx])
+      glUseProgram(glsl->gl_program[idx]);
+
    glsl->glsl_active_index = idx;
-   glUseProgram(glsl->gl_program[idx]);
+   glsl->shadow.program    = glsl->gl_program[idx];
 }
 
 static unsigned gl_glsl_num(void)
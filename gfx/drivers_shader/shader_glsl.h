@@ -24,4 +24,28 @@ void gl_glsl_set_get_proc_address(gfx_ctx_proc_t (*proc)(const char*));
 
 void gl_glsl_set_context_type(bool core_profile, unsigned major, unsigned minor);
 
+/**
+ * gl_glsl_init_async:
+ * @path                    : Path to shader or preset, NULL for stock.
+ * @poll                    : Driver compiles in the background and
+ *                            supports polling for completion.
+ *
+ * Starts building a shader chain next to the active one.
+ * Keep rendering with the active chain until gl_glsl_async_ready()
+ * returns true, then complete it with gl_glsl_async_finish(),
+ * deinit the active chain and swap with gl_glsl_async_install().
+ *
+ * Returns: handle of the new chain, or NULL if it cannot be parsed.
+ **/
+void *gl_glsl_init_async(const char *path, bool poll);
+
+bool gl_glsl_async_ready(void *data);
+
+/* Frees @data on failure. */
+bool gl_glsl_async_finish(void *data);
+
+void gl_glsl_async_install(void *data);
+
+void gl_glsl_async_free(void *data);
+
 #endif
@@ -31,6 +31,11 @@ typedef struct gl_font_renderer
    const char *ident;
 
    const struct font_glyph *(*get_glyph)(void *data, uint32_t code);
+
+   /* Optional. Messages rendered after begin_batch are only
+    * queued, flush draws them all with one call. */
+   void (*begin_batch)(void *data);
+   void (*flush)(void *data);
 } gl_font_renderer_t;
 
 extern gl_font_renderer_t gl_raster_font;
@@ -16,11 +16,101 @@
 
 #include "font_renderer_driver.h"
 #include "../general.h"
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
 #endif
 
+#define FONT_GLYPH_CACHE_COLS 16
+
+enum
+{
+   FONT_GLYPH_UNKNOWN = 0,
+   FONT_GLYPH_CACHED,
+   FONT_GLYPH_MISSING
+};
+
+bool font_glyph_cache_init(struct font_glyph_cache *cache,
+      unsigned count, unsigned cell_width, unsigned cell_height,
+      font_glyph_render_t render, void *data)
+{
+   unsigned rows = (count + FONT_GLYPH_CACHE_COLS - 1)
+      / FONT_GLYPH_CACHE_COLS;
+
+   memset(cache, 0, sizeof(*cache));
+
+   cache->count         = count;
+   cache->cell_width    = cell_width ? cell_width : 1;
+   cache->cell_height   = cell_height ? cell_height : 1;
+   cache->render        = render;
+   cache->render_data   = data;
+
+   cache->atlas.width   = cache->cell_width * FONT_GLYPH_CACHE_COLS;
+   cache->atlas.height  = cache->cell_height * rows;
+   cache->atlas.buffer  = (uint8_t*)
+      calloc(cache->atlas.width * cache->atlas.height, 1);
+   cache->glyphs        = (struct font_glyph*)
+      calloc(count, sizeof(*cache->glyphs));
+   cache->state         = (uint8_t*)calloc(count, 1);
+
+   if (!cache->atlas.buffer || !cache->glyphs || !cache->state)
+   {
+      font_glyph_cache_free(cache);
+      return false;
+   }
+
+   return true;
+}
+
+const struct font_glyph *font_glyph_cache_get(
+      struct font_glyph_cache *cache, uint32_t code)
+{
+   struct font_glyph *glyph = NULL;
+   unsigned x, y;
+
+   if (code >= cache->count)
+      return NULL;
+
+   glyph = &cache->glyphs[code];
+
+   switch (cache->state[code])
+   {
+      case FONT_GLYPH_CACHED:
+         return glyph;
+      case FONT_GLYPH_MISSING:
+         return NULL;
+      default:
+         break;
+   }
+
+   x = (code % FONT_GLYPH_CACHE_COLS) * cache->cell_width;
+   y = (code / FONT_GLYPH_CACHE_COLS) * cache->cell_height;
+
+   if (!cache->render(cache->render_data, code, glyph,
+            cache->atlas.buffer + x + y * cache->atlas.width,
+            cache->atlas.width, cache->cell_width, cache->cell_height))
+   {
+      cache->state[code] = FONT_GLYPH_MISSING;
+      return NULL;
+   }
+
+   glyph->atlas_offset_x = x;
+   glyph->atlas_offset_y = y;
+   cache->state[code]    = FONT_GLYPH_CACHED;
+   cache->atlas.generation++;
+   return glyph;
+}
+
+void font_glyph_cache_free(struct font_glyph_cache *cache)
+{
+   free(cache->atlas.buffer);
+   free(cache->glyphs);
+   free(cache->state);
+   memset(cache, 0, sizeof(*cache));
+}
+
 static const font_renderer_driver_t *font_backends[] = {
 #ifdef HAVE_FREETYPE
    &freetype_font_renderer,
@@ -53,6 +53,34 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+
+   /* Bumped when glyphs are added to the buffer. Drivers which
+    * keep a copy of it upload it again when it changed. */
+   unsigned generation;
+};
+
+/* Rasterizes @code at @dst, rows @pitch bytes apart, clipped
+ * to @max_width x @max_height. Fills in @glyph except for its
+ * atlas offsets. Returns false if the font has no such glyph. */
+typedef bool (*font_glyph_render_t)(void *data, uint32_t code,
+      struct font_glyph *glyph, uint8_t *dst, unsigned pitch,
+      unsigned max_width, unsigned max_height);
+
+/* Atlas of fixed cells, one per code, which the renderers share.
+ * Glyphs are only rasterized when first asked for, and then
+ * kept for as long as the renderer. */
+struct font_glyph_cache
+{
+   struct font_atlas atlas;
+   struct font_glyph *glyphs;
+   /* FONT_GLYPH_* of each code. */
+   uint8_t *state;
+   unsigned count;
+   unsigned cell_width;
+   unsigned cell_height;
+
+   font_glyph_render_t render;
+   void *render_data;
 };
 
 typedef struct font_renderer_driver
@@ -75,6 +103,37 @@ extern font_renderer_driver_t freetype_font_renderer;
 extern font_renderer_driver_t coretext_font_renderer;
 extern font_renderer_driver_t bitmap_font_renderer;
 
+/**
+ * font_glyph_cache_init:
+ * @cache                   : glyph cache.
+ * @count                   : number of codes, starting at 0.
+ * @cell_width              : width of the biggest glyph.
+ * @cell_height             : height of the biggest glyph.
+ * @render                  : rasterizes a glyph.
+ * @data                    : passed to @render.
+ *
+ * Sets up an empty atlas with room for @count glyphs.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool font_glyph_cache_init(struct font_glyph_cache *cache,
+      unsigned count, unsigned cell_width, unsigned cell_height,
+      font_glyph_render_t render, void *data);
+
+/**
+ * font_glyph_cache_get:
+ * @cache                   : glyph cache.
+ * @code                    : character code.
+ *
+ * Rasterizes the glyph of @code on first use.
+ *
+ * Returns: glyph, or NULL if the font has none for @code.
+ **/
+const struct font_glyph *font_glyph_cache_get(
+      struct font_glyph_cache *cache, uint32_t code);
+
+void font_glyph_cache_free(struct font_glyph_cache *cache);
+
 /* font_path can be NULL for default font. */
 bool font_renderer_create_default(const font_renderer_driver_t **driver,
       void **handle, const char *font_path, unsigned font_size);
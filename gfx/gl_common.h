@@ -44,6 +44,28 @@
 #define HAVE_GL_ASYNC_READBACK
 #endif
 
+/* Recorder reads async readback PBOs while they are mapped. 
+ * Needs XRGB8888 readbacks, which GLES does not do. */
+#if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_MENU) \
+   && defined(HAVE_THREADS) && !defined(HAVE_OPENGLES)
+#define HAVE_GL_MAPPED_READBACK
+#include <rthreads/rthreads.h>
+#endif
+
+/* Every readback PBO, and how many frames ago 
+ * the one read back was written. */
+#ifdef HAVE_GL_MAPPED_READBACK
+#define GL_PBO_READBACK_MAX 8
+#else
+#define GL_PBO_READBACK_MAX 4
+#endif
+#define GL_PBO_READBACK_DEPTH 4
+
+#if defined(HAVE_GLSL) && defined(HAVE_FBO) && !defined(HAVE_PSGL) \
+   && !defined(HAVE_OPENGLES1)
+#define HAVE_GL_UNPACK
+#endif
+
 #if defined(HAVE_PSGL)
 #define RARCH_GL_FRAMEBUFFER GL_FRAMEBUFFER_OES
 #define RARCH_GL_FRAMEBUFFER_COMPLETE GL_FRAMEBUFFER_COMPLETE_OES
@@ -151,6 +173,38 @@
 #define RARCH_GL_FORMAT16_565 GL_UNSIGNED_SHORT_5_6_5
 #endif
 
+/* Packed FBO formats, core in GLES3 and desktop GL. */
+#ifndef GL_RGB10_A2
+#define GL_RGB10_A2 0x8059
+#endif
+#ifndef GL_UNSIGNED_INT_2_10_10_10_REV
+#define GL_UNSIGNED_INT_2_10_10_10_REV 0x8368
+#endif
+
+/* Attachments of the default frame buffer, for glInvalidateFramebuffer.
+ * Same values as EXT_discard_framebuffer's. */
+#ifndef GL_DEPTH
+#define GL_DEPTH 0x1801
+#endif
+#ifndef GL_STENCIL
+#define GL_STENCIL 0x1802
+#endif
+
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+
+typedef void (APIENTRY *gl_blit_framebuffer_t)(GLint src_x0, GLint src_y0,
+      GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0,
+      GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter);
+
+/* glInvalidateFramebuffer and glDiscardFramebufferEXT alike. */
+typedef void (APIENTRY *gl_invalidate_framebuffer_t)(GLenum target,
+      GLsizei num_attachments, const GLenum *attachments);
+
 /* Platform specific workarounds/hacks. */
 #if defined(__CELLOS_LV2__)
 #define NO_GL_READ_PIXELS
@@ -253,6 +307,30 @@ struct gl_coords
    unsigned vertices;
 };
 
+#ifdef HAVE_GL_SYNC
+#define GL_GPU_TIME_QUERIES 4
+/* Start of frame, end of each shader pass, 
+ * end of the menu texture and end of frame. */
+#define GL_GPU_TIME_MARKS (MAX_SHADERS + 4)
+
+struct gl_gpu_time_frame
+{
+   GLuint queries[GL_GPU_TIME_MARKS];
+   unsigned marks;
+   unsigned passes;
+   bool menu;
+};
+#endif
+
+#ifdef HAVE_GL_MAPPED_READBACK
+struct gl_pbo_mapping
+{
+   struct gl *gl;
+   bool mapped;
+   volatile bool released;
+};
+#endif
+
 typedef struct gl
 {
    const gfx_ctx_driver_t *ctx_driver;
@@ -263,7 +341,12 @@ typedef struct gl
    unsigned tex_index; /* For use with PREV. */
    unsigned textures;
    struct gl_tex_info tex_info;
-   struct gl_tex_info prev_info[MAX_TEXTURES];
+   /* History, newest first. prev_info points into a ring which
+    * stores every entry twice, so the window stays contiguous
+    * and a new frame costs two copies instead of a shift. */
+   struct gl_tex_info *prev_info;
+   struct gl_tex_info prev_info_ring[2 * MAX_TEXTURES];
+   unsigned prev_info_index;
    GLuint tex_mag_filter;
    GLuint tex_min_filter;
    bool tex_mipmap;
@@ -284,6 +367,9 @@ typedef struct gl
    int fbo_pass;
    bool fbo_inited;
 
+   /* Textures, FBOs and buffers accounted to RARCH_MEM_VIDEO. */
+   size_t mem_size;
+
    GLuint hw_render_fbo[MAX_TEXTURES];
    GLuint hw_render_depth[MAX_TEXTURES];
    bool hw_render_fbo_init;
@@ -291,6 +377,14 @@ typedef struct gl
    bool has_fp_fbo;
    bool has_srgb_fbo;
    bool has_srgb_fbo_gles3;
+   bool has_rgb10_a2_fbo;
+
+   /* Without a shader chain to run, integer scaled frames are
+    * blitted to the back buffer, see gl_frame_blit(). NULL if
+    * the GL cannot blit. */
+   gl_blit_framebuffer_t blit_framebuffer;
+   GLuint blit_fbo;
+   bool blit_fbo_checked;
 #endif
    bool hw_render_use;
    bool shared_context_use;
@@ -306,6 +400,21 @@ typedef struct gl
    unsigned win_width;
    unsigned win_height;
    struct rarch_viewport vp;
+   /* What gl_set_viewport() last computed vp and mvp from. */
+   struct
+   {
+      bool valid;
+      bool force_full;
+      bool allow_rotate;
+      bool scale_integer;
+      bool keep_aspect;
+      unsigned width;
+      unsigned height;
+      unsigned win_height;
+      unsigned aspect_ratio_idx;
+      float aspect_ratio;
+      struct rarch_viewport custom;
+   } vp_key;
    unsigned vp_out_width;
    unsigned vp_out_height;
    unsigned last_width[MAX_TEXTURES];
@@ -330,6 +439,16 @@ typedef struct gl
    bool have_es2_compat;
 #endif
 
+   /* NULL if the GL can do neither. Tells tiled GPUs which
+    * contents need not be written back to memory. */
+   gl_invalidate_framebuffer_t invalidate_framebuffer;
+
+#ifdef HAVE_GLSL
+   /* Shader chain being built while the current one renders. */
+   void *shader_pending;
+   bool have_parallel_compile;
+#endif
+
    /* Fonts */
    const gl_font_renderer_t *font_driver;
    void *font_handle;
@@ -337,11 +456,30 @@ typedef struct gl
    bool egl_images;
    video_info_t video_info;
 
+#ifdef HAVE_GL_UNPACK
+   /* Frames are uploaded as they are to unpack_texture, 
+    * then converted into texture[] by unpack_program. */
+   bool unpack_enable;
+   GLenum unpack_fmt;
+   GLuint unpack_texture;
+   GLuint unpack_program;
+   GLint unpack_scale;
+   GLuint unpack_vbo;
+   GLuint unpack_fbo[MAX_TEXTURES];
+#endif
+
 #ifdef HAVE_OVERLAY
    unsigned overlays;
    bool overlay_enable;
    bool overlay_full_screen;
+   /* With an atlas, all images share overlay_tex[0] and 
+    * the whole overlay is drawn in one call. */
+   bool overlay_atlas;
+   unsigned overlay_textures;
    GLuint *overlay_tex;
+   /* Where each image lives in its texture, as x, y, w, h. */
+   GLfloat *overlay_atlas_rect;
+   /* Two triangles per image. */
    GLfloat *overlay_vertex_coord;
    GLfloat *overlay_tex_coord;
    GLfloat *overlay_color_coord;
@@ -349,11 +487,19 @@ typedef struct gl
 
 #ifdef HAVE_GL_ASYNC_READBACK
    /* PBOs used for asynchronous viewport readbacks. */
-   GLuint pbo_readback[4];
-   bool pbo_readback_valid[4];
+   GLuint pbo_readback[GL_PBO_READBACK_MAX];
+   bool pbo_readback_valid[GL_PBO_READBACK_MAX];
    bool pbo_readback_enable;
    unsigned pbo_readback_index;
+   unsigned pbo_readback_count;
    struct scaler_ctx pbo_readback_scaler;
+#ifdef HAVE_GL_MAPPED_READBACK
+   /* PBOs mapped out through read_viewport_mapped(), which
+    * stay mapped until the recorder releases them. */
+   struct gl_pbo_mapping pbo_readback_mapping[GL_PBO_READBACK_MAX];
+   slock_t *pbo_readback_lock;
+   scond_t *pbo_readback_cond;
+#endif
 #endif
    void *readback_buffer_screenshot;
 
@@ -362,13 +508,70 @@ typedef struct gl
    bool menu_texture_enable;
    bool menu_texture_full_screen;
    GLfloat menu_texture_alpha;
+
+   /* Last frame run through the whole shader chain, which
+    * the menu over a paused core keeps pushing again. */
+   bool frame_reusable;
+   const void *reuse_frame;
+   unsigned reuse_width;
+   unsigned reuse_height;
+   unsigned reuse_pitch;
 #endif
 
+   /* The textures and FBOs hold what the shader chain made of
+    * the last frame, so a dupe can show it again. */
+   bool dupe_reusable;
+   /* The last frame shown was the one before it again. */
+   bool frame_repeated;
+
 #ifdef HAVE_GL_SYNC
 #define MAX_FENCES 4
    bool have_sync;
    GLsync fences[MAX_FENCES];
    unsigned fence_count;
+
+   /* With a shared context, set once the frontend has drawn
+    * from each hw_render_fbo, for the core to wait on before
+    * rendering into it again. */
+   GLsync hw_render_release[MAX_TEXTURES];
+
+   /* Ring of persistently mapped unpack buffer slots 
+    * used to stream frames into the texture. */
+#define GL_UPLOAD_RING_SIZE 3
+   bool upload_ring_enable;
+   GLuint upload_pbo;
+   uint8_t *upload_ptr;
+   size_t upload_slot_size;
+   unsigned upload_index;
+   GLsync upload_fences[GL_UPLOAD_RING_SIZE];
+
+   /* Fenced screenshot readback, collected by a later frame. */
+   bool screenshot_request;
+   video_viewport_read_cb_t screenshot_cb;
+   GLuint screenshot_pbo;
+   size_t screenshot_pbo_size;
+   GLsync screenshot_fence;
+   unsigned screenshot_width;
+   unsigned screenshot_height;
+
+   /* GPU timestamps of gl_frame(), read back from a few frames 
+    * in flight so the queries never stall. */
+   bool have_timer_query;
+   bool gpu_time_active;
+   struct gl_gpu_time_frame gpu_time_frames[GL_GPU_TIME_QUERIES];
+   unsigned gpu_time_index;
+   unsigned gpu_time_pending;
+
+   /* Last collected frame, in usec. */
+   retro_time_t gpu_time;
+   retro_time_t gpu_time_pass[MAX_SHADERS + 1];
+   unsigned gpu_time_passes;
+   retro_time_t gpu_time_menu;
+
+   /* Adaptive hard sync state, see gl_adaptive_sync_delay(). */
+   retro_time_t sync_end;
+   retro_time_t swap_time;
+   retro_time_t sync_work;
 #endif
 
    bool core_context;
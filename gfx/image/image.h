@@ -44,4 +44,9 @@ struct texture_image
 bool texture_image_load(struct texture_image *img, const char *path);
 void texture_image_free(struct texture_image *img);
 
+#ifndef _XBOX1
+bool texture_image_load_cached(struct texture_image *img, const char *path,
+      unsigned max_width, unsigned max_height, const char *cache_dir);
+#endif
+
 #endif
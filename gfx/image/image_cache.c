@@ -0,0 +1,238 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Keeps images scaled down to the size they are drawn at,
+ * as raw pixels ready for upload, so that they are only
+ * decoded and scaled the first time. */
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <file/file_path.h>
+#include <gfx/scaler/scaler.h>
+#include "image.h"
+#include "../../general.h"
+
+#define IMAGE_CACHE_MAGIC "RAIMG01"
+
+struct image_cache_header
+{
+   char magic[8];
+   uint32_t width;
+   uint32_t height;
+};
+
+/* Names the cache file from everything the pixels depend on,
+ * so an image which changed is never read back stale. */
+static bool image_cache_path(char *out, size_t size, const char *cache_dir,
+      const char *path, unsigned max_width, unsigned max_height)
+{
+   char key[PATH_MAX_LENGTH + 64], name[32];
+   const char *c;
+   struct stat st;
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   snprintf(key, sizeof(key), "%s\n%lld\n%lld\n%ux%u\n%d",
+         path, (long long)st.st_size, (long long)st.st_mtime,
+         max_width, max_height, driver.gfx_use_rgba);
+
+   for (c = key; *c; c++)
+      hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+
+   snprintf(name, sizeof(name), "%016llx.img", (unsigned long long)hash);
+   fill_pathname_join(out, cache_dir, name, size);
+   return true;
+}
+
+static bool image_cache_read(struct texture_image *img, const char *path,
+      unsigned max_width, unsigned max_height)
+{
+   size_t size;
+   struct image_cache_header header;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+      return false;
+
+   if (fread(&header, sizeof(header), 1, file) != 1
+         || memcmp(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic))
+         || !header.width || header.width > max_width
+         || !header.height || header.height > max_height)
+      goto error;
+
+   size        = (size_t)header.width * header.height * sizeof(uint32_t);
+   img->pixels = (uint32_t*)malloc(size);
+   if (!img->pixels || fread(img->pixels, 1, size, file) != size)
+      goto error;
+
+   img->width  = header.width;
+   img->height = header.height;
+   fclose(file);
+   return true;
+
+error:
+   free(img->pixels);
+   img->pixels = NULL;
+   fclose(file);
+   return false;
+}
+
+/* Written aside and renamed, so readers never see half a file. */
+static void image_cache_write(const struct texture_image *img,
+      const char *path)
+{
+   char tmp[PATH_MAX_LENGTH];
+   size_t size = (size_t)img->width * img->height * sizeof(uint32_t);
+   struct image_cache_header header = {IMAGE_CACHE_MAGIC};
+   FILE *file;
+
+   header.width  = img->width;
+   header.height = img->height;
+
+   if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+      return;
+
+   file = fopen(tmp, "wb");
+   if (!file)
+      return;
+
+   if (fwrite(&header, sizeof(header), 1, file) != 1
+         || fwrite(img->pixels, 1, size, file) != size)
+   {
+      fclose(file);
+      remove(tmp);
+      return;
+   }
+
+   fclose(file);
+   if (rename(tmp, path) != 0)
+      remove(tmp);
+}
+
+/* Scales @img down to fit @max_width x @max_height,
+ * keeping its aspect ratio. */
+static bool image_cache_scale(struct texture_image *img,
+      unsigned max_width, unsigned max_height)
+{
+   struct scaler_ctx scaler = {0};
+   uint32_t *pixels;
+   unsigned width  = img->width;
+   unsigned height = img->height;
+
+   if (width <= max_width && height <= max_height)
+      return true;
+
+   if ((uint64_t)width * max_height > (uint64_t)height * max_width)
+   {
+      height = max((uint64_t)height * max_width / width, 1);
+      width  = max_width;
+   }
+   else
+   {
+      width  = max((uint64_t)width * max_height / height, 1);
+      height = max_height;
+   }
+
+   pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+   if (!pixels)
+      return false;
+
+   scaler.in_width    = img->width;
+   scaler.in_height   = img->height;
+   scaler.in_stride   = img->width * sizeof(uint32_t);
+   scaler.in_fmt      = SCALER_FMT_ARGB8888;
+   scaler.out_width   = width;
+   scaler.out_height  = height;
+   scaler.out_stride  = width * sizeof(uint32_t);
+   scaler.out_fmt     = SCALER_FMT_ARGB8888;
+   scaler.scaler_type = SCALER_TYPE_LANCZOS3;
+
+   if (!scaler_ctx_gen_filter(&scaler))
+   {
+      scaler_ctx_gen_reset(&scaler);
+      free(pixels);
+      return false;
+   }
+
+   /* Channels are filtered alike, whichever order they are in. */
+   scaler_ctx_scale(&scaler, pixels, img->pixels);
+   scaler_ctx_gen_reset(&scaler);
+
+   free(img->pixels);
+   img->pixels = pixels;
+   img->width  = width;
+   img->height = height;
+   return true;
+}
+
+/**
+ * texture_image_load_cached:
+ * @img                     : image to load into.
+ * @path                    : path of the image.
+ * @max_width               : width it is drawn at, at most.
+ * @max_height              : height it is drawn at, at most.
+ * @cache_dir               : directory of the cache, or NULL.
+ *
+ * Loads @path like texture_image_load(), scaled down to fit
+ * @max_width x @max_height. The result is kept in @cache_dir,
+ * and later loads of the same image read it back instead of
+ * decoding and scaling it again. Safe to call from any thread.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool texture_image_load_cached(struct texture_image *img, const char *path,
+      unsigned max_width, unsigned max_height, const char *cache_dir)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   bool cached = false;
+
+#ifdef GEKKO
+   /* Pixels get tiled for GX, so they cannot be scaled. */
+   cache_dir = NULL;
+#endif
+
+   memset(img, 0, sizeof(*img));
+
+   if (cache_dir && *cache_dir && max_width && max_height)
+      cached = image_cache_path(cache_path, sizeof(cache_path),
+            cache_dir, path, max_width, max_height);
+
+   if (cached && image_cache_read(img, cache_path, max_width, max_height))
+      return true;
+
+   if (!texture_image_load(img, path))
+      return false;
+
+   if (!cached)
+      return true;
+
+   if (!image_cache_scale(img, max_width, max_height))
+   {
+      RARCH_WARN("Failed to scale down image: %s.\n", path);
+      return true;
+   }
+
+   image_cache_write(img, cache_path);
+   return true;
+}
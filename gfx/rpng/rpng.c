@@ -25,6 +25,10 @@
 #include <malloc.h>
 #endif
 
+#if defined(HAVE_ZLIB_DEFLATE) && defined(HAVE_THREADS)
+#include <rthreads/rthreadpool.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #include "../../hash.h"
 #else
@@ -107,12 +111,6 @@ struct
    { "PLTE", PNG_CHUNK_PLTE },
 };
 
-struct idat_buffer
-{
-   uint8_t *data;
-   size_t size;
-};
-
 static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
 {
    unsigned i;
@@ -250,8 +248,25 @@ static inline int paeth(int a, int b, int c)
    return c;
 }
 
+/* Channel positions of the pixels the decoder writes. */
+struct png_shift
+{
+   unsigned a;
+   unsigned r;
+   unsigned g;
+   unsigned b;
+};
+
+static inline uint32_t png_pixel(const struct png_shift *shift,
+      uint32_t a, uint32_t r, uint32_t g, uint32_t b)
+{
+   return (a << shift->a) | (r << shift->r) |
+      (g << shift->g) | (b << shift->b);
+}
+
 static inline void copy_line_rgb(uint32_t *data,
-      const uint8_t *decoded, unsigned width, unsigned bpp)
+      const uint8_t *decoded, unsigned width, unsigned bpp,
+      const struct png_shift *shift)
 {
    unsigned i;
    bpp /= 8;
@@ -263,12 +278,13 @@ static inline void copy_line_rgb(uint32_t *data,
       decoded += bpp;
       uint32_t b = *decoded;
       decoded += bpp;
-      data[i] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      data[i] = png_pixel(shift, 0xff, r, g, b);
    }
 }
 
 static inline void copy_line_rgba(uint32_t *data,
-      const uint8_t *decoded, unsigned width, unsigned bpp)
+      const uint8_t *decoded, unsigned width, unsigned bpp,
+      const struct png_shift *shift)
 {
    unsigned i;
    bpp /= 8;
@@ -282,12 +298,13 @@ static inline void copy_line_rgba(uint32_t *data,
       decoded += bpp;
       uint32_t a = *decoded;
       decoded += bpp;
-      data[i] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+      data[i] = png_pixel(shift, a, r, g, b);
    }
 }
 
 static inline void copy_line_bw(uint32_t *data,
-      const uint8_t *decoded, unsigned width, unsigned depth)
+      const uint8_t *decoded, unsigned width, unsigned depth,
+      const struct png_shift *shift)
 {
    unsigned i, bit;
    if (depth == 16)
@@ -295,7 +312,7 @@ static inline void copy_line_bw(uint32_t *data,
       for (i = 0; i < width; i++)
       {
          uint32_t val = decoded[i << 1];
-         data[i] = (val * 0x010101) | (0xffu << 24);
+         data[i] = png_pixel(shift, 0xff, val, val, val);
       }
    }
    else
@@ -311,14 +328,14 @@ static inline void copy_line_bw(uint32_t *data,
 
          val &= mask;
          val *= mul;
-         data[i] = (val * 0x010101) | (0xffu << 24);
+         data[i] = png_pixel(shift, 0xff, val, val, val);
       }
    }
 }
 
 static inline void copy_line_gray_alpha(uint32_t *data,
       const uint8_t *decoded, unsigned width,
-      unsigned bpp)
+      unsigned bpp, const struct png_shift *shift)
 {
    unsigned i;
    bpp /= 8;
@@ -329,7 +346,7 @@ static inline void copy_line_gray_alpha(uint32_t *data,
       uint32_t alpha = *decoded;
       decoded += bpp;
 
-      data[i] = (gray * 0x010101) | (alpha << 24);
+      data[i] = png_pixel(shift, alpha, gray, gray, gray);
    }
 }
 
@@ -396,95 +413,290 @@ static void png_pass_geom(const struct png_ihdr *ihdr,
       *pitch_out = pitch;
 }
 
+/* Scanlines are unfiltered in place, and have this many zero
+ * bytes in front. The filters then read them for the pixel
+ * left of the first one, which the spec says is zero. */
+#define PNG_ROW_PAD 8
 
-static bool png_reverse_filter(uint32_t *data, const struct png_ihdr *ihdr,
-      const uint8_t *inflate_buf, size_t inflate_buf_size,
-      const uint32_t *palette)
+/* Bytes of IDAT read from the file at a time. */
+#define PNG_READ_SIZE (32 * 1024)
+
+/* Sub, Average and Paeth depend on the byte bpp bytes back,
+ * so SIMD only helps when a whole pixel fits one vector.
+ * The kernels do one 3 or 4 byte pixel per step, which is
+ * what 8-bit RGB and RGBA use. */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SSE2
+
+static inline __m128i png_load_pixel(const uint8_t *p, unsigned bpp)
 {
-   unsigned i, h;
-   bool ret = true;
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return _mm_cvtsi32_si128(v);
+}
 
-   unsigned bpp;
-   unsigned pitch;
-   size_t pass_size;
-   png_pass_geom(ihdr, ihdr->width, ihdr->height, &bpp, &pitch, &pass_size);
+static inline void png_store_pixel(uint8_t *p, __m128i v, unsigned bpp)
+{
+   uint32_t out = _mm_cvtsi128_si32(v);
+   memcpy(p, &out, bpp);
+}
 
-   if (inflate_buf_size < pass_size)
-      return false;
+static inline void png_unfilter_sub_simd(uint8_t *cur,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
 
-   uint8_t *prev_scanline    = (uint8_t*)calloc(1, pitch);
-   uint8_t *decoded_scanline = (uint8_t*)calloc(1, pitch);
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i d = _mm_add_epi8(png_load_pixel(cur + i, bpp), a);
+      png_store_pixel(cur + i, d, bpp);
+      a = d;
+   }
+}
 
-   if (!prev_scanline || !decoded_scanline)
-      GOTO_END_ERROR();
+static inline void png_unfilter_avg_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i one = _mm_set1_epi8(1);
+   __m128i a = _mm_setzero_si128();
 
-   for (h = 0; h < ihdr->height;
-         h++, inflate_buf += pitch, data += ihdr->width)
+   for (i = 0; i < pitch; i += bpp)
    {
-      unsigned filter = *inflate_buf++;
-      switch (filter)
-      {
-         case 0: /* None */
-            memcpy(decoded_scanline, inflate_buf, pitch);
-            break;
+      __m128i b   = png_load_pixel(prev + i, bpp);
+      /* _mm_avg_epu8 rounds up, the filter rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one));
+      __m128i d   = _mm_add_epi8(png_load_pixel(cur + i, bpp), avg);
+      png_store_pixel(cur + i, d, bpp);
+      a = d;
+   }
+}
 
-         case 1: /* Sub */
-            for (i = 0; i < bpp; i++)
-               decoded_scanline[i] = inflate_buf[i];
-            for (i = bpp; i < pitch; i++)
-               decoded_scanline[i] = decoded_scanline[i - bpp] + inflate_buf[i];
-            break;
+static inline __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
 
-         case 2: /* Up */
-            for (i = 0; i < pitch; i++)
-               decoded_scanline[i] = prev_scanline[i] + inflate_buf[i];
-            break;
+static inline __m128i png_select(__m128i mask, __m128i t, __m128i e)
+{
+   return _mm_or_si128(_mm_and_si128(mask, t), _mm_andnot_si128(mask, e));
+}
 
-         case 3: /* Average */
-            for (i = 0; i < bpp; i++)
-            {
-               uint8_t avg = prev_scanline[i] >> 1;
-               decoded_scanline[i] = avg + inflate_buf[i];
-            }
-            for (i = bpp; i < pitch; i++)
-            {
-               uint8_t avg = (decoded_scanline[i - bpp] + prev_scanline[i]) >> 1;
-               decoded_scanline[i] = avg + inflate_buf[i];
-            }
-            break;
+static inline void png_unfilter_paeth_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i zero = _mm_setzero_si128();
+   /* Left and upper left pixel, widened to 16 bits. */
+   __m128i a = zero;
+   __m128i c = zero;
 
-         case 4: /* Paeth */
-            for (i = 0; i < bpp; i++)
-               decoded_scanline[i] = paeth(0, prev_scanline[i], 0) + inflate_buf[i];
-            for (i = bpp; i < pitch; i++)
-               decoded_scanline[i] = paeth(decoded_scanline[i - bpp],
-                     prev_scanline[i], prev_scanline[i - bpp]) + inflate_buf[i];
-            break;
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b  = _mm_unpacklo_epi8(png_load_pixel(prev + i, bpp), zero);
+      __m128i d  = _mm_unpacklo_epi8(png_load_pixel(cur + i, bpp), zero);
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = _mm_add_epi16(pa, pb);
+      __m128i smallest, nearest;
+
+      pa       = png_abs_epi16(pa);
+      pb       = png_abs_epi16(pb);
+      pc       = png_abs_epi16(pc);
+      smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+      /* Ties go to a, then b, like paeth(). */
+      nearest  = png_select(_mm_cmpeq_epi16(pa, smallest), a,
+            png_select(_mm_cmpeq_epi16(pb, smallest), b, c));
+
+      /* Byte adds, so the sum wraps like the filter wants
+       * and the high bytes stay zero. */
+      d = _mm_add_epi8(d, nearest);
+      png_store_pixel(cur + i, _mm_packus_epi16(d, d), bpp);
+
+      c = b;
+      a = d;
+   }
+}
 
-         default:
-            GOTO_END_ERROR();
-      }
+static inline void png_unfilter_up_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(cur + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(cur + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+
+   for (; i < pitch; i++)
+      cur[i] += prev[i];
+}
 
-      if (ihdr->color_type == 0)
-         copy_line_bw(data, decoded_scanline, ihdr->width, ihdr->depth);
-      else if (ihdr->color_type == 2)
-         copy_line_rgb(data, decoded_scanline, ihdr->width, ihdr->depth);
-      else if (ihdr->color_type == 3)
-         copy_line_plt(data, decoded_scanline, ihdr->width,
-               ihdr->depth, palette);
-      else if (ihdr->color_type == 4)
-         copy_line_gray_alpha(data, decoded_scanline, ihdr->width,
-               ihdr->depth);
-      else if (ihdr->color_type == 6)
-         copy_line_rgba(data, decoded_scanline, ihdr->width, ihdr->depth);
-
-      memcpy(prev_scanline, decoded_scanline, pitch);
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_NEON
+
+static inline uint8x8_t png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static inline void png_store_pixel(uint8_t *p, uint8x8_t v, unsigned bpp)
+{
+   uint32_t out = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+   memcpy(p, &out, bpp);
+}
+
+static inline void png_unfilter_sub_simd(uint8_t *cur,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t d = vadd_u8(png_load_pixel(cur + i, bpp), a);
+      png_store_pixel(cur + i, d, bpp);
+      a = d;
    }
+}
 
-end:
-   free(decoded_scanline);
-   free(prev_scanline);
-   return ret;
+static inline void png_unfilter_avg_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      /* vhadd_u8 rounds down, like the filter. */
+      uint8x8_t avg = vhadd_u8(a, png_load_pixel(prev + i, bpp));
+      uint8x8_t d   = vadd_u8(png_load_pixel(cur + i, bpp), avg);
+      png_store_pixel(cur + i, d, bpp);
+      a = d;
+   }
+}
+
+static inline void png_unfilter_paeth_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t b         = png_load_pixel(prev + i, bpp);
+      uint16x8_t pa       = vabdl_u8(b, c);
+      uint16x8_t pb       = vabdl_u8(a, c);
+      uint16x8_t pc       = vabdq_u16(vaddl_u8(a, b), vshll_n_u8(c, 1));
+      uint16x8_t smallest = vminq_u16(pc, vminq_u16(pa, pb));
+      /* Ties go to a, then b, like paeth(). */
+      uint8x8_t use_a     = vmovn_u16(vceqq_u16(pa, smallest));
+      uint8x8_t use_b     = vmovn_u16(vceqq_u16(pb, smallest));
+      uint8x8_t nearest   = vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+      uint8x8_t d         = vadd_u8(png_load_pixel(cur + i, bpp), nearest);
+
+      png_store_pixel(cur + i, d, bpp);
+      c = b;
+      a = d;
+   }
+}
+
+static inline void png_unfilter_up_simd(uint8_t *cur,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= pitch; i += 16)
+      vst1q_u8(cur + i, vaddq_u8(vld1q_u8(cur + i), vld1q_u8(prev + i)));
+
+   for (; i < pitch; i++)
+      cur[i] += prev[i];
+}
+#endif
+
+/**
+ * png_unfilter_row:
+ * @filter                  : filter type of the scanline.
+ * @cur                     : scanline to unfilter in place.
+ * @prev                    : previous unfiltered scanline.
+ * @pitch                   : bytes per scanline.
+ * @bpp                     : bytes per pixel, rounded up.
+ *
+ * Both scanlines need PNG_ROW_PAD zero bytes in front.
+ *
+ * Returns: true (1) if successful, false (0) on an 
+ * unknown filter type.
+ **/
+static bool png_unfilter_row(unsigned filter, uint8_t *cur,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const uint8_t *left    = cur - bpp;
+   const uint8_t *up_left = prev - bpp;
+
+   switch (filter)
+   {
+      case 0: /* None */
+         break;
+
+      case 1: /* Sub */
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+         if (bpp == 4)
+            png_unfilter_sub_simd(cur, pitch, 4);
+         else if (bpp == 3)
+            png_unfilter_sub_simd(cur, pitch, 3);
+         else
+#endif
+         for (i = 0; i < pitch; i++)
+            cur[i] += left[i];
+         break;
+
+      case 2: /* Up */
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+         png_unfilter_up_simd(cur, prev, pitch);
+#else
+         for (i = 0; i < pitch; i++)
+            cur[i] += prev[i];
+#endif
+         break;
+
+      case 3: /* Average */
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+         if (bpp == 4)
+            png_unfilter_avg_simd(cur, prev, pitch, 4);
+         else if (bpp == 3)
+            png_unfilter_avg_simd(cur, prev, pitch, 3);
+         else
+#endif
+         for (i = 0; i < pitch; i++)
+            cur[i] += (left[i] + prev[i]) >> 1;
+         break;
+
+      case 4: /* Paeth */
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+         if (bpp == 4)
+            png_unfilter_paeth_simd(cur, prev, pitch, 4);
+         else if (bpp == 3)
+            png_unfilter_paeth_simd(cur, prev, pitch, 3);
+         else
+#endif
+         for (i = 0; i < pitch; i++)
+            cur[i] += paeth(left[i], prev[i], up_left[i]);
+         break;
+
+      default:
+         return false;
+   }
+
+   return true;
 }
 
 struct adam7_pass
@@ -495,103 +707,270 @@ struct adam7_pass
    unsigned stride_y;
 };
 
-static void deinterlace_pass(uint32_t *data, const struct png_ihdr *ihdr,
-      const uint32_t *input, unsigned pass_width, unsigned pass_height,
-      const struct adam7_pass *pass)
+static const struct adam7_pass adam7_passes[] = {
+   { 0, 0, 8, 8 },
+   { 4, 0, 8, 8 },
+   { 0, 4, 4, 8 },
+   { 2, 0, 4, 4 },
+   { 0, 2, 2, 4 },
+   { 1, 0, 2, 2 },
+   { 0, 1, 1, 2 },
+};
+
+/* Decoder state, fed IDAT data as it is read. Scanlines are
+ * inflated, unfiltered and written out one at a time, so the
+ * image never sits in memory compressed or filtered. */
+struct png_process
+{
+   const struct png_ihdr *ihdr;
+   const uint32_t *palette;
+   struct png_shift shift;
+   uint32_t *data;
+   /* Pixels of a pass scanline, for interlaced images. */
+   uint32_t *line;
+
+   z_stream stream;
+   bool stream_init;
+
+   /* Each has PNG_ROW_PAD bytes in front, the last of
+    * which the filter type byte gets inflated into. */
+   uint8_t *cur;
+   uint8_t *prev;
+   uint8_t *rows[2];
+
+   unsigned pass;
+   unsigned pass_width;
+   unsigned pass_height;
+   unsigned bpp;
+   unsigned pitch;
+   unsigned h;
+   /* Bytes of the current scanline inflated so far,
+    * filter type byte included. */
+   size_t pos;
+   bool done;
+};
+
+static void png_process_pass(struct png_process *proc)
 {
-   unsigned x, y;
-   data += pass->y * ihdr->width + pass->x;
-   for (y = 0; y < pass_height;
-         y++, data += ihdr->width * pass->stride_y, input += pass_width)
+   struct png_ihdr pass_ihdr = *proc->ihdr;
+
+   if (proc->ihdr->interlace == 1)
+   {
+      const struct adam7_pass *pass = NULL;
+
+      /* Skips empty passes. */
+      for (; proc->pass < ARRAY_SIZE(adam7_passes); proc->pass++)
+      {
+         pass = &adam7_passes[proc->pass];
+         if (proc->ihdr->width > pass->x && proc->ihdr->height > pass->y)
+            break;
+      }
+
+      if (proc->pass == ARRAY_SIZE(adam7_passes))
+      {
+         proc->done = true;
+         return;
+      }
+
+      pass_ihdr.width  = (proc->ihdr->width - pass->x +
+            pass->stride_x - 1) / pass->stride_x;
+      pass_ihdr.height = (proc->ihdr->height - pass->y +
+            pass->stride_y - 1) / pass->stride_y;
+   }
+   else if (proc->pass > 0)
    {
-      uint32_t *out = data;
-      for (x = 0; x < pass_width; x++, out += pass->stride_x)
-         *out = input[x];
+      proc->done = true;
+      return;
    }
+
+   png_pass_geom(&pass_ihdr, pass_ihdr.width, pass_ihdr.height,
+         &proc->bpp, &proc->pitch, NULL);
+
+   proc->pass_width  = pass_ihdr.width;
+   proc->pass_height = pass_ihdr.height;
+   proc->h           = 0;
+   proc->pos         = 0;
+
+   /* The first scanline of a pass has none above it. */
+   memset(proc->prev - PNG_ROW_PAD, 0, PNG_ROW_PAD + proc->pitch);
 }
 
-static bool png_reverse_filter_adam7(uint32_t *data,
-      const struct png_ihdr *ihdr,
-      const uint8_t *inflate_buf, size_t inflate_buf_size,
-      const uint32_t *palette)
+static void png_process_copy_line(const struct png_process *proc,
+      uint32_t *data)
 {
-   unsigned pass;
-   static const struct adam7_pass passes[] = {
-      { 0, 0, 8, 8 },
-      { 4, 0, 8, 8 },
-      { 0, 4, 4, 8 },
-      { 2, 0, 4, 4 },
-      { 0, 2, 2, 4 },
-      { 1, 0, 2, 2 },
-      { 0, 1, 1, 2 },
-   };
+   const struct png_ihdr *ihdr = proc->ihdr;
+   unsigned width              = proc->pass_width;
 
-   for (pass = 0; pass < ARRAY_SIZE(passes); pass++)
+   if (ihdr->color_type == 0)
+      copy_line_bw(data, proc->cur, width, ihdr->depth, &proc->shift);
+   else if (ihdr->color_type == 2)
+      copy_line_rgb(data, proc->cur, width, ihdr->depth, &proc->shift);
+   else if (ihdr->color_type == 3)
+      copy_line_plt(data, proc->cur, width,
+            ihdr->depth, proc->palette);
+   else if (ihdr->color_type == 4)
+      copy_line_gray_alpha(data, proc->cur, width,
+            ihdr->depth, &proc->shift);
+   else if (ihdr->color_type == 6)
+      copy_line_rgba(data, proc->cur, width, ihdr->depth, &proc->shift);
+}
+
+static bool png_process_row(struct png_process *proc)
+{
+   uint8_t *tmp        = NULL;
+   unsigned filter     = proc->cur[-1];
+   unsigned img_width  = proc->ihdr->width;
+
+   proc->cur[-1] = 0;
+   if (!png_unfilter_row(filter, proc->cur, proc->prev,
+            proc->pitch, proc->bpp))
+      return false;
+
+   if (proc->ihdr->interlace == 1)
    {
-      if (ihdr->width <= passes[pass].x ||
-            ihdr->height <= passes[pass].y) /* Empty pass */
-         continue;
+      unsigned x;
+      const struct adam7_pass *pass = &adam7_passes[proc->pass];
+      uint32_t *out = proc->data + (pass->y + proc->h * pass->stride_y)
+         * img_width + pass->x;
+
+      png_process_copy_line(proc, proc->line);
+      for (x = 0; x < proc->pass_width; x++, out += pass->stride_x)
+         *out = proc->line[x];
+   }
+   else
+      png_process_copy_line(proc, proc->data + proc->h * img_width);
 
-      unsigned pass_width  = (ihdr->width - 
-            passes[pass].x + passes[pass].stride_x - 1) / passes[pass].stride_x;
-      unsigned pass_height = (ihdr->height - passes[pass].y + 
-            passes[pass].stride_y - 1) / passes[pass].stride_y;
+   tmp        = proc->prev;
+   proc->prev = proc->cur;
+   proc->cur  = tmp;
+   proc->pos  = 0;
 
-      uint32_t *tmp_data = (uint32_t*)
-         malloc(pass_width * pass_height * sizeof(uint32_t));
+   if (++proc->h == proc->pass_height)
+   {
+      proc->pass++;
+      png_process_pass(proc);
+   }
 
-      if (!tmp_data)
-         return false;
+   return true;
+}
 
-      struct png_ihdr tmp_ihdr = *ihdr;
-      tmp_ihdr.width = pass_width;
-      tmp_ihdr.height = pass_height;
+static bool png_process_init(struct png_process *proc,
+      const struct png_ihdr *ihdr, const uint32_t *palette,
+      const struct png_shift *shift)
+{
+   unsigned i, pitch;
+   size_t pixels = (size_t)ihdr->width * ihdr->height;
 
-      size_t pass_size;
-      png_pass_geom(&tmp_ihdr, pass_width,
-            pass_height, NULL, NULL, &pass_size);
+   proc->ihdr    = ihdr;
+   proc->palette = palette;
+   proc->shift   = *shift;
 
-      if (pass_size > inflate_buf_size)
-      {
-         free(tmp_data);
+   if (pixels / ihdr->width != ihdr->height ||
+         pixels > SIZE_MAX / sizeof(uint32_t))
+      return false;
+
+#ifdef GEKKO
+   /* we often use these in textures, make sure they're 32-byte aligned */
+   proc->data = (uint32_t*)memalign(32, pixels * sizeof(uint32_t));
+#else
+   proc->data = (uint32_t*)malloc(pixels * sizeof(uint32_t));
+#endif
+   if (!proc->data)
+      return false;
+
+   /* Interlaced passes are never wider than the image. */
+   png_pass_geom(ihdr, ihdr->width, ihdr->height, NULL, &pitch, NULL);
+   for (i = 0; i < 2; i++)
+   {
+      proc->rows[i] = (uint8_t*)calloc(1, PNG_ROW_PAD + pitch);
+      if (!proc->rows[i])
          return false;
-      }
+   }
 
-      if (!png_reverse_filter(tmp_data,
-               &tmp_ihdr, inflate_buf, pass_size, palette))
-      {
-         free(tmp_data);
+   proc->cur  = proc->rows[0] + PNG_ROW_PAD;
+   proc->prev = proc->rows[1] + PNG_ROW_PAD;
+
+   if (ihdr->interlace == 1)
+   {
+      proc->line = (uint32_t*)malloc(ihdr->width * sizeof(uint32_t));
+      if (!proc->line)
          return false;
-      }
+   }
 
-      inflate_buf += pass_size;
-      inflate_buf_size -= pass_size;
+   if (inflateInit(&proc->stream) != Z_OK)
+      return false;
+   proc->stream_init = true;
 
-      deinterlace_pass(data,
-            ihdr, tmp_data, pass_width, pass_height, &passes[pass]);
-      free(tmp_data);
+   png_process_pass(proc);
+   return true;
+}
+
+static void png_process_free(struct png_process *proc)
+{
+   if (proc->stream_init)
+      inflateEnd(&proc->stream);
+   free(proc->rows[0]);
+   free(proc->rows[1]);
+   free(proc->line);
+   free(proc->data);
+   memset(proc, 0, sizeof(*proc));
+}
+
+static bool png_process_idat(struct png_process *proc,
+      const uint8_t *buf, size_t size)
+{
+   proc->stream.next_in  = (Bytef*)buf;
+   proc->stream.avail_in = size;
+
+   while (proc->stream.avail_in && !proc->done)
+   {
+      int zret;
+      size_t row_size = proc->pitch + 1;
+
+      proc->stream.next_out  = proc->cur - 1 + proc->pos;
+      proc->stream.avail_out = row_size - proc->pos;
+
+      zret      = inflate(&proc->stream, Z_NO_FLUSH);
+      proc->pos = row_size - proc->stream.avail_out;
+
+      if (proc->pos == row_size && !png_process_row(proc))
+         return false;
+
+      /* Scanlines still missing are caught at the end. */
+      if (zret == Z_STREAM_END)
+         break;
+      if (zret != Z_OK)
+         return false;
    }
 
    return true;
 }
 
-static bool png_append_idat(FILE *file,
-      const struct png_chunk *chunk, struct idat_buffer *buf)
+static bool png_read_idat(FILE *file, const struct png_chunk *chunk,
+      struct png_process *proc, uint8_t *buf)
 {
-   uint8_t *new_buffer = (uint8_t*)realloc(buf->data, buf->size + chunk->size);
-   if (!new_buffer)
-      return false;
+   size_t left = chunk->size;
+
+   while (left)
+   {
+      size_t size = left < PNG_READ_SIZE ? left : PNG_READ_SIZE;
+
+      if (fread(buf, 1, size, file) != size)
+         return false;
+
+      if (!proc->done && !png_process_idat(proc, buf, size))
+         return false;
+
+      left -= size;
+   }
 
-   buf->data  = new_buffer;
-   if (fread(buf->data + buf->size, 1, chunk->size, file) != chunk->size)
-      return false;
    if (fseek(file, sizeof(uint32_t), SEEK_CUR) < 0)
       return false;
-   buf->size += chunk->size;
    return true;
 }
 
-static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries)
+static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries,
+      const struct png_shift *shift)
 {
    unsigned i;
    if (entries > 256)
@@ -606,7 +985,7 @@ static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries)
       uint32_t r = buf[3 * i + 0];
       uint32_t g = buf[3 * i + 1];
       uint32_t b = buf[3 * i + 2];
-      buffer[i] = (r << 16) | (g << 8) | (b << 0) | (0xffu << 24);
+      buffer[i] = png_pixel(shift, 0xff, r, g, b);
    }
 
    if (fseek(file, sizeof(uint32_t), SEEK_CUR) < 0)
@@ -615,8 +994,10 @@ static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries)
    return true;
 }
 
-bool rpng_load_image_argb(const char *path, uint32_t **data,
-      unsigned *width, unsigned *height)
+bool rpng_load_image_argb_shift(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height,
+      unsigned a_shift, unsigned r_shift,
+      unsigned g_shift, unsigned b_shift)
 {
    long pos;
    *data   = NULL;
@@ -636,11 +1017,10 @@ bool rpng_load_image_argb(const char *path, uint32_t **data,
    bool has_idat = false;
    bool has_iend = false;
    bool has_plte = false;
-   uint8_t *inflate_buf = NULL;
-   size_t inflate_buf_size = 0;
-   z_stream stream = {0};
+   uint8_t *read_buf = NULL;
 
-   struct idat_buffer idat_buf = {0};
+   struct png_process proc = {0};
+   struct png_shift shift = { a_shift, r_shift, g_shift, b_shift };
    struct png_ihdr ihdr = {0};
    uint32_t palette[256] = {0};
 
@@ -687,7 +1067,7 @@ bool rpng_load_image_argb(const char *path, uint32_t **data,
             if (chunk.size % 3)
                GOTO_END_ERROR();
 
-            if (!png_read_plte(file, palette, chunk.size / 3))
+            if (!png_read_plte(file, palette, chunk.size / 3, &shift))
                GOTO_END_ERROR();
 
             has_plte = true;
@@ -697,7 +1077,17 @@ bool rpng_load_image_argb(const char *path, uint32_t **data,
             if (!has_ihdr || has_iend || (ihdr.color_type == 3 && !has_plte))
                GOTO_END_ERROR();
 
-            if (!png_append_idat(file, &chunk, &idat_buf))
+            if (!has_idat)
+            {
+               read_buf = (uint8_t*)malloc(PNG_READ_SIZE);
+               if (!read_buf)
+                  GOTO_END_ERROR();
+
+               if (!png_process_init(&proc, &ihdr, palette, &shift))
+                  GOTO_END_ERROR();
+            }
+
+            if (!png_read_idat(file, &chunk, &proc, read_buf))
                GOTO_END_ERROR();
 
             has_idat = true;
@@ -718,60 +1108,30 @@ bool rpng_load_image_argb(const char *path, uint32_t **data,
    if (!has_ihdr || !has_idat || !has_iend)
       GOTO_END_ERROR();
 
-   if (inflateInit(&stream) != Z_OK)
-      GOTO_END_ERROR();
-
-   png_pass_geom(&ihdr, ihdr.width, ihdr.height, NULL, NULL, &inflate_buf_size);
-   if (ihdr.interlace == 1) /* To be sure. */
-      inflate_buf_size *= 2;
-
-   inflate_buf = (uint8_t*)malloc(inflate_buf_size);
-   if (!inflate_buf)
-      GOTO_END_ERROR();
-
-   stream.next_in   = idat_buf.data;
-   stream.avail_in  = idat_buf.size;
-   stream.avail_out = inflate_buf_size;
-   stream.next_out  = inflate_buf;
-
-   if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
-   {
-      inflateEnd(&stream);
+   /* IDAT ended before the last scanline. */
+   if (!proc.done)
       GOTO_END_ERROR();
-   }
-   inflateEnd(&stream);
 
-   *width  = ihdr.width;
-   *height = ihdr.height;
-#ifdef GEKKO
-   /* we often use these in textures, make sure they're 32-byte aligned */
-   *data = (uint32_t*)memalign(32, ihdr.width * ihdr.height * sizeof(uint32_t));
-#else
-   *data = (uint32_t*)malloc(ihdr.width * ihdr.height * sizeof(uint32_t));
-#endif
-   if (!*data)
-      GOTO_END_ERROR();
-
-   if (ihdr.interlace == 1)
-   {
-      if (!png_reverse_filter_adam7(*data,
-               &ihdr, inflate_buf, stream.total_out, palette))
-         GOTO_END_ERROR();
-   }
-   else if (!png_reverse_filter(*data,
-            &ihdr, inflate_buf, stream.total_out, palette))
-      GOTO_END_ERROR();
+   *data     = proc.data;
+   *width    = ihdr.width;
+   *height   = ihdr.height;
+   proc.data = NULL;
 
 end:
    if (file)
       fclose(file);
-   if (!ret)
-      free(*data);
-   free(idat_buf.data);
-   free(inflate_buf);
+   png_process_free(&proc);
+   free(read_buf);
    return ret;
 }
 
+bool rpng_load_image_argb(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   return rpng_load_image_argb_shift(path, data,
+         width, height, 24, 16, 8, 0);
+}
+
 #ifdef HAVE_ZLIB_DEFLATE
 
 static void dword_write_be(uint8_t *buf, uint32_t val)
@@ -870,88 +1230,346 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
    }
 }
 
-static unsigned count_sad(const uint8_t *data, size_t size)
+/* Rows of a band, at least, so the bands do not lose
+ * too much to starting without a dictionary. */
+#define PNG_BAND_MIN_ROWS 64
+
+/* Room in front of the compressed data of a band, for the
+ * IDAT chunk header and, in the first band, the zlib header. */
+#define PNG_IDAT_OFFSET 10
+
+/* Filtered by one thread, compressed as one stretch of the
+ * deflate stream, and written as one IDAT chunk. */
+struct png_band
 {
-   size_t i;
-   unsigned cnt = 0;
-   for (i = 0; i < size; i++)
-      cnt += abs((int8_t)data[i]);
-   return cnt;
-}
+   const uint8_t *data;
+   unsigned first;
+   unsigned rows;
+
+   uint8_t *out;
+   size_t out_size;
+   uLong adler;
+   bool ok;
+};
 
-static unsigned filter_up(uint8_t *target, const uint8_t *line,
-      const uint8_t *prev, unsigned width, unsigned bpp)
+struct png_encoder
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < width; i++)
-      target[i] = line[i] - prev[i];
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   unsigned bpp;
+   int level;
+   struct png_band *bands;
+   unsigned num_bands;
+};
 
-   return count_sad(target, width);
+static void png_encode_line(uint8_t *dst, const uint8_t *src,
+      unsigned width, unsigned bpp)
+{
+   if (bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, width);
+   else
+      copy_bgr24_line(dst, src, width);
 }
 
-static unsigned filter_sub(uint8_t *target, const uint8_t *line,
-      unsigned width, unsigned bpp)
+/**
+ * png_filter_row:
+ * @cur                     : scanline, preceded by @bpp zero bytes.
+ * @prev                    : scanline above, preceded likewise.
+ * @size                    : bytes in a scanline.
+ * @bpp                     : bytes per pixel.
+ * @filtered                : where Sub, Up, Average and Paeth go.
+ * @scores                  : sums of absolute values of the bytes,
+ *                            None first, then as @filtered.
+ *
+ * Runs all filters over the scanline in one go. Every filter
+ * only reads unfiltered bytes, so this carries no dependency
+ * from one pixel to the next and vectorizes in full.
+ **/
+static void png_filter_row(const uint8_t *cur, const uint8_t *prev,
+      unsigned size, unsigned bpp, uint8_t **filtered, unsigned *scores)
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i];
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - line[i - bpp];
+   unsigned i = 0, j;
+   uint8_t *sub_out   = filtered[0];
+   uint8_t *up_out    = filtered[1];
+   uint8_t *avg_out   = filtered[2];
+   uint8_t *paeth_out = filtered[3];
 
-   return count_sad(target, width);
+   for (j = 0; j < 5; j++)
+      scores[j] = 0;
+
+#ifdef RPNG_SSE2
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i one  = _mm_set1_epi8(1);
+      __m128i sad[5];
+
+      for (j = 0; j < 5; j++)
+         sad[j] = zero;
+
+/* Bytes taken as signed, so |x| is the smaller of x and -x
+ * taken as unsigned. */
+#define PNG_SAD(acc, v) acc = _mm_add_epi64(acc, _mm_sad_epu8( \
+      _mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero))
+
+      for (; i + 16 <= size; i += 16)
+      {
+         __m128i x  = _mm_loadu_si128((const __m128i*)(cur + i));
+         __m128i a  = _mm_loadu_si128((const __m128i*)(cur + i - bpp));
+         __m128i b  = _mm_loadu_si128((const __m128i*)(prev + i));
+         __m128i c  = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+         /* _mm_avg_epu8 rounds up, the filter rounds down. */
+         __m128i mean = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+         __m128i pred[2], v;
+
+         for (j = 0; j < 2; j++)
+         {
+            __m128i a16 = j ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i b16 = j ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+            __m128i c16 = j ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            __m128i pa  = _mm_sub_epi16(b16, c16);
+            __m128i pb  = _mm_sub_epi16(a16, c16);
+            __m128i pc  = png_abs_epi16(_mm_add_epi16(pa, pb));
+            __m128i smallest;
+
+            pa       = png_abs_epi16(pa);
+            pb       = png_abs_epi16(pb);
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+            /* Ties go to a, then b, like paeth(). */
+            pred[j]  = png_select(_mm_cmpeq_epi16(pa, smallest), a16,
+                  png_select(_mm_cmpeq_epi16(pb, smallest), b16, c16));
+         }
+
+         PNG_SAD(sad[0], x);
+
+         v = _mm_sub_epi8(x, a);
+         _mm_storeu_si128((__m128i*)(sub_out + i), v);
+         PNG_SAD(sad[1], v);
+
+         v = _mm_sub_epi8(x, b);
+         _mm_storeu_si128((__m128i*)(up_out + i), v);
+         PNG_SAD(sad[2], v);
+
+         v = _mm_sub_epi8(x, mean);
+         _mm_storeu_si128((__m128i*)(avg_out + i), v);
+         PNG_SAD(sad[3], v);
+
+         v = _mm_sub_epi8(x, _mm_packus_epi16(pred[0], pred[1]));
+         _mm_storeu_si128((__m128i*)(paeth_out + i), v);
+         PNG_SAD(sad[4], v);
+      }
+#undef PNG_SAD
+
+      for (j = 0; j < 5; j++)
+         scores[j] = _mm_cvtsi128_si32(sad[j]) +
+            _mm_cvtsi128_si32(_mm_unpackhi_epi64(sad[j], sad[j]));
+   }
+#endif
+
+   for (; i < size; i++)
+   {
+      uint8_t x = cur[i];
+      uint8_t a = (cur - bpp)[i];
+      uint8_t b = prev[i];
+      uint8_t c = (prev - bpp)[i];
+
+      sub_out[i]   = x - a;
+      up_out[i]    = x - b;
+      avg_out[i]   = x - ((a + b) >> 1);
+      paeth_out[i] = x - paeth(a, b, c);
+
+      scores[0] += abs((int8_t)x);
+      scores[1] += abs((int8_t)sub_out[i]);
+      scores[2] += abs((int8_t)up_out[i]);
+      scores[3] += abs((int8_t)avg_out[i]);
+      scores[4] += abs((int8_t)paeth_out[i]);
+   }
 }
 
-static unsigned filter_avg(uint8_t *target, const uint8_t *line,
-      const uint8_t *prev, unsigned width, unsigned bpp)
+/* Filters the rows of @band, and compresses them as a part of
+ * the deflate stream which ends with a sync flush, unless it
+ * is the last part. */
+static bool png_encode_band(const struct png_encoder *enc,
+      struct png_band *band)
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
+   unsigned h, i;
+   int flush, rc;
+   z_stream stream;
+   bool ret                = false;
+   const uint8_t *data     = band->data;
+   size_t size             = enc->width * enc->bpp;
+   size_t filtered_size    = (size + 1) * band->rows;
+   uint8_t *filtered       = NULL;
+   uint8_t *rows           = NULL;
+   uint8_t *cur, *prev, *target;
+   uint8_t *candidates[4];
+   unsigned scores[5];
+
+   memset(&stream, 0, sizeof(stream));
+
+   /* The row above, 4 candidates, then what gets compressed. */
+   rows     = (uint8_t*)calloc(6, PNG_ROW_PAD + size);
+   filtered = (uint8_t*)malloc(filtered_size);
+   if (!rows || !filtered)
+      goto end;
+
+   prev = rows + PNG_ROW_PAD;
+   cur  = prev + PNG_ROW_PAD + size;
+   for (i = 0; i < 4; i++)
+      candidates[i] = cur + (i + 1) * (PNG_ROW_PAD + size);
+
+   if (band->first)
+      png_encode_line(prev, data - enc->pitch, enc->width, enc->bpp);
+
+   for (h = 0, target = filtered; h < band->rows;
+         h++, data += enc->pitch, target += size + 1)
+   {
+      uint8_t filter = 0;
+      unsigned min_sad;
+      const uint8_t *chosen = cur;
+      uint8_t *tmp;
+
+      png_encode_line(cur, data, enc->width, enc->bpp);
+
+      /* Try every filtering method, and choose the method
+       * which has most entries as zero.
+       *
+       * This is probably not very optimal, but it's very 
+       * simple to implement.
+       */
+      png_filter_row(cur, prev, size, enc->bpp, candidates, scores);
+
+      min_sad = scores[0];
+      for (i = 1; i < 5; i++)
+      {
+         if (scores[i] < min_sad)
+         {
+            filter  = i;
+            chosen  = candidates[i - 1];
+            min_sad = scores[i];
+         }
+      }
+
+      target[0] = filter;
+      memcpy(target + 1, chosen, size);
+
+      tmp  = prev;
+      prev = cur;
+      cur  = tmp;
+   }
+
+   /* Raw deflate, the zlib header and checksum are only
+    * written once for the whole stream. */
+   if (deflateInit2(&stream, enc->level, Z_DEFLATED,
+            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      goto end;
+
+   /* The sync flush marker and the checksum on top. */
+   band->out_size = deflateBound(&stream, filtered_size) + 16;
+   band->out      = (uint8_t*)malloc(PNG_IDAT_OFFSET + band->out_size);
+   if (!band->out)
+   {
+      deflateEnd(&stream);
+      goto end;
+   }
+
+   flush            = (band->first + band->rows == enc->height)
+      ? Z_FINISH : Z_SYNC_FLUSH;
+   stream.next_in   = filtered;
+   stream.avail_in  = filtered_size;
+   stream.next_out  = band->out + PNG_IDAT_OFFSET;
+   stream.avail_out = band->out_size;
 
-   return count_sad(target, width);
+   rc             = deflate(&stream, flush);
+   band->out_size = stream.total_out;
+   deflateEnd(&stream);
+
+   if (flush == Z_FINISH ? rc != Z_STREAM_END
+         : (rc != Z_OK || stream.avail_in))
+      goto end;
+
+   band->adler = adler32(adler32(0, NULL, 0), filtered, filtered_size);
+   ret         = true;
+
+end:
+   free(rows);
+   free(filtered);
+   return ret;
 }
 
-static unsigned filter_paeth(uint8_t *target,
-      const uint8_t *line, const uint8_t *prev,
-      unsigned width, unsigned bpp)
+#ifdef HAVE_THREADS
+static void png_encode_band_job(void *data, unsigned index)
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
+   struct png_encoder *enc = (struct png_encoder*)data;
+   struct png_band *band   = &enc->bands[index];
 
-   return count_sad(target, width);
+   band->ok = png_encode_band(enc, band);
 }
+#endif
 
 static bool rpng_save_image(const char *path,
       const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      const struct rpng_save_options *options)
 {
-   unsigned h;
+   unsigned i;
    bool ret = true;
+   uLong adler = 0;
    struct png_ihdr ihdr = {0};
+   struct png_encoder enc = {0};
+   FILE *file = NULL;
+
+   enc.width     = width;
+   enc.height    = height;
+   enc.pitch     = pitch;
+   enc.bpp       = bpp;
+   enc.level     = options ? options->level : 9;
+   enc.num_bands = 1;
+
+#ifdef HAVE_THREADS
+   if (options && options->pool)
+   {
+      enc.num_bands = sthread_pool_threads(options->pool);
+      if (enc.num_bands > height / PNG_BAND_MIN_ROWS)
+         enc.num_bands = height / PNG_BAND_MIN_ROWS;
+      if (!enc.num_bands)
+         enc.num_bands = 1;
+   }
+#endif
 
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
+   enc.bands = (struct png_band*)calloc(enc.num_bands, sizeof(*enc.bands));
+   if (!enc.bands || !height)
+      GOTO_END_ERROR();
+
+   for (i = 0; i < enc.num_bands; i++)
+   {
+      struct png_band *band = &enc.bands[i];
+
+      band->first = (uint64_t)height * i / enc.num_bands;
+      band->rows  = (uint64_t)height * (i + 1) / enc.num_bands - band->first;
+      band->data  = data + (size_t)band->first * pitch;
+   }
+
+#ifdef HAVE_THREADS
+   if (enc.num_bands > 1)
+      sthread_pool_parallel_for(options->pool, enc.num_bands,
+            png_encode_band_job, &enc);
+   else
+#endif
+      enc.bands[0].ok = png_encode_band(&enc, &enc.bands[0]);
 
-   z_stream stream = {0};
+   for (i = 0; i < enc.num_bands; i++)
+   {
+      if (!enc.bands[i].ok)
+         GOTO_END_ERROR();
+      adler = i ? adler32_combine(adler, enc.bands[i].adler,
+            (z_off_t)enc.bands[i].rows * (width * bpp + 1))
+         : enc.bands[i].adler;
+   }
 
-   FILE *file = fopen(path, "wb");
+   file = fopen(path, "wb");
    if (!file)
       GOTO_END_ERROR();
 
@@ -965,103 +1583,39 @@ static bool rpng_save_image(const char *path,
    if (!png_write_ihdr(file, &ihdr))
       GOTO_END_ERROR();
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
-
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
-
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
-
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   /* The IDAT chunks together make up the zlib stream. */
+   for (i = 0; i < enc.num_bands; i++)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      struct png_band *band = &enc.bands[i];
+      uint8_t *chunk        = band->out + PNG_IDAT_OFFSET - 8;
+      size_t size           = band->out_size;
 
-      /* Try every filtering method, and choose the method
-       * which has most entries as zero.
-       *
-       * This is probably not very optimal, but it's very 
-       * simple to implement.
-       */
-      unsigned none_score  = count_sad(rgba_line, width * bpp);
-      unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-      unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-      unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-      unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
-
-      uint8_t filter = 0;
-      unsigned min_sad = none_score;
-      const uint8_t *chosen_filtered = rgba_line;
-
-      if (sub_score < min_sad)
+      if (i == 0)
       {
-         filter = 1;
-         chosen_filtered = sub_filtered;
-         min_sad = sub_score;
+         /* 32K window, with the level in FLEVEL, and
+          * FCHECK making it a multiple of 31. */
+         int level       = enc.level < 0 ? 6 : enc.level;
+         unsigned flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+         unsigned header = (0x78 << 8) | (flevel << 6);
+
+         header += (31 - header % 31) % 31;
+         chunk  -= 2;
+         size   += 2;
+         chunk[8] = (uint8_t)(header >> 8);
+         chunk[9] = (uint8_t)header;
       }
 
-      if (up_score < min_sad)
+      if (i == enc.num_bands - 1)
       {
-         filter = 2;
-         chosen_filtered = up_filtered;
-         min_sad = up_score;
+         dword_write_be(chunk + 8 + size, adler);
+         size += 4;
       }
 
-      if (avg_score < min_sad)
-      {
-         filter = 3;
-         chosen_filtered = avg_filtered;
-         min_sad = avg_score;
-      }
-
-      if (paeth_score < min_sad)
-      {
-         filter = 4;
-         chosen_filtered = paeth_filtered;
-         min_sad = paeth_score;
-      }
-
-      *encode_target++ = filter;
-      memcpy(encode_target, chosen_filtered, width * bpp);
-
-      memcpy(prev_encoded, rgba_line, width * bpp);
-   }
-
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
-      GOTO_END_ERROR();
-
-   stream.next_in   = encode_buf;
-   stream.avail_in  = encode_buf_size;
-   stream.next_out  = deflate_buf + 8;
-   stream.avail_out = encode_buf_size * 2;
-
-   deflateInit(&stream, 9);
-   if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
-   {
-      deflateEnd(&stream);
-      GOTO_END_ERROR();
+      memcpy(chunk + 4, "IDAT", 4);
+      dword_write_be(chunk + 0, size);
+      if (!png_write_idat(file, chunk, size + 8))
+         GOTO_END_ERROR();
    }
-   deflateEnd(&stream);
-
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0, stream.total_out);
-   if (!png_write_idat(file, deflate_buf, stream.total_out + 8))
-      GOTO_END_ERROR();
 
    if (!png_write_iend(file))
       GOTO_END_ERROR();
@@ -1069,14 +1623,12 @@ static bool rpng_save_image(const char *path,
 end:
    if (file)
       fclose(file);
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
+   if (!ret && file)
+      remove(path);
+   if (enc.bands)
+      for (i = 0; i < enc.num_bands; i++)
+         free(enc.bands[i].out);
+   free(enc.bands);
    return ret;
 }
 
@@ -1084,14 +1636,30 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), NULL);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, NULL);
+}
+
+bool rpng_save_image_argb_ext(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      const struct rpng_save_options *options)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, sizeof(uint32_t), options);
+}
+
+bool rpng_save_image_bgr24_ext(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      const struct rpng_save_options *options)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, options);
 }
 
 #endif
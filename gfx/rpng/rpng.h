@@ -31,11 +31,37 @@ extern "C" {
 bool rpng_load_image_argb(const char *path, uint32_t **data,
       unsigned *width, unsigned *height);
 
+/* Like rpng_load_image_argb, but puts each channel
+ * at the given bit shift. */
+bool rpng_load_image_argb_shift(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height,
+      unsigned a_shift, unsigned r_shift,
+      unsigned g_shift, unsigned b_shift);
+
 #ifdef HAVE_ZLIB_DEFLATE
+struct sthread_pool;
+
+struct rpng_save_options
+{
+   /* zlib level, from 0 (fastest) to 9 (smallest). */
+   int level;
+   /* Optional. If set, rows are filtered and compressed
+    * in bands which run on this pool (HAVE_THREADS). */
+   struct sthread_pool *pool;
+};
+
+/* Save at level 9 on the calling thread. */
 bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch);
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
+
+bool rpng_save_image_argb_ext(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      const struct rpng_save_options *options);
+bool rpng_save_image_bgr24_ext(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      const struct rpng_save_options *options);
 #endif
 
 #ifdef __cplusplus
@@ -130,6 +130,11 @@ typedef struct gfx_ctx_driver
 
    /* Optional. Binds HW-render offscreen context. */
    void (*bind_hw_render)(void *data, bool enable);
+
+   /* Optional. Asks for variable refresh (FreeSync, G-Sync) on the
+    * current window, or stops asking. Only valid after set_video_mode.
+    * Returns true if the display is known to refresh at variable rate. */
+   bool (*set_vrr)(void *data, bool enable);
 } gfx_ctx_driver_t;
 
 extern const gfx_ctx_driver_t gfx_ctx_sdl_gl;
@@ -79,6 +79,28 @@ struct font_params
 #define FONT_COLOR_GET_BLUE(col)  (((col) >> 16) & 0xff)
 #define FONT_COLOR_GET_ALPHA(col) (((col) >> 24) & 0xff)
 
+/* Receives a bottom-up ARGB8888 copy of the viewport, 
+ * which the callee takes ownership of. */
+typedef void (*video_viewport_read_cb_t)(void *buffer,
+      unsigned width, unsigned height, int pitch);
+
+/* Viewport contents in driver owned memory, 
+ * see read_viewport_mapped(). */
+struct video_mapped_frame
+{
+   /* Top row, XRGB8888. */
+   const void *data;
+   unsigned width;
+   unsigned height;
+   /* Negative when rows are stored bottom-up. */
+   int pitch;
+
+   /* Gives the memory back to the driver. 
+    * Callable from any thread. */
+   void (*release)(void *userdata);
+   void *userdata;
+};
+
 /* Optionally implemented interface to poke more
  * deeply into video driver. */
 
@@ -107,6 +129,23 @@ typedef struct video_poke_interface
    void (*grab_mouse_toggle)(void *data);
 
    struct gfx_shader *(*get_current_shader)(void *data);
+
+   /* Hands out memory the core can render the next frame into. */
+   bool (*get_current_software_framebuffer)(void *data,
+         struct retro_framebuffer *framebuffer);
+
+   /* Reads back the viewport of the next frame without stalling. 
+    * @cb is called from a later frame once the data has arrived. */
+   bool (*read_viewport_async)(void *data, video_viewport_read_cb_t cb);
+
+   /* Like read_viewport, but without copying the frame out.
+    * Returns false while no frame is ready. With a NULL @frame, 
+    * only reports whether the driver can do this at all. */
+   bool (*read_viewport_mapped)(void *data, struct video_mapped_frame *frame);
+
+   /* Whether the last frame shown was the one before it again,
+    * shown without running the shader chain. */
+   bool (*frame_repeated)(void *data);
 } video_poke_interface_t;
 
 typedef struct video_driver
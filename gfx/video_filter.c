@@ -23,6 +23,25 @@
 #include <file/dir_list.h>
 #include "../performance.h"
 #include <stdlib.h>
+#include <string.h>
+
+/* Pool tasks should take at least this long, so that queueing 
+ * them costs next to nothing in comparison. */
+#define SOFTFILTER_TASK_MIN_USEC 200
+
+/* Upper bound on slices when the thread count is automatic. */
+#define SOFTFILTER_MAX_SLICES 32
+
+/* Rows a slice should have at the very least. */
+#define SOFTFILTER_MIN_SLICE_ROWS 16
+
+/* Used if the cache size cannot be queried. */
+#define SOFTFILTER_DEFAULT_CACHE_SIZE (256 * 1024)
+
+/* Source rows a filter may look at above and below the 
+ * line it works on. Chains run over tiles which overlap by 
+ * this many rows per stage, so that tile edges do not show. */
+#define SOFTFILTER_CHAIN_HALO_ROWS 2
 
 struct rarch_soft_plug
 {
@@ -33,65 +52,52 @@ struct rarch_soft_plug
 };
 
 #ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
-{
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
-};
+#include "../retroarch.h"
+#endif
 
-static void filter_thread_loop(void *data)
+struct rarch_softfilter_stage
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   const struct softfilter_implementation *impl;
+   void *impl_data;
 
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
+   enum retro_pixel_format in_pix_fmt, out_pix_fmt;
+   /* Output rows per input row, 0 if not a whole number. */
+   unsigned scale_y;
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+   struct softfilter_work_packet *packets;
+   unsigned threads;
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
-}
+#ifdef HAVE_THREADS
+   sthread_pool_t *pool;
+   /* Consecutive packets run by one pool task. */
+   unsigned batch;
+   /* Running average of the time one packet takes. */
+   retro_time_t packet_usec;
 #endif
+};
 
 struct rarch_softfilter
 {
    config_file_t *conf;
 
-   const struct softfilter_implementation *impl;
-   void *impl_data;
-
    struct rarch_soft_plug *plugs;
    unsigned num_plugs;
 
+   struct rarch_softfilter_stage *stages;
+   unsigned num_stages;
+
    unsigned max_width, max_height;
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
-   struct softfilter_work_packet *packets;
-   unsigned threads;
-
-#ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
-#endif
+   /* Chains only. Two halves which the stages of 
+    * a tile take turns writing to. */
+   uint8_t *tile_buffer;
+   size_t tile_buffer_half;
+   size_t tile_stride;
+   /* Source rows per tile, and extra rows processed 
+    * above and below them. */
+   unsigned tile_rows;
+   unsigned tile_halo;
 };
 
 static const struct softfilter_implementation *
@@ -117,33 +123,82 @@ static const struct softfilter_config softfilter_config = {
    config_userdata_free,
 };
 
-static bool create_softfilter_graph(rarch_softfilter_t *filt,
+/**
+ * softfilter_auto_slices:
+ * @max_width               : maximum input width.
+ * @max_height              : maximum input height.
+ * @bpp                     : bytes per input pixel.
+ *
+ * Picks how many slices a frame is cut into when the 
+ * thread count is automatic. There are at least as many 
+ * slices as the pool has threads, and more if that is 
+ * what it takes for a slice to fit the per-core cache.
+ * The output is assumed to be scaled 2x.
+ *
+ * Returns: number of slices.
+ **/
+static unsigned softfilter_auto_slices(unsigned max_width,
+      unsigned max_height, unsigned bpp)
+{
+   unsigned slices    = rarch_get_cpu_cores();
+   size_t cache_size  = rarch_get_cpu_cache_size();
+   /* Input and 2x2 output rows. */
+   size_t frame_size  = (size_t)max_width * max_height * bpp * 5;
+   unsigned max_slices = max_height / SOFTFILTER_MIN_SLICE_ROWS;
+
+#ifdef HAVE_THREADS
+   if (rarch_get_thread_pool())
+      slices = sthread_pool_threads(rarch_get_thread_pool());
+#endif
+
+   if (!cache_size)
+      cache_size = SOFTFILTER_DEFAULT_CACHE_SIZE;
+
+   while (slices < SOFTFILTER_MAX_SLICES && frame_size / slices > cache_size)
+      slices <<= 1;
+
+   if (slices > SOFTFILTER_MAX_SLICES)
+      slices = SOFTFILTER_MAX_SLICES;
+   if (slices > max_slices)
+      slices = max_slices;
+   if (slices < 1)
+      slices = 1;
+
+   return slices;
+}
+
+static unsigned softfilter_pixel_size(enum retro_pixel_format fmt)
+{
+   return fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 
+      sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+static bool create_softfilter_stage(rarch_softfilter_t *filt,
+      struct rarch_softfilter_stage *stage, const char *key,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i;
-   char key[64], name[64];
+   unsigned input_fmts, input_fmt, output_fmts, out_width, out_height;
+   char name[64];
    struct config_file_userdata userdata;
 
-   snprintf(key, sizeof(key), "filter");
-
    if (!config_get_array(filt->conf, key, name, sizeof(name)))
       return false;
 
-   filt->impl = softfilter_find_implementation(filt, name);
-   if (!filt->impl)
+   stage->impl = softfilter_find_implementation(filt, name);
+   if (!stage->impl)
       return false;
 
    userdata.conf = filt->conf;
    /* Index-specific configs take priority over ident-specific. */
    userdata.prefix[0] = key; 
-   userdata.prefix[1] = filt->impl->short_ident;
+   userdata.prefix[1] = stage->impl->short_ident;
 
    /* Simple assumptions. */
-   filt->pix_fmt = in_pixel_format;
-   input_fmts = filt->impl->query_input_formats();
+   stage->in_pix_fmt = in_pixel_format;
+   input_fmts = stage->impl->query_input_formats();
 
    switch (in_pixel_format)
    {
@@ -163,75 +218,205 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       return false;
    }
 
-   output_fmts = filt->impl->query_output_formats(input_fmt);
+   output_fmts = stage->impl->query_output_formats(input_fmt);
    /* If we have a match of input/output formats, use that. */
    if (output_fmts & input_fmt)
-      filt->out_pix_fmt = in_pixel_format;
+      stage->out_pix_fmt = in_pixel_format;
    else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+      stage->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
    else if (output_fmts & SOFTFILTER_FMT_RGB565)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
+      stage->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
    else
    {
       RARCH_ERR("Did not find suitable output format for softfilter.\n");
       return false;
    }
 
-   filt->max_width = max_width;
-   filt->max_height = max_height;
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = softfilter_auto_slices(max_width, max_height,
+            softfilter_pixel_size(in_pixel_format));
 
-   filt->impl_data = filt->impl->create(
+   stage->impl_data = stage->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads : 
-         rarch_get_cpu_cores(), cpu_features,
-         &userdata);
-   if (!filt->impl_data)
+         threads, cpu_features, &userdata);
+   if (!stage->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
+   threads = stage->impl->query_num_threads(stage->impl_data);
    if (!threads)
    {
       RARCH_ERR("Invalid number of threads.\n");
       return false;
    }
 
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   RARCH_LOG("Using %u slices for softfilter %s.\n", threads, name);
 
-   filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
-   if (!filt->packets)
+   stage->packets = (struct softfilter_work_packet*)
+      calloc(threads, sizeof(*stage->packets));
+   if (!stage->packets)
    {
       RARCH_ERR("Failed to allocate softfilter packets.\n");
       return false;
    }
 
+   stage->threads = threads;
+
+   stage->impl->query_output_size(stage->impl_data, &out_width,
+         &out_height, max_width, max_height);
+   stage->scale_y = (max_height && out_height % max_height == 0) ?
+      out_height / max_height : 0;
+
 #ifdef HAVE_THREADS
-   filt->thread_data = (struct filter_thread_data*)
-      calloc(threads, sizeof(*filt->thread_data));
-   if (!filt->thread_data)
+   /* Packets run on the shared pool, so that we do not 
+    * oversubscribe the cores with threads of our own. */
+   if (threads > 1)
+      stage->pool = rarch_get_thread_pool();
+   stage->batch = 1;
+#endif
+
+   return true;
+}
+
+/**
+ * create_softfilter_tiles:
+ * @filt                    : softfilter handle.
+ *
+ * Sets up tiled processing of a chain. Tiles are sized 
+ * so that a tile and everything the stages make of it fit 
+ * the per-core cache. If a stage does not scale by a whole 
+ * number of rows, the chain runs over the whole frame instead.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool create_softfilter_tiles(rarch_softfilter_t *filt)
+{
+   unsigned i, width, height, band_rows;
+   size_t row_size   = 0;
+   size_t cache_size = rarch_get_cpu_cache_size();
+   bool tileable     = true;
+
+   if (!cache_size)
+      cache_size = SOFTFILTER_DEFAULT_CACHE_SIZE;
+
+   /* Bytes written per source row, over the whole chain. */
+   width  = filt->max_width;
+   height = 1;
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+
+      if (!stage->scale_y)
+         tileable = false;
+
+      stage->impl->query_output_size(stage->impl_data,
+            &width, &height, width, height);
+      row_size += (size_t)width * height * 
+         softfilter_pixel_size(stage->out_pix_fmt);
+   }
+
+   filt->tile_halo = SOFTFILTER_CHAIN_HALO_ROWS * filt->num_stages;
+   filt->tile_rows = row_size ? cache_size / row_size : filt->max_height;
+   if (filt->tile_rows < 4 * filt->tile_halo)
+      filt->tile_rows = 4 * filt->tile_halo;
+
+   if (!tileable || filt->tile_rows >= filt->max_height)
+   {
+      filt->tile_rows = filt->max_height;
+      filt->tile_halo = 0;
+   }
+
+   band_rows = filt->tile_rows + 2 * filt->tile_halo;
+   if (band_rows > filt->max_height)
+      band_rows = filt->max_height;
+
+   /* Size the halves for the largest stage output. */
+   width  = filt->max_width;
+   height = band_rows;
+   filt->tile_stride      = 0;
+   filt->tile_buffer_half = 0;
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+      size_t stride;
+
+      stage->impl->query_output_size(stage->impl_data,
+            &width, &height, width, height);
+
+      stride = (size_t)width * softfilter_pixel_size(stage->out_pix_fmt);
+      if (stride > filt->tile_stride)
+         filt->tile_stride = stride;
+      if ((size_t)height > filt->tile_buffer_half)
+         filt->tile_buffer_half = height;
+   }
+
+   filt->tile_stride      = (filt->tile_stride + 15) & ~(size_t)15;
+   filt->tile_buffer_half *= filt->tile_stride;
+
+   filt->tile_buffer = (uint8_t*)malloc(2 * filt->tile_buffer_half);
+   if (!filt->tile_buffer)
+   {
+      RARCH_ERR("Failed to allocate softfilter tile buffer.\n");
       return false;
-   filt->threads = threads;
+   }
+
+   RARCH_LOG("[SoftFilter]: Running %u filters over tiles of %u rows.\n",
+         filt->num_stages, filt->tile_rows);
+
+   return true;
+}
+
+static bool create_softfilter_graph(rarch_softfilter_t *filt,
+      enum retro_pixel_format in_pixel_format,
+      unsigned max_width, unsigned max_height,
+      softfilter_simd_mask_t cpu_features,
+      unsigned threads)
+{
+   unsigned i, filters = 0;
+   unsigned width  = max_width;
+   unsigned height = max_height;
+   enum retro_pixel_format fmt = in_pixel_format;
+
+   /* Either a single "filter", or a chain of "filters" 
+    * called "filter0", "filter1", ... */
+   if (!config_get_uint(filt->conf, "filters", &filters))
+      filters = 0;
+
+   filt->num_stages = filters ? filters : 1;
+   filt->stages = (struct rarch_softfilter_stage*)
+      calloc(filt->num_stages, sizeof(*filt->stages));
+   if (!filt->stages)
+      return false;
+
+   filt->pix_fmt    = in_pixel_format;
+   filt->max_width  = max_width;
+   filt->max_height = max_height;
 
-   for (i = 0; i < threads; i++)
+   for (i = 0; i < filt->num_stages; i++)
    {
-      filt->thread_data[i].userdata = filt->impl_data;
-      filt->thread_data[i].done = true;
+      char key[64];
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
 
-      filt->thread_data[i].lock = slock_new();
-      if (!filt->thread_data[i].lock)
-         return false;
-      filt->thread_data[i].cond = scond_new();
-      if (!filt->thread_data[i].cond)
-         return false;
-      filt->thread_data[i].thread = sthread_create(
-            filter_thread_loop, &filt->thread_data[i]);
-      if (!filt->thread_data[i].thread)
+      if (filters)
+         snprintf(key, sizeof(key), "filter%u", i);
+      else
+         snprintf(key, sizeof(key), "filter");
+
+      if (!create_softfilter_stage(filt, stage, key, fmt,
+               width, height, cpu_features, threads))
          return false;
+
+      stage->impl->query_output_size(stage->impl_data,
+            &width, &height, width, height);
+      fmt = stage->out_pix_fmt;
    }
-#endif
+
+   filt->out_pix_fmt = fmt;
+
+   if (filt->num_stages > 1)
+      return create_softfilter_tiles(filt);
 
    return true;
 }
@@ -415,9 +600,16 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    if (!filt)
       return;
 
-   free(filt->packets);
-   if (filt->impl && filt->impl_data)
-      filt->impl->destroy(filt->impl_data);
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+
+      free(stage->packets);
+      if (stage->impl && stage->impl_data)
+         stage->impl->destroy(stage->impl_data);
+   }
+   free(filt->stages);
+   free(filt->tile_buffer);
 
 #ifdef HAVE_DYLIB
    for (i = 0; i < filt->num_plugs; i++)
@@ -427,22 +619,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    }
    free(filt->plugs);
 #endif
-
-#ifdef HAVE_THREADS
-   for (i = 0; i < filt->threads; i++)
-   {
-      if (!filt->thread_data[i].thread)
-         continue;
-      slock_lock(filt->thread_data[i].lock);
-      filt->thread_data[i].die = true;
-      scond_signal(filt->thread_data[i].cond);
-      slock_unlock(filt->thread_data[i].lock);
-      sthread_join(filt->thread_data[i].thread);
-      slock_free(filt->thread_data[i].lock);
-      scond_free(filt->thread_data[i].cond);
-   }
-   free(filt->thread_data);
-#endif
    free(filt);
 }
 
@@ -457,9 +633,22 @@ void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
 {
-   if (filt && filt->impl && filt->impl->query_output_size)
-      filt->impl->query_output_size(filt->impl_data, out_width,
-            out_height, width, height);
+   unsigned i;
+
+   if (!filt)
+      return;
+
+   *out_width  = width;
+   *out_height = height;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+
+      if (stage->impl && stage->impl->query_output_size)
+         stage->impl->query_output_size(stage->impl_data, out_width,
+               out_height, *out_width, *out_height);
+   }
 }
 
 enum retro_pixel_format rarch_softfilter_get_output_format(
@@ -468,44 +657,202 @@ enum retro_pixel_format rarch_softfilter_get_output_format(
    return filt->out_pix_fmt;
 }
 
-void rarch_softfilter_process(rarch_softfilter_t *filt,
+static void softfilter_work(void *data, unsigned index)
+{
+   struct rarch_softfilter_stage *stage = 
+      (struct rarch_softfilter_stage*)data;
+
+   if (stage->packets[index].work)
+      stage->packets[index].work(stage->impl_data,
+            stage->packets[index].thread_data);
+}
+
+#ifdef HAVE_THREADS
+static void softfilter_work_batch(void *data, unsigned index)
+{
+   struct rarch_softfilter_stage *stage = 
+      (struct rarch_softfilter_stage*)data;
+   unsigned i     = index * stage->batch;
+   unsigned end   = i + stage->batch;
+
+   if (end > stage->threads)
+      end = stage->threads;
+
+   for (; i < end; i++)
+      softfilter_work(stage, i);
+}
+
+/**
+ * softfilter_update_batch:
+ * @stage                   : softfilter stage.
+ * @tasks                   : number of tasks the frame ran as.
+ * @usec                    : time the frame took.
+ *
+ * Re-estimates the cost of a packet and picks how many of 
+ * them to run per task next frame. Cheap packets get batched 
+ * up until a task is worth queueing; there are never fewer 
+ * tasks than pool threads, though.
+ **/
+static void softfilter_update_batch(struct rarch_softfilter_stage *stage,
+      unsigned tasks, retro_time_t usec)
+{
+   unsigned workers   = sthread_pool_threads(stage->pool);
+   unsigned max_batch = (stage->threads + workers - 1) / workers;
+   retro_time_t packet_usec;
+   unsigned batch;
+
+   if (workers > tasks)
+      workers = tasks;
+
+   packet_usec = usec * workers / stage->threads;
+   stage->packet_usec = stage->packet_usec ?
+      (stage->packet_usec * 7 + packet_usec) / 8 : packet_usec;
+
+   batch = stage->packet_usec ? 
+      SOFTFILTER_TASK_MIN_USEC / stage->packet_usec + 1 : max_batch;
+
+   if (batch > max_batch)
+      batch = max_batch;
+   if (batch < 1)
+      batch = 1;
+
+   stage->batch = batch;
+}
+#endif
+
+static void softfilter_process_stage(struct rarch_softfilter_stage *stage,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
    unsigned i;
 
-   if (filt && filt->impl && filt->impl->get_work_packets)
-      filt->impl->get_work_packets(filt->impl_data, filt->packets,
+   if (stage->impl && stage->impl->get_work_packets)
+      stage->impl->get_work_packets(stage->impl_data, stage->packets,
             output, output_stride, input, width, height, input_stride);
    
 #ifdef HAVE_THREADS
-   /* Fire off workers */
-   for (i = 0; i < filt->threads; i++)
+   if (stage->pool)
    {
-#if 0
-      RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-      filt->thread_data[i].packet = &filt->packets[i];
-      slock_lock(filt->thread_data[i].lock);
-      filt->thread_data[i].done = false;
-      scond_signal(filt->thread_data[i].cond);
-      slock_unlock(filt->thread_data[i].lock);
+      unsigned tasks     = (stage->threads + stage->batch - 1) / stage->batch;
+      retro_time_t start = rarch_get_time_usec();
+
+      sthread_pool_parallel_for(stage->pool, tasks,
+            softfilter_work_batch, stage);
+
+      softfilter_update_batch(stage, tasks, 
+            rarch_get_time_usec() - start);
+      return;
    }
+#endif
 
-   /* Wait for workers */
-   for (i = 0; i < filt->threads; i++)
+   for (i = 0; i < stage->threads; i++)
+      softfilter_work(stage, i);
+}
+
+/**
+ * softfilter_process_tile:
+ * @filt                    : softfilter handle.
+ * @output                  : frame output.
+ * @output_stride           : pitch of @output.
+ * @input                   : frame input.
+ * @width                   : frame width.
+ * @height                  : frame height.
+ * @input_stride            : pitch of @input.
+ * @y                       : first source row of the tile.
+ * @rows                    : source rows in the tile.
+ *
+ * Runs one tile, along with its halo, through all stages of 
+ * the chain. Only the last stage writes outside the tile buffer, 
+ * and only if there is no halo to cut off.
+ **/
+static void softfilter_process_tile(rarch_softfilter_t *filt,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride,
+      unsigned y, unsigned rows)
+{
+   unsigned i, out_rows, skip_rows;
+   unsigned y_start      = y > filt->tile_halo ? y - filt->tile_halo : 0;
+   unsigned y_end        = y + rows + filt->tile_halo;
+   unsigned out_y        = y;
+   const uint8_t *src    = (const uint8_t*)input;
+   size_t src_stride     = input_stride;
+   uint8_t *dst          = NULL;
+   size_t dst_stride     = 0;
+
+   if (y_end > height)
+      y_end = height;
+
+   src       += y_start * input_stride;
+   out_rows   = rows;
+   skip_rows  = y - y_start;
+   height     = y_end - y_start;
+
+   for (i = 0; i < filt->num_stages; i++)
    {
-#if 0
-      RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-      slock_lock(filt->thread_data[i].lock);
-      while (!filt->thread_data[i].done)
-         scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-      slock_unlock(filt->thread_data[i].lock);
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+      unsigned out_width, out_height;
+
+      stage->impl->query_output_size(stage->impl_data,
+            &out_width, &out_height, width, height);
+
+      if (i + 1 == filt->num_stages && y_start == y && y_end == y + rows)
+      {
+         dst        = (uint8_t*)output + out_y * stage->scale_y * output_stride;
+         dst_stride = output_stride;
+      }
+      else
+      {
+         dst        = filt->tile_buffer + (i & 1) * filt->tile_buffer_half;
+         dst_stride = filt->tile_stride;
+      }
+
+      softfilter_process_stage(stage, dst, dst_stride,
+            src, width, height, src_stride);
+
+      out_y     *= stage->scale_y;
+      out_rows  *= stage->scale_y;
+      skip_rows *= stage->scale_y;
+
+      src        = dst;
+      src_stride = dst_stride;
+      width      = out_width;
+      height     = out_height;
    }
-#else
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
-#endif
+
+   if (dst_stride == output_stride && 
+         dst == (uint8_t*)output + out_y * output_stride)
+      return;
+
+   /* Cut the halo off. */
+   for (i = 0; i < out_rows; i++)
+      memcpy((uint8_t*)output + (out_y + i) * output_stride,
+            dst + (skip_rows + i) * dst_stride,
+            width * softfilter_pixel_size(filt->out_pix_fmt));
 }
 
+void rarch_softfilter_process(rarch_softfilter_t *filt,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned y;
+
+   if (!filt || !filt->num_stages)
+      return;
+
+   if (filt->num_stages == 1)
+   {
+      softfilter_process_stage(&filt->stages[0], output, output_stride,
+            input, width, height, input_stride);
+      return;
+   }
+
+   for (y = 0; y < height; y += filt->tile_rows)
+   {
+      unsigned rows = height - y;
+      if (rows > filt->tile_rows)
+         rows = filt->tile_rows;
+
+      softfilter_process_tile(filt, output, output_stride,
+            input, width, height, input_stride, y, rows);
+   }
+}
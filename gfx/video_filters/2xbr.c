@@ -34,6 +34,7 @@
 */
  
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -63,6 +64,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
    uint16_t RGBtoYUV[65536];
    uint16_t tbl_5_to_8[32];
    uint16_t tbl_6_to_8[64];
@@ -224,7 +226,6 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   (void)simd;
    (void)config;
    (void)userdata;
  
@@ -235,6 +236,7 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = softfilter_simd_kernels(simd);
    if (!filt->workers)
    {
       free(filt);
@@ -560,8 +562,7 @@ static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
    uint32_t pg_lbmask        = PG_LBMASK8888;
    uint32_t pg_alpha_mask    = ALPHA_MASK8888;
    struct filter_data *filt = (struct filter_data*)data;
-
-   (void)filt;
+   softfilter_simd_mask_t simd = filt->simd;
 
    nextline = (last) ? 0 : src_stride;
    
@@ -569,9 +570,26 @@ static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
    {
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
+#ifdef SOFTFILTER_SIMD_KERNELS
+      uint32_t flat[SOFTFILTER_FLAT_WORDS];
+      int use_flat = simd && width <= SOFTFILTER_FLAT_MAX_WIDTH;
+
+      /* Pixels the filter would only repeat are found up front. */
+      if (use_flat)
+         softfilter_flat_cross_xrgb8888(in, nextline, width, flat);
+#endif
  
       for (finish = width; finish; finish -= 1)
       {
+#ifdef SOFTFILTER_SIMD_KERNELS
+         if (use_flat && softfilter_flat_test(flat, width - finish))
+         {
+            out[0] = out[1] = out[dst_stride] = out[dst_stride + 1] = *in;
+            ++in;
+            out += 2;
+            continue;
+         }
+#endif
          uint32_t E[4];
          uint32_t ex, e, i, ke, ki, ex2, ex3, px;
          uint32_t A1 = *(in - nextline - nextline - 1);
@@ -619,6 +637,7 @@ static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
    uint16_t pg_red_mask, pg_green_mask, pg_blue_mask, pg_lbmask;
    unsigned nextline, finish;
    struct filter_data *filt = (struct filter_data*)data;
+   softfilter_simd_mask_t simd = filt->simd;
 
    pg_red_mask   = RED_MASK565;
    pg_green_mask = GREEN_MASK565;
@@ -631,9 +650,26 @@ static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
+#ifdef SOFTFILTER_SIMD_KERNELS
+      uint32_t flat[SOFTFILTER_FLAT_WORDS];
+      int use_flat = simd && width <= SOFTFILTER_FLAT_MAX_WIDTH;
+
+      /* Pixels the filter would only repeat are found up front. */
+      if (use_flat)
+         softfilter_flat_cross_rgb565(in, nextline, width, flat);
+#endif
  
       for (finish = width; finish; finish -= 1)
       {
+#ifdef SOFTFILTER_SIMD_KERNELS
+         if (use_flat && softfilter_flat_test(flat, width - finish))
+         {
+            out[0] = out[1] = out[dst_stride] = out[dst_stride + 1] = *in;
+            ++in;
+            out += 2;
+            continue;
+         }
+#endif
          uint16_t E[4];
          uint16_t ex, e, i, ke, ki, ex2, ex3, px;
          uint16_t A1 = *(in - nextline - nextline - 1);
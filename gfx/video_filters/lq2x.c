@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -43,6 +44,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -66,7 +68,6 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -77,6 +78,7 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = softfilter_simd_kernels(simd);
    if (!filt->workers)
    {
       free(filt);
@@ -104,6 +106,63 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
+/* Blends towards a neighbour that matches one of the 
+ * sides, if the pixel sits on an edge. */
+static inline void lq2x_pixel_rgb565(uint16_t A, uint16_t B,
+      uint16_t C, uint16_t D, uint16_t E,
+      uint16_t *out0, uint16_t *out1)
+{
+   uint16_t c = C;
+
+   if(A != E && B != D)
+   {
+      out0[0] = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out0[1] = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out1[0] = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+      out1[1] = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+   }
+   else
+   {
+      out0[0] = c;
+      out0[1] = c;
+      out1[0] = c;
+      out1[1] = c;
+   }
+}
+
+static inline void lq2x_pixel_xrgb8888(uint32_t A, uint32_t B,
+      uint32_t C, uint32_t D, uint32_t E,
+      uint32_t *out0, uint32_t *out1)
+{
+   uint32_t c = C;
+
+   if(A != E && B != D)
+   {
+      out0[0] = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out0[1] = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out1[0] = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+      out1[1] = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+   }
+   else
+   {
+      out0[0] = c;
+      out0[1] = c;
+      out1[0] = c;
+      out1[1] = c;
+   }
+}
+
+#define lq2x_generic_pixel(pixel_cb) \
+   pixel_cb(*(src - prevline), \
+         (x > 0) ? *(src - 1) : *src, \
+         *src, \
+         (x < width - 1) ? *(src + 1) : *src, \
+         *(src + nextline), \
+         out0, out1); \
+   src++; \
+   out0 += 2; \
+   out1 += 2
+
 static void lq2x_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src, 
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
@@ -121,28 +180,7 @@ static void lq2x_generic_rgb565(unsigned width, unsigned height,
 
       for(x = 0; x < width; x++)
       {
-         uint16_t A, B, C, D, E, c;
-         A = *(src - prevline);
-         B = (x > 0) ? *(src - 1) : *src;
-         C = *src;
-         D = (x < width - 1) ? *(src + 1) : *src;
-         E = *(src++ + nextline);
-         c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_generic_pixel(lq2x_pixel_rgb565);
       }
 
       src += src_stride - width;
@@ -167,27 +205,7 @@ static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
 
       for(x = 0; x < width; x++)
       {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_generic_pixel(lq2x_pixel_xrgb8888);
       }
 
       src += src_stride - width;
@@ -196,8 +214,95 @@ static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
    }
 }
 
+#ifdef SOFTFILTER_SIMD_KERNELS
+/* (C + A - ((C ^ A) & 0x0821)) >> 1 without leaving 16-bit lanes:
+ * with the low bits split off, C + A - mask is always even. */
+static inline sf_vec_t lq2x_blend_rgb565(sf_vec_t C, sf_vec_t A)
+{
+   sf_vec_t mask = sf_and(sf_xor(C, A), sf_dup16(0x0821));
+   sf_vec_t sum  = sf_add16(sf_shr16(C, 1), sf_shr16(A, 1));
+
+   sum = sf_add16(sum, sf_and(sf_and(C, A), sf_dup16(1)));
+   return sf_sub16(sum, sf_shr16(mask, 1));
+}
+
+/* Wraps around just like the scalar 32-bit math. */
+static inline sf_vec_t lq2x_blend_xrgb8888(sf_vec_t C, sf_vec_t A)
+{
+   sf_vec_t mask = sf_and(sf_xor(C, A), sf_dup32(0x0421));
+   return sf_shr32(sf_sub32(sf_add32(C, A), mask), 1);
+}
+
+/* Does the same as lq2x_pixel_*() for a vector of pixels whose 
+ * left and right neighbours are all inside the row. */
+#define lq2x_simd_pixels(type_t, pixels, eq, zip_lo, zip_hi, blend_cb) \
+   { \
+      const type_t *p = src + x; \
+      sf_vec_t A    = sf_load(p - prevline); \
+      sf_vec_t B    = sf_load(p - 1); \
+      sf_vec_t C    = sf_load(p); \
+      sf_vec_t D    = sf_load(p + 1); \
+      sf_vec_t E    = sf_load(p + nextline); \
+      sf_vec_t flat = sf_or(eq(A, E), eq(B, D)); \
+      sf_vec_t CA   = blend_cb(C, A); \
+      sf_vec_t CE   = blend_cb(C, E); \
+      sf_vec_t o0l  = sf_select(sf_bic(eq(A, B), flat), CA, C); \
+      sf_vec_t o0r  = sf_select(sf_bic(eq(A, D), flat), CA, C); \
+      sf_vec_t o1l  = sf_select(sf_bic(eq(E, B), flat), CE, C); \
+      sf_vec_t o1r  = sf_select(sf_bic(eq(E, D), flat), CE, C); \
+      sf_store(out0 + 2 * x, zip_lo(o0l, o0r)); \
+      sf_store(out0 + 2 * x + pixels, zip_hi(o0l, o0r)); \
+      sf_store(out1 + 2 * x, zip_lo(o1l, o1r)); \
+      sf_store(out1 + 2 * x + pixels, zip_hi(o1l, o1r)); \
+   }
+
+#define lq2x_simd_row(type_t, pixels, pixel_cb, eq, zip_lo, zip_hi, blend_cb) \
+   for (y = 0; y < height; y++) \
+   { \
+      int prevline = (y == 0 ? 0 : src_stride); \
+      int nextline = (y == height - 1 || last) ? 0 : src_stride; \
+      type_t *out0 = dst + 2 * y * dst_stride; \
+      type_t *out1 = out0 + dst_stride; \
+      \
+      /* First and last pixels repeat themselves at the edges. */ \
+      for (x = 1; x + pixels < width; x += pixels) \
+         lq2x_simd_pixels(type_t, pixels, eq, zip_lo, zip_hi, blend_cb); \
+      \
+      for (; x < width; x++) \
+         pixel_cb(*(src + x - prevline), *(src + x - 1), src[x], \
+               (x < width - 1) ? src[x + 1] : src[x], \
+               *(src + x + nextline), \
+               out0 + 2 * x, out1 + 2 * x); \
+      \
+      pixel_cb(*(src - prevline), src[0], src[0], \
+            (width > 1) ? src[1] : src[0], *(src + nextline), \
+            out0, out1); \
+      \
+      src += src_stride; \
+   }
+
+static void lq2x_simd_rgb565(unsigned width, unsigned height,
+      int first, int last, uint16_t *src, 
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+   lq2x_simd_row(uint16_t, SF_PIXELS16, lq2x_pixel_rgb565,
+         sf_eq16, sf_zip16_lo, sf_zip16_hi, lq2x_blend_rgb565);
+}
+
+static void lq2x_simd_xrgb8888(unsigned width, unsigned height,
+      int first, int last, uint32_t *src, 
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+   lq2x_simd_row(uint32_t, SF_PIXELS32, lq2x_pixel_xrgb8888,
+         sf_eq32, sf_zip32_lo, sf_zip32_hi, lq2x_blend_xrgb8888);
+}
+#endif
+
 static void lq2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = 
       (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
@@ -205,6 +310,18 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
+#ifdef SOFTFILTER_SIMD_KERNELS
+   if (filt->simd)
+   {
+      lq2x_simd_rgb565(width, height,
+            thr->first, thr->last, input,
+            thr->in_pitch / SOFTFILTER_BPP_RGB565,
+            output,
+            thr->out_pitch / SOFTFILTER_BPP_RGB565);
+      return;
+   }
+#endif
+
    lq2x_generic_rgb565(width, height,
          thr->first, thr->last, input,
          thr->in_pitch / SOFTFILTER_BPP_RGB565,
@@ -214,6 +331,7 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
 
 static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = 
       (struct softfilter_thread_data*)thread_data;
    uint32_t *input = (uint32_t*)thr->in_data;
@@ -221,7 +339,17 @@ static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   (void)data;
+#ifdef SOFTFILTER_SIMD_KERNELS
+   if (filt->simd)
+   {
+      lq2x_simd_xrgb8888(width, height,
+            thr->first, thr->last, input,
+            thr->in_pitch / SOFTFILTER_BPP_XRGB8888,
+            output,
+            thr->out_pitch / SOFTFILTER_BPP_XRGB8888);
+      return;
+   }
+#endif
 
    lq2x_generic_xrgb8888(width, height,
          thr->first, thr->last, input,
@@ -0,0 +1,213 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFTFILTER_SIMD_H__
+#define SOFTFILTER_SIMD_H__
+
+/* Vector helpers shared by the softfilters.
+ *
+ * Only one instruction set is compiled in: SSE2 on x86
+ * builds that enable it (always on x86_64), NEON on ARM builds
+ * that enable it. SOFTFILTER_SIMD_KERNELS is the matching
+ * SOFTFILTER_SIMD_* bit, which filters check against the mask
+ * passed to create() before using any of this.
+ *
+ * The sf_* operations work on 128-bit vectors of either eight
+ * RGB565 or four XRGB8888 pixels. */
+
+#include "softfilter.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTFILTER_SIMD_KERNELS SOFTFILTER_SIMD_SSE2
+
+typedef __m128i sf_vec_t;
+
+#define sf_load(ptr)         _mm_loadu_si128((const __m128i*)(ptr))
+#define sf_store(ptr, v)     _mm_storeu_si128((__m128i*)(ptr), v)
+#define sf_dup16(x)          _mm_set1_epi16((short)(x))
+#define sf_dup32(x)          _mm_set1_epi32((int)(x))
+#define sf_and(a, b)         _mm_and_si128(a, b)
+#define sf_or(a, b)          _mm_or_si128(a, b)
+#define sf_xor(a, b)         _mm_xor_si128(a, b)
+/* a & ~b */
+#define sf_bic(a, b)         _mm_andnot_si128(b, a)
+/* Lanes of a where m is set, lanes of b elsewhere. */
+#define sf_select(m, a, b)   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define sf_eq16(a, b)        _mm_cmpeq_epi16(a, b)
+#define sf_eq32(a, b)        _mm_cmpeq_epi32(a, b)
+#define sf_add16(a, b)       _mm_add_epi16(a, b)
+#define sf_add32(a, b)       _mm_add_epi32(a, b)
+#define sf_sub16(a, b)       _mm_sub_epi16(a, b)
+#define sf_sub32(a, b)       _mm_sub_epi32(a, b)
+#define sf_shr16(a, n)       _mm_srli_epi16(a, n)
+#define sf_shr32(a, n)       _mm_srli_epi32(a, n)
+#define sf_zip16_lo(a, b)    _mm_unpacklo_epi16(a, b)
+#define sf_zip16_hi(a, b)    _mm_unpackhi_epi16(a, b)
+#define sf_zip32_lo(a, b)    _mm_unpacklo_epi32(a, b)
+#define sf_zip32_hi(a, b)    _mm_unpackhi_epi32(a, b)
+
+/* One bit per lane of a compare result. */
+static inline unsigned sf_mask16(sf_vec_t m)
+{
+   return _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128()));
+}
+
+static inline unsigned sf_mask32(sf_vec_t m)
+{
+   return _mm_movemask_ps(_mm_castsi128_ps(m));
+}
+
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOFTFILTER_SIMD_KERNELS SOFTFILTER_SIMD_NEON
+
+typedef uint32x4_t sf_vec_t;
+
+#define SF_U16(v)            vreinterpretq_u16_u32(v)
+#define SF_V16(v)            vreinterpretq_u32_u16(v)
+
+#define sf_load(ptr)         vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)(ptr)))
+#define sf_store(ptr, v)     vst1q_u8((uint8_t*)(ptr), vreinterpretq_u8_u32(v))
+#define sf_dup16(x)          SF_V16(vdupq_n_u16((uint16_t)(x)))
+#define sf_dup32(x)          vdupq_n_u32((uint32_t)(x))
+#define sf_and(a, b)         vandq_u32(a, b)
+#define sf_or(a, b)          vorrq_u32(a, b)
+#define sf_xor(a, b)         veorq_u32(a, b)
+#define sf_bic(a, b)         vbicq_u32(a, b)
+#define sf_select(m, a, b)   vbslq_u32(m, a, b)
+#define sf_eq16(a, b)        SF_V16(vceqq_u16(SF_U16(a), SF_U16(b)))
+#define sf_eq32(a, b)        vceqq_u32(a, b)
+#define sf_add16(a, b)       SF_V16(vaddq_u16(SF_U16(a), SF_U16(b)))
+#define sf_add32(a, b)       vaddq_u32(a, b)
+#define sf_sub16(a, b)       SF_V16(vsubq_u16(SF_U16(a), SF_U16(b)))
+#define sf_sub32(a, b)       vsubq_u32(a, b)
+#define sf_shr16(a, n)       SF_V16(vshrq_n_u16(SF_U16(a), n))
+#define sf_shr32(a, n)       vshrq_n_u32(a, n)
+#define sf_zip16_lo(a, b)    SF_V16(vzipq_u16(SF_U16(a), SF_U16(b)).val[0])
+#define sf_zip16_hi(a, b)    SF_V16(vzipq_u16(SF_U16(a), SF_U16(b)).val[1])
+#define sf_zip32_lo(a, b)    vzipq_u32(a, b).val[0]
+#define sf_zip32_hi(a, b)    vzipq_u32(a, b).val[1]
+
+static inline unsigned sf_mask16(sf_vec_t m)
+{
+   static const uint16_t bits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+   uint16x8_t v = vandq_u16(SF_U16(m), vld1q_u16(bits));
+   uint64x2_t s = vpaddlq_u32(vpaddlq_u16(v));
+   return (unsigned)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+
+static inline unsigned sf_mask32(sf_vec_t m)
+{
+   static const uint32_t bits[4] = { 1, 2, 4, 8 };
+   uint64x2_t s = vpaddlq_u32(vandq_u32(m, vld1q_u32(bits)));
+   return (unsigned)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+#endif
+
+#ifdef SOFTFILTER_SIMD_KERNELS
+#define SF_PIXELS16 8
+#define SF_PIXELS32 4
+
+/* Widest row the flat masks below are kept on the stack for.
+ * Wider frames take the plain C path. */
+#define SOFTFILTER_FLAT_MAX_WIDTH 2048
+#define SOFTFILTER_FLAT_WORDS (SOFTFILTER_FLAT_MAX_WIDTH / 32)
+
+#define softfilter_flat_test(flat, x) (((flat)[(x) >> 5] >> ((x) & 31)) & 1)
+
+/* Row scanners set bit x of @flat when pixel x matches its
+ * neighbours, so the filter would only repeat it. They never
+ * read further right than in[width], like the scalar kernels. */
+
+/* Pixel equals its left, right, upper and lower neighbour. */
+#define SOFTFILTER_FLAT_CROSS(name, type_t, pixels, eq, mask) \
+static inline void name(const type_t *in, int stride, \
+      unsigned width, uint32_t *flat) \
+{ \
+   unsigned x = 0; \
+   memset(flat, 0, ((width + 31) >> 5) * sizeof(uint32_t)); \
+   for (; x + pixels <= width; x += pixels) \
+   { \
+      const type_t *p = in + x; \
+      sf_vec_t c = sf_load(p); \
+      sf_vec_t m = sf_and( \
+            sf_and(eq(c, sf_load(p - 1)), eq(c, sf_load(p + 1))), \
+            sf_and(eq(c, sf_load(p - stride)), eq(c, sf_load(p + stride)))); \
+      flat[x >> 5] |= (uint32_t)mask(m) << (x & 31); \
+   } \
+   for (; x < width; x++) \
+   { \
+      const type_t *p = in + x; \
+      if (p[0] == p[-1] && p[0] == p[1] \
+            && p[0] == p[-stride] && p[0] == p[stride]) \
+         flat[x >> 5] |= 1u << (x & 31); \
+   } \
+}
+
+/* Pixel equals its right, lower and lower right neighbour. */
+#define SOFTFILTER_FLAT_2X2(name, type_t, pixels, eq, mask) \
+static inline void name(const type_t *in, int stride, \
+      unsigned width, uint32_t *flat) \
+{ \
+   unsigned x = 0; \
+   memset(flat, 0, ((width + 31) >> 5) * sizeof(uint32_t)); \
+   for (; x + pixels <= width; x += pixels) \
+   { \
+      const type_t *p = in + x; \
+      sf_vec_t c = sf_load(p); \
+      sf_vec_t m = sf_and( \
+            sf_and(eq(c, sf_load(p + 1)), eq(c, sf_load(p + stride))), \
+            eq(c, sf_load(p + stride + 1))); \
+      flat[x >> 5] |= (uint32_t)mask(m) << (x & 31); \
+   } \
+   for (; x < width; x++) \
+   { \
+      const type_t *p = in + x; \
+      if (p[0] == p[1] && p[0] == p[stride] && p[0] == p[stride + 1]) \
+         flat[x >> 5] |= 1u << (x & 31); \
+   } \
+}
+
+SOFTFILTER_FLAT_CROSS(softfilter_flat_cross_rgb565, uint16_t,
+      SF_PIXELS16, sf_eq16, sf_mask16)
+SOFTFILTER_FLAT_CROSS(softfilter_flat_cross_xrgb8888, uint32_t,
+      SF_PIXELS32, sf_eq32, sf_mask32)
+SOFTFILTER_FLAT_2X2(softfilter_flat_2x2_rgb565, uint16_t,
+      SF_PIXELS16, sf_eq16, sf_mask16)
+SOFTFILTER_FLAT_2X2(softfilter_flat_2x2_xrgb8888, uint32_t,
+      SF_PIXELS32, sf_eq32, sf_mask32)
+#endif
+
+/**
+ * softfilter_simd_kernels:
+ * @simd                    : SIMD mask passed to create().
+ *
+ * Returns: the SOFTFILTER_SIMD_* bit the vector kernels were
+ * built for if the CPU has it, otherwise 0.
+ **/
+static inline softfilter_simd_mask_t softfilter_simd_kernels(
+      softfilter_simd_mask_t simd)
+{
+#ifdef SOFTFILTER_SIMD_KERNELS
+   return simd & SOFTFILTER_SIMD_KERNELS;
+#else
+   (void)simd;
+   return 0;
+#endif
+}
+
+#endif
@@ -17,6 +17,7 @@
 // Compile: gcc -o supertwoxsai.so -shared supertwoxsai.c -std=c99 -O3 -Wall -pedantic -fPIC
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -45,6 +46,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned supertwoxsai_generic_input_fmts(void)
@@ -68,7 +70,6 @@ static void *supertwoxsai_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -78,6 +79,7 @@ static void *supertwoxsai_generic_create(const struct softfilter_config *config,
    filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = softfilter_simd_kernels(simd);
    if (!filt->workers)
    {
       free(filt);
@@ -200,7 +202,8 @@ static void supertwoxsai_generic_destroy(void *data)
 
 static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
       int first, int last, uint32_t *src, 
-      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride,
+      softfilter_simd_mask_t simd)
 {
    unsigned nextline, finish;
    nextline = (last) ? 0 : src_stride;
@@ -209,9 +212,26 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
    {
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
+#ifdef SOFTFILTER_SIMD_KERNELS
+      uint32_t flat[SOFTFILTER_FLAT_WORDS];
+      int use_flat = simd && width <= SOFTFILTER_FLAT_MAX_WIDTH;
+
+      /* Pixels the filter would only repeat are found up front. */
+      if (use_flat)
+         softfilter_flat_2x2_xrgb8888(in, nextline, width, flat);
+#endif
 
       for (finish = width; finish; finish -= 1)
       {
+#ifdef SOFTFILTER_SIMD_KERNELS
+         if (use_flat && softfilter_flat_test(flat, width - finish))
+         {
+            out[0] = out[1] = out[dst_stride] = out[dst_stride + 1] = *in;
+            ++in;
+            out += 2;
+            continue;
+         }
+#endif
          supertwoxsai_declare_variables(uint32_t, in, nextline);
 
          //---------------------------    B1 B2
@@ -230,7 +250,8 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
 
 static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src, 
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride,
+      softfilter_simd_mask_t simd)
 {
    unsigned nextline, finish;
    nextline = (last) ? 0 : src_stride;
@@ -239,9 +260,26 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
+#ifdef SOFTFILTER_SIMD_KERNELS
+      uint32_t flat[SOFTFILTER_FLAT_WORDS];
+      int use_flat = simd && width <= SOFTFILTER_FLAT_MAX_WIDTH;
+
+      /* Pixels the filter would only repeat are found up front. */
+      if (use_flat)
+         softfilter_flat_2x2_rgb565(in, nextline, width, flat);
+#endif
 
       for (finish = width; finish; finish -= 1)
       {
+#ifdef SOFTFILTER_SIMD_KERNELS
+         if (use_flat && softfilter_flat_test(flat, width - finish))
+         {
+            out[0] = out[1] = out[dst_stride] = out[dst_stride + 1] = *in;
+            ++in;
+            out += 2;
+            continue;
+         }
+#endif
          supertwoxsai_declare_variables(uint16_t, in, nextline);
 
          //---------------------------    B1 B2
@@ -260,6 +298,7 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
 
 static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
    uint16_t *output = (uint16_t*)thr->out_data;
@@ -267,11 +306,13 @@ static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supertwoxsai_generic_rgb565(width, height,
-         thr->first, thr->last, input, thr->in_pitch / SOFTFILTER_BPP_RGB565, output, thr->out_pitch / SOFTFILTER_BPP_RGB565);
+         thr->first, thr->last, input, thr->in_pitch / SOFTFILTER_BPP_RGB565, output, thr->out_pitch / SOFTFILTER_BPP_RGB565,
+         filt->simd);
 }
 
 static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    uint32_t *input = (uint32_t*)thr->in_data;
    uint32_t *output = (uint32_t*)thr->out_data;
@@ -279,7 +320,8 @@ static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supertwoxsai_generic_xrgb8888(width, height,
-         thr->first, thr->last, input, thr->in_pitch / SOFTFILTER_BPP_XRGB8888, output, thr->out_pitch / SOFTFILTER_BPP_XRGB8888);
+         thr->first, thr->last, input, thr->in_pitch / SOFTFILTER_BPP_XRGB8888, output, thr->out_pitch / SOFTFILTER_BPP_XRGB8888,
+         filt->simd);
 }
 
 static void supertwoxsai_generic_packets(void *data,
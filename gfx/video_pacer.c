@@ -0,0 +1,253 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video_pacer.h"
+#include <math.h>
+#include <string.h>
+#include "../general.h"
+#include "../driver.h"
+#include "../performance.h"
+#include <retro_miscellaneous.h>
+
+/* Vblank intervals per refresh rate estimate. */
+#define PACER_SAMPLES 256
+
+/* Frames per automatic frame delay decision. */
+#define PACER_WINDOW 64
+
+/* Time to keep between the core finishing and vblank, 
+ * to absorb jitter of the core and of the GPU. */
+#define PACER_SLACK_MARGIN_USEC 2000
+
+/* Maximum that video_frame_delay allows. */
+#define PACER_MAX_FRAME_DELAY 15
+
+/* How close to a VRR deadline sleeping stops and spinning 
+ * takes over, as sleeps overshoot by about a millisecond. */
+#define PACER_VRR_SPIN_USEC 1500
+
+static struct
+{
+   retro_time_t submit_time;
+
+   retro_time_t driver_time;
+   uint64_t driver_msc;
+   bool has_driver_time;
+
+   retro_time_t last_time;
+   uint64_t last_msc;
+
+   double samples[PACER_SAMPLES];
+   unsigned num_samples;
+   float refresh_rate;
+
+   retro_time_t window_min_slack;
+   unsigned window_frames;
+   unsigned window_missed;
+   unsigned frame_delay;
+
+   /* Frames are due at vrr_anchor + vrr_frames / vrr_fps,
+    * counted from the anchor so the rate never drifts. */
+   retro_time_t vrr_anchor;
+   uint64_t vrr_frames;
+   double vrr_fps;
+} pacer;
+
+void video_pacer_reset(void)
+{
+   unsigned frame_delay = pacer.frame_delay;
+
+   memset(&pacer, 0, sizeof(pacer));
+
+   /* A delay that worked before a driver reinit is a good start. */
+   pacer.frame_delay = frame_delay;
+}
+
+void video_pacer_set_present_time(retro_time_t usec, uint64_t msc)
+{
+   pacer.driver_time     = usec;
+   pacer.driver_msc      = msc;
+   pacer.has_driver_time = true;
+}
+
+void video_pacer_frame_submit(void)
+{
+   pacer.submit_time = rarch_get_time_usec();
+}
+
+void video_pacer_vrr_wait(double fps)
+{
+   retro_time_t deadline;
+   retro_time_t now = rarch_get_time_usec();
+
+   if (fps <= 0.0)
+      return;
+
+   if (fps != pacer.vrr_fps || !pacer.vrr_anchor)
+   {
+      pacer.vrr_anchor = now;
+      pacer.vrr_frames = 0;
+      pacer.vrr_fps    = fps;
+      return;
+   }
+
+   deadline = pacer.vrr_anchor +
+      (retro_time_t)(++pacer.vrr_frames * 1000000.0 / fps);
+
+   /* More than a frame late, e.g. after loading. Start over 
+    * instead of rushing frames out to catch up. */
+   if (now > deadline + (retro_time_t)(1000000.0 / fps))
+   {
+      pacer.vrr_anchor = now;
+      pacer.vrr_frames = 0;
+      return;
+   }
+
+   if (deadline - now > PACER_VRR_SPIN_USEC)
+      rarch_sleep((deadline - now - PACER_VRR_SPIN_USEC) / 1000 + 1);
+
+   while (rarch_get_time_usec() < deadline);
+}
+
+static void video_pacer_update_refresh_rate(void)
+{
+   unsigned i;
+   double hz, mean = 0.0, dev = 0.0;
+
+   for (i = 0; i < PACER_SAMPLES; i++)
+      mean += pacer.samples[i];
+   mean /= PACER_SAMPLES;
+
+   for (i = 0; i < PACER_SAMPLES; i++)
+      dev += (pacer.samples[i] - mean) * (pacer.samples[i] - mean);
+   dev = sqrt(dev / PACER_SAMPLES) / mean;
+
+   pacer.num_samples = 0;
+
+   /* Too noisy to trust, likely not really vsynced. */
+   if (dev > 0.01)
+      return;
+
+   hz = 1000000.0 / mean;
+   pacer.refresh_rate = hz;
+
+   if (!g_settings.video.refresh_rate_track)
+      return;
+
+   if (fabs(1.0 - hz / g_settings.video.refresh_rate) < 0.0005)
+      return;
+
+   RARCH_LOG("Measured display refresh rate: %.4f Hz (%.3f %% deviation).\n",
+         hz, 100.0 * dev);
+   driver_set_monitor_refresh_rate(hz);
+}
+
+static void video_pacer_update_frame_delay(void)
+{
+   unsigned delay   = pacer.frame_delay;
+   double period    = 1000000.0 / g_settings.video.refresh_rate;
+
+   if (pacer.window_missed)
+      delay = delay > 2 ? delay - 2 : 0;
+   else if (pacer.window_min_slack > PACER_SLACK_MARGIN_USEC + 1000
+         && delay < PACER_MAX_FRAME_DELAY
+         && (delay + 1) * 1000 + PACER_SLACK_MARGIN_USEC < period)
+      delay++;
+   else if (pacer.window_min_slack < PACER_SLACK_MARGIN_USEC && delay)
+      delay--;
+
+   if (delay != pacer.frame_delay)
+      RARCH_LOG("Automatic frame delay: %u ms (%u missed vblanks, %d usec minimum slack).\n",
+            delay, pacer.window_missed, (int)pacer.window_min_slack);
+
+   pacer.frame_delay      = delay;
+   pacer.window_frames    = 0;
+   pacer.window_missed    = 0;
+   pacer.window_min_slack = 0;
+}
+
+void video_pacer_frame_presented(void)
+{
+   retro_time_t now, slack;
+   uint64_t msc;
+   double period;
+   unsigned interval    = max(g_settings.video.swap_interval, 1);
+   bool has_driver_time = pacer.has_driver_time;
+
+   pacer.has_driver_time = false;
+
+   /* Not paced by the display, or frame() returns before presenting. */
+   if (g_settings.video.threaded || driver.nonblock_state
+         || !g_settings.video.vsync || g_extern.is_paused
+         || g_extern.is_menu || g_settings.video.refresh_rate <= 0.0f)
+   {
+      pacer.last_time = 0;
+      return;
+   }
+
+   now    = has_driver_time ? pacer.driver_time : rarch_get_time_usec();
+   msc    = has_driver_time ? pacer.driver_msc : 0;
+   period = 1000000.0 / g_settings.video.refresh_rate;
+
+   if (pacer.last_time && now > pacer.last_time)
+   {
+      double   delta   = (double)(now - pacer.last_time);
+      unsigned vblanks = (unsigned)(delta / period + 0.5);
+
+      /* A real vblank counter makes every interval usable,
+       * otherwise only those that look like one swap. */
+      if (msc && pacer.last_msc && msc > pacer.last_msc)
+         vblanks = msc - pacer.last_msc;
+
+      if (vblanks > interval)
+         pacer.window_missed++;
+
+      if (vblanks && (msc || vblanks == interval))
+      {
+         double sample = delta / vblanks;
+
+         if (sample > 0.5 * period && sample < 1.5 * period)
+         {
+            pacer.samples[pacer.num_samples++] = sample;
+            if (pacer.num_samples == PACER_SAMPLES)
+               video_pacer_update_refresh_rate();
+         }
+      }
+   }
+
+   pacer.last_time = now;
+   pacer.last_msc  = msc;
+
+   if (!g_settings.video.frame_delay_auto || !pacer.submit_time)
+      return;
+
+   slack = now - pacer.submit_time;
+   if (!pacer.window_frames || slack < pacer.window_min_slack)
+      pacer.window_min_slack = slack;
+
+   if (++pacer.window_frames == PACER_WINDOW)
+      video_pacer_update_frame_delay();
+}
+
+float video_pacer_get_refresh_rate(void)
+{
+   return pacer.refresh_rate;
+}
+
+unsigned video_pacer_get_frame_delay(void)
+{
+   return pacer.frame_delay;
+}
@@ -0,0 +1,94 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_PACER_H
+#define __VIDEO_PACER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <boolean.h>
+#include "../libretro.h"
+
+/**
+ * video_pacer_reset:
+ *
+ * Drops all swap timing history. Called whenever the
+ * video driver is (re)initialized.
+ **/
+void video_pacer_reset(void);
+
+/**
+ * video_pacer_set_present_time:
+ * @usec                 : Time the last frame reached the display,
+ *                         in rarch_get_time_usec() time base.
+ * @msc                  : Vblank counter at @usec, or 0 if unknown.
+ *
+ * Lets a video driver report the real present time of the last
+ * frame, such as from GLX_OML_sync_control. Without it, the time
+ * video_driver_t::frame returned is used instead.
+ **/
+void video_pacer_set_present_time(retro_time_t usec, uint64_t msc);
+
+/**
+ * video_pacer_frame_submit:
+ *
+ * Marks that the core is done with a frame and it is being
+ * handed to the video driver.
+ **/
+void video_pacer_frame_submit(void);
+
+/**
+ * video_pacer_vrr_wait:
+ * @fps                  : rate of the core.
+ *
+ * Waits until the next frame is due at @fps. With variable
+ * refresh, the display refreshes when a frame is presented,
+ * so this sets the refresh rate to exactly that of the core.
+ **/
+void video_pacer_vrr_wait(double fps);
+
+/**
+ * video_pacer_frame_presented:
+ *
+ * Marks that video_driver_t::frame returned. Updates the refresh
+ * rate estimate, and the automatic frame delay once per window.
+ **/
+void video_pacer_frame_presented(void);
+
+/**
+ * video_pacer_get_refresh_rate:
+ *
+ * Returns: display refresh rate measured from swap timing,
+ * or 0.0 if there is no stable estimate yet.
+ **/
+float video_pacer_get_refresh_rate(void);
+
+/**
+ * video_pacer_get_frame_delay:
+ *
+ * Returns: frame delay in milliseconds that leaves the core just
+ * enough time to finish before vblank, for video_frame_delay_auto.
+ **/
+unsigned video_pacer_get_frame_delay(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -72,6 +72,43 @@ static enum gfx_wrap_type wrap_str_to_mode(const char *wrap_mode)
    return RARCH_WRAP_DEFAULT;
 }
 
+/** 
+ * gfx_shader_fbo_format_to_str:
+ * @format            : FBO format.
+ *
+ * Returns: preset string identifier of FBO format.
+ **/
+const char *gfx_shader_fbo_format_to_str(enum gfx_fbo_format format)
+{
+   switch (format)
+   {
+      case RARCH_FBO_FORMAT_RGB565:
+         return "RGB565";
+      case RARCH_FBO_FORMAT_RGBA4444:
+         return "RGBA4444";
+      case RARCH_FBO_FORMAT_RGB10_A2:
+         return "RGB10_A2";
+      default:
+         return "RGBA8";
+   }
+}
+
+static enum gfx_fbo_format fbo_str_to_format(const char *format)
+{
+   if (strcmp(format, "RGBA8") == 0)
+      return RARCH_FBO_FORMAT_DEFAULT;
+   else if (strcmp(format, "RGB565") == 0)
+      return RARCH_FBO_FORMAT_RGB565;
+   else if (strcmp(format, "RGBA4444") == 0)
+      return RARCH_FBO_FORMAT_RGBA4444;
+   else if (strcmp(format, "RGB10_A2") == 0)
+      return RARCH_FBO_FORMAT_RGB10_A2;
+
+   RARCH_WARN("Invalid framebuffer format %s. Valid ones are: RGBA8 (default), RGB565, RGBA4444 and RGB10_A2. Falling back to default.\n",
+         format);
+   return RARCH_FBO_FORMAT_DEFAULT;
+}
+
 /** 
  * shader_parse_pass:
  * @conf              : Preset file to read from.
@@ -86,6 +123,7 @@ static bool shader_parse_pass(config_file_t *conf, struct gfx_shader_pass *pass,
 {
    char shader_name[64], filter_name_buf[64], wrap_name_buf[64], wrap_mode[64];
    char frame_count_mod_buf[64], srgb_output_buf[64], fp_fbo_buf[64];
+   char fbo_format_buf[64], fbo_format[64];
    char mipmap_buf[64], alias_buf[64], scale_name_buf[64], attr_name_buf[64];
    char scale_type[64] = {0};
    char scale_type_x[64] = {0};
@@ -129,6 +167,10 @@ static bool shader_parse_pass(config_file_t *conf, struct gfx_shader_pass *pass,
    snprintf(fp_fbo_buf, sizeof(fp_fbo_buf), "float_framebuffer%u", i);
    config_get_bool(conf, fp_fbo_buf, &pass->fbo.fp_fbo);
 
+   snprintf(fbo_format_buf, sizeof(fbo_format_buf), "framebuffer_format%u", i);
+   if (config_get_array(conf, fbo_format_buf, fbo_format, sizeof(fbo_format)))
+      pass->fbo.format = fbo_str_to_format(fbo_format);
+
    snprintf(mipmap_buf, sizeof(mipmap_buf), "mipmap_input%u", i);
    config_get_bool(conf, mipmap_buf, &pass->mipmap);
 
@@ -554,6 +596,8 @@ bool gfx_shader_read_conf_cgp(config_file_t *conf, struct gfx_shader *shader)
       return false;
    }
 
+   config_get_bool(conf, "time_dependent", &shader->time_dependent);
+
    shader->passes = min(shaders, GFX_MAX_SHADERS);
    for (i = 0; i < shader->passes; i++)
    {
@@ -610,6 +654,11 @@ static void shader_write_fbo(config_file_t *conf,
    config_set_bool(conf, key, fbo->fp_fbo);
    snprintf(key, sizeof(key), "srgb_framebuffer%u", i);
    config_set_bool(conf, key, fbo->srgb_fbo);
+   if (fbo->format != RARCH_FBO_FORMAT_DEFAULT)
+   {
+      snprintf(key, sizeof(key), "framebuffer_format%u", i);
+      config_set_string(conf, key, gfx_shader_fbo_format_to_str(fbo->format));
+   }
 
    if (!fbo->valid)
       return;
@@ -706,6 +755,8 @@ void gfx_shader_write_conf_cgp(config_file_t *conf,
    unsigned i;
 
    config_set_int(conf, "shaders", shader->passes);
+   if (shader->time_dependent)
+      config_set_bool(conf, "time_dependent", true);
 
    for (i = 0; i < shader->passes; i++)
    {
@@ -74,6 +74,16 @@ enum gfx_wrap_type
    RARCH_WRAP_MIRRORED_REPEAT
 };
 
+/* Storage of a pass' FBO. The packed formats halve (or keep
+ * at 32-bit, for RGB10_A2) what a pass writes and reads back. */
+enum gfx_fbo_format
+{
+   RARCH_FBO_FORMAT_DEFAULT = 0,
+   RARCH_FBO_FORMAT_RGB565,
+   RARCH_FBO_FORMAT_RGBA4444,
+   RARCH_FBO_FORMAT_RGB10_A2
+};
+
 struct gfx_fbo_scale
 {
    enum gfx_scale_type type_x;
@@ -84,6 +94,7 @@ struct gfx_fbo_scale
    unsigned abs_y;
    bool fp_fbo;
    bool srgb_fbo;
+   enum gfx_fbo_format format;
    bool valid;
 };
 
@@ -136,6 +147,10 @@ struct gfx_shader
    bool modern; /* Only used for XML shaders. */
    char prefix[64];
 
+   /* Output changes from frame to frame even when the
+    * input does not, so dupes have to run the chain. */
+   bool time_dependent;
+
    unsigned passes;
    struct gfx_shader_pass pass[GFX_MAX_SHADERS];
 
@@ -176,6 +191,15 @@ bool gfx_shader_read_conf_cgp(config_file_t *conf,
 void gfx_shader_write_conf_cgp(config_file_t *conf,
       struct gfx_shader *shader);
 
+/**
+ * gfx_shader_fbo_format_to_str:
+ * @format            : FBO format.
+ *
+ * Returns: preset string identifier of FBO format,
+ * e.g. "RGB565".
+ **/
+const char *gfx_shader_fbo_format_to_str(enum gfx_fbo_format format);
+
 /**
  * gfx_shader_resolve_relative:
  * @shader            : Shader pass handle.
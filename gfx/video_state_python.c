@@ -15,6 +15,7 @@
  */
 
 #include <Python.h>
+#include <marshal.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
@@ -27,63 +28,94 @@
 #include <compat/posix_string.h>
 #include "../input/input_common.h"
 #include "../file_ops.h"
+#include "../hash.h"
 
-static PyObject* py_read_wram(PyObject *self, PyObject *args)
-{
-   unsigned addr;
-   size_t   max;
-   const uint8_t *data = (const uint8_t*)
-      pretro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+/* Reads the script made during the last evaluation, so the 
+ * results can be reused while none of them change. */
+#define PY_READ_LOG_SIZE 256
 
-   (void)self;
+enum py_read_kind
+{
+   PY_READ_WRAM = 0,
+   PY_READ_VRAM,
+   PY_READ_INPUT,
+   PY_READ_ANALOG
+};
 
-   if (!data)
-   {
-      Py_INCREF(Py_None);
-      return Py_None;
-   }
+struct py_read
+{
+   enum py_read_kind kind;
+   unsigned args[3];
+   int32_t value;
+};
 
-   max = pretro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+static struct py_read py_read_log[PY_READ_LOG_SIZE];
+static unsigned py_read_log_count;
+static bool py_read_log_active;
+static bool py_read_log_overflow;
 
-   if (!PyArg_ParseTuple(args, "I", &addr))
-      return NULL;
+/* -1 if there is nothing to read. */
+static int32_t py_read_memory(unsigned id, unsigned addr)
+{
+   const uint8_t *data = (const uint8_t*)pretro_get_memory_data(id);
 
-   if (addr >= max)
-   {
-      Py_INCREF(Py_None);
-      return Py_None;
-   }
+   if (!data || addr >= pretro_get_memory_size(id))
+      return -1;
 
-   return PyLong_FromLong(data[addr]);
+   return data[addr];
 }
 
-static PyObject* py_read_vram(PyObject *self, PyObject *args)
+static void py_read_log_add(enum py_read_kind kind,
+      const unsigned *args, int32_t value)
 {
-   unsigned addr;
-   size_t max;
-   const uint8_t *data = (const uint8_t*)
-      pretro_get_memory_data(RETRO_MEMORY_VIDEO_RAM);
+   struct py_read *read = NULL;
 
-   (void)self;
+   if (!py_read_log_active)
+      return;
 
-   if (!data)
+   if (py_read_log_count >= PY_READ_LOG_SIZE)
    {
-      Py_INCREF(Py_None);
-      return Py_None;
+      py_read_log_overflow = true;
+      return;
    }
 
-   max = pretro_get_memory_size(RETRO_MEMORY_VIDEO_RAM);
+   read        = &py_read_log[py_read_log_count++];
+   read->kind  = kind;
+   read->value = value;
+   memcpy(read->args, args, sizeof(read->args));
+}
+
+static PyObject *py_read_ram(PyObject *args, enum py_read_kind kind)
+{
+   int32_t value;
+   unsigned read_args[3] = {0};
 
-   if (!PyArg_ParseTuple(args, "I", &addr))
+   if (!PyArg_ParseTuple(args, "I", &read_args[0]))
       return NULL;
 
-   if (addr >= max)
+   value = py_read_memory(kind == PY_READ_WRAM ?
+         RETRO_MEMORY_SYSTEM_RAM : RETRO_MEMORY_VIDEO_RAM, read_args[0]);
+   py_read_log_add(kind, read_args, value);
+
+   if (value < 0)
    {
       Py_INCREF(Py_None);
       return Py_None;
    }
 
-   return PyLong_FromLong(data[addr]);
+   return PyLong_FromLong(value);
+}
+
+static PyObject* py_read_wram(PyObject *self, PyObject *args)
+{
+   (void)self;
+   return py_read_ram(args, PY_READ_WRAM);
+}
+
+static PyObject* py_read_vram(PyObject *self, PyObject *args)
+{
+   (void)self;
+   return py_read_ram(args, PY_READ_VRAM);
 }
 
 static const struct retro_keybind *py_binds[MAX_USERS] = {
@@ -105,49 +137,103 @@ static const struct retro_keybind *py_binds[MAX_USERS] = {
    g_settings.input.binds[15],
 };
 
+static int32_t py_read_input_value(enum py_read_kind kind,
+      const unsigned *args)
+{
+   if (!driver.input_data)
+      return 0;
+
+   if (kind == PY_READ_INPUT)
+   {
+      if (driver.block_libretro_input)
+         return 0;
+
+      return driver.input->input_state(driver.input_data,
+            py_binds, args[0] - 1, RETRO_DEVICE_JOYPAD, 0, args[1]);
+   }
+
+   return driver.input->input_state(driver.input_data,
+         py_binds, args[0] - 1, RETRO_DEVICE_ANALOG, args[1], args[2]);
+}
+
 static PyObject *py_read_input(PyObject *self, PyObject *args)
 {
-   unsigned user, key;
-   int16_t res = 0;
+   int32_t res;
+   unsigned read_args[3] = {0};
    
    (void)self;
 
    if (!driver.input_data)
       return PyBool_FromLong(0);
 
-   if (!PyArg_ParseTuple(args, "II", &user, &key))
+   if (!PyArg_ParseTuple(args, "II", &read_args[0], &read_args[1]))
       return NULL;
 
-   if (user > MAX_USERS || user < 1 || key >= RARCH_FIRST_META_KEY)
+   if (read_args[0] > MAX_USERS || read_args[0] < 1 ||
+         read_args[1] >= RARCH_FIRST_META_KEY)
       return NULL;
 
-   if (!driver.block_libretro_input)
-      res = driver.input->input_state(driver.input_data,
-            py_binds, user - 1, RETRO_DEVICE_JOYPAD, 0, key);
+   res = py_read_input_value(PY_READ_INPUT, read_args);
+   py_read_log_add(PY_READ_INPUT, read_args, res);
    return PyBool_FromLong(res);
 }
 
 static PyObject *py_read_analog(PyObject *self, PyObject *args)
 {
-   unsigned user, index, id;
-   int16_t res = 0;
+   int32_t res;
+   unsigned read_args[3] = {0};
 
    (void)self;
 
    if (!driver.input_data)
       return PyBool_FromLong(0);
 
-   if (!PyArg_ParseTuple(args, "III", &user, &index, &id))
+   if (!PyArg_ParseTuple(args, "III",
+            &read_args[0], &read_args[1], &read_args[2]))
       return NULL;
 
-   if (user > MAX_USERS || user < 1 || index > 1 || id > 1)
+   if (read_args[0] > MAX_USERS || read_args[0] < 1 ||
+         read_args[1] > 1 || read_args[2] > 1)
       return NULL;
 
-   res = driver.input->input_state(driver.input_data,
-         py_binds, user - 1, RETRO_DEVICE_ANALOG, index, id);
+   res = py_read_input_value(PY_READ_ANALOG, read_args);
+   py_read_log_add(PY_READ_ANALOG, read_args, res);
    return PyFloat_FromDouble((double)res / 0x7fff);
 }
 
+/* True if everything the script read last time reads the same. */
+static bool py_read_log_unchanged(void)
+{
+   unsigned i;
+
+   if (py_read_log_overflow)
+      return false;
+
+   for (i = 0; i < py_read_log_count; i++)
+   {
+      const struct py_read *read = &py_read_log[i];
+      int32_t value;
+
+      switch (read->kind)
+      {
+         case PY_READ_WRAM:
+            value = py_read_memory(RETRO_MEMORY_SYSTEM_RAM, read->args[0]);
+            break;
+         case PY_READ_VRAM:
+            value = py_read_memory(RETRO_MEMORY_VIDEO_RAM, read->args[0]);
+            break;
+         default:
+            value = py_read_input_value(read->kind, read->args);
+            break;
+      }
+
+      if (value != read->value)
+         return false;
+   }
+
+   return true;
+}
+
 static PyMethodDef RarchMethods[] = {
    { "read_wram",    py_read_wram,   METH_VARARGS, "Read WRAM from system." },
    { "read_vram",    py_read_vram,   METH_VARARGS, "Read VRAM from system." },
@@ -201,12 +287,37 @@ static PyObject* PyInit_Retro(void)
    return mod;
 }
 
+#define PY_STATE_MAX_UNIFORMS 64
+
+/* Calls every uniform method in one go, so the interpreter
+ * is entered once per frame rather than once per uniform. */
+static const char py_batch_script[] =
+   "def batch(methods, frame_count):\n"
+   "   return tuple([m(frame_count) for m in methods])\n";
+
+/* Compiled scripts are cached next to them as <script>.rpyc:
+ * this header, then the marshalled code object. */
+#define PY_CACHE_MAGIC 0x43505952 /* "RYPC" */
+
 struct py_state
 {
    PyObject *main;
    PyObject *dict;
    PyObject *inst;
+   PyObject *batch;
+   /* Bound methods of inst, in uniform order. */
+   PyObject *methods;
+
+   char ids[PY_STATE_MAX_UNIFORMS][64];
+   float values[PY_STATE_MAX_UNIFORMS];
+   unsigned num_uniforms;
+   bool has_values;
 
+   /* Set by the script class with cache_results = True, for 
+    * scripts whose results only depend on what they read. */
+   bool cache;
+
+   bool bind_failed;
    bool warned_ret;
    bool warned_type;
 };
@@ -273,6 +384,85 @@ static char *align_program(const char *program)
    return new_prog;
 }
 
+/**
+ * py_state_compile_file:
+ * @path                 : path to the script.
+ *
+ * Compiles the script at @path, or loads it from its bytecode
+ * cache if the cache was made from the same source by the same
+ * Python version.
+ *
+ * Returns: code object, or NULL on error.
+ **/
+static PyObject *py_state_compile_file(const char *path)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   uint32_t header[3];
+   char *source     = NULL;
+   void *cache      = NULL;
+   PyObject *code   = NULL;
+   long cache_len   = 0;
+   long len         = read_file(path, (void**)&source);
+
+   if (len < 0)
+   {
+      RARCH_ERR("Python: Failed to read script\n");
+      return NULL;
+   }
+
+   header[0] = PY_CACHE_MAGIC;
+   header[1] = (uint32_t)PyImport_GetMagicNumber();
+   header[2] = crc32_calculate((const uint8_t*)source, len);
+
+   snprintf(cache_path, sizeof(cache_path), "%s.rpyc", path);
+   cache_len = read_file(cache_path, &cache);
+
+   if (cache_len > (long)sizeof(header) &&
+         memcmp(cache, header, sizeof(header)) == 0)
+   {
+      code = PyMarshal_ReadObjectFromString((char*)cache + sizeof(header),
+            cache_len - sizeof(header));
+      if (!code)
+         PyErr_Clear();
+   }
+   free(cache);
+
+   if (!code)
+   {
+      PyObject *data = NULL;
+
+      code = Py_CompileString(source, path, Py_file_input);
+      if (code)
+         data = PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION);
+
+      if (data)
+      {
+         size_t size = sizeof(header) + PyBytes_GET_SIZE(data);
+         uint8_t *buf = (uint8_t*)malloc(size);
+
+         /* Not being able to write it next to the script is fine. */
+         if (buf)
+         {
+            memcpy(buf, header, sizeof(header));
+            memcpy(buf + sizeof(header), PyBytes_AS_STRING(data),
+                  PyBytes_GET_SIZE(data));
+            if (write_file(cache_path, buf, size))
+               RARCH_LOG("Python: Cached bytecode to \"%s\".\n",
+                     cache_path);
+            free(buf);
+         }
+         Py_DECREF(data);
+      }
+      else if (code)
+         PyErr_Clear();
+   }
+   else
+      RARCH_LOG("Python: Loaded bytecode from \"%s\".\n", cache_path);
+
+   free(source);
+   return code;
+}
+
 py_state_t *py_state_new(const char *script,
       unsigned is_file, const char *pyclass)
 {
@@ -282,29 +472,42 @@ py_state_t *py_state_new(const char *script,
    RARCH_LOG("Initialized Python runtime.\n");
 
    py_state_t *handle = (py_state_t*)calloc(1, sizeof(*handle));
-   PyObject *hook = NULL;
+   PyObject *hook = NULL, *cache = NULL, *batch_dict = NULL;
 
    handle->main = PyImport_AddModule("__main__");
    if (!handle->main)
       goto error;
    Py_INCREF(handle->main);
 
+   handle->dict = PyModule_GetDict(handle->main);
+   if (!handle->dict)
+   {
+      RARCH_ERR("Python: PyModule_GetDict() failed.\n");
+      goto error;
+   }
+   Py_INCREF(handle->dict);
+
    if (is_file)
    {
       /* Have to hack around the fact that the FILE struct
        * isn't standardized across environments.
        * PyRun_SimpleFile() breaks on Windows because it's 
        * compiled with MSVC. */
+      PyObject *ret  = NULL;
+      PyObject *code = py_state_compile_file(script);
 
-      char *script_ = NULL;
-      if (read_file(script, (void**)&script_) < 0)
-      {
-         RARCH_ERR("Python: Failed to read script\n");
+      if (!code)
          goto error;
-      }
 
-      PyRun_SimpleString(script_);
-      free(script_);
+      ret = PyEval_EvalCode(code, handle->dict, handle->dict);
+      Py_DECREF(code);
+
+      if (!ret)
+      {
+         PyErr_Print();
+         PyErr_Clear();
+      }
+      Py_XDECREF(ret);
    }
    else
    {
@@ -317,13 +520,6 @@ py_state_t *py_state_new(const char *script,
    }
 
    RARCH_LOG("Python: Script loaded.\n");
-   handle->dict = PyModule_GetDict(handle->main);
-   if (!handle->dict)
-   {
-      RARCH_ERR("Python: PyModule_GetDict() failed.\n");
-      goto error;
-   }
-   Py_INCREF(handle->dict);
 
    hook = PyDict_GetItemString(handle->dict, pyclass);
    if (!hook)
@@ -340,6 +536,32 @@ py_state_t *py_state_new(const char *script,
    }
    Py_INCREF(handle->inst);
 
+   cache = PyObject_GetAttrString(handle->inst, "cache_results");
+   if (cache)
+   {
+      handle->cache = PyObject_IsTrue(cache) == 1;
+      Py_DECREF(cache);
+   }
+   else
+      PyErr_Clear();
+
+   batch_dict = PyDict_New();
+   if (!batch_dict)
+      goto error;
+
+   PyDict_SetItemString(batch_dict, "__builtins__", PyEval_GetBuiltins());
+   Py_XDECREF(PyRun_String(py_batch_script, Py_file_input,
+            batch_dict, batch_dict));
+   handle->batch = PyDict_GetItemString(batch_dict, "batch");
+   Py_XINCREF(handle->batch);
+   Py_DECREF(batch_dict);
+
+   if (!handle->batch)
+   {
+      RARCH_ERR("Python: Failed to set up batched calls.\n");
+      goto error;
+   }
+
    return handle;
 
 error:
@@ -357,6 +579,8 @@ void py_state_free(py_state_t *handle)
    PyErr_Print();
    PyErr_Clear();
 
+   Py_CLEAR(handle->methods);
+   Py_CLEAR(handle->batch);
    Py_CLEAR(handle->inst);
    Py_CLEAR(handle->dict);
    Py_CLEAR(handle->main);
@@ -365,12 +589,65 @@ void py_state_free(py_state_t *handle)
    Py_Finalize();
 }
 
-float py_state_get(py_state_t *handle, const char *id,
-      unsigned frame_count)
+unsigned py_state_add_uniform(py_state_t *handle, const char *id)
+{
+   unsigned i;
+
+   for (i = 0; i < handle->num_uniforms; i++)
+      if (strcmp(handle->ids[i], id) == 0)
+         return i;
+
+   if (handle->num_uniforms >= PY_STATE_MAX_UNIFORMS || handle->methods)
+      return PY_STATE_MAX_UNIFORMS;
+
+   strlcpy(handle->ids[handle->num_uniforms], id, sizeof(handle->ids[0]));
+   return handle->num_uniforms++;
+}
+
+/* Looks up the uniform methods once, on the first update. */
+static bool py_state_bind(py_state_t *handle)
+{
+   unsigned i;
+
+   handle->methods = PyTuple_New(handle->num_uniforms);
+   if (!handle->methods)
+      goto error;
+
+   for (i = 0; i < handle->num_uniforms; i++)
+   {
+      PyObject *method = PyObject_GetAttrString(handle->inst,
+            handle->ids[i]);
+
+      if (!method)
+      {
+         RARCH_ERR("Python: Script has no method \"%s\".\n",
+               handle->ids[i]);
+         goto error;
+      }
+
+      PyTuple_SET_ITEM(handle->methods, i, method);
+   }
+
+   return true;
+
+error:
+   PyErr_Print();
+   PyErr_Clear();
+   Py_CLEAR(handle->methods);
+   handle->bind_failed = true;
+   return false;
+}
+
+void py_state_update(py_state_t *handle, unsigned frame_count)
 {
    unsigned i;
-   float retval;
-   PyObject *ret = NULL;
+   PyObject *frame = NULL, *ret = NULL;
+
+   if (!handle->num_uniforms || handle->bind_failed)
+      return;
+
+   if (!handle->methods && !py_state_bind(handle))
+      return;
 
    for (i = 0; i < MAX_USERS; i++)
    {
@@ -380,28 +657,69 @@ float py_state_get(py_state_t *handle, const char *id,
             g_settings.input.analog_dpad_mode[i]);
    }
 
-   ret = PyObject_CallMethod(handle->inst, (char*)id, (char*)"I", frame_count);
+   if (handle->cache && handle->has_values && py_read_log_unchanged())
+      goto end;
 
-   for (i = 0; i < MAX_USERS; i++)
-   {
-      input_pop_analog_dpad(g_settings.input.binds[i]);
-      input_pop_analog_dpad(g_settings.input.autoconf_binds[i]);
-   }
+   py_read_log_count    = 0;
+   py_read_log_overflow = false;
+   py_read_log_active   = true;
 
-   if (!ret)
+   frame = PyLong_FromUnsignedLong(frame_count);
+   if (frame)
+      ret = PyObject_CallFunctionObjArgs(handle->batch,
+            handle->methods, frame, NULL);
+   Py_XDECREF(frame);
+
+   py_read_log_active = false;
+
+   if (!ret || !PyTuple_Check(ret) ||
+         PyTuple_GET_SIZE(ret) != (Py_ssize_t)handle->num_uniforms)
    {
       if (!handle->warned_ret)
       {
          RARCH_WARN("Didn't get return value from script. Bug?\n");
          PyErr_Print();
-         PyErr_Clear();
       }
 
+      PyErr_Clear();
+      Py_XDECREF(ret);
       handle->warned_ret = true;
-      return 0.0f;
+      handle->has_values = false;
+      goto end;
+   }
+
+   for (i = 0; i < handle->num_uniforms; i++)
+   {
+      double value = PyFloat_AsDouble(PyTuple_GET_ITEM(ret, i));
+
+      if (value == -1.0 && PyErr_Occurred())
+      {
+         if (!handle->warned_type)
+            RARCH_WARN("Python: \"%s\" did not return a number.\n",
+                  handle->ids[i]);
+         PyErr_Clear();
+         handle->warned_type = true;
+         value = 0.0;
+      }
+
+      handle->values[i] = (float)value;
    }
 
-   retval = (float)PyFloat_AsDouble(ret);
    Py_DECREF(ret);
-   return retval;
+   handle->has_values = true;
+
+end:
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      input_pop_analog_dpad(g_settings.input.binds[i]);
+      input_pop_analog_dpad(g_settings.input.autoconf_binds[i]);
+   }
+}
+
+float py_state_value(py_state_t *handle, unsigned index)
+{
+   if (index >= handle->num_uniforms || !handle->has_values)
+      return 0.0f;
+
+   return handle->values[index];
 }
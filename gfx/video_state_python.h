@@ -29,7 +29,30 @@ py_state_t *py_state_new(const char *program,
 
 void py_state_free(py_state_t *handle);
 
-float py_state_get(py_state_t *handle, 
-      const char *id, unsigned frame_count);
+/**
+ * py_state_add_uniform:
+ * @handle               : Python state handle.
+ * @id                   : Name of the method of the script class
+ *                         which returns the uniform.
+ *
+ * Adds a uniform to evaluate in py_state_update(). Must be called
+ * before the first update.
+ *
+ * Returns: index to pass to py_state_value().
+ **/
+unsigned py_state_add_uniform(py_state_t *handle, const char *id);
+
+/**
+ * py_state_update:
+ * @handle               : Python state handle.
+ * @frame_count          : Frame count passed to the script.
+ *
+ * Evaluates all uniforms in a single call into the interpreter.
+ * If the script class sets cache_results, the last results are
+ * reused as long as everything the script read is unchanged.
+ **/
+void py_state_update(py_state_t *handle, unsigned frame_count);
+
+float py_state_value(py_state_t *handle, unsigned index);
 
 #endif
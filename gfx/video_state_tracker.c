@@ -24,24 +24,36 @@
 #include "video_state_python.h"
 #endif
 
+/* One value read from RAM or input, shared by all the
+ * semantics tracking the same address, mask and equal. */
+struct state_tracker_source
+{
+   const uint16_t *input_ptr;
+   const uint8_t *ptr;
+
+   uint32_t addr;
+   uint16_t mask;
+   uint16_t equal;
+};
+
 struct state_tracker_internal
 {
    char id[64];
 
-   bool is_input;
-   const uint16_t *input_ptr;
-   const uint8_t *ptr;
 #ifdef HAVE_PYTHON
    py_state_t *py;
+   unsigned py_index;
 #endif
 
-   uint32_t addr;
-   uint16_t mask;
-
-   uint16_t equal;
+   /* Index in state_tracker::sources. */
+   unsigned source;
 
    enum state_tracker_type type;
 
+   /* Last value handed out, for state_tracker_uniform::changed. */
+   float last_value;
+   bool has_last_value;
+
    uint32_t prev[2];
    int frame_count;
    int frame_count_prev;
@@ -54,6 +66,13 @@ struct state_tracker
    struct state_tracker_internal *info;
    unsigned info_elem;
 
+   /* Gathered once per frame, before the semantics are updated. */
+   struct state_tracker_source *sources;
+   uint16_t *values;
+   unsigned num_sources;
+
+   /* Input is only polled if a semantic tracks it. */
+   bool has_input;
    uint16_t input_state[2];
 
 #ifdef HAVE_PYTHON
@@ -61,6 +80,35 @@ struct state_tracker
 #endif
 };
 
+/**
+ * state_tracker_add_source:
+ * @tracker                      : State tracker handle.
+ * @source                       : Value to read every frame.
+ *
+ * Returns: index of @source in the gather plan, reusing an
+ * existing source which reads the same value.
+ **/
+static unsigned state_tracker_add_source(state_tracker_t *tracker,
+      const struct state_tracker_source *source)
+{
+   unsigned i;
+
+   for (i = 0; i < tracker->num_sources; i++)
+   {
+      const struct state_tracker_source *other = &tracker->sources[i];
+
+      if (other->input_ptr == source->input_ptr &&
+            other->ptr == source->ptr &&
+            other->addr == source->addr &&
+            other->mask == source->mask &&
+            other->equal == source->equal)
+         return i;
+   }
+
+   tracker->sources[tracker->num_sources] = *source;
+   return tracker->num_sources++;
+}
+
 /**
  * state_tracker_init:
  * @info                         : State tracker info handle.
@@ -93,11 +141,15 @@ state_tracker_t* state_tracker_init(const struct state_tracker_info *info)
 
    tracker->info = (struct state_tracker_internal*)
       calloc(info->info_elem, sizeof(struct state_tracker_internal));
+   tracker->sources = (struct state_tracker_source*)
+      calloc(info->info_elem, sizeof(struct state_tracker_source));
+   tracker->values = (uint16_t*)
+      calloc(info->info_elem, sizeof(uint16_t));
 
-   if (!tracker->info)
+   if (!tracker->info || !tracker->sources || !tracker->values)
    {
       RARCH_ERR("Allocation of state tracker info failed.\n");
-      free(tracker);
+      state_tracker_free(tracker);
       return NULL;
    }
 
@@ -107,46 +159,53 @@ state_tracker_t* state_tracker_init(const struct state_tracker_info *info)
    {
       /* If we don't have a valid pointer. */
       static const uint8_t empty = 0;
+      struct state_tracker_source source = {0};
 
       strlcpy(tracker->info[i].id, info->info[i].id,
             sizeof(tracker->info[i].id));
-      tracker->info[i].addr  = info->info[i].addr;
       tracker->info[i].type  = info->info[i].type;
-      tracker->info[i].mask  = (info->info[i].mask == 0) 
+
+      source.addr  = info->info[i].addr;
+      source.mask  = (info->info[i].mask == 0) 
          ? 0xffff : info->info[i].mask;
-      tracker->info[i].equal = info->info[i].equal;
+      source.equal = info->info[i].equal;
 
 #ifdef HAVE_PYTHON
       if (info->info[i].type == RARCH_STATE_PYTHON)
       {
          if (!tracker->py)
          {
-            free(tracker->info);
-            free(tracker);
+            state_tracker_free(tracker);
             RARCH_ERR("Python semantic was requested, but Python tracker is not loaded.\n");
             return NULL;
          }
-         tracker->info[i].py = tracker->py;
+         tracker->info[i].py       = tracker->py;
+         tracker->info[i].py_index = py_state_add_uniform(tracker->py,
+               info->info[i].id);
+         continue;
       }
 #endif
 
       switch (info->info[i].ram_type)
       {
          case RARCH_STATE_WRAM:
-            tracker->info[i].ptr = info->wram ? info->wram : &empty;
+            source.ptr = info->wram ? info->wram : &empty;
             break;
          case RARCH_STATE_INPUT_SLOT1:
-            tracker->info[i].input_ptr = &tracker->input_state[0];
-            tracker->info[i].is_input = true;
+            source.input_ptr = &tracker->input_state[0];
+            tracker->has_input = true;
             break;
          case RARCH_STATE_INPUT_SLOT2:
-            tracker->info[i].input_ptr = &tracker->input_state[1];
-            tracker->info[i].is_input = true;
+            source.input_ptr = &tracker->input_state[1];
+            tracker->has_input = true;
             break;
 
          default:
-            tracker->info[i].ptr = &empty;
+            source.ptr  = &empty;
+            source.addr = 0;
       }
+
+      tracker->info[i].source = state_tracker_add_source(tracker, &source);
    }
 
    return tracker;
@@ -163,6 +222,8 @@ void state_tracker_free(state_tracker_t *tracker)
    if (tracker)
    {
       free(tracker->info);
+      free(tracker->sources);
+      free(tracker->values);
 #ifdef HAVE_PYTHON
       py_state_free(tracker->py);
 #endif
@@ -171,66 +232,77 @@ void state_tracker_free(state_tracker_t *tracker)
    free(tracker);
 }
 
-static inline uint16_t state_tracker_fetch(
-      const struct state_tracker_internal *info)
+/**
+ * state_tracker_gather:
+ * @tracker                      : State tracker handle.
+ *
+ * Reads every source once for this frame.
+ **/
+static void state_tracker_gather(state_tracker_t *tracker)
 {
-   uint16_t val = info->ptr[info->addr];
+   unsigned i;
 
-   if (info->is_input)
-      val = *info->input_ptr;
+   for (i = 0; i < tracker->num_sources; i++)
+   {
+      const struct state_tracker_source *source = &tracker->sources[i];
+      uint16_t val = source->input_ptr ?
+         *source->input_ptr : source->ptr[source->addr];
 
-   val &= info->mask;
+      val &= source->mask;
 
-   if (info->equal && val != info->equal)
-      val = 0;
+      if (source->equal && val != source->equal)
+         val = 0;
 
-   return val;
+      tracker->values[i] = val;
+   }
 }
 
-static void state_tracker_update_element(
+static void state_tracker_update_element(state_tracker_t *tracker,
       struct state_tracker_uniform *uniform,
       struct state_tracker_internal *info,
       unsigned frame_count)
 {
+   uint16_t val = tracker->values[info->source];
+
    uniform->id = info->id;
 
    switch (info->type)
    {
       case RARCH_STATE_CAPTURE:
-         uniform->value = state_tracker_fetch(info);
+         uniform->value = val;
          break;
 
       case RARCH_STATE_CAPTURE_PREV:
-         if (info->prev[0] != state_tracker_fetch(info))
+         if (info->prev[0] != val)
          {
             info->prev[1] = info->prev[0];
-            info->prev[0] = state_tracker_fetch(info);
+            info->prev[0] = val;
          }
          uniform->value = info->prev[1];
          break;
 
       case RARCH_STATE_TRANSITION:
-         if (info->old_value != state_tracker_fetch(info))
+         if (info->old_value != val)
          {
-            info->old_value = state_tracker_fetch(info);
+            info->old_value = val;
             info->frame_count = frame_count;
          }
          uniform->value = info->frame_count;
          break;
 
       case RARCH_STATE_TRANSITION_COUNT:
-         if (info->old_value != state_tracker_fetch(info))
+         if (info->old_value != val)
          {
-            info->old_value = state_tracker_fetch(info);
+            info->old_value = val;
             info->transition_count++;
          }
          uniform->value = info->transition_count;
          break;
 
       case RARCH_STATE_TRANSITION_PREV:
-         if (info->old_value != state_tracker_fetch(info))
+         if (info->old_value != val)
          {
-            info->old_value = state_tracker_fetch(info);
+            info->old_value = val;
             info->frame_count_prev = info->frame_count;
             info->frame_count = frame_count;
          }
@@ -239,13 +311,18 @@ static void state_tracker_update_element(
       
 #ifdef HAVE_PYTHON
       case RARCH_STATE_PYTHON:
-         uniform->value = py_state_get(info->py, info->id, frame_count);
+         uniform->value = py_state_value(info->py, info->py_index);
          break;
 #endif
       
       default:
          break;
    }
+
+   uniform->changed = !info->has_last_value ||
+      uniform->value != info->last_value;
+   info->last_value     = uniform->value;
+   info->has_last_value = true;
 }
 
 /**
@@ -319,8 +396,8 @@ static void state_tracker_update_input(state_tracker_t *tracker)
  * @elem                         : Amount of uniform elements.
  * @frame_count                  : Frame count.
  *
- * Calls state_tracker_update_input(), and updates each uniform
- * element accordingly.
+ * Polls input if a semantic tracks it, reads each tracked
+ * value once, and updates each uniform element accordingly.
  *
  * Returns: Amount of state elements (either equal to @elem
  * or equal to @tracker->info_eleme).
@@ -334,10 +411,18 @@ unsigned state_tracker_get_uniform(state_tracker_t *tracker,
    if (tracker->info_elem < elem)
       elems = tracker->info_elem;
 
-   state_tracker_update_input(tracker);
+   if (tracker->has_input)
+      state_tracker_update_input(tracker);
+
+   state_tracker_gather(tracker);
+
+#ifdef HAVE_PYTHON
+   if (tracker->py)
+      py_state_update(tracker->py, frame_count);
+#endif
 
    for (i = 0; i < elems; i++)
-      state_tracker_update_element(
+      state_tracker_update_element(tracker,
             &uniforms[i], &tracker->info[i], frame_count);
 
    return elems;
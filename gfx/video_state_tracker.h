@@ -74,6 +74,9 @@ struct state_tracker_uniform
 {
    const char *id;
    float value;
+   /* Differs from the previous call, or is the first one. 
+    * Uniforms need not be uploaded again otherwise. */
+   bool changed;
 };
 
 typedef struct state_tracker state_tracker_t;
@@ -103,8 +106,8 @@ void state_tracker_free(state_tracker_t *tracker);
  * @elem                         : Amount of uniform elements.
  * @frame_count                  : Frame count.
  *
- * Calls update_input(), and updates each uniform
- * element accordingly.
+ * Polls input if a semantic tracks it, reads each tracked
+ * value once, and updates each uniform element accordingly.
  *
  * Returns: Amount of state elements (either equal to @elem
  * or equal to @tracker->info_eleme).
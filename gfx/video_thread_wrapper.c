@@ -33,12 +33,24 @@ static void *thread_init_never_call(const video_info_t *video,
    return NULL;
 }
 
+/* How long to spin before sleeping on a wakeup, if the 
+ * other thread can run on another core meanwhile. */
+#define THREAD_SPIN_USEC 50
+
+/* Called with thr->lock held, which is dropped while waiting. */
+static void thread_wait_event(thread_video_t *thr, sevent_t *event)
+{
+   slock_unlock(thr->lock);
+   sevent_wait(event);
+   slock_lock(thr->lock);
+}
+
 static void thread_reply(thread_video_t *thr, enum thread_cmd cmd)
 {
    slock_lock(thr->lock);
    thr->reply_cmd = cmd;
    thr->send_cmd = CMD_NONE;
-   scond_signal(thr->cond_cmd);
+   sevent_signal(thr->event_cmd);
    slock_unlock(thr->lock);
 }
 
@@ -89,6 +101,9 @@ static void thread_loop(void *data)
    unsigned i = 0;
    (void)i;
 
+   rarch_trace_thread_name("Video");
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_VIDEO);
+
    for (;;)
    {
       bool ret = false;
@@ -97,7 +112,7 @@ static void thread_loop(void *data)
 
       slock_lock(thr->lock);
       while (thr->send_cmd == CMD_NONE && !thr->frame.updated)
-         scond_wait(thr->cond_thread, thr->lock);
+         thread_wait_event(thr, thr->event_thread);
       if (thr->frame.updated)
          updated = true;
 
@@ -257,8 +272,9 @@ static void thread_loop(void *data)
             break;
 
          case CMD_POKE_SET_ASPECT_RATIO:
-            thr->poke->set_aspect_ratio(thr->driver_data,
-                  thr->cmd_data.i);
+            if (thr->poke && thr->poke->set_aspect_ratio)
+               thr->poke->set_aspect_ratio(thr->driver_data,
+                     thr->cmd_data.i);
             thread_reply(thr, CMD_POKE_SET_ASPECT_RATIO);
             break;
 
@@ -307,15 +323,43 @@ static void thread_loop(void *data)
          bool focus = false;
          bool has_windowed = true;
          struct rarch_viewport vp = {0};
+         unsigned width, height, pitch;
+         const uint8_t *buffer;
+
+         /* Take the ready frame, so the caller can hand over 
+          * the next one while we draw. */
+         slock_lock(thr->lock);
+         if (!thr->frame.dupe)
+         {
+            unsigned index          = thr->frame.draw_index;
+            thr->frame.draw_index   = thr->frame.ready_index;
+            thr->frame.ready_index  = index;
+         }
+         buffer = thr->frame.buffer[thr->frame.draw_index];
+         width  = thr->frame.width;
+         height = thr->frame.height;
+         pitch  = thr->frame.pitch;
+         strlcpy(thr->frame.draw_msg, thr->frame.msg,
+               sizeof(thr->frame.draw_msg));
+         thr->frame.updated = false;
+         thr->frame.dupe    = false;
+         thr->frame.busy    = true;
+         sevent_signal(thr->event_cmd);
+         slock_unlock(thr->lock);
 
          slock_lock(thr->frame.lock);
 
          thread_update_driver_state(thr);
 
+         RARCH_PERFORMANCE_INIT(thr_video_frame);
+         RARCH_PERFORMANCE_START(thr_video_frame);
+
          if (thr->driver && thr->driver->frame)
             ret = thr->driver->frame(thr->driver_data,
-               thr->frame.buffer, thr->frame.width, thr->frame.height,
-               thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+               buffer, width, height, pitch,
+               *thr->frame.draw_msg ? thr->frame.draw_msg : NULL);
+
+         RARCH_PERFORMANCE_STOP(thr_video_frame);
 
          slock_unlock(thr->frame.lock);
 
@@ -335,9 +379,9 @@ static void thread_loop(void *data)
          thr->alive = alive;
          thr->focus = focus;
          thr->has_windowed = has_windowed;
-         thr->frame.updated = false;
+         thr->frame.busy = false;
          thr->vp = vp;
-         scond_signal(thr->cond_cmd);
+         sevent_signal(thr->event_cmd);
          slock_unlock(thr->lock);
       }
    }
@@ -348,7 +392,7 @@ static void thread_send_cmd(thread_video_t *thr, enum thread_cmd cmd)
    slock_lock(thr->lock);
    thr->send_cmd = cmd;
    thr->reply_cmd = CMD_NONE;
-   scond_signal(thr->cond_thread);
+   sevent_signal(thr->event_thread);
    slock_unlock(thr->lock);
 }
 
@@ -356,7 +400,7 @@ static void thread_wait_reply(thread_video_t *thr, enum thread_cmd cmd)
 {
    slock_lock(thr->lock);
    while (cmd != thr->reply_cmd)
-      scond_wait(thr->cond_cmd, thr->lock);
+      thread_wait_event(thr, thr->event_cmd);
    slock_unlock(thr->lock);
 }
 
@@ -430,12 +474,12 @@ static bool thread_frame(void *data, const void *frame_,
          ? sizeof(uint32_t) : sizeof(uint16_t));
 
    src = (const uint8_t*)frame_;
-   dst = thr->frame.buffer;
 
    slock_lock(thr->lock);
 
    if (!thr->nonblock)
    {
+      bool woken;
       retro_time_t target_frame_time = (retro_time_t)
          roundf(1000000LL / g_settings.video.refresh_rate);
       retro_time_t target = thr->last_time + target_frame_time;
@@ -449,45 +493,73 @@ static bool thread_frame(void *data, const void *frame_,
          if (delta <= 0)
             break;
 
-         if (!scond_wait_timeout(thr->cond_cmd, thr->lock, delta))
+         slock_unlock(thr->lock);
+         woken = sevent_wait_timeout(thr->event_cmd, delta);
+         slock_lock(thr->lock);
+
+         if (!woken)
             break;
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is 
-    * still working on last frame. */
-   if (!thr->frame.updated)
+   /* If the thread did not get to the last frame in time, 
+    * it is replaced by this one. */
+   if (thr->frame.updated)
+      thr->miss_count++;
+   else
+      thr->hit_count++;
+
+   if (src)
    {
-      if (src)
+      /* The write buffer is ours alone, no need to hold the lock. */
+      dst = thr->frame.buffer[thr->frame.write_index];
+      slock_unlock(thr->lock);
+
+      /* Nothing to copy if the core rendered straight into it 
+       * through GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+      if (src != dst)
       {
          unsigned h;
          for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
       }
+      else if (pitch != copy_stride)
+      {
+         unsigned h;
+         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+            memmove(dst, src, copy_stride);
+      }
+
+      slock_lock(thr->lock);
+      {
+         unsigned index          = thr->frame.write_index;
+         thr->frame.write_index  = thr->frame.ready_index;
+         thr->frame.ready_index  = index;
+      }
+      thr->frame.dupe = false;
+   }
+   else if (!thr->frame.updated)
+      thr->frame.dupe = true;
 
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.pitch  = copy_stride;
+   thr->frame.updated = true;
+   thr->frame.width  = width;
+   thr->frame.height = height;
+   thr->frame.pitch  = copy_stride;
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   if (msg)
+      strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
+   else
+      *thr->frame.msg = '\0';
 
-      scond_signal(thr->cond_thread);
+   sevent_signal(thr->event_thread);
 
 #if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
-#endif
-      thr->hit_count++;
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated || thr->frame.busy)
+         thread_wait_event(thr, thr->event_cmd);
    }
-   else
-      thr->miss_count++;
+#endif
 
    slock_unlock(thr->lock);
 
@@ -507,13 +579,16 @@ static void thread_set_nonblock_state(void *data, bool state)
 static bool thread_init(thread_video_t *thr, const video_info_t *info,
       const input_driver_t **input, void **input_data)
 {
+   unsigned i;
    size_t max_size;
 
    thr->lock = slock_new();
    thr->alpha_lock = slock_new();
    thr->frame.lock = slock_new();
-   thr->cond_cmd = scond_new();
-   thr->cond_thread = scond_new();
+   thr->event_cmd = sevent_new(rarch_get_cpu_cores() > 1
+         ? THREAD_SPIN_USEC : 0);
+   thr->event_thread = sevent_new(rarch_get_cpu_cores() > 1
+         ? THREAD_SPIN_USEC : 0);
    thr->input = input;
    thr->input_data = input_data;
    thr->info = *info;
@@ -524,11 +599,18 @@ static bool thread_init(thread_video_t *thr, const video_info_t *info,
    max_size = info->input_scale * RARCH_SCALE_BASE;
    max_size *= max_size;
    max_size *= info->rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer = (uint8_t*)malloc(max_size);
-   if (!thr->frame.buffer)
-      return false;
+   for (i = 0; i < ARRAY_SIZE(thr->frame.buffer); i++)
+   {
+      thr->frame.buffer[i] = (uint8_t*)malloc(max_size);
+      if (!thr->frame.buffer[i])
+         return false;
 
-   memset(thr->frame.buffer, 0x80, max_size);
+      memset(thr->frame.buffer[i], 0x80, max_size);
+   }
+   thr->frame.buffer_size = max_size;
+   thr->frame.write_index = 0;
+   thr->frame.ready_index = 1;
+   thr->frame.draw_index  = 2;
 
    thr->last_time = rarch_get_time_usec();
 
@@ -608,6 +690,7 @@ static bool thread_read_viewport(void *data, uint8_t *buffer)
 
 static void thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    if (!thr)
       return;
@@ -619,11 +702,12 @@ static void thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < ARRAY_SIZE(thr->frame.buffer); i++)
+      free(thr->frame.buffer[i]);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
-   scond_free(thr->cond_cmd);
-   scond_free(thr->cond_thread);
+   sevent_free(thr->event_cmd);
+   sevent_free(thr->event_thread);
 
    free(thr->alpha_mod);
    slock_free(thr->alpha_lock);
@@ -831,7 +915,31 @@ static struct gfx_shader *thread_get_current_shader(void *data)
    thread_video_t *thr = (thread_video_t*)data;
    if (!thr)
       return NULL;
-   return thr->poke ? thr->poke->get_current_shader(thr->driver_data) : NULL;
+   return thr->poke && thr->poke->get_current_shader ?
+      thr->poke->get_current_shader(thr->driver_data) : NULL;
+}
+
+/* Called by the core through the environment callback, 
+ * so on the same thread as thread_frame(). */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   size_t pitch;
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr)
+      return false;
+
+   pitch = framebuffer->width * (thr->info.rgb32 
+         ? sizeof(uint32_t) : sizeof(uint16_t));
+
+   if (!pitch || pitch * framebuffer->height > thr->frame.buffer_size)
+      return false;
+
+   framebuffer->data         = thr->frame.buffer[thr->frame.write_index];
+   framebuffer->pitch        = pitch;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+   return true;
 }
 
 static const video_poke_interface_t thread_poke = {
@@ -852,6 +960,7 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
    thread_get_current_shader,
+   thread_get_current_software_framebuffer,
 };
 
 static void thread_get_poke_interface(void *data,
@@ -859,13 +968,11 @@ static void thread_get_poke_interface(void *data,
 {
    thread_video_t *thr = (thread_video_t*)data;
 
+   /* The software framebuffer is ours, so the interface is
+    * there even if the driver has none. */
+   *iface = &thread_poke;
    if (thr->driver->poke_interface)
-   {
-      *iface = &thread_poke;
       thr->driver->poke_interface(thr->driver_data, &thr->poke);
-   }
-   else
-      *iface = NULL;
 }
 
 static const video_driver_t video_thread = {
@@ -57,8 +57,10 @@ enum thread_cmd
 typedef struct thread_video
 {
    slock_t *lock;
-   scond_t *cond_cmd;
-   scond_t *cond_thread;
+   /* Wakes up the caller waiting for a reply or a frame. */
+   sevent_t *event_cmd;
+   /* Wakes up the video thread. */
+   sevent_t *event_thread;
    sthread_t *thread;
 
    video_info_t info;
@@ -173,13 +175,26 @@ typedef struct thread_video
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
+      /* Triple buffered. The caller writes into buffer[write_index],
+       * buffer[ready_index] holds the newest frame while updated is 
+       * set, and the video thread draws buffer[draw_index]. 
+       * Handing over a frame only swaps indices. */
+      uint8_t *buffer[3];
+      size_t buffer_size;
+      unsigned write_index;
+      unsigned ready_index;
+      unsigned draw_index;
       unsigned width;
       unsigned height;
       unsigned pitch;
       bool updated;
+      /* The ready frame is a dupe, so draw buffer[draw_index] again. */
+      bool dupe;
+      /* The video thread is drawing a frame. */
+      bool busy;
       bool within_thread;
       char msg[PATH_MAX_LENGTH];
+      char draw_msg[PATH_MAX_LENGTH];
    } frame;
 
    video_driver_t video_thread;
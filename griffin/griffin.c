@@ -57,6 +57,7 @@ PERFORMANCE
 #endif
 
 #include "../performance.c"
+#include "../thread_role.c"
 
 /*============================================================
 COMPATIBILITY
@@ -80,6 +81,7 @@ CONFIG FILE
 CHEATS
 ============================================================ */
 #include "../cheats.c"
+#include "../cheat_search.c"
 #include "../hash.c"
 
 /*============================================================
@@ -167,6 +169,10 @@ VIDEO IMAGE
 #include "../gfx/image/image_rpng.c"
 #endif
 
+#ifndef _XBOX1
+#include "../gfx/image/image_cache.c"
+#endif
+
 #include "../gfx/rpng/rpng.c"
 
 /*============================================================
@@ -192,6 +198,7 @@ VIDEO DRIVER
 #endif
 
 #include "../gfx/gfx_common.c"
+#include "../gfx/video_pacer.c"
 
 #ifdef _XBOX
 #include "../xdk/xdk_resources.cpp"
@@ -359,6 +366,7 @@ INPUT
 #if defined(__linux__) && !defined(ANDROID) 
 #include "../input/drivers/linuxraw_input.c"
 #include "../input/drivers_joypad/linuxraw_joypad.c"
+#include "../input/drivers_joypad/hidraw_joypad.c"
 #endif
 
 #ifdef HAVE_X11
@@ -578,6 +586,13 @@ REWIND
 ============================================================ */
 #include "../rewind.c"
 
+/*============================================================
+RUN-AHEAD
+============================================================ */
+#include "../runahead.c"
+#include "../latency_test.c"
+#include "../perf_governor.c"
+
 /*============================================================
 FRONTEND
 ============================================================ */
@@ -626,8 +641,14 @@ RETROARCH
 RECORDING
 ============================================================ */
 #include "../movie.c"
+#include "../frame_hash.c"
 #include "../record/record_driver.c"
 
+#ifdef HAVE_SHM
+#include "../record/drivers/shm.c"
+#include "../memory_share.c"
+#endif
+
 /*============================================================
 THREAD
 ============================================================ */
@@ -635,9 +656,13 @@ THREAD
 #include "../thread/xenon_sdl_threads.c"
 #elif defined(HAVE_THREADS)
 #include "../libretro-sdk/rthreads/rthreads.c"
+#include "../libretro-sdk/rthreads/rthreadpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #include "../autosave.c"
+#ifdef __GNUC__
+#include "../logger/async_logger.c"
+#endif
 #endif
 
 
@@ -648,6 +673,8 @@ NETPLAY
 #include "../netplay.c"
 #include "../http_lib.c"
 #include "../http_intf.c"
+#include "../net_http.c"
+#include "../downloader.c"
 #endif
 
 /*============================================================
@@ -663,6 +690,7 @@ SCREENSHOTS
 PLAYLISTS
 ============================================================ */
 #include "../playlist.c"
+#include "../content_scan.c"
 
 /*============================================================
 MENU
@@ -674,6 +702,7 @@ MENU
 #include "../menu/menu_action.c"
 #include "../menu/menu_list.c"
 #include "../menu/menu_entries.c"
+#include "../menu/menu_dir_cache.c"
 #include "../menu/menu_entries_cbs.c"
 #include "../menu/menu_shader.c"
 #include "../menu/menu_navigation.c"
@@ -792,7 +821,6 @@ XML
 /*============================================================
  RARCHDB
 ============================================================ */
-#include "../rarchdb/bintree.c"
 #include "../rarchdb/db_parser.c"
 #include "../rarchdb/rarchdb.c"
 #include "../rarchdb/rmsgpack.c"
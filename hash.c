@@ -22,10 +22,55 @@
 #else
 #include <unistd.h>
 #endif
+#include <stdlib.h>
 #include "hash.h"
+#include "performance.h"
 #include <retro_miscellaneous.h>
 #include <retro_endianness.h>
 
+/* Hardware kernels. x86 ones are built with function-level target
+ * attributes and picked at runtime from the CPU feature mask, ARM
+ * ones are only built when the compiler targets the extension, so
+ * they can always be used then. */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+   (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define HASH_HAVE_X86
+#define HASH_TARGET_CLMUL __attribute__((target("sse2,pclmul")))
+#define HASH_TARGET_SHA   __attribute__((target("sse4.1,sha")))
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HASH_HAVE_ARM_CRC32
+#endif
+
+#if defined(__ARM_FEATURE_CRYPTO) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HASH_HAVE_ARM_SHA
+#endif
+
+typedef uint32_t (*crc32_func_t)(uint32_t crc,
+      const uint8_t *data, size_t length);
+typedef void (*sha_blocks_func_t)(uint32_t *state,
+      const uint8_t *data, size_t blocks);
+
+static struct
+{
+   volatile bool init;
+   crc32_func_t crc32;
+   sha_blocks_func_t sha1;
+   sha_blocks_func_t sha256;
+} hash_impl;
+
+static void hash_init(void);
+
+static INLINE uint32_t hash_load32be(const uint8_t *p)
+{
+   return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+      ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
 #define LSL32(x, n) ((uint32_t)(x) << (n))
 #define LSR32(x, n) ((uint32_t)(x) >> (n))
 #define ROR32(x, n) (LSR32(x, n) | LSL32(x, 32 - (n)))
@@ -49,77 +94,398 @@ static const uint32_t T_K[64] = {
 
 /* SHA256 implementation from bSNES. Written by valditx. */
 
-struct sha256_ctx 
-{
-   union
-   {
-      uint8_t u8[64];
-      uint32_t u32[16];
-   } in;
-   unsigned inlen;
-
-   uint32_t w[64];
-   uint32_t h[8];
-   uint64_t len;
-};
-
 static void sha256_init(struct sha256_ctx *p) 
 {
    memset(p, 0, sizeof(struct sha256_ctx));
    memcpy(p->h, T_H, sizeof(T_H));
 }
 
-static void sha256_block(struct sha256_ctx *p) 
+static void sha256_blocks_c(uint32_t *state,
+      const uint8_t *data, size_t blocks)
 {
    unsigned i;
+   uint32_t w[64];
    uint32_t s0, s1;
    uint32_t a, b, c, d, e, f, g, h;
    uint32_t t1, t2, maj, ch;
 
-   for (i = 0; i < 16; i++) 
-      p->w[i] = load32be(p->in.u32 + i);
+   for (; blocks; blocks--, data += 64)
+   {
+      for (i = 0; i < 16; i++) 
+         w[i] = hash_load32be(data + 4 * i);
+
+      for (i = 16; i < 64; i++) 
+      {
+         s0 = ROR32(w[i - 15],  7) ^ ROR32(w[i - 15], 18) ^ LSR32(w[i - 15],  3);
+         s1 = ROR32(w[i -  2], 17) ^ ROR32(w[i -  2], 19) ^ LSR32(w[i -  2], 10);
+         w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      a = state[0]; b = state[1]; c = state[2]; d = state[3];
+      e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+      for (i = 0; i < 64; i++) 
+      {
+         s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+         maj = (a & b) ^ (a & c) ^ (b & c);
+         t2 = s0 + maj;
+         s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+         ch = (e & f) ^ (~e & g);
+         t1 = h + s1 + ch + T_K[i] + w[i];
+
+         h = g; g = f; f = e; e = d + t1;
+         d = c; c = b; b = a; a = t1 + t2;
+      }
+
+      state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+      state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+   }
+}
 
-   for (i = 16; i < 64; i++) 
+#ifdef HASH_HAVE_X86
+/* SHA extensions keep the state as ABEF and CDGH. */
+HASH_TARGET_SHA
+static void sha256_blocks_ni(uint32_t *state,
+      const uint8_t *data, size_t blocks)
+{
+   __m128i state0, state1, msg, tmp;
+   __m128i msg0, msg1, msg2, msg3;
+   __m128i abef_save, cdgh_save;
+   const __m128i mask = _mm_set_epi64x(
+         0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+   tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1);
+   state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b);
+   state0 = _mm_alignr_epi8(tmp, state1, 8);
+   state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+   for (; blocks; blocks--, data += 64)
    {
-      s0 = ROR32(p->w[i - 15],  7) ^ ROR32(p->w[i - 15], 18) ^ LSR32(p->w[i - 15],  3);
-      s1 = ROR32(p->w[i -  2], 17) ^ ROR32(p->w[i -  2], 19) ^ LSR32(p->w[i -  2], 10);
-      p->w[i] = p->w[i - 16] + s0 + p->w[i - 7] + s1;
+      abef_save = state0;
+      cdgh_save = state1;
+
+      /* Rounds 0-3 */
+      msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+      msg = _mm_add_epi32(msg0, _mm_loadu_si128((const __m128i*)(T_K + 0)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+      /* Rounds 4-7 */
+      msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+      msg = _mm_add_epi32(msg1, _mm_loadu_si128((const __m128i*)(T_K + 4)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+      /* Rounds 8-11 */
+      msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+      msg = _mm_add_epi32(msg2, _mm_loadu_si128((const __m128i*)(T_K + 8)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+      /* Rounds 12-15 */
+      msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+      msg = _mm_add_epi32(msg3, _mm_loadu_si128((const __m128i*)(T_K + 12)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg3, msg2, 4);
+      msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+      /* Rounds 16-19 */
+      msg = _mm_add_epi32(msg0, _mm_loadu_si128((const __m128i*)(T_K + 16)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg0, msg3, 4);
+      msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+      /* Rounds 20-23 */
+      msg = _mm_add_epi32(msg1, _mm_loadu_si128((const __m128i*)(T_K + 20)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg1, msg0, 4);
+      msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+      /* Rounds 24-27 */
+      msg = _mm_add_epi32(msg2, _mm_loadu_si128((const __m128i*)(T_K + 24)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg2, msg1, 4);
+      msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+      /* Rounds 28-31 */
+      msg = _mm_add_epi32(msg3, _mm_loadu_si128((const __m128i*)(T_K + 28)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg3, msg2, 4);
+      msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+      /* Rounds 32-35 */
+      msg = _mm_add_epi32(msg0, _mm_loadu_si128((const __m128i*)(T_K + 32)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg0, msg3, 4);
+      msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+      /* Rounds 36-39 */
+      msg = _mm_add_epi32(msg1, _mm_loadu_si128((const __m128i*)(T_K + 36)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg1, msg0, 4);
+      msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+      /* Rounds 40-43 */
+      msg = _mm_add_epi32(msg2, _mm_loadu_si128((const __m128i*)(T_K + 40)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg2, msg1, 4);
+      msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+      /* Rounds 44-47 */
+      msg = _mm_add_epi32(msg3, _mm_loadu_si128((const __m128i*)(T_K + 44)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg3, msg2, 4);
+      msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+      /* Rounds 48-51 */
+      msg = _mm_add_epi32(msg0, _mm_loadu_si128((const __m128i*)(T_K + 48)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg0, msg3, 4);
+      msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+      /* Rounds 52-55 */
+      msg = _mm_add_epi32(msg1, _mm_loadu_si128((const __m128i*)(T_K + 52)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg1, msg0, 4);
+      msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+      /* Rounds 56-59 */
+      msg = _mm_add_epi32(msg2, _mm_loadu_si128((const __m128i*)(T_K + 56)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      tmp = _mm_alignr_epi8(msg2, msg1, 4);
+      msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+      /* Rounds 60-63 */
+      msg = _mm_add_epi32(msg3, _mm_loadu_si128((const __m128i*)(T_K + 60)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+      state0 = _mm_add_epi32(state0, abef_save);
+      state1 = _mm_add_epi32(state1, cdgh_save);
    }
 
-   a = p->h[0]; b = p->h[1]; c = p->h[2]; d = p->h[3];
-   e = p->h[4]; f = p->h[5]; g = p->h[6]; h = p->h[7];
+   tmp    = _mm_shuffle_epi32(state0, 0x1b);
+   state1 = _mm_shuffle_epi32(state1, 0xb1);
+   state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+   state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+   _mm_storeu_si128((__m128i*)&state[0], state0);
+   _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+#endif
+
+#ifdef HASH_HAVE_ARM_SHA
+static void sha256_blocks_armv8(uint32_t *state,
+      const uint8_t *data, size_t blocks)
+{
+   uint32x4_t state0, state1, abef, tmp;
+   uint32x4_t msg0, msg1, msg2, msg3;
+   uint32x4_t abcd_save, efgh_save;
+
+   state0 = vld1q_u32(&state[0]);
+   state1 = vld1q_u32(&state[4]);
 
-   for (i = 0; i < 64; i++) 
+   for (; blocks; blocks--, data += 64)
    {
-      s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
-      maj = (a & b) ^ (a & c) ^ (b & c);
-      t2 = s0 + maj;
-      s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
-      ch = (e & f) ^ (~e & g);
-      t1 = h + s1 + ch + T_K[i] + p->w[i];
-
-      h = g; g = f; f = e; e = d + t1;
-      d = c; c = b; b = a; a = t1 + t2;
+      abcd_save = state0;
+      efgh_save = state1;
+
+      msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data +  0)));
+      msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+      msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+      msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+      /* Rounds 0-3 */
+      tmp = vaddq_u32(msg0, vld1q_u32(T_K + 0));
+      msg0 = vsha256su1q_u32(vsha256su0q_u32(msg0, msg1), msg2, msg3);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 4-7 */
+      tmp = vaddq_u32(msg1, vld1q_u32(T_K + 4));
+      msg1 = vsha256su1q_u32(vsha256su0q_u32(msg1, msg2), msg3, msg0);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 8-11 */
+      tmp = vaddq_u32(msg2, vld1q_u32(T_K + 8));
+      msg2 = vsha256su1q_u32(vsha256su0q_u32(msg2, msg3), msg0, msg1);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 12-15 */
+      tmp = vaddq_u32(msg3, vld1q_u32(T_K + 12));
+      msg3 = vsha256su1q_u32(vsha256su0q_u32(msg3, msg0), msg1, msg2);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 16-19 */
+      tmp = vaddq_u32(msg0, vld1q_u32(T_K + 16));
+      msg0 = vsha256su1q_u32(vsha256su0q_u32(msg0, msg1), msg2, msg3);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 20-23 */
+      tmp = vaddq_u32(msg1, vld1q_u32(T_K + 20));
+      msg1 = vsha256su1q_u32(vsha256su0q_u32(msg1, msg2), msg3, msg0);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 24-27 */
+      tmp = vaddq_u32(msg2, vld1q_u32(T_K + 24));
+      msg2 = vsha256su1q_u32(vsha256su0q_u32(msg2, msg3), msg0, msg1);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 28-31 */
+      tmp = vaddq_u32(msg3, vld1q_u32(T_K + 28));
+      msg3 = vsha256su1q_u32(vsha256su0q_u32(msg3, msg0), msg1, msg2);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 32-35 */
+      tmp = vaddq_u32(msg0, vld1q_u32(T_K + 32));
+      msg0 = vsha256su1q_u32(vsha256su0q_u32(msg0, msg1), msg2, msg3);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 36-39 */
+      tmp = vaddq_u32(msg1, vld1q_u32(T_K + 36));
+      msg1 = vsha256su1q_u32(vsha256su0q_u32(msg1, msg2), msg3, msg0);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 40-43 */
+      tmp = vaddq_u32(msg2, vld1q_u32(T_K + 40));
+      msg2 = vsha256su1q_u32(vsha256su0q_u32(msg2, msg3), msg0, msg1);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 44-47 */
+      tmp = vaddq_u32(msg3, vld1q_u32(T_K + 44));
+      msg3 = vsha256su1q_u32(vsha256su0q_u32(msg3, msg0), msg1, msg2);
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 48-51 */
+      tmp = vaddq_u32(msg0, vld1q_u32(T_K + 48));
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 52-55 */
+      tmp = vaddq_u32(msg1, vld1q_u32(T_K + 52));
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 56-59 */
+      tmp = vaddq_u32(msg2, vld1q_u32(T_K + 56));
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      /* Rounds 60-63 */
+      tmp = vaddq_u32(msg3, vld1q_u32(T_K + 60));
+      abef = state0;
+      state0 = vsha256hq_u32(state0, state1, tmp);
+      state1 = vsha256h2q_u32(state1, abef, tmp);
+
+      state0 = vaddq_u32(state0, abcd_save);
+      state1 = vaddq_u32(state1, efgh_save);
    }
 
-   p->h[0] += a; p->h[1] += b; p->h[2] += c; p->h[3] += d;
-   p->h[4] += e; p->h[5] += f; p->h[6] += g; p->h[7] += h;
+   vst1q_u32(&state[0], state0);
+   vst1q_u32(&state[4], state1);
+}
+#endif
+
+static void sha256_block(struct sha256_ctx *p) 
+{
+   if (!hash_impl.init)
+      hash_init();
+
+   hash_impl.sha256(p->h, p->in, 1);
 
    /* Next block */
    p->inlen = 0;
 }
 
-static void sha256_chunk(struct sha256_ctx *p, const uint8_t *s, unsigned len) 
+static void sha256_chunk(struct sha256_ctx *p, const uint8_t *s, size_t len) 
 {
-   unsigned l;
+   size_t l;
    p->len += len;
 
    while (len) 
    {
+      /* Whole blocks are hashed straight from the input. */
+      if (!p->inlen && len >= 64)
+      {
+         if (!hash_impl.init)
+            hash_init();
+
+         hash_impl.sha256(p->h, s, len >> 6);
+         s   += len & ~63u;
+         len &= 63;
+         continue;
+      }
+
       l = 64 - p->inlen;
       l = (len < l) ? len : l;
 
-      memcpy(p->in.u8 + p->inlen, s, l);
+      memcpy(p->in + p->inlen, s, l);
       s += l;
       p->inlen += l;
       len -= l;
@@ -131,20 +497,21 @@ static void sha256_chunk(struct sha256_ctx *p, const uint8_t *s, unsigned len)
 
 static void sha256_final(struct sha256_ctx *p) 
 {
+   unsigned i;
    uint64_t len;
-   p->in.u8[p->inlen++] = 0x80;
+   p->in[p->inlen++] = 0x80;
 
    if (p->inlen > 56) 
    {
-      memset(p->in.u8 + p->inlen, 0, 64 - p->inlen);
+      memset(p->in + p->inlen, 0, 64 - p->inlen);
       sha256_block(p);
    }
 
-   memset(p->in.u8 + p->inlen, 0, 56 - p->inlen);
+   memset(p->in + p->inlen, 0, 56 - p->inlen);
 
    len = p->len << 3;
-   store32be(p->in.u32 + 14, (uint32_t)(len >> 32));
-   store32be(p->in.u32 + 15, (uint32_t)len);
+   for (i = 0; i < 8; i++)
+      p->in[56 + i] = (uint8_t)(len >> (56 - 8 * i));
    sha256_block(p);
 }
 
@@ -155,10 +522,19 @@ static void sha256_subhash(struct sha256_ctx *p, uint32_t *t)
       store32be(t++, p->h[i]);
 }
 
-void sha256_hash(char *out, const uint8_t *in, size_t size)
+void sha256_begin(struct sha256_ctx *ctx)
+{
+   sha256_init(ctx);
+}
+
+void sha256_update(struct sha256_ctx *ctx, const uint8_t *in, size_t size)
+{
+   sha256_chunk(ctx, in, size);
+}
+
+void sha256_end(struct sha256_ctx *ctx, char *out)
 {
    unsigned i;
-   struct sha256_ctx sha;
 
    union
    {
@@ -166,16 +542,22 @@ void sha256_hash(char *out, const uint8_t *in, size_t size)
       uint8_t u8[32];
    } shahash;
 
-   sha256_init(&sha);
-   sha256_chunk(&sha, in, size);
-   sha256_final(&sha);
-   sha256_subhash(&sha, shahash.u32);
+   sha256_final(ctx);
+   sha256_subhash(ctx, shahash.u32);
 
    for (i = 0; i < 32; i++)
       snprintf(out + 2 * i, 3, "%02x", (unsigned)shahash.u8[i]);
 }
 
-#ifndef HAVE_ZLIB
+void sha256_hash(char *out, const uint8_t *in, size_t size)
+{
+   struct sha256_ctx sha;
+
+   sha256_begin(&sha);
+   sha256_update(&sha, in, size);
+   sha256_end(&sha, out);
+}
+
 /* Zlib CRC32. */
 static const uint32_t crc32_table[256] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -223,21 +605,157 @@ static const uint32_t crc32_table[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+/* crc32_slice[n][i] is the CRC of byte i followed by n zero bytes,
+ * for eight bytes at a time. Row 0 is crc32_table. */
+static uint32_t crc32_slice[8][256];
+
 uint32_t crc32_adjust(uint32_t checksum, uint8_t input)
 {
    return ((checksum >> 8) & 0x00ffffff) ^ crc32_table[(checksum ^ input) & 0xff];
 }
 
-uint32_t crc32_calculate(const uint8_t *data, size_t length)
+static void crc32_slice_init(void)
+{
+   unsigned i, n;
+
+   for (i = 0; i < 256; i++)
+   {
+      crc32_slice[0][i] = crc32_table[i];
+      for (n = 1; n < 8; n++)
+         crc32_slice[n][i] = crc32_adjust(crc32_slice[n - 1][i], 0);
+   }
+}
+
+/* All kernels work on the inverted CRC. */
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *data, size_t length)
 {
-   size_t i;
-   uint32_t checksum = ~0;
-   for (i = 0; i < length; i++)
-      checksum = crc32_adjust(checksum, data[i]);
-   return ~checksum;
+   for (; length && ((uintptr_t)data & 7); length--)
+      crc = crc32_adjust(crc, *data++);
+
+   for (; length >= 8; length -= 8, data += 8)
+   {
+      uint32_t lo = crc ^ (data[0] | (data[1] << 8) |
+            (data[2] << 16) | ((uint32_t)data[3] << 24));
+      uint32_t hi = data[4] | (data[5] << 8) |
+            (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+      crc = crc32_slice[7][lo & 0xff] ^
+         crc32_slice[6][(lo >> 8) & 0xff] ^
+         crc32_slice[5][(lo >> 16) & 0xff] ^
+         crc32_slice[4][lo >> 24] ^
+         crc32_slice[3][hi & 0xff] ^
+         crc32_slice[2][(hi >> 8) & 0xff] ^
+         crc32_slice[1][(hi >> 16) & 0xff] ^
+         crc32_slice[0][hi >> 24];
+   }
+
+   for (; length; length--)
+      crc = crc32_adjust(crc, *data++);
+
+   return crc;
+}
+
+#ifdef HASH_HAVE_X86
+/* Folds 64 bytes at a time with carry-less multiplies, then
+ * Barrett reduces to 32 bits. The constants are powers of x
+ * modulo the reflected CRC32 polynomial. */
+HASH_TARGET_CLMUL
+static uint32_t crc32_fold_clmul(uint32_t crc,
+      const uint8_t *data, size_t length)
+{
+   const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+   const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+   const __m128i k5   = _mm_set_epi64x(0, 0x0163cd6124LL);
+   const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+   const __m128i low  = _mm_set_epi32(0, ~0, 0, ~0);
+   __m128i x0, x1, x2, x3, x4;
+   size_t tail = length & 15;
+
+   if (length < 64)
+      return crc32_slice8(crc, data, length);
+
+   length -= tail;
+
+   x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+   x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+   x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+   x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+   x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+   for (data += 64, length -= 64; length >= 64; data += 64, length -= 64)
+   {
+#define CRC32_FOLD(x, k, next) \
+      _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+               _mm_clmulepi64_si128(x, k, 0x11)), next)
+      x1 = CRC32_FOLD(x1, k1k2, _mm_loadu_si128((const __m128i*)(data + 0x00)));
+      x2 = CRC32_FOLD(x2, k1k2, _mm_loadu_si128((const __m128i*)(data + 0x10)));
+      x3 = CRC32_FOLD(x3, k1k2, _mm_loadu_si128((const __m128i*)(data + 0x20)));
+      x4 = CRC32_FOLD(x4, k1k2, _mm_loadu_si128((const __m128i*)(data + 0x30)));
+   }
+
+   /* Down to 128 bits. */
+   x1 = CRC32_FOLD(x1, k3k4, x2);
+   x1 = CRC32_FOLD(x1, k3k4, x3);
+   x1 = CRC32_FOLD(x1, k3k4, x4);
+
+   for (; length >= 16; data += 16, length -= 16)
+      x1 = CRC32_FOLD(x1, k3k4, _mm_loadu_si128((const __m128i*)data));
+#undef CRC32_FOLD
+
+   /* Down to 64 bits. */
+   x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+   x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+   x2 = _mm_srli_si128(x1, 4);
+   x1 = _mm_and_si128(x1, low);
+   x1 = _mm_clmulepi64_si128(x1, k5, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   /* Barrett reduction. */
+   x0 = _mm_and_si128(x1, low);
+   x0 = _mm_clmulepi64_si128(x0, poly, 0x10);
+   x0 = _mm_and_si128(x0, low);
+   x0 = _mm_clmulepi64_si128(x0, poly, 0x00);
+   x1 = _mm_xor_si128(x1, x0);
+
+   crc = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+   return crc32_slice8(crc, data, tail);
 }
 #endif
 
+#ifdef HASH_HAVE_ARM_CRC32
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t *data, size_t length)
+{
+   for (; length && ((uintptr_t)data & 7); length--)
+      crc = __crc32b(crc, *data++);
+
+   for (; length >= 8; length -= 8, data += 8)
+   {
+      uint64_t v;
+      memcpy(&v, data, sizeof(v));
+      crc = __crc32d(crc, v);
+   }
+
+   for (; length; length--)
+      crc = __crc32b(crc, *data++);
+
+   return crc;
+}
+#endif
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length)
+{
+   if (!hash_impl.init)
+      hash_init();
+
+   return ~hash_impl.crc32(~crc, data, length);
+}
+
+uint32_t crc32_calculate(const uint8_t *data, size_t length)
+{
+   return crc32_update(0, data, length);
+}
+
 /* SHA-1 implementation. */
 
 /*
@@ -299,7 +817,8 @@ static void SHA1Reset(SHA1Context *context)
    context->Corrupted  = 0;
 }
 
-static void SHA1ProcessMessageBlock(SHA1Context *context)
+static void sha1_blocks_c(uint32_t *state,
+      const uint8_t *data, size_t blocks)
 {
    const unsigned K[] =            /* Constants defined in SHA-1   */      
    {
@@ -313,80 +832,420 @@ static void SHA1ProcessMessageBlock(SHA1Context *context)
    unsigned    W[80];              /* Word sequence                */
    unsigned    A, B, C, D, E;      /* Word buffers                 */
 
-   /* Initialize the first 16 words in the array W */
-   for(t = 0; t < 16; t++)
+   for (; blocks; blocks--, data += 64)
    {
-      W[t] = ((unsigned) context->Message_Block[t * 4]) << 24;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 1]) << 16;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 2]) << 8;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 3]);
-   }
+      /* Initialize the first 16 words in the array W */
+      for(t = 0; t < 16; t++)
+         W[t] = hash_load32be(data + t * 4);
 
-   for(t = 16; t < 80; t++)
-      W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
+      for(t = 16; t < 80; t++)
+         W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
 
-   A = context->Message_Digest[0];
-   B = context->Message_Digest[1];
-   C = context->Message_Digest[2];
-   D = context->Message_Digest[3];
-   E = context->Message_Digest[4];
+      A = state[0];
+      B = state[1];
+      C = state[2];
+      D = state[3];
+      E = state[4];
 
-   for(t = 0; t < 20; t++)
-   {
-      temp =  SHA1CircularShift(5,A) +
-         ((B & C) | ((~B) & D)) + E + W[t] + K[0];
-      temp &= 0xFFFFFFFF;
-      E = D;
-      D = C;
-      C = SHA1CircularShift(30,B);
-      B = A;
-      A = temp;
-   }
+      for(t = 0; t < 20; t++)
+      {
+         temp =  SHA1CircularShift(5,A) +
+            ((B & C) | ((~B) & D)) + E + W[t] + K[0];
+         E = D;
+         D = C;
+         C = SHA1CircularShift(30,B);
+         B = A;
+         A = temp;
+      }
 
-   for(t = 20; t < 40; t++)
-   {
-      temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
-      temp &= 0xFFFFFFFF;
-      E = D;
-      D = C;
-      C = SHA1CircularShift(30,B);
-      B = A;
-      A = temp;
+      for(t = 20; t < 40; t++)
+      {
+         temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
+         E = D;
+         D = C;
+         C = SHA1CircularShift(30,B);
+         B = A;
+         A = temp;
+      }
+
+      for(t = 40; t < 60; t++)
+      {
+         temp = SHA1CircularShift(5,A) +
+            ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
+         E = D;
+         D = C;
+         C = SHA1CircularShift(30,B);
+         B = A;
+         A = temp;
+      }
+
+      for(t = 60; t < 80; t++)
+      {
+         temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
+         E = D;
+         D = C;
+         C = SHA1CircularShift(30,B);
+         B = A;
+         A = temp;
+      }
+
+      state[0] += A;
+      state[1] += B;
+      state[2] += C;
+      state[3] += D;
+      state[4] += E;
    }
+}
+
+#ifdef HASH_HAVE_X86
+/* SHA extensions keep A to D reversed in one register,
+ * and E in the top lane of another. */
+HASH_TARGET_SHA
+static void sha1_blocks_ni(uint32_t *state,
+      const uint8_t *data, size_t blocks)
+{
+   __m128i abcd, abcd_save, e0, e0_save, e1;
+   __m128i msg0, msg1, msg2, msg3;
+   const __m128i mask = _mm_set_epi64x(
+         0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
 
-   for(t = 40; t < 60; t++)
+   abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1b);
+   e0   = _mm_set_epi32(state[4], 0, 0, 0);
+
+   for (; blocks; blocks--, data += 64)
    {
-      temp = SHA1CircularShift(5,A) +
-         ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
-      temp &= 0xFFFFFFFF;
-      E = D;
-      D = C;
-      C = SHA1CircularShift(30,B);
-      B = A;
-      A = temp;
+      abcd_save = abcd;
+      e0_save   = e0;
+
+      /* Rounds 0-3 */
+      msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+      e0 = _mm_add_epi32(e0, msg0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      /* Rounds 4-7 */
+      msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+      /* Rounds 8-11 */
+      msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 12-15 */
+      msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 16-19 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 20-23 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 24-27 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 28-31 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 32-35 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 36-39 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 40-43 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 44-47 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 48-51 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 52-55 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 56-59 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 60-63 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 64-67 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 68-71 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 72-75 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+      /* Rounds 76-79 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+      e0   = _mm_sha1nexte_epu32(e0, e0_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
    }
 
-   for(t = 60; t < 80; t++)
+   _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1b));
+   state[4] = _mm_extract_epi32(e0, 3);
+}
+#endif
+
+#ifdef HASH_HAVE_ARM_SHA
+static void sha1_blocks_armv8(uint32_t *state,
+      const uint8_t *data, size_t blocks)
+{
+   uint32x4_t abcd, abcd_save, tmp;
+   uint32x4_t msg0, msg1, msg2, msg3;
+   uint32_t e0, e0_save, e1;
+
+   abcd = vld1q_u32(state);
+   e0   = state[4];
+
+   for (; blocks; blocks--, data += 64)
    {
-      temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
-      temp &= 0xFFFFFFFF;
-      E = D;
-      D = C;
-      C = SHA1CircularShift(30,B);
-      B = A;
-      A = temp;
+      abcd_save = abcd;
+      e0_save   = e0;
+
+      msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data +  0)));
+      msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+      msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+      msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+      /* Rounds 0-3 */
+      tmp = vaddq_u32(msg0, vdupq_n_u32(0x5a827999));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e0, tmp);
+
+      /* Rounds 4-7 */
+      tmp = vaddq_u32(msg1, vdupq_n_u32(0x5a827999));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e1, tmp);
+
+      /* Rounds 8-11 */
+      tmp = vaddq_u32(msg2, vdupq_n_u32(0x5a827999));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e0, tmp);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+      /* Rounds 12-15 */
+      tmp = vaddq_u32(msg3, vdupq_n_u32(0x5a827999));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e1, tmp);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+
+      /* Rounds 16-19 */
+      tmp = vaddq_u32(msg0, vdupq_n_u32(0x5a827999));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e0, tmp);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+
+      /* Rounds 20-23 */
+      tmp = vaddq_u32(msg1, vdupq_n_u32(0x6ed9eba1));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+
+      /* Rounds 24-27 */
+      tmp = vaddq_u32(msg2, vdupq_n_u32(0x6ed9eba1));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, tmp);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+
+      /* Rounds 28-31 */
+      tmp = vaddq_u32(msg3, vdupq_n_u32(0x6ed9eba1));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+
+      /* Rounds 32-35 */
+      tmp = vaddq_u32(msg0, vdupq_n_u32(0x6ed9eba1));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, tmp);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+
+      /* Rounds 36-39 */
+      tmp = vaddq_u32(msg1, vdupq_n_u32(0x6ed9eba1));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+
+      /* Rounds 40-43 */
+      tmp = vaddq_u32(msg2, vdupq_n_u32(0x8f1bbcdc));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1mq_u32(abcd, e0, tmp);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+
+      /* Rounds 44-47 */
+      tmp = vaddq_u32(msg3, vdupq_n_u32(0x8f1bbcdc));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1mq_u32(abcd, e1, tmp);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+
+      /* Rounds 48-51 */
+      tmp = vaddq_u32(msg0, vdupq_n_u32(0x8f1bbcdc));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1mq_u32(abcd, e0, tmp);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+
+      /* Rounds 52-55 */
+      tmp = vaddq_u32(msg1, vdupq_n_u32(0x8f1bbcdc));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1mq_u32(abcd, e1, tmp);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+
+      /* Rounds 56-59 */
+      tmp = vaddq_u32(msg2, vdupq_n_u32(0x8f1bbcdc));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1mq_u32(abcd, e0, tmp);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+
+      /* Rounds 60-63 */
+      tmp = vaddq_u32(msg3, vdupq_n_u32(0xca62c1d6));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+
+      /* Rounds 64-67 */
+      tmp = vaddq_u32(msg0, vdupq_n_u32(0xca62c1d6));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, tmp);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+
+      /* Rounds 68-71 */
+      tmp = vaddq_u32(msg1, vdupq_n_u32(0xca62c1d6));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+
+      /* Rounds 72-75 */
+      tmp = vaddq_u32(msg2, vdupq_n_u32(0xca62c1d6));
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, tmp);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+
+      /* Rounds 76-79 */
+      tmp = vaddq_u32(msg3, vdupq_n_u32(0xca62c1d6));
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, tmp);
+
+      e0   += e0_save;
+      abcd  = vaddq_u32(abcd, abcd_save);
    }
 
-   context->Message_Digest[0] =
-      (context->Message_Digest[0] + A) & 0xFFFFFFFF;
-   context->Message_Digest[1] =
-      (context->Message_Digest[1] + B) & 0xFFFFFFFF;
-   context->Message_Digest[2] =
-      (context->Message_Digest[2] + C) & 0xFFFFFFFF;
-   context->Message_Digest[3] =
-      (context->Message_Digest[3] + D) & 0xFFFFFFFF;
-   context->Message_Digest[4] =
-      (context->Message_Digest[4] + E) & 0xFFFFFFFF;
+   vst1q_u32(state, abcd);
+   state[4] = e0;
+}
+#endif
+
+static void SHA1ProcessMessageBlock(SHA1Context *context)
+{
+   if (!hash_impl.init)
+      hash_init();
+
+   hash_impl.sha1(context->Message_Digest, context->Message_Block, 1);
 
    context->Message_Block_Index = 0;
 }
@@ -448,6 +1307,8 @@ static void SHA1Input(     SHA1Context         *context,
                     const unsigned char *message_array,
                     unsigned            length)
 {
+   uint64_t bits;
+
    if (!length)
       return;
 
@@ -457,45 +1318,107 @@ static void SHA1Input(     SHA1Context         *context,
       return;
    }
 
-   while(length-- && !context->Corrupted)
+   bits = (((uint64_t)context->Length_High << 32) | context->Length_Low)
+      + (uint64_t)length * 8;
+   if (bits < (uint64_t)length * 8)
    {
-      context->Message_Block[context->Message_Block_Index++] =
-         (*message_array & 0xFF);
+      context->Corrupted = 1; /* Message is too long */
+      return;
+   }
+   context->Length_Low  = (uint32_t)bits;
+   context->Length_High = (uint32_t)(bits >> 32);
 
-      context->Length_Low += 8;
-      /* Force it to 32 bits */
-      context->Length_Low &= 0xFFFFFFFF;
-      if (context->Length_Low == 0)
-      {
-         context->Length_High++;
-         /* Force it to 32 bits */
-         context->Length_High &= 0xFFFFFFFF;
-         if (context->Length_High == 0)
-            context->Corrupted = 1; /* Message is too long */
-      }
+   /* Tops up a partial block first, then hashes whole
+    * blocks straight from the input. */
+   while (length && context->Message_Block_Index)
+   {
+      context->Message_Block[context->Message_Block_Index++] = *message_array++;
+      length--;
 
       if (context->Message_Block_Index == 64)
          SHA1ProcessMessageBlock(context);
+   }
+
+   if (length >= 64)
+   {
+      if (!hash_impl.init)
+         hash_init();
 
-      message_array++;
+      hash_impl.sha1(context->Message_Digest, message_array, length >> 6);
+      message_array += length & ~63u;
+      length        &= 63;
    }
+
+   memcpy(context->Message_Block, message_array, length);
+   context->Message_Block_Index = length;
+}
+
+/**
+ * hash_init:
+ *
+ * Picks the fastest CRC32, SHA-1 and SHA-256 kernels
+ * the CPU runs.
+ **/
+static void hash_init(void)
+{
+#ifdef HASH_HAVE_X86
+   const uint64_t sha_mask = RETRO_SIMD_SHA | RETRO_SIMD_SSSE3 | RETRO_SIMD_SSE4;
+   uint64_t cpu = rarch_get_cpu_features();
+#endif
+
+   crc32_slice_init();
+
+   hash_impl.crc32  = crc32_slice8;
+   hash_impl.sha1   = sha1_blocks_c;
+   hash_impl.sha256 = sha256_blocks_c;
+
+#ifdef HASH_HAVE_X86
+   if ((cpu & (RETRO_SIMD_PCLMUL | RETRO_SIMD_SSE2)) ==
+         (RETRO_SIMD_PCLMUL | RETRO_SIMD_SSE2))
+      hash_impl.crc32 = crc32_fold_clmul;
+
+   if ((cpu & sha_mask) == sha_mask)
+   {
+      hash_impl.sha1   = sha1_blocks_ni;
+      hash_impl.sha256 = sha256_blocks_ni;
+   }
+#endif
+
+#ifdef HASH_HAVE_ARM_CRC32
+   hash_impl.crc32  = crc32_armv8;
+#endif
+#ifdef HASH_HAVE_ARM_SHA
+   hash_impl.sha1   = sha1_blocks_armv8;
+   hash_impl.sha256 = sha256_blocks_armv8;
+#endif
+
+   /* Threads racing here all store the same kernels. */
+   hash_impl.init = true;
 }
 
+/* Big enough reads that the kernels, not the syscalls,
+ * set the pace. */
+#define SHA1_READ_SIZE (64 * 1024)
+
 int sha1_calculate(const char *path, char *result)
 {
-   unsigned char buff[4096];
    SHA1Context sha;
    int rv = 1;
+   unsigned char *buff = NULL;
    int fd = open(path, O_RDONLY);
 
    if (fd < 0)
       goto error;
 
+   buff = (unsigned char*)malloc(SHA1_READ_SIZE);
+   if (!buff)
+      goto error;
+
    SHA1Reset(&sha);
 
    do
    {
-      rv = read(fd, buff, 4096);
+      rv = read(fd, buff, SHA1_READ_SIZE);
       if (rv < 0)
          goto error;
 
@@ -511,10 +1434,12 @@ int sha1_calculate(const char *path, char *result)
          sha.Message_Digest[2],
          sha.Message_Digest[3], sha.Message_Digest[4]);
 
+   free(buff);
    close(fd);
    return 0;
 
 error:
+   free(buff);
    if (fd >= 0)
       close(fd);
    return -1;
@@ -52,28 +52,34 @@
  * for comparing with the cheat XML values. */
 void sha256_hash(char *out, const uint8_t *in, size_t size);
 
-#ifdef HAVE_ZLIB
-#include <zlib.h>
-
-static inline uint32_t crc32_calculate(const uint8_t *data, size_t length)
+struct sha256_ctx
 {
-   return crc32(0, data, length);
-}
+   uint8_t in[64];
+   unsigned inlen;
 
-static inline uint32_t crc32_adjust(uint32_t crc, uint8_t data)
-{
-   /* zlib and nall have different
-    * assumptions on "sign" for this function. */
-   return ~crc32(~crc, &data, 1);
-}
-#else
+   uint32_t h[8];
+   uint64_t len;
+};
+
+/* Same as sha256_hash(), over data which comes in pieces.
+ * @out of sha256_end() needs 65 bytes. */
+void sha256_begin(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const uint8_t *in, size_t size);
+void sha256_end(struct sha256_ctx *ctx, char *out);
+
+/* Same CRC32 as zlib's crc32(), on PCLMULQDQ or the ARMv8 CRC32
+ * instructions where the CPU has them. */
 uint32_t crc32_calculate(const uint8_t *data, size_t length);
+
+/* Carries on a crc32_calculate() over more data. */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length);
+
+/* Adds a byte to a CRC that is kept inverted in between. */
 uint32_t crc32_adjust(uint32_t crc, uint8_t data);
-#endif
 
 typedef struct SHA1Context
 {
-   unsigned Message_Digest[5]; /* Message Digest (output)          */
+   uint32_t Message_Digest[5]; /* Message Digest (output)          */
 
    unsigned Length_Low;        /* Message length in bits           */
    unsigned Length_High;       /* Message length in bits           */
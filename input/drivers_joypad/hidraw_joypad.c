@@ -0,0 +1,987 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Joypads read straight from hidraw. Report descriptors are
+ * parsed here, so reports go from the device to the pad state
+ * without evdev in between. Reports are read on a thread, as
+ * fast as the device sends them, and the main thread takes the
+ * latest state when polling. */
+
+#include "../input_autodetect.h"
+#include "../input_common.h"
+#include "../../general.h"
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+#include <linux/hidraw.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#ifndef IS_JOYCONFIG
+#include "../../performance.h"
+#endif
+
+/* retroarch-joyconfig does not link against threads. */
+#if defined(HAVE_THREADS) && !defined(IS_JOYCONFIG)
+#define HIDRAW_THREADED
+#include <rthreads/rthreads.h>
+#endif
+
+#define HIDRAW_NUM_BUTTONS 32
+#define HIDRAW_NUM_AXES 8
+#define HIDRAW_NUM_HATS 4
+#define HIDRAW_MAX_FIELDS 128
+#define HIDRAW_MAX_USAGES 64
+
+/* /dev/hidraw0 up to this one are looked at on init. */
+#define HIDRAW_MAX_DEVICES 64
+
+/* Largest report the kernel hands out. */
+#define HIDRAW_REPORT_SIZE 4096
+
+#define HID_PAGE_GENERIC_DESKTOP 0x01
+#define HID_PAGE_BUTTON 0x09
+#define HID_USAGE_JOYSTICK 0x04
+#define HID_USAGE_GAMEPAD 0x05
+#define HID_USAGE_MULTI_AXIS 0x08
+#define HID_USAGE_X 0x30
+#define HID_USAGE_HAT_SWITCH 0x39
+
+enum hidraw_field_type
+{
+   HIDRAW_FIELD_BUTTON = 0,
+   HIDRAW_FIELD_AXIS,
+   HIDRAW_FIELD_HAT
+};
+
+/* Where an input lives in the reports of a pad. */
+struct hidraw_field
+{
+   uint8_t report_id;
+   uint8_t type;
+   uint8_t index;
+   uint8_t size;
+   uint16_t offset;
+   int32_t logical_min;
+   int32_t logical_max;
+};
+
+struct hidraw_state
+{
+   uint32_t buttons;
+   int16_t axes[HIDRAW_NUM_AXES];
+   uint16_t hats[HIDRAW_NUM_HATS];
+};
+
+struct hidraw_joypad
+{
+   int fd;
+   unsigned dev;
+   char *ident;
+
+   struct hidraw_field fields[HIDRAW_MAX_FIELDS];
+   unsigned num_fields;
+   unsigned num_hats;
+   bool report_ids;
+   bool read_failed;
+
+   /* Updated by the reader, seq is odd while it does. */
+   volatile unsigned seq;
+   struct hidraw_state state;
+
+   /* State as of the last poll. */
+   struct hidraw_state polled;
+
+#ifdef HIDRAW_THREADED
+   uint64_t reports;
+   retro_time_t first_report;
+   retro_time_t last_report;
+#endif
+};
+
+static struct hidraw_joypad hidraw_pads[MAX_USERS];
+static int g_hidraw_notify = -1;
+static bool g_hidraw_hotplug;
+
+#ifdef HIDRAW_THREADED
+/* Guards the fds of pads against the reader thread. */
+static slock_t *g_hidraw_lock;
+static sthread_t *g_hidraw_thread;
+static int g_hidraw_wake[2] = { -1, -1 };
+static volatile bool g_hidraw_quit;
+#endif
+
+/* Globals of the report descriptor parser. */
+struct hidraw_globals
+{
+   uint32_t usage_page;
+   int32_t logical_min;
+   int32_t logical_max;
+   uint32_t report_size;
+   uint32_t report_count;
+   uint8_t report_id;
+};
+
+static uint32_t hidraw_item_udata(const uint8_t *data, unsigned size)
+{
+   unsigned i;
+   uint32_t value = 0;
+
+   for (i = 0; i < size; i++)
+      value |= (uint32_t)data[i] << (8 * i);
+   return value;
+}
+
+static int32_t hidraw_item_sdata(const uint8_t *data, unsigned size)
+{
+   uint32_t value = hidraw_item_udata(data, size);
+
+   if (size && size < 4 && (value & (1u << (8 * size - 1))))
+      value |= ~0u << (8 * size);
+   return (int32_t)value;
+}
+
+static void hidraw_add_field(struct hidraw_joypad *pad,
+      const struct hidraw_globals *g, uint32_t usage, unsigned offset)
+{
+   struct hidraw_field *field = NULL;
+   unsigned page              = usage >> 16;
+   unsigned id                = usage & 0xffff;
+
+   if (pad->num_fields >= HIDRAW_MAX_FIELDS
+         || !g->report_size || g->report_size > 32
+         || offset + g->report_size > HIDRAW_REPORT_SIZE * 8)
+      return;
+
+   field = &pad->fields[pad->num_fields];
+
+   if (page == HID_PAGE_BUTTON && id >= 1 && id <= HIDRAW_NUM_BUTTONS)
+   {
+      field->type  = HIDRAW_FIELD_BUTTON;
+      field->index = id - 1;
+   }
+   else if (page == HID_PAGE_GENERIC_DESKTOP && id >= HID_USAGE_X
+         && id < HID_USAGE_X + HIDRAW_NUM_AXES)
+   {
+      field->type  = HIDRAW_FIELD_AXIS;
+      field->index = id - HID_USAGE_X;
+   }
+   else if (page == HID_PAGE_GENERIC_DESKTOP && id == HID_USAGE_HAT_SWITCH
+         && pad->num_hats < HIDRAW_NUM_HATS)
+   {
+      field->type  = HIDRAW_FIELD_HAT;
+      field->index = pad->num_hats++;
+   }
+   else
+      return;
+
+   field->report_id   = g->report_id;
+   field->size        = g->report_size;
+   field->offset      = offset;
+   field->logical_min = g->logical_min;
+   field->logical_max = g->logical_max;
+   pad->num_fields++;
+}
+
+/**
+ * hidraw_parse_descriptor:
+ * @pad                   : Pad to fill the fields of.
+ * @desc                  : Report descriptor.
+ * @len                   : Length of @desc.
+ *
+ * Picks the buttons, axes and hat switches out of the joystick,
+ * gamepad and multi-axis collections of a report descriptor.
+ * Array inputs are skipped, pads report their inputs as
+ * variables.
+ *
+ * Returns: true (1) if the device is a joypad, otherwise false (0).
+ **/
+static bool hidraw_parse_descriptor(struct hidraw_joypad *pad,
+      const uint8_t *desc, size_t len)
+{
+   unsigned n;
+   size_t i = 0;
+   struct hidraw_globals g, stack[4];
+   uint32_t usages[HIDRAW_MAX_USAGES];
+   uint32_t usage_min = 0, usage_max = 0;
+   unsigned num_usages = 0, sp = 0, depth = 0;
+   bool has_range = false, in_joypad = false;
+   /* Bits so far in every report. */
+   static uint32_t offsets[256];
+
+   memset(&g, 0, sizeof(g));
+   memset(offsets, 0, sizeof(offsets));
+
+   pad->num_fields = 0;
+   pad->num_hats   = 0;
+   pad->report_ids = false;
+
+   while (i < len)
+   {
+      uint32_t udata;
+      int32_t sdata;
+      uint8_t prefix = desc[i++];
+      unsigned size  = prefix & 3;
+      unsigned type  = (prefix >> 2) & 3;
+      unsigned tag   = prefix >> 4;
+
+      /* Long items, reserved and never used. */
+      if (prefix == 0xfe)
+      {
+         if (i >= len)
+            break;
+         i += 2 + desc[i];
+         continue;
+      }
+
+      if (size == 3)
+         size = 4;
+      if (i + size > len)
+         break;
+
+      udata = hidraw_item_udata(desc + i, size);
+      sdata = hidraw_item_sdata(desc + i, size);
+      i    += size;
+
+      switch (type)
+      {
+         case 0: /* Main */
+            switch (tag)
+            {
+               case 0x8: /* Input */
+                  /* Constants are padding, arrays are left out. */
+                  if (in_joypad && !(udata & 1) && (udata & 2))
+                  {
+                     for (n = 0; n < g.report_count; n++)
+                     {
+                        uint32_t usage;
+
+                        if (num_usages)
+                           usage = usages[n < num_usages ? n : num_usages - 1];
+                        else if (has_range)
+                           usage = min(usage_min + n, usage_max);
+                        else
+                           break;
+
+                        hidraw_add_field(pad, &g, usage,
+                              offsets[g.report_id] + n * g.report_size);
+                     }
+                  }
+
+                  offsets[g.report_id] += g.report_size * g.report_count;
+                  break;
+               case 0xa: /* Collection */
+                  /* Application collections at the top tell
+                   * what the device is. */
+                  if (!depth)
+                  {
+                     uint32_t usage = num_usages ? usages[0] : usage_min;
+
+                     in_joypad = udata == 1
+                        && (usage >> 16) == HID_PAGE_GENERIC_DESKTOP
+                        && ((usage & 0xffff) == HID_USAGE_JOYSTICK
+                              || (usage & 0xffff) == HID_USAGE_GAMEPAD
+                              || (usage & 0xffff) == HID_USAGE_MULTI_AXIS);
+                  }
+                  depth++;
+                  break;
+               case 0xc: /* End Collection */
+                  if (depth)
+                     depth--;
+                  if (!depth)
+                     in_joypad = false;
+                  break;
+            }
+
+            num_usages = 0;
+            has_range  = false;
+            usage_min  = usage_max = 0;
+            break;
+
+         case 1: /* Global */
+            switch (tag)
+            {
+               case 0x0:
+                  g.usage_page = udata;
+                  break;
+               case 0x1:
+                  g.logical_min = sdata;
+                  break;
+               case 0x2:
+                  /* Unsigned unless the minimum is negative. */
+                  g.logical_max = g.logical_min < 0 ? sdata : (int32_t)udata;
+                  break;
+               case 0x7:
+                  g.report_size = udata;
+                  break;
+               case 0x8:
+                  g.report_id     = udata;
+                  pad->report_ids = true;
+                  break;
+               case 0x9:
+                  g.report_count = udata;
+                  break;
+               case 0xa: /* Push */
+                  if (sp < ARRAY_SIZE(stack))
+                     stack[sp++] = g;
+                  break;
+               case 0xb: /* Pop */
+                  if (sp)
+                     g = stack[--sp];
+                  break;
+            }
+            break;
+
+         case 2: /* Local */
+            /* Four byte usages carry their page. */
+            if (size != 4)
+               udata |= g.usage_page << 16;
+
+            switch (tag)
+            {
+               case 0x0:
+                  if (num_usages < HIDRAW_MAX_USAGES)
+                     usages[num_usages++] = udata;
+                  break;
+               case 0x1:
+                  usage_min = udata;
+                  has_range = true;
+                  break;
+               case 0x2:
+                  usage_max = udata;
+                  has_range = true;
+                  break;
+            }
+            break;
+      }
+   }
+
+   return pad->num_fields > 0;
+}
+
+static uint32_t hidraw_report_bits(const uint8_t *data,
+      unsigned offset, unsigned size)
+{
+   unsigned i;
+   uint32_t value = 0;
+
+   for (i = 0; i < size; i++)
+   {
+      unsigned bit = offset + i;
+      if (data[bit >> 3] & (1 << (bit & 7)))
+         value |= 1u << i;
+   }
+
+   return value;
+}
+
+static const uint16_t hidraw_hat_dirs[8] = {
+   HAT_UP_MASK,
+   HAT_UP_MASK | HAT_RIGHT_MASK,
+   HAT_RIGHT_MASK,
+   HAT_DOWN_MASK | HAT_RIGHT_MASK,
+   HAT_DOWN_MASK,
+   HAT_DOWN_MASK | HAT_LEFT_MASK,
+   HAT_LEFT_MASK,
+   HAT_UP_MASK | HAT_LEFT_MASK,
+};
+
+/**
+ * hidraw_parse_report:
+ * @pad                   : Pad the report came from.
+ * @state                 : State to update.
+ * @report                : Report, with its ID if the pad uses them.
+ * @len                   : Length of @report.
+ *
+ * Updates @state with the inputs in @report. Inputs in
+ * other reports keep their state.
+ **/
+static void hidraw_parse_report(const struct hidraw_joypad *pad,
+      struct hidraw_state *state, const uint8_t *report, size_t len)
+{
+   unsigned i;
+   uint8_t id = 0;
+
+   if (pad->report_ids)
+   {
+      if (!len)
+         return;
+      id = *report++;
+      len--;
+   }
+
+   for (i = 0; i < pad->num_fields; i++)
+   {
+      int32_t value;
+      int64_t range;
+      const struct hidraw_field *field = &pad->fields[i];
+
+      if (field->report_id != id
+            || field->offset + field->size > len * 8)
+         continue;
+
+      value = (int32_t)hidraw_report_bits(report,
+            field->offset, field->size);
+
+      if (field->logical_min < 0 && field->size < 32
+            && (value & (1 << (field->size - 1))))
+         value |= ~0u << field->size;
+
+      range = (int64_t)field->logical_max - field->logical_min;
+
+      switch (field->type)
+      {
+         case HIDRAW_FIELD_BUTTON:
+            if (value)
+               BIT32_SET(state->buttons, field->index);
+            else
+               BIT32_CLEAR(state->buttons, field->index);
+            break;
+         case HIDRAW_FIELD_AXIS:
+            if (range > 0)
+            {
+               int64_t val = ((int64_t)value - field->logical_min)
+                  * 0xfffe / range - 0x7fff;
+               state->axes[field->index] =
+                  max(-0x7fff, min(0x7fff, val));
+            }
+            break;
+         case HIDRAW_FIELD_HAT:
+         {
+            int64_t dir = (int64_t)value - field->logical_min;
+
+            /* Four way hats skip the diagonals. */
+            if (range == 3)
+               dir *= 2;
+
+            /* Anything out of range is the centered hat. */
+            state->hats[field->index] = (dir >= 0 && dir < 8
+                  && value <= field->logical_max) ? hidraw_hat_dirs[dir] : 0;
+            break;
+         }
+      }
+   }
+}
+
+/**
+ * hidraw_joypad_read:
+ * @pad                   : Pad to read.
+ * @report                : Buffer of HIDRAW_REPORT_SIZE bytes.
+ *
+ * Applies the reports waiting on @pad to its state.
+ **/
+static void hidraw_joypad_read(struct hidraw_joypad *pad, uint8_t *report)
+{
+   for (;;)
+   {
+      ssize_t len = read(pad->fd, report, HIDRAW_REPORT_SIZE);
+#ifndef IS_JOYCONFIG
+      uint32_t old_buttons = pad->state.buttons;
+#endif
+
+      if (len <= 0)
+      {
+         if (len < 0 && errno != EAGAIN && errno != EINTR)
+            pad->read_failed = true;
+         break;
+      }
+
+      pad->seq++;
+#ifdef HIDRAW_THREADED
+      __sync_synchronize();
+#endif
+      hidraw_parse_report(pad, &pad->state, report, len);
+#ifdef HIDRAW_THREADED
+      __sync_synchronize();
+#endif
+      pad->seq++;
+
+#ifndef IS_JOYCONFIG
+      if (pad->state.buttons & ~old_buttons)
+         rarch_latency_test_input_event(rarch_get_time_usec());
+#endif
+
+#ifdef HIDRAW_THREADED
+      pad->last_report = rarch_get_time_usec();
+      if (!pad->reports++)
+         pad->first_report = pad->last_report;
+#endif
+   }
+}
+
+/* Takes the state of @pad for this frame. */
+static void hidraw_joypad_snapshot(struct hidraw_joypad *pad)
+{
+#ifdef HIDRAW_THREADED
+   unsigned seq;
+
+   do
+   {
+      seq = pad->seq;
+      __sync_synchronize();
+      memcpy(&pad->polled, &pad->state, sizeof(pad->polled));
+      __sync_synchronize();
+   } while ((seq & 1) || seq != pad->seq);
+#else
+   pad->polled = pad->state;
+#endif
+}
+
+#ifdef HIDRAW_THREADED
+static void hidraw_joypad_wake(void)
+{
+   char c = 0;
+
+   if (write(g_hidraw_wake[1], &c, 1) < 0)
+      RARCH_ERR("[hidraw]: Failed to wake reader thread.\n");
+}
+
+static void hidraw_joypad_thread(void *data)
+{
+   static uint8_t report[HIDRAW_REPORT_SIZE];
+   struct pollfd fds[MAX_USERS + 1];
+   unsigned ports[MAX_USERS + 1];
+
+   (void)data;
+
+   while (!g_hidraw_quit)
+   {
+      unsigned i, num = 1;
+
+      fds[0].fd     = g_hidraw_wake[0];
+      fds[0].events = POLLIN;
+
+      slock_lock(g_hidraw_lock);
+      for (i = 0; i < MAX_USERS; i++)
+      {
+         if (hidraw_pads[i].fd < 0 || hidraw_pads[i].read_failed)
+            continue;
+
+         fds[num].fd     = hidraw_pads[i].fd;
+         fds[num].events = POLLIN;
+         ports[num++]    = i;
+      }
+      slock_unlock(g_hidraw_lock);
+
+      if (poll(fds, num, -1) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         RARCH_ERR("[hidraw]: Reader thread failed to poll: %s.\n",
+               strerror(errno));
+         break;
+      }
+
+      /* Pads changed, or time to quit. */
+      if (fds[0].revents)
+      {
+         char buf[64];
+         while (read(g_hidraw_wake[0], buf, sizeof(buf)) > 0);
+         continue;
+      }
+
+      slock_lock(g_hidraw_lock);
+      for (i = 1; i < num; i++)
+      {
+         struct hidraw_joypad *pad = &hidraw_pads[ports[i]];
+
+         if (fds[i].revents && pad->fd == fds[i].fd)
+            hidraw_joypad_read(pad, report);
+      }
+      slock_unlock(g_hidraw_lock);
+   }
+}
+#endif
+
+static void hidraw_joypad_close(unsigned port)
+{
+   int fd;
+   struct hidraw_joypad *pad = &hidraw_pads[port];
+
+   if (pad->fd < 0)
+      return;
+
+#ifndef IS_JOYCONFIG
+   if (g_hidraw_hotplug)
+   {
+      char msg[512];
+      snprintf(msg, sizeof(msg), "Joypad #%u (%s) disconnected.",
+            port, pad->ident);
+      msg_queue_push(g_extern.msg_queue, msg, 0, 60);
+   }
+#endif
+
+   RARCH_LOG("[hidraw]: Joypad %s disconnected.\n", pad->ident);
+
+#ifdef HIDRAW_THREADED
+   slock_lock(g_hidraw_lock);
+#endif
+   fd      = pad->fd;
+   pad->fd = -1;
+#ifdef HIDRAW_THREADED
+   slock_unlock(g_hidraw_lock);
+   hidraw_joypad_wake();
+
+   if (pad->reports > 1 && pad->last_report > pad->first_report)
+      RARCH_LOG("[hidraw]: %llu reports, %.0f per second.\n",
+            (unsigned long long)pad->reports,
+            (pad->reports - 1) * 1000000.0
+            / (pad->last_report - pad->first_report));
+#endif
+
+   close(fd);
+
+   memset(&pad->state, 0, sizeof(pad->state));
+   memset(&pad->polled, 0, sizeof(pad->polled));
+   *pad->ident = '\0';
+
+   input_config_autoconfigure_joypad(port, NULL, 0, 0, NULL);
+}
+
+static bool hidraw_joypad_open(unsigned dev)
+{
+   int fd, desc_size = 0;
+   unsigned i, port = MAX_USERS;
+   char path[PATH_MAX];
+   struct hidraw_devinfo info;
+   struct hidraw_report_descriptor desc;
+   struct hidraw_joypad *pad = NULL;
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      if (hidraw_pads[i].fd >= 0 && hidraw_pads[i].dev == dev)
+         return false;
+      if (hidraw_pads[i].fd < 0 && port == MAX_USERS)
+         port = i;
+   }
+
+   if (port == MAX_USERS)
+      return false;
+
+   snprintf(path, sizeof(path), "/dev/hidraw%u", dev);
+
+   /* Device can have just been created, but not made accessible (yet).
+    * IN_ATTRIB will signal when permissions change. */
+   if (access(path, R_OK) < 0)
+      return false;
+
+   fd = open(path, O_RDONLY | O_NONBLOCK);
+   if (fd < 0)
+      return false;
+
+   memset(&desc, 0, sizeof(desc));
+   if (ioctl(fd, HIDIOCGRDESCSIZE, &desc_size) < 0
+         || desc_size <= 0 || desc_size > HID_MAX_DESCRIPTOR_SIZE)
+      goto error;
+
+   desc.size = desc_size;
+   if (ioctl(fd, HIDIOCGRDESC, &desc) < 0)
+      goto error;
+
+   /* The reader thread leaves pads without fd alone. */
+   pad = &hidraw_pads[port];
+   if (!hidraw_parse_descriptor(pad, desc.value, desc.size))
+      goto error;
+
+   memset(&info, 0, sizeof(info));
+   ioctl(fd, HIDIOCGRAWINFO, &info);
+
+   *pad->ident = '\0';
+   if (ioctl(fd, HIDIOCGRAWNAME(sizeof(g_settings.input.device_names[0])),
+            pad->ident) < 0)
+      *pad->ident = '\0';
+
+   RARCH_LOG("[hidraw]: Found pad: %s on %s, %u inputs.\n",
+         pad->ident, path, pad->num_fields);
+
+#ifndef IS_JOYCONFIG
+   if (g_hidraw_hotplug)
+   {
+      char msg[512];
+      snprintf(msg, sizeof(msg), "Joypad #%u (%s) connected.",
+            port, pad->ident);
+      msg_queue_push(g_extern.msg_queue, msg, 0, 60);
+   }
+#endif
+
+   memset(&pad->state, 0, sizeof(pad->state));
+   memset(&pad->polled, 0, sizeof(pad->polled));
+   pad->dev         = dev;
+   pad->read_failed = false;
+#ifdef HIDRAW_THREADED
+   pad->reports     = 0;
+
+   slock_lock(g_hidraw_lock);
+#endif
+   pad->fd = fd;
+#ifdef HIDRAW_THREADED
+   slock_unlock(g_hidraw_lock);
+   hidraw_joypad_wake();
+#endif
+
+   input_config_autoconfigure_joypad(port, pad->ident,
+         (uint16_t)info.vendor, (uint16_t)info.product, "hidraw");
+   return true;
+
+error:
+   close(fd);
+   return false;
+}
+
+static void hidraw_joypad_handle_hotplug(void)
+{
+   int i, rc;
+   size_t event_size = sizeof(struct inotify_event) + NAME_MAX + 1;
+   uint8_t *event_buf = (uint8_t*)calloc(1, event_size);
+
+   if (!event_buf)
+      return;
+
+   while ((rc = read(g_hidraw_notify, event_buf, event_size)) >= 0)
+   {
+      struct inotify_event *event = NULL;
+
+      /* Can read multiple events in one read() call. */
+      for (i = 0; i < rc; i += event->len + sizeof(struct inotify_event))
+      {
+         unsigned dev, port;
+
+         event = (struct inotify_event*)&event_buf[i];
+
+         if (strstr(event->name, "hidraw") != event->name)
+            continue;
+
+         dev = strtoul(event->name + 6, NULL, 10);
+
+         if (event->mask & IN_DELETE)
+         {
+            for (port = 0; port < MAX_USERS; port++)
+               if (hidraw_pads[port].fd >= 0 && hidraw_pads[port].dev == dev)
+                  hidraw_joypad_close(port);
+         }
+         /* Sometimes, device will be created before access to it
+          * is established. */
+         else if (event->mask & (IN_CREATE | IN_ATTRIB))
+            hidraw_joypad_open(dev);
+      }
+   }
+
+   free(event_buf);
+}
+
+static void hidraw_joypad_poll(void)
+{
+   unsigned i;
+#ifndef HIDRAW_THREADED
+   static uint8_t report[HIDRAW_REPORT_SIZE];
+#endif
+
+   if (g_hidraw_notify >= 0)
+      hidraw_joypad_handle_hotplug();
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      struct hidraw_joypad *pad = &hidraw_pads[i];
+
+      if (pad->fd < 0)
+         continue;
+
+#ifndef HIDRAW_THREADED
+      if (!pad->read_failed)
+         hidraw_joypad_read(pad, report);
+#endif
+      hidraw_joypad_snapshot(pad);
+   }
+}
+
+static void hidraw_joypad_destroy(void)
+{
+   unsigned i;
+
+   g_hidraw_hotplug = false;
+
+#ifdef HIDRAW_THREADED
+   if (g_hidraw_thread)
+   {
+      g_hidraw_quit = true;
+      hidraw_joypad_wake();
+      sthread_join(g_hidraw_thread);
+   }
+   g_hidraw_thread = NULL;
+   g_hidraw_quit   = false;
+#endif
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      if (hidraw_pads[i].fd >= 0)
+         close(hidraw_pads[i].fd);
+   }
+
+   memset(hidraw_pads, 0, sizeof(hidraw_pads));
+
+   for (i = 0; i < MAX_USERS; i++)
+      hidraw_pads[i].fd = -1;
+
+   if (g_hidraw_notify >= 0)
+      close(g_hidraw_notify);
+   g_hidraw_notify = -1;
+
+#ifdef HIDRAW_THREADED
+   for (i = 0; i < 2; i++)
+   {
+      if (g_hidraw_wake[i] >= 0)
+         close(g_hidraw_wake[i]);
+      g_hidraw_wake[i] = -1;
+   }
+
+   if (g_hidraw_lock)
+      slock_free(g_hidraw_lock);
+   g_hidraw_lock = NULL;
+#endif
+}
+
+static bool hidraw_joypad_init(void)
+{
+   unsigned i;
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      hidraw_pads[i].fd    = -1;
+      hidraw_pads[i].ident = g_settings.input.device_names[i];
+   }
+
+#ifdef HIDRAW_THREADED
+   g_hidraw_lock = slock_new();
+   if (!g_hidraw_lock || pipe(g_hidraw_wake) < 0)
+      goto error;
+
+   fcntl(g_hidraw_wake[0], F_SETFL,
+         fcntl(g_hidraw_wake[0], F_GETFL) | O_NONBLOCK);
+
+   g_hidraw_thread = sthread_create(hidraw_joypad_thread, NULL);
+   if (!g_hidraw_thread)
+      goto error;
+#endif
+
+   for (i = 0; i < HIDRAW_MAX_DEVICES; i++)
+      hidraw_joypad_open(i);
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      if (hidraw_pads[i].fd < 0)
+         input_config_autoconfigure_joypad(i, NULL, 0, 0, NULL);
+   }
+
+   g_hidraw_notify = inotify_init();
+   if (g_hidraw_notify >= 0)
+   {
+      fcntl(g_hidraw_notify, F_SETFL,
+            fcntl(g_hidraw_notify, F_GETFL) | O_NONBLOCK);
+      inotify_add_watch(g_hidraw_notify, "/dev",
+            IN_DELETE | IN_CREATE | IN_ATTRIB);
+   }
+
+   g_hidraw_hotplug = true;
+
+   return true;
+
+#ifdef HIDRAW_THREADED
+error:
+   RARCH_ERR("[hidraw]: Failed to start reader thread.\n");
+   hidraw_joypad_destroy();
+   return false;
+#endif
+}
+
+static bool hidraw_joypad_hat(const struct hidraw_joypad *pad, uint16_t hat)
+{
+   unsigned h = GET_HAT(hat);
+
+   if (h >= HIDRAW_NUM_HATS)
+      return false;
+   return pad->polled.hats[h] & GET_HAT_DIR(hat);
+}
+
+static bool hidraw_joypad_button(unsigned port, uint16_t joykey)
+{
+   const struct hidraw_joypad *pad =
+      (const struct hidraw_joypad*)&hidraw_pads[port];
+
+   if (GET_HAT_DIR(joykey))
+      return hidraw_joypad_hat(pad, joykey);
+   return joykey < HIDRAW_NUM_BUTTONS && BIT32_GET(pad->polled.buttons, joykey);
+}
+
+static int16_t hidraw_joypad_axis(unsigned port, uint32_t joyaxis)
+{
+   int16_t val = 0;
+   const struct hidraw_joypad *pad = NULL;
+
+   if (joyaxis == AXIS_NONE)
+      return 0;
+
+   pad = (const struct hidraw_joypad*)&hidraw_pads[port];
+
+   if (AXIS_NEG_GET(joyaxis) < HIDRAW_NUM_AXES)
+   {
+      val = pad->polled.axes[AXIS_NEG_GET(joyaxis)];
+      if (val > 0)
+         val = 0;
+   }
+   else if (AXIS_POS_GET(joyaxis) < HIDRAW_NUM_AXES)
+   {
+      val = pad->polled.axes[AXIS_POS_GET(joyaxis)];
+      if (val < 0)
+         val = 0;
+   }
+
+   return val;
+}
+
+static bool hidraw_joypad_query_pad(unsigned pad)
+{
+   return pad < MAX_USERS && hidraw_pads[pad].fd >= 0;
+}
+
+static const char *hidraw_joypad_name(unsigned pad)
+{
+   if (pad >= MAX_USERS)
+      return NULL;
+
+   return *hidraw_pads[pad].ident ? hidraw_pads[pad].ident : NULL;
+}
+
+rarch_joypad_driver_t hidraw_joypad = {
+   hidraw_joypad_init,
+   hidraw_joypad_query_pad,
+   hidraw_joypad_destroy,
+   hidraw_joypad_button,
+   hidraw_joypad_axis,
+   hidraw_joypad_poll,
+   NULL,
+   hidraw_joypad_name,
+   "hidraw",
+};
@@ -20,6 +20,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../general.h"
 
@@ -37,73 +43,432 @@ static void input_autoconfigure_joypad_conf(config_file_t *conf,
    }
 }
 
-static bool input_try_autoconfigure_joypad_from_conf(config_file_t *conf,
-      unsigned idx, const char *name, const char *drv,
-      int32_t vid, int32_t pid, bool block_osd_spam)
+/* A profile as far as matching goes. Profiles are parsed once
+ * into the index, a hotplug only parses the ones it picked. */
+struct autoconfig_profile
+{
+   char *ident;
+   char *driver;
+   int vid;
+   int pid;
+
+   /* Index into input_builtin_autoconfs, or -1 for files. */
+   int builtin;
+   char *path;
+   time_t mtime;
+   off_t size;
+};
+
+struct autoconfig_index
 {
-   char ident[PATH_MAX_LENGTH], ident_idx[PATH_MAX_LENGTH];
-   char input_driver[PATH_MAX_LENGTH], msg[PATH_MAX_LENGTH];
-   int input_vid = 0, input_pid = 0;
-   bool cond_found_idx, cond_found_general,
-        cond_found_vid = false, cond_found_pid = false;
+   struct autoconfig_profile *profiles;
+   size_t size;
+   size_t cap;
+   bool builtin_loaded;
+};
+
+/* A pad to autoconfigure, and the result of doing so. */
+struct autoconfig_request
+{
+   bool pending;
+   bool done;
+   bool block_osd_spam;
 
-   if (!conf)
-      return false;
+   char name[PATH_MAX_LENGTH];
+   char driver[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   int32_t vid;
+   int32_t pid;
+
+   bool found;
+   struct retro_keybind binds[RARCH_BIND_LIST_END];
+};
+
+/* Only used by one autoconfigure at a time. */
+static struct autoconfig_index autoconfig_index;
+
+static void input_autoconfigure_profile_free(
+      struct autoconfig_profile *profile)
+{
+   free(profile->ident);
+   free(profile->driver);
+   free(profile->path);
+}
 
-   *ident = *input_driver = '\0';
+static bool input_autoconfigure_index_add(config_file_t *conf,
+      int builtin, const char *path, const struct stat *st)
+{
+   char ident[PATH_MAX_LENGTH], driver[PATH_MAX_LENGTH];
+   struct autoconfig_profile *profile = NULL;
+   struct autoconfig_index *index     = &autoconfig_index;
+
+   if (index->size == index->cap)
+   {
+      size_t cap = index->cap ? index->cap * 2 : 64;
+      struct autoconfig_profile *profiles = (struct autoconfig_profile*)
+         realloc(index->profiles, cap * sizeof(*profiles));
+
+      if (!profiles)
+         return false;
+
+      index->profiles = profiles;
+      index->cap      = cap;
+   }
+
+   *ident = *driver = '\0';
 
    config_get_array(conf, "input_device", ident, sizeof(ident));
-   config_get_array(conf, "input_driver", input_driver, sizeof(input_driver));
-   config_get_int(conf, "input_vendor_id", &input_vid);
-   config_get_int(conf, "input_product_id", &input_pid);
+   config_get_array(conf, "input_driver", driver, sizeof(driver));
+
+   profile = &index->profiles[index->size];
+   memset(profile, 0, sizeof(*profile));
+
+   config_get_int(conf, "input_vendor_id", &profile->vid);
+   config_get_int(conf, "input_product_id", &profile->pid);
+
+   profile->ident   = strdup(ident);
+   profile->driver  = strdup(driver);
+   profile->builtin = builtin;
+   if (path)
+   {
+      profile->path  = strdup(path);
+      profile->mtime = st->st_mtime;
+      profile->size  = st->st_size;
+   }
+
+   if (!profile->ident || !profile->driver || (path && !profile->path))
+   {
+      input_autoconfigure_profile_free(profile);
+      return false;
+   }
+
+   index->size++;
+   return true;
+}
+
+static bool input_autoconfigure_index_has(const char *path,
+      const struct stat *st)
+{
+   size_t i;
+
+   for (i = 0; i < autoconfig_index.size; i++)
+   {
+      const struct autoconfig_profile *profile =
+         &autoconfig_index.profiles[i];
+
+      if (profile->path && !strcmp(profile->path, path))
+         return profile->mtime == st->st_mtime
+            && profile->size == st->st_size;
+   }
+
+   return false;
+}
+
+/**
+ * input_autoconfigure_index_update:
+ * @dir                   : Autoconfig directory, or empty for
+ *                          built-in profiles only.
+ *
+ * Brings the index up to date with @dir. Built-in profiles are
+ * parsed once, files again only when new or changed.
+ **/
+static void input_autoconfigure_index_update(const char *dir)
+{
+   size_t i, size = 0;
+   struct string_list *list       = NULL;
+   struct autoconfig_index *index = &autoconfig_index;
+
+#if defined(HAVE_BUILTIN_AUTOCONFIG)
+   if (!index->builtin_loaded)
+   {
+      for (i = 0; input_builtin_autoconfs[i]; i++)
+      {
+         config_file_t *conf = (config_file_t*)
+            config_file_new_from_string(input_builtin_autoconfs[i]);
 
-   snprintf(ident_idx, sizeof(ident_idx), "%s_p%u", ident, idx);
+         if (!conf)
+            continue;
 
-#if 0
-   RARCH_LOG("ident_idx: %s\n", ident_idx);
+         input_autoconfigure_index_add(conf, i, NULL, NULL);
+         config_file_free(conf);
+      }
+   }
 #endif
+   index->builtin_loaded = true;
+
+   if (*dir)
+      list = dir_list_new(dir, "cfg", false);
+
+   /* Drop files which are gone or changed. */
+   for (i = 0; i < index->size; i++)
+   {
+      struct stat st;
+      struct autoconfig_profile *profile = &index->profiles[i];
+      bool keep = !profile->path;
+
+      if (profile->path && list
+            && string_list_find_elem(list, profile->path)
+            && stat(profile->path, &st) == 0)
+         keep = profile->mtime == st.st_mtime
+            && profile->size == st.st_size;
+
+      if (keep)
+         index->profiles[size++] = *profile;
+      else
+         input_autoconfigure_profile_free(profile);
+   }
+   index->size = size;
+
+   if (!list)
+      return;
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct stat st;
+      config_file_t *conf = NULL;
+      const char *path    = list->elems[i].data;
+
+      if (stat(path, &st) != 0 || input_autoconfigure_index_has(path, &st))
+         continue;
+
+      conf = config_file_new(path);
+      if (!conf)
+         continue;
+
+      input_autoconfigure_index_add(conf, -1, path, &st);
+      config_file_free(conf);
+   }
+
+   string_list_free(list);
+}
 
-   cond_found_idx     = !strcmp(ident_idx, name);
-   cond_found_general = !strcmp(ident, name) && !strcmp(drv, input_driver);
-   if ((vid != 0) && (input_vid != 0))
-      cond_found_vid     = (vid == input_vid);
-   if ((pid != 0) && (input_pid != 0))
-      cond_found_pid     = (pid == input_pid);
+static bool input_autoconfigure_profile_match(
+      const struct autoconfig_profile *profile, unsigned idx,
+      const char *name, const char *drv, int32_t vid, int32_t pid)
+{
+   char ident_idx[PATH_MAX_LENGTH];
 
    /* If Vendor ID and Product ID matches, we've found our
     * entry. */
-   if (cond_found_vid && cond_found_pid)
-      goto found;
+   if (vid != 0 && profile->vid != 0 && vid == profile->vid
+         && pid != 0 && profile->pid != 0 && pid == profile->pid)
+      return true;
 
    /* Check for name match. */
-   if (cond_found_idx)
-      goto found;
-   else if (cond_found_general)
-      goto found;
+   snprintf(ident_idx, sizeof(ident_idx), "%s_p%u", profile->ident, idx);
 
-   return false;
+   if (!strcmp(ident_idx, name))
+      return true;
+   return !strcmp(profile->ident, name) && !strcmp(drv, profile->driver);
+}
+
+static bool input_autoconfigure_profile_apply(
+      const struct autoconfig_profile *profile,
+      struct retro_keybind *binds)
+{
+   config_file_t *conf = NULL;
+
+#if defined(HAVE_BUILTIN_AUTOCONFIG)
+   if (profile->builtin >= 0)
+      conf = (config_file_t*)config_file_new_from_string(
+            input_builtin_autoconfs[profile->builtin]);
+#endif
+   if (profile->path)
+      conf = config_file_new(profile->path);
+
+   if (!conf)
+      return false;
+
+   input_autoconfigure_joypad_conf(conf, binds);
+   config_file_free(conf);
+   return true;
+}
+
+static void input_autoconfigure_binds_reset(struct retro_keybind *binds)
+{
+   unsigned i;
+
+   for (i = 0; i < RARCH_BIND_LIST_END; i++)
+   {
+      binds[i].joykey           = NO_BTN;
+      binds[i].joyaxis          = AXIS_NONE;
+      binds[i].joykey_label[0]  = '\0';
+      binds[i].joyaxis_label[0] = '\0';
+   }
+}
+
+/**
+ * input_autoconfigure_resolve:
+ * @idx                   : Port of the pad.
+ * @req                   : Pad to autoconfigure.
+ *
+ * Finds the profiles of the pad in @req and fills its binds.
+ * The first matching built-in profile applies, then the first
+ * matching file on top of it.
+ **/
+static void input_autoconfigure_resolve(unsigned idx,
+      struct autoconfig_request *req)
+{
+   size_t i;
+   bool builtin_found = false, file_found = false;
+
+   input_autoconfigure_index_update(req->dir);
+   input_autoconfigure_binds_reset(req->binds);
+   req->found = false;
+
+   for (i = 0; i < autoconfig_index.size; i++)
+   {
+      const struct autoconfig_profile *profile =
+         &autoconfig_index.profiles[i];
+      bool builtin = !profile->path;
+
+      if (builtin ? builtin_found : file_found)
+         continue;
+      if (!input_autoconfigure_profile_match(profile, idx,
+               req->name, req->driver, req->vid, req->pid))
+         continue;
+      if (!input_autoconfigure_profile_apply(profile, req->binds))
+         continue;
+
+      if (builtin)
+         builtin_found = true;
+      else
+         file_found    = true;
+      req->found = true;
+   }
+}
 
-found:
+static void input_autoconfigure_request_apply(unsigned idx,
+      const struct autoconfig_request *req)
+{
+   /* Room for the whole name and the text around it. */
+   char msg[sizeof(req->name) + 64];
+
+   if (!req->found)
+      return;
+
+   memcpy(g_settings.input.autoconf_binds[idx], req->binds,
+         sizeof(req->binds));
    g_settings.input.autoconfigured[idx] = true;
-   input_autoconfigure_joypad_conf(conf, g_settings.input.autoconf_binds[idx]);
 
    snprintf(msg, sizeof(msg), "Joypad port #%u (%s) configured.",
-         idx, name);
+         idx, req->name);
 
-   if (!block_osd_spam)
+   if (!req->block_osd_spam)
       msg_queue_push(g_extern.msg_queue, msg, 0, 60);
    RARCH_LOG("%s\n", msg);
+}
 
-   return true;
+#ifdef HAVE_THREADS
+/* Hotplugs are autoconfigured on a thread, which runs while
+ * there are pending requests. Results are applied by
+ * input_config_autoconfigure_joypad_poll(). */
+static struct autoconfig_request autoconfig_requests[MAX_USERS];
+static slock_t *autoconfig_lock;
+static sthread_t *autoconfig_thread;
+static bool autoconfig_thread_running;
+
+static void input_autoconfigure_thread(void *data)
+{
+   struct autoconfig_request *req = (struct autoconfig_request*)
+      calloc(1, sizeof(*req));
+
+   (void)data;
+
+   slock_lock(autoconfig_lock);
+
+   for (;;)
+   {
+      unsigned idx;
+
+      for (idx = 0; idx < MAX_USERS; idx++)
+         if (autoconfig_requests[idx].pending)
+            break;
+
+      if (idx == MAX_USERS)
+         break;
+
+      autoconfig_requests[idx].pending = false;
+
+      if (!req)
+         continue;
+
+      *req = autoconfig_requests[idx];
+      slock_unlock(autoconfig_lock);
+
+      input_autoconfigure_resolve(idx, req);
+
+      slock_lock(autoconfig_lock);
+
+      /* Dropped if the pad changed meanwhile. */
+      if (!autoconfig_requests[idx].pending
+            && !strcmp(autoconfig_requests[idx].name, req->name))
+      {
+         memcpy(autoconfig_requests[idx].binds, req->binds,
+               sizeof(req->binds));
+         autoconfig_requests[idx].found = req->found;
+         autoconfig_requests[idx].done  = true;
+      }
+   }
+
+   autoconfig_thread_running = false;
+   slock_unlock(autoconfig_lock);
+
+   free(req);
+}
+
+void input_config_autoconfigure_joypad_poll(void)
+{
+   unsigned idx;
+
+   if (!autoconfig_lock)
+      return;
+
+   slock_lock(autoconfig_lock);
+
+   for (idx = 0; idx < MAX_USERS; idx++)
+   {
+      if (!autoconfig_requests[idx].done)
+         continue;
+
+      autoconfig_requests[idx].done = false;
+      input_autoconfigure_request_apply(idx, &autoconfig_requests[idx]);
+   }
+
+   if (autoconfig_thread && !autoconfig_thread_running)
+   {
+      sthread_join(autoconfig_thread);
+      autoconfig_thread = NULL;
+   }
+
+   slock_unlock(autoconfig_lock);
 }
 
+/* Called with autoconfig_lock held. */
+static bool input_autoconfigure_thread_start(void)
+{
+   /* A finished thread not joined yet. */
+   if (autoconfig_thread)
+      sthread_join(autoconfig_thread);
+
+   autoconfig_thread         = sthread_create(
+         input_autoconfigure_thread, NULL);
+   autoconfig_thread_running = autoconfig_thread != NULL;
+
+   return autoconfig_thread_running;
+}
+#else
+void input_config_autoconfigure_joypad_poll(void)
+{
+}
+#endif
+
 void input_config_autoconfigure_joypad(unsigned idx,
       const char *name, int32_t vid, int32_t pid,
       const char *drv)
 {
-   size_t i;
-   bool internal_only, block_osd_spam;
-   struct string_list *list = NULL;
+   bool block_osd_spam;
+   struct autoconfig_request *req = NULL;
 
    if (!g_settings.input.autodetect_enable)
       return;
@@ -113,60 +478,64 @@ void input_config_autoconfigure_joypad(unsigned idx,
     * every time (fine in log). */
    block_osd_spam = g_settings.input.autoconfigured[idx] && name;
 
-   for (i = 0; i < RARCH_BIND_LIST_END; i++)
-   {
-      g_settings.input.autoconf_binds[idx][i].joykey = NO_BTN;
-      g_settings.input.autoconf_binds[idx][i].joyaxis = AXIS_NONE;
-      g_settings.input.autoconf_binds[idx][i].joykey_label[0] = '\0';
-      g_settings.input.autoconf_binds[idx][i].joyaxis_label[0] = '\0';
-   }
+   input_autoconfigure_binds_reset(g_settings.input.autoconf_binds[idx]);
    g_settings.input.autoconfigured[idx] = false;
 
-   if (!name)
-      return;
-
-   /* if false, load from both cfg files and internal */
-   internal_only = !*g_settings.input.autoconfig_dir;
+#ifdef HAVE_THREADS
+   if (!autoconfig_lock)
+      autoconfig_lock = slock_new();
 
-#if defined(HAVE_BUILTIN_AUTOCONFIG)
-   /* First internal */
-   for (i = 0; input_builtin_autoconfs[i]; i++)
+   if (autoconfig_lock)
    {
-      config_file_t *conf = (config_file_t*)
-         config_file_new_from_string(input_builtin_autoconfs[i]);
-      bool success = input_try_autoconfigure_joypad_from_conf(conf,
-            idx, name, drv, vid, pid, block_osd_spam);
-
-      config_file_free(conf);
-      if (success)
-         break;
+      bool queued = false;
+
+      slock_lock(autoconfig_lock);
+
+      /* Drops whatever the port had pending. */
+      req          = &autoconfig_requests[idx];
+      req->pending = false;
+      req->done    = false;
+      *req->name   = '\0';
+
+      if (name && (autoconfig_thread_running
+               || input_autoconfigure_thread_start()))
+      {
+         req->pending        = true;
+         req->block_osd_spam = block_osd_spam;
+         req->vid            = vid;
+         req->pid            = pid;
+         strlcpy(req->name, name, sizeof(req->name));
+         strlcpy(req->driver, drv ? drv : "", sizeof(req->driver));
+         strlcpy(req->dir, g_settings.input.autoconfig_dir,
+               sizeof(req->dir));
+         queued = true;
+      }
+
+      slock_unlock(autoconfig_lock);
+
+      /* Without a thread, autoconfigures right here. */
+      if (queued || !name)
+         return;
    }
 #endif
 
-   if (internal_only)
+   if (!name)
       return;
 
-   /* Now try files */
-   list = dir_list_new(g_settings.input.autoconfig_dir, "cfg", false);
-
-   if (!list)
+   req = (struct autoconfig_request*)calloc(1, sizeof(*req));
+   if (!req)
       return;
 
-   for (i = 0; i < list->size; i++)
-   {
-      bool success;
-      config_file_t *conf = config_file_new(list->elems[i].data);
-      if (!conf)
-         continue;
+   req->block_osd_spam = block_osd_spam;
+   req->vid            = vid;
+   req->pid            = pid;
+   strlcpy(req->name, name, sizeof(req->name));
+   strlcpy(req->driver, drv ? drv : "", sizeof(req->driver));
+   strlcpy(req->dir, g_settings.input.autoconfig_dir, sizeof(req->dir));
 
-      success = input_try_autoconfigure_joypad_from_conf(conf,
-            idx, name, drv, vid, pid, block_osd_spam);
-      config_file_free(conf);
-      if (success)
-         break;
-   }
-
-   string_list_free(list);
+   input_autoconfigure_resolve(idx, req);
+   input_autoconfigure_request_apply(idx, req);
+   free(req);
 }
 
 const struct retro_keybind *input_get_auto_bind(unsigned port, unsigned id)
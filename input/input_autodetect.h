@@ -22,10 +22,31 @@
 const struct retro_keybind *input_get_auto_bind(unsigned port,
       unsigned id);
 
+/**
+ * input_config_autoconfigure_joypad:
+ * @idx                   : Port of the pad.
+ * @name                  : Name of the pad, or NULL once unplugged.
+ * @vid                   : Vendor ID of the pad, or 0.
+ * @pid                   : Product ID of the pad, or 0.
+ * @driver                : Joypad driver the pad belongs to.
+ *
+ * Clears the autoconfigured binds of port @idx, and looks up the
+ * autoconfig profile of the pad plugged into it. With threads,
+ * profiles are looked up on a thread and the binds are set by
+ * input_config_autoconfigure_joypad_poll().
+ **/
 void input_config_autoconfigure_joypad(unsigned idx,
       const char *name, int32_t vid, int32_t pid,
       const char *driver);
 
+/**
+ * input_config_autoconfigure_joypad_poll:
+ *
+ * Sets the binds of pads autoconfigured since the last call.
+ * Called every frame.
+ **/
+void input_config_autoconfigure_joypad_poll(void);
+
 extern const char* const input_builtin_autoconfs[];
 
 #endif
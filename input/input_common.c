@@ -105,6 +105,9 @@ const struct input_bind_map input_config_bind_map[RARCH_BIND_LIST_END_NULL] = {
       DECLARE_META_BIND(2, disk_next,             RARCH_DISK_NEXT, "Disk next"),
 	   DECLARE_META_BIND(2, disk_prev,             RARCH_DISK_NEXT, "Disk prev"),
       DECLARE_META_BIND(2, grab_mouse_toggle,     RARCH_GRAB_MOUSE_TOGGLE, "Grab mouse toggle"),
+      DECLARE_META_BIND(2, save_replay,           RARCH_SAVE_REPLAY, "Save replay"),
+      DECLARE_META_BIND(2, latency_test,          RARCH_LATENCY_TEST, "Latency test"),
+      DECLARE_META_BIND(2, trace_dump,            RARCH_TRACE_DUMP, "Trace dump"),
 #ifdef HAVE_MENU
       DECLARE_META_BIND(1, menu_toggle,           RARCH_MENU_TOGGLE, "Menu toggle"),
 #endif
@@ -46,6 +46,7 @@ static rarch_joypad_driver_t *joypad_drivers[] = {
 #endif
 #if defined(__linux) && !defined(ANDROID)
    &linuxraw_joypad,
+   &hidraw_joypad,
 #endif
 #ifdef HAVE_PARPORT
    &parport_joypad,
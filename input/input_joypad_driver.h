@@ -45,6 +45,7 @@ struct rarch_joypad_driver
 
 extern rarch_joypad_driver_t dinput_joypad;
 extern rarch_joypad_driver_t linuxraw_joypad;
+extern rarch_joypad_driver_t hidraw_joypad;
 extern rarch_joypad_driver_t parport_joypad;
 extern rarch_joypad_driver_t udev_joypad;
 extern rarch_joypad_driver_t winxinput_joypad;
@@ -999,6 +999,27 @@ const struct rarch_key_map rarch_key_map_apple_hid[] = {
 
 static enum retro_key rarch_keysym_lut[RETROK_LAST];
 
+/* Reverse of rarch_keysym_lut, so key events do not have to search
+ * it. Open addressing on the key symbol, a symbol of 0 marks an
+ * empty slot. Key symbols are sparse (X11 and SDL2 ones especially),
+ * so this is hashed rather than indexed directly. */
+#define RARCH_KEYSYM_HASH_BITS 10
+#define RARCH_KEYSYM_HASH_SIZE (1 << RARCH_KEYSYM_HASH_BITS)
+
+struct rarch_keysym_hash_entry
+{
+   unsigned sym;
+   enum retro_key rk;
+};
+
+static struct rarch_keysym_hash_entry
+   rarch_keysym_hash[RARCH_KEYSYM_HASH_SIZE];
+
+static inline unsigned input_keymaps_hash_sym(unsigned sym)
+{
+   return ((uint32_t)sym * 2654435761u) >> (32 - RARCH_KEYSYM_HASH_BITS);
+}
+
 /**
  * input_keymaps_init_keyboard_lut:
  * @map                   : Keyboard map.
@@ -1007,10 +1028,32 @@ static enum retro_key rarch_keysym_lut[RETROK_LAST];
  **/
 void input_keymaps_init_keyboard_lut(const struct rarch_key_map *map)
 {
+   unsigned rk;
+
    memset(rarch_keysym_lut, 0, sizeof(rarch_keysym_lut));
+   memset(rarch_keysym_hash, 0, sizeof(rarch_keysym_hash));
 
    for (; map->rk != RETROK_UNKNOWN; map++)
       rarch_keysym_lut[map->rk] = (enum retro_key)map->sym;
+
+   /* Lowest retro key wins when several share a symbol. */
+   for (rk = RETROK_UNKNOWN + 1; rk < RETROK_LAST; rk++)
+   {
+      unsigned sym = rarch_keysym_lut[rk];
+      unsigned i   = input_keymaps_hash_sym(sym);
+
+      if (!sym)
+         continue;
+
+      while (rarch_keysym_hash[i].sym && rarch_keysym_hash[i].sym != sym)
+         i = (i + 1) & (RARCH_KEYSYM_HASH_SIZE - 1);
+
+      if (rarch_keysym_hash[i].sym)
+         continue;
+
+      rarch_keysym_hash[i].sym = sym;
+      rarch_keysym_hash[i].rk  = (enum retro_key)rk;
+   }
 }
 
 /**
@@ -1024,12 +1067,13 @@ void input_keymaps_init_keyboard_lut(const struct rarch_key_map *map)
  **/
 enum retro_key input_keymaps_translate_keysym_to_rk(unsigned sym)
 {
-   unsigned i;
+   unsigned i = input_keymaps_hash_sym(sym);
 
-   for (i = 0; i < ARRAY_SIZE(rarch_keysym_lut); i++)
+   for (; rarch_keysym_hash[i].sym;
+         i = (i + 1) & (RARCH_KEYSYM_HASH_SIZE - 1))
    {
-      if (rarch_keysym_lut[i] == sym)
-         return (enum retro_key)i;
+      if (rarch_keysym_hash[i].sym == sym)
+         return rarch_keysym_hash[i].rk;
    }
 
    return RETROK_UNKNOWN;
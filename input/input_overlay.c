@@ -25,6 +25,116 @@
 #include <stddef.h>
 #include <math.h>
 
+/* Decoded images by path. Entries no overlay uses any more
+ * are kept until the next set finished loading, so loading
+ * the same overlays again, as drivers reinit, decodes
+ * nothing. Only used by one loader at a time, and by
+ * input_overlay_free() once its loader was joined. */
+struct overlay_image_cache_entry
+{
+   char *path;
+   struct texture_image image;
+   unsigned refs;
+};
+
+static struct overlay_image_cache_entry *overlay_image_cache;
+static size_t overlay_image_cache_size;
+static size_t overlay_image_cache_cap;
+
+static bool input_overlay_image_load(struct texture_image *img,
+      const char *path)
+{
+   size_t i;
+   struct texture_image tmp = {0};
+   struct overlay_image_cache_entry *entry = NULL;
+
+   for (i = 0; i < overlay_image_cache_size; i++)
+   {
+      if (strcmp(overlay_image_cache[i].path, path) == 0)
+      {
+         overlay_image_cache[i].refs++;
+         *img = overlay_image_cache[i].image;
+         return true;
+      }
+   }
+
+   if (!texture_image_load(&tmp, path))
+      return false;
+
+   if (overlay_image_cache_size == overlay_image_cache_cap)
+   {
+      size_t cap = overlay_image_cache_cap ?
+         overlay_image_cache_cap * 2 : 16;
+      struct overlay_image_cache_entry *cache =
+         (struct overlay_image_cache_entry*)
+         realloc(overlay_image_cache, cap * sizeof(*cache));
+
+      if (!cache)
+         goto uncached;
+
+      overlay_image_cache     = cache;
+      overlay_image_cache_cap = cap;
+   }
+
+   entry       = &overlay_image_cache[overlay_image_cache_size];
+   entry->path = strdup(path);
+   if (!entry->path)
+      goto uncached;
+
+   entry->image = tmp;
+   entry->refs  = 1;
+   overlay_image_cache_size++;
+
+   *img = tmp;
+   return true;
+
+uncached:
+   *img = tmp;
+   return true;
+}
+
+static void input_overlay_image_free(struct texture_image *img)
+{
+   size_t i;
+
+   if (!img->pixels)
+      return;
+
+   for (i = 0; i < overlay_image_cache_size; i++)
+   {
+      if (overlay_image_cache[i].image.pixels == img->pixels)
+      {
+         overlay_image_cache[i].refs--;
+         memset(img, 0, sizeof(*img));
+         return;
+      }
+   }
+
+   texture_image_free(img);
+}
+
+/* Frees the images no overlay uses. */
+static void input_overlay_image_cache_trim(void)
+{
+   size_t i, size = 0;
+
+   for (i = 0; i < overlay_image_cache_size; i++)
+   {
+      struct overlay_image_cache_entry *entry = &overlay_image_cache[i];
+
+      if (entry->refs)
+      {
+         overlay_image_cache[size++] = *entry;
+         continue;
+      }
+
+      texture_image_free(&entry->image);
+      free(entry->path);
+   }
+
+   overlay_image_cache_size = size;
+}
+
 static void input_overlay_scale(struct overlay *overlay, float scale)
 {
    size_t i;
@@ -89,7 +199,7 @@ void input_overlay_set_scale_factor(input_overlay_t *ol, float scale)
 {
    size_t i;
 
-   if (!ol)
+   if (!ol || !ol->active)
       return;
 
    for (i = 0; i < ol->size; i++)
@@ -106,11 +216,13 @@ static void input_overlay_free_overlay(struct overlay *overlay)
       return;
 
    for (i = 0; i < overlay->size; i++)
-      texture_image_free(&overlay->descs[i].image);
+      input_overlay_image_free(&overlay->descs[i].image);
 
+   free(overlay->grid.start);
+   free(overlay->grid.indices);
    free(overlay->load_images);
    free(overlay->descs);
-   texture_image_free(&overlay->image);
+   input_overlay_image_free(&overlay->image);
 }
 
 static void input_overlay_free_overlays(input_overlay_t *ol)
@@ -157,7 +269,7 @@ static bool input_overlay_load_desc(input_overlay_t *ol,
       fill_pathname_resolve_relative(path, ol->overlay_path,
             image_path, sizeof(path));
 
-      if (texture_image_load(&img, path))
+      if (input_overlay_image_load(&img, path))
          desc->image = img;
    }
 
@@ -299,6 +411,153 @@ end:
    return ret;
 }
 
+/* Cells per side of the hit testing grid, at most. */
+#define OVERLAY_GRID_MAX 16
+
+/**
+ * input_overlay_desc_bounds:
+ * @desc                  : Overlay descriptor handle.
+ * @x0, @y0, @x1, @y1     : Bounding box of the desc's hitbox.
+ *
+ * Gets the largest area the hitbox of @desc can cover,
+ * which is grown by range_mod while it is pressed.
+ **/
+static void input_overlay_desc_bounds(const struct overlay_desc *desc,
+      float *x0, float *y0, float *x1, float *y1)
+{
+   float range_mod = desc->range_mod > 1.0f ? desc->range_mod : 1.0f;
+   float range_x   = desc->range_x * range_mod;
+   float range_y   = desc->range_y * range_mod;
+
+   *x0 = desc->x - range_x;
+   *x1 = desc->x + range_x;
+   *y0 = desc->y - range_y;
+   *y1 = desc->y + range_y;
+}
+
+static unsigned input_overlay_grid_cell(float pos, float origin,
+      float cell, unsigned cells)
+{
+   float idx = (pos - origin) / cell;
+
+   if (idx <= 0.0f)
+      return 0;
+   if (idx >= cells)
+      return cells - 1;
+   return (unsigned)idx;
+}
+
+/**
+ * input_overlay_build_grid:
+ * @overlay               : Overlay handle.
+ *
+ * Sorts the descs of @overlay into a uniform grid, so that
+ * input_overlay_poll() only tests the descs in the cell of
+ * a pointer.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool input_overlay_build_grid(struct overlay *overlay)
+{
+   size_t i;
+   unsigned cell, dim, cells, total = 0;
+   float min_x, min_y, max_x, max_y;
+   struct overlay_grid *grid = &overlay->grid;
+
+   if (!overlay->size)
+      return true;
+
+   input_overlay_desc_bounds(&overlay->descs[0], &min_x, &min_y,
+         &max_x, &max_y);
+
+   for (i = 1; i < overlay->size; i++)
+   {
+      float x0, y0, x1, y1;
+
+      input_overlay_desc_bounds(&overlay->descs[i], &x0, &y0, &x1, &y1);
+      min_x = min(min_x, x0);
+      min_y = min(min_y, y0);
+      max_x = max(max_x, x1);
+      max_y = max(max_y, y1);
+   }
+
+   /* About one desc per cell. */
+   dim = (unsigned)ceil(sqrt((double)overlay->size));
+   if (dim > OVERLAY_GRID_MAX)
+      dim = OVERLAY_GRID_MAX;
+
+   grid->x      = min_x;
+   grid->y      = min_y;
+   grid->cols   = dim;
+   grid->rows   = dim;
+   grid->cell_w = (max_x - min_x) / dim;
+   grid->cell_h = (max_y - min_y) / dim;
+   if (grid->cell_w <= 0.0f)
+      grid->cell_w = 1.0f;
+   if (grid->cell_h <= 0.0f)
+      grid->cell_h = 1.0f;
+
+   cells       = dim * dim;
+   grid->start = (unsigned*)calloc(cells + 1, sizeof(*grid->start));
+   if (!grid->start)
+      return false;
+
+   /* Count the descs of each cell, then place them. */
+   for (i = 0; i < overlay->size; i++)
+   {
+      unsigned col, row;
+      float x0, y0, x1, y1;
+
+      input_overlay_desc_bounds(&overlay->descs[i], &x0, &y0, &x1, &y1);
+
+      for (row = input_overlay_grid_cell(y0, grid->y, grid->cell_h, dim);
+            row <= input_overlay_grid_cell(y1, grid->y, grid->cell_h, dim);
+            row++)
+         for (col = input_overlay_grid_cell(x0, grid->x, grid->cell_w, dim);
+               col <= input_overlay_grid_cell(x1, grid->x, grid->cell_w, dim);
+               col++)
+            grid->start[row * dim + col + 1]++;
+   }
+
+   for (cell = 0; cell < cells; cell++)
+   {
+      total                  += grid->start[cell + 1];
+      grid->start[cell + 1]   = total;
+   }
+
+   grid->indices = (unsigned*)malloc(total * sizeof(*grid->indices));
+   if (!grid->indices)
+   {
+      free(grid->start);
+      grid->start = NULL;
+      return false;
+   }
+
+   for (i = 0; i < overlay->size; i++)
+   {
+      unsigned col, row;
+      float x0, y0, x1, y1;
+
+      input_overlay_desc_bounds(&overlay->descs[i], &x0, &y0, &x1, &y1);
+
+      /* start[cell] doubles as fill position, it ends up
+       * at the start of the next cell. */
+      for (row = input_overlay_grid_cell(y0, grid->y, grid->cell_h, dim);
+            row <= input_overlay_grid_cell(y1, grid->y, grid->cell_h, dim);
+            row++)
+         for (col = input_overlay_grid_cell(x0, grid->x, grid->cell_w, dim);
+               col <= input_overlay_grid_cell(x1, grid->x, grid->cell_w, dim);
+               col++)
+            grid->indices[grid->start[row * dim + col]++] = i;
+   }
+
+   for (cell = cells; cell > 0; cell--)
+      grid->start[cell] = grid->start[cell - 1];
+   grid->start[0] = 0;
+
+   return true;
+}
+
 static bool input_overlay_load_overlay(input_overlay_t *ol,
       config_file_t *conf, const char *config_path,
       struct overlay *overlay, unsigned idx)
@@ -324,7 +583,7 @@ static bool input_overlay_load_overlay(input_overlay_t *ol,
       fill_pathname_resolve_relative(overlay_resolved_path, config_path,
             overlay_path, sizeof(overlay_resolved_path));
 
-      if (texture_image_load(&img, overlay_resolved_path))
+      if (input_overlay_image_load(&img, overlay_resolved_path))
          overlay->image = img;
       else
       {
@@ -414,6 +673,10 @@ static bool input_overlay_load_overlay(input_overlay_t *ol,
       }
    }
 
+   /* Hit testing scans all descs without a grid. */
+   if (!input_overlay_build_grid(overlay))
+      RARCH_WARN("[Overlay]: Failed to build hit testing grid.\n");
+
    /* Precache load image array for simplicity. */
    overlay->load_images = (struct texture_image*)
       calloc(1 + overlay->size, sizeof(struct texture_image));
@@ -546,9 +809,20 @@ static bool input_overlay_load_overlays(input_overlay_t *ol, const char *path)
 
 end:
    config_file_free(conf);
+   input_overlay_image_cache_trim();
    return ret;
 }
 
+#ifdef HAVE_THREADS
+static void input_overlay_load_thread(void *data)
+{
+   input_overlay_t *ol = (input_overlay_t*)data;
+
+   ol->loader_ok   = input_overlay_load_overlays(ol, ol->overlay_path);
+   ol->loader_done = true;
+}
+#endif
+
 static void input_overlay_load_active(input_overlay_t *ol)
 {
    if (!ol)
@@ -597,23 +871,69 @@ input_overlay_t *input_overlay_new(const char *path, bool enable)
    if (!ol->iface)
       goto error;
 
-   if (!input_overlay_load_overlays(ol, path))
+   ol->enable = enable;
+
+#ifdef HAVE_THREADS
+   /* Every overlay of the set is decoded before the first
+    * one is shown, switching to any of them decodes nothing. */
+   ol->loader = sthread_create(input_overlay_load_thread, ol);
+   if (ol->loader)
+      return ol;
+#endif
+
+   ol->loader_ok   = input_overlay_load_overlays(ol, path);
+   ol->loader_done = true;
+
+   if (!input_overlay_ready(ol))
       goto error;
 
+   return ol;
+
+error:
+   input_overlay_free(ol);
+   return NULL;
+}
+
+bool input_overlay_ready(input_overlay_t *ol)
+{
+   if (!ol)
+      return false;
+   if (ol->active)
+      return true;
+   if (!ol->loader_done)
+      return false;
+
+#ifdef HAVE_THREADS
+   if (ol->loader)
+   {
+      sthread_join(ol->loader);
+      ol->loader = NULL;
+   }
+#endif
+
+   if (!ol->loader_ok)
+   {
+      RARCH_ERR("[Overlay]: Failed to load overlays from: %s.\n",
+            ol->overlay_path);
+
+      /* The handle stays inert. */
+      input_overlay_free_overlays(ol);
+      ol->overlays    = NULL;
+      ol->size        = 0;
+      ol->loader_done = false;
+      return false;
+   }
+
    ol->active = &ol->overlays[0];
 
    input_overlay_load_active(ol);
-   input_overlay_enable(ol, enable);
+   input_overlay_enable(ol, ol->enable);
 
    input_overlay_set_alpha_mod(ol, g_settings.input.overlay_opacity);
    input_overlay_set_scale_factor(ol, g_settings.input.overlay_scale);
    ol->next_index = (ol->index + 1) % ol->size;
 
-   return ol;
-
-error:
-   input_overlay_free(ol);
-   return NULL;
+   return true;
 }
 
 /**
@@ -678,8 +998,10 @@ static bool inside_hitbox(const struct overlay_desc *desc, float x, float y)
 void input_overlay_poll(input_overlay_t *ol, input_overlay_state_t *out,
       int16_t norm_x, int16_t norm_y)
 {
-   size_t i;
+   size_t i, count;
    float x, y;
+   const unsigned *indices     = NULL;
+   const struct overlay_grid *grid = NULL;
 
    memset(out, 0, sizeof(*out));
 
@@ -699,9 +1021,32 @@ void input_overlay_poll(input_overlay_t *ol, input_overlay_state_t *out,
    x /= ol->active->mod_w;
    y /= ol->active->mod_h;
 
-   for (i = 0; i < ol->active->size; i++)
+   grid  = &ol->active->grid;
+   count = ol->active->size;
+
+   if (grid->start)
    {
-      struct overlay_desc *desc = &ol->active->descs[i];
+      unsigned cell;
+
+      /* Outside the grid, no hitbox can be reached. */
+      if (x < grid->x || y < grid->y
+            || x > grid->x + grid->cols * grid->cell_w
+            || y > grid->y + grid->rows * grid->cell_h)
+         count = 0;
+      else
+      {
+         cell = input_overlay_grid_cell(y, grid->y, grid->cell_h, grid->rows)
+            * grid->cols
+            + input_overlay_grid_cell(x, grid->x, grid->cell_w, grid->cols);
+         indices = grid->indices + grid->start[cell];
+         count   = grid->start[cell + 1] - grid->start[cell];
+      }
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      struct overlay_desc *desc =
+         &ol->active->descs[indices ? indices[i] : i];
 
       if (!inside_hitbox(desc, x, y))
          continue;
@@ -849,7 +1194,7 @@ void input_overlay_poll_clear(input_overlay_t *ol)
  **/
 void input_overlay_next(input_overlay_t *ol)
 {
-   if (!ol)
+   if (!ol || !ol->active)
       return;
 
    ol->index = ol->next_index;
@@ -871,7 +1216,7 @@ void input_overlay_next(input_overlay_t *ol)
  **/
 bool input_overlay_full_screen(input_overlay_t *ol)
 {
-   if (!ol)
+   if (!ol || !ol->active)
       return false;
    return ol->active->full_screen;
 }
@@ -887,6 +1232,11 @@ void input_overlay_free(input_overlay_t *ol)
    if (!ol)
       return;
 
+#ifdef HAVE_THREADS
+   if (ol->loader)
+      sthread_join(ol->loader);
+#endif
+
    input_overlay_free_overlays(ol);
 
    if (ol->iface)
@@ -908,7 +1258,7 @@ void input_overlay_set_alpha_mod(input_overlay_t *ol, float mod)
 {
    unsigned i;
 
-   if (!ol)
+   if (!ol || !ol->active)
       return;
 
    for (i = 0; i < ol->active->load_images_size; i++)
@@ -21,6 +21,7 @@
 #include "../libretro.h"
 #include "../gfx/image/image.h"
 #include <stdint.h>
+#include <rthreads/rthreads.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -95,11 +96,27 @@ struct overlay_desc
    bool movable;
 };
 
+/* Uniform grid over the hitboxes of an overlay's descs, in
+ * the same normalized space as overlay_desc::x and y. */
+struct overlay_grid
+{
+   float x, y;
+   float cell_w, cell_h;
+   unsigned cols, rows;
+
+   /* Descs reaching into cell i are indices[start[i]] up to
+    * indices[start[i + 1]], in the order of descs. */
+   unsigned *start;
+   unsigned *indices;
+};
+
 struct overlay
 {
    struct overlay_desc *descs;
    size_t size;
 
+   struct overlay_grid grid;
+
    struct texture_image image;
 
    bool block_scale;
@@ -131,6 +148,12 @@ struct input_overlay
 
    unsigned next_index;
    char *overlay_path;
+
+   /* Set by the loader thread, which owns overlays and
+    * size until input_overlay_ready() joined it. */
+   sthread_t *loader;
+   volatile bool loader_done;
+   bool loader_ok;
 };
 
 typedef struct input_overlay input_overlay_t;
@@ -150,12 +173,26 @@ typedef struct input_overlay_state
  * @path                  : Path to overlay file.
  * @enable                : Enable the overlay after initializing it?
  *
- * Creates and initializes an overlay handle.
+ * Creates and initializes an overlay handle. With threads,
+ * the overlays are loaded in the background, and the handle
+ * does nothing until input_overlay_ready() sees them loaded.
  *
  * Returns: Overlay handle on success, otherwise NULL.
  **/
 input_overlay_t *input_overlay_new(const char *overlay, bool enable);
 
+/**
+ * input_overlay_ready:
+ * @ol                    : Overlay handle.
+ *
+ * Shows the first overlay once the overlays are loaded.
+ * Called every frame.
+ *
+ * Returns: true (1) if the overlay is loaded and can be
+ * polled, otherwise false (0).
+ **/
+bool input_overlay_ready(input_overlay_t *ol);
+
 /**
  * input_overlay_free:
  * @ol                    : Overlay handle.
@@ -152,6 +152,22 @@ static input_keyboard_press_t g_keyboard_press_cb;
 
 static void *g_keyboard_press_data;
 
+/* Key events bound for the core's keyboard callback are held
+ * here and handed over in one go by input_keyboard_event_flush(). */
+#define KEYBOARD_EVENT_QUEUE_SIZE 256
+
+struct input_keyboard_queued_event
+{
+   uint32_t character;
+   unsigned code;
+   uint16_t mod;
+   bool down;
+};
+
+static struct input_keyboard_queued_event
+   g_keyboard_queue[KEYBOARD_EVENT_QUEUE_SIZE];
+static unsigned g_keyboard_queue_count;
+
 /**
  * input_keyboard_start_line:
  * @userdata                 : Userdata.
@@ -247,6 +263,41 @@ void input_keyboard_event(bool down, unsigned code,
       }
    }
    else if (g_extern.system.key_event)
-      g_extern.system.key_event(down, code, character, mod);
+   {
+      struct input_keyboard_queued_event *event = NULL;
+
+      /* Only the core's callback is flushed from input polling.
+       * The menu swaps in its own and does not poll, so that one
+       * gets its keys right away. */
+      if (g_extern.system.key_event != g_extern.frontend_key_event)
+      {
+         g_extern.system.key_event(down, code, character, mod);
+         return;
+      }
+
+      if (g_keyboard_queue_count == KEYBOARD_EVENT_QUEUE_SIZE)
+         input_keyboard_event_flush();
+
+      event = &g_keyboard_queue[g_keyboard_queue_count++];
+      event->down      = down;
+      event->code      = code;
+      event->character = character;
+      event->mod       = mod;
+   }
+}
+
+void input_keyboard_event_flush(void)
+{
+   unsigned i;
+   retro_keyboard_event_t cb = g_extern.system.key_event;
+
+   if (cb)
+   {
+      for (i = 0; i < g_keyboard_queue_count; i++)
+         cb(g_keyboard_queue[i].down, g_keyboard_queue[i].code,
+               g_keyboard_queue[i].character, g_keyboard_queue[i].mod);
+   }
+
+   g_keyboard_queue_count = 0;
 }
 
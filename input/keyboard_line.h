@@ -99,6 +99,15 @@ void input_keyboard_line_free(input_keyboard_line_t *state);
 void input_keyboard_event(bool down, unsigned code, uint32_t character,
       uint16_t mod);
 
+/**
+ * input_keyboard_event_flush:
+ *
+ * Hands the key events queued by input_keyboard_event() to the
+ * core's keyboard callback, in order. Called once per input poll,
+ * and before the callback is swapped out.
+ **/
+void input_keyboard_event_flush(void);
+
 /**
  * input_keyboard_start_line:
  * @userdata                 : Userdata.
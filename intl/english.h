@@ -74,6 +74,9 @@
 #define RETRO_LBL_DISK_NEXT "Disk Swap Next"
 #define RETRO_LBL_DISK_PREV "Disk Swap Previous"
 #define RETRO_LBL_GRAB_MOUSE_TOGGLE "Grab mouse toggle"
+#define RETRO_LBL_SAVE_REPLAY "Save Replay"
+#define RETRO_LBL_LATENCY_TEST "Latency Test"
+#define RETRO_LBL_TRACE_DUMP "Trace Dump"
 #define RETRO_LBL_MENU_TOGGLE "Menu toggle"
 
 #define TERM_STR "\n"
@@ -82,6 +85,11 @@
 #define RETRO_MSG_INIT_RECORDING_FAILED "Failed to start recording."
 #define RETRO_MSG_TAKE_SCREENSHOT "Taking screenshot."
 #define RETRO_MSG_TAKE_SCREENSHOT_FAILED "Failed to take screenshot."
+#define RETRO_MSG_SAVE_REPLAY "Saving replay."
+#define RETRO_MSG_SAVE_REPLAY_FAILED "Failed to save replay."
+#define RETRO_MSG_TRACE_DUMP "Trace written."
+#define RETRO_MSG_TRACE_DUMP_FAILED "Failed to write trace."
+#define RETRO_MSG_TRACE_DUMP_NO_PERFCNT "Enable performance counters to trace."
 #define RETRO_MSG_TAKE_SCREENSHOT_ERROR "Cannot take screenshot. GPU rendering is used and read_viewport is not supported."
 #define RETRO_MSG_AUDIO_WRITE_FAILED "Audio backend failed to write. Will continue without sound."
 #define RETRO_MSG_MOVIE_STARTED_INIT_NETPLAY_FAILED "Movie playback has started. Cannot start netplay."
@@ -101,6 +109,8 @@
 #define RETRO_LOG_INIT_RECORDING_SKIPPED RETRO_MSG_INIT_RECORDING_SKIPPED TERM_STR
 #define RETRO_LOG_INIT_RECORDING_FAILED RETRO_MSG_INIT_RECORDING_FAILED TERM_STR
 #define RETRO_LOG_TAKE_SCREENSHOT RETRO_MSG_TAKE_SCREENSHOT TERM_STR
+#define RETRO_LOG_SAVE_REPLAY_FAILED RETRO_MSG_SAVE_REPLAY_FAILED TERM_STR
+#define RETRO_LOG_TRACE_DUMP_FAILED RETRO_MSG_TRACE_DUMP_FAILED TERM_STR
 #define RETRO_LOG_TAKE_SCREENSHOT_FAILED RETRO_MSG_TAKE_SCREENSHOT_FAILED TERM_STR
 #define RETRO_LOG_TAKE_SCREENSHOT_ERROR RETRO_MSG_TAKE_SCREENSHOT_ERROR TERM_STR
 #define RETRO_LOG_AUDIO_WRITE_FAILED RETRO_MSG_AUDIO_WRITE_FAILED TERM_STR
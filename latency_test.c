@@ -0,0 +1,241 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "latency_test.h"
+#include "general.h"
+#include "driver.h"
+#include "performance.h"
+#include "input/input_joypad.h"
+
+/* Input events older than this when the hotkey is seen
+ * belong to some other press. */
+#define LATENCY_TEST_EVENT_MAX_AGE 100000
+
+/* Frames to wait for the core to show a frame, and for
+ * the photodiode to see it. */
+#define LATENCY_TEST_TIMEOUT_FRAMES 60
+
+/* Frames after which drivers which do not report swaps
+ * are taken to be done with the white frame. */
+#define LATENCY_TEST_SWAP_FRAMES 2
+
+enum latency_test_state
+{
+   LATENCY_TEST_IDLE = 0,
+   /* Waiting for the core to show a frame. */
+   LATENCY_TEST_ARMED,
+   /* The white frame was handed to the video driver. */
+   LATENCY_TEST_SHOWN
+};
+
+static const char *latency_test_stage_names[RARCH_LATENCY_STAGE_LAST] = {
+   "poll",
+   "retro_run",
+   "swap",
+   "swap done",
+   "display",
+};
+
+static enum latency_test_state state;
+static unsigned frames;
+static retro_time_t origin;
+static bool origin_is_event;
+static retro_time_t last_event;
+
+/* Swap stages are marked from the video thread
+ * when video_threaded is set. */
+static volatile bool swap_pending;
+static volatile retro_time_t stamps[RARCH_LATENCY_STAGE_LAST];
+
+static uint8_t *white_frame;
+static size_t white_frame_size;
+
+void rarch_latency_test_input_event(retro_time_t usec)
+{
+   last_event = usec;
+}
+
+void rarch_latency_test_trigger(void)
+{
+   unsigned i;
+   retro_time_t now = rarch_get_time_usec();
+
+   if (state != LATENCY_TEST_IDLE)
+      return;
+
+   for (i = 0; i < RARCH_LATENCY_STAGE_LAST; i++)
+      stamps[i] = 0;
+
+   origin_is_event = last_event && last_event <= now
+      && now - last_event < LATENCY_TEST_EVENT_MAX_AGE;
+   origin          = origin_is_event ? last_event : now;
+   stamps[RARCH_LATENCY_STAGE_POLL] = now;
+
+   /* Left over by a video driver which does not report swaps. */
+   swap_pending = false;
+
+   frames = 0;
+   state  = LATENCY_TEST_ARMED;
+}
+
+void rarch_latency_test_frame(const void **data,
+      unsigned height, size_t pitch)
+{
+   size_t size = pitch * height;
+
+   if (state != LATENCY_TEST_ARMED)
+      return;
+
+   /* Dupes and hardware rendered frames cannot be
+    * turned white, wait for the next one. */
+   if (!*data || *data == RETRO_HW_FRAME_BUFFER_VALID)
+      return;
+
+   if (size > white_frame_size)
+   {
+      uint8_t *tmp = (uint8_t*)realloc(white_frame, size);
+      if (!tmp)
+         return;
+
+      white_frame      = tmp;
+      white_frame_size = size;
+   }
+
+   /* All ones is white in every pixel format. */
+   memset(white_frame, 0xff, size);
+   *data = white_frame;
+
+   swap_pending = true;
+   state        = LATENCY_TEST_SHOWN;
+}
+
+bool rarch_latency_test_swap_begin(void)
+{
+   if (!swap_pending)
+      return false;
+
+   swap_pending = false;
+   stamps[RARCH_LATENCY_STAGE_SWAP] = rarch_get_time_usec();
+   return true;
+}
+
+void rarch_latency_test_swap_end(void)
+{
+   stamps[RARCH_LATENCY_STAGE_SWAP_DONE] = rarch_get_time_usec();
+}
+
+static bool latency_test_photodiode_lit(void)
+{
+   int axis = g_settings.input.latency_test_axis;
+   const rarch_joypad_driver_t *joypad = NULL;
+
+   if (driver.input && driver.input_data && driver.input->get_joypad_driver)
+      joypad = driver.input->get_joypad_driver(driver.input_data);
+
+   return joypad && input_joypad_axis_raw(joypad,
+         g_settings.input.joypad_map[0], axis)
+      >= g_settings.input.latency_test_threshold;
+}
+
+static void latency_test_report(void)
+{
+   unsigned i;
+   char msg[256];
+   size_t pos = 0;
+   retro_time_t last = 0;
+
+   pos += snprintf(msg + pos, sizeof(msg) - pos, "Latency from %s:",
+         origin_is_event ? "input event" : "poll");
+
+   for (i = 0; i < RARCH_LATENCY_STAGE_LAST && pos < sizeof(msg); i++)
+   {
+      retro_time_t usec;
+
+      if (!stamps[i])
+         continue;
+
+      usec = stamps[i] - origin;
+      last = usec;
+      rarch_perf_histogram_add(&perf_histogram_latency[i], usec);
+
+      pos += snprintf(msg + pos, sizeof(msg) - pos, "%s %s %.2f ms",
+            i ? "," : "", latency_test_stage_names[i], usec / 1000.0);
+   }
+
+   RARCH_LOG("%s.\n", msg);
+
+   snprintf(msg, sizeof(msg), "Latency: %.2f ms (%s).",
+         last / 1000.0, stamps[RARCH_LATENCY_STAGE_DISPLAY] ?
+         "display" : "swap");
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+}
+
+void rarch_latency_test_iterate(void)
+{
+   bool swapped, displayed;
+   bool photodiode = g_settings.input.latency_test_axis >= 0;
+
+   if (state == LATENCY_TEST_IDLE)
+      return;
+
+   /* The frame the hotkey was polled for is done. */
+   if (!stamps[RARCH_LATENCY_STAGE_RUN])
+      stamps[RARCH_LATENCY_STAGE_RUN] = rarch_get_time_usec();
+
+   frames++;
+
+   if (state == LATENCY_TEST_ARMED)
+   {
+      if (frames >= LATENCY_TEST_TIMEOUT_FRAMES)
+      {
+         RARCH_WARN("Latency test: core did not show a frame"
+               " which could be turned white.\n");
+         state = LATENCY_TEST_IDLE;
+      }
+      return;
+   }
+
+   if (photodiode && !stamps[RARCH_LATENCY_STAGE_DISPLAY]
+         && latency_test_photodiode_lit())
+      stamps[RARCH_LATENCY_STAGE_DISPLAY] = rarch_get_time_usec();
+
+   swapped   = stamps[RARCH_LATENCY_STAGE_SWAP_DONE]
+      || frames >= LATENCY_TEST_SWAP_FRAMES;
+   displayed = !photodiode || stamps[RARCH_LATENCY_STAGE_DISPLAY]
+      || frames >= LATENCY_TEST_TIMEOUT_FRAMES;
+
+   if (!swapped || !displayed)
+      return;
+
+   if (photodiode && !stamps[RARCH_LATENCY_STAGE_DISPLAY])
+      RARCH_WARN("Latency test: photodiode did not see the white frame.\n");
+
+   latency_test_report();
+   state = LATENCY_TEST_IDLE;
+}
+
+void rarch_latency_test_deinit(void)
+{
+   state        = LATENCY_TEST_IDLE;
+   swap_pending = false;
+
+   free(white_frame);
+   white_frame      = NULL;
+   white_frame_size = 0;
+}
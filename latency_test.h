@@ -0,0 +1,119 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_LATENCY_TEST_H
+#define __RARCH_LATENCY_TEST_H
+
+#include <boolean.h>
+#include <stddef.h>
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Input-to-photon latency test. Pressing the latency test hotkey
+ * turns the next frame the core shows white, and times it on its
+ * way out. Every stage is timed from the input event of the press
+ * if the input driver reports one, otherwise from the poll which
+ * saw it. Results go to the latency_* performance histograms. */
+enum rarch_latency_stage
+{
+   /* The hotkey was seen after polling input. */
+   RARCH_LATENCY_STAGE_POLL = 0,
+   /* retro_run() returned. */
+   RARCH_LATENCY_STAGE_RUN,
+   /* The video driver started swapping the white frame. */
+   RARCH_LATENCY_STAGE_SWAP,
+   /* The swap completed. */
+   RARCH_LATENCY_STAGE_SWAP_DONE,
+   /* The photodiode on input_latency_test_axis saw the white frame. */
+   RARCH_LATENCY_STAGE_DISPLAY,
+
+   RARCH_LATENCY_STAGE_LAST
+};
+
+/**
+ * rarch_latency_test_input_event:
+ * @usec                 : Time the event happened, in
+ *                         rarch_get_time_usec() time base.
+ *
+ * Input drivers which timestamp their events report button
+ * presses with this, as they apply them.
+ **/
+void rarch_latency_test_input_event(retro_time_t usec);
+
+/**
+ * rarch_latency_test_trigger:
+ *
+ * Starts a test, unless one is running already. Called when the
+ * latency test hotkey is pressed.
+ **/
+void rarch_latency_test_trigger(void);
+
+/**
+ * rarch_latency_test_frame:
+ * @data                 : Frame of the core, replaced if it is
+ *                         the one to turn white.
+ * @height               : Height of frame.
+ * @pitch                : Pitch of frame in bytes.
+ *
+ * Called with every frame the core shows, before it is handed
+ * to the video driver.
+ **/
+void rarch_latency_test_frame(const void **data,
+      unsigned height, size_t pitch);
+
+/**
+ * rarch_latency_test_swap_begin:
+ *
+ * Called by video drivers right before they swap buffers.
+ * Can be called from the video thread.
+ *
+ * Returns: true (1) if the frame being swapped is the white one,
+ * in which case the driver calls rarch_latency_test_swap_end()
+ * once the swap completed.
+ **/
+bool rarch_latency_test_swap_begin(void);
+
+/**
+ * rarch_latency_test_swap_end:
+ *
+ * Marks that the swap of the white frame completed.
+ **/
+void rarch_latency_test_swap_end(void);
+
+/**
+ * rarch_latency_test_iterate:
+ *
+ * Called once per frame, after the core ran. Watches the
+ * photodiode and reports the test once all stages are in.
+ **/
+void rarch_latency_test_iterate(void);
+
+/**
+ * rarch_latency_test_deinit:
+ *
+ * Drops a running test and frees the white frame.
+ * Must be called after the video driver is deinitialized.
+ **/
+void rarch_latency_test_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
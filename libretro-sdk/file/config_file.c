@@ -47,43 +47,79 @@
 static config_file_t *config_file_new_internal(const char *path, unsigned depth);
 void config_file_free(config_file_t *conf);
 
-static char *getaline(FILE *file)
+/* Entries, their strings and the text they were parsed from all
+ * live in blocks owned by the config file, freed along with it. */
+struct config_arena
 {
-   char* newline = (char*)malloc(9);
-   char* newline_tmp = NULL;
-   size_t cur_size = 8;
-   size_t idx = 0;
-   int in = getc(file);
+   struct config_arena *next;
+   size_t size;
+   size_t used;
+};
 
-   if (!newline)
-      return NULL;
+#define CONFIG_ARENA_BLOCK 4096
+#define CONFIG_ARENA_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+static void *config_arena_alloc(config_file_t *conf, size_t size)
+{
+   struct config_arena *block = conf->arena;
+   size_t header = CONFIG_ARENA_ALIGN(sizeof(*block));
 
-   while (in != EOF && in != '\n')
+   size = CONFIG_ARENA_ALIGN(size);
+
+   if (!block || block->size - block->used < size)
    {
-      if (idx == cur_size)
-      {
-         cur_size *= 2;
-         newline_tmp = (char*)realloc(newline, cur_size + 1);
+      size_t block_size = size > CONFIG_ARENA_BLOCK ? size : CONFIG_ARENA_BLOCK;
 
-         if (!newline_tmp)
-         {
-            free(newline);
-            return NULL;
-         }
+      block = (struct config_arena*)malloc(header + block_size);
+      if (!block)
+         return NULL;
 
-         newline = newline_tmp;
-      }
+      block->next = conf->arena;
+      block->size = block_size;
+      block->used = 0;
+      conf->arena = block;
+   }
+
+   block->used += size;
+   return (uint8_t*)block + header + block->used - size;
+}
 
-      newline[idx++] = in;
-      in = getc(file);
+static char *config_arena_strdup(config_file_t *conf, const char *str)
+{
+   size_t len = strlen(str) + 1;
+   char *copy = (char*)config_arena_alloc(conf, len);
+
+   if (copy)
+      memcpy(copy, str, len);
+   return copy;
+}
+
+/* Takes over the blocks of @from, behind the one @conf
+ * allocates from. */
+static void config_arena_adopt(config_file_t *conf, config_file_t *from)
+{
+   struct config_arena *last = from->arena;
+
+   if (!last)
+      return;
+
+   if (conf->arena)
+   {
+      while (last->next)
+         last = last->next;
+
+      last->next        = conf->arena->next;
+      conf->arena->next = from->arena;
    }
-   newline[idx] = '\0';
-   return newline; 
+   else
+      conf->arena = from->arena;
+
+   from->arena = NULL;
 }
 
 static char *extract_value(char *line, bool is_value)
 {
-   char *save = NULL, *tok = NULL;
+   char *save = NULL;
 
    if (is_value)
    {
@@ -105,21 +141,141 @@ static char *extract_value(char *line, bool is_value)
    if (*line == '"')
    {
       line++;
-      tok = strtok_r(line, "\"", &save);
-      if (!tok)
-         return NULL;
-      return strdup(tok);
+      return strtok_r(line, "\"", &save);
    }
    else if (*line == '\0') /* Nothing */
       return NULL;
 
    /* We don't have that. Read until next space. */
-   tok = strtok_r(line, " \n\t\f\r\v", &save);
-   if (tok)
-      return strdup(tok);
+   return strtok_r(line, " \n\t\f\r\v", &save);
+}
+
+/* FNV-1a. */
+static uint32_t config_hash_key(const char *key)
+{
+   uint32_t hash = 2166136261u;
+
+   for (; *key; key++)
+      hash = (hash ^ (uint8_t)*key) * 16777619u;
+   return hash;
+}
+
+/* Gets the first entry of @key, as a scan of the list would. */
+static struct config_entry_list *config_find_own_entry(
+      const config_file_t *conf, const char *key)
+{
+   struct config_entry_list *list = NULL;
+
+   if (!conf->buckets)
+   {
+      for (list = conf->entries; list; list = list->next)
+         if (strcmp(key, list->key) == 0)
+            return list;
+      return NULL;
+   }
+
+   list = conf->buckets[config_hash_key(key) & conf->bucket_mask];
+   for (; list; list = list->hash_next)
+      if (strcmp(key, list->key) == 0)
+         return list;
    return NULL;
 }
 
+/* Keys missing from a layer are looked up in its base. */
+static struct config_entry_list *config_find_entry(
+      const config_file_t *conf, const char *key)
+{
+   for (; conf; conf = conf->base)
+   {
+      struct config_entry_list *list = config_find_own_entry(conf, key);
+      if (list)
+         return list;
+   }
+   return NULL;
+}
+
+static void config_grow_buckets(config_file_t *conf)
+{
+   size_t i, size = conf->buckets ? (conf->bucket_mask + 1) * 2 : 64;
+   struct config_entry_list **buckets = (struct config_entry_list**)
+      calloc(size, sizeof(*buckets));
+
+   if (!buckets)
+      return;
+
+   for (i = 0; conf->buckets && i <= conf->bucket_mask; i++)
+   {
+      struct config_entry_list *list = conf->buckets[i];
+
+      while (list)
+      {
+         struct config_entry_list *next = list->hash_next;
+         struct config_entry_list **bucket =
+            &buckets[config_hash_key(list->key) & (size - 1)];
+
+         list->hash_next = *bucket;
+         *bucket         = list;
+         list            = next;
+      }
+   }
+
+   free(conf->buckets);
+   conf->buckets     = buckets;
+   conf->bucket_mask = size - 1;
+}
+
+static void config_reindex(config_file_t *conf);
+
+/* Indexes an entry linked in at the end of the list, unless
+ * an earlier one of the same key already is. */
+static void config_index_entry(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list **bucket = NULL;
+   struct config_entry_list *list    = NULL;
+
+   /* Lookups scan the list until buckets could be had. */
+   if (!conf->buckets)
+   {
+      config_reindex(conf);
+      return;
+   }
+
+   if (conf->keys > conf->bucket_mask)
+      config_grow_buckets(conf);
+
+   bucket = &conf->buckets[config_hash_key(entry->key) & conf->bucket_mask];
+   for (list = *bucket; list; list = list->hash_next)
+      if (strcmp(entry->key, list->key) == 0)
+         return;
+
+   entry->hash_next = *bucket;
+   *bucket          = entry;
+   conf->keys++;
+}
+
+/* Indexes the whole list anew, for entries linked in
+ * before others. */
+static void config_reindex(config_file_t *conf)
+{
+   struct config_entry_list *list = NULL;
+
+   free(conf->buckets);
+   conf->buckets     = NULL;
+   conf->bucket_mask = 0;
+   conf->keys        = 0;
+
+   config_grow_buckets(conf);
+   if (!conf->buckets)
+      return;
+
+   for (list = conf->entries; list; list = list->next)
+   {
+      list->hash_next = NULL;
+      config_index_entry(conf, list);
+   }
+}
+
 static void set_list_readonly(struct config_entry_list *list)
 {
    while (list)
@@ -132,46 +288,44 @@ static void set_list_readonly(struct config_entry_list *list)
 /* Move semantics? */
 static void add_child_list(config_file_t *parent, config_file_t *child)
 {
-   if (parent->entries)
-   {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
+   struct config_entry_list *list = child->entries;
 
-      set_list_readonly(child->entries);
-      head->next = child->entries;
-   }
+   if (!list)
+      return;
+
+   set_list_readonly(list);
+
+   /* Out of the buckets of the child. */
+   for (; list; list = list->next)
+      list->hash_next = NULL;
+
+   if (parent->tail)
+      parent->tail->next = child->entries;
    else
-   {
-      set_list_readonly(child->entries);
       parent->entries = child->entries;
-   }
-
-   child->entries = NULL;
 
-   /* Rebase tail. */
-   if (parent->entries)
+   for (list = child->entries; list; list = list->next)
    {
-      struct config_entry_list *head = 
-         (struct config_entry_list*)parent->entries;
-
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
+      config_index_entry(parent, list);
+      parent->tail = list;
    }
-   else
-      parent->tail = NULL;
+
+   child->entries = NULL;
+   child->tail    = NULL;
+   config_arena_adopt(parent, child);
 }
 
-static void add_include_list(config_file_t *conf, const char *path)
+static void add_include_list(config_file_t *conf, char *path)
 {
    struct config_include_list *head = conf->includes;
-   struct config_include_list *node = (struct config_include_list*)calloc(1, sizeof(*node));
+   struct config_include_list *node = (struct config_include_list*)
+      config_arena_alloc(conf, sizeof(*node));
 
    if (!node)
       return;
 
-   node->path = strdup(path);
+   node->path = path;
+   node->next = NULL;
 
    if (head)
    {
@@ -214,15 +368,11 @@ static void add_sub_conf(config_file_t *conf, char *line)
    sub_conf = (config_file_t*)
       config_file_new_internal(real_path, conf->include_depth + 1);
    if (!sub_conf)
-   {
-      free(path);
       return;
-   }
 
    /* Pilfer internal list. */
    add_child_list(conf, sub_conf);
    config_file_free(sub_conf);
-   free(path);
 }
 
 static char *strip_comment(char *str)
@@ -264,24 +414,25 @@ static char *strip_comment(char *str)
    return str;
 }
 
-static bool parse_line(config_file_t *conf,
-      struct config_entry_list *list, char *line)
+/**
+ * parse_line:
+ * @conf                 : config file the line belongs to.
+ * @line                 : line, cut up in place.
+ * @key                  : set to the key, within @line.
+ * @value                : set to the value, within @line.
+ *
+ * Returns: true if the line is a key and value, otherwise
+ * false, for comments and includes as well.
+ **/
+static bool parse_line(config_file_t *conf, char *line,
+      char **key, char **value)
 {
-   char* comment = NULL;
-   char* key = (char*)malloc(9);
-   char* key_tmp = NULL;
-   size_t cur_size = 8;
-   size_t idx = 0;
+   char *comment = NULL;
+   char *key_end = NULL;
 
-   if (!key)
+   if (!*line)
       return false;
 
-   if (!line || !*line)
-   {
-      free(key);
-      return false;
-   }
-
    comment = strip_comment(line);
 
    /* Starting line with # and include includes config files. */
@@ -291,7 +442,6 @@ static bool parse_line(config_file_t *conf,
       if (strstr(comment, "include ") == comment)
       {
          add_sub_conf(conf, comment + strlen("include "));
-         free(key);
          return false;
       }
    }
@@ -304,36 +454,64 @@ static bool parse_line(config_file_t *conf,
    while (isspace(*line))
       line++;
 
+   *key = line;
    while (isgraph(*line))
-   {
-      if (idx == cur_size)
-      {
-         cur_size *= 2;
-         key_tmp = (char*)realloc(key, cur_size + 1);
+      line++;
+   key_end = line;
 
-         if (!key_tmp)
-         {
-            free(key);
-            return false;
-         }
+   /* The value starts past the '=' following the key,
+    * so the key is only cut off once it has been found. */
+   *value = extract_value(line, true);
+   if (!*value)
+      return false;
 
-         key = key_tmp;
-      }
+   *key_end = '\0';
+   return true;
+}
 
-      key[idx++] = *line++;
-   }
-   key[idx] = '\0';
-   list->key = key;
+static void config_add_entry(config_file_t *conf, char *key, char *value)
+{
+   struct config_entry_list *list = (struct config_entry_list*)
+      config_arena_alloc(conf, sizeof(*list));
+
+   if (!list)
+      return;
+
+   memset(list, 0, sizeof(*list));
+   list->key   = key;
+   list->value = value;
+
+   if (conf->entries)
+      conf->tail->next = list;
+   else
+      conf->entries = list;
+
+   conf->tail = list;
+   config_index_entry(conf, list);
+}
 
-   list->value = extract_value(line, true);
-   if (!list->value)
+/* Parses the lines of @buf, which has to stay around for
+ * as long as @conf does. */
+static void config_parse(config_file_t *conf, char *buf)
+{
+   while (*buf)
    {
-      list->key = NULL;
-      free(key);
-      return false;
-   }
+      char *key   = NULL;
+      char *value = NULL;
+      char *line  = buf;
+      char *end   = strchr(buf, '\n');
 
-   return true;
+      if (end)
+      {
+         *end = '\0';
+         buf  = end + 1;
+      }
+      else
+         buf += strlen(buf);
+
+      if (parse_line(conf, line, &key, &value))
+         config_add_entry(conf, key, value);
+   }
 }
 
 bool config_append_file(config_file_t *conf, const char *path)
@@ -345,8 +523,14 @@ bool config_append_file(config_file_t *conf, const char *path)
    if (new_conf->tail)
    {
       new_conf->tail->next = conf->entries;
+      if (!conf->tail)
+         conf->tail        = new_conf->tail;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+      config_arena_adopt(conf, new_conf);
+
+      /* Takes precedence over what was there. */
+      config_reindex(conf);
    }
 
    config_file_free(new_conf);
@@ -356,6 +540,9 @@ bool config_append_file(config_file_t *conf, const char *path)
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth)
 {
+   long len;
+   size_t read_len;
+   char *buf  = NULL;
    FILE *file = NULL;
    struct config_file *conf = (struct config_file*)calloc(1, sizeof(*conf));
    if (!conf)
@@ -372,7 +559,7 @@ static config_file_t *config_file_new_internal(
    }
 
    conf->include_depth = depth;
-   file = fopen(path, "r");
+   file = fopen(path, "rb");
 
    if (!file)
    {
@@ -381,48 +568,27 @@ static config_file_t *config_file_new_internal(
       return NULL;
    }
 
-   while (!feof(file))
+   /* Read in one go, then parsed in place. */
+   if (fseek(file, 0, SEEK_END) != 0 || (len = ftell(file)) < 0
+         || fseek(file, 0, SEEK_SET) != 0
+         || !(buf = (char*)config_arena_alloc(conf, len + 1)))
    {
-      struct config_entry_list *list = (struct config_entry_list*)
-         calloc(1, sizeof(*list));
-      char *line = NULL;
-
-      if (!list)
-      {
-         config_file_free(conf);
-         fclose(file);
-         return NULL;
-      }
-
-      line = getaline(file);
-
-      if (line)
-      {
-         if (parse_line(conf, list, line))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries = list;
-
-            conf->tail = list;
-         }
-
-         free(line);
-      }
-
-      if (list != conf->tail)
-         free(list);
+      fclose(file);
+      config_file_free(conf);
+      return NULL;
    }
+
+   read_len      = fread(buf, 1, len, file);
+   buf[read_len] = '\0';
    fclose(file);
 
+   config_parse(conf, buf);
+
    return conf;
 }
 
 config_file_t *config_file_new_from_string(const char *from_string)
 {
-   size_t i;
-   struct string_list *lines = NULL;
    struct config_file *conf = (struct config_file*)calloc(1, sizeof(*conf));
    if (!conf)
       return NULL;
@@ -432,43 +598,23 @@ config_file_t *config_file_new_from_string(const char *from_string)
 
    conf->path = NULL;
    conf->include_depth = 0;
-   
-   lines = string_split(from_string, "\n");
-   if (!lines)
-      return conf;
-
-   for (i = 0; i < lines->size; i++)
-   {
-      struct config_entry_list *list = (struct config_entry_list*)
-         calloc(1, sizeof(*list));
-      char* line = lines->elems[i].data;
 
-      if (!list)
-      {
-         string_list_free(lines);
-         config_file_free(conf);
-         return NULL;
-      }
-
-      if (line)
-      {
-         if (parse_line(conf, list, line))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries = list;
+   from_string = config_arena_strdup(conf, from_string);
+   if (!from_string)
+      return conf;
 
-            conf->tail = list;
-         }
-      }
+   config_parse(conf, (char*)from_string);
 
-      if (list != conf->tail)
-         free(list);
-   }
+   return conf;
+}
 
-   string_list_free(lines);
+config_file_t *config_file_new_layer(const config_file_t *base)
+{
+   struct config_file *conf = (struct config_file*)calloc(1, sizeof(*conf));
+   if (!conf)
+      return NULL;
 
+   conf->base = base;
    return conf;
 }
 
@@ -479,208 +625,154 @@ config_file_t *config_file_new(const char *path)
 
 void config_file_free(config_file_t *conf)
 {
-   struct config_include_list *inc_tmp = NULL;
-   struct config_entry_list *tmp = NULL;
+   struct config_entry_list *list = NULL;
+   struct config_arena *arena     = NULL;
    if (!conf)
       return;
 
-   tmp = conf->entries;
-   while (tmp)
+   for (list = conf->entries; list; list = list->next)
    {
-      struct config_entry_list *hold = NULL;
-      free(tmp->key);
-      free(tmp->value);
-      hold = tmp;
-      tmp = tmp->next;
-      free(hold);
+      if (list->value_heap)
+         free(list->value);
    }
 
-   inc_tmp = (struct config_include_list*)conf->includes;
-   while (inc_tmp)
+   arena = conf->arena;
+   while (arena)
    {
-      struct config_include_list *hold = NULL;
-      free(inc_tmp->path);
-      hold = (struct config_include_list*)inc_tmp;
-      inc_tmp = inc_tmp->next;
+      struct config_arena *hold = arena;
+      arena = arena->next;
       free(hold);
    }
 
+   free(conf->buckets);
    free(conf->path);
    free(conf);
 }
 
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *in = strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   *in = strtod(list->value, NULL);
+   return true;
 }
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         /* strtof() is C99/POSIX. Just use the more portable kind. */
-         *in = (float)strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   /* strtof() is C99/POSIX. Just use the more portable kind. */
+   *in = (float)strtod(list->value, NULL);
+   return true;
 }
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   struct config_entry_list *list = conf->entries;
+   int val;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         int val;
-         errno = 0;
-         val = strtol(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtol(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   struct config_entry_list *list = conf->entries;
+   uint64_t val;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         uint64_t val;
-         errno = 0;
-         val = strtoull(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoull(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list != NULL)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoul(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
 
-   return false;
+   *in = val;
+   return true;
 }
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 16);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoul(list->value, NULL, 16);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (list->value[0] && list->value[1])
-            return false;
-         *in = *list->value;
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   if (list->value[0] && list->value[1])
+      return false;
+   *in = *list->value;
+   return true;
 }
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *str = strdup(list->value);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   *str = strdup(list->value);
+   return true;
 }
 
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-         return strlcpy(buf, list->value, size) < size;
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   return strlcpy(buf, list->value, size) < size;
 }
 
 bool config_get_path(config_file_t *conf, const char *key,
@@ -689,77 +781,73 @@ bool config_get_path(config_file_t *conf, const char *key,
 #if defined(RARCH_CONSOLE)
    return config_get_array(conf, key, buf, size);
 #else
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         fill_pathname_expand_special(buf, list->value, size);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   fill_pathname_expand_special(buf, list->value, size);
+   return true;
 #endif
 }
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   struct config_entry_list *list = conf->entries;
+   struct config_entry_list *list = config_find_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (strcasecmp(list->value, "true") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "1") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "false") == 0)
-            *in = false;
-         else if (strcasecmp(list->value, "0") == 0)
-            *in = false;
-         else
-            return false;
-
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   if (strcasecmp(list->value, "true") == 0)
+      *in = true;
+   else if (strcasecmp(list->value, "1") == 0)
+      *in = true;
+   else if (strcasecmp(list->value, "false") == 0)
+      *in = false;
+   else if (strcasecmp(list->value, "0") == 0)
+      *in = false;
+   else
+      return false;
+
+   return true;
 }
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *elem = NULL;
-   struct config_entry_list *list = conf->entries;
-   struct config_entry_list *last = list;
-   while (list)
+   char *value                    = NULL;
+   struct config_entry_list *list = config_find_own_entry(conf, key);
+
+   /* Entries from an #include come first, but are not
+    * the ones to change. A base is never changed either,
+    * the layer gets an entry of its own. */
+   for (; list; list = list->next)
    {
       if (!list->readonly && (strcmp(key, list->key) == 0))
       {
-         free(list->value);
-         list->value = strdup(val);
+         size_t len = strlen(val);
+
+         /* A value that fits is overwritten in place. A longer
+          * one moves to the heap and is grown there from then
+          * on, so setting a key over and over does not keep
+          * taking new space from the arena. */
+         if (len <= strlen(list->value))
+            memmove(list->value, val, len + 1);
+         else if ((value = (char*)realloc(
+                     list->value_heap ? list->value : NULL, len + 1)))
+         {
+            memcpy(value, val, len + 1);
+            list->value      = value;
+            list->value_heap = true;
+         }
          return;
       }
-
-      last = list;
-      list = list->next;
    }
 
-   elem = (struct config_entry_list*)calloc(1, sizeof(*elem));
-
-   if (!elem)
-      return;
-
-   elem->key = strdup(key);
-   elem->value = strdup(val);
+   key   = config_arena_strdup(conf, key);
+   value = config_arena_strdup(conf, val);
 
-   if (last)
-      last->next = elem;
-   else
-      conf->entries = elem;
+   if (key && value)
+      config_add_entry(conf, (char*)key, value);
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -828,58 +916,101 @@ void config_set_bool(config_file_t *conf, const char *key, bool val)
    config_set_string(conf, key, val ? "true" : "false");
 }
 
-bool config_file_write(config_file_t *conf, const char *path)
+char *config_file_serialize(config_file_t *conf, size_t *len)
 {
-   FILE *file;
+   char *buf, *out;
+   size_t size = 1;
+   struct config_entry_list *list       = NULL;
+   struct config_include_list *includes = NULL;
 
-   if (path)
+   for (includes = conf->includes; includes; includes = includes->next)
+      size += strlen(includes->path) + sizeof("#include \"\"\n") - 1;
+
+   for (list = conf->entries; list; list = list->next)
+      if (!list->readonly)
+         size += strlen(list->key) + strlen(list->value)
+            + sizeof(" = \"\"\n") - 1;
+
+   if (!(buf = (char*)malloc(size)))
+      return NULL;
+
+   out = buf;
+   for (includes = conf->includes; includes; includes = includes->next)
+      out += sprintf(out, "#include \"%s\"\n", includes->path);
+
+   for (list = conf->entries; list; list = list->next)
+      if (!list->readonly)
+         out += sprintf(out, "%s = \"%s\"\n", list->key, list->value);
+
+   *out = '\0';
+   if (len)
+      *len = out - buf;
+   return buf;
+}
+
+bool config_file_write_data(const char *path, const void *data, size_t len)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   bool ret   = false;
+   FILE *file = NULL;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+   if (!(file = fopen(tmp_path, "w")))
+      return false;
+
+   ret = fwrite(data, 1, len, file) == len;
+   if (fclose(file) != 0)
+      ret = false;
+
+#ifdef _WIN32
+   /* rename() does not replace existing files here. */
+   if (ret)
+      remove(path);
+#endif
+
+   if (!ret || rename(tmp_path, path) != 0)
    {
-      file = fopen(path, "w");
-      if (!file)
-         return false;
+      remove(tmp_path);
+      return false;
    }
-   else
-      file = stdout;
 
-   config_file_dump(conf, file);
+   return true;
+}
+
+bool config_file_write(config_file_t *conf, const char *path)
+{
+   bool ret = false;
+   size_t len = 0;
+   char *buf = config_file_serialize(conf, &len);
+
+   if (!buf)
+      return false;
 
    if (path)
-      fclose(file);
+      ret = config_file_write_data(path, buf, len);
+   else
+      ret = fwrite(buf, 1, len, stdout) == len;
 
-   return true;
+   free(buf);
+   return ret;
 }
 
 void config_file_dump(config_file_t *conf, FILE *file)
 {
-   struct config_entry_list *list = NULL;
-   struct config_include_list *includes = conf->includes;
-   while (includes)
-   {
-      fprintf(file, "#include \"%s\"\n", includes->path);
-      includes = includes->next;
-   }
+   size_t len = 0;
+   char *buf = config_file_serialize(conf, &len);
 
-   list = (struct config_entry_list*)conf->entries;
-   while (list)
-   {
-      if (!list->readonly)
-         fprintf(file, "%s = \"%s\"\n", list->key, list->value);
-      list = list->next;
-   }
+   if (!buf)
+      return;
+
+   fwrite(buf, 1, len, file);
+   free(buf);
 }
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (strcmp(entry, list->key) == 0)
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_find_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
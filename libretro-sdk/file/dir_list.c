@@ -46,6 +46,7 @@
 #endif
 
 #include <retro_miscellaneous.h>
+#include <string/string_sort.h>
 
 static int qstrcmp_plain(const void *a_, const void *b_)
 {
@@ -79,9 +80,44 @@ static int qstrcmp_dir(const void *a_, const void *b_)
  **/
 void dir_list_sort(struct string_list *list, bool dir_first)
 {
-   if (list)
+   size_t i, len = 0;
+   char *folded                   = NULL;
+   struct string_sort_key *keys   = NULL;
+   struct string_list_elem *elems = NULL;
+
+   if (!list || list->size < 2)
+      return;
+
+   for (i = 0; i < list->size; i++)
+      len += strlen(list->elems[i].data) + 1;
+
+   keys   = (struct string_sort_key*)malloc(2 * list->size * sizeof(*keys));
+   elems  = (struct string_list_elem*)malloc(list->size * sizeof(*elems));
+   folded = (char*)malloc(len);
+
+   if (!keys || !elems || !folded)
+   {
       qsort(list->elems, list->size, sizeof(struct string_list_elem),
             dir_first ? qstrcmp_dir : qstrcmp_plain);
+      goto end;
+   }
+
+   /* Higher file types go first, see enum in file_path.h. */
+   for (i = 0, len = 0; i < list->size; i++)
+      len += string_sort_key_init(&keys[i], folded + len,
+            list->elems[i].data, dir_first ?
+            255 - (uint8_t)list->elems[i].attr.i : 0, i);
+
+   string_sort_keys(keys, keys + list->size, list->size);
+
+   for (i = 0; i < list->size; i++)
+      elems[i] = list->elems[keys[i].index];
+   memcpy(list->elems, elems, list->size * sizeof(*elems));
+
+end:
+   free(keys);
+   free(elems);
+   free(folded);
 }
 
 /**
@@ -127,6 +163,42 @@ static bool dirent_is_directory(const char *path,
 }
 #endif
 
+/**
+ * dir_list_ext_list_new:
+ * @ext          : allowed extensions, separated by '|'.
+ *
+ * Splits @ext, dropping any leading '.' of the extensions
+ * so entries only need one compare each.
+ *
+ * Returns: extension list, NULL if @ext is.
+ **/
+static struct string_list *dir_list_ext_list_new(const char *ext)
+{
+   size_t i;
+   struct string_list *ext_list = ext ? string_split(ext, "|") : NULL;
+
+   for (i = 0; ext_list && i < ext_list->size; i++)
+   {
+      char *elem = ext_list->elems[i].data;
+      if (*elem == '.')
+         memmove(elem, elem + 1, strlen(elem));
+   }
+
+   return ext_list;
+}
+
+static bool dir_list_ext_supported(const struct string_list *ext_list,
+      const char *file_ext)
+{
+   size_t i;
+
+   for (i = 0; ext_list && i < ext_list->size; i++)
+      if (strcasecmp(ext_list->elems[i].data, file_ext) == 0)
+         return true;
+
+   return false;
+}
+
 /**
  * parse_dir_entry:
  * @name         : name of the directory listing entry.
@@ -156,7 +228,7 @@ static int parse_dir_entry(const char *name, char *file_path,
    if (!is_dir)
    {
       is_compressed_file = path_is_compressed_file(file_path);
-      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+      if (dir_list_ext_supported(ext_list, file_ext))
          supported_by_core = true;
    }
 
@@ -217,11 +289,10 @@ struct string_list *dir_list_new(const char *dir,
    ext_list = NULL;
    (void)path_buf;
 
-   if (!(list = string_list_new()))
+   if (!(list = string_list_new_arena()))
       return NULL;
 
-   if (ext)
-      ext_list = string_split(ext, "|");
+   ext_list = dir_list_ext_list_new(ext);
 
 #ifdef _WIN32
    snprintf(path_buf, sizeof(path_buf), "%s\\*", dir);
@@ -23,9 +23,127 @@
 #include <stdlib.h>
 #include <string.h>
 #include <file/file_list.h>
+#include <string/string_sort.h>
 #include <compat/strcasestr.h>
 #include <compat/posix_string.h>
 
+#define FILE_LIST_ARENA_MIN (4 * 1024)
+
+/* Block of entry strings, the bytes follow the header. */
+struct file_list_arena
+{
+   struct file_list_arena *next;
+   size_t size;
+   size_t used;
+};
+
+/**
+ * file_list_arena_dup:
+ * @list             : pointer to file list
+ * @str              : string to copy, can be NULL
+ *
+ * Copies @str into the list's current block, starting a new,
+ * twice as large one when it does not fit.
+ *
+ * Returns: the copy, or NULL if @str is NULL or out of memory.
+ **/
+static char *file_list_arena_dup(file_list_t *list, const char *str)
+{
+   char *data;
+   size_t len;
+   struct file_list_arena *block = list->arena;
+
+   if (!str)
+      return NULL;
+
+   len = strlen(str) + 1;
+
+   if (!block || block->size - block->used < len)
+   {
+      size_t size = block ? block->size * 2 : FILE_LIST_ARENA_MIN;
+
+      while (size < len)
+         size *= 2;
+
+      block = (struct file_list_arena*)malloc(sizeof(*block) + size);
+      if (!block)
+         return NULL;
+
+      block->next = list->arena;
+      block->size = size;
+      block->used = 0;
+      list->arena = block;
+   }
+
+   /* Can overlap when set to a string it just released. */
+   data = (char*)(block + 1) + block->used;
+   memmove(data, str, len);
+   block->used += len;
+   return data;
+}
+
+/**
+ * file_list_arena_release:
+ * @list             : pointer to file list
+ * @str              : string from file_list_arena_dup(), can be NULL
+ *
+ * Gives the space of @str back if it is the last string carved
+ * from the current block, which is the case for entries popped
+ * off the end, as the menu stack does.
+ **/
+static void file_list_arena_release(file_list_t *list, const char *str)
+{
+   size_t len;
+   struct file_list_arena *block = list->arena;
+
+   if (!str || !block)
+      return;
+
+   len = strlen(str) + 1;
+   if (block->used >= len &&
+         str == (const char*)(block + 1) + block->used - len)
+      block->used -= len;
+}
+
+/**
+ * file_list_arena_reset:
+ * @list             : pointer to file list
+ *
+ * Drops all strings. A list which overflowed its block gets one
+ * block as large as all of them, so the next rebuild of the same
+ * list fits in it.
+ **/
+static void file_list_arena_reset(file_list_t *list)
+{
+   size_t size = 0;
+   struct file_list_arena *block = list->arena;
+
+   if (!block)
+      return;
+
+   if (!block->next)
+   {
+      block->used = 0;
+      return;
+   }
+
+   while (block)
+   {
+      struct file_list_arena *next = block->next;
+      size += block->size;
+      free(block);
+      block = next;
+   }
+
+   list->arena = (struct file_list_arena*)malloc(sizeof(*block) + size);
+   if (!list->arena)
+      return;
+
+   list->arena->next = NULL;
+   list->arena->size = size;
+   list->arena->used = 0;
+}
+
 void file_list_push(file_list_t *list,
       const char *path, const char *label,
       unsigned type, size_t directory_ptr)
@@ -38,8 +156,9 @@ void file_list_push(file_list_t *list,
             list->capacity * sizeof(struct item_file));
    }
 
-   list->list[list->size].label = strdup(label);
-   list->list[list->size].path = strdup(path);
+   /* Popped in reverse, see file_list_pop(). */
+   list->list[list->size].path = file_list_arena_dup(list, path);
+   list->list[list->size].label = file_list_arena_dup(list, label);
    list->list[list->size].alt = NULL;
    list->list[list->size].type = type;
    list->list[list->size].directory_ptr = directory_ptr;
@@ -65,8 +184,15 @@ void file_list_pop(file_list_t *list, size_t *directory_ptr)
    if (list->size != 0)
    {
       --list->size;
-      free(list->list[list->size].path);
-      free(list->list[list->size].label);
+      file_list_arena_release(list, list->list[list->size].alt);
+      file_list_arena_release(list, list->list[list->size].label);
+      file_list_arena_release(list, list->list[list->size].path);
+      list->list[list->size].alt = NULL;
+      list->list[list->size].label = NULL;
+      list->list[list->size].path = NULL;
+
+      if (list->size == 0)
+         file_list_arena_reset(list);
    }
 
    if (directory_ptr)
@@ -75,16 +201,16 @@ void file_list_pop(file_list_t *list, size_t *directory_ptr)
 
 void file_list_free(file_list_t *list)
 {
-   size_t i;
-
    if (!list)
       return;
 
-   for (i = 0; i < list->size; i++)
+   while (list->arena)
    {
-      free(list->list[i].path);
-      free(list->list[i].label);
+      struct file_list_arena *next = list->arena->next;
+      free(list->arena);
+      list->arena = next;
    }
+
    free(list->list);
    free(list);
 }
@@ -95,33 +221,38 @@ void file_list_clear(file_list_t *list)
 
    for (i = 0; i < list->size; i++)
    {
-      free(list->list[i].path);
       list->list[i].path = NULL;
-      free(list->list[i].label);
       list->list[i].label = NULL;
-      free(list->list[i].alt);
       list->list[i].alt = NULL;
    }
 
    list->size = 0;
+   file_list_arena_reset(list);
 }
 
 void file_list_copy(file_list_t *list, file_list_t *list_old)
 {
    size_t i;
 
-   list_old->size = list->size;
-   list_old->capacity = list->capacity;
+   file_list_clear(list_old);
 
-   list_old->list = (struct item_file*)realloc(list_old->list,
+   if (list_old->capacity < list->capacity)
+   {
+      list_old->capacity = list->capacity;
+      list_old->list = (struct item_file*)realloc(list_old->list,
             list_old->capacity * sizeof(struct item_file));
+   }
+
+   list_old->size = list->size;
 
    for (i = 0; i < list->size; i++)
    {
-      list_old->list[i].path = strdup(list->list[i].path);
-      list_old->list[i].label = strdup(list->list[i].label);
-      if (list->list[i].alt)
-         list_old->list[i].alt = strdup(list->list[i].alt);
+      list_old->list[i].path = file_list_arena_dup(list_old,
+            list->list[i].path);
+      list_old->list[i].label = file_list_arena_dup(list_old,
+            list->list[i].label);
+      list_old->list[i].alt = file_list_arena_dup(list_old,
+            list->list[i].alt);
       list_old->list[i].type = list->list[i].type;
       list_old->list[i].directory_ptr = list->list[i].directory_ptr;
       list_old->list[i].userdata = list->list[i].userdata;
@@ -132,8 +263,8 @@ void file_list_copy(file_list_t *list, file_list_t *list_old)
 void file_list_set_label_at_offset(file_list_t *list, size_t idx,
       const char *label)
 {
-   free(list->list[idx].label);
-   list->list[idx].label = strdup(label);
+   file_list_arena_release(list, list->list[idx].label);
+   list->list[idx].label = file_list_arena_dup(list, label);
 }
 
 void file_list_get_label_at_offset(const file_list_t *list, size_t idx,
@@ -147,8 +278,8 @@ void file_list_get_label_at_offset(const file_list_t *list, size_t idx,
 void file_list_set_alt_at_offset(file_list_t *list, size_t idx,
       const char *alt)
 {
-   free(list->list[idx].alt);
-   list->list[idx].alt = strdup(alt);
+   file_list_arena_release(list, list->list[idx].alt);
+   list->list[idx].alt = file_list_arena_dup(list, alt);
 }
 
 void file_list_get_alt_at_offset(const file_list_t *list, size_t idx,
@@ -170,7 +301,44 @@ static int file_list_alt_cmp(const void *a_, const void *b_)
 
 void file_list_sort_on_alt(file_list_t *list)
 {
-   qsort(list->list, list->size, sizeof(list->list[0]), file_list_alt_cmp);
+   size_t i, len = 0;
+   char *folded                 = NULL;
+   struct string_sort_key *keys = NULL;
+   struct item_file *items      = NULL;
+
+   if (list->size < 2)
+      return;
+
+   for (i = 0; i < list->size; i++)
+      len += strlen(list->list[i].alt ?
+            list->list[i].alt : list->list[i].path) + 1;
+
+   keys   = (struct string_sort_key*)malloc(2 * list->size * sizeof(*keys));
+   items  = (struct item_file*)malloc(list->size * sizeof(*items));
+   folded = (char*)malloc(len);
+
+   if (!keys || !items || !folded)
+   {
+      qsort(list->list, list->size, sizeof(list->list[0]),
+            file_list_alt_cmp);
+      goto end;
+   }
+
+   for (i = 0, len = 0; i < list->size; i++)
+      len += string_sort_key_init(&keys[i], folded + len,
+            list->list[i].alt ? list->list[i].alt : list->list[i].path,
+            0, i);
+
+   string_sort_keys(keys, keys + list->size, list->size);
+
+   for (i = 0; i < list->size; i++)
+      items[i] = list->list[keys[i].index];
+   memcpy(list->list, items, list->size * sizeof(*items));
+
+end:
+   free(keys);
+   free(items);
+   free(folded);
 }
 
 void *file_list_get_userdata_at_offset(const file_list_t *list, size_t idx)
@@ -28,14 +28,50 @@
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef __ARM_NEON__
+#undef __ARM_NEON
 #endif
 
 #if defined(__SSE2__)
 #include <emmintrin.h>
 #endif
 
-#if defined(__SSE2_)
-void conv_rgb565_0rgb1555(void *output_, const void *input_,
+/* AVX2 kernels are built with a target attribute and only picked
+ * when the CPU reports AVX2, so one x86 binary runs everywhere. */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) && \
+   (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define PIXCONV_AVX2
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXCONV_NEON
+#endif
+
+static void conv_rgb565_0rgb1555_c(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t hi = (col >> 1) & 0x7fe0;
+         uint16_t lo = col & 0x1f;
+         output[w] = hi | lo;
+      }
+   }
+}
+
+#if defined(__SSE2__)
+static void conv_rgb565_0rgb1555_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -54,7 +90,7 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (w = 0; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
@@ -68,8 +104,9 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_rgb565_0rgb1555(void *output_, const void *input_,
+#endif
+
+static void conv_0rgb1555_rgb565_c(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -83,17 +120,16 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (w = 0; w < width; w++)
       {
          uint16_t col = input[w];
-         uint16_t hi = (col >> 1) & 0x7fe0;
-         uint16_t lo = col & 0x1f;
-         output[w] = hi | lo;
+         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
+         uint16_t b = col & 0x1f;
+         uint16_t glow = (col >> 4) & (1 << 5);
+         output[w] = rg | b | glow;
       }
    }
 }
 
-#endif
-
 #if defined(__SSE2__)
-void conv_0rgb1555_rgb565(void *output_, const void *input_,
+static void conv_0rgb1555_rgb565_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -131,32 +167,36 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_0rgb1555_rgb565(void *output_, const void *input_,
+#endif
+
+static void conv_0rgb1555_argb8888_c(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint16_t *input = (const uint16_t*)input_;
-   uint16_t *output = (uint16_t*)output_;
+   uint32_t *output      = (uint32_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 1, input += in_stride >> 1)
+         h++, output += out_stride >> 2, input += in_stride >> 1)
    {
       for (w = 0; w < width; w++)
       {
-         uint16_t col = input[w];
-         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
-         uint16_t b = col & 0x1f;
-         uint16_t glow = (col >> 4) & (1 << 5);
-         output[w] = rg | b | glow;
+         uint32_t col = input[w];
+         uint32_t r = (col >> 10) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 3) | (g >> 2);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
-#endif
 
 #if defined(__SSE2__)
-void conv_0rgb1555_argb8888(void *output_, const void *input_,
+static void conv_0rgb1555_argb8888_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -214,8 +254,9 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_0rgb1555_argb8888(void *output_, const void *input_,
+#endif
+
+static void conv_rgb565_argb8888_c(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -229,21 +270,20 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 10) & 0x1f;
-         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
          uint32_t b = (col >>  0) & 0x1f;
          r = (r << 3) | (r >> 2);
-         g = (g << 3) | (g >> 2);
+         g = (g << 2) | (g >> 4);
          b = (b << 3) | (b >> 2);
 
          output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
-#endif
 
 #if defined(__SSE2__)
-void conv_rgb565_argb8888(void *output_, const void *input_,
+static void conv_rgb565_argb8888_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -303,8 +343,9 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_rgb565_argb8888(void *output_, const void *input_,
+#endif
+
+void conv_rgba4444_argb8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -318,43 +359,74 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 11) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 12) & 0xf;
+         uint32_t g = (col >>  8) & 0xf;
+         uint32_t b = (col >>  4) & 0xf;
+         uint32_t a = (col >>  0) & 0xf;
+         r = (r << 4) | r;
+         g = (g << 4) | g;
+         b = (b << 4) | b;
+         a = (a << 4) | a;
+
+         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static void conv_0rgb1555_bgr24_c(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+      for (w = 0; w < width; w++)
+      {
+         uint32_t col = input[w];
          uint32_t b = (col >>  0) & 0x1f;
-         r = (r << 3) | (r >> 2);
-         g = (g << 2) | (g >> 4);
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
          b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
 
-         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
       }
    }
 }
-#endif
 
-void conv_rgba4444_argb8888(void *output_, const void *input_,
+static void conv_rgb565_bgr24_c(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint16_t *input = (const uint16_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   uint8_t *output       = (uint8_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride, input += in_stride >> 1)
    {
+      uint8_t *out = output;
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 12) & 0xf;
-         uint32_t g = (col >>  8) & 0xf;
-         uint32_t b = (col >>  4) & 0xf;
-         uint32_t a = (col >>  0) & 0xf;
-         r = (r << 4) | r;
-         g = (g << 4) | g;
-         b = (b << 4) | b;
-         a = (a << 4) | a;
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 11) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 2) | (g >> 4);
+         r = (r << 3) | (r >> 2);
 
-         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
       }
    }
 }
@@ -405,7 +477,7 @@ static inline void store_bgr24_sse2(void *output, __m128i a,
                   _mm_or_si128(c3, _mm_or_si128(c4, c5))))));
 }
 
-void conv_0rgb1555_bgr24(void *output_, const void *input_,
+static void conv_0rgb1555_bgr24_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -483,7 +555,7 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
    }
 }
 
-void conv_rgb565_bgr24(void *output_, const void *input_,
+static void conv_rgb565_bgr24_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -560,64 +632,6 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_0rgb1555_bgr24(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
-{
-   int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
-
-   for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 1)
-   {
-      uint8_t *out = output;
-      for (w = 0; w < width; w++)
-      {
-         uint32_t col = input[w];
-         uint32_t b = (col >>  0) & 0x1f;
-         uint32_t g = (col >>  5) & 0x1f;
-         uint32_t r = (col >> 10) & 0x1f;
-         b = (b << 3) | (b >> 2);
-         g = (g << 3) | (g >> 2);
-         r = (r << 3) | (r >> 2);
-
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
-      }
-   }
-}
-
-void conv_rgb565_bgr24(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
-{
-   int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
-
-   for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 1)
-   {
-      uint8_t *out = output;
-      for (w = 0; w < width; w++)
-      {
-         uint32_t col = input[w];
-         uint32_t b = (col >>  0) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
-         uint32_t r = (col >> 11) & 0x1f;
-         b = (b << 3) | (b >> 2);
-         g = (g << 2) | (g >> 4);
-         r = (r << 3) | (r >> 2);
-
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
-      }
-   }
-}
 #endif
 
 void conv_bgr24_argb8888(void *output_, const void *input_,
@@ -664,8 +678,7 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
    }
 }
 
-#if defined(__SSE2__)
-void conv_argb8888_bgr24(void *output_, const void *input_,
+static void conv_argb8888_bgr24_c(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -673,23 +686,11 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
-   int max_width = width - 15;
-
    for (h = 0; h < height;
          h++, output += out_stride, input += in_stride >> 2)
    {
       uint8_t *out = output;
-
-      for (w = 0; w < max_width; w += 16, out += 48)
-      {
-         store_bgr24_sse2(out,
-               _mm_loadu_si128((const __m128i*)(input + w +  0)),
-               _mm_loadu_si128((const __m128i*)(input + w +  4)),
-               _mm_loadu_si128((const __m128i*)(input + w +  8)),
-               _mm_loadu_si128((const __m128i*)(input + w + 12)));
-      }
-
-      for (; w < width; w++)
+      for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
          *out++ = (uint8_t)(col >>  0);
@@ -698,8 +699,9 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_argb8888_bgr24(void *output_, const void *input_,
+
+#if defined(__SSE2__)
+static void conv_argb8888_bgr24_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -707,11 +709,23 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
+   int max_width = width - 15;
+
    for (h = 0; h < height;
          h++, output += out_stride, input += in_stride >> 2)
    {
       uint8_t *out = output;
-      for (w = 0; w < width; w++)
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         store_bgr24_sse2(out,
+               _mm_loadu_si128((const __m128i*)(input + w +  0)),
+               _mm_loadu_si128((const __m128i*)(input + w +  4)),
+               _mm_loadu_si128((const __m128i*)(input + w +  8)),
+               _mm_loadu_si128((const __m128i*)(input + w + 12)));
+      }
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          *out++ = (uint8_t)(col >>  0);
@@ -750,8 +764,43 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
 #define YUV_MAT_V_R (90)
 #define YUV_MAT_V_G (-46)
 
+static void conv_yuyv_argb8888_c(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      for (w = 0; w < width; w += 2, src += 4, dst += 2)
+      {
+         int _y0 = src[0];
+         int  u = src[1] - 128;
+         int _y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
+
 #if defined(__SSE2__)
-void conv_yuyv_argb8888(void *output_, const void *input_,
+static void conv_yuyv_argb8888_sse2(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -878,43 +927,760 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
       }
    }
 }
-#else
-void conv_yuyv_argb8888(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
+#endif
+
+#if defined(PIXCONV_NEON)
+/* Widens eight RGB565 pixels to 8-bit B, G and R channels. */
+static inline void expand_rgb565_neon(uint16x8_t in, uint8x8_t *bgr)
+{
+   uint8x8_t r = vand_u8(vshrn_n_u16(in, 8), vdup_n_u8(0xf8));
+   uint8x8_t g = vand_u8(vshrn_n_u16(in, 3), vdup_n_u8(0xfc));
+   uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+   bgr[0] = vorr_u8(b, vshr_n_u8(b, 5));
+   bgr[1] = vorr_u8(g, vshr_n_u8(g, 6));
+   bgr[2] = vorr_u8(r, vshr_n_u8(r, 5));
+}
+
+/* Widens eight 0RGB1555 pixels to 8-bit B, G and R channels. */
+static inline void expand_0rgb1555_neon(uint16x8_t in, uint8x8_t *bgr)
+{
+   uint8x8_t r = vand_u8(vshrn_n_u16(in, 7), vdup_n_u8(0xf8));
+   uint8x8_t g = vand_u8(vshrn_n_u16(in, 2), vdup_n_u8(0xf8));
+   uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+   bgr[0] = vorr_u8(b, vshr_n_u8(b, 5));
+   bgr[1] = vorr_u8(g, vshr_n_u8(g, 5));
+   bgr[2] = vorr_u8(r, vshr_n_u8(r, 5));
+}
+
+static void conv_rgb565_0rgb1555_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   const uint16x8_t hi_mask = vdupq_n_u16(0x7fe0);
+   const uint16x8_t lo_mask = vdupq_n_u16(0x1f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         vst1q_u16(output + w, vorrq_u16(
+                  vandq_u16(vshrq_n_u16(in, 1), hi_mask),
+                  vandq_u16(in, lo_mask)));
+      }
+
+      if (w < width)
+         conv_rgb565_0rgb1555_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_rgb565_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   const uint16x8_t hi_mask   = vdupq_n_u16((0x1f << 11) | (0x1f << 6));
+   const uint16x8_t lo_mask   = vdupq_n_u16(0x1f);
+   const uint16x8_t glow_mask = vdupq_n_u16(1 << 5);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint16x8_t in   = vld1q_u16(input + w);
+         uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1), hi_mask);
+         uint16x8_t b    = vandq_u16(in, lo_mask);
+         uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4), glow_mask);
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
+
+      if (w < width)
+         conv_0rgb1555_rgb565_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_argb8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t px;
+         expand_0rgb1555_neon(vld1q_u16(input + w), px.val);
+         px.val[3] = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), px);
+      }
+
+      if (w < width)
+         conv_0rgb1555_argb8888_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_rgb565_argb8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t px;
+         expand_rgb565_neon(vld1q_u16(input + w), px.val);
+         px.val[3] = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), px);
+      }
+
+      if (w < width)
+         conv_rgb565_argb8888_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_bgr24_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint8x8x3_t px;
+         expand_0rgb1555_neon(vld1q_u16(input + w), px.val);
+         vst3_u8(output + 3 * w, px);
+      }
+
+      if (w < width)
+         conv_0rgb1555_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_rgb565_bgr24_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      for (w = 0; w + 8 <= width; w += 8)
+      {
+         uint8x8x3_t px;
+         expand_rgb565_neon(vld1q_u16(input + w), px.val);
+         vst3_u8(output + 3 * w, px);
+      }
+
+      if (w < width)
+         conv_rgb565_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_argb8888_bgr24_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         uint8x16x4_t argb = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16x3_t bgr;
+         bgr.val[0] = argb.val[0];
+         bgr.val[1] = argb.val[1];
+         bgr.val[2] = argb.val[2];
+         vst3q_u8(output + 3 * w, bgr);
+      }
+
+      if (w < width)
+         conv_argb8888_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+static void conv_yuyv_argb8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
 {
    int h, w;
    const uint8_t *input = (const uint8_t*)input_;
    uint32_t *output     = (uint32_t*)output_;
 
+   const int16x8_t chroma_offset = vdupq_n_s16(128);
+   const int16x8_t round_offset  = vdupq_n_s16(YUV_OFFSET);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      /* Each loop processes 16 pixels. The products fit in 16 bits,
+       * so this matches the C path exactly. */
+      for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         uint8x8x4_t px;
+         uint8x8x2_t r, g, b;
+         uint8x8x4_t yuv = vld4_u8(src); /* [Y even, U, Y odd, V] */
+
+         int16x8_t y0 = vreinterpretq_s16_u16(vshll_n_u8(yuv.val[0], 6));
+         int16x8_t y1 = vreinterpretq_s16_u16(vshll_n_u8(yuv.val[2], 6));
+         int16x8_t u  = vsubq_s16(
+               vreinterpretq_s16_u16(vmovl_u8(yuv.val[1])), chroma_offset);
+         int16x8_t v  = vsubq_s16(
+               vreinterpretq_s16_u16(vmovl_u8(yuv.val[3])), chroma_offset);
+
+         /* Chroma contributions, shared by both pixels of a pair. */
+         int16x8_t cr = vmlaq_n_s16(round_offset, v, YUV_MAT_V_R);
+         int16x8_t cg = vmlaq_n_s16(vmlaq_n_s16(round_offset,
+                  u, YUV_MAT_U_G), v, YUV_MAT_V_G);
+         int16x8_t cb = vmlaq_n_s16(round_offset, u, YUV_MAT_U_B);
+
+         /* Saturate into 8-bit and put even and odd pixels back in order. */
+         r = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, cr), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(y1, cr), YUV_SHIFT));
+         g = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, cg), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(y1, cg), YUV_SHIFT));
+         b = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, cb), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(y1, cb), YUV_SHIFT));
+
+         px.val[3] = vdup_n_u8(0xff);
+         px.val[0] = b.val[0];
+         px.val[1] = g.val[0];
+         px.val[2] = r.val[0];
+         vst4_u8((uint8_t*)(dst + 0), px);
+         px.val[0] = b.val[1];
+         px.val[1] = g.val[1];
+         px.val[2] = r.val[1];
+         vst4_u8((uint8_t*)(dst + 8), px);
+      }
+
+      if (w < width)
+         conv_yuyv_argb8888_c(dst, src, width - w, 1, out_stride, in_stride);
+   }
+}
+#endif
+
+#if defined(PIXCONV_AVX2)
+/* Splits sixteen RGB565 pixels into 16-bit B, G and R lanes. */
+__attribute__((target("avx2")))
+static inline void expand_rgb565_avx2(__m256i in,
+      __m256i *r, __m256i *g, __m256i *b)
+{
+   *r = _mm256_mulhi_epi16(_mm256_and_si256(_mm256_srli_epi16(in, 1),
+            _mm256_set1_epi16(0x1f << 10)), _mm256_set1_epi16(0x0210));
+   *g = _mm256_mulhi_epi16(_mm256_and_si256(in,
+            _mm256_set1_epi16(0x3f << 5)), _mm256_set1_epi16(0x2080));
+   *b = _mm256_mulhi_epi16(_mm256_and_si256(_mm256_slli_epi16(in, 5),
+            _mm256_set1_epi16(0x1f << 5)), _mm256_set1_epi16(0x4200));
+}
+
+/* Splits sixteen 0RGB1555 pixels into 16-bit B, G and R lanes. */
+__attribute__((target("avx2")))
+static inline void expand_0rgb1555_avx2(__m256i in,
+      __m256i *r, __m256i *g, __m256i *b)
+{
+   const __m256i pix_mask_gb = _mm256_set1_epi16(0x1f << 5);
+   const __m256i mul15_mid   = _mm256_set1_epi16(0x4200);
+
+   *r = _mm256_mulhi_epi16(_mm256_and_si256(in,
+            _mm256_set1_epi16(0x1f << 10)), _mm256_set1_epi16(0x0210));
+   *g = _mm256_mulhi_epi16(_mm256_and_si256(in, pix_mask_gb), mul15_mid);
+   *b = _mm256_mulhi_epi16(_mm256_and_si256(_mm256_slli_epi16(in, 5),
+            pix_mask_gb), mul15_mid);
+}
+
+/* Packs sixteen pixels worth of B, G and R lanes into ARGB8888,
+ * pixels 0-7 in @lo and 8-15 in @hi. */
+__attribute__((target("avx2")))
+static inline void pack_argb8888_avx2(__m256i r, __m256i g, __m256i b,
+      __m256i *lo, __m256i *hi)
+{
+   const __m256i a  = _mm256_set1_epi16(0x00ff);
+   __m256i res_lo   = _mm256_or_si256(_mm256_unpacklo_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpacklo_epi8(r, a), 2));
+   __m256i res_hi   = _mm256_or_si256(_mm256_unpackhi_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpackhi_epi8(r, a), 2));
+
+   /* Unpacking works within 128-bit lanes, put the pixels back in order. */
+   *lo = _mm256_permute2x128_si256(res_lo, res_hi, 0x20);
+   *hi = _mm256_permute2x128_si256(res_lo, res_hi, 0x31);
+}
+
+/* Stores eight ARGB8888 pixels as 24 bytes of BGR24. */
+__attribute__((target("avx2")))
+static inline void store_bgr24_avx2(uint8_t *out, __m256i argb)
+{
+   const __m256i shuf = _mm256_setr_epi8(
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+   const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+   __m256i bgr = _mm256_permutevar8x32_epi32(
+         _mm256_shuffle_epi8(argb, shuf), perm);
+
+   _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(bgr));
+   _mm_storel_epi64((__m128i*)(out + 16), _mm256_extracti128_si256(bgr, 1));
+}
+
+__attribute__((target("avx2")))
+static void conv_0rgb1555_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride)
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         __m256i r, g, b, lo, hi;
+         expand_0rgb1555_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w)), &r, &g, &b);
+         pack_argb8888_avx2(r, g, b, &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      if (w < width)
+         conv_0rgb1555_argb8888_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+__attribute__((target("avx2")))
+static void conv_rgb565_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         __m256i r, g, b, lo, hi;
+         expand_rgb565_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w)), &r, &g, &b);
+         pack_argb8888_avx2(r, g, b, &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      if (w < width)
+         conv_rgb565_argb8888_c(output + w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+__attribute__((target("avx2")))
+static void conv_0rgb1555_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         __m256i r, g, b, lo, hi;
+         expand_0rgb1555_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w)), &r, &g, &b);
+         pack_argb8888_avx2(r, g, b, &lo, &hi);
+         store_bgr24_avx2(output + 3 * w +  0, lo);
+         store_bgr24_avx2(output + 3 * w + 24, hi);
+      }
+
+      if (w < width)
+         conv_0rgb1555_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+__attribute__((target("avx2")))
+static void conv_rgb565_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         __m256i r, g, b, lo, hi;
+         expand_rgb565_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w)), &r, &g, &b);
+         pack_argb8888_avx2(r, g, b, &lo, &hi);
+         store_bgr24_avx2(output + 3 * w +  0, lo);
+         store_bgr24_avx2(output + 3 * w + 24, hi);
+      }
+
+      if (w < width)
+         conv_rgb565_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+__attribute__((target("avx2")))
+static void conv_argb8888_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      for (w = 0; w + 16 <= width; w += 16)
+      {
+         store_bgr24_avx2(output + 3 * w +  0,
+               _mm256_loadu_si256((const __m256i*)(input + w + 0)));
+         store_bgr24_avx2(output + 3 * w + 24,
+               _mm256_loadu_si256((const __m256i*)(input + w + 8)));
+      }
+
+      if (w < width)
+         conv_argb8888_bgr24_c(output + 3 * w, input + w,
+               width - w, 1, out_stride, in_stride);
+   }
+}
+
+__attribute__((target("avx2")))
+static void conv_yuyv_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   const __m256i mask_y        = _mm256_set1_epi16(0xff);
+   const __m256i mask_u        = _mm256_set1_epi32(0xff << 8);
+   const __m256i mask_v        = _mm256_set1_epi32((int)(0xffu << 24));
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset  = _mm256_set1_epi16(YUV_OFFSET);
+   const __m256i yuv_mul       = _mm256_set1_epi16(YUV_MAT_Y);
+   const __m256i u_g_mul       = _mm256_set1_epi16(YUV_MAT_U_G);
+   const __m256i u_b_mul       = _mm256_set1_epi16(YUV_MAT_U_B);
+   const __m256i v_r_mul       = _mm256_set1_epi16(YUV_MAT_V_R);
+   const __m256i v_g_mul       = _mm256_set1_epi16(YUV_MAT_V_G);
+   const __m256i a             = _mm256_set1_epi16(-1);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
    {
       const uint8_t *src = input;
       uint32_t *dst = output;
 
-      for (w = 0; w < width; w += 2, src += 4, dst += 2)
+      /* Each loop processes 32 pixels, same steps as the SSE2 path.
+       * Packing and unpacking stay within 128-bit lanes, which
+       * leaves Y and chroma lined up until the final store. */
+      for (w = 0; w + 32 <= width; w += 32, src += 64, dst += 32)
       {
-         int _y0 = src[0];
-         int  u = src[1] - 128;
-         int _y1 = src[2];
-         int  v = src[3] - 128;
+         __m256i yuv0 = _mm256_loadu_si256((const __m256i*)(src +  0));
+         __m256i yuv1 = _mm256_loadu_si256((const __m256i*)(src + 32));
+
+         __m256i _y0 = _mm256_mullo_epi16(
+               _mm256_and_si256(yuv0, mask_y), yuv_mul);
+         __m256i _y1 = _mm256_mullo_epi16(
+               _mm256_and_si256(yuv1, mask_y), yuv_mul);
+
+         __m256i u = _mm256_sub_epi16(_mm256_packs_epi32(
+                  _mm256_srli_si256(_mm256_and_si256(yuv0, mask_u), 1),
+                  _mm256_srli_si256(_mm256_and_si256(yuv1, mask_u), 1)),
+               chroma_offset);
+         __m256i v = _mm256_sub_epi16(_mm256_packs_epi32(
+                  _mm256_srli_si256(_mm256_and_si256(yuv0, mask_v), 3),
+                  _mm256_srli_si256(_mm256_and_si256(yuv1, mask_v), 3)),
+               chroma_offset);
 
-         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+         /* Upscale chroma horizontally (nearest). */
+         __m256i u0 = _mm256_unpacklo_epi16(u, u);
+         __m256i u1 = _mm256_unpackhi_epi16(u, u);
+         __m256i v0 = _mm256_unpacklo_epi16(v, v);
+         __m256i v1 = _mm256_unpackhi_epi16(v, v);
 
-         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+         __m256i r0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _y0, _mm256_mullo_epi16(v0, v_r_mul)),
+                  round_offset), YUV_SHIFT);
+         __m256i g0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y0, _mm256_mullo_epi16(v0, v_g_mul)),
+                     _mm256_mullo_epi16(u0, u_g_mul)),
+                  round_offset), YUV_SHIFT);
+         __m256i b0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _y0, _mm256_mullo_epi16(u0, u_b_mul)),
+                  round_offset), YUV_SHIFT);
+         __m256i r1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _y1, _mm256_mullo_epi16(v1, v_r_mul)),
+                  round_offset), YUV_SHIFT);
+         __m256i g1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y1, _mm256_mullo_epi16(v1, v_g_mul)),
+                     _mm256_mullo_epi16(u1, u_g_mul)),
+                  round_offset), YUV_SHIFT);
+         __m256i b1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _y1, _mm256_mullo_epi16(u1, u_b_mul)),
+                  round_offset), YUV_SHIFT);
 
-         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
-         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+         /* Saturate into 8-bit. */
+         __m256i r = _mm256_packus_epi16(r0, r1);
+         __m256i g = _mm256_packus_epi16(g0, g1);
+         __m256i b = _mm256_packus_epi16(b0, b1);
+
+         /* Interleave into ARGB. Lane 0 now holds pixels 0-7 and
+          * 16-23, lane 1 pixels 8-15 and 24-31. */
+         __m256i bg_lo = _mm256_unpacklo_epi8(b, g);
+         __m256i bg_hi = _mm256_unpackhi_epi8(b, g);
+         __m256i ra_lo = _mm256_unpacklo_epi8(r, a);
+         __m256i ra_hi = _mm256_unpackhi_epi8(r, a);
+         __m256i res0  = _mm256_unpacklo_epi16(bg_lo, ra_lo);
+         __m256i res1  = _mm256_unpackhi_epi16(bg_lo, ra_lo);
+         __m256i res2  = _mm256_unpacklo_epi16(bg_hi, ra_hi);
+         __m256i res3  = _mm256_unpackhi_epi16(bg_hi, ra_hi);
+
+         _mm256_storeu_si256((__m256i*)(dst +  0),
+               _mm256_permute2x128_si256(res0, res1, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst +  8),
+               _mm256_permute2x128_si256(res0, res1, 0x31));
+         _mm256_storeu_si256((__m256i*)(dst + 16),
+               _mm256_permute2x128_si256(res2, res3, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst + 24),
+               _mm256_permute2x128_si256(res2, res3, 0x31));
       }
+
+      if (w < width)
+         conv_yuyv_argb8888_c(dst, src, width - w, 1, out_stride, in_stride);
    }
 }
 #endif
 
+typedef void (*conv_func_t)(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride);
+
+enum
+{
+   CONV_SIMD_SSE2 = 1 << 0,
+   CONV_SIMD_AVX2 = 1 << 1,
+   CONV_SIMD_NEON = 1 << 2
+};
+
+struct conv_kernels
+{
+   const char *ident;
+   unsigned simd;
+   conv_func_t rgb565_0rgb1555;
+   conv_func_t _0rgb1555_rgb565;
+   conv_func_t _0rgb1555_argb8888;
+   conv_func_t rgb565_argb8888;
+   conv_func_t _0rgb1555_bgr24;
+   conv_func_t rgb565_bgr24;
+   conv_func_t argb8888_bgr24;
+   conv_func_t yuyv_argb8888;
+};
+
+#define CONV_KERNELS(ident, simd, base, wide) \
+   { ident, simd, \
+      conv_rgb565_0rgb1555_##base,   conv_0rgb1555_rgb565_##base, \
+      conv_0rgb1555_argb8888_##wide, conv_rgb565_argb8888_##wide, \
+      conv_0rgb1555_bgr24_##wide,    conv_rgb565_bgr24_##wide, \
+      conv_argb8888_bgr24_##wide,    conv_yuyv_argb8888_##wide }
+
+/* Ordered by preference, last supported entry wins. The 16-bit
+ * to 16-bit conversions are too cheap to gain from AVX2 and keep
+ * the SSE2 kernels. */
+static const struct conv_kernels conv_kernels_list[] = {
+   CONV_KERNELS("c",    0,                               c,    c),
+#if defined(__SSE2__)
+   CONV_KERNELS("sse2", CONV_SIMD_SSE2,                  sse2, sse2),
+#endif
+#if defined(PIXCONV_AVX2)
+   CONV_KERNELS("avx2", CONV_SIMD_SSE2 | CONV_SIMD_AVX2, sse2, avx2),
+#endif
+#if defined(PIXCONV_NEON)
+   CONV_KERNELS("neon", CONV_SIMD_NEON,                  neon, neon),
+#endif
+};
+
+#define CONV_NUM_KERNELS \
+   (sizeof(conv_kernels_list) / sizeof(conv_kernels_list[0]))
+
+static const struct conv_kernels *conv_active_kernels;
+
+/**
+ * conv_cpu_simd:
+ *
+ * SSE2 and NEON are baseline for the builds that compile them in,
+ * AVX2 is asked of the CPU.
+ *
+ * Returns: the CONV_SIMD_* kernels this CPU can run.
+ **/
+static unsigned conv_cpu_simd(void)
+{
+   unsigned simd = 0;
+#if defined(__SSE2__)
+   simd |= CONV_SIMD_SSE2;
+#endif
+#if defined(PIXCONV_AVX2)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      simd |= CONV_SIMD_AVX2;
+#endif
+#if defined(PIXCONV_NEON)
+   simd |= CONV_SIMD_NEON;
+#endif
+   return simd;
+}
+
+/**
+ * conv_kernels:
+ *
+ * Picks the kernel set on first use. Concurrent first calls
+ * all pick the same set, so the race is harmless.
+ *
+ * Returns: the best kernel set for this CPU.
+ **/
+static const struct conv_kernels *conv_kernels(void)
+{
+   unsigned i, simd;
+   const struct conv_kernels *kernels = conv_active_kernels;
+
+   if (kernels)
+      return kernels;
+
+   simd    = conv_cpu_simd();
+   kernels = &conv_kernels_list[0];
+
+   for (i = 1; i < CONV_NUM_KERNELS; i++)
+   {
+      if ((simd & conv_kernels_list[i].simd) == conv_kernels_list[i].simd)
+         kernels = &conv_kernels_list[i];
+   }
+
+   conv_active_kernels = kernels;
+   return kernels;
+}
+
+const char *conv_simd_ident(void)
+{
+   return conv_kernels()->ident;
+}
+
+void conv_rgb565_0rgb1555(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->rgb565_0rgb1555(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_0rgb1555_rgb565(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->_0rgb1555_rgb565(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_0rgb1555_argb8888(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->_0rgb1555_argb8888(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_rgb565_argb8888(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->rgb565_argb8888(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_0rgb1555_bgr24(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->_0rgb1555_bgr24(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_rgb565_bgr24(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->rgb565_bgr24(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_argb8888_bgr24(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->argb8888_bgr24(output, input,
+         width, height, out_stride, in_stride);
+}
+
+void conv_yuyv_argb8888(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_kernels()->yuyv_argb8888(output, input,
+         width, height, out_stride, in_stride);
+}
+
 void conv_copy(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -29,6 +29,15 @@
 #include <stdio.h>
 #include <math.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreadpool.h>
+
+/* Frames smaller than this are not worth splitting up. */
+#define SCALER_THREAD_MIN_PIXELS (256 * 256)
+/* Rows each thread should get at the very least. */
+#define SCALER_THREAD_MIN_ROWS 16
+#endif
+
 /* In case aligned allocs are needed later. */
 
 /**
@@ -107,6 +116,8 @@ static bool allocate_frames(struct scaler_ctx *ctx)
  **/
 static bool set_direct_pix_conv(struct scaler_ctx *ctx)
 {
+   ctx->direct_pixconv = NULL;
+
    if (ctx->in_fmt == ctx->out_fmt)
    {
       ctx->direct_pixconv = conv_copy;
@@ -215,32 +226,28 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
    scaler_ctx_gen_reset(ctx);
 
-   if (ctx->in_width == ctx->out_width && ctx->in_height == ctx->out_height)
-      ctx->unscaled = true; /* Only pixel format conversion ... */
-   else
-   {
-      ctx->scaler_horiz = scaler_argb8888_horiz;
-      ctx->scaler_vert  = scaler_argb8888_vert;
-      ctx->unscaled     = false;
-   }
-
    ctx->scaler_special = NULL;
 
+   /* Only pixel format conversion, straight from input to 
+    * output. Pairs without a direct converter still go through 
+    * ARGB8888 and the filters below. */
+   ctx->unscaled = ctx->in_width == ctx->out_width
+      && ctx->in_height == ctx->out_height
+      && set_direct_pix_conv(ctx);
+
+   if (ctx->unscaled)
+      return true;
+
+   ctx->scaler_horiz = scaler_argb8888_horiz;
+   ctx->scaler_vert  = scaler_argb8888_vert;
+
    if (!allocate_frames(ctx))
       return false;
 
-   if (ctx->unscaled)
-   {
-      if (!set_direct_pix_conv(ctx))
-         return false;
-   }
-   else
-   {
-      if (!set_pix_conv(ctx))
-         return false;
-   }
+   if (!set_pix_conv(ctx))
+      return false;
 
-   if (!ctx->unscaled && !scaler_gen_filter(ctx))
+   if (!scaler_gen_filter(ctx))
       return false;
 
    return true;
@@ -263,6 +270,82 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
    memset(&ctx->output, 0, sizeof(ctx->output));
 }
 
+#ifdef HAVE_THREADS
+struct scaler_job
+{
+   struct scaler_ctx *ctx;
+   unsigned bands;
+
+   const void *input;
+   void *output;
+
+   /* ARGB8888 frames the scalers work on. */
+   const void *input_frame;
+   int input_stride;
+   void *output_frame;
+   int output_stride;
+};
+
+/* Converts and horizontally scales one band of input rows. */
+static void scaler_job_horiz(void *data, unsigned index)
+{
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   struct scaler_ctx *ctx       = job->ctx;
+   int first = (int)((int64_t)ctx->in_height * index / job->bands);
+   int last  = (int)((int64_t)ctx->in_height * (index + 1) / job->bands);
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+      ctx->in_pixconv(
+            (uint8_t*)ctx->input.frame + first * ctx->input.stride,
+            (const uint8_t*)job->input + first * ctx->in_stride,
+            ctx->in_width, last - first,
+            ctx->input.stride, ctx->in_stride);
+
+   ctx->scaler_horiz(ctx, job->input_frame, job->input_stride, first, last);
+}
+
+/* Vertically scales and converts one band of output rows. */
+static void scaler_job_vert(void *data, unsigned index)
+{
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   struct scaler_ctx *ctx       = job->ctx;
+   int first = (int)((int64_t)ctx->out_height * index / job->bands);
+   int last  = (int)((int64_t)ctx->out_height * (index + 1) / job->bands);
+
+   ctx->scaler_vert(ctx, job->output_frame, job->output_stride, first, last);
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv(
+            (uint8_t*)job->output + first * ctx->out_stride,
+            (const uint8_t*)ctx->output.frame + first * ctx->output.stride,
+            ctx->out_width, last - first,
+            ctx->out_stride, ctx->output.stride);
+}
+
+/**
+ * scaler_ctx_bands:
+ * @ctx          : pointer to scaler context object.
+ *
+ * Returns: number of bands to split the generic filter 
+ * path into, 1 if it should not be split.
+ **/
+static unsigned scaler_ctx_bands(const struct scaler_ctx *ctx)
+{
+   unsigned bands;
+   int rows = ctx->in_height < ctx->out_height ? 
+      ctx->in_height : ctx->out_height;
+
+   if (!ctx->pool || ctx->out_width * ctx->out_height < SCALER_THREAD_MIN_PIXELS)
+      return 1;
+
+   bands = sthread_pool_threads(ctx->pool);
+   if (bands > (unsigned)(rows / SCALER_THREAD_MIN_ROWS))
+      bands = rows / SCALER_THREAD_MIN_ROWS;
+
+   return bands ? bands : 1;
+}
+#endif
+
 /**
  * scaler_ctx_scale:
  * @ctx          : pointer to scaler context object.
@@ -278,6 +361,9 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    void *output_frame      = output;
    int input_stride        = ctx->in_stride;
    int output_stride       = ctx->out_stride;
+#ifdef HAVE_THREADS
+   unsigned bands          = 1;
+#endif
 
    if (ctx->unscaled)
    {
@@ -290,10 +376,6 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
 
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
-      ctx->in_pixconv(ctx->input.frame, input,
-            ctx->in_width, ctx->in_height,
-            ctx->input.stride, ctx->in_stride);
-
       input_frame       = ctx->input.frame;
       input_stride      = ctx->input.stride;
    }
@@ -304,6 +386,37 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
       output_stride = ctx->output.stride;
    }
 
+#ifdef HAVE_THREADS
+   if (!ctx->scaler_special)
+      bands = scaler_ctx_bands(ctx);
+
+   if (bands > 1)
+   {
+      /* Every band of output rows needs input rows from all 
+       * around it, so all horizontal scaling has to be done 
+       * before vertical scaling starts. */
+      struct scaler_job job;
+
+      job.ctx           = ctx;
+      job.bands         = bands;
+      job.input         = input;
+      job.output        = output;
+      job.input_frame   = input_frame;
+      job.input_stride  = input_stride;
+      job.output_frame  = output_frame;
+      job.output_stride = output_stride;
+
+      sthread_pool_parallel_for(ctx->pool, bands, scaler_job_horiz, &job);
+      sthread_pool_parallel_for(ctx->pool, bands, scaler_job_vert, &job);
+      return;
+   }
+#endif
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+      ctx->in_pixconv(ctx->input.frame, input,
+            ctx->in_width, ctx->in_height,
+            ctx->input.stride, ctx->in_stride);
+
    if (ctx->scaler_special)
    {
       /* Take some special, and (hopefully) more optimized path. */
@@ -315,8 +428,8 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    else
    {
       /* Take generic filter path. */
-      ctx->scaler_horiz(ctx, input_frame, input_stride);
-      ctx->scaler_vert (ctx, output, output_stride);
+      ctx->scaler_horiz(ctx, input_frame, input_stride, 0, ctx->scaled.height);
+      ctx->scaler_vert (ctx, output_frame, output_stride, 0, ctx->out_height);
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
@@ -171,6 +171,106 @@ static bool gen_filter_sinc(struct scaler_ctx *ctx)
    return true;
 }
 
+/* Lanczos3 taps per source pixel of support. */
+#define LANCZOS3_RADIUS 3
+
+static inline double filter_lanczos3(double x)
+{
+   if (fabs(x) >= LANCZOS3_RADIUS)
+      return 0.0;
+   return filter_sinc(M_PI * x) * filter_sinc(M_PI * x / LANCZOS3_RADIUS);
+}
+
+/* Taps needed by one axis. The kernel is stretched out 
+ * when downsampling, so that it keeps working as a low-pass. */
+static int lanczos3_taps(int in_len, int out_len)
+{
+   double scale = in_len > out_len ? (double)in_len / out_len : 1.0;
+   int taps     = 2 * (int)ceil(LANCZOS3_RADIUS * scale);
+
+   /* Taps can not reach further than the image does. */
+   if (taps > in_len)
+      taps = in_len;
+   return taps;
+}
+
+static void gen_filter_lanczos3_sub(struct scaler_filter *filter,
+      int out_len, int in_len)
+{
+   int i, j;
+   const int taps   = filter->filter_len;
+   double step      = (double)in_len / out_len;
+   /* Lanczos works on the source grid when upsampling, 
+    * on the destination grid when downsampling. */
+   double phase_mul = in_len > out_len ? (double)out_len / in_len : 1.0;
+
+   for (i = 0; i < out_len; i++)
+   {
+      double weights[512];
+      double sum     = 0.0;
+      int16_t *coeff = filter->filter + i * filter->filter_stride;
+      int unity_sum  = 0;
+      int peak       = 0;
+      double center  = (i + 0.5) * step - 0.5;
+      int pos        = (int)floor(center) - (taps / 2 - 1);
+
+      /* Edge pixels are repeated. Keep all taps inside the 
+       * image and fold whatever falls outside onto the edge. */
+      int start = pos;
+      if (start < 0)
+         start = 0;
+      if (start > in_len - taps)
+         start = in_len - taps;
+
+      memset(weights, 0, taps * sizeof(*weights));
+      for (j = 0; j < taps; j++)
+      {
+         int src       = pos + j;
+         double weight = filter_lanczos3((src - center) * phase_mul);
+
+         if (src < 0)
+            src = 0;
+         else if (src >= in_len)
+            src = in_len - 1;
+
+         weights[src - start] += weight;
+         sum += weight;
+      }
+
+      filter->filter_pos[i] = start;
+
+      /* Normalize, so that flat areas stay flat. Rounding is 
+       * put back into the largest tap. */
+      for (j = 0; j < taps; j++)
+      {
+         coeff[j]   = (int16_t)floor(FILTER_UNITY * weights[j] / sum + 0.5);
+         unity_sum += coeff[j];
+         if (coeff[j] > coeff[peak])
+            peak = j;
+      }
+      coeff[peak] += FILTER_UNITY - unity_sum;
+   }
+}
+
+static bool gen_filter_lanczos3(struct scaler_ctx *ctx)
+{
+   ctx->horiz.filter_len    = lanczos3_taps(ctx->in_width, ctx->out_width);
+   ctx->horiz.filter_stride = ctx->horiz.filter_len;
+   ctx->vert.filter_len     = lanczos3_taps(ctx->in_height, ctx->out_height);
+   ctx->vert.filter_stride  = ctx->vert.filter_len;
+
+   /* Keeps the weights on the stack. */
+   if (ctx->horiz.filter_len > 512 || ctx->vert.filter_len > 512)
+      return false;
+
+   if (!allocate_filters(ctx))
+      return false;
+
+   gen_filter_lanczos3_sub(&ctx->horiz, ctx->out_width, ctx->in_width);
+   gen_filter_lanczos3_sub(&ctx->vert, ctx->out_height, ctx->in_height);
+
+   return true;
+}
 
 static bool validate_filter(struct scaler_ctx *ctx)
 {
@@ -272,6 +372,10 @@ bool scaler_gen_filter(struct scaler_ctx *ctx)
          ret = gen_filter_sinc(ctx);
          break;
 
+      case SCALER_TYPE_LANCZOS3:
+         ret = gen_filter_lanczos3(ctx);
+         break;
+
       default:
          return false;
    }
@@ -24,6 +24,13 @@
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef __AVX2__
+#undef __ARM_NEON__
+#undef __ARM_NEON
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
 #endif
 
 #if defined(__SSE2__)
@@ -31,6 +38,9 @@
 #ifdef _WIN32
 #include <intrin.h>
 #endif
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCALER_NEON
 #endif
 
 // ARGB8888 scaler is split in two:
@@ -49,61 +59,145 @@
 // Scaling is now complete. Channels are shifted right by 3, and saturated into 8-bit values.
 //
 // The C version of scalers perform the exact same operations as the SIMD code for testing purposes.
+//
+// Both scalers work on a range of rows, [first, last), so that a frame can be split up between threads.
+// The vertical SIMD scalers work on several output pixels at once, as they all share the filter of the row.
 
 #if defined(__SSE2__)
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+// One output pixel of the vertical scaler.
+static inline uint32_t scaler_argb8888_vert_pixel_sse2(const int16_t *filter_vert,
+      int filter_len, const uint64_t *input_base_y, int stride)
+{
+   int y;
+   __m128i res = _mm_setzero_si128();
+
+   for (y = 0; y < filter_len; y++, input_base_y += stride)
+   {
+      __m128i coeff = _mm_set1_epi16(filter_vert[y]);
+      __m128i col   = _mm_loadl_epi64((const __m128i*)input_base_y);
+
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   res = _mm_srai_epi16(res, (7 - 2 - 2));
+   return _mm_cvtsi128_si32(_mm_packus_epi16(res, res));
+}
+
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride,
+      int first, int last)
 {
    int h, w, y;
    const uint64_t *input = ctx->scaled.frame;
-   uint32_t *output = (uint32_t*)output_;
+   uint32_t *output = (uint32_t*)output_ + first * (stride >> 2);
+   const int scaled_stride = ctx->scaled.stride >> 3;
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   const int16_t *filter_vert = ctx->vert.filter + first * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   for (h = first; h < last; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
+      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * scaled_stride;
 
-      for (w = 0; w < ctx->out_width; w++)
-      {
-         __m128i res = _mm_setzero_si128();
+      w = 0;
 
+#if defined(__AVX2__)
+      for (; w + 4 <= ctx->out_width; w += 4)
+      {
+         __m256i res = _mm256_setzero_si256();
          const uint64_t *input_base_y = input_base + w;
 
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += (ctx->scaled.stride >> 2))
+         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+            __m256i coeff = _mm256_set1_epi16(filter_vert[y]);
+            __m256i col   = _mm256_loadu_si256((const __m256i*)input_base_y);
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
          }
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
+         res = _mm256_srai_epi16(res, (7 - 2 - 2));
+         // Packing works per 128-bit lane, so gather the low halves.
+         res = _mm256_permute4x64_epi64(_mm256_packus_epi16(res, res), 0x08);
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
+      }
+#endif
+
+      for (; w + 2 <= ctx->out_width; w += 2)
+      {
+         __m128i res = _mm_setzero_si128();
+         const uint64_t *input_base_y = input_base + w;
+
+         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+            __m128i coeff = _mm_set1_epi16(filter_vert[y]);
+            __m128i col   = _mm_loadu_si128((const __m128i*)input_base_y);
 
             res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
          }
 
-         res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
          res = _mm_srai_epi16(res, (7 - 2 - 2));
+         _mm_storel_epi64((__m128i*)(output + w), _mm_packus_epi16(res, res));
+      }
+
+      for (; w < ctx->out_width; w++)
+         output[w] = scaler_argb8888_vert_pixel_sse2(filter_vert,
+               ctx->vert.filter_len, input_base + w, scaled_stride);
+   }
+}
+#elif defined(SCALER_NEON)
+static inline int16x8_t scaler_mulhi_neon(int16x8_t a, int16_t b)
+{
+   return vcombine_s16(
+         vshrn_n_s32(vmull_n_s16(vget_low_s16(a), b), 16),
+         vshrn_n_s32(vmull_n_s16(vget_high_s16(a), b), 16));
+}
+
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride,
+      int first, int last)
+{
+   int h, w, y;
+   const uint64_t *input = ctx->scaled.frame;
+   uint32_t *output = (uint32_t*)output_ + first * (stride >> 2);
+   const int scaled_stride = ctx->scaled.stride >> 3;
 
-         __m128i final = _mm_packus_epi16(res, res);
+   const int16_t *filter_vert = ctx->vert.filter + first * ctx->vert.filter_stride;
 
-         output[w] = _mm_cvtsi128_si32(final);
+   for (h = first; h < last; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   {
+      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * scaled_stride;
+
+      for (w = 0; w < ctx->out_width; w += 2)
+      {
+         int16x8_t res = vdupq_n_s16(0);
+         const uint64_t *input_base_y = input_base + w;
+         uint8x8_t final;
+
+         // The scaled frame is padded, so the second pixel can always be read.
+         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
+         {
+            int16x8_t col = vld1q_s16((const int16_t*)input_base_y);
+            res = vqaddq_s16(scaler_mulhi_neon(col, filter_vert[y]), res);
+         }
+
+         final = vqmovun_s16(vshrq_n_s16(res, (7 - 2 - 2)));
+
+         if (w + 1 < ctx->out_width)
+            vst1_u8((uint8_t*)(output + w), final);
+         else
+            output[w] = vget_lane_u32(vreinterpret_u32_u8(final), 0);
       }
    }
 }
 #else
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride,
+      int first, int last)
 {
    int h, w, y;
    const uint64_t *input = ctx->scaled.frame;
-   uint32_t *output = (uint32_t*)output_;
+   uint32_t *output = (uint32_t*)output_ + first * (stride >> 2);
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   const int16_t *filter_vert = ctx->vert.filter + first * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   for (h = first; h < last; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
    {
       const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
 
@@ -144,56 +238,138 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
 #endif
 
 #if defined(__SSE2__)
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+static inline void scaler_store_argb64_sse2(uint64_t *output, __m128i res)
 {
-   int h, w, x;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+#ifdef __x86_64__
+   *output = _mm_cvtsi128_si64(res);
+#else // 32-bit doesn't have si64. Do it in two steps.
+   union
+   {
+      uint32_t *u32;
+      uint64_t *u64;
+   } u;
+   u.u64 = output;
+   u.u32[0] = _mm_cvtsi128_si32(res);
+   u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+#endif
+}
+
+// One output pixel of the horizontal scaler.
+static inline __m128i scaler_argb8888_horiz_pixel_sse2(const int16_t *filter_horiz,
+      int filter_len, const uint32_t *input_base_x)
+{
+   int x;
+   __m128i res = _mm_setzero_si128();
+
+   for (x = 0; (x + 1) < filter_len; x += 2)
+   {
+      __m128i coeff = _mm_set_epi64x((uint16_t)filter_horiz[x + 1] * 0x0001000100010001ull, (uint16_t)filter_horiz[x + 0] * 0x0001000100010001ull);
+
+      __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
+               ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; x < filter_len; x++)
+   {
+      __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_horiz[x] * 0x0001000100010001ull);
+      __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   return _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+}
+
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride,
+      int first, int last)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)((const uint8_t*)input_ + first * stride);
+   uint64_t *output      = ctx->scaled.frame + first * (ctx->scaled.stride >> 3);
+
+   for (h = first; h < last; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
 
-      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
-      {
-         __m128i res = _mm_setzero_si128();
+      w = 0;
 
+#if defined(__AVX2__)
+      // Two output pixels at once, one per 128-bit lane.
+      for (; w + 2 <= ctx->scaled.width; w += 2, filter_horiz += 2 * ctx->horiz.filter_stride)
+      {
+         int x;
+         __m256i res = _mm256_setzero_si256();
+         const int16_t *filter_next = filter_horiz + ctx->horiz.filter_stride;
          const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         const uint32_t *input_next_x = input + ctx->horiz.filter_pos[w + 1];
 
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
+            __m256i coeff = _mm256_set_epi64x(
+                  (uint16_t)filter_next[x + 1] * 0x0001000100010001ull, (uint16_t)filter_next[x + 0] * 0x0001000100010001ull,
+                  (uint16_t)filter_horiz[x + 1] * 0x0001000100010001ull, (uint16_t)filter_horiz[x + 0] * 0x0001000100010001ull);
 
-            __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+            __m256i col = _mm256_cvtepu8_epi16(_mm_set_epi64x(
+                     ((uint64_t)input_next_x[x + 1] << 32) | input_next_x[x + 0],
+                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]));
 
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            col = _mm256_slli_epi16(col, 7);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
          }
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
+            __m256i coeff = _mm256_set_epi64x(0, (uint16_t)filter_next[x] * 0x0001000100010001ull,
+                  0, (uint16_t)filter_horiz[x] * 0x0001000100010001ull);
+            __m256i col   = _mm256_cvtepu8_epi16(_mm_set_epi32(0, input_next_x[x], 0, input_base_x[x]));
 
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            col = _mm256_slli_epi16(col, 7);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
          }
 
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+         res = _mm256_adds_epi16(_mm256_srli_si256(res, 8), res);
 
-#ifdef __x86_64__
-         output[w] = _mm_cvtsi128_si64(res);
-#else // 32-bit doesn't have si64. Do it in two steps.
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
-         u.u64 = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+         scaler_store_argb64_sse2(output + w, _mm256_castsi256_si128(res));
+         scaler_store_argb64_sse2(output + w + 1, _mm256_extracti128_si256(res, 1));
+      }
 #endif
+
+      for (; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+         scaler_store_argb64_sse2(output + w, scaler_argb8888_horiz_pixel_sse2(filter_horiz,
+                  ctx->horiz.filter_len, input + ctx->horiz.filter_pos[w]));
+   }
+}
+#elif defined(SCALER_NEON)
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride,
+      int first, int last)
+{
+   int h, w, x;
+   const uint32_t *input = (const uint32_t*)((const uint8_t*)input_ + first * stride);
+   uint64_t *output      = ctx->scaled.frame + first * (ctx->scaled.stride >> 3);
+
+   for (h = first; h < last; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+      {
+         int16x4_t res = vdup_n_s16(0);
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+
+         for (x = 0; x < ctx->horiz.filter_len; x++)
+         {
+            int16x4_t col = vreinterpret_s16_u16(vget_low_u16(
+                     vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(input_base_x[x])))));
+
+            col = vshl_n_s16(col, 7);
+            res = vqadd_s16(vshrn_n_s32(vmull_n_s16(col, filter_horiz[x]), 16), res);
+         }
+
+         output[w] = vget_lane_u64(vreinterpret_u64_s16(res), 0);
       }
    }
 }
@@ -203,13 +379,14 @@ static inline uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t
    return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride,
+      int first, int last)
 {
    int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   const uint32_t *input = (const uint32_t*)((const uint8_t*)input_ + first * stride);
+   uint64_t *output      = ctx->scaled.frame + first * (ctx->scaled.stride >> 3);
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   for (h = first; h < last; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
 
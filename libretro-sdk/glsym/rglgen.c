@@ -40,3 +40,83 @@ void rglgen_resolve_symbols(rglgen_proc_address_t proc)
    rglgen_resolve_symbols_custom(proc, rglgen_symbol_map);
 }
 
+/* Suffixes of entry points which only come with extensions. */
+static const char *rglgen_vendors[] = {
+   "ARB", "EXT", "KHR", "OES", "NV", "AMD", "APPLE", "ATI",
+   "INTEL", "MESA", "HP", "ARM", "IMG", "QCOM", NULL
+};
+
+static rglgen_proc_address_t rglgen_lazy_proc;
+/* Bit N set once the entry points of rglgen_vendors[N] are resolved. */
+static unsigned rglgen_lazy_resolved;
+
+static int rglgen_symbol_vendor(const char *sym)
+{
+   int i;
+   size_t len = strlen(sym);
+
+   for (i = 0; rglgen_vendors[i]; i++)
+   {
+      size_t vendor_len = strlen(rglgen_vendors[i]);
+
+      if (len > vendor_len &&
+            !strcmp(sym + len - vendor_len, rglgen_vendors[i]))
+         return i;
+   }
+
+   return -1;
+}
+
+void rglgen_resolve_core_symbols(rglgen_proc_address_t proc)
+{
+   const struct rglgen_sym_map *map;
+
+   rglgen_lazy_proc     = proc;
+   rglgen_lazy_resolved = 0;
+
+   for (map = rglgen_symbol_map; map->sym; map++)
+   {
+      rglgen_func_t func = NULL;
+
+      /* Cleared too, so none of a previous context is kept. */
+      if (rglgen_symbol_vendor(map->sym) < 0)
+         func = proc(map->sym);
+      memcpy(map->ptr, &func, sizeof(func));
+   }
+}
+
+void rglgen_resolve_extension(const char *ext)
+{
+   int i;
+   const struct rglgen_sym_map *map;
+
+   if (!rglgen_lazy_proc)
+      return;
+
+   if (!strncmp(ext, "GL_", 3))
+      ext += 3;
+
+   for (i = 0; rglgen_vendors[i]; i++)
+   {
+      size_t vendor_len = strlen(rglgen_vendors[i]);
+
+      if (!strncmp(ext, rglgen_vendors[i], vendor_len) &&
+            ext[vendor_len] == '_')
+         break;
+   }
+
+   if (!rglgen_vendors[i] || (rglgen_lazy_resolved & (1u << i)))
+      return;
+
+   rglgen_lazy_resolved |= 1u << i;
+
+   for (map = rglgen_symbol_map; map->sym; map++)
+   {
+      if (rglgen_symbol_vendor(map->sym) == i)
+      {
+         rglgen_func_t func = rglgen_lazy_proc(map->sym);
+         memcpy(map->ptr, &func, sizeof(func));
+      }
+   }
+}
+
@@ -38,9 +38,14 @@ struct config_entry_list
    /* If we got this from an #include,
     * do not allow overwrite. */
    bool readonly;
+   /* Value outgrew its place in the arena and was moved
+    * to the heap, see config_set_string(). */
+   bool value_heap;
    char *key;
    char *value;
    struct config_entry_list *next;
+   /* Next entry in the same hash bucket. */
+   struct config_entry_list *hash_next;
 };
 
 struct config_include_list
@@ -56,7 +61,19 @@ struct config_file
    struct config_entry_list *tail;
    unsigned include_depth;
 
+   /* First entry of each key, by hash of the key. */
+   struct config_entry_list **buckets;
+   size_t bucket_mask;
+   size_t keys;
+
    struct config_include_list *includes;
+
+   /* Memory of the entries, see config_file.c. */
+   struct config_arena *arena;
+
+   /* Config that keys missing here are looked up in,
+    * see config_file_new_layer(). */
+   const struct config_file *base;
 };
 
 typedef struct config_file config_file_t;
@@ -78,6 +95,13 @@ config_file_t *config_file_new(const char *path);
 /* Load a config file from a string. */
 config_file_t *config_file_new_from_string(const char *from_string);
 
+/* Creates an empty config layered over base. Getters fall back to
+ * base for keys the layer does not have, setters and appended
+ * files only change the layer. Entry lists and writing only cover
+ * the layer's own entries. base is not copied and has to outlive
+ * the layer, freeing the layer leaves it alone. */
+config_file_t *config_file_new_layer(const config_file_t *base);
+
 /* Frees config file. */
 void config_file_free(config_file_t *conf);
 
@@ -152,9 +176,18 @@ void config_set_string(config_file_t *conf, const char *entry, const char *val);
 void config_set_path(config_file_t *conf, const char *entry, const char *val);
 void config_set_bool(config_file_t *conf, const char *entry, bool val);
 
-/* Write the current config to a file. */
+/* Write the current config to a file. The file is replaced in one
+ * go, readers never see it half written. A NULL path goes to stdout. */
 bool config_file_write(config_file_t *conf, const char *path);
 
+/* Current config as the text config_file_write() writes.
+ * Length is written to len if non-NULL. Free with free(). */
+char *config_file_serialize(config_file_t *conf, size_t *len);
+
+/* Replace the file at path with data, by writing path.tmp
+ * and renaming it over path. */
+bool config_file_write_data(const char *path, const void *data, size_t len);
+
 /* Dump the current config to an already opened file.
  * Does not close the file. */
 void config_file_dump(config_file_t *conf, FILE *file);
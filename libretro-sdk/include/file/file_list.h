@@ -40,12 +40,18 @@ struct item_file
    void *actiondata;
 };
 
+struct file_list_arena;
+
 typedef struct file_list
 {
    struct item_file *list;
 
    size_t capacity;
    size_t size;
+
+   /* Blocks the path, label and alt strings are carved from.
+    * Reset as a whole when the list is cleared. */
+   struct file_list_arena *arena;
 } file_list_t;
 
 
@@ -77,6 +77,17 @@ void conv_yuyv_argb8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
 
+/**
+ * conv_simd_ident:
+ *
+ * The conversions pick the fastest kernels the CPU supports
+ * the first time any of them is called.
+ *
+ * Returns: name of the kernel set in use ("c", "sse2", "avx2"
+ * or "neon").
+ **/
+const char *conv_simd_ident(void);
+
 void conv_copy(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
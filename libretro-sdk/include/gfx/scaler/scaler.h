@@ -50,9 +50,12 @@ enum scaler_type
    SCALER_TYPE_UNKNOWN = 0,
    SCALER_TYPE_POINT,
    SCALER_TYPE_BILINEAR,
-   SCALER_TYPE_SINC
+   SCALER_TYPE_SINC,
+   SCALER_TYPE_LANCZOS3
 };
 
+struct sthread_pool;
+
 struct scaler_filter
 {
    int16_t *filter;
@@ -75,10 +78,11 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   /* Scale rows [first, last) of the frame. */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         const void*, int, int, int);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         void*, int, int, int);
    void (*scaler_special)(const struct scaler_ctx*,
          void*, const void*, int, int, int, int, int, int);
 
@@ -108,6 +112,10 @@ struct scaler_ctx
       uint32_t *frame;
       int stride;
    } output;
+
+   /* Optional. If set, scaler_ctx_scale() splits large frames 
+    * into bands of rows which run on this pool (HAVE_THREADS). */
+   struct sthread_pool *pool;
 };
 
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
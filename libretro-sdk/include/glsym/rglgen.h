@@ -41,6 +41,16 @@ void rglgen_resolve_symbols(rglgen_proc_address_t proc);
 void rglgen_resolve_symbols_custom(rglgen_proc_address_t proc,
       const struct rglgen_sym_map *map);
 
+/* Like rglgen_resolve_symbols(), but leaves the entry points of
+ * extensions, e.g. glFooARB, NULL until rglgen_resolve_extension()
+ * is called with an extension of the same vendor. Call it again
+ * for every new context. */
+void rglgen_resolve_core_symbols(rglgen_proc_address_t proc);
+
+/* Resolves the entry points of the vendor of @ext, e.g. all
+ * glFooARB for "ARB_sync" or "GL_ARB_sync", once per context. */
+void rglgen_resolve_extension(const char *ext);
+
 #ifdef __cplusplus
 }
 #endif
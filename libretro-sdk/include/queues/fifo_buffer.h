@@ -52,6 +52,46 @@ size_t fifo_read_avail(fifo_buffer_t *buffer);
 
 size_t fifo_write_avail(fifo_buffer_t *buffer);
 
+#ifndef FIFO_CACHE_LINE_SIZE
+#define FIFO_CACHE_LINE_SIZE 64
+#endif
+
+/* Lock-free variant for exactly one producer and one consumer
+ * thread. Only the producer may call fifo_spsc_write() and
+ * fifo_spsc_write_avail(), only the consumer fifo_spsc_read()
+ * and fifo_spsc_read_avail(). first and end live on cache lines
+ * of their own, so that the two threads do not fight over them. */
+struct fifo_spsc_buffer
+{
+   uint8_t *buffer;
+   size_t bufsize;
+
+   char pad0[FIFO_CACHE_LINE_SIZE];
+   /* Only written by the consumer. */
+   size_t first;
+
+   char pad1[FIFO_CACHE_LINE_SIZE - sizeof(size_t)];
+   /* Only written by the producer. */
+   size_t end;
+
+   char pad2[FIFO_CACHE_LINE_SIZE - sizeof(size_t)];
+};
+
+typedef struct fifo_spsc_buffer fifo_spsc_buffer_t;
+
+fifo_spsc_buffer_t *fifo_spsc_new(size_t size);
+
+void fifo_spsc_write(fifo_spsc_buffer_t *buffer,
+      const void *in_buf, size_t size);
+
+void fifo_spsc_read(fifo_spsc_buffer_t *buffer, void *in_buf, size_t size);
+
+void fifo_spsc_free(fifo_spsc_buffer_t *buffer);
+
+size_t fifo_spsc_read_avail(fifo_spsc_buffer_t *buffer);
+
+size_t fifo_spsc_write_avail(fifo_spsc_buffer_t *buffer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,9 @@
 extern "C" {
 #endif
 
+/* Longer messages are cut short. */
+#define MSG_QUEUE_MSG_MAX 256
+
 typedef struct msg_queue msg_queue_t;
 
 /**
@@ -51,7 +54,9 @@ msg_queue_t *msg_queue_new(size_t size);
  *                      before it vanishes (E.g. show a message for
  *                      3 seconds @ 60fps = 180 duration).
  *
- * Push a new message onto the queue.
+ * Push a new message onto the queue. Safe to call from any
+ * thread, does not allocate or lock. Messages are dropped
+ * while the queue is full.
  **/
 void msg_queue_push(msg_queue_t *queue, const char *msg,
       unsigned prio, unsigned duration);
@@ -60,10 +65,11 @@ void msg_queue_push(msg_queue_t *queue, const char *msg,
  * msg_queue_pull:
  * @queue             : pointer to queue object
  *
- * Pulls highest priority message in queue.
+ * Pulls highest priority message in queue. Only one thread
+ * may pull, clear or free the queue.
  *
  * Returns: NULL if no message in queue, otherwise a string
- * containing the message.
+ * containing the message, valid until the next pull or clear.
  **/
 const char *msg_queue_pull(msg_queue_t *queue);
 
@@ -0,0 +1,144 @@
+/* Copyright  (C) 2010-2015 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthreadpool.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_RTHREADPOOL_H__
+#define __LIBRETRO_SDK_RTHREADPOOL_H__
+
+#include <boolean.h>
+
+#if defined(__cplusplus) && !defined(_MSC_VER)
+extern "C" {
+#endif
+
+typedef struct sthread_pool sthread_pool_t;
+typedef struct sthread_group sthread_group_t;
+
+typedef void (*sthread_task_t)(void *userdata);
+typedef void (*sthread_for_t)(void *userdata, unsigned index);
+
+/**
+ * sthread_pool_new:
+ * @threads                 : number of worker threads.
+ *
+ * Create a new thread pool. Every worker has a task queue of
+ * its own and steals from the others when it runs dry. 
+ * Threads waiting on a group help running tasks, so a pool 
+ * is usually created with one worker less than there are cores.
+ * A pool with no workers runs all tasks on the waiting thread.
+ *
+ * Returns: pointer to new thread pool if successful, otherwise NULL.
+ */
+sthread_pool_t *sthread_pool_new(unsigned threads);
+
+/**
+ * sthread_pool_new_init:
+ * @threads                 : number of worker threads.
+ * @thread_init             : run by every worker as it starts, with
+ *                            the index of the worker, or NULL.
+ * @userdata                : passed to @thread_init.
+ *
+ * Same as sthread_pool_new(), for workers which need setting
+ * up, e.g. with sthread_set_current_priority().
+ *
+ * Returns: pointer to new thread pool if successful, otherwise NULL.
+ */
+sthread_pool_t *sthread_pool_new_init(unsigned threads,
+      sthread_for_t thread_init, void *userdata);
+
+/**
+ * sthread_pool_free:
+ * @pool                    : pointer to thread pool object 
+ *
+ * Stops the workers and frees the pool. No group may 
+ * have tasks left when this is called.
+ */
+void sthread_pool_free(sthread_pool_t *pool);
+
+/**
+ * sthread_pool_threads:
+ * @pool                    : pointer to thread pool object 
+ *
+ * Returns: number of threads that can run tasks at once, 
+ * including the one waiting for them.
+ */
+unsigned sthread_pool_threads(sthread_pool_t *pool);
+
+/**
+ * sthread_pool_parallel_for:
+ * @pool                    : pointer to thread pool object 
+ * @count                   : number of iterations.
+ * @func                    : called once for every index in [0, @count).
+ * @userdata                : passed to @func.
+ *
+ * Runs all iterations on the pool and waits for them to finish. 
+ * The calling thread runs iterations as well.
+ */
+void sthread_pool_parallel_for(sthread_pool_t *pool, unsigned count,
+      sthread_for_t func, void *userdata);
+
+/**
+ * sthread_group_new:
+ * @pool                    : pointer to thread pool object 
+ *
+ * Create a task group, which tracks a set of tasks 
+ * so that they can be waited for together.
+ *
+ * Returns: pointer to new task group if successful, otherwise NULL.
+ */
+sthread_group_t *sthread_group_new(sthread_pool_t *pool);
+
+/**
+ * sthread_group_run:
+ * @group                   : pointer to task group object 
+ * @func                    : task to run.
+ * @userdata                : passed to @func.
+ *
+ * Queues a task on the pool of @group. Tasks may queue 
+ * further tasks, also in the same group.
+ *
+ * Returns: true (1) if the task was queued, otherwise false (0).
+ */
+bool sthread_group_run(sthread_group_t *group,
+      sthread_task_t func, void *userdata);
+
+/**
+ * sthread_group_wait:
+ * @group                   : pointer to task group object 
+ *
+ * Waits until all tasks of @group are done, running 
+ * queued tasks on the calling thread in the meantime.
+ */
+void sthread_group_wait(sthread_group_t *group);
+
+/**
+ * sthread_group_free:
+ * @group                   : pointer to task group object 
+ *
+ * Waits for the tasks of @group, then frees it.
+ */
+void sthread_group_free(sthread_group_t *group);
+
+#if defined(__cplusplus) && !defined(_MSC_VER)
+}
+#endif
+
+#endif
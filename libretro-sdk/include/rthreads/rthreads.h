@@ -33,6 +33,15 @@ extern "C" {
 typedef struct sthread sthread_t;
 typedef struct slock slock_t;
 typedef struct scond scond_t;
+typedef struct sevent sevent_t;
+
+enum sthread_priority
+{
+   STHREAD_PRIORITY_LOW = 0,
+   STHREAD_PRIORITY_NORMAL,
+   STHREAD_PRIORITY_HIGH,
+   STHREAD_PRIORITY_REALTIME
+};
 
 /**
  * sthread_create:
@@ -72,6 +81,41 @@ int sthread_detach(sthread_t *thread);
  */
 void sthread_join(sthread_t *thread);
 
+/**
+ * sthread_get_current_thread_id:
+ *
+ * Returns: ID of the calling thread, which no other running
+ * thread shares.
+ */
+uintptr_t sthread_get_current_thread_id(void);
+
+/**
+ * sthread_set_current_priority:
+ * @priority                : priority to run at.
+ * @mmcss_task              : MMCSS task of the thread on Windows,
+ *                            e.g. "Pro Audio", or NULL.
+ *
+ * Sets the priority of the calling thread. Realtime is SCHED_FIFO
+ * with pthreads. On Windows, it registers the thread with MMCSS
+ * as @mmcss_task, falling back to time critical priority.
+ *
+ * Returns: true (1) on success, false (0) if the system did not
+ * allow it, or does not support it.
+ */
+bool sthread_set_current_priority(enum sthread_priority priority,
+      const char *mmcss_task);
+
+/**
+ * sthread_set_current_affinity:
+ * @cpu_mask                : bit N set to run on CPU N.
+ *
+ * Restricts the calling thread to the CPUs in @cpu_mask.
+ *
+ * Returns: true (1) on success, false (0) if the system did not
+ * allow it, or does not support it.
+ */
+bool sthread_set_current_affinity(uint64_t cpu_mask);
+
 /**
  * slock_new:
  *
@@ -168,6 +212,59 @@ int scond_broadcast(scond_t *cond);
  **/
 void scond_signal(scond_t *cond);
 
+/**
+ * sevent_new:
+ * @spin_us                 : time to spin before going to sleep 
+ *                            (in microseconds), 0 to never spin.
+ *
+ * Creates an auto-reset event. Meant for one thread waking up 
+ * another quickly; on Linux it is a futex, so waking up does not 
+ * involve a mutex, and timeouts use the monotonic clock. 
+ * Spinning helps with short waits, but only makes sense 
+ * if the other thread runs on another core.
+ *
+ * Returns: pointer to new event on success, otherwise NULL.
+ **/
+sevent_t *sevent_new(unsigned spin_us);
+
+/**
+ * sevent_free:
+ * @event                   : pointer to event object 
+ *
+ * Frees an event.
+ **/
+void sevent_free(sevent_t *event);
+
+/**
+ * sevent_signal:
+ * @event                   : pointer to event object 
+ *
+ * Sets the event, waking up a thread waiting on it. If nobody 
+ * waits, the next wait returns immediately.
+ **/
+void sevent_signal(sevent_t *event);
+
+/**
+ * sevent_wait:
+ * @event                   : pointer to event object 
+ *
+ * Waits until the event is set, and resets it.
+ **/
+void sevent_wait(sevent_t *event);
+
+/**
+ * sevent_wait_timeout:
+ * @event                   : pointer to event object 
+ * @timeout_us              : timeout (in microseconds)
+ *
+ * Waits until the event is set, and resets it, 
+ * or until @timeout_us elapses.
+ *
+ * Returns: false (0) if timeout elapses before the event is
+ * set, otherwise true (1).
+ **/
+bool sevent_wait_timeout(sevent_t *event, int64_t timeout_us);
+
 #ifndef RARCH_INTERNAL
 #if defined(__CELLOS_LV2__) && !defined(__PSL1GHT__)
 #include <sys/timer.h>
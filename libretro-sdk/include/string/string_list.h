@@ -44,11 +44,16 @@ struct string_list_elem
    union string_list_elem_attr attr;
 };
 
+struct string_list_arena;
+
 struct string_list
 {
    struct string_list_elem *elems;
    size_t size;
    size_t cap;
+   /* Blocks element strings are carved from,
+    * NULL if each one is allocated on its own. */
+   struct string_list_arena *arena;
 };
 
 /**
@@ -96,6 +101,19 @@ struct string_list *string_split(const char *str, const char *delim);
  */
 struct string_list *string_list_new(void);
 
+/**
+ * string_list_new_arena:
+ *
+ * Creates a new string list which keeps its element strings
+ * packed in a few large blocks rather than allocating each one,
+ * for lists of many short strings. Strings replaced with
+ * string_list_set() are only released together with the list.
+ * Has to be freed manually with string_list_free().
+ *
+ * Returns: new string list if successful, otherwise NULL.
+ */
+struct string_list *string_list_new_arena(void);
+
 /**
  * string_list_append:
  * @list             : pointer to string list
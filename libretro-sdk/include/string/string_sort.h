@@ -0,0 +1,160 @@
+/* Copyright  (C) 2010-2015 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (string_sort.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_STRING_SORT_H
+#define __LIBRETRO_SDK_STRING_SORT_H
+
+/* Case insensitive sorting of large string lists, with each
+ * string folded once up front instead of in every compare.
+ *
+ * Keys are sorted by rank, then by the folded string in
+ * strcasecmp() order. The first 8 folded bytes are packed big
+ * endian into prefix, which is radix sorted; only strings
+ * sharing all of those go to a comparison sort on the rest.
+ * Equal keys keep their order. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <retro_inline.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct string_sort_key
+{
+   uint64_t prefix;
+   /* Folded string past the prefix, NULL if the string is shorter,
+    * in which case an equal prefix means an equal string. */
+   const char *rest;
+   size_t index;
+   uint8_t rank;
+};
+
+/**
+ * string_sort_key_init:
+ * @key              : key to fill in.
+ * @out              : where the folded string goes, strlen(@in) + 1 bytes.
+ * @in               : string to sort by.
+ * @rank             : sorts before the string, lowest first.
+ * @index            : position of the string in the caller's list.
+ *
+ * Returns: bytes written to @out.
+ **/
+static INLINE size_t string_sort_key_init(struct string_sort_key *key,
+      char *out, const char *in, uint8_t rank, size_t index)
+{
+   unsigned i;
+   size_t len = 0;
+
+   do
+      out[len] = tolower((unsigned char)in[len]);
+   while (in[len++]);
+
+   key->prefix = 0;
+   key->rest   = len > 8 ? out + 8 : NULL;
+   key->index  = index;
+   key->rank   = rank;
+
+   /* Bytes past the terminator pack as zero. */
+   for (i = 0; i < 8; i++)
+      key->prefix = (key->prefix << 8) | (i < len ? (uint8_t)out[i] : 0);
+
+   return len;
+}
+
+static INLINE int string_sort_rest_cmp(const void *a_, const void *b_)
+{
+   const struct string_sort_key *a = (const struct string_sort_key*)a_;
+   const struct string_sort_key *b = (const struct string_sort_key*)b_;
+   int ret = strcmp(a->rest, b->rest);
+
+   if (ret)
+      return ret;
+   return a->index < b->index ? -1 : a->index > b->index;
+}
+
+/**
+ * string_sort_keys:
+ * @keys             : keys to sort.
+ * @tmp              : scratch space for @count keys.
+ * @count            : number of keys.
+ *
+ * Sorts @keys by rank, then case insensitively.
+ **/
+static INLINE void string_sort_keys(struct string_sort_key *keys,
+      struct string_sort_key *tmp, size_t count)
+{
+   size_t i, j;
+   unsigned pass;
+   struct string_sort_key *src = keys, *dst = tmp;
+
+   /* LSD radix sort, one byte of prefix per pass and the rank last. */
+   for (pass = 0; pass < 9; pass++)
+   {
+      size_t counts[256] = {0};
+      size_t pos = 0;
+
+      for (i = 0; i < count; i++)
+         counts[pass < 8 ? (uint8_t)(src[i].prefix >> (pass * 8))
+            : src[i].rank]++;
+
+      /* Everything has the same byte here. */
+      for (i = 0; i < 256 && counts[i] != count; i++)
+      {
+         size_t n  = counts[i];
+         counts[i] = pos;
+         pos      += n;
+      }
+      if (i < 256)
+         continue;
+
+      for (i = 0; i < count; i++)
+         dst[counts[pass < 8 ? (uint8_t)(src[i].prefix >> (pass * 8))
+            : src[i].rank]++] = src[i];
+
+      src = dst;
+      dst = (dst == tmp) ? keys : tmp;
+   }
+
+   if (src != keys)
+      memcpy(keys, src, count * sizeof(*keys));
+
+   for (i = 0; i < count; i = j)
+   {
+      for (j = i + 1; j < count && keys[j].rank == keys[i].rank
+            && keys[j].prefix == keys[i].prefix; j++);
+
+      if (j - i > 1 && keys[i].rest)
+         qsort(keys + i, j - i, sizeof(*keys), string_sort_rest_cmp);
+   }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
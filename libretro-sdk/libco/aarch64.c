@@ -0,0 +1,131 @@
+/*
+  libco.aarch64
+  license: public domain
+*/
+
+#define LIBCO_C
+#include <libco.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef IOS
+#include <malloc.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Context layout, in 64-bit words:
+ *  0-11  x19-x30 (x29 frame pointer, x30 link register)
+ *  12    sp
+ *  13-20 d8-d15
+ *  21    entrypoint of a new cothread
+ * Only what AAPCS64 has the callee keep is saved, and no
+ * signal mask, unlike ucontext. */
+#define CO_ENTRYPOINT 21
+
+static thread_local uint64_t co_active_buffer[64];
+static thread_local cothread_t co_active_handle;
+
+asm (
+      ".text\n"
+      ".align 4\n"
+      ".globl co_switch_aarch64\n"
+      ".globl _co_switch_aarch64\n"
+      "co_switch_aarch64:\n"
+      "_co_switch_aarch64:\n"
+      "  stp x19, x20, [x1, #0]\n"
+      "  stp x21, x22, [x1, #16]\n"
+      "  stp x23, x24, [x1, #32]\n"
+      "  stp x25, x26, [x1, #48]\n"
+      "  stp x27, x28, [x1, #64]\n"
+      "  stp x29, x30, [x1, #80]\n"
+      "  mov x16, sp\n"
+      "  str x16, [x1, #96]\n"
+      "  stp d8, d9, [x1, #104]\n"
+      "  stp d10, d11, [x1, #120]\n"
+      "  stp d12, d13, [x1, #136]\n"
+      "  stp d14, d15, [x1, #152]\n"
+      "  ldp x19, x20, [x0, #0]\n"
+      "  ldp x21, x22, [x0, #16]\n"
+      "  ldp x23, x24, [x0, #32]\n"
+      "  ldp x25, x26, [x0, #48]\n"
+      "  ldp x27, x28, [x0, #64]\n"
+      "  ldp x29, x30, [x0, #80]\n"
+      "  ldr x16, [x0, #96]\n"
+      "  mov sp, x16\n"
+      "  ldp d8, d9, [x0, #104]\n"
+      "  ldp d10, d11, [x0, #120]\n"
+      "  ldp d12, d13, [x0, #136]\n"
+      "  ldp d14, d15, [x0, #152]\n"
+      "  ret\n"
+    );
+
+/* ASM */
+void co_switch_aarch64(cothread_t handle, cothread_t current);
+
+static void crash(void)
+{
+   /* Called only if cothread_t entrypoint returns. */
+   assert(0);
+   abort();
+}
+
+/* A new cothread starts here, with itself active. */
+static void co_entrypoint(void)
+{
+   uint64_t *ptr = (uint64_t*)co_active_handle;
+   ((void (*)(void))(uintptr_t)ptr[CO_ENTRYPOINT])();
+   crash();
+}
+
+cothread_t co_create(unsigned int size, void (*entrypoint)(void))
+{
+   uint64_t *ptr;
+   cothread_t handle = 0;
+
+   size = (size + 1023) & ~1023;
+#if HAVE_POSIX_MEMALIGN >= 1
+   if (posix_memalign(&handle, 1024, size + 512) < 0)
+      return 0;
+#else
+   handle = memalign(1024, size + 512);
+#endif
+
+   if (!handle)
+      return handle;
+
+   ptr = (uint64_t*)handle;
+   memset(ptr, 0, 512);
+
+   /* The stack takes the rest and has to stay 16 byte aligned. */
+   ptr[11]            = (uintptr_t)co_entrypoint; /* x30, link register */
+   ptr[12]            = ((uintptr_t)ptr + size + 512) & ~(uintptr_t)15; /* sp */
+   ptr[CO_ENTRYPOINT] = (uintptr_t)entrypoint;
+   return handle;
+}
+
+cothread_t co_active(void)
+{
+   if (!co_active_handle)
+      co_active_handle = co_active_buffer;
+   return co_active_handle;
+}
+
+void co_delete(cothread_t handle)
+{
+   free(handle);
+}
+
+void co_switch(cothread_t handle)
+{
+   cothread_t co_previous_handle = co_active();
+   co_switch_aarch64(co_active_handle = handle, co_previous_handle);
+}
+
+#ifdef __cplusplus
+}
+#endif
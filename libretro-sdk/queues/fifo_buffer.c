@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include <queues/fifo_buffer.h>
+#include <retro_inline.h>
 
 fifo_buffer_t *fifo_new(size_t size)
 {
@@ -109,3 +110,137 @@ void fifo_read(fifo_buffer_t *buffer, void *in_buf, size_t size)
    buffer->first = (buffer->first + size) % buffer->bufsize;
 }
 
+
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define FIFO_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define FIFO_LOAD_RELAXED(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define FIFO_STORE_RELEASE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+static INLINE size_t fifo_load_acquire(size_t *ptr)
+{
+   size_t val = *(volatile size_t*)ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static INLINE void fifo_store_release(size_t *ptr, size_t val)
+{
+   __sync_synchronize();
+   *(volatile size_t*)ptr = val;
+}
+
+#define FIFO_LOAD_ACQUIRE(ptr) fifo_load_acquire(ptr)
+#define FIFO_LOAD_RELAXED(ptr) (*(volatile size_t*)(ptr))
+#define FIFO_STORE_RELEASE(ptr, val) fifo_store_release(ptr, val)
+#elif defined(_MSC_VER)
+/* Volatile accesses have acquire/release semantics on MSVC,
+ * the barrier keeps the compiler from reordering around them. */
+#include <intrin.h>
+
+static INLINE size_t fifo_load_acquire(size_t *ptr)
+{
+   size_t val = *(volatile size_t*)ptr;
+   _ReadWriteBarrier();
+   return val;
+}
+
+static INLINE void fifo_store_release(size_t *ptr, size_t val)
+{
+   _ReadWriteBarrier();
+   *(volatile size_t*)ptr = val;
+}
+
+#define FIFO_LOAD_ACQUIRE(ptr) fifo_load_acquire(ptr)
+#define FIFO_LOAD_RELAXED(ptr) (*(volatile size_t*)(ptr))
+#define FIFO_STORE_RELEASE(ptr, val) fifo_store_release(ptr, val)
+#else
+#error "No atomic operations available for fifo_spsc_buffer_t."
+#endif
+
+fifo_spsc_buffer_t *fifo_spsc_new(size_t size)
+{
+   fifo_spsc_buffer_t *buf = (fifo_spsc_buffer_t*)calloc(1, sizeof(*buf));
+
+   if (!buf)
+      return NULL;
+
+   buf->buffer = (uint8_t*)calloc(1, size + 1);
+   if (!buf->buffer)
+   {
+      free(buf);
+      return NULL;
+   }
+   buf->bufsize = size + 1;
+
+   return buf;
+}
+
+void fifo_spsc_free(fifo_spsc_buffer_t *buffer)
+{
+   if (!buffer)
+      return;
+
+   free(buffer->buffer);
+   free(buffer);
+}
+
+size_t fifo_spsc_read_avail(fifo_spsc_buffer_t *buffer)
+{
+   size_t first = FIFO_LOAD_RELAXED(&buffer->first);
+   size_t end   = FIFO_LOAD_ACQUIRE(&buffer->end);
+
+   if (end < first)
+      end += buffer->bufsize;
+   return end - first;
+}
+
+size_t fifo_spsc_write_avail(fifo_spsc_buffer_t *buffer)
+{
+   size_t first = FIFO_LOAD_ACQUIRE(&buffer->first);
+   size_t end   = FIFO_LOAD_RELAXED(&buffer->end);
+
+   if (end < first)
+      end += buffer->bufsize;
+
+   return (buffer->bufsize - 1) - (end - first);
+}
+
+void fifo_spsc_write(fifo_spsc_buffer_t *buffer,
+      const void *in_buf, size_t size)
+{
+   size_t first_write = size;
+   size_t rest_write  = 0;
+   size_t end         = FIFO_LOAD_RELAXED(&buffer->end);
+
+   if (end + size > buffer->bufsize)
+   {
+      first_write = buffer->bufsize - end;
+      rest_write = size - first_write;
+   }
+
+   memcpy(buffer->buffer + end, in_buf, first_write);
+   memcpy(buffer->buffer, (const uint8_t*)in_buf + first_write, rest_write);
+
+   /* Publish the data only after it has been copied. */
+   FIFO_STORE_RELEASE(&buffer->end, (end + size) % buffer->bufsize);
+}
+
+void fifo_spsc_read(fifo_spsc_buffer_t *buffer, void *in_buf, size_t size)
+{
+   size_t first_read = size;
+   size_t rest_read  = 0;
+   size_t first      = FIFO_LOAD_RELAXED(&buffer->first);
+
+   if (first + size > buffer->bufsize)
+   {
+      first_read = buffer->bufsize - first;
+      rest_read = size - first_read;
+   }
+
+   memcpy(in_buf, (const uint8_t*)buffer->buffer + first, first_read);
+   memcpy((uint8_t*)in_buf + first_read, buffer->buffer, rest_read);
+
+   /* Hand the space back only after we are done reading from it. */
+   FIFO_STORE_RELEASE(&buffer->first, (first + size) % buffer->bufsize);
+}
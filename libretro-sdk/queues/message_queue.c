@@ -24,21 +24,103 @@
 #include <string.h>
 #include <boolean.h>
 #include <queues/message_queue.h>
-#include <compat/posix_string.h>
+#include <compat/strl.h>
+#include <retro_inline.h>
+
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define MSG_QUEUE_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define MSG_QUEUE_STORE_RELEASE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+static INLINE bool msg_queue_cas(unsigned *ptr, unsigned expected,
+      unsigned desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+         __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+#elif defined(__GNUC__)
+static INLINE unsigned msg_queue_load_acquire(unsigned *ptr)
+{
+   unsigned val = *(volatile unsigned*)ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static INLINE void msg_queue_store_release(unsigned *ptr, unsigned val)
+{
+   __sync_synchronize();
+   *(volatile unsigned*)ptr = val;
+}
+
+static INLINE bool msg_queue_cas(unsigned *ptr, unsigned expected,
+      unsigned desired)
+{
+   return __sync_bool_compare_and_swap(ptr, expected, desired);
+}
+
+#define MSG_QUEUE_LOAD_ACQUIRE(ptr) msg_queue_load_acquire(ptr)
+#define MSG_QUEUE_STORE_RELEASE(ptr, val) msg_queue_store_release(ptr, val)
+#elif defined(_MSC_VER)
+/* Volatile accesses have acquire/release semantics on MSVC,
+ * the barrier keeps the compiler from reordering around them. */
+#include <intrin.h>
+
+static INLINE unsigned msg_queue_load_acquire(unsigned *ptr)
+{
+   unsigned val = *(volatile unsigned*)ptr;
+   _ReadWriteBarrier();
+   return val;
+}
+
+static INLINE void msg_queue_store_release(unsigned *ptr, unsigned val)
+{
+   _ReadWriteBarrier();
+   *(volatile unsigned*)ptr = val;
+}
+
+static INLINE bool msg_queue_cas(unsigned *ptr, unsigned expected,
+      unsigned desired)
+{
+   return (unsigned)_InterlockedCompareExchange((volatile long*)ptr,
+         (long)desired, (long)expected) == expected;
+}
+
+#define MSG_QUEUE_LOAD_ACQUIRE(ptr) msg_queue_load_acquire(ptr)
+#define MSG_QUEUE_STORE_RELEASE(ptr, val) msg_queue_store_release(ptr, val)
+#else
+#error "No atomic operations available for msg_queue_t."
+#endif
 
 struct queue_elem
 {
    unsigned duration;
    unsigned prio;
-   char *msg;
+   char msg[MSG_QUEUE_MSG_MAX];
+};
+
+/* A slot is free to post into while seq equals the position
+ * it is at, and holds a message once seq is one past it. */
+struct queue_slot
+{
+   unsigned seq;
+   struct queue_elem elem;
 };
 
 struct msg_queue
 {
-   struct queue_elem **elems;
+   /* Messages posted from any thread, which the puller moves
+    * into the heap. */
+   struct queue_slot *slots;
+   unsigned slot_mask;
+   unsigned post_pos;
+   unsigned take_pos;
+
+   /* Heap by priority, elems[1] is the front. Only the puller
+    * touches it. */
+   struct queue_elem *elems;
    size_t ptr;
    size_t size;
-   char *tmp_msg;
+   char tmp_msg[MSG_QUEUE_MSG_MAX];
 };
 
 /**
@@ -52,19 +134,28 @@ struct msg_queue
  **/
 msg_queue_t *msg_queue_new(size_t size)
 {
+   unsigned i, slots = 1;
    msg_queue_t *queue = (msg_queue_t*)calloc(1, sizeof(*queue));
    if (!queue)
       return NULL;
 
-   queue->size = size + 1;
-   queue->elems = (struct queue_elem**)
-      calloc(queue->size,sizeof(struct queue_elem*)); 
+   while (slots < size)
+      slots <<= 1;
 
-   if (!queue->elems)
+   queue->slot_mask = slots - 1;
+   queue->slots = (struct queue_slot*)calloc(slots, sizeof(*queue->slots));
+   queue->size  = size + 1;
+   queue->elems = (struct queue_elem*)
+      calloc(queue->size, sizeof(struct queue_elem));
+
+   if (!queue->slots || !queue->elems)
    {
-      free(queue);
+      msg_queue_free(queue);
       return NULL;
    }
+
+   for (i = 0; i < slots; i++)
+      queue->slots[i].seq = i;
    queue->ptr = 1;
 
    return queue;
@@ -80,7 +171,7 @@ void msg_queue_free(msg_queue_t *queue)
 {
    if (queue)
    {
-      msg_queue_clear(queue);
+      free(queue->slots);
       free(queue->elems);
    }
    free(queue);
@@ -95,40 +186,83 @@ void msg_queue_free(msg_queue_t *queue)
  *                      before it vanishes (E.g. show a message for
  *                      3 seconds @ 60fps = 180 duration).
  *
- * Push a new message onto the queue.
+ * Push a new message onto the queue. Safe to call from any
+ * thread, does not allocate or lock. Messages are dropped
+ * while the queue is full.
  **/
 void msg_queue_push(msg_queue_t *queue, const char *msg,
       unsigned prio, unsigned duration)
 {
-   size_t tmp_ptr = 0;
-   struct queue_elem *new_elem = NULL;
+   unsigned pos;
+   struct queue_slot *slot = NULL;
 
-   if (!queue || queue->ptr >= queue->size)
+   if (!queue)
       return;
 
-   new_elem = (struct queue_elem*)calloc(1, sizeof(struct queue_elem));
-   if (!new_elem)
-      return;
+   pos = MSG_QUEUE_LOAD_ACQUIRE(&queue->post_pos);
 
-   new_elem->prio = prio;
-   new_elem->duration = duration;
-   new_elem->msg = msg ? strdup(msg) : NULL;
+   for (;;)
+   {
+      int diff;
 
-   queue->elems[queue->ptr] = new_elem;
-   tmp_ptr = queue->ptr++;
+      slot = &queue->slots[pos & queue->slot_mask];
+      diff = (int)(MSG_QUEUE_LOAD_ACQUIRE(&slot->seq) - pos);
 
-   while (tmp_ptr > 1)
-   {
-      struct queue_elem *parent = queue->elems[tmp_ptr >> 1];
-      struct queue_elem *child  = queue->elems[tmp_ptr];
+      /* Still holds a message the puller has not taken. */
+      if (diff < 0)
+         return;
 
-      if (child->prio <= parent->prio)
+      if (diff == 0 && msg_queue_cas(&queue->post_pos, pos, pos + 1))
          break;
 
-      queue->elems[tmp_ptr >> 1] = child;
-      queue->elems[tmp_ptr] = parent;
+      pos = MSG_QUEUE_LOAD_ACQUIRE(&queue->post_pos);
+   }
+
+   slot->elem.prio     = prio;
+   slot->elem.duration = duration;
+   if (msg)
+      strlcpy(slot->elem.msg, msg, sizeof(slot->elem.msg));
+   else
+      *slot->elem.msg = '\0';
+
+   MSG_QUEUE_STORE_RELEASE(&slot->seq, pos + 1);
+}
+
+static void msg_queue_swap(msg_queue_t *queue, size_t a, size_t b)
+{
+   struct queue_elem tmp = queue->elems[a];
+   queue->elems[a] = queue->elems[b];
+   queue->elems[b] = tmp;
+}
+
+/* Moves what was posted into the heap. */
+static void msg_queue_take_posted(msg_queue_t *queue)
+{
+   for (;;)
+   {
+      size_t tmp_ptr;
+      struct queue_slot *slot = &queue->slots[
+         queue->take_pos & queue->slot_mask];
+
+      if (MSG_QUEUE_LOAD_ACQUIRE(&slot->seq) != queue->take_pos + 1)
+         return;
+
+      if (queue->ptr < queue->size)
+      {
+         queue->elems[queue->ptr] = slot->elem;
+         tmp_ptr = queue->ptr++;
+
+         while (tmp_ptr > 1 && queue->elems[tmp_ptr].prio
+               > queue->elems[tmp_ptr >> 1].prio)
+         {
+            msg_queue_swap(queue, tmp_ptr, tmp_ptr >> 1);
+            tmp_ptr >>= 1;
+         }
+      }
 
-      tmp_ptr >>= 1;
+      MSG_QUEUE_STORE_RELEASE(&slot->seq,
+            queue->take_pos + queue->slot_mask + 1);
+      queue->take_pos++;
    }
 }
 
@@ -140,92 +274,65 @@ void msg_queue_push(msg_queue_t *queue, const char *msg,
  **/
 void msg_queue_clear(msg_queue_t *queue)
 {
-   size_t i;
-
    if (!queue)
       return;
 
-   for (i = 1; i < queue->ptr; i++)
-   {
-      if (queue->elems[i])
-      {
-         free(queue->elems[i]->msg);
-         free(queue->elems[i]);
-         queue->elems[i] = NULL;
-      }
-   }
+   msg_queue_take_posted(queue);
    queue->ptr = 1;
-   free(queue->tmp_msg);
-   queue->tmp_msg = NULL;
+   *queue->tmp_msg = '\0';
 }
 
 /**
  * msg_queue_pull:
  * @queue             : pointer to queue object
  *
- * Pulls highest priority message in queue.
+ * Pulls highest priority message in queue. Only one thread
+ * may pull, clear or free the queue.
  *
  * Returns: NULL if no message in queue, otherwise a string
- * containing the message.
+ * containing the message, valid until the next pull or clear.
  **/
 const char *msg_queue_pull(msg_queue_t *queue)
 {
-   struct queue_elem *front  = NULL, *last = NULL,
-                     *parent = NULL, *child = NULL;
+   struct queue_elem *front = NULL;
    size_t tmp_ptr = 1;
-    
-   (void)parent;
-   (void)child;
-   (void)tmp_ptr;
-    
+
+   if (!queue)
+      return NULL;
+
+   msg_queue_take_posted(queue);
+
    /* Nothing in queue. */
-   if (!queue || queue->ptr == 1)
+   if (queue->ptr == 1)
       return NULL;
 
-   front = (struct queue_elem*)queue->elems[1];
+   front = &queue->elems[1];
    front->duration--;
    if (front->duration > 0)
-      return front->msg;
-
-   free(queue->tmp_msg);
-   queue->tmp_msg = front->msg;
-   front->msg = NULL;
+      return *front->msg ? front->msg : NULL;
 
-   front = (struct queue_elem*)queue->elems[1];
-   last  = (struct queue_elem*)queue->elems[--queue->ptr];
-   queue->elems[1] = last;
-   free(front);
+   memcpy(queue->tmp_msg, front->msg, sizeof(queue->tmp_msg));
+   queue->elems[1] = queue->elems[--queue->ptr];
 
    for (;;)
    {
       size_t switch_index = tmp_ptr;
-      bool left = (tmp_ptr * 2 <= queue->ptr)
-         && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2]);
-      bool right = (tmp_ptr * 2 + 1 <= queue->ptr)
-         && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2 + 1]);
+      size_t left         = tmp_ptr * 2;
+      size_t right        = tmp_ptr * 2 + 1;
 
-      if (!left && !right)
-         break;
+      if (left < queue->ptr && queue->elems[left].prio
+            > queue->elems[switch_index].prio)
+         switch_index = left;
+      if (right < queue->ptr && queue->elems[right].prio
+            > queue->elems[switch_index].prio)
+         switch_index = right;
 
-      if (left && !right)
-         switch_index <<= 1;
-      else if (right && !left)
-         switch_index += switch_index + 1;
-      else
-      {
-         if (queue->elems[tmp_ptr * 2]
-               >= queue->elems[tmp_ptr * 2 + 1])
-            switch_index <<= 1;
-         else
-            switch_index += switch_index + 1;
-      }
+      if (switch_index == tmp_ptr)
+         break;
 
-      parent = (struct queue_elem*)queue->elems[tmp_ptr];
-      child  = (struct queue_elem*)queue->elems[switch_index];
-      queue->elems[tmp_ptr] = child;
-      queue->elems[switch_index] = parent;
+      msg_queue_swap(queue, tmp_ptr, switch_index);
       tmp_ptr = switch_index;
    }
 
-   return queue->tmp_msg;
+   return *queue->tmp_msg ? queue->tmp_msg : NULL;
 }
@@ -0,0 +1,463 @@
+/* Copyright  (C) 2010-2015 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthreadpool.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rthreads/rthreads.h>
+#include <rthreads/rthreadpool.h>
+
+struct pool_task
+{
+   sthread_task_t task;
+   sthread_for_t range;
+   void *userdata;
+   unsigned index;
+   sthread_group_t *group;
+};
+
+/* Ring of tasks. The owning worker takes the newest task,
+ * thieves take the oldest. */
+struct pool_queue
+{
+   slock_t *lock;
+   struct pool_task *tasks;
+   size_t head;
+   size_t count;
+   size_t capacity;
+};
+
+struct pool_worker
+{
+   sthread_pool_t *pool;
+   sthread_t *thread;
+   unsigned index;
+};
+
+struct sthread_pool
+{
+   struct pool_worker *workers;
+   unsigned threads;
+
+   /* One queue per worker, at least one. */
+   struct pool_queue *queues;
+   unsigned num_queues;
+
+   /* Run by every worker as it starts. */
+   sthread_for_t thread_init;
+   void *thread_init_userdata;
+
+   /* Idle workers sleep on cond until tasks are queued. */
+   slock_t *lock;
+   scond_t *cond;
+   unsigned pending;
+   unsigned next_queue;
+   bool quit;
+};
+
+struct sthread_group
+{
+   sthread_pool_t *pool;
+   slock_t *lock;
+   scond_t *cond;
+   unsigned pending;
+};
+
+static bool pool_queue_push(struct pool_queue *queue,
+      const struct pool_task *task)
+{
+   if (queue->count == queue->capacity)
+   {
+      size_t i;
+      size_t capacity = queue->capacity ? queue->capacity * 2 : 64;
+      struct pool_task *tasks = (struct pool_task*)
+         malloc(capacity * sizeof(*tasks));
+
+      if (!tasks)
+         return false;
+
+      for (i = 0; i < queue->count; i++)
+         tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+
+      free(queue->tasks);
+      queue->tasks    = tasks;
+      queue->head     = 0;
+      queue->capacity = capacity;
+   }
+
+   queue->tasks[(queue->head + queue->count) % queue->capacity] = *task;
+   queue->count++;
+   return true;
+}
+
+static bool pool_queue_pop(struct pool_queue *queue,
+      struct pool_task *task, bool steal)
+{
+   bool ret = false;
+
+   slock_lock(queue->lock);
+   if (queue->count)
+   {
+      if (steal)
+      {
+         *task       = queue->tasks[queue->head];
+         queue->head = (queue->head + 1) % queue->capacity;
+      }
+      else
+         *task = queue->tasks[
+            (queue->head + queue->count - 1) % queue->capacity];
+
+      queue->count--;
+      ret = true;
+   }
+   slock_unlock(queue->lock);
+
+   return ret;
+}
+
+/**
+ * pool_take:
+ * @pool                    : pointer to thread pool object 
+ * @self                    : queue to look at first.
+ * @task                    : filled with the task to run.
+ *
+ * Takes the newest task of our own queue, or steals the 
+ * oldest one of another queue if ours is empty.
+ *
+ * Returns: true (1) if a task was taken, otherwise false (0).
+ **/
+static bool pool_take(sthread_pool_t *pool, unsigned self,
+      struct pool_task *task)
+{
+   unsigned i;
+   bool ret = pool_queue_pop(&pool->queues[self], task, false);
+
+   for (i = 1; !ret && i < pool->num_queues; i++)
+      ret = pool_queue_pop(&pool->queues[(self + i) % pool->num_queues],
+            task, true);
+
+   if (ret)
+   {
+      slock_lock(pool->lock);
+      pool->pending--;
+      slock_unlock(pool->lock);
+   }
+
+   return ret;
+}
+
+static void pool_run(const struct pool_task *task)
+{
+   sthread_group_t *group = task->group;
+
+   if (task->task)
+      task->task(task->userdata);
+   else
+      task->range(task->userdata, task->index);
+
+   slock_lock(group->lock);
+   if (--group->pending == 0)
+      scond_broadcast(group->cond);
+   slock_unlock(group->lock);
+}
+
+static bool pool_submit(sthread_pool_t *pool, const struct pool_task *task)
+{
+   struct pool_queue *queue;
+   bool ret;
+
+   /* pending has to be raised before anyone can take the task 
+    * and lower it again, hence the nested locks. */
+   slock_lock(pool->lock);
+   queue = &pool->queues[pool->next_queue];
+   pool->next_queue = (pool->next_queue + 1) % pool->num_queues;
+
+   slock_lock(queue->lock);
+   ret = pool_queue_push(queue, task);
+   slock_unlock(queue->lock);
+
+   if (ret)
+   {
+      pool->pending++;
+      scond_signal(pool->cond);
+   }
+   slock_unlock(pool->lock);
+
+   return ret;
+}
+
+static void pool_worker_loop(void *data)
+{
+   struct pool_worker *worker = (struct pool_worker*)data;
+   sthread_pool_t *pool       = worker->pool;
+
+   if (pool->thread_init)
+      pool->thread_init(pool->thread_init_userdata, worker->index);
+
+   for (;;)
+   {
+      struct pool_task task;
+      bool quit;
+
+      if (pool_take(pool, worker->index, &task))
+      {
+         pool_run(&task);
+         continue;
+      }
+
+      slock_lock(pool->lock);
+      while (!pool->pending && !pool->quit)
+         scond_wait(pool->cond, pool->lock);
+      quit = pool->quit;
+      slock_unlock(pool->lock);
+
+      if (quit)
+         break;
+   }
+}
+
+sthread_pool_t *sthread_pool_new(unsigned threads)
+{
+   return sthread_pool_new_init(threads, NULL, NULL);
+}
+
+sthread_pool_t *sthread_pool_new_init(unsigned threads,
+      sthread_for_t thread_init, void *userdata)
+{
+   unsigned i;
+   sthread_pool_t *pool = (sthread_pool_t*)calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->thread_init          = thread_init;
+   pool->thread_init_userdata = userdata;
+
+   pool->num_queues = threads ? threads : 1;
+   pool->queues     = (struct pool_queue*)
+      calloc(pool->num_queues, sizeof(*pool->queues));
+   pool->workers    = (struct pool_worker*)
+      calloc(pool->num_queues, sizeof(*pool->workers));
+   pool->lock       = slock_new();
+   pool->cond       = scond_new();
+
+   if (!pool->queues || !pool->workers || !pool->lock || !pool->cond)
+      goto error;
+
+   for (i = 0; i < pool->num_queues; i++)
+   {
+      pool->queues[i].lock = slock_new();
+      if (!pool->queues[i].lock)
+         goto error;
+   }
+
+   for (i = 0; i < threads; i++)
+   {
+      pool->workers[i].pool   = pool;
+      pool->workers[i].index  = i;
+      pool->workers[i].thread = sthread_create(pool_worker_loop,
+            &pool->workers[i]);
+      if (!pool->workers[i].thread)
+         goto error;
+      pool->threads++;
+   }
+
+   return pool;
+
+error:
+   sthread_pool_free(pool);
+   return NULL;
+}
+
+void sthread_pool_free(sthread_pool_t *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock && pool->cond)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->threads; i++)
+      sthread_join(pool->workers[i].thread);
+
+   if (pool->queues)
+   {
+      for (i = 0; i < pool->num_queues; i++)
+      {
+         if (pool->queues[i].lock)
+            slock_free(pool->queues[i].lock);
+         free(pool->queues[i].tasks);
+      }
+   }
+
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->cond)
+      scond_free(pool->cond);
+
+   free(pool->queues);
+   free(pool->workers);
+   free(pool);
+}
+
+unsigned sthread_pool_threads(sthread_pool_t *pool)
+{
+   return pool->threads + 1;
+}
+
+sthread_group_t *sthread_group_new(sthread_pool_t *pool)
+{
+   sthread_group_t *group = (sthread_group_t*)calloc(1, sizeof(*group));
+
+   if (!group)
+      return NULL;
+
+   group->pool = pool;
+   group->lock = slock_new();
+   group->cond = scond_new();
+
+   if (!group->lock || !group->cond)
+   {
+      if (group->lock)
+         slock_free(group->lock);
+      if (group->cond)
+         scond_free(group->cond);
+      free(group);
+      return NULL;
+   }
+
+   return group;
+}
+
+static bool group_submit(sthread_group_t *group, struct pool_task *task)
+{
+   task->group = group;
+
+   slock_lock(group->lock);
+   group->pending++;
+   slock_unlock(group->lock);
+
+   if (pool_submit(group->pool, task))
+      return true;
+
+   /* Could not queue it, so run it ourselves. */
+   pool_run(task);
+   return true;
+}
+
+bool sthread_group_run(sthread_group_t *group,
+      sthread_task_t func, void *userdata)
+{
+   struct pool_task task;
+
+   memset(&task, 0, sizeof(task));
+   task.task     = func;
+   task.userdata = userdata;
+
+   return group_submit(group, &task);
+}
+
+void sthread_group_wait(sthread_group_t *group)
+{
+   sthread_pool_t *pool = group->pool;
+   unsigned start       = 0;
+
+   for (;;)
+   {
+      struct pool_task task;
+      bool done;
+
+      slock_lock(group->lock);
+      done = !group->pending;
+      slock_unlock(group->lock);
+
+      if (done)
+         return;
+
+      /* Help out instead of just blocking. */
+      if (pool_take(pool, start, &task))
+      {
+         pool_run(&task);
+         start = (start + 1) % pool->num_queues;
+         continue;
+      }
+
+      /* Everything left is already running on a worker. */
+      slock_lock(group->lock);
+      while (group->pending)
+         scond_wait(group->cond, group->lock);
+      slock_unlock(group->lock);
+      return;
+   }
+}
+
+void sthread_group_free(sthread_group_t *group)
+{
+   if (!group)
+      return;
+
+   sthread_group_wait(group);
+
+   slock_free(group->lock);
+   scond_free(group->cond);
+   free(group);
+}
+
+void sthread_pool_parallel_for(sthread_pool_t *pool, unsigned count,
+      sthread_for_t func, void *userdata)
+{
+   unsigned i;
+   struct pool_task task;
+   sthread_group_t *group = NULL;
+
+   if (count > 1)
+      group = sthread_group_new(pool);
+
+   if (!group)
+   {
+      for (i = 0; i < count; i++)
+         func(userdata, i);
+      return;
+   }
+
+   memset(&task, 0, sizeof(task));
+   task.range    = func;
+   task.userdata = userdata;
+
+   /* The first iteration is ours. */
+   for (i = 1; i < count; i++)
+   {
+      task.index = i;
+      group_submit(group, &task);
+   }
+
+   func(userdata, 0);
+
+   sthread_group_free(group);
+}
@@ -21,6 +21,7 @@
  */
 
 #include <rthreads/rthreads.h>
+#include <retro_inline.h>
 #include <stdlib.h>
 
 #if defined(_WIN32)
@@ -44,6 +45,27 @@
 #include <mach/mach.h>
 #endif
 
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && (defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#define HAVE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* pthread_cond_timedwait() can measure against the monotonic 
+ * clock, so that clock adjustments do not stretch timeouts. */
+#if defined(__linux__) && !defined(ANDROID)
+#define SCOND_MONOTONIC
+#endif
+
 struct thread_data
 {
    void (*func)(void*);
@@ -77,6 +99,21 @@ struct scond
 #endif
 };
 
+struct sevent
+{
+#if defined(HAVE_FUTEX)
+   /* 1 if set, 0 if not. */
+   int state;
+   unsigned spin_us;
+#elif defined(_WIN32)
+   HANDLE event;
+#else
+   slock_t *lock;
+   scond_t *cond;
+   bool state;
+#endif
+};
+
 #ifdef _WIN32
 static DWORD CALLBACK thread_wrap(void *data_)
 #else
@@ -148,7 +185,9 @@ int sthread_detach(sthread_t *thread)
    free(thread);
    return 0;
 #else
-   return pthread_detach(thread->id);
+   int ret = pthread_detach(thread->id);
+   free(thread);
+   return ret;
 #endif
 }
 
@@ -174,6 +213,159 @@ void sthread_join(sthread_t *thread)
    free(thread);
 }
 
+/**
+ * sthread_get_current_thread_id:
+ *
+ * Returns: ID of the calling thread, which no other running
+ * thread shares.
+ */
+uintptr_t sthread_get_current_thread_id(void)
+{
+#if defined(_WIN32)
+   return (uintptr_t)GetCurrentThreadId();
+#elif defined(GEKKO)
+   return (uintptr_t)LWP_GetSelf();
+#elif defined(PSP)
+   return (uintptr_t)sceKernelGetThreadId();
+#else
+   return (uintptr_t)pthread_self();
+#endif
+}
+
+#if defined(_WIN32) && !defined(_XBOX)
+typedef HANDLE (WINAPI *av_set_mm_thread_characteristics_t)(
+      LPCSTR task, LPDWORD task_index);
+
+static bool sthread_set_mmcss(const char *task)
+{
+   DWORD task_index = 0;
+   av_set_mm_thread_characteristics_t set_characteristics;
+   /* Stays loaded for as long as the thread is registered. */
+   HMODULE avrt = LoadLibraryA("avrt.dll");
+
+   if (!avrt)
+      return false;
+
+   set_characteristics = (av_set_mm_thread_characteristics_t)
+      GetProcAddress(avrt, "AvSetMmThreadCharacteristicsA");
+
+   return set_characteristics && set_characteristics(task, &task_index);
+}
+#endif
+
+/**
+ * sthread_set_current_priority:
+ * @priority                : priority to run at.
+ * @mmcss_task              : MMCSS task of the thread on Windows,
+ *                            e.g. "Pro Audio", or NULL.
+ *
+ * Sets the priority of the calling thread. Realtime is SCHED_FIFO
+ * with pthreads. On Windows, it registers the thread with MMCSS
+ * as @mmcss_task, falling back to time critical priority.
+ *
+ * Returns: true (1) on success, false (0) if the system did not
+ * allow it, or does not support it.
+ */
+bool sthread_set_current_priority(enum sthread_priority priority,
+      const char *mmcss_task)
+{
+#if defined(_WIN32)
+   int win_priority = THREAD_PRIORITY_NORMAL;
+
+   switch (priority)
+   {
+      case STHREAD_PRIORITY_LOW:
+         win_priority = THREAD_PRIORITY_BELOW_NORMAL;
+         break;
+      case STHREAD_PRIORITY_HIGH:
+         win_priority = THREAD_PRIORITY_HIGHEST;
+         break;
+      case STHREAD_PRIORITY_REALTIME:
+#ifndef _XBOX
+         if (mmcss_task && sthread_set_mmcss(mmcss_task))
+            return true;
+#endif
+         win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+         break;
+      default:
+         break;
+   }
+
+   return SetThreadPriority(GetCurrentThread(), win_priority) != 0;
+#elif defined(GEKKO) || defined(PSP)
+   (void)priority;
+   (void)mmcss_task;
+   return false;
+#else
+   struct sched_param param = {0};
+
+   (void)mmcss_task;
+
+   if (priority == STHREAD_PRIORITY_REALTIME)
+   {
+      int min = sched_get_priority_min(SCHED_FIFO);
+      int max = sched_get_priority_max(SCHED_FIFO);
+
+      /* Low in the realtime range, system audio and input
+       * threads still come first. */
+      param.sched_priority = min + 10 < max ? min + 10 : max;
+      return pthread_setschedparam(pthread_self(),
+            SCHED_FIFO, &param) == 0;
+   }
+
+#if defined(__linux__)
+   /* Threads have nice values of their own on Linux. */
+   if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0)
+      return false;
+
+   return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid),
+         priority == STHREAD_PRIORITY_LOW ? 10 :
+         priority == STHREAD_PRIORITY_HIGH ? -10 : 0) == 0;
+#else
+   {
+      int min = sched_get_priority_min(SCHED_OTHER);
+      int max = sched_get_priority_max(SCHED_OTHER);
+
+      param.sched_priority = priority == STHREAD_PRIORITY_LOW ? min :
+         priority == STHREAD_PRIORITY_HIGH ? max : (min + max) / 2;
+      return pthread_setschedparam(pthread_self(),
+            SCHED_OTHER, &param) == 0;
+   }
+#endif
+#endif
+}
+
+/**
+ * sthread_set_current_affinity:
+ * @cpu_mask                : bit N set to run on CPU N.
+ *
+ * Restricts the calling thread to the CPUs in @cpu_mask.
+ *
+ * Returns: true (1) on success, false (0) if the system did not
+ * allow it, or does not support it.
+ */
+bool sthread_set_current_affinity(uint64_t cpu_mask)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   return SetThreadAffinityMask(GetCurrentThread(),
+         (DWORD_PTR)cpu_mask) != 0;
+#elif defined(__linux__) && defined(CPU_SET)
+   unsigned i;
+   cpu_set_t set;
+
+   CPU_ZERO(&set);
+   for (i = 0; i < 64; i++)
+      if (cpu_mask & ((uint64_t)1 << i))
+         CPU_SET(i, &set);
+
+   /* 0 is the calling thread. */
+   return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+   (void)cpu_mask;
+   return false;
+#endif
+}
+
 /**
  * slock_new:
  *
@@ -268,9 +460,19 @@ scond_t *scond_new(void)
    if (!cond)
       return NULL;
 
-#ifdef _WIN32
+#if defined(_WIN32)
    cond->event = CreateEvent(NULL, FALSE, FALSE, NULL);
    if (!cond->event)
+#elif defined(SCOND_MONOTONIC)
+   pthread_condattr_t attr;
+   bool failed;
+
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   failed = pthread_cond_init(&cond->cond, &attr) != 0;
+   pthread_condattr_destroy(&attr);
+
+   if (failed)
 #else
    if (pthread_cond_init(&cond->cond, NULL) < 0)
 #endif
@@ -415,13 +617,15 @@ bool scond_wait_timeout(scond_t *cond, slock_t *lock, int64_t timeout_us)
    gettimeofday(&tm, NULL);
    now.tv_sec = tm.tv_sec;
    now.tv_nsec = tm.tv_usec * 1000;
+#elif defined(SCOND_MONOTONIC)
+   clock_gettime(CLOCK_MONOTONIC, &now);
 #elif !defined(GEKKO)
    /* timeout on libogc is duration, not end time. */
    clock_gettime(CLOCK_REALTIME, &now);
 #endif
 
    now.tv_sec += timeout_us / 1000000LL;
-   now.tv_nsec += timeout_us * 1000LL;
+   now.tv_nsec += (timeout_us % 1000000LL) * 1000LL;
 
    now.tv_sec += now.tv_nsec / 1000000000LL;
    now.tv_nsec = now.tv_nsec % 1000000000LL;
@@ -430,3 +634,163 @@ bool scond_wait_timeout(scond_t *cond, slock_t *lock, int64_t timeout_us)
    return (ret == 0);
 #endif
 }
+
+#ifdef HAVE_FUTEX
+static int64_t sevent_now_us(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (int64_t)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+static INLINE void sevent_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+   __builtin_ia32_pause();
+#endif
+}
+
+/* Resets the event if it was set. */
+static INLINE bool sevent_consume(sevent_t *event)
+{
+   return __atomic_exchange_n(&event->state, 0, __ATOMIC_ACQUIRE) == 1;
+}
+#endif
+
+sevent_t *sevent_new(unsigned spin_us)
+{
+   sevent_t *event = (sevent_t*)calloc(1, sizeof(*event));
+   if (!event)
+      return NULL;
+
+#if defined(HAVE_FUTEX)
+   event->spin_us = spin_us;
+#elif defined(_WIN32)
+   (void)spin_us;
+   event->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+   if (!event->event)
+   {
+      free(event);
+      return NULL;
+   }
+#else
+   (void)spin_us;
+   event->lock = slock_new();
+   event->cond = scond_new();
+   if (!event->lock || !event->cond)
+   {
+      sevent_free(event);
+      return NULL;
+   }
+#endif
+
+   return event;
+}
+
+void sevent_free(sevent_t *event)
+{
+   if (!event)
+      return;
+
+#if defined(HAVE_FUTEX)
+#elif defined(_WIN32)
+   CloseHandle(event->event);
+#else
+   if (event->lock)
+      slock_free(event->lock);
+   if (event->cond)
+      scond_free(event->cond);
+#endif
+   free(event);
+}
+
+void sevent_signal(sevent_t *event)
+{
+#if defined(HAVE_FUTEX)
+   if (__atomic_exchange_n(&event->state, 1, __ATOMIC_RELEASE) == 0)
+      syscall(SYS_futex, &event->state, FUTEX_WAKE_PRIVATE, 1,
+            NULL, NULL, 0);
+#elif defined(_WIN32)
+   SetEvent(event->event);
+#else
+   slock_lock(event->lock);
+   event->state = true;
+   scond_signal(event->cond);
+   slock_unlock(event->lock);
+#endif
+}
+
+/* Negative @timeout_us waits forever. */
+static bool sevent_wait_internal(sevent_t *event, int64_t timeout_us)
+{
+#if defined(HAVE_FUTEX)
+   int64_t now      = sevent_now_us();
+   int64_t deadline = now + timeout_us;
+   int64_t spin_end = now + event->spin_us;
+
+   if (sevent_consume(event))
+      return true;
+
+   while (now < spin_end && (timeout_us < 0 || now < deadline))
+   {
+      if (__atomic_load_n(&event->state, __ATOMIC_RELAXED)
+            && sevent_consume(event))
+         return true;
+      sevent_relax();
+      now = sevent_now_us();
+   }
+
+   for (;;)
+   {
+      struct timespec remaining;
+
+      if (sevent_consume(event))
+         return true;
+
+      if (timeout_us >= 0)
+      {
+         int64_t left = deadline - sevent_now_us();
+         if (left <= 0)
+            return false;
+
+         remaining.tv_sec  = left / 1000000LL;
+         remaining.tv_nsec = (left % 1000000LL) * 1000LL;
+      }
+
+      /* Timeouts of FUTEX_WAIT are relative, against 
+       * the monotonic clock. */
+      syscall(SYS_futex, &event->state, FUTEX_WAIT_PRIVATE, 0,
+            timeout_us >= 0 ? &remaining : NULL, NULL, 0);
+   }
+#elif defined(_WIN32)
+   return WaitForSingleObject(event->event, timeout_us < 0
+         ? INFINITE : (DWORD)((timeout_us + 999) / 1000)) == WAIT_OBJECT_0;
+#else
+   bool ret = true;
+
+   slock_lock(event->lock);
+   if (timeout_us < 0)
+   {
+      while (!event->state)
+         scond_wait(event->cond, event->lock);
+   }
+   else if (!event->state)
+      scond_wait_timeout(event->cond, event->lock, timeout_us);
+
+   ret = event->state;
+   event->state = false;
+   slock_unlock(event->lock);
+
+   return ret;
+#endif
+}
+
+void sevent_wait(sevent_t *event)
+{
+   sevent_wait_internal(event, -1);
+}
+
+bool sevent_wait_timeout(sevent_t *event, int64_t timeout_us)
+{
+   return sevent_wait_internal(event, timeout_us < 0 ? 0 : timeout_us);
+}
@@ -28,6 +28,55 @@
 #include <compat/strl.h>
 #include <compat/posix_string.h>
 
+#define STRING_LIST_ARENA_MIN (4 * 1024)
+#define STRING_LIST_ARENA_MAX (64 * 1024)
+
+/* Block of element strings, the bytes follow the header. */
+struct string_list_arena
+{
+   struct string_list_arena *next;
+   size_t size;
+   size_t used;
+};
+
+/**
+ * string_list_arena_dup:
+ * @list             : pointer to string list in arena mode
+ * @str              : string to copy
+ *
+ * Copies @str into the list's current block, starting a new
+ * one when it does not fit. Blocks double in size up to
+ * STRING_LIST_ARENA_MAX, longer strings get a block of their own.
+ *
+ * Returns: the copy if successful, otherwise NULL.
+ **/
+static char *string_list_arena_dup(struct string_list *list, const char *str)
+{
+   char *data;
+   size_t len = strlen(str) + 1;
+   struct string_list_arena *block = list->arena;
+
+   if (block->size - block->used < len)
+   {
+      size_t size = min(block->size * 2, STRING_LIST_ARENA_MAX);
+
+      block = (struct string_list_arena*)
+         malloc(sizeof(*block) + max(size, len));
+      if (!block)
+         return NULL;
+
+      block->next = list->arena;
+      block->size = max(size, len);
+      block->used = 0;
+      list->arena = block;
+   }
+
+   data = (char*)(block + 1) + block->used;
+   memcpy(data, str, len);
+   block->used += len;
+   return data;
+}
+
 /**
  * string_list_free
  * @list             : pointer to string list object
@@ -40,8 +89,21 @@ void string_list_free(struct string_list *list)
    if (!list)
       return;
 
-   for (i = 0; i < list->size; i++)
-      free(list->elems[i].data);
+   if (list->arena)
+   {
+      while (list->arena)
+      {
+         struct string_list_arena *next = list->arena->next;
+         free(list->arena);
+         list->arena = next;
+      }
+   }
+   else
+   {
+      for (i = 0; i < list->size; i++)
+         free(list->elems[i].data);
+   }
+
    free(list->elems);
    free(list);
 }
@@ -95,6 +157,44 @@ struct string_list *string_list_new(void)
    return list;
 }
 
+/**
+ * string_list_new_arena:
+ *
+ * Creates a new string list which keeps its element strings
+ * packed in a few large blocks rather than allocating each one,
+ * for lists of many short strings. Strings replaced with
+ * string_list_set() are only released together with the list.
+ * Has to be freed manually with string_list_free().
+ *
+ * Returns: new string list if successful, otherwise NULL.
+ */
+static struct string_list *string_list_new_arena_size(size_t size)
+{
+   struct string_list *list = string_list_new();
+
+   if (!list)
+      return NULL;
+
+   list->arena = (struct string_list_arena*)
+      malloc(sizeof(*list->arena) + size);
+
+   if (!list->arena)
+   {
+      string_list_free(list);
+      return NULL;
+   }
+
+   list->arena->next = NULL;
+   list->arena->size = size;
+   list->arena->used = 0;
+   return list;
+}
+
+struct string_list *string_list_new_arena(void)
+{
+   return string_list_new_arena_size(STRING_LIST_ARENA_MIN);
+}
+
 /**
  * string_list_append:
  * @list             : pointer to string list
@@ -113,7 +213,10 @@ bool string_list_append(struct string_list *list, const char *elem,
          !string_list_capacity(list, list->cap * 2))
       return false;
 
-   data_dup = strdup(elem);
+   if (list->arena)
+      data_dup = string_list_arena_dup(list, elem);
+   else
+      data_dup = strdup(elem);
    if (!data_dup)
       return false;
 
@@ -135,6 +238,13 @@ bool string_list_append(struct string_list *list, const char *elem,
 void string_list_set(struct string_list *list,
       unsigned idx, const char *str)
 {
+   if (list->arena)
+   {
+      rarch_assert(list->elems[idx].data =
+            string_list_arena_dup(list, str));
+      return;
+   }
+
    free(list->elems[idx].data);
    rarch_assert(list->elems[idx].data = strdup(str));
 }
@@ -180,7 +290,8 @@ struct string_list *string_split(const char *str, const char *delim)
    char *save      = NULL;
    char *copy      = NULL;
    const char *tmp = NULL;
-   struct string_list *list = string_list_new();
+   /* The tokens never take more than @str itself. */
+   struct string_list *list = string_list_new_arena_size(strlen(str) + 1);
 
    if (!list)
       goto error;
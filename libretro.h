@@ -851,6 +851,23 @@ enum retro_mod
                                             * Returns the specified language of the frontend, if specified by the user.
                                             * It can be used by the core for localization purposes.
                                             */
+#define RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER (40 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+                                           /* struct retro_framebuffer * --
+                                            * Returns a preallocated framebuffer which the core can render 
+                                            * the frame into when not using SET_HW_RENDER. The core fills in 
+                                            * width, height and access_flags, the frontend fills in the rest.
+                                            * The framebuffer must not be used after the current call to 
+                                            * retro_run() returns.
+                                            *
+                                            * This lets a core render straight into memory owned by the 
+                                            * video driver, so that the frame does not have to be copied.
+                                            * To make use of it, the core must pass the exact same pointer, 
+                                            * width, height and pitch to retro_video_refresh_t.
+                                            * Rendering into a different buffer is still valid.
+                                            *
+                                            * The contents of the framebuffer are undefined when it is 
+                                            * returned, the buffer is always writeable and readable.
+                                            */
 
 #define RETRO_MEMDESC_CONST     (1 << 0)   /* The frontend will never change this memory area once retro_load_game has returned. */
 #define RETRO_MEMDESC_BIGENDIAN (1 << 1)   /* The memory area contains big endian data. Default is little endian. */
@@ -1125,6 +1142,9 @@ struct retro_log_callback
 #define RETRO_SIMD_VFPU     (1 << 13)
 #define RETRO_SIMD_PS       (1 << 14)
 #define RETRO_SIMD_AES      (1 << 15)
+#define RETRO_SIMD_FMA      (1 << 16)
+#define RETRO_SIMD_PCLMUL   (1 << 17)
+#define RETRO_SIMD_SHA      (1 << 18)
 
 typedef uint64_t retro_perf_tick_t;
 typedef int64_t retro_time_t;
@@ -1665,6 +1685,29 @@ enum retro_pixel_format
    RETRO_PIXEL_FORMAT_UNKNOWN  = INT_MAX
 };
 
+#define RETRO_MEMORY_ACCESS_WRITE (1 << 0) /* The core will write to the buffer. */
+#define RETRO_MEMORY_ACCESS_READ (1 << 1)  /* The core will read from the buffer. */
+#define RETRO_MEMORY_TYPE_CACHED (1 << 0)  /* The memory is cached, so reading it is not slow. */
+
+struct retro_framebuffer
+{
+   void *data;                   /* The framebuffer which the core can render into.
+                                    Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+   unsigned width;               /* The framebuffer width used by the core. Set by core. */
+   unsigned height;              /* The framebuffer height used by the core. Set by core. */
+   size_t pitch;                 /* The number of bytes between the beginning of a scanline,
+                                    and beginning of the next scanline.
+                                    Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+   enum retro_pixel_format format; /* The pixel format the core must use to render into data.
+                                    Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+
+   unsigned access_flags;        /* How the core will access the memory in the framebuffer.
+                                    RETRO_MEMORY_ACCESS_* flags. Set by core. */
+   unsigned memory_flags;        /* Flags telling core how the memory has been mapped.
+                                    RETRO_MEMORY_TYPE_* flags. 
+                                    Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+};
+
 struct retro_message
 {
    const char *msg;        /* Message to be displayed. */
@@ -27,8 +27,10 @@
 #include "general.h"
 #include "retroarch.h"
 #include "performance.h"
+#include "frame_hash.h"
 #include "input/keyboard_line.h"
 #include "audio/audio_utils.h"
+#include "gfx/video_pacer.h"
 #include "retroarch_logger.h"
 #include "intl/intl.h"
 
@@ -48,16 +50,24 @@
 static void video_frame(const void *data, unsigned width,
       unsigned height, size_t pitch)
 {
+   retro_time_t bench_start;
    const char *msg = NULL;
 
    if (!driver.video_active)
       return;
 
+   bench_start = rarch_benchmark_callback_begin();
+
+   frame_hash_frame(data, width, height, pitch,
+         g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+
    g_extern.frame_cache.data   = data;
    g_extern.frame_cache.width  = width;
    g_extern.frame_cache.height = height;
    g_extern.frame_cache.pitch  = pitch;
 
+   rarch_latency_test_frame(&data, height, pitch);
+
    if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555 &&
          data && data != RETRO_HW_FRAME_BUFFER_VALID)
    {
@@ -82,7 +92,7 @@ static void video_frame(const void *data, unsigned width,
     */
    if (driver.recording_data && (!g_extern.filter.filter
             || !g_settings.video.post_filter_record || !data
-            || g_extern.record_gpu_buffer)
+            || g_extern.record_gpu_buffer || g_extern.record_gpu_mapped)
       )
       rarch_recording_dump_frame(data, width, height, pitch);
 
@@ -115,139 +125,29 @@ static void video_frame(const void *data, unsigned width,
       pitch = opitch;
    }
 
-   if (!driver.video->frame(driver.video_data, data, width, height, pitch, msg))
-      driver.video_active = false;
-}
+   if (g_extern.system.vrr && !driver.nonblock_state)
+      video_pacer_vrr_wait(g_extern.system.av_info.timing.fps);
 
-/*
- * readjust_audio_input_rate:
- *
- * Readjust the audio input rate.
- */
-static void readjust_audio_input_rate(void)
-{
-   int avail = driver.audio->write_avail(driver.audio_data);
+   video_pacer_frame_submit();
 
-   //RARCH_LOG_OUTPUT("Audio buffer is %u%% full\n",
-   //      (unsigned)(100 - (avail * 100) / g_extern.audio_data.driver_buffer_size));
-
-   unsigned write_idx = g_extern.measure_data.buffer_free_samples_count++ &
-      (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
-   int      half_size   = g_extern.audio_data.driver_buffer_size / 2;
-   int      delta_mid   = avail - half_size;
-   double   direction   = (double)delta_mid / half_size;
-   double   adjust      = 1.0 + g_settings.audio.rate_control_delta *
-      direction;
+   if (!driver.video->frame(driver.video_data, data, width, height, pitch, msg))
+      driver.video_active = false;
 
-   g_extern.measure_data.buffer_free_samples[write_idx] = avail;
-   g_extern.audio_data.src_ratio = g_extern.audio_data.orig_src_ratio * adjust;
+   video_pacer_frame_presented();
 
-   //RARCH_LOG_OUTPUT("New rate: %lf, Orig rate: %lf\n",
-   //      g_extern.audio_data.src_ratio, g_extern.audio_data.orig_src_ratio);
+   rarch_benchmark_callback_end(bench_start);
 }
 
-/**
- * audio_flush:
- * @data                 : pointer to audio buffer.
- * @right                : amount of samples to write.
- *
- * Writes audio samples to audio driver. Will first
- * perform DSP processing (if enabled) and resampling.
- *
- * Returns: true (1) if audio samples were written to the audio
- * driver, false (0) in case of an error.
- **/
-static bool audio_flush(const int16_t *data, size_t samples)
+static void write_audio(const int16_t *data, size_t samples)
 {
-   const void *output_data        = NULL;
-   unsigned output_frames         = 0;
-   size_t   output_size           = sizeof(float);
-   struct resampler_data src_data = {0};
-   struct rarch_dsp_data dsp_data = {0};
-
-   if (driver.recording_data)
-   {
-      struct ffemu_audio_data ffemu_data = {0};
-      ffemu_data.data                    = data;
-      ffemu_data.frames                  = samples / 2;
+   retro_time_t bench_start = rarch_benchmark_callback_begin();
 
-      if (driver.recording && driver.recording->push_audio)
-         driver.recording->push_audio(driver.recording_data, &ffemu_data);
-   }
+   driver.audio_active = audio_driver_flush(data, samples)
+      && driver.audio_active;
 
-   if (g_extern.is_paused || g_extern.audio_data.mute)
-      return true;
-   if (!driver.audio_active || !g_extern.audio_data.data)
-      return false;
-
-   RARCH_PERFORMANCE_INIT(audio_convert_s16);
-   RARCH_PERFORMANCE_START(audio_convert_s16);
-   audio_convert_s16_to_float(g_extern.audio_data.data, data, samples,
-         g_extern.audio_data.volume_gain);
-   RARCH_PERFORMANCE_STOP(audio_convert_s16);
-
-   src_data.data_in               = g_extern.audio_data.data;
-   src_data.input_frames          = samples >> 1;
-
-   dsp_data.input                 = g_extern.audio_data.data;
-   dsp_data.input_frames          = samples >> 1;
-
-   if (g_extern.audio_data.dsp)
-   {
-      RARCH_PERFORMANCE_INIT(audio_dsp);
-      RARCH_PERFORMANCE_START(audio_dsp);
-      rarch_dsp_filter_process(g_extern.audio_data.dsp, &dsp_data);
-      RARCH_PERFORMANCE_STOP(audio_dsp);
-
-      if (dsp_data.output)
-      {
-         src_data.data_in      = dsp_data.output;
-         src_data.input_frames = dsp_data.output_frames;
-      }
-   }
-
-   src_data.data_out = g_extern.audio_data.outsamples;
-
-   if (g_extern.audio_data.rate_control)
-      readjust_audio_input_rate();
-
-   src_data.ratio = g_extern.audio_data.src_ratio;
-   if (g_extern.is_slowmotion)
-      src_data.ratio *= g_settings.slowmotion_ratio;
-
-   RARCH_PERFORMANCE_INIT(resampler_proc);
-   RARCH_PERFORMANCE_START(resampler_proc);
-   rarch_resampler_process(driver.resampler,
-         driver.resampler_data, &src_data);
-   RARCH_PERFORMANCE_STOP(resampler_proc);
-
-   output_data   = g_extern.audio_data.outsamples;
-   output_frames = src_data.output_frames;
-
-   if (!g_extern.audio_data.use_float)
-   {
-      RARCH_PERFORMANCE_INIT(audio_convert_float);
-      RARCH_PERFORMANCE_START(audio_convert_float);
-      audio_convert_float_to_s16(g_extern.audio_data.conv_outsamples,
-            (const float*)output_data, output_frames * 2);
-      RARCH_PERFORMANCE_STOP(audio_convert_float);
-
-      output_data = g_extern.audio_data.conv_outsamples;
-      output_size = sizeof(int16_t);
-   }
-
-   if (driver.audio->write(driver.audio_data, output_data,
-            output_frames * output_size * 2) < 0)
-   {
-      RARCH_ERR(RETRO_LOG_AUDIO_WRITE_FAILED);
-      return false;
-   }
-
-   return true;
+   rarch_benchmark_callback_end(bench_start);
 }
 
-#define write_audio(data, samples) (driver.audio_active = audio_flush((data), (samples)) && driver.audio_active)
-
 /**
  * retro_flush_audio:
  * @data                 : pointer to audio buffer.
@@ -340,6 +240,20 @@ static size_t audio_sample_batch_rewind(const int16_t *data, size_t frames)
    return frames;
 }
 
+static void video_frame_runahead(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+}
+
+static void audio_sample_runahead(int16_t left, int16_t right)
+{
+}
+
+static size_t audio_sample_batch_runahead(const int16_t *data, size_t frames)
+{
+   return frames;
+}
+
 /**
  * input_apply_turbo:
  * @port                 : user number
@@ -370,6 +284,50 @@ static bool input_apply_turbo(unsigned port, unsigned id, bool res)
    return res;
 }
 
+/* Set between retro_input_poll_late_begin() and _end(), 
+ * while polls are put off. */
+static bool input_poll_deferred;
+/* A poll was asked for and has not run yet. */
+static bool input_poll_pending;
+
+static void input_poll_driver(void);
+
+/* RetroPad buttons of each port, resolved from the binds 
+ * on the first query after a poll. */
+static uint16_t input_joypad_state[MAX_USERS];
+/* Bit per port, set once input_joypad_state holds it. */
+static uint32_t input_joypad_state_valid;
+
+/**
+ * input_joypad_state_get:
+ * @binds                : binds of all users.
+ * @port                 : user number.
+ *
+ * Resolves every RetroPad button of @port through the input
+ * driver once per poll, so that cores querying buttons one by 
+ * one cost a bit test each rather than going through binds.
+ *
+ * Returns: bitmask of RetroPad buttons held on @port.
+ **/
+static uint16_t input_joypad_state_get(
+      const struct retro_keybind **binds, unsigned port)
+{
+   unsigned i;
+   uint16_t state = 0;
+
+   if (input_joypad_state_valid & (1 << port))
+      return input_joypad_state[port];
+
+   for (i = 0; i < RARCH_FIRST_CUSTOM_BIND; i++)
+      if (driver.input->input_state(driver.input_data, binds, port,
+               RETRO_DEVICE_JOYPAD, 0, i))
+         state |= 1 << i;
+
+   input_joypad_state[port]  = state;
+   input_joypad_state_valid |= 1 << port;
+   return state;
+}
+
 /**
  * input_state:
  * @port                 : user number.
@@ -408,6 +366,12 @@ static int16_t input_state(unsigned port, unsigned device,
 
    device &= RETRO_DEVICE_MASK;
 
+   if (input_poll_pending)
+   {
+      input_poll_pending = false;
+      input_poll_driver();
+   }
+
    if (g_extern.bsv.movie && g_extern.bsv.movie_playback)
    {
       int16_t ret;
@@ -425,7 +389,10 @@ static int16_t input_state(unsigned port, unsigned device,
 
    if (!driver.block_libretro_input)
    {
-      if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+      if (device == RETRO_DEVICE_JOYPAD && id < RARCH_FIRST_CUSTOM_BIND
+            && port < MAX_USERS)
+         res = (input_joypad_state_get(libretro_input_binds, port) >> id) & 1;
+      else if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
          res = driver.input->input_state(driver.input_data, libretro_input_binds, port,
                device, idx, id);
 
@@ -608,17 +575,15 @@ static inline void input_poll_overlay(void)
 }
 #endif
 
-/**
- * input_poll:
- *
- * Input polling callback function.
- **/
-static void input_poll(void)
+static void input_poll_driver(void)
 {
+   retro_time_t bench_start = rarch_benchmark_callback_begin();
+
    driver.input->poll(driver.input_data);
+   input_joypad_state_valid = 0;
 
 #ifdef HAVE_OVERLAY
-   if (driver.overlay)
+   if (driver.overlay && input_overlay_ready(driver.overlay))
       input_poll_overlay();
 #endif
 
@@ -626,6 +591,52 @@ static void input_poll(void)
    if (driver.command)
       rarch_cmd_poll(driver.command);
 #endif
+
+   input_keyboard_event_flush();
+
+   rarch_benchmark_callback_end(bench_start);
+}
+
+/**
+ * input_poll:
+ *
+ * Input polling callback function.
+ **/
+static void input_poll(void)
+{
+   if (input_poll_deferred)
+   {
+      input_poll_pending = true;
+      return;
+   }
+
+   input_poll_driver();
+}
+
+void retro_input_poll_late_begin(void)
+{
+   /* Binds may have changed since the last frame, and not
+    * every core polls before reading input. */
+   input_joypad_state_valid = 0;
+
+   input_poll_pending  = false;
+   input_poll_deferred = g_settings.input.poll_late;
+#ifdef HAVE_NETPLAY
+   /* Netplay sends what it polled right away. */
+   if (driver.netplay_data)
+      input_poll_deferred = false;
+#endif
+}
+
+void retro_input_poll_late_end(void)
+{
+   input_poll_deferred = false;
+
+   if (!input_poll_pending)
+      return;
+
+   input_poll_pending = false;
+   input_poll_driver();
 }
 
 /**
@@ -711,3 +722,25 @@ void retro_set_rewind_callbacks(void)
    }
 }
 
+
+/**
+ * retro_set_runahead_callbacks:
+ * @video          : present video frames.
+ * @audio          : output audio samples.
+ *
+ * Used by run-ahead to hide the output of frames that 
+ * will be rolled back. Passing true for both restores 
+ * the regular callbacks.
+ **/
+void retro_set_runahead_callbacks(bool video, bool audio)
+{
+   pretro_set_video_refresh(video ? video_frame : video_frame_runahead);
+
+   if (audio)
+      retro_set_rewind_callbacks();
+   else
+   {
+      pretro_set_audio_sample(audio_sample_runahead);
+      pretro_set_audio_sample_batch(audio_sample_batch_runahead);
+   }
+}
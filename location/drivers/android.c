@@ -14,8 +14,13 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <rthreads/rthreads.h>
+
 #include "../../driver.h"
 
+/* How often the listener thread asks Java for a new fix. */
+#define ANDROID_LOCATION_POLL_USEC 100000
+
 typedef struct android_location
 {
    jmethodID onLocationInit;
@@ -27,8 +32,78 @@ typedef struct android_location
    jmethodID onLocationGetLatitude;
    jmethodID onLocationGetHorizontalAccuracy;
    jmethodID onLocationHasChanged;
+
+   sthread_t *thread;
+   sevent_t *wake;
+   volatile bool quit;
+   volatile bool started;
+
+   /* Latest fix, written by the listener thread only. seq is odd
+    * while it is being written. */
+   volatile unsigned seq;
+   volatile double latitude;
+   volatile double longitude;
+   volatile double horiz_accuracy;
+
+   /* seq of the fix last handed out by get_position. */
+   unsigned read_seq;
 } androidlocation_t;
 
+static void android_location_poll(androidlocation_t *androidlocation,
+      JNIEnv *env)
+{
+   struct android_app *android_app = (struct android_app*)g_android;
+   jdouble lat, lon, horiz_accu;
+   jboolean newLocation;
+
+   CALL_BOOLEAN_METHOD(env, newLocation, android_app->activity->clazz,
+         androidlocation->onLocationHasChanged);
+
+   if (!newLocation)
+      return;
+
+   CALL_DOUBLE_METHOD(env, lat,        android_app->activity->clazz,
+         androidlocation->onLocationGetLatitude);
+   CALL_DOUBLE_METHOD(env, lon,        android_app->activity->clazz,
+         androidlocation->onLocationGetLongitude);
+   CALL_DOUBLE_METHOD(env, horiz_accu, android_app->activity->clazz,
+         androidlocation->onLocationGetHorizontalAccuracy);
+
+   androidlocation->seq++;
+   __sync_synchronize();
+
+   /* Zero means Java has no value, keep the last one. */
+   if (lat != 0.0)
+      androidlocation->latitude = lat;
+   if (lon != 0.0)
+      androidlocation->longitude = lon;
+   if (horiz_accu != 0.0)
+      androidlocation->horiz_accuracy = horiz_accu;
+
+   __sync_synchronize();
+   androidlocation->seq++;
+}
+
+/* Does the JNI calls for get_position, so the core only
+ * ever reads the cached fix. */
+static void android_location_thread(void *data)
+{
+   androidlocation_t *androidlocation = (androidlocation_t*)data;
+   JNIEnv *env = jni_thread_getenv();
+
+   if (!env)
+      return;
+
+   while (!androidlocation->quit)
+   {
+      if (androidlocation->started)
+         android_location_poll(androidlocation, env);
+
+      sevent_wait_timeout(androidlocation->wake,
+            ANDROID_LOCATION_POLL_USEC);
+   }
+}
+
 static void *android_location_init(void)
 {
    JNIEnv *env;
@@ -96,8 +171,19 @@ static void *android_location_init(void)
    CALL_VOID_METHOD(env, android_app->activity->clazz,
          androidlocation->onLocationInit);
 
+   androidlocation->wake = sevent_new(0);
+   if (!androidlocation->wake)
+      goto dealloc;
+
+   androidlocation->thread = sthread_create(android_location_thread,
+         androidlocation);
+   if (!androidlocation->thread)
+      goto dealloc;
+
    return androidlocation;
 dealloc:
+   if (androidlocation && androidlocation->wake)
+      sevent_free(androidlocation->wake);
    if (androidlocation)
       free(androidlocation);
    return NULL;
@@ -107,12 +193,17 @@ static void android_location_free(void *data)
 {
    struct android_app *android_app = (struct android_app*)g_android;
    androidlocation_t *androidlocation = (androidlocation_t*)data;
-   JNIEnv *env = jni_thread_getenv();
-   if (!env)
-      return;
+   JNIEnv *env;
 
-   CALL_VOID_METHOD(env, android_app->activity->clazz,
-         androidlocation->onLocationFree);
+   androidlocation->quit = true;
+   sevent_signal(androidlocation->wake);
+   sthread_join(androidlocation->thread);
+   sevent_free(androidlocation->wake);
+
+   env = jni_thread_getenv();
+   if (env)
+      CALL_VOID_METHOD(env, android_app->activity->clazz,
+            androidlocation->onLocationFree);
 
    free(androidlocation);
 }
@@ -128,6 +219,9 @@ static bool android_location_start(void *data)
    CALL_VOID_METHOD(env, android_app->activity->clazz,
          androidlocation->onLocationStart);
 
+   androidlocation->started = true;
+   sevent_signal(androidlocation->wake);
+
    return true;
 }
 
@@ -135,7 +229,11 @@ static void android_location_stop(void *data)
 {
    struct android_app *android_app = (struct android_app*)g_android;
    androidlocation_t *androidlocation = (androidlocation_t*)data;
-   JNIEnv *env = jni_thread_getenv();
+   JNIEnv *env;
+
+   androidlocation->started = false;
+
+   env = jni_thread_getenv();
    if (!env)
       return;
 
@@ -147,34 +245,31 @@ static bool android_location_get_position(void *data, double *latitude,
       double *longitude, double *horiz_accuracy,
       double *vert_accuracy)
 {
-   struct android_app *android_app = (struct android_app*)g_android;
    androidlocation_t *androidlocation = (androidlocation_t*)data;
-   JNIEnv *env = jni_thread_getenv();
-   if (!env)
-      goto fail;
+   unsigned seq;
+   double lat, lon, horiz_accu;
 
-   jdouble lat, lon, horiz_accu;
-   jboolean newLocation;
+   do
+   {
+      seq = androidlocation->seq;
+      __sync_synchronize();
 
-   CALL_BOOLEAN_METHOD(env, newLocation, android_app->activity->clazz,
-         androidlocation->onLocationHasChanged);
+      /* No fix since the last call. */
+      if ((seq & 1) || seq == androidlocation->read_seq)
+         goto fail;
 
-   if (!newLocation)
-      goto fail;
+      lat        = androidlocation->latitude;
+      lon        = androidlocation->longitude;
+      horiz_accu = androidlocation->horiz_accuracy;
 
-   CALL_DOUBLE_METHOD(env, lat,        android_app->activity->clazz,
-         androidlocation->onLocationGetLatitude);
-   CALL_DOUBLE_METHOD(env, lon,        android_app->activity->clazz,
-         androidlocation->onLocationGetLongitude);
-   CALL_DOUBLE_METHOD(env, horiz_accu, android_app->activity->clazz,
-         androidlocation->onLocationGetHorizontalAccuracy);
+      __sync_synchronize();
+   } while (seq != androidlocation->seq);
 
-   if (lat != 0.0)
-      *latitude = lat;
-   if (lon != 0.0)
-      *longitude = lon;
-   if (horiz_accu != 0.0)
-      *horiz_accuracy = horiz_accu;
+   androidlocation->read_seq = seq;
+
+   *latitude       = lat;
+   *longitude      = lon;
+   *horiz_accuracy = horiz_accu;
 
    /* TODO/FIXME - custom implement vertical accuracy since 
     * Android location API does not have it? */
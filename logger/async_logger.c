@@ -0,0 +1,262 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rthreads/rthreads.h>
+#include <compat/strl.h>
+
+#include "async_logger.h"
+#include "../performance.h"
+
+#define LOG_ASYNC_SLOTS 128
+#define LOG_ASYNC_LINE_MAX 1024
+
+/* How long a line can keep repeating before the count is
+ * written out anyway. */
+#define LOG_ASYNC_REPEAT_USEC 1000000
+
+/* A slot is free to log into while seq equals the position
+ * it is at, and holds a line once seq is one past it. */
+struct log_async_slot
+{
+   unsigned seq;
+   FILE *file;
+   char line[LOG_ASYNC_LINE_MAX];
+};
+
+/* Static, so a thread still logging while the writer stops
+ * never writes into freed memory. */
+static struct log_async_slot log_slots[LOG_ASYNC_SLOTS];
+static unsigned log_post_pos;
+static unsigned log_take_pos;
+static unsigned log_dropped;
+
+static volatile bool log_running;
+static volatile bool log_quit;
+static sthread_t *log_thread;
+/* Never freed, a thread may still be signalling it. */
+static sevent_t *log_wake;
+
+/* Writer thread only. */
+static char log_last[LOG_ASYNC_LINE_MAX];
+static FILE *log_last_file;
+static unsigned log_repeats;
+static retro_time_t log_repeat_start;
+
+static void log_async_flush_repeats(void)
+{
+   if (log_repeats)
+      fprintf(log_last_file, "Last message repeated %u times.\n",
+            log_repeats);
+   log_repeats = 0;
+}
+
+static void log_async_write(FILE *file, const char *line)
+{
+   if (file == log_last_file && !strcmp(line, log_last))
+   {
+      if (!log_repeats++)
+         log_repeat_start = rarch_get_time_usec();
+      else if (rarch_get_time_usec() - log_repeat_start
+            >= LOG_ASYNC_REPEAT_USEC)
+         log_async_flush_repeats();
+      return;
+   }
+
+   log_async_flush_repeats();
+   fputs(line, file);
+   strlcpy(log_last, line, sizeof(log_last));
+   log_last_file = file;
+}
+
+/* Writes out what was logged. Only one thread at a time. */
+static void log_async_drain(void)
+{
+   unsigned dropped;
+
+   for (;;)
+   {
+      struct log_async_slot *slot =
+         &log_slots[log_take_pos % LOG_ASYNC_SLOTS];
+
+      if (slot->seq != log_take_pos + 1)
+         break;
+      __sync_synchronize();
+
+      log_async_write(slot->file, slot->line);
+
+      __sync_synchronize();
+      slot->seq = log_take_pos + LOG_ASYNC_SLOTS;
+      log_take_pos++;
+   }
+
+   dropped = __sync_lock_test_and_set(&log_dropped, 0);
+   if (dropped && log_last_file)
+   {
+      log_async_flush_repeats();
+      fprintf(log_last_file, "[Log]: %u lines dropped.\n", dropped);
+   }
+
+   if (log_last_file)
+      fflush(log_last_file);
+}
+
+static void log_async_thread(void *data)
+{
+   (void)data;
+
+   for (;;)
+   {
+      bool quit = log_quit;
+
+      log_async_drain();
+
+      if (quit)
+         break;
+
+      /* Idle, nothing left to hold the count back for. */
+      if (!sevent_wait_timeout(log_wake, LOG_ASYNC_REPEAT_USEC))
+      {
+         log_async_flush_repeats();
+         if (log_last_file)
+            fflush(log_last_file);
+      }
+   }
+
+   log_async_flush_repeats();
+}
+
+bool rarch_log_async_init(void)
+{
+   static bool registered;
+   unsigned i;
+
+   if (log_running)
+      return true;
+
+   for (i = 0; i < LOG_ASYNC_SLOTS; i++)
+      log_slots[i].seq = log_take_pos + i;
+   log_post_pos = log_take_pos;
+
+   log_quit = false;
+   if (!log_wake && !(log_wake = sevent_new(0)))
+      return false;
+
+   if (!(log_thread = sthread_create(log_async_thread, NULL)))
+      return false;
+
+   /* Paths which exit() early still get their lines out. */
+   if (!registered)
+      atexit(rarch_log_async_deinit);
+   registered = true;
+
+   __sync_synchronize();
+   log_running = true;
+   return true;
+}
+
+void rarch_log_async_deinit(void)
+{
+   if (!log_running)
+      return;
+
+   log_running = false;
+   __sync_synchronize();
+
+   log_quit = true;
+   sevent_signal(log_wake);
+   sthread_join(log_thread);
+   log_thread = NULL;
+
+   /* Lines which got a slot as the writer stopped. */
+   log_async_drain();
+   log_async_flush_repeats();
+   log_last_file = NULL;
+   *log_last     = '\0';
+}
+
+static void log_async_sync(FILE *file, const char *head, const char *func,
+      const char *sep, const char *tag, const char *fmt, va_list ap)
+{
+   fprintf(file, "%s%s%s", head, func, sep);
+   if (tag)
+      fputs(tag, file);
+   vfprintf(file, fmt, ap);
+   fflush(file);
+}
+
+void rarch_log_async_v(FILE *file, const char *head, const char *func,
+      const char *sep, const char *tag, const char *fmt, va_list ap)
+{
+   int len;
+   unsigned pos;
+   struct log_async_slot *slot = NULL;
+
+   if (!log_running)
+   {
+      log_async_sync(file, head, func, sep, tag, fmt, ap);
+      return;
+   }
+
+   pos = log_post_pos;
+
+   for (;;)
+   {
+      int diff;
+
+      slot = &log_slots[pos % LOG_ASYNC_SLOTS];
+      diff = (int)(slot->seq - pos);
+      __sync_synchronize();
+
+      /* The writer is behind, rather drop the line than wait. */
+      if (diff < 0)
+      {
+         __sync_fetch_and_add(&log_dropped, 1);
+         return;
+      }
+
+      if (diff == 0 && __sync_bool_compare_and_swap(&log_post_pos,
+               pos, pos + 1))
+         break;
+
+      pos = log_post_pos;
+   }
+
+   len = snprintf(slot->line, sizeof(slot->line), "%s%s%s%s",
+         head, func, sep, tag ? tag : "");
+   if (len < 0 || len >= (int)sizeof(slot->line))
+      len = 0;
+   if (vsnprintf(slot->line + len, sizeof(slot->line) - len, fmt, ap)
+         >= (int)(sizeof(slot->line) - len))
+      slot->line[sizeof(slot->line) - 2] = '\n';
+   slot->file = file;
+
+   __sync_synchronize();
+   slot->seq = pos + 1;
+
+   sevent_signal(log_wake);
+}
+
+void rarch_log_async(FILE *file, const char *head, const char *func,
+      const char *sep, const char *tag, const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   rarch_log_async_v(file, head, func, sep, tag, fmt, ap);
+   va_end(ap);
+}
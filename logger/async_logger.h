@@ -0,0 +1,102 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_ASYNC_LOGGER_H
+#define __RARCH_ASYNC_LOGGER_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * rarch_log_async_init:
+ *
+ * Starts a thread which writes out the log from then on, so
+ * logging only formats the line into a ring buffer. Repeats
+ * of a line are written as a count.
+ *
+ * Returns: true (1) if the thread runs, otherwise false (0)
+ * and logging stays synchronous.
+ **/
+bool rarch_log_async_init(void);
+
+/**
+ * rarch_log_async_deinit:
+ *
+ * Writes out what is left and stops the thread. Logging is
+ * synchronous again afterwards.
+ **/
+void rarch_log_async_deinit(void);
+
+/**
+ * rarch_log_async_v:
+ * @file                 : file to write the line to.
+ * @head                 : written first, e.g. "RetroArch: ".
+ * @func                 : function which logs.
+ * @sep                  : written after @func.
+ * @tag                  : written before the message, or NULL.
+ * @fmt                  : message format.
+ * @ap                   : message arguments.
+ *
+ * Logs a line, from any thread. Lines are dropped, and
+ * counted, while the ring buffer is full.
+ **/
+void rarch_log_async_v(FILE *file, const char *head, const char *func,
+      const char *sep, const char *tag, const char *fmt, va_list ap);
+
+void rarch_log_async(FILE *file, const char *head, const char *func,
+      const char *sep, const char *tag, const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define RARCH_LOG(...) do { \
+      if (RARCH_LOG_VERBOSE) \
+         rarch_log_async(LOG_FILE, PROGRAM_NAME ": ", __FUNCTION__, \
+               ": ", NULL, __VA_ARGS__); \
+   } while (0)
+#define RARCH_LOG_V(tag, fmt, vp) do { \
+      if (RARCH_LOG_VERBOSE) \
+         rarch_log_async_v(LOG_FILE, PROGRAM_NAME ": ", __FUNCTION__, \
+               ": ", tag, fmt, vp); \
+   } while (0)
+
+#define RARCH_LOG_OUTPUT(...) \
+   rarch_log_async(LOG_FILE, "", __FUNCTION__, ": ", NULL, __VA_ARGS__)
+#define RARCH_LOG_OUTPUT_V(tag, fmt, vp) \
+   rarch_log_async_v(LOG_FILE, PROGRAM_NAME ": ", __FUNCTION__, ": ", \
+         tag, fmt, vp)
+
+#define RARCH_ERR(...) \
+   rarch_log_async(LOG_FILE, PROGRAM_NAME " [ERROR] :: ", __FUNCTION__, \
+         " :: ", NULL, __VA_ARGS__)
+#define RARCH_ERR_V(tag, fmt, vp) \
+   rarch_log_async_v(LOG_FILE, PROGRAM_NAME " [ERROR] :: ", __FUNCTION__, \
+         " :: ", tag, fmt, vp)
+
+#define RARCH_WARN(...) \
+   rarch_log_async(LOG_FILE, PROGRAM_NAME " [WARN] :: ", __FUNCTION__, \
+         " :: ", NULL, __VA_ARGS__)
+#define RARCH_WARN_V(tag, fmt, vp) \
+   rarch_log_async_v(LOG_FILE, PROGRAM_NAME " [WARN] :: ", __FUNCTION__, \
+         " :: ", tag, fmt, vp)
+
+#endif
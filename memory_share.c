@@ -0,0 +1,198 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Publishes core RAM to a POSIX shared memory object. See
+ * memory_share.h for the layout. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include "memory_share.h"
+#include "general.h"
+#include "dynamic.h"
+#include "libretro.h"
+
+/* Keeps every region on its own cache lines. */
+#define MEMSHARE_ALIGN(x) (((x) + 63) & ~(uint64_t)63)
+
+static const unsigned memshare_ids[RARCH_MEMSHARE_MAX_REGIONS] = {
+   RETRO_MEMORY_SYSTEM_RAM,
+   RETRO_MEMORY_SAVE_RAM,
+   RETRO_MEMORY_VIDEO_RAM,
+   RETRO_MEMORY_RTC,
+};
+
+static struct
+{
+   int fd;
+   char name[PATH_MAX_LENGTH];
+   uint8_t *map;
+   size_t size;
+   struct rarch_memshare_header *header;
+} memshare = { -1 };
+
+void memory_share_init(void)
+{
+   unsigned i, num_regions = 0;
+   uint64_t offset;
+   struct rarch_memshare_header *header = NULL;
+
+   memory_share_deinit();
+
+   if (!*g_settings.memory_share_name)
+      return;
+
+   if (strchr(g_settings.memory_share_name, '/'))
+   {
+      RARCH_ERR("[MemShare]: Invalid shared memory name \"%s\".\n",
+            g_settings.memory_share_name);
+      return;
+   }
+
+   snprintf(memshare.name, sizeof(memshare.name), "/%s",
+         g_settings.memory_share_name);
+
+   offset = MEMSHARE_ALIGN(sizeof(*header));
+   for (i = 0; i < RARCH_MEMSHARE_MAX_REGIONS; i++)
+   {
+      size_t size = pretro_get_memory_size(memshare_ids[i]);
+
+      if (size && pretro_get_memory_data(memshare_ids[i]))
+         offset += MEMSHARE_ALIGN(size);
+   }
+   memshare.size = offset;
+
+   /* Others may read, only we write. */
+   memshare.fd = shm_open(memshare.name, O_CREAT | O_RDWR, 0644);
+   if (memshare.fd < 0)
+   {
+      RARCH_ERR("[MemShare]: Failed to open shared memory \"%s\".\n",
+            memshare.name);
+      return;
+   }
+
+   /* Shrinking first zeroes whatever a previous run left behind. */
+   if (ftruncate(memshare.fd, 0) < 0
+         || ftruncate(memshare.fd, memshare.size) < 0)
+      goto error;
+
+   memshare.map = (uint8_t*)mmap(NULL, memshare.size,
+         PROT_READ | PROT_WRITE, MAP_SHARED, memshare.fd, 0);
+   if (memshare.map == MAP_FAILED)
+   {
+      memshare.map = NULL;
+      goto error;
+   }
+
+   header          = (struct rarch_memshare_header*)memshare.map;
+   memshare.header = header;
+
+   header->version     = RARCH_MEMSHARE_VERSION;
+   header->content_crc = g_extern.content_crc;
+   if (g_extern.system.info.library_name)
+      strlcpy(header->library_name, g_extern.system.info.library_name,
+            sizeof(header->library_name));
+
+   offset = MEMSHARE_ALIGN(sizeof(*header));
+   for (i = 0; i < RARCH_MEMSHARE_MAX_REGIONS; i++)
+   {
+      struct rarch_memshare_region *region =
+         &header->regions[num_regions];
+      size_t size = pretro_get_memory_size(memshare_ids[i]);
+
+      if (!size || !pretro_get_memory_data(memshare_ids[i]))
+         continue;
+
+      region->id     = memshare_ids[i];
+      region->offset = offset;
+      region->size   = size;
+      offset        += MEMSHARE_ALIGN(size);
+      num_regions++;
+   }
+   header->num_regions = num_regions;
+
+   /* Readers go by the magic, so it is the last thing set. */
+   __sync_synchronize();
+   header->magic = RARCH_MEMSHARE_MAGIC;
+
+   RARCH_LOG("[MemShare]: Publishing %u memory regions to shared memory "
+         "\"%s\" (%u bytes).\n",
+         num_regions, memshare.name, (unsigned)memshare.size);
+   return;
+
+error:
+   RARCH_ERR("[MemShare]: Failed to set up shared memory \"%s\".\n",
+         memshare.name);
+   memory_share_deinit();
+}
+
+void memory_share_update(void)
+{
+   unsigned i;
+   struct rarch_memshare_header *header = memshare.header;
+
+   if (!header)
+      return;
+
+   header->seq++;
+   __sync_synchronize();
+
+   for (i = 0; i < header->num_regions; i++)
+   {
+      const struct rarch_memshare_region *region = &header->regions[i];
+      /* Cores may move their buffers around, so
+       * it is looked up again every frame. */
+      const void *data = pretro_get_memory_data(region->id);
+      size_t size      = pretro_get_memory_size(region->id);
+
+      if (data)
+         memcpy(memshare.map + region->offset, data,
+               size < region->size ? size : region->size);
+   }
+
+   header->frame_count++;
+   __sync_synchronize();
+   header->seq++;
+}
+
+void memory_share_deinit(void)
+{
+   if (memshare.map)
+   {
+      __sync_synchronize();
+      memshare.header->closed = 1;
+      munmap(memshare.map, memshare.size);
+   }
+
+   /* Tools which already mapped it keep their mapping. */
+   if (memshare.fd >= 0)
+   {
+      close(memshare.fd);
+      shm_unlink(memshare.name);
+   }
+
+   memshare.fd     = -1;
+   memshare.map    = NULL;
+   memshare.header = NULL;
+   memshare.size   = 0;
+}
@@ -0,0 +1,104 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_MEMORY_SHARE_H
+#define __RARCH_MEMORY_SHARE_H
+
+/* Layout of the shared memory core RAM is published to, for
+ * external tools (score trackers, achievements) to sample without
+ * going through the command interface. Setting memory_share_name
+ * to <name> creates the POSIX shared memory object "/<name>",
+ * laid out as:
+ *
+ *    struct rarch_memshare_header
+ *    num_regions times, at regions[i].offset:
+ *       regions[i].size bytes of the core's memory region
+ *       regions[i].id (RETRO_MEMORY_*)
+ *
+ * Every frame the core ran, all regions are copied behind a
+ * seqlock: seq is odd while they are being written. Readers take
+ * seq, copy what they need, then check seq is unchanged and even.
+ * frame_count tells how many frames the core ran so far, so a
+ * reader sampling at frame rate notices skipped frames.
+ *
+ * Tools should map it read-only. All fields are native endian. */
+
+#include <stdint.h>
+
+#define RARCH_MEMSHARE_MAGIC       0x524d5331 /* "RMS1" */
+#define RARCH_MEMSHARE_VERSION     1
+#define RARCH_MEMSHARE_MAX_REGIONS 4
+
+struct rarch_memshare_region
+{
+   uint32_t id;
+   uint32_t reserved;
+   uint64_t offset;
+   uint64_t size;
+};
+
+struct rarch_memshare_header
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Set once the core is unloaded, nothing more gets written. */
+   volatile uint32_t closed;
+   uint32_t num_regions;
+
+   /* To tell which game the RAM belongs to. */
+   char library_name[64];
+   uint32_t content_crc;
+
+   volatile uint32_t seq;
+   volatile uint64_t frame_count;
+
+   struct rarch_memshare_region regions[RARCH_MEMSHARE_MAX_REGIONS];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * memory_share_init:
+ *
+ * Publishes the memory regions of the loaded core, if
+ * g_settings.memory_share_name is set. Must be called after
+ * the content was loaded.
+ **/
+void memory_share_init(void);
+
+/**
+ * memory_share_update:
+ *
+ * Copies the memory regions to the shared memory. Called once
+ * per frame the core ran.
+ **/
+void memory_share_update(void);
+
+/**
+ * memory_share_deinit:
+ *
+ * Marks the shared memory closed and removes it. Must be called
+ * before the core is unloaded.
+ **/
+void memory_share_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -314,6 +314,10 @@ static void glui_frame(void)
 
    glui_render_background(false);
 
+   /* All lines are drawn at once, before the message boxes. */
+   if (gl->font_driver && gl->font_driver->begin_batch)
+      gl->font_driver->begin_batch(gl->font_handle);
+
    menu_list_get_last_stack(driver.menu->menu_list, &dir, &label, &menu_type);
 
    get_title(label, dir, menu_type, title, sizeof(title));
@@ -382,6 +386,9 @@ static void glui_frame(void)
          y, type_str_buf, selected);
    }
 
+   if (gl->font_driver && gl->font_driver->flush)
+      gl->font_driver->flush(gl->font_handle);
+
 #ifdef GEKKO
    const char *message_queue;
 
@@ -23,6 +23,7 @@
 
 #include "../menu.h"
 #include "../../retroarch.h"
+#include "../../performance.h"
 #include <compat/posix_string.h>
 #include <file/file_path.h>
 
@@ -30,18 +31,51 @@
 
 #include "shared.h"
 
+/* More than RGUI_TERM_HEIGHT can ever be. */
+#define RGUI_MAX_ROWS 32
+#define RGUI_LINE_LEN 256
+
+typedef struct rgui_line
+{
+   char text[RGUI_LINE_LEN];
+   bool green;
+   bool drawn;
+} rgui_line_t;
+
 typedef struct rgui_handle
 {
    unsigned term_height;
    uint16_t *frame_buf;
    size_t frame_buf_pitch;
+
+   /* What frame_buf shows, so that only lines which changed
+    * get drawn again. Title, status, then the entries. */
+   rgui_line_t lines[RGUI_MAX_ROWS + 2];
+   int16_t cursor_x;
+   int16_t cursor_y;
+   bool cursor_drawn;
+   /* Something was drawn over the lines, such as a message box. */
+   bool full_redraw;
+
+   /* frame_buf changed since it was last handed to the video
+    * driver. Unchanged frames are not uploaded again. */
+   bool frame_dirty;
 } rgui_handle_t;
 
+enum
+{
+   RGUI_LINE_TITLE = 0,
+   RGUI_LINE_STATUS,
+   RGUI_LINE_ENTRIES
+};
+
 #define RGUI_TERM_START_X (driver.menu->width / 21)
 #define RGUI_TERM_START_Y (driver.menu->height / 9)
 #define RGUI_TERM_WIDTH (((driver.menu->width - RGUI_TERM_START_X - RGUI_TERM_START_X) / (FONT_WIDTH_STRIDE)))
 #define RGUI_TERM_HEIGHT (((driver.menu->height - RGUI_TERM_START_Y - RGUI_TERM_START_X) / (FONT_HEIGHT_STRIDE)) - 1)
 
+#define RGUI_FRAME_BUF_SIZE (400 * 240 * sizeof(uint16_t))
+
 static void rgui_copy_glyph(uint8_t *glyph, const uint8_t *buf)
 {
    int y, x;
@@ -209,29 +243,72 @@ static bool rguidisp_init_font(void *data)
    return true;
 }
 
-static void rgui_render_background(void *data)
+/* fill_rect, limited to the rows from @clip_y to @clip_y + @clip_height. */
+static void fill_rect_rows(uint16_t *buf, unsigned pitch,
+      unsigned x, unsigned y,
+      unsigned width, unsigned height,
+      unsigned clip_y, unsigned clip_height,
+      uint16_t (*col)(unsigned x, unsigned y))
 {
-   rgui_handle_t *rgui = (rgui_handle_t*)data;
+   unsigned top    = max(y, clip_y);
+   unsigned bottom = min(y + height, clip_y + clip_height);
 
+   if (top < bottom)
+      fill_rect(buf, pitch, x, top, width, bottom - top, col);
+}
+
+/**
+ * rgui_render_background:
+ * @rgui                    : RGUI handle.
+ * @y                       : first row to draw.
+ * @height                  : number of rows to draw.
+ *
+ * Draws the background over the given rows of the frame,
+ * wiping whatever was drawn there.
+ **/
+static void rgui_render_background(rgui_handle_t *rgui,
+      unsigned y, unsigned height)
+{
    if (!rgui)
       return;
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         0, 0, driver.menu->width, driver.menu->height, gray_filler);
+   fill_rect_rows(rgui->frame_buf, rgui->frame_buf_pitch,
+         0, 0, driver.menu->width, driver.menu->height,
+         y, height, gray_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         5, 5, driver.menu->width - 10, 5, green_filler);
+   fill_rect_rows(rgui->frame_buf, rgui->frame_buf_pitch,
+         5, 5, driver.menu->width - 10, 5,
+         y, height, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
+   fill_rect_rows(rgui->frame_buf, rgui->frame_buf_pitch,
          5, driver.menu->height - 10, driver.menu->width - 10, 5,
-         green_filler);
+         y, height, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         5, 5, 5, driver.menu->height - 10, green_filler);
+   fill_rect_rows(rgui->frame_buf, rgui->frame_buf_pitch,
+         5, 5, 5, driver.menu->height - 10,
+         y, height, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
+   fill_rect_rows(rgui->frame_buf, rgui->frame_buf_pitch,
          driver.menu->width - 10, 5, 5, driver.menu->height - 10,
-         green_filler);
+         y, height, green_filler);
+
+   rgui->frame_dirty = true;
+}
+
+static bool rgui_line_equal(const rgui_line_t *a, const rgui_line_t *b)
+{
+   if (a->drawn != b->drawn)
+      return false;
+   if (!a->drawn)
+      return true;
+   return a->green == b->green && !strcmp(a->text, b->text);
+}
+
+static void rgui_line_set(rgui_line_t *line, const char *text, bool green)
+{
+   strlcpy(line->text, text, sizeof(line->text));
+   line->green = green;
+   line->drawn = true;
 }
 
 static void rgui_render_messagebox(const char *message)
@@ -308,6 +385,10 @@ static void rgui_render_messagebox(const char *message)
       blit_line(x + 8 + offset_x, y + 8 + offset_y, msg, false);
    }
 
+   /* Wiping it means drawing everything under it again. */
+   rgui->full_redraw = true;
+   rgui->frame_dirty = true;
+
    string_list_free(list);
 }
 
@@ -324,13 +405,20 @@ static void rgui_blit_cursor(void* data)
          x, y-5, 1, 11, 0xFFFF);
    color_rect(rgui->frame_buf, rgui->frame_buf_pitch,
          x-5, y, 11, 1, 0xFFFF);
+
+   rgui->cursor_x     = x;
+   rgui->cursor_y     = y;
+   rgui->cursor_drawn = true;
+   rgui->frame_dirty  = true;
 }
 
 static void rgui_render(void)
 {
    size_t i, end;
    char title[256], title_buf[256], title_msg[64];
+   rgui_line_t lines[RGUI_MAX_ROWS + 2];
    unsigned x, y, menu_type  = 0;
+   bool full_redraw;
    const char *dir     = NULL;
    const char *label   = NULL;
    rgui_handle_t *rgui = NULL;
@@ -364,8 +452,9 @@ static void rgui_render(void)
          menu_list_get_size(driver.menu->menu_list)) ?
       driver.menu->begin + RGUI_TERM_HEIGHT :
       menu_list_get_size(driver.menu->menu_list);
+   end = min(end, driver.menu->begin + RGUI_MAX_ROWS);
 
-   rgui_render_background(rgui);
+   memset(lines, 0, sizeof(lines));
 
    menu_list_get_last_stack(driver.menu->menu_list,
          &dir, &label, &menu_type);
@@ -378,7 +467,7 @@ static void rgui_render(void)
 
    menu_ticker_line(title_buf, RGUI_TERM_WIDTH - 3,
          g_extern.frame_count / RGUI_TERM_START_X, title, true);
-   blit_line(RGUI_TERM_START_X + RGUI_TERM_START_X, RGUI_TERM_START_X, title_buf, true);
+   rgui_line_set(&lines[RGUI_LINE_TITLE], title_buf, true);
 
    core_name = g_extern.menu.info.library_name;
    if (!core_name)
@@ -394,16 +483,9 @@ static void rgui_render(void)
 
    snprintf(title_msg, sizeof(title_msg), "%s - %s %s", PACKAGE_VERSION,
          core_name, core_version);
-   blit_line(
-         RGUI_TERM_START_X + RGUI_TERM_START_X,
-         (RGUI_TERM_HEIGHT * FONT_HEIGHT_STRIDE) +
-         RGUI_TERM_START_Y + 2, title_msg, true);
+   rgui_line_set(&lines[RGUI_LINE_STATUS], title_msg, true);
 
-
-   x = RGUI_TERM_START_X;
-   y = RGUI_TERM_START_Y;
-
-   for (i = driver.menu->begin; i < end; i++, y += FONT_HEIGHT_STRIDE)
+   for (i = driver.menu->begin; i < end; i++)
    {
       char message[PATH_MAX_LENGTH], type_str[PATH_MAX_LENGTH],
            entry_title_buf[PATH_MAX_LENGTH], type_str_buf[PATH_MAX_LENGTH],
@@ -439,7 +521,54 @@ static void rgui_render(void)
             w,
             type_str_buf);
 
-      blit_line(x, y, message, selected);
+      rgui_line_set(&lines[RGUI_LINE_ENTRIES + i - driver.menu->begin],
+            message, selected);
+   }
+
+   /* A cursor which moved or has lines change under it
+    * has to be wiped, and with it everything it covers. */
+   full_redraw = rgui->full_redraw ||
+      rgui->cursor_drawn != driver.menu->mouse.enable ||
+      (rgui->cursor_drawn && (rgui->cursor_x != driver.menu->mouse.x ||
+                              rgui->cursor_y != driver.menu->mouse.y));
+
+   for (i = 0; i < RGUI_MAX_ROWS + 2 && !full_redraw; i++)
+      if (rgui->cursor_drawn && !rgui_line_equal(&lines[i], &rgui->lines[i]))
+         full_redraw = true;
+
+   rgui->full_redraw  = false;
+   rgui->cursor_drawn = false;
+
+   if (full_redraw)
+      rgui_render_background(rgui, 0, driver.menu->height);
+
+   for (i = 0; i < RGUI_MAX_ROWS + 2; i++)
+   {
+      if (!full_redraw && rgui_line_equal(&lines[i], &rgui->lines[i]))
+         continue;
+
+      if (i == RGUI_LINE_TITLE)
+      {
+         x = RGUI_TERM_START_X + RGUI_TERM_START_X;
+         y = RGUI_TERM_START_X;
+      }
+      else if (i == RGUI_LINE_STATUS)
+      {
+         x = RGUI_TERM_START_X + RGUI_TERM_START_X;
+         y = (RGUI_TERM_HEIGHT * FONT_HEIGHT_STRIDE) + RGUI_TERM_START_Y + 2;
+      }
+      else
+      {
+         x = RGUI_TERM_START_X;
+         y = RGUI_TERM_START_Y + (i - RGUI_LINE_ENTRIES) * FONT_HEIGHT_STRIDE;
+      }
+
+      if (!full_redraw)
+         rgui_render_background(rgui, y, FONT_HEIGHT_STRIDE);
+      if (lines[i].drawn)
+         blit_line(x, y, lines[i].text, lines[i].green);
+
+      rgui->lines[i] = lines[i];
    }
 
 #ifdef GEKKO
@@ -466,8 +595,10 @@ static void rgui_render(void)
       rgui_render_messagebox(msg);
    }
 
-   if (driver.menu->mouse.enable)
+   if (driver.menu->mouse.enable && full_redraw)
       rgui_blit_cursor(rgui);
+   else if (driver.menu->mouse.enable)
+      rgui->cursor_drawn = true;
 }
 
 static void *rgui_init(void)
@@ -489,7 +620,7 @@ static void *rgui_init(void)
 
    rgui = (rgui_handle_t*)menu->userdata;
 
-   rgui->frame_buf = (uint16_t*)malloc(400 * 240 * sizeof(uint16_t)); 
+   rgui->frame_buf = (uint16_t*)malloc(RGUI_FRAME_BUF_SIZE);
 
    if (!rgui->frame_buf)
    {
@@ -502,6 +633,7 @@ static void *rgui_init(void)
    menu->height = 240;
    menu->begin = 0;
    rgui->frame_buf_pitch = menu->width * sizeof(uint16_t);
+   rgui->full_redraw     = true;
 
    ret = rguidisp_init_font(menu);
 
@@ -516,6 +648,8 @@ static void *rgui_init(void)
       return NULL;
    }
 
+   rarch_mem_add(RARCH_MEM_MENU, RGUI_FRAME_BUF_SIZE);
+
    return menu;
 }
 
@@ -533,7 +667,10 @@ static void rgui_free(void *data)
       return;
 
    if (rgui->frame_buf)
+   {
       free(rgui->frame_buf);
+      rarch_mem_sub(RARCH_MEM_MENU, RGUI_FRAME_BUF_SIZE);
+   }
 
    if (menu->userdata)
       free(menu->userdata);
@@ -548,10 +685,27 @@ static void rgui_set_texture(void *data)
    menu_handle_t *menu = (menu_handle_t*)data;
    rgui_handle_t *rgui = (rgui_handle_t*)menu->userdata;
 
+   /* The video driver keeps what it got last time. */
+   if (!rgui->frame_dirty)
+      return;
+
    if (driver.video_data && driver.video_poke &&
          driver.video_poke->set_texture_frame)
+   {
       driver.video_poke->set_texture_frame(driver.video_data,
             rgui->frame_buf, false, menu->width, menu->height, 1.0f);
+      rgui->frame_dirty = false;
+   }
+}
+
+static void rgui_context_reset(void *data)
+{
+   menu_handle_t *menu = (menu_handle_t*)data;
+   rgui_handle_t *rgui = menu ? (rgui_handle_t*)menu->userdata : NULL;
+
+   /* A new video driver has no menu texture yet. */
+   if (rgui)
+      rgui->frame_dirty = true;
 }
 
 static void rgui_navigation_clear(void *data, bool pending_push)
@@ -623,7 +777,7 @@ menu_ctx_driver_t menu_ctx_rgui = {
    rgui_init,
    NULL,
    rgui_free,
-   NULL,
+   rgui_context_reset,
    NULL,
    rgui_populate_entries,
    NULL,
@@ -19,15 +19,25 @@
 #include <stdint.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
 
 #include "../menu.h"
 #include <file/file_path.h>
 #include "../../gfx/gl_common.h"
 #include "../../gfx/video_thread_wrapper.h"
 #include <compat/posix_string.h>
+#include <compat/strl.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/rthreadpool.h>
+#include "../../retroarch.h"
+#endif
 
 #include "shared.h"
 #include "../menu_animation.h"
+#include "../../performance.h"
 
 #ifndef XMB_THEME
 #define XMB_THEME "monochrome"
@@ -37,6 +47,28 @@
 #define XMB_DELAY 0.02
 #endif
 
+/* Icons are packed into shared atlas pages, so that
+ * draw_icon() can batch them into a few draw calls. */
+#define XMB_ATLAS_SIZE     2048
+#define XMB_ATLAS_PAGES    4
+#define XMB_ATLAS_SHELVES  32
+#define XMB_ATLAS_CELL_MIN 16
+
+/* Sprites per draw call. */
+#define XMB_BATCH_SPRITES  128
+
+/* Image in an atlas page or in a texture of its own. */
+typedef struct xmb_sprite
+{
+   /* 0 until the image is uploaded. */
+   GLuint tex;
+   /* Left, top, right and bottom texture coordinates. */
+   GLfloat coord[4];
+   /* Size of the image, in pixels. */
+   unsigned width;
+   unsigned height;
+} xmb_sprite_t;
+
 typedef struct
 {
    float alpha;
@@ -44,8 +76,10 @@ typedef struct
    float zoom;
    float x;
    float y;
-   GLuint icon;
-   GLuint content_icon;
+   xmb_sprite_t icon;
+   xmb_sprite_t content_icon;
+   /* Core icons are only asked for once the tab comes near. */
+   bool icons_requested;
 } xmb_node_t;
 
 enum
@@ -72,10 +106,60 @@ enum
 
 struct xmb_texture_item
 {
-   GLuint id;
+   xmb_sprite_t sprite;
    char path[PATH_MAX_LENGTH];
 };
 
+/* Cells of a shelf are all as wide as it is high. */
+struct xmb_atlas_shelf
+{
+   unsigned y;
+   unsigned height;
+   unsigned x;
+};
+
+typedef struct xmb_atlas_page
+{
+   GLuint tex;
+   /* Top of the space no shelf has taken yet. */
+   unsigned next_y;
+   unsigned num_shelves;
+   struct xmb_atlas_shelf shelves[XMB_ATLAS_SHELVES];
+   /* Mipmaps need to be generated again. */
+   bool dirty;
+} xmb_atlas_page_t;
+
+/* Sprites queued by draw_icon(), all from the same texture. */
+struct xmb_batch
+{
+   GLuint tex;
+   unsigned count;
+   GLfloat vertex[2 * 6 * XMB_BATCH_SPRITES];
+   GLfloat tex_coord[2 * 6 * XMB_BATCH_SPRITES];
+   GLfloat color[4 * 6 * XMB_BATCH_SPRITES];
+};
+
+/* Image decoded on the thread pool, waiting for its upload. */
+typedef struct xmb_texture_job
+{
+   char path[PATH_MAX_LENGTH];
+   /* NULL once the texture is no longer wanted. */
+   xmb_sprite_t *target;
+   /* Packed into an atlas page if it fits. */
+   bool atlas;
+   /* Size it is drawn at, at most. */
+   unsigned max_width;
+   unsigned max_height;
+   const char *cache_dir;
+   struct texture_image ti;
+   bool decoded;
+   bool loaded;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   struct xmb_texture_job *next;
+} xmb_texture_job_t;
+
 typedef struct xmb_handle
 {
    file_list_t *menu_stack_old;
@@ -118,25 +202,30 @@ typedef struct xmb_handle
    float c_passive_alpha;
    float i_passive_zoom;
    float i_passive_alpha;
+   /* Selection the entries of selection_buf were last
+    * laid out around, see xmb_list_window. */
+   size_t list_current;
    void *font;
    int font_size;
    xmb_node_t settings_node;
+   xmb_atlas_page_t atlas[XMB_ATLAS_PAGES];
+   unsigned atlas_size;
+   struct xmb_batch batch;
+   /* Pending texture requests, guarded by jobs_lock. */
+   xmb_texture_job_t *jobs;
+   /* Where decoded images are kept scaled down, empty if nowhere. */
+   char image_cache_dir[PATH_MAX_LENGTH];
+   /* Thumbnail of the current savestate slot, shown while
+    * Save State or Load State is selected. */
+   xmb_sprite_t state_thumb;
+   char state_thumb_path[PATH_MAX_LENGTH];
+   time_t state_thumb_mtime;
+#ifdef HAVE_THREADS
+   slock_t *jobs_lock;
+   sthread_group_t *jobs_group;
+#endif
 } xmb_handle_t;
 
-static const GLfloat rmb_vertex[] = {
-   0, 0,
-   1, 0,
-   0, 1,
-   1, 1,
-};
-
-static const GLfloat rmb_tex_coord[] = {
-   0, 1,
-   1, 1,
-   0, 0,
-   1, 0,
-};
-
 static char *xmb_str_replace (const char *string,
       const char *substr, const char *replacement)
 {
@@ -175,63 +264,155 @@ static char *xmb_str_replace (const char *string,
    return newstr;
 }
 
-static void xmb_draw_icon(GLuint texture, float x, float y,
-      float alpha, float rotation, float scale_factor)
+/**
+ * xmb_draw_flush:
+ *
+ * Draws the sprites queued by xmb_draw_icon(). Done before
+ * anything which has to go on top of them.
+ **/
+static void xmb_draw_flush(void)
 {
    struct gl_coords coords;
-   math_matrix_4x4 mymat, mrot, mscal;
+   gl_t *gl = NULL;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
-   if (!xmb)
+   if (!xmb || !xmb->batch.count)
       return;
 
-   if (alpha > xmb->alpha)
-      alpha = xmb->alpha;
+   gl = (gl_t*)driver_video_resolve(NULL);
 
-   if (alpha == 0)
+   if (!gl)
       return;
 
+   if (gl->shader && gl->shader->use)
+      gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
+
+   glViewport(0, 0, gl->win_width, gl->win_height);
+
+   coords.vertices      = 6 * xmb->batch.count;
+   coords.vertex        = xmb->batch.vertex;
+   coords.tex_coord     = xmb->batch.tex_coord;
+   coords.lut_tex_coord = xmb->batch.tex_coord;
+   coords.color         = xmb->batch.color;
+   glBindTexture(GL_TEXTURE_2D, xmb->batch.tex);
+
+   gl->shader->set_coords(&coords);
+   gl->shader->set_mvp(gl, &gl->mvp_no_rot);
+
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glDrawArrays(GL_TRIANGLES, 0, coords.vertices);
+   glDisable(GL_BLEND);
+
+   xmb->batch.count = 0;
+}
+
+/**
+ * xmb_draw_quad:
+ * @sprite                  : image to draw.
+ * @cx                      : center, in pixels from the left.
+ * @cy                      : center, in pixels from the bottom.
+ * @half_width              : half the width, in pixels.
+ * @half_height             : half the height, in pixels.
+ * @alpha                   : opacity.
+ * @rotation                : rotation around the center, in radians.
+ *
+ * Queues a rectangle with @sprite, see xmb_draw_icon().
+ **/
+static void xmb_draw_quad(const xmb_sprite_t *sprite, float cx, float cy,
+      float half_width, float half_height, float alpha, float rotation)
+{
+   unsigned i;
+   float cosine, sine, inv_width, inv_height;
+   GLfloat *vertex, *tex_coord, *color;
+   xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
    gl_t *gl = (gl_t*)driver_video_resolve(NULL);
+   /* Two triangles, as in the raster font. */
+   static const int corners[6][2] = {
+      { 0, 0 }, { 1, 0 }, { 0, 1 },
+      { 1, 1 }, { 0, 1 }, { 1, 0 },
+   };
 
-   if (!gl)
+   if (!xmb || !gl)
       return;
 
-   if (x < -xmb->icon_size || x > gl->win_width + xmb->icon_size
-         || y < -xmb->icon_size || y > gl->win_height + xmb->icon_size)
-      return;
+   if (xmb->batch.count == XMB_BATCH_SPRITES
+         || (xmb->batch.count && xmb->batch.tex != sprite->tex))
+      xmb_draw_flush();
 
-   GLfloat color[] = {
-      1.0f, 1.0f, 1.0f, alpha,
-      1.0f, 1.0f, 1.0f, alpha,
-      1.0f, 1.0f, 1.0f, alpha,
-      1.0f, 1.0f, 1.0f, alpha,
-   };
+   vertex    = xmb->batch.vertex    + 2 * 6 * xmb->batch.count;
+   tex_coord = xmb->batch.tex_coord + 2 * 6 * xmb->batch.count;
+   color     = xmb->batch.color     + 4 * 6 * xmb->batch.count;
 
-   if (gl->shader && gl->shader->use)
-      gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
+   cosine     = cosf(rotation);
+   sine       = sinf(rotation);
+   inv_width  = 1.0f / gl->win_width;
+   inv_height = 1.0f / gl->win_height;
 
-   glViewport(x, gl->win_height - y, xmb->icon_size, xmb->icon_size);
+   for (i = 0; i < 6; i++)
+   {
+      float dx = corners[i][0] ? half_width : -half_width;
+      float dy = corners[i][1] ? half_height : -half_height;
+
+      vertex[2 * i + 0]    = (cx + cosine * dx - sine * dy) * inv_width;
+      vertex[2 * i + 1]    = (cy + sine * dx + cosine * dy) * inv_height;
+      /* The top row of the image is at the top coordinate. */
+      tex_coord[2 * i + 0] = sprite->coord[corners[i][0] ? 2 : 0];
+      tex_coord[2 * i + 1] = sprite->coord[corners[i][1] ? 1 : 3];
+      color[4 * i + 0]     = 1.0f;
+      color[4 * i + 1]     = 1.0f;
+      color[4 * i + 2]     = 1.0f;
+      color[4 * i + 3]     = alpha;
+   }
 
-   coords.vertices = 4;
-   coords.vertex = rmb_vertex;
-   coords.tex_coord = rmb_tex_coord;
-   coords.lut_tex_coord = rmb_tex_coord;
-   coords.color = color;
-   glBindTexture(GL_TEXTURE_2D, texture);
+   xmb->batch.tex = sprite->tex;
+   xmb->batch.count++;
+}
 
-   matrix_4x4_rotate_z(&mrot, rotation);
-   matrix_4x4_multiply(&mymat, &mrot, &gl->mvp_no_rot);
+/**
+ * xmb_draw_icon:
+ * @sprite                  : image to draw.
+ * @x                       : left edge, in pixels from the left.
+ * @y                       : bottom edge, in pixels from the top.
+ * @alpha                   : opacity.
+ * @rotation                : rotation around the center, in radians.
+ * @scale_factor            : scale around the center.
+ *
+ * Queues an icon_size square with @sprite. The queue is only
+ * drawn once a sprite from another texture comes, or on
+ * xmb_draw_flush(), so icons from one atlas page take a
+ * single draw call.
+ **/
+static void xmb_draw_icon(const xmb_sprite_t *sprite, float x, float y,
+      float alpha, float rotation, float scale_factor)
+{
+   float half;
+   xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
+   gl_t *gl = NULL;
 
-   matrix_4x4_scale(&mscal, scale_factor, scale_factor, 1);
-   matrix_4x4_multiply(&mymat, &mscal, &mymat);
+   if (!xmb)
+      return;
 
-   gl->shader->set_coords(&coords);
-   gl->shader->set_mvp(gl, &mymat);
+   if (alpha > xmb->alpha)
+      alpha = xmb->alpha;
 
-   glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-   glDisable(GL_BLEND);
+   if (alpha == 0 || !sprite || !sprite->tex)
+      return;
+
+   gl = (gl_t*)driver_video_resolve(NULL);
+
+   if (!gl)
+      return;
+
+   if (x < -xmb->icon_size || x > gl->win_width + xmb->icon_size
+         || y < -xmb->icon_size || y > gl->win_height + xmb->icon_size)
+      return;
+
+   /* Center, with y going up like GL does. */
+   half = xmb->icon_size * scale_factor / 2.0f;
+   xmb_draw_quad(sprite, x + xmb->icon_size / 2.0f,
+         gl->win_height - y + xmb->icon_size / 2.0f,
+         half, half, alpha, rotation);
 }
 
 static void xmb_draw_text(const char *str, float x,
@@ -337,10 +518,10 @@ static void xmb_render_background(bool force_transparency)
    if ((g_settings.menu.pause_libretro
       || !g_extern.main_is_init || g_extern.libretro_dummy)
       && !force_transparency
-      && xmb->textures[XMB_TEXTURE_BG].id)
+      && xmb->textures[XMB_TEXTURE_BG].sprite.tex)
    {
       coords.color = color;
-      glBindTexture(GL_TEXTURE_2D, xmb->textures[XMB_TEXTURE_BG].id);
+      glBindTexture(GL_TEXTURE_2D, xmb->textures[XMB_TEXTURE_BG].sprite.tex);
    }
    else
    {
@@ -404,42 +585,105 @@ static void xmb_render_messagebox(const char *message)
    string_list_free(list);
 }
 
+/* Entries this many rows out of view are still laid out,
+ * so that short moves slide them in instead of popping up. */
+#define XMB_LIST_MARGIN 4
+
+/**
+ * xmb_item_y:
+ * @xmb                     : XMB handle.
+ * @i                       : entry index.
+ * @current                 : selected entry.
+ *
+ * Returns: vertical offset of entry @i at rest.
+ **/
+static float xmb_item_y(xmb_handle_t *xmb, size_t i, size_t current)
+{
+   if (i == current)
+      return xmb->vspacing * xmb->active_item_factor;
+   if (i > current)
+      return xmb->vspacing * ((float)(i - current) + xmb->under_item_offset);
+   if (xmb->depth > 1)
+      return xmb->vspacing * (xmb->above_subitem_offset - (float)(current - i));
+   return xmb->vspacing * (xmb->above_item_offset - (float)(current - i));
+}
+
+/**
+ * xmb_list_window:
+ * @xmb                     : XMB handle.
+ * @current                 : selected entry.
+ * @size                    : number of entries.
+ * @first                   : first entry in view.
+ * @last                    : entry past the last one in view.
+ *
+ * Only entries around the selection can be seen, so only those
+ * get laid out, tweened and drawn. The rest keep whatever state
+ * they had, and get put at their place at rest when they come
+ * into view.
+ **/
+static void xmb_list_window(xmb_handle_t *xmb, size_t current,
+      size_t size, size_t *first, size_t *last)
+{
+   float above, below;
+   size_t rows_above, rows_below;
+   gl_t *gl = (gl_t*)driver_video_resolve(NULL);
+   float height = gl ? gl->win_height : 0;
+
+   /* Entries are culled once they are an icon past the edges. */
+   above = (xmb->margin_top + xmb->icon_size * 1.5) / xmb->vspacing
+      + max(xmb->above_item_offset, xmb->above_subitem_offset);
+   below = (height + xmb->icon_size / 2.0 - xmb->margin_top) / xmb->vspacing
+      - xmb->under_item_offset;
+
+   rows_above = (above > 0 ? (size_t)ceilf(above) : 0) + XMB_LIST_MARGIN;
+   rows_below = (below > 0 ? (size_t)ceilf(below) : 0) + XMB_LIST_MARGIN;
+
+   *first = current > rows_above ? current - rows_above : 0;
+   *first = min(*first, size);
+   *last  = min(current + rows_below + 1, size);
+}
+
 static void xmb_selection_pointer_changed(void)
 {
-   int i;
-   unsigned current, end;
+   size_t i, current, end, first, last, old_first, old_last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
+   file_list_t *list = NULL;
 
    if (!xmb)
       return;
 
+   list    = driver.menu->menu_list->selection_buf;
    current = driver.menu->selection_ptr;
-   end = menu_list_get_size(driver.menu->menu_list);
+   end     = menu_list_get_size(driver.menu->menu_list);
+
+   xmb_list_window(xmb, current, end, &first, &last);
+   xmb_list_window(xmb, xmb->list_current, end, &old_first, &old_last);
 
-   for (i = 0; i < end; i++)
+   for (i = first; i < last; i++)
    {
-      float iy;
+      float iy = xmb_item_y(xmb, i, current);
       float ia = xmb->i_passive_alpha;
       float iz = xmb->i_passive_zoom;
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(
-            driver.menu->menu_list->selection_buf, i);
+            list, i);
 
       if (!node)
          continue;
 
-      if (i < current)
-         if (xmb->depth > 1)
-            iy = xmb->vspacing * (i - (int)current + xmb->above_subitem_offset);
-         else
-            iy = xmb->vspacing * (i - (int)current + xmb->above_item_offset);
-      else
-         iy = xmb->vspacing * (i - (int)current + xmb->under_item_offset);
+      /* Coming into view, from where it would have been. */
+      if (i < old_first || i >= old_last)
+      {
+         node->alpha       = xmb->i_passive_alpha;
+         node->label_alpha = xmb->i_passive_alpha;
+         node->zoom        = xmb->i_passive_zoom;
+         node->x           = 0;
+         node->y           = xmb_item_y(xmb, i, xmb->list_current);
+      }
 
       if (i == current)
       {
          ia = xmb->i_active_alpha;
          iz = xmb->i_active_zoom;
-         iy = xmb->vspacing * xmb->active_item_factor;
       }
 
       add_tween(XMB_DELAY, ia, &node->alpha, &inOutQuad, NULL);
@@ -447,17 +691,21 @@ static void xmb_selection_pointer_changed(void)
       add_tween(XMB_DELAY, iz, &node->zoom,  &inOutQuad, NULL);
       add_tween(XMB_DELAY, iy, &node->y,     &inOutQuad, NULL);
    }
+
+   xmb->list_current = current;
 }
 
 static void xmb_list_open_old(file_list_t *list, int dir, size_t current)
 {
-   int i;
+   size_t i, first, last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
    if (!xmb)
       return;
 
-   for (i = 0; i < file_list_get_size(list); i++)
+   xmb_list_window(xmb, current, file_list_get_size(list), &first, &last);
+
+   for (i = first; i < last; i++)
    {
       float ia = 0;
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(list, i);
@@ -480,18 +728,19 @@ static void xmb_list_open_old(file_list_t *list, int dir, size_t current)
 
 static void xmb_list_open_new(file_list_t *list, int dir, size_t current)
 {
-   int i;
+   size_t i, first, last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
    if (!xmb)
       return;
 
-   for (i = 0; i < file_list_get_size(list); i++)
+   xmb_list_window(xmb, current, file_list_get_size(list), &first, &last);
+
+   for (i = first; i < last; i++)
    {
-      float iy = 0;
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(list, i);
        
-      if (!xmb)
+      if (!node)
           continue;
        
       node->label_alpha = 0;
@@ -502,28 +751,17 @@ static void xmb_list_open_new(file_list_t *list, int dir, size_t current)
       //else
       //   node->x = xmb->icon_size*dir;
 
-      if (i < current)
-         if (xmb->depth > 1)
-            iy = xmb->vspacing * (i - (int)current + xmb->above_subitem_offset);
-         else
-            iy = xmb->vspacing * (i - (int)current + xmb->above_item_offset);
-      else
-         iy = xmb->vspacing * (i - (int)current + xmb->under_item_offset);
-
-      if (i == current)
-         iy = xmb->vspacing * xmb->active_item_factor;
-
-      node->y = iy;
+      node->y = xmb_item_y(xmb, i, current);
 
       if (i == current)
          node->zoom = 1;
    }
-   for (i = 0; i < file_list_get_size(list); i++)
+   for (i = first; i < last; i++)
    {
       float ia;
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(list, i);
        
-      if (!xmb)
+      if (!node)
           continue;
 
       ia = (i == current) ? xmb->i_active_alpha : xmb->i_passive_alpha;
@@ -532,54 +770,387 @@ static void xmb_list_open_new(file_list_t *list, int dir, size_t current)
       add_tween(XMB_DELAY, 0, &node->x, &inOutQuad, NULL);
    }
 
-   xmb->old_depth = xmb->depth;
+   xmb->old_depth    = xmb->depth;
+   xmb->list_current = current;
 }
 
-static GLuint xmb_png_texture_load_(const char * file_name)
+/* Decoded textures handed to the GPU per frame, so a
+ * context reset does not stall on all of them at once. */
+#define XMB_TEXTURE_UPLOADS_PER_FRAME 4
+
+static void xmb_sprite_upload(const struct texture_image *ti,
+      xmb_sprite_t *sprite)
 {
-   struct texture_image ti = {0};
-   GLuint texture = 0;
+   /* Generate the OpenGL texture object */
+   glGenTextures(1, &sprite->tex);
+   glBindTexture(GL_TEXTURE_2D, sprite->tex);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ti->width, ti->height, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, ti->pixels);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glGenerateMipmap(GL_TEXTURE_2D);
 
-   if (! path_file_exists(file_name))
-      return 0;
+   sprite->coord[0] = 0.0f;
+   sprite->coord[1] = 0.0f;
+   sprite->coord[2] = 1.0f;
+   sprite->coord[3] = 1.0f;
+   sprite->width    = ti->width;
+   sprite->height   = ti->height;
+}
 
-   texture_image_load(&ti, file_name);
+static bool xmb_atlas_owns(const xmb_handle_t *xmb, GLuint tex)
+{
+   unsigned i;
 
-   /* Generate the OpenGL texture object */
-   glGenTextures(1, &texture);
-   glBindTexture(GL_TEXTURE_2D, texture);
-   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ti.width, ti.height, 0,
-         GL_RGBA, GL_UNSIGNED_BYTE, ti.pixels);
+   for (i = 0; i < XMB_ATLAS_PAGES; i++)
+      if (xmb->atlas[i].tex && xmb->atlas[i].tex == tex)
+         return true;
+   return false;
+}
+
+static size_t xmb_atlas_page_mem(const xmb_handle_t *xmb)
+{
+   /* Mipmaps add a third. */
+   return (size_t)xmb->atlas_size * xmb->atlas_size
+      * sizeof(uint32_t) * 4 / 3;
+}
+
+static bool xmb_atlas_page_init(xmb_handle_t *xmb, xmb_atlas_page_t *page)
+{
+   uint32_t *clear = NULL;
+
+   if (!xmb->atlas_size)
+   {
+      GLint max_size = 0;
+
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+      xmb->atlas_size = XMB_ATLAS_SIZE;
+      while (xmb->atlas_size > 256 && xmb->atlas_size > (unsigned)max_size)
+         xmb->atlas_size >>= 1;
+   }
+
+   /* Space no icon takes has to be transparent,
+    * smaller mipmaps take it in. */
+   clear = (uint32_t*)calloc(xmb->atlas_size * xmb->atlas_size,
+         sizeof(uint32_t));
+   if (!clear)
+      return false;
+
+   memset(page, 0, sizeof(*page));
+   glGenTextures(1, &page->tex);
+   glBindTexture(GL_TEXTURE_2D, page->tex);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, xmb->atlas_size, xmb->atlas_size,
+         0, GL_RGBA, GL_UNSIGNED_BYTE, clear);
    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-   glGenerateMipmap(GL_TEXTURE_2D);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   free(clear);
 
-   free(ti.pixels);
+   page->dirty = true;
+   rarch_mem_add(RARCH_MEM_MENU, xmb_atlas_page_mem(xmb));
+   return true;
+}
+
+static bool xmb_atlas_page_alloc(xmb_atlas_page_t *page, unsigned size,
+      unsigned cell, unsigned *x, unsigned *y)
+{
+   unsigned i, shelf_y;
+   struct xmb_atlas_shelf *shelf = NULL;
+
+   for (i = 0; i < page->num_shelves; i++)
+   {
+      shelf = &page->shelves[i];
+
+      if (shelf->height == cell && shelf->x + cell <= size)
+      {
+         *x         = shelf->x;
+         *y         = shelf->y;
+         shelf->x  += cell;
+         return true;
+      }
+   }
 
-   return texture;
+   /* Shelves start at a multiple of their height. Cells are then
+    * aligned to their size, and the mipmaps of one icon do not
+    * take in its neighbours. */
+   shelf_y = (page->next_y + cell - 1) & ~(cell - 1);
+   if (page->num_shelves == XMB_ATLAS_SHELVES || shelf_y + cell > size)
+      return false;
+
+   shelf         = &page->shelves[page->num_shelves++];
+   shelf->y      = shelf_y;
+   shelf->height = cell;
+   shelf->x      = cell;
+   page->next_y  = shelf_y + cell;
+
+   *x = 0;
+   *y = shelf_y;
+   return true;
 }
 
-static int xmb_png_texture_load_wrap(void *data)
+/**
+ * xmb_atlas_add:
+ * @xmb                     : XMB handle.
+ * @ti                      : decoded image.
+ * @sprite                  : sprite to point at the image.
+ *
+ * Packs @ti into an atlas page, creating pages as needed.
+ *
+ * Returns: true (1) if it was packed, false (0) if it is too
+ * big for a page or all pages are full.
+ **/
+static bool xmb_atlas_add(xmb_handle_t *xmb,
+      const struct texture_image *ti, xmb_sprite_t *sprite)
 {
-   const char *filename = (const char*)data;
-   return xmb_png_texture_load_(filename);
+   unsigned i, x = 0, y = 0;
+   unsigned cell = XMB_ATLAS_CELL_MIN;
+   float inv_size;
+   xmb_atlas_page_t *page = NULL;
+
+   while (cell < ti->width || cell < ti->height)
+      cell <<= 1;
+
+   for (i = 0; i < XMB_ATLAS_PAGES; i++)
+   {
+      page = &xmb->atlas[i];
+
+      if (!page->tex && !xmb_atlas_page_init(xmb, page))
+         return false;
+
+      /* Bigger images would leave too few cells. */
+      if (cell > xmb->atlas_size / 4)
+         return false;
+
+      if (xmb_atlas_page_alloc(page, xmb->atlas_size, cell, &x, &y))
+         break;
+   }
+
+   if (i == XMB_ATLAS_PAGES)
+      return false;
+
+   glBindTexture(GL_TEXTURE_2D, page->tex);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, ti->width, ti->height,
+         GL_RGBA, GL_UNSIGNED_BYTE, ti->pixels);
+   page->dirty = true;
+
+   /* Inset by half a texel, so filtering stays inside. */
+   inv_size         = 1.0f / xmb->atlas_size;
+   sprite->tex      = page->tex;
+   sprite->coord[0] = (x + 0.5f) * inv_size;
+   sprite->coord[1] = (y + 0.5f) * inv_size;
+   sprite->coord[2] = (x + ti->width - 0.5f) * inv_size;
+   sprite->coord[3] = (y + ti->height - 0.5f) * inv_size;
+   sprite->width    = ti->width;
+   sprite->height   = ti->height;
+   return true;
 }
 
-static GLuint xmb_png_texture_load(const char* file_name)
+static void xmb_atlas_update(xmb_handle_t *xmb)
 {
-   if (g_settings.video.threaded
-         && !g_extern.system.hw_render_callback.context_type)
+   unsigned i;
+
+   for (i = 0; i < XMB_ATLAS_PAGES; i++)
    {
-      thread_video_t *thr = (thread_video_t*)driver.video_data;
-      thr->cmd_data.custom_command.method = xmb_png_texture_load_wrap;
-      thr->cmd_data.custom_command.data   = (void*)file_name;
-      thr->send_cmd_func(thr, CMD_CUSTOM_COMMAND);
-      thr->wait_reply_func(thr, CMD_CUSTOM_COMMAND);
+      if (!xmb->atlas[i].dirty)
+         continue;
+
+      glBindTexture(GL_TEXTURE_2D, xmb->atlas[i].tex);
+      glGenerateMipmap(GL_TEXTURE_2D);
+      xmb->atlas[i].dirty = false;
+   }
+}
+
+static void xmb_atlas_free(xmb_handle_t *xmb)
+{
+   unsigned i;
+
+   for (i = 0; i < XMB_ATLAS_PAGES; i++)
+   {
+      if (!xmb->atlas[i].tex)
+         continue;
 
-      return thr->cmd_data.custom_command.return_value;
+      glDeleteTextures(1, &xmb->atlas[i].tex);
+      rarch_mem_sub(RARCH_MEM_MENU, xmb_atlas_page_mem(xmb));
+      memset(&xmb->atlas[i], 0, sizeof(xmb->atlas[i]));
    }
+}
 
-   return xmb_png_texture_load_(file_name);
+/* Deletes the texture of @sprite, unless it is an atlas page. */
+static void xmb_sprite_free(xmb_handle_t *xmb, xmb_sprite_t *sprite)
+{
+   if (sprite->tex && !xmb_atlas_owns(xmb, sprite->tex))
+      glDeleteTextures(1, &sprite->tex);
+   memset(sprite, 0, sizeof(*sprite));
+}
+
+static void xmb_texture_decode(void *data)
+{
+   xmb_texture_job_t *job = (xmb_texture_job_t*)data;
+   bool loaded = path_file_exists(job->path)
+      && texture_image_load_cached(&job->ti, job->path,
+            job->max_width, job->max_height, job->cache_dir);
+
+#ifdef HAVE_THREADS
+   if (job->lock)
+      slock_lock(job->lock);
+#endif
+   job->loaded  = loaded;
+   job->decoded = true;
+#ifdef HAVE_THREADS
+   if (job->lock)
+      slock_unlock(job->lock);
+#endif
+}
+
+/**
+ * xmb_texture_request:
+ * @xmb                     : XMB handle.
+ * @path                    : path of the PNG image.
+ * @target                  : where to store the texture.
+ * @atlas                   : pack it into an atlas page.
+ * @max_width               : width it is drawn at, at most.
+ * @max_height              : height it is drawn at, at most.
+ *
+ * Decodes @path on the thread pool, and has xmb_frame()
+ * upload it to @target some frames later. @target stays
+ * 0 until then, so callers draw a placeholder meanwhile.
+ * Works for any image, icons or thumbnails alike. Images
+ * drawn other than by xmb_draw_icon() should not be packed.
+ * Images are scaled down to @max_width x @max_height once,
+ * and read back from the image cache after that.
+ **/
+static void xmb_texture_request(xmb_handle_t *xmb,
+      const char *path, xmb_sprite_t *target, bool atlas,
+      unsigned max_width, unsigned max_height)
+{
+   xmb_texture_job_t *job = (xmb_texture_job_t*)
+      calloc(1, sizeof(*job));
+
+   if (!job)
+      return;
+
+   strlcpy(job->path, path, sizeof(job->path));
+   job->target     = target;
+   job->atlas      = atlas;
+   job->max_width  = max_width;
+   job->max_height = max_height;
+   job->cache_dir  = xmb->image_cache_dir;
+
+#ifdef HAVE_THREADS
+   job->lock   = xmb->jobs_lock;
+   if (xmb->jobs_lock)
+      slock_lock(xmb->jobs_lock);
+#endif
+   job->next   = xmb->jobs;
+   xmb->jobs   = job;
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_unlock(xmb->jobs_lock);
+
+   if (xmb->jobs_group && xmb->jobs_lock
+         && sthread_group_run(xmb->jobs_group, xmb_texture_decode, job))
+      return;
+#endif
+
+   xmb_texture_decode(job);
+}
+
+/**
+ * xmb_texture_cancel:
+ * @xmb                     : XMB handle.
+ * @target                  : target to drop, or NULL for all.
+ *
+ * Drops the targets of pending requests, for when what
+ * they point to is about to go away or be asked for again.
+ **/
+static void xmb_texture_cancel(xmb_handle_t *xmb, xmb_sprite_t *target)
+{
+   xmb_texture_job_t *job = NULL;
+
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_lock(xmb->jobs_lock);
+#endif
+   for (job = xmb->jobs; job; job = job->next)
+      if (!target || job->target == target)
+         job->target = NULL;
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_unlock(xmb->jobs_lock);
+#endif
+}
+
+/**
+ * xmb_texture_poll:
+ * @xmb                     : XMB handle.
+ *
+ * Uploads up to XMB_TEXTURE_UPLOADS_PER_FRAME decoded
+ * requests. Must be called with the GL context current.
+ **/
+static void xmb_texture_poll(xmb_handle_t *xmb)
+{
+   unsigned uploads = 0;
+   xmb_texture_job_t **job = &xmb->jobs;
+
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_lock(xmb->jobs_lock);
+#endif
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   while (*job && uploads < XMB_TEXTURE_UPLOADS_PER_FRAME)
+   {
+      xmb_texture_job_t *done = *job;
+
+      if (!done->decoded)
+      {
+         job = &done->next;
+         continue;
+      }
+
+      if (done->loaded && done->target)
+      {
+         xmb_sprite_free(xmb, done->target);
+         if (!done->atlas || !xmb_atlas_add(xmb, &done->ti, done->target))
+            xmb_sprite_upload(&done->ti, done->target);
+         uploads++;
+      }
+
+      *job = done->next;
+      texture_image_free(&done->ti);
+      free(done);
+   }
+
+   xmb_atlas_update(xmb);
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_unlock(xmb->jobs_lock);
+#endif
+}
+
+static void xmb_texture_jobs_free(xmb_handle_t *xmb)
+{
+#ifdef HAVE_THREADS
+   if (xmb->jobs_group)
+      sthread_group_free(xmb->jobs_group);
+   xmb->jobs_group = NULL;
+#endif
+
+   while (xmb->jobs)
+   {
+      xmb_texture_job_t *job = xmb->jobs;
+
+      xmb->jobs = job->next;
+      texture_image_free(&job->ti);
+      free(job);
+   }
+
+#ifdef HAVE_THREADS
+   if (xmb->jobs_lock)
+      slock_free(xmb->jobs_lock);
+   xmb->jobs_lock = NULL;
+#endif
 }
 
 static xmb_node_t* xmb_node_for_core(int i)
@@ -625,19 +1196,111 @@ static xmb_node_t* xmb_node_for_core(int i)
    return node;
 }
 
+/* Tabs this far out of view are still tweened and loaded,
+ * so that they slide in with their icons. */
+#define XMB_CATEGORY_MARGIN 2
+
+/**
+ * xmb_category_window:
+ * @xmb                     : XMB handle.
+ * @first                   : first tab in view.
+ * @last                    : tab past the last one in view.
+ *
+ * Works out which tabs can be seen once the tab strip has
+ * scrolled to the selected one. Only those get tweened,
+ * drawn and their icons loaded.
+ **/
+static void xmb_category_window(xmb_handle_t *xmb, int *first, int *last)
+{
+   int left, right;
+   gl_t *gl = (gl_t*)driver_video_resolve(NULL);
+   float width = gl ? gl->win_width : 0;
+   int current = driver.menu->cat_selection_ptr;
+
+   /* The strip moves left by up to two icons in submenus. */
+   left  = (int)ceilf((xmb->margin_left + xmb->icon_size)
+         / xmb->hspacing) + XMB_CATEGORY_MARGIN;
+   right = (int)ceilf((width - xmb->margin_left + xmb->icon_size * 2.5)
+         / xmb->hspacing) + XMB_CATEGORY_MARGIN;
+
+   *first = max(current - left, 0);
+   *last  = min(current + right + 1, xmb->num_categories);
+}
+
+/**
+ * xmb_core_icons_request:
+ * @xmb                     : XMB handle.
+ *
+ * Asks for the icons of the core tabs around the selected
+ * one, which are not in or on their way yet.
+ **/
+static void xmb_core_icons_request(xmb_handle_t *xmb)
+{
+   int i, first, last;
+   char mediapath[PATH_MAX_LENGTH], themepath[PATH_MAX_LENGTH],
+        iconpath[PATH_MAX_LENGTH], core_id[PATH_MAX_LENGTH],
+        texturepath[PATH_MAX_LENGTH], content_texturepath[PATH_MAX_LENGTH];
+   core_info_list_t *info_list = (core_info_list_t*)g_extern.core_info;
+
+   if (!info_list)
+      return;
+
+   fill_pathname_join(mediapath, g_settings.assets_directory,
+         "lakka", sizeof(mediapath));
+   fill_pathname_join(themepath, mediapath, XMB_THEME, sizeof(themepath));
+   fill_pathname_join(iconpath, themepath, xmb->icon_dir, sizeof(iconpath));
+   fill_pathname_slash(iconpath, sizeof(iconpath));
+
+   xmb_category_window(xmb, &first, &last);
+
+   for (i = max(first, 1); i < last; i++)
+   {
+      core_info_t *info = &info_list->list[i-1];
+      xmb_node_t *node  = xmb_node_for_core(i-1);
+
+      if (!node || node->icons_requested)
+         continue;
+
+      if (info->systemname)
+      {
+         char *tmp = xmb_str_replace(info->systemname, "/", " ");
+         strlcpy(core_id, tmp, sizeof(core_id));
+         free(tmp);
+      }
+      else
+         strlcpy(core_id, "default", sizeof(core_id));
+
+      strlcpy(texturepath, iconpath, sizeof(texturepath));
+      strlcat(texturepath, core_id, sizeof(texturepath));
+      strlcat(texturepath, ".png", sizeof(texturepath));
+
+      strlcpy(content_texturepath, iconpath, sizeof(content_texturepath));
+      strlcat(content_texturepath, core_id, sizeof(content_texturepath));
+      strlcat(content_texturepath, "-content.png", sizeof(content_texturepath));
+
+      xmb_texture_request(xmb, texturepath, &node->icon, true,
+            xmb->icon_size, xmb->icon_size);
+      xmb_texture_request(xmb, content_texturepath,
+            &node->content_icon, true, xmb->icon_size, xmb->icon_size);
+      node->icons_requested = true;
+   }
+}
+
 static void xmb_list_switch_old(file_list_t *list, int dir, size_t current)
 {
-   int i;
+   size_t i, first, last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
    if (!xmb)
       return;
 
-   for (i = 0; i < file_list_get_size(list); i++)
+   xmb_list_window(xmb, current, file_list_get_size(list), &first, &last);
+
+   for (i = first; i < last; i++)
    {
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(list, i);
 
-      if (!xmb)
+      if (!node)
           continue;
 
       add_tween(XMB_DELAY, 0, &node->alpha,  &inOutQuad, NULL);
@@ -648,18 +1311,20 @@ static void xmb_list_switch_old(file_list_t *list, int dir, size_t current)
 
 static void xmb_list_switch_new(file_list_t *list, int dir, size_t current)
 {
-   int i;
+   size_t i, first, last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
    if (!xmb)
       return;
 
-   for (i = 0; i < file_list_get_size(list); i++)
+   xmb_list_window(xmb, current, file_list_get_size(list), &first, &last);
+
+   for (i = first; i < last; i++)
    {
       float ia = 0.5;
       xmb_node_t *node = (xmb_node_t*)file_list_get_userdata_at_offset(list, i);
 
-      if (!xmb)
+      if (!node)
           continue;
 
       node->x = xmb->hspacing * dir;
@@ -710,8 +1375,7 @@ static void xmb_set_title()
 static void xmb_populate_entries(void *data, const char *path,
       const char *label, unsigned k)
 {
-   int dir;
-   unsigned j;
+   int dir, j, first, last;
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
 
    if (!xmb)
@@ -725,7 +1389,10 @@ static void xmb_populate_entries(void *data, const char *path,
 
       xmb->active_category += dir;
 
-      for (j = 0; j < xmb->num_categories; j++)
+      xmb_core_icons_request(xmb);
+      xmb_category_window(xmb, &first, &last);
+
+      for (j = first; j < last; j++)
       {
          float ia, iz;
          xmb_node_t *node = j ? xmb_node_for_core(j-1) : &xmb->settings_node;
@@ -755,7 +1422,9 @@ static void xmb_populate_entries(void *data, const char *path,
    else if (xmb->depth < xmb->old_depth)
       dir = -1;
 
-   for (j = 0; j < xmb->num_categories; j++)
+   xmb_category_window(xmb, &first, &last);
+
+   for (j = first; j < last; j++)
    {
       float ia;
       xmb_node_t *node = j ? xmb_node_for_core(j-1) : &xmb->settings_node;
@@ -786,12 +1455,11 @@ static void xmb_populate_entries(void *data, const char *path,
 static void xmb_draw_items(file_list_t *list, file_list_t *stack,
       size_t current, size_t cat_selection_ptr)
 {
-   unsigned i;
+   size_t i, first, end;
    const char *dir = NULL;
    const char *label = NULL;
    unsigned menu_type = 0;
    xmb_node_t *core_node = NULL;
-   size_t end = file_list_get_size(list);
 
    xmb_handle_t *xmb = (xmb_handle_t*)driver.menu->userdata;
    if (!xmb || !list->size)
@@ -802,7 +1470,9 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
    if (xmb->active_category)
       core_node = xmb_node_for_core(cat_selection_ptr - 1);
 
-   for (i = 0; i < end; i++)
+   xmb_list_window(xmb, current, file_list_get_size(list), &first, &end);
+
+   for (i = first; i < end; i++)
    {
       char val_buf[PATH_MAX_LENGTH], path_buf[PATH_MAX_LENGTH];
       char name[256], value[256];
@@ -818,52 +1488,53 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
             entry_label, path,
             path_buf, sizeof(path_buf));
 
-      GLuint icon = 0;
+      const xmb_sprite_t *icon = NULL;
       switch(type)
       {
          case MENU_FILE_DIRECTORY:
-            icon = xmb->textures[XMB_TEXTURE_FOLDER].id;
+            icon = &xmb->textures[XMB_TEXTURE_FOLDER].sprite;
             break;
          case MENU_FILE_PLAIN:
-            icon = xmb->textures[XMB_TEXTURE_FILE].id;
+            icon = &xmb->textures[XMB_TEXTURE_FILE].sprite;
             break;
          case MENU_FILE_PLAYLIST_ENTRY:
-            icon = xmb->textures[XMB_TEXTURE_FILE].id;
+            icon = &xmb->textures[XMB_TEXTURE_FILE].sprite;
             break;
          case MENU_FILE_CONTENTLIST_ENTRY:
-            icon = core_node ? core_node->content_icon : xmb->textures[XMB_TEXTURE_FILE].id;
+            icon = core_node && core_node->content_icon.tex ?
+               &core_node->content_icon : &xmb->textures[XMB_TEXTURE_FILE].sprite;
             break;
          case MENU_FILE_CARCHIVE:
-            icon = xmb->textures[XMB_TEXTURE_ZIP].id;
+            icon = &xmb->textures[XMB_TEXTURE_ZIP].sprite;
             break;
          case MENU_FILE_CORE:
-            icon = xmb->textures[XMB_TEXTURE_CORE].id;
+            icon = &xmb->textures[XMB_TEXTURE_CORE].sprite;
             break;
          case MENU_SETTING_ACTION_RUN:
-            icon = xmb->textures[XMB_TEXTURE_RUN].id;
+            icon = &xmb->textures[XMB_TEXTURE_RUN].sprite;
             break;
          case MENU_SETTING_ACTION_SAVESTATE:
-            icon = xmb->textures[XMB_TEXTURE_SAVESTATE].id;
+            icon = &xmb->textures[XMB_TEXTURE_SAVESTATE].sprite;
             break;
          case MENU_SETTING_ACTION_LOADSTATE:
-            icon = xmb->textures[XMB_TEXTURE_LOADSTATE].id;
+            icon = &xmb->textures[XMB_TEXTURE_LOADSTATE].sprite;
             break;
          case MENU_SETTING_ACTION_SCREENSHOT:
-            icon = xmb->textures[XMB_TEXTURE_SCREENSHOT].id;
+            icon = &xmb->textures[XMB_TEXTURE_SCREENSHOT].sprite;
             break;
          case MENU_SETTING_ACTION_RESET:
-            icon = xmb->textures[XMB_TEXTURE_RELOAD].id;
+            icon = &xmb->textures[XMB_TEXTURE_RELOAD].sprite;
             break;
          case MENU_SETTING_ACTION:
             icon = (xmb->depth == 3) ?
-                  xmb->textures[XMB_TEXTURE_SUBSETTING].id :
-                  xmb->textures[XMB_TEXTURE_SETTING].id;
+                  &xmb->textures[XMB_TEXTURE_SUBSETTING].sprite :
+                  &xmb->textures[XMB_TEXTURE_SETTING].sprite;
             break;
          case MENU_SETTING_GROUP:
-            icon = xmb->textures[XMB_TEXTURE_SETTING].id;
+            icon = &xmb->textures[XMB_TEXTURE_SETTING].sprite;
             break;
          default:
-            icon = xmb->textures[XMB_TEXTURE_SUBSETTING].id;
+            icon = &xmb->textures[XMB_TEXTURE_SUBSETTING].sprite;
             break;
       }
 
@@ -894,9 +1565,9 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
             && strcmp(val_buf, "ON")
             && strcmp(val_buf, "OFF"))
             || ((!strcmp(val_buf, "ON")
-            && !xmb->textures[XMB_TEXTURE_SWITCH_ON].id)
+            && !xmb->textures[XMB_TEXTURE_SWITCH_ON].sprite.tex)
             || (!strcmp(val_buf, "OFF")
-            && !xmb->textures[XMB_TEXTURE_SWITCH_OFF].id)))
+            && !xmb->textures[XMB_TEXTURE_SWITCH_OFF].sprite.tex)))
          xmb_draw_text(value,
                node->x + xmb->margin_left + xmb->hspacing + 
                xmb->label_margin_left + xmb->setting_margin_left, 
@@ -904,8 +1575,8 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
                1, 
                node->label_alpha);
 
-      if (!strcmp(val_buf, "ON") && xmb->textures[XMB_TEXTURE_SWITCH_ON].id)
-         xmb_draw_icon(xmb->textures[XMB_TEXTURE_SWITCH_ON].id,
+      if (!strcmp(val_buf, "ON") && xmb->textures[XMB_TEXTURE_SWITCH_ON].sprite.tex)
+         xmb_draw_icon(&xmb->textures[XMB_TEXTURE_SWITCH_ON].sprite,
                node->x + xmb->margin_left + xmb->hspacing
                + xmb->icon_size/2.0 + xmb->setting_margin_left,
                xmb->margin_top + node->y + xmb->icon_size/2.0,
@@ -913,8 +1584,8 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
                0,
                1);
 
-      if (!strcmp(val_buf, "OFF") && xmb->textures[XMB_TEXTURE_SWITCH_OFF].id)
-         xmb_draw_icon(xmb->textures[XMB_TEXTURE_SWITCH_OFF].id,
+      if (!strcmp(val_buf, "OFF") && xmb->textures[XMB_TEXTURE_SWITCH_OFF].sprite.tex)
+         xmb_draw_icon(&xmb->textures[XMB_TEXTURE_SWITCH_OFF].sprite,
                node->x + xmb->margin_left + xmb->hspacing
                + xmb->icon_size/2.0 + xmb->setting_margin_left,
                xmb->margin_top + node->y + xmb->icon_size/2.0,
@@ -924,9 +1595,71 @@ static void xmb_draw_items(file_list_t *list, file_list_t *stack,
    }
 }
 
+/* Height of the savestate thumbnail, in icons. */
+#define XMB_STATE_THUMB_ICONS 3
+
+/**
+ * xmb_draw_state_thumbnail:
+ * @xmb                     : XMB handle.
+ * @gl                      : GL handle.
+ *
+ * Shows the thumbnail of the current savestate slot while
+ * Save State or Load State is selected. It is asked for
+ * again whenever the slot or its thumbnail changes.
+ **/
+static void xmb_draw_state_thumbnail(xmb_handle_t *xmb, gl_t *gl)
+{
+   char path[PATH_MAX_LENGTH];
+   struct stat st;
+   time_t mtime = 0;
+   unsigned type = 0;
+   float height, width;
+
+   if (driver.menu->selection_ptr >=
+         file_list_get_size(driver.menu->menu_list->selection_buf))
+      return;
+
+   menu_list_get_at_offset(driver.menu->menu_list->selection_buf,
+         driver.menu->selection_ptr, NULL, NULL, &type);
+
+   if (type != MENU_SETTING_ACTION_SAVESTATE &&
+         type != MENU_SETTING_ACTION_LOADSTATE)
+      return;
+
+   rarch_state_slot_path(path, sizeof(path));
+   strlcat(path, ".png", sizeof(path));
+
+   if (stat(path, &st) == 0)
+      mtime = st.st_mtime;
+
+   if (strcmp(path, xmb->state_thumb_path) || mtime != xmb->state_thumb_mtime)
+   {
+      strlcpy(xmb->state_thumb_path, path, sizeof(xmb->state_thumb_path));
+      xmb->state_thumb_mtime = mtime;
+
+      xmb_texture_cancel(xmb, &xmb->state_thumb);
+      xmb_sprite_free(xmb, &xmb->state_thumb);
+
+      if (mtime)
+         xmb_texture_request(xmb, path, &xmb->state_thumb, false,
+               gl->win_width / 2, xmb->icon_size * XMB_STATE_THUMB_ICONS);
+   }
+
+   if (!xmb->state_thumb.tex || !xmb->state_thumb.height)
+      return;
+
+   height = xmb->icon_size * XMB_STATE_THUMB_ICONS;
+   width  = height * xmb->state_thumb.width / xmb->state_thumb.height;
+
+   xmb_draw_quad(&xmb->state_thumb,
+         gl->win_width - xmb->title_margin_left - width / 2.0f,
+         gl->win_height - xmb->margin_top - height / 2.0f,
+         width / 2.0f, height / 2.0f, xmb->alpha, 0);
+}
+
 static void xmb_frame(void)
 {
-   int i, depth;
+   int i, depth, first, last;
    char title_msg[64];
    const char *core_name = NULL;
    const char *core_version = NULL;
@@ -937,12 +1670,18 @@ static void xmb_frame(void)
    if (!xmb || !gl)
       return;
 
+   xmb_texture_poll(xmb);
+
    update_tweens(0.002);
 
    glViewport(0, 0, gl->win_width, gl->win_height);
 
    xmb_render_background(false);
 
+   /* Labels are queued up and drawn after the icons. */
+   if (gl->font_driver && gl->font_driver->begin_batch)
+      gl->font_driver->begin_batch(xmb->font);
+
    core_name = g_extern.menu.info.library_name;
 
    if (!core_name)
@@ -965,7 +1704,7 @@ static void xmb_frame(void)
    xmb_draw_text(title_msg, xmb->title_margin_left, 
          gl->win_height - xmb->title_margin_bottom, 1, 1);
 
-   xmb_draw_icon(xmb->textures[XMB_TEXTURE_ARROW].id,
+   xmb_draw_icon(&xmb->textures[XMB_TEXTURE_ARROW].sprite,
          xmb->x + xmb->margin_left + xmb->hspacing - xmb->icon_size/2.0 + xmb->icon_size,
          xmb->margin_top + xmb->icon_size/2.0 + xmb->vspacing * xmb->active_item_factor,
          xmb->arrow_alpha,
@@ -986,14 +1725,23 @@ static void xmb_frame(void)
          driver.menu->selection_ptr,
          driver.menu->cat_selection_ptr);
 
-   for (i = 0; i < xmb->num_categories; i++)
+   xmb_draw_state_thumbnail(xmb, gl);
+
+   xmb_category_window(xmb, &first, &last);
+
+   for (i = first; i < last; i++)
    {
+      const xmb_sprite_t *icon = NULL;
       xmb_node_t *node = i ? xmb_node_for_core(i-1) : &xmb->settings_node;
 
       if (!node)
          continue;
 
-      xmb_draw_icon(node->icon, 
+      /* Core icons which are not in yet show the generic one. */
+      icon = node->icon.tex ? &node->icon :
+         &xmb->textures[i ? XMB_TEXTURE_CORE : XMB_TEXTURE_SETTINGS].sprite;
+
+      xmb_draw_icon(icon, 
             xmb->x + xmb->categories_x + xmb->margin_left + xmb->hspacing*(i+1) - xmb->icon_size / 2.0,
             xmb->margin_top + xmb->icon_size / 2.0, 
             node->alpha, 
@@ -1001,6 +1749,12 @@ static void xmb_frame(void)
             node->zoom);
    }
 
+   xmb_draw_flush();
+
+   /* Message boxes go over all of it. */
+   if (gl->font_driver && gl->font_driver->flush)
+      gl->font_driver->flush(xmb->font);
+
 #ifdef GEKKO
    const char *message_queue;
 
@@ -1039,7 +1793,11 @@ static void xmb_frame(void)
 
 static void xmb_init_core_info(void *data)
 {
-   (void)data;
+   menu_handle_t *menu = (menu_handle_t*)data;
+
+   /* Pending requests point into nodes freed with the list. */
+   if (menu && menu->userdata)
+      xmb_texture_cancel((xmb_handle_t*)menu->userdata, NULL);
 
    core_info_list_free(g_extern.core_info);
    g_extern.core_info = NULL;
@@ -1136,6 +1894,35 @@ static void *xmb_init(void)
    xmb->label_margin_top = xmb->font_size/3.0;
    xmb->setting_margin_left = 600.0 * scale_factor;
 
+#ifdef HAVE_THREADS
+   {
+      sthread_pool_t *pool = rarch_get_thread_pool();
+
+      /* A pool without workers would only run the task
+       * once somebody waits for it. */
+      if (pool && sthread_pool_threads(pool) > 1)
+      {
+         xmb->jobs_lock  = slock_new();
+         xmb->jobs_group = sthread_group_new(pool);
+      }
+   }
+#endif
+
+   if (*g_settings.menu_image_cache_directory)
+      strlcpy(xmb->image_cache_dir, g_settings.menu_image_cache_directory,
+            sizeof(xmb->image_cache_dir));
+   else
+      rarch_cache_path(xmb->image_cache_dir, sizeof(xmb->image_cache_dir),
+            "image_cache");
+
+   if (*xmb->image_cache_dir && !path_is_directory(xmb->image_cache_dir)
+         && !path_mkdir(xmb->image_cache_dir))
+   {
+      RARCH_WARN("[XMB]: Cannot create image cache directory \"%s\".\n",
+            xmb->image_cache_dir);
+      *xmb->image_cache_dir = '\0';
+   }
+
    xmb_init_core_info(menu);
 
    xmb->num_categories = g_extern.core_info ? (g_extern.core_info->count + 1) : 1;
@@ -1147,6 +1934,9 @@ static void xmb_free(void *data)
 {
    menu_handle_t *menu = (menu_handle_t*)data;
 
+   if (menu->userdata)
+      xmb_texture_jobs_free((xmb_handle_t*)menu->userdata);
+
    if (g_extern.core_info)
       core_info_list_free(g_extern.core_info);
 
@@ -1182,18 +1972,14 @@ static bool xmb_font_init_first(const gl_font_renderer_t **font_driver,
 
 static void xmb_context_reset(void *data)
 {
-   int i, k;
+   int k;
    char bgpath[PATH_MAX_LENGTH];
    char mediapath[PATH_MAX_LENGTH], themepath[PATH_MAX_LENGTH], iconpath[PATH_MAX_LENGTH],
-         fontpath[PATH_MAX_LENGTH], core_id[PATH_MAX_LENGTH], texturepath[PATH_MAX_LENGTH],
-         content_texturepath[PATH_MAX_LENGTH];
+         fontpath[PATH_MAX_LENGTH];
 
-   core_info_t* info = NULL;
-   core_info_list_t* info_list = NULL;
    gl_t *gl = NULL;
    xmb_handle_t *xmb = NULL;
    menu_handle_t *menu = (menu_handle_t*)data;
-   xmb_node_t *node = NULL;
 
    if (!menu)
       return;
@@ -1258,55 +2044,22 @@ static void xmb_context_reset(void *data)
    fill_pathname_join(xmb->textures[XMB_TEXTURE_SWITCH_OFF].path, iconpath,
          "off.png", sizeof(xmb->textures[XMB_TEXTURE_SWITCH_OFF].path));
 
-   for (k = 0; k < XMB_TEXTURE_LAST; k++)
-      xmb->textures[k].id = xmb_png_texture_load(xmb->textures[k].path);
-
-   xmb->settings_node.icon = xmb->textures[XMB_TEXTURE_SETTINGS].id;
+   /* The background is drawn on its own, not as a sprite,
+    * over the whole window. */
+   xmb_texture_request(xmb, xmb->textures[XMB_TEXTURE_BG].path,
+         &xmb->textures[XMB_TEXTURE_BG].sprite, false,
+         gl->win_width, gl->win_height);
+   for (k = XMB_TEXTURE_BG + 1; k < XMB_TEXTURE_LAST; k++)
+      xmb_texture_request(xmb, xmb->textures[k].path,
+            &xmb->textures[k].sprite, true,
+            xmb->icon_size, xmb->icon_size);
+
+   /* Drawn from textures[XMB_TEXTURE_SETTINGS]. */
+   memset(&xmb->settings_node.icon, 0, sizeof(xmb->settings_node.icon));
    xmb->settings_node.alpha = xmb->c_active_alpha;
    xmb->settings_node.zoom = xmb->c_active_zoom;
 
-   info_list = (core_info_list_t*)g_extern.core_info;
-
-   if (!info_list)
-      return;
-
-   for (i = 1; i < xmb->num_categories; i++)
-   {
-      node = xmb_node_for_core(i-1);
-
-      fill_pathname_join(mediapath, g_settings.assets_directory,
-            "lakka", sizeof(mediapath));
-      fill_pathname_join(themepath, mediapath, XMB_THEME, sizeof(themepath));
-      fill_pathname_join(iconpath, themepath, xmb->icon_dir, sizeof(iconpath));
-      fill_pathname_slash(iconpath, sizeof(iconpath));
-
-      info = (core_info_t*)&info_list->list[i-1];
-
-      if (!info)
-         continue;
-
-      if (info->systemname)
-      {
-         char *tmp = xmb_str_replace(info->systemname, "/", " ");
-         strlcpy(core_id, tmp, sizeof(core_id));
-         free(tmp);
-      }
-      else
-         strlcpy(core_id, "default", sizeof(core_id));
-
-      strlcpy(texturepath, iconpath, sizeof(texturepath));
-      strlcat(texturepath, core_id, sizeof(texturepath));
-      strlcat(texturepath, ".png", sizeof(texturepath));
-
-      strlcpy(content_texturepath, iconpath, sizeof(content_texturepath));
-      strlcat(content_texturepath, core_id, sizeof(content_texturepath));
-      strlcat(content_texturepath, "-content.png", sizeof(content_texturepath));
-
-      node->alpha = i == xmb->active_category ? xmb->c_active_alpha : xmb->c_passive_alpha;
-      node->zoom = i == xmb->active_category ? xmb->c_active_zoom : xmb->c_passive_zoom;
-      node->icon = xmb_png_texture_load(texturepath);
-      node->content_icon = xmb_png_texture_load(content_texturepath);
-   }
+   xmb_core_icons_request(xmb);
 }
 
 static void xmb_navigation_clear(void *data, bool pending_push)
@@ -1407,13 +2160,24 @@ static void xmb_list_insert(void *data,
 static void xmb_list_delete(void *data, size_t idx,
       size_t list_size)
 {
+   xmb_node_t *node  = NULL;
    file_list_t *list = (file_list_t*)data;
 
    if (!list)
       return;
 
-   if (list->list[idx].userdata)
-      free(list->list[idx].userdata);
+   node = (xmb_node_t*)list->list[idx].userdata;
+
+   if (node)
+   {
+      /* A tween left running would write into freed memory. */
+      kill_tween(&node->alpha);
+      kill_tween(&node->label_alpha);
+      kill_tween(&node->zoom);
+      kill_tween(&node->x);
+      kill_tween(&node->y);
+      free(node);
+   }
    list->list[idx].userdata = NULL;
 }
 
@@ -1473,8 +2237,11 @@ static void xmb_context_destroy(void *data)
    if (!xmb)
       return;
 
+   /* Whatever is still pending belongs to the old context. */
+   xmb_texture_cancel(xmb, NULL);
+
    for (i = 0; i < XMB_TEXTURE_LAST; i++)
-      glDeleteTextures(1, &xmb->textures[i].id);
+      xmb_sprite_free(xmb, &xmb->textures[i].sprite);
 
    for (i = 1; i < xmb->num_categories; i++)
    {
@@ -1483,9 +2250,16 @@ static void xmb_context_destroy(void *data)
       if (!node)
          continue;
 
-      glDeleteTextures(1, &node->icon);
-      glDeleteTextures(1, &node->content_icon);
+      xmb_sprite_free(xmb, &node->icon);
+      xmb_sprite_free(xmb, &node->content_icon);
+      node->icons_requested = false;
    }
+
+   xmb_sprite_free(xmb, &xmb->state_thumb);
+   *xmb->state_thumb_path = '\0';
+
+   xmb_atlas_free(xmb);
+   xmb->batch.count = 0;
 }
 
 menu_ctx_driver_t menu_ctx_xmb = {
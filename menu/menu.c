@@ -17,10 +17,50 @@
 #include "menu.h"
 #include "menu_entries.h"
 #include "menu_shader.h"
+#include "menu_dir_cache.h"
+#include "menu_animation.h"
 #include "../dynamic.h"
 #include "../frontend/frontend.h"
 #include "../../retroarch.h"
 #include <file/file_path.h>
+#include "../performance.h"
+
+/* Drawing goes on at full rate for this long after
+ * the last input or animation. */
+#define MENU_IDLE_DELAY_USEC 1000000
+
+static retro_time_t menu_last_active;
+static retro_time_t menu_last_drawn;
+
+/**
+ * menu_frame_is_idle:
+ * @input                    : Input sample for this frame.
+ * @now                      : Current time.
+ *
+ * Nothing needs the menu to be drawn at full rate when the core
+ * is paused, no tween is running, and neither input, the mouse
+ * nor a message showed up for a while. Such frames are only
+ * drawn at menu_idle_fps.
+ *
+ * Returns: true (1) if drawing the frame can be left out.
+ **/
+static bool menu_frame_is_idle(retro_input_t input, retro_time_t now)
+{
+   menu_handle_t *menu = driver.menu;
+
+   if (!g_settings.menu.idle_fps || !g_settings.menu.pause_libretro
+         || input || tweens_active() || menu->keyboard.display
+         || menu->mouse.dx || menu->mouse.dy
+         || menu->mouse.left || menu->mouse.right
+         || menu->mouse.wheelup || menu->mouse.wheeldown
+         || (driver.current_msg && *driver.current_msg))
+      menu_last_active = now;
+
+   if (now - menu_last_active < MENU_IDLE_DELAY_USEC)
+      return false;
+
+   return now - menu_last_drawn < 1000000 / g_settings.menu.idle_fps;
+}
 
 /**
  ** draw_frame:
@@ -274,6 +314,8 @@ void menu_free(void *data)
    menu_list_free(menu->menu_list);
    menu->menu_list = NULL;
 
+   menu_dir_cache_free();
+
    rarch_main_command(RARCH_CMD_HISTORY_DEINIT);
 
    if (g_extern.core_info)
@@ -480,7 +522,21 @@ int menu_iterate(retro_input_t input,
       ret = driver.menu_ctx->backend->iterate(action);
 
    if (g_extern.is_menu)
-      draw_frame();
+   {
+      retro_time_t now = rarch_get_time_usec();
+
+      if (menu_frame_is_idle(input, now))
+      {
+         /* Nothing else blocks without a frame, so this
+          * keeps polling input at about the refresh rate. */
+         rarch_sleep(1000 / max(g_settings.video.refresh_rate, 1.0f));
+      }
+      else
+      {
+         menu_last_drawn = now;
+         draw_frame();
+      }
+   }
 
    if (driver.menu_ctx && driver.menu_ctx->input_postprocess)
       driver.menu_ctx->input_postprocess(input, old_input);
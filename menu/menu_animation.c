@@ -17,88 +17,180 @@
 #include "menu_animation.h"
 #include <math.h>
 
-static tween_t* tweens = NULL;
-static int numtweens = 0;
+/* Tweens are kept packed in the first count slots, a field to
+ * an array, so that updating them is one pass over each. A hash
+ * of their subjects finds the tween already running on a value,
+ * which is then re-targeted, so bursts of tweens on the same
+ * values never grow the pool. */
+#define TWEENS_MAX       2048
+#define TWEENS_HASH_SIZE (TWEENS_MAX * 2)
+#define TWEENS_HASH_MASK (TWEENS_HASH_SIZE - 1)
 
-static void tween_free(tween_t *tw)
+static struct
 {
-   if (tw)
-      free(tw);
-   tw = NULL;
+   float running_since[TWEENS_MAX];
+   float duration[TWEENS_MAX];
+   float initial_value[TWEENS_MAX];
+   float target_value[TWEENS_MAX];
+   float *subject[TWEENS_MAX];
+   easingFunc easing[TWEENS_MAX];
+   tweenCallback callback[TWEENS_MAX];
+   /* Hash slot of each tween. */
+   uint16_t slot[TWEENS_MAX];
+
+   /* Open addressing, one past the tween index, 0 if empty. */
+   uint16_t hash[TWEENS_HASH_SIZE];
+   unsigned count;
+} tweens;
+
+static unsigned tween_hash(const float *subject)
+{
+   return ((uint32_t)((uintptr_t)subject >> 2) * 2654435761u)
+      & TWEENS_HASH_MASK;
+}
+
+/* Slot holding the tween of @subject, or the empty one it would go in. */
+static unsigned tween_find(const float *subject)
+{
+   unsigned slot = tween_hash(subject);
+
+   while (tweens.hash[slot]
+         && tweens.subject[tweens.hash[slot] - 1] != subject)
+      slot = (slot + 1) & TWEENS_HASH_MASK;
+
+   return slot;
+}
+
+/**
+ * tween_remove:
+ * @index                    : index of the tween.
+ *
+ * Drops a tween, moving the last one into its place.
+ **/
+static void tween_remove(unsigned index)
+{
+   unsigned last = tweens.count - 1;
+   unsigned hole = tweens.slot[index];
+   unsigned slot = hole;
+
+   /* Moves the tweens probing past the hole back into it,
+    * so that lookups never stop short of them. */
+   tweens.hash[hole] = 0;
+   for (;;)
+   {
+      unsigned home;
+
+      slot = (slot + 1) & TWEENS_HASH_MASK;
+      if (!tweens.hash[slot])
+         break;
+
+      home = tween_hash(tweens.subject[tweens.hash[slot] - 1]);
+      if (((slot - home) & TWEENS_HASH_MASK) < ((slot - hole) & TWEENS_HASH_MASK))
+         continue;
+
+      tweens.hash[hole] = tweens.hash[slot];
+      tweens.slot[tweens.hash[hole] - 1] = hole;
+      tweens.hash[slot] = 0;
+      hole = slot;
+   }
+
+   if (index != last)
+   {
+      tweens.running_since[index] = tweens.running_since[last];
+      tweens.duration[index]      = tweens.duration[last];
+      tweens.initial_value[index] = tweens.initial_value[last];
+      tweens.target_value[index]  = tweens.target_value[last];
+      tweens.subject[index]       = tweens.subject[last];
+      tweens.easing[index]        = tweens.easing[last];
+      tweens.callback[index]      = tweens.callback[last];
+      tweens.slot[index]          = tweens.slot[last];
+      tweens.hash[tweens.slot[index]] = index + 1;
+   }
+
+   tweens.count = last;
 }
 
 void add_tween(float duration, float target_value, float* subject,
       easingFunc easing, tweenCallback callback)
 {
-   tween_t *tween = NULL;
-   tween_t *temp_tweens = (tween_t*)
-      realloc(tweens, (numtweens + 1) * sizeof(tween_t));
+   unsigned index;
+   unsigned slot = tween_find(subject);
 
-   if (temp_tweens)
+   if (tweens.hash[slot])
+      index = tweens.hash[slot] - 1;
+   else if (tweens.count < TWEENS_MAX)
    {
-      tweens = temp_tweens;
+      index              = tweens.count++;
+      tweens.hash[slot]  = index + 1;
+      tweens.slot[index] = slot;
    }
-   else /* Realloc failed. */
+   else
    {
-      tween_free(tweens);
+      /* No room left, it just gets there at once. */
+      *subject = target_value;
+      if (callback)
+         callback();
       return;
    }
 
-   numtweens++;
-   tween = (tween_t*)&tweens[numtweens-1];
+   tweens.running_since[index] = 0;
+   tweens.duration[index]      = duration;
+   tweens.initial_value[index] = *subject;
+   tweens.target_value[index]  = target_value;
+   tweens.subject[index]       = subject;
+   tweens.easing[index]        = easing;
+   tweens.callback[index]      = callback;
+}
 
-   if (!tween)
-      return;
+void kill_tween(float *subject)
+{
+   unsigned slot = tween_find(subject);
 
-   tween->alive = 1;
-   tween->duration = duration;
-   tween->running_since = 0;
-   tween->initial_value = *subject;
-   tween->target_value = target_value;
-   tween->subject = subject;
-   tween->easing = easing;
-   tween->callback = callback;
+   if (tweens.hash[slot])
+      tween_remove(tweens.hash[slot] - 1);
 }
 
-static void update_tween(tween_t *tween, float dt, int *active_tweens)
+void update_tweens(float dt)
 {
-   if (!tween)
-      return;
+   unsigned i;
 
-   if (tween->running_since >= tween->duration)
-      return;
+   for (i = 0; i < tweens.count; i++)
+   {
+      tweens.running_since[i] += dt;
+
+      if (tweens.easing[i])
+         *tweens.subject[i] = tweens.easing[i](
+               tweens.running_since[i],
+               tweens.initial_value[i],
+               tweens.target_value[i] - tweens.initial_value[i],
+               tweens.duration[i]);
+   }
 
-   tween->running_since += dt;
+   for (i = 0; i < tweens.count; )
+   {
+      tweenCallback callback;
 
-   if (tween->easing)
-      *tween->subject = tween->easing(
-            tween->running_since,
-            tween->initial_value,
-            tween->target_value - tween->initial_value,
-            tween->duration);
+      if (tweens.running_since[i] < tweens.duration[i])
+      {
+         i++;
+         continue;
+      }
 
-   if (tween->running_since >= tween->duration)
-   {
-      *tween->subject = tween->target_value;
+      *tweens.subject[i] = tweens.target_value[i];
+      callback           = tweens.callback[i];
 
-      if (tween->callback)
-         tween->callback();
-   }
+      /* Out of the pool first, the callback may well
+       * start another tween on the same value. */
+      tween_remove(i);
 
-   if (tween->running_since < tween->duration)
-      *active_tweens += 1;
+      if (callback)
+         callback();
+   }
 }
 
-void update_tweens(float dt)
+int tweens_active(void)
 {
-   int i;
-   int active_tweens = 0;
-
-   for(i = 0; i < numtweens; i++)
-      update_tween(&tweens[i], dt, &active_tweens);
-
-   if (!active_tweens)
-      numtweens = 0;
+   return tweens.count;
 }
 
 // linear
@@ -27,23 +27,22 @@ extern "C" {
 typedef float (*easingFunc)(float, float, float, float);
 typedef void  (*tweenCallback) (void);
 
-typedef struct
-{
-   int    alive;
-   float  duration;
-   float  running_since;
-   float  initial_value;
-   float  target_value;
-   float* subject;
-   easingFunc easing;
-   tweenCallback callback;
-} tween_t;
-
+/* Tweens *subject to target_value over duration. A tween still
+ * running on subject is re-targeted instead, from where subject
+ * is at, and its callback dropped. */
 void add_tween(float duration, float target_value, float* subject,
       easingFunc easing, tweenCallback callback);
 
+/* Stops the tween running on subject, if any, leaving subject
+ * where it is. For values about to be freed. */
+void kill_tween(float *subject);
+
 void update_tweens(float dt);
 
+/* Non-zero while tweens are still running, which means the
+ * menu has to keep being drawn. */
+int tweens_active(void);
+
 /* from https://github.com/kikito/tween.lua/blob/master/tween.lua */
 
 float linear(float t, float b, float c, float d);
@@ -0,0 +1,503 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <file/dir_list.h>
+
+#include "menu_dir_cache.h"
+#include "menu_list.h"
+#include "../performance.h"
+
+#if defined(__linux__)
+#define HAVE_DIR_CACHE_INOTIFY
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define DIR_CACHE_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM \
+      | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+/* Current folder plus a few parents, which is what going
+ * back and forth in the file browser touches. */
+#define DIR_CACHE_SIZE 4
+
+typedef struct dir_cache_entry
+{
+   char dir[PATH_MAX_LENGTH];
+   char *exts;
+   struct string_list *list;
+
+   /* Directory mtime when it was read. */
+   time_t mtime;
+   long mtime_nsec;
+
+   bool stale;
+   /* inotify watch, 0 if there is none. */
+   int watch;
+   unsigned last_used;
+   /* Accounted to RARCH_MEM_MENU. */
+   size_t mem_size;
+} dir_cache_entry_t;
+
+static dir_cache_entry_t dir_cache[DIR_CACHE_SIZE];
+static unsigned dir_cache_clock;
+
+/* Menu lists going back a few levels. */
+#define LIST_CACHE_SIZE 4
+/* Directories a single list can depend on. */
+#define LIST_CACHE_DIRS 64
+
+typedef struct list_cache_dir
+{
+   char *dir;
+   time_t mtime;
+   long mtime_nsec;
+} list_cache_dir_t;
+
+typedef struct list_cache_item
+{
+   char *path;
+   char *label;
+   char *alt;
+   unsigned type;
+} list_cache_item_t;
+
+typedef struct list_cache_entry
+{
+   char *key;
+   unsigned generation;
+   list_cache_item_t *items;
+   size_t size;
+   list_cache_dir_t *dirs;
+   size_t num_dirs;
+   unsigned last_used;
+   /* Accounted to RARCH_MEM_MENU. */
+   size_t mem_size;
+} list_cache_entry_t;
+
+static list_cache_entry_t list_cache[LIST_CACHE_SIZE];
+
+/* Directories the list being built depends on so far. */
+static list_cache_dir_t list_cache_pending[LIST_CACHE_DIRS];
+static size_t list_cache_num_pending;
+static bool list_cache_pending_valid;
+
+#ifdef HAVE_DIR_CACHE_INOTIFY
+static int dir_cache_notify = -1;
+#endif
+
+static bool dir_cache_stat(const char *dir, time_t *mtime, long *nsec)
+{
+#ifndef RARCH_CONSOLE
+   struct stat st;
+
+   if (stat(dir, &st) != 0)
+      return false;
+
+   *mtime = st.st_mtime;
+#if defined(__linux__)
+   *nsec  = st.st_mtim.tv_nsec;
+#else
+   *nsec  = 0;
+#endif
+   return true;
+#else
+   return false;
+#endif
+}
+
+static void dir_cache_entry_free(dir_cache_entry_t *entry)
+{
+#ifdef HAVE_DIR_CACHE_INOTIFY
+   unsigned i;
+
+   /* Listings of one directory with other filters share the watch. */
+   if (entry->watch > 0)
+   {
+      for (i = 0; i < DIR_CACHE_SIZE; i++)
+         if (&dir_cache[i] != entry && dir_cache[i].list
+               && dir_cache[i].watch == entry->watch)
+            break;
+
+      if (i == DIR_CACHE_SIZE)
+         inotify_rm_watch(dir_cache_notify, entry->watch);
+   }
+#endif
+
+   rarch_mem_sub(RARCH_MEM_MENU, entry->mem_size);
+   dir_list_free(entry->list);
+   free(entry->exts);
+   memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * dir_cache_poll:
+ *
+ * Marks the listings of directories which inotify saw
+ * change as stale.
+ **/
+static void dir_cache_poll(void)
+{
+#ifdef HAVE_DIR_CACHE_INOTIFY
+   char buf[4096];
+   ssize_t len;
+   unsigned i;
+
+   if (dir_cache_notify < 0)
+      return;
+
+   while ((len = read(dir_cache_notify, buf, sizeof(buf))) > 0)
+   {
+      ssize_t pos = 0;
+
+      while (pos < len)
+      {
+         const struct inotify_event *event =
+            (const struct inotify_event*)&buf[pos];
+
+         for (i = 0; i < DIR_CACHE_SIZE; i++)
+            if (dir_cache[i].list && (event->mask & IN_Q_OVERFLOW
+                     || dir_cache[i].watch == event->wd))
+               dir_cache[i].stale = true;
+
+         pos += sizeof(*event) + event->len;
+      }
+   }
+#endif
+}
+
+static bool dir_cache_entry_matches(const dir_cache_entry_t *entry,
+      const char *dir, const char *exts)
+{
+   if (!entry->list || strcmp(entry->dir, dir))
+      return false;
+   if (!entry->exts || !exts)
+      return entry->exts == exts;
+   return !strcmp(entry->exts, exts);
+}
+
+static int dir_cache_watch(const char *dir)
+{
+#ifdef HAVE_DIR_CACHE_INOTIFY
+   int watch;
+
+   if (dir_cache_notify < 0)
+   {
+      dir_cache_notify = inotify_init();
+      if (dir_cache_notify < 0)
+         return 0;
+      fcntl(dir_cache_notify, F_SETFL,
+            fcntl(dir_cache_notify, F_GETFL) | O_NONBLOCK);
+      fcntl(dir_cache_notify, F_SETFD, FD_CLOEXEC);
+   }
+
+   watch = inotify_add_watch(dir_cache_notify, dir, DIR_CACHE_EVENTS);
+   return watch > 0 ? watch : 0;
+#else
+   (void)dir;
+   return 0;
+#endif
+}
+
+struct string_list *menu_dir_cache_list(const char *dir, const char *exts)
+{
+   unsigned i;
+   bool has_time;
+   time_t mtime  = 0;
+   long nsec     = 0;
+   dir_cache_entry_t *entry = &dir_cache[0];
+
+   dir_cache_poll();
+   dir_cache_clock++;
+
+   for (i = 0; i < DIR_CACHE_SIZE; i++)
+   {
+      if (dir_cache_entry_matches(&dir_cache[i], dir, exts))
+      {
+         entry = &dir_cache[i];
+         break;
+      }
+
+      if (dir_cache[i].last_used < entry->last_used)
+         entry = &dir_cache[i];
+   }
+
+   /* A watched directory would have been marked stale, so
+    * there is no need to go to the file system at all. */
+   if (i < DIR_CACHE_SIZE && entry->watch > 0 && !entry->stale)
+   {
+      entry->last_used = dir_cache_clock;
+      return entry->list;
+   }
+
+   has_time = dir_cache_stat(dir, &mtime, &nsec);
+
+   if (i < DIR_CACHE_SIZE && has_time && !entry->stale
+         && entry->mtime == mtime && entry->mtime_nsec == nsec)
+   {
+      entry->last_used = dir_cache_clock;
+      return entry->list;
+   }
+
+   dir_cache_entry_free(entry);
+
+   /* Watched before reading, so nothing changing
+    * in between goes unnoticed. */
+   entry->watch = dir_cache_watch(dir);
+
+   if (!(entry->list = dir_list_new(dir, exts, true)))
+   {
+      dir_cache_entry_free(entry);
+      return NULL;
+   }
+
+   dir_list_sort(entry->list, true);
+
+   entry->mem_size = entry->list->cap * sizeof(*entry->list->elems);
+   for (i = 0; i < entry->list->size; i++)
+      entry->mem_size += strlen(entry->list->elems[i].data) + 1;
+   rarch_mem_add(RARCH_MEM_MENU, entry->mem_size);
+
+   strlcpy(entry->dir, dir, sizeof(entry->dir));
+   entry->exts       = exts ? strdup(exts) : NULL;
+   entry->mtime      = mtime;
+   entry->mtime_nsec = nsec;
+   entry->last_used  = dir_cache_clock;
+
+   /* Without a watch only the mtime tells changes apart, and
+    * some file systems only keep it to the second. A change
+    * later in the second it was read would go unnoticed. */
+   entry->stale      = !has_time ||
+      (!entry->watch && mtime >= time(NULL));
+
+   return entry->list;
+}
+
+static void list_cache_entry_free(list_cache_entry_t *entry)
+{
+   size_t i;
+
+   for (i = 0; i < entry->size; i++)
+   {
+      free(entry->items[i].path);
+      free(entry->items[i].label);
+      free(entry->items[i].alt);
+   }
+   for (i = 0; i < entry->num_dirs; i++)
+      free(entry->dirs[i].dir);
+
+   rarch_mem_sub(RARCH_MEM_MENU, entry->mem_size);
+   free(entry->items);
+   free(entry->dirs);
+   free(entry->key);
+   memset(entry, 0, sizeof(*entry));
+}
+
+static void list_cache_pending_clear(void)
+{
+   size_t i;
+
+   for (i = 0; i < list_cache_num_pending; i++)
+      free(list_cache_pending[i].dir);
+
+   list_cache_num_pending   = 0;
+   list_cache_pending_valid = true;
+}
+
+static bool list_cache_entry_valid(const list_cache_entry_t *entry,
+      unsigned generation)
+{
+   size_t i;
+
+   if (entry->generation != generation)
+      return false;
+
+   for (i = 0; i < entry->num_dirs; i++)
+   {
+      time_t mtime = 0;
+      long nsec    = 0;
+
+      if (!dir_cache_stat(entry->dirs[i].dir, &mtime, &nsec)
+            || mtime != entry->dirs[i].mtime
+            || nsec != entry->dirs[i].mtime_nsec)
+         return false;
+   }
+
+   return true;
+}
+
+bool menu_list_cache_restore(file_list_t *list, const char *key,
+      unsigned generation)
+{
+   size_t i;
+   list_cache_entry_t *entry = NULL;
+
+   list_cache_pending_clear();
+   dir_cache_clock++;
+
+   for (i = 0; i < LIST_CACHE_SIZE; i++)
+      if (list_cache[i].key && !strcmp(list_cache[i].key, key))
+         entry = &list_cache[i];
+
+   if (!entry)
+      return false;
+
+   if (!list_cache_entry_valid(entry, generation))
+   {
+      list_cache_entry_free(entry);
+      return false;
+   }
+
+   for (i = 0; i < entry->size; i++)
+   {
+      const list_cache_item_t *item = &entry->items[i];
+
+      menu_list_push(list, item->path, item->label, item->type, 0);
+      if (item->alt)
+         file_list_set_alt_at_offset(list, list->size - 1, item->alt);
+   }
+
+   entry->last_used = dir_cache_clock;
+   return true;
+}
+
+void menu_list_cache_depend(const char *dir)
+{
+   list_cache_dir_t *pending = NULL;
+
+   if (!list_cache_pending_valid)
+      return;
+
+   /* Left uncached rather than missing a change. */
+   if (list_cache_num_pending == LIST_CACHE_DIRS)
+   {
+      list_cache_pending_valid = false;
+      return;
+   }
+
+   pending = &list_cache_pending[list_cache_num_pending];
+   if (!dir_cache_stat(dir, &pending->mtime, &pending->mtime_nsec)
+         || pending->mtime >= time(NULL))
+   {
+      /* Same as for listings, a change later in the second
+       * would go unnoticed with a coarse mtime. */
+      list_cache_pending_valid = false;
+      return;
+   }
+
+   pending->dir = strdup(dir);
+   list_cache_num_pending++;
+}
+
+void menu_list_cache_store(const file_list_t *list, const char *key,
+      unsigned generation)
+{
+   size_t i;
+   list_cache_entry_t *entry = &list_cache[0];
+
+   if (!list_cache_pending_valid)
+   {
+      list_cache_pending_clear();
+      return;
+   }
+
+   for (i = 0; i < LIST_CACHE_SIZE; i++)
+   {
+      if (list_cache[i].key && !strcmp(list_cache[i].key, key))
+      {
+         entry = &list_cache[i];
+         break;
+      }
+
+      if (list_cache[i].last_used < entry->last_used)
+         entry = &list_cache[i];
+   }
+
+   list_cache_entry_free(entry);
+
+   entry->items = (list_cache_item_t*)calloc(list->size + 1,
+         sizeof(*entry->items));
+   entry->dirs  = (list_cache_dir_t*)calloc(list_cache_num_pending + 1,
+         sizeof(*entry->dirs));
+   entry->key   = strdup(key);
+   if (!entry->items || !entry->dirs || !entry->key)
+   {
+      list_cache_entry_free(entry);
+      list_cache_pending_clear();
+      return;
+   }
+
+   entry->mem_size = list->size * sizeof(*entry->items) +
+      list_cache_num_pending * sizeof(*entry->dirs) + strlen(key) + 1;
+
+   for (i = 0; i < list->size; i++)
+   {
+      const struct item_file *file = &list->list[i];
+      list_cache_item_t *item      = &entry->items[i];
+
+      item->path  = file->path  ? strdup(file->path)  : NULL;
+      item->label = file->label ? strdup(file->label) : NULL;
+      item->alt   = file->alt   ? strdup(file->alt)   : NULL;
+      item->type  = file->type;
+
+      entry->mem_size += (item->path  ? strlen(item->path)  + 1 : 0)
+         + (item->label ? strlen(item->label) + 1 : 0)
+         + (item->alt   ? strlen(item->alt)   + 1 : 0);
+   }
+   entry->size = list->size;
+
+   /* The pending directories are handed over as they are. */
+   memcpy(entry->dirs, list_cache_pending,
+         list_cache_num_pending * sizeof(*entry->dirs));
+   entry->num_dirs        = list_cache_num_pending;
+   list_cache_num_pending = 0;
+
+   for (i = 0; i < entry->num_dirs; i++)
+      entry->mem_size += strlen(entry->dirs[i].dir) + 1;
+
+   entry->generation = generation;
+   entry->last_used  = dir_cache_clock;
+   rarch_mem_add(RARCH_MEM_MENU, entry->mem_size);
+}
+
+void menu_dir_cache_free(void)
+{
+   unsigned i;
+
+   for (i = 0; i < DIR_CACHE_SIZE; i++)
+      if (dir_cache[i].list)
+         dir_cache_entry_free(&dir_cache[i]);
+
+   for (i = 0; i < LIST_CACHE_SIZE; i++)
+      if (list_cache[i].key)
+         list_cache_entry_free(&list_cache[i]);
+   list_cache_pending_clear();
+
+#ifdef HAVE_DIR_CACHE_INOTIFY
+   if (dir_cache_notify >= 0)
+      close(dir_cache_notify);
+   dir_cache_notify = -1;
+#endif
+}
@@ -0,0 +1,90 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_DIR_CACHE_H
+#define _MENU_DIR_CACHE_H
+
+#include <string/string_list.h>
+#include <file/file_list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * menu_dir_cache_list:
+ * @dir          : directory path.
+ * @exts         : allowed extensions, or NULL for all files.
+ *
+ * Gets the listing of @dir, directories included and sorted
+ * first, as dir_list_new() and dir_list_sort() would make it.
+ * The last few listings are kept, and only read again once
+ * the directory changed.
+ *
+ * Returns: listing owned by the cache, valid until the next
+ * call, or NULL in case of error.
+ **/
+struct string_list *menu_dir_cache_list(const char *dir, const char *exts);
+
+/**
+ * menu_list_cache_restore:
+ * @list         : menu list, cleared.
+ * @key          : what the list was made out of.
+ * @generation   : generation of the data it was made out of.
+ *
+ * Pushes the entries of the list last stored for @key onto
+ * @list, provided it was stored with the same @generation and
+ * none of the directories it was made out of changed since.
+ * Otherwise the list is to be built, and the directories it is
+ * built out of given to menu_list_cache_depend() on the way.
+ *
+ * Returns: true if @list was filled in, otherwise false.
+ **/
+bool menu_list_cache_restore(file_list_t *list, const char *key,
+      unsigned generation);
+
+/**
+ * menu_list_cache_depend:
+ * @dir          : directory path.
+ *
+ * Notes that the list being built is made out of the contents
+ * of @dir, so that it is built again once @dir changes.
+ **/
+void menu_list_cache_depend(const char *dir);
+
+/**
+ * menu_list_cache_store:
+ * @list         : menu list just built.
+ * @key          : what the list was made out of.
+ * @generation   : generation of the data it was made out of.
+ *
+ * Keeps a copy of the entries of @list, for
+ * menu_list_cache_restore() to bring back.
+ **/
+void menu_list_cache_store(const file_list_t *list, const char *key,
+      unsigned generation);
+
+/**
+ * menu_dir_cache_free:
+ *
+ * Drops all cached listings and lists.
+ **/
+void menu_dir_cache_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
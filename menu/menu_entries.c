@@ -19,6 +19,7 @@
 #include <file/file_path.h>
 #include "../file_ops.h"
 #include <file/dir_list.h>
+#include "menu_dir_cache.h"
 
 void menu_entries_refresh(file_list_t *list)
 {
@@ -191,6 +192,7 @@ static void menu_entries_content_list_push(
    if (!info)
       return;
 
+   menu_list_cache_depend(path);
    str_list = (struct string_list*)dir_list_new(path, info->supported_extensions, true);
 
    dir_list_sort(str_list, true);
@@ -235,7 +237,21 @@ int menu_entries_push_horizontal_menu_list(menu_handle_t *menu,
       return -1;
 
    if (!info->supports_no_game)
-      menu_entries_content_list_push(list, info, g_settings.content_directory);
+   {
+      char key[PATH_MAX_LENGTH * 2];
+
+      /* Walking the content directory again is only needed
+       * once something in it changed. */
+      snprintf(key, sizeof(key), "content:%s:%s",
+            info->path ? info->path : "", g_settings.content_directory);
+
+      if (!menu_list_cache_restore(list, key, 0))
+      {
+         menu_entries_content_list_push(list, info,
+               g_settings.content_directory);
+         menu_list_cache_store(list, key, 0);
+      }
+   }
    else
       menu_list_push(
             list,
@@ -385,17 +401,18 @@ int menu_entries_parse_list(
    push_dir           = (setting && setting->browser_selection_type == ST_DIR);
 
    if (path_is_compressed)
+   {
       str_list = compressed_file_list_new(dir,exts);
+      dir_list_sort(str_list, true);
+   }
    else
-      str_list = dir_list_new(dir,
+      str_list = menu_dir_cache_list(dir,
             g_settings.menu.navigation.browser.filter.supported_extensions_enable 
-            ? exts : NULL, true);
+            ? exts : NULL);
 
    if (!str_list)
       return -1;
 
-   dir_list_sort(str_list, true);
-
    if (push_dir)
       menu_list_push(list, "<Use this directory>", "",
             MENU_FILE_USE_DIRECTORY, 0);
@@ -471,7 +488,9 @@ int menu_entries_parse_list(
             file_type, 0);
    }
 
-   string_list_free(str_list);
+   /* Listings from the cache stay with it. */
+   if (path_is_compressed)
+      string_list_free(str_list);
 
    if (!strcmp(label, "core_list"))
    {
@@ -20,11 +20,13 @@
 #include "menu_input.h"
 #include "menu_entries.h"
 #include "menu_shader.h"
+#include "menu_dir_cache.h"
 
 #include "../file_ext.h"
 #include "../config.def.h"
 #include "../cheats.h"
 #include "../retroarch.h"
+#include "../performance.h"
 
 #ifdef GEKKO
 enum
@@ -1106,6 +1108,8 @@ static int action_toggle_save_state(unsigned type, const char *label,
          break;
    }
 
+   rarch_main_command(RARCH_CMD_PREFETCH_STATE);
+
    return 0;
 }
 
@@ -1729,6 +1733,34 @@ static int deferred_push_core_information(void *data, void *userdata,
    return 0;
 }
 
+static int deferred_push_memory_information(void *data, void *userdata,
+      const char *path, const char *label, unsigned type)
+{
+   unsigned i;
+   file_list_t *list      = (file_list_t*)data;
+   file_list_t *menu_list = (file_list_t*)userdata;
+
+   if (!list || !menu_list)
+      return -1;
+
+   menu_list_clear(list);
+
+   /* Ends with the total, RARCH_MEM_LAST. */
+   for (i = 0; i <= RARCH_MEM_LAST; i++)
+   {
+      char tmp[PATH_MAX_LENGTH];
+
+      rarch_mem_summary((enum rarch_mem_tag)i, tmp, sizeof(tmp));
+      menu_list_push(list, tmp, "",
+            MENU_SETTINGS_CORE_INFO_NONE, 0);
+   }
+
+   if (driver.menu_ctx && driver.menu_ctx->populate_entries)
+      driver.menu_ctx->populate_entries(driver.menu, path, label, type);
+
+   return 0;
+}
+
 static int deferred_push_performance_counters(void *data, void *userdata,
       const char *path, const char *label, unsigned type)
 {
@@ -1822,8 +1854,10 @@ static int deferred_push_settings(void *data, void *userdata,
    if (!list || !menu_list)
       return -1;
 
-   settings_list_free(driver.menu->list_settings);
-   driver.menu->list_settings = (rarch_setting_t *)setting_data_new(SL_FLAG_ALL_SETTINGS);
+   /* The groups are the same in every list, there is
+    * no need to build a fresh one to list them. */
+   if (!driver.menu->list_settings)
+      driver.menu->list_settings = (rarch_setting_t *)setting_data_new(SL_FLAG_ALL_SETTINGS);
    rarch_setting_t *setting = (rarch_setting_t*)setting_data_find_setting(driver.menu->list_settings,
          "Driver Options");
 
@@ -1851,8 +1885,13 @@ static int deferred_push_category(void *data, void *userdata,
    if (!list || !menu_list)
       return -1;
 
-   settings_list_free(driver.menu->list_settings);
-   driver.menu->list_settings = (rarch_setting_t *)setting_data_new(SL_FLAG_ALL_SETTINGS);
+   /* Only the input binds depend on the core and the number of
+    * users, every other group is the same in every list. */
+   if (!driver.menu->list_settings || !strcmp(label, "Input Options"))
+   {
+      settings_list_free(driver.menu->list_settings);
+      driver.menu->list_settings = (rarch_setting_t *)setting_data_new(SL_FLAG_ALL_SETTINGS);
+   }
    rarch_setting_t *setting = (rarch_setting_t*)setting_data_find_setting(
          driver.menu->list_settings, label);
 
@@ -2171,6 +2210,12 @@ static int deferred_push_history_list(void *data, void *userdata,
       return -1;
 
    menu_list_clear(list);
+
+   /* Going through the entries reads them from the file. */
+   if (menu_list_cache_restore(list, "history",
+            content_playlist_generation(g_defaults.history)))
+      goto end;
+
    list_size = content_playlist_size(g_defaults.history);
 
    for (i = 0; i < list_size; i++)
@@ -2194,6 +2239,10 @@ static int deferred_push_history_list(void *data, void *userdata,
             MENU_FILE_PLAYLIST_ENTRY, 0);
    }
 
+   menu_list_cache_store(list, "history",
+         content_playlist_generation(g_defaults.history));
+
+end:
    driver.menu->scroll_indices_size = 0;
    menu_entries_build_scroll_indices(list);
    menu_entries_refresh(list);
@@ -2651,6 +2700,7 @@ static void menu_entries_cbs_init_bind_ok(menu_file_list_cbs_t *cbs,
          !strcmp(label, "core_cheat_options") ||
          !strcmp(label, "core_input_remapping_options") ||
          !strcmp(label, "core_information") ||
+         !strcmp(label, "memory_information") ||
          !strcmp(label, "disk_options") ||
          !strcmp(label, "settings") ||
          !strcmp(label, "performance_counters") ||
@@ -2715,6 +2765,7 @@ static void menu_entries_cbs_init_bind_toggle(menu_file_list_cbs_t *cbs,
          !strcmp(label, "configurations") ||
          !strcmp(label, "quit_retroarch") ||
          !strcmp(label, "core_information") ||
+         !strcmp(label, "memory_information") ||
          !strcmp(label, "settings") ||
          !strcmp(label, "help") ||
          !strcmp(label, "resume_content") ||
@@ -2790,6 +2841,8 @@ static void menu_entries_cbs_init_bind_deferred_push(menu_file_list_cbs_t *cbs,
       cbs->action_deferred_push = deferred_push_core_list_deferred;
    else if (!strcmp(label, "core_information"))
       cbs->action_deferred_push = deferred_push_core_information;
+   else if (!strcmp(label, "memory_information"))
+      cbs->action_deferred_push = deferred_push_memory_information;
    else if (!strcmp(label, "performance_counters"))
       cbs->action_deferred_push = deferred_push_performance_counters;
    else if (!strcmp(label, "core_counters"))
@@ -1,7 +1,7 @@
 /*  RetroArch - A frontend for libretro.
  *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
  *  Copyright (C) 2011-2015 - Daniel De Matteis
- * 
+ *
  *  RetroArch is free software: you can redistribute it and/or modify it under the terms
  *  of the GNU General Public License as published by the Free Software Found-
  *  ation, either version 3 of the License, or (at your option) any later version.
@@ -22,16 +22,39 @@
 #include "general.h"
 #include "dynamic.h"
 
+/* Sanity limit for input values in one BSV2 frame. */
+#define BSV2_MAX_FRAME_INPUTS (1 << 20)
+
+/* stdio buffer of the movie file. Recording writes a chunk per
+ * frame at most, this keeps those to a few actual writes a minute. */
+#define BSV_FILE_BUFFER_SIZE (1 << 18)
+
+/* BSV1 input values read ahead at a time while playing back. */
+#define BSV1_READ_AHEAD (1 << 15)
+
+struct bsv_keyframe
+{
+   uint32_t frame;
+   uint32_t offset;
+};
+
 struct bsv_movie
 {
    FILE *file;
 
-   /* A ring buffer keeping track of positions
+   /* BSV1: A ring buffer keeping track of positions
     * in the file for each frame. */
    size_t *frame_pos;
    size_t frame_mask;
    size_t frame_ptr;
 
+   /* BSV1: Input read ahead from the file, which starts
+    * at file offset read_base. */
+   int16_t *read_buf;
+   size_t read_count;
+   size_t read_ptr;
+   long read_base;
+
    size_t min_file_pos;
 
    size_t state_size;
@@ -40,12 +63,415 @@ struct bsv_movie
    bool playback;
    bool first_rewind;
    bool did_rewind;
+
+   /* BSV2: Frames are addressed by number, keyframes
+    * tell where to start looking for one. */
+   bool bsv2;
+   bool ended;
+   uint32_t frame;
+   struct bsv_keyframe *keyframes;
+   size_t keyframes_count;
+   size_t keyframes_cap;
+
+   /* Input of the frame being recorded. */
+   int16_t *input;
+   uint32_t input_count;
+   uint32_t input_cap;
+
+   /* Input of the last 'F' chunk, which is what is played back,
+    * and what recorded frames are compared against. */
+   int16_t *last;
+   uint32_t last_count;
+   uint32_t last_cap;
+   uint32_t last_ptr;
+   bool last_valid;
+
+   /* Recording: repeats of last which are not written yet.
+    * Playback: repeats of last which are still to be played. */
+   uint32_t repeat;
 };
 
+static bool bsv2_write_u32(FILE *file, uint32_t val)
+{
+   val = swap_if_big32(val);
+   return fwrite(&val, sizeof(val), 1, file) == 1;
+}
+
+static bool bsv2_read_u32(FILE *file, uint32_t *val)
+{
+   if (fread(val, sizeof(*val), 1, file) != 1)
+      return false;
+   *val = swap_if_big32(*val);
+   return true;
+}
+
+static bool bsv2_reserve(int16_t **buf, uint32_t *cap, uint32_t count)
+{
+   int16_t *tmp;
+   uint32_t new_cap = *cap ? *cap : 64;
+
+   if (count <= *cap)
+      return true;
+
+   while (new_cap < count)
+      new_cap *= 2;
+
+   tmp = (int16_t*)realloc(*buf, new_cap * sizeof(int16_t));
+   if (!tmp)
+      return false;
+
+   *buf = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+static bool bsv2_add_keyframe(bsv_movie_t *handle,
+      uint32_t frame, uint32_t offset)
+{
+   if (handle->keyframes_count == handle->keyframes_cap)
+   {
+      size_t cap = handle->keyframes_cap ? handle->keyframes_cap * 2 : 64;
+      struct bsv_keyframe *tmp = (struct bsv_keyframe*)
+         realloc(handle->keyframes, cap * sizeof(*tmp));
+
+      if (!tmp)
+         return false;
+
+      handle->keyframes     = tmp;
+      handle->keyframes_cap = cap;
+   }
+
+   handle->keyframes[handle->keyframes_count].frame  = frame;
+   handle->keyframes[handle->keyframes_count].offset = offset;
+   handle->keyframes_count++;
+   return true;
+}
+
+/* Last keyframe at or before frame. There is always one for frame 0. */
+static const struct bsv_keyframe *bsv2_find_keyframe(
+      const bsv_movie_t *handle, uint32_t frame)
+{
+   size_t lo = 0, hi = handle->keyframes_count;
+
+   while (hi - lo > 1)
+   {
+      size_t mid = (lo + hi) / 2;
+      if (handle->keyframes[mid].frame <= frame)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   return &handle->keyframes[lo];
+}
+
+/* Reads the next chunk into handle. Keyframes are skipped over.
+ * Returns the chunk tag, BSV2_CHUNK_END on the end or on errors. */
+static int bsv2_read_chunk(bsv_movie_t *handle)
+{
+   uint32_t i, count, size;
+   int tag = fgetc(handle->file);
+
+   switch (tag)
+   {
+      case BSV2_CHUNK_FRAME:
+         if (!bsv2_read_u32(handle->file, &count)
+               || count > BSV2_MAX_FRAME_INPUTS
+               || !bsv2_reserve(&handle->last, &handle->last_cap, count)
+               || fread(handle->last, sizeof(int16_t),
+                  count, handle->file) != count)
+            break;
+
+         for (i = 0; i < count; i++)
+            handle->last[i] = swap_if_big16(handle->last[i]);
+
+         handle->last_count = count;
+         handle->last_valid = true;
+         return tag;
+
+      case BSV2_CHUNK_REPEAT:
+         if (!bsv2_read_u32(handle->file, &count) || !handle->last_valid)
+            break;
+
+         handle->repeat = count;
+         return tag;
+
+      case BSV2_CHUNK_KEYFRAME:
+         if (!bsv2_read_u32(handle->file, &count)
+               || !bsv2_read_u32(handle->file, &size)
+               || fseek(handle->file, size, SEEK_CUR) != 0)
+            break;
+
+         handle->last_valid = false;
+         return tag;
+   }
+
+   return BSV2_CHUNK_END;
+}
+
+/* Playback: makes the input of the next frame current. */
+static bool bsv2_read_frame(bsv_movie_t *handle)
+{
+   handle->last_ptr = 0;
+
+   while (!handle->repeat)
+   {
+      switch (bsv2_read_chunk(handle))
+      {
+         case BSV2_CHUNK_FRAME:
+            return true;
+         case BSV2_CHUNK_END:
+            return false;
+      }
+   }
+
+   handle->repeat--;
+   return true;
+}
+
+static void bsv2_flush_repeat(bsv_movie_t *handle)
+{
+   if (!handle->repeat)
+      return;
+
+   fputc(BSV2_CHUNK_REPEAT, handle->file);
+   bsv2_write_u32(handle->file, handle->repeat);
+   handle->repeat = 0;
+}
+
+static void bsv2_write_frame(bsv_movie_t *handle)
+{
+   uint32_t i;
+   int16_t *tmp;
+   uint32_t tmp_cap;
+
+   fputc(BSV2_CHUNK_FRAME, handle->file);
+   bsv2_write_u32(handle->file, handle->input_count);
+
+   for (i = 0; i < handle->input_count; i++)
+      handle->input[i] = swap_if_big16(handle->input[i]);
+   fwrite(handle->input, sizeof(int16_t), handle->input_count, handle->file);
+   for (i = 0; i < handle->input_count; i++)
+      handle->input[i] = swap_if_big16(handle->input[i]);
+
+   /* This frame is what the next ones are compared against. */
+   tmp                = handle->last;
+   tmp_cap            = handle->last_cap;
+   handle->last       = handle->input;
+   handle->last_cap   = handle->input_cap;
+   handle->last_count = handle->input_count;
+   handle->last_valid = true;
+   handle->input      = tmp;
+   handle->input_cap  = tmp_cap;
+}
+
+static void bsv2_write_keyframe(bsv_movie_t *handle)
+{
+   long offset = ftell(handle->file);
+
+   if (!handle->state_size || offset < 0
+         || pretro_serialize_size() != handle->state_size
+         || !pretro_serialize(handle->state, handle->state_size))
+      return;
+
+   if (!bsv2_add_keyframe(handle, handle->frame, offset))
+      return;
+
+   fputc(BSV2_CHUNK_KEYFRAME, handle->file);
+   bsv2_write_u32(handle->file, handle->frame);
+   bsv2_write_u32(handle->file, handle->state_size);
+   fwrite(handle->state, 1, handle->state_size, handle->file);
+
+   /* Keyframes must not depend on what came before. */
+   handle->last_valid = false;
+}
+
+/* Puts the stream at the start of frame target.
+ * When recording, everything from there on is dropped. */
+static bool bsv2_position(bsv_movie_t *handle, uint32_t target)
+{
+   const struct bsv_keyframe *keyframe = bsv2_find_keyframe(handle, target);
+   uint32_t frame     = keyframe->frame;
+   uint32_t run_first = 0;
+   long run_offset    = 0;
+
+   if (fseek(handle->file, keyframe->offset, SEEK_SET) != 0)
+      return false;
+
+   handle->repeat     = 0;
+   handle->last_valid = false;
+   handle->ended      = false;
+
+   while (frame < target)
+   {
+      long offset;
+
+      if (handle->repeat)
+      {
+         uint32_t skip = handle->repeat;
+         if (skip > target - frame)
+            skip = target - frame;
+
+         handle->repeat -= skip;
+         frame          += skip;
+         continue;
+      }
+
+      offset = ftell(handle->file);
+
+      switch (bsv2_read_chunk(handle))
+      {
+         case BSV2_CHUNK_FRAME:
+            frame++;
+            break;
+         case BSV2_CHUNK_REPEAT:
+            run_offset = offset;
+            run_first  = frame;
+            break;
+         case BSV2_CHUNK_END:
+            return false;
+      }
+   }
+
+   if (!handle->playback)
+   {
+      long offset = ftell(handle->file);
+
+      /* Cut in the middle of a run, it gets written
+       * again with what is left of it. */
+      if (handle->repeat)
+      {
+         offset         = run_offset;
+         handle->repeat = target - run_first;
+      }
+
+      while (handle->keyframes_count > 1 &&
+            handle->keyframes[handle->keyframes_count - 1].frame >= target)
+         handle->keyframes_count--;
+
+      fseek(handle->file, offset, SEEK_SET);
+   }
+
+   return true;
+}
+
+static bool bsv2_read_index(bsv_movie_t *handle, uint32_t offset)
+{
+   uint32_t i, count;
+
+   if (!offset || fseek(handle->file, offset, SEEK_SET) != 0
+         || !bsv2_read_u32(handle->file, &count))
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t frame, pos;
+
+      if (!bsv2_read_u32(handle->file, &frame)
+            || !bsv2_read_u32(handle->file, &pos)
+            || !bsv2_add_keyframe(handle, frame, pos))
+         return false;
+   }
+
+   return handle->keyframes_count && handle->keyframes[0].frame == 0;
+}
+
+/* For movies which were not closed properly. */
+static void bsv2_scan_index(bsv_movie_t *handle)
+{
+   uint32_t count, size, frame = 0;
+
+   handle->keyframes_count = 0;
+   bsv2_add_keyframe(handle, 0, handle->min_file_pos);
+   fseek(handle->file, handle->min_file_pos, SEEK_SET);
+
+   for (;;)
+   {
+      long offset = ftell(handle->file);
+      int tag     = fgetc(handle->file);
+
+      if (tag == BSV2_CHUNK_FRAME)
+      {
+         if (!bsv2_read_u32(handle->file, &count) ||
+               fseek(handle->file, count * sizeof(int16_t), SEEK_CUR) != 0)
+            break;
+         frame++;
+      }
+      else if (tag == BSV2_CHUNK_REPEAT)
+      {
+         if (!bsv2_read_u32(handle->file, &count))
+            break;
+         frame += count;
+      }
+      else if (tag == BSV2_CHUNK_KEYFRAME)
+      {
+         if (!bsv2_read_u32(handle->file, &count)
+               || !bsv2_read_u32(handle->file, &size)
+               || count != frame
+               || fseek(handle->file, size, SEEK_CUR) != 0)
+            break;
+         bsv2_add_keyframe(handle, frame, offset);
+      }
+      else
+         break;
+   }
+
+   RARCH_WARN("Movie has no index, found %u frames.\n", frame);
+}
+
+static void bsv2_finish_record(bsv_movie_t *handle)
+{
+   size_t i;
+   long offset;
+
+   bsv2_flush_repeat(handle);
+   fputc(BSV2_CHUNK_END, handle->file);
+
+   offset = ftell(handle->file);
+   bsv2_write_u32(handle->file, handle->keyframes_count);
+   for (i = 0; i < handle->keyframes_count; i++)
+   {
+      bsv2_write_u32(handle->file, handle->keyframes[i].frame);
+      bsv2_write_u32(handle->file, handle->keyframes[i].offset);
+   }
+
+   if (offset <= 0)
+      return;
+
+   fseek(handle->file, INDEX_OFFSET_INDEX * sizeof(uint32_t), SEEK_SET);
+   bsv2_write_u32(handle->file, offset);
+   bsv2_write_u32(handle->file, handle->frame);
+}
+
+/* Position in the BSV1 input stream, as a file offset. */
+static long bsv1_tell(const bsv_movie_t *handle)
+{
+   return handle->read_base + handle->read_ptr * sizeof(int16_t);
+}
+
+static void bsv1_seek(bsv_movie_t *handle, long pos)
+{
+   long delta = pos - handle->read_base;
+
+   /* Most rewinds stay within what was read ahead. */
+   if (delta >= 0 && !(delta % sizeof(int16_t))
+         && (size_t)delta <= handle->read_count * sizeof(int16_t))
+   {
+      handle->read_ptr = delta / sizeof(int16_t);
+      return;
+   }
+
+   fseek(handle->file, pos, SEEK_SET);
+   handle->read_base  = pos;
+   handle->read_count = 0;
+   handle->read_ptr   = 0;
+}
+
 static bool init_playback(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size;
-   uint32_t header[4] = {0};
+   uint32_t header[BSV2_HEADER_SIZE] = {0};
+   size_t header_size = 4;
 
    handle->playback = true;
    handle->file = fopen(path, "rb");
@@ -55,15 +481,29 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
       return false;
    }
 
+   setvbuf(handle->file, NULL, _IOFBF, BSV_FILE_BUFFER_SIZE);
+
    if (fread(header, sizeof(uint32_t), 4, handle->file) != 4)
    {
       RARCH_ERR("Couldn't read movie header.\n");
       return false;
    }
 
+   if (swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC)
+   {
+      handle->bsv2 = true;
+      header_size  = BSV2_HEADER_SIZE;
+
+      if (fread(header + 4, sizeof(uint32_t), BSV2_HEADER_SIZE - 4,
+               handle->file) != BSV2_HEADER_SIZE - 4)
+      {
+         RARCH_ERR("Couldn't read movie header.\n");
+         return false;
+      }
+   }
    /* Compatibility with old implementation that
     * used incorrect documentation. */
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
+   else if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
          && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
    {
       RARCH_ERR("Movie file is not a valid BSV1 file.\n");
@@ -94,7 +534,27 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
          RARCH_WARN("Movie format seems to have a different serializer version. Will most likely fail.\n");
    }
 
-   handle->min_file_pos = sizeof(header) + state_size;
+   handle->min_file_pos = header_size * sizeof(uint32_t) + state_size;
+
+   if (handle->bsv2)
+   {
+      handle->keyframes_count = 0;
+      if (bsv2_read_index(handle, swap_if_big32(header[INDEX_OFFSET_INDEX])))
+         RARCH_LOG("Movie has %u frames, %u keyframes.\n",
+               swap_if_big32(header[FRAME_COUNT_INDEX]),
+               (unsigned)handle->keyframes_count);
+      else
+         bsv2_scan_index(handle);
+
+      fseek(handle->file, handle->min_file_pos, SEEK_SET);
+   }
+   else
+   {
+      handle->read_buf = (int16_t*)malloc(BSV1_READ_AHEAD * sizeof(int16_t));
+      if (!handle->read_buf)
+         return false;
+      handle->read_base = handle->min_file_pos;
+   }
 
    return true;
 }
@@ -102,26 +562,31 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
 static bool init_record(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size;
-   uint32_t header[4] = {0};
+   uint32_t header[BSV2_HEADER_SIZE] = {0};
 
-   handle->file = fopen(path, "wb");
+   /* Read back when rewinding. */
+   handle->file = fopen(path, "w+b");
    if (!handle->file)
    {
       RARCH_ERR("Couldn't open BSV \"%s\" for recording.\n", path);
       return false;
    }
 
+   setvbuf(handle->file, NULL, _IOFBF, BSV_FILE_BUFFER_SIZE);
+
+   handle->bsv2 = true;
 
    /* This value is supposed to show up as
-    * BSV1 in a HEX editor, big-endian. */
-   header[MAGIC_INDEX] = swap_if_little32(BSV_MAGIC);
+    * BSV2 in a HEX editor, big-endian. */
+   header[MAGIC_INDEX] = swap_if_little32(BSV2_MAGIC);
 
    header[CRC_INDEX] = swap_if_big32(g_extern.content_crc);
 
    state_size = pretro_serialize_size();
 
    header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
-   fwrite(header, 4, sizeof(uint32_t), handle->file);
+   header[KEYFRAME_INTERVAL_INDEX] = swap_if_big32(BSV2_KEYFRAME_INTERVAL);
+   fwrite(header, BSV2_HEADER_SIZE, sizeof(uint32_t), handle->file);
 
    handle->min_file_pos = sizeof(header) + state_size;
    handle->state_size = state_size;
@@ -136,7 +601,7 @@ static bool init_record(bsv_movie_t *handle, const char *path)
       fwrite(handle->state, 1, state_size, handle->file);
    }
 
-   return true;
+   return bsv2_add_keyframe(handle, 0, handle->min_file_pos);
 }
 
 void bsv_movie_free(bsv_movie_t *handle)
@@ -145,25 +610,56 @@ void bsv_movie_free(bsv_movie_t *handle)
       return;
 
    if (handle->file)
+   {
+      if (handle->bsv2 && !handle->playback)
+         bsv2_finish_record(handle);
       fclose(handle->file);
+   }
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->read_buf);
+   free(handle->keyframes);
+   free(handle->input);
+   free(handle->last);
    free(handle);
 }
 
 bool bsv_movie_get_input(bsv_movie_t *handle, int16_t *input)
 {
-   if (fread(input, sizeof(int16_t), 1, handle->file) != 1)
-      return false;
+   if (handle->bsv2)
+   {
+      if (handle->ended)
+         return false;
+
+      /* Asking for more than was recorded means
+       * we desynced already. */
+      *input = 0;
+      if (handle->last_ptr < handle->last_count)
+         *input = handle->last[handle->last_ptr++];
+      return true;
+   }
+
+   if (handle->read_ptr == handle->read_count)
+   {
+      handle->read_base  = bsv1_tell(handle);
+      handle->read_ptr   = 0;
+      handle->read_count = fread(handle->read_buf, sizeof(int16_t),
+            BSV1_READ_AHEAD, handle->file);
+      if (!handle->read_count)
+         return false;
+   }
 
-   *input = swap_if_big16(*input);
+   *input = swap_if_big16(handle->read_buf[handle->read_ptr++]);
    return true;
 }
 
 void bsv_movie_set_input(bsv_movie_t *handle, int16_t input)
 {
-   input = swap_if_big16(input);
-   fwrite(&input, sizeof(int16_t), 1, handle->file);
+   if (!bsv2_reserve(&handle->input, &handle->input_cap,
+            handle->input_count + 1))
+      return;
+
+   handle->input[handle->input_count++] = input;
 }
 
 bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
@@ -180,10 +676,13 @@ bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
    else if (!init_record(handle, path))
       goto error;
 
-   /* Just pick something really large 
+   if (handle->bsv2)
+      return handle;
+
+   /* Just pick something really large
     * ~1 million frames rewind should do the trick. */
    if (!(handle->frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
-      goto error; 
+      goto error;
 
    handle->frame_pos[0] = handle->min_file_pos;
    handle->frame_mask = (1 << 20) - 1;
@@ -199,7 +698,27 @@ void bsv_movie_set_frame_start(bsv_movie_t *handle)
 {
    if (!handle)
       return;
-   handle->frame_pos[handle->frame_ptr] = ftell(handle->file);
+
+   if (!handle->bsv2)
+   {
+      handle->frame_pos[handle->frame_ptr] = bsv1_tell(handle);
+      return;
+   }
+
+   if (handle->playback)
+   {
+      if (!handle->ended && !bsv2_read_frame(handle))
+         handle->ended = true;
+      return;
+   }
+
+   if (handle->frame && (handle->frame % BSV2_KEYFRAME_INTERVAL) == 0)
+   {
+      bsv2_flush_repeat(handle);
+      bsv2_write_keyframe(handle);
+   }
+
+   handle->input_count = 0;
 }
 
 void bsv_movie_set_frame_end(bsv_movie_t *handle)
@@ -207,21 +726,80 @@ void bsv_movie_set_frame_end(bsv_movie_t *handle)
    if (!handle)
       return;
 
-   handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   if (!handle->bsv2)
+      handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   else
+   {
+      if (!handle->playback)
+      {
+         if (handle->last_valid
+               && handle->input_count == handle->last_count
+               && !memcmp(handle->input, handle->last,
+                  handle->input_count * sizeof(int16_t)))
+            handle->repeat++;
+         else
+         {
+            bsv2_flush_repeat(handle);
+            bsv2_write_frame(handle);
+         }
+      }
+
+      handle->frame++;
+   }
 
    handle->first_rewind = !handle->did_rewind;
    handle->did_rewind = false;
 }
 
+static void bsv2_frame_rewind(bsv_movie_t *handle)
+{
+   /* See bsv_movie_frame_rewind for why it is 1 or 2. */
+   uint32_t step   = handle->first_rewind ? 1 : 2;
+   uint32_t target = handle->frame > step ? handle->frame - step : 0;
+
+   if (!handle->playback)
+   {
+      bsv2_flush_repeat(handle);
+
+      if (!target)
+      {
+         /* If recording, we simply reset
+          * the starting point. Nice and easy. */
+         fseek(handle->file, BSV2_HEADER_SIZE * sizeof(uint32_t), SEEK_SET);
+         pretro_serialize(handle->state, handle->state_size);
+         fwrite(handle->state, 1, handle->state_size, handle->file);
+
+         handle->keyframes_count = 1;
+         handle->last_valid      = false;
+         handle->frame           = 0;
+         return;
+      }
+   }
+
+   if (!bsv2_position(handle, target))
+   {
+      RARCH_WARN("Movie: Couldn't rewind to frame %u.\n", target);
+      return;
+   }
+
+   handle->frame = target;
+}
+
 void bsv_movie_frame_rewind(bsv_movie_t *handle)
 {
    handle->did_rewind = true;
 
+   if (handle->bsv2)
+   {
+      bsv2_frame_rewind(handle);
+      return;
+   }
+
    if ((handle->frame_ptr <= 1) && (handle->frame_pos[0] == handle->min_file_pos))
    {
       /* If we're at the beginning... */
       handle->frame_ptr = 0;
-      fseek(handle->file, handle->min_file_pos, SEEK_SET);
+      bsv1_seek(handle, handle->min_file_pos);
    }
    else
    {
@@ -233,23 +811,51 @@ void bsv_movie_frame_rewind(bsv_movie_t *handle)
        * plus another. */
       handle->frame_ptr = (handle->frame_ptr -
             (handle->first_rewind ? 1 : 2)) & handle->frame_mask;
-      fseek(handle->file, handle->frame_pos[handle->frame_ptr], SEEK_SET);
+      bsv1_seek(handle, handle->frame_pos[handle->frame_ptr]);
    }
 
-   if (ftell(handle->file) <= (long)handle->min_file_pos)
-   {
-      /* We rewound past the beginning. */
+   /* We rewound past the beginning. BSV1 movies are only played back. */
+   if (bsv1_tell(handle) <= (long)handle->min_file_pos)
+      bsv1_seek(handle, handle->min_file_pos);
+}
 
-      if (!handle->playback)
-      {
-         /* If recording, we simply reset
-          * the starting point. Nice and easy. */
-         fseek(handle->file, 4 * sizeof(uint32_t), SEEK_SET);
-         pretro_serialize(handle->state, handle->state_size);
-         fwrite(handle->state, 1, handle->state_size, handle->file);
-      }
-      else
-         fseek(handle->file, handle->min_file_pos, SEEK_SET);
+int64_t bsv_movie_seek(bsv_movie_t *handle, uint64_t frame)
+{
+   uint32_t tag_frame, size;
+   const struct bsv_keyframe *keyframe;
+
+   if (!handle || !handle->bsv2 || !handle->playback)
+      return -1;
+
+   if (frame > UINT32_MAX)
+      frame = UINT32_MAX;
+
+   keyframe = bsv2_find_keyframe(handle, frame);
+
+   if (keyframe->frame)
+   {
+      if (fseek(handle->file, keyframe->offset, SEEK_SET) != 0
+            || fgetc(handle->file) != BSV2_CHUNK_KEYFRAME
+            || !bsv2_read_u32(handle->file, &tag_frame)
+            || !bsv2_read_u32(handle->file, &size))
+         return -1;
    }
-}
+   else
+   {
+      fseek(handle->file, BSV2_HEADER_SIZE * sizeof(uint32_t), SEEK_SET);
+      size = handle->state_size;
+   }
+
+   if (size != handle->state_size || (size &&
+            fread(handle->state, 1, size, handle->file) != size))
+      return -1;
 
+   if (size)
+      pretro_unserialize(handle->state, size);
+
+   if (!bsv2_position(handle, keyframe->frame))
+      return -1;
+
+   handle->frame = keyframe->frame;
+   return keyframe->frame;
+}
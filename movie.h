@@ -26,12 +26,40 @@ extern "C" {
 #include <boolean.h>
 
 #define BSV_MAGIC 0x42535631
+#define BSV2_MAGIC 0x42535632
 
 #define MAGIC_INDEX 0
 #define SERIALIZER_INDEX 1
 #define CRC_INDEX 2
 #define STATE_SIZE_INDEX 3
 
+/* BSV2 extends the BSV1 header. */
+#define KEYFRAME_INTERVAL_INDEX 4
+#define INDEX_OFFSET_INDEX 5
+#define FRAME_COUNT_INDEX 6
+#define BSV2_HEADER_SIZE 8
+
+/* Frames between the savestates embedded in a BSV2 movie. */
+#define BSV2_KEYFRAME_INTERVAL 1800
+
+/* BSV2 chunk tags. The header and initial state are followed by
+ * a stream of chunks:
+ *
+ * 'F' u32 count, count * s16 : Input of one frame.
+ * 'R' u32 count              : The last 'F' repeats for count frames.
+ * 'K' u32 frame, u32 size, state : Savestate before frame.
+ *                              The next frame is always an 'F'.
+ * 'E'                        : End of the stream.
+ *
+ * After 'E' comes the keyframe index, u32 count, then count * (u32 frame,
+ * u32 file offset of the chunk), pointed to by the header.
+ * Frame 0 is listed with the offset of the first chunk.
+ * All values are little-endian. */
+#define BSV2_CHUNK_FRAME 'F'
+#define BSV2_CHUNK_REPEAT 'R'
+#define BSV2_CHUNK_KEYFRAME 'K'
+#define BSV2_CHUNK_END 'E'
+
 typedef struct bsv_movie bsv_movie_t;
 
 enum rarch_movie_type
@@ -55,6 +83,18 @@ void bsv_movie_set_frame_end(bsv_movie_t *handle);
 
 void bsv_movie_frame_rewind(bsv_movie_t *handle);
 
+/**
+ * bsv_movie_seek:
+ * @handle                : Movie handle, in playback.
+ * @frame                 : Frame to go to.
+ *
+ * Loads the last keyframe at or before @frame and continues
+ * playback from there. Only BSV2 movies have keyframes.
+ *
+ * Returns: frame which was reached, or -1 on failure.
+ **/
+int64_t bsv_movie_seek(bsv_movie_t *handle, uint64_t frame);
+
 void bsv_movie_free(bsv_movie_t *handle);
 
 #ifdef __cplusplus
@@ -0,0 +1,1324 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Nonblocking HTTP/1.1 client. Unlike http_lib, nothing here waits
+ * on the network: every socket is nonblocking and the transfers of
+ * a pool are moved along by net_http_pool_poll(). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#include <compat/strl.h>
+#include <compat/posix_string.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "netplay_compat.h"
+#include "netplay.h"
+#include "net_http.h"
+#include "general.h"
+
+#define NET_HTTP_BUFFER_SIZE   16384
+#define NET_HTTP_MAX_IDLE      8
+#define NET_HTTP_IDLE_TIMEOUT  15 /* seconds */
+#define NET_HTTP_MAX_REDIRECTS 5
+
+enum net_http_state
+{
+   NET_HTTP_STATE_RESOLVE = 0,
+   NET_HTTP_STATE_CONNECT,
+   NET_HTTP_STATE_SEND,
+   NET_HTTP_STATE_HEADERS,
+   NET_HTTP_STATE_BODY,
+   NET_HTTP_STATE_CHUNK_SIZE,
+   NET_HTTP_STATE_CHUNK_DATA,
+   NET_HTTP_STATE_CHUNK_END,
+   NET_HTTP_STATE_TRAILER,
+   NET_HTTP_STATE_DONE
+};
+
+/* A connection left open by a finished transfer. */
+struct net_http_conn
+{
+   int fd;
+   char host[256];
+   unsigned port;
+   time_t idle_since;
+   struct net_http_conn *next;
+};
+
+/* Name lookup, done on its own thread when there are threads.
+ * Whichever of the thread and the transfer lets go last frees it. */
+struct net_http_resolve
+{
+   char host[256];
+   char port[8];
+   struct addrinfo *addr;
+   bool done;
+#ifdef HAVE_THREADS
+   bool abandoned;
+   slock_t *lock;
+#endif
+};
+
+struct net_http_transfer
+{
+   enum net_http_state state;
+   bool cancelled;
+
+   char host[256];
+   unsigned port;
+   char *resource;
+   unsigned redirects;
+
+   char *path;
+   char *tmp_path;
+   FILE *file;
+
+   net_http_progress_t progress;
+   net_http_write_t write;
+   net_http_done_t done;
+   void *userdata;
+
+   /* Where the body asked for starts, and where the
+    * next piece for @write goes. */
+   size_t range_start;
+   size_t write_offset;
+   size_t total;
+
+   struct net_http_resolve *resolve;
+   struct addrinfo *addr_next;
+   int fd;
+   bool reused;
+
+   char *request;
+   size_t request_len;
+   size_t request_pos;
+
+   /* Received, but not parsed yet. */
+   char buf[NET_HTTP_BUFFER_SIZE];
+   size_t buf_len;
+
+   int status;
+   int result;
+   bool keep_alive;
+   bool chunked;
+   bool has_length;
+   size_t content_length;
+   size_t chunk_left;
+   size_t received;
+   char *location;
+
+   char *body;
+   size_t body_len;
+   size_t body_cap;
+
+   struct net_http_transfer *next;
+};
+
+struct net_http_pool
+{
+   net_http_transfer_t *transfers;
+   struct net_http_conn *idle;
+};
+
+static bool net_http_nonblock(int fd)
+{
+#ifdef _WIN32
+   u_long mode = 1;
+   return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+   return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool net_http_would_block(void)
+{
+#ifdef _WIN32
+   return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+   return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+#endif
+}
+
+static bool net_http_prefix(const char *str, const char *prefix)
+{
+   for (; *prefix; str++, prefix++)
+      if (tolower((unsigned char)*str) != *prefix)
+         return false;
+   return true;
+}
+
+/**
+ * net_http_set_url:
+ * @t                    : transfer handle.
+ * @url                  : absolute http:// URL, or an absolute path
+ *                         on the current server for redirects.
+ *
+ * Returns: true (1) if the URL could be used, otherwise false (0).
+ **/
+static bool net_http_set_url(net_http_transfer_t *t, const char *url)
+{
+   const char *host, *end, *resource;
+   size_t host_len, resource_len;
+
+   if (*url == '/' && t->resource)
+      resource = url;
+   else
+   {
+      /* There is no TLS to do https:// with. */
+      if (!net_http_prefix(url, "http://"))
+         return false;
+
+      host = url + strlen("http://");
+      if (*host == '[')
+      {
+         /* IPv6 literal, kept without its brackets. */
+         host++;
+         end = strchr(host, ']');
+         if (!end)
+            return false;
+         host_len = end - host;
+         end++;
+      }
+      else
+      {
+         end      = host + strcspn(host, ":/?#");
+         host_len = end - host;
+      }
+
+      if (!host_len || host_len >= sizeof(t->host))
+         return false;
+
+      memcpy(t->host, host, host_len);
+      t->host[host_len] = '\0';
+      t->port           = 80;
+
+      if (*end == ':')
+      {
+         char *port_end;
+         unsigned long port = strtoul(end + 1, &port_end, 10);
+
+         if (port_end == end + 1 || port == 0 || port > 65535)
+            return false;
+         t->port = port;
+         end     = port_end;
+      }
+
+      if (*end != '\0' && *end != '/' && *end != '?' && *end != '#')
+         return false;
+      resource = end;
+   }
+
+   /* The fragment stays on our side. */
+   resource_len = strcspn(resource, "#");
+
+   free(t->resource);
+   t->resource = (char*)malloc(resource_len + 2);
+   if (!t->resource)
+      return false;
+
+   if (*resource != '/')
+   {
+      t->resource[0] = '/';
+      memcpy(t->resource + 1, resource, resource_len);
+      t->resource[resource_len + 1] = '\0';
+   }
+   else
+   {
+      memcpy(t->resource, resource, resource_len);
+      t->resource[resource_len] = '\0';
+   }
+
+   return true;
+}
+
+static void net_http_resolve_free(struct net_http_resolve *r)
+{
+   if (r->addr)
+      freeaddrinfo(r->addr);
+#ifdef HAVE_THREADS
+   if (r->lock)
+      slock_free(r->lock);
+#endif
+   free(r);
+}
+
+static void net_http_resolve_lookup(struct net_http_resolve *r)
+{
+   struct addrinfo hints = {0};
+
+   hints.ai_family   = AF_UNSPEC;
+   hints.ai_socktype = SOCK_STREAM;
+
+   if (getaddrinfo(r->host, r->port, &hints, &r->addr) != 0)
+      r->addr = NULL;
+}
+
+#ifdef HAVE_THREADS
+static void net_http_resolve_thread(void *data)
+{
+   bool abandoned;
+   struct net_http_resolve *r = (struct net_http_resolve*)data;
+
+   net_http_resolve_lookup(r);
+
+   slock_lock(r->lock);
+   r->done   = true;
+   abandoned = r->abandoned;
+   slock_unlock(r->lock);
+
+   if (abandoned)
+      net_http_resolve_free(r);
+}
+#endif
+
+static void net_http_resolve_abandon(net_http_transfer_t *t)
+{
+   struct net_http_resolve *r = t->resolve;
+
+   if (!r)
+      return;
+
+   t->resolve   = NULL;
+   t->addr_next = NULL;
+
+#ifdef HAVE_THREADS
+   if (r->lock)
+   {
+      slock_lock(r->lock);
+      if (!r->done)
+      {
+         /* The thread frees it once getaddrinfo() returns. */
+         r->abandoned = true;
+         slock_unlock(r->lock);
+         return;
+      }
+      slock_unlock(r->lock);
+   }
+#endif
+
+   net_http_resolve_free(r);
+}
+
+static bool net_http_resolve_start(net_http_transfer_t *t)
+{
+   struct net_http_resolve *r = (struct net_http_resolve*)
+      calloc(1, sizeof(*r));
+
+   if (!r)
+      return false;
+
+   strlcpy(r->host, t->host, sizeof(r->host));
+   snprintf(r->port, sizeof(r->port), "%u", t->port);
+   t->resolve = r;
+
+#ifdef HAVE_THREADS
+   r->lock = slock_new();
+   if (r->lock)
+   {
+      sthread_t *thread = sthread_create(net_http_resolve_thread, r);
+
+      if (thread)
+      {
+         sthread_detach(thread);
+         return true;
+      }
+   }
+#endif
+
+   /* Without a thread, the lookup blocks. */
+   net_http_resolve_lookup(r);
+   r->done = true;
+   return true;
+}
+
+static bool net_http_resolve_done(net_http_transfer_t *t)
+{
+   bool done;
+   struct net_http_resolve *r = t->resolve;
+
+#ifdef HAVE_THREADS
+   if (r->lock)
+   {
+      slock_lock(r->lock);
+      done = r->done;
+      slock_unlock(r->lock);
+      return done;
+   }
+#endif
+
+   done = r->done;
+   return done;
+}
+
+static void net_http_close(net_http_transfer_t *t)
+{
+   if (t->fd >= 0)
+      close(t->fd);
+   t->fd = -1;
+}
+
+static void net_http_finish(net_http_transfer_t *t, int result)
+{
+   net_http_close(t);
+   net_http_resolve_abandon(t);
+
+   if (t->file)
+   {
+      bool ok = (fclose(t->file) == 0) && result >= 200 && result < 300;
+      t->file = NULL;
+
+      if (ok)
+      {
+#ifdef _WIN32
+         remove(t->path);
+#endif
+         if (rename(t->tmp_path, t->path) < 0)
+            ok = false;
+      }
+
+      if (!ok)
+      {
+         remove(t->tmp_path);
+         if (result >= 200 && result < 300)
+            result = NET_HTTP_ERROR_FILE;
+      }
+   }
+
+   t->result = result;
+   t->state  = NET_HTTP_STATE_DONE;
+}
+
+static void net_http_connect_next(net_http_transfer_t *t)
+{
+   while (t->addr_next)
+   {
+      struct addrinfo *addr = t->addr_next;
+
+      t->addr_next = addr->ai_next;
+      t->fd        = socket(addr->ai_family,
+            addr->ai_socktype, addr->ai_protocol);
+      if (t->fd < 0)
+         continue;
+
+      if (!net_http_nonblock(t->fd))
+      {
+         net_http_close(t);
+         continue;
+      }
+
+      if (connect(t->fd, addr->ai_addr, addr->ai_addrlen) == 0)
+      {
+         t->state = NET_HTTP_STATE_SEND;
+         return;
+      }
+
+      if (net_http_would_block())
+      {
+         t->state = NET_HTTP_STATE_CONNECT;
+         return;
+      }
+
+      net_http_close(t);
+   }
+
+   net_http_finish(t, NET_HTTP_ERROR_CONNECT);
+}
+
+static bool net_http_build_request(net_http_transfer_t *t)
+{
+   char host[300];
+   char range[64] = "";
+   size_t size;
+
+   if (strchr(t->host, ':'))
+      snprintf(host, sizeof(host), "[%s]", t->host);
+   else
+      strlcpy(host, t->host, sizeof(host));
+
+   if (t->port != 80)
+   {
+      size_t len = strlen(host);
+      snprintf(host + len, sizeof(host) - len, ":%u", t->port);
+   }
+
+   if (t->range_start)
+      snprintf(range, sizeof(range), "Range: bytes=%llu-\r\n",
+            (unsigned long long)t->range_start);
+
+   free(t->request);
+   size       = strlen(t->resource) + strlen(host) + strlen(range) + 256;
+   t->request = (char*)malloc(size);
+   if (!t->request)
+      return false;
+
+   t->request_len = snprintf(t->request, size,
+         "GET %s HTTP/1.1\r\n"
+         "Host: %s\r\n"
+         "User-Agent: RetroArch/" PACKAGE_VERSION "\r\n"
+         "Accept-Encoding: identity\r\n"
+         "Connection: keep-alive\r\n"
+         "%s"
+         "\r\n",
+         t->resource, host, range);
+   t->request_pos = 0;
+   return true;
+}
+
+/**
+ * net_http_start:
+ * @pool                 : pool handle.
+ * @t                    : transfer handle.
+ *
+ * (Re)starts the request of @t, on an idle connection to the
+ * server if there is one, otherwise on a new one.
+ **/
+static void net_http_start(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   struct net_http_conn **conn;
+
+   net_http_resolve_abandon(t);
+
+   t->buf_len        = 0;
+   t->status         = 0;
+   t->keep_alive     = false;
+   t->chunked        = false;
+   t->has_length     = false;
+   t->content_length = 0;
+   t->chunk_left     = 0;
+   t->received       = 0;
+   t->write_offset   = 0;
+   t->total          = 0;
+   t->body_len       = 0;
+   t->reused         = false;
+
+   if (!net_http_build_request(t))
+   {
+      net_http_finish(t, NET_HTTP_ERROR_MEMORY);
+      return;
+   }
+
+   for (conn = &pool->idle; *conn; conn = &(*conn)->next)
+   {
+      struct net_http_conn *c = *conn;
+
+      if (c->port != t->port || strcmp(c->host, t->host))
+         continue;
+
+      *conn     = c->next;
+      t->fd     = c->fd;
+      t->reused = true;
+      t->state  = NET_HTTP_STATE_SEND;
+      free(c);
+      return;
+   }
+
+   if (!net_http_resolve_start(t))
+   {
+      net_http_finish(t, NET_HTTP_ERROR_MEMORY);
+      return;
+   }
+
+   t->state = NET_HTTP_STATE_RESOLVE;
+}
+
+/* The server may have closed an idle connection just as we picked
+ * it up. That only shows once the request is out, so the request
+ * is made again on a new connection if nothing came back. */
+static bool net_http_retry(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   if (!t->reused || t->status || t->buf_len)
+      return false;
+
+   RARCH_LOG("[HTTP]: Connection to %s went stale, reconnecting.\n",
+         t->host);
+   net_http_close(t);
+   net_http_start(pool, t);
+   return true;
+}
+
+static void net_http_keep(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   unsigned count = 0;
+   struct net_http_conn *c, **last;
+
+   if (t->fd < 0)
+      return;
+
+   /* Leftovers mean we lost track of the responses. */
+   if (!t->keep_alive || t->buf_len)
+   {
+      net_http_close(t);
+      return;
+   }
+
+   c = (struct net_http_conn*)calloc(1, sizeof(*c));
+   if (!c)
+   {
+      net_http_close(t);
+      return;
+   }
+
+   c->fd         = t->fd;
+   c->port       = t->port;
+   c->idle_since = time(NULL);
+   strlcpy(c->host, t->host, sizeof(c->host));
+   c->next       = pool->idle;
+   pool->idle    = c;
+   t->fd         = -1;
+
+   /* Newest first, so whatever is past the limit is the oldest. */
+   for (last = &pool->idle; *last; last = &(*last)->next)
+   {
+      if (++count <= NET_HTTP_MAX_IDLE)
+         continue;
+
+      c     = *last;
+      *last = c->next;
+      close(c->fd);
+      free(c);
+      break;
+   }
+}
+
+/* Returns: 0 on success, otherwise one of enum net_http_error. */
+static int net_http_sink(net_http_transfer_t *t,
+      const char *data, size_t len)
+{
+   if (!len)
+      return 0;
+
+   t->received += len;
+
+   if (t->file)
+      return fwrite(data, 1, len, t->file) == len
+         ? 0 : NET_HTTP_ERROR_FILE;
+
+   if (t->write && t->status >= 200 && t->status < 300)
+   {
+      size_t offset    = t->write_offset;
+      t->write_offset += len;
+      return t->write(t->userdata, offset, data, len, t->total)
+         ? 0 : NET_HTTP_ERROR_ABORTED;
+   }
+
+   if (t->body_len + len + 1 > t->body_cap)
+   {
+      size_t cap = t->body_cap ? t->body_cap : 4096;
+      char *body;
+
+      while (t->body_len + len + 1 > cap)
+         cap *= 2;
+
+      body = (char*)realloc(t->body, cap);
+      if (!body)
+         return NET_HTTP_ERROR_MEMORY;
+
+      t->body     = body;
+      t->body_cap = cap;
+   }
+
+   memcpy(t->body + t->body_len, data, len);
+   t->body_len         += len;
+   t->body[t->body_len] = '\0';
+   return 0;
+}
+
+static void net_http_consume(net_http_transfer_t *t, size_t len)
+{
+   memmove(t->buf, t->buf + len, t->buf_len - len);
+   t->buf_len -= len;
+}
+
+static char *net_http_find_line(net_http_transfer_t *t, const char *end)
+{
+   size_t i, end_len = strlen(end);
+
+   for (i = 0; i + end_len <= t->buf_len; i++)
+      if (!memcmp(t->buf + i, end, end_len))
+         return t->buf + i;
+   return NULL;
+}
+
+/**
+ * net_http_parse_headers:
+ * @t                    : transfer handle.
+ * @head                 : NUL terminated header block, which
+ *                         is cut up in place.
+ *
+ * Returns: true (1) if the status line made sense,
+ * otherwise false (0).
+ **/
+static bool net_http_parse_headers(net_http_transfer_t *t, char *head)
+{
+   char *line, *save = NULL;
+   size_t range_first = 0, range_total = 0;
+
+   line = strtok_r(head, "\r\n", &save);
+   if (!line || !net_http_prefix(line, "http/1.") || strlen(line) < 12)
+      return false;
+
+   /* Only HTTP/1.1 keeps connections open unless told otherwise. */
+   t->keep_alive = line[7] != '0';
+   t->status     = strtol(line + 9, NULL, 10);
+   if (t->status < 100 || t->status > 999)
+      return false;
+
+   while ((line = strtok_r(NULL, "\r\n", &save)))
+   {
+      char *value = strchr(line, ':');
+      char *end;
+
+      if (!value)
+         continue;
+
+      *value++ = '\0';
+      while (*value == ' ' || *value == '\t')
+         value++;
+      end = value + strlen(value);
+      while (end > value && (end[-1] == ' ' || end[-1] == '\t'))
+         *--end = '\0';
+
+      if (!strcasecmp(line, "Content-Length"))
+      {
+         t->has_length     = true;
+         t->content_length = strtoul(value, NULL, 10);
+      }
+      else if (!strcasecmp(line, "Transfer-Encoding"))
+      {
+         char *c;
+         for (c = value; *c; c++)
+            *c = tolower((unsigned char)*c);
+         t->chunked = strstr(value, "chunked") != NULL;
+      }
+      else if (!strcasecmp(line, "Connection"))
+      {
+         if (!strcasecmp(value, "close"))
+            t->keep_alive = false;
+         else if (!strcasecmp(value, "keep-alive"))
+            t->keep_alive = true;
+      }
+      else if (!strcasecmp(line, "Content-Range"))
+      {
+         /* bytes <first>-<last>/<total or *> */
+         const char *total = strchr(value, '/');
+
+         if (net_http_prefix(value, "bytes "))
+            range_first = strtoul(value + strlen("bytes "), NULL, 10);
+         if (total && total[1] != '*')
+            range_total = strtoul(total + 1, NULL, 10);
+      }
+      else if (!strcasecmp(line, "Location"))
+      {
+         free(t->location);
+         t->location = strdup(value);
+      }
+   }
+
+   /* Chunks win over a length, as RFC 7230 has it. */
+   if (t->chunked)
+      t->has_length = false;
+
+   if (t->status == 206)
+   {
+      t->write_offset = range_first;
+      t->total        = range_total;
+   }
+   else if (t->has_length)
+      t->total = t->content_length;
+
+   return true;
+}
+
+static void net_http_redirect(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   char *location = t->location;
+
+   t->location = NULL;
+
+   /* Draining the body is not worth it, the connection just goes. */
+   net_http_close(t);
+
+   if (++t->redirects > NET_HTTP_MAX_REDIRECTS
+         || !net_http_set_url(t, location))
+   {
+      free(location);
+      net_http_finish(t, NET_HTTP_ERROR_URL);
+      return;
+   }
+
+   RARCH_LOG("[HTTP]: Redirected to %s.\n", location);
+   free(location);
+   net_http_start(pool, t);
+}
+
+static void net_http_body_start(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   if (t->path && t->status >= 200 && t->status < 300)
+   {
+      t->file = fopen(t->tmp_path, "wb");
+      if (!t->file)
+      {
+         net_http_finish(t, NET_HTTP_ERROR_FILE);
+         return;
+      }
+   }
+
+   if (t->status == 204 || t->status == 304
+         || (t->has_length && !t->content_length))
+   {
+      net_http_keep(pool, t);
+      net_http_finish(t, t->status);
+   }
+   else if (t->chunked)
+      t->state = NET_HTTP_STATE_CHUNK_SIZE;
+   else
+   {
+      /* Without a length, the body goes until the server closes. */
+      if (!t->has_length)
+         t->keep_alive = false;
+      t->state = NET_HTTP_STATE_BODY;
+   }
+}
+
+/**
+ * net_http_parse:
+ * @pool                 : pool handle.
+ * @t                    : transfer handle.
+ *
+ * Eats as much of the receive buffer as it can.
+ **/
+static void net_http_parse(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   for (;;)
+   {
+      char *end;
+      size_t len;
+      int error;
+
+      switch (t->state)
+      {
+         case NET_HTTP_STATE_HEADERS:
+            end = net_http_find_line(t, "\r\n\r\n");
+            if (!end)
+            {
+               if (t->buf_len == sizeof(t->buf))
+                  net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+
+            *end = '\0';
+            len  = end - t->buf + 4;
+            if (!net_http_parse_headers(t, t->buf))
+            {
+               net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+            net_http_consume(t, len);
+
+            if (t->status < 200)
+            {
+               /* 100 Continue and such, the real one follows. */
+               free(t->location);
+               t->location = NULL;
+               continue;
+            }
+
+            if (t->location && t->status >= 300 && t->status < 400
+                  && t->status != 304)
+            {
+               net_http_redirect(pool, t);
+               return;
+            }
+
+            net_http_body_start(pool, t);
+            break;
+
+         case NET_HTTP_STATE_BODY:
+            len = t->buf_len;
+            if (t->has_length && len > t->content_length - t->received)
+               len = t->content_length - t->received;
+
+            if ((error = net_http_sink(t, t->buf, len)))
+            {
+               net_http_finish(t, error);
+               return;
+            }
+            net_http_consume(t, len);
+
+            if (t->has_length && t->received == t->content_length)
+            {
+               net_http_keep(pool, t);
+               net_http_finish(t, t->status);
+            }
+            return;
+
+         case NET_HTTP_STATE_CHUNK_SIZE:
+            end = net_http_find_line(t, "\r\n");
+            if (!end)
+            {
+               if (t->buf_len == sizeof(t->buf))
+                  net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+
+            *end = '\0';
+            if (!isxdigit((unsigned char)t->buf[0]))
+            {
+               net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+
+            /* Chunk extensions after the ';' are ignored. */
+            t->chunk_left = strtoul(t->buf, NULL, 16);
+            net_http_consume(t, end - t->buf + 2);
+            t->state = t->chunk_left
+               ? NET_HTTP_STATE_CHUNK_DATA : NET_HTTP_STATE_TRAILER;
+            break;
+
+         case NET_HTTP_STATE_CHUNK_DATA:
+            len = t->buf_len;
+            if (len > t->chunk_left)
+               len = t->chunk_left;
+
+            if ((error = net_http_sink(t, t->buf, len)))
+            {
+               net_http_finish(t, error);
+               return;
+            }
+            net_http_consume(t, len);
+            t->chunk_left -= len;
+
+            if (t->chunk_left)
+               return;
+            t->state = NET_HTTP_STATE_CHUNK_END;
+            break;
+
+         case NET_HTTP_STATE_CHUNK_END:
+            if (t->buf_len < 2)
+               return;
+            if (t->buf[0] != '\r' || t->buf[1] != '\n')
+            {
+               net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+            net_http_consume(t, 2);
+            t->state = NET_HTTP_STATE_CHUNK_SIZE;
+            break;
+
+         case NET_HTTP_STATE_TRAILER:
+            end = net_http_find_line(t, "\r\n");
+            if (!end)
+            {
+               if (t->buf_len == sizeof(t->buf))
+                  net_http_finish(t, NET_HTTP_ERROR_PROTOCOL);
+               return;
+            }
+
+            len = end - t->buf;
+            net_http_consume(t, len + 2);
+            if (!len)
+            {
+               net_http_keep(pool, t);
+               net_http_finish(t, t->status);
+               return;
+            }
+            break;
+
+         default:
+            return;
+      }
+   }
+}
+
+static void net_http_send(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   int ret = send(t->fd, t->request + t->request_pos,
+         t->request_len - t->request_pos, 0);
+
+   if (ret < 0)
+   {
+      if (net_http_would_block())
+         return;
+      if (!net_http_retry(pool, t))
+         net_http_finish(t, NET_HTTP_ERROR_IO);
+      return;
+   }
+
+   t->request_pos += ret;
+   if (t->request_pos == t->request_len)
+      t->state = NET_HTTP_STATE_HEADERS;
+}
+
+static void net_http_recv(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   size_t received = t->received;
+   int ret         = recv(t->fd, t->buf + t->buf_len,
+         sizeof(t->buf) - t->buf_len, 0);
+
+   if (ret < 0 && net_http_would_block())
+      return;
+
+   if (ret <= 0)
+   {
+      if (ret == 0 && t->state == NET_HTTP_STATE_BODY && !t->has_length)
+      {
+         net_http_close(t);
+         net_http_finish(t, t->status);
+      }
+      else if (!net_http_retry(pool, t))
+         net_http_finish(t, ret == 0
+               ? NET_HTTP_ERROR_PROTOCOL : NET_HTTP_ERROR_IO);
+      return;
+   }
+
+   t->buf_len += ret;
+   net_http_parse(pool, t);
+
+   if (t->progress && t->received != received && !t->cancelled)
+      t->progress(t->userdata, t->received,
+            t->has_length ? t->content_length : 0);
+}
+
+static void net_http_connected(net_http_pool_t *pool, net_http_transfer_t *t)
+{
+   int error       = 0;
+   socklen_t len   = sizeof(error);
+
+   if (getsockopt(t->fd, SOL_SOCKET, SO_ERROR,
+            NONCONST_CAST &error, &len) < 0 || error)
+   {
+      net_http_close(t);
+      net_http_connect_next(t);
+      return;
+   }
+
+   t->state = NET_HTTP_STATE_SEND;
+   net_http_send(pool, t);
+}
+
+static void net_http_transfer_free(net_http_transfer_t *t)
+{
+   net_http_close(t);
+   net_http_resolve_abandon(t);
+
+   if (t->file)
+   {
+      fclose(t->file);
+      remove(t->tmp_path);
+   }
+
+   free(t->resource);
+   free(t->path);
+   free(t->tmp_path);
+   free(t->request);
+   free(t->location);
+   free(t->body);
+   free(t);
+}
+
+net_http_pool_t *net_http_pool_new(void)
+{
+   if (!network_init())
+      return NULL;
+   return (net_http_pool_t*)calloc(1, sizeof(net_http_pool_t));
+}
+
+void net_http_pool_free(net_http_pool_t *pool)
+{
+   if (!pool)
+      return;
+
+   while (pool->transfers)
+   {
+      net_http_transfer_t *t = pool->transfers;
+      pool->transfers        = t->next;
+      net_http_transfer_free(t);
+   }
+
+   while (pool->idle)
+   {
+      struct net_http_conn *c = pool->idle;
+      pool->idle              = c->next;
+      close(c->fd);
+      free(c);
+   }
+
+   free(pool);
+}
+
+static net_http_transfer_t *net_http_transfer_new(const char *url,
+      net_http_done_t done, void *userdata)
+{
+   net_http_transfer_t *t = NULL;
+
+   if (!url)
+      return NULL;
+
+   t = (net_http_transfer_t*)calloc(1, sizeof(*t));
+   if (!t)
+      return NULL;
+
+   t->fd       = -1;
+   t->done     = done;
+   t->userdata = userdata;
+
+   if (!net_http_set_url(t, url))
+   {
+      RARCH_ERR("[HTTP]: Cannot fetch \"%s\".\n", url);
+      net_http_transfer_free(t);
+      return NULL;
+   }
+
+   return t;
+}
+
+static void net_http_transfer_add(net_http_pool_t *pool,
+      net_http_transfer_t *t)
+{
+   net_http_start(pool, t);
+
+   t->next         = pool->transfers;
+   pool->transfers = t;
+}
+
+net_http_transfer_t *net_http_get(net_http_pool_t *pool, const char *url,
+      const char *path, net_http_progress_t progress,
+      net_http_done_t done, void *userdata)
+{
+   net_http_transfer_t *t = NULL;
+
+   if (!pool || !(t = net_http_transfer_new(url, done, userdata)))
+      return NULL;
+
+   t->progress = progress;
+
+   if (path)
+   {
+      size_t len  = strlen(path) + sizeof(".tmp");
+
+      t->path     = strdup(path);
+      t->tmp_path = (char*)malloc(len);
+      if (!t->path || !t->tmp_path)
+         goto error;
+      snprintf(t->tmp_path, len, "%s.tmp", path);
+   }
+
+   net_http_transfer_add(pool, t);
+   return t;
+
+error:
+   net_http_transfer_free(t);
+   return NULL;
+}
+
+net_http_transfer_t *net_http_get_range(net_http_pool_t *pool,
+      const char *url, size_t offset, net_http_write_t write,
+      net_http_done_t done, void *userdata)
+{
+   net_http_transfer_t *t = NULL;
+
+   if (!pool || !write || !(t = net_http_transfer_new(url, done, userdata)))
+      return NULL;
+
+   t->write       = write;
+   t->range_start = offset;
+
+   net_http_transfer_add(pool, t);
+   return t;
+}
+
+void net_http_cancel(net_http_pool_t *pool, net_http_transfer_t *transfer)
+{
+   (void)pool;
+
+   /* Freed by the next poll, as callbacks may cancel
+    * from under the loop going through the transfers. */
+   if (transfer)
+      transfer->cancelled = true;
+}
+
+static void net_http_poll_idle(net_http_pool_t *pool, fd_set *read_fds)
+{
+   time_t now = time(NULL);
+   struct net_http_conn **conn = &pool->idle;
+
+   while (*conn)
+   {
+      struct net_http_conn *c = *conn;
+
+      /* Anything coming in on an idle connection is
+       * the server hanging up. */
+      if ((read_fds && FD_ISSET(c->fd, read_fds))
+            || now - c->idle_since >= NET_HTTP_IDLE_TIMEOUT)
+      {
+         *conn = c->next;
+         close(c->fd);
+         free(c);
+         continue;
+      }
+
+      conn = &c->next;
+   }
+}
+
+bool net_http_pool_poll(net_http_pool_t *pool, unsigned timeout_ms)
+{
+   int max_fd = -1;
+   bool resolving = false;
+   bool left = false;
+   fd_set read_fds, write_fds;
+   net_http_transfer_t *t;
+   struct net_http_conn *c;
+
+   if (!pool)
+      return false;
+
+   FD_ZERO(&read_fds);
+   FD_ZERO(&write_fds);
+
+   for (t = pool->transfers; t; t = t->next)
+   {
+      if (t->cancelled)
+         continue;
+
+      if (t->state == NET_HTTP_STATE_RESOLVE)
+      {
+         if (!net_http_resolve_done(t))
+         {
+            resolving = true;
+            continue;
+         }
+
+         if (!t->resolve->addr)
+         {
+            RARCH_ERR("[HTTP]: Could not resolve %s.\n", t->host);
+            net_http_finish(t, NET_HTTP_ERROR_RESOLVE);
+            continue;
+         }
+
+         t->addr_next = t->resolve->addr;
+         net_http_connect_next(t);
+      }
+
+      switch (t->state)
+      {
+         case NET_HTTP_STATE_CONNECT:
+         case NET_HTTP_STATE_SEND:
+            FD_SET(t->fd, &write_fds);
+            break;
+         case NET_HTTP_STATE_DONE:
+            continue;
+         default:
+            FD_SET(t->fd, &read_fds);
+            break;
+      }
+
+      if (t->fd > max_fd)
+         max_fd = t->fd;
+   }
+
+   net_http_poll_idle(pool, NULL);
+   for (c = pool->idle; c; c = c->next)
+   {
+      FD_SET(c->fd, &read_fds);
+      if (c->fd > max_fd)
+         max_fd = c->fd;
+   }
+
+   /* Lookups finishing do not wake select() up. */
+   if (resolving && timeout_ms > 10)
+      timeout_ms = 10;
+
+   if (max_fd >= 0)
+   {
+      struct timeval tv;
+
+      tv.tv_sec  = timeout_ms / 1000;
+      tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+      if (select(max_fd + 1, &read_fds, &write_fds, NULL, &tv) < 0)
+      {
+         FD_ZERO(&read_fds);
+         FD_ZERO(&write_fds);
+      }
+   }
+   else if (timeout_ms && resolving)
+      rarch_sleep(timeout_ms);
+
+   /* Before any transfer hands its connection back. */
+   net_http_poll_idle(pool, &read_fds);
+
+   for (t = pool->transfers; t; t = t->next)
+   {
+      if (t->cancelled || t->fd < 0)
+         continue;
+
+      switch (t->state)
+      {
+         case NET_HTTP_STATE_CONNECT:
+            if (FD_ISSET(t->fd, &write_fds))
+               net_http_connected(pool, t);
+            break;
+         case NET_HTTP_STATE_SEND:
+            if (FD_ISSET(t->fd, &write_fds))
+               net_http_send(pool, t);
+            break;
+         case NET_HTTP_STATE_RESOLVE:
+         case NET_HTTP_STATE_DONE:
+            break;
+         default:
+            if (FD_ISSET(t->fd, &read_fds))
+               net_http_recv(pool, t);
+            break;
+      }
+   }
+
+   /* Done callbacks may queue or cancel transfers, so the
+    * list is walked again from the top after each. */
+   for (;;)
+   {
+      net_http_transfer_t **link;
+
+      for (link = &pool->transfers; *link; link = &(*link)->next)
+         if ((*link)->cancelled || (*link)->state == NET_HTTP_STATE_DONE)
+            break;
+
+      t = *link;
+      if (!t)
+         break;
+
+      *link = t->next;
+
+      if (!t->cancelled && t->done)
+         t->done(t->userdata, t->result, t->body, t->body_len);
+
+      net_http_transfer_free(t);
+   }
+
+   for (t = pool->transfers; t; t = t->next)
+      left = left || !t->cancelled;
+
+   return left;
+}
@@ -0,0 +1,150 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NET_HTTP_H
+#define __RARCH_NET_HTTP_H
+
+#include <stddef.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Passed to the done callback instead of an HTTP status. */
+enum net_http_error
+{
+   NET_HTTP_ERROR_URL      = -1,
+   NET_HTTP_ERROR_RESOLVE  = -2,
+   NET_HTTP_ERROR_CONNECT  = -3,
+   NET_HTTP_ERROR_IO       = -4,
+   NET_HTTP_ERROR_PROTOCOL = -5,
+   NET_HTTP_ERROR_FILE     = -6,
+   NET_HTTP_ERROR_MEMORY   = -7,
+   NET_HTTP_ERROR_ABORTED  = -8
+};
+
+typedef struct net_http_pool net_http_pool_t;
+typedef struct net_http_transfer net_http_transfer_t;
+
+/* @total is 0 as long as the size of the body is not known. */
+typedef void (*net_http_progress_t)(void *userdata,
+      size_t received, size_t total);
+
+/* Takes a 2xx body piece by piece. @offset is where @data goes in
+ * the whole resource, which starts over at 0 when the server sends
+ * all of it instead of the range asked for. @total is the size of
+ * the whole resource, 0 while unknown. Returning false aborts the
+ * transfer with NET_HTTP_ERROR_ABORTED. */
+typedef bool (*net_http_write_t)(void *userdata, size_t offset,
+      const char *data, size_t len, size_t total);
+
+/* @status is the HTTP status of the response, or one of
+ * enum net_http_error. @data is the body, NUL terminated, or NULL
+ * if it was empty or went to a file. It is freed once the
+ * callback returns. */
+typedef void (*net_http_done_t)(void *userdata,
+      int status, const char *data, size_t len);
+
+/**
+ * net_http_pool_new:
+ *
+ * Creates a set of HTTP transfers which are driven together by
+ * net_http_pool_poll(). Connections to the same server are kept
+ * open and reused by later transfers of the pool.
+ *
+ * Returns: new pool, or NULL on failure.
+ **/
+net_http_pool_t *net_http_pool_new(void);
+
+/**
+ * net_http_pool_free:
+ * @pool                 : pool handle.
+ *
+ * Aborts the transfers left, without calling their callbacks,
+ * and closes every connection.
+ **/
+void net_http_pool_free(net_http_pool_t *pool);
+
+/**
+ * net_http_get:
+ * @pool                 : pool handle.
+ * @url                  : http:// URL to fetch.
+ * @path                 : file to stream a successful body to, or
+ *                         NULL to keep it in memory.
+ * @progress             : called as the body comes in. Can be NULL.
+ * @done                 : called once the transfer is over. Can be NULL.
+ * @userdata             : passed to @progress and @done.
+ *
+ * Queues a GET request. Nothing blocks here, names are looked up
+ * and connections made from net_http_pool_poll(). Redirects are
+ * followed. A file is written to @path.tmp and only renamed over
+ * @path once complete.
+ *
+ * Returns: transfer handle, valid until @done has been called,
+ * or NULL on failure.
+ **/
+net_http_transfer_t *net_http_get(net_http_pool_t *pool, const char *url,
+      const char *path, net_http_progress_t progress,
+      net_http_done_t done, void *userdata);
+
+/**
+ * net_http_get_range:
+ * @pool                 : pool handle.
+ * @url                  : http:// URL to fetch.
+ * @offset               : first byte wanted, 0 for all of it.
+ * @write                : gets the body as it comes in.
+ * @done                 : called once the transfer is over. Can be NULL.
+ * @userdata             : passed to @write and @done.
+ *
+ * Like net_http_get(), but the body goes to @write, and only the
+ * part from @offset on is asked for, to resume earlier transfers.
+ * Bodies of other than 2xx responses still go to @done.
+ *
+ * Returns: transfer handle, valid until @done has been called,
+ * or NULL on failure.
+ **/
+net_http_transfer_t *net_http_get_range(net_http_pool_t *pool,
+      const char *url, size_t offset, net_http_write_t write,
+      net_http_done_t done, void *userdata);
+
+/**
+ * net_http_cancel:
+ * @pool                 : pool handle.
+ * @transfer             : transfer handle.
+ *
+ * Aborts a transfer. Its callbacks are not called anymore.
+ **/
+void net_http_cancel(net_http_pool_t *pool, net_http_transfer_t *transfer);
+
+/**
+ * net_http_pool_poll:
+ * @pool                 : pool handle.
+ * @timeout_ms           : how long to wait for the network, 0 to
+ *                         only do what can be done right away.
+ *
+ * Moves every transfer along as far as the network allows.
+ * Callbacks are called from here, on the thread calling it.
+ *
+ * Returns: true (1) if transfers are left, otherwise false (0).
+ **/
+bool net_http_pool_poll(net_http_pool_t *pool, unsigned timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
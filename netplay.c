@@ -23,9 +23,20 @@
 #include "general.h"
 #include "autosave.h"
 #include "dynamic.h"
+#include "performance.h"
+#include "hash.h"
 #include <queues/message_queue.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_ZLIB_DEFLATE
+#include <zlib.h>
+#endif
 
 struct delta_frame
 {
@@ -42,9 +53,52 @@ struct delta_frame
 #define UDP_FRAME_PACKETS 16
 #define MAX_SPECTATORS 16
 
+/* Input stream buffered per spectator. A spectator that falls 
+ * this far behind is dropped, so it cannot hold up the others. */
+#define SPECTATOR_BUFFER_SIZE (1 << 16)
+
+struct spectator
+{
+   int fd;
+
+   /* Input stream not written to fd yet. */
+   uint8_t *buffer;
+   size_t head;
+   size_t tail;
+
+   /* Set by the writer on socket errors. */
+   bool dead;
+   /* Set when the buffer overflowed. */
+   bool slow;
+};
+
+/* Bumped whenever the protocol changes, so that 
+ * implementation_magic_value() refuses older versions. */
+#define NETPLAY_PROTOCOL_VERSION 3
+
+/* Negotiated in send_info()/get_info(). */
+#define NETPLAY_FLAG_DELTA_INPUT (1 << 0)
+#define NETPLAY_FLAGS_SUPPORTED NETPLAY_FLAG_DELTA_INPUT
+
+/* Savestates are synced in blocks of this size. Only blocks
+ * whose CRC32 differs from the receiver's own state are sent. */
+#define NETPLAY_STATE_BLOCK_SIZE 4096
+#define NETPLAY_STATE_END 0xffffffffu
+/* Set in the block size word if the block is deflated. */
+#define NETPLAY_STATE_DEFLATED 0x80000000u
+/* Receiving side can inflate blocks. */
+#define NETPLAY_SYNC_FLAG_INFLATE (1 << 0)
+
 #define NETPLAY_CMD_ACK 0
 #define NETPLAY_CMD_NAK 1
 #define NETPLAY_CMD_FLIP_PLAYERS 2
+/* Carries a 32-bit timestamp in microseconds, which is echoed back
+ * in a PONG. Neither is acknowledged. */
+#define NETPLAY_CMD_PING 3
+#define NETPLAY_CMD_PONG 4
+
+/* How often we measure the round trip time. */
+#define NETPLAY_PING_INTERVAL_USEC 1000000
 
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
@@ -66,6 +120,8 @@ struct netplay
 
    struct delta_frame *buffer;
    size_t buffer_size;
+   /* buffer and the states in it are accounted to RARCH_MEM_NETPLAY. */
+   bool buffers_accounted;
 
    /* Pointer where we are now. */
    size_t self_ptr; 
@@ -87,6 +143,12 @@ struct netplay
    /* To compat UDP packet loss we also send 
     * old data along with the packets. */
    uint32_t packet_buffer[UDP_FRAME_PACKETS * 2];
+   /* Our own input, indexed by frame % NETPLAY_INPUT_HISTORY. */
+   uint16_t input_history[NETPLAY_INPUT_HISTORY];
+   /* Number of frames in input_history so far. */
+   uint32_t input_frames;
+   /* NETPLAY_FLAG_* agreed upon with the other side. */
+   uint32_t flags;
    uint32_t frame_count;
    uint32_t read_frame_count;
    uint32_t other_frame_count;
@@ -100,7 +162,17 @@ struct netplay
    /* Spectating. */
    bool spectate;
    bool spectate_client;
-   int spectate_fds[MAX_SPECTATORS];
+   struct spectator spectators[MAX_SPECTATORS];
+   /* Listening socket when relaying a stream we spectate ourselves. */
+   int relay_fd;
+#ifdef HAVE_THREADS
+   /* Writes the input stream to spectators, 
+    * so slow sockets do not stall the frame. */
+   sthread_t *spectate_thread;
+   slock_t *spectate_lock;
+   scond_t *spectate_cond;
+   bool spectate_quit;
+#endif
    uint16_t *spectate_input;
    size_t spectate_input_ptr;
    size_t spectate_input_size;
@@ -112,6 +184,16 @@ struct netplay
     * well after flip_frame before allowing another flip. */
    bool flip;
    uint32_t flip_frame;
+
+   /* Set while we are waiting for the other side to catch up,
+    * because all frames in the buffer are still speculative. */
+   retro_time_t stall_start;
+   retro_time_t stall_resend;
+
+   struct netplay_stats stats;
+   retro_time_t stats_start;
+   retro_time_t ping_time;
+   unsigned stats_resimulated;
 };
 
 static bool send_all(int fd, const void *data_, size_t size)
@@ -182,20 +264,113 @@ static bool netplay_can_poll(netplay_t *netplay)
    return netplay->can_poll;
 }
 
+size_t netplay_encode_input(const uint16_t *history, uint32_t frames,
+      uint8_t *out)
+{
+   uint32_t newest = frames - 1;
+   uint8_t *run    = out + NETPLAY_DELTA_HEADER_SIZE;
+   unsigned runs   = 0;
+   uint32_t i;
+
+   if (frames > NETPLAY_INPUT_HISTORY)
+      frames = NETPLAY_INPUT_HISTORY;
+
+   for (i = 0; i < frames; i++)
+   {
+      uint16_t state = history[(newest - i) % NETPLAY_INPUT_HISTORY];
+
+      if (runs && run[-3] < 0xff &&
+            ((run[-2] << 8) | run[-1]) == state)
+      {
+         run[-3]++;
+         continue;
+      }
+
+      run[0] = 1;
+      run[1] = state >> 8;
+      run[2] = state & 0xff;
+      run   += NETPLAY_DELTA_RUN_SIZE;
+      runs++;
+   }
+
+   out[0] = newest >> 24;
+   out[1] = newest >> 16;
+   out[2] = newest >>  8;
+   out[3] = newest >>  0;
+   out[4] = runs;
+
+   return run - out;
+}
+
+unsigned netplay_decode_input(const uint8_t *buffer, size_t size,
+      uint32_t *first, uint16_t *input)
+{
+   unsigned i, runs;
+   uint32_t newest, frames = 0;
+   const uint8_t *run;
+   uint16_t *end;
+
+   if (size < NETPLAY_DELTA_HEADER_SIZE)
+      return 0;
+
+   newest = ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+      ((uint32_t)buffer[2] << 8) | buffer[3];
+   runs   = buffer[4];
+
+   if (size != NETPLAY_DELTA_HEADER_SIZE + runs * NETPLAY_DELTA_RUN_SIZE)
+      return 0;
+
+   for (i = 0; i < runs; i++)
+      frames += buffer[NETPLAY_DELTA_HEADER_SIZE + i * NETPLAY_DELTA_RUN_SIZE];
+
+   if (frames == 0 || frames > NETPLAY_INPUT_HISTORY || frames > newest + 1)
+      return 0;
+
+   /* Walk the runs from the oldest frame towards the newest. */
+   run = buffer + size;
+   end = input + frames;
+
+   while (input < end)
+   {
+      unsigned len;
+      uint16_t state;
+
+      run  -= NETPLAY_DELTA_RUN_SIZE;
+      len   = run[0];
+      state = (run[1] << 8) | run[2];
+
+      while (len--)
+         *input++ = state;
+   }
+
+   *first = newest + 1 - frames;
+   return frames;
+}
+
 static bool send_chunk(netplay_t *netplay)
 {
    const struct sockaddr *addr = NULL;
+   const void *packet          = netplay->packet_buffer;
+   ssize_t packet_size         = sizeof(netplay->packet_buffer);
+   uint8_t delta[NETPLAY_MAX_PACKET_SIZE];
 
    if (netplay->addr)
       addr = netplay->addr->ai_addr;
    else if (netplay->has_client_addr)
       addr = (const struct sockaddr*)&netplay->their_addr;
 
+   if (netplay->flags & NETPLAY_FLAG_DELTA_INPUT)
+   {
+      packet      = delta;
+      packet_size = netplay_encode_input(netplay->input_history,
+            netplay->input_frames, delta);
+   }
+
    if (addr)
    {
-      if (sendto(netplay->udp_fd, CONST_CAST netplay->packet_buffer,
-               sizeof(netplay->packet_buffer), 0, addr,
-               sizeof(struct sockaddr)) != sizeof(netplay->packet_buffer))
+      if (sendto(netplay->udp_fd, CONST_CAST packet,
+               packet_size, 0, addr,
+               sizeof(struct sockaddr)) != packet_size)
       {
          warn_hangup();
          netplay->has_connection = false;
@@ -237,6 +412,8 @@ static bool get_self_input_state(netplay_t *netplay)
          sizeof (netplay->packet_buffer) - 2 * sizeof(uint32_t));
    netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2] = htonl(netplay->frame_count); 
    netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2 + 1] = htonl(state);
+   netplay->input_history[netplay->frame_count % NETPLAY_INPUT_HISTORY] = state;
+   netplay->input_frames = netplay->frame_count + 1;
 
    if (!send_chunk(netplay))
    {
@@ -262,24 +439,85 @@ static bool netplay_cmd_nak(netplay_t *netplay)
    return send_all(netplay->fd, &cmd, sizeof(cmd));
 }
 
-static bool netplay_get_response(netplay_t *netplay)
+static bool netplay_send_cmd(netplay_t *netplay, uint32_t cmd,
+      const void *data, size_t size)
 {
-   uint32_t response;
-   if (!recv_all(netplay->fd, &response, sizeof(response)))
+   cmd = (cmd << 16) | (size & 0xffff);
+   cmd = htonl(cmd);
+
+   if (!send_all(netplay->fd, &cmd, sizeof(cmd)))
+      return false;
+
+   if (!send_all(netplay->fd, data, size))
       return false;
 
-   return ntohl(response) == NETPLAY_CMD_ACK;
+   return true;
+}
+
+/**
+ * netplay_update_rtt:
+ * @netplay              : pointer to netplay object
+ * @timestamp            : timestamp our PING carried.
+ *
+ * Updates round trip time and jitter from a PONG. Jitter is 
+ * smoothed the same way as RFC 3550 interarrival jitter.
+ **/
+static void netplay_update_rtt(netplay_t *netplay, uint32_t timestamp)
+{
+   uint32_t rtt  = (uint32_t)rarch_get_time_usec() - timestamp;
+   int32_t delta = (int32_t)(rtt - netplay->stats.rtt_usec);
+
+   if (delta < 0)
+      delta = -delta;
+
+   if (netplay->stats.rtt_usec)
+      netplay->stats.jitter_usec += 
+         (delta - (int32_t)netplay->stats.jitter_usec) / 16;
+
+   netplay->stats.rtt_usec = rtt;
+}
+
+static bool netplay_handle_cmd(netplay_t *netplay, uint32_t cmd);
+
+static bool netplay_get_response(netplay_t *netplay)
+{
+   for (;;)
+   {
+      uint32_t response;
+      if (!recv_all(netplay->fd, &response, sizeof(response)))
+         return false;
+
+      response = ntohl(response);
+
+      switch (response >> 16)
+      {
+         /* The other side may measure latency while 
+          * we wait for an answer. */
+         case NETPLAY_CMD_PING:
+         case NETPLAY_CMD_PONG:
+            if (!netplay_handle_cmd(netplay, response))
+               return false;
+            break;
+         default:
+            return response == NETPLAY_CMD_ACK;
+      }
+   }
 }
 
 static bool netplay_get_cmd(netplay_t *netplay)
 {
-   uint32_t cmd, flip_frame;
-   size_t cmd_size;
+   uint32_t cmd;
 
    if (!recv_all(netplay->fd, &cmd, sizeof(cmd)))
       return false;
 
-   cmd = ntohl(cmd);
+   return netplay_handle_cmd(netplay, ntohl(cmd));
+}
+
+static bool netplay_handle_cmd(netplay_t *netplay, uint32_t cmd)
+{
+   uint32_t flip_frame, timestamp;
+   size_t cmd_size;
 
    cmd_size = cmd & 0xffff;
    cmd = cmd >> 16;
@@ -315,6 +553,24 @@ static bool netplay_get_cmd(netplay_t *netplay)
 
          return netplay_cmd_ack(netplay);
 
+      case NETPLAY_CMD_PING:
+      case NETPLAY_CMD_PONG:
+         if (cmd_size != sizeof(uint32_t))
+         {
+            RARCH_ERR("CMD_PING has unexpected command size.\n");
+            return false;
+         }
+
+         if (!recv_all(netplay->fd, &timestamp, sizeof(timestamp)))
+            return false;
+
+         if (cmd == NETPLAY_CMD_PING)
+            return netplay_send_cmd(netplay, NETPLAY_CMD_PONG,
+                  &timestamp, sizeof(timestamp));
+
+         netplay_update_rtt(netplay, ntohl(timestamp));
+         return true;
+
       default:
          break;
    }
@@ -378,37 +634,124 @@ static int poll_input(netplay_t *netplay, bool block)
    return 0;
 }
 
-static bool receive_data(netplay_t *netplay, uint32_t *buffer, size_t size)
+/**
+ * receive_data:
+ * @netplay              : pointer to netplay object
+ * @buffer               : buffer to receive into.
+ * @size                 : size of @buffer.
+ *
+ * Returns: size of the received packet, or -1 on error.
+ **/
+static ssize_t receive_data(netplay_t *netplay, void *buffer, size_t size)
 {
    socklen_t addrlen = sizeof(netplay->their_addr);
+   ssize_t ret       = recvfrom(netplay->udp_fd, NONCONST_CAST buffer,
+         size, 0, (struct sockaddr*)&netplay->their_addr, &addrlen);
 
-   if (recvfrom(netplay->udp_fd, NONCONST_CAST buffer, size, 0,
-            (struct sockaddr*)&netplay->their_addr, &addrlen) != (ssize_t)size)
-      return false;
+   if (ret < 0)
+      return -1;
    netplay->has_client_addr = true;
+   return ret;
+}
+
+static void parse_packet(netplay_t *netplay, uint32_t *buffer,
+      unsigned size, uint32_t last_frame);
+
+static void parse_delta_packet(netplay_t *netplay, const uint8_t *buffer,
+      size_t size, uint32_t last_frame);
+
+/**
+ * netplay_receive_input:
+ * @netplay              : pointer to netplay object
+ * @last_frame           : newest frame we have our own input for.
+ *
+ * Reads all input packets that are available right now,
+ * without blocking.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool netplay_receive_input(netplay_t *netplay, uint32_t last_frame)
+{
+   int res = poll_input(netplay, false);
+
+   if (res == -1)
+      goto hangup;
+
+   while (res == 1 && netplay->read_frame_count <= last_frame)
+   {
+      uint32_t buffer[NETPLAY_MAX_PACKET_SIZE / sizeof(uint32_t) + 1];
+      ssize_t size = receive_data(netplay, buffer, sizeof(buffer));
+
+      if (size < 0)
+         goto hangup;
+
+      if (netplay->flags & NETPLAY_FLAG_DELTA_INPUT)
+         parse_delta_packet(netplay, (const uint8_t*)buffer, size, last_frame);
+      else if (size == UDP_FRAME_PACKETS * 2 * sizeof(uint32_t))
+         parse_packet(netplay, buffer, UDP_FRAME_PACKETS, last_frame);
+      else
+         goto hangup;
+
+      res = poll_input(netplay, false);
+      if (res == -1)
+         goto hangup;
+   }
+
    return true;
+
+hangup:
+   warn_hangup();
+   netplay->has_connection = false;
+   return false;
+}
+
+static void read_input(netplay_t *netplay, uint32_t frame, uint16_t state)
+{
+   if (frame != netplay->read_frame_count)
+      return;
+
+   netplay->buffer[netplay->read_ptr].is_simulated = false;
+   netplay->buffer[netplay->read_ptr].real_input_state = state;
+   netplay->read_ptr = NEXT_PTR(netplay->read_ptr);
+   netplay->read_frame_count++;
+   netplay->timeout_cnt = 0;
 }
 
-static void parse_packet(netplay_t *netplay, uint32_t *buffer, unsigned size)
+static void parse_packet(netplay_t *netplay, uint32_t *buffer,
+      unsigned size, uint32_t last_frame)
 {
    unsigned i;
    for (i = 0; i < size * 2; i++)
       buffer[i] = ntohl(buffer[i]);
 
-   for (i = 0; i < size && netplay->read_frame_count <= netplay->frame_count; i++)
-   {
-      uint32_t frame = buffer[2 * i + 0];
-      uint32_t state = buffer[2 * i + 1];
+   for (i = 0; i < size && netplay->read_frame_count <= last_frame; i++)
+      read_input(netplay, buffer[2 * i + 0], buffer[2 * i + 1]);
+}
 
-      if (frame == netplay->read_frame_count)
-      {
-         netplay->buffer[netplay->read_ptr].is_simulated = false;
-         netplay->buffer[netplay->read_ptr].real_input_state = state;
-         netplay->read_ptr = NEXT_PTR(netplay->read_ptr);
-         netplay->read_frame_count++;
-         netplay->timeout_cnt = 0;
-      }
-   }
+/**
+ * parse_delta_packet:
+ * @netplay              : pointer to netplay object
+ * @buffer               : packet as built by netplay_encode_input().
+ * @size                 : size of @buffer in bytes.
+ * @last_frame           : newest frame we have our own input for.
+ *
+ * Reads the frames we do not have yet out of a 
+ * NETPLAY_FLAG_DELTA_INPUT packet. Malformed packets are dropped.
+ **/
+static void parse_delta_packet(netplay_t *netplay, const uint8_t *buffer,
+      size_t size, uint32_t last_frame)
+{
+   uint16_t input[NETPLAY_INPUT_HISTORY];
+   uint32_t first;
+   unsigned i;
+   unsigned frames = netplay_decode_input(buffer, size, &first, input);
+
+   /* Nothing new in here. */
+   if (!frames || first + frames <= netplay->read_frame_count)
+      return;
+
+   for (i = 0; i < frames && netplay->read_frame_count <= last_frame; i++)
+      read_input(netplay, first + i, input[i]);
 }
 
 /* TODO: Somewhat better prediction. :P */
@@ -427,16 +770,14 @@ static void simulate_input(netplay_t *netplay)
  * netplay_poll:
  * @netplay              : pointer to netplay object
  *
- * Polls network to see if we have anything new. If our 
- * network buffer is full, we simply have to block 
- * for new input data.
+ * Polls network to see if we have anything new. Never blocks, 
+ * netplay_pre_frame() makes sure there is room in the buffer 
+ * for another speculative frame before we get here.
  *
  * Returns: true (1) if successful, otherwise false (0).
  **/
 static bool netplay_poll(netplay_t *netplay)
 {
-   int res;
-
    if (!netplay->has_connection)
       return false;
 
@@ -457,42 +798,15 @@ static bool netplay_poll(netplay_t *netplay)
       return true;
    }
 
-   /* We might have reached the end of the buffer, where we 
-    * simply have to block. */
-   res = poll_input(netplay, netplay->other_ptr == netplay->self_ptr);
-   if (res == -1)
-   {
-      netplay->has_connection = false;
-      warn_hangup();
+   if (!netplay_receive_input(netplay, netplay->frame_count))
       return false;
-   }
 
-   if (res == 1)
-   {
-      uint32_t first_read = netplay->read_frame_count;
-      do 
-      {
-         uint32_t buffer[UDP_FRAME_PACKETS * 2];
-         if (!receive_data(netplay, buffer, sizeof(buffer)))
-         {
-            warn_hangup();
-            netplay->has_connection = false;
-            return false;
-         }
-         parse_packet(netplay, buffer, UDP_FRAME_PACKETS);
-
-      } while ((netplay->read_frame_count <= netplay->frame_count) && 
-            poll_input(netplay, (netplay->other_ptr == netplay->self_ptr) && 
-               (first_read == netplay->read_frame_count)) == 1);
-   }
-   else
+   /* Cannot allow this. Should not happen though. */
+   if (netplay->self_ptr == netplay->other_ptr)
    {
-      /* Cannot allow this. Should not happen though. */
-      if (netplay->self_ptr == netplay->other_ptr)
-      {
-         warn_hangup();
-         return false;
-      }
+      warn_hangup();
+      netplay->has_connection = false;
+      return false;
    }
 
    if (netplay->read_ptr != netplay->self_ptr)
@@ -696,9 +1010,15 @@ end:
    return fd;
 }
 
-static bool init_tcp_socket(netplay_t *netplay, const char *server,
+/**
+ * init_tcp_socket:
+ *
+ * Returns: connected or listening socket, or -1 on failure.
+ **/
+static int init_tcp_socket(netplay_t *netplay, const char *server,
       uint16_t port, bool spectate)
 {
+   int fd = -1;
    struct addrinfo hints, *res = NULL;
    memset(&hints, 0, sizeof(hints));
 
@@ -712,29 +1032,23 @@ static bool init_tcp_socket(netplay_t *netplay, const char *server,
    if (!server)
       hints.ai_flags = AI_PASSIVE;
 
-   bool ret = false;
    char port_buf[16];
    snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
    if (getaddrinfo(server, port_buf, &hints, &res) < 0)
-      return false;
+      return -1;
 
    if (!res)
-      return false;
+      return -1;
 
    /* If "localhost" is used, it is important to check every possible 
     * address for IPv4/IPv6. */
    const struct addrinfo *tmp_info = res;
    while (tmp_info)
    {
-      int fd;
-      if ((fd = init_tcp_connection(tmp_info, server, netplay->spectate,
+      if ((fd = init_tcp_connection(tmp_info, server, spectate,
                (struct sockaddr*)&netplay->other_addr,
                sizeof(netplay->other_addr))) >= 0)
-      {
-         ret = true;
-         netplay->fd = fd;
          break;
-      }
 
       tmp_info = tmp_info->ai_next;
    }
@@ -742,10 +1056,10 @@ static bool init_tcp_socket(netplay_t *netplay, const char *server,
    if (res)
       freeaddrinfo(res);
 
-   if (!ret)
+   if (fd < 0)
       RARCH_ERR("Failed to set up netplay sockets.\n");
 
-   return ret;
+   return fd;
 }
 
 static bool init_udp_socket(netplay_t *netplay, const char *server,
@@ -852,7 +1166,8 @@ static bool init_socket(netplay_t *netplay, const char *server, uint16_t port)
    if (!network_init())
       return false;
 
-   if (!init_tcp_socket(netplay, server, port, netplay->spectate))
+   netplay->fd = init_tcp_socket(netplay, server, port, netplay->spectate);
+   if (netplay->fd < 0)
       return false;
    if (!netplay->spectate && !init_udp_socket(netplay, server, port))
       return false;
@@ -880,6 +1195,7 @@ static uint32_t implementation_magic_value(void)
    unsigned api    = pretro_api_version();
 
    res |= api;
+   res ^= NETPLAY_PROTOCOL_VERSION << 8;
 
    len = strlen(lib);
    for (i = 0; i < len; i++)
@@ -946,10 +1262,12 @@ static bool send_info(netplay_t *netplay)
    unsigned sram_size;
    char msg[512];
    void *sram = NULL;
-   uint32_t header[3] = {
+   uint32_t flags;
+   uint32_t header[4] = {
       htonl(g_extern.content_crc),
       htonl(implementation_magic_value()),
-      htonl(pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM))
+      htonl(pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM)),
+      htonl(NETPLAY_FLAGS_SUPPORTED)
    };
 
    if (!send_all(netplay->fd, header, sizeof(header)))
@@ -961,6 +1279,13 @@ static bool send_info(netplay_t *netplay)
       return false;
    }
 
+   if (!recv_all(netplay->fd, &flags, sizeof(flags)))
+   {
+      RARCH_ERR("Failed to receive protocol flags from host.\n");
+      return false;
+   }
+   netplay->flags = ntohl(flags) & NETPLAY_FLAGS_SUPPORTED;
+
    /* Get SRAM data from User 1. */
    sram      = pretro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
    sram_size = pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
@@ -988,7 +1313,8 @@ static bool get_info(netplay_t *netplay)
 {
    const void *sram;
    unsigned sram_size;
-   uint32_t header[3];
+   uint32_t flags;
+   uint32_t header[4];
 
    if (!recv_all(netplay->fd, header, sizeof(header)))
    {
@@ -1020,6 +1346,16 @@ static bool get_info(netplay_t *netplay)
       return false;
    }
 
+   /* Use whatever both sides support. */
+   netplay->flags = ntohl(header[3]) & NETPLAY_FLAGS_SUPPORTED;
+   flags          = htonl(netplay->flags);
+
+   if (!send_all(netplay->fd, &flags, sizeof(flags)))
+   {
+      RARCH_ERR("Failed to send protocol flags to client.\n");
+      return false;
+   }
+
    /* Send SRAM data to our User 2. */
    sram      = pretro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
    sram_size = pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
@@ -1108,67 +1444,476 @@ static bool bsv_parse_header(const uint32_t *header, uint32_t magic)
    return true;
 }
 
-static bool get_info_spectate(netplay_t *netplay)
+/**
+ * send_state:
+ * @fd                   : TCP socket.
+ * @state                : savestate to send.
+ * @size                 : size of @state.
+ *
+ * Sends @state to a receiver in recv_state(). The receiver first
+ * tells us the CRC32 of each block of its own state, and we send 
+ * only the blocks that differ, deflated if both sides can.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool send_state(int fd, const uint8_t *state, size_t size)
 {
-   void *buf;
-   size_t save_state_size, size;
-   uint32_t header[4];
-   char msg[512];
-   bool ret = true;
-
-   if (!send_nickname(netplay, netplay->fd))
-   {
-      RARCH_ERR("Failed to send nickname to host.\n");
+   uint32_t i, flags, num_blocks, sent = 0, bytes = 0, word;
+   uint32_t blocks    = (size + NETPLAY_STATE_BLOCK_SIZE - 1) /
+      NETPLAY_STATE_BLOCK_SIZE;
+   uint32_t *crcs     = NULL;
+   uint8_t *deflated  = NULL;
+   bool ret           = false;
+
+   if (!recv_all(fd, &flags, sizeof(flags)) ||
+         !recv_all(fd, &num_blocks, sizeof(num_blocks)))
       return false;
-   }
 
-   if (!get_nickname(netplay, netplay->fd))
+   flags      = ntohl(flags);
+   num_blocks = ntohl(num_blocks);
+
+   if (num_blocks != blocks)
    {
-      RARCH_ERR("Failed to receive nickname from host.\n");
+      RARCH_ERR("State sync: block count mismatch.\n");
       return false;
    }
 
-   snprintf(msg, sizeof(msg), "Connected to \"%s\"", netplay->other_nick);
-   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
-   RARCH_LOG("%s\n", msg);
+   crcs = (uint32_t*)malloc(blocks * sizeof(uint32_t) + 1);
+   if (!crcs || !recv_all(fd, crcs, blocks * sizeof(uint32_t)))
+      goto end;
 
+#ifdef HAVE_ZLIB_DEFLATE
+   if (flags & NETPLAY_SYNC_FLAG_INFLATE)
+      deflated = (uint8_t*)malloc(compressBound(NETPLAY_STATE_BLOCK_SIZE));
+#endif
 
-   if (!recv_all(netplay->fd, header, sizeof(header)))
+   for (i = 0; i < blocks; i++)
    {
-      RARCH_ERR("Cannot get header from host.\n");
-      return false;
-   }
+      const uint8_t *block = state + i * NETPLAY_STATE_BLOCK_SIZE;
+      size_t block_size    = size - i * NETPLAY_STATE_BLOCK_SIZE;
+      const void *data     = block;
+      uint32_t data_size;
 
-   save_state_size = pretro_serialize_size();
-   if (!bsv_parse_header(header, implementation_magic_value()))
-   {
-      RARCH_ERR("Received invalid BSV header from host.\n");
-      return false;
-   }
+      if (block_size > NETPLAY_STATE_BLOCK_SIZE)
+         block_size = NETPLAY_STATE_BLOCK_SIZE;
 
-   buf = malloc(save_state_size);
-   if (!buf)
-      return false;
+      if (crc32_calculate(block, block_size) == ntohl(crcs[i]))
+         continue;
 
-   size = save_state_size;
+      data_size = block_size;
 
-   if (!recv_all(netplay->fd, buf, size))
-   {
-      RARCH_ERR("Failed to receive save state from host.\n");
-      free(buf);
-      return false;
+#ifdef HAVE_ZLIB_DEFLATE
+      if (deflated)
+      {
+         uLongf out_size = compressBound(NETPLAY_STATE_BLOCK_SIZE);
+         if (compress2(deflated, &out_size, block, block_size,
+                  Z_BEST_SPEED) == Z_OK && out_size < block_size)
+         {
+            data      = deflated;
+            data_size = out_size | NETPLAY_STATE_DEFLATED;
+         }
+      }
+#endif
+
+      word = htonl(i);
+      if (!send_all(fd, &word, sizeof(word)))
+         goto end;
+      word = htonl(data_size);
+      if (!send_all(fd, &word, sizeof(word)))
+         goto end;
+      if (!send_all(fd, data, data_size & ~NETPLAY_STATE_DEFLATED))
+         goto end;
+
+      sent++;
+      bytes += data_size & ~NETPLAY_STATE_DEFLATED;
    }
 
-   if (save_state_size)
-      ret = pretro_unserialize(buf, save_state_size);
+   word = htonl(NETPLAY_STATE_END);
+   if (!send_all(fd, &word, sizeof(word)))
+      goto end;
+   word = htonl(crc32_calculate(state, size));
+   if (!send_all(fd, &word, sizeof(word)))
+      goto end;
+
+   RARCH_LOG("State sync: sent %u of %u blocks, %u bytes.\n",
+         sent, blocks, bytes);
+   ret = true;
 
-   free(buf);
+end:
+   free(crcs);
+   free(deflated);
    return ret;
 }
 
-static bool init_buffers(netplay_t *netplay)
+/**
+ * recv_state:
+ * @fd                   : TCP socket.
+ * @state                : our own current savestate. Is updated
+ *                         to the sender's state.
+ * @size                 : size of @state.
+ *
+ * Receives a savestate sent with send_state().
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool recv_state(int fd, uint8_t *state, size_t size)
 {
-   unsigned i;
+   uint32_t i, word;
+   uint32_t blocks   = (size + NETPLAY_STATE_BLOCK_SIZE - 1) /
+      NETPLAY_STATE_BLOCK_SIZE;
+   uint32_t *crcs    = (uint32_t*)malloc(blocks * sizeof(uint32_t) + 1);
+   uint8_t *inflated = NULL;
+   bool ret          = false;
+
+   if (!crcs)
+      return false;
+
+   word = 0;
+#ifdef HAVE_ZLIB
+   word = NETPLAY_SYNC_FLAG_INFLATE;
+#endif
+   word = htonl(word);
+   if (!send_all(fd, &word, sizeof(word)))
+      goto end;
+   word = htonl(blocks);
+   if (!send_all(fd, &word, sizeof(word)))
+      goto end;
+
+   for (i = 0; i < blocks; i++)
+   {
+      size_t block_size = size - i * NETPLAY_STATE_BLOCK_SIZE;
+      if (block_size > NETPLAY_STATE_BLOCK_SIZE)
+         block_size = NETPLAY_STATE_BLOCK_SIZE;
+      crcs[i] = htonl(crc32_calculate(
+               state + i * NETPLAY_STATE_BLOCK_SIZE, block_size));
+   }
+
+   if (!send_all(fd, crcs, blocks * sizeof(uint32_t)))
+      goto end;
+
+   inflated = (uint8_t*)malloc(NETPLAY_STATE_BLOCK_SIZE);
+   if (!inflated)
+      goto end;
+
+   for (;;)
+   {
+      uint32_t idx, data_size;
+      size_t block_size;
+      uint8_t *block;
+
+      if (!recv_all(fd, &idx, sizeof(idx)))
+         goto end;
+      idx = ntohl(idx);
+      if (idx == NETPLAY_STATE_END)
+         break;
+
+      if (idx >= blocks || !recv_all(fd, &data_size, sizeof(data_size)))
+         goto end;
+      data_size = ntohl(data_size);
+
+      block      = state + idx * NETPLAY_STATE_BLOCK_SIZE;
+      block_size = size - idx * NETPLAY_STATE_BLOCK_SIZE;
+      if (block_size > NETPLAY_STATE_BLOCK_SIZE)
+         block_size = NETPLAY_STATE_BLOCK_SIZE;
+
+      if ((data_size & ~NETPLAY_STATE_DEFLATED) > block_size)
+         goto end;
+
+      if (!(data_size & NETPLAY_STATE_DEFLATED))
+      {
+         if (data_size != block_size || !recv_all(fd, block, block_size))
+            goto end;
+         continue;
+      }
+
+#ifdef HAVE_ZLIB
+      {
+         uLongf out_size = block_size;
+         data_size &= ~NETPLAY_STATE_DEFLATED;
+
+         if (!recv_all(fd, inflated, data_size))
+            goto end;
+
+         if (uncompress(block, &out_size, inflated, data_size) != Z_OK
+               || out_size != block_size)
+            goto end;
+      }
+#else
+      goto end;
+#endif
+   }
+
+   if (!recv_all(fd, &word, sizeof(word)))
+      goto end;
+
+   ret = ntohl(word) == crc32_calculate(state, size);
+   if (!ret)
+      RARCH_ERR("State sync: CRC32 mismatch after sync.\n");
+
+end:
+   free(crcs);
+   free(inflated);
+   return ret;
+}
+
+static bool get_info_spectate(netplay_t *netplay)
+{
+   void *buf;
+   size_t save_state_size, size;
+   uint32_t header[4];
+   char msg[512];
+   bool ret = true;
+
+   if (!send_nickname(netplay, netplay->fd))
+   {
+      RARCH_ERR("Failed to send nickname to host.\n");
+      return false;
+   }
+
+   if (!get_nickname(netplay, netplay->fd))
+   {
+      RARCH_ERR("Failed to receive nickname from host.\n");
+      return false;
+   }
+
+   snprintf(msg, sizeof(msg), "Connected to \"%s\"", netplay->other_nick);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+   RARCH_LOG("%s\n", msg);
+
+
+   if (!recv_all(netplay->fd, header, sizeof(header)))
+   {
+      RARCH_ERR("Cannot get header from host.\n");
+      return false;
+   }
+
+   save_state_size = pretro_serialize_size();
+   if (!bsv_parse_header(header, implementation_magic_value()))
+   {
+      RARCH_ERR("Received invalid BSV header from host.\n");
+      return false;
+   }
+
+   if (!save_state_size)
+      return true;
+
+   buf = malloc(save_state_size);
+   if (!buf)
+      return false;
+
+   size = save_state_size;
+
+   /* Our own state is likely close to the host's, since we
+    * run the same content. Only the differences are sent. */
+   if (!pretro_serialize(buf, size))
+      memset(buf, 0, size);
+
+   if (!recv_state(netplay->fd, (uint8_t*)buf, size))
+   {
+      RARCH_ERR("Failed to receive save state from host.\n");
+      free(buf);
+      return false;
+   }
+
+   ret = pretro_unserialize(buf, save_state_size);
+
+   free(buf);
+   return ret;
+}
+
+static bool socket_nonblock(int fd)
+{
+#if defined(_WIN32)
+   u_long mode = 1;
+   return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#elif defined(__CELLOS_LV2__)
+   int i = 1;
+   return setsockopt(fd, SOL_SOCKET, SO_NBIO, &i, sizeof(int)) == 0;
+#else
+   return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool socket_would_block(void)
+{
+#if defined(_WIN32)
+   return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+   return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static void spectators_lock(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   if (netplay->spectate_lock)
+      slock_lock(netplay->spectate_lock);
+#endif
+}
+
+static void spectators_unlock(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   if (netplay->spectate_lock)
+      slock_unlock(netplay->spectate_lock);
+#endif
+}
+
+/**
+ * spectators_flush:
+ * @netplay              : pointer to netplay object
+ * @writable             : sockets known to be writable, or NULL
+ *                         to try all of them.
+ *
+ * Writes as much of the buffered input stream as the sockets
+ * take without blocking. Must be called with the lock held.
+ **/
+static void spectators_flush(netplay_t *netplay, const fd_set *writable)
+{
+   unsigned i;
+
+   for (i = 0; i < MAX_SPECTATORS; i++)
+   {
+      struct spectator *s = &netplay->spectators[i];
+
+      while (s->fd >= 0 && !s->dead && s->head != s->tail)
+      {
+         ssize_t ret;
+         size_t size = (s->head > s->tail ? s->head : SPECTATOR_BUFFER_SIZE)
+            - s->tail;
+
+         if (writable && !FD_ISSET(s->fd, writable))
+            break;
+
+         ret = send(s->fd, CONST_CAST (s->buffer + s->tail), size, 0);
+         if (ret < 0)
+         {
+            if (!socket_would_block())
+               s->dead = true;
+            break;
+         }
+
+         s->tail = (s->tail + ret) % SPECTATOR_BUFFER_SIZE;
+      }
+   }
+}
+
+#ifdef HAVE_THREADS
+static void spectate_thread(void *data)
+{
+   netplay_t *netplay = (netplay_t*)data;
+
+   slock_lock(netplay->spectate_lock);
+
+   while (!netplay->spectate_quit)
+   {
+      unsigned i;
+      fd_set fds;
+      int max_fd = -1;
+      struct timeval tv = {0};
+
+      FD_ZERO(&fds);
+      for (i = 0; i < MAX_SPECTATORS; i++)
+      {
+         const struct spectator *s = &netplay->spectators[i];
+         if (s->fd < 0 || s->dead || s->head == s->tail)
+            continue;
+
+         FD_SET(s->fd, &fds);
+         if (s->fd > max_fd)
+            max_fd = s->fd;
+      }
+
+      if (max_fd < 0)
+      {
+         scond_wait(netplay->spectate_cond, netplay->spectate_lock);
+         continue;
+      }
+
+      slock_unlock(netplay->spectate_lock);
+
+      /* Time out now and then so we notice new data and quit requests. */
+      tv.tv_usec = 100000;
+      if (select(max_fd + 1, NULL, &fds, NULL, &tv) < 0)
+         FD_ZERO(&fds);
+
+      slock_lock(netplay->spectate_lock);
+      spectators_flush(netplay, &fds);
+   }
+
+   slock_unlock(netplay->spectate_lock);
+}
+#endif
+
+/**
+ * spectators_init:
+ * @netplay              : pointer to netplay object
+ *
+ * Sets up the spectator list and, if threads are available,
+ * the writer thread.
+ **/
+static void spectators_init(netplay_t *netplay)
+{
+   unsigned i;
+
+   for (i = 0; i < MAX_SPECTATORS; i++)
+      netplay->spectators[i].fd = -1;
+
+#ifdef HAVE_THREADS
+   if (netplay->spectate_thread)
+      return;
+
+   netplay->spectate_lock = slock_new();
+   netplay->spectate_cond = scond_new();
+
+   if (netplay->spectate_lock && netplay->spectate_cond)
+      netplay->spectate_thread = sthread_create(spectate_thread, netplay);
+
+   if (!netplay->spectate_thread)
+   {
+      RARCH_WARN("Failed to start spectator thread, writing on the main thread.\n");
+      if (netplay->spectate_lock)
+         slock_free(netplay->spectate_lock);
+      if (netplay->spectate_cond)
+         scond_free(netplay->spectate_cond);
+      netplay->spectate_lock = NULL;
+      netplay->spectate_cond = NULL;
+   }
+#endif
+}
+
+static void spectators_deinit(netplay_t *netplay)
+{
+   unsigned i;
+
+#ifdef HAVE_THREADS
+   if (netplay->spectate_thread)
+   {
+      slock_lock(netplay->spectate_lock);
+      netplay->spectate_quit = true;
+      scond_signal(netplay->spectate_cond);
+      slock_unlock(netplay->spectate_lock);
+
+      sthread_join(netplay->spectate_thread);
+      slock_free(netplay->spectate_lock);
+      scond_free(netplay->spectate_cond);
+      netplay->spectate_thread = NULL;
+      netplay->spectate_lock = NULL;
+      netplay->spectate_cond = NULL;
+   }
+#endif
+
+   for (i = 0; i < MAX_SPECTATORS; i++)
+   {
+      if (netplay->spectators[i].fd >= 0)
+         close(netplay->spectators[i].fd);
+      free(netplay->spectators[i].buffer);
+   }
+}
+
+static bool init_buffers(netplay_t *netplay)
+{
+   unsigned i;
 
    if (!netplay)
       return false;
@@ -1191,6 +1936,10 @@ static bool init_buffers(netplay_t *netplay)
       netplay->buffer[i].is_simulated = true;
    }
 
+   rarch_mem_add(RARCH_MEM_NETPLAY, netplay->buffer_size *
+         (sizeof(*netplay->buffer) + netplay->state_size));
+   netplay->buffers_accounted = true;
+
    return true;
 }
 
@@ -1225,6 +1974,7 @@ netplay_t *netplay_new(const char *server, uint16_t port,
 
    netplay->fd = -1;
    netplay->udp_fd = -1;
+   netplay->relay_fd = -1;
    netplay->cbs = *cb;
    netplay->port = server ? 0 : 1;
    netplay->spectate = spectate;
@@ -1245,8 +1995,8 @@ netplay_t *netplay_new(const char *server, uint16_t port,
             goto error;
       }
 
-      for (i = 0; i < MAX_SPECTATORS; i++)
-         netplay->spectate_fds[i] = -1;
+      if (!server)
+         spectators_init(netplay);
    }
    else
    {
@@ -1261,7 +2011,9 @@ netplay_t *netplay_new(const char *server, uint16_t port,
             goto error;
       }
 
-      netplay->buffer_size = frames + 1;
+      /* We need room for at least one speculative frame,
+       * otherwise both sides wait for each other forever. */
+      netplay->buffer_size = (frames ? frames : 1) + 1;
 
       if (!init_buffers(netplay))
          goto error;
@@ -1281,18 +2033,45 @@ error:
    return NULL;
 }
 
-static bool netplay_send_cmd(netplay_t *netplay, uint32_t cmd,
-      const void *data, size_t size)
+/**
+ * netplay_get_stats:
+ * @netplay              : pointer to netplay object
+ * @stats                : filled with the current statistics.
+ *
+ * Gets rollback, prediction and latency statistics 
+ * of the current session.
+ **/
+void netplay_get_stats(netplay_t *netplay, struct netplay_stats *stats)
 {
-   cmd = (cmd << 16) | (size & 0xffff);
-   cmd = htonl(cmd);
+   *stats = netplay->stats;
+}
 
-   if (!send_all(netplay->fd, &cmd, sizeof(cmd)))
+/**
+ * netplay_spectate_relay:
+ * @netplay              : pointer to netplay object
+ * @port                 : port to accept spectators on.
+ *
+ * When spectating, re-broadcasts the stream we receive to
+ * spectators of our own.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool netplay_spectate_relay(netplay_t *netplay, uint16_t port)
+{
+   if (!netplay->spectate || !netplay->spectate_client)
+   {
+      RARCH_ERR("Relaying is only possible when spectating.\n");
       return false;
+   }
 
-   if (!send_all(netplay->fd, data, size))
+   netplay->relay_fd = init_tcp_socket(netplay, NULL, port, true);
+   if (netplay->relay_fd < 0)
       return false;
 
+   spectators_init(netplay);
+
+   RARCH_LOG("Relaying spectator stream on port %hu.\n",
+         (unsigned short)port);
    return true;
 }
 
@@ -1361,13 +2140,22 @@ void netplay_free(netplay_t *netplay)
 {
    unsigned i;
 
+   if (!netplay->spectate)
+      RARCH_LOG("Netplay: %u rollbacks, %u frames resimulated, "
+            "deepest rollback %u frames, stalled for %u frames, "
+            "%u of %u predictions missed.\n",
+            netplay->stats.rollbacks, netplay->stats.resimulated,
+            netplay->stats.max_rollback, netplay->stats.stalled,
+            netplay->stats.mispredictions, netplay->stats.predictions);
+
    close(netplay->fd);
 
    if (netplay->spectate)
    {
-      for (i = 0; i < MAX_SPECTATORS; i++)
-         if (netplay->spectate_fds[i] >= 0)
-            close(netplay->spectate_fds[i]);
+      if (!netplay->spectate_client || netplay->relay_fd >= 0)
+         spectators_deinit(netplay);
+      if (netplay->relay_fd >= 0)
+         close(netplay->relay_fd);
 
       free(netplay->spectate_input);
    }
@@ -1379,6 +2167,10 @@ void netplay_free(netplay_t *netplay)
          free(netplay->buffer[i].state);
 
       free(netplay->buffer);
+
+      if (netplay->buffers_accounted)
+         rarch_mem_sub(RARCH_MEM_NETPLAY, netplay->buffer_size *
+               (sizeof(*netplay->buffer) + netplay->state_size));
    }
 
    if (netplay->addr)
@@ -1387,19 +2179,221 @@ void netplay_free(netplay_t *netplay)
    free(netplay);
 }
 
+/**
+ * netplay_update_stats:
+ * @netplay              : pointer to netplay object
+ *
+ * Folds the counters of the last second into netplay->stats.
+ **/
+static void netplay_update_stats(netplay_t *netplay)
+{
+   retro_time_t now = rarch_get_time_usec();
+
+   if (!netplay->stats_start)
+      netplay->stats_start = now;
+
+   if (now - netplay->stats_start < 1000000)
+      return;
+
+   netplay->stats.resimulated_per_sec = netplay->stats_resimulated;
+   netplay->stats_resimulated         = 0;
+   netplay->stats_start               = now;
+}
+
+/**
+ * netplay_ping:
+ * @netplay              : pointer to netplay object
+ *
+ * Sends a PING now and then, so that we know the
+ * round trip time of the connection.
+ **/
+static void netplay_ping(netplay_t *netplay)
+{
+   uint32_t timestamp;
+   retro_time_t now = rarch_get_time_usec();
+
+   if (!netplay->has_connection
+         || now - netplay->ping_time < NETPLAY_PING_INTERVAL_USEC)
+      return;
+
+   netplay->ping_time = now;
+   timestamp          = htonl((uint32_t)now);
+
+   if (!netplay_send_cmd(netplay, NETPLAY_CMD_PING,
+            &timestamp, sizeof(timestamp)))
+   {
+      warn_hangup();
+      netplay->has_connection = false;
+   }
+}
+
+/**
+ * netplay_resimulate:
+ * @netplay              : pointer to netplay object
+ *
+ * Skips past all frames that were predicted correctly, then
+ * rolls back to the first mispredicted frame and runs the core
+ * forward again to where we are now.
+ **/
+static void netplay_resimulate(netplay_t *netplay)
+{
+   unsigned depth;
+   bool first = true;
+   uint16_t prediction;
+
+   /* Nothing to do... */
+   if (netplay->other_frame_count == netplay->read_frame_count)
+      return;
+
+   /* Skip ahead if we predicted correctly.
+    * Skip until our simulation failed. */
+   while (netplay->other_frame_count < netplay->read_frame_count)
+   {
+      const struct delta_frame *ptr = &netplay->buffer[netplay->other_ptr];
+      if ((ptr->simulated_input_state != ptr->real_input_state)
+            && !ptr->used_real)
+         break;
+      if (!ptr->used_real)
+         netplay->stats.predictions++;
+      netplay->other_ptr = NEXT_PTR(netplay->other_ptr);
+      netplay->other_frame_count++;
+   }
+
+   if (netplay->other_frame_count >= netplay->read_frame_count)
+      return;
+
+   netplay->stats.predictions++;
+   netplay->stats.mispredictions++;
+
+   /* Frames we still have no real input for are predicted again
+    * from the newest input we know of. */
+   prediction = netplay->buffer[PREV_PTR(netplay->read_ptr)].real_input_state;
+   depth      = netplay->frame_count - netplay->other_frame_count;
+
+   RARCH_PERFORMANCE_INIT(netplay_resimulate);
+   RARCH_PERFORMANCE_START(netplay_resimulate);
+
+   /* Replay frames. */
+   netplay->is_replay = true;
+   netplay->tmp_ptr = netplay->other_ptr;
+   netplay->tmp_frame_count = netplay->other_frame_count;
+
+   pretro_unserialize(netplay->buffer[netplay->other_ptr].state,
+         netplay->state_size);
+
+   while (first || (netplay->tmp_ptr != netplay->self_ptr))
+   {
+      struct delta_frame *ptr = &netplay->buffer[netplay->tmp_ptr];
+
+      if (ptr->is_simulated)
+         ptr->simulated_input_state = prediction;
+
+      pretro_serialize(ptr->state, netplay->state_size);
+#if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
+      lock_autosave();
+#endif
+      pretro_run();
+#if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
+      unlock_autosave();
+#endif
+      netplay->tmp_ptr = NEXT_PTR(netplay->tmp_ptr);
+      netplay->tmp_frame_count++;
+      first = false;
+   }
+
+   netplay->other_ptr = netplay->read_ptr;
+   netplay->other_frame_count = netplay->read_frame_count;
+   netplay->is_replay = false;
+
+   RARCH_PERFORMANCE_STOP(netplay_resimulate);
+
+   netplay->stats.rollbacks++;
+   netplay->stats.resimulated += depth;
+   netplay->stats_resimulated += depth;
+   if (depth > netplay->stats.max_rollback)
+      netplay->stats.max_rollback = depth;
+}
+
+/**
+ * netplay_stall:
+ * @netplay              : pointer to netplay object
+ *
+ * Called when every frame in the buffer is still speculative.
+ * Reads whatever input has arrived and resimulates, without 
+ * blocking. Resends our input now and then in case it got lost,
+ * and gives up on the connection after a while.
+ *
+ * Returns: true (1) if we can run the next frame, false (0) if
+ * we still have to wait.
+ **/
+static bool netplay_stall(netplay_t *netplay)
+{
+   retro_time_t now = rarch_get_time_usec();
+
+   if (!netplay->stall_start)
+   {
+      netplay->stall_start  = now;
+      netplay->stall_resend = now;
+   }
+
+   /* We have not polled our own input for this frame yet,
+    * so only read up to the previous one. */
+   if (netplay_receive_input(netplay, netplay->frame_count - 1))
+      netplay_resimulate(netplay);
+
+   if (!netplay->has_connection
+         || NEXT_PTR(netplay->self_ptr) != netplay->other_ptr)
+   {
+      netplay->stall_start = 0;
+      return true;
+   }
+
+   netplay->stats.stalled++;
+
+   if (now - netplay->stall_start >= MAX_RETRIES * RETRY_MS * 1000LL)
+   {
+      warn_hangup();
+      netplay->has_connection = false;
+      netplay->stall_start = 0;
+      return true;
+   }
+
+   if (now - netplay->stall_resend >= RETRY_MS * 1000)
+   {
+      RARCH_LOG("Network is stalling, resending packet ...\n");
+      netplay->stall_resend = now;
+      if (!send_chunk(netplay))
+         return true;
+   }
+
+   return false;
+}
+
 /**
  * netplay_pre_frame_net:   
  * @netplay              : pointer to netplay object
  *
  * Pre-frame for Netplay (normal version).
+ *
+ * Returns: true (1) if the frame should be run, false (0)
+ * if we are waiting for input from the other side.
  **/
-static void netplay_pre_frame_net(netplay_t *netplay)
+static bool netplay_pre_frame_net(netplay_t *netplay)
 {
+   netplay_update_stats(netplay);
+   netplay_ping(netplay);
+
+   if (netplay->has_connection
+         && NEXT_PTR(netplay->self_ptr) == netplay->other_ptr
+         && !netplay_stall(netplay))
+      return false;
+
    pretro_serialize(netplay->buffer[netplay->self_ptr].state,
          netplay->state_size);
    netplay->can_poll = true;
 
    input_poll_net();
+   return true;
 }
 
 static void netplay_set_spectate_input(netplay_t *netplay, int16_t input)
@@ -1431,7 +2425,14 @@ static int16_t netplay_get_spectate_input(netplay_t *netplay, bool port,
    int16_t inp;
 
    if (recv_all(netplay->fd, NONCONST_CAST &inp, sizeof(inp)))
-      return swap_if_big16(inp);
+   {
+      inp = swap_if_big16(inp);
+
+      /* Pass the stream on to our own spectators. */
+      if (netplay->relay_fd >= 0)
+         netplay_set_spectate_input(netplay, inp);
+      return inp;
+   }
 
    RARCH_ERR("Connection with host was cut.\n");
    msg_queue_clear(g_extern.msg_queue);
@@ -1454,6 +2455,7 @@ int16_t input_state_spectate_client(unsigned port, unsigned device,
  * @netplay              : pointer to netplay object
  *
  * Pre-frame for Netplay (spectate mode version).
+ * Accepts new spectators, either as the host or as a relay.
  **/
 static void netplay_pre_frame_spectate(netplay_t *netplay)
 {
@@ -1465,21 +2467,24 @@ static void netplay_pre_frame_spectate(netplay_t *netplay)
    socklen_t addr_size;
    fd_set fds;
    struct timeval tmp_tv = {0};
+   uint8_t *buffer = NULL;
+   int listen_fd   = netplay->spectate_client ?
+      netplay->relay_fd : netplay->fd;
 
-   if (netplay->spectate_client)
+   if (listen_fd < 0)
       return;
 
    FD_ZERO(&fds);
-   FD_SET(netplay->fd, &fds);
+   FD_SET(listen_fd, &fds);
 
-   if (select(netplay->fd + 1, &fds, NULL, NULL, &tmp_tv) <= 0)
+   if (select(listen_fd + 1, &fds, NULL, NULL, &tmp_tv) <= 0)
       return;
 
-   if (!FD_ISSET(netplay->fd, &fds))
+   if (!FD_ISSET(listen_fd, &fds))
       return;
 
    addr_size = sizeof(their_addr);
-   new_fd = accept(netplay->fd, (struct sockaddr*)&their_addr, &addr_size);
+   new_fd = accept(listen_fd, (struct sockaddr*)&their_addr, &addr_size);
    if (new_fd < 0)
    {
       RARCH_ERR("Failed to accept incoming spectator.\n");
@@ -1487,14 +2492,16 @@ static void netplay_pre_frame_spectate(netplay_t *netplay)
    }
 
    idx = -1;
+   spectators_lock(netplay);
    for (i = 0; i < MAX_SPECTATORS; i++)
    {
-      if (netplay->spectate_fds[i] == -1)
+      if (netplay->spectators[i].fd == -1)
       {
          idx = i;
          break;
       }
    }
+   spectators_unlock(netplay);
 
    /* No vacant client streams :( */
    if (idx == -1)
@@ -1531,7 +2538,7 @@ static void netplay_pre_frame_spectate(netplay_t *netplay)
    setsockopt(new_fd, SOL_SOCKET, SO_SNDBUF, CONST_CAST &bufsize,
          sizeof(int));
 
-   if (!send_all(new_fd, header, header_size))
+   if (!send_all(new_fd, header, 4 * sizeof(uint32_t)))
    {
       RARCH_ERR("Failed to send header to client.\n");
       close(new_fd);
@@ -1539,8 +2546,33 @@ static void netplay_pre_frame_spectate(netplay_t *netplay)
       return;
    }
 
+   if (header_size > 4 * sizeof(uint32_t) &&
+         !send_state(new_fd, (const uint8_t*)(header + 4),
+            header_size - 4 * sizeof(uint32_t)))
+   {
+      RARCH_ERR("Failed to send save state to client.\n");
+      close(new_fd);
+      free(header);
+      return;
+   }
+
    free(header);
-   netplay->spectate_fds[idx] = new_fd;
+
+   buffer = (uint8_t*)malloc(SPECTATOR_BUFFER_SIZE);
+   if (!buffer || !socket_nonblock(new_fd))
+   {
+      RARCH_ERR("Failed to set up spectator stream.\n");
+      free(buffer);
+      close(new_fd);
+      return;
+   }
+
+   spectators_lock(netplay);
+   free(netplay->spectators[idx].buffer);
+   memset(&netplay->spectators[idx], 0, sizeof(netplay->spectators[idx]));
+   netplay->spectators[idx].buffer = buffer;
+   netplay->spectators[idx].fd     = new_fd;
+   spectators_unlock(netplay);
 
 #ifndef HAVE_SOCKET_LEGACY
    log_connection(&their_addr, idx, netplay->other_nick);
@@ -1553,13 +2585,18 @@ static void netplay_pre_frame_spectate(netplay_t *netplay)
  *
  * Pre-frame for Netplay.
  * Call this before running retro_run().
+ *
+ * Returns: true (1) if retro_run() should be called this frame,
+ * false (0) if we have to wait for the other side.
  **/
-void netplay_pre_frame(netplay_t *netplay)
+bool netplay_pre_frame(netplay_t *netplay)
 {
    if (netplay->spectate)
+   {
       netplay_pre_frame_spectate(netplay);
-   else
-      netplay_pre_frame_net(netplay);
+      return true;
+   }
+   return netplay_pre_frame_net(netplay);
 }
 
 /**
@@ -1572,55 +2609,7 @@ void netplay_pre_frame(netplay_t *netplay)
 static void netplay_post_frame_net(netplay_t *netplay)
 {
    netplay->frame_count++;
-
-   /* Nothing to do... */
-   if (netplay->other_frame_count == netplay->read_frame_count)
-      return;
-
-   /* Skip ahead if we predicted correctly.
-    * Skip until our simulation failed. */
-   while (netplay->other_frame_count < netplay->read_frame_count)
-   {
-      const struct delta_frame *ptr = &netplay->buffer[netplay->other_ptr];
-      if ((ptr->simulated_input_state != ptr->real_input_state)
-            && !ptr->used_real)
-         break;
-      netplay->other_ptr = NEXT_PTR(netplay->other_ptr);
-      netplay->other_frame_count++;
-   }
-
-   if (netplay->other_frame_count < netplay->read_frame_count)
-   {
-      bool first = true;
-
-      /* Replay frames. */
-      netplay->is_replay = true;
-      netplay->tmp_ptr = netplay->other_ptr;
-      netplay->tmp_frame_count = netplay->other_frame_count;
-
-      pretro_unserialize(netplay->buffer[netplay->other_ptr].state,
-            netplay->state_size);
-
-      while (first || (netplay->tmp_ptr != netplay->self_ptr))
-      {
-         pretro_serialize(netplay->buffer[netplay->tmp_ptr].state,
-               netplay->state_size);
-#if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
-         lock_autosave();
-#endif
-         pretro_run();
-#if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
-         unlock_autosave();
-#endif
-         netplay->tmp_ptr = NEXT_PTR(netplay->tmp_ptr);
-         netplay->tmp_frame_count++;
-         first = false;
-      }
-
-      netplay->other_ptr = netplay->read_ptr;
-      netplay->other_frame_count = netplay->read_frame_count;
-      netplay->is_replay = false;
-   }
+   netplay_resimulate(netplay);
 }
 
 /**
@@ -1633,31 +2622,67 @@ static void netplay_post_frame_net(netplay_t *netplay)
 static void netplay_post_frame_spectate(netplay_t *netplay)
 {
    unsigned i;
-   if (netplay->spectate_client)
+   const uint8_t *data = (const uint8_t*)netplay->spectate_input;
+   size_t size         = netplay->spectate_input_ptr * sizeof(int16_t);
+
+   if (netplay->spectate_client && netplay->relay_fd < 0)
       return;
 
+   spectators_lock(netplay);
+
    for (i = 0; i < MAX_SPECTATORS; i++)
    {
-      if (netplay->spectate_fds[i] == -1)
+      struct spectator *s = &netplay->spectators[i];
+      size_t used, first;
+      char msg[512];
+
+      if (s->fd < 0)
          continue;
 
-      if (!send_all(netplay->spectate_fds[i],
-               netplay->spectate_input,
-               netplay->spectate_input_ptr * sizeof(int16_t)))
-      {
-         char msg[512];
+      used = (s->head + SPECTATOR_BUFFER_SIZE - s->tail) 
+         % SPECTATOR_BUFFER_SIZE;
 
-         RARCH_LOG("Client (#%u) disconnected ...\n", i);
+      /* One byte is kept free to tell a full buffer from an empty one. */
+      if (!s->dead && used + size >= SPECTATOR_BUFFER_SIZE)
+         s->slow = true;
 
-         snprintf(msg, sizeof(msg), "Client (#%u) disconnected.", i);
+      if (s->dead || s->slow)
+      {
+         if (s->slow)
+         {
+            RARCH_LOG("Client (#%u) is too slow, dropping ...\n", i);
+            snprintf(msg, sizeof(msg), "Client (#%u) was too slow and has been dropped.", i);
+         }
+         else
+         {
+            RARCH_LOG("Client (#%u) disconnected ...\n", i);
+            snprintf(msg, sizeof(msg), "Client (#%u) disconnected.", i);
+         }
          msg_queue_push(g_extern.msg_queue, msg, 1, 180);
 
-         close(netplay->spectate_fds[i]);
-         netplay->spectate_fds[i] = -1;
-         break;
+         close(s->fd);
+         s->fd = -1;
+         continue;
       }
+
+      first = SPECTATOR_BUFFER_SIZE - s->head;
+      if (first > size)
+         first = size;
+
+      memcpy(s->buffer + s->head, data, first);
+      memcpy(s->buffer, data + first, size - first);
+      s->head = (s->head + size) % SPECTATOR_BUFFER_SIZE;
    }
 
+#ifdef HAVE_THREADS
+   if (netplay->spectate_thread)
+      scond_signal(netplay->spectate_cond);
+   else
+#endif
+      spectators_flush(netplay, NULL);
+
+   spectators_unlock(netplay);
+
    netplay->spectate_input_ptr = 0;
 }
 
@@ -26,6 +26,45 @@
 
 typedef struct netplay netplay_t;
 
+/* With NETPLAY_FLAG_DELTA_INPUT, each packet carries the input
+ * of the last NETPLAY_INPUT_HISTORY frames, run-length encoded:
+ *
+ * uint32_t newest frame
+ * uint8_t  number of runs
+ * runs, newest first: uint8_t length, uint16_t input state
+ *
+ * Input rarely changes from frame to frame, so this is usually 
+ * a handful of bytes, and a lost packet is covered by the 
+ * next one for about a second. */
+#define NETPLAY_INPUT_HISTORY 64
+#define NETPLAY_DELTA_HEADER_SIZE 5
+#define NETPLAY_DELTA_RUN_SIZE 3
+#define NETPLAY_MAX_PACKET_SIZE \
+   (NETPLAY_DELTA_HEADER_SIZE + NETPLAY_INPUT_HISTORY * NETPLAY_DELTA_RUN_SIZE)
+
+struct netplay_stats
+{
+   /* Number of times we rolled back because of a misprediction. */
+   unsigned rollbacks;
+   /* Total frames run again because of rollbacks. */
+   unsigned resimulated;
+   /* Frames run again during the last full second. */
+   unsigned resimulated_per_sec;
+   /* Deepest rollback so far, in frames. */
+   unsigned max_rollback;
+   /* Frames we waited for the other side, because 
+    * every buffered frame was still speculative. */
+   unsigned stalled;
+   /* Frames of the other side we had to predict,
+    * and how many of those we got wrong. */
+   unsigned predictions;
+   unsigned mispredictions;
+   /* Last measured round trip time of the connection. */
+   unsigned rtt_usec;
+   /* Smoothed variation of the round trip time. */
+   unsigned jitter_usec;
+};
+
 void input_poll_net(void);
 
 int16_t input_state_net(unsigned port, unsigned device,
@@ -95,14 +134,38 @@ void netplay_free(netplay_t *handle);
  **/
 void netplay_flip_users(netplay_t *handle);
 
+/**
+ * netplay_spectate_relay:
+ * @netplay              : pointer to netplay object
+ * @port                 : port to accept spectators on.
+ *
+ * When spectating, re-broadcasts the stream we receive to
+ * spectators of our own.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool netplay_spectate_relay(netplay_t *handle, uint16_t port);
+
+/**
+ * netplay_get_stats:
+ * @netplay              : pointer to netplay object
+ * @stats                : filled with the current statistics.
+ *
+ * Gets rollback statistics of the current session.
+ **/
+void netplay_get_stats(netplay_t *handle, struct netplay_stats *stats);
+
 /**
  * netplay_pre_frame:   
  * @netplay              : pointer to netplay object
  *
  * Pre-frame for Netplay.
  * Call this before running retro_run().
+ *
+ * Returns: true (1) if retro_run() should be called this frame,
+ * false (0) if we have to wait for the other side.
  **/
-void netplay_pre_frame(netplay_t *handle);
+bool netplay_pre_frame(netplay_t *handle);
 
 /**
  * netplay_post_frame:   
@@ -114,5 +177,33 @@ void netplay_pre_frame(netplay_t *handle);
  **/
 void netplay_post_frame(netplay_t *handle);
 
+/**
+ * netplay_encode_input:
+ * @history              : input of the last frames, indexed by
+ *                         frame % NETPLAY_INPUT_HISTORY.
+ * @frames               : number of frames played so far.
+ * @out                  : buffer of NETPLAY_MAX_PACKET_SIZE bytes.
+ *
+ * Builds a NETPLAY_FLAG_DELTA_INPUT packet.
+ *
+ * Returns: size of the packet in bytes.
+ **/
+size_t netplay_encode_input(const uint16_t *history, uint32_t frames,
+      uint8_t *out);
+
+/**
+ * netplay_decode_input:
+ * @buffer               : packet as built by netplay_encode_input().
+ * @size                 : size of @buffer in bytes.
+ * @first                : receives the frame of @input[0].
+ * @input                : receives up to NETPLAY_INPUT_HISTORY
+ *                         input states, oldest first.
+ *
+ * Returns: number of frames in the packet, or 0 if it
+ * is malformed.
+ **/
+unsigned netplay_decode_input(const uint8_t *buffer, size_t size,
+      uint32_t *first, uint16_t *input);
+
 #endif
 
@@ -38,23 +38,22 @@ struct bps_data
    uint8_t *target_data;
    size_t modify_length, source_length, target_length;
    size_t modify_offset, source_offset, target_offset;
-   uint32_t modify_checksum, source_checksum, target_checksum;
 
-   size_t source_relative_offset, target_relative_offset, output_offset;
+   size_t output_offset;
 };
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = crc32_adjust(bps->modify_checksum, data);
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   return 0x00;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
 {
    uint64_t data = 0, shift = 1;
 
-   for (;;)
+   while (bps->modify_offset < bps->modify_length)
    {
       uint8_t x = bps_read(bps);
       data += (x & 0x7f) * shift;
@@ -67,35 +66,52 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
+/* Moves a source or target copy offset by a signed delta.
+ * Returns false if it would go before the start. */
+static bool bps_seek(struct bps_data *bps, size_t *offset)
 {
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = crc32_adjust(bps->target_checksum, data);
+   uint64_t data  = bps_decode(bps);
+   uint64_t delta = data >> 1;
+
+   if (data & 1)
+   {
+      if (delta > *offset)
+         return false;
+      *offset -= delta;
+   }
+   else
+      *offset += delta;
+
+   return true;
+}
+
+static uint32_t bps_read32(const uint8_t *data)
+{
+   return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
 }
 
 patch_error_t bps_apply_patch(
       const uint8_t *modify_data, size_t modify_length,
       const uint8_t *source_data, size_t source_length,
-      uint8_t *target_data, size_t *target_length)
+      uint8_t *target_data, size_t *target_length,
+      uint32_t *target_crc)
 {
    size_t i;
    size_t modify_source_size, modify_target_size,
           modify_markup_size;
    struct bps_data bps = {0};
-   uint32_t modify_source_checksum = 0, modify_target_checksum = 0,
-            modify_modify_checksum = 0, checksum;
+   uint32_t checksum = 0;
+   const uint8_t *footer = NULL;
 
    if (modify_length < 19)
       return PATCH_PATCH_TOO_SMALL;
 
    bps.modify_data = modify_data;
-   bps.modify_length = modify_length;
+   bps.modify_length = modify_length - 12;
    bps.target_data = target_data;
    bps.target_length = *target_length;
    bps.source_data = source_data;
    bps.source_length = source_length;
-   bps.modify_checksum = ~0;
-   bps.target_checksum = ~0;
 
    if ((bps_read(&bps) != 'B') || (bps_read(&bps) != 'P') ||
          (bps_read(&bps) != 'S') || (bps_read(&bps) != '1'))
@@ -112,73 +128,88 @@ patch_error_t bps_apply_patch(
    if (modify_target_size > bps.target_length)
       return PATCH_TARGET_TOO_SMALL;
 
-   while (bps.modify_offset < bps.modify_length - 12)
+   /* Nothing is written past the size the patch gives. */
+   bps.target_length = modify_target_size;
+
+   /* Whole runs are copied at a time and checksummed as they 
+    * are written, while they are still in cache. */
+   while (bps.modify_offset < bps.modify_length)
    {
       size_t length = bps_decode(&bps);
       unsigned mode = length & 3;
+      uint8_t *out  = bps.target_data + bps.output_offset;
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+         return PATCH_PATCH_INVALID;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset + length > bps.source_length)
+               return PATCH_PATCH_INVALID;
+            memcpy(out, bps.source_data + bps.output_offset, length);
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(out, bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
             break;
 
          case SOURCE_COPY:
+            if (!bps_seek(&bps, &bps.source_offset)
+                  || bps.source_offset > bps.source_length
+                  || length > bps.source_length - bps.source_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(out, bps.source_data + bps.source_offset, length);
+            bps.source_offset += length;
+            break;
+
          case TARGET_COPY:
          {
-            int offset = bps_decode(&bps);
-            bool negative = offset & 1;
-            offset >>= 1;
-            if (negative)
-               offset = -offset;
+            const uint8_t *in = NULL;
 
-            if (mode == SOURCE_COPY)
-            {
-               bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
-            }
+            if (!bps_seek(&bps, &bps.target_offset)
+                  || bps.target_offset >= bps.output_offset)
+               return PATCH_PATCH_INVALID;
+
+            in = bps.target_data + bps.target_offset;
+
+            /* Runs reaching into what they write repeat a pattern,
+             * which has to go byte by byte. */
+            if (bps.output_offset - bps.target_offset >= length)
+               memcpy(out, in, length);
             else
             {
-               bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               for (i = 0; i < length; i++)
+                  out[i] = in[i];
             }
+            bps.target_offset += length;
             break;
          }
       }
-   }
-
 
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
+      checksum = crc32_update(checksum, out, length);
+      bps.output_offset += length;
+   }
 
-   bps.source_checksum = crc32_calculate(bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   footer = modify_data + modify_length - 12;
 
-   if (bps.source_checksum != modify_source_checksum)
+   if (crc32_calculate(bps.source_data, bps.source_length)
+         != bps_read32(footer + 0))
       return PATCH_SOURCE_CHECKSUM_INVALID;
-   if (bps.target_checksum != modify_target_checksum)
+   if (bps.output_offset != modify_target_size
+         || checksum != bps_read32(footer + 4))
       return PATCH_TARGET_CHECKSUM_INVALID;
-   if (checksum != modify_modify_checksum)
+   if (crc32_calculate(modify_data, modify_length - 4)
+         != bps_read32(footer + 8))
       return PATCH_PATCH_CHECKSUM_INVALID;
 
    *target_length = modify_target_size;
+   *target_crc = checksum;
 
    return PATCH_SUCCESS;
 }
@@ -187,48 +218,25 @@ struct ups_data
 {
    const uint8_t *patch_data, *source_data; 
    uint8_t *target_data;
-   unsigned patch_length, source_length, target_length;
-   unsigned patch_offset, source_offset, target_offset;
-   unsigned patch_checksum, source_checksum, target_checksum;
+   size_t patch_length, source_length, target_length;
+   size_t patch_offset, offset;
+
+   /* Target data checksummed so far. */
+   size_t checksum_offset;
+   uint32_t target_checksum;
 };
 
 static uint8_t ups_patch_read(struct ups_data *data) 
 {
    if (data->patch_offset < data->patch_length) 
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum = crc32_adjust(data->patch_checksum, n);
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
-static uint8_t ups_source_read(struct ups_data *data) 
-{
-   if (data->source_offset < data->source_length) 
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum = crc32_adjust(data->source_checksum, n);
-      return n;
-   }
-   return 0x00;
-}
-
-static void ups_target_write(struct ups_data *data, uint8_t n) 
-{
-   if (data->target_offset < data->target_length) 
-   {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum = crc32_adjust(data->target_checksum, n);
-   }
-
-   data->target_offset++;
-}
-
 static uint64_t ups_decode(struct ups_data *data) 
 {
    uint64_t offset = 0, shift = 1;
-   while (true) 
+   while (data->patch_offset < data->patch_length) 
    {
       uint8_t x = ups_patch_read(data);
       offset += (x & 0x7f) * shift;
@@ -240,15 +248,79 @@ static uint64_t ups_decode(struct ups_data *data)
    return offset;
 }
 
+/* Copies @length bytes of source to target from the current 
+ * offset. Source past its end reads as zero, target past its 
+ * end is not written. */
+static void ups_copy(struct ups_data *data, uint64_t length)
+{
+   size_t count = 0, from_source = 0;
+
+   if (data->offset < data->target_length)
+   {
+      count = data->target_length - data->offset;
+      if (length < count)
+         count = length;
+   }
+
+   if (data->offset < data->source_length)
+   {
+      from_source = data->source_length - data->offset;
+      if (count < from_source)
+         from_source = count;
+   }
+
+   if (count)
+   {
+      memcpy(data->target_data + data->offset,
+            data->source_data + data->offset, from_source);
+      memset(data->target_data + data->offset + from_source,
+            0, count - from_source);
+   }
+
+   /* The offset only matters up to the end of either. */
+   if (length > SIZE_MAX - data->offset)
+      data->offset = SIZE_MAX;
+   else
+      data->offset += length;
+}
+
+static void ups_xor(struct ups_data *data, uint8_t patch_xor)
+{
+   uint8_t n = data->offset < data->source_length ?
+      data->source_data[data->offset] : 0x00;
+
+   if (data->offset < data->target_length)
+      data->target_data[data->offset] = patch_xor ^ n;
+
+   data->offset++;
+}
+
+/* Catches the target checksum up with what was written. */
+static void ups_checksum(struct ups_data *data)
+{
+   size_t end = data->offset < data->target_length ?
+      data->offset : data->target_length;
+
+   if (end <= data->checksum_offset)
+      return;
+
+   data->target_checksum = crc32_update(data->target_checksum,
+         data->target_data + data->checksum_offset,
+         end - data->checksum_offset);
+   data->checksum_offset = end;
+}
+
 patch_error_t ups_apply_patch(
       const uint8_t *patchdata, size_t patchlength,
       const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+      uint8_t *targetdata, size_t *targetlength,
+      uint32_t *target_crc)
 {
-   size_t i;
-   unsigned source_read_length, target_read_length;
-   uint32_t patch_read_checksum = 0, source_read_checksum = 0,
-            target_read_checksum = 0, patch_result_checksum;
+   size_t end;
+   const uint8_t *footer = NULL;
+   uint32_t source_read_checksum, target_read_checksum,
+            source_checksum;
+   uint64_t source_read_length, target_read_length;
    struct ups_data data = {0};
 
    data.patch_data = patchdata;
@@ -257,9 +329,6 @@ patch_error_t ups_apply_patch(
    data.patch_length = patchlength;
    data.source_length = sourcelength;
    data.target_length = *targetlength;
-   data.patch_checksum = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
 
    if (data.patch_length < 18) 
       return PATCH_PATCH_INVALID;
@@ -272,6 +341,13 @@ patch_error_t ups_apply_patch(
    if (ups_patch_read(&data) != '1') 
       return PATCH_PATCH_INVALID;
 
+   footer = patchdata + patchlength - 12;
+   if (crc32_calculate(patchdata, patchlength - 4) != bps_read32(footer + 8))
+      return PATCH_PATCH_INVALID;
+
+   source_read_checksum = bps_read32(footer + 0);
+   target_read_checksum = bps_read32(footer + 4);
+
    source_read_length = ups_decode(&data);
    target_read_length = ups_decode(&data);
 
@@ -284,67 +360,67 @@ patch_error_t ups_apply_patch(
       return PATCH_TARGET_TOO_SMALL;
    data.target_length = *targetlength;
 
-   while (data.patch_offset < data.patch_length - 12) 
+   /* Patches apply the same way in both directions, check 
+    * the source is one of the two ends. */
+   source_checksum = crc32_calculate(data.source_data, data.source_length);
+   if (source_checksum == source_read_checksum
+         && data.source_length == source_read_length)
+      ;
+   else if (source_checksum == target_read_checksum
+         && data.source_length == target_read_length)
+      target_read_checksum = source_read_checksum;
+   else
+      return PATCH_SOURCE_INVALID;
+
+   data.patch_length -= 12;
+
+   while (data.patch_offset < data.patch_length) 
    {
-      unsigned length = ups_decode(&data);
-      while (length--) 
-         ups_target_write(&data, ups_source_read(&data));
+      ups_copy(&data, ups_decode(&data));
+
       while (true) 
       {
          uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
+         ups_xor(&data, patch_xor);
          if (patch_xor == 0)
             break;
       }
-   }
 
-   while (data.source_offset < data.source_length) 
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length) 
-      ups_target_write(&data, ups_source_read(&data));
-
-
-   for (i = 0; i < 4; i++) 
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++) 
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
+      ups_checksum(&data);
+   }
 
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   end = data.source_length > data.target_length ?
+      data.source_length : data.target_length;
+   if (data.offset < end)
+      ups_copy(&data, end - data.offset);
+   ups_checksum(&data);
 
-   for (i = 0; i < 4; i++) 
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
+   if (data.target_checksum != target_read_checksum)
+      return PATCH_TARGET_INVALID;
 
-   if (patch_result_checksum != patch_read_checksum) 
-      return PATCH_PATCH_INVALID;
+   *target_crc = data.target_checksum;
+   return PATCH_SUCCESS;
+}
 
-   if (data.source_checksum == source_read_checksum
-         && data.source_length == source_read_length) 
-   {
-      if (data.target_checksum == target_read_checksum
-            && data.target_length == target_read_length) 
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   } 
-   else if (data.source_checksum == target_read_checksum
-         && data.source_length == target_read_length) 
-   {
-      if (data.target_checksum == source_read_checksum
-            && data.target_length == source_read_length) 
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   } 
+/* IPS records may start past the end of what is there so far,
+ * what they skip over is zeroed. */
+static void ips_grow(uint8_t *targetdata, size_t *targetlength, size_t end)
+{
+   if (end <= *targetlength)
+      return;
 
-   return PATCH_SOURCE_INVALID;
+   memset(targetdata + *targetlength, 0, end - *targetlength);
+   *targetlength = end;
 }
 
 patch_error_t ips_apply_patch(
       const uint8_t *patchdata, size_t patchlen,
       const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+      uint8_t *targetdata, size_t *targetlength,
+      uint32_t *target_crc)
 {
    uint32_t offset = 5;
+   size_t capacity = *targetlength;
 
    if (patchlen < 8 ||
          patchdata[0] != 'P' ||
@@ -354,7 +430,12 @@ patch_error_t ips_apply_patch(
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
-   memcpy(targetdata, sourcedata, sourcelength);
+   if (capacity < sourcelength)
+      return PATCH_TARGET_TOO_SMALL;
+
+   /* Patching in place is allowed. */
+   if (targetdata != sourcedata)
+      memcpy(targetdata, sourcedata, sourcelength);
 
    *targetlength = sourcelength;
 
@@ -373,13 +454,20 @@ patch_error_t ips_apply_patch(
       if (address == 0x454f46) /* EOF */
       {
          if (offset == patchlen)
+         {
+            *target_crc = crc32_calculate(targetdata, *targetlength);
             return PATCH_SUCCESS;
+         }
          else if (offset == patchlen - 3)
          {
             uint32_t size = patchdata[offset++] << 16;
             size |= patchdata[offset++] << 8;
             size |= patchdata[offset++] << 0;
+            if (size > capacity)
+               return PATCH_TARGET_TOO_SMALL;
+            ips_grow(targetdata, targetlength, size);
             *targetlength = size;
+            *target_crc = crc32_calculate(targetdata, *targetlength);
             return PATCH_SUCCESS;
          }
       }
@@ -394,9 +482,12 @@ patch_error_t ips_apply_patch(
       {
          if (offset > patchlen - length)
             break;
+         if (address + length > capacity)
+            return PATCH_TARGET_TOO_SMALL;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset++];
+         ips_grow(targetdata, targetlength, address);
+         memcpy(targetdata + address, patchdata + offset, length);
+         offset += length;
       }
       else /* RLE */
       {
@@ -408,17 +499,17 @@ patch_error_t ips_apply_patch(
 
          if (length == 0) /* Illegal */
             break;
+         if (address + length > capacity)
+            return PATCH_TARGET_TOO_SMALL;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset];
-
+         ips_grow(targetdata, targetlength, address);
+         memset(targetdata + address, patchdata[offset], length);
          offset++;
       }
 
-      if (address > *targetlength)
-         *targetlength = address;
+      if (address + length > *targetlength)
+         *targetlength = address + length;
    }
 
    return PATCH_PATCH_INVALID;
 }
-
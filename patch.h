@@ -39,23 +39,30 @@ typedef enum
    PATCH_PATCH_CHECKSUM_INVALID
 } patch_error_t;
 
+/* Patches take the target buffer size in *target_length and 
+ * return the patched size in it. On success, *target_crc is 
+ * the CRC32 of the patched data. The IPS patcher alone may be
+ * given the same buffer as source and target. */
 typedef patch_error_t (*patch_func_t)(const uint8_t*, size_t,
-      const uint8_t*, size_t, uint8_t*, size_t*);
+      const uint8_t*, size_t, uint8_t*, size_t*, uint32_t*);
 
 patch_error_t bps_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
-      uint8_t *target_data, size_t *target_length);
+      uint8_t *target_data, size_t *target_length,
+      uint32_t *target_crc);
 
 patch_error_t ups_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
-      uint8_t *target_data, size_t *target_length);
+      uint8_t *target_data, size_t *target_length,
+      uint32_t *target_crc);
 
 
 patch_error_t ips_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
-      uint8_t *target_data, size_t *target_length);
+      uint8_t *target_data, size_t *target_length,
+      uint32_t *target_crc);
 
 #endif
@@ -0,0 +1,203 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <file/file_path.h>
+#include "perf_governor.h"
+#include "general.h"
+#include "driver.h"
+#include "performance.h"
+#include "frontend/frontend_driver.h"
+
+/* Frame times are looked at over windows of this length. */
+#define PERF_GOVERNOR_WINDOW_USEC 2000000
+
+/* Windows in a row at full speed before a level is given back. */
+#define PERF_GOVERNOR_CALM_WINDOWS 5
+
+/* Rewind saves state this much less often from the rewind level on. */
+#define PERF_GOVERNOR_REWIND_SCALE 4
+
+static struct rarch_perf_histogram governor_frame_time = {"governor_frame_time"};
+
+static bool governor_active;
+static unsigned governor_level;
+static unsigned governor_calm;
+static retro_time_t governor_window_start;
+static retro_time_t governor_last_frame;
+
+static retro_time_t perf_governor_frame_budget(void)
+{
+   double fps = g_extern.system.av_info.timing.fps;
+
+   return (fps > 0.0) ? (retro_time_t)(1000000.0 / fps) : 16667;
+}
+
+static enum frontend_thermal_state perf_governor_thermal_state(void)
+{
+   if (!driver.frontend_ctx || !driver.frontend_ctx->get_thermal_state)
+      return FRONTEND_THERMAL_NONE;
+   return driver.frontend_ctx->get_thermal_state();
+}
+
+static void perf_governor_set_shader(bool stock)
+{
+   enum rarch_shader_type type = RARCH_SHADER_NONE;
+   const char *path            = g_settings.video.shader_path;
+   const char *ext             = path_get_extension(path);
+
+   if (!g_settings.video.shader_enable || !*path ||
+         !driver.video || !driver.video->set_shader)
+      return;
+
+   if (!strcmp(ext, "glsl") || !strcmp(ext, "glslp"))
+      type = RARCH_SHADER_GLSL;
+   else if (!strcmp(ext, "cg") || !strcmp(ext, "cgp"))
+      type = RARCH_SHADER_CG;
+   else
+      return;
+
+   if (!driver.video->set_shader(driver.video_data, type,
+            stock ? NULL : path))
+      RARCH_WARN("[Governor]: Failed to apply shader.\n");
+}
+
+static void perf_governor_set_level(unsigned level)
+{
+   static const char *names[RARCH_PERF_GOVERNOR_LAST] = {
+      "full quality",
+      "sparser rewind",
+      "stock shader",
+   };
+
+   if (level == governor_level)
+      return;
+
+   if ((governor_level >= RARCH_PERF_GOVERNOR_SHADER) !=
+         (level >= RARCH_PERF_GOVERNOR_SHADER))
+      perf_governor_set_shader(level >= RARCH_PERF_GOVERNOR_SHADER);
+
+   RARCH_LOG("[Governor]: Running at %s.\n", names[level]);
+   governor_level = level;
+}
+
+static void perf_governor_start(void)
+{
+   if (driver.frontend_ctx && driver.frontend_ctx->set_performance_mode)
+      driver.frontend_ctx->set_performance_mode(true,
+            perf_governor_frame_budget());
+
+   rarch_perf_histogram_reset(&governor_frame_time);
+   governor_level        = RARCH_PERF_GOVERNOR_FULL;
+   governor_calm         = 0;
+   governor_window_start = 0;
+   governor_last_frame   = 0;
+   governor_active       = true;
+}
+
+/* Frames which run late on a minority of frames show up in the
+ * 95th percentile well before they add up to a visible stutter,
+ * and the platform reports heating before it throttles. */
+static void perf_governor_evaluate(void)
+{
+   retro_time_t budget = perf_governor_frame_budget();
+   retro_time_t late   = rarch_perf_histogram_percentile(
+         &governor_frame_time, 95);
+   enum frontend_thermal_state thermal = perf_governor_thermal_state();
+
+   if (thermal >= FRONTEND_THERMAL_MODERATE || late > budget * 5 / 4)
+   {
+      governor_calm = 0;
+      if (governor_level + 1 < RARCH_PERF_GOVERNOR_LAST)
+         perf_governor_set_level(governor_level + 1);
+      return;
+   }
+
+   if (thermal > FRONTEND_THERMAL_LIGHT || late > budget * 21 / 20)
+   {
+      governor_calm = 0;
+      return;
+   }
+
+   if (governor_level && ++governor_calm >= PERF_GOVERNOR_CALM_WINDOWS)
+   {
+      governor_calm = 0;
+      perf_governor_set_level(governor_level - 1);
+   }
+}
+
+void rarch_perf_governor_frame(retro_time_t work_time)
+{
+   retro_time_t now;
+
+   if (!g_settings.performance_mode)
+   {
+      rarch_perf_governor_deinit();
+      return;
+   }
+
+   if (!governor_active)
+      perf_governor_start();
+
+   now = rarch_get_time_usec();
+
+   /* Fast-forward and pauses are not frames at the core's rate. */
+   if (driver.nonblock_state || (governor_last_frame &&
+            now - governor_last_frame > PERF_GOVERNOR_WINDOW_USEC))
+      governor_last_frame = 0;
+   else
+   {
+      if (governor_last_frame)
+         rarch_perf_histogram_add(&governor_frame_time,
+               now - governor_last_frame);
+      governor_last_frame = now;
+
+      if (work_time && driver.frontend_ctx &&
+            driver.frontend_ctx->report_frame_time)
+         driver.frontend_ctx->report_frame_time(work_time);
+   }
+
+   if (!governor_window_start)
+      governor_window_start = now;
+
+   if (now - governor_window_start < PERF_GOVERNOR_WINDOW_USEC)
+      return;
+
+   if (governor_frame_time.count)
+      perf_governor_evaluate();
+
+   rarch_perf_histogram_reset(&governor_frame_time);
+   governor_window_start = now;
+}
+
+void rarch_perf_governor_deinit(void)
+{
+   if (!governor_active)
+      return;
+
+   perf_governor_set_level(RARCH_PERF_GOVERNOR_FULL);
+
+   if (driver.frontend_ctx && driver.frontend_ctx->set_performance_mode)
+      driver.frontend_ctx->set_performance_mode(false, 0);
+
+   governor_active = false;
+}
+
+unsigned rarch_perf_governor_rewind_scale(void)
+{
+   return (governor_level >= RARCH_PERF_GOVERNOR_REWIND) ?
+      PERF_GOVERNOR_REWIND_SCALE : 1;
+}
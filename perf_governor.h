@@ -0,0 +1,69 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_PERF_GOVERNOR_H
+#define __RARCH_PERF_GOVERNOR_H
+
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Performance mode. While performance_mode is on, the platform is
+ * asked for clocks it can sustain, and quality is given up one
+ * level at a time when the device heats up or frames start to run
+ * late, then given back once it has run at full speed for a while. */
+enum rarch_perf_governor_level
+{
+   RARCH_PERF_GOVERNOR_FULL = 0,
+   /* Rewind saves state less often. */
+   RARCH_PERF_GOVERNOR_REWIND,
+   /* The stock shader replaces the shader preset as well. */
+   RARCH_PERF_GOVERNOR_SHADER,
+
+   RARCH_PERF_GOVERNOR_LAST
+};
+
+/**
+ * rarch_perf_governor_frame:
+ * @work_time            : Time spent running the frame, 0 if
+ *                         it was not measured.
+ *
+ * Called after every frame of the core. Starts and stops
+ * performance mode as the setting changes.
+ **/
+void rarch_perf_governor_frame(retro_time_t work_time);
+
+/**
+ * rarch_perf_governor_deinit:
+ *
+ * Gives back all quality and leaves performance mode.
+ **/
+void rarch_perf_governor_deinit(void);
+
+/**
+ * rarch_perf_governor_rewind_scale:
+ *
+ * Returns: factor rewind_granularity is scaled by.
+ **/
+unsigned rarch_perf_governor_rewind_scale(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,11 +15,16 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "libretro.h"
 #include "performance.h"
 #include "general.h"
 #include "compat/strl.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef ANDROID
 #include "performance/performance_android.h"
 #endif
@@ -84,6 +89,22 @@ const struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 unsigned perf_ptr_rarch;
 unsigned perf_ptr_libretro;
 
+struct rarch_perf_histogram perf_histogram_frame_time = {"frame_time"};
+struct rarch_perf_histogram perf_histogram_iterate    = {"rarch_main_iterate"};
+struct rarch_perf_histogram perf_histogram_gpu_time   = {"gpu_time"};
+struct rarch_perf_histogram perf_histogram_gpu_menu   = {"gpu_menu"};
+struct rarch_perf_histogram perf_histogram_gpu_pass[PERF_GPU_PASSES] = {
+   {"gpu_pass_1"},  {"gpu_pass_2"},  {"gpu_pass_3"},  {"gpu_pass_4"},
+   {"gpu_pass_5"},  {"gpu_pass_6"},  {"gpu_pass_7"},  {"gpu_pass_8"},
+   {"gpu_pass_9"},  {"gpu_pass_10"}, {"gpu_pass_11"}, {"gpu_pass_12"},
+   {"gpu_pass_13"}, {"gpu_pass_14"}, {"gpu_pass_15"}, {"gpu_pass_16"},
+   {"gpu_pass_17"},
+};
+struct rarch_perf_histogram perf_histogram_latency[RARCH_LATENCY_STAGE_LAST] = {
+   {"latency_poll"}, {"latency_retro_run"}, {"latency_swap"},
+   {"latency_swap_done"}, {"latency_display"},
+};
+
 void rarch_perf_register(struct retro_perf_counter *perf)
 {
    if (!g_extern.perfcnt_enable || perf->registered 
@@ -126,13 +147,715 @@ static void log_counters(
    }
 }
 
+void rarch_perf_histogram_add(struct rarch_perf_histogram *hist,
+      retro_time_t usec)
+{
+   retro_time_t bucket;
+
+   if (usec < 0)
+      usec = 0;
+
+   bucket = usec / PERF_HISTOGRAM_BUCKET_USEC;
+   if (bucket >= PERF_HISTOGRAM_BUCKETS)
+      bucket = PERF_HISTOGRAM_BUCKETS - 1;
+
+   if (!hist->count || usec < hist->min)
+      hist->min = usec;
+   if (usec > hist->max)
+      hist->max = usec;
+
+   hist->buckets[bucket]++;
+   hist->count++;
+   hist->total += usec;
+}
+
+retro_time_t rarch_perf_histogram_percentile(
+      const struct rarch_perf_histogram *hist, unsigned percent)
+{
+   unsigned i;
+   uint64_t rank, seen = 0;
+
+   if (!hist->count)
+      return 0;
+   if (percent >= 100)
+      return hist->max;
+
+   /* Rank of the sample we are looking for, 1-based. */
+   rank = (hist->count * percent + 99) / 100;
+   if (!rank)
+      rank = 1;
+
+   for (i = 0; i < PERF_HISTOGRAM_BUCKETS; i++)
+   {
+      retro_time_t lo, hi, val;
+
+      if (seen + hist->buckets[i] < rank)
+      {
+         seen += hist->buckets[i];
+         continue;
+      }
+
+      /* Clamp the bucket to what was actually observed,
+       * the overflow bucket has no upper bound otherwise. */
+      lo = (retro_time_t)i * PERF_HISTOGRAM_BUCKET_USEC;
+      hi = lo + PERF_HISTOGRAM_BUCKET_USEC;
+      if (lo < hist->min)
+         lo = hist->min;
+      if (hi > hist->max || i == PERF_HISTOGRAM_BUCKETS - 1)
+         hi = hist->max;
+
+      val = lo + (hi - lo) * (retro_time_t)(rank - seen) 
+         / (retro_time_t)hist->buckets[i];
+      return val;
+   }
+
+   return hist->max;
+}
+
+void rarch_perf_histogram_summary(
+      const struct rarch_perf_histogram *hist, char *s, size_t len)
+{
+   if (!hist->count)
+   {
+      snprintf(s, len, "%s: no samples", hist->ident);
+      return;
+   }
+
+   snprintf(s, len,
+         "%s: avg %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, "
+         "max %.2f ms, %llu samples",
+         hist->ident,
+         (double)hist->total / hist->count / 1000.0,
+         rarch_perf_histogram_percentile(hist, 50) / 1000.0,
+         rarch_perf_histogram_percentile(hist, 95) / 1000.0,
+         rarch_perf_histogram_percentile(hist, 99) / 1000.0,
+         hist->max / 1000.0,
+         (unsigned long long)hist->count);
+}
+
+void rarch_perf_histogram_reset(struct rarch_perf_histogram *hist)
+{
+   const char *ident = hist->ident;
+
+   memset(hist, 0, sizeof(*hist));
+   hist->ident = ident;
+}
+
+#define PERF_TIMELINE_DEPTH 32
+#define PERF_TIMELINE_NONE  ((unsigned)-1)
+
+struct rarch_timeline_event
+{
+   const char *name;
+   retro_time_t start;
+   retro_time_t end;
+};
+
+static struct rarch_timeline_event timeline_events[PERF_TIMELINE_EVENTS];
+static unsigned timeline_count;
+/* Events of the open spans, NONE for those which did not fit. */
+static unsigned timeline_stack[PERF_TIMELINE_DEPTH];
+static unsigned timeline_depth;
+
+void rarch_timeline_begin(const char *name)
+{
+   unsigned event = PERF_TIMELINE_NONE;
+
+   if (timeline_count < PERF_TIMELINE_EVENTS
+         && timeline_depth < PERF_TIMELINE_DEPTH)
+   {
+      event = timeline_count++;
+      timeline_events[event].name  = name;
+      timeline_events[event].start = rarch_get_time_usec();
+      timeline_events[event].end   = 0;
+   }
+
+   if (timeline_depth < PERF_TIMELINE_DEPTH)
+      timeline_stack[timeline_depth] = event;
+   timeline_depth++;
+}
+
+void rarch_timeline_end(void)
+{
+   unsigned event;
+
+   if (!timeline_depth)
+      return;
+
+   if (--timeline_depth >= PERF_TIMELINE_DEPTH)
+      return;
+
+   event = timeline_stack[timeline_depth];
+   if (event != PERF_TIMELINE_NONE)
+      timeline_events[event].end = rarch_get_time_usec();
+}
+
+static void perf_write_json_string(FILE *file, const char *s)
+{
+   fputc('"', file);
+   for (; *s; s++)
+      fprintf(file, *s == '\\' || *s == '"' ? "\\%c" : "%c", *s);
+   fputc('"', file);
+}
+
+bool rarch_timeline_dump(const char *path)
+{
+   unsigned i;
+   retro_time_t now = rarch_get_time_usec();
+   FILE *file       = fopen(path, "w");
+
+   if (!file)
+      return false;
+
+   /* Times count from the first span. */
+   fprintf(file, "{\"traceEvents\":[");
+
+   for (i = 0; i < timeline_count; i++)
+   {
+      const struct rarch_timeline_event *event = &timeline_events[i];
+      retro_time_t end  = event->end ? event->end : now;
+
+      fprintf(file, "%s\n{\"name\":", i ? "," : "");
+      perf_write_json_string(file, event->name);
+      fprintf(file, ",\"cat\":\"startup\",\"ph\":\"X\","
+            "\"ts\":%.0f,\"dur\":%.0f,\"pid\":1,\"tid\":1}",
+            (double)(event->start - timeline_events[0].start),
+            (double)(end - event->start));
+   }
+
+   fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+   return fclose(file) == 0;
+}
+
+#if defined(__GNUC__)
+#define PERF_TRACE_BARRIER() __sync_synchronize()
+#else
+#define PERF_TRACE_BARRIER()
+#endif
+
+struct rarch_trace_event
+{
+   const char *name;
+   retro_perf_tick_t start;
+   retro_perf_tick_t end;
+   uintptr_t thread;
+   unsigned frame;
+   /* Number of the event plus one once written, 0 while writing. */
+   unsigned seq;
+};
+
+struct rarch_trace_thread
+{
+   uintptr_t id;
+   const char *name;
+};
+
+static struct rarch_trace_event trace_events[PERF_TRACE_EVENTS];
+/* Number of the next event, wrapping around the ring. */
+static unsigned trace_next;
+static struct rarch_trace_thread trace_threads[PERF_TRACE_THREADS];
+static unsigned trace_thread_count;
+static bool trace_inited;
+static retro_perf_tick_t trace_base_ticks;
+static retro_time_t trace_base_usec;
+
+static uintptr_t trace_thread_id(void)
+{
+#ifdef HAVE_THREADS
+   return sthread_get_current_thread_id();
+#else
+   return 0;
+#endif
+}
+
+void rarch_trace_init(void)
+{
+   if (trace_inited)
+      return;
+
+   trace_base_ticks = rarch_get_perf_counter();
+   trace_base_usec  = rarch_get_time_usec();
+   trace_inited     = true;
+
+   rarch_trace_thread_name("Main");
+}
+
+void rarch_trace_thread_name(const char *name)
+{
+   unsigned i, count = trace_thread_count;
+   uintptr_t id      = trace_thread_id();
+
+   /* Threads come and go, new ones can get the ids of old ones. */
+   for (i = 0; i < count && i < PERF_TRACE_THREADS; i++)
+   {
+      if (trace_threads[i].id != id)
+         continue;
+      trace_threads[i].name = name;
+      return;
+   }
+
+#if defined(__GNUC__)
+   i = __sync_fetch_and_add(&trace_thread_count, 1);
+#else
+   i = trace_thread_count++;
+#endif
+   if (i >= PERF_TRACE_THREADS)
+      return;
+
+   trace_threads[i].id   = id;
+   trace_threads[i].name = name;
+}
+
+void rarch_trace_add(const char *name,
+      retro_perf_tick_t start, retro_perf_tick_t end)
+{
+   unsigned seq;
+   struct rarch_trace_event *event;
+
+   if (!trace_inited)
+      return;
+
+#if defined(__GNUC__)
+   seq = __sync_fetch_and_add(&trace_next, 1);
+#else
+   seq = trace_next++;
+#endif
+   event = &trace_events[seq % PERF_TRACE_EVENTS];
+
+   event->seq    = 0;
+   PERF_TRACE_BARRIER();
+   event->name   = name;
+   event->start  = start;
+   event->end    = end;
+   event->thread = trace_thread_id();
+   event->frame  = g_extern.frame_count;
+   PERF_TRACE_BARRIER();
+   event->seq    = seq + 1;
+}
+
+/* Named threads keep their place, the others follow. */
+static unsigned trace_tid(uintptr_t id, uintptr_t *unnamed,
+      unsigned *unnamed_count)
+{
+   unsigned i;
+   unsigned named = trace_thread_count < PERF_TRACE_THREADS
+      ? trace_thread_count : PERF_TRACE_THREADS;
+
+   for (i = named; i-- > 0; )
+      if (trace_threads[i].id == id)
+         return i + 1;
+
+   for (i = 0; i < *unnamed_count; i++)
+      if (unnamed[i] == id)
+         return PERF_TRACE_THREADS + i + 1;
+
+   if (*unnamed_count >= PERF_TRACE_THREADS)
+      return 0;
+
+   unnamed[(*unnamed_count)++] = id;
+   return PERF_TRACE_THREADS + i + 1;
+}
+
+bool rarch_trace_dump(const char *path)
+{
+   unsigned i, count, kept = 0, unnamed_count = 0;
+   uintptr_t unnamed[PERF_TRACE_THREADS];
+   struct rarch_trace_event *events = NULL;
+   unsigned next                    = trace_next;
+   retro_perf_tick_t now_ticks      = rarch_get_perf_counter();
+   retro_time_t now_usec            = rarch_get_time_usec();
+   double usec_per_tick             = 0.0;
+   FILE *file                       = NULL;
+
+   if (!trace_inited)
+      return false;
+
+   count = next < PERF_TRACE_EVENTS ? next : PERF_TRACE_EVENTS;
+
+   /* Copy first, the ring goes on while the file is written. */
+   if (count && !(events = (struct rarch_trace_event*)
+            malloc(count * sizeof(*events))))
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned seq = next - count + i;
+      const struct rarch_trace_event *event =
+         &trace_events[seq % PERF_TRACE_EVENTS];
+
+      if (event->seq != seq + 1)
+         continue;
+      events[kept] = *event;
+      PERF_TRACE_BARRIER();
+      /* Overwritten while copying. */
+      if (event->seq != seq + 1)
+         continue;
+      kept++;
+   }
+
+   if (now_ticks != trace_base_ticks)
+      usec_per_tick = (double)(now_usec - trace_base_usec) /
+         (double)(int64_t)(now_ticks - trace_base_ticks);
+
+   if (!(file = fopen(path, "w")))
+   {
+      free(events);
+      return false;
+   }
+
+   /* Times count from rarch_trace_init(). */
+   fprintf(file, "{\"traceEvents\":[");
+
+   for (i = 0; i < trace_thread_count && i < PERF_TRACE_THREADS; i++)
+   {
+      fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+            "\"pid\":1,\"tid\":%u,\"args\":{\"name\":", i ? "," : "", i + 1);
+      perf_write_json_string(file, trace_threads[i].name);
+      fprintf(file, "}}");
+   }
+
+   for (i = 0; i < kept; i++)
+   {
+      const struct rarch_trace_event *event = &events[i];
+      unsigned tid = trace_tid(event->thread, unnamed, &unnamed_count);
+
+      fprintf(file, ",\n{\"name\":");
+      perf_write_json_string(file, event->name ? event->name : "");
+      fprintf(file, ",\"cat\":\"perf\",\"ph\":\"X\","
+            "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"frame\":%u}}",
+            (double)(int64_t)(event->start - trace_base_ticks) * usec_per_tick,
+            (double)(int64_t)(event->end - event->start) * usec_per_tick,
+            tid, event->frame);
+   }
+
+   fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+   free(events);
+   return fclose(file) == 0;
+}
+
+#define PERF_SAMPLE_USEC 1000000
+#define PERF_SAMPLE_MAX  (MAX_COUNTERS * 2)
+
+/* What a counter had at the last sample. */
+struct rarch_perf_prev
+{
+   const struct retro_perf_counter *perf;
+   retro_perf_tick_t total;
+   retro_perf_tick_t call_cnt;
+};
+
+static struct rarch_perf_prev perf_prev[PERF_SAMPLE_MAX];
+static retro_perf_tick_t perf_prev_ticks;
+static retro_time_t perf_prev_usec;
+static unsigned perf_prev_frame;
+
+/* Written to the one not current, then made current,
+ * so readers on other threads never see one half done. */
+static struct rarch_perf_sample perf_samples[2][PERF_SAMPLE_MAX];
+static unsigned perf_sample_count[2];
+static unsigned perf_sample_current;
+
+static int perf_sample_compare(const void *a, const void *b)
+{
+   const struct rarch_perf_sample *sa = (const struct rarch_perf_sample*)a;
+   const struct rarch_perf_sample *sb = (const struct rarch_perf_sample*)b;
+
+   if (sa->percent != sb->percent)
+      return sa->percent < sb->percent ? 1 : -1;
+   return 0;
+}
+
+void rarch_perf_sample_update(void)
+{
+   unsigned i, count = 0, frames;
+   unsigned next                     = !perf_sample_current;
+   struct rarch_perf_sample *samples = perf_samples[next];
+   retro_time_t now_usec             = rarch_get_time_usec();
+   retro_perf_tick_t now_ticks       = rarch_get_perf_counter();
+   double usec, usec_per_tick;
+
+   if (!perf_prev_usec)
+   {
+      perf_prev_usec  = now_usec;
+      perf_prev_ticks = now_ticks;
+      perf_prev_frame = g_extern.frame_count;
+   }
+
+   if (now_usec - perf_prev_usec < PERF_SAMPLE_USEC
+         || now_ticks == perf_prev_ticks)
+      return;
+
+   usec          = (double)(now_usec - perf_prev_usec);
+   usec_per_tick = usec / (double)(int64_t)(now_ticks - perf_prev_ticks);
+   frames        = g_extern.frame_count - perf_prev_frame;
+
+   for (i = 0; i < PERF_SAMPLE_MAX; i++)
+   {
+      const struct retro_perf_counter *perf = i < MAX_COUNTERS
+         ? (i < perf_ptr_rarch ? perf_counters_rarch[i] : NULL)
+         : (i - MAX_COUNTERS < perf_ptr_libretro
+               ? perf_counters_libretro[i - MAX_COUNTERS] : NULL);
+      struct rarch_perf_prev *prev = &perf_prev[i];
+      retro_perf_tick_t total;
+      retro_perf_tick_t call_cnt;
+
+      if (!perf)
+      {
+         prev->perf = NULL;
+         continue;
+      }
+
+      total    = perf->total;
+      call_cnt = perf->call_cnt;
+
+      /* Counters new since the last sample only count from now,
+       * their place could have been another's before the core changed. */
+      if (prev->perf == perf && call_cnt > prev->call_cnt)
+      {
+         struct rarch_perf_sample *sample = &samples[count++];
+         double counter_usec = (double)(int64_t)(total - prev->total)
+            * usec_per_tick;
+
+         sample->ident           = perf->ident;
+         sample->core            = i >= MAX_COUNTERS;
+         sample->percent         = (float)(100.0 * counter_usec / usec);
+         sample->usec_per_frame  = frames
+            ? (float)(counter_usec / frames) : 0.0f;
+         sample->calls_per_frame = frames
+            ? (float)(call_cnt - prev->call_cnt) / frames : 0.0f;
+      }
+
+      prev->perf     = perf;
+      prev->total    = total;
+      prev->call_cnt = call_cnt;
+   }
+
+   qsort(samples, count, sizeof(*samples), perf_sample_compare);
+
+   perf_sample_count[next] = count;
+   PERF_TRACE_BARRIER();
+   perf_sample_current     = next;
+
+   perf_prev_usec  = now_usec;
+   perf_prev_ticks = now_ticks;
+   perf_prev_frame = g_extern.frame_count;
+}
+
+unsigned rarch_perf_sample_get(struct rarch_perf_sample *samples,
+      unsigned max)
+{
+   unsigned current = perf_sample_current;
+   unsigned count   = perf_sample_count[current];
+
+   if (count > max)
+      count = max;
+   memcpy(samples, perf_samples[current], count * sizeof(*samples));
+   return count;
+}
+
+void rarch_perf_sample_summary(const struct rarch_perf_sample *sample,
+      char *s, size_t len)
+{
+   snprintf(s, len, "%s%s: %.2f ms/frame, %.1f%%, %.1f calls/frame",
+         sample->core ? "core " : "", sample->ident,
+         sample->usec_per_frame / 1000.0f, sample->percent,
+         sample->calls_per_frame);
+}
+
+static size_t mem_current[RARCH_MEM_LAST];
+static size_t mem_peak[RARCH_MEM_LAST];
+
+static const char *mem_tag_names[RARCH_MEM_LAST] = {
+   "Rewind",
+   "Video",
+   "Audio",
+   "Menu",
+   "Recording",
+   "Database",
+   "Netplay",
+};
+
+void rarch_mem_add(enum rarch_mem_tag tag, size_t size)
+{
+   size_t current;
+
+#if defined(__GNUC__)
+   current = __sync_add_and_fetch(&mem_current[tag], size);
+#else
+   current = mem_current[tag] += size;
+#endif
+
+   /* Racing adds can only lose a peak to one that
+    * is just as recent. */
+   if (current > mem_peak[tag])
+      mem_peak[tag] = current;
+}
+
+void rarch_mem_sub(enum rarch_mem_tag tag, size_t size)
+{
+#if defined(__GNUC__)
+   __sync_sub_and_fetch(&mem_current[tag], size);
+#else
+   mem_current[tag] -= size;
+#endif
+}
+
+size_t rarch_mem_get(enum rarch_mem_tag tag, size_t *peak)
+{
+   if (peak)
+      *peak = mem_peak[tag];
+   return mem_current[tag];
+}
+
+const char *rarch_mem_tag_name(enum rarch_mem_tag tag)
+{
+   if (tag >= RARCH_MEM_LAST)
+      return "Total";
+   return mem_tag_names[tag];
+}
+
+static void mem_format(size_t size, char *s, size_t len)
+{
+   if (size < 1024 * 1024)
+      snprintf(s, len, "%u KB", (unsigned)((size + 1023) / 1024));
+   else
+      snprintf(s, len, "%.1f MB", size / (1024.0 * 1024.0));
+}
+
+void rarch_mem_summary(enum rarch_mem_tag tag, char *s, size_t len)
+{
+   char current_str[32], peak_str[32];
+   size_t current = 0, peak = 0;
+
+   if (tag < RARCH_MEM_LAST)
+      current = rarch_mem_get(tag, &peak);
+   else
+   {
+      unsigned i;
+
+      /* Peaks of different subsystems need not coincide,
+       * their sum is an upper bound. */
+      for (i = 0; i < RARCH_MEM_LAST; i++)
+      {
+         size_t tag_peak;
+         current += rarch_mem_get((enum rarch_mem_tag)i, &tag_peak);
+         peak    += tag_peak;
+      }
+   }
+
+   mem_format(current, current_str, sizeof(current_str));
+   mem_format(peak, peak_str, sizeof(peak_str));
+   snprintf(s, len, "%s: %s (peak %s)",
+         rarch_mem_tag_name(tag), current_str, peak_str);
+}
+
+static void log_histogram(const struct rarch_perf_histogram *hist)
+{
+   unsigned i, last = 0;
+   uint64_t peak = 0;
+   char summary[256];
+
+   if (!hist->count)
+      return;
+
+   rarch_perf_histogram_summary(hist, summary, sizeof(summary));
+   RARCH_LOG("[PERF]: %s.\n", summary);
+
+   for (i = 0; i < PERF_HISTOGRAM_BUCKETS; i++)
+   {
+      if (hist->buckets[i] > peak)
+         peak = hist->buckets[i];
+      if (hist->buckets[i])
+         last = i;
+   }
+
+   for (i = hist->min / PERF_HISTOGRAM_BUCKET_USEC; i <= last; i++)
+   {
+      char bar[41];
+      unsigned width = (unsigned)(hist->buckets[i] * 40 / peak);
+
+      if (!hist->buckets[i])
+         continue;
+
+      memset(bar, '#', width);
+      bar[width] = '\0';
+
+      RARCH_LOG("[PERF]:   %6.2f ms%s %8llu %s\n",
+            (double)i * PERF_HISTOGRAM_BUCKET_USEC / 1000.0,
+            i == PERF_HISTOGRAM_BUCKETS - 1 ? "+" : " ",
+            (unsigned long long)hist->buckets[i], bar);
+   }
+}
+
+retro_time_t rarch_benchmark_callback_begin(void)
+{
+   if (!g_extern.benchmark.in_core)
+      return 0;
+
+   g_extern.benchmark.in_core = false;
+   return rarch_get_time_usec();
+}
+
+void rarch_benchmark_callback_end(retro_time_t start)
+{
+   if (!start)
+      return;
+
+   g_extern.benchmark.callbacks += rarch_get_time_usec() - start;
+   g_extern.benchmark.in_core    = true;
+}
+
+void rarch_benchmark_report(void)
+{
+   double wall, core, frontend, frames;
+   retro_time_t end = g_extern.benchmark.end;
+
+   if (!g_extern.benchmark.enable || !g_extern.benchmark.frames)
+      return;
+
+   if (!end)
+      end = rarch_get_time_usec();
+
+   frames   = g_extern.benchmark.frames;
+   wall     = (double)(end - g_extern.benchmark.start) / 1000000.0;
+   core     = (double)(g_extern.benchmark.core
+         - g_extern.benchmark.callbacks) / 1000000.0;
+   frontend = wall - core;
+   if (wall <= 0.0)
+      wall = 1e-6;
+
+   printf("Benchmark: %u frames in %.3f s, %.1f fps.\n",
+         g_extern.benchmark.frames, wall, frames / wall);
+   printf("Benchmark: core %.3f s (%.1f%%), %.1f us/frame.\n",
+         core, 100.0 * core / wall, core * 1000000.0 / frames);
+   printf("Benchmark: frontend %.3f s (%.1f%%), %.1f us/frame, "
+         "%.3f s of it in callbacks from the core.\n",
+         frontend, 100.0 * frontend / wall, frontend * 1000000.0 / frames,
+         (double)g_extern.benchmark.callbacks / 1000000.0);
+   fflush(stdout);
+}
+
 void rarch_perf_log(void)
 {
+   unsigned i;
+
    if (!g_extern.perfcnt_enable)
       return;
 
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(perf_counters_rarch, perf_ptr_rarch);
+
+   log_histogram(&perf_histogram_frame_time);
+   log_histogram(&perf_histogram_iterate);
+   log_histogram(&perf_histogram_gpu_time);
+   for (i = 0; i < PERF_GPU_PASSES; i++)
+      log_histogram(&perf_histogram_gpu_pass[i]);
+   log_histogram(&perf_histogram_gpu_menu);
+   for (i = 0; i < RARCH_LATENCY_STAGE_LAST; i++)
+      log_histogram(&perf_histogram_latency[i]);
 }
 
 void retro_perf_log(void)
@@ -274,9 +997,9 @@ static void x86_cpuid(int func, int flags[4])
          "cpuid\n"
          "xchg %%" REG_b ", %%" REG_S "\n"
          : "=a"(flags[0]), "=S"(flags[1]), "=c"(flags[2]), "=d"(flags[3])
-         : "a"(func));
+         : "a"(func), "c"(0)); /* Leaf 7 needs sub-leaf 0. */
 #elif defined(_MSC_VER)
-   __cpuid(flags, func);
+   __cpuidex(flags, func, 0);
 #else
    RARCH_WARN("Unknown compiler. Cannot check CPUID with inline assembly.\n");
    memset(flags, 0, 4 * sizeof(int));
@@ -375,6 +1098,32 @@ unsigned rarch_get_cpu_cores(void)
 #endif
 }
 
+/**
+ * rarch_get_cpu_cache_size:
+ *
+ * Gets the size of the per-core (L2) data cache.
+ *
+ * Returns: cache size in bytes, or 0 if unknown.
+ **/
+size_t rarch_get_cpu_cache_size(void)
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+   /* glibc */
+   long ret = sysconf(_SC_LEVEL2_CACHE_SIZE);
+   if (ret <= 0)
+      return 0;
+   return ret;
+#elif defined(__APPLE__)
+   uint64_t size = 0;
+   size_t len    = sizeof(size);
+   if (sysctlbyname("hw.l2cachesize", &size, &len, NULL, 0) != 0)
+      return 0;
+   return (size_t)size;
+#else
+   return 0;
+#endif
+}
+
 /**
  * rarch_get_cpu_features:
  *
@@ -387,7 +1136,7 @@ uint64_t rarch_get_cpu_features(void)
    uint64_t cpu = 0;
 
    const unsigned MAX_FEATURES = \
-         sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES AVX AVX2 NEON VMX VMX128 VFPU PS");
+         sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES PCLMUL AVX AVX2 FMA SHA NEON VMX VMX128 VFPU PS");
    char buf[MAX_FEATURES];
    memset(buf, 0, MAX_FEATURES);
 
@@ -434,19 +1183,31 @@ uint64_t rarch_get_cpu_features(void)
    if (flags[2] & (1 << 25))
       cpu |= RETRO_SIMD_AES;
 
+   if (flags[2] & (1 << 1))
+      cpu |= RETRO_SIMD_PCLMUL;
+
    const int avx_flags = (1 << 27) | (1 << 28);
 
    /* Must only perform xgetbv check if we have 
     * AVX CPU support (guaranteed to have at least i686). */
    if (((flags[2] & avx_flags) == avx_flags) 
          && ((xgetbv_x86(0) & 0x6) == 0x6))
+   {
       cpu |= RETRO_SIMD_AVX;
 
+      /* FMA3 uses the AVX register state. */
+      if (flags[2] & (1 << 12))
+         cpu |= RETRO_SIMD_FMA;
+   }
+
    if (max_flag >= 7)
    {
       x86_cpuid(7, flags);
-      if (flags[1] & (1 << 5))
+      /* AVX2 needs the YMM state the OS enabled for AVX. */
+      if ((cpu & RETRO_SIMD_AVX) && (flags[1] & (1 << 5)))
          cpu |= RETRO_SIMD_AVX2;
+      if (flags[1] & (1 << 29))
+         cpu |= RETRO_SIMD_SHA;
    }
 
    x86_cpuid(0x80000000, flags);
@@ -477,6 +1238,9 @@ uint64_t rarch_get_cpu_features(void)
    arm_enable_runfast_mode();
 #elif defined(__ALTIVEC__)
    cpu |= RETRO_SIMD_VMX;
+#elif defined(EMSCRIPTEN) && defined(__SSE2__)
+   /* The SSE kernels run on WebAssembly SIMD. */
+   cpu |= RETRO_SIMD_SSE | RETRO_SIMD_SSE2;
 #elif defined(XBOX360)
    cpu |= RETRO_SIMD_VMX128;
 #elif defined(PSP)
@@ -494,8 +1258,11 @@ uint64_t rarch_get_cpu_features(void)
    if (cpu & RETRO_SIMD_SSE4)   strlcat(buf, " SSE4", sizeof(buf));
    if (cpu & RETRO_SIMD_SSE42)  strlcat(buf, " SSE4.2", sizeof(buf));
    if (cpu & RETRO_SIMD_AES)    strlcat(buf, " AES", sizeof(buf));
+   if (cpu & RETRO_SIMD_PCLMUL) strlcat(buf, " PCLMUL", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX)    strlcat(buf, " AVX", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX2)   strlcat(buf, " AVX2", sizeof(buf));
+   if (cpu & RETRO_SIMD_FMA)    strlcat(buf, " FMA", sizeof(buf));
+   if (cpu & RETRO_SIMD_SHA)    strlcat(buf, " SHA", sizeof(buf));
    if (cpu & RETRO_SIMD_NEON)   strlcat(buf, " NEON", sizeof(buf));
    if (cpu & RETRO_SIMD_VMX)    strlcat(buf, " VMX", sizeof(buf));
    if (cpu & RETRO_SIMD_VMX128) strlcat(buf, " VMX128", sizeof(buf));
@@ -18,6 +18,7 @@
 #define _RARCH_PERF_H
 
 #include "general.h"
+#include "latency_test.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,39 @@ extern const struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 extern unsigned perf_ptr_rarch;
 extern unsigned perf_ptr_libretro;
 
+#ifndef PERF_HISTOGRAM_BUCKETS
+#define PERF_HISTOGRAM_BUCKETS 200
+#endif
+
+/* Width of one histogram bucket. The last bucket also
+ * collects everything beyond the histogram range. */
+#define PERF_HISTOGRAM_BUCKET_USEC 250
+
+struct rarch_perf_histogram
+{
+   const char *ident;
+   uint64_t buckets[PERF_HISTOGRAM_BUCKETS];
+   uint64_t count;
+   retro_time_t total;
+   retro_time_t min;
+   retro_time_t max;
+};
+
+/* Time between two frames of the core, and time spent
+ * running one frame in rarch_main_iterate(). */
+extern struct rarch_perf_histogram perf_histogram_frame_time;
+extern struct rarch_perf_histogram perf_histogram_iterate;
+/* Filled by video drivers which can time their GPU work. 
+ * Passes are counted from the first shader pass, the last 
+ * one is the pass to the back buffer. */
+#define PERF_GPU_PASSES 17
+
+extern struct rarch_perf_histogram perf_histogram_gpu_time;
+extern struct rarch_perf_histogram perf_histogram_gpu_pass[PERF_GPU_PASSES];
+extern struct rarch_perf_histogram perf_histogram_gpu_menu;
+
+/* Filled by the latency test, one per rarch_latency_stage. */
+extern struct rarch_perf_histogram perf_histogram_latency[RARCH_LATENCY_STAGE_LAST];
 
 /**
  * rarch_get_perf_counter:
@@ -79,6 +113,252 @@ void rarch_perf_log(void);
 
 void retro_perf_log(void);
 
+/**
+ * rarch_perf_histogram_add:
+ * @hist               : pointer to histogram
+ * @usec               : sample to add, in microseconds.
+ *
+ * Adds a sample to histogram.
+ **/
+void rarch_perf_histogram_add(struct rarch_perf_histogram *hist,
+      retro_time_t usec);
+
+/**
+ * rarch_benchmark_callback_begin:
+ *
+ * Call as a frontend callback starts, to tell its time apart
+ * from the core's for --benchmark. Nested callbacks count once.
+ *
+ * Returns: value for rarch_benchmark_callback_end().
+ **/
+retro_time_t rarch_benchmark_callback_begin(void);
+
+void rarch_benchmark_callback_end(retro_time_t start);
+
+/* Prints how the time of --benchmark split between core and frontend. */
+void rarch_benchmark_report(void);
+
+/**
+ * rarch_perf_histogram_percentile:
+ * @hist               : pointer to histogram
+ * @percent            : percentile to get (0 - 100).
+ *
+ * Estimates a percentile of the samples in histogram,
+ * interpolated within the bucket it falls into.
+ *
+ * Returns: percentile in microseconds, or 0 if no
+ * samples were added.
+ **/
+retro_time_t rarch_perf_histogram_percentile(
+      const struct rarch_perf_histogram *hist, unsigned percent);
+
+/**
+ * rarch_perf_histogram_summary:
+ * @hist               : pointer to histogram
+ * @s                  : output string.
+ * @len                : size of @s.
+ *
+ * Writes a one-line summary (average, p50, p95, p99, max)
+ * of histogram to @s.
+ **/
+void rarch_perf_histogram_summary(
+      const struct rarch_perf_histogram *hist, char *s, size_t len);
+
+void rarch_perf_histogram_reset(struct rarch_perf_histogram *hist);
+
+/* Spans of startup work, kept from the start of the process
+ * until PERF_TIMELINE_EVENTS of them were recorded. */
+#ifndef PERF_TIMELINE_EVENTS
+#define PERF_TIMELINE_EVENTS 512
+#endif
+
+/**
+ * rarch_timeline_begin:
+ * @name               : name of the span, must stay valid.
+ *
+ * Starts a span on the timeline, nested in the span begun last.
+ * Only to be used from the main thread, or from a thread it
+ * waits on until the span is ended.
+ **/
+void rarch_timeline_begin(const char *name);
+
+/**
+ * rarch_timeline_end:
+ *
+ * Ends the span begun last.
+ **/
+void rarch_timeline_end(void);
+
+/**
+ * rarch_timeline_dump:
+ * @path               : file to write to.
+ *
+ * Writes the spans recorded so far as a Chrome trace
+ * (chrome://tracing), spans not ended yet lasting until now.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool rarch_timeline_dump(const char *path);
+
+/* Every perf counter scope which ends while perf counters are
+ * enabled is traced, on any thread. The last PERF_TRACE_EVENTS
+ * of them are kept. */
+#ifndef PERF_TRACE_EVENTS
+#define PERF_TRACE_EVENTS 8192
+#endif
+
+/* Threads which can be named. */
+#ifndef PERF_TRACE_THREADS
+#define PERF_TRACE_THREADS 16
+#endif
+
+/**
+ * rarch_trace_init:
+ *
+ * Starts the clock traced scopes are timed against, and names
+ * the calling thread the main thread. Only the first call counts.
+ **/
+void rarch_trace_init(void);
+
+/**
+ * rarch_trace_thread_name:
+ * @name               : name of the thread, must stay valid.
+ *
+ * Names the calling thread in the traces written by
+ * rarch_trace_dump(). Safe from any thread.
+ **/
+void rarch_trace_thread_name(const char *name);
+
+/**
+ * rarch_trace_add:
+ * @name               : name of the scope, must stay valid.
+ * @start              : perf counter as the scope began.
+ * @end                : perf counter as the scope ended.
+ *
+ * Traces a scope of the calling thread, in the frame running.
+ * Safe from any thread.
+ **/
+void rarch_trace_add(const char *name,
+      retro_perf_tick_t start, retro_perf_tick_t end);
+
+/**
+ * rarch_trace_dump:
+ * @path               : file to write to.
+ *
+ * Writes the traced scopes as a Chrome trace (chrome://tracing,
+ * Perfetto), one track per thread, each scope telling the frame
+ * it ran in.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool rarch_trace_dump(const char *path);
+
+/* Most counters perf_hud_show shows. */
+#define PERF_HUD_LINES 32
+
+/* Time a perf counter took over the last second. */
+struct rarch_perf_sample
+{
+   const char *ident;
+   /* Registered by the core rather than by RetroArch. */
+   bool core;
+   /* Share of the second, 0 - 100. */
+   float percent;
+   float usec_per_frame;
+   float calls_per_frame;
+};
+
+/**
+ * rarch_perf_sample_update:
+ *
+ * Call once per frame from the main thread. Once a second,
+ * takes what every registered counter, RetroArch's and the
+ * core's, added up since the last time.
+ **/
+void rarch_perf_sample_update(void);
+
+/**
+ * rarch_perf_sample_get:
+ * @samples            : array to write to.
+ * @max                : size of @samples.
+ *
+ * Gets the counters of the last second, most time first.
+ * Safe from any thread.
+ *
+ * Returns: number of samples written.
+ **/
+unsigned rarch_perf_sample_get(struct rarch_perf_sample *samples,
+      unsigned max);
+
+/**
+ * rarch_perf_sample_summary:
+ * @sample             : sample.
+ * @s                  : output string.
+ * @len                : size of @s.
+ *
+ * Writes a one-line summary of @sample to @s.
+ **/
+void rarch_perf_sample_summary(const struct rarch_perf_sample *sample,
+      char *s, size_t len);
+
+/* Subsystems memory is accounted to. */
+enum rarch_mem_tag
+{
+   RARCH_MEM_REWIND = 0,
+   RARCH_MEM_VIDEO,
+   RARCH_MEM_AUDIO,
+   RARCH_MEM_MENU,
+   RARCH_MEM_RECORD,
+   RARCH_MEM_DB,
+   RARCH_MEM_NETPLAY,
+   RARCH_MEM_LAST
+};
+
+/**
+ * rarch_mem_add:
+ * @tag                : subsystem the memory belongs to.
+ * @size               : bytes allocated.
+ *
+ * Accounts @size bytes to @tag. Subsystems account their large
+ * allocations, GPU memory included, and take back the same amount
+ * with rarch_mem_sub() when freeing them. Safe from any thread.
+ **/
+void rarch_mem_add(enum rarch_mem_tag tag, size_t size);
+
+/**
+ * rarch_mem_sub:
+ * @tag                : subsystem the memory belonged to.
+ * @size               : bytes freed.
+ **/
+void rarch_mem_sub(enum rarch_mem_tag tag, size_t size);
+
+/**
+ * rarch_mem_get:
+ * @tag                : subsystem.
+ * @peak               : highest amount accounted so far, can be NULL.
+ *
+ * Returns: bytes currently accounted to @tag.
+ **/
+size_t rarch_mem_get(enum rarch_mem_tag tag, size_t *peak);
+
+/**
+ * rarch_mem_tag_name:
+ * @tag                : subsystem.
+ *
+ * Returns: human readable name of @tag.
+ **/
+const char *rarch_mem_tag_name(enum rarch_mem_tag tag);
+
+/**
+ * rarch_mem_summary:
+ * @tag                : subsystem, or RARCH_MEM_LAST for the total.
+ * @s                  : output string.
+ * @len                : size of @s.
+ *
+ * Writes the current and peak amount accounted to @tag to @s.
+ **/
+void rarch_mem_summary(enum rarch_mem_tag tag, char *s, size_t len);
+
 /**
  * rarch_perf_start:
  * @perf               : pointer to performance counter
@@ -102,10 +382,14 @@ static inline void rarch_perf_start(struct retro_perf_counter *perf)
  **/
 static inline void rarch_perf_stop(struct retro_perf_counter *perf)
 {
+   retro_perf_tick_t end;
+
    if (!g_extern.perfcnt_enable || !perf)
       return;
 
-   perf->total += rarch_get_perf_counter() - perf->start;
+   end          = rarch_get_perf_counter();
+   perf->total += end - perf->start;
+   rarch_trace_add(perf->ident, perf->start, end);
 }
 
 /**
@@ -126,6 +410,15 @@ uint64_t rarch_get_cpu_features(void);
  **/
 unsigned rarch_get_cpu_cores(void);
 
+/**
+ * rarch_get_cpu_cache_size:
+ *
+ * Gets the size of the per-core (L2) data cache.
+ *
+ * Returns: cache size in bytes, or 0 if unknown.
+ **/
+size_t rarch_get_cpu_cache_size(void);
+
 
 #ifdef __cplusplus
 }
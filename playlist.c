@@ -16,43 +16,285 @@
  */
 
 #include "playlist.h"
+#include "performance.h"
 #include <compat/posix_string.h>
 #include <boolean.h>
+#include <retro_miscellaneous.h>
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Playlists are stored as:
+ *
+ *    header: magic, version, entry count, index offset, size
+ *    one record per entry: path, core path, core name
+ *    index: count times { record offset, hash }, top first
+ *    records pushed since the index was written
+ *
+ * Loading only reads the index, an entry is read from its record
+ * the first time it is asked for. Each push appends its record,
+ * which loading replays on top of the index, at the size the
+ * playlist had when they were pushed. The file is only rewritten
+ * once enough of those piled up, after a clear or a change of
+ * size, or to upgrade a playlist from the older text format.
+ *
+ * Records hold each string as a 16-bit length and its bytes,
+ * an empty path being no path. Numbers are big endian. */
+
+#define PLAYLIST_MAGIC       "RPLAYLST"
+#define PLAYLIST_VERSION     1
+#define PLAYLIST_HEADER_SIZE 32
+#define PLAYLIST_INDEX_SIZE  12
+/* Three string lengths. */
+#define PLAYLIST_RECORD_MIN  6
+
+#define PLAYLIST_NONE        ((size_t)-1)
+
 struct content_playlist_entry
 {
    char *path;
    char *core_path;
    char *core_name;
+
+   /* Record to read the strings from until loaded is set. */
+   uint64_t offset;
+   /* Of path and core path, to find duplicates without
+    * reading every record. */
+   uint32_t hash;
+   bool loaded;
+
+   /* Slots of the entries above and below it. */
+   size_t prev;
+   size_t next;
+   /* Next slot in the same hash bucket. */
+   size_t hash_next;
 };
 
 struct content_playlist
 {
+   /* cap slots, the first size of them used, linked in
+    * playlist order from head to tail. */
    struct content_playlist_entry *entries;
    size_t size;
    size_t cap;
+   size_t head;
+   size_t tail;
+
+   /* Heads of the hash chains. */
+   size_t *buckets;
+   size_t bucket_mask;
+
+   /* Slots and buckets, accounted to RARCH_MEM_DB. */
+   size_t mem_size;
+
+   /* Last index looked up and its slot, so walking the
+    * playlist in order steps from one to the next. */
+   size_t cursor;
+   size_t cursor_slot;
+
+   FILE *file;
+   /* Records appended past the index. */
+   size_t appended;
+   /* The file has to be written from scratch. */
+   bool rewrite;
 
    char *conf_path;
+
+   /* Changed along with the entries, see
+    * content_playlist_generation(). */
+   unsigned generation;
 };
 
-void content_playlist_get_index(content_playlist_t *playlist,
-      size_t idx,
-      const char **path, const char **core_path,
-      const char **core_name)
+/* Shared by all playlists, so that two of them
+ * never go by the same generation. */
+static unsigned content_playlist_generations;
+
+static void content_playlist_write_be(uint8_t *buf, uint64_t val,
+      unsigned bytes)
 {
-   if (!playlist)
-      return;
+   while (bytes--)
+   {
+      buf[bytes] = (uint8_t)val;
+      val >>= 8;
+   }
+}
 
-   if (path)
-      *path      = playlist->entries[idx].path;
-   if (core_path)
-      *core_path = playlist->entries[idx].core_path;
-   if (core_name)
-      *core_name = playlist->entries[idx].core_name;
+static uint64_t content_playlist_read_be(const uint8_t *buf,
+      unsigned bytes)
+{
+   uint64_t val = 0;
+
+   while (bytes--)
+      val = (val << 8) | *buf++;
+   return val;
+}
+
+/* FNV-1a. */
+static uint32_t content_playlist_hash(const char *path,
+      const char *core_path)
+{
+   uint32_t hash = 2166136261u;
+
+   for (path = path ? path : ""; *path; path++)
+      hash = (hash ^ (uint8_t)*path) * 16777619u;
+   hash *= 16777619u;
+   for (; *core_path; core_path++)
+      hash = (hash ^ (uint8_t)*core_path) * 16777619u;
+   return hash;
+}
+
+/**
+ * content_playlist_alloc:
+ * @playlist             : playlist handle.
+ * @cap                  : number of entries.
+ *
+ * Allocates empty slots and hash buckets for @cap entries,
+ * leaving whatever the playlist had to the caller.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool content_playlist_alloc(content_playlist_t *playlist,
+      size_t cap)
+{
+   size_t i, buckets = 1;
+
+   while (buckets < cap)
+      buckets <<= 1;
+
+   playlist->entries = (struct content_playlist_entry*)calloc(cap,
+         sizeof(*playlist->entries));
+   playlist->buckets = (size_t*)malloc(buckets * sizeof(size_t));
+   if (!playlist->entries || !playlist->buckets)
+      return false;
+
+   for (i = 0; i < buckets; i++)
+      playlist->buckets[i] = PLAYLIST_NONE;
+
+   playlist->mem_size    = cap * sizeof(*playlist->entries) +
+      buckets * sizeof(size_t);
+   rarch_mem_add(RARCH_MEM_DB, playlist->mem_size);
+
+   playlist->bucket_mask = buckets - 1;
+   playlist->cap         = cap;
+   playlist->size        = 0;
+   playlist->head        = PLAYLIST_NONE;
+   playlist->tail        = PLAYLIST_NONE;
+   playlist->cursor      = PLAYLIST_NONE;
+   return true;
+}
+
+static void content_playlist_link_bottom(content_playlist_t *playlist,
+      size_t slot)
+{
+   struct content_playlist_entry *entry = &playlist->entries[slot];
+
+   entry->prev = playlist->tail;
+   entry->next = PLAYLIST_NONE;
+   if (playlist->tail != PLAYLIST_NONE)
+      playlist->entries[playlist->tail].next = slot;
+   else
+      playlist->head = slot;
+   playlist->tail = slot;
+
+   playlist->cursor = PLAYLIST_NONE;
+}
+
+static void content_playlist_unlink(content_playlist_t *playlist,
+      size_t slot)
+{
+   struct content_playlist_entry *entry = &playlist->entries[slot];
+
+   if (entry->prev != PLAYLIST_NONE)
+      playlist->entries[entry->prev].next = entry->next;
+   else
+      playlist->head = entry->next;
+
+   if (entry->next != PLAYLIST_NONE)
+      playlist->entries[entry->next].prev = entry->prev;
+   else
+      playlist->tail = entry->prev;
+
+   playlist->cursor = PLAYLIST_NONE;
+}
+
+static void content_playlist_link_top(content_playlist_t *playlist,
+      size_t slot)
+{
+   struct content_playlist_entry *entry = &playlist->entries[slot];
+
+   entry->prev = PLAYLIST_NONE;
+   entry->next = playlist->head;
+   if (playlist->head != PLAYLIST_NONE)
+      playlist->entries[playlist->head].prev = slot;
+   else
+      playlist->tail = slot;
+   playlist->head = slot;
+
+   playlist->cursor = PLAYLIST_NONE;
+}
+
+static void content_playlist_link_hash(content_playlist_t *playlist,
+      size_t slot)
+{
+   struct content_playlist_entry *entry = &playlist->entries[slot];
+   size_t *bucket = &playlist->buckets[entry->hash & playlist->bucket_mask];
+
+   entry->hash_next = *bucket;
+   *bucket          = slot;
+}
+
+static void content_playlist_unlink_hash(content_playlist_t *playlist,
+      size_t slot)
+{
+   struct content_playlist_entry *entry = &playlist->entries[slot];
+   size_t *link = &playlist->buckets[entry->hash & playlist->bucket_mask];
+
+   while (*link != slot)
+      link = &playlist->entries[*link].hash_next;
+   *link = entry->hash_next;
+}
+
+/**
+ * content_playlist_slot:
+ * @playlist             : playlist handle.
+ * @idx                  : index of the entry.
+ *
+ * Walks to the entry from whichever of the top, the bottom and
+ * the last entry looked up is closest.
+ *
+ * Returns: slot of the entry.
+ **/
+static size_t content_playlist_slot(content_playlist_t *playlist,
+      size_t idx)
+{
+   size_t pos  = 0;
+   size_t slot = playlist->head;
+
+   if (playlist->size - 1 - idx < idx)
+   {
+      pos  = playlist->size - 1;
+      slot = playlist->tail;
+   }
+
+   if (playlist->cursor != PLAYLIST_NONE &&
+         (playlist->cursor > idx ? playlist->cursor - idx : idx - playlist->cursor)
+         < (pos > idx ? pos - idx : idx - pos))
+   {
+      pos  = playlist->cursor;
+      slot = playlist->cursor_slot;
+   }
+
+   for (; pos < idx; pos++)
+      slot = playlist->entries[slot].next;
+   for (; pos > idx; pos--)
+      slot = playlist->entries[slot].prev;
+
+   playlist->cursor      = idx;
+   playlist->cursor_slot = slot;
+   return slot;
 }
 
 static void content_playlist_free_entry(
@@ -74,74 +316,295 @@ static void content_playlist_free_entry(
    memset(entry, 0, sizeof(*entry));
 }
 
-void content_playlist_push(content_playlist_t *playlist,
-      const char *path, const char *core_path,
-      const char *core_name)
+/**
+ * content_playlist_read_record:
+ * @file                 : file positioned at the record.
+ * @entry                : entry to read the strings into.
+ *
+ * Returns: true if the whole record was read, otherwise false,
+ * with @entry left empty.
+ **/
+static bool content_playlist_read_record(FILE *file,
+      struct content_playlist_entry *entry)
 {
-   size_t i;
+   unsigned i;
+   char **field[3];
 
-   if (!playlist)
+   field[0] = &entry->path;
+   field[1] = &entry->core_path;
+   field[2] = &entry->core_name;
+
+   for (i = 0; i < 3; i++)
+   {
+      uint8_t len_buf[2];
+      size_t len;
+
+      if (fread(len_buf, 1, sizeof(len_buf), file) != sizeof(len_buf))
+         goto error;
+
+      len = content_playlist_read_be(len_buf, 2);
+
+      if (!len && i == 0)
+         continue;
+
+      *field[i] = (char*)malloc(len + 1);
+      if (!*field[i] || fread(*field[i], 1, len, file) != len)
+         goto error;
+      (*field[i])[len] = '\0';
+   }
+
+   return true;
+
+error:
+   content_playlist_free_entry(entry);
+   return false;
+}
+
+static bool content_playlist_write_record(FILE *file,
+      const struct content_playlist_entry *entry)
+{
+   unsigned i;
+   const char *field[3];
+
+   field[0] = entry->path ? entry->path : "";
+   field[1] = entry->core_path;
+   field[2] = entry->core_name;
+
+   for (i = 0; i < 3; i++)
+   {
+      uint8_t len_buf[2];
+      size_t len = strlen(field[i]);
+
+      if (len > UINT16_MAX)
+         return false;
+
+      content_playlist_write_be(len_buf, len, 2);
+      if (fwrite(len_buf, 1, sizeof(len_buf), file) != sizeof(len_buf)
+            || fwrite(field[i], 1, len, file) != len)
+         return false;
+   }
+
+   return true;
+}
+
+/* Reads the strings of an entry the index only gave the
+ * offset of. */
+static void content_playlist_load_entry(content_playlist_t *playlist,
+      struct content_playlist_entry *entry)
+{
+   struct content_playlist_entry links = *entry;
+
+   if (entry->loaded)
       return;
 
-   for (i = 0; i < playlist->size; i++)
+   entry->loaded = true;
+
+   if (playlist->file
+         && fseek(playlist->file, (long)entry->offset, SEEK_SET) == 0
+         && content_playlist_read_record(playlist->file, entry))
+      return;
+
+   /* Broken record, keeps the entry though it can't run. */
+   entry->core_path = strdup("");
+   entry->core_name = strdup("");
+   entry->hash      = links.hash;
+   entry->loaded    = true;
+   entry->prev      = links.prev;
+   entry->next      = links.next;
+   entry->hash_next = links.hash_next;
+}
+
+void content_playlist_get_index(content_playlist_t *playlist,
+      size_t idx,
+      const char **path, const char **core_path,
+      const char **core_name)
+{
+   struct content_playlist_entry *entry = NULL;
+
+   if (!playlist || idx >= playlist->size)
+      return;
+
+   entry = &playlist->entries[content_playlist_slot(playlist, idx)];
+   content_playlist_load_entry(playlist, entry);
+
+   if (path)
+      *path      = entry->path;
+   if (core_path)
+      *core_path = entry->core_path;
+   if (core_name)
+      *core_name = entry->core_name;
+}
+
+/**
+ * content_playlist_bump:
+ * @playlist             : playlist handle.
+ * @path                 : content path, or NULL.
+ * @core_path            : core path.
+ * @core_name            : core name.
+ *
+ * Moves the entry for @path and @core_path to the top, adding it
+ * and dropping the bottom entry of a full playlist if it is new.
+ *
+ * Returns: the top entry, or NULL if it already was on top.
+ **/
+static struct content_playlist_entry *content_playlist_bump(
+      content_playlist_t *playlist,
+      const char *path, const char *core_path,
+      const char *core_name)
+{
+   size_t slot;
+   struct content_playlist_entry *entry = NULL;
+   uint32_t hash = content_playlist_hash(path, core_path);
+
+   for (slot = playlist->buckets[hash & playlist->bucket_mask];
+         slot != PLAYLIST_NONE; slot = entry->hash_next)
    {
-      bool equal_path = (!path && !playlist->entries[i].path) ||
-         (path && playlist->entries[i].path &&
-          !strcmp(path,playlist->entries[i].path));
+      bool equal_path;
+
+      entry = &playlist->entries[slot];
+      if (entry->hash != hash)
+         continue;
+
+      content_playlist_load_entry(playlist, entry);
+
+      equal_path = (!path && !entry->path) ||
+         (path && entry->path && !strcmp(path, entry->path));
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
-      if (equal_path && !strcmp(playlist->entries[i].core_path, core_path))
+      if (equal_path && !strcmp(entry->core_path, core_path))
       {
-         if (i == 0)
-            return;
+         if (slot == playlist->head)
+            return NULL;
 
          /* Seen it before, bump to top. */
-         struct content_playlist_entry tmp = playlist->entries[i];
-         memmove(playlist->entries + 1, playlist->entries,
-               i * sizeof(struct content_playlist_entry));
-         playlist->entries[0] = tmp;
-         return;
+         content_playlist_unlink(playlist, slot);
+         content_playlist_link_top(playlist, slot);
+         return entry;
       }
    }
 
+   /* A full playlist gives up its bottom entry's slot. */
    if (playlist->size == playlist->cap)
    {
-      content_playlist_free_entry(&playlist->entries[playlist->cap - 1]);
-      playlist->size--;
+      slot = playlist->tail;
+      content_playlist_unlink(playlist, slot);
+      content_playlist_unlink_hash(playlist, slot);
+      content_playlist_free_entry(&playlist->entries[slot]);
    }
+   else
+      slot = playlist->size++;
+
+   entry            = &playlist->entries[slot];
+   entry->path      = path ? strdup(path) : NULL;
+   entry->core_path = strdup(core_path);
+   entry->core_name = strdup(core_name);
+   entry->hash      = hash;
+   entry->loaded    = true;
+
+   content_playlist_link_hash(playlist, slot);
+   content_playlist_link_top(playlist, slot);
+   playlist->generation = ++content_playlist_generations;
+   return entry;
+}
 
-   memmove(playlist->entries + 1, playlist->entries,
-         (playlist->cap - 1) * sizeof(struct content_playlist_entry));
+void content_playlist_push(content_playlist_t *playlist,
+      const char *path, const char *core_path,
+      const char *core_name)
+{
+   struct content_playlist_entry *entry = NULL;
+
+   if (!playlist || !playlist->cap)
+      return;
+
+   entry = content_playlist_bump(playlist, path, core_path, core_name);
+   if (!entry || playlist->rewrite)
+      return;
+
+   /* Flushed right away, so that an entry that was pushed
+    * survives a crash before the playlist is freed. */
+   if (!playlist->file
+         || fseek(playlist->file, 0, SEEK_END) != 0
+         || !content_playlist_write_record(playlist->file, entry)
+         || fflush(playlist->file) != 0)
+   {
+      playlist->rewrite = true;
+      return;
+   }
 
-   playlist->entries[0].path      = path ? strdup(path) : NULL;
-   playlist->entries[0].core_path = strdup(core_path);
-   playlist->entries[0].core_name = strdup(core_name);
-   playlist->size++;
+   playlist->appended++;
 }
 
+/**
+ * content_playlist_write_file:
+ * @playlist             : playlist handle.
+ *
+ * Writes the playlist from scratch, with the index covering
+ * every entry. Entries not read yet are read from the old file,
+ * which is then replaced.
+ **/
 static void content_playlist_write_file(content_playlist_t *playlist)
 {
-   size_t i;
-   FILE *file = NULL;
+   size_t i, slot;
+   char tmp_path[PATH_MAX_LENGTH];
+   uint8_t header[PLAYLIST_HEADER_SIZE];
+   uint8_t *index = NULL;
+   long index_offset;
+   bool ok        = false;
+   FILE *file     = NULL;
 
-   if (!playlist)
-      return;
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", playlist->conf_path);
 
-   file = fopen(playlist->conf_path, "w");
+   index = (uint8_t*)malloc(playlist->size * PLAYLIST_INDEX_SIZE + 1);
+   file  = fopen(tmp_path, "wb");
 
-   if (!file)
-      return;
+   if (!index || !file)
+      goto end;
 
-   for (i = 0; i < playlist->size; i++)
+   memset(header, 0, sizeof(header));
+   if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
+      goto end;
+
+   for (i = 0, slot = playlist->head; slot != PLAYLIST_NONE;
+         i++, slot = playlist->entries[slot].next)
    {
-      fprintf(file, "%s\n%s\n%s\n",
-            playlist->entries[i].path ? playlist->entries[i].path : "",
-            playlist->entries[i].core_path,
-            playlist->entries[i].core_name);
+      struct content_playlist_entry *entry = &playlist->entries[slot];
+      uint8_t *index_entry = index + i * PLAYLIST_INDEX_SIZE;
+
+      content_playlist_load_entry(playlist, entry);
+
+      content_playlist_write_be(index_entry, ftell(file), 8);
+      content_playlist_write_be(index_entry + 8, entry->hash, 4);
+
+      if (!content_playlist_write_record(file, entry))
+         goto end;
    }
 
-   fclose(file);
+   index_offset = ftell(file);
+   if (fwrite(index, PLAYLIST_INDEX_SIZE, playlist->size, file)
+         != playlist->size)
+      goto end;
+
+   memcpy(header, PLAYLIST_MAGIC, 8);
+   content_playlist_write_be(header + 8,  PLAYLIST_VERSION, 4);
+   content_playlist_write_be(header + 12, playlist->size, 4);
+   content_playlist_write_be(header + 16, index_offset, 8);
+   content_playlist_write_be(header + 24, playlist->cap, 4);
+
+   ok = fseek(file, 0, SEEK_SET) == 0
+      && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+end:
+   free(index);
+   if (file && fclose(file) != 0)
+      ok = false;
+
+   if (playlist->file)
+      fclose(playlist->file);
+   playlist->file = NULL;
+
+   if (!ok || rename(tmp_path, playlist->conf_path) != 0)
+      remove(tmp_path);
 }
 
 void content_playlist_free(content_playlist_t *playlist)
@@ -150,13 +613,21 @@ void content_playlist_free(content_playlist_t *playlist)
    if (!playlist)
       return;
 
-   if (playlist->conf_path)
+   /* Replaying the appended records on every load costs
+    * more than writing them into the index once. */
+   if (playlist->conf_path && (playlist->rewrite ||
+            playlist->appended > playlist->size / 4 + 16))
       content_playlist_write_file(playlist);
    free(playlist->conf_path);
 
-   for (i = 0; i < playlist->cap; i++)
+   if (playlist->file)
+      fclose(playlist->file);
+
+   for (i = 0; i < playlist->size; i++)
       content_playlist_free_entry(&playlist->entries[i]);
    free(playlist->entries);
+   free(playlist->buckets);
+   rarch_mem_sub(RARCH_MEM_DB, playlist->mem_size);
 
    free(playlist);
 }
@@ -167,9 +638,17 @@ void content_playlist_clear(content_playlist_t *playlist)
    if (!playlist)
       return;
 
-   for (i = 0; i < playlist->cap; i++)
+   for (i = 0; i < playlist->size; i++)
       content_playlist_free_entry(&playlist->entries[i]);
-   playlist->size = 0;
+   for (i = 0; i <= playlist->bucket_mask; i++)
+      playlist->buckets[i] = PLAYLIST_NONE;
+
+   playlist->size    = 0;
+   playlist->head    = PLAYLIST_NONE;
+   playlist->tail    = PLAYLIST_NONE;
+   playlist->cursor  = PLAYLIST_NONE;
+   playlist->rewrite = true;
+   playlist->generation = ++content_playlist_generations;
 }
 
 size_t content_playlist_size(content_playlist_t *playlist)
@@ -179,22 +658,63 @@ size_t content_playlist_size(content_playlist_t *playlist)
    return 0;
 }
 
-static bool content_playlist_read_file(
-      content_playlist_t *playlist, const char *path)
+unsigned content_playlist_generation(content_playlist_t *playlist)
+{
+   if (playlist)
+      return playlist->generation;
+   return 0;
+}
+
+/* Keeps the top @cap entries. */
+static void content_playlist_resize(content_playlist_t *playlist,
+      size_t cap)
+{
+   size_t i, slot, next;
+   content_playlist_t old = *playlist;
+
+   if (cap == playlist->cap)
+      return;
+
+   if (!content_playlist_alloc(playlist, cap))
+   {
+      free(playlist->entries);
+      free(playlist->buckets);
+      *playlist = old;
+      return;
+   }
+
+   for (i = 0, slot = old.head; slot != PLAYLIST_NONE; i++, slot = next)
+   {
+      struct content_playlist_entry *entry = &old.entries[slot];
+
+      next = entry->next;
+
+      if (i < cap)
+      {
+         playlist->entries[i] = *entry;
+         content_playlist_link_hash(playlist, i);
+         content_playlist_link_bottom(playlist, i);
+         playlist->size++;
+      }
+      else
+         content_playlist_free_entry(entry);
+   }
+
+   free(old.entries);
+   free(old.buckets);
+   rarch_mem_sub(RARCH_MEM_DB, old.mem_size);
+   playlist->generation = ++content_playlist_generations;
+}
+
+/* Playlists written before the binary format had three lines
+ * per entry: path, core path and core name. */
+static void content_playlist_read_text(
+      content_playlist_t *playlist, FILE *file)
 {
    char buf[3][1024];
    unsigned i;
    struct content_playlist_entry *entry = NULL;
    char *last = NULL;
-   FILE *file = fopen(path, "r");
-
-   if (!file)
-   {
-      /* Playlist file does not exist,
-       * creating an empty playlist instead.
-       */
-      return true;
-   }
 
    for (playlist->size = 0; playlist->size < playlist->cap; )
    {
@@ -202,7 +722,7 @@ static bool content_playlist_read_file(
       {
          *buf[i] = '\0';
          if (!fgets(buf[i], sizeof(buf[i]), file))
-            goto end;
+            return;
 
          last = strrchr(buf[i], '\n');
          if (last)
@@ -218,11 +738,148 @@ static bool content_playlist_read_file(
          entry->path = strdup(buf[0]);
       entry->core_path = strdup(buf[1]);
       entry->core_name = strdup(buf[2]);
+      entry->hash      = content_playlist_hash(entry->path, entry->core_path);
+      entry->loaded    = true;
+
+      content_playlist_link_hash(playlist, playlist->size);
+      content_playlist_link_bottom(playlist, playlist->size);
       playlist->size++;
    }
+}
 
-end:
-   fclose(file);
+/* Replays the records pushed since the index was written. */
+static void content_playlist_read_appended(content_playlist_t *playlist,
+      long offset)
+{
+   for (;;)
+   {
+      struct content_playlist_entry tmp = {0};
+
+      if (fseek(playlist->file, offset, SEEK_SET) != 0)
+         break;
+
+      if (!content_playlist_read_record(playlist->file, &tmp))
+      {
+         /* Left half written, later records would be lost
+          * behind it. */
+         if (fseek(playlist->file, 0, SEEK_END) != 0
+               || ftell(playlist->file) != offset)
+            playlist->rewrite = true;
+         break;
+      }
+
+      offset = ftell(playlist->file);
+
+      content_playlist_bump(playlist, tmp.path,
+            tmp.core_path, tmp.core_name);
+      content_playlist_free_entry(&tmp);
+      playlist->appended++;
+   }
+}
+
+static bool content_playlist_read_file(
+      content_playlist_t *playlist, const char *path)
+{
+   uint8_t header[PLAYLIST_HEADER_SIZE];
+   uint8_t *index = NULL;
+   uint64_t count, index_offset, file_cap, file_size, limit, i;
+   size_t cap     = playlist->cap;
+
+   playlist->file = fopen(path, "r+b");
+   if (!playlist->file)
+      playlist->file = fopen(path, "rb");
+
+   if (!playlist->file)
+   {
+      /* Playlist file does not exist,
+       * creating an empty playlist instead.
+       */
+      playlist->rewrite = true;
+      return true;
+   }
+
+   if (fread(header, 1, sizeof(header), playlist->file) != sizeof(header)
+         || memcmp(header, PLAYLIST_MAGIC, 8) != 0)
+   {
+      rewind(playlist->file);
+      content_playlist_read_text(playlist, playlist->file);
+      goto rewrite;
+   }
+
+   count        = content_playlist_read_be(header + 12, 4);
+   index_offset = content_playlist_read_be(header + 16, 8);
+   file_cap     = content_playlist_read_be(header + 24, 4);
+
+   if (fseek(playlist->file, 0, SEEK_END) != 0
+         || ftell(playlist->file) < 0)
+      goto rewrite;
+   file_size = ftell(playlist->file);
+
+   if (content_playlist_read_be(header + 8, 4) != PLAYLIST_VERSION
+         || index_offset < PLAYLIST_HEADER_SIZE || index_offset > LONG_MAX
+         || index_offset > file_size
+         || count > (file_size - index_offset) / PLAYLIST_INDEX_SIZE
+         || !file_cap || count > file_cap
+         || fseek(playlist->file, (long)index_offset, SEEK_SET) != 0)
+      goto rewrite;
+
+   /* No more entries can be replayed than the index and the
+    * records after it hold. Any larger size drops the same
+    * entries, so a broken one is cut down to what the file
+    * holds before anything is allocated for it. */
+   limit = count + (file_size - index_offset
+         - count * PLAYLIST_INDEX_SIZE) / PLAYLIST_RECORD_MIN;
+   if (file_cap > limit)
+      file_cap = limit ? limit : 1;
+
+   /* Replayed at the size they were pushed at, seeing the
+    * same entries drop off the bottom. */
+   if (file_cap != cap)
+   {
+      content_playlist_resize(playlist, file_cap);
+      playlist->rewrite = true;
+   }
+
+   index = (uint8_t*)malloc(count * PLAYLIST_INDEX_SIZE + 1);
+   if (!index || fread(index, PLAYLIST_INDEX_SIZE, count, playlist->file)
+         != count)
+   {
+      free(index);
+      goto rewrite;
+   }
+
+   for (i = 0; i < count && playlist->size < playlist->cap; i++)
+   {
+      const uint8_t *index_entry = index + i * PLAYLIST_INDEX_SIZE;
+      struct content_playlist_entry *entry =
+         &playlist->entries[playlist->size];
+
+      entry->offset = content_playlist_read_be(index_entry, 8);
+      entry->hash   = content_playlist_read_be(index_entry + 8, 4);
+
+      if (entry->offset < PLAYLIST_HEADER_SIZE
+            || entry->offset >= index_offset)
+      {
+         playlist->rewrite = true;
+         continue;
+      }
+
+      content_playlist_link_hash(playlist, playlist->size);
+      content_playlist_link_bottom(playlist, playlist->size);
+      playlist->size++;
+   }
+   free(index);
+
+   content_playlist_read_appended(playlist,
+         (long)(index_offset + count * PLAYLIST_INDEX_SIZE));
+   content_playlist_resize(playlist, cap);
+   return true;
+
+rewrite:
+   /* Whatever could be read is kept, in a file written anew. */
+   fclose(playlist->file);
+   playlist->file     = NULL;
+   playlist->rewrite  = true;
    return true;
 }
 
@@ -233,16 +890,13 @@ content_playlist_t *content_playlist_init(const char *path, size_t size)
    if (!playlist)
       return NULL;
 
-   playlist->entries = (struct content_playlist_entry*)calloc(size,
-         sizeof(*playlist->entries));
-   if (!playlist->entries)
+   if (!content_playlist_alloc(playlist, size))
       goto error;
 
-   playlist->cap = size;
-
    content_playlist_read_file(playlist, path);
 
-   playlist->conf_path = strdup(path);
+   playlist->conf_path  = strdup(path);
+   playlist->generation = ++content_playlist_generations;
    return playlist;
 
 error:
@@ -34,6 +34,16 @@ void content_playlist_clear(content_playlist_t *playlist);
 
 size_t content_playlist_size(content_playlist_t *playlist);
 
+/**
+ * content_playlist_generation:
+ * @playlist             : playlist handle.
+ *
+ * Returns: a number which changes whenever the entries of
+ * @playlist do, and which no other playlist goes by, to tell
+ * whether something made out of it is still current.
+ **/
+unsigned content_playlist_generation(content_playlist_t *playlist);
+
 void content_playlist_get_index(content_playlist_t *playlist,
       size_t index,
       const char **path, const char **core_path,
@@ -5,6 +5,7 @@
 #include <direct.h>
 #else
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 #include <string.h>
 #include <errno.h>
@@ -13,12 +14,16 @@
 #include <fcntl.h>
 
 #include <stdio.h>
+#include <ctype.h>
 
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "rarchdb_endian.h"
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
 #define MAGIC_NUMBER "RARCHDB"
 
 struct rarchdb_header
@@ -37,12 +42,13 @@ struct rarchdb_index
 	char name[50];
 	uint64_t key_size;
 	uint64_t next;
-};
-
-struct node_iter_ctx
-{
-	struct rarchdb *db;
-	struct rarchdb_index *idx;
+	/* Slots of a hash index, 0 for a sorted one. */
+	uint64_t buckets;
+	/* Field the keys come from, which older indexes are named after. */
+	char field[50];
+	uint64_t key_type;
+	/* Keys can repeat and items can leave them out. */
+	int secondary;
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -100,29 +106,171 @@ int rarchdb_create(int fd, rarchdb_value_provider value_provider, void *ctx)
    return 0;
 }
 
+static const struct rmsgpack_dom_value *rarchdb_index_field(
+      const struct rmsgpack_dom_value *header, const char *name,
+      enum rmsgpack_dom_type type)
+{
+   struct rmsgpack_dom_value key;
+   const struct rmsgpack_dom_value *value;
+
+   key.type = RDT_STRING;
+   key.string.len = strlen(name);
+   key.string.buff = (char*)name;
+
+   value = rmsgpack_dom_value_map_value(header, &key);
+   if (!value || value->type != type)
+      return NULL;
+   return value;
+}
+
+static void rarchdb_index_string(char *s, size_t size,
+      const struct rmsgpack_dom_value *value)
+{
+   size_t len = value->string.len < size ? value->string.len : size - 1;
+
+   memcpy(s, value->string.buff, len);
+   s[len] = '\0';
+}
+
 static int rarchdb_read_index_header(int fd, struct rarchdb_index *idx)
 {
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next,
-         NULL);
+   int rv;
+   struct rmsgpack_dom_value header;
+   const struct rmsgpack_dom_value *name, *key_size, *next, *buckets;
+   const struct rmsgpack_dom_value *field, *key_type, *secondary;
+
+   if ((rv = rmsgpack_dom_read(fd, &header)) < 0)
+      return rv;
+
+   name     = rarchdb_index_field(&header, "name", RDT_STRING);
+   key_size = rarchdb_index_field(&header, "key_size", RDT_UINT);
+   next     = rarchdb_index_field(&header, "next", RDT_UINT);
+   /* Only hash indexes have it, sorted ones predate them. */
+   buckets  = rarchdb_index_field(&header, "buckets", RDT_UINT);
+   field    = rarchdb_index_field(&header, "field", RDT_STRING);
+   key_type = rarchdb_index_field(&header, "key_type", RDT_UINT);
+   secondary = rarchdb_index_field(&header, "secondary", RDT_BOOL);
+
+   if (!name || !key_size || !next)
+   {
+      rmsgpack_dom_value_free(&header);
+      return -EINVAL;
+   }
+
+   rarchdb_index_string(idx->name, sizeof(idx->name), name);
+   rarchdb_index_string(idx->field, sizeof(idx->field),
+         field ? field : name);
+   idx->key_size = key_size->uint_;
+   idx->next     = next->uint_;
+   idx->buckets  = buckets ? buckets->uint_ : 0;
+   idx->key_type = key_type ? key_type->uint_ : RARCHDB_KEY_BYTES;
+   idx->secondary = secondary && secondary->bool_;
+
+   rmsgpack_dom_value_free(&header);
+   return 0;
 }
 
 static void rarchdb_write_index_header(int fd, struct rarchdb_index *idx)
 {
-	rmsgpack_write_map_header(fd, 3);
+	rmsgpack_write_map_header(fd, 4 + !!idx->buckets + !!idx->key_type
+			+ !!idx->secondary);
 	rmsgpack_write_string(fd, "name", strlen("name"));
 	rmsgpack_write_string(fd, idx->name, strlen(idx->name));
+	rmsgpack_write_string(fd, "field", strlen("field"));
+	rmsgpack_write_string(fd, idx->field, strlen(idx->field));
 	rmsgpack_write_string(fd, "key_size", strlen("key_size"));
 	rmsgpack_write_uint(fd, idx->key_size);
 	rmsgpack_write_string(fd, "next", strlen("next"));
 	rmsgpack_write_uint(fd, idx->next);
+	if (idx->buckets)
+	{
+		rmsgpack_write_string(fd, "buckets", strlen("buckets"));
+		rmsgpack_write_uint(fd, idx->buckets);
+	}
+	if (idx->key_type)
+	{
+		rmsgpack_write_string(fd, "key_type", strlen("key_type"));
+		rmsgpack_write_uint(fd, idx->key_type);
+	}
+	if (idx->secondary)
+	{
+		rmsgpack_write_string(fd, "secondary", strlen("secondary"));
+		rmsgpack_write_bool(fd, 1);
+	}
+}
+
+/* Items are parsed in place from here, index nodes pointed at. */
+static int rarchdb_map(struct rarchdb *db)
+{
+   struct stat st;
+   off_t pos;
+   uint8_t *buff;
+   uint64_t nread = 0;
+
+   db->data   = NULL;
+   db->size   = 0;
+   db->mapped = 0;
+
+   if (fstat(db->fd, &st) != 0)
+      return -errno;
+
+   db->size = st.st_size;
+
+#ifndef _WIN32
+   if (db->size)
+   {
+      void *map = mmap(NULL, db->size, PROT_READ, MAP_SHARED, db->fd, 0);
+
+      if (map != MAP_FAILED)
+      {
+         db->data   = (const uint8_t*)map;
+         db->mapped = 1;
+         return 0;
+      }
+   }
+#endif
+
+   buff = (uint8_t*)malloc(db->size ? db->size : 1);
+   if (!buff)
+      return -ENOMEM;
+
+   pos = lseek(db->fd, 0, SEEK_CUR);
+   lseek(db->fd, 0, SEEK_SET);
+
+   while (nread < db->size)
+   {
+      ssize_t rv = read(db->fd, buff + nread, db->size - nread);
+      if (rv <= 0)
+      {
+         free(buff);
+         lseek(db->fd, pos, SEEK_SET);
+         return rv < 0 ? -errno : -EINVAL;
+      }
+      nread += rv;
+   }
+
+   lseek(db->fd, pos, SEEK_SET);
+   db->data = buff;
+   return 0;
+}
+
+static void rarchdb_unmap(struct rarchdb *db)
+{
+#ifndef _WIN32
+   if (db->mapped)
+      munmap((void*)db->data, db->size);
+   else
+#endif
+      free((void*)db->data);
+
+   db->data   = NULL;
+   db->size   = 0;
+   db->mapped = 0;
 }
 
 void rarchdb_close(struct rarchdb *db)
 {
+	rarchdb_unmap(db);
 	close(db->fd);
 	db->fd = -1;
 }
@@ -132,7 +280,11 @@ int rarchdb_open(const char *path, struct rarchdb *db)
    struct rarchdb_header header;
    struct rarchdb_metadata md;
    int rv;
-   int fd = open(path, O_RDWR);
+   int fd = open(path, O_RDWR | O_BINARY);
+
+   /* Only creating indexes writes, lookups work on read-only files. */
+   if (fd == -1)
+      fd = open(path, O_RDONLY | O_BINARY);
    if (fd == -1)
       return -errno;
 
@@ -143,7 +295,7 @@ int rarchdb_open(const char *path, struct rarchdb *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(header.magic_number)) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -157,8 +309,11 @@ int rarchdb_open(const char *path, struct rarchdb *db)
       goto error;
    }
    db->count = md.count;
+   db->metadata_offset = header.metadata_offset;
    db->first_index_offset = lseek(fd, 0, SEEK_CUR);
    db->fd = fd;
+   if ((rv = rarchdb_map(db)) < 0)
+      goto error;
    rarchdb_read_reset(db);
    return 0;
 error:
@@ -172,74 +327,186 @@ static int rarchdb_find_index(struct rarchdb *db, const char *index_name, struct
    off_t offset = lseek(db->fd, db->first_index_offset, SEEK_SET);
    while (offset < eof)
    {
-      rarchdb_read_index_header(db->fd, idx);
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (rarchdb_read_index_header(db->fd, idx) < 0)
+         return -1;
+      if (strcmp(index_name, idx->name) == 0)
          return 0;
       offset = lseek(db->fd, idx->next, SEEK_CUR);
    }
    return -1;
 }
 
-static int node_compare(const void *a, const void* b, void *ctx)
+/* Index nodes are the key followed by the item offset.
+ * Sorted indexes keep them ordered by key, hash indexes keep
+ * them in a power of two of slots, where an empty slot has
+ * offset 0, which no item can have. */
+static int binsearch(const uint8_t *buff, const void *item, uint64_t count, uint8_t field_size, uint64_t *offset)
 {
-	return memcmp(a, b, *(uint8_t*)ctx);
+   uint64_t low = 0, high = count;
+   size_t item_size = field_size + sizeof(uint64_t);
+
+   while (low < high)
+   {
+      uint64_t mid = low + (high - low) / 2;
+      const uint8_t *current = buff + mid * item_size;
+      int rv = memcmp(current, item, field_size);
+
+      if (rv == 0)
+      {
+         memcpy(offset, current + field_size, sizeof(uint64_t));
+         return 0;
+      }
+
+      if (rv > 0)
+         high = mid;
+      else
+         low = mid + 1;
+   }
+
+   return -1;
 }
 
-static int binsearch(const void *buff, const void *item, uint64_t count, uint8_t field_size, uint64_t *offset)
+/* FNV-1a, keys are already hashes or CRCs so it only has
+ * to spread them over the slots. */
+static uint64_t hash_key(const uint8_t *key, size_t size)
 {
-   int mid = count / 2;
-   int item_size = field_size + sizeof(uint64_t);
-   uint64_t *current = (uint64_t*)buff + (mid * item_size);
-   int rv = node_compare(current, item, &field_size);
+   size_t i;
+   uint64_t h = 0xcbf29ce484222325ULL;
 
-   if (rv == 0)
+   for (i = 0; i < size; i++)
+      h = (h ^ key[i]) * 0x100000001b3ULL;
+
+   return h;
+}
+
+static int hash_find(const uint8_t *buff, const void *item, uint64_t buckets, uint8_t field_size, uint64_t *offset)
+{
+   uint64_t i, probes;
+   size_t item_size = field_size + sizeof(uint64_t);
+
+   i = hash_key((const uint8_t*)item, field_size) & (buckets - 1);
+
+   for (probes = 0; probes < buckets; probes++)
    {
-      *offset = *(uint64_t*)(current + field_size);
-      return 0;
+      const uint8_t *current = buff + i * item_size;
+
+      memcpy(offset, current + field_size, sizeof(uint64_t));
+      if (*offset == 0)
+         return -1;
+      if (memcmp(current, item, field_size) == 0)
+         return 0;
+
+      i = (i + 1) & (buckets - 1);
    }
-   else if (count == 0)
-      return -1;
-   else if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
 
-   return binsearch(current + item_size, item, count - mid, field_size, offset);
+   return -1;
 }
 
-int rarchdb_find_entry(struct rarchdb *db, const char *index_name, const void *key)
+int rarchdb_lookup_open(struct rarchdb *db, const char *index_name,
+      struct rarchdb_lookup *lookup)
 {
    struct rarchdb_index idx;
-   int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   ssize_t rv;
+   uint8_t *nodes;
+   uint64_t pos;
+   uint64_t nread = 0;
+
+   memset(lookup, 0, sizeof(*lookup));
 
    if (rarchdb_find_index(db, index_name, &idx) < 0)
    {
       rarchdb_read_reset(db);
       return -1;
    }
-   
-   bufflen = idx.next;
-   buff = malloc(bufflen);
-   
-   if (!buff)
+
+   if (!idx.key_size || idx.key_size > 0xff)
+   {
+      rarchdb_read_reset(db);
+      return -EINVAL;
+   }
+
+   /* Slot counts that are not a power of two are not ours. */
+   if (idx.buckets & (idx.buckets - 1))
+   {
+      rarchdb_read_reset(db);
+      return -EINVAL;
+   }
+
+   lookup->key_size = idx.key_size;
+   lookup->key_type = idx.key_type;
+   lookup->count = idx.next / (idx.key_size + sizeof(uint64_t));
+   lookup->buckets = idx.buckets;
+   if (lookup->buckets > lookup->count)
+   {
+      rarchdb_read_reset(db);
+      return -EINVAL;
+   }
+
+   /* Indexes created since the file was opened are not mapped. */
+   pos = lseek(db->fd, 0, SEEK_CUR);
+   if (pos + idx.next <= db->size)
+   {
+      lookup->nodes = db->data + pos;
+      rarchdb_read_reset(db);
+      return 0;
+   }
+
+   nodes = (uint8_t*)malloc(idx.next ? idx.next : 1);
+   if (!nodes)
+   {
+      rarchdb_read_reset(db);
       return -ENOMEM;
+   }
+
+   lookup->nodes = nodes;
+   lookup->owned = 1;
 
-   while (nread < bufflen)
+   while (nread < idx.next)
    {
-      void *buff_ = (uint64_t*)buff + nread;
-      rv = read(db->fd, buff_, bufflen - nread);
+      rv = read(db->fd, nodes + nread, idx.next - nread);
       if (rv <= 0)
       {
-         free(buff);
-         return -errno;
+         rv = rv < 0 ? -errno : -EINVAL;
+         rarchdb_lookup_close(lookup);
+         rarchdb_read_reset(db);
+         return rv;
       }
       nread += rv;
    }
 
-   rv = binsearch(buff, key, db->count, idx.key_size, &offset);
-   free(buff);
    rarchdb_read_reset(db);
+   return 0;
+}
+
+int rarchdb_lookup_find(const struct rarchdb_lookup *lookup, const void *key,
+      uint64_t *offset)
+{
+   if (lookup->buckets)
+      return hash_find(lookup->nodes, key, lookup->buckets,
+            (uint8_t)lookup->key_size, offset);
+
+   return binsearch(lookup->nodes, key, lookup->count,
+         (uint8_t)lookup->key_size, offset);
+}
+
+void rarchdb_lookup_close(struct rarchdb_lookup *lookup)
+{
+   if (lookup->owned)
+      free((void*)lookup->nodes);
+   memset(lookup, 0, sizeof(*lookup));
+}
+
+int rarchdb_find_entry(struct rarchdb *db, const char *index_name, const void *key)
+{
+   struct rarchdb_lookup lookup;
+   uint64_t offset;
+   int rv = rarchdb_lookup_open(db, index_name, &lookup);
+
+   if (rv != 0)
+      return rv;
+
+   rv = rarchdb_lookup_find(&lookup, key, &offset);
+   rarchdb_lookup_close(&lookup);
 
    if (rv == 0)
       lseek(db->fd, offset, SEEK_SET);
@@ -272,14 +539,32 @@ int rarchdb_read_item(struct rarchdb *db, struct rmsgpack_dom_value *out)
 	return 0;
 }
 
-static int node_iter(void *value, void *ctx)
+int rarchdb_read_item_view(struct rarchdb *db, struct rmsgpack_dom_arena *arena,
+      struct rmsgpack_dom_value *out)
 {
-	struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   int rv;
+   uint64_t pos;
 
-	if (write(nictx->db->fd, value, nictx->idx->key_size + sizeof(uint64_t)) > 0)
-		return 0;
+   if (db->eof)
+      return EOF;
 
-   return -1;
+   pos = lseek(db->fd, 0, SEEK_CUR);
+   if (pos >= db->size)
+      return -EINVAL;
+
+   rv = rmsgpack_dom_parse(db->data + pos, db->size - pos, arena, out);
+   if (rv < 0)
+      return rv;
+
+   lseek(db->fd, pos + rv, SEEK_SET);
+
+   if (out->type == RDT_NULL)
+   {
+      db->eof = 1;
+      return EOF;
+   }
+
+   return 0;
 }
 
 uint64_t rarchdb_tell(struct rarchdb *db)
@@ -287,29 +572,216 @@ uint64_t rarchdb_tell(struct rarchdb *db)
 	return lseek(db->fd, 0, SEEK_CUR);
 }
 
-int rarchdb_create_index(struct rarchdb *db, const char* name, const char *field_name)
+/* Bottom-up merge sort of @count nodes of @size bytes, by their
+ * first @key_size bytes. Returns whichever of @nodes and @tmp
+ * ends up holding the sorted nodes. */
+static uint8_t *sort_nodes(uint8_t *nodes, uint8_t *tmp, uint64_t count,
+      size_t size, size_t key_size)
 {
-   int rv;
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
-   struct rarchdb_index idx;
+   uint64_t width;
+   uint8_t *src = nodes, *dst = tmp, *swap;
+
+   for (width = 1; width < count; width *= 2)
+   {
+      uint64_t start;
+
+      for (start = 0; start < count; start += 2 * width)
+      {
+         uint64_t l   = start;
+         uint64_t mid = start + width < count ? start + width : count;
+         uint64_t r   = mid;
+         uint64_t end = start + 2 * width < count ? start + 2 * width : count;
+         uint8_t *out = dst + start * size;
+
+         /* Already in order, which is the usual case for DATs. */
+         if (mid < end && memcmp(src + (mid - 1) * size,
+                  src + mid * size, key_size) <= 0)
+         {
+            memcpy(out, src + start * size, (end - start) * size);
+            continue;
+         }
+
+         while (l < mid && r < end)
+         {
+            if (memcmp(src + r * size, src + l * size, key_size) < 0)
+               memcpy(out, src + r++ * size, size);
+            else
+               memcpy(out, src + l++ * size, size);
+            out += size;
+         }
+
+         memcpy(out, src + l * size, (mid - l) * size);
+         out += (mid - l) * size;
+         memcpy(out, src + r * size, (end - r) * size);
+      }
+
+      swap = src;
+      src  = dst;
+      dst  = swap;
+   }
+
+   return src;
+}
+
+static void print_duplicate(const uint8_t *key, size_t key_size)
+{
+   struct rmsgpack_dom_value value;
+
+   value.type = RDT_BINARY;
+   value.binary.len = key_size;
+   value.binary.buff = (char*)key;
+
+   printf("Value is not unique: ");
+   rmsgpack_dom_value_print(&value);
+   printf("\n");
+}
+
+/* Secondary index keys sort the way rarchdb_query_match() compares
+ * values: numbers as big endian of the value with its sign flipped,
+ * strings and binaries zero padded or cut to the key size. Both only
+ * ever keep or swap the order of two values for equal keys, so a key
+ * range holds every item in the value range, and a few more that the
+ * query then tells apart. */
+static int key_type_of(const struct rmsgpack_dom_value *value)
+{
+   switch (value->type)
+   {
+      case RDT_BOOL:
+      case RDT_UINT:
+      case RDT_INT:
+         return RARCHDB_KEY_NUMBER;
+      case RDT_STRING:
+      case RDT_BINARY:
+         return RARCHDB_KEY_BYTES;
+      default:
+         break;
+   }
+
+   return -1;
+}
+
+static int encode_key(uint64_t key_type, uint8_t key_size,
+      const struct rmsgpack_dom_value *value, uint8_t *key)
+{
+   unsigned i;
+   int64_t number;
+   uint64_t biased;
+
+   if (key_type_of(value) != (int)key_type)
+      return -1;
+
+   if (key_type == RARCHDB_KEY_BYTES)
+   {
+      uint32_t len = value->string.len < key_size ?
+         value->string.len : key_size;
+
+      memset(key, 0, key_size);
+      memcpy(key, value->string.buff, len);
+      return 0;
+   }
+
+   if (key_size != sizeof(uint64_t))
+      return -1;
+
+   if (value->type == RDT_BOOL)
+      number = value->bool_ != 0;
+   else if (value->type == RDT_INT)
+      number = value->int_;
+   else
+      number = value->uint_ > INT64_MAX ? INT64_MAX : (int64_t)value->uint_;
+
+   biased = (uint64_t)number ^ (1ULL << 63);
+   for (i = 0; i < sizeof(uint64_t); i++)
+      key[i] = (uint8_t)(biased >> (56 - 8 * i));
+
+   return 0;
+}
+
+/* Works out the key type from the first item that has the field,
+ * and for strings and binaries the key size from the longest. */
+static int secondary_key_layout(struct rarchdb *db,
+      const struct rmsgpack_dom_value *key,
+      uint64_t *key_type, uint8_t *key_size)
+{
+   int type = -1;
+   uint32_t longest = 0;
    struct rmsgpack_dom_value item;
    struct rmsgpack_dom_value *field;
-   void* buff = NULL;
-   uint64_t *buff_u64 = NULL;
-   uint8_t field_size = 0;
-   struct bintree tree;
-   uint64_t item_loc = rarchdb_tell(db);
-   uint64_t idx_header_offset;
+   struct rmsgpack_dom_arena arena;
 
-   bintree_new(&tree, node_compare, &field_size);
+   rmsgpack_dom_arena_init(&arena);
    rarchdb_read_reset(db);
 
+   while (rarchdb_read_item_view(db, &arena, &item) == 0)
+   {
+      field = rmsgpack_dom_value_map_value(&item, key);
+
+      if (field && type < 0)
+         type = key_type_of(field);
+
+      if (field && type == RARCHDB_KEY_BYTES
+            && key_type_of(field) == type
+            && field->string.len > longest)
+         longest = field->string.len;
+
+      rmsgpack_dom_arena_reset(&arena);
+   }
+
+   rmsgpack_dom_arena_free(&arena);
+   rarchdb_read_reset(db);
+
+   if (type < 0)
+   {
+      printf("field not found in any item\n");
+      return -EINVAL;
+   }
+
+   *key_type = type;
+   if (type == RARCHDB_KEY_NUMBER)
+      *key_size = sizeof(uint64_t);
+   else
+      *key_size = longest == 0 ? 1 : longest > 0xff ? 0xff : longest;
+
+   return 0;
+}
+
+/* Reads @field_name of every item into *nodes, as key and offset
+ * pairs. Unique indexes need it to be a binary of the same size in
+ * every item. Secondary ones encode whatever the items have, see
+ * encode_key(), and leave out items without it. */
+static int collect_nodes(struct rarchdb *db, const char *field_name,
+      int secondary, uint8_t **nodes, uint64_t *count,
+      uint8_t *key_size, uint64_t *key_type)
+{
+   int rv = 0;
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_value *field;
+   struct rmsgpack_dom_arena arena;
+   uint8_t field_size = 0;
+   uint8_t *buff = NULL;
+   uint64_t cap = 0, n = 0;
+   uint64_t item_loc;
+   size_t node_size = 0;
+
    key.type = RDT_STRING;
    key.string.len = strlen(field_name);
    // We know we aren't going to change it
    key.string.buff = (char *) field_name;
-   while(rarchdb_read_item(db, &item) == 0)
+
+   *key_type = RARCHDB_KEY_BYTES;
+   if (secondary)
+   {
+      if ((rv = secondary_key_layout(db, &key, key_type, &field_size)) < 0)
+         return rv;
+      node_size = field_size + sizeof(uint64_t);
+   }
+
+   rmsgpack_dom_arena_init(&arena);
+   rarchdb_read_reset(db);
+   item_loc = rarchdb_tell(db);
+
+   while(rarchdb_read_item_view(db, &arena, &item) == 0)
    {
       if (item.type != RDT_MAP)
       {
@@ -318,28 +790,35 @@ int rarchdb_create_index(struct rarchdb *db, const char* name, const char *field
          goto clean;
       }
       field = rmsgpack_dom_value_map_value(&item, &key);
-      if (!field)
+
+      if (secondary)
+      {
+         if (!field || key_type_of(field) != (int)*key_type)
+            goto next;
+      }
+      else if (!field)
       {
          rv = -EINVAL;
          printf("field not found in item\n");
          goto clean;
       }
-      if (field->type != RDT_BINARY)
+      else if (field->type != RDT_BINARY)
       {
          rv = -EINVAL;
          printf("field is not binary\n");
          goto clean;
       }
-
-      if (field->binary.len == 0)
+      else if (field->binary.len == 0 || field->binary.len > 0xff)
       {
          rv = -EINVAL;
-         printf("field is empty\n");
+         printf("field is empty or too long\n");
          goto clean;
       }
-
-      if (field_size == 0)
+      else if (field_size == 0)
+      {
          field_size = field->binary.len;
+         node_size = field_size + sizeof(uint64_t);
+      }
       else if (field->binary.len != field_size)
       {
          rv = -EINVAL;
@@ -347,49 +826,1375 @@ int rarchdb_create_index(struct rarchdb *db, const char* name, const char *field
          goto clean;
       }
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if(!buff)
+      if (n == cap)
       {
-         rv = -ENOMEM;
-         goto clean;
+         uint8_t *grown;
+
+         cap = cap ? cap * 2 : (db->count > 64 ? db->count : 64);
+         grown = (uint8_t*)realloc(buff, cap * node_size);
+         if (!grown)
+         {
+            rv = -ENOMEM;
+            goto clean;
+         }
+         buff = grown;
       }
 
-      memcpy(buff, field->binary.buff, field_size);
-	  buff_u64 = (uint64_t*)buff + field_size;
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+      encode_key(*key_type, field_size, field, buff + n * node_size);
+      memcpy(buff + n * node_size + field_size, &item_loc, sizeof(uint64_t));
+      n++;
 
-      if (bintree_insert(&tree, buff) != 0)
-      {
-         printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
-         printf("\n");
-         rv = -EINVAL;
-         goto clean;
-      }
-      buff = NULL;
-      rmsgpack_dom_value_free(&item);
+next:
+      rmsgpack_dom_arena_reset(&arena);
       item_loc = rarchdb_tell(db);
    }
 
-   (void)rv;
-   (void)idx_header_offset;
+clean:
+   rmsgpack_dom_arena_free(&arena);
+   rarchdb_read_reset(db);
+
+   if (rv < 0 || n == 0)
+   {
+      free(buff);
+      return rv < 0 ? rv : -EINVAL;
+   }
+
+   *nodes = buff;
+   *count = n;
+   *key_size = field_size;
+   return 0;
+}
 
-   idx_header_offset = lseek(db->fd, 0, SEEK_END);
-   strncpy(idx.name, name, 50);
+static int write_all(int fd, const void *buff, uint64_t size)
+{
+   uint64_t written = 0;
 
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next = db->count * (field_size + sizeof(uint64_t));
-   rarchdb_write_index_header(db->fd, &idx);
+   while (written < size)
+   {
+      ssize_t rv = write(fd, (const uint8_t*)buff + written, size - written);
+      if (rv <= 0)
+         return rv < 0 ? -errno : -EIO;
+      written += rv;
+   }
 
-   nictx.db = db;
-   nictx.idx = &idx;
-   bintree_iterate(&tree, node_iter, &nictx);
-   bintree_free(&tree);
-clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
-   rarchdb_read_reset(db);
    return 0;
 }
+
+/* Appends the index to fd. */
+static int write_index(int fd, struct rarchdb_index *idx,
+      const uint8_t *nodes)
+{
+   lseek(fd, 0, SEEK_END);
+   rarchdb_write_index_header(fd, idx);
+   return write_all(fd, nodes, idx->next);
+}
+
+static void init_index(struct rarchdb_index *idx, const char *name,
+      const char *field_name, uint8_t key_size, uint64_t key_type,
+      int secondary)
+{
+   memset(idx, 0, sizeof(*idx));
+   strncpy(idx->name, name, sizeof(idx->name) - 1);
+   strncpy(idx->field, field_name, sizeof(idx->field) - 1);
+   idx->key_size = key_size;
+   idx->key_type = key_type;
+   idx->secondary = secondary;
+}
+
+static int create_sorted_index(struct rarchdb *db, const char *name,
+      const char *field_name, int secondary)
+{
+   int rv;
+   uint64_t i, count, key_type;
+   size_t node_size;
+   uint8_t key_size;
+   struct rarchdb_index idx;
+   uint8_t *nodes = NULL, *tmp = NULL, *sorted;
+
+   if ((rv = collect_nodes(db, field_name, secondary,
+               &nodes, &count, &key_size, &key_type)) < 0)
+      return rv;
+
+   node_size = key_size + sizeof(uint64_t);
+   tmp = (uint8_t*)malloc(count * node_size);
+   if (!tmp)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
+
+   /* Stable, so items with the same key stay in file order. */
+   sorted = sort_nodes(nodes, tmp, count, node_size, key_size);
+
+   for (i = 1; i < count && !secondary; i++)
+   {
+      if (memcmp(sorted + (i - 1) * node_size, sorted + i * node_size,
+               key_size) == 0)
+      {
+         print_duplicate(sorted + i * node_size, key_size);
+         rv = -EINVAL;
+         goto clean;
+      }
+   }
+
+   init_index(&idx, name, field_name, key_size, key_type, secondary);
+   idx.next = count * node_size;
+
+   rv = write_index(db->fd, &idx, sorted);
+   rarchdb_read_reset(db);
+
+clean:
+   free(nodes);
+   free(tmp);
+   return rv;
+}
+
+int rarchdb_create_index(struct rarchdb *db, const char* name, const char *field_name)
+{
+   return create_sorted_index(db, name, field_name, 0);
+}
+
+int rarchdb_create_secondary_index(struct rarchdb *db, const char* name, const char *field_name)
+{
+   return create_sorted_index(db, name, field_name, 1);
+}
+
+/* Lays nodes out in a hash table, see hash_find(). */
+static int hash_nodes(const uint8_t *nodes, uint64_t count, uint8_t key_size,
+      uint8_t **table, uint64_t *buckets)
+{
+   uint64_t i;
+   size_t node_size = key_size + sizeof(uint64_t);
+
+   /* At most half full, so misses stop within a few slots. */
+   for (*buckets = 1; *buckets < count * 2; *buckets *= 2);
+
+   *table = (uint8_t*)calloc(*buckets, node_size);
+   if (!*table)
+      return -ENOMEM;
+
+   for (i = 0; i < count; i++)
+   {
+      const uint8_t *node = nodes + i * node_size;
+      uint64_t slot = hash_key(node, key_size) & (*buckets - 1);
+
+      for (;;)
+      {
+         uint64_t offset;
+         uint8_t *current = *table + slot * node_size;
+
+         memcpy(&offset, current + key_size, sizeof(uint64_t));
+         if (offset == 0)
+         {
+            memcpy(current, node, node_size);
+            break;
+         }
+
+         if (memcmp(current, node, key_size) == 0)
+         {
+            print_duplicate(node, key_size);
+            free(*table);
+            *table = NULL;
+            return -EINVAL;
+         }
+
+         slot = (slot + 1) & (*buckets - 1);
+      }
+   }
+
+   return 0;
+}
+
+int rarchdb_create_hash_index(struct rarchdb *db, const char* name, const char *field_name)
+{
+   int rv;
+   uint64_t count, key_type, buckets;
+   uint8_t key_size;
+   struct rarchdb_index idx;
+   uint8_t *nodes = NULL, *table = NULL;
+
+   if ((rv = collect_nodes(db, field_name, 0,
+               &nodes, &count, &key_size, &key_type)) < 0)
+      return rv;
+
+   if ((rv = hash_nodes(nodes, count, key_size, &table, &buckets)) < 0)
+      goto clean;
+
+   init_index(&idx, name, field_name, key_size, key_type, 0);
+   idx.next = buckets * (key_size + sizeof(uint64_t));
+   idx.buckets = buckets;
+
+   rv = write_index(db->fd, &idx, table);
+   rarchdb_read_reset(db);
+
+clean:
+   free(nodes);
+   free(table);
+   return rv;
+}
+
+enum query_op
+{
+   QUERY_EQ,
+   QUERY_NE,
+   QUERY_LT,
+   QUERY_LE,
+   QUERY_GT,
+   QUERY_GE
+};
+
+struct query_cond
+{
+   struct rmsgpack_dom_value field;
+   enum query_op op;
+   struct rmsgpack_dom_value value;
+};
+
+struct rarchdb_query
+{
+   unsigned count;
+   struct query_cond *conds;
+};
+
+static const char *query_skip_space(const char *p)
+{
+   while (isspace((unsigned char)*p))
+      p++;
+   return p;
+}
+
+static int query_is_ident(char c, int first)
+{
+   return c == '_' || isalpha((unsigned char)c)
+      || (!first && isdigit((unsigned char)c));
+}
+
+/* Case insensitive, and only as a whole word. */
+static const char *query_keyword(const char *p, const char *word)
+{
+   for (; *word; p++, word++)
+   {
+      if (tolower((unsigned char)*p) != *word)
+         return NULL;
+   }
+
+   return query_is_ident(*p, 0) ? NULL : p;
+}
+
+static int query_hex(char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return -1;
+}
+
+/* Returns where the value ends, or NULL. */
+static const char *query_parse_value(const char *p,
+      struct rmsgpack_dom_value *value, const char **error)
+{
+   const char *end;
+   uint32_t len = 0;
+   uint64_t number = 0;
+   int negative = 0;
+
+   if (*p == '"')
+   {
+      for (end = p + 1; *end != '"'; end++, len++)
+      {
+         if (*end == '\\' && (end[1] == '"' || end[1] == '\\'))
+            end++;
+         if (!*end)
+         {
+            *error = "Unterminated string";
+            return NULL;
+         }
+      }
+
+      value->string.buff = (char*)malloc(len + 1);
+      if (!value->string.buff)
+      {
+         *error = "Out of memory";
+         return NULL;
+      }
+      value->type = RDT_STRING;
+      value->string.len = len;
+
+      for (len = 0, p++; p < end; p++)
+      {
+         if (*p == '\\' && (p[1] == '"' || p[1] == '\\'))
+            p++;
+         value->string.buff[len++] = *p;
+      }
+      value->string.buff[len] = '\0';
+
+      return end + 1;
+   }
+
+   if ((*p == 'x' || *p == 'X') && p[1] == '\'')
+   {
+      for (end = p + 2; query_hex(*end) >= 0; end++)
+         len++;
+
+      if (*end != '\'' || len & 1)
+      {
+         *error = "Binaries are an even number of hex digits";
+         return NULL;
+      }
+
+      value->binary.buff = (char*)malloc(len / 2 + 1);
+      if (!value->binary.buff)
+      {
+         *error = "Out of memory";
+         return NULL;
+      }
+      value->type = RDT_BINARY;
+      value->binary.len = len / 2;
+
+      for (len = 0, p += 2; p < end; p += 2)
+         value->binary.buff[len++] = (char)(query_hex(p[0]) << 4 | query_hex(p[1]));
+
+      return end + 1;
+   }
+
+   if ((end = query_keyword(p, "true")) || (end = query_keyword(p, "false")))
+   {
+      value->type = RDT_BOOL;
+      value->bool_ = *p == 't' || *p == 'T';
+      return end;
+   }
+
+   if (*p == '-')
+   {
+      negative = 1;
+      p++;
+   }
+
+   if (!isdigit((unsigned char)*p))
+   {
+      *error = "Expected a value";
+      return NULL;
+   }
+
+   for (; isdigit((unsigned char)*p); p++)
+   {
+      if (number > (UINT64_MAX - (*p - '0')) / 10)
+      {
+         *error = "Number out of range";
+         return NULL;
+      }
+      number = number * 10 + (*p - '0');
+   }
+
+   if (query_is_ident(*p, 0))
+   {
+      *error = "Expected a value";
+      return NULL;
+   }
+
+   if (negative)
+   {
+      if (number > (uint64_t)INT64_MAX + 1)
+      {
+         *error = "Number out of range";
+         return NULL;
+      }
+      value->type = RDT_INT;
+      value->int_ = (int64_t)(0 - number);
+   }
+   else
+   {
+      value->type = RDT_UINT;
+      value->uint_ = number;
+   }
+
+   return p;
+}
+
+static const char *query_parse_op(const char *p, enum query_op *op)
+{
+   switch (*p)
+   {
+      case '=':
+         *op = QUERY_EQ;
+         return p[1] == '=' ? p + 2 : p + 1;
+      case '!':
+         *op = QUERY_NE;
+         return p[1] == '=' ? p + 2 : NULL;
+      case '<':
+         *op = p[1] == '=' ? QUERY_LE : QUERY_LT;
+         return p[1] == '=' ? p + 2 : p + 1;
+      case '>':
+         *op = p[1] == '=' ? QUERY_GE : QUERY_GT;
+         return p[1] == '=' ? p + 2 : p + 1;
+   }
+
+   return NULL;
+}
+
+struct rarchdb_query *rarchdb_query_compile(const char *query, const char **error)
+{
+   const char *p, *start;
+   struct query_cond *cond;
+   struct rarchdb_query *q = (struct rarchdb_query*)calloc(1, sizeof(*q));
+
+   if (!q)
+   {
+      *error = "Out of memory";
+      return NULL;
+   }
+
+   for (p = query_skip_space(query); *p; p = query_skip_space(p))
+   {
+      if (q->count)
+      {
+         if (!(p = query_keyword(p, "and")))
+         {
+            *error = "Expected \"and\"";
+            goto error;
+         }
+         p = query_skip_space(p);
+      }
+
+      cond = (struct query_cond*)realloc(q->conds,
+            (q->count + 1) * sizeof(*cond));
+      if (!cond)
+      {
+         *error = "Out of memory";
+         goto error;
+      }
+      q->conds = cond;
+      cond = &q->conds[q->count++];
+      memset(cond, 0, sizeof(*cond));
+
+      if (!query_is_ident(*p, 1))
+      {
+         *error = "Expected a field name";
+         goto error;
+      }
+
+      for (start = p; query_is_ident(*p, 0); p++);
+
+      cond->field.string.buff = (char*)malloc(p - start + 1);
+      if (!cond->field.string.buff)
+      {
+         *error = "Out of memory";
+         goto error;
+      }
+      cond->field.type = RDT_STRING;
+      cond->field.string.len = p - start;
+      memcpy(cond->field.string.buff, start, p - start);
+      cond->field.string.buff[p - start] = '\0';
+
+      if (!(p = query_parse_op(query_skip_space(p), &cond->op)))
+      {
+         *error = "Expected =, !=, <, <=, > or >=";
+         goto error;
+      }
+
+      if (!(p = query_parse_value(query_skip_space(p), &cond->value, error)))
+         goto error;
+   }
+
+   return q;
+
+error:
+   rarchdb_query_free(q);
+   return NULL;
+}
+
+void rarchdb_query_free(struct rarchdb_query *query)
+{
+   unsigned i;
+
+   if (!query)
+      return;
+
+   for (i = 0; i < query->count; i++)
+   {
+      rmsgpack_dom_value_free(&query->conds[i].field);
+      rmsgpack_dom_value_free(&query->conds[i].value);
+   }
+
+   free(query->conds);
+   free(query);
+}
+
+/* Sets *cmp to below, at or above 0 as a is less than, equal to or
+ * more than b. Returns -1 for values that do not compare. */
+static int query_compare(const struct rmsgpack_dom_value *a,
+      const struct rmsgpack_dom_value *b, int *cmp)
+{
+   int type = key_type_of(a);
+
+   if (type < 0 || type != key_type_of(b))
+      return -1;
+
+   if (type == RARCHDB_KEY_BYTES)
+   {
+      uint32_t len = a->string.len < b->string.len ?
+         a->string.len : b->string.len;
+
+      *cmp = memcmp(a->string.buff, b->string.buff, len);
+      if (*cmp == 0)
+         *cmp = (a->string.len > b->string.len) - (a->string.len < b->string.len);
+   }
+   else
+   {
+      int a_neg = a->type == RDT_INT && a->int_ < 0;
+      int b_neg = b->type == RDT_INT && b->int_ < 0;
+      uint64_t a_val = a->type == RDT_BOOL ? a->bool_ != 0 : a->uint_;
+      uint64_t b_val = b->type == RDT_BOOL ? b->bool_ != 0 : b->uint_;
+
+      /* Two's complement compares right unsigned within a sign. */
+      if (a_neg != b_neg)
+         *cmp = a_neg ? -1 : 1;
+      else
+         *cmp = (a_val > b_val) - (a_val < b_val);
+   }
+
+   return 0;
+}
+
+static int query_cond_match(const struct query_cond *cond,
+      const struct rmsgpack_dom_value *item)
+{
+   int cmp;
+   const struct rmsgpack_dom_value *value =
+      rmsgpack_dom_value_map_value(item, &cond->field);
+
+   if (!value || query_compare(value, &cond->value, &cmp) < 0)
+      return 0;
+
+   switch (cond->op)
+   {
+      case QUERY_EQ:
+         return cmp == 0;
+      case QUERY_NE:
+         return cmp != 0;
+      case QUERY_LT:
+         return cmp < 0;
+      case QUERY_LE:
+         return cmp <= 0;
+      case QUERY_GT:
+         return cmp > 0;
+      case QUERY_GE:
+         return cmp >= 0;
+   }
+
+   return 0;
+}
+
+int rarchdb_query_match(const struct rarchdb_query *query,
+      const struct rmsgpack_dom_value *item)
+{
+   unsigned i;
+
+   for (i = 0; i < query->count; i++)
+   {
+      if (!query_cond_match(&query->conds[i], item))
+         return 0;
+   }
+
+   return 1;
+}
+
+/* Items an index leaves for a query: nodes begin to end of a sorted
+ * one, or the one item a hash index found. */
+struct query_range
+{
+   struct rarchdb_lookup lookup;
+   uint64_t begin;
+   uint64_t end;
+   uint64_t offset;
+};
+
+static uint64_t query_range_offset(const struct query_range *range, uint64_t i)
+{
+   uint64_t offset;
+
+   if (range->lookup.buckets)
+      return range->offset;
+
+   memcpy(&offset, range->lookup.nodes + (range->begin + i) *
+         (range->lookup.key_size + sizeof(uint64_t)) +
+         range->lookup.key_size, sizeof(uint64_t));
+   return offset;
+}
+
+/* First node not below key, or with upper set, first node above it. */
+static uint64_t query_bound(const struct rarchdb_lookup *lookup,
+      const uint8_t *key, int upper)
+{
+   uint64_t low = 0, high = lookup->count;
+   size_t item_size = lookup->key_size + sizeof(uint64_t);
+
+   while (low < high)
+   {
+      uint64_t mid = low + (high - low) / 2;
+      int rv = memcmp(lookup->nodes + mid * item_size, key, lookup->key_size);
+
+      if (rv < 0 || (upper && rv == 0))
+         low = mid + 1;
+      else
+         high = mid;
+   }
+
+   return low;
+}
+
+static int query_on_field(const struct query_cond *cond,
+      const struct rarchdb_index *idx)
+{
+   return cond->field.string.len == strlen(idx->field)
+      && memcmp(cond->field.string.buff, idx->field, cond->field.string.len) == 0;
+}
+
+/* Returns 1 with range set up if idx narrows the query down. */
+static int query_index_range(struct rarchdb *db,
+      const struct rarchdb_query *query, const struct rarchdb_index *idx,
+      struct query_range *range)
+{
+   unsigned i;
+   uint8_t key[0xff], lo[0xff], hi[0xff];
+   int has_lo = 0, has_hi = 0, usable = 0;
+
+   for (i = 0; i < query->count; i++)
+   {
+      const struct query_cond *cond = &query->conds[i];
+
+      if (query_on_field(cond, idx) && cond->op != QUERY_NE
+            && (cond->op == QUERY_EQ || !idx->buckets)
+            && key_type_of(&cond->value) == (int)idx->key_type)
+         usable = 1;
+   }
+
+   if (!usable || rarchdb_lookup_open(db, idx->name, &range->lookup) != 0)
+      return 0;
+
+   for (i = 0; i < query->count; i++)
+   {
+      const struct query_cond *cond = &query->conds[i];
+      enum query_op op = cond->op;
+
+      if (!query_on_field(cond, idx) || op == QUERY_NE
+            || encode_key(range->lookup.key_type,
+               (uint8_t)range->lookup.key_size, &cond->value, key) < 0)
+         continue;
+
+      /* Hash indexes only find the one value. */
+      if (range->lookup.buckets && op != QUERY_EQ)
+         continue;
+
+      if ((op == QUERY_EQ || op == QUERY_GT || op == QUERY_GE)
+            && (!has_lo || memcmp(key, lo, range->lookup.key_size) > 0))
+      {
+         memcpy(lo, key, range->lookup.key_size);
+         has_lo = 1;
+      }
+
+      if ((op == QUERY_EQ || op == QUERY_LT || op == QUERY_LE)
+            && (!has_hi || memcmp(key, hi, range->lookup.key_size) < 0))
+      {
+         memcpy(hi, key, range->lookup.key_size);
+         has_hi = 1;
+      }
+   }
+
+   if (range->lookup.buckets)
+   {
+      if (!has_lo)
+      {
+         rarchdb_lookup_close(&range->lookup);
+         return 0;
+      }
+
+      range->begin = 0;
+      range->end = rarchdb_lookup_find(&range->lookup, lo, &range->offset) == 0;
+      return 1;
+   }
+
+   /* Bounds are inclusive, cut keys can tie with values the
+    * query rules out, so matching leaves those out. */
+   range->begin = has_lo ? query_bound(&range->lookup, lo, 0) : 0;
+   range->end = has_hi ? query_bound(&range->lookup, hi, 1) : range->lookup.count;
+   if (range->end < range->begin)
+      range->end = range->begin;
+
+   return 1;
+}
+
+static int rarchdb_list_indexes(struct rarchdb *db,
+      struct rarchdb_index **indexes, unsigned *count)
+{
+   struct rarchdb_index *list = NULL, *grown;
+   unsigned n = 0;
+   off_t eof = lseek(db->fd, 0, SEEK_END);
+   off_t offset = lseek(db->fd, db->first_index_offset, SEEK_SET);
+
+   while (offset < eof)
+   {
+      grown = (struct rarchdb_index*)realloc(list, (n + 1) * sizeof(*list));
+      if (!grown)
+      {
+         free(list);
+         rarchdb_read_reset(db);
+         return -ENOMEM;
+      }
+      list = grown;
+
+      if (rarchdb_read_index_header(db->fd, &list[n]) < 0)
+         break;
+      offset = lseek(db->fd, list[n].next, SEEK_CUR);
+      n++;
+   }
+
+   rarchdb_read_reset(db);
+   *indexes = list;
+   *count = n;
+   return 0;
+}
+
+static int query_offset_cmp(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+int rarchdb_cursor_open(struct rarchdb *db, const struct rarchdb_query *query,
+      struct rarchdb_cursor *cursor)
+{
+   int rv = 0;
+   unsigned i, count, ranges = 0;
+   uint64_t j, n;
+   uint64_t *offsets;
+   uint8_t *keep;
+   struct rarchdb_index *indexes = NULL;
+   struct query_range *range = NULL, best;
+
+   memset(cursor, 0, sizeof(*cursor));
+   cursor->db = db;
+   cursor->query = query;
+   cursor->pos = db->root + sizeof(struct rarchdb_header);
+   rmsgpack_dom_arena_init(&cursor->arena);
+
+   if (!query->count)
+      return 0;
+
+   if ((rv = rarchdb_list_indexes(db, &indexes, &count)) < 0)
+      return rv;
+
+   range = (struct query_range*)calloc(count ? count : 1, sizeof(*range));
+   if (!range)
+   {
+      free(indexes);
+      return -ENOMEM;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      if (query_index_range(db, query, &indexes[i], &range[ranges]))
+         ranges++;
+   }
+   free(indexes);
+
+   if (!ranges)
+      goto end;
+
+   /* Smallest range first, it is what the others get checked against. */
+   for (i = 1; i < ranges; i++)
+   {
+      if (range[i].end - range[i].begin < range[0].end - range[0].begin)
+      {
+         best = range[0];
+         range[0] = range[i];
+         range[i] = best;
+      }
+   }
+
+   n = range[0].end - range[0].begin;
+   offsets = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+   if (!offsets)
+   {
+      rv = -ENOMEM;
+      goto end;
+   }
+
+   for (j = 0; j < n; j++)
+      offsets[j] = query_range_offset(&range[0], j);
+   qsort(offsets, n, sizeof(uint64_t), query_offset_cmp);
+
+   /* Going through another range costs a search of the offsets left per
+    * node, reading them costs a parse each, so only ranges not much
+    * bigger than what is left are worth it. */
+   for (i = 1; i < ranges && n; i++)
+   {
+      uint64_t size = range[i].end - range[i].begin, left = 0;
+
+      if (size > n * 4 || !(keep = (uint8_t*)calloc(n, 1)))
+         continue;
+
+      for (j = 0; j < size; j++)
+      {
+         uint64_t offset = query_range_offset(&range[i], j);
+         uint64_t *found = (uint64_t*)bsearch(&offset, offsets, n,
+               sizeof(uint64_t), query_offset_cmp);
+
+         if (found)
+            keep[found - offsets] = 1;
+      }
+
+      for (j = 0; j < n; j++)
+      {
+         if (keep[j])
+            offsets[left++] = offsets[j];
+      }
+
+      free(keep);
+      n = left;
+   }
+
+   cursor->offsets = offsets;
+   cursor->count = n;
+   cursor->pos = 0;
+
+end:
+   for (i = 0; i < ranges; i++)
+      rarchdb_lookup_close(&range[i].lookup);
+   free(range);
+   return rv;
+}
+
+int rarchdb_cursor_next(struct rarchdb_cursor *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   uint64_t offset;
+   struct rarchdb *db = cursor->db;
+
+   while (!cursor->eof)
+   {
+      if (cursor->offsets)
+      {
+         if (cursor->pos >= cursor->count)
+            break;
+         offset = cursor->offsets[cursor->pos++];
+      }
+      else
+         offset = cursor->pos;
+
+      if (offset >= db->size)
+         return -EINVAL;
+
+      rmsgpack_dom_arena_reset(&cursor->arena);
+      rv = rmsgpack_dom_parse(db->data + offset, db->size - offset,
+            &cursor->arena, out);
+      if (rv < 0)
+         return rv;
+
+      if (!cursor->offsets)
+      {
+         cursor->pos += rv;
+         if (out->type == RDT_NULL)
+            break;
+      }
+
+      if (rarchdb_query_match(cursor->query, out))
+         return 0;
+   }
+
+   cursor->eof = 1;
+   return EOF;
+}
+
+void rarchdb_cursor_close(struct rarchdb_cursor *cursor)
+{
+   free(cursor->offsets);
+   rmsgpack_dom_arena_free(&cursor->arena);
+   memset(cursor, 0, sizeof(*cursor));
+}
+
+struct offset_list
+{
+   uint64_t *offsets;
+   uint64_t count;
+   uint64_t cap;
+};
+
+static int offset_list_push(struct offset_list *list, uint64_t offset)
+{
+   if (list->count == list->cap)
+   {
+      uint64_t cap = list->cap ? list->cap * 2 : 64;
+      uint64_t *grown = (uint64_t*)realloc(list->offsets,
+            cap * sizeof(uint64_t));
+
+      if (!grown)
+         return -ENOMEM;
+      list->offsets = grown;
+      list->cap = cap;
+   }
+
+   list->offsets[list->count++] = offset;
+   return 0;
+}
+
+/* Opens the index rarchdb_update() finds items to change by, or sorts
+ * one in memory if the db has none on key_field. */
+static int update_key_lookup(struct rarchdb *db, const char *key_field,
+      struct rarchdb_lookup *lookup)
+{
+   int rv, best = -1;
+   unsigned i, count;
+   uint8_t key_size, *nodes = NULL, *tmp, *sorted;
+   uint64_t n, key_type;
+   struct rarchdb_index *indexes;
+
+   if ((rv = rarchdb_list_indexes(db, &indexes, &count)) < 0)
+      return rv;
+
+   /* Hash indexes find one item, sorted ones a range. */
+   for (i = 0; i < count; i++)
+   {
+      if (strcmp(indexes[i].field, key_field) != 0)
+         continue;
+      if (best < 0 || indexes[i].buckets
+            || (!indexes[i].secondary && !indexes[best].buckets))
+         best = i;
+   }
+
+   if (best >= 0)
+   {
+      rv = rarchdb_lookup_open(db, indexes[best].name, lookup);
+      free(indexes);
+      return rv < 0 ? rv : rv ? -EINVAL : 0;
+   }
+   free(indexes);
+
+   memset(lookup, 0, sizeof(*lookup));
+   lookup->key_size = 1;
+
+   /* No item has it, so none can change. */
+   if (collect_nodes(db, key_field, 1, &nodes, &n, &key_size, &key_type) < 0)
+      return 0;
+
+   tmp = (uint8_t*)malloc(n * (key_size + sizeof(uint64_t)));
+   if (!tmp)
+   {
+      free(nodes);
+      return -ENOMEM;
+   }
+
+   sorted = sort_nodes(nodes, tmp, n, key_size + sizeof(uint64_t), key_size);
+   free(sorted == nodes ? tmp : nodes);
+
+   lookup->count = n;
+   lookup->key_size = key_size;
+   lookup->key_type = key_type;
+   lookup->nodes = sorted;
+   lookup->owned = 1;
+   return 0;
+}
+
+/* Sets matches to the items with value as their key_field. */
+static int update_matches(struct rarchdb *db,
+      const struct rarchdb_lookup *lookup, const struct rmsgpack_dom_value *key,
+      const struct rmsgpack_dom_value *value, struct rmsgpack_dom_arena *arena,
+      struct offset_list *matches)
+{
+   int rv, cmp;
+   uint8_t encoded[0xff];
+   uint64_t i, begin = 0, end = 0, offset;
+   struct rmsgpack_dom_value item;
+   const struct rmsgpack_dom_value *field;
+
+   matches->count = 0;
+
+   if (!lookup->count || encode_key(lookup->key_type,
+            (uint8_t)lookup->key_size, value, encoded) < 0)
+      return 0;
+
+   if (lookup->buckets)
+      end = rarchdb_lookup_find(lookup, encoded, &offset) == 0;
+   else
+   {
+      begin = query_bound(lookup, encoded, 0);
+      end = query_bound(lookup, encoded, 1);
+   }
+
+   /* Keys can be cut, the item has the final say. */
+   for (i = begin; i < end; i++)
+   {
+      if (!lookup->buckets)
+         memcpy(&offset, lookup->nodes + i * (lookup->key_size +
+                  sizeof(uint64_t)) + lookup->key_size, sizeof(uint64_t));
+
+      rmsgpack_dom_arena_reset(arena);
+      if (offset >= db->size || rmsgpack_dom_parse(db->data + offset,
+               db->size - offset, arena, &item) < 0)
+         return -EINVAL;
+
+      field = rmsgpack_dom_value_map_value(&item, key);
+      if (field && query_compare(field, value, &cmp) == 0 && cmp == 0
+            && (rv = offset_list_push(matches, offset)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+/* Where an item the update keeps ends up in the new file. shift[k] is
+ * the size of the first k removed items. */
+static int update_remap(const struct rarchdb *db,
+      const struct offset_list *removed, const uint64_t *shift,
+      uint64_t offset, uint64_t *remapped)
+{
+   uint64_t low = 0, high = removed->count;
+
+   while (low < high)
+   {
+      uint64_t mid = low + (high - low) / 2;
+      if (removed->offsets[mid] < offset)
+         low = mid + 1;
+      else
+         high = mid;
+   }
+
+   if (low < removed->count && removed->offsets[low] == offset)
+      return -1;
+
+   *remapped = offset - db->root - shift[low];
+   return 0;
+}
+
+/* Appends idx to fd with the nodes of kept items moved to where they
+ * are now, and the nodes of added ones merged in. */
+static int update_index(struct rarchdb *db, int fd,
+      const struct rarchdb_index *idx, const struct offset_list *removed,
+      const uint64_t *shift, const struct rmsgpack_dom_value *changes,
+      const uint64_t *change_offsets, uint64_t change_count)
+{
+   int rv;
+   uint8_t key_size;
+   size_t node_size;
+   uint64_t i, slots, offset, n_old = 0, n_new = 0;
+   uint64_t o = 0, a = 0, n = 0;
+   struct rarchdb_lookup lookup;
+   struct rarchdb_index out = *idx;
+   struct rmsgpack_dom_value key;
+   const struct rmsgpack_dom_value *field;
+   uint8_t *nodes = NULL, *added, *tmp = NULL, *merged = NULL, *sorted;
+
+   if ((rv = rarchdb_lookup_open(db, idx->name, &lookup)) != 0)
+      return rv < 0 ? rv : -EINVAL;
+
+   key_size = (uint8_t)lookup.key_size;
+   node_size = key_size + sizeof(uint64_t);
+   slots = lookup.buckets ? lookup.buckets : lookup.count;
+
+   /* Added nodes go right after the kept ones. */
+   nodes = (uint8_t*)malloc((slots + change_count + 1) * node_size);
+   tmp = (uint8_t*)malloc((change_count + 1) * node_size);
+   if (!nodes || !tmp)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
+
+   for (i = 0; i < slots; i++)
+   {
+      const uint8_t *node = lookup.nodes + i * node_size;
+
+      memcpy(&offset, node + key_size, sizeof(uint64_t));
+      if ((lookup.buckets && offset == 0)
+            || update_remap(db, removed, shift, offset, &offset) < 0)
+         continue;
+
+      memcpy(nodes + n_old * node_size, node, key_size);
+      memcpy(nodes + n_old * node_size + key_size, &offset, sizeof(uint64_t));
+      n_old++;
+   }
+
+   key.type = RDT_STRING;
+   key.string.len = strlen(idx->field);
+   key.string.buff = (char*)idx->field;
+   added = nodes + n_old * node_size;
+
+   for (i = 0; i < change_count; i++)
+   {
+      uint8_t *node = added + n_new * node_size;
+
+      field = rmsgpack_dom_value_map_value(&changes[i], &key);
+
+      if (!idx->secondary && (!field || field->type != RDT_BINARY
+               || field->binary.len != key_size))
+      {
+         printf("field %s of an item is not a binary of %u bytes\n",
+               idx->field, (unsigned)key_size);
+         rv = -EINVAL;
+         goto clean;
+      }
+
+      if (!field || encode_key(lookup.key_type, key_size, field, node) < 0)
+         continue;
+
+      memcpy(node + key_size, &change_offsets[i], sizeof(uint64_t));
+      n_new++;
+   }
+
+   if (lookup.buckets)
+   {
+      if ((rv = hash_nodes(nodes, n_old + n_new, key_size,
+                  &merged, &out.buckets)) < 0)
+         goto clean;
+      out.next = out.buckets * node_size;
+      rv = write_index(fd, &out, merged);
+      goto clean;
+   }
+
+   merged = (uint8_t*)malloc((n_old + n_new + 1) * node_size);
+   if (!merged)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
+
+   /* Kept nodes are still in order, added ones come after them in
+    * the file so they go after them on ties too. */
+   sorted = sort_nodes(added, tmp, n_new, node_size, key_size);
+
+   while (o < n_old || a < n_new)
+   {
+      const uint8_t *node;
+
+      if (a == n_new || (o < n_old && memcmp(nodes + o * node_size,
+                  sorted + a * node_size, key_size) <= 0))
+         node = nodes + o++ * node_size;
+      else
+         node = sorted + a++ * node_size;
+
+      if (!idx->secondary && n &&
+            memcmp(merged + (n - 1) * node_size, node, key_size) == 0)
+      {
+         print_duplicate(node, key_size);
+         rv = -EINVAL;
+         goto clean;
+      }
+
+      memcpy(merged + n++ * node_size, node, node_size);
+   }
+
+   out.next = n * node_size;
+   rv = write_index(fd, &out, merged);
+
+clean:
+   rarchdb_lookup_close(&lookup);
+   free(nodes);
+   free(tmp);
+   free(merged);
+   return rv;
+}
+
+int rarchdb_update(struct rarchdb *db, const char *path, const char *key_field,
+      rarchdb_value_provider value_provider, void *ctx)
+{
+   int rv, fd = -1;
+   unsigned i, index_count = 0;
+   uint64_t j, n, pos, items_start, items_end, unchanged = 0;
+   uint64_t change_count = 0, change_cap = 0;
+   uint64_t *shift = NULL, *change_offsets = NULL;
+   struct rarchdb_lookup lookup;
+   struct rarchdb_header header = {};
+   struct rarchdb_metadata md;
+   struct rarchdb_index *indexes = NULL;
+   struct rmsgpack_dom_value key, item, old;
+   const struct rmsgpack_dom_value *value;
+   struct rmsgpack_dom_value *changes = NULL;
+   struct rmsgpack_dom_arena arena;
+   struct offset_list matches = {0}, removed = {0};
+
+   items_start = db->root + sizeof(struct rarchdb_header);
+   items_end = db->metadata_offset - 1;
+   if (db->metadata_offset <= items_start || db->metadata_offset > db->size
+         || db->data[items_end] != 0xc0)
+      return -EINVAL;
+
+   if ((rv = update_key_lookup(db, key_field, &lookup)) < 0)
+      return rv;
+
+   rmsgpack_dom_arena_init(&arena);
+   key.type = RDT_STRING;
+   key.string.len = strlen(key_field);
+   key.string.buff = (char*)key_field;
+
+   while ((rv = value_provider(ctx, &item)) == 0)
+   {
+      value = item.type == RDT_MAP ?
+         rmsgpack_dom_value_map_value(&item, &key) : &item;
+
+      if (!value)
+      {
+         printf("item has no %s\n", key_field);
+         rmsgpack_dom_value_free(&item);
+         rv = -EINVAL;
+         goto clean;
+      }
+
+      if ((rv = update_matches(db, &lookup, &key, value, &arena, &matches)) < 0)
+      {
+         rmsgpack_dom_value_free(&item);
+         goto clean;
+      }
+
+      if (item.type == RDT_MAP && matches.count == 1
+            && rmsgpack_dom_parse(db->data + matches.offsets[0],
+               db->size - matches.offsets[0], &arena, &old) > 0
+            && rmsgpack_dom_value_cmp(&old, &item) == 0)
+      {
+         unchanged++;
+         rmsgpack_dom_value_free(&item);
+         continue;
+      }
+
+      for (j = 0; j < matches.count; j++)
+      {
+         if ((rv = offset_list_push(&removed, matches.offsets[j])) < 0)
+         {
+            rmsgpack_dom_value_free(&item);
+            goto clean;
+         }
+      }
+
+      if (item.type != RDT_MAP)
+      {
+         rmsgpack_dom_value_free(&item);
+         continue;
+      }
+
+      if (change_count == change_cap)
+      {
+         struct rmsgpack_dom_value *grown;
+
+         change_cap = change_cap ? change_cap * 2 : 64;
+         grown = (struct rmsgpack_dom_value*)realloc(changes,
+               change_cap * sizeof(*changes));
+         if (!grown)
+         {
+            rmsgpack_dom_value_free(&item);
+            rv = -ENOMEM;
+            goto clean;
+         }
+         changes = grown;
+      }
+
+      changes[change_count++] = item;
+   }
+
+   if (rv < 0)
+      goto clean;
+
+   /* An item can be matched by more than one change. */
+   if (removed.count)
+      qsort(removed.offsets, removed.count, sizeof(uint64_t), query_offset_cmp);
+   for (j = 0, n = 0; j < removed.count; j++)
+   {
+      if (!n || removed.offsets[n - 1] != removed.offsets[j])
+         removed.offsets[n++] = removed.offsets[j];
+   }
+   removed.count = n;
+
+   shift = (uint64_t*)malloc((removed.count + 1) * sizeof(uint64_t));
+   change_offsets = (uint64_t*)malloc((change_count + 1) * sizeof(uint64_t));
+   if (!shift || !change_offsets)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
+
+   shift[0] = 0;
+   for (j = 0; j < removed.count; j++)
+   {
+      rmsgpack_dom_arena_reset(&arena);
+      rv = rmsgpack_dom_parse(db->data + removed.offsets[j],
+            db->size - removed.offsets[j], &arena, &old);
+      if (rv < 0)
+         goto clean;
+      shift[j + 1] = shift[j] + rv;
+   }
+
+   fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0644);
+   if (fd < 0)
+   {
+      rv = -errno;
+      goto clean;
+   }
+
+   /* Kept items are copied as they are, in between the removed ones. */
+   lseek(fd, sizeof(struct rarchdb_header), SEEK_SET);
+   for (j = 0, pos = items_start; j <= removed.count; j++)
+   {
+      uint64_t end = j < removed.count ? removed.offsets[j] : items_end;
+
+      if ((rv = write_all(fd, db->data + pos, end - pos)) < 0)
+         goto clean;
+      if (j < removed.count)
+         pos = end + shift[j + 1] - shift[j];
+   }
+
+   for (j = 0; j < change_count; j++)
+   {
+      change_offsets[j] = lseek(fd, 0, SEEK_CUR);
+      if ((rv = rmsgpack_dom_write(fd, &changes[j])) < 0)
+         goto clean;
+   }
+
+   if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
+      goto clean;
+
+   header.metadata_offset = httobe64(lseek(fd, 0, SEEK_CUR));
+   md.count = db->count - removed.count + change_count;
+   rarchdb_write_metadata(fd, &md);
+
+   if ((rv = rarchdb_list_indexes(db, &indexes, &index_count)) < 0)
+      goto clean;
+
+   for (i = 0; i < index_count; i++)
+   {
+      if ((rv = update_index(db, fd, &indexes[i], &removed, shift,
+                  changes, change_offsets, change_count)) < 0)
+         goto clean;
+   }
+
+   memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
+   lseek(fd, 0, SEEK_SET);
+   if ((rv = write_all(fd, &header, sizeof(header))) < 0)
+      goto clean;
+
+   printf(
+#ifdef _WIN32
+   "Updated DB: %I64u added, %I64u removed, %I64u unchanged\n"
+#else
+   "Updated DB: %llu added, %llu removed, %llu unchanged\n"
+#endif
+   ,(unsigned long long)change_count, (unsigned long long)removed.count,
+   (unsigned long long)unchanged);
+
+clean:
+   if (fd >= 0 && close(fd) != 0 && rv >= 0)
+      rv = -errno;
+   for (j = 0; j < change_count; j++)
+      rmsgpack_dom_value_free(&changes[j]);
+   free(changes);
+   free(change_offsets);
+   free(shift);
+   free(indexes);
+   free(matches.offsets);
+   free(removed.offsets);
+   rmsgpack_dom_arena_free(&arena);
+   rarchdb_lookup_close(&lookup);
+   rarchdb_read_reset(db);
+   return rv < 0 ? rv : 0;
+}
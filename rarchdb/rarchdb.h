@@ -9,22 +9,111 @@ struct rarchdb {
 	int eof;
 	uint64_t root;
 	uint64_t count;
+	uint64_t metadata_offset;
 	uint64_t first_index_offset;
+	/* The whole file, mapped, or read in where it cannot be. */
+	const uint8_t *data;
+	uint64_t size;
+	int mapped;
 };
 
 
+/* How index keys are laid out, see rarchdb_create_secondary_index(). */
+enum rarchdb_key_type {
+	RARCHDB_KEY_BYTES = 0,
+	RARCHDB_KEY_NUMBER
+};
+
+/* An index read into memory, for looking up many keys
+ * without reading it again each time. */
+struct rarchdb_lookup {
+	uint64_t count;
+	uint64_t key_size;
+	uint64_t key_type;
+	/* Slots of a hash index, 0 for a sorted one. */
+	uint64_t buckets;
+	const uint8_t *nodes;
+	/* Nodes were read in, rather than pointing into the file. */
+	int owned;
+};
+
 typedef int(*rarchdb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
 int rarchdb_create(int fd, rarchdb_value_provider value_provider, void *ctx);
+/* Writes db to path with the changes value_provider gives. A map replaces
+ * the items with the same key_field, or is added if there are none, and
+ * any other value removes the items that have it as key_field. Maps the
+ * same as the item they replace change nothing. Items left as they were
+ * are copied over, and indexes merged with the changes rather than built
+ * again. path cannot be the file db is open from. */
+int rarchdb_update(struct rarchdb *db, const char *path, const char *key_field,
+		rarchdb_value_provider value_provider, void *ctx);
 
 void rarchdb_close(struct rarchdb *db);
 int rarchdb_open(const char *path, struct rarchdb *db);
 
 int rarchdb_read_item(struct rarchdb *db, struct rmsgpack_dom_value *out);
+/* Like rarchdb_read_item(), but parses the item in place, see
+ * rmsgpack_dom_parse(). Resetting arena between items keeps
+ * iterating from allocating at all. */
+int rarchdb_read_item_view(struct rarchdb *db, struct rmsgpack_dom_arena *arena,
+		struct rmsgpack_dom_value *out);
 int rarchdb_read_reset(struct rarchdb *db);
 int rarchdb_create_index(struct rarchdb *db, const char* name, const char *field_name);
+/* Same as rarchdb_create_index(), but lookups hash the key instead of
+ * searching for it, which only suits exact matches like CRCs and digests. */
+int rarchdb_create_hash_index(struct rarchdb *db, const char* name, const char *field_name);
+/* Sorted index for queries, see rarchdb_query_compile(). Items can share a
+ * value or not have the field at all. Keys are numbers for fields that are
+ * numbers or booleans, and strings or binaries cut to 255 bytes otherwise. */
+int rarchdb_create_secondary_index(struct rarchdb *db, const char* name, const char *field_name);
 int rarchdb_find_entry(struct rarchdb *db, const char *index_name, const void *key);
 
+int rarchdb_lookup_open(struct rarchdb *db, const char *index_name, struct rarchdb_lookup *lookup);
+/* Sets offset to where the item is, for rarchdb_read_item() after seeking there. */
+int rarchdb_lookup_find(const struct rarchdb_lookup *lookup, const void *key, uint64_t *offset);
+void rarchdb_lookup_close(struct rarchdb_lookup *lookup);
+
 uint64_t rarchdb_tell(struct rarchdb *db);
 
+struct rarchdb_query;
+
+/* Compiles a query such as
+ *
+ *    publisher = "Nintendo" and year >= 1990 and year <= 1995
+ *
+ * which is any number of comparisons of a field against a value, joined
+ * by "and". Comparisons are =, !=, <, <=, > and >=. Values are numbers,
+ * "strings" with \" and \\ escapes, x'hex' binaries, true and false.
+ * Numbers and booleans compare with each other, and strings with
+ * binaries. Items without the field, or with a value it does not
+ * compare with, never match. An empty query matches everything.
+ * Returns NULL on failure, with error pointing at a message. */
+struct rarchdb_query *rarchdb_query_compile(const char *query, const char **error);
+void rarchdb_query_free(struct rarchdb_query *query);
+int rarchdb_query_match(const struct rarchdb_query *query, const struct rmsgpack_dom_value *item);
+
+/* Iterates over the items a query matches, in file order. */
+struct rarchdb_cursor {
+	struct rarchdb *db;
+	const struct rarchdb_query *query;
+	struct rmsgpack_dom_arena arena;
+	/* Where the items indexes narrowed the query down to are,
+	 * or NULL to go through all of them. */
+	uint64_t *offsets;
+	uint64_t count;
+	uint64_t pos;
+	int eof;
+};
+
+/* Uses every index whose field the query compares with to rule items
+ * out before reading them. query has to outlast the cursor. */
+int rarchdb_cursor_open(struct rarchdb *db, const struct rarchdb_query *query,
+		struct rarchdb_cursor *cursor);
+/* Parses the next match in place, see rarchdb_read_item_view(). It lasts
+ * until the next call. Returns 0, EOF after the last one, or a negative
+ * errno. */
+int rarchdb_cursor_next(struct rarchdb_cursor *cursor, struct rmsgpack_dom_value *out);
+void rarchdb_cursor_close(struct rarchdb_cursor *cursor);
+
 #endif
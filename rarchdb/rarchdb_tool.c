@@ -9,6 +9,12 @@ static int list_db(void)
 	return 0;
 }
 
+static int changes_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   int rv = rarchdb_read_item((struct rarchdb*)ctx, out);
+   return rv == EOF ? 1 : rv;
+}
+
 int main(int argc, char** argv)
 {
    int rv;
@@ -20,7 +26,11 @@ int main(int argc, char** argv)
       printf("Available Commands:\n");
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
+      printf("\tcreate-hash-index <index name> <field name>\n");
+      printf("\tcreate-secondary-index <index name> <field name>\n");
       printf("\tfind <index name> <value>\n");
+      printf("\tquery <query>\n");
+      printf("\tupdate <key field> <changes db file>\n");
       return 1;
    }
 
@@ -40,27 +50,116 @@ int main(int argc, char** argv)
          printf("Usage: %s <db file> list\n", argv[0]);
          return 1;
       }
-      while(rarchdb_read_item(&db, &item) == 0)
+      struct rmsgpack_dom_arena arena;
+
+      rmsgpack_dom_arena_init(&arena);
+      while(rarchdb_read_item_view(&db, &arena, &item) == 0)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
+         rmsgpack_dom_arena_reset(&arena);
       }
+      rmsgpack_dom_arena_free(&arena);
    }
-   else if (strcmp(command, "create-index") == 0)
+   else if (strcmp(command, "create-index") == 0
+         || strcmp(command, "create-hash-index") == 0
+         || strcmp(command, "create-secondary-index") == 0)
    {
       const char *index_name, *field_name;
 
       if (argc != 5)
       {
-         printf("Usage: %s <db file> create-index <index name> <field name>\n", argv[0]);
+         printf("Usage: %s <db file> %s <index name> <field name>\n", argv[0], command);
          return 1;
       }
 
       index_name = argv[3];
       field_name = argv[4];
 
-      rarchdb_create_index(&db, index_name, field_name);
+      if (strcmp(command, "create-index") == 0)
+         rv = rarchdb_create_index(&db, index_name, field_name);
+      else if (strcmp(command, "create-hash-index") == 0)
+         rv = rarchdb_create_hash_index(&db, index_name, field_name);
+      else
+         rv = rarchdb_create_secondary_index(&db, index_name, field_name);
+
+      if (rv < 0)
+      {
+         printf("Could not create index '%s': %s\n", index_name, strerror(-rv));
+         return 1;
+      }
+   }
+   else if (strcmp(command, "query") == 0)
+   {
+      const char *error = NULL;
+      struct rarchdb_query *query;
+      struct rarchdb_cursor cursor;
+
+      if (argc != 4)
+      {
+         printf("Usage: %s <db file> query <query>\n", argv[0]);
+         return 1;
+      }
+
+      query = rarchdb_query_compile(argv[3], &error);
+      if (!query)
+      {
+         printf("Could not compile query: %s\n", error);
+         return 1;
+      }
+
+      if ((rv = rarchdb_cursor_open(&db, query, &cursor)) < 0)
+      {
+         printf("Could not run query: %s\n", strerror(-rv));
+         rarchdb_query_free(query);
+         return 1;
+      }
+
+      while ((rv = rarchdb_cursor_next(&cursor, &item)) == 0)
+      {
+         rmsgpack_dom_value_print(&item);
+         printf("\n");
+      }
+
+      rarchdb_cursor_close(&cursor);
+      rarchdb_query_free(query);
+   }
+   else if (strcmp(command, "update") == 0)
+   {
+      char tmp_path[1024];
+      struct rarchdb changes;
+
+      if (argc != 5)
+      {
+         printf("Usage: %s <db file> update <key field> <changes db file>\n", argv[0]);
+         return 1;
+      }
+
+      if ((rv = rarchdb_open(argv[4], &changes)) != 0)
+      {
+         printf("Could not open db file '%s': %s\n", argv[4], strerror(-rv));
+         return 1;
+      }
+
+      snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+      rv = rarchdb_update(&db, tmp_path, argv[3], changes_provider, &changes);
+      rarchdb_close(&changes);
+
+      if (rv < 0)
+      {
+         printf("Could not update db file '%s': %s\n", path, strerror(-rv));
+         remove(tmp_path);
+         return 1;
+      }
+
+      /* Readers keep whichever file they have open. */
+      rarchdb_close(&db);
+      if (rename(tmp_path, path) != 0)
+      {
+         printf("Could not replace db file '%s'\n", path);
+         return 1;
+      }
+      return 0;
    }
    else if (strcmp(command, "find") == 0)
    {
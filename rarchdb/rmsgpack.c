@@ -564,3 +564,204 @@ int rmsgpack_read(int fd, struct rmsgpack_read_callbacks *callbacks, void *data)
 
    return 0;
 }
+
+/* Deep enough for any sane document, while keeping malicious
+ * files from running the stack out. */
+#define MAX_BUF_DEPTH 128
+
+struct rmsgpack_buf
+{
+   const uint8_t *pos;
+   const uint8_t *end;
+};
+
+static int buf_read_uint(struct rmsgpack_buf *b, size_t size, uint64_t *out)
+{
+   size_t i;
+
+   if ((size_t)(b->end - b->pos) < size)
+      return -EINVAL;
+
+   *out = 0;
+   for (i = 0; i < size; i++)
+      *out = (*out << 8) | *b->pos++;
+   return 0;
+}
+
+static int buf_read_int(struct rmsgpack_buf *b, size_t size, int64_t *out)
+{
+   uint64_t tmp;
+   int rv = buf_read_uint(b, size, &tmp);
+
+   if (rv < 0)
+      return rv;
+
+   /* Sign extends from the width it was stored with. */
+   if (size < 8 && (tmp & ((uint64_t)1 << (size * 8 - 1))))
+      tmp |= ~(uint64_t)0 << (size * 8);
+   *out = (int64_t)tmp;
+   return 0;
+}
+
+static int buf_read_view(struct rmsgpack_buf *b, uint64_t len,
+      const uint8_t **view)
+{
+   if ((uint64_t)(b->end - b->pos) < len)
+      return -EINVAL;
+
+   *view = b->pos;
+   b->pos += len;
+   return 0;
+}
+
+static int buf_read(struct rmsgpack_buf *b,
+      struct rmsgpack_read_callbacks *callbacks, void *data, unsigned depth);
+
+static int buf_read_map(struct rmsgpack_buf *b, uint64_t len,
+      struct rmsgpack_read_callbacks *callbacks, void *data, unsigned depth)
+{
+   int rv;
+   uint64_t i;
+
+   /* Every pair takes at least two bytes. */
+   if (len > (uint64_t)(b->end - b->pos) / 2)
+      return -EINVAL;
+
+   if (callbacks->read_map_start &&
+         (rv = callbacks->read_map_start(len, data)) < 0)
+      return rv;
+
+   for (i = 0; i < len * 2; i++)
+   {
+      if ((rv = buf_read(b, callbacks, data, depth + 1)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+static int buf_read_array(struct rmsgpack_buf *b, uint64_t len,
+      struct rmsgpack_read_callbacks *callbacks, void *data, unsigned depth)
+{
+   int rv;
+   uint64_t i;
+
+   if (len > (uint64_t)(b->end - b->pos))
+      return -EINVAL;
+
+   if (callbacks->read_array_start &&
+         (rv = callbacks->read_array_start(len, data)) < 0)
+      return rv;
+
+   for (i = 0; i < len; i++)
+   {
+      if ((rv = buf_read(b, callbacks, data, depth + 1)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+static int buf_read(struct rmsgpack_buf *b,
+      struct rmsgpack_read_callbacks *callbacks, void *data, unsigned depth)
+{
+   int rv;
+   uint8_t type;
+   uint64_t tmp_len    = 0;
+   uint64_t tmp_uint   = 0;
+   int64_t tmp_int     = 0;
+   const uint8_t *view = NULL;
+
+   if (depth > MAX_BUF_DEPTH || b->pos >= b->end)
+      return -EINVAL;
+
+   type = *b->pos++;
+
+   if (type < MPF_FIXMAP)
+      return callbacks->read_int ? callbacks->read_int(type, data) : 0;
+   else if (type < MPF_FIXARRAY)
+      return buf_read_map(b, type - MPF_FIXMAP, callbacks, data, depth);
+   else if (type < MPF_FIXSTR)
+      return buf_read_array(b, type - MPF_FIXARRAY, callbacks, data, depth);
+   else if (type < MPF_NIL)
+   {
+      tmp_len = type - MPF_FIXSTR;
+      if ((rv = buf_read_view(b, tmp_len, &view)) < 0)
+         return rv;
+      return callbacks->read_string ?
+         callbacks->read_string((char*)view, tmp_len, data) : 0;
+   }
+   else if (type > MPF_MAP32)
+      return callbacks->read_int ?
+         callbacks->read_int(type - 0xff - 1, data) : 0;
+
+   switch (type)
+   {
+      case 0xc0:
+         return callbacks->read_nil ? callbacks->read_nil(data) : 0;
+      case 0xc2:
+      case 0xc3:
+         return callbacks->read_bool ?
+            callbacks->read_bool(type == MPF_TRUE, data) : 0;
+      case 0xc4:
+      case 0xc5:
+      case 0xc6:
+         if ((rv = buf_read_uint(b, 1 << (type - MPF_BIN8), &tmp_len)) < 0
+               || (rv = buf_read_view(b, tmp_len, &view)) < 0)
+            return rv;
+         return callbacks->read_bin ?
+            callbacks->read_bin((void*)view, tmp_len, data) : 0;
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf:
+         if ((rv = buf_read_uint(b, 1 << (type - MPF_UINT8), &tmp_uint)) < 0)
+            return rv;
+         return callbacks->read_uint ?
+            callbacks->read_uint(tmp_uint, data) : 0;
+      case 0xd0:
+      case 0xd1:
+      case 0xd2:
+      case 0xd3:
+         if ((rv = buf_read_int(b, 1 << (type - MPF_INT8), &tmp_int)) < 0)
+            return rv;
+         return callbacks->read_int ?
+            callbacks->read_int(tmp_int, data) : 0;
+      case 0xd9:
+      case 0xda:
+      case 0xdb:
+         if ((rv = buf_read_uint(b, 1 << (type - MPF_STR8), &tmp_len)) < 0
+               || (rv = buf_read_view(b, tmp_len, &view)) < 0)
+            return rv;
+         return callbacks->read_string ?
+            callbacks->read_string((char*)view, tmp_len, data) : 0;
+      case 0xdc:
+      case 0xdd:
+         if ((rv = buf_read_uint(b, 2 << (type - MPF_ARRAY16), &tmp_len)) < 0)
+            return rv;
+         return buf_read_array(b, tmp_len, callbacks, data, depth);
+      case 0xde:
+      case 0xdf:
+         if ((rv = buf_read_uint(b, 2 << (type - MPF_MAP16), &tmp_len)) < 0)
+            return rv;
+         return buf_read_map(b, tmp_len, callbacks, data, depth);
+   }
+
+   /* Floats and extensions are not supported. */
+   return -EINVAL;
+}
+
+int rmsgpack_read_buf(const void *buff, size_t size,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   int rv;
+   struct rmsgpack_buf b;
+
+   b.pos = (const uint8_t*)buff;
+   b.end = b.pos + size;
+
+   if ((rv = buf_read(&b, callbacks, data, 0)) < 0)
+      return rv;
+
+   return (int)(b.pos - (const uint8_t*)buff);
+}
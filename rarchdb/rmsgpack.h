@@ -1,6 +1,7 @@
 #ifndef __RARCHDB_MSGPACK_H__
 #define __RARCHDB_MSGPACK_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct rmsgpack_read_callbacks {
@@ -26,5 +27,12 @@ int rmsgpack_write_uint(int fd, uint64_t value);
 
 int rmsgpack_read(int fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/* Reads a value out of memory instead of a file. Strings and
+ * binaries are handed to the callbacks as pointers into buff,
+ * they are not copied nor NUL-terminated.
+ * Returns the number of bytes the value took, or a negative errno. */
+int rmsgpack_read_buf(const void *buff, size_t size,
+		struct rmsgpack_read_callbacks *callbacks, void *data);
+
 #endif
 
@@ -11,12 +11,104 @@
 
 
 #define MAX_DEPTH 128
+
+/* Smallest block an arena grows by. */
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+struct rmsgpack_dom_arena_block
+{
+   struct rmsgpack_dom_arena_block *next;
+   size_t size;
+   size_t used;
+};
+
 struct dom_reader_state
 {
 	int i;
 	struct rmsgpack_dom_value* stack[MAX_DEPTH];
+	/* Set when parsing in place, maps and arrays come from here. */
+	struct rmsgpack_dom_arena *arena;
 };
 
+void rmsgpack_dom_arena_init(struct rmsgpack_dom_arena *arena)
+{
+   arena->head = NULL;
+   arena->cur  = NULL;
+}
+
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block;
+
+   for (block = arena->head; block; block = block->next)
+      block->used = 0;
+   arena->cur = arena->head;
+}
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block = arena->head;
+
+   while (block)
+   {
+      struct rmsgpack_dom_arena_block *next = block->next;
+      free(block);
+      block = next;
+   }
+   rmsgpack_dom_arena_init(arena);
+}
+
+/* Zeroed memory that lives until the arena is reset. */
+static void *dom_arena_alloc(struct rmsgpack_dom_arena *arena, size_t size)
+{
+   void *ptr;
+   struct rmsgpack_dom_arena_block *block = arena->cur;
+   /* Blocks start with their header, keep it 16 byte aligned. */
+   const size_t header = (sizeof(*block) + 15) & ~(size_t)15;
+
+   size = (size + 15) & ~(size_t)15;
+
+   /* Blocks a reset left behind are reused before growing. */
+   while (block && block->used + size > block->size)
+      block = block->next;
+
+   if (!block)
+   {
+      size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+
+      block = (struct rmsgpack_dom_arena_block*)malloc(header + block_size);
+      if (!block)
+         return NULL;
+
+      block->size = block_size;
+      block->used = 0;
+
+      if (arena->cur)
+      {
+         block->next      = arena->cur->next;
+         arena->cur->next = block;
+      }
+      else
+      {
+         block->next = arena->head;
+         arena->head = block;
+      }
+   }
+
+   arena->cur   = block;
+   ptr          = (uint8_t*)block + header + block->used;
+   block->used += size;
+   memset(ptr, 0, size);
+   return ptr;
+}
+
+static void *dom_reader_alloc(struct dom_reader_state *s, size_t count, size_t size)
+{
+   if (s->arena)
+      return count ? dom_arena_alloc(s->arena, count * size) : NULL;
+   return calloc(count, size);
+}
+
 
 static struct rmsgpack_dom_value *dom_reader_state_pop(struct dom_reader_state *s)
 {
@@ -27,7 +119,8 @@ static struct rmsgpack_dom_value *dom_reader_state_pop(struct dom_reader_state *
 
 static int dom_reader_state_push(struct dom_reader_state *s, struct rmsgpack_dom_value *v)
 {
-	//TODO: Verify we don't overflow
+	if (s->i + 1 >= MAX_DEPTH)
+		return -ENOMEM;
 	s->i++;
 	s->stack[s->i] = v;
 	return 0;
@@ -105,9 +198,10 @@ static int dom_read_map_start(uint32_t len, void *data)
    v->map.len = len;
    v->map.items = NULL;
 
-   items = (struct rmsgpack_dom_pair *)calloc(len, sizeof(struct rmsgpack_dom_pair));
+   items = (struct rmsgpack_dom_pair *)dom_reader_alloc(dom_state,
+         len, sizeof(struct rmsgpack_dom_pair));
 
-   if (!items)
+   if (!items && len)
       return -ENOMEM;
 
 	v->map.items = items;
@@ -132,9 +226,10 @@ static int dom_read_array_start(uint32_t len, void *data)
    v->array.len = len;
    v->array.items = NULL;
 
-   items = (struct rmsgpack_dom_value*)calloc(len, sizeof(struct rmsgpack_dom_pair));
+   items = (struct rmsgpack_dom_value*)dom_reader_alloc(dom_state,
+         len, sizeof(struct rmsgpack_dom_value));
 
-   if (!items)
+   if (!items && len)
       return -ENOMEM;
 
    v->array.items = items;
@@ -214,7 +309,7 @@ int rmsgpack_dom_value_cmp(
    unsigned i;
 
    if (a == b)
-      return 1;
+      return 0;
 
    if (a->type != b->type)
       return 1;
@@ -224,15 +319,15 @@ int rmsgpack_dom_value_cmp(
       case RDT_NULL:
          return 0;
       case RDT_BOOL:
-         return a->bool_ == b->bool_ ? 1 : 0;
+         return a->bool_ == b->bool_ ? 0 : 1;
       case RDT_INT:
-         return a->int_ == b->int_ ? 1 : 0;
+         return a->int_ == b->int_ ? 0 : 1;
       case RDT_UINT:
-         return a->uint_ == b->uint_ ? 1 : 0;
+         return a->uint_ == b->uint_ ? 0 : 1;
       case RDT_STRING:
          if (a->string.len != b->string.len)
             return 1;
-         return strncmp(a->string.buff, b->string.buff, a->string.len);
+         return memcmp(a->string.buff, b->string.buff, a->string.len);
       case RDT_BINARY:
          if (a->binary.len != b->binary.len)
             return 1;
@@ -240,14 +335,18 @@ int rmsgpack_dom_value_cmp(
       case RDT_MAP:
          if (a->map.len != b->map.len)
             return 1;
+         /* Keys are unique, so the same pairs in any order are equal. */
          for (i = 0; i < a->map.len; i++)
          {
-            if((rv = rmsgpack_dom_value_cmp(&a->map.items[i].key, &b->map.items[i].key)) != 0)
-               return rv;
-            if((rv = rmsgpack_dom_value_cmp(&a->map.items[i].value, &b->map.items[i].value)) != 0)
+            const struct rmsgpack_dom_value *value =
+               rmsgpack_dom_value_map_value(b, &a->map.items[i].key);
+
+            if (!value)
+               return 1;
+            if((rv = rmsgpack_dom_value_cmp(&a->map.items[i].value, value)) != 0)
                return rv;
          }
-         break;
+         return 0;
       case RDT_ARRAY:
          if (a->array.len != b->array.len)
             return 1;
@@ -256,7 +355,7 @@ int rmsgpack_dom_value_cmp(
             if((rv = rmsgpack_dom_value_cmp(&a->array.items[i], &b->array.items[i])) != 0)
                return rv;
          }
-         break;
+         return 0;
    }
 
    return 1;
@@ -292,7 +391,7 @@ void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj)
 #endif
          break;
       case RDT_STRING:
-         printf("\"%s\"", obj->string.buff);
+         printf("\"%.*s\"", (int)obj->string.len, obj->string.buff);
          break;
       case RDT_BINARY:
          printf("\"");
@@ -377,6 +476,7 @@ int rmsgpack_dom_read(int fd, struct rmsgpack_dom_value *out)
    struct dom_reader_state s;
    s.i = 0;
    s.stack[0] = out;
+   s.arena = NULL;
    rv = rmsgpack_read(fd, &dom_reader_callbacks, &s);
 
    if (rv < 0)
@@ -385,6 +485,17 @@ int rmsgpack_dom_read(int fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+int rmsgpack_dom_parse(const void *buff, size_t size,
+      struct rmsgpack_dom_arena *arena, struct rmsgpack_dom_value *out)
+{
+   struct dom_reader_state s;
+   s.i = 0;
+   s.stack[0] = out;
+   s.arena = arena;
+   out->type = RDT_NULL;
+   return rmsgpack_read_buf(buff, size, &dom_reader_callbacks, &s);
+}
+
 int rmsgpack_dom_read_into(int fd, ...)
 {
    va_list ap;
@@ -1,6 +1,7 @@
 #ifndef __RARCHDB_MSGPACK_DOM_H__
 #define __RARCHDB_MSGPACK_DOM_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 enum rmsgpack_dom_type {
@@ -44,6 +45,20 @@ struct rmsgpack_dom_pair {
 	struct rmsgpack_dom_value value;
 };
 
+struct rmsgpack_dom_arena_block;
+
+/* Allocates the maps and arrays of values parsed in place,
+ * releasing them all at once. */
+struct rmsgpack_dom_arena {
+	struct rmsgpack_dom_arena_block *head;
+	struct rmsgpack_dom_arena_block *cur;
+};
+
+void rmsgpack_dom_arena_init(struct rmsgpack_dom_arena *arena);
+/* Drops all values, keeping the memory for the next ones. */
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena);
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena);
+
 void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj);
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v);
 int rmsgpack_dom_value_cmp(const struct rmsgpack_dom_value *a, const struct rmsgpack_dom_value *b);
@@ -53,4 +68,12 @@ struct rmsgpack_dom_value *rmsgpack_dom_value_map_value(const struct rmsgpack_do
 int rmsgpack_dom_read(int fd, struct rmsgpack_dom_value *out);
 int rmsgpack_dom_write(int fd, const struct rmsgpack_dom_value *obj);
 int rmsgpack_dom_read_into(int fd, ...);
+
+/* Parses a value without copying it. Strings and binaries point into
+ * buff and are not NUL-terminated, maps and arrays come from arena.
+ * The value lasts until buff goes away or arena is reset, and must
+ * not be passed to rmsgpack_dom_value_free().
+ * Returns the number of bytes the value took, or a negative errno. */
+int rmsgpack_dom_parse(const void *buff, size_t size,
+		struct rmsgpack_dom_arena *arena, struct rmsgpack_dom_value *out);
 #endif
@@ -33,6 +33,9 @@ extern "C" {
 #ifdef HAVE_AV_CHANNEL_LAYOUT
 #include <libavutil/channel_layout.h>
 #endif
+#ifdef HAVE_AV_HWCONTEXT
+#include <libavutil/hwcontext.h>
+#endif
 #include <libavutil/avconfig.h>
 #include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
@@ -47,16 +50,21 @@ extern "C" {
 #include <queues/fifo_buffer.h>
 #include <rthreads/rthreads.h>
 #include "../../general.h"
+#include "../../retroarch.h"
 #include <gfx/scaler/scaler.h>
 #include <file/config_file.h>
 #include "../../audio/audio_utils.h"
 #include "../record_driver.h"
+#include "../../performance.h"
 #include <assert.h>
 
 #ifdef FFEMU_PERF
 #include <time.h>
 #endif
 
+/* Video frames the encoder thread can fall behind by. */
+#define MAX_FRAMES 32
+
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(52, 9, 0)
 #define av_frame_alloc avcodec_alloc_frame
 #define av_frame_free avcodec_free_frame
@@ -71,6 +79,13 @@ struct ff_video_info
    uint8_t *conv_frame_buf;
    int64_t frame_cnt;
 
+   /* Queued frames are read into in_buf. in_frame points the
+    * encoder straight at it when there is nothing to convert. */
+   uint8_t *in_buf;
+   AVFrame *in_frame;
+   /* The last frame went through in_frame, so dupes do too. */
+   bool wrapped;
+
    uint8_t *outbuf;
    size_t outbuf_size;
 
@@ -82,6 +97,14 @@ struct ff_video_info
    unsigned frame_drop_ratio;
    unsigned frame_drop_count;
 
+   /* Queued frames past which new ones are dropped, 
+    * 0 to not drop on depth. */
+   unsigned max_queued;
+
+   /* Filled in by the main thread, apart from the encode times. */
+   struct ffemu_stats stats;
+   struct rarch_perf_histogram encode_time;
+
    /* Input pixel size. */
    size_t pix_size;
 
@@ -90,6 +113,17 @@ struct ff_video_info
    struct scaler_ctx scaler;
    struct SwsContext *sws;
    bool use_sws;
+   /* Encoder takes the input format, frames of the
+    * output size are passed on or copied as they are. */
+   bool direct_copy;
+
+#ifdef HAVE_AV_HWCONTEXT
+   /* Set for encoders only taking device frames. conv_frame
+    * is uploaded into hw_frame before each encode. */
+   AVBufferRef *hw_device;
+   AVBufferRef *hw_frames;
+   AVFrame *hw_frame;
+#endif
 };
 
 struct ff_audio_info
@@ -99,6 +133,10 @@ struct ff_audio_info
 
    uint8_t *buffer;
    size_t frames_in_buffer;
+   /* Points into buffer or planar_buf, set up again for each
+    * encode. Encoders don't keep frames past the call unless
+    * they are refcounted, so one is enough. */
+   AVFrame *frame;
 
    int64_t frame_cnt;
 
@@ -129,6 +167,10 @@ struct ff_audio_info
    size_t planar_buf_frames;
 
    double ratio;
+
+   /* Input frames dropped because audio_fifo was full.
+    * Written under the lock, skipped over in the timestamps. */
+   size_t dropped_frames;
 };
 
 struct ff_muxer_info
@@ -144,12 +186,26 @@ struct ff_config_param
    char vcodec[64];
    char acodec[64];
    char format[64];
+   char hwaccel[64];
+   char hwaccel_device[PATH_MAX_LENGTH];
    enum PixelFormat out_pix_fmt;
    unsigned threads;
    unsigned frame_drop_ratio;
    unsigned sample_rate;
    unsigned scale_factor;
-
+   /* Milliseconds queued up before frames are dropped, 
+    * 0 to block instead. */
+   unsigned max_latency;
+   /* Bytes of video_fifo, 0 for the default. */
+   size_t buffer_size;
+   /* Drop frames rather than wait when the buffer is full. */
+   bool drop_frames;
+
+   /* Output is a network URL, set up for low latency. */
+   bool stream;
+   /* Seconds kept for save_replay(), 0 to write out 
+    * packets as they come. */
+   unsigned replay;
    bool audio_enable;
    /* Keep same naming conventions as libavcodec. */
    bool audio_qscale;
@@ -163,27 +219,166 @@ struct ff_config_param
    AVDictionary *audio_opts;
 };
 
+/* Entry of attr_fifo. */
+struct ff_video_attr
+{
+   struct ffemu_video_data data;
+   /* Set for frames from push_video_mapped(), which are read
+    * in place instead of being copied into video_fifo. */
+   ffemu_release_cb_t release;
+   void *userdata;
+   /* Dropped frames leave gaps, so timestamps are 
+    * assigned on push. */
+   int64_t pts;
+};
+
+/* Precedes each packet in a ff_packet_queue. */
+struct ff_packet_header
+{
+   int64_t pts;
+   int64_t dts;
+   int size;
+   int flags;
+   int stream_index;
+};
+
+/* Lock-free queue of headers, each followed by its payload. */
+struct ff_packet_queue
+{
+   fifo_spsc_buffer_t *fifo;
+   /* The muxer took packets off fifo. */
+   sevent_t *drain;
+};
+
+/* Encoded packet held by the replay buffer. */
+struct ff_replay_packet
+{
+   struct ff_replay_packet *next;
+   uint8_t *data;
+   int size;
+   int flags;
+   int stream_index;
+   int64_t pts;
+   int64_t dts;
+};
+
+struct ff_replay_info
+{
+   /* Oldest first, always starting on a video keyframe. 
+    * Only touched by the muxer thread. */
+   struct ff_replay_packet *head;
+   struct ff_replay_packet *tail;
+   size_t bytes;
+
+   /* Set by save_replay(), under the lock. */
+   char path[PATH_MAX_LENGTH];
+   bool pending;
+};
+
 typedef struct ffmpeg
 {
    struct ff_video_info video;
    struct ff_audio_info audio;
    struct ff_muxer_info muxer;
+   struct ff_replay_info replay;
    struct ff_config_param config;
    
    struct ffemu_params params;
 
-   scond_t *cond;
-   slock_t *cond_lock;
+   /* Guards audio.dropped_frames and the replay request. */
    slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
-   sthread_t *thread;
+
+   /* Written by the main thread, each read by one encoder thread. */
+   fifo_spsc_buffer_t *audio_fifo;
+   fifo_spsc_buffer_t *video_fifo;
+   fifo_spsc_buffer_t *attr_fifo;
+
+   /* Encoded packets on their way to the muxer thread. */
+   struct ff_packet_queue video_packets;
+   struct ff_packet_queue audio_packets;
+   /* Takes the biggest packet either encoder can put out. */
+   uint8_t *mux_buf;
+
+   /* Queues and buffers above, accounted to RARCH_MEM_RECORD. */
+   size_t mem_size;
+
+   sthread_t *video_thread;
+   sthread_t *audio_thread;
+   sthread_t *mux_thread;
+
+   /* Input was queued, or the encoder threads should exit. */
+   sevent_t *video_wake;
+   sevent_t *audio_wake;
+   /* A packet was queued, a replay was asked for, 
+    * or the encoder threads have exited. */
+   sevent_t *mux_wake;
+   /* An encoder thread took input off its fifo. */
+   sevent_t *space;
 
    volatile bool alive;
-   volatile bool can_sleep;
+   volatile bool mux_alive;
 } ffmpeg_t;
 
+/* Hardware encoders selectable with the "hwaccel" option. 
+ * "auto" tries them in this order. */
+struct ff_hw_encoder
+{
+   const char *ident;
+   const char *encoder;
+   /* Format frames are converted to when the encoder does not
+    * take the input format. */
+   enum PixelFormat sw_pix_fmt;
+#ifdef HAVE_AV_HWCONTEXT
+   /* Encoders only taking device frames, 
+    * AV_HWDEVICE_TYPE_NONE otherwise. */
+   enum AVHWDeviceType device_type;
+   enum PixelFormat hw_pix_fmt;
+#endif
+};
+
+#ifdef HAVE_AV_HWCONTEXT
+#define FF_HW_DEVICE(type, fmt) , type, fmt
+#define ff_hw_encoder_has_device(hw) ((hw)->device_type != AV_HWDEVICE_TYPE_NONE)
+#else
+#define FF_HW_DEVICE(type, fmt)
+#define ff_hw_encoder_has_device(hw) false
+#endif
+
+static const struct ff_hw_encoder ff_hw_encoders[] = {
+   { "nvenc",        "h264_nvenc",        PIX_FMT_NV12
+      FF_HW_DEVICE(AV_HWDEVICE_TYPE_NONE, PIX_FMT_NONE) },
+#ifdef HAVE_AV_HWCONTEXT
+   { "vaapi",        "h264_vaapi",        PIX_FMT_NV12
+      FF_HW_DEVICE(AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI) },
+#endif
+   { "qsv",          "h264_qsv",          PIX_FMT_NV12
+      FF_HW_DEVICE(AV_HWDEVICE_TYPE_NONE, PIX_FMT_NONE) },
+   { "videotoolbox", "h264_videotoolbox", PIX_FMT_NV12
+      FF_HW_DEVICE(AV_HWDEVICE_TYPE_NONE, PIX_FMT_NONE) },
+   { "mediacodec",   "h264_mediacodec",   PIX_FMT_NV12
+      FF_HW_DEVICE(AV_HWDEVICE_TYPE_NONE, PIX_FMT_NONE) },
+};
+
+static bool ffmpeg_is_stream_url(const char *path)
+{
+   return strstr(path, "://") && strncmp(path, "file:", 5);
+}
+
+/* Output goes over a link or into the replay buffer,
+ * both sized by bit rate rather than by quality. */
+static bool ffmpeg_bounded_rate(const struct ff_config_param *params)
+{
+   return params->stream || params->replay;
+}
+
+/* Muxer for URLs nothing can be guessed from. */
+static const char *ffmpeg_stream_format(const char *url)
+{
+   if (!strncmp(url, "rtmp", 4))
+      return "flv";
+   return "mpegts";
+}
+
 static bool ffmpeg_codec_has_sample_format(enum AVSampleFormat fmt,
       const enum AVSampleFormat *fmts)
 {
@@ -268,6 +463,47 @@ static void ffmpeg_audio_resolve_sample_rate(ffmpeg_t *handle,
    }
 }
 
+/**
+ * ffmpeg_audio_reserve:
+ * @handle                  : FFmpeg handle.
+ * @frames                  : Input frames pushed at once.
+ *
+ * Grows the conversion and resampling buffers to take
+ * @frames. Does nothing once they are big enough.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool ffmpeg_audio_reserve(ffmpeg_t *handle, size_t frames)
+{
+   struct ff_audio_info *audio = &handle->audio;
+   unsigned channels           = handle->params.channels;
+
+   if (frames <= audio->float_conv_frames)
+      return true;
+
+   audio->float_conv = (float*)av_realloc(audio->float_conv,
+         frames * channels * sizeof(float));
+   if (!audio->float_conv)
+      return false;
+
+   /* To make sure we don't accidentially overflow. */
+   audio->resample_out_frames = frames * (audio->ratio ? audio->ratio : 1.0) + 16;
+
+   audio->resample_out = (float*)av_realloc(audio->resample_out,
+         audio->resample_out_frames * channels * sizeof(float));
+   if (!audio->resample_out)
+      return false;
+
+   audio->fixed_conv_frames = max(audio->resample_out_frames, frames);
+   audio->fixed_conv = (int16_t*)av_realloc(audio->fixed_conv,
+         audio->fixed_conv_frames * channels * sizeof(int16_t));
+   if (!audio->fixed_conv)
+      return false;
+
+   audio->float_conv_frames = frames;
+   return true;
+}
+
 static bool ffmpeg_init_audio(ffmpeg_t *handle)
 {
    struct ff_config_param *params = &handle->config;
@@ -275,12 +511,14 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
    struct ff_video_info *video    = &handle->video;
    struct ffemu_params *param     = &handle->params;
 
-   AVCodec *codec = avcodec_find_encoder_by_name(
-         *params->acodec ? params->acodec : "flac");
+   /* Stream muxers rarely take FLAC. */
+   const char *acodec = *params->acodec ? params->acodec :
+      (ffmpeg_bounded_rate(params) ? "aac" : "flac");
+
+   AVCodec *codec = avcodec_find_encoder_by_name(acodec);
    if (!codec)
    {
-      RARCH_ERR("[FFmpeg]: Cannot find acodec %s.\n",
-            *params->acodec ? params->acodec : "flac");
+      RARCH_ERR("[FFmpeg]: Cannot find acodec %s.\n", acodec);
       return false;
    }
 
@@ -351,35 +589,169 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
    if (!audio->outbuf)
       return false;
 
+   /* The encoder thread pushes a codec frame at a time. Sizing 
+    * everything for that here keeps allocations off that path. */
+   audio->frame = av_frame_alloc();
+   if (!audio->frame)
+      return false;
+
+   if (audio->is_planar)
+   {
+      audio->planar_buf_frames = audio->codec->frame_size;
+      audio->planar_buf        = av_malloc(audio->planar_buf_frames *
+            audio->codec->channels * audio->sample_size);
+      if (!audio->planar_buf)
+         return false;
+   }
+
+   if ((audio->use_float || audio->resampler) &&
+         !ffmpeg_audio_reserve(handle, audio->codec->frame_size))
+      return false;
+
    return true;
 }
 
-static bool ffmpeg_init_video(ffmpeg_t *handle)
+static const struct ff_hw_encoder *ffmpeg_find_hw_encoder(const char *ident)
 {
-   struct ff_config_param *params = &handle->config;
-   struct ff_video_info *video    = &handle->video;
-   struct ffemu_params *param     = &handle->params;
+   unsigned i;
 
-   AVCodec *codec = NULL;
+   for (i = 0; i < ARRAY_SIZE(ff_hw_encoders); i++)
+      if (!strcmp(ff_hw_encoders[i].ident, ident))
+         return &ff_hw_encoders[i];
 
-   if (*params->vcodec)
-      codec = avcodec_find_encoder_by_name(params->vcodec);
-   else
+   return NULL;
+}
+
+static bool ffmpeg_codec_has_pix_fmt(const AVCodec *codec,
+      enum PixelFormat fmt)
+{
+   const enum PixelFormat *p;
+
+   if (!codec->pix_fmts)
+      return false;
+
+   for (p = codec->pix_fmts; *p != PIX_FMT_NONE; p++)
+      if (*p == fmt)
+         return true;
+
+   return false;
+}
+
+/**
+ * ffmpeg_hw_pix_fmt:
+ * @video                   : Video state, input format already set.
+ * @hw                      : Hardware encoder in use.
+ *
+ * Picks the format frames are handed to a hardware encoder in.
+ * Encoders taking system memory frames get the input format
+ * itself when they accept it, so the frame only needs copying.
+ *
+ * Returns: pixel format of the frames passed to the encoder
+ * (before upload, for encoders taking device frames).
+ **/
+static enum PixelFormat ffmpeg_hw_pix_fmt(struct ff_video_info *video,
+      const struct ff_hw_encoder *hw)
+{
+   if (ff_hw_encoder_has_device(hw))
+      return hw->sw_pix_fmt;
+
+   if (ffmpeg_codec_has_pix_fmt(video->encoder, video->in_pix_fmt))
+      return video->in_pix_fmt;
+#ifdef AV_PIX_FMT_0RGB32
+   /* Our XRGB8888 frames never carry alpha. */
+   if (video->in_pix_fmt == PIX_FMT_RGB32 &&
+         ffmpeg_codec_has_pix_fmt(video->encoder, AV_PIX_FMT_0RGB32))
+      return AV_PIX_FMT_0RGB32;
+#endif
+
+   return hw->sw_pix_fmt;
+}
+
+#ifdef HAVE_AV_HWCONTEXT
+static bool ffmpeg_init_hw_frames(ffmpeg_t *handle,
+      const struct ff_hw_encoder *hw)
+{
+   AVHWFramesContext *frames;
+   struct ff_video_info *video = &handle->video;
+   const char *device          = *handle->config.hwaccel_device ?
+      handle->config.hwaccel_device : NULL;
+
+   if (av_hwdevice_ctx_create(&video->hw_device, hw->device_type,
+            device, NULL, 0) < 0)
    {
-      /* By default, lossless video. */
-      av_dict_set(&params->video_opts, "qp", "0", 0);
-      codec = avcodec_find_encoder_by_name("libx264rgb");
+      RARCH_ERR("[FFmpeg]: Cannot open %s device.\n", hw->ident);
+      return false;
    }
 
-   if (!codec)
-   {
-      RARCH_ERR("[FFmpeg]: Cannot find vcodec %s.\n",
-            *params->vcodec ? params->vcodec : "libx264rgb");
+   video->hw_frames = av_hwframe_ctx_alloc(video->hw_device);
+   if (!video->hw_frames)
       return false;
+
+   frames                    = (AVHWFramesContext*)video->hw_frames->data;
+   frames->format            = hw->hw_pix_fmt;
+   frames->sw_format         = video->pix_fmt;
+   frames->width             = handle->params.out_width;
+   frames->height            = handle->params.out_height;
+   /* Some devices cannot grow the surface pool after init. */
+   frames->initial_pool_size = 20;
+
+   if (av_hwframe_ctx_init(video->hw_frames) < 0)
+      return false;
+
+   video->codec->hw_frames_ctx = av_buffer_ref(video->hw_frames);
+   video->codec->pix_fmt       = hw->hw_pix_fmt;
+   video->hw_frame             = av_frame_alloc();
+
+   return video->codec->hw_frames_ctx && video->hw_frame;
+}
+#endif
+
+static void ffmpeg_deinit_video_codec(struct ff_video_info *video)
+{
+   if (video->codec)
+   {
+      avcodec_close(video->codec);
+      av_free(video->codec);
+      video->codec = NULL;
    }
 
+#ifdef HAVE_AV_HWCONTEXT
+   av_frame_free(&video->hw_frame);
+   av_buffer_unref(&video->hw_frames);
+   av_buffer_unref(&video->hw_device);
+#endif
+}
+
+/**
+ * ffmpeg_init_video_codec:
+ * @handle                  : FFmpeg handle.
+ * @codec                   : Encoder to open.
+ * @hw                      : Hardware encoder entry @codec belongs
+ *                            to, or NULL for software encoders.
+ *
+ * Sets up the conversion into the encoder's pixel format and
+ * opens the encoder.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool ffmpeg_init_video_codec(ffmpeg_t *handle, AVCodec *codec,
+      const struct ff_hw_encoder *hw)
+{
+   struct ff_config_param *params = &handle->config;
+   struct ff_video_info *video    = &handle->video;
+   struct ffemu_params *param     = &handle->params;
+   AVDictionary *opts             = NULL;
+   bool ret;
+
    video->encoder = codec;
 
+   if (params->out_pix_fmt != PIX_FMT_NONE)
+      video->pix_fmt = params->out_pix_fmt;
+   else if (hw)
+      video->pix_fmt = ffmpeg_hw_pix_fmt(video, hw);
+   else /* Use BGR24 as default out format. */
+      video->pix_fmt = PIX_FMT_BGR24;
+
    /* Don't use swscaler unless format is not something "in-house" scaler
     * supports.
     *
@@ -387,32 +759,148 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
     * and it's non-trivial to fix upstream as it's heavily geared towards YUV.
     * If we're dealing with strange formats or YUV, just use libswscale.
     */
-   if (params->out_pix_fmt != PIX_FMT_NONE)
+   video->use_sws = false;
+   switch (video->pix_fmt)
    {
-      video->pix_fmt = params->out_pix_fmt;
-      if (video->pix_fmt != PIX_FMT_BGR24 && video->pix_fmt != PIX_FMT_RGB32)
+      case PIX_FMT_BGR24:
+         video->scaler.out_fmt = SCALER_FMT_BGR24;
+         break;
+
+      case PIX_FMT_RGB32:
+         video->scaler.out_fmt = SCALER_FMT_ARGB8888;
+         break;
+
+      default:
          video->use_sws = true;
+         break;
+   }
 
-      switch (video->pix_fmt)
-      {
-         case PIX_FMT_BGR24:
-            video->scaler.out_fmt = SCALER_FMT_BGR24;
-            break;
+   /* Frames the encoder takes as they come in only need copying
+    * when no scaling is asked for. */
+   video->direct_copy = video->pix_fmt == video->in_pix_fmt;
+#ifdef AV_PIX_FMT_0RGB32
+   if (video->pix_fmt == AV_PIX_FMT_0RGB32 &&
+         video->in_pix_fmt == PIX_FMT_RGB32)
+      video->direct_copy = true;
+#endif
 
-         case PIX_FMT_RGB32:
-            video->scaler.out_fmt = SCALER_FMT_ARGB8888;
-            break;
+   video->codec = avcodec_alloc_context3(codec);
+
+   video->codec->codec_type          = AVMEDIA_TYPE_VIDEO;
+   video->codec->width               = param->out_width;
+   video->codec->height              = param->out_height;
+   video->codec->time_base           = av_d2q((double)
+         params->frame_drop_ratio /param->fps, 1000000); /* Arbitrary big number. */
+   video->codec->sample_aspect_ratio = av_d2q(
+         param->aspect_ratio * param->out_height / param->out_width, 255);
+   video->codec->pix_fmt             = video->pix_fmt;
+
+   video->codec->thread_count = params->threads;
+
+   if (params->video_qscale)
+   {
+      video->codec->flags |= CODEC_FLAG_QSCALE;
+      video->codec->global_quality = params->video_global_quality;
+   }
+   else if (params->video_bit_rate)
+      video->codec->bit_rate = params->video_bit_rate;
 
-         default:
-            break;
+   if (ffmpeg_bounded_rate(params))
+   {
+      /* A keyframe every second, nothing held back for reordering. 
+       * This is also what the replay buffer is cut at. */
+      video->codec->gop_size     = (int)(param->fps /
+            params->frame_drop_ratio + 0.5);
+      video->codec->max_b_frames = 0;
+
+      /* Constant rate, half a second of VBV buffer. */
+      if (!params->video_qscale && params->video_bit_rate)
+      {
+         video->codec->rc_max_rate    = params->video_bit_rate;
+         video->codec->rc_buffer_size = params->video_bit_rate / 2;
       }
    }
-   else /* Use BGR24 as default out format. */
+
+   if (handle->muxer.ctx->oformat->flags & AVFMT_GLOBALHEADER)
+      video->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+#ifdef HAVE_AV_HWCONTEXT
+   if (hw && ff_hw_encoder_has_device(hw) && !ffmpeg_init_hw_frames(handle, hw))
+      return false;
+#endif
+
+   /* avcodec_open2() eats the options it used, 
+    * keep them around for the next encoder we may try. */
+   if (params->video_opts)
+      av_dict_copy(&opts, params->video_opts, 0);
+
+   /* Private options, only where they are known to exist. */
+   if (ffmpeg_bounded_rate(params) && !strncmp(codec->name, "libx264", 7))
    {
-      video->pix_fmt        = PIX_FMT_BGR24;
-      video->scaler.out_fmt = SCALER_FMT_BGR24;
+      if (params->stream)
+         av_dict_set(&opts, "tune", "zerolatency", AV_DICT_DONT_OVERWRITE);
+      av_dict_set(&opts, "preset", "veryfast", AV_DICT_DONT_OVERWRITE);
    }
 
+   ret = avcodec_open2(video->codec, codec, opts ? &opts : NULL) == 0;
+   av_dict_free(&opts);
+
+   return ret;
+}
+
+/**
+ * ffmpeg_init_video_hw:
+ * @handle                  : FFmpeg handle.
+ *
+ * Opens the encoder named by the "hwaccel" option. "auto" tries 
+ * every known one in order, falling back to software encoding
+ * when none is usable.
+ *
+ * Returns: true (1) if an encoder was opened, otherwise false (0).
+ **/
+static bool ffmpeg_init_video_hw(ffmpeg_t *handle)
+{
+   unsigned i;
+   const char *ident = handle->config.hwaccel;
+   bool auto_select  = !strcmp(ident, "auto");
+
+   for (i = 0; i < ARRAY_SIZE(ff_hw_encoders); i++)
+   {
+      AVCodec *codec;
+      const struct ff_hw_encoder *hw = &ff_hw_encoders[i];
+
+      if (!auto_select && strcmp(hw->ident, ident))
+         continue;
+
+      codec = avcodec_find_encoder_by_name(hw->encoder);
+      if (!codec)
+      {
+         if (!auto_select)
+            RARCH_ERR("[FFmpeg]: Cannot find vcodec %s.\n", hw->encoder);
+         continue;
+      }
+
+      if (ffmpeg_init_video_codec(handle, codec, hw))
+      {
+         RARCH_LOG("[FFmpeg]: Encoding video with %s.\n", hw->encoder);
+         return true;
+      }
+
+      RARCH_WARN("[FFmpeg]: Cannot open %s.\n", hw->encoder);
+      ffmpeg_deinit_video_codec(&handle->video);
+   }
+
+   return false;
+}
+
+static bool ffmpeg_init_video(ffmpeg_t *handle)
+{
+   struct ff_config_param *params = &handle->config;
+   struct ff_video_info *video    = &handle->video;
+   struct ffemu_params *param     = &handle->params;
+
+   AVCodec *codec = NULL;
+
    switch (param->pix_fmt)
    {
       case FFEMU_PIX_RGB565:
@@ -437,7 +925,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
          return false;
    }
 
-   video->codec = avcodec_alloc_context3(codec);
+#ifdef HAVE_THREADS
+   /* Large frames are scaled in bands on the shared pool, 
+    * so that scaling does not hold up the encoder thread. */
+   video->scaler.pool = rarch_get_thread_pool();
+#endif
 
    /* Useful to set scale_factor to 2 for chroma subsampled formats to
     * maintain full chroma resolution. (Or just use 4:4:4 or RGB ...)
@@ -445,32 +937,70 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    param->out_width  *= params->scale_factor;
    param->out_height *= params->scale_factor;
 
-   video->codec->codec_type          = AVMEDIA_TYPE_VIDEO;
-   video->codec->width               = param->out_width;
-   video->codec->height              = param->out_height;
-   video->codec->time_base           = av_d2q((double)
-         params->frame_drop_ratio /param->fps, 1000000); /* Arbitrary big number. */
-   video->codec->sample_aspect_ratio = av_d2q(
-         param->aspect_ratio * param->out_height / param->out_width, 255);
-   video->codec->pix_fmt             = video->pix_fmt;
+   /* Frames queued for the encoder thread are what delays output. */
+   if (params->max_latency)
+   {
+      video->max_queued = (unsigned)(params->max_latency * param->fps /
+            (1000.0 * params->frame_drop_ratio));
+      if (!video->max_queued)
+         video->max_queued = 1;
+      if (video->max_queued > MAX_FRAMES)
+         video->max_queued = MAX_FRAMES;
+   }
 
-   video->codec->thread_count = params->threads;
+   /* Stream servers expect a bounded bit rate, and the replay 
+    * buffer's memory use goes by it. */
+   if (ffmpeg_bounded_rate(params) && !params->video_qscale 
+         && !params->video_bit_rate)
+      params->video_bit_rate = 6000000;
 
-   if (params->video_qscale)
+   if (*params->hwaccel)
    {
-      video->codec->flags |= CODEC_FLAG_QSCALE;
-      video->codec->global_quality = params->video_global_quality;
+      if (strcmp(params->hwaccel, "auto") &&
+            !ffmpeg_find_hw_encoder(params->hwaccel))
+      {
+         RARCH_ERR("[FFmpeg]: Unknown hwaccel \"%s\".\n", params->hwaccel);
+         return false;
+      }
+
+      if (ffmpeg_init_video_hw(handle))
+         goto opened;
+
+      if (strcmp(params->hwaccel, "auto"))
+         return false;
+
+      RARCH_WARN("[FFmpeg]: No hardware encoder usable, "
+            "falling back to software.\n");
    }
-   else if (params->video_bit_rate)
-      video->codec->bit_rate = params->video_bit_rate;
 
-   if (handle->muxer.ctx->oformat->flags & AVFMT_GLOBALHEADER)
-      video->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+   if (*params->vcodec)
+      codec = avcodec_find_encoder_by_name(params->vcodec);
+   else if (ffmpeg_bounded_rate(params))
+   {
+      /* What stream servers take, lossless RGB would not fit the link. */
+      if (params->out_pix_fmt == PIX_FMT_NONE)
+         params->out_pix_fmt = PIX_FMT_YUV420P;
+      codec = avcodec_find_encoder_by_name("libx264");
+   }
+   else
+   {
+      /* By default, lossless video. */
+      av_dict_set(&params->video_opts, "qp", "0", 0);
+      codec = avcodec_find_encoder_by_name("libx264rgb");
+   }
 
-   if (avcodec_open2(video->codec, codec, params->video_opts ?
-            &params->video_opts : NULL) != 0)
+   if (!codec)
+   {
+      RARCH_ERR("[FFmpeg]: Cannot find vcodec %s.\n",
+            *params->vcodec ? params->vcodec :
+            (ffmpeg_bounded_rate(params) ? "libx264" : "libx264rgb"));
       return false;
+   }
 
+   if (!ffmpeg_init_video_codec(handle, codec, NULL))
+      return false;
+
+opened:
    /* Allocate a big buffer. ffmpeg API doesn't seem to give us some
     * clues how big this buffer should be. */
    video->outbuf_size = 1 << 23;
@@ -485,17 +1015,38 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    avpicture_fill((AVPicture*)video->conv_frame, video->conv_frame_buf,
          video->pix_fmt, param->out_width, param->out_height);
 
+   /* For some reason, FFmpeg has a tendency to crash 
+    * if we don't overallocate a bit. */
+   video->in_buf   = (uint8_t*)av_malloc(2 * param->fb_width *
+         param->fb_height * video->pix_size);
+   video->in_frame = av_frame_alloc();
+   if (!video->conv_frame_buf || !video->conv_frame
+         || !video->in_buf || !video->in_frame)
+      return false;
+
+   video->in_frame->format = video->pix_fmt;
+   video->in_frame->width  = param->out_width;
+   video->in_frame->height = param->out_height;
+
    return true;
 }
 
 static bool ffmpeg_init_config(struct ff_config_param *params,
-      const char *config)
+      const char *config, const char *filename, unsigned replay)
 {
    params->out_pix_fmt = PIX_FMT_NONE;
    params->scale_factor = 1;
-   params->threads = 1;
+   /* 0 lets libavcodec use as many threads as there are cores. */
+   params->threads = 0;
    params->frame_drop_ratio = 1;
 
+   /* A stalled link should cost frames, not stall the game. 
+    * Neither should a replay buffer nobody may ever save. */
+   params->replay      = replay;
+   params->stream      = !replay && ffmpeg_is_stream_url(filename);
+   params->max_latency = params->stream ? 500 : 0;
+   params->drop_frames = params->stream || params->replay;
+
    if (!config)
       return true;
 
@@ -512,6 +1063,11 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
          sizeof(params->acodec));
    config_get_array(params->conf, "format", params->format,
          sizeof(params->format));
+   /* One of ff_hw_encoders, or "auto". Takes precedence over vcodec. */
+   config_get_array(params->conf, "hwaccel", params->hwaccel,
+         sizeof(params->hwaccel));
+   config_get_path(params->conf, "hwaccel_device", params->hwaccel_device,
+         sizeof(params->hwaccel_device));
 
    config_get_uint(params->conf, "threads", &params->threads);
 
@@ -524,6 +1080,26 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 
    config_get_uint(params->conf, "sample_rate", &params->sample_rate);
    config_get_uint(params->conf, "scale_factor", &params->scale_factor);
+   config_get_uint(params->conf, "max_latency", &params->max_latency);
+
+   unsigned buffer_size = 0;
+   if (config_get_uint(params->conf, "buffer_size", &buffer_size))
+      params->buffer_size = (size_t)buffer_size << 20; /* MiB. */
+
+   char drop_policy[64] = {0};
+   if (config_get_array(params->conf, "drop_policy", drop_policy,
+            sizeof(drop_policy)))
+   {
+      if (!strcmp(drop_policy, "drop"))
+         params->drop_frames = true;
+      else if (!strcmp(drop_policy, "block"))
+         params->drop_frames = false;
+      else
+      {
+         RARCH_ERR("Unknown drop_policy \"%s\".\n", drop_policy);
+         return false;
+      }
+   }
 
    params->audio_qscale = config_get_int(params->conf, "audio_global_quality",
          &params->audio_global_quality);
@@ -567,17 +1143,34 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 static bool ffmpeg_init_muxer_pre(ffmpeg_t *handle)
 {
    AVFormatContext *ctx = avformat_alloc_context();
-   av_strlcpy(ctx->filename, handle->params.filename, sizeof(ctx->filename));
+   if (handle->params.filename)
+      av_strlcpy(ctx->filename, handle->params.filename,
+            sizeof(ctx->filename));
 
    if (*handle->config.format)
       ctx->oformat = av_guess_format(handle->config.format, NULL, NULL);
+   else if (handle->config.replay)
+      ctx->oformat = av_guess_format("matroska", NULL, NULL);
    else
+   {
       ctx->oformat = av_guess_format(NULL, ctx->filename, NULL);
+      if (!ctx->oformat && handle->config.stream)
+         ctx->oformat = av_guess_format(
+               ffmpeg_stream_format(ctx->filename), NULL, NULL);
+   }
 
    if (!ctx->oformat)
       return false;
 
-   if (avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
+#ifdef AVFMT_FLAG_FLUSH_PACKETS
+   /* Send packets as soon as they are muxed. */
+   if (handle->config.stream)
+      ctx->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+#endif
+
+   /* Replays open their own files when saved. */
+   if (!handle->config.replay &&
+         avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
    {
       av_free(ctx);
       return false;
@@ -607,72 +1200,182 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    av_dict_set(&handle->muxer.ctx->metadata, "title",
          "RetroArch video dump", 0); 
 
+   /* Nothing is written, so packets keep the codec's timestamps. */
+   if (handle->config.replay)
+   {
+      handle->muxer.vstream->time_base = handle->video.codec->time_base;
+      if (handle->muxer.astream)
+         handle->muxer.astream->time_base = handle->audio.codec->time_base;
+      return true;
+   }
+
    return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
 }
 
-#define MAX_FRAMES 32
+static void ffmpeg_video_thread(void *data);
+static void ffmpeg_audio_thread(void *data);
+static void ffmpeg_mux_thread(void *data);
+static void ffmpeg_replay_free(struct ff_replay_info *replay);
 
-static void ffmpeg_thread(void *data);
+/* Room for a full output buffer worth of packet, and then some. */
+#define FF_PACKET_QUEUE_SLACK (1 << 16)
 
 static bool init_thread(ffmpeg_t *handle)
 {
+   size_t audio_fifo_size = 32000 * sizeof(int16_t) *
+         handle->params.channels * MAX_FRAMES / 60; /* Some arbitrary max size. */
+
    handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
-         handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
-
-   handle->alive = true;
-   handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
-
-   assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   handle->audio_fifo = fifo_spsc_new(audio_fifo_size);
+   handle->attr_fifo = fifo_spsc_new(sizeof(struct ff_video_attr) * MAX_FRAMES);
+
+   /* Memory budget for frames, anywhere from one full frame
+    * to MAX_FRAMES of them. */
+   size_t frame_size = handle->params.fb_width * handle->params.fb_height *
+      handle->video.pix_size;
+   size_t fifo_size  = frame_size * MAX_FRAMES;
+   if (handle->config.buffer_size && handle->config.buffer_size < fifo_size)
+      fifo_size = handle->config.buffer_size > frame_size ?
+         handle->config.buffer_size : frame_size;
+
+   handle->video_fifo              = fifo_spsc_new(fifo_size);
+   handle->video.stats.buffer_size = fifo_size;
+
+   handle->mem_size = audio_fifo_size + fifo_size +
+      sizeof(struct ff_video_attr) * MAX_FRAMES +
+      handle->video.outbuf_size * 2 + FF_PACKET_QUEUE_SLACK;
+
+   handle->video_packets.fifo  = fifo_spsc_new(handle->video.outbuf_size +
+         FF_PACKET_QUEUE_SLACK);
+   handle->video_packets.drain = sevent_new(0);
+   handle->mux_buf = (uint8_t*)av_malloc(handle->video.outbuf_size);
+
+   handle->video_wake = sevent_new(0);
+   handle->mux_wake   = sevent_new(0);
+   handle->space      = sevent_new(0);
+
+   assert(handle->lock && handle->audio_fifo && handle->attr_fifo &&
+         handle->video_fifo && handle->video_packets.fifo &&
+         handle->video_packets.drain && handle->mux_buf &&
+         handle->video_wake && handle->mux_wake && handle->space);
+
+   if (handle->config.audio_enable)
+   {
+      handle->audio_packets.fifo  = fifo_spsc_new(handle->audio.outbuf_size
+            * MAX_FRAMES);
+      handle->audio_packets.drain = sevent_new(0);
+      handle->audio_wake          = sevent_new(0);
+
+      assert(handle->audio_packets.fifo && handle->audio_packets.drain &&
+            handle->audio_wake);
+      assert(handle->audio.outbuf_size <= handle->video.outbuf_size);
+
+      handle->mem_size += handle->audio.outbuf_size * MAX_FRAMES;
+   }
+
+   rarch_mem_add(RARCH_MEM_RECORD, handle->mem_size);
+
+   handle->alive     = true;
+   handle->mux_alive = true;
+
+   /* Scaling, encoding and writing out each stall on their own:
+    * scaling on big frames, encoding on complex scenes, writing 
+    * on a slow disk or link. Audio and video are encoded side 
+    * by side, and hand packets to the muxer thread. */
+   handle->mux_thread   = sthread_create(ffmpeg_mux_thread, handle);
+   handle->video_thread = sthread_create(ffmpeg_video_thread, handle);
+   assert(handle->mux_thread && handle->video_thread);
+
+   if (handle->config.audio_enable)
+   {
+      handle->audio_thread = sthread_create(ffmpeg_audio_thread, handle);
+      assert(handle->audio_thread);
+   }
 
    return true;
 }
 
+static void deinit_packet_queue(struct ff_packet_queue *queue)
+{
+   if (queue->fifo)
+      fifo_spsc_free(queue->fifo);
+   if (queue->drain)
+      sevent_free(queue->drain);
+
+   queue->fifo  = NULL;
+   queue->drain = NULL;
+}
+
 static void deinit_thread(ffmpeg_t *handle)
 {
-   if (!handle->thread)
+   if (!handle->mux_thread)
       return;
 
-   slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
 
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
+   sevent_signal(handle->video_wake);
+   sthread_join(handle->video_thread);
+
+   if (handle->audio_thread)
+   {
+      sevent_signal(handle->audio_wake);
+      sthread_join(handle->audio_thread);
+   }
+
+   /* Encoders may still be waiting on the muxer until here. 
+    * It writes out whatever they left queued before exiting. */
+   handle->mux_alive = false;
+   sevent_signal(handle->mux_wake);
+   sthread_join(handle->mux_thread);
 
    slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
+   sevent_free(handle->video_wake);
+   sevent_free(handle->mux_wake);
+   sevent_free(handle->space);
+   if (handle->audio_wake)
+      sevent_free(handle->audio_wake);
+
+   deinit_packet_queue(&handle->video_packets);
+   deinit_packet_queue(&handle->audio_packets);
+
+   av_free(handle->mux_buf);
+   handle->mux_buf = NULL;
 
-   handle->thread = NULL;
+   handle->video_thread = NULL;
+   handle->audio_thread = NULL;
+   handle->mux_thread   = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
+   rarch_mem_sub(RARCH_MEM_RECORD, handle->mem_size);
+   handle->mem_size = 0;
+
    if (handle->audio_fifo)
    {
-      fifo_free(handle->audio_fifo);
+      fifo_spsc_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
    
    if (handle->attr_fifo)
    {
-      fifo_free(handle->attr_fifo);
+      struct ff_video_attr attr;
+
+      /* Give back mapped frames that never got encoded. */
+      while (fifo_spsc_read_avail(handle->attr_fifo) >= sizeof(attr))
+      {
+         fifo_spsc_read(handle->attr_fifo, &attr, sizeof(attr));
+         if (attr.release)
+            attr.release(attr.userdata);
+      }
+
+      fifo_spsc_free(handle->attr_fifo);
       handle->attr_fifo = NULL;
    }
 
    if (handle->video_fifo)
    {
-      fifo_free(handle->video_fifo);
+      fifo_spsc_free(handle->video_fifo);
       handle->video_fifo = NULL;
    }
 }
@@ -693,187 +1396,593 @@ static void ffmpeg_free(void *data)
    }
 
    av_free(handle->audio.buffer);
+   av_frame_free(&handle->audio.frame);
+
+   ffmpeg_deinit_video_codec(&handle->video);
+
+   av_frame_free(&handle->video.conv_frame);
+   av_free(handle->video.conv_frame_buf);
+   av_frame_free(&handle->video.in_frame);
+   av_free(handle->video.in_buf);
+
+   scaler_ctx_gen_reset(&handle->video.scaler);
+
+   if (handle->video.sws)
+      sws_freeContext(handle->video.sws);
+
+   if (handle->config.conf)
+      config_file_free(handle->config.conf);
+   if (handle->config.video_opts)
+      av_dict_free(&handle->config.video_opts);
+   if (handle->config.audio_opts)
+      av_dict_free(&handle->config.audio_opts);
+
+   rarch_resampler_freep(&handle->audio.resampler,
+         &handle->audio.resampler_data);
+
+   ffmpeg_replay_free(&handle->replay);
+
+   av_free(handle->audio.float_conv);
+   av_free(handle->audio.resample_out);
+   av_free(handle->audio.fixed_conv);
+   av_free(handle->audio.planar_buf);
+
+   free(handle);
+}
+
+static void *ffmpeg_new(const struct ffemu_params *params)
+{
+   av_register_all();
+   avformat_network_init();
+
+   ffmpeg_t *handle = (ffmpeg_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      goto error;
+
+   handle->params = *params;
+
+   if (!ffmpeg_init_config(&handle->config, params->config,
+            params->filename, params->replay_seconds))
+      goto error;
+
+   if (!ffmpeg_init_muxer_pre(handle))
+      goto error;
+
+   if (!ffmpeg_init_video(handle))
+      goto error;
+
+   if (handle->config.audio_enable && !ffmpeg_init_audio(handle))
+      goto error;
+
+   if (!ffmpeg_init_muxer_post(handle))
+      goto error;
+
+   if (!init_thread(handle))
+      goto error;
+
+   return handle;
+
+error:
+   ffmpeg_free(handle);
+   return NULL;
+}
+
+static bool ffmpeg_drop_video_frame(ffmpeg_t *handle)
+{
+   bool drop_frame = handle->video.frame_drop_count++ %
+      handle->video.frame_drop_ratio;
+
+   handle->video.frame_drop_count %= handle->video.frame_drop_ratio;
+
+   return drop_frame;
+}
+
+/* Whether a frame taking @size bytes of video_fifo fits. 
+ * Only called by the main thread, the writer. */
+static bool ffmpeg_has_video_space(ffmpeg_t *handle, size_t size)
+{
+   return fifo_spsc_write_avail(handle->attr_fifo) >= sizeof(struct ff_video_attr)
+      && fifo_spsc_write_avail(handle->video_fifo) >= size;
+}
+
+/* Bytes waiting in @fifo, as seen by its writer. */
+static size_t ffmpeg_fifo_queued(fifo_spsc_buffer_t *fifo)
+{
+   return (fifo->bufsize - 1) - fifo_spsc_write_avail(fifo);
+}
+
+/**
+ * ffmpeg_admit_video:
+ * @handle                  : FFmpeg handle.
+ * @size                    : Bytes of video_fifo the frame takes.
+ *
+ * Drop policy. With "max_latency" set, frames are dropped once 
+ * the encoder thread is that far behind, typically because it is 
+ * blocked on a stalled network write. With "drop_policy = drop", 
+ * they are dropped whenever the buffer is full, instead of the 
+ * main thread waiting for room. A dropped frame still uses up
+ * its timestamp, so playback stays in sync.
+ *
+ * Returns: true (1) if the frame should be queued, 
+ * false (0) if it is dropped.
+ **/
+static bool ffmpeg_admit_video(ffmpeg_t *handle, size_t size)
+{
+   unsigned queued;
+   bool full;
+   struct ffemu_stats *stats = &handle->video.stats;
+
+   queued = ffmpeg_fifo_queued(handle->attr_fifo) / sizeof(struct ff_video_attr);
+   full   = !ffmpeg_has_video_space(handle, size);
+
+   if (queued > stats->max_queued_frames)
+      stats->max_queued_frames = queued;
+
+   if ((handle->video.max_queued && queued >= handle->video.max_queued)
+         || (full && handle->config.drop_frames))
+   {
+      handle->video.frame_cnt++;
+      stats->dropped_frames++;
+      return false;
+   }
+
+   return true;
+}
+
+/* Blocks until the buffer has room for a frame taking @size bytes 
+ * of video_fifo. Returns false if the thread is going away. */
+static bool ffmpeg_wait_video_space(ffmpeg_t *handle, size_t size)
+{
+   retro_time_t start = 0;
+
+   for (;;)
+   {
+      bool avail = ffmpeg_has_video_space(handle, size);
+
+      if (!handle->alive)
+         return false;
+
+      if (avail)
+         break;
+
+      /* The main thread stalls for as long as we wait here. */
+      if (!start)
+         start = rarch_get_time_usec();
+
+      sevent_wait(handle->space);
+   }
+
+   if (start)
+   {
+      handle->video.stats.blocked_frames++;
+      handle->video.stats.blocked_usec += rarch_get_time_usec() - start;
+   }
+
+   return true;
+}
+
+static bool ffmpeg_push_video(void *data,
+      const struct ffemu_video_data *video_data)
+{
+   unsigned y;
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !video_data)
+      return false;
+
+   if (ffmpeg_drop_video_frame(handle))
+      return true;
+
+   size_t size = video_data->is_dupe ? 0 :
+      video_data->width * video_data->height * handle->video.pix_size;
+
+   if (!ffmpeg_admit_video(handle, size))
+      return true;
+
+   if (!ffmpeg_wait_video_space(handle, size))
+      return false;
+
+   /* Tightly pack our frame to conserve memory.
+    * libretro tends to use a very large pitch.
+    */
+   struct ff_video_attr attr = {{0}};
+   struct ffemu_video_data *attr_data = &attr.data;
+   *attr_data = *video_data;
+   attr.pts   = handle->video.frame_cnt++;
+
+   if (attr_data->is_dupe)
+      attr_data->width = attr_data->height = attr_data->pitch = 0;
+   else
+      attr_data->pitch = attr_data->width * handle->video.pix_size;
+
+   /* The frame has to be in place before the encoder thread
+    * sees its attr. */
+   int offset = 0;
+   for (y = 0; y < attr_data->height; y++, offset += video_data->pitch)
+      fifo_spsc_write(handle->video_fifo,
+            (const uint8_t*)video_data->data + offset, attr_data->pitch);
+
+   fifo_spsc_write(handle->attr_fifo, &attr, sizeof(attr));
+   sevent_signal(handle->video_wake);
+
+   return true;
+}
+
+static bool ffmpeg_push_video_mapped(void *data,
+      const struct ffemu_video_data *video_data,
+      ffemu_release_cb_t release, void *userdata)
+{
+   struct ff_video_attr attr = {{0}};
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !video_data)
+   {
+      release(userdata);
+      return false;
+   }
+
+   if (ffmpeg_drop_video_frame(handle) || !ffmpeg_admit_video(handle, 0))
+   {
+      release(userdata);
+      return true;
+   }
+
+   if (!ffmpeg_wait_video_space(handle, 0))
+   {
+      release(userdata);
+      return false;
+   }
+
+   attr.data     = *video_data;
+   attr.release  = release;
+   attr.userdata = userdata;
+   attr.pts      = handle->video.frame_cnt++;
+
+   fifo_spsc_write(handle->attr_fifo, &attr, sizeof(attr));
+   sevent_signal(handle->video_wake);
+
+   return true;
+}
+
+static bool ffmpeg_push_audio(void *data,
+      const struct ffemu_audio_data *audio_data)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !audio_data)
+      return false;
+
+   if (!handle->config.audio_enable)
+      return true;
+
+   for (;;)
+   {
+      size_t avail = fifo_spsc_write_avail(handle->audio_fifo);
+
+      if (!handle->alive)
+         return false;
+
+      if (avail >= audio_data->frames * handle->params.channels
+            * sizeof(int16_t))
+         break;
+
+      /* Same drop policy as video, the gap is 
+       * skipped over in the timestamps. */
+      if (handle->config.max_latency)
+      {
+         slock_lock(handle->lock);
+         handle->audio.dropped_frames += audio_data->frames;
+         slock_unlock(handle->lock);
+         return true;
+      }
+
+      sevent_wait(handle->space);
+   }
+
+   fifo_spsc_write(handle->audio_fifo, audio_data->data,
+         audio_data->frames * handle->params.channels * sizeof(int16_t));
+   sevent_signal(handle->audio_wake);
+
+   return true;
+}
+
+static bool ffmpeg_replay_is_keyframe(ffmpeg_t *handle,
+      const struct ff_replay_packet *pkt)
+{
+   return pkt->stream_index == handle->muxer.vstream->index &&
+      (pkt->flags & AV_PKT_FLAG_KEY);
+}
+
+/* Seconds into the recording. */
+static double ffmpeg_replay_time(ffmpeg_t *handle,
+      const struct ff_replay_packet *pkt)
+{
+   AVStream *stream = handle->muxer.ctx->streams[pkt->stream_index];
+   int64_t ts = pkt->dts != (int64_t)AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+   return ts * av_q2d(stream->time_base);
+}
 
-   if (handle->video.codec)
-   {
-      avcodec_close(handle->video.codec);
-      av_free(handle->video.codec);
-   }
+static void ffmpeg_replay_pop(struct ff_replay_info *replay)
+{
+   struct ff_replay_packet *pkt = replay->head;
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
+   replay->head   = pkt->next;
+   replay->bytes -= pkt->size;
+   if (!replay->head)
+      replay->tail = NULL;
 
-   scaler_ctx_gen_reset(&handle->video.scaler);
+   av_free(pkt->data);
+   free(pkt);
+}
 
-   if (handle->video.sws)
-      sws_freeContext(handle->video.sws);
+/* Drops the oldest GOPs for as long as what is left still 
+ * covers the replay window. Saves can only start on a keyframe,
+ * so memory is bounded by bit rate times window, plus a GOP. */
+static void ffmpeg_replay_trim(ffmpeg_t *handle)
+{
+   struct ff_replay_info *replay = &handle->replay;
+   double newest = ffmpeg_replay_time(handle, replay->tail);
 
-   if (handle->config.conf)
-      config_file_free(handle->config.conf);
-   if (handle->config.video_opts)
-      av_dict_free(&handle->config.video_opts);
-   if (handle->config.audio_opts)
-      av_dict_free(&handle->config.audio_opts);
+   for (;;)
+   {
+      struct ff_replay_packet *next = replay->head->next;
 
-   rarch_resampler_freep(&handle->audio.resampler,
-         &handle->audio.resampler_data);
+      while (next && !ffmpeg_replay_is_keyframe(handle, next))
+         next = next->next;
 
-   av_free(handle->audio.float_conv);
-   av_free(handle->audio.resample_out);
-   av_free(handle->audio.fixed_conv);
-   av_free(handle->audio.planar_buf);
+      if (!next || newest - ffmpeg_replay_time(handle, next) 
+            < handle->config.replay)
+         break;
 
-   free(handle);
+      while (replay->head != next)
+         ffmpeg_replay_pop(replay);
+   }
 }
 
-static void *ffmpeg_new(const struct ffemu_params *params)
+static bool ffmpeg_replay_push(ffmpeg_t *handle, const AVPacket *pkt)
 {
-   av_register_all();
-   avformat_network_init();
-
-   ffmpeg_t *handle = (ffmpeg_t*)calloc(1, sizeof(*handle));
-   if (!handle)
-      goto error;
+   struct ff_replay_info *replay = &handle->replay;
+   struct ff_replay_packet *entry = NULL;
+   bool keyframe = pkt->stream_index == handle->muxer.vstream->index &&
+      (pkt->flags & AV_PKT_FLAG_KEY);
 
-   handle->params = *params;
+   /* Nothing before the first keyframe could be played back. */
+   if (!replay->head && !keyframe)
+      return true;
 
-   if (!ffmpeg_init_config(&handle->config, params->config))
-      goto error;
+   entry = (struct ff_replay_packet*)calloc(1, sizeof(*entry));
+   if (!entry)
+      return false;
 
-   if (!ffmpeg_init_muxer_pre(handle))
-      goto error;
+   entry->data = (uint8_t*)av_malloc(pkt->size);
+   if (!entry->data)
+   {
+      free(entry);
+      return false;
+   }
 
-   if (!ffmpeg_init_video(handle))
-      goto error;
+   memcpy(entry->data, pkt->data, pkt->size);
+   entry->size         = pkt->size;
+   entry->flags        = pkt->flags;
+   entry->stream_index = pkt->stream_index;
+   entry->pts          = pkt->pts;
+   entry->dts          = pkt->dts;
 
-   if (handle->config.audio_enable && !ffmpeg_init_audio(handle))
-      goto error;
+   if (replay->tail)
+      replay->tail->next = entry;
+   else
+      replay->head = entry;
+   replay->tail   = entry;
+   replay->bytes += entry->size;
 
-   if (!ffmpeg_init_muxer_post(handle))
-      goto error;
+   if (keyframe)
+      ffmpeg_replay_trim(handle);
 
-   if (!init_thread(handle))
-      goto error;
+   return true;
+}
 
-   return handle;
+static void ffmpeg_replay_free(struct ff_replay_info *replay)
+{
+   while (replay->head)
+      ffmpeg_replay_pop(replay);
+}
 
-error:
-   ffmpeg_free(handle);
-   return NULL;
+/* Hands an encoded packet to the muxer, or to the replay buffer. */
+static bool ffmpeg_write_packet(ffmpeg_t *handle, AVPacket *pkt)
+{
+   if (handle->config.replay)
+      return ffmpeg_replay_push(handle, pkt);
+   return av_interleaved_write_frame(handle->muxer.ctx, pkt) >= 0;
 }
 
-static bool ffmpeg_push_video(void *data,
-      const struct ffemu_video_data *video_data)
+/**
+ * ffmpeg_queue_packet:
+ * @handle                  : FFmpeg handle.
+ * @queue                   : Queue of the stream @pkt belongs to.
+ * @pkt                     : Encoded packet.
+ *
+ * Hands a packet from an encoder thread to the muxer thread,
+ * waiting for room if the muxer is behind. Once the threads
+ * are gone, packets go straight to the muxer.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool ffmpeg_queue_packet(ffmpeg_t *handle,
+      struct ff_packet_queue *queue, AVPacket *pkt)
 {
-   unsigned y;
-   bool drop_frame;
-   ffmpeg_t *handle = (ffmpeg_t*)data;
+   struct ff_packet_header header;
+   size_t size = sizeof(header) + pkt->size;
 
-   if (!handle || !video_data)
-      return false;
+   if (!handle->mux_thread)
+      return ffmpeg_write_packet(handle, pkt);
 
-   drop_frame = handle->video.frame_drop_count++ %
-      handle->video.frame_drop_ratio;
+   if (size > queue->fifo->bufsize - 1)
+      return false;
 
-   handle->video.frame_drop_count %= handle->video.frame_drop_ratio;
+   while (fifo_spsc_write_avail(queue->fifo) < size)
+      sevent_wait(queue->drain);
 
-   if (drop_frame)
-      return true;
+   header.pts          = pkt->pts;
+   header.dts          = pkt->dts;
+   header.size         = pkt->size;
+   header.flags        = pkt->flags;
+   header.stream_index = pkt->stream_index;
 
-   for (;;)
-   {
-      slock_lock(handle->lock);
-      unsigned avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
+   fifo_spsc_write(queue->fifo, &header, sizeof(header));
+   fifo_spsc_write(queue->fifo, pkt->data, pkt->size);
+   sevent_signal(handle->mux_wake);
 
-      if (!handle->alive)
-         return false;
+   return true;
+}
 
-      if (avail >= sizeof(*video_data))
-         break;
+/* Writes out the next packet in @queue, if there is one. */
+static bool ffmpeg_mux_packet(ffmpeg_t *handle, struct ff_packet_queue *queue)
+{
+   AVPacket pkt;
+   struct ff_packet_header header;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   if (fifo_spsc_read_avail(queue->fifo) < sizeof(header))
+      return false;
 
-      slock_unlock(handle->cond_lock);
-   }
+   fifo_spsc_read(queue->fifo, &header, sizeof(header));
 
-   slock_lock(handle->lock);
+   /* The payload is written right behind the header. */
+   while (fifo_spsc_read_avail(queue->fifo) < (size_t)header.size)
+      sevent_wait(handle->mux_wake);
 
-   /* Tightly pack our frame to conserve memory.
-    * libretro tends to use a very large pitch.
-    */
-   struct ffemu_video_data attr_data = *video_data;
+   fifo_spsc_read(queue->fifo, handle->mux_buf, header.size);
+   sevent_signal(queue->drain);
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
-   else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+   av_init_packet(&pkt);
+   pkt.data         = handle->mux_buf;
+   pkt.size         = header.size;
+   pkt.pts          = header.pts;
+   pkt.dts          = header.dts;
+   pkt.flags        = header.flags;
+   pkt.stream_index = header.stream_index;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   ffmpeg_write_packet(handle, &pkt);
+   return true;
+}
 
-   int offset = 0;
-   for (y = 0; y < attr_data.height; y++, offset += video_data->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)video_data->data + offset, attr_data.pitch);
+/* First extension the muxer registers, for naming saved replays. */
+static const char *ffmpeg_replay_extension(const AVOutputFormat *format,
+      char *ext, size_t size)
+{
+   const char *delim = NULL;
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   if (!format->extensions || !*format->extensions)
+      return format->name;
 
-   return true;
+   av_strlcpy(ext, format->extensions, size);
+   delim = strchr(ext, ',');
+   if (delim)
+      ext[delim - ext] = '\0';
+   return ext;
 }
 
-static bool ffmpeg_push_audio(void *data,
-      const struct ffemu_audio_data *audio_data)
+/**
+ * ffmpeg_replay_save:
+ * @handle                  : FFmpeg handle.
+ * @path                    : Path to save to, without extension.
+ *
+ * Remuxes the replay buffer into a new file, with timestamps
+ * starting from zero. Packets are copied as they are, nothing 
+ * is encoded again. Called from the muxer thread, or after 
+ * it has stopped.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool ffmpeg_replay_save(ffmpeg_t *handle, const char *path)
 {
-   ffmpeg_t *handle = (ffmpeg_t*)data;
+   unsigned i;
+   char ext[32];
+   int64_t start;
+   const struct ff_replay_packet *entry;
+   AVFormatContext *in  = handle->muxer.ctx;
+   AVFormatContext *ctx = NULL;
+   bool ret             = false;
 
-   if (!handle || !audio_data)
-      return false;
+   if (!handle->replay.head)
+      goto end;
 
-   if (!handle->config.audio_enable)
-      return true;
+   ctx = avformat_alloc_context();
+   if (!ctx)
+      goto end;
 
-   for (;;)
+   ctx->oformat = in->oformat;
+   snprintf(ctx->filename, sizeof(ctx->filename), "%s.%s", path,
+         ffmpeg_replay_extension(in->oformat, ext, sizeof(ext)));
+
+   for (i = 0; i < in->nb_streams; i++)
    {
-      slock_lock(handle->lock);
-      unsigned avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
+      AVStream *stream = avformat_new_stream(ctx, in->streams[i]->codec->codec);
+      if (!stream || avcodec_copy_context(stream->codec,
+               in->streams[i]->codec) < 0)
+         goto end;
 
-      if (!handle->alive)
-         return false;
+      stream->time_base           = in->streams[i]->time_base;
+      stream->sample_aspect_ratio = in->streams[i]->sample_aspect_ratio;
+   }
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
-         break;
+   av_dict_set(&ctx->metadata, "title", "RetroArch replay", 0); 
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   if (avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
+      goto end;
+   if (avformat_write_header(ctx, NULL) < 0)
+      goto end;
 
-      slock_unlock(handle->cond_lock);
+   /* The buffer starts on a video keyframe, which becomes time zero. */
+   entry = handle->replay.head;
+   start = av_rescale_q(entry->dts != (int64_t)AV_NOPTS_VALUE ? 
+         entry->dts : entry->pts,
+         in->streams[entry->stream_index]->time_base, AV_TIME_BASE_Q);
+
+   for (; entry; entry = entry->next)
+   {
+      AVPacket pkt;
+      AVRational in_base  = in->streams[entry->stream_index]->time_base;
+      AVRational out_base = ctx->streams[entry->stream_index]->time_base;
+      int64_t offset      = av_rescale_q(start, AV_TIME_BASE_Q, in_base);
+
+      av_init_packet(&pkt);
+      pkt.data         = entry->data;
+      pkt.size         = entry->size;
+      pkt.flags        = entry->flags;
+      pkt.stream_index = entry->stream_index;
+      pkt.pts          = AV_NOPTS_VALUE;
+      pkt.dts          = AV_NOPTS_VALUE;
+
+      if (entry->pts != (int64_t)AV_NOPTS_VALUE)
+         pkt.pts = av_rescale_q(entry->pts - offset, in_base, out_base);
+      if (entry->dts != (int64_t)AV_NOPTS_VALUE)
+         pkt.dts = av_rescale_q(entry->dts - offset, in_base, out_base);
+
+      /* Audio encoded just ahead of the keyframe. */
+      if ((pkt.dts != (int64_t)AV_NOPTS_VALUE ? pkt.dts : pkt.pts) < 0)
+         continue;
+
+      if (av_interleaved_write_frame(ctx, &pkt) < 0)
+         goto end;
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   ret = av_write_trailer(ctx) == 0;
 
-   return true;
+end:
+   if (ret)
+      RARCH_LOG("[FFmpeg]: Saved replay to \"%s\" (%u KiB).\n",
+            ctx->filename, (unsigned)(handle->replay.bytes >> 10));
+   else
+      RARCH_ERR("[FFmpeg]: Failed to save replay to \"%s\".\n", path);
+
+   if (ctx)
+   {
+      if (ctx->pb)
+         avio_close(ctx->pb);
+      avformat_free_context(ctx);
+   }
+
+   return ret;
 }
 
 static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
@@ -910,6 +2019,38 @@ static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
    return true;
 }
 
+/* Encoders read with vector loads, so frames they get
+ * in place have to be aligned like libavutil's own. */
+#define FF_WRAP_ALIGN 64
+
+/**
+ * ffmpeg_wrap_input:
+ * @handle                  : FFmpeg handle.
+ * @data                    : Frame to encode.
+ *
+ * Points in_frame at @data when the encoder takes it as it is,
+ * which spares copying it into conv_frame.
+ *
+ * Returns: true (1) if in_frame is to be encoded,
+ * otherwise false (0).
+ **/
+static bool ffmpeg_wrap_input(ffmpeg_t *handle,
+      const struct ffemu_video_data *data)
+{
+   AVFrame *frame = handle->video.in_frame;
+
+   if (!handle->video.direct_copy
+         || data->width  != handle->params.out_width
+         || data->height != handle->params.out_height
+         || data->pitch <= 0
+         || (((uintptr_t)data->data | data->pitch) & (FF_WRAP_ALIGN - 1)))
+      return false;
+
+   frame->data[0]     = (uint8_t*)data->data;
+   frame->linesize[0] = data->pitch;
+   return true;
+}
+
 static void ffmpeg_scale_input(ffmpeg_t *handle,
       const struct ffemu_video_data *data)
 {
@@ -917,7 +2058,20 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    bool shrunk = handle->params.out_width < data->width
       || handle->params.out_height < data->height;
 
-   if (handle->video.use_sws)
+   if (handle->video.direct_copy 
+         && data->width  == handle->params.out_width
+         && data->height == handle->params.out_height)
+   {
+      unsigned y;
+      const uint8_t *in = (const uint8_t*)data->data;
+      uint8_t *out      = handle->video.conv_frame->data[0];
+      size_t row_size   = data->width * handle->video.pix_size;
+
+      for (y = 0; y < data->height; y++, in += data->pitch,
+            out += handle->video.conv_frame->linesize[0])
+         memcpy(out, in, row_size);
+   }
+   else if (handle->video.use_sws)
    {
       handle->video.sws = sws_getCachedContext(handle->video.sws,
             data->width, data->height, handle->video.in_pix_fmt,
@@ -956,24 +2110,67 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
 }
 
 static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct ffemu_video_data *data)
+      const struct ff_video_attr *attr)
 {
+   bool ret;
+   const struct ffemu_video_data *data = &attr->data;
+   AVFrame *frame     = handle->video.conv_frame;
+   retro_time_t start = rarch_get_time_usec();
+
    if (!data->is_dupe)
-      ffmpeg_scale_input(handle, data);
+   {
+      handle->video.wrapped = ffmpeg_wrap_input(handle, data);
+      if (!handle->video.wrapped)
+         ffmpeg_scale_input(handle, data);
+   }
+
+   if (handle->video.wrapped)
+      frame = handle->video.in_frame;
+
+#ifdef HAVE_AV_HWCONTEXT
+   if (handle->video.hw_frames)
+   {
+      AVFrame *sw_frame = frame;
+
+      frame = handle->video.hw_frame;
+      if (av_hwframe_get_buffer(handle->video.hw_frames, frame, 0) < 0)
+         return false;
+
+      if (av_hwframe_transfer_data(frame, sw_frame, 0) < 0)
+      {
+         av_frame_unref(frame);
+         return false;
+      }
+   }
+#endif
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+   frame->pts = attr->pts;
 
    AVPacket pkt;
-   if (!encode_video(handle, &pkt, handle->video.conv_frame))
+   ret = encode_video(handle, &pkt, frame);
+   rarch_perf_histogram_add(&handle->video.encode_time,
+         rarch_get_time_usec() - start);
+
+#ifdef HAVE_AV_HWCONTEXT
+   /* The encoder keeps its own reference while it needs the surface. */
+   if (handle->video.hw_frames)
+      av_frame_unref(frame);
+#endif
+
+   /* Mapped frames are handed back after this, dupes of
+    * them can only repeat conv_frame. */
+   if (attr->release)
+      handle->video.wrapped = false;
+
+   if (!ret)
       return false;
 
    if (pkt.size)
    {
-      if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+      if (!ffmpeg_queue_packet(handle, &handle->video_packets, &pkt))
          return false;
    }
 
-   handle->video.frame_cnt++;
    return true;
 }
 
@@ -999,20 +2196,11 @@ static void planarize_s16(int16_t *out, const int16_t *in, size_t frames)
 
 static void planarize_audio(ffmpeg_t *handle)
 {
+   /* Sized for a full codec frame by ffmpeg_init_audio(), 
+    * frames_in_buffer never gets past that. */
    if (!handle->audio.is_planar)
       return;
 
-   if (handle->audio.frames_in_buffer > handle->audio.planar_buf_frames)
-   {
-      handle->audio.planar_buf = av_realloc(handle->audio.planar_buf, 
-            handle->audio.frames_in_buffer * handle->params.channels *
-            handle->audio.sample_size);
-      if (!handle->audio.planar_buf)
-         return;
-
-      handle->audio.planar_buf_frames = handle->audio.frames_in_buffer;
-   }
-
    if (handle->audio.use_float)
       planarize_float((float*)handle->audio.planar_buf,
             (const float*)handle->audio.buffer,
@@ -1029,9 +2217,7 @@ static bool encode_audio(ffmpeg_t *handle, AVPacket *pkt, bool dry)
    pkt->data = handle->audio.outbuf;
    pkt->size = handle->audio.outbuf_size;
 
-   AVFrame *frame = av_frame_alloc();
-   if (!frame)
-      return false;
+   AVFrame *frame = handle->audio.frame;
 
    frame->nb_samples     = handle->audio.frames_in_buffer;
    frame->format         = handle->audio.codec->sample_fmt;
@@ -1054,17 +2240,13 @@ static bool encode_audio(ffmpeg_t *handle, AVPacket *pkt, bool dry)
    int got_packet = 0;
    if (avcodec_encode_audio2(handle->audio.codec,
             pkt, dry ? NULL : frame, &got_packet) < 0)
-   {
-      av_frame_free(&frame);
       return false;
-   }
 
    if (!got_packet)
    {
       pkt->size = 0;
       pkt->pts = AV_NOPTS_VALUE;
       pkt->dts = AV_NOPTS_VALUE;
-      av_frame_free(&frame);
       return true;
    }
 
@@ -1082,8 +2264,6 @@ static bool encode_audio(ffmpeg_t *handle, AVPacket *pkt, bool dry)
             handle->muxer.astream->time_base);
    }
 
-   av_frame_free(&frame);
-
    pkt->stream_index = handle->muxer.astream->index;
    return true;
 }
@@ -1094,31 +2274,10 @@ static void ffmpeg_audio_resample(ffmpeg_t *handle,
    if (!handle->audio.use_float && !handle->audio.resampler)
       return;
 
-   if (data->frames > handle->audio.float_conv_frames)
-   {
-      handle->audio.float_conv = (float*)av_realloc(handle->audio.float_conv,
-            data->frames * handle->params.channels * sizeof(float));
-      if (!handle->audio.float_conv)
-         return;
-
-      handle->audio.float_conv_frames = data->frames;
-
-      /* To make sure we don't accidentially overflow. */
-      handle->audio.resample_out_frames = data->frames * handle->audio.ratio + 16;
-
-      handle->audio.resample_out = (float*)av_realloc(handle->audio.resample_out,
-            handle->audio.resample_out_frames *
-            handle->params.channels * sizeof(float));
-      if (!handle->audio.resample_out)
-         return;
-
-      handle->audio.fixed_conv_frames = max(handle->audio.resample_out_frames,
-            handle->audio.float_conv_frames);
-      handle->audio.fixed_conv = (int16_t*)av_realloc(handle->audio.fixed_conv,
-            handle->audio.fixed_conv_frames * handle->params.channels * sizeof(int16_t));
-      if (!handle->audio.fixed_conv)
-         return;
-   }
+   /* Pushes are a codec frame at most, which is what
+    * ffmpeg_init_audio() has reserved for already. */
+   if (!ffmpeg_audio_reserve(handle, data->frames))
+      return;
 
    if (handle->audio.use_float || handle->audio.resampler)
    {
@@ -1191,7 +2350,7 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 
       if (pkt.size)
       {
-         if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+         if (!ffmpeg_queue_packet(handle, &handle->audio_packets, &pkt))
             return false;
       }
    }
@@ -1202,10 +2361,10 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = fifo_read_avail(handle->audio_fifo);
+   size_t avail = fifo_spsc_read_avail(handle->audio_fifo);
    if (avail)
    {
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      fifo_spsc_read(handle->audio_fifo, audio_buf, avail);
 
       struct ffemu_audio_data aud = {0};
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
@@ -1218,7 +2377,7 @@ static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
    {
       AVPacket pkt;
       if (!encode_audio(handle, &pkt, true) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_queue_packet(handle, &handle->audio_packets, &pkt))
          break;
    }
 }
@@ -1229,15 +2388,28 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
    {
       AVPacket pkt;
       if (!encode_video(handle, &pkt, NULL) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_queue_packet(handle, &handle->video_packets, &pkt))
          break;
    }
 }
 
+/* Pops the next frame off attr_fifo. Copied frames are read
+ * into in_buf, mapped frames stay where they are. Dupes leave
+ * in_buf as it is, for a wrapped frame to be sent again. */
+static void ffmpeg_pop_video(ffmpeg_t *handle,
+      struct ff_video_attr *attr)
+{
+   fifo_spsc_read(handle->attr_fifo, attr, sizeof(*attr));
+   if (attr->release)
+      return;
+
+   fifo_spsc_read(handle->video_fifo, handle->video.in_buf,
+         attr->data.height * attr->data.pitch);
+   attr->data.data = handle->video.in_buf;
+}
+
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
-   void *video_buf = av_malloc(2 * handle->params.fb_width * 
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ? 
       (handle->audio.codec->frame_size * 
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1253,9 +2425,9 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
       if (handle->config.audio_enable)
       {
-         if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
+         if (fifo_spsc_read_avail(handle->audio_fifo) >= audio_buf_size)
          {
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+            fifo_spsc_read(handle->audio_fifo, audio_buf, audio_buf_size);
 
             struct ffemu_audio_data aud = {0};
             aud.frames = handle->audio.codec->frame_size;
@@ -1266,14 +2438,13 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      struct ffemu_video_data attr_buf;
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
+      struct ff_video_attr attr;
+      if (fifo_spsc_read_avail(handle->attr_fifo) >= sizeof(attr))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf, 
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+         ffmpeg_pop_video(handle, &attr);
+         ffmpeg_push_video_thread(handle, &attr);
+         if (attr.release)
+            attr.release(attr.userdata);
 
          did_work = true;
       }
@@ -1286,7 +2457,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1302,89 +2472,190 @@ static bool ffmpeg_finalize(void *data)
    /* Flush out data still in buffers (internal, and FFmpeg internal). */
    ffmpeg_flush_buffers(handle);
 
+   if (handle->video.stats.dropped_frames)
+      RARCH_WARN("[FFmpeg]: Dropped %u video frames.\n",
+            handle->video.stats.dropped_frames);
+   if (handle->video.stats.blocked_frames)
+      RARCH_WARN("[FFmpeg]: Main thread waited on the encoder %u times, "
+            "%u ms in total.\n", handle->video.stats.blocked_frames,
+            (unsigned)(handle->video.stats.blocked_usec / 1000));
+
    deinit_thread_buf(handle);
 
+   /* Asked for just before the thread went away. */
+   if (handle->replay.pending)
+   {
+      handle->replay.pending = false;
+      ffmpeg_replay_save(handle, handle->replay.path);
+   }
+
    /* Write final data. */
-   av_write_trailer(handle->muxer.ctx);
+   if (!handle->config.replay)
+      av_write_trailer(handle->muxer.ctx);
 
    return true;
 }
 
-static void ffmpeg_thread(void *data)
+static void ffmpeg_video_thread(void *data)
 {
    ffmpeg_t *ff = (ffmpeg_t*)data;
 
-   /* For some reason, FFmpeg has a tendency to crash 
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-   assert(video_buf);
+   rarch_trace_thread_name("Record video");
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_RECORD);
 
-   size_t audio_buf_size = ff->config.audio_enable ? 
-      (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
-   void *audio_buf = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
+   while (ff->alive)
+   {
+      struct ff_video_attr attr;
+
+      if (fifo_spsc_read_avail(ff->attr_fifo) < sizeof(attr))
+      {
+         sevent_wait(ff->video_wake);
+         continue;
+      }
+
+      ffmpeg_pop_video(ff, &attr);
+      sevent_signal(ff->space);
+
+      RARCH_PERFORMANCE_INIT(ffmpeg_encode_video);
+      RARCH_PERFORMANCE_START(ffmpeg_encode_video);
+      ffmpeg_push_video_thread(ff, &attr);
+      RARCH_PERFORMANCE_STOP(ffmpeg_encode_video);
+      if (attr.release)
+         attr.release(attr.userdata);
+   }
+}
+
+static void ffmpeg_audio_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
+
+   size_t audio_buf_size = ff->audio.codec->frame_size * 
+      ff->params.channels * sizeof(int16_t);
+   void *audio_buf = av_malloc(audio_buf_size);
+   assert(audio_buf);
+
+   rarch_trace_thread_name("Record audio");
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_RECORD);
 
    while (ff->alive)
    {
-      struct ffemu_video_data attr_buf;
+      size_t dropped;
 
-      bool avail_video = false;
-      bool avail_audio = false;
+      if (fifo_spsc_read_avail(ff->audio_fifo) < audio_buf_size)
+      {
+         sevent_wait(ff->audio_wake);
+         continue;
+      }
 
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
+      fifo_spsc_read(ff->audio_fifo, audio_buf, audio_buf_size);
+      sevent_signal(ff->space);
 
-      if (ff->config.audio_enable)
-         if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
+      slock_lock(ff->lock);
+      dropped                  = ff->audio.dropped_frames;
+      ff->audio.dropped_frames = 0;
       slock_unlock(ff->lock);
 
-      if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+      /* Timestamps are in output samples. */
+      if (dropped)
+         ff->audio.frame_cnt += (int64_t)(dropped *
+               (ff->audio.ratio ? ff->audio.ratio : 1.0) + 0.5);
 
-         slock_unlock(ff->cond_lock);
-      }
+      struct ffemu_audio_data aud = {0};
+      aud.frames = ff->audio.codec->frame_size;
+      aud.data = audio_buf;
+
+      RARCH_PERFORMANCE_INIT(ffmpeg_encode_audio);
+      RARCH_PERFORMANCE_START(ffmpeg_encode_audio);
+      ffmpeg_push_audio_thread(ff, &aud, true);
+      RARCH_PERFORMANCE_STOP(ffmpeg_encode_audio);
+   }
+
+   av_free(audio_buf);
+}
+
+static void ffmpeg_mux_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
+
+   rarch_trace_thread_name("Record mux");
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_RECORD);
 
-      if (avail_video)
+   for (;;)
+   {
+      char replay_path[PATH_MAX_LENGTH];
+      bool did_work    = false;
+      bool save_replay = false;
+      /* Read first, so that nothing queued before the encoders 
+       * exited is left behind. */
+      bool alive       = ff->mux_alive;
+
+      RARCH_PERFORMANCE_INIT(ffmpeg_mux);
+      RARCH_PERFORMANCE_START(ffmpeg_mux);
+
+      /* One packet of each in turn, the muxer interleaves. */
+      if (ffmpeg_mux_packet(ff, &ff->video_packets))
+         did_work = true;
+      if (ff->config.audio_enable && ffmpeg_mux_packet(ff, &ff->audio_packets))
+         did_work = true;
+
+      RARCH_PERFORMANCE_STOP(ffmpeg_mux);
+
+      slock_lock(ff->lock);
+      if (ff->replay.pending)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
+         av_strlcpy(replay_path, ff->replay.path, sizeof(replay_path));
+         ff->replay.pending = false;
+         save_replay        = true;
       }
+      slock_unlock(ff->lock);
 
-      if (avail_audio)
-      {
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+      /* Packets queue up meanwhile, as on any slow write. */
+      if (save_replay)
+         ffmpeg_replay_save(ff, replay_path);
 
-         struct ffemu_audio_data aud = {0};
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data = audio_buf;
+      if (did_work || save_replay)
+         continue;
 
-         ffmpeg_push_audio_thread(ff, &aud, true);
-      }
+      if (!alive)
+         break;
+
+      sevent_wait(ff->mux_wake);
    }
+}
 
-   av_free(video_buf);
-   av_free(audio_buf);
+static void ffmpeg_get_stats(void *data, struct ffemu_stats *stats)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+   struct rarch_perf_histogram *encode_time = &handle->video.encode_time;
+
+   *stats = handle->video.stats;
+
+   stats->queued_frames  = ffmpeg_fifo_queued(handle->attr_fifo) 
+      / sizeof(struct ff_video_attr);
+   stats->buffered_bytes = ffmpeg_fifo_queued(handle->video_fifo);
+
+   if (encode_time->count)
+   {
+      stats->encode_usec_avg = encode_time->total / encode_time->count;
+      stats->encode_usec_p95 = rarch_perf_histogram_percentile(encode_time, 95);
+      stats->encode_usec_max = encode_time->max;
+   }
+}
+
+static bool ffmpeg_save_replay(void *data, const char *path)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !handle->config.replay || !handle->mux_thread)
+      return false;
+
+   slock_lock(handle->lock);
+   av_strlcpy(handle->replay.path, path, sizeof(handle->replay.path));
+   handle->replay.pending = true;
+   slock_unlock(handle->lock);
+
+   sevent_signal(handle->mux_wake);
+   return true;
 }
 
 const ffemu_backend_t ffemu_ffmpeg = {
@@ -1394,5 +2665,8 @@ const ffemu_backend_t ffemu_ffmpeg = {
    ffmpeg_push_audio,
    ffmpeg_finalize,
    "ffmpeg",
+   ffmpeg_push_video_mapped,
+   ffmpeg_get_stats,
+   ffmpeg_save_replay,
 };
 
@@ -0,0 +1,337 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Publishes frames and audio to a POSIX shared memory object,
+ * for capture tools that would rather read them in place than
+ * decode an encoded stream. See shm.h for the layout. */
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <file/config_file.h>
+#include "../../general.h"
+#include "../../performance.h"
+#include "../record_driver.h"
+#include "shm.h"
+
+#define SHM_PREFIX "shm://"
+
+/* Keeps slots and the audio ring on their own cache lines. */
+#define SHM_ALIGN(x) (((x) + 63) & ~(uint64_t)63)
+
+typedef struct shm_record
+{
+   int fd;
+   char name[PATH_MAX];
+   uint8_t *map;
+   size_t size;
+
+   struct rarch_shm_header *header;
+   unsigned pixel_size;
+   unsigned channels;
+   /* Set up and accounted to RARCH_MEM_RECORD. */
+   bool published;
+} shm_record_t;
+
+static void shm_record_free(void *data)
+{
+   shm_record_t *handle = (shm_record_t*)data;
+
+   if (!handle)
+      return;
+
+   if (handle->map)
+   {
+      __sync_synchronize();
+      handle->header->closed = 1;
+      munmap(handle->map, handle->size);
+   }
+
+   if (handle->published)
+      rarch_mem_sub(RARCH_MEM_RECORD, handle->size);
+
+   /* Tools which already mapped it keep their mapping. */
+   if (handle->fd >= 0)
+   {
+      close(handle->fd);
+      shm_unlink(handle->name);
+   }
+
+   free(handle);
+}
+
+static void *shm_record_new(const struct ffemu_params *params)
+{
+   unsigned video_slots = 4, audio_ms = 500;
+   uint64_t slot_size, audio_size;
+   struct rarch_shm_header *header = NULL;
+   const char *name   = NULL;
+   shm_record_t *handle = NULL;
+
+   /* Only claims recordings to shm://<name>,
+    * anything else is left to the encoders. */
+   if (!params->filename || strncmp(params->filename,
+            SHM_PREFIX, strlen(SHM_PREFIX)) != 0)
+      return NULL;
+
+   name = params->filename + strlen(SHM_PREFIX);
+   if (!*name || strchr(name, '/'))
+   {
+      RARCH_ERR("[SHM]: Invalid shared memory name \"%s\".\n", name);
+      return NULL;
+   }
+
+   handle = (shm_record_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      return NULL;
+
+   handle->fd = -1;
+   snprintf(handle->name, sizeof(handle->name), "/%s", name);
+
+   if (params->config)
+   {
+      config_file_t *conf = config_file_new(params->config);
+
+      if (conf)
+      {
+         config_get_uint(conf, "video_slots", &video_slots);
+         config_get_uint(conf, "audio_buffer_ms", &audio_ms);
+         config_file_free(conf);
+      }
+   }
+
+   /* Needs a spare slot so the one being written is never
+    * the latest published. */
+   video_slots = max(video_slots, 2);
+
+   switch (params->pix_fmt)
+   {
+      case FFEMU_PIX_RGB565:
+         handle->pixel_size = 2;
+         break;
+      case FFEMU_PIX_BGR24:
+         handle->pixel_size = 3;
+         break;
+      case FFEMU_PIX_ARGB8888:
+      default:
+         handle->pixel_size = 4;
+         break;
+   }
+
+   handle->channels = params->channels;
+
+   slot_size  = SHM_ALIGN(sizeof(struct rarch_shm_frame) +
+         (uint64_t)params->fb_width * params->fb_height * handle->pixel_size);
+   audio_size = (uint64_t)params->samplerate * audio_ms / 1000;
+   audio_size = SHM_ALIGN(max(audio_size, 1) *
+         handle->channels * sizeof(int16_t));
+
+   handle->size = SHM_ALIGN(sizeof(*header)) +
+      video_slots * slot_size + audio_size;
+
+   handle->fd = shm_open(handle->name, O_CREAT | O_RDWR, 0600);
+   if (handle->fd < 0)
+   {
+      RARCH_ERR("[SHM]: Failed to open shared memory \"%s\".\n",
+            handle->name);
+      goto error;
+   }
+
+   /* Shrinking first zeroes whatever a previous run left behind. */
+   if (ftruncate(handle->fd, 0) < 0
+         || ftruncate(handle->fd, handle->size) < 0)
+      goto error;
+
+   handle->map = (uint8_t*)mmap(NULL, handle->size,
+         PROT_READ | PROT_WRITE, MAP_SHARED, handle->fd, 0);
+   if (handle->map == MAP_FAILED)
+   {
+      handle->map = NULL;
+      goto error;
+   }
+
+   header = (struct rarch_shm_header*)handle->map;
+   handle->header = header;
+
+   header->version         = RARCH_SHM_VERSION;
+   header->pix_fmt         = params->pix_fmt;
+   header->fps             = params->fps;
+   header->sample_rate     = params->samplerate;
+   header->channels        = handle->channels;
+   header->max_width       = params->fb_width;
+   header->max_height      = params->fb_height;
+   header->video_slots     = video_slots;
+   header->video_slot_size = slot_size;
+   header->video_offset    = SHM_ALIGN(sizeof(*header));
+   header->audio_size      = audio_size;
+   header->audio_offset    = header->video_offset + video_slots * slot_size;
+
+   /* Readers go by the magic, so it is the last thing set. */
+   __sync_synchronize();
+   header->magic           = RARCH_SHM_MAGIC;
+
+   RARCH_LOG("[SHM]: Publishing to shared memory \"%s\" "
+         "(%u frame slots, %u bytes).\n",
+         handle->name, video_slots, (unsigned)handle->size);
+
+   rarch_mem_add(RARCH_MEM_RECORD, handle->size);
+   handle->published = true;
+
+   return handle;
+
+error:
+   RARCH_ERR("[SHM]: Failed to set up shared memory \"%s\".\n",
+         handle->name);
+   shm_record_free(handle);
+   return NULL;
+}
+
+static bool shm_record_push_video(void *data,
+      const struct ffemu_video_data *video_data)
+{
+   unsigned y, width, height, pitch;
+   struct rarch_shm_frame *frame = NULL;
+   const uint8_t *src            = NULL;
+   uint8_t *dst                  = NULL;
+   shm_record_t *handle          = (shm_record_t*)data;
+   struct rarch_shm_header *header;
+
+   if (!handle || !video_data)
+      return false;
+
+   header = handle->header;
+   header->frame_count++;
+
+   /* Readers tell dupes apart from frame_count. */
+   if (video_data->is_dupe || !video_data->data)
+      return true;
+
+   width  = min(video_data->width, header->max_width);
+   height = min(video_data->height, header->max_height);
+   pitch  = width * handle->pixel_size;
+
+   frame = (struct rarch_shm_frame*)(handle->map + header->video_offset +
+         (header->frame_index % header->video_slots) *
+         header->video_slot_size);
+   dst   = (uint8_t*)(frame + 1);
+   src   = (const uint8_t*)video_data->data;
+
+   frame->seq++;
+   __sync_synchronize();
+
+   frame->width       = width;
+   frame->height      = height;
+   frame->pitch       = pitch;
+   frame->frame_count = header->frame_count;
+   frame->time_usec   = rarch_get_time_usec();
+
+   /* A negative pitch walks a bottom-up readback,
+    * which comes out top-down here. */
+   for (y = 0; y < height; y++, dst += pitch, src += video_data->pitch)
+      memcpy(dst, src, pitch);
+
+   __sync_synchronize();
+   frame->seq++;
+   __sync_synchronize();
+   header->frame_index++;
+
+   return true;
+}
+
+static bool shm_record_push_video_mapped(void *data,
+      const struct ffemu_video_data *video_data,
+      ffemu_release_cb_t release, void *userdata)
+{
+   /* The copy into the slot is all that reads the frame,
+    * so it goes back right away. */
+   bool ret = shm_record_push_video(data, video_data);
+
+   release(userdata);
+   return ret;
+}
+
+static bool shm_record_push_audio(void *data,
+      const struct ffemu_audio_data *audio_data)
+{
+   uint64_t bytes, written, pos, first;
+   const uint8_t *src   = NULL;
+   uint8_t *ring        = NULL;
+   shm_record_t *handle = (shm_record_t*)data;
+   struct rarch_shm_header *header;
+
+   if (!handle || !audio_data)
+      return false;
+
+   header = handle->header;
+   ring   = handle->map + header->audio_offset;
+   src    = (const uint8_t*)audio_data->data;
+   bytes  = (uint64_t)audio_data->frames *
+      handle->channels * sizeof(int16_t);
+   written = header->audio_written + bytes;
+
+   /* Only the tail of an oversized push can be kept. */
+   if (bytes > header->audio_size)
+   {
+      src   += bytes - header->audio_size;
+      bytes  = header->audio_size;
+   }
+
+   pos   = (written - bytes) % header->audio_size;
+   first = min(bytes, header->audio_size - pos);
+
+   memcpy(ring + pos, src, first);
+   memcpy(ring, src + first, bytes - first);
+
+   __sync_synchronize();
+   header->audio_written = written;
+
+   return true;
+}
+
+static bool shm_record_finalize(void *data)
+{
+   shm_record_t *handle = (shm_record_t*)data;
+
+   if (!handle)
+      return false;
+
+   __sync_synchronize();
+   handle->header->closed = 1;
+   return true;
+}
+
+const ffemu_backend_t ffemu_shm = {
+   shm_record_new,
+   shm_record_free,
+   shm_record_push_video,
+   shm_record_push_audio,
+   shm_record_finalize,
+   "shm",
+   shm_record_push_video_mapped,
+   NULL,
+   NULL,
+};
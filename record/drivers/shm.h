@@ -0,0 +1,102 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_SHM_RECORD_H
+#define __RARCH_SHM_RECORD_H
+
+/* Layout of the shared memory the "shm" record driver publishes
+ * to, for capture tools to read frames and audio from in place.
+ * Recording to "shm://<name>" creates the POSIX shared memory
+ * object "/<name>", laid out as:
+ *
+ *    struct rarch_shm_header
+ *    video_slots times, at video_offset + i * video_slot_size:
+ *       struct rarch_shm_frame, followed by the pixels
+ *    audio_size bytes of audio ring, at audio_offset
+ *
+ * Frames are written to slot frame_index % video_slots, behind a
+ * seqlock: seq is odd while the slot is being written. Readers
+ * take seq, copy or use the frame, then check seq is unchanged
+ * and even. The writer only wraps around onto a slot after
+ * video_slots - 1 newer frames, so readers keeping up never
+ * have to retry. Pixels are top-down, pitch bytes per row.
+ *
+ * Audio is interleaved signed 16-bit, written at
+ * audio_written % audio_size. Readers keep their own position
+ * and have been overrun once audio_written is more than
+ * audio_size past it.
+ *
+ * Counters are only ever increased, with a write barrier before
+ * each increase. All fields are native endian. */
+
+#include <stdint.h>
+
+#define RARCH_SHM_MAGIC   0x52534d31 /* "RSM1" */
+#define RARCH_SHM_VERSION 1
+
+/* Same values as enum ffemu_pix_format. */
+enum rarch_shm_pix_format
+{
+   RARCH_SHM_PIX_RGB565 = 0,
+   RARCH_SHM_PIX_BGR24,
+   RARCH_SHM_PIX_ARGB8888
+};
+
+struct rarch_shm_header
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Set once the stream is over, nothing more gets written. */
+   volatile uint32_t closed;
+   uint32_t pix_fmt;
+
+   double fps;
+   double sample_rate;
+   uint32_t channels;
+
+   /* Biggest frame that fits a slot. */
+   uint32_t max_width;
+   uint32_t max_height;
+
+   uint32_t video_slots;
+   uint64_t video_slot_size;
+   uint64_t video_offset;
+   uint64_t audio_size;
+   uint64_t audio_offset;
+
+   /* Frames published so far. The latest one is in slot
+    * (frame_index - 1) % video_slots. */
+   volatile uint64_t frame_index;
+   /* Frames the core ran, including dupes and drops,
+    * which are not published. */
+   volatile uint64_t frame_count;
+   /* Audio bytes published so far. */
+   volatile uint64_t audio_written;
+};
+
+struct rarch_shm_frame
+{
+   volatile uint32_t seq;
+   uint32_t width;
+   uint32_t height;
+   uint32_t pitch;
+   /* Value of frame_count for this frame. */
+   uint64_t frame_count;
+   /* Microseconds, on RetroArch's clock. */
+   int64_t time_usec;
+};
+
+#endif
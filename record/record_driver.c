@@ -24,6 +24,9 @@
 #endif
 
 static const ffemu_backend_t *ffemu_backends[] = {
+#ifdef HAVE_SHM
+   &ffemu_shm,
+#endif
 #ifdef HAVE_FFMPEG
    &ffemu_ffmpeg,
 #endif
@@ -69,7 +72,14 @@ bool ffemu_init_first(const ffemu_backend_t **backend, void **data,
 
    for (i = 0; ffemu_backends[i]; i++)
    {
-      void *handle = ffemu_backends[i]->init(params);
+      void *handle = NULL;
+
+      if (params->mapped_video && !ffemu_backends[i]->push_video_mapped)
+         continue;
+      if (params->replay_seconds && !ffemu_backends[i]->save_replay)
+         continue;
+
+      handle = ffemu_backends[i]->init(params);
 
       if (!handle)
          continue;
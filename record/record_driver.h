@@ -59,11 +59,18 @@ struct ffemu_params
    /* Input pixel format. */
    enum ffemu_pix_format pix_fmt;
 
-   /* Filename to dump to. */
+   /* Filename to dump to. Not used when replay_seconds is set. */
    const char *filename;
 
    /* Path to config. Optional. */
    const char *config;
+
+   /* Video comes through push_video_mapped(). */
+   bool mapped_video;
+
+   /* Nothing is written out as it comes in. Only the last
+    * replay_seconds of output are kept, for save_replay(). */
+   unsigned replay_seconds;
 };
 
 struct ffemu_video_data
@@ -81,6 +88,31 @@ struct ffemu_audio_data
    size_t frames;
 };
 
+/* Recorder health, see get_stats(). */
+struct ffemu_stats
+{
+   /* Video frames waiting for the encoder, now and at most. */
+   unsigned queued_frames;
+   unsigned max_queued_frames;
+   /* Frame data waiting for the encoder, and the budget for it. */
+   size_t buffered_bytes;
+   size_t buffer_size;
+   /* Frames dropped by the drop policy. */
+   unsigned dropped_frames;
+   /* Pushes which had to wait for room, stalling the caller, 
+    * and the time spent waiting. */
+   unsigned blocked_frames;
+   uint64_t blocked_usec;
+   /* Time taken to convert and encode one video frame. */
+   uint64_t encode_usec_avg;
+   uint64_t encode_usec_p95;
+   uint64_t encode_usec_max;
+};
+
+/* Hands a frame passed to push_video_mapped() back to its owner.
+ * Called from the recording thread. */
+typedef void (*ffemu_release_cb_t)(void *userdata);
+
 typedef struct ffemu_backend
 {
    void *(*init)(const struct ffemu_params *params);
@@ -89,9 +121,27 @@ typedef struct ffemu_backend
    bool  (*push_audio)(void *data, const struct ffemu_audio_data *audio_data);
    bool  (*finalize)(void *data);
    const char *ident;
+
+   /* Like push_video, but video_data->data is read in place 
+    * instead of being copied. @release is called once the frame
+    * is no longer needed, also when push_video_mapped fails. 
+    * Optional. */
+   bool  (*push_video_mapped)(void *data,
+         const struct ffemu_video_data *video_data,
+         ffemu_release_cb_t release, void *userdata);
+
+   /* Optional. */
+   void  (*get_stats)(void *data, struct ffemu_stats *stats);
+
+   /* Writes what is kept of a replay_seconds recording to
+    * @path, which gets the container's extension appended. 
+    * Returns once the save is queued, which does not hold up
+    * the recording. Optional. */
+   bool  (*save_replay)(void *data, const char *path);
 } ffemu_backend_t;
 
 extern const ffemu_backend_t ffemu_ffmpeg;
+extern const ffemu_backend_t ffemu_shm;
 
 /**
  * ffemu_find_backend:
@@ -58,6 +58,36 @@ void retro_set_default_callbacks(void *data);
  **/
 void retro_set_rewind_callbacks(void);
 
+/**
+ * retro_input_poll_late_begin:
+ *
+ * Called before running the core. With input_poll_late, 
+ * polls the core asks for until retro_input_poll_late_end() 
+ * are put off until its next input query. Also drops the 
+ * RetroPad buttons resolved for the last frame.
+ **/
+void retro_input_poll_late_begin(void);
+
+/**
+ * retro_input_poll_late_end:
+ *
+ * Called after running the core. Runs a poll still put off,
+ * so that input keeps being pumped for cores which never 
+ * query it after polling.
+ **/
+void retro_input_poll_late_end(void);
+
+/**
+ * retro_set_runahead_callbacks:
+ * @video          : present video frames.
+ * @audio          : output audio samples.
+ *
+ * Used by run-ahead to hide the output of frames that 
+ * will be rolled back. Passing true for both restores 
+ * the regular callbacks.
+ **/
+void retro_set_runahead_callbacks(bool video, bool audio);
+
 /**
  * retro_flush_audio:
  * @data                 : pointer to audio buffer.
@@ -25,6 +25,7 @@
 #include "dynamic.h"
 #include "content.h"
 #include "file_ops.h"
+#include "hash.h"
 #include <file/file_path.h>
 #include <file/dir_list.h>
 #include "general.h"
@@ -33,7 +34,14 @@
 #include <compat/strl.h>
 #include "screenshot.h"
 #include "performance.h"
+#include "frame_hash.h"
 #include "cheats.h"
+#include "runahead.h"
+#include "perf_governor.h"
+#ifdef HAVE_SHM
+#include "memory_share.h"
+#endif
+#include "content_scan.h"
 #include <compat/getopt.h>
 #include <compat/posix_string.h>
 #include "input/keyboard_line.h"
@@ -102,6 +110,43 @@ done:
    return retval;
 }
 
+static void take_screenshot_viewport_async_cb(void *buffer,
+      unsigned width, unsigned height, int pitch)
+{
+   char screenshot_path[PATH_MAX_LENGTH];
+   const char *screenshot_dir = g_settings.screenshot_directory;
+
+   if (!*g_settings.screenshot_directory)
+   {
+      fill_pathname_basedir(screenshot_path, g_extern.basename,
+            sizeof(screenshot_path));
+      screenshot_dir = screenshot_path;
+   }
+
+   if (!screenshot_dump_async(screenshot_dir, buffer, width, height,
+            pitch, SCALER_FMT_ARGB8888))
+      RARCH_WARN(RETRO_LOG_TAKE_SCREENSHOT_FAILED);
+}
+
+/**
+ * take_screenshot_viewport_async:
+ *
+ * Asks the video driver to read back the viewport of the 
+ * next frame, which is then encoded off the main thread. 
+ * Needs frames to keep coming, so it is not used while paused.
+ *
+ * Returns: true (1) if the readback was started, otherwise false (0).
+ **/
+static bool take_screenshot_viewport_async(void)
+{
+   if (g_extern.is_paused || !driver.video_poke
+         || !driver.video_poke->read_viewport_async)
+      return false;
+
+   return driver.video_poke->read_viewport_async(driver.video_data,
+         take_screenshot_viewport_async_cb);
+}
+
 static bool take_screenshot_raw(void)
 {
    char screenshot_path[PATH_MAX_LENGTH];
@@ -134,6 +179,7 @@ static bool take_screenshot_raw(void)
 static bool take_screenshot(void)
 {
    bool viewport_read = false;
+   bool viewport_async = false;
    bool ret = true;
    const char *msg = NULL;
 
@@ -149,7 +195,11 @@ static bool take_screenshot(void)
    /* Clear out message queue to avoid OSD fonts to appear on screenshot. */
    msg_queue_clear(g_extern.msg_queue);
 
+   /* The driver reads back before drawing the menu on top. */
    if (viewport_read)
+      viewport_async = take_screenshot_viewport_async();
+
+   if (viewport_read && !viewport_async)
    {
 #ifdef HAVE_MENU
       /* Avoid taking screenshot of GUI overlays. */
@@ -162,7 +212,9 @@ static bool take_screenshot(void)
          rarch_render_cached_frame();
    }
 
-   if (viewport_read)
+   if (viewport_async)
+      ret = true;
+   else if (viewport_read)
       ret = take_screenshot_viewport();
    else if (g_extern.frame_cache.data &&
          (g_extern.frame_cache.data != RETRO_HW_FRAME_BUFFER_VALID))
@@ -199,7 +251,7 @@ void rarch_recording_dump_frame(const void *data, unsigned width,
    ffemu_data.height  = height;
    ffemu_data.data    = data;
 
-   if (g_extern.record_gpu_buffer)
+   if (g_extern.record_gpu_buffer || g_extern.record_gpu_mapped)
    {
       struct rarch_viewport vp = {0};
 
@@ -228,6 +280,39 @@ void rarch_recording_dump_frame(const void *data, unsigned width,
          return;
       }
 
+      if (g_extern.record_gpu_mapped)
+      {
+         struct video_mapped_frame frame = {0};
+
+         /* The recorder reads the frame straight out of 
+          * driver memory and hands it back when done. */
+         if (!driver.video_poke->read_viewport_mapped(driver.video_data,
+                  &frame))
+            return;
+
+         ffemu_data.data   = frame.data;
+         ffemu_data.width  = frame.width;
+         ffemu_data.height = frame.height;
+         ffemu_data.pitch  = frame.pitch;
+
+         driver.recording->push_video_mapped(driver.recording_data,
+               &ffemu_data, frame.release, frame.userdata);
+         return;
+      }
+
+      /* The driver showed the last frame again without running
+       * the shader chain, so the recorder can repeat what it
+       * encoded last rather than read back the same picture. */
+      if (driver.video_poke && driver.video_poke->frame_repeated
+            && driver.video_poke->frame_repeated(driver.video_data))
+      {
+         ffemu_data.is_dupe = true;
+         if (driver.recording && driver.recording->push_video)
+            driver.recording->push_video(driver.recording_data,
+                  &ffemu_data);
+         return;
+      }
+
       /* Big bottleneck.
        * Since we might need to do read-backs asynchronously,
        * it might take 3-4 times before this returns true. */
@@ -245,7 +330,7 @@ void rarch_recording_dump_frame(const void *data, unsigned width,
       ffemu_data.pitch  = -ffemu_data.pitch;
    }
 
-   if (!g_extern.record_gpu_buffer)
+   if (!g_extern.record_gpu_buffer && !g_extern.record_gpu_mapped)
       ffemu_data.is_dupe = !data;
 
    if (driver.recording && driver.recording->push_video)
@@ -263,8 +348,10 @@ static bool init_recording(void)
 {
    struct ffemu_params params = {0};
    const struct retro_system_av_info *info = &g_extern.system.av_info;
+   /* Recording to a file takes the place of the replay buffer. */
+   bool replay = !g_extern.recording_enable && g_settings.replay_buffer;
 
-   if (!g_extern.recording_enable)
+   if (!g_extern.recording_enable && !replay)
       return false;
 
    if (g_extern.libretro_dummy)
@@ -289,12 +376,13 @@ static bool init_recording(void)
    params.fb_width   = info->geometry.max_width;
    params.fb_height  = info->geometry.max_height;
    params.channels   = 2;
-   params.filename   = g_extern.record_path;
+   params.filename   = replay ? NULL : g_extern.record_path;
    params.fps        = g_extern.system.av_info.timing.fps;
    params.samplerate = g_extern.system.av_info.timing.sample_rate;
    params.pix_fmt    = (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888) ?
       FFEMU_PIX_ARGB8888 : FFEMU_PIX_RGB565;
    params.config     = NULL;
+   params.replay_seconds = replay ? g_settings.replay_buffer : 0;
    
    if (*g_extern.record_config)
       params.config = g_extern.record_config;
@@ -331,11 +419,24 @@ static bool init_recording(void)
       RARCH_LOG("Detected viewport of %u x %u\n",
             vp.width, vp.height);
 
-      g_extern.record_gpu_buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
-      if (!g_extern.record_gpu_buffer)
+      /* Skip copying readbacks out if the driver can lend them. */
+      if (driver.video_poke && driver.video_poke->read_viewport_mapped
+            && driver.video_poke->read_viewport_mapped(
+               driver.video_data, NULL))
       {
-         RARCH_ERR("Failed to allocate GPU record buffer.\n");
-         return false;
+         RARCH_LOG("Recording from mapped GPU readbacks.\n");
+         params.pix_fmt             = FFEMU_PIX_ARGB8888;
+         params.mapped_video        = true;
+         g_extern.record_gpu_mapped = true;
+      }
+      else
+      {
+         g_extern.record_gpu_buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
+         if (!g_extern.record_gpu_buffer)
+         {
+            RARCH_ERR("Failed to allocate GPU record buffer.\n");
+            return false;
+         }
       }
    }
    else
@@ -370,7 +471,7 @@ static bool init_recording(void)
    }
 
    RARCH_LOG("Recording to %s @ %ux%u. (FB size: %ux%u pix_fmt: %u)\n",
-         g_extern.record_path,
+         replay ? "replay buffer" : g_extern.record_path,
          params.out_width, params.out_height,
          params.fb_width, params.fb_height,
          (unsigned)params.pix_fmt);
@@ -383,6 +484,94 @@ static bool init_recording(void)
       return false;
    }
 
+   g_extern.record_replay = replay;
+   return true;
+}
+
+/**
+ * save_replay:
+ *
+ * Writes the replay buffer to replay_directory, falling back
+ * to the screenshot directory and then the content directory.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool save_replay(void)
+{
+   char replay_dir[PATH_MAX_LENGTH], replay_name[PATH_MAX_LENGTH];
+   char replay_path[PATH_MAX_LENGTH];
+   bool ret = false;
+
+   if (g_extern.record_replay && driver.recording
+         && driver.recording->save_replay)
+   {
+      if (*g_settings.replay_directory)
+         strlcpy(replay_dir, g_settings.replay_directory, sizeof(replay_dir));
+      else if (*g_settings.screenshot_directory)
+         strlcpy(replay_dir, g_settings.screenshot_directory,
+               sizeof(replay_dir));
+      else
+         fill_pathname_basedir(replay_dir, g_extern.basename,
+               sizeof(replay_dir));
+
+      /* The recorder adds the extension. */
+      fill_dated_filename(replay_name, "", sizeof(replay_name));
+      replay_name[strlen(replay_name) - 1] = '\0';
+      fill_pathname_join(replay_path, replay_dir, replay_name,
+            sizeof(replay_path));
+
+      ret = driver.recording->save_replay(driver.recording_data,
+            replay_path);
+   }
+
+   if (ret)
+      RARCH_LOG("Saving replay to \"%s\".\n", replay_path);
+   else
+      RARCH_WARN(RETRO_LOG_SAVE_REPLAY_FAILED);
+
+   msg_queue_push(g_extern.msg_queue, ret ? RETRO_MSG_SAVE_REPLAY
+         : RETRO_MSG_SAVE_REPLAY_FAILED, 1, 180);
+
+   return ret;
+}
+
+/**
+ * save_trace:
+ *
+ * Writes the perf counter trace to the screenshot directory,
+ * falling back to the content directory.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool save_trace(void)
+{
+   char trace_dir[PATH_MAX_LENGTH], trace_name[PATH_MAX_LENGTH];
+   char trace_path[PATH_MAX_LENGTH];
+
+   if (!g_extern.perfcnt_enable)
+   {
+      msg_queue_push(g_extern.msg_queue,
+            RETRO_MSG_TRACE_DUMP_NO_PERFCNT, 1, 180);
+      return false;
+   }
+
+   if (*g_settings.screenshot_directory)
+      strlcpy(trace_dir, g_settings.screenshot_directory, sizeof(trace_dir));
+   else
+      fill_pathname_basedir(trace_dir, g_extern.basename, sizeof(trace_dir));
+
+   fill_dated_filename(trace_name, "json", sizeof(trace_name));
+   fill_pathname_join(trace_path, trace_dir, trace_name, sizeof(trace_path));
+
+   if (!rarch_trace_dump(trace_path))
+   {
+      RARCH_WARN(RETRO_LOG_TRACE_DUMP_FAILED);
+      msg_queue_push(g_extern.msg_queue, RETRO_MSG_TRACE_DUMP_FAILED, 1, 180);
+      return false;
+   }
+
+   RARCH_LOG("Trace written to \"%s\".\n", trace_path);
+   msg_queue_push(g_extern.msg_queue, RETRO_MSG_TRACE_DUMP, 1, 180);
    return true;
 }
 
@@ -540,6 +729,7 @@ static void print_help(void)
    puts("\t--spectate: Netplay will become spectating mode.");
    puts("\t\tHost can live stream the game content to users that connect.");
    puts("\t\tHowever, the client will not be able to play. Multiple clients can connect to the host.");
+   puts("\t--relay: When spectating, re-broadcast the stream to other spectators on this port.");
 #endif
    puts("\t--nick: Picks a username (for use with netplay). Not mandatory.");
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
@@ -547,7 +737,7 @@ static void print_help(void)
    puts("\t\tAvailable commands are listed if command is invalid.");
 #endif
 
-   puts("\t-r/--record: Path to record video file.\n\t\tUsing .mkv extension is recommended.");
+   puts("\t-r/--record: Path to record video file.\n\t\tUsing .mkv extension is recommended.\n\t\tshm://<name> publishes raw frames to shared memory instead.");
    puts("\t--recordconfig: Path to settings used during recording.");
    puts("\t--size: Overrides output video size when recording (format: WIDTHxHEIGHT).");
    puts("\t-v/--verbose: Verbose logging.");
@@ -556,7 +746,14 @@ static void print_help(void)
    puts("\t--ips: Specifies path for IPS patch that will be applied to content.");
    puts("\t--no-patch: Disables all forms of content patching.");
    puts("\t-D/--detach: Detach " RETRO_FRONTEND " from the running console. Not relevant for all platforms.");
-   puts("\t--max-frames: Runs for the specified number of frames, then exits.\n");
+   puts("\t--max-frames: Runs for the specified number of frames, then exits.");
+   puts("\t--benchmark: Runs the specified number of frames as fast as possible with\n\t\t"
+         "null video, audio and input drivers, then prints where the time went.\n\t\t"
+         "Combine with --bsvplay for deterministic input.");
+   puts("\t--hash-record: Writes the CRC32 and time of every frame to a file.");
+   puts("\t--hash-check: Compares the CRC32 of every frame with a file --hash-record\n\t\t"
+         "wrote, and exits with an error if any differ.");
+   puts("\t--scan: Scans a directory for content known to the databases,\n\t\tadds it to playlists, then exits.\n");
 }
 
 static void set_basename(const char *path)
@@ -711,6 +908,7 @@ static void parse_input(int argc, char *argv[])
    *g_extern.ips_name = '\0';
 
    *g_extern.subsystem = '\0';
+   *g_extern.scan_dir = '\0';
 
    if (argc < 2)
    {
@@ -750,6 +948,7 @@ static void parse_input(int argc, char *argv[])
       { "frames", 1, NULL, 'F' },
       { "port", 1, &val, 'p' },
       { "spectate", 0, &val, 'S' },
+      { "relay", 1, &val, 'r' },
 #endif
       { "nick", 1, &val, 'N' },
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
@@ -763,7 +962,11 @@ static void parse_input(int argc, char *argv[])
       { "features", 0, &val, 'f' },
       { "subsystem", 1, NULL, 'Z' },
       { "max-frames", 1, NULL, 'm' },
+      { "benchmark", 1, &val, 'b' },
+      { "hash-record", 1, &val, 'y' },
+      { "hash-check", 1, &val, 'k' },
       { "eof-exit", 0, &val, 'e' },
+      { "scan", 1, &val, 'D' },
       { NULL, 0, NULL, 0 }
    };
 
@@ -983,6 +1186,10 @@ static void parse_input(int argc, char *argv[])
                   g_extern.netplay_is_spectate = true;
                   break;
 
+               case 'r':
+                  g_extern.netplay_relay_port = strtoul(optarg, NULL, 0);
+                  break;
+
 #endif
                case 'N':
                   g_extern.has_set_username = true;
@@ -1044,6 +1251,26 @@ static void parse_input(int argc, char *argv[])
                   g_extern.bsv.eof_exit = true;
                   break;
 
+               case 'b':
+                  g_extern.benchmark.enable = true;
+                  g_extern.max_frames = strtoul(optarg, NULL, 10);
+                  break;
+
+               case 'y':
+                  strlcpy(g_extern.frame_hash_record_path, optarg,
+                        sizeof(g_extern.frame_hash_record_path));
+                  break;
+
+               case 'k':
+                  strlcpy(g_extern.frame_hash_check_path, optarg,
+                        sizeof(g_extern.frame_hash_check_path));
+                  break;
+
+               case 'D':
+                  strlcpy(g_extern.scan_dir, optarg,
+                        sizeof(g_extern.scan_dir));
+                  break;
+
                default:
                   break;
             }
@@ -1212,7 +1439,8 @@ static void init_rewind(void)
          (unsigned)(g_settings.rewind_buffer_size / 1000000));
 
    g_extern.state_manager = state_manager_new(g_extern.state_size,
-         g_settings.rewind_buffer_size);
+         g_settings.rewind_buffer_size, g_settings.rewind_keyframe_interval,
+         g_settings.rewind_threaded, g_settings.rewind_compression);
 
    if (!g_extern.state_manager)
       RARCH_WARN(RETRO_LOG_REWIND_INIT_FAILED);
@@ -1305,7 +1533,12 @@ static bool init_netplay(void)
          g_settings.username);
 
    if (driver.netplay_data)
+   {
+      if (g_extern.netplay_relay_port)
+         netplay_spectate_relay((netplay_t*)driver.netplay_data,
+               g_extern.netplay_relay_port);
       return true;
+   }
 
    g_extern.netplay_is_client = false;
    RARCH_WARN(RETRO_LOG_INIT_NETPLAY_FAILED);
@@ -1321,7 +1554,8 @@ static bool init_netplay(void)
 #ifdef HAVE_COMMAND
 static void init_command(void)
 {
-   if (!g_settings.stdin_cmd_enable && !g_settings.network_cmd_enable)
+   if (!g_settings.stdin_cmd_enable && !g_settings.network_cmd_enable
+         && !g_settings.command_server_enable)
       return;
 
    if (g_settings.stdin_cmd_enable && driver.stdin_claimed)
@@ -1333,7 +1567,15 @@ static void init_command(void)
    if (!(driver.command = rarch_cmd_new(g_settings.stdin_cmd_enable
                && !driver.stdin_claimed,
                g_settings.network_cmd_enable, g_settings.network_cmd_port)))
+   {
       RARCH_ERR("Failed to initialize command interface.\n");
+      return;
+   }
+
+   if (g_settings.command_server_enable)
+      rarch_cmd_server_start(driver.command,
+            g_settings.command_server_port,
+            g_settings.command_server_path);
 }
 #endif
 
@@ -1585,6 +1827,226 @@ static bool save_auto_state(void)
    return true;
 }
 
+/**
+ * resume_snapshot_state_path:
+ * @s                    : output path.
+ * @len                  : size of @s.
+ *
+ * The savestate of the resume snapshot, next to its
+ * config with .state in place of the extension.
+ **/
+static void resume_snapshot_state_path(char *s, size_t len)
+{
+   fill_pathname(s, g_settings.resume_snapshot_path, ".state", len);
+}
+
+static bool resume_snapshot_state_crc(const char *path, uint32_t *crc)
+{
+   void *buf = NULL;
+   ssize_t size;
+
+   content_flush_saves();
+
+   if ((size = read_file(path, &buf)) < 0)
+      return false;
+
+   *crc = crc32_calculate((const uint8_t*)buf, size);
+   free(buf);
+   return true;
+}
+
+/**
+ * save_resume_snapshot:
+ *
+ * Saves the core, content and a savestate to come back
+ * to when started without content next time.
+ *
+ * Returns: true if a snapshot was saved.
+ **/
+static bool save_resume_snapshot(void)
+{
+   uint32_t crc;
+   char state_path[PATH_MAX_LENGTH];
+   config_file_t *conf = NULL;
+   bool ret            = false;
+
+   if (!g_settings.resume_snapshot_enable || g_extern.libretro_dummy ||
+         g_extern.libretro_no_content || *g_extern.subsystem)
+      return false;
+
+   resume_snapshot_state_path(state_path, sizeof(state_path));
+
+   /* The CRC ties the state to the config written after it, a
+    * state without its config is not restored. */
+   if (!save_state(state_path) || !resume_snapshot_state_crc(state_path, &crc))
+      goto end;
+
+   if (!(conf = config_file_new(NULL)))
+      goto end;
+
+   config_set_path(conf, "core_path", g_settings.libretro);
+   config_set_path(conf, "content_path", g_extern.fullpath);
+   config_set_hex(conf, "state_crc", crc);
+
+   ret = config_file_write(conf, g_settings.resume_snapshot_path);
+   config_file_free(conf);
+
+end:
+   RARCH_LOG("Resume snapshot to \"%s\" %s.\n",
+         g_settings.resume_snapshot_path, ret ? "succeeded" : "failed");
+   return ret;
+}
+
+/**
+ * load_resume_snapshot:
+ *
+ * Picks the core and content of the resume snapshot, if it is
+ * enabled and RetroArch was started without content. The state
+ * is restored by init_core() once the content is loaded.
+ *
+ * Returns: true if the snapshot was picked, config has to
+ * be loaded again for the core.
+ **/
+static bool load_resume_snapshot(void)
+{
+   char core_path[PATH_MAX_LENGTH], content_path[PATH_MAX_LENGTH];
+   unsigned crc        = 0;
+   config_file_t *conf = NULL;
+   bool ret            = false;
+
+   if (!g_settings.resume_snapshot_enable || g_extern.libretro_dummy ||
+         !g_extern.libretro_no_content || g_extern.has_set_libretro ||
+         *g_extern.subsystem)
+      return false;
+
+   if (!(conf = config_file_new(g_settings.resume_snapshot_path)))
+      return false;
+
+   if (config_get_path(conf, "core_path", core_path, sizeof(core_path))
+         && config_get_path(conf, "content_path",
+            content_path, sizeof(content_path))
+         && config_get_hex(conf, "state_crc", &crc)
+         && path_file_exists(core_path) && path_file_exists(content_path))
+   {
+      RARCH_LOG("Resuming \"%s\" from snapshot \"%s\".\n",
+            content_path, g_settings.resume_snapshot_path);
+
+      strlcpy(g_settings.libretro, core_path, sizeof(g_settings.libretro));
+      g_extern.has_set_libretro    = true;
+      g_extern.libretro_no_content = false;
+      set_paths(content_path);
+
+      g_extern.resume.pending   = true;
+      g_extern.resume.state_crc = crc;
+      ret = true;
+   }
+
+   config_file_free(conf);
+   return ret;
+}
+
+/**
+ * restore_resume_snapshot:
+ *
+ * Loads the savestate of the resume snapshot picked by
+ * load_resume_snapshot(), if it still goes with it.
+ **/
+static void restore_resume_snapshot(void)
+{
+   uint32_t crc;
+   char state_path[PATH_MAX_LENGTH];
+
+   if (!g_extern.resume.pending)
+      return;
+   g_extern.resume.pending = false;
+
+   resume_snapshot_state_path(state_path, sizeof(state_path));
+
+   if (!resume_snapshot_state_crc(state_path, &crc)
+         || crc != g_extern.resume.state_crc)
+   {
+      RARCH_WARN("Resume snapshot state \"%s\" does not match its snapshot, "
+            "starting content afresh.\n", state_path);
+      return;
+   }
+
+   if (!load_state(state_path))
+      RARCH_ERR("Failed to restore resume snapshot state \"%s\".\n",
+            state_path);
+}
+
+#ifdef HAVE_ZLIB_DEFLATE
+/* Where the pending viewport readback goes, see
+ * save_state_thumbnail(). */
+static char state_thumbnail_path[PATH_MAX_LENGTH];
+
+static void save_state_thumbnail_viewport_cb(void *buffer,
+      unsigned width, unsigned height, int pitch)
+{
+   if (!screenshot_dump_file_async(state_thumbnail_path, buffer,
+            width, height, pitch, SCALER_FMT_ARGB8888))
+      RARCH_WARN("Failed to save savestate thumbnail.\n");
+}
+
+/**
+ * save_state_thumbnail:
+ * @path                 : path of the savestate.
+ *
+ * Saves the current frame next to the savestate, as
+ * "<path>.png". The frame is only copied here, it is
+ * encoded on the thread pool. Hardware rendered frames need
+ * the asynchronous viewport readback, without it they get
+ * no thumbnail rather than stalling on the GPU.
+ **/
+static void save_state_thumbnail(const char *path)
+{
+   unsigned i;
+   bool viewport_read;
+   uint8_t *frame             = NULL;
+   const uint8_t *data        = (const uint8_t*)g_extern.frame_cache.data;
+   unsigned width             = g_extern.frame_cache.width;
+   unsigned height            = g_extern.frame_cache.height;
+   size_t pitch               = g_extern.frame_cache.pitch;
+   enum scaler_pix_fmt fmt    = SCALER_FMT_RGB565;
+
+   /* A cut short name would land next to the wrong savestate. */
+   if (snprintf(state_thumbnail_path, sizeof(state_thumbnail_path),
+            "%s.png", path) >= (int)sizeof(state_thumbnail_path))
+      return;
+
+   viewport_read = (g_settings.video.gpu_screenshot ||
+         g_extern.system.hw_render_callback.context_type
+         != RETRO_HW_CONTEXT_NONE) && driver.video->read_viewport &&
+      driver.video->viewport_info;
+
+   if (viewport_read)
+   {
+      if (!g_extern.is_paused && driver.video_poke
+            && driver.video_poke->read_viewport_async)
+         driver.video_poke->read_viewport_async(driver.video_data,
+               save_state_thumbnail_viewport_cb);
+      return;
+   }
+
+   if (!data || data == RETRO_HW_FRAME_BUFFER_VALID || !width || !height)
+      return;
+
+   if (!(frame = (uint8_t*)malloc(height * pitch)))
+      return;
+
+   /* The encoder takes frames bottom-up. */
+   for (i = 0; i < height; i++)
+      memcpy(frame + i * pitch, data + (height - 1 - i) * pitch, pitch);
+
+   if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+      fmt = SCALER_FMT_ARGB8888;
+
+   if (!screenshot_dump_file_async(state_thumbnail_path, frame,
+            width, height, pitch, fmt))
+      RARCH_WARN("Failed to save savestate thumbnail.\n");
+}
+#endif
+
 /* Save or load state here. */
 
 static void rarch_load_state(const char *path,
@@ -1609,6 +2071,11 @@ static void rarch_save_state(const char *path,
 {
    if (save_state(path))
    {
+#ifdef HAVE_ZLIB_DEFLATE
+      if (g_settings.savestate_thumbnail_enable)
+         save_state_thumbnail(path);
+#endif
+
       if (g_settings.state_slot < 0)
          snprintf(msg, sizeof_msg,
                "Saved state to slot #-1 (auto).");
@@ -1621,18 +2088,30 @@ static void rarch_save_state(const char *path,
             "Failed to save state to \"%s\".", path);
 }
 
-static void main_state(unsigned cmd)
+/**
+ * rarch_state_slot_path:
+ * @path                 : output path.
+ * @size                 : size of @path.
+ *
+ * Path of the savestate in the current slot.
+ **/
+void rarch_state_slot_path(char *path, size_t size)
 {
-   char path[PATH_MAX_LENGTH], msg[PATH_MAX_LENGTH];
-
    if (g_settings.state_slot > 0)
-      snprintf(path, sizeof(path), "%s%d",
+      snprintf(path, size, "%s%d",
             g_extern.savestate_name, g_settings.state_slot);
    else if (g_settings.state_slot < 0)
-      snprintf(path, sizeof(path), "%s.auto",
+      snprintf(path, size, "%s.auto",
             g_extern.savestate_name);
    else
-      strlcpy(path, g_extern.savestate_name, sizeof(path));
+      strlcpy(path, g_extern.savestate_name, size);
+}
+
+static void main_state(unsigned cmd)
+{
+   char path[PATH_MAX_LENGTH], msg[PATH_MAX_LENGTH];
+
+   rarch_state_slot_path(path, sizeof(path));
 
    if (pretro_serialize_size())
    {
@@ -1853,6 +2332,35 @@ static void free_temporary_content(void)
    string_list_free(g_extern.temporary_content);
 }
 
+#ifdef HAVE_THREADS
+static sthread_pool_t *thread_pool;
+
+static void thread_pool_init(void *data, unsigned idx)
+{
+   (void)data;
+   (void)idx;
+
+   rarch_thread_role_apply(RARCH_THREAD_ROLE_WORKER);
+}
+
+sthread_pool_t *rarch_get_thread_pool(void)
+{
+   unsigned cores;
+
+   if (thread_pool)
+      return thread_pool;
+
+   cores = rarch_get_cpu_cores();
+   thread_pool = sthread_pool_new_init(cores > 1 ? cores - 1 : 0,
+         thread_pool_init, NULL);
+   if (thread_pool)
+      RARCH_LOG("Created thread pool with %u threads.\n",
+            sthread_pool_threads(thread_pool));
+
+   return thread_pool;
+}
+#endif
+
 static void main_clear_state_extern(void)
 {
    /* XXX This memset is really dangerous.
@@ -1868,6 +2376,15 @@ static void main_clear_state_extern(void)
    rarch_main_command(RARCH_CMD_LOG_FILE_DEINIT);
    rarch_main_command(RARCH_CMD_HISTORY_DEINIT);
 
+   screenshot_deinit();
+
+#ifdef HAVE_THREADS
+   /* Drivers are gone by now, so nobody uses the pool anymore. */
+   if (thread_pool)
+      sthread_pool_free(thread_pool);
+   thread_pool = NULL;
+#endif
+
    memset(&g_extern, 0, sizeof(g_extern));
 }
 
@@ -1978,6 +2495,37 @@ static void validate_cpu_features(void)
 #endif
 }
 
+/**
+ * init_benchmark:
+ *
+ * Overrides the config for --benchmark: null drivers, nothing
+ * that waits on a clock, and performance counters on, so that
+ * frames run back to back and only cost CPU time.
+ **/
+static void init_benchmark(void)
+{
+   if (!g_extern.benchmark.enable)
+      return;
+
+   strlcpy(g_settings.video.driver, "null", sizeof(g_settings.video.driver));
+   strlcpy(g_settings.audio.driver, "null", sizeof(g_settings.audio.driver));
+   strlcpy(g_settings.input.driver, "null", sizeof(g_settings.input.driver));
+   strlcpy(g_settings.input.joypad_driver, "null",
+         sizeof(g_settings.input.joypad_driver));
+
+   g_settings.video.vsync                     = false;
+   g_settings.video.threaded                  = false;
+   g_settings.video.frame_delay               = 0;
+   g_settings.video.frame_delay_auto          = false;
+   g_settings.audio.sync                      = false;
+   g_settings.fastforward_ratio_throttle_enable = false;
+   g_settings.rewind_enable                   = false;
+   g_extern.perfcnt_enable                    = true;
+
+   if (!g_extern.max_frames && !g_extern.bsv.eof_exit)
+      RARCH_WARN("--benchmark without a frame count runs until quit.\n");
+}
+
 static void init_system_av_info(void)
 {
    pretro_get_system_av_info(&g_extern.system.av_info);
@@ -1986,18 +2534,29 @@ static void init_system_av_info(void)
 
 static void deinit_core(void)
 {
+#ifdef HAVE_SHM
+   memory_share_deinit();
+#endif
+   runahead_deinit();
+
    pretro_unload_game();
    pretro_deinit();
 
    rarch_main_command(RARCH_CMD_DRIVERS_DEINIT);
+   rarch_latency_test_deinit();
 
    uninit_libretro_sym();
 }
 
 static bool init_core(void)
 {
+   bool ret;
+
    verify_api_version();
+
+   rarch_timeline_begin("retro_init");
    pretro_init();
+   rarch_timeline_end();
 
    g_extern.use_sram = !g_extern.libretro_dummy &&
       !g_extern.libretro_no_content;
@@ -2007,7 +2566,11 @@ static bool init_core(void)
       if (!g_extern.libretro_no_content)
          fill_pathnames();
 
-      if (!init_content_file())
+      rarch_timeline_begin("init_content_file");
+      ret = init_content_file();
+      rarch_timeline_end();
+
+      if (!ret)
          return false;
 
       if (!g_extern.libretro_no_content)
@@ -2018,6 +2581,7 @@ static bool init_core(void)
             RARCH_LOG("Skipping SRAM load.\n");
 
          load_auto_state();
+         restore_resume_snapshot();
 
          rarch_main_command(RARCH_CMD_BSV_MOVIE_INIT);
          rarch_main_command(RARCH_CMD_NETPLAY_INIT);
@@ -2027,6 +2591,10 @@ static bool init_core(void)
    retro_init_libretro_cbs(&driver.retro_ctx);
    init_system_av_info();
 
+#ifdef HAVE_SHM
+   memory_share_init();
+#endif
+
    return true;
 }
 
@@ -2039,10 +2607,43 @@ static bool init_core(void)
  *
  * Returns: 0 on success, otherwise 1 if there was an error.
  **/
+/**
+ * scan_content:
+ *
+ * Scans the directory passed with --scan against the databases
+ * in the content database directory. Playlists are written next
+ * to the content history playlist.
+ *
+ * Returns: number of content files matched, -1 on error.
+ **/
+static int scan_content(void)
+{
+   char playlist_dir[PATH_MAX_LENGTH];
+
+   if (!*g_settings.content_database)
+   {
+      RARCH_ERR("No content database directory set, cannot scan.\n");
+      return -1;
+   }
+
+   if (*g_settings.content_history_path)
+      fill_pathname_basedir(playlist_dir, g_settings.content_history_path,
+            sizeof(playlist_dir));
+   else
+      strlcpy(playlist_dir, g_settings.content_database,
+            sizeof(playlist_dir));
+
+   return content_scan_directory(g_extern.scan_dir,
+         g_settings.content_database, playlist_dir);
+}
+
 int rarch_main_init(int argc, char *argv[])
 {
    int sjlj_ret;
+   bool ret;
 
+   rarch_timeline_begin("rarch_main_init");
+   rarch_trace_init();
    init_state();
 
    if ((sjlj_ret = setjmp(g_extern.error_sjlj_context)) > 0)
@@ -2065,16 +2666,52 @@ int rarch_main_init(int argc, char *argv[])
    }
 
    validate_cpu_features();
+
+   rarch_timeline_begin("config_load");
    config_load();
 
+   /* Again for the config of the snapshot's core. */
+   if (load_resume_snapshot())
+      config_load();
+   rarch_timeline_end();
+
+#if defined(HAVE_THREADS) && defined(__GNUC__)
+   if (g_settings.log_async_enable && !rarch_log_async_init())
+      RARCH_WARN("[Log]: Could not start the log thread.\n");
+#endif
+
+   init_benchmark();
+
+   if (!frame_hash_init(g_extern.frame_hash_record_path,
+            g_extern.frame_hash_check_path))
+      rarch_fail(1, "frame_hash_init()");
+
+   if (*g_extern.scan_dir)
+      exit(scan_content() < 0 ? 1 : 0);
+
+   rarch_timeline_begin("init_libretro_sym");
    init_libretro_sym(g_extern.libretro_dummy);
    init_system_info();
+   rarch_timeline_end();
 
    init_drivers_pre();
 
-   if (!rarch_main_command(RARCH_CMD_CORE_INIT))
+   rarch_timeline_begin("init_core");
+   ret = rarch_main_command(RARCH_CMD_CORE_INIT);
+   rarch_timeline_end();
+
+   if (!ret)
       goto error;
 
+   /* Content-less cores do not play movies, and waiting
+    * for the end of one would never end. */
+   if (g_extern.benchmark.enable && g_extern.bsv.movie_start_playback
+         && !g_extern.bsv.movie)
+   {
+      RARCH_ERR("Nothing to benchmark, the movie did not start.\n");
+      goto error;
+   }
+
    rarch_main_command(RARCH_CMD_DRIVERS_INIT);
    rarch_main_command(RARCH_CMD_COMMAND_INIT);
    rarch_main_command(RARCH_CMD_REWIND_INIT);
@@ -2086,12 +2723,14 @@ int rarch_main_init(int argc, char *argv[])
 
    g_extern.error_in_init = false;
    g_extern.main_is_init  = true;
+   rarch_timeline_end();
    return 0;
 
 error:
    rarch_main_command(RARCH_CMD_CORE_DEINIT);
 
    g_extern.main_is_init = false;
+   rarch_timeline_end();
    return 1;
 }
 
@@ -2179,12 +2818,16 @@ void rarch_main_set_state(unsigned cmd)
          /* Override keyboard callback to redirect to menu instead.
           * We'll use this later for something ...
           * FIXME: This should probably be moved to menu_common somehow. */
+         input_keyboard_event_flush();
          g_extern.frontend_key_event = g_extern.system.key_event;
          g_extern.system.key_event   = menu_input_key_event;
 
          driver.menu->need_refresh = true;
          g_extern.system.frame_time_last = 0;
          g_extern.is_menu = true;
+
+         /* Likely to load a state from the menu. */
+         rarch_main_command(RARCH_CMD_PREFETCH_STATE);
 #endif
          break;
       case RARCH_ACTION_STATE_LOAD_CONTENT:
@@ -2211,6 +2854,7 @@ void rarch_main_set_state(unsigned cmd)
          driver.flushing_input = true;
 
          /* Restore libretro keyboard callback. */
+         input_keyboard_event_flush();
          g_extern.system.key_event = g_extern.frontend_key_event;
 #endif
          if (driver.video_data && driver.video_poke &&
@@ -2419,10 +3063,29 @@ bool rarch_main_command(unsigned cmd)
 
          main_state(cmd);
          break;
+      case RARCH_CMD_PREFETCH_STATE:
+         {
+            char path[PATH_MAX_LENGTH];
+
+            if (!pretro_serialize_size() || g_extern.libretro_dummy)
+               return false;
+
+            rarch_state_slot_path(path, sizeof(path));
+            content_prefetch_state(path);
+         }
+         break;
       case RARCH_CMD_TAKE_SCREENSHOT:
          if (!take_screenshot())
             return false;
          break;
+      case RARCH_CMD_SAVE_REPLAY:
+         if (!save_replay())
+            return false;
+         break;
+      case RARCH_CMD_TRACE_DUMP:
+         if (!save_trace())
+            return false;
+         break;
       case RARCH_CMD_PREPARE_DUMMY:
          *g_extern.fullpath = '\0';
 
@@ -2457,6 +3120,8 @@ bool rarch_main_command(unsigned cmd)
          if (g_extern.cheat)
             cheat_manager_free(g_extern.cheat);
          g_extern.cheat = NULL;
+         cheat_search_free(g_extern.cheat_search);
+         g_extern.cheat_search = NULL;
          break;
       case RARCH_CMD_CHEATS_INIT:
          rarch_main_command(RARCH_CMD_CHEATS_DEINIT);
@@ -2468,7 +3133,11 @@ bool rarch_main_command(unsigned cmd)
             return false;
 #endif
          if (g_extern.state_manager)
+         {
+            if (g_extern.perfcnt_enable)
+               state_manager_benchmark(g_extern.state_manager);
             state_manager_free(g_extern.state_manager);
+         }
          g_extern.state_manager = NULL;
          break;
       case RARCH_CMD_REWIND_INIT:
@@ -2581,6 +3250,7 @@ bool rarch_main_command(unsigned cmd)
          if (g_extern.record_gpu_buffer)
             free(g_extern.record_gpu_buffer);
          g_extern.record_gpu_buffer = NULL;
+         g_extern.record_gpu_mapped = false;
          break;
       case RARCH_CMD_RECORD_DEINIT:
          if (!driver.recording_data || !driver.recording)
@@ -2594,6 +3264,7 @@ bool rarch_main_command(unsigned cmd)
 
          driver.recording_data = NULL;
          driver.recording = NULL;
+         g_extern.record_replay = false;
 
          rarch_main_command(RARCH_CMD_GPU_RECORD_DEINIT);
          break;
@@ -2627,7 +3298,9 @@ bool rarch_main_command(unsigned cmd)
          if (*g_settings.libretro_directory &&
                !g_extern.core_info)
          {
+            rarch_timeline_begin("core_info_list_new");
             g_extern.core_info = core_info_list_new(g_settings.libretro_directory);
+            rarch_timeline_end();
 #ifdef HAVE_MENU
             if (driver.menu_ctx && driver.menu_ctx->init_core_info)
                driver.menu_ctx->init_core_info(driver.menu);
@@ -2974,6 +3647,7 @@ bool rarch_main_command(unsigned cmd)
          }
          break;
       case RARCH_CMD_PERFCNT_REPORT_FRONTEND_LOG:
+         rarch_benchmark_report();
          rarch_perf_log();
          break;
    }
@@ -2999,9 +3673,12 @@ void rarch_main_deinit(void)
 
    rarch_main_command(RARCH_CMD_REWIND_DEINIT);
    rarch_main_command(RARCH_CMD_CHEATS_DEINIT);
+   rarch_perf_governor_deinit();
    rarch_main_command(RARCH_CMD_BSV_MOVIE_DEINIT);
+   frame_hash_deinit();
 
    rarch_main_command(RARCH_CMD_AUTOSAVE_STATE);
+   save_resume_snapshot();
 
    rarch_main_command(RARCH_CMD_CORE_DEINIT);
 
@@ -3009,6 +3686,9 @@ void rarch_main_deinit(void)
    rarch_main_command(RARCH_CMD_SUBSYSTEM_FULLPATHS_DEINIT);
    rarch_main_command(RARCH_CMD_SAVEFILES_DEINIT);
 
+   content_prefetch_state(NULL);
+   content_flush_saves();
+
    g_extern.main_is_init = false;
 }
 
@@ -3138,6 +3818,17 @@ bool rarch_replace_config(const char *path)
    return true;
 }
 
+bool rarch_cache_path(char *s, size_t len, const char *name)
+{
+   if (*g_settings.cache_directory)
+      fill_pathname_join(s, g_settings.cache_directory, name, len);
+   else if (*g_extern.config_path)
+      fill_pathname_resolve_relative(s, g_extern.config_path, name, len);
+   else
+      return false;
+   return true;
+}
+
 void rarch_update_system_info(struct retro_system_info *_info,
       bool *load_no_content)
 {
@@ -19,6 +19,10 @@
 
 #include <boolean.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreadpool.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,8 +39,14 @@ enum basic_event
    RARCH_CMD_LOAD_CORE,
    RARCH_CMD_LOAD_STATE,
    RARCH_CMD_SAVE_STATE,
+   /* Reads the state of the current slot ahead of loading it. */
+   RARCH_CMD_PREFETCH_STATE,
    /* Takes screenshot. */
    RARCH_CMD_TAKE_SCREENSHOT,
+   /* Writes out the replay buffer. */
+   RARCH_CMD_SAVE_REPLAY,
+   /* Writes out the perf counter trace. */
+   RARCH_CMD_TRACE_DUMP,
    /* Initializes dummy core. */
    RARCH_CMD_PREPARE_DUMMY,
    /* Quits RetroArch. */
@@ -260,6 +270,15 @@ void rarch_main_deinit(void);
  **/
 void rarch_render_cached_frame(void);
 
+/**
+ * rarch_state_slot_path:
+ * @path                 : output path.
+ * @size                 : size of @path.
+ *
+ * Path of the savestate in the current slot.
+ **/
+void rarch_state_slot_path(char *path, size_t size);
+
 /**
  * rarch_disk_control_set_eject:
  * @new_state            : Eject or close the virtual drive tray.
@@ -311,6 +330,20 @@ void rarch_recording_dump_frame(const void *data, unsigned width,
  **/
 bool rarch_replace_config(const char *path);
 
+/**
+ * rarch_cache_path:
+ * @s                    : output path.
+ * @len                  : size of @s.
+ * @name                 : name of the cache file or directory.
+ *
+ * Places a cache in cache_directory, or next to the config
+ * file if that is not set. Instances pointed at the same
+ * cache_directory share their caches.
+ *
+ * Returns: false if there is nowhere to keep the cache.
+ **/
+bool rarch_cache_path(char *s, size_t len, const char *name);
+
 /**
  * rarch_playlist_load_content:
  * @playlist             : Playlist handle.
@@ -344,6 +377,20 @@ int rarch_defer_core(core_info_list_t *data,
 void rarch_update_system_info(struct retro_system_info *info,
       bool *load_no_content);
 
+#ifdef HAVE_THREADS
+/**
+ * rarch_get_thread_pool:
+ *
+ * Gets the task pool shared by all subsystems, creating 
+ * it on first use. It has a worker less than there are 
+ * cores, since threads waiting on it run tasks as well.
+ * Must be called from the main thread.
+ *
+ * Returns: thread pool, or NULL if it could not be created.
+ **/
+sthread_pool_t *rarch_get_thread_pool(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
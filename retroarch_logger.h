@@ -48,6 +48,9 @@
 #include "logger/xdk1_logger_override.h"
 #elif defined(ANDROID) && defined(HAVE_LOGGER) && defined(RARCH_INTERNAL)
 #include "logger/android_logger_override.h"
+#elif defined(HAVE_THREADS) && defined(__GNUC__) && defined(RARCH_INTERNAL) \
+   && !defined(IS_SALAMANDER) && !defined(IS_JOYCONFIG)
+#include "logger/async_logger.h"
 #else
 
 #ifndef RARCH_LOG
@@ -22,6 +22,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifndef UINT16_MAX
 #define UINT16_MAX 0xffff
 #endif
@@ -39,10 +43,24 @@
 #define NO_UNALIGNED_MEM
 #endif
 
+/* The delta scanners may read past the end of a block. 
+ * state_manager_new() reserves REWIND_BLOCK_PADDING bytes 
+ * behind every block so the widest vector load stays in bounds. */
+#define REWIND_BLOCK_PADDING 32
+
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
-repeat {
+uint16 type; /* REWIND_ENTRY_* */
+if (type == REWIND_ENTRY_DELTA_LZ || type == REWIND_ENTRY_KEYFRAME_LZ)
+{
+   uint32 rawsize; /* as two native uint16s, low first */
+   uint8[] lz; /* LZ of what would follow type otherwise, padded to uint16;
+                * deltas use the newer state as dictionary */
+}
+else if (type == REWIND_ENTRY_KEYFRAME)
+   uint16[blocksize / 2] state; /* the complete state */
+else repeat {
    uint16 numchanged; /* everything is counted in units of uint16 */
    if (numchanged)
    {
@@ -59,6 +77,34 @@ repeat {
 size thisstart;
 #endif
 
+#define REWIND_ENTRY_DELTA       0
+#define REWIND_ENTRY_KEYFRAME    1
+#define REWIND_ENTRY_DELTA_LZ    2
+#define REWIND_ENTRY_KEYFRAME_LZ 3
+
+/* Second-stage LZ, in the spirit of LZ4: a token byte with the
+ * literal count in the high and the match length - 4 in the low
+ * nibble (15 meaning more follow in 255-continued bytes), the
+ * literals, then a little endian uint16 offset back. The last
+ * sequence has literals only. */
+#define REWIND_LZ_HASH_BITS 12
+/* Deltas are compressed with the newer state, which the decoder
+ * has as well, as a dictionary; that catches data moved around
+ * in memory. Every Nth position of it is looked up. */
+#define REWIND_LZ_DICT_BITS 16
+#define REWIND_LZ_DICT_STEP 8
+#define REWIND_LZ_MIN_MATCH 4
+/* The last match ends this far before the end of the input,
+ * the last literals take at least that. */
+#define REWIND_LZ_LAST_LITERALS 5
+
+/* The LZ stage is judged over this many compressed states. */
+#define REWIND_LZ_WINDOW 32
+/* While it does not pay off, only every Nth state is tried. */
+#define REWIND_LZ_PROBE 16
+/* Average cost per state at which it stops paying off. */
+#define REWIND_LZ_MAX_USEC 1000
+
 /* The start offsets point to 'nextstart' of any given compressed frame.
  * Each uint16 is stored native endian; anything that claims any other 
  * endianness refers to the endianness of this specific item.
@@ -80,6 +126,19 @@ size thisstart;
  * unused at any given moment. */
 
 
+typedef size_t (*rewind_find_func_t)(const uint16_t *a, const uint16_t *b);
+
+/* Index entry for a keyframe in the ring buffer. */
+struct rewind_keyframe
+{
+   /* Offset of the entry ('nextstart' of it). */
+   size_t start;
+   /* Offset of the head right after the entry was written. */
+   size_t end;
+   /* Serial number of the entry. */
+   uint64_t serial;
+};
+
 /* These are called very few constant times per frame, 
  * keep it as simple as possible. */
 static inline void write_size_t(void *ptr, size_t val)
@@ -99,6 +158,8 @@ struct state_manager
 {
    uint8_t *data;
    size_t capacity;
+   /* Accounted to RARCH_MEM_REWIND. */
+   size_t mem_size;
    /* Reading and writing is done here here. */
    uint8_t *head;
    /* If head comes close to this, discard a frame. */
@@ -117,11 +178,65 @@ struct state_manager
 
    unsigned entries;
    bool thisblock_valid;
+
+   /* Serial number of the newest entry in the ring buffer.
+    * Counts up on push, down on pop. */
+   uint64_t serial;
+
+   /* Every keyframe_interval'th entry is stored in full instead 
+    * of as a delta. This lets state_manager_seek() skip over 
+    * everything newer than the keyframe. 0 disables keyframes. */
+   unsigned keyframe_interval;
+
+   /* Ring of keyframes currently in the buffer, oldest first. */
+   struct rewind_keyframe *keyframes;
+   size_t keyframes_max;
+   size_t keyframes_first;
+   size_t keyframes_count;
+
+   /* Delta scanners, picked at init based on CPU features. */
+   rewind_find_func_t find_change;
+   rewind_find_func_t find_same;
+
+   /* Second-stage LZ, NULL if disabled. lzblock holds a delta
+    * before compressing and after decompressing it. */
+   uint8_t *lzblock;
+   uint32_t *lztable;
+   uint32_t *lzdtable;
+   bool lz_enabled;
+   /* What the LZ stage did over the current window. */
+   unsigned lz_count;
+   uint64_t lz_in;
+   uint64_t lz_out;
+   retro_time_t lz_usec;
+
+#ifdef HAVE_THREADS
+   /* Threaded mode. The worker compresses job_old against job_new
+    * into the ring buffer while the frontend serializes the next
+    * state into nextblock. spareblock is the third buffer of the
+    * rotation; it is handed back once the worker is idle. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *spareblock;
+   const uint8_t *job_old;
+   const uint8_t *job_new;
+   bool job_pending;
+   bool quit;
+#endif
 };
 
-state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
+static void state_manager_init_scanners(state_manager_t *state);
+
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data);
+#endif
+
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size,
+      unsigned keyframe_interval, bool threaded, bool compress)
 {
    size_t newblocksize;
+   unsigned blocks;
    int maxcblks;
    const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
    state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
@@ -133,15 +248,16 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    state->blocksize = newblocksize;
 
    maxcblks = (state->blocksize + maxcblkcover - 1) / maxcblkcover;
-   state->maxcompsize = state->blocksize + maxcblks * sizeof(uint16_t) * 2 +
+   state->maxcompsize = sizeof(uint16_t) + state->blocksize +
+      maxcblks * sizeof(uint16_t) * 2 +
       sizeof(uint16_t) + sizeof(uint32_t) + sizeof(size_t) * 2;
 
    state->data = (uint8_t*)malloc(buffer_size);
 
    state->thisblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
+      calloc(state->blocksize + sizeof(uint16_t) * 4 + REWIND_BLOCK_PADDING, 1);
    state->nextblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
+      calloc(state->blocksize + sizeof(uint16_t) * 4 + REWIND_BLOCK_PADDING, 1);
    if (!state->data || !state->thisblock || !state->nextblock)
       goto error;
 
@@ -154,7 +270,7 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
     * There is also some padding at the end. This is so we don't 
     * read outside the buffer end if we're reading in large blocks;
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get 
+    * It doesn't make any difference to us, but sacrificing a few bytes to get 
     * Valgrind happy is worth it. */
    *(uint16_t*)(state->thisblock + state->blocksize + sizeof(uint16_t) * 3) =
       0xFFFF;
@@ -163,9 +279,74 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 
    state->capacity = buffer_size;
 
+   if (keyframe_interval)
+   {
+      /* A keyframe takes up at least a full block. */
+      state->keyframe_interval = keyframe_interval;
+      state->keyframes_max     = buffer_size / state->blocksize + 1;
+      state->keyframes         = (struct rewind_keyframe*)
+         calloc(state->keyframes_max, sizeof(*state->keyframes));
+      if (!state->keyframes)
+         goto error;
+   }
+
+   state_manager_init_scanners(state);
+
+   if (compress)
+   {
+      state->lzblock = (uint8_t*)malloc(state->maxcompsize);
+      state->lztable = (uint32_t*)
+         malloc(sizeof(uint32_t) << REWIND_LZ_HASH_BITS);
+      state->lzdtable = (uint32_t*)
+         malloc(sizeof(uint32_t) << REWIND_LZ_DICT_BITS);
+      if (!state->lzblock || !state->lztable || !state->lzdtable)
+         goto error;
+
+      /* Gets a full window to prove itself first. */
+      state->lz_enabled = true;
+   }
+
    state->head = state->data + sizeof(size_t);
    state->tail = state->data + sizeof(size_t);
 
+#ifdef HAVE_THREADS
+   if (threaded)
+   {
+      state->spareblock = (uint8_t*)
+         calloc(state->blocksize + sizeof(uint16_t) * 4 + REWIND_BLOCK_PADDING, 1);
+      state->lock = slock_new();
+      state->cond = scond_new();
+      if (!state->spareblock || !state->lock || !state->cond)
+         goto error;
+
+      /* The blocks rotate through all three pairings, so the spare
+       * needs a marker that differs from both of the others. */
+      *(uint16_t*)(state->spareblock + state->blocksize + sizeof(uint16_t) * 3) =
+         0x5555;
+
+      state->thread = sthread_create(state_manager_thread, state);
+      if (!state->thread)
+         goto error;
+   }
+#else
+   (void)threaded;
+#endif
+
+   blocks = 2;
+#ifdef HAVE_THREADS
+   if (state->spareblock)
+      blocks++;
+#endif
+
+   state->mem_size = buffer_size + state->keyframes_max *
+      sizeof(*state->keyframes) + blocks *
+      (state->blocksize + sizeof(uint16_t) * 4 + REWIND_BLOCK_PADDING);
+   if (state->lzblock)
+      state->mem_size += state->maxcompsize +
+         (sizeof(uint32_t) << REWIND_LZ_HASH_BITS) +
+         (sizeof(uint32_t) << REWIND_LZ_DICT_BITS);
+   rarch_mem_add(RARCH_MEM_REWIND, state->mem_size);
+
    return state;
 
 error:
@@ -178,12 +359,339 @@ void state_manager_free(state_manager_t *state)
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   if (state->thread)
+   {
+      slock_lock(state->lock);
+      state->quit = true;
+      scond_broadcast(state->cond);
+      slock_unlock(state->lock);
+      sthread_join(state->thread);
+   }
+
+   if (state->lock)
+      slock_free(state->lock);
+   if (state->cond)
+      scond_free(state->cond);
+   free(state->spareblock);
+#endif
+
+   rarch_mem_sub(RARCH_MEM_REWIND, state->mem_size);
+
+   free(state->keyframes);
+   free(state->lzblock);
+   free(state->lztable);
+   free(state->lzdtable);
    free(state->data);
    free(state->thisblock);
    free(state->nextblock);
    free(state);
 }
 
+static inline uint32_t rewind_lz_read32(const uint8_t *ptr)
+{
+   uint32_t val;
+
+   memcpy(&val, ptr, sizeof(val));
+   return val;
+}
+
+static uint8_t *rewind_lz_write_length(uint8_t *out, size_t len)
+{
+   for (; len >= 255; len -= 255)
+      *out++ = 255;
+   *out++ = len;
+   return out;
+}
+
+/**
+ * rewind_lz_compress:
+ * @in                 : data to compress.
+ * @size               : size of @in, in bytes.
+ * @dict               : data the decompressor has as well, or NULL.
+ * @dictsize           : size of @dict, in bytes.
+ * @out                : output buffer.
+ * @max                : size of @out, in bytes.
+ * @table              : 1 << REWIND_LZ_HASH_BITS entries of scratch.
+ * @dtable             : 1 << REWIND_LZ_DICT_BITS entries of scratch.
+ *
+ * Returns: size of the compressed data, or 0 if it
+ * does not fit into @max bytes.
+ **/
+static size_t rewind_lz_compress(const uint8_t *in, size_t size,
+      const uint8_t *dict, size_t dictsize,
+      uint8_t *out, size_t max, uint32_t *table, uint32_t *dtable)
+{
+   const uint8_t *ip     = in;
+   const uint8_t *anchor = in;
+   const uint8_t *end    = in + size;
+   uint8_t *op           = out;
+   uint8_t *oend         = out + max;
+   size_t lits;
+
+   memset(table, 0, sizeof(uint32_t) << REWIND_LZ_HASH_BITS);
+
+   if (dict)
+   {
+      size_t i;
+
+      memset(dtable, 0, sizeof(uint32_t) << REWIND_LZ_DICT_BITS);
+      for (i = 0; i + REWIND_LZ_MIN_MATCH <= dictsize;
+            i += REWIND_LZ_DICT_STEP)
+         dtable[(rewind_lz_read32(dict + i) * 2654435761u) >>
+            (32 - REWIND_LZ_DICT_BITS)] = i + 1;
+   }
+
+   if (size > REWIND_LZ_MIN_MATCH + REWIND_LZ_LAST_LITERALS * 2)
+   {
+      const uint8_t *limit = end - REWIND_LZ_LAST_LITERALS * 2;
+
+      while (ip < limit)
+      {
+         const uint8_t *ref, *match, *base = in, *base_end = ip;
+         uint32_t seq  = rewind_lz_read32(ip);
+         uint32_t hash = seq * 2654435761u;
+         uint32_t h    = hash >> (32 - REWIND_LZ_HASH_BITS);
+         size_t len, offset;
+         uint8_t *token;
+
+         ref      = in + table[h];
+         table[h] = ip - in;
+
+         if (ref >= ip || ip - ref > 0xffff ||
+               rewind_lz_read32(ref) != seq)
+         {
+            uint32_t pos = dict ?
+               dtable[hash >> (32 - REWIND_LZ_DICT_BITS)] : 0;
+
+            if (!pos || rewind_lz_read32(dict + pos - 1) != seq)
+            {
+               /* Skip faster through data which does not compress.
+                * Dictionary positions are sampled, stepping over
+                * them would lose the matches. */
+               ip += dict ? 1 : 1 + ((ip - anchor) >> 6);
+               continue;
+            }
+
+            ref      = dict + pos - 1;
+            base     = dict;
+            base_end = dict + dictsize;
+         }
+
+         while (ip > anchor && ref > base && ip[-1] == ref[-1])
+         {
+            ip--;
+            ref--;
+         }
+
+         offset = base == in ? (size_t)(ip - ref) : 0;
+
+         match = ip + REWIND_LZ_MIN_MATCH;
+         ref  += REWIND_LZ_MIN_MATCH;
+         while (match < end - REWIND_LZ_LAST_LITERALS &&
+               ref < base_end && *match == *ref)
+         {
+            match++;
+            ref++;
+         }
+
+         lits = ip - anchor;
+         len  = match - ip - REWIND_LZ_MIN_MATCH;
+
+         if ((size_t)(oend - op) < 1 + lits / 255 + 1 + lits +
+               2 + 4 + len / 255 + 1)
+            return 0;
+
+         token = op++;
+         *token = (lits >= 15 ? 15 : lits) << 4;
+         if (lits >= 15)
+            op = rewind_lz_write_length(op, lits - 15);
+         memcpy(op, anchor, lits);
+         op += lits;
+
+         /* Offset 0 stands for a position in the dictionary. */
+         *op++ = offset;
+         *op++ = offset >> 8;
+         if (!offset)
+         {
+            size_t pos = ref - (match - ip) - dict;
+
+            *op++ = pos;
+            *op++ = pos >> 8;
+            *op++ = pos >> 16;
+            *op++ = pos >> 24;
+         }
+
+         *token |= len >= 15 ? 15 : len;
+         if (len >= 15)
+            op = rewind_lz_write_length(op, len - 15);
+
+         ip     = match;
+         anchor = ip;
+      }
+   }
+
+   lits = end - anchor;
+   if ((size_t)(oend - op) < 1 + lits / 255 + 1 + lits)
+      return 0;
+
+   *op++ = (lits >= 15 ? 15 : lits) << 4;
+   if (lits >= 15)
+      op = rewind_lz_write_length(op, lits - 15);
+   memcpy(op, anchor, lits);
+   op += lits;
+
+   return op - out;
+}
+
+static size_t rewind_lz_read_length(const uint8_t **in, size_t len)
+{
+   uint8_t byte;
+
+   if (len != 15)
+      return len;
+
+   do
+   {
+      byte = *(*in)++;
+      len += byte;
+   } while (byte == 255);
+
+   return len;
+}
+
+/**
+ * rewind_lz_decompress:
+ * @in                 : data from rewind_lz_compress().
+ * @dict               : the dictionary it was compressed with, or NULL.
+ * @out                : output buffer.
+ * @size               : size of the uncompressed data, in bytes.
+ **/
+static void rewind_lz_decompress(const uint8_t *in, const uint8_t *dict,
+      uint8_t *out, size_t size)
+{
+   uint8_t *op   = out;
+   uint8_t *oend = out + size;
+
+   for (;;)
+   {
+      const uint8_t *ref;
+      size_t len, offset;
+      uint8_t token = *in++;
+
+      len = rewind_lz_read_length(&in, token >> 4);
+      memcpy(op, in, len);
+      op += len;
+      in += len;
+
+      if (op >= oend)
+         break;
+
+      offset = in[0] | (in[1] << 8);
+      in    += 2;
+      if (offset)
+         ref = op - offset;
+      else
+      {
+         ref = dict + (in[0] | (in[1] << 8) | ((size_t)in[2] << 16) |
+               ((size_t)in[3] << 24));
+         in += 4;
+      }
+
+      len = rewind_lz_read_length(&in, token & 15) + REWIND_LZ_MIN_MATCH;
+
+      /* Matches may overlap what they copy. */
+      while (len--)
+         *op++ = *ref++;
+   }
+}
+
+/**
+ * state_manager_lz_judge:
+ * @state              : state manager handle.
+ *
+ * Decides whether the LZ stage pays off for the states of
+ * this core, once a window of them was compressed.
+ **/
+static void state_manager_lz_judge(state_manager_t *state)
+{
+   bool enable;
+
+   if (++state->lz_count < REWIND_LZ_WINDOW)
+      return;
+
+   /* Worth it if it saves an eighth at bearable cost. */
+   enable = state->lz_out * 8 <= state->lz_in * 7 &&
+      state->lz_usec <= (retro_time_t)REWIND_LZ_MAX_USEC * state->lz_count;
+
+   if (enable != state->lz_enabled)
+      RARCH_LOG("Rewind: %s LZ stage, %u%% of the size at %u usec per state.\n",
+            enable ? "Enabling" : "Disabling",
+            (unsigned)(state->lz_out * 100 / (state->lz_in ? state->lz_in : 1)),
+            (unsigned)(state->lz_usec / state->lz_count));
+
+   state->lz_enabled = enable;
+   state->lz_count   = 0;
+   state->lz_in      = 0;
+   state->lz_out     = 0;
+   state->lz_usec    = 0;
+}
+
+static struct rewind_keyframe *keyframe_at(state_manager_t *state,
+      size_t i)
+{
+   return &state->keyframes[(state->keyframes_first + i)
+      % state->keyframes_max];
+}
+
+static struct rewind_keyframe *keyframe_newest(state_manager_t *state)
+{
+   if (!state->keyframes_count)
+      return NULL;
+   return keyframe_at(state, state->keyframes_count - 1);
+}
+
+/**
+ * state_manager_discard_tail:
+ * @state              : state manager handle.
+ *
+ * Drops the oldest entry of the ring buffer.
+ **/
+static void state_manager_discard_tail(state_manager_t *state)
+{
+   size_t tailpos = state->tail - state->data;
+
+   if (state->keyframes_count && keyframe_at(state, 0)->start == tailpos)
+   {
+      state->keyframes_first = (state->keyframes_first + 1)
+         % state->keyframes_max;
+      state->keyframes_count--;
+   }
+
+   state->tail = state->data + read_size_t(state->tail);
+   state->entries--;
+}
+
+/**
+ * state_manager_wait:
+ * @state              : state manager handle.
+ *
+ * Waits until the worker thread (if any) has finished 
+ * writing the last pushed delta to the ring buffer.
+ **/
+static void state_manager_wait(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (!state->thread)
+      return;
+
+   slock_lock(state->lock);
+   while (state->job_pending)
+      scond_wait(state->cond, state->lock);
+   slock_unlock(state->lock);
+#endif
+}
+
 bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
@@ -194,6 +702,8 @@ bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data = NULL;
 
+   state_manager_wait(state);
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid = false;
@@ -207,6 +717,10 @@ bool state_manager_pop(state_manager_t *state, const void **data)
 
    start = read_size_t(state->head - sizeof(size_t));
    state->head = state->data + start;
+   state->serial--;
+
+   if (keyframe_newest(state) && keyframe_newest(state)->start == start)
+      state->keyframes_count--;
 
    compressed = state->data + start + sizeof(size_t);
    out = state->thisblock;
@@ -216,6 +730,33 @@ bool state_manager_pop(state_manager_t *state, const void **data)
    compressed16 = (const uint16_t*)compressed;
    out16 = (uint16_t*)out;
 
+   if (compressed16[0] == REWIND_ENTRY_DELTA_LZ ||
+         compressed16[0] == REWIND_ENTRY_KEYFRAME_LZ)
+   {
+      bool keyframe    = compressed16[0] == REWIND_ENTRY_KEYFRAME_LZ;
+      uint32_t rawsize = compressed16[1] | ((uint32_t)compressed16[2] << 16);
+
+      /* Keyframes have to decode on their own, for seeking. */
+      rewind_lz_decompress((const uint8_t*)(compressed16 + 3),
+            keyframe ? NULL : out, keyframe ? out : state->lzblock, rawsize);
+
+      if (keyframe)
+      {
+         state->entries--;
+         *data = state->thisblock;
+         return true;
+      }
+
+      compressed16 = (const uint16_t*)state->lzblock;
+   }
+   else if (*compressed16++ == REWIND_ENTRY_KEYFRAME)
+   {
+      memcpy(out, compressed16, state->blocksize);
+      state->entries--;
+      *data = state->thisblock;
+      return true;
+   }
+
    for (;;)
    {
       uint16_t i;
@@ -272,7 +813,6 @@ void state_manager_push_where(state_manager_t *state, void **data)
    *data = state->nextblock;
 }
 
-#if __SSE2__
 #if defined(__GNUC__)
 static inline int compat_ctz(unsigned x)
 {
@@ -297,35 +837,24 @@ static inline int compat_ctz(unsigned x)
 }
 #endif
 
+#if defined(__SSE2__)
 #include <emmintrin.h>
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
+#endif
 
-static inline size_t find_change(const uint16_t *a, const uint16_t *b)
-{
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-	
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi32(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
+#if defined(CPU_X86) && defined(__GNUC__) && \
+   (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define HAVE_REWIND_AVX2 1
+#endif
 
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-			return ret | (a[ret] == b[ret]);
-      }
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
-      a128++;
-      b128++;
-   }
-}
-#else
-static inline size_t find_change(const uint16_t *a, const uint16_t *b)
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all. */
+
+static size_t find_change_c(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -356,9 +885,8 @@ static inline size_t find_change(const uint16_t *a, const uint16_t *b)
    }
    return a - a_org;
 }
-#endif
 
-static inline size_t find_same(const uint16_t *a, const uint16_t *b)
+static size_t find_same_c(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -398,121 +926,580 @@ static inline size_t find_same(const uint16_t *a, const uint16_t *b)
    return a - a_org;
 }
 
-void state_manager_push_do(state_manager_t *state)
+/* The vectorized scanners compare 32-bit lanes, like find_same_c().
+ * A lane mismatch tells us which pair of uint16s differs;
+ * the last compare picks the right one of the two. */
+
+static inline size_t find_same_fixup(const uint16_t *a, const uint16_t *b,
+      size_t ret)
 {
-   if (state->thisblock_valid)
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+
+#if defined(__SSE2__)
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+	
+   for (;;)
    {
-      if (state->capacity < sizeof(size_t) + state->maxcompsize)
-         return;
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
 
-recheckcapacity:;
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+			return ret | (a[ret] == b[ret]);
+      }
+
+      a128++;
+      b128++;
+   }
+}
+
+static size_t find_same_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
 
-      size_t headpos = state->head - state->data;
-      size_t tailpos = state->tail - state->data;
-      size_t remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+      if (mask) /* Found an identical lane. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         return find_same_fixup(a, b, ret);
+      }
 
-      if (remaining <= state->maxcompsize)
+      a128++;
+      b128++;
+   }
+}
+#endif
+
+#if defined(HAVE_REWIND_AVX2)
+__attribute__((target("avx2")))
+static size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask != 0xffffffffu)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+__attribute__((target("avx2")))
+static size_t find_same_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         return find_same_fixup(a, b, ret);
       }
 
-      RARCH_PERFORMANCE_INIT(gen_deltas);
-      RARCH_PERFORMANCE_START(gen_deltas);
+      a256++;
+      b256++;
+   }
+}
+#endif
 
-      const uint8_t *oldb = state->thisblock;
-      const uint8_t *newb = state->nextblock;
-      uint8_t *compressed = state->head + sizeof(size_t);
+#if defined(__ARM_NEON__)
+/* Narrows a 4x32-bit compare result to one 64-bit word,
+ * 16 bits per lane. */
+static inline uint64_t neon_lane_mask(uint32x4_t c)
+{
+   return vget_lane_u64(vreinterpret_u64_u16(vmovn_u32(c)), 0);
+}
 
-      /* Begin compression code; 'compressed' will point to 
-       * the end of the compressed data (excluding the prev pointer). */
-      const uint16_t *old16 = (const uint16_t*)oldb;
-      const uint16_t *new16 = (const uint16_t*)newb;
-      uint16_t *compressed16 = (uint16_t*)compressed;
-      size_t num16s = state->blocksize / sizeof(uint16_t);
+static size_t find_change_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
 
-      while (num16s)
+   for (;;)
+   {
+      uint32x4_t v0 = vreinterpretq_u32_u8(vld1q_u8(a8));
+      uint32x4_t v1 = vreinterpretq_u32_u8(vld1q_u8(b8));
+      uint64_t mask = neon_lane_mask(vceqq_u32(v0, v1));
+
+      if (mask != UINT64_C(0xffffffffffffffff))
       {
-         size_t i;
-         size_t skip = find_change(old16, new16);
+         size_t ret = ((a8 - (const uint8_t*)a) >> 1) |
+            ((__builtin_ctzll(~mask) >> 4) << 1);
+         return ret | (a[ret] == b[ret]);
+      }
 
-         if (skip >= num16s)
-            break;
+      a8 += 16;
+      b8 += 16;
+   }
+}
+
+static size_t find_same_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
+
+   for (;;)
+   {
+      uint32x4_t v0 = vreinterpretq_u32_u8(vld1q_u8(a8));
+      uint32x4_t v1 = vreinterpretq_u32_u8(vld1q_u8(b8));
+      uint64_t mask = neon_lane_mask(vceqq_u32(v0, v1));
+
+      if (mask)
+      {
+         size_t ret = ((a8 - (const uint8_t*)a) >> 1) |
+            ((__builtin_ctzll(mask) >> 4) << 1);
+         return find_same_fixup(a, b, ret);
+      }
 
-         old16 += skip;
-         new16 += skip;
-         num16s -= skip;
+      a8 += 16;
+      b8 += 16;
+   }
+}
+#endif
+
+struct rewind_scanner
+{
+   const char *ident;
+   uint64_t simd_mask;
+   rewind_find_func_t find_change;
+   rewind_find_func_t find_same;
+};
+
+/* Ordered by preference, last match wins. */
+static const struct rewind_scanner rewind_scanners[] = {
+   { "c",    0,                 find_change_c,    find_same_c    },
+#if defined(__SSE2__)
+   { "sse2", RETRO_SIMD_SSE2,   find_change_sse2, find_same_sse2 },
+#endif
+#if defined(HAVE_REWIND_AVX2)
+   { "avx2", RETRO_SIMD_AVX | RETRO_SIMD_AVX2,
+                                find_change_avx2, find_same_avx2 },
+#endif
+#if defined(__ARM_NEON__)
+   { "neon", RETRO_SIMD_NEON,   find_change_neon, find_same_neon },
+#endif
+};
+
+#define REWIND_NUM_SCANNERS \
+   (sizeof(rewind_scanners) / sizeof(rewind_scanners[0]))
+
+static void state_manager_init_scanners(state_manager_t *state)
+{
+   unsigned i;
+   const struct rewind_scanner *scanner = &rewind_scanners[0];
+   uint64_t cpu = rarch_get_cpu_features();
+
+   for (i = 1; i < REWIND_NUM_SCANNERS; i++)
+   {
+      if ((cpu & rewind_scanners[i].simd_mask) == rewind_scanners[i].simd_mask)
+         scanner = &rewind_scanners[i];
+   }
+
+   RARCH_LOG("Rewind: using \"%s\" delta scanner.\n", scanner->ident);
+
+   state->find_change = scanner->find_change;
+   state->find_same   = scanner->find_same;
+}
+
+/**
+ * state_manager_compress:
+ * @find_change        : scanner used to skip over unchanged data.
+ * @find_same          : scanner used to measure changed runs.
+ * @oldb               : block to store (the previous state).
+ * @newb               : block to compare against (the new state).
+ * @blocksize          : size of both blocks, in bytes.
+ * @compressed         : output buffer, at least maxcompsize bytes.
+ *
+ * Generates the delta from @newb back to @oldb.
+ *
+ * Returns: pointer to the end of the compressed data.
+ **/
+static uint8_t *state_manager_compress(
+      rewind_find_func_t find_change, rewind_find_func_t find_same,
+      const uint8_t *oldb, const uint8_t *newb, size_t blocksize,
+      uint8_t *compressed)
+{
+   const uint16_t *old16 = (const uint16_t*)oldb;
+   const uint16_t *new16 = (const uint16_t*)newb;
+   uint16_t *compressed16 = (uint16_t*)compressed;
+   size_t num16s = blocksize / sizeof(uint16_t);
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16 += skip;
+      new16 += skip;
+      num16s -= skip;
 
-         if (skip > UINT16_MAX)
+      if (skip > UINT16_MAX)
+      {
+         if (skip > UINT32_MAX)
          {
-            if (skip > UINT32_MAX)
-            {
-               /* This will make it scan the entire thing again, 
-                * but it only hits on 8GB unchanged data anyways,
-                * and if you're doing that, you've got bigger problems. */
-               skip = UINT32_MAX;
-            }
-            *compressed16++ = 0;
-            *compressed16++ = skip;
-            *compressed16++ = skip >> 16;
-            skip = 0;
-            continue;
+            /* This will make it scan the entire thing again, 
+             * but it only hits on 8GB unchanged data anyways,
+             * and if you're doing that, you've got bigger problems. */
+            skip = UINT32_MAX;
          }
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         skip = 0;
+         continue;
+      }
 
-         size_t changed = find_same(old16, new16);
-         if (changed > UINT16_MAX)
-            changed = UINT16_MAX;
+      changed = find_same(old16, new16);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
 
-         *compressed16++ = changed;
-         *compressed16++ = skip;
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
+
+      old16 += changed;
+      new16 += changed;
+      num16s -= changed;
+      compressed16 += changed;
+   }
+
+   compressed16[0] = 0;
+   compressed16[1] = 0;
+   compressed16[2] = 0;
+   return (uint8_t*)(compressed16 + 3);
+}
+
+/**
+ * state_manager_push_lz:
+ * @state              : state manager handle.
+ * @type               : type of the entry being written.
+ * @keyframe           : whether @raw is a keyframe.
+ * @raw                : the entry as it would be stored without LZ.
+ * @rawsize            : size of @raw, in bytes.
+ * @dict               : the newer state, or NULL for keyframes.
+ *
+ * Writes @raw behind @type, LZ compressed if that makes it smaller.
+ *
+ * Returns: pointer to the end of the entry.
+ **/
+static uint8_t *state_manager_push_lz(state_manager_t *state,
+      uint16_t *type, bool keyframe, const uint8_t *raw, size_t rawsize,
+      const uint8_t *dict)
+{
+   size_t size       = 0;
+   retro_time_t start = rarch_get_time_usec();
+
+   /* Smaller than the plain entry, or it is not worth it. */
+   if (rawsize > sizeof(uint16_t) * 3)
+      size = rewind_lz_compress(raw, rawsize, dict, state->blocksize,
+            (uint8_t*)(type + 3), rawsize - sizeof(uint16_t) * 3,
+            state->lztable, state->lzdtable);
+
+   state->lz_usec += rarch_get_time_usec() - start;
+   state->lz_in   += rawsize;
+   state->lz_out  += size ? size : rawsize;
+   state_manager_lz_judge(state);
+
+   if (!size)
+   {
+      *type = keyframe ? REWIND_ENTRY_KEYFRAME : REWIND_ENTRY_DELTA;
+      memcpy(type + 1, raw, rawsize);
+      return (uint8_t*)(type + 1) + rawsize;
+   }
+
+   type[0] = keyframe ? REWIND_ENTRY_KEYFRAME_LZ : REWIND_ENTRY_DELTA_LZ;
+   type[1] = rawsize;
+   type[2] = rawsize >> 16;
+   /* The next entry starts uint16 aligned. */
+   return (uint8_t*)(type + 3) + ((size + 1) & ~(size_t)1);
+}
+
+/**
+ * state_manager_push_delta:
+ * @state              : state manager handle.
+ * @oldb               : the previously pushed state.
+ * @newb               : the state that is being pushed.
+ *
+ * Appends the delta from @newb back to @oldb to the ring buffer,
+ * discarding the oldest entries if needed.
+ **/
+static void state_manager_push_delta(state_manager_t *state,
+      const uint8_t *oldb, const uint8_t *newb)
+{
+   if (state->capacity < sizeof(size_t) + state->maxcompsize)
+      return;
+
+recheckcapacity:;
+
+   size_t headpos = state->head - state->data;
+   size_t tailpos = state->tail - state->data;
+   size_t remaining = (tailpos + state->capacity -
+         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+   if (remaining <= state->maxcompsize)
+   {
+      state_manager_discard_tail(state);
+      goto recheckcapacity;
+   }
+
+   RARCH_PERFORMANCE_INIT(gen_deltas);
+   RARCH_PERFORMANCE_START(gen_deltas);
+
+   state->serial++;
 
-         for (i = 0; i < changed; i++)
-            compressed16[i] = old16[i];
+   bool keyframe = state->keyframe_interval &&
+      (state->serial % state->keyframe_interval) == 0;
+   uint16_t *type = (uint16_t*)(state->head + sizeof(size_t));
+   uint8_t *compressed;
 
-         old16 += changed;
-         new16 += changed;
-         num16s -= changed;
-         compressed16 += changed;
+   if (state->lzblock && (state->lz_enabled ||
+            (state->serial % REWIND_LZ_PROBE) == 0))
+   {
+      const uint8_t *raw = oldb;
+      size_t rawsize     = state->blocksize;
+
+      if (!keyframe)
+      {
+         raw     = state->lzblock;
+         rawsize = state_manager_compress(
+               state->find_change, state->find_same,
+               oldb, newb, state->blocksize, state->lzblock) - raw;
       }
 
-      compressed16[0] = 0;
-      compressed16[1] = 0;
-      compressed16[2] = 0;
-      compressed = (uint8_t*)(compressed16 + 3);
-      /* End compression code. */
+      compressed = state_manager_push_lz(state, type, keyframe,
+            raw, rawsize, keyframe ? NULL : newb);
+   }
+   else if (keyframe)
+   {
+      *type = REWIND_ENTRY_KEYFRAME;
+      memcpy(type + 1, oldb, state->blocksize);
+      compressed = (uint8_t*)(type + 1) + state->blocksize;
+   }
+   else
+   {
+      *type = REWIND_ENTRY_DELTA;
+      compressed = state_manager_compress(
+            state->find_change, state->find_same,
+            oldb, newb, state->blocksize, (uint8_t*)(type + 1));
+   }
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed = state->data;
+      if (state->tail == state->data + sizeof(size_t))
+         state_manager_discard_tail(state);
+   }
+   write_size_t(compressed, state->head-state->data);
+   compressed += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+
+   if (keyframe)
+   {
+      struct rewind_keyframe *kf = NULL;
+
+      if (state->keyframes_count == state->keyframes_max)
       {
-         compressed = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         state->keyframes_first = (state->keyframes_first + 1)
+            % state->keyframes_max;
+         state->keyframes_count--;
       }
-      write_size_t(compressed, state->head-state->data);
-      compressed += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head = compressed;
 
-      RARCH_PERFORMANCE_STOP(gen_deltas);
+      kf         = keyframe_at(state, state->keyframes_count++);
+      kf->start  = state->head - state->data;
+      kf->end    = compressed - state->data;
+      kf->serial = state->serial;
+   }
+
+   state->head = compressed;
+
+   RARCH_PERFORMANCE_STOP(gen_deltas);
+}
+
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      while (!state->job_pending && !state->quit)
+         scond_wait(state->cond, state->lock);
+
+      if (state->quit)
+         break;
+
+      slock_unlock(state->lock);
+
+      state_manager_push_delta(state, state->job_old, state->job_new);
+
+      slock_lock(state->lock);
+      state->entries++;
+      state->job_pending = false;
+      scond_broadcast(state->cond);
    }
+
+   slock_unlock(state->lock);
+}
+#endif
+
+void state_manager_push_do(state_manager_t *state)
+{
+   uint8_t *swap = NULL;
+
+#ifdef HAVE_THREADS
+   if (state->thread && state->thisblock_valid)
+   {
+      /* Only one delta is in flight at any time. If the worker is
+       * still busy with the previous one, we have to wait here;
+       * normally it finishes well within a frame. */
+      state_manager_wait(state);
+
+      slock_lock(state->lock);
+      state->job_old     = state->thisblock;
+      state->job_new     = state->nextblock;
+      state->job_pending = true;
+      scond_signal(state->cond);
+      slock_unlock(state->lock);
+
+      /* job_old is busy until the worker is done with it,
+       * so rotate it out and hand out the spare block instead. */
+      swap              = state->thisblock;
+      state->thisblock  = state->nextblock;
+      state->nextblock  = state->spareblock;
+      state->spareblock = swap;
+      return;
+   }
+#endif
+
+   if (state->thisblock_valid)
+      state_manager_push_delta(state, state->thisblock, state->nextblock);
    else
       state->thisblock_valid = true;
 
-   uint8_t *swap = state->thisblock;
+   swap = state->thisblock;
    state->thisblock = state->nextblock;
    state->nextblock = swap;
 
    state->entries++;
-   return;
+}
+
+bool state_manager_seek(state_manager_t *state, unsigned count,
+      const void **data)
+{
+   size_t i;
+   uint64_t target;
+   struct rewind_keyframe *kf = NULL;
+
+   *data = NULL;
+
+   if (!count)
+      return false;
+
+   state_manager_wait(state);
+
+   if (state->thisblock_valid)
+   {
+      state->thisblock_valid = false;
+      state->entries--;
+      *data = state->thisblock;
+      if (--count == 0)
+         return true;
+   }
+
+   if (count > state->entries)
+      count = state->entries;
+   if (!count)
+      return *data != NULL;
+
+   /* Serial of the entry we want to end up at. Jump to the 
+    * oldest keyframe which is not older than that, and 
+    * decode the remaining deltas from there. */
+   target = state->serial - count + 1;
+
+   for (i = 0; i < state->keyframes_count; i++)
+   {
+      if (keyframe_at(state, i)->serial >= target)
+      {
+         kf = keyframe_at(state, i);
+         break;
+      }
+   }
+
+   if (kf)
+   {
+      unsigned skipped = state->serial - kf->serial;
+
+      state->head            = state->data + kf->end;
+      state->serial          = kf->serial;
+      state->entries        -= skipped;
+      state->keyframes_count = i + 1;
+      count                 -= skipped;
+   }
+
+   while (count--)
+   {
+      if (!state_manager_pop(state, data))
+         break;
+   }
+
+   return *data != NULL;
 }
 
 void state_manager_capacity(state_manager_t *state,
       unsigned *entries, size_t *bytes, bool *full)
 {
-   size_t headpos   = state->head - state->data;
-   size_t tailpos   = state->tail - state->data;
-   size_t remaining = (tailpos + state->capacity -
+   size_t headpos, tailpos, remaining;
+
+   state_manager_wait(state);
+
+   headpos   = state->head - state->data;
+   tailpos   = state->tail - state->data;
+   remaining = (tailpos + state->capacity -
          sizeof(size_t) - headpos - 1) % state->capacity + 1;
 
    if (entries)
@@ -522,3 +1509,80 @@ void state_manager_capacity(state_manager_t *state,
    if (full)
       *full = remaining <= state->maxcompsize * 2;
 }
+
+/**
+ * state_manager_benchmark:
+ * @state              : state manager handle.
+ *
+ * Compresses the two most recently captured states with every 
+ * delta scanner this CPU supports and logs the throughput of each,
+ * and what the LZ stage makes of the delta if it is enabled.
+ * Needs at least two pushed states to be meaningful.
+ **/
+void state_manager_benchmark(state_manager_t *state)
+{
+   unsigned i, j;
+   uint8_t *scratch = NULL;
+   uint64_t cpu;
+
+   if (!state)
+      return;
+
+   state_manager_wait(state);
+
+   if (!state->thisblock_valid)
+      return;
+
+   scratch = (uint8_t*)malloc(state->maxcompsize);
+   if (!scratch)
+      return;
+
+   cpu = rarch_get_cpu_features();
+
+   for (i = 0; i < REWIND_NUM_SCANNERS; i++)
+   {
+      const struct rewind_scanner *scanner = &rewind_scanners[i];
+      const unsigned iterations  = 64;
+      uint8_t *end               = scratch;
+      retro_time_t start, elapsed;
+
+      if ((cpu & scanner->simd_mask) != scanner->simd_mask)
+         continue;
+
+      start = rarch_get_time_usec();
+      for (j = 0; j < iterations; j++)
+         end = state_manager_compress(scanner->find_change,
+               scanner->find_same, state->thisblock, state->nextblock,
+               state->blocksize, scratch);
+      elapsed = rarch_get_time_usec() - start;
+
+      if (elapsed <= 0)
+         elapsed = 1;
+
+      RARCH_LOG("[PERF]: Rewind delta (%s): %.1f MB/s, %u -> %u bytes.\n",
+            scanner->ident,
+            (double)state->blocksize * iterations / elapsed,
+            (unsigned)state->blocksize, (unsigned)(end - scratch));
+   }
+
+   if (state->lzblock)
+   {
+      retro_time_t start, elapsed;
+      size_t size = state_manager_compress(state->find_change,
+            state->find_same, state->thisblock, state->nextblock,
+            state->blocksize, scratch) - scratch;
+      size_t lzsize;
+
+      start  = rarch_get_time_usec();
+      lzsize = rewind_lz_compress(scratch, size, state->nextblock,
+            state->blocksize, state->lzblock, state->maxcompsize,
+            state->lztable, state->lzdtable);
+      elapsed = rarch_get_time_usec() - start;
+
+      RARCH_LOG("[PERF]: Rewind LZ: %u usec, %u -> %u bytes.\n",
+            (unsigned)elapsed, (unsigned)size,
+            (unsigned)(lzsize ? lzsize : size));
+   }
+
+   free(scratch);
+}
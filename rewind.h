@@ -27,7 +27,24 @@ extern "C" {
 
 typedef struct state_manager state_manager_t;
 
-state_manager_t *state_manager_new(size_t state_size, size_t buffer_size);
+/**
+ * state_manager_new:
+ * @state_size         : size of a single savestate, in bytes.
+ * @buffer_size        : size of the rewind ring buffer, in bytes.
+ * @keyframe_interval  : store every Nth state in full, 0 to disable.
+ * @threaded           : compress deltas on a worker thread.
+ * @compress           : LZ compress entries as well, for as long 
+ *                       as that pays off with the states of the core.
+ *
+ * In threaded mode, state_manager_push_do() hands the delta off 
+ * to a worker and returns immediately. Popping (and querying the 
+ * capacity) waits for the worker to finish. Threaded mode is 
+ * silently ignored if built without HAVE_THREADS.
+ *
+ * Returns: new state manager, or NULL on failure.
+ **/
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size,
+      unsigned keyframe_interval, bool threaded, bool compress);
 
 void state_manager_free(state_manager_t *state);
 
@@ -37,9 +54,27 @@ void state_manager_push_where(state_manager_t *state, void **data);
 
 void state_manager_push_do(state_manager_t *state);
 
+/**
+ * state_manager_seek:
+ * @state              : state manager handle.
+ * @count              : number of states to go back.
+ * @data               : set to the resulting state.
+ *
+ * Same as calling state_manager_pop() @count times, but jumps 
+ * over keyframes instead of decoding every delta in between.
+ * Stops at the oldest state if the buffer does not reach back 
+ * far enough.
+ *
+ * Returns: true if a state was popped, otherwise false.
+ **/
+bool state_manager_seek(state_manager_t *state, unsigned count,
+      const void **data);
+
 void state_manager_capacity(state_manager_t *state,
       unsigned int *entries, size_t *bytes, bool *full);
 
+void state_manager_benchmark(state_manager_t *state);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,387 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <file/file_path.h>
+#include "runahead.h"
+#include "general.h"
+#include "dynamic.h"
+#include "file_ops.h"
+#include "retro.h"
+#include "retroarch.h"
+#include "performance.h"
+
+/* Second instance of the core, used only for speculative frames. */
+static struct retro_core_instance secondary;
+static bool secondary_loaded;
+static char secondary_path[PATH_MAX_LENGTH];
+
+static void secondary_video_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+}
+
+static void secondary_audio_sample(int16_t left, int16_t right)
+{
+}
+
+static size_t secondary_audio_sample_batch(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
+/* Input was already polled by the main instance this frame. */
+static void secondary_input_poll(void)
+{
+}
+
+/**
+ * secondary_environment_cb:
+ * @cmd                  : Environment command.
+ * @data                 : Environment data.
+ *
+ * Environment callback of the second instance. Only queries are
+ * forwarded, so the second instance cannot change any frontend 
+ * state the main instance has already set up.
+ *
+ * Returns: true (1) if @cmd was handled, otherwise false (0).
+ **/
+static bool secondary_environment_cb(unsigned cmd, void *data)
+{
+   switch (cmd)
+   {
+      case RETRO_ENVIRONMENT_GET_OVERSCAN:
+      case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+      case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_CONTENT_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_LIBRETRO_PATH:
+      case RETRO_ENVIRONMENT_GET_VARIABLE:
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+      case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_PERF_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_USERNAME:
+      case RETRO_ENVIRONMENT_GET_LANGUAGE:
+         return rarch_environment_cb(cmd, data);
+
+      case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+         return *(const enum retro_pixel_format*)data == 
+            g_extern.system.pix_fmt;
+
+      case RETRO_ENVIRONMENT_SET_ROTATION:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+      case RETRO_ENVIRONMENT_SET_VARIABLES:
+      case RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO:
+      case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+      case RETRO_ENVIRONMENT_SET_MEMORY_MAPS:
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+         /* Already handled for the main instance. */
+         return true;
+
+      default:
+         return false;
+   }
+}
+
+/**
+ * secondary_copy_library:
+ *
+ * Copies the current core to a temporary file, so the dynamic 
+ * linker gives us a separate copy of its global state.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool secondary_copy_library(void)
+{
+   char dir[PATH_MAX_LENGTH], name[PATH_MAX_LENGTH];
+   const char *tmp = NULL;
+   void *buf       = NULL;
+   long size       = read_file(g_settings.libretro, &buf);
+   bool ret        = false;
+
+   if (size < 0)
+      return false;
+
+#ifdef _WIN32
+   tmp = getenv("TEMP");
+#else
+   tmp = getenv("TMPDIR");
+   if (!tmp)
+      tmp = "/tmp";
+#endif
+
+   if (*g_settings.extraction_directory)
+      strlcpy(dir, g_settings.extraction_directory, sizeof(dir));
+   else if (tmp)
+      strlcpy(dir, tmp, sizeof(dir));
+   else
+      fill_pathname_basedir(dir, g_settings.libretro, sizeof(dir));
+
+   snprintf(name, sizeof(name), "retroarch_secondary_%s",
+         path_basename(g_settings.libretro));
+   fill_pathname_join(secondary_path, dir, name, sizeof(secondary_path));
+
+   ret = write_file(secondary_path, buf, size);
+   free(buf);
+   return ret;
+}
+
+static void secondary_unload(void)
+{
+   if (secondary_loaded)
+   {
+      secondary.retro_unload_game();
+      secondary.retro_deinit();
+   }
+   secondary_loaded = false;
+
+   libretro_unload_instance(&secondary);
+
+   if (*secondary_path)
+      remove(secondary_path);
+   *secondary_path = '\0';
+}
+
+/**
+ * runahead_secondary_init:
+ * @special              : Subsystem of the content. Can be NULL.
+ * @info                 : Content as passed to the main instance.
+ * @num_info             : Number of elements in @info.
+ *
+ * Loads a second instance of the core with the same content.
+ **/
+void runahead_secondary_init(const struct retro_subsystem_info *special,
+      const struct retro_game_info *info, unsigned num_info)
+{
+   unsigned i;
+   bool ret;
+
+   if (!g_settings.runahead_frames || !g_settings.runahead_secondary_instance)
+      return;
+
+   if (g_extern.system.hw_render_callback.context_type != RETRO_HW_CONTEXT_NONE)
+   {
+      RARCH_WARN("Run-ahead: second instance is not available for HW rendered cores.\n");
+      return;
+   }
+
+   if (!secondary_copy_library())
+   {
+      RARCH_WARN("Run-ahead: could not copy core for second instance.\n");
+      secondary_unload();
+      return;
+   }
+
+   RARCH_LOG("Run-ahead: loading second instance from \"%s\".\n",
+         secondary_path);
+
+   if (!libretro_load_instance(&secondary, secondary_path))
+   {
+      secondary_unload();
+      return;
+   }
+
+   secondary.retro_set_environment(secondary_environment_cb);
+   secondary.retro_init();
+   secondary_loaded = true;
+
+   secondary.retro_set_video_refresh(secondary_video_frame);
+   secondary.retro_set_audio_sample(secondary_audio_sample);
+   secondary.retro_set_audio_sample_batch(secondary_audio_sample_batch);
+   secondary.retro_set_input_poll(secondary_input_poll);
+
+   if (special)
+      ret = secondary.retro_load_game_special(special->id, info, num_info);
+   else
+      ret = secondary.retro_load_game(info);
+
+   if (!ret)
+   {
+      RARCH_WARN("Run-ahead: second instance failed to load content.\n");
+      secondary_unload();
+      return;
+   }
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      unsigned device = g_settings.input.libretro_device[i];
+      if (device != RETRO_DEVICE_JOYPAD)
+         secondary.retro_set_controller_port_device(i, device);
+   }
+}
+
+/**
+ * runahead_available:
+ *
+ * Checks whether run-ahead can be used for this frame.
+ * Netplay already rolls the core back and forth on its own, 
+ * BSV movies and rewinding need every frame to run exactly once.
+ *
+ * Returns: true (1) if run-ahead can be used, otherwise false (0).
+ **/
+static bool runahead_available(void)
+{
+   if (!g_settings.runahead_frames || g_extern.runahead.failed)
+      return false;
+#ifdef HAVE_NETPLAY
+   if (driver.netplay_data)
+      return false;
+#endif
+   if (g_extern.bsv.movie || g_extern.frame_is_reverse)
+      return false;
+   /* Audio callback cores push samples on their own schedule,
+    * so speculative frames cannot be muted. */
+   if (g_extern.system.audio_callback.callback)
+      return false;
+
+   if (g_extern.runahead.buffer)
+      return true;
+
+   /* Allocated once per core, so we don't allocate every frame. */
+   g_extern.runahead.size = pretro_serialize_size();
+   if (g_extern.runahead.size)
+      g_extern.runahead.buffer = malloc(g_extern.runahead.size);
+
+   if (!g_extern.runahead.buffer)
+   {
+      RARCH_WARN("Run-ahead: core does not support savestates, disabling.\n");
+      g_extern.runahead.failed = true;
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * runahead_run_secondary:
+ *
+ * Runs the main instance once, then moves its state straight from
+ * the serialize buffer into the second instance and runs that one
+ * ahead. The main instance is never rolled back, so its audio is
+ * left untouched.
+ **/
+static void runahead_run_secondary(void)
+{
+   unsigned i;
+   bool ok;
+
+   retro_set_runahead_callbacks(false, true);
+   pretro_run();
+   retro_set_runahead_callbacks(true, true);
+
+   RARCH_PERFORMANCE_INIT(runahead_serialize);
+   RARCH_PERFORMANCE_START(runahead_serialize);
+   ok = pretro_serialize(g_extern.runahead.buffer, g_extern.runahead.size);
+   RARCH_PERFORMANCE_STOP(runahead_serialize);
+
+   if (ok)
+   {
+      RARCH_PERFORMANCE_INIT(runahead_unserialize);
+      RARCH_PERFORMANCE_START(runahead_unserialize);
+      ok = secondary.retro_unserialize(g_extern.runahead.buffer,
+            g_extern.runahead.size);
+      RARCH_PERFORMANCE_STOP(runahead_unserialize);
+   }
+
+   if (!ok)
+   {
+      RARCH_WARN("Run-ahead: could not sync second instance, disabling.\n");
+      g_extern.runahead.failed = true;
+      rarch_render_cached_frame();
+      return;
+   }
+
+   /* The main callbacks are only bound after content is loaded. */
+   secondary.retro_set_input_state(driver.retro_ctx.state_cb);
+
+   for (i = 1; i <= g_settings.runahead_frames; i++)
+   {
+      secondary.retro_set_video_refresh(i == g_settings.runahead_frames ?
+            driver.retro_ctx.frame_cb : secondary_video_frame);
+      secondary.retro_run();
+   }
+}
+
+void runahead_run(void)
+{
+   unsigned i;
+   bool ok;
+
+   if (!runahead_available())
+   {
+      pretro_run();
+      return;
+   }
+
+   if (secondary_loaded)
+   {
+      runahead_run_secondary();
+      return;
+   }
+
+   /* The real frame. We keep its audio, but not its video,
+    * since a more recent frame will be shown instead. */
+   retro_set_runahead_callbacks(false, true);
+   pretro_run();
+
+   RARCH_PERFORMANCE_INIT(runahead_serialize);
+   RARCH_PERFORMANCE_START(runahead_serialize);
+   ok = pretro_serialize(g_extern.runahead.buffer, g_extern.runahead.size);
+   RARCH_PERFORMANCE_STOP(runahead_serialize);
+
+   if (!ok)
+   {
+      RARCH_WARN("Run-ahead: failed to serialize, disabling.\n");
+      g_extern.runahead.failed = true;
+      retro_set_runahead_callbacks(true, true);
+      rarch_render_cached_frame();
+      return;
+   }
+
+   /* Speculative frames. Only the last one gets presented. */
+   for (i = 1; i <= g_settings.runahead_frames; i++)
+   {
+      retro_set_runahead_callbacks(i == g_settings.runahead_frames, false);
+      pretro_run();
+   }
+
+   RARCH_PERFORMANCE_INIT(runahead_unserialize);
+   RARCH_PERFORMANCE_START(runahead_unserialize);
+   ok = pretro_unserialize(g_extern.runahead.buffer, g_extern.runahead.size);
+   RARCH_PERFORMANCE_STOP(runahead_unserialize);
+
+   retro_set_runahead_callbacks(true, true);
+
+   if (!ok)
+   {
+      RARCH_WARN("Run-ahead: failed to unserialize, disabling.\n");
+      g_extern.runahead.failed = true;
+   }
+}
+
+void runahead_deinit(void)
+{
+   secondary_unload();
+
+   free(g_extern.runahead.buffer);
+   g_extern.runahead.buffer = NULL;
+   g_extern.runahead.size   = 0;
+   g_extern.runahead.failed = false;
+}
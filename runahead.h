@@ -0,0 +1,68 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_RUNAHEAD_H
+#define __RARCH_RUNAHEAD_H
+
+#include <boolean.h>
+#include <stddef.h>
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * runahead_run:
+ *
+ * Runs the core for one frame. If run-ahead is enabled, the core
+ * is run g_settings.runahead_frames frames further with the current
+ * input, the last of those frames is presented, and the core is 
+ * rolled back to the state after the first frame. 
+ *
+ * Falls back to a plain retro_run() if run-ahead is disabled
+ * or not possible right now.
+ **/
+void runahead_run(void);
+
+/**
+ * runahead_secondary_init:
+ * @special              : Subsystem of the content. Can be NULL.
+ * @info                 : Content as passed to the main instance.
+ * @num_info             : Number of elements in @info.
+ *
+ * If g_settings.runahead_secondary_instance is set, loads a second
+ * instance of the core with the same content. runahead_run() will
+ * then use it for the speculative frames, and the main instance is
+ * never rolled back. Must be called right after the main instance
+ * loaded its content.
+ **/
+void runahead_secondary_init(const struct retro_subsystem_info *special,
+      const struct retro_game_info *info, unsigned num_info);
+
+/**
+ * runahead_deinit:
+ *
+ * Frees the run-ahead state buffer and unloads the second
+ * instance, if any. Must be called before the core is unloaded.
+ **/
+void runahead_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,6 +23,13 @@
 #include "intl/intl.h"
 #include "retroarch.h"
 #include "runloop.h"
+#include "runahead.h"
+#include "perf_governor.h"
+#ifdef HAVE_SHM
+#include "memory_share.h"
+#endif
+#include "gfx/video_pacer.h"
+#include "input/input_autodetect.h"
 
 #ifdef HAVE_MENU
 #include "menu/menu.h"
@@ -261,8 +268,9 @@ static void check_rewind(bool pressed)
    {
       static unsigned cnt = 0;
 
-      cnt = (cnt + 1) % (g_settings.rewind_granularity ?
-            g_settings.rewind_granularity : 1); /* Avoid possible SIGFPE. */
+      cnt = (cnt + 1) % ((g_settings.rewind_granularity ?
+            g_settings.rewind_granularity : 1) /* Avoid possible SIGFPE. */
+            * rarch_perf_governor_rewind_scale());
 
       if ((cnt == 0) || g_extern.bsv.movie)
       {
@@ -504,6 +512,14 @@ static int do_pre_state_checks(
       retro_input_t input, retro_input_t old_input,
       retro_input_t trigger_input)
 {
+   input_config_autoconfigure_joypad_poll();
+
+#ifdef HAVE_OVERLAY
+   /* Shows the overlay once loaded, in the menu as well. */
+   if (driver.overlay)
+      input_overlay_ready(driver.overlay);
+#endif
+
    if (BIT64_GET(trigger_input, RARCH_OVERLAY_NEXT))
       rarch_main_command(RARCH_CMD_OVERLAY_NEXT);
 
@@ -542,6 +558,15 @@ static int do_state_checks(
    if (BIT64_GET(trigger_input, RARCH_SCREENSHOT))
       rarch_main_command(RARCH_CMD_TAKE_SCREENSHOT);
 
+   if (BIT64_GET(trigger_input, RARCH_SAVE_REPLAY))
+      rarch_main_command(RARCH_CMD_SAVE_REPLAY);
+
+   if (BIT64_GET(trigger_input, RARCH_LATENCY_TEST))
+      rarch_latency_test_trigger();
+
+   if (BIT64_GET(trigger_input, RARCH_TRACE_DUMP))
+      rarch_main_command(RARCH_CMD_TRACE_DUMP);
+
    if (BIT64_GET(trigger_input, RARCH_MUTE))
       rarch_main_command(RARCH_CMD_AUDIO_MUTE_TOGGLE);
 
@@ -642,13 +667,35 @@ static inline int time_to_exit(retro_input_t input)
 /**
  * update_frame_time:
  *
- * Updates frame timing if frame timing callback is in use by the core.
+ * Records the frame time histogram if performance counters 
+ * are enabled, and updates frame timing if frame timing 
+ * callback is in use by the core.
  **/
 static void update_frame_time(void)
 {
+   static retro_time_t last_time;
    retro_time_t curr_time = rarch_get_time_usec();
    retro_time_t delta     = curr_time - g_extern.system.frame_time_last;
    bool is_locked_fps     = g_extern.is_paused || driver.nonblock_state;
+
+   if (g_extern.perfcnt_enable)
+   {
+      /* Menu and pause are not frames of the core, 
+       * restart measuring once they are left. */
+      if (g_extern.is_menu || g_extern.is_paused)
+         last_time = 0;
+      else
+      {
+         if (last_time)
+            rarch_perf_histogram_add(&perf_histogram_frame_time,
+                  curr_time - last_time);
+         last_time = curr_time;
+      }
+   }
+
+   if (!g_extern.system.frame_time.callback)
+      return;
+
    is_locked_fps         |= !!driver.recording_data;
 
    if (!g_extern.system.frame_time_last || is_locked_fps)
@@ -861,6 +908,26 @@ static int rarch_main_iterate_quit(void)
    return -1;
 }
 
+/**
+ * benchmark_core_run:
+ *
+ * runahead_run(), timed for --benchmark.
+ **/
+static void benchmark_core_run(void)
+{
+   retro_time_t start = rarch_get_time_usec();
+
+   if (!g_extern.benchmark.start)
+      g_extern.benchmark.start = start;
+
+   g_extern.benchmark.in_core = true;
+   runahead_run();
+   g_extern.benchmark.in_core = false;
+
+   g_extern.benchmark.core += rarch_get_time_usec() - start;
+   g_extern.benchmark.frames++;
+}
+
 /**
  * rarch_main_iterate:
  *
@@ -871,9 +938,11 @@ static int rarch_main_iterate_quit(void)
  **/
 int rarch_main_iterate(void)
 {
-   unsigned i;
+   unsigned i, frame_delay;
    retro_input_t trigger_input;
    int ret                         = 0;
+   retro_time_t iterate_start      = 0;
+   retro_time_t iterate_time       = 0;
    static retro_input_t last_input = 0;
    retro_input_t old_input         = last_input;
    retro_input_t input             = input_keys_pressed();
@@ -885,10 +954,13 @@ int rarch_main_iterate(void)
    trigger_input = input & ~old_input;
 
    if (time_to_exit(input))
+   {
+      if (g_extern.benchmark.enable && !g_extern.benchmark.end)
+         g_extern.benchmark.end = rarch_get_time_usec();
       return rarch_main_iterate_quit();
+   }
 
-   if (g_extern.system.frame_time.callback)
-      update_frame_time();
+   update_frame_time();
 
    do_pre_state_checks(input, old_input, trigger_input);
 
@@ -924,8 +996,16 @@ int rarch_main_iterate(void)
 #endif
 
 #ifdef HAVE_NETPLAY
-   if (driver.netplay_data)
-      netplay_pre_frame((netplay_t*)driver.netplay_data);
+   if (driver.netplay_data &&
+         !netplay_pre_frame((netplay_t*)driver.netplay_data))
+   {
+      /* Waiting for the other side, keep showing the last frame. */
+      rarch_render_cached_frame();
+#if defined(HAVE_THREADS)
+      unlock_autosave();
+#endif
+      goto success;
+   }
 #endif
 
    if (g_extern.bsv.movie)
@@ -946,12 +1026,30 @@ int rarch_main_iterate(void)
             g_settings.input.analog_dpad_mode[i]);
    }
 
-   if ((g_settings.video.frame_delay > 0) && !driver.nonblock_state)
-      rarch_sleep(g_settings.video.frame_delay);
+   frame_delay = g_settings.video.frame_delay_auto ?
+      video_pacer_get_frame_delay() : g_settings.video.frame_delay;
+
+   if ((frame_delay > 0) && !driver.nonblock_state)
+      rarch_sleep(frame_delay);
+
 
+   if (g_extern.perfcnt_enable || g_settings.performance_mode)
+      iterate_start = rarch_get_time_usec();
+
+   if (g_extern.cheat)
+      cheat_manager_apply_ram_cheats(g_extern.cheat);
 
    /* Run libretro for one frame. */
-   pretro_run();
+   retro_input_poll_late_begin();
+   if (g_extern.benchmark.enable)
+      benchmark_core_run();
+   else
+      runahead_run();
+   retro_input_poll_late_end();
+
+   rarch_latency_test_iterate();
+
+   audio_driver_autotune_update();
 
    for (i = 0; i < g_settings.input.max_users; i++)
    {
@@ -965,6 +1063,10 @@ int rarch_main_iterate(void)
    if (g_extern.bsv.movie)
       bsv_movie_set_frame_end(g_extern.bsv.movie);
 
+#ifdef HAVE_SHM
+   memory_share_update();
+#endif
+
 #ifdef HAVE_NETPLAY
    if (driver.netplay_data)
       netplay_post_frame((netplay_t*)driver.netplay_data);
@@ -974,6 +1076,17 @@ int rarch_main_iterate(void)
    unlock_autosave();
 #endif
 
+   if (iterate_start)
+      iterate_time = rarch_get_time_usec() - iterate_start;
+
+   if (g_extern.perfcnt_enable)
+   {
+      rarch_perf_histogram_add(&perf_histogram_iterate, iterate_time);
+      rarch_perf_sample_update();
+   }
+
+   rarch_perf_governor_frame(iterate_time);
+
 success:
    if (g_settings.fastforward_ratio_throttle_enable)
       limit_frame_time();
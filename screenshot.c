@@ -24,6 +24,8 @@
 #include "general.h"
 #include <file/file_path.h>
 #include "gfx/scaler/scaler.h"
+#include "retroarch.h"
+#include "screenshot.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -105,7 +107,7 @@ static void dump_line_32(uint8_t *line, const uint32_t *src, unsigned width)
 }
 
 static void dump_content(FILE *file, const void *frame,
-      int width, int height, int pitch, bool bgr24)
+      int width, int height, int pitch, enum scaler_pix_fmt fmt)
 {
    int i, j;
    union
@@ -129,12 +131,12 @@ static void dump_content(FILE *file, const void *frame,
          goto end;
    }
 
-   if (bgr24) /* BGR24 byte order. Can directly copy. */
+   if (fmt == SCALER_FMT_BGR24) /* BGR24 byte order. Can directly copy. */
    {
       for (j = 0; j < height; j++, u.u8 += pitch)
          dump_line_bgr(lines[j], u.u8, width);
    }
-   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+   else if (fmt == SCALER_FMT_ARGB8888)
    {
       for (j = 0; j < height; j++, u.u8 += pitch)
          dump_line_32(lines[j], u.u32, width);
@@ -155,56 +157,46 @@ end:
 #endif
 
 /* Take frame bottom-up. */
-bool screenshot_dump(const char *folder, const void *frame,
-      unsigned width, unsigned height, int pitch, bool bgr24)
+static bool screenshot_write(const char *filename, const void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt)
 {
-   char filename[PATH_MAX_LENGTH];
-   char shotname[PATH_MAX_LENGTH];
-
-#ifdef HAVE_ZLIB_DEFLATE
-#define IMG_EXT "png"
-#else
-#define IMG_EXT "bmp"
-#endif
-
-   fill_dated_filename(shotname, IMG_EXT, sizeof(shotname));
-   fill_pathname_join(filename, folder, shotname, sizeof(filename));
-
 #ifdef HAVE_ZLIB_DEFLATE
+   bool ret;
+   struct scaler_ctx scaler = {0};
+   struct rpng_save_options options = {0};
    uint8_t *out_buffer = (uint8_t*)malloc(width * height * 3);
    if (!out_buffer)
       return false;
 
-   struct scaler_ctx scaler = {0};
+   options.level = g_settings.video.screenshot_compression_level;
+#ifdef HAVE_THREADS
+   options.pool  = rarch_get_thread_pool();
+   scaler.pool   = options.pool;
+#endif
+
    scaler.in_width   = width;
    scaler.in_height  = height;
    scaler.out_width  = width;
    scaler.out_height = height;
    scaler.in_stride  = -pitch;
    scaler.out_stride = width * 3;
+   scaler.in_fmt     = fmt;
    scaler.out_fmt = SCALER_FMT_BGR24;
    scaler.scaler_type = SCALER_TYPE_POINT;
 
-   if (bgr24)
-      scaler.in_fmt = SCALER_FMT_BGR24;
-   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
-      scaler.in_fmt = SCALER_FMT_ARGB8888;
-   else
-      scaler.in_fmt = SCALER_FMT_RGB565;
-
    scaler_ctx_gen_filter(&scaler);
    scaler_ctx_scale(&scaler, out_buffer,
          (const uint8_t*)frame + ((int)height - 1) * pitch);
    scaler_ctx_gen_reset(&scaler);
 
-   RARCH_LOG("Using RPNG for PNG screenshots.\n");
-   bool ret = rpng_save_image_bgr24(filename,
-         out_buffer, width, height, width * 3);
+   ret = rpng_save_image_bgr24_ext(filename,
+         out_buffer, width, height, width * 3, &options);
    if (!ret)
       RARCH_ERR("Failed to take screenshot.\n");
    free(out_buffer);
    return ret;
 #else
+   bool ret;
    FILE *file = fopen(filename, "wb");
    if (!file)
    {
@@ -212,10 +204,10 @@ bool screenshot_dump(const char *folder, const void *frame,
       return false;
    }
 
-   bool ret = write_header_bmp(file, width, height);
+   ret = write_header_bmp(file, width, height);
 
    if (ret)
-      dump_content(file, frame, width, height, pitch, bgr24);
+      dump_content(file, frame, width, height, pitch, fmt);
    else
       RARCH_ERR("Failed to write image header.\n");
 
@@ -224,3 +216,140 @@ bool screenshot_dump(const char *folder, const void *frame,
 #endif
 }
 
+static void screenshot_fill_filename(char *filename, size_t size,
+      const char *folder)
+{
+   char shotname[PATH_MAX_LENGTH];
+
+#ifdef HAVE_ZLIB_DEFLATE
+#define IMG_EXT "png"
+#else
+#define IMG_EXT "bmp"
+#endif
+
+   fill_dated_filename(shotname, IMG_EXT, sizeof(shotname));
+   fill_pathname_join(filename, folder, shotname, size);
+}
+
+bool screenshot_dump(const char *folder, const void *frame,
+      unsigned width, unsigned height, int pitch, bool bgr24)
+{
+   char filename[PATH_MAX_LENGTH];
+   enum scaler_pix_fmt fmt = SCALER_FMT_RGB565;
+
+   if (bgr24)
+      fmt = SCALER_FMT_BGR24;
+   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+      fmt = SCALER_FMT_ARGB8888;
+
+   screenshot_fill_filename(filename, sizeof(filename), folder);
+
+#ifdef HAVE_ZLIB_DEFLATE
+   RARCH_LOG("Using RPNG for PNG screenshots.\n");
+#endif
+   return screenshot_write(filename, frame, width, height, pitch, fmt);
+}
+
+#ifdef HAVE_THREADS
+typedef struct screenshot_task
+{
+   char filename[PATH_MAX_LENGTH];
+   void *frame;
+   unsigned width;
+   unsigned height;
+   int pitch;
+   enum scaler_pix_fmt fmt;
+} screenshot_task_t;
+
+/* Tasks of all screenshots still being encoded. */
+static sthread_group_t *screenshot_group;
+
+static void screenshot_task_run(void *data)
+{
+   screenshot_task_t *task = (screenshot_task_t*)data;
+
+   if (screenshot_write(task->filename, task->frame,
+            task->width, task->height, task->pitch, task->fmt))
+      RARCH_LOG("Saved screenshot \"%s\".\n", task->filename);
+
+   free(task->frame);
+   free(task);
+}
+#endif
+
+/**
+ * screenshot_queue:
+ * @filename                : path to save the image to.
+ * @frame                   : bottom-up frame, freed once written.
+ * @width                   : width of @frame.
+ * @height                  : height of @frame.
+ * @pitch                   : pitch of @frame in bytes.
+ * @fmt                     : pixel format of @frame.
+ *
+ * Returns: true (1) if the image was queued or written,
+ * otherwise false (0).
+ **/
+static bool screenshot_queue(const char *filename, void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt)
+{
+   bool ret;
+#ifdef HAVE_THREADS
+   sthread_pool_t *pool = rarch_get_thread_pool();
+
+   /* A pool without workers would only run the task 
+    * once somebody waits for it. */
+   if (pool && sthread_pool_threads(pool) > 1)
+   {
+      screenshot_task_t *task = NULL;
+
+      if (!screenshot_group)
+         screenshot_group = sthread_group_new(pool);
+
+      task = (screenshot_task_t*)calloc(1, sizeof(*task));
+
+      if (task && screenshot_group)
+      {
+         strlcpy(task->filename, filename, sizeof(task->filename));
+         task->frame  = frame;
+         task->width  = width;
+         task->height = height;
+         task->pitch  = pitch;
+         task->fmt    = fmt;
+
+         if (sthread_group_run(screenshot_group,
+                  screenshot_task_run, task))
+            return true;
+      }
+
+      free(task);
+   }
+#endif
+
+   ret = screenshot_write(filename, frame, width, height, pitch, fmt);
+   free(frame);
+   return ret;
+}
+
+bool screenshot_dump_async(const char *folder, void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt)
+{
+   char filename[PATH_MAX_LENGTH];
+
+   screenshot_fill_filename(filename, sizeof(filename), folder);
+   return screenshot_queue(filename, frame, width, height, pitch, fmt);
+}
+
+bool screenshot_dump_file_async(const char *filename, void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt)
+{
+   return screenshot_queue(filename, frame, width, height, pitch, fmt);
+}
+
+void screenshot_deinit(void)
+{
+#ifdef HAVE_THREADS
+   if (screenshot_group)
+      sthread_group_free(screenshot_group);
+   screenshot_group = NULL;
+#endif
+}
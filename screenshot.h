@@ -20,10 +20,54 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <boolean.h>
+#include <gfx/scaler/scaler.h>
 
 bool screenshot_dump(const char *folder, const void *frame, 
       unsigned width, unsigned height, int pitch, bool bgr24);
 
+/**
+ * screenshot_dump_async:
+ * @folder                  : directory to save the screenshot in.
+ * @frame                   : bottom-up frame, freed once written.
+ * @width                   : width of @frame.
+ * @height                  : height of @frame.
+ * @pitch                   : pitch of @frame in bytes.
+ * @fmt                     : pixel format of @frame.
+ *
+ * Converts and encodes the screenshot on the thread pool, 
+ * or right away if there are no worker threads.
+ *
+ * Returns: true (1) if the screenshot was queued or written, 
+ * otherwise false (0).
+ **/
+bool screenshot_dump_async(const char *folder, void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt);
+
+/**
+ * screenshot_dump_file_async:
+ * @filename                : path to save the image to.
+ * @frame                   : bottom-up frame, freed once written.
+ * @width                   : width of @frame.
+ * @height                  : height of @frame.
+ * @pitch                   : pitch of @frame in bytes.
+ * @fmt                     : pixel format of @frame.
+ *
+ * Like screenshot_dump_async(), to a path of the caller's
+ * choosing, for savestate thumbnails.
+ *
+ * Returns: true (1) if the image was queued or written, 
+ * otherwise false (0).
+ **/
+bool screenshot_dump_file_async(const char *filename, void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt);
+
+/**
+ * screenshot_deinit:
+ *
+ * Waits for all queued screenshots to be written.
+ **/
+void screenshot_deinit(void);
+
 void screenshot_generate_filename(char *filename, size_t size);
 
 #endif
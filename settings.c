@@ -29,6 +29,13 @@
 #endif
 
 #include <ctype.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 struct settings g_settings;
 struct global g_extern;
@@ -422,9 +429,17 @@ static void config_set_defaults(void)
    g_settings.video.vsync = vsync;
    g_settings.video.hard_sync = hard_sync;
    g_settings.video.hard_sync_frames = hard_sync_frames;
+   g_settings.video.hard_sync_adaptive = hard_sync_adaptive;
+   g_settings.video.gpu_pass_stats_show = gpu_pass_stats_show;
+   g_settings.perf_hud_show = perf_hud_show;
+   g_settings.perf_hud_count = perf_hud_count;
    g_settings.video.frame_delay = frame_delay;
+   g_settings.video.frame_delay_auto = frame_delay_auto;
+   g_settings.runahead_frames = runahead_frames;
+   g_settings.runahead_secondary_instance = runahead_secondary_instance;
    g_settings.video.black_frame_insertion = black_frame_insertion;
    g_settings.video.swap_interval = swap_interval;
+   g_settings.video.vrr = video_vrr;
    g_settings.video.threaded = video_threaded;
 
    if (g_defaults.settings.video_threaded_enable != video_threaded)
@@ -432,6 +447,7 @@ static void config_set_defaults(void)
 
    g_settings.video.shared_context = video_shared_context;
    g_settings.video.force_srgb_disable = false;
+   g_settings.video.gpu_pixel_unpack = video_gpu_pixel_unpack;
 #ifdef GEKKO
    g_settings.video.viwidth = video_viwidth;
    g_settings.video.vfilter = video_vfilter;
@@ -456,6 +472,7 @@ static void config_set_defaults(void)
    g_settings.video.msg_color_b = ((message_color >>  0) & 0xff) / 255.0f;
 
    g_settings.video.refresh_rate = refresh_rate;
+   g_settings.video.refresh_rate_track = refresh_rate_track;
 
    if (g_defaults.settings.video_refresh_rate > 0.0 &&
          g_defaults.settings.video_refresh_rate != refresh_rate)
@@ -463,7 +480,9 @@ static void config_set_defaults(void)
 
    g_settings.video.post_filter_record = post_filter_record;
    g_settings.video.gpu_record = gpu_record;
+   g_settings.replay_buffer = replay_buffer;
    g_settings.video.gpu_screenshot = gpu_screenshot;
+   g_settings.video.screenshot_compression_level = screenshot_compression_level;
    g_settings.video.rotation = ORIENTATION_NORMAL;
 
    g_settings.audio.enable = audio_enable;
@@ -481,6 +500,9 @@ static void config_set_defaults(void)
    g_settings.audio.sync = audio_sync;
    g_settings.audio.rate_control = rate_control;
    g_settings.audio.rate_control_delta = rate_control_delta;
+   g_settings.audio.rate_control_target = rate_control_target;
+   g_settings.audio.latency_autotune = audio_latency_autotune;
+   g_settings.audio.latency_autotuned = 0;
    g_settings.audio.max_timing_skew = max_timing_skew;
    g_settings.audio.volume = audio_volume;
    g_extern.audio_data.volume_gain = db_to_gain(g_settings.audio.volume);
@@ -488,6 +510,9 @@ static void config_set_defaults(void)
    g_settings.rewind_enable = rewind_enable;
    g_settings.rewind_buffer_size = rewind_buffer_size;
    g_settings.rewind_granularity = rewind_granularity;
+   g_settings.rewind_threaded = rewind_threaded;
+   g_settings.rewind_keyframe_interval = rewind_keyframe_interval;
+   g_settings.rewind_compression = rewind_compression;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
    g_settings.fastforward_ratio_throttle_enable = fastforward_ratio_throttle_enable;
@@ -496,18 +521,27 @@ static void config_set_defaults(void)
 
    g_settings.block_sram_overwrite = block_sram_overwrite;
    g_settings.savestate_auto_index = savestate_auto_index;
+   g_settings.savestate_compression = savestate_compression;
+   g_settings.savestate_thumbnail_enable = savestate_thumbnail_enable;
    g_settings.savestate_auto_save  = savestate_auto_save;
    g_settings.savestate_auto_load  = savestate_auto_load;
+   g_settings.resume_snapshot_enable = resume_snapshot_enable;
    g_settings.network_cmd_enable   = network_cmd_enable;
    g_settings.network_cmd_port     = network_cmd_port;
    g_settings.stdin_cmd_enable     = stdin_cmd_enable;
+   g_settings.command_server_enable = command_server_enable;
+   g_settings.command_server_port  = command_server_port;
    g_settings.content_history_size    = default_content_history_size;
    g_settings.libretro_log_level   = libretro_log_level;
+   g_settings.log_async_enable     = log_async_enable;
+   g_settings.libretro_warm_pool_size = libretro_warm_pool_size;
+   g_settings.performance_mode     = performance_mode;
 
 #ifdef HAVE_MENU
    g_settings.menu_show_start_screen = menu_show_start_screen;
    g_settings.menu.pause_libretro = true;
    g_settings.menu.mouse_enable = false;
+   g_settings.menu.idle_fps = menu_idle_fps;
    g_settings.menu.navigation.wraparound.horizontal_enable = true;
    g_settings.menu.navigation.wraparound.vertical_enable = true;
    g_settings.menu.navigation.browser.filter.supported_extensions_enable = true;
@@ -566,6 +600,9 @@ static void config_set_defaults(void)
    g_settings.input.overlay_opacity = 0.7f;
    g_settings.input.overlay_scale = 1.0f;
    g_settings.input.autodetect_enable = input_autodetect_enable;
+   g_settings.input.poll_late = input_poll_late;
+   g_settings.input.latency_test_axis = input_latency_test_axis;
+   g_settings.input.latency_test_threshold = input_latency_test_threshold;
    *g_settings.input.keyboard_layout = '\0';
 
    for (i = 0; i < MAX_USERS; i++)
@@ -596,13 +633,24 @@ static void config_set_defaults(void)
    *g_settings.core_options_path = '\0';
    *g_settings.content_history_path = '\0';
    *g_settings.content_history_directory = '\0';
+   *g_settings.resume_snapshot_path = '\0';
+   *g_settings.command_server_path = '\0';
+   *g_settings.memory_share_name = '\0';
+   for (i = 0; i < RARCH_THREAD_ROLE_LAST; i++)
+   {
+      strlcpy(g_settings.thread.priority[i], "default",
+            sizeof(g_settings.thread.priority[i]));
+      *g_settings.thread.affinity[i] = '\0';
+   }
    *g_settings.content_database = '\0';
    *g_settings.cheat_database = '\0';
    *g_settings.cheat_settings_path = '\0';
    *g_settings.resampler_directory = '\0';
    *g_settings.screenshot_directory = '\0';
+   *g_settings.replay_directory = '\0';
    *g_settings.system_directory = '\0';
    *g_settings.extraction_directory = '\0';
+   *g_settings.cache_directory = '\0';
    *g_settings.input.autoconfig_dir = '\0';
    *g_settings.input.overlay = '\0';
    *g_settings.content_directory = '\0';
@@ -610,6 +658,7 @@ static void config_set_defaults(void)
    *g_settings.playlist_directory = '\0';
    *g_settings.video.shader_path = '\0';
    *g_settings.video.shader_dir = '\0';
+   *g_settings.video.shader_cache_dir = '\0';
    *g_settings.video.filter_dir = '\0';
    *g_settings.audio.filter_dir = '\0';
    *g_settings.video.softfilter_plugin = '\0';
@@ -617,6 +666,7 @@ static void config_set_defaults(void)
 #ifdef HAVE_MENU
    *g_settings.menu_content_directory = '\0';
    *g_settings.menu_config_directory = '\0';
+   *g_settings.menu_image_cache_directory = '\0';
 #endif
    g_settings.core_specific_config = default_core_specific_config;
 
@@ -976,24 +1026,124 @@ static void config_read_keybinds_conf(config_file_t *conf)
 
 /* Also dumps inherited values, useful for logging. */
 
-static void config_file_dump_all(config_file_t *conf)
+static void config_file_dump_all(const config_file_t *conf)
 {
-   struct config_entry_list *list = NULL;
-   struct config_include_list *includes = conf->includes;
-
-   while (includes)
+   for (; conf; conf = conf->base)
    {
-      RARCH_LOG("#include \"%s\"\n", includes->path);
-      includes = includes->next;
+      struct config_entry_list *list = NULL;
+      struct config_include_list *includes = conf->includes;
+
+      while (includes)
+      {
+         RARCH_LOG("#include \"%s\"\n", includes->path);
+         includes = includes->next;
+      }
+
+      list = conf->entries;
+      while (list)
+      {
+         RARCH_LOG("%s = \"%s\" %s\n", list->key,
+               list->value, list->readonly ? "(included)" : "");
+         list = list->next;
+      }
    }
+}
+
+/* Parsed config files, so loading the same config again (every
+ * time content is loaded) does not parse it again. Appended
+ * configs are layered over the cached one per load instead of
+ * being merged into it. */
+#define CONFIG_CACHE_SIZE 2
+
+static struct config_cache_entry
+{
+   char path[PATH_MAX_LENGTH];
+   config_file_t *conf;
+   time_t mtime;
+   off_t size;
+   unsigned last_used;
+} config_cache[CONFIG_CACHE_SIZE];
 
-   list = conf->entries;
-   while (list)
+static unsigned config_cache_clock;
+
+static void config_cache_entry_free(struct config_cache_entry *entry)
+{
+   config_file_free(entry->conf);
+   memset(entry, 0, sizeof(*entry));
+}
+
+static void config_cache_drop(const char *path)
+{
+   unsigned i;
+
+   for (i = 0; i < CONFIG_CACHE_SIZE; i++)
+      if (config_cache[i].conf && !strcmp(config_cache[i].path, path))
+         config_cache_entry_free(&config_cache[i]);
+}
+
+/**
+ * config_cache_get:
+ * @path            : config file to get.
+ *
+ * Returns: parsed config file at @path, owned by the cache,
+ * or NULL if it could not be read.
+ */
+static const config_file_t *config_cache_get(const char *path)
+{
+   unsigned i;
+   config_file_t *conf = NULL;
+   struct config_cache_entry *entry = &config_cache[0];
+#ifndef RARCH_CONSOLE
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return NULL;
+#endif
+
+   config_cache_clock++;
+
+   for (i = 0; i < CONFIG_CACHE_SIZE; i++)
    {
-      RARCH_LOG("%s = \"%s\" %s\n", list->key,
-            list->value, list->readonly ? "(included)" : "");
-      list = list->next;
+      if (config_cache[i].conf && !strcmp(config_cache[i].path, path))
+      {
+         entry = &config_cache[i];
+#ifndef RARCH_CONSOLE
+         if (entry->mtime == st.st_mtime && entry->size == st.st_size)
+         {
+            entry->last_used = config_cache_clock;
+            return entry->conf;
+         }
+#endif
+         break;
+      }
+
+      if (config_cache[i].last_used < entry->last_used)
+         entry = &config_cache[i];
    }
+
+   config_cache_entry_free(entry);
+
+   if (!(conf = config_file_new(path)))
+      return NULL;
+
+   strlcpy(entry->path, path, sizeof(entry->path));
+   entry->conf      = conf;
+   entry->last_used = config_cache_clock;
+
+#ifndef RARCH_CONSOLE
+   entry->mtime     = st.st_mtime;
+   entry->size      = st.st_size;
+
+   /* Changes to #included files would go unnoticed, and mtimes
+    * may only have a resolution of a second. Such files are
+    * parsed again next time. */
+   if (conf->includes || st.st_mtime >= time(NULL))
+      entry->mtime  = (time_t)-1;
+#else
+   entry->mtime     = (time_t)-1;
+#endif
+
+   return conf;
 }
 
 /**
@@ -1016,9 +1166,10 @@ static bool config_load_file(const char *path, bool set_defaults)
 
    if (path)
    {
-      conf = config_file_new(path);
-      if (!conf)
+      const config_file_t *base = config_cache_get(path);
+      if (!base)
          return false;
+      conf = config_file_new_layer(base);
    }
    else
       conf = open_default_config_file();
@@ -1067,6 +1218,7 @@ static bool config_load_file(const char *path, bool set_defaults)
 #ifdef HAVE_MENU
    CONFIG_GET_BOOL(menu.pause_libretro, "menu_pause_libretro");
    CONFIG_GET_BOOL(menu.mouse_enable,   "menu_mouse_enable");
+   CONFIG_GET_INT(menu.idle_fps,        "menu_idle_fps");
    CONFIG_GET_BOOL(menu.navigation.wraparound.horizontal_enable, "menu_navigation_wraparound_horizontal_enable");
    CONFIG_GET_BOOL(menu.navigation.wraparound.vertical_enable,   "menu_navigation_wraparound_vertical_enable");
    CONFIG_GET_BOOL(menu.navigation.browser.filter.supported_extensions_enable,   "menu_navigation_browser_filter_supported_extensions_enable");
@@ -1075,15 +1227,25 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_INT(video.hard_sync_frames, "video_hard_sync_frames");
    if (g_settings.video.hard_sync_frames > 3)
       g_settings.video.hard_sync_frames = 3;
+   CONFIG_GET_BOOL(video.hard_sync_adaptive, "video_hard_sync_adaptive");
 
    CONFIG_GET_INT(video.frame_delay, "video_frame_delay");
    if (g_settings.video.frame_delay > 15)
       g_settings.video.frame_delay = 15;
+   CONFIG_GET_BOOL(video.frame_delay_auto, "video_frame_delay_auto");
+
+   CONFIG_GET_INT(runahead_frames, "run_ahead_frames");
+   if (g_settings.runahead_frames > 6)
+      g_settings.runahead_frames = 6;
+   CONFIG_GET_BOOL(runahead_secondary_instance,
+         "run_ahead_secondary_instance");
 
    CONFIG_GET_BOOL(video.black_frame_insertion, "video_black_frame_insertion");
    CONFIG_GET_INT(video.swap_interval, "video_swap_interval");
    g_settings.video.swap_interval = max(g_settings.video.swap_interval, 1);
    g_settings.video.swap_interval = min(g_settings.video.swap_interval, 4);
+   CONFIG_GET_INT(video.vrr, "video_vrr");
+   g_settings.video.vrr = min(g_settings.video.vrr, VIDEO_VRR_ON);
    CONFIG_GET_BOOL(video.threaded, "video_threaded");
    CONFIG_GET_BOOL(video.shared_context, "video_shared_context");
 #ifdef GEKKO
@@ -1098,6 +1260,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_INT(video.aspect_ratio_idx, "aspect_ratio_index");
    CONFIG_GET_BOOL(video.aspect_ratio_auto, "video_aspect_ratio_auto");
    CONFIG_GET_FLOAT(video.refresh_rate, "video_refresh_rate");
+   CONFIG_GET_BOOL(video.refresh_rate_track, "video_refresh_rate_track");
 
    CONFIG_GET_PATH(video.shader_path, "video_shader");
    CONFIG_GET_BOOL(video.shader_enable, "video_shader_enable");
@@ -1112,6 +1275,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_INT(video.rotation, "video_rotation");
 
    CONFIG_GET_BOOL(video.force_srgb_disable, "video_force_srgb_disable");
+   CONFIG_GET_BOOL(video.gpu_pixel_unpack, "video_gpu_pixel_unpack");
 
 #ifdef RARCH_CONSOLE
    /* TODO - will be refactored later to make it more clean - it's more 
@@ -1154,11 +1318,19 @@ static bool config_load_file(const char *path, bool set_defaults)
 
    CONFIG_GET_BOOL(video.post_filter_record, "video_post_filter_record");
    CONFIG_GET_BOOL(video.gpu_record, "video_gpu_record");
+   CONFIG_GET_INT(replay_buffer, "replay_buffer");
    CONFIG_GET_BOOL(video.gpu_screenshot, "video_gpu_screenshot");
+   CONFIG_GET_INT(video.screenshot_compression_level,
+         "video_screenshot_compression_level");
+   if (g_settings.video.screenshot_compression_level > 9)
+      g_settings.video.screenshot_compression_level = 9;
 
    CONFIG_GET_PATH(video.shader_dir, "video_shader_dir");
    if (!strcmp(g_settings.video.shader_dir, "default"))
       *g_settings.video.shader_dir = '\0';
+   CONFIG_GET_PATH(video.shader_cache_dir, "video_shader_cache_dir");
+   if (!strcmp(g_settings.video.shader_cache_dir, "default"))
+      *g_settings.video.shader_cache_dir = '\0';
 
    CONFIG_GET_PATH(video.filter_dir, "video_filter_dir");
    if (!strcmp(g_settings.video.filter_dir, "default"))
@@ -1206,6 +1378,9 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(audio.sync, "audio_sync");
    CONFIG_GET_BOOL(audio.rate_control, "audio_rate_control");
    CONFIG_GET_FLOAT(audio.rate_control_delta, "audio_rate_control_delta");
+   CONFIG_GET_INT(audio.rate_control_target, "audio_rate_control_target");
+   CONFIG_GET_BOOL(audio.latency_autotune, "audio_latency_autotune");
+   CONFIG_GET_INT(audio.latency_autotuned, "audio_latency_autotuned");
    CONFIG_GET_FLOAT(audio.max_timing_skew, "audio_max_timing_skew");
    CONFIG_GET_FLOAT(audio.volume, "audio_volume");
    CONFIG_GET_STRING(audio.resampler, "audio_resampler");
@@ -1242,6 +1417,9 @@ static bool config_load_file(const char *path, bool set_defaults)
    }
 
    CONFIG_GET_BOOL(fps_show, "fps_show");
+   CONFIG_GET_BOOL(video.gpu_pass_stats_show, "video_gpu_pass_stats_show");
+   CONFIG_GET_BOOL(perf_hud_show, "perf_hud_show");
+   CONFIG_GET_INT(perf_hud_count, "perf_hud_count");
    CONFIG_GET_BOOL(fps_monitor_enable, "fps_monitor_enable");
    CONFIG_GET_BOOL(load_dummy_on_core_shutdown, "load_dummy_on_core_shutdown");
 
@@ -1260,8 +1438,23 @@ static bool config_load_file(const char *path, bool set_defaults)
       }
    }
 
+   CONFIG_GET_PATH(replay_directory, "replay_directory");
+   if (*g_settings.replay_directory)
+   {
+      if (!strcmp(g_settings.replay_directory, "default"))
+         *g_settings.replay_directory = '\0';
+      else if (!path_is_directory(g_settings.replay_directory))
+      {
+         RARCH_WARN("replay_directory is not an existing directory, ignoring ...\n");
+         *g_settings.replay_directory = '\0';
+      }
+   }
+
    CONFIG_GET_PATH(resampler_directory, "resampler_directory");
    CONFIG_GET_PATH(extraction_directory, "extraction_directory");
+   CONFIG_GET_PATH(cache_directory, "cache_directory");
+   if (!strcmp(g_settings.cache_directory, "default"))
+      *g_settings.cache_directory = '\0';
    CONFIG_GET_PATH(content_directory, "content_directory");
    CONFIG_GET_PATH(assets_directory, "assets_directory");
    CONFIG_GET_PATH(playlist_directory, "playlist_directory");
@@ -1278,9 +1471,15 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_PATH(menu_config_directory, "rgui_config_directory");
    if (!strcmp(g_settings.menu_config_directory, "default"))
       *g_settings.menu_config_directory = '\0';
+   CONFIG_GET_PATH(menu_image_cache_directory, "menu_image_cache_directory");
+   if (!strcmp(g_settings.menu_image_cache_directory, "default"))
+      *g_settings.menu_image_cache_directory = '\0';
    CONFIG_GET_BOOL(menu_show_start_screen, "rgui_show_start_screen");
 #endif
    CONFIG_GET_INT(libretro_log_level, "libretro_log_level");
+   CONFIG_GET_BOOL(log_async_enable, "log_async_enable");
+   CONFIG_GET_INT(libretro_warm_pool_size, "libretro_warm_pool_size");
+   CONFIG_GET_BOOL(performance_mode, "performance_mode");
 
    if (!g_extern.has_set_verbosity)
       CONFIG_GET_BOOL_EXTERN(verbosity, "log_verbosity");
@@ -1307,6 +1506,9 @@ static bool config_load_file(const char *path, bool set_defaults)
       g_settings.rewind_buffer_size = buffer_size * UINT64_C(1000000);
 
    CONFIG_GET_INT(rewind_granularity, "rewind_granularity");
+   CONFIG_GET_BOOL(rewind_threaded, "rewind_threaded");
+   CONFIG_GET_INT(rewind_keyframe_interval, "rewind_keyframe_interval");
+   CONFIG_GET_BOOL(rewind_compression, "rewind_compression");
    CONFIG_GET_FLOAT(slowmotion_ratio, "slowmotion_ratio");
    if (g_settings.slowmotion_ratio < 1.0f)
       g_settings.slowmotion_ratio = 1.0f;
@@ -1329,12 +1531,39 @@ static bool config_load_file(const char *path, bool set_defaults)
 
    CONFIG_GET_BOOL(block_sram_overwrite, "block_sram_overwrite");
    CONFIG_GET_BOOL(savestate_auto_index, "savestate_auto_index");
+   CONFIG_GET_BOOL(savestate_compression, "savestate_compression");
+   CONFIG_GET_BOOL(savestate_thumbnail_enable, "savestate_thumbnail_enable");
    CONFIG_GET_BOOL(savestate_auto_save, "savestate_auto_save");
    CONFIG_GET_BOOL(savestate_auto_load, "savestate_auto_load");
+   CONFIG_GET_BOOL(resume_snapshot_enable, "resume_snapshot_enable");
+   CONFIG_GET_PATH(resume_snapshot_path, "resume_snapshot_path");
+
+   if (!*g_settings.resume_snapshot_path)
+      fill_pathname_resolve_relative(g_settings.resume_snapshot_path,
+            g_extern.config_path, "retroarch-resume.cfg",
+            sizeof(g_settings.resume_snapshot_path));
 
    CONFIG_GET_BOOL(network_cmd_enable, "network_cmd_enable");
    CONFIG_GET_INT(network_cmd_port, "network_cmd_port");
    CONFIG_GET_BOOL(stdin_cmd_enable, "stdin_cmd_enable");
+   CONFIG_GET_BOOL(command_server_enable, "command_server_enable");
+   CONFIG_GET_INT(command_server_port, "command_server_port");
+   CONFIG_GET_PATH(command_server_path, "command_server_path");
+   CONFIG_GET_STRING(memory_share_name, "memory_share_name");
+
+   for (i = 0; i < RARCH_THREAD_ROLE_LAST; i++)
+   {
+      char key[64];
+
+      snprintf(key, sizeof(key), "thread_%s_priority",
+            rarch_thread_role_name((enum rarch_thread_role)i));
+      config_get_array(conf, key, g_settings.thread.priority[i],
+            sizeof(g_settings.thread.priority[i]));
+      snprintf(key, sizeof(key), "thread_%s_affinity",
+            rarch_thread_role_name((enum rarch_thread_role)i));
+      config_get_array(conf, key, g_settings.thread.affinity[i],
+            sizeof(g_settings.thread.affinity[i]));
+   }
 
    CONFIG_GET_PATH(content_history_directory, "content_history_dir");
 
@@ -1347,6 +1576,10 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_INT(input.turbo_duty_cycle, "input_duty_cycle");
 
    CONFIG_GET_BOOL(input.autodetect_enable, "input_autodetect_enable");
+   CONFIG_GET_BOOL(input.poll_late, "input_poll_late");
+   CONFIG_GET_INT(input.latency_test_axis, "input_latency_test_axis");
+   CONFIG_GET_INT(input.latency_test_threshold,
+         "input_latency_test_threshold");
    CONFIG_GET_PATH(input.autoconfig_dir, "joypad_autoconfig_dir");
 
    if (!g_extern.has_set_username)
@@ -1673,6 +1906,8 @@ void config_load(void)
          g_settings.config_save_on_exit && g_settings.core_specific_config)
       config_save_file(g_extern.core_specific_config_path);
 
+   config_save_flush(NULL);
+
    /* Flush out some states that could have been set by core environment variables */
    g_extern.has_set_input_descriptors = false;
 
@@ -1686,6 +1921,98 @@ void config_load(void)
    config_load_core_specific();
 }
 
+typedef struct config_save_job
+{
+   char path[PATH_MAX_LENGTH];
+   char *data;
+   size_t len;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+#endif
+   struct config_save_job *next;
+} config_save_job_t;
+
+static config_save_job_t *config_save_jobs;
+
+static void config_save_job_write(void *data)
+{
+   config_save_job_t *job = (config_save_job_t*)data;
+
+   if (!config_file_write_data(job->path, job->data, job->len))
+      RARCH_ERR("Failed to write config to \"%s\".\n", job->path);
+}
+
+/**
+ * config_save_flush:
+ * @path            : Path to wait for, or NULL for all of them.
+ *
+ * Waits for config files queued by config_save_file() to be
+ * on disk. Anything reading a saved config file back goes
+ * through here first.
+ */
+void config_save_flush(const char *path)
+{
+   config_save_job_t **link = &config_save_jobs;
+
+   while (*link)
+   {
+      config_save_job_t *job = *link;
+
+      if (path && strcmp(job->path, path))
+      {
+         link = &job->next;
+         continue;
+      }
+
+#ifdef HAVE_THREADS
+      sthread_join(job->thread);
+#endif
+      *link = job->next;
+      free(job->data);
+      free(job);
+   }
+}
+
+/**
+ * config_save_queue:
+ * @conf            : Config to save.
+ * @path            : Path that shall be written to.
+ *
+ * Serializes @conf and leaves writing it out to a worker thread,
+ * so slow storage does not hold up the caller.
+ *
+ * Returns: true (1) if the config was queued, otherwise false (0).
+ */
+static bool config_save_queue(config_file_t *conf, const char *path)
+{
+   config_save_job_t *job = (config_save_job_t*)
+      calloc(1, sizeof(*job));
+
+   if (!job)
+      return false;
+
+   strlcpy(job->path, path, sizeof(job->path));
+   if (!(job->data = config_file_serialize(conf, &job->len)))
+   {
+      free(job);
+      return false;
+   }
+
+#ifdef HAVE_THREADS
+   if ((job->thread = sthread_create(config_save_job_write, job)))
+   {
+      job->next        = config_save_jobs;
+      config_save_jobs = job;
+      return true;
+   }
+#endif
+
+   config_save_job_write(job);
+   free(job->data);
+   free(job);
+   return true;
+}
+
 /**
  * config_save_file:
  * @path            : Path that shall be written to.
@@ -1698,9 +2025,12 @@ bool config_save_file(const char *path)
 {
    unsigned i = 0;
    bool ret = false;
-   config_file_t *conf = config_file_new(path);
+   config_file_t *conf = NULL;
 
-   if (!conf)
+   /* The file is read back for the values not saved here. */
+   config_save_flush(path);
+
+   if (!(conf = config_file_new(path)))
       conf = config_file_new(NULL);
 
    if (!conf)
@@ -1724,6 +2054,21 @@ bool config_save_file(const char *path)
    config_set_bool(conf,  "load_dummy_on_core_shutdown",
          g_settings.load_dummy_on_core_shutdown);
    config_set_bool(conf,  "fps_show", g_settings.fps_show);
+   config_set_bool(conf,  "video_gpu_pass_stats_show",
+         g_settings.video.gpu_pass_stats_show);
+   config_set_bool(conf,  "perf_hud_show", g_settings.perf_hud_show);
+   config_set_int(conf,   "perf_hud_count", g_settings.perf_hud_count);
+   for (i = 0; i < RARCH_THREAD_ROLE_LAST; i++)
+   {
+      char key[64];
+
+      snprintf(key, sizeof(key), "thread_%s_priority",
+            rarch_thread_role_name((enum rarch_thread_role)i));
+      config_set_string(conf, key, g_settings.thread.priority[i]);
+      snprintf(key, sizeof(key), "thread_%s_affinity",
+            rarch_thread_role_name((enum rarch_thread_role)i));
+      config_set_string(conf, key, g_settings.thread.affinity[i]);
+   }
    config_set_bool(conf,  "fps_monitor_enable", g_settings.fps_monitor_enable);
    config_set_path(conf,  "libretro_path", g_settings.libretro);
    config_set_path(conf,  "libretro_directory", g_settings.libretro_directory);
@@ -1736,6 +2081,12 @@ bool config_save_file(const char *path)
    config_set_bool(conf,  "audio_sync",    g_settings.audio.sync);
    config_set_int(conf,   "audio_block_frames", g_settings.audio.block_frames);
    config_set_int(conf,   "rewind_granularity", g_settings.rewind_granularity);
+   config_set_int(conf,   "replay_buffer", g_settings.replay_buffer);
+   config_set_bool(conf,  "rewind_threaded", g_settings.rewind_threaded);
+   config_set_int(conf,   "rewind_keyframe_interval",
+         g_settings.rewind_keyframe_interval);
+   config_set_bool(conf,  "rewind_compression",
+         g_settings.rewind_compression);
    config_set_path(conf,  "video_shader", g_settings.video.shader_path);
    config_set_bool(conf,  "video_shader_enable",
          g_settings.video.shader_enable);
@@ -1756,8 +2107,12 @@ bool config_save_file(const char *path)
          g_settings.video.shared_context);
    config_set_bool(conf,  "video_force_srgb_disable",
          g_settings.video.force_srgb_disable);
+   config_set_bool(conf,  "video_gpu_pixel_unpack",
+         g_settings.video.gpu_pixel_unpack);
    config_set_bool(conf,  "video_fullscreen", g_settings.video.fullscreen);
    config_set_float(conf, "video_refresh_rate", g_settings.video.refresh_rate);
+   config_set_bool(conf,  "video_refresh_rate_track",
+         g_settings.video.refresh_rate_track);
    config_set_int(conf,   "video_monitor_index",
          g_settings.video.monitor_index);
    config_set_int(conf,   "video_fullscreen_x", g_settings.video.fullscreen_x);
@@ -1767,23 +2122,37 @@ bool config_save_file(const char *path)
    config_set_string(conf,"menu_driver", g_settings.menu.driver);
    config_set_bool(conf,"menu_pause_libretro", g_settings.menu.pause_libretro);
    config_set_bool(conf,"menu_mouse_enable", g_settings.menu.mouse_enable);
+   config_set_int(conf,"menu_idle_fps", g_settings.menu.idle_fps);
 #endif
    config_set_bool(conf,  "video_vsync", g_settings.video.vsync);
    config_set_bool(conf,  "video_hard_sync", g_settings.video.hard_sync);
    config_set_int(conf,   "video_hard_sync_frames",
          g_settings.video.hard_sync_frames);
+   config_set_bool(conf,  "video_hard_sync_adaptive",
+         g_settings.video.hard_sync_adaptive);
    config_set_int(conf,   "video_frame_delay", g_settings.video.frame_delay);
+   config_set_bool(conf,  "video_frame_delay_auto",
+         g_settings.video.frame_delay_auto);
+   config_set_int(conf,   "run_ahead_frames", g_settings.runahead_frames);
+   config_set_bool(conf,  "run_ahead_secondary_instance",
+         g_settings.runahead_secondary_instance);
    config_set_bool(conf,  "video_black_frame_insertion",
          g_settings.video.black_frame_insertion);
    config_set_bool(conf,  "video_disable_composition",
          g_settings.video.disable_composition);
    config_set_bool(conf,  "pause_nonactive", g_settings.pause_nonactive);
    config_set_int(conf, "video_swap_interval", g_settings.video.swap_interval);
+   config_set_int(conf, "video_vrr", g_settings.video.vrr);
    config_set_bool(conf, "video_gpu_screenshot", g_settings.video.gpu_screenshot);
+   config_set_int(conf, "video_screenshot_compression_level",
+         g_settings.video.screenshot_compression_level);
    config_set_int(conf, "video_rotation", g_settings.video.rotation);
    config_set_path(conf, "screenshot_directory",
          *g_settings.screenshot_directory ?
          g_settings.screenshot_directory : "default");
+   config_set_path(conf, "replay_directory",
+         *g_settings.replay_directory ?
+         g_settings.replay_directory : "default");
    config_set_int(conf, "aspect_ratio_index", g_settings.video.aspect_ratio_idx);
    config_set_string(conf, "audio_device", g_settings.audio.device);
    config_set_string(conf, "video_filter", g_settings.video.softfilter_plugin);
@@ -1793,6 +2162,12 @@ bool config_save_file(const char *path)
    config_set_bool(conf, "audio_rate_control", g_settings.audio.rate_control);
    config_set_float(conf, "audio_rate_control_delta",
          g_settings.audio.rate_control_delta);
+   config_set_int(conf, "audio_rate_control_target",
+         g_settings.audio.rate_control_target);
+   config_set_bool(conf, "audio_latency_autotune",
+         g_settings.audio.latency_autotune);
+   config_set_int(conf, "audio_latency_autotuned",
+         g_settings.audio.latency_autotuned);
    config_set_float(conf, "audio_max_timing_skew",
          g_settings.audio.max_timing_skew);
    config_set_float(conf, "audio_volume", g_settings.audio.volume);
@@ -1811,6 +2186,9 @@ bool config_save_file(const char *path)
          g_settings.system_directory : "default");
    config_set_path(conf, "extraction_directory",
          g_settings.extraction_directory);
+   config_set_path(conf, "cache_directory",
+         *g_settings.cache_directory ?
+         g_settings.cache_directory : "default");
    config_set_path(conf, "resampler_directory",
          g_settings.resampler_directory);
    config_set_string(conf, "audio_resampler", g_settings.audio.resampler);
@@ -1821,6 +2199,9 @@ bool config_save_file(const char *path)
    config_set_path(conf, "video_shader_dir",
          *g_settings.video.shader_dir ?
          g_settings.video.shader_dir : "default");
+   config_set_path(conf, "video_shader_cache_dir",
+         *g_settings.video.shader_cache_dir ?
+         g_settings.video.shader_cache_dir : "default");
    config_set_path(conf, "video_filter_dir",
          *g_settings.video.filter_dir ?
          g_settings.video.filter_dir : "default");
@@ -1844,6 +2225,9 @@ bool config_save_file(const char *path)
    config_set_path(conf, "rgui_config_directory",
          *g_settings.menu_config_directory ?
          g_settings.menu_config_directory : "default");
+   config_set_path(conf, "menu_image_cache_directory",
+         *g_settings.menu_image_cache_directory ?
+         g_settings.menu_image_cache_directory : "default");
    config_set_bool(conf, "rgui_show_start_screen",
          g_settings.menu_show_start_screen);
    config_set_bool(conf, "menu_navigation_wraparound_horizontal_enable",
@@ -1860,6 +2244,11 @@ bool config_save_file(const char *path)
          g_settings.input.autoconfig_dir);
    config_set_bool(conf, "input_autodetect_enable",
          g_settings.input.autodetect_enable);
+   config_set_bool(conf, "input_poll_late", g_settings.input.poll_late);
+   config_set_int(conf, "input_latency_test_axis",
+         g_settings.input.latency_test_axis);
+   config_set_int(conf, "input_latency_test_threshold",
+         g_settings.input.latency_test_threshold);
 
 #ifdef HAVE_OVERLAY
    config_set_path(conf, "overlay_directory",
@@ -1903,10 +2292,16 @@ bool config_save_file(const char *path)
          g_settings.block_sram_overwrite);
    config_set_bool(conf, "savestate_auto_index",
          g_settings.savestate_auto_index);
+   config_set_bool(conf, "savestate_compression",
+         g_settings.savestate_compression);
+   config_set_bool(conf, "savestate_thumbnail_enable",
+         g_settings.savestate_thumbnail_enable);
    config_set_bool(conf, "savestate_auto_save",
          g_settings.savestate_auto_save);
    config_set_bool(conf, "savestate_auto_load",
          g_settings.savestate_auto_load);
+   config_set_bool(conf, "resume_snapshot_enable",
+         g_settings.resume_snapshot_enable);
    config_set_bool(conf, "history_list_enable",
          g_settings.history_list_enable);
 
@@ -1958,12 +2353,19 @@ bool config_save_file(const char *path)
    config_set_bool(conf, "core_specific_config",
          g_settings.core_specific_config);
    config_set_int(conf, "libretro_log_level", g_settings.libretro_log_level);
+   config_set_bool(conf, "log_async_enable", g_settings.log_async_enable);
+   config_set_int(conf, "libretro_warm_pool_size",
+         g_settings.libretro_warm_pool_size);
+   config_set_bool(conf, "performance_mode", g_settings.performance_mode);
    config_set_bool(conf, "log_verbosity", g_extern.verbosity);
    config_set_bool(conf, "perfcnt_enable", g_extern.perfcnt_enable);
 
    config_set_int(conf, "archive_mode", g_settings.archive.mode);
 
-   ret = config_file_write(conf, path);
+   ret = config_save_queue(conf, path);
    config_file_free(conf);
+
+   /* Same mtime and size would not tell it apart. */
+   config_cache_drop(path);
    return ret;
 }
@@ -116,12 +116,23 @@ void config_load(void);
  * config_save_file:
  * @path            : Path that shall be written to.
  *
- * Writes a config file to disk.
+ * Writes a config file to disk. The file is written out on a
+ * worker thread, config_save_flush() waits for it.
  *
- * Returns: true (1) on success, otherwise returns false (0).
+ * Returns: true (1) if the config was built and queued,
+ * otherwise returns false (0).
  */
 bool config_save_file(const char *path);
 
+/**
+ * config_save_flush:
+ * @path            : Path to wait for, or NULL for all of them.
+ *
+ * Waits for config files queued by config_save_file() to be
+ * on disk.
+ */
+void config_save_flush(const char *path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,7 @@
 #include "file_ext.h"
 #include "settings.h"
 #include "retroarch.h"
+#include "performance.h"
 
 #if defined(__CELLOS_LV2__)
 #include <sdk_version.h>
@@ -1954,6 +1955,24 @@ int setting_data_get_description(const char *label, char *msg,
             "-- Enable or disable verbosity level \n"
             "of frontend.");
    }
+   else if (!strcmp(label, "log_async_enable"))
+   {
+      snprintf(msg, sizeof_msg,
+            "-- Writes the log from a thread, so \n"
+            "logging does not hold up the frame. \n"
+            " \n"
+            "Repeats of a line are written as a \n"
+            "count. Takes effect on restart.");
+   }
+   else if (!strcmp(label, "performance_mode"))
+   {
+      snprintf(msg, sizeof_msg,
+            "-- Asks the device for speeds it \n"
+            "can keep up, and saves rewind state \n"
+            "less often, then drops the shader, \n"
+            "while it runs hot or frames start \n"
+            "to run late.");
+   }
    else if (!strcmp(label, "perfcnt_enable"))
    {
       snprintf(msg, sizeof_msg,
@@ -2044,6 +2063,38 @@ int setting_data_get_description(const char *label, char *msg,
             " 1: Syncs to previous frame.\n"
             " 2: Etc ...");
    }
+   else if (!strcmp(label, "video_gpu_pass_stats_show"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Shows how long the GPU spends \n"
+            "on each shader pass, in milliseconds.\n"
+            " \n"
+            "Useful to find the pass which makes \n"
+            "a shader preset too slow.\n"
+            " \n"
+            "Needs GL_ARB_timer_query.");
+   }
+   else if (!strcmp(label, "perf_hud_show"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Shows the performance counters \n"
+            "which took the most time over the \n"
+            "last second, the core's included.\n"
+            " \n"
+            "Needs performance counters enabled.");
+   }
+   else if (!strcmp(label, "video_hard_sync_adaptive"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Adaptive 'GPU Hard Sync'.\n"
+            " \n"
+            "Syncs to GPU immediately, then delays \n"
+            "the next frame by the measured CPU and \n"
+            "GPU frame time, so it completes just \n"
+            "before VSync.\n"
+            " \n"
+            "Ignores 'GPU Hard Sync Frames'.");
+   }
    else if (!strcmp(label, "video_frame_delay"))
    {
       snprintf(msg, sizeof_msg,
@@ -2055,6 +2106,50 @@ int setting_data_get_description(const char *label, char *msg,
             " \n"
             "Maximum is 15.");
    }
+   else if (!strcmp(label, "video_frame_delay_auto"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Picks the frame delay from swap\n"
+            "timing instead of 'Frame Delay'.\n"
+            " \n"
+            "Grows the delay while the core finishes\n"
+            "well before VSync, and backs off when\n"
+            "VSyncs are missed.");
+   }
+   else if (!strcmp(label, "video_refresh_rate_track"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Replaces 'Refresh Rate' with the\n"
+            "rate measured from swap timing, once\n"
+            "that estimate is stable.\n"
+            " \n"
+            "Audio rate control then follows the\n"
+            "actual display.");
+   }
+   else if (!strcmp(label, "run_ahead_frames"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Runs the core ahead by this many\n"
+            "frames and rolls it back afterwards.\n"
+            " \n"
+            "Removes input lag of the core itself.\n"
+            "Needs savestate support, and runs the\n"
+            "core (N + 1) times per frame.\n"
+            " \n"
+            "Maximum is 6.");
+   }
+   else if (!strcmp(label, "run_ahead_secondary_instance"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Use a second instance of the core\n"
+            "for run-ahead frames.\n"
+            " \n"
+            "The main core is never rolled back,\n"
+            "so audio stays intact. Needs twice\n"
+            "the memory.\n"
+            " \n"
+            "Takes effect when content is loaded.");
+   }
    else if (!strcmp(label, "audio_rate_control_delta"))
    {
       snprintf(msg, sizeof_msg,
@@ -2070,6 +2165,33 @@ int setting_data_get_description(const char *label, char *msg,
             " Input rate is defined as: \n"
             " input rate * (1.0 +/- (rate control delta))");
    }
+   else if (!strcmp(label, "audio_rate_control_target"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Audio rate control target.\n"
+            " \n"
+            "Amount of audio in milliseconds rate \n"
+            "control keeps buffered in the audio driver.\n"
+            " \n"
+            "Lower values give lower latency, but \n"
+            "can underrun on a busy system.\n"
+            " \n"
+            "0 keeps the buffer half full.");
+   }
+   else if (!strcmp(label, "audio_latency_autotune"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Audio latency auto-tuning.\n"
+            " \n"
+            "Starts with a low audio latency and \n"
+            "raises it whenever the audio driver \n"
+            "runs dry, until it plays without \n"
+            "underruns.\n"
+            " \n"
+            "Audio Latency is the upper bound. \n"
+            "With per-core configs, the learned \n"
+            "latency is saved for each core.");
+   }
    else if (!strcmp(label, "audio_max_timing_skew"))
    {
       snprintf(msg, sizeof_msg,
@@ -2140,6 +2262,17 @@ int setting_data_get_description(const char *label, char *msg,
             "configured as if it is a 60 Hz monitor \n"
             "(divide refresh rate by 2).");
    }
+   else if (!strcmp(label, "video_gpu_pixel_unpack"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Converts frames on the GPU.\n"
+            " \n"
+            "Frames the GL driver would convert on \n"
+            "the CPU are uploaded as they are and \n"
+            "converted by a small shader pass. \n"
+            "Halves upload bandwidth for 16-bit \n"
+            "cores on GL without RGB565 support.");
+   }
    else if (!strcmp(label, "video_threaded"))
    {
       snprintf(msg, sizeof_msg,
@@ -2235,6 +2368,14 @@ int setting_data_get_description(const char *label, char *msg,
             " -- Screenshots output of GPU shaded \n"
             "material if available.");
    }
+   else if (!strcmp(label, "video_screenshot_compression_level"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- zlib level of PNG screenshots. \n"
+            " \n"
+            "Low levels save much faster, for \n"
+            "slightly bigger files.");
+   }
    else if (!strcmp(label, "autosave_interval"))
    {
       snprintf(msg, sizeof_msg,
@@ -2255,6 +2396,27 @@ int setting_data_get_description(const char *label, char *msg,
             "Directory to dump screenshots to."
             );
    }
+   else if (!strcmp(label, "replay_directory"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Replay Directory. \n"
+            " \n"
+            "Directory to save replays to. \n"
+            "Uses the screenshot directory if \n"
+            "not set.");
+   }
+   else if (!strcmp(label, "replay_buffer"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Replay Buffer. \n"
+            " \n"
+            "Seconds of gameplay kept encoded \n"
+            "in memory, written out by the \n"
+            "Save Replay hotkey. \n"
+            " \n"
+            "A value of 0 disables it. Takes \n"
+            "effect when content is loaded.");
+   }
    else if (!strcmp(label, "video_swap_interval"))
    {
       snprintf(msg, sizeof_msg,
@@ -2263,6 +2425,19 @@ int setting_data_get_description(const char *label, char *msg,
             "Uses a custom swap interval for VSync. Set this \n"
             "to effectively halve monitor refresh rate.");
    }
+   else if (!strcmp(label, "video_vrr"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Variable Refresh Rate.\n"
+            " \n"
+            "On FreeSync and G-Sync displays, presents \n"
+            "frames at the exact rate of the core and \n"
+            "lets the display follow. Audio is not \n"
+            "resampled to the refresh rate then. \n"
+            " \n"
+            "0: Off. 1: If the display reports it. \n"
+            "2: Always.");
+   }
    else if (!strcmp(label, "video_refresh_rate_auto"))
    {
       snprintf(msg, sizeof_msg,
@@ -2352,6 +2527,39 @@ int setting_data_get_description(const char *label, char *msg,
             "at a time, increasing the rewinding \n"
             "speed.");
    }
+   else if (!strcmp(label, "rewind_keyframe_interval"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Rewind keyframe interval.\n"
+            " \n"
+            "Stores every Nth rewind state in full. \n"
+            "Makes seeking far back fast, but uses \n"
+            "more of the rewind buffer. \n"
+            " \n"
+            "0 disables keyframes.");
+   }
+   else if (!strcmp(label, "rewind_threaded"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Threaded rewind.\n"
+            " \n"
+            "Compresses rewind states on a separate \n"
+            "thread. Smooths out frame times with \n"
+            "big savestates. Takes effect the next \n"
+            "time rewind is enabled.");
+   }
+   else if (!strcmp(label, "rewind_compression"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Rewind compression.\n"
+            " \n"
+            "Compresses rewind states further, for \n"
+            "as long as that pays off with the \n"
+            "running core. Fits more rewind time \n"
+            "into the buffer at some CPU cost. \n"
+            "Takes effect the next time rewind \n"
+            "is enabled.");
+   }
    else if (!strcmp(label, "rewind_enable"))
    {
       snprintf(msg, sizeof_msg,
@@ -2368,6 +2576,16 @@ int setting_data_get_description(const char *label, char *msg,
             "Will attempt to auto-configure \n"
             "joypads, Plug-and-Play style.");
    }
+   else if (!strcmp(label, "input_poll_late"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Polls input when the core first \n"
+            "reads it in a frame, rather than \n"
+            "when the core asks for a poll. \n"
+            " \n"
+            "Cuts latency for cores which poll \n"
+            "early. Best used with a frame delay.");
+   }
    else if (!strcmp(label, "camera_allow"))
    {
       snprintf(msg, sizeof_msg,
@@ -2617,6 +2835,10 @@ int setting_data_get_description(const char *label, char *msg,
    else if (!strcmp(label, "cheat_toggle"))
       snprintf(msg, sizeof_msg,
             " -- Toggle cheat index.\n");
+   else if (!strcmp(label, "latency_test"))
+      snprintf(msg, sizeof_msg,
+            " -- Turns the next frame white and \n"
+            "logs how long it took to show it.");
    else if (!strcmp(label, "shader_prev"))
       snprintf(msg, sizeof_msg,
             " -- Applies previous shader in directory.");
@@ -3060,6 +3282,10 @@ static void general_write_handler(void *data)
       g_extern.audio_data.volume_gain = db_to_gain(*setting->value.fraction);
    else if (!strcmp(setting->name, "audio_latency"))
       rarch_cmd = RARCH_CMD_AUDIO_REINIT;
+   else if (!strcmp(setting->name, "audio_rate_control_target"))
+      rarch_cmd = RARCH_CMD_AUDIO_REINIT;
+   else if (!strcmp(setting->name, "audio_latency_autotune"))
+      rarch_cmd = RARCH_CMD_AUDIO_REINIT;
    else if (!strcmp(setting->name, "audio_rate_control_delta"))
    {
       if (*setting->value.fraction < 0.0005)
@@ -3402,6 +3628,12 @@ static bool setting_data_append_list_main_menu_options(
             group_info.name,
             subgroup_info.name);
    }
+
+   CONFIG_ACTION(
+         "memory_information",
+         "Memory Information",
+         group_info.name,
+         subgroup_info.name);
    if (g_extern.main_is_init && !g_extern.libretro_dummy)
    {
       CONFIG_ACTION(
@@ -3663,6 +3895,38 @@ static bool setting_data_append_list_general_options(
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 3, 1.0, true, true);
 
+   CONFIG_BOOL(g_settings.log_async_enable,
+         "log_async_enable",
+         "Log From A Thread",
+         log_async_enable,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
+   CONFIG_UINT(g_settings.libretro_warm_pool_size,
+         "libretro_warm_pool_size",
+         "Core Warm Pool Size (MB)",
+         libretro_warm_pool_size,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 512, 16, true, true);
+
+   CONFIG_BOOL(g_settings.performance_mode,
+         "performance_mode",
+         "Performance Mode",
+         performance_mode,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_BOOL(g_extern.perfcnt_enable,
          "perfcnt_enable",
          "Performance Counters",
@@ -3720,6 +3984,38 @@ static bool setting_data_append_list_general_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_BOOL(g_settings.video.gpu_pass_stats_show,
+         "video_gpu_pass_stats_show",
+         "Show GPU Pass Times",
+         gpu_pass_stats_show,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
+   CONFIG_BOOL(g_settings.perf_hud_show,
+         "perf_hud_show",
+         "Show Performance Counters",
+         perf_hud_show,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
+   CONFIG_UINT(g_settings.perf_hud_count,
+         "perf_hud_count",
+         "Performance Counters Shown",
+         perf_hud_count,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 1, PERF_HUD_LINES, 1, true, true);
+
    CONFIG_BOOL(
          g_settings.rewind_enable,
          "rewind_enable",
@@ -3755,6 +4051,43 @@ static bool setting_data_append_list_general_options(
             general_read_handler);
    settings_list_current_add_range(list, list_info, 1, 32768, 1, true, false);
 
+   CONFIG_UINT(
+         g_settings.rewind_keyframe_interval,
+         "rewind_keyframe_interval",
+         "Rewind Keyframe Interval",
+         rewind_keyframe_interval,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 36000, 60, true, false);
+
+#ifdef HAVE_THREADS
+   CONFIG_BOOL(
+         g_settings.rewind_threaded,
+         "rewind_threaded",
+         "Threaded Rewind",
+         rewind_threaded,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+#endif
+
+   CONFIG_BOOL(
+         g_settings.rewind_compression,
+         "rewind_compression",
+         "Rewind Compression",
+         rewind_compression,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_BOOL(
          g_settings.block_sram_overwrite,
          "block_sram_overwrite",
@@ -3856,6 +4189,30 @@ static bool setting_data_append_list_general_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_BOOL(
+         g_settings.savestate_compression,
+         "savestate_compression",
+         "Save State Compression",
+         savestate_compression,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
+   CONFIG_BOOL(
+         g_settings.savestate_thumbnail_enable,
+         "savestate_thumbnail_enable",
+         "Save State Thumbnails",
+         savestate_thumbnail_enable,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_BOOL(
          g_settings.savestate_auto_save,
          "savestate_auto_save",
@@ -3880,6 +4237,18 @@ static bool setting_data_append_list_general_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_BOOL(
+         g_settings.resume_snapshot_enable,
+         "resume_snapshot_enable",
+         "Resume Snapshot",
+         resume_snapshot_enable,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_INT(
          g_settings.state_slot,
          "state_slot",
@@ -3992,6 +4361,18 @@ static bool setting_data_append_list_video_options(
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 0, 0.001, true, false);
 
+   CONFIG_BOOL(
+         g_settings.video.refresh_rate_track,
+         "video_refresh_rate_track",
+         "Track Measured Refresh Rate",
+         refresh_rate_track,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_BOOL(g_settings.fps_monitor_enable,
          "fps_monitor_enable",
          "Monitor FPS Enable",
@@ -4032,6 +4413,20 @@ static bool setting_data_append_list_video_options(
    settings_list_current_add_cmd(list, list_info, RARCH_CMD_REINIT);
    settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
 
+   CONFIG_BOOL(
+         g_settings.video.gpu_pixel_unpack,
+         "video_gpu_pixel_unpack",
+         "GPU Pixel Format Conversion",
+         video_gpu_pixel_unpack,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_cmd(list, list_info, RARCH_CMD_REINIT);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
+
    END_SUB_GROUP(list, list_info);
 
    START_SUB_GROUP(list, list_info, "Aspect", group_info.name, subgroup_info);
@@ -4299,6 +4694,18 @@ static bool setting_data_append_list_video_options(
    settings_list_current_add_range(list, list_info, 1, 4, 1, true, true);
    settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
 
+   CONFIG_UINT(
+         g_settings.video.vrr,
+         "video_vrr",
+         "Variable Refresh Rate",
+         video_vrr,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_cmd(list, list_info, RARCH_CMD_REINIT);
+   settings_list_current_add_range(list, list_info, 0, 2, 1, true, true);
+
    CONFIG_BOOL(
          g_settings.video.hard_sync,
          "video_hard_sync",
@@ -4322,6 +4729,18 @@ static bool setting_data_append_list_video_options(
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 3, 1, true, true);
 
+   CONFIG_BOOL(
+         g_settings.video.hard_sync_adaptive,
+         "video_hard_sync_adaptive",
+         "Hard GPU Sync Adaptive",
+         hard_sync_adaptive,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_UINT(
          g_settings.video.frame_delay,
          "video_frame_delay",
@@ -4332,6 +4751,42 @@ static bool setting_data_append_list_video_options(
          general_write_handler,
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
+
+   CONFIG_BOOL(
+         g_settings.video.frame_delay_auto,
+         "video_frame_delay_auto",
+         "Frame Delay Auto",
+         frame_delay_auto,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
+   CONFIG_UINT(
+         g_settings.runahead_frames,
+         "run_ahead_frames",
+         "Run-Ahead Frames",
+         runahead_frames,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 6, 1, true, true);
+#ifdef HAVE_DYNAMIC
+   CONFIG_BOOL(
+         g_settings.runahead_secondary_instance,
+         "run_ahead_secondary_instance",
+         "Run-Ahead Second Instance",
+         runahead_secondary_instance,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+#endif
 #if !defined(RARCH_MOBILE)
    CONFIG_BOOL(
          g_settings.video.black_frame_insertion,
@@ -4378,6 +4833,17 @@ static bool setting_data_append_list_video_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_UINT(
+         g_settings.replay_buffer,
+         "replay_buffer",
+         "Replay Buffer (seconds)",
+         replay_buffer,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 600, 5, true, true);
+
    CONFIG_BOOL(
          g_settings.video.gpu_screenshot,
          "video_gpu_screenshot",
@@ -4390,6 +4856,17 @@ static bool setting_data_append_list_video_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_UINT(
+         g_settings.video.screenshot_compression_level,
+         "video_screenshot_compression_level",
+         "Screenshot Compression Level",
+         screenshot_compression_level,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 9, 1, true, true);
+
    CONFIG_BOOL(
          g_settings.video.allow_rotate,
          "video_allow_rotate",
@@ -4692,6 +5169,31 @@ static bool setting_data_append_list_audio_options(
          true,
          false);
 
+   CONFIG_UINT(
+         g_settings.audio.rate_control_target,
+         "audio_rate_control_target",
+         "Audio Rate Control Target",
+         rate_control_target,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 256, 1.0, true, true);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_IS_DEFERRED);
+
+   CONFIG_BOOL(
+         g_settings.audio.latency_autotune,
+         "audio_latency_autotune",
+         "Audio Latency Auto-Tune",
+         audio_latency_autotune,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_IS_DEFERRED);
+
    CONFIG_FLOAT(
          g_settings.audio.max_timing_skew,
          "audio_max_timing_skew",
@@ -4816,6 +5318,18 @@ static bool setting_data_append_list_input_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_BOOL(
+         g_settings.input.poll_late,
+         "input_poll_late",
+         "Late Input Polling",
+         input_poll_late,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+
    CONFIG_BOOL(
          g_settings.input.autoconfig_descriptor_label_show,
          "autoconfig_descriptor_label_show",
@@ -5048,6 +5562,11 @@ static bool setting_data_append_list_input_options(
        * 2 is the length of '99'; we don't need more users than that.
        */
       static char buffer[MAX_USERS][7+2+1];
+      /* Like buffer, these outlive the list being built and are
+       * rewritten by the next one, which only starts once the
+       * previous list has been freed. */
+      static char name[MAX_USERS][RARCH_BIND_LIST_END][64];
+      static char label[MAX_USERS][RARCH_BIND_LIST_END][128];
       const struct retro_keybind* const defaults =
          (user == 0) ? retro_keybinds_1 : retro_keybinds_rest;
 
@@ -5062,8 +5581,6 @@ static bool setting_data_append_list_input_options(
 
       for (i = 0; i < RARCH_BIND_LIST_END; i ++)
       {
-         char label[PATH_MAX_LENGTH];
-         char name[PATH_MAX_LENGTH];
          bool do_add = true;
          const struct input_bind_map* keybind = 
             (const struct input_bind_map*)&input_config_bind_map[i];
@@ -5079,20 +5596,23 @@ static bool setting_data_append_list_input_options(
                )
          {
             if (g_extern.system.input_desc_btn[user][i])
-               snprintf(label, sizeof(label), "%s %s", buffer[user],
-                     g_extern.system.input_desc_btn[user][i]);
+               snprintf(label[user][i], sizeof(label[user][i]), "%s %s",
+                     buffer[user], g_extern.system.input_desc_btn[user][i]);
             else
             {
-               snprintf(label, sizeof(label), "%s %s", buffer[user], "N/A");
+               snprintf(label[user][i], sizeof(label[user][i]), "%s %s",
+                     buffer[user], "N/A");
 
                if (g_settings.input.input_descriptor_hide_unbound)
                   do_add = false;
             }
          }
          else
-            snprintf(label, sizeof(label), "%s %s", buffer[user], keybind->desc);
+            snprintf(label[user][i], sizeof(label[user][i]), "%s %s",
+                  buffer[user], keybind->desc);
 
-         snprintf(name, sizeof(name), "p%u_%s", user + 1, keybind->base);
+         snprintf(name[user][i], sizeof(name[user][i]), "p%u_%s",
+               user + 1, keybind->base);
 
          if (do_add)
          {
@@ -5100,8 +5620,8 @@ static bool setting_data_append_list_input_options(
                   g_settings.input.binds[user][i],
                   user + 1,
                   user,
-                  strdup(name), /* TODO: Find a way to fix these memleaks. */
-                  strdup(label),
+                  name[user][i],
+                  label[user][i],
                   &defaults[i],
                   group_info.name,
                   subgroup_info.name);
@@ -5275,6 +5795,17 @@ static bool setting_data_append_list_menu_options(
          general_write_handler,
          general_read_handler);
 
+   CONFIG_UINT(
+         g_settings.menu.idle_fps,
+         "menu_idle_fps",
+         "Idle Frame Rate",
+         menu_idle_fps,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 60, 1, true, true);
+
    END_SUB_GROUP(list, list_info);
 
    START_SUB_GROUP(list, list_info, "Navigation", group_info.name, subgroup_info);
@@ -5644,6 +6175,21 @@ static bool setting_data_append_list_path_options(
          list_info,
          SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
 
+   CONFIG_DIR(
+         g_settings.menu_image_cache_directory,
+         "menu_image_cache_directory",
+         "Menu Image Cache Directory",
+         "",
+         "<default>",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_data_list_current_add_flags(
+         list,
+         list_info,
+         SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
+
 #endif
 
    CONFIG_DIR(
@@ -5764,6 +6310,21 @@ static bool setting_data_append_list_path_options(
          list,
          list_info,
          SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
+
+   CONFIG_DIR(
+         g_settings.video.shader_cache_dir,
+         "video_shader_cache_dir",
+         "Shader Cache Directory",
+         "",
+         "<default>",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_data_list_current_add_flags(
+         list,
+         list_info,
+         SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
 #endif
 
 #ifdef HAVE_OVERLAY
@@ -5813,6 +6374,21 @@ static bool setting_data_append_list_path_options(
          list_info,
          SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
 
+   CONFIG_DIR(
+         g_settings.replay_directory,
+         "replay_directory",
+         "Replay Directory",
+         "",
+         "<Screenshot dir>",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_data_list_current_add_flags(
+         list,
+         list_info,
+         SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
+
    CONFIG_DIR(
          g_settings.input.autoconfig_dir,
          "joypad_autoconfig_dir",
@@ -5902,6 +6478,21 @@ static bool setting_data_append_list_path_options(
          list,
          list_info,
          SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
+
+   CONFIG_DIR(
+         g_settings.cache_directory,
+         "cache_directory",
+         "Cache Directory",
+         "",
+         "<default>",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_data_list_current_add_flags(
+         list,
+         list_info,
+         SD_FLAG_ALLOW_EMPTY | SD_FLAG_PATH_DIR | SD_FLAG_BROWSER_ACTION);
    END_SUB_GROUP(list, list_info);
    END_GROUP(list, list_info);
 
@@ -5959,6 +6550,15 @@ static bool setting_data_append_list_privacy_options(
  **/
 rarch_setting_t *setting_data_new(unsigned mask)
 {
+   /* Sizes of the lists built so far, by mask. The same mask
+    * nearly always makes a list of the same size, so the next
+    * one is allocated in one go rather than grown. */
+   static struct
+   {
+      unsigned mask;
+      int size;
+   } size_hints[4];
+   unsigned i;
    rarch_setting_t terminator = { ST_NONE };
    rarch_setting_t* list = NULL;
    rarch_setting_t* resized_list = NULL;
@@ -5967,6 +6567,15 @@ rarch_setting_t *setting_data_new(unsigned mask)
    if (!list_info)
       return NULL;
 
+   for (i = 0; i < ARRAY_SIZE(size_hints); i++)
+   {
+      if (size_hints[i].mask == mask && size_hints[i].size)
+      {
+         list_info->size = size_hints[i].size;
+         break;
+      }
+   }
+
    list = (rarch_setting_t*)settings_list_new(list_info->size);
    if (!list)
       goto error;
@@ -6070,12 +6679,25 @@ rarch_setting_t *setting_data_new(unsigned mask)
    if (!(settings_list_append(&list, list_info, terminator)))
       goto error;
 
+   for (i = 0; i < ARRAY_SIZE(size_hints); i++)
+   {
+      if (size_hints[i].mask == mask || !size_hints[i].size)
+      {
+         size_hints[i].mask = mask;
+         size_hints[i].size = list_info->index;
+         break;
+      }
+   }
+
    /* flatten this array to save ourselves some kilobytes. */
-   resized_list = (rarch_setting_t*) realloc(list, list_info->index * sizeof(rarch_setting_t));
-   if (resized_list)
-      list = resized_list;
-   else
-      goto error;
+   if (list_info->index < list_info->size)
+   {
+      resized_list = (rarch_setting_t*) realloc(list, list_info->index * sizeof(rarch_setting_t));
+      if (resized_list)
+         list = resized_list;
+      else
+         goto error;
+   }
 
    settings_info_list_free(list_info);
 
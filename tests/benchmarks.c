@@ -0,0 +1,1055 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Micro-benchmarks of the hot paths of the frontend: rewind,
+ * resampling, pixel conversion, scaling, softfilters, PNG,
+ * config parsing, directory listing, database lookups and hashing.
+ *
+ * Every case runs long enough to be timed reliably, and the best
+ * of several runs is reported as ns/op and MB/s. Inputs come from
+ * a fixed seed, so that runs can be compared with each other.
+ *
+ * Built with "make benchmarks" from the top level directory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <file/dir_list.h>
+#include <file/config_file.h>
+#include <string/string_list.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/pixconv.h>
+
+#include "../general.h"
+#include "../performance.h"
+#include "../rewind.h"
+#include "../hash.h"
+#include "../frontend/frontend_driver.h"
+#include "../frontend/frontend.h"
+#include "../audio/audio_resampler_driver.h"
+#include "../gfx/video_filter.h"
+#include "../gfx/rpng/rpng.h"
+#include "../rarchdb/rarchdb.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* Everything but frontend.c is linked in, which still wants these. */
+void main_exit(args_type() args)
+{
+   (void)args;
+}
+
+void main_exit_save_config(void)
+{
+}
+
+bool main_load_content(int argc, char **argv,
+      args_type() args, environment_get_t environ_get,
+      process_args_t process_args)
+{
+   (void)argc;
+   (void)argv;
+   (void)args;
+   (void)environ_get;
+   (void)process_args;
+   return false;
+}
+
+struct bench_config
+{
+   const char *filter;
+   double min_seconds;
+   unsigned runs;
+   const char *filter_dir;
+   const char *work_dir;
+};
+
+static struct bench_config bench_conf = {
+   NULL, 0.2, 5, "gfx/video_filters", ".",
+};
+
+typedef void (*bench_fn_t)(void *data, unsigned iterations);
+
+struct bench_case
+{
+   const char *name;
+   /* Runs @iterations operations. */
+   bench_fn_t run;
+   /* Optional. Called before each timed run, with the same @iterations. */
+   bench_fn_t setup;
+   void *data;
+   /* Payload of one operation, 0 if throughput makes no sense. */
+   size_t bytes;
+   /* 0 for no limit. */
+   unsigned max_iterations;
+};
+
+static uint32_t bench_seed;
+
+/* xorshift32, so that every run sees the same inputs. */
+static uint32_t bench_rand(void)
+{
+   bench_seed ^= bench_seed << 13;
+   bench_seed ^= bench_seed >> 17;
+   bench_seed ^= bench_seed << 5;
+   return bench_seed;
+}
+
+static void bench_fill(void *data, size_t size)
+{
+   size_t i;
+   uint8_t *ptr = (uint8_t*)data;
+
+   for (i = 0; i < size; i++)
+      ptr[i] = bench_rand() >> 24;
+}
+
+static retro_time_t bench_time(const struct bench_case *bench,
+      unsigned iterations)
+{
+   retro_time_t start;
+
+   if (bench->setup)
+      bench->setup(bench->data, iterations);
+
+   start = rarch_get_time_usec();
+   bench->run(bench->data, iterations);
+   return rarch_get_time_usec() - start;
+}
+
+/**
+ * bench_run:
+ * @bench              : case to run.
+ *
+ * Doubles the iteration count until a run takes the minimum
+ * time, then keeps the fastest of the configured number of runs.
+ * The fastest run is the one least disturbed by the rest of
+ * the system, which makes it the most repeatable.
+ **/
+static void bench_run(const struct bench_case *bench)
+{
+   unsigned i;
+   double ns, best_ns = 0.0;
+   unsigned iterations = 1;
+   retro_time_t min_usec = (retro_time_t)(bench_conf.min_seconds * 1000000.0);
+
+   if (bench_conf.filter && !strstr(bench->name, bench_conf.filter))
+      return;
+
+   for (;;)
+   {
+      retro_time_t elapsed = bench_time(bench, iterations);
+
+      if (elapsed >= min_usec)
+         break;
+      if (bench->max_iterations && iterations >= bench->max_iterations)
+         break;
+
+      /* Jump close to the target once a run is long enough to go by. */
+      if (elapsed > 1000)
+         iterations = (unsigned)(iterations *
+               (1.2 * (double)min_usec / (double)elapsed));
+      else
+         iterations *= 2;
+
+      if (bench->max_iterations && iterations > bench->max_iterations)
+         iterations = bench->max_iterations;
+   }
+
+   for (i = 0; i < bench_conf.runs; i++)
+   {
+      retro_time_t elapsed = bench_time(bench, iterations);
+
+      ns = (double)elapsed * 1000.0 / iterations;
+      if (i == 0 || ns < best_ns)
+         best_ns = ns;
+   }
+
+   if (bench->bytes)
+      printf("%-36s %14.1f ns/op %10.1f MB/s %10u ops\n", bench->name,
+            best_ns, (double)bench->bytes * 1000.0 / best_ns, iterations);
+   else
+      printf("%-36s %14.1f ns/op %10s      %10u ops\n", bench->name,
+            best_ns, "-", iterations);
+   fflush(stdout);
+}
+
+static void bench_work_path(char *path, size_t size, const char *name)
+{
+   fill_pathname_join(path, bench_conf.work_dir, name, size);
+}
+
+/* Rewind */
+
+#define BENCH_REWIND_STATE_SIZE  (128 * 1024)
+#define BENCH_REWIND_BUFFER_SIZE (64 * 1024 * 1024)
+#define BENCH_REWIND_CHANGES     256
+#define BENCH_REWIND_MAX_POPS    2048
+
+struct bench_rewind
+{
+   state_manager_t *state;
+   uint8_t *frame;
+   /* Where the next state changes, as a core would touch RAM. */
+   uint32_t offsets[BENCH_REWIND_CHANGES];
+};
+
+static void bench_rewind_push_one(struct bench_rewind *rewind)
+{
+   unsigned i;
+   void *where = NULL;
+
+   for (i = 0; i < BENCH_REWIND_CHANGES; i++)
+      rewind->frame[rewind->offsets[i]]++;
+   rewind->offsets[bench_rand() % BENCH_REWIND_CHANGES] =
+      bench_rand() % BENCH_REWIND_STATE_SIZE;
+
+   state_manager_push_where(rewind->state, &where);
+   memcpy(where, rewind->frame, BENCH_REWIND_STATE_SIZE);
+   state_manager_push_do(rewind->state);
+}
+
+static void bench_rewind_push(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_rewind *rewind = (struct bench_rewind*)data;
+
+   for (i = 0; i < iterations; i++)
+      bench_rewind_push_one(rewind);
+}
+
+static void bench_rewind_fill(void *data, unsigned iterations)
+{
+   bench_rewind_push(data, iterations + 1);
+}
+
+static void bench_rewind_pop(void *data, unsigned iterations)
+{
+   unsigned i;
+   const void *state;
+   struct bench_rewind *rewind = (struct bench_rewind*)data;
+
+   for (i = 0; i < iterations; i++)
+      state_manager_pop(rewind->state, &state);
+}
+
+static void bench_rewind(void)
+{
+   unsigned i;
+   struct bench_rewind rewind;
+   struct bench_case push = { "rewind/push", bench_rewind_push, NULL,
+      &rewind, BENCH_REWIND_STATE_SIZE, 0 };
+   struct bench_case pop  = { "rewind/pop", bench_rewind_pop,
+      bench_rewind_fill, &rewind, BENCH_REWIND_STATE_SIZE,
+      BENCH_REWIND_MAX_POPS };
+
+   rewind.frame = (uint8_t*)malloc(BENCH_REWIND_STATE_SIZE);
+   rewind.state = state_manager_new(BENCH_REWIND_STATE_SIZE,
+         BENCH_REWIND_BUFFER_SIZE, 0, false, false);
+   if (!rewind.frame || !rewind.state)
+      goto end;
+
+   bench_fill(rewind.frame, BENCH_REWIND_STATE_SIZE);
+   for (i = 0; i < BENCH_REWIND_CHANGES; i++)
+      rewind.offsets[i] = bench_rand() % BENCH_REWIND_STATE_SIZE;
+
+   bench_run(&push);
+   bench_run(&pop);
+
+end:
+   state_manager_free(rewind.state);
+   free(rewind.frame);
+}
+
+/* Resamplers */
+
+#define BENCH_RESAMPLER_FRAMES 1024
+
+struct bench_resampler
+{
+   const rarch_resampler_t *backend;
+   void *handle;
+   float *in;
+   float *out;
+   double ratio;
+};
+
+static void bench_resampler_process(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_resampler *re = (struct bench_resampler*)data;
+
+   for (i = 0; i < iterations; i++)
+   {
+      struct resampler_data src = {0};
+
+      src.data_in      = re->in;
+      src.data_out     = re->out;
+      src.input_frames = BENCH_RESAMPLER_FRAMES;
+      src.ratio        = re->ratio;
+      rarch_resampler_process(re->backend, re->handle, &src);
+   }
+}
+
+static void bench_resamplers(void)
+{
+   unsigned i;
+   static const char *idents[] = { "sinc", "CC", "nearest" };
+   struct bench_resampler re = {0};
+
+   /* Like a core at 32040.5 Hz going out at 48 kHz. */
+   re.ratio = 48000.0 / 32040.5;
+   re.in    = (float*)malloc(BENCH_RESAMPLER_FRAMES * 2 * sizeof(float));
+   re.out   = (float*)malloc((size_t)(BENCH_RESAMPLER_FRAMES * re.ratio * 2
+            + 64) * 2 * sizeof(float));
+   if (!re.in || !re.out)
+      goto end;
+
+   for (i = 0; i < BENCH_RESAMPLER_FRAMES * 2; i++)
+      re.in[i] = (float)((int32_t)bench_rand()) / 2147483648.0f;
+
+   for (i = 0; i < ARRAY_SIZE(idents); i++)
+   {
+      char name[64];
+      struct bench_case bench = { name, bench_resampler_process, NULL,
+         &re, BENCH_RESAMPLER_FRAMES * 2 * sizeof(float), 0 };
+
+      if (!rarch_resampler_realloc(&re.handle, &re.backend,
+               idents[i], re.ratio))
+         continue;
+
+      snprintf(name, sizeof(name), "resampler/%s", idents[i]);
+      bench_run(&bench);
+      rarch_resampler_freep(&re.backend, &re.handle);
+   }
+
+end:
+   free(re.in);
+   free(re.out);
+}
+
+/* Pixel conversion and scaling */
+
+#define BENCH_FRAME_WIDTH  640
+#define BENCH_FRAME_HEIGHT 480
+
+typedef void (*bench_conv_t)(void *output, const void *input,
+      int width, int height, int out_stride, int in_stride);
+
+struct bench_pixconv
+{
+   bench_conv_t conv;
+   unsigned in_bpp;
+   unsigned out_bpp;
+   const void *in;
+   void *out;
+};
+
+static void bench_pixconv_run(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_pixconv *pix = (struct bench_pixconv*)data;
+
+   for (i = 0; i < iterations; i++)
+      pix->conv(pix->out, pix->in, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT,
+            BENCH_FRAME_WIDTH * pix->out_bpp,
+            BENCH_FRAME_WIDTH * pix->in_bpp);
+}
+
+static void bench_pixconv(const void *in, void *out)
+{
+   unsigned i;
+   static const struct
+   {
+      const char *name;
+      bench_conv_t conv;
+      unsigned in_bpp, out_bpp;
+   } convs[] = {
+      { "pixconv/rgb565-argb8888",   conv_rgb565_argb8888,   2, 4 },
+      { "pixconv/0rgb1555-argb8888", conv_0rgb1555_argb8888, 2, 4 },
+      { "pixconv/0rgb1555-rgb565",   conv_0rgb1555_rgb565,   2, 2 },
+      { "pixconv/argb8888-abgr8888", conv_argb8888_abgr8888, 4, 4 },
+      { "pixconv/argb8888-bgr24",    conv_argb8888_bgr24,    4, 3 },
+      { "pixconv/bgr24-argb8888",    conv_bgr24_argb8888,    3, 4 },
+      { "pixconv/yuyv-argb8888",     conv_yuyv_argb8888,     2, 4 },
+   };
+
+   for (i = 0; i < ARRAY_SIZE(convs); i++)
+   {
+      struct bench_pixconv pix = { convs[i].conv, convs[i].in_bpp,
+         convs[i].out_bpp, in, out };
+      struct bench_case bench = { convs[i].name, bench_pixconv_run, NULL,
+         &pix, BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT * convs[i].in_bpp, 0 };
+
+      bench_run(&bench);
+   }
+}
+
+struct bench_scaler
+{
+   struct scaler_ctx ctx;
+   const void *in;
+   void *out;
+};
+
+static void bench_scaler_run(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_scaler *scaler = (struct bench_scaler*)data;
+
+   for (i = 0; i < iterations; i++)
+      scaler_ctx_scale(&scaler->ctx, scaler->out, scaler->in);
+}
+
+static void bench_scaler(const void *in, void *out)
+{
+   unsigned i;
+   static const struct
+   {
+      const char *name;
+      enum scaler_type type;
+      enum scaler_pix_fmt in_fmt;
+      unsigned in_bpp;
+   } scalers[] = {
+      { "scaler/point-rgb565-2x",      SCALER_TYPE_POINT,    SCALER_FMT_RGB565,   2 },
+      { "scaler/bilinear-rgb565-2x",   SCALER_TYPE_BILINEAR, SCALER_FMT_RGB565,   2 },
+      { "scaler/point-argb8888-2x",    SCALER_TYPE_POINT,    SCALER_FMT_ARGB8888, 4 },
+      { "scaler/bilinear-argb8888-2x", SCALER_TYPE_BILINEAR, SCALER_FMT_ARGB8888, 4 },
+      { "scaler/sinc-argb8888-2x",     SCALER_TYPE_SINC,     SCALER_FMT_ARGB8888, 4 },
+   };
+
+   /* A quarter of the frame to all of it, like a 320x240 core. */
+   for (i = 0; i < ARRAY_SIZE(scalers); i++)
+   {
+      struct bench_scaler scaler;
+      struct bench_case bench = { scalers[i].name, bench_scaler_run, NULL,
+         &scaler, (BENCH_FRAME_WIDTH / 2) * (BENCH_FRAME_HEIGHT / 2)
+            * scalers[i].in_bpp, 0 };
+
+      memset(&scaler, 0, sizeof(scaler));
+      scaler.in                = in;
+      scaler.out               = out;
+      scaler.ctx.in_width      = BENCH_FRAME_WIDTH / 2;
+      scaler.ctx.in_height     = BENCH_FRAME_HEIGHT / 2;
+      scaler.ctx.in_stride     = (BENCH_FRAME_WIDTH / 2) * scalers[i].in_bpp;
+      scaler.ctx.in_fmt        = scalers[i].in_fmt;
+      scaler.ctx.out_width     = BENCH_FRAME_WIDTH;
+      scaler.ctx.out_height    = BENCH_FRAME_HEIGHT;
+      scaler.ctx.out_stride    = BENCH_FRAME_WIDTH * sizeof(uint32_t);
+      scaler.ctx.out_fmt       = SCALER_FMT_ARGB8888;
+      scaler.ctx.scaler_type   = scalers[i].type;
+
+      if (!scaler_ctx_gen_filter(&scaler.ctx))
+         continue;
+
+      bench_run(&bench);
+      scaler_ctx_gen_reset(&scaler.ctx);
+   }
+}
+
+/* Softfilters */
+
+#define BENCH_FILTER_WIDTH  256
+#define BENCH_FILTER_HEIGHT 224
+
+struct bench_softfilter
+{
+   rarch_softfilter_t *filt;
+   const void *in;
+   void *out;
+   size_t out_stride;
+};
+
+static void bench_softfilter_run(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_softfilter *soft = (struct bench_softfilter*)data;
+
+   for (i = 0; i < iterations; i++)
+      rarch_softfilter_process(soft->filt, soft->out, soft->out_stride,
+            soft->in, BENCH_FILTER_WIDTH, BENCH_FILTER_HEIGHT,
+            BENCH_FILTER_WIDTH * sizeof(uint16_t));
+}
+
+static void bench_softfilters(const void *in)
+{
+   unsigned i;
+   struct string_list *list = dir_list_new(bench_conf.filter_dir,
+         "filt", false);
+
+   if (!list || !list->size)
+   {
+      fprintf(stderr, "No softfilters in \"%s\", skipping them.\n",
+            bench_conf.filter_dir);
+      string_list_free(list);
+      return;
+   }
+
+   dir_list_sort(list, false);
+
+   for (i = 0; i < list->size; i++)
+   {
+      char name[PATH_MAX_LENGTH];
+      unsigned width = 0, height = 0;
+      struct bench_softfilter soft = {0};
+      struct bench_case bench = { name, bench_softfilter_run, NULL,
+         &soft, BENCH_FILTER_WIDTH * BENCH_FILTER_HEIGHT * sizeof(uint16_t),
+         0 };
+      const char *path = list->elems[i].data;
+
+      snprintf(name, sizeof(name), "softfilter/%s", path_basename(path));
+      path_remove_extension(name);
+
+      if (bench_conf.filter && !strstr(name, bench_conf.filter))
+         continue;
+
+      soft.filt = rarch_softfilter_new(path, RARCH_SOFTFILTER_THREADS_AUTO,
+            RETRO_PIXEL_FORMAT_RGB565, BENCH_FILTER_WIDTH,
+            BENCH_FILTER_HEIGHT);
+      if (!soft.filt)
+      {
+         fprintf(stderr, "Could not load \"%s\", skipping it.\n", path);
+         continue;
+      }
+
+      rarch_softfilter_get_max_output_size(soft.filt, &width, &height);
+      soft.out_stride = width *
+         (rarch_softfilter_get_output_format(soft.filt)
+          == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+      soft.in  = in;
+      soft.out = malloc(soft.out_stride * height);
+
+      if (soft.out)
+         bench_run(&bench);
+
+      free(soft.out);
+      rarch_softfilter_free(soft.filt);
+   }
+
+   string_list_free(list);
+}
+
+/* PNG */
+
+#define BENCH_PNG_WIDTH  320
+#define BENCH_PNG_HEIGHT 240
+
+struct bench_png
+{
+   char path[PATH_MAX_LENGTH];
+   const uint32_t *image;
+};
+
+#ifdef HAVE_ZLIB_DEFLATE
+static void bench_png_encode(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_png *png = (struct bench_png*)data;
+
+   for (i = 0; i < iterations; i++)
+      rpng_save_image_argb(png->path, png->image, BENCH_PNG_WIDTH,
+            BENCH_PNG_HEIGHT, BENCH_PNG_WIDTH * sizeof(uint32_t));
+}
+#endif
+
+static void bench_png_decode(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_png *png = (struct bench_png*)data;
+
+   for (i = 0; i < iterations; i++)
+   {
+      uint32_t *image = NULL;
+      unsigned width = 0, height = 0;
+
+      if (rpng_load_image_argb(png->path, &image, &width, &height))
+         free(image);
+   }
+}
+
+static void bench_png(void)
+{
+   unsigned x, y;
+   struct bench_png png;
+   uint32_t *image;
+   struct bench_case decode = { "rpng/decode", bench_png_decode, NULL,
+      &png, BENCH_PNG_WIDTH * BENCH_PNG_HEIGHT * sizeof(uint32_t), 0 };
+#ifdef HAVE_ZLIB_DEFLATE
+   struct bench_case encode = { "rpng/encode", bench_png_encode, NULL,
+      &png, BENCH_PNG_WIDTH * BENCH_PNG_HEIGHT * sizeof(uint32_t), 0 };
+#endif
+
+   image = (uint32_t*)malloc(BENCH_PNG_WIDTH * BENCH_PNG_HEIGHT
+         * sizeof(uint32_t));
+   if (!image)
+      return;
+
+   /* Gradients with some noise compress about as well as a game. */
+   for (y = 0; y < BENCH_PNG_HEIGHT; y++)
+      for (x = 0; x < BENCH_PNG_WIDTH; x++)
+         image[y * BENCH_PNG_WIDTH + x] = 0xff000000u
+            | ((x & 0xf8) << 16) | ((y & 0xf8) << 8)
+            | ((bench_rand() & 0xf0000000) ? ((x + y) & 0xf8) : 0xff);
+
+   png.image = image;
+   bench_work_path(png.path, sizeof(png.path), "bench-rpng.png");
+
+#ifdef HAVE_ZLIB_DEFLATE
+   bench_run(&encode);
+   bench_png_encode(&png, 1);
+
+   bench_run(&decode);
+#else
+   fprintf(stderr, "Built without HAVE_ZLIB_DEFLATE, skipping rpng.\n");
+   (void)decode;
+#endif
+
+   remove(png.path);
+   free(image);
+}
+
+/* Config files */
+
+static void bench_config_parse(void *data, unsigned iterations)
+{
+   unsigned i;
+
+   for (i = 0; i < iterations; i++)
+      config_file_free(config_file_new_from_string((const char*)data));
+}
+
+static void bench_config(void)
+{
+   unsigned i;
+   size_t len = 0, size = 64 * 1024;
+   char *cfg = (char*)malloc(size);
+   struct bench_case bench = { "config_file/parse", bench_config_parse,
+      NULL, cfg, 0, 0 };
+
+   if (!cfg)
+      return;
+
+   /* About as many entries as retroarch.cfg, in the same shape. */
+   for (i = 0; i < 600 && len + 128 < size; i++)
+   {
+      switch (i % 4)
+      {
+         case 0:
+            len += snprintf(cfg + len, size - len,
+                  "input_player%u_btn_%u = \"%u\"\n", i % 8, i, i % 16);
+            break;
+         case 1:
+            len += snprintf(cfg + len, size - len,
+                  "video_setting_%u = \"true\"\n", i);
+            break;
+         case 2:
+            len += snprintf(cfg + len, size - len,
+                  "# Comment for the next setting, %u.\n"
+                  "audio_setting_%u = %u.%u\n", i, i, i, i % 10);
+            break;
+         default:
+            len += snprintf(cfg + len, size - len,
+                  "path_setting_%u = \"~/.config/retroarch/dir%u\"\n", i, i);
+            break;
+      }
+   }
+
+   bench.bytes = len;
+   bench_run(&bench);
+   free(cfg);
+}
+
+/* Directory listing */
+
+#define BENCH_DIR_FILES 1000
+
+struct bench_dir
+{
+   char path[PATH_MAX_LENGTH];
+   const char *ext;
+};
+
+static void bench_dir_list(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_dir *dir = (struct bench_dir*)data;
+
+   for (i = 0; i < iterations; i++)
+      dir_list_free(dir_list_new(dir->path, dir->ext, false));
+}
+
+static void bench_dir(void)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+   struct bench_dir dir;
+   struct bench_case all = { "dir_list/all", bench_dir_list, NULL,
+      &dir, 0, 0 };
+   struct bench_case ext = { "dir_list/ext", bench_dir_list, NULL,
+      &dir, 0, 0 };
+   static const char *exts[] = { "sfc", "smc", "zip", "srm", "state" };
+
+   bench_work_path(dir.path, sizeof(dir.path), "bench-dir");
+   if (!path_is_directory(dir.path) && !path_mkdir(dir.path))
+   {
+      fprintf(stderr, "Could not create \"%s\", skipping dir_list.\n",
+            dir.path);
+      return;
+   }
+
+   for (i = 0; i < BENCH_DIR_FILES; i++)
+   {
+      FILE *file;
+      char name[64];
+
+      snprintf(name, sizeof(name), "Game %04u.%s", i,
+            exts[i % ARRAY_SIZE(exts)]);
+      fill_pathname_join(path, dir.path, name, sizeof(path));
+      file = fopen(path, "wb");
+      if (file)
+         fclose(file);
+   }
+
+   dir.ext = NULL;
+   bench_run(&all);
+   dir.ext = "sfc|smc|zip";
+   bench_run(&ext);
+
+   for (i = 0; i < BENCH_DIR_FILES; i++)
+   {
+      char name[64];
+
+      snprintf(name, sizeof(name), "Game %04u.%s", i,
+            exts[i % ARRAY_SIZE(exts)]);
+      fill_pathname_join(path, dir.path, name, sizeof(path));
+      remove(path);
+   }
+   remove(dir.path);
+}
+
+/* Database */
+
+#define BENCH_DB_ITEMS 20000
+
+struct bench_db
+{
+   struct rarchdb db;
+   struct rarchdb_lookup sorted;
+   struct rarchdb_lookup hashed;
+   unsigned next;
+   /* Big endian CRCs of the items, in the order they were written. */
+   uint8_t *keys;
+};
+
+static uint32_t bench_db_crc(unsigned index)
+{
+   /* Spread out, like real CRCs. */
+   return (index + 1) * 2654435761u;
+}
+
+static int bench_db_string(struct rmsgpack_dom_value *out, const char *str)
+{
+   out->type        = RDT_STRING;
+   out->string.len  = strlen(str);
+   out->string.buff = strdup(str);
+   return out->string.buff ? 0 : -1;
+}
+
+static int bench_db_next(void *ctx, struct rmsgpack_dom_value *out)
+{
+   char name[64];
+   uint32_t crc;
+   struct bench_db *db = (struct bench_db*)ctx;
+   struct rmsgpack_dom_pair *pairs;
+
+   if (db->next >= BENCH_DB_ITEMS)
+      return 1;
+
+   pairs = (struct rmsgpack_dom_pair*)calloc(3, sizeof(*pairs));
+   if (!pairs)
+      return -1;
+
+   out->type      = RDT_MAP;
+   out->map.len   = 3;
+   out->map.items = pairs;
+
+   crc = bench_db_crc(db->next);
+   snprintf(name, sizeof(name), "Game %u (USA)", db->next);
+
+   pairs[1].value.type         = RDT_BINARY;
+   pairs[1].value.binary.len   = 4;
+   pairs[1].value.binary.buff  = (char*)malloc(4);
+   pairs[2].value.type         = RDT_UINT;
+   pairs[2].value.uint_        = 512 * 1024 + db->next;
+
+   if (bench_db_string(&pairs[0].key, "name") < 0
+         || bench_db_string(&pairs[0].value, name) < 0
+         || bench_db_string(&pairs[1].key, "crc") < 0
+         || bench_db_string(&pairs[2].key, "size") < 0
+         || !pairs[1].value.binary.buff)
+      return -1;
+
+   pairs[1].value.binary.buff[0] = crc >> 24;
+   pairs[1].value.binary.buff[1] = crc >> 16;
+   pairs[1].value.binary.buff[2] = crc >>  8;
+   pairs[1].value.binary.buff[3] = crc >>  0;
+   memcpy(db->keys + db->next * 4, pairs[1].value.binary.buff, 4);
+
+   db->next++;
+   return 0;
+}
+
+static void bench_db_lookup(struct rarchdb_lookup *lookup,
+      const uint8_t *keys, unsigned iterations)
+{
+   unsigned i;
+   uint64_t offset;
+
+   for (i = 0; i < iterations; i++)
+      rarchdb_lookup_find(lookup,
+            keys + (bench_rand() % BENCH_DB_ITEMS) * 4, &offset);
+}
+
+static void bench_db_sorted(void *data, unsigned iterations)
+{
+   struct bench_db *db = (struct bench_db*)data;
+   bench_db_lookup(&db->sorted, db->keys, iterations);
+}
+
+static void bench_db_hashed(void *data, unsigned iterations)
+{
+   struct bench_db *db = (struct bench_db*)data;
+   bench_db_lookup(&db->hashed, db->keys, iterations);
+}
+
+static void bench_db_find_read(void *data, unsigned iterations)
+{
+   unsigned i;
+   struct bench_db *db = (struct bench_db*)data;
+
+   for (i = 0; i < iterations; i++)
+   {
+      struct rmsgpack_dom_value item;
+
+      if (rarchdb_find_entry(&db->db, "crc_hash",
+               db->keys + (bench_rand() % BENCH_DB_ITEMS) * 4) != 0)
+         continue;
+      if (rarchdb_read_item(&db->db, &item) == 0)
+         rmsgpack_dom_value_free(&item);
+   }
+}
+
+static void bench_database(void)
+{
+   int fd, rv;
+   char path[PATH_MAX_LENGTH];
+   struct bench_db db;
+   struct bench_case sorted = { "rarchdb/lookup-sorted", bench_db_sorted,
+      NULL, &db, 0, 0 };
+   struct bench_case hashed = { "rarchdb/lookup-hash", bench_db_hashed,
+      NULL, &db, 0, 0 };
+   struct bench_case find   = { "rarchdb/find-entry+read",
+      bench_db_find_read, NULL, &db, 0, 0 };
+
+   /* Building the database takes a while, only do it if needed. */
+   if (bench_conf.filter
+         && !strstr(sorted.name, bench_conf.filter)
+         && !strstr(hashed.name, bench_conf.filter)
+         && !strstr(find.name, bench_conf.filter))
+      return;
+
+   memset(&db, 0, sizeof(db));
+   db.keys = (uint8_t*)malloc(BENCH_DB_ITEMS * 4);
+   if (!db.keys)
+      return;
+
+   bench_work_path(path, sizeof(path), "bench-rarchdb.rdb");
+   fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+   if (fd < 0)
+   {
+      fprintf(stderr, "Could not create \"%s\", skipping rarchdb.\n", path);
+      free(db.keys);
+      return;
+   }
+
+   rv = rarchdb_create(fd, bench_db_next, &db);
+   close(fd);
+
+   if (rv < 0 || rarchdb_open(path, &db.db) < 0)
+      goto end;
+
+   if (rarchdb_create_index(&db.db, "crc", "crc") < 0
+         || rarchdb_create_hash_index(&db.db, "crc_hash", "crc") < 0)
+      goto close;
+
+   if (rarchdb_lookup_open(&db.db, "crc", &db.sorted) == 0)
+   {
+      bench_run(&sorted);
+      rarchdb_lookup_close(&db.sorted);
+   }
+
+   if (rarchdb_lookup_open(&db.db, "crc_hash", &db.hashed) == 0)
+   {
+      bench_run(&hashed);
+      rarchdb_lookup_close(&db.hashed);
+   }
+
+   bench_run(&find);
+
+close:
+   rarchdb_close(&db.db);
+end:
+   remove(path);
+   free(db.keys);
+}
+
+/* Hashing */
+
+#define BENCH_HASH_SIZE (1024 * 1024)
+
+static void bench_crc32(void *data, unsigned iterations)
+{
+   unsigned i;
+   volatile uint32_t crc = 0;
+
+   for (i = 0; i < iterations; i++)
+      crc += crc32_calculate((const uint8_t*)data, BENCH_HASH_SIZE);
+   (void)crc;
+}
+
+static void bench_sha256(void *data, unsigned iterations)
+{
+   unsigned i;
+   char out[65];
+
+   for (i = 0; i < iterations; i++)
+      sha256_hash(out, (const uint8_t*)data, BENCH_HASH_SIZE);
+}
+
+static void bench_hash(const void *data)
+{
+   struct bench_case crc = { "hash/crc32", bench_crc32, NULL,
+      (void*)data, BENCH_HASH_SIZE, 0 };
+   struct bench_case sha = { "hash/sha256", bench_sha256, NULL,
+      (void*)data, BENCH_HASH_SIZE, 0 };
+
+   bench_run(&crc);
+   bench_run(&sha);
+}
+
+static void print_help(const char *argv0)
+{
+   printf("Usage: %s [options]\n", argv0);
+   printf("\t-f/--filter: Only run benchmarks whose name contains this.\n");
+   printf("\t-t/--time: Minimum seconds per timed run. Default is 0.2.\n");
+   printf("\t-r/--runs: Timed runs per benchmark, the best is kept. Default is 5.\n");
+   printf("\t-s/--softfilters: Directory with .filt files. Default is \"gfx/video_filters\".\n");
+   printf("\t-w/--work-dir: Where temporary files go. Default is \".\".\n");
+   printf("\t-v/--verbose: Log from RetroArch.\n");
+}
+
+int main(int argc, char *argv[])
+{
+   size_t size;
+   uint8_t *in, *out;
+
+   const struct option opts[] = {
+      { "filter", 1, NULL, 'f' },
+      { "time", 1, NULL, 't' },
+      { "runs", 1, NULL, 'r' },
+      { "softfilters", 1, NULL, 's' },
+      { "work-dir", 1, NULL, 'w' },
+      { "verbose", 0, NULL, 'v' },
+      { "help", 0, NULL, 'h' },
+      { NULL, 0, NULL, 0 },
+   };
+
+   g_extern.log_file = stderr;
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "f:t:r:s:w:vh", opts, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'f':
+            bench_conf.filter = optarg;
+            break;
+         case 't':
+            bench_conf.min_seconds = strtod(optarg, NULL);
+            break;
+         case 'r':
+            bench_conf.runs = strtoul(optarg, NULL, 0);
+            break;
+         case 's':
+            bench_conf.filter_dir = optarg;
+            break;
+         case 'w':
+            bench_conf.work_dir = optarg;
+            break;
+         case 'v':
+            g_extern.verbosity = true;
+            break;
+         case 'h':
+            print_help(argv[0]);
+            return 0;
+         default:
+            print_help(argv[0]);
+            return 1;
+      }
+   }
+
+   if (!bench_conf.runs)
+      bench_conf.runs = 1;
+
+   /* Big enough for any frame or hash input below. */
+   size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT * sizeof(uint32_t);
+   if (size < BENCH_HASH_SIZE)
+      size = BENCH_HASH_SIZE;
+
+   in  = (uint8_t*)malloc(size);
+   out = (uint8_t*)malloc(size * 4);
+   if (!in || !out)
+      return 1;
+
+   bench_seed = 0x12345678;
+   bench_fill(in, size);
+
+   bench_rewind();
+   bench_resamplers();
+   bench_pixconv(in, out);
+   bench_scaler(in, out);
+   bench_softfilters(in);
+   bench_png();
+   bench_config();
+   bench_dir();
+   bench_database();
+   bench_hash(in);
+
+   free(in);
+   free(out);
+   return 0;
+}
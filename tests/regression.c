@@ -0,0 +1,755 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Round trip tests of the formats and queues the benchmarks made
+ * faster: binary playlists, BSV2 movies, the config parser, the
+ * message queue, compressed savestates and netplay input packets.
+ *
+ * Each case writes something out, reads it back and compares it
+ * with what went in, so a faster path that loses data fails here
+ * rather than in a user's save directory.
+ *
+ * Built and run with "make regression" from the top level
+ * directory. Exits non-zero if any case fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <file/config_file.h>
+#include <file/file_path.h>
+#include <queues/message_queue.h>
+#include <rthreads/rthreads.h>
+
+#include "../general.h"
+#include "../dynamic.h"
+#include "../content.h"
+#include "../movie.h"
+#include "../playlist.h"
+#include "../frontend/frontend_driver.h"
+#include "../frontend/frontend.h"
+#ifdef HAVE_NETPLAY
+#include "../netplay.h"
+#endif
+
+/* Everything but frontend.c is linked in, which still wants these. */
+void main_exit(args_type() args)
+{
+   (void)args;
+}
+
+void main_exit_save_config(void)
+{
+}
+
+bool main_load_content(int argc, char **argv,
+      args_type() args, environment_get_t environ_get,
+      process_args_t process_args)
+{
+   (void)argc;
+   (void)argv;
+   (void)args;
+   (void)environ_get;
+   (void)process_args;
+   return false;
+}
+
+#define TEST_CHECK(cond) do { \
+   if (!(cond)) \
+   { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", \
+            __FILE__, __LINE__, #cond); \
+      return false; \
+   } \
+} while (0)
+
+typedef bool (*test_fn_t)(void);
+
+struct test_case
+{
+   const char *name;
+   test_fn_t run;
+};
+
+static const char *test_work_dir = ".";
+static uint32_t test_seed;
+
+/* xorshift32, so that every run sees the same inputs. */
+static uint32_t test_rand(void)
+{
+   test_seed ^= test_seed << 13;
+   test_seed ^= test_seed >> 17;
+   test_seed ^= test_seed << 5;
+   return test_seed;
+}
+
+static void test_path(char *path, size_t size, const char *name)
+{
+   fill_pathname_join(path, test_work_dir, name, size);
+}
+
+/* Playlists */
+
+#define TEST_PLAYLIST_CAP   32
+#define TEST_PLAYLIST_PATHS 48
+
+/* What the playlist is expected to hold, top first. */
+struct test_playlist_model
+{
+   int ids[TEST_PLAYLIST_CAP];
+   size_t size;
+};
+
+static void test_playlist_model_push(struct test_playlist_model *model,
+      int id)
+{
+   size_t i;
+
+   for (i = 0; i < model->size; i++)
+      if (model->ids[i] == id)
+         break;
+
+   if (i == model->size)
+   {
+      if (model->size < TEST_PLAYLIST_CAP)
+         model->size++;
+      i = model->size - 1;
+   }
+
+   memmove(model->ids + 1, model->ids, i * sizeof(int));
+   model->ids[0] = id;
+}
+
+/* Id 0 has no content path. */
+static void test_playlist_names(int id, char *path, char *core_path,
+      size_t size)
+{
+   snprintf(path, size, "/games/%d/game %d.bin", id, id);
+   snprintf(core_path, size, "/cores/core_%d.so", id % 3);
+}
+
+static bool test_playlist_compare(content_playlist_t *playlist,
+      const struct test_playlist_model *model)
+{
+   size_t i;
+
+   TEST_CHECK(content_playlist_size(playlist) == model->size);
+
+   for (i = 0; i < model->size; i++)
+   {
+      char path[64], core_path[64];
+      const char *got_path      = NULL;
+      const char *got_core_path = NULL;
+      const char *got_core_name = NULL;
+
+      test_playlist_names(model->ids[i], path, core_path, sizeof(path));
+      content_playlist_get_index(playlist, i,
+            &got_path, &got_core_path, &got_core_name);
+
+      if (model->ids[i] == 0)
+         TEST_CHECK(!got_path);
+      else
+         TEST_CHECK(got_path && !strcmp(got_path, path));
+      TEST_CHECK(got_core_path && !strcmp(got_core_path, core_path));
+      TEST_CHECK(got_core_name && !strcmp(got_core_name, "Core"));
+   }
+
+   return true;
+}
+
+/* Reloads after every few pushes, so that entries come back both
+ * from a rewritten file and from records appended to it. */
+static bool test_playlist_round_trip(void)
+{
+   unsigned round, i;
+   char path[PATH_MAX_LENGTH];
+   struct test_playlist_model model = {{0}};
+   content_playlist_t *playlist     = NULL;
+
+   test_path(path, sizeof(path), "regression.lpl");
+   remove(path);
+
+   for (round = 0; round < 40; round++)
+   {
+      playlist = content_playlist_init(path, TEST_PLAYLIST_CAP);
+      TEST_CHECK(playlist);
+      TEST_CHECK(test_playlist_compare(playlist, &model));
+
+      for (i = 0; i < 1 + test_rand() % 8; i++)
+      {
+         char game[64], core[64];
+         int id = test_rand() % TEST_PLAYLIST_PATHS;
+
+         test_playlist_names(id, game, core, sizeof(game));
+         content_playlist_push(playlist, id ? game : NULL, core, "Core");
+         test_playlist_model_push(&model, id);
+      }
+
+      TEST_CHECK(test_playlist_compare(playlist, &model));
+      content_playlist_free(playlist);
+   }
+
+   remove(path);
+   return true;
+}
+
+/* A size in the header far beyond what the file holds is cut
+ * down instead of being allocated. */
+static bool test_playlist_broken_size(void)
+{
+   unsigned i;
+   FILE *file;
+   char path[PATH_MAX_LENGTH];
+   static const uint8_t huge[4] = { 0xff, 0xff, 0xff, 0xff };
+   struct test_playlist_model model = {{0}};
+   content_playlist_t *playlist     = NULL;
+
+   test_path(path, sizeof(path), "regression-broken.lpl");
+   remove(path);
+
+   playlist = content_playlist_init(path, TEST_PLAYLIST_CAP);
+   TEST_CHECK(playlist);
+   for (i = 1; i <= 8; i++)
+   {
+      char game[64], core[64];
+
+      test_playlist_names(i, game, core, sizeof(game));
+      content_playlist_push(playlist, game, core, "Core");
+      test_playlist_model_push(&model, i);
+   }
+
+   /* Leaves a file that is all index, no appended records. */
+   content_playlist_clear(playlist);
+   for (i = 1; i <= 8; i++)
+   {
+      char game[64], core[64];
+
+      test_playlist_names(i, game, core, sizeof(game));
+      content_playlist_push(playlist, game, core, "Core");
+   }
+   content_playlist_free(playlist);
+
+   file = fopen(path, "r+b");
+   TEST_CHECK(file);
+   TEST_CHECK(fseek(file, 24, SEEK_SET) == 0);
+   TEST_CHECK(fwrite(huge, 1, sizeof(huge), file) == sizeof(huge));
+   fclose(file);
+
+   playlist = content_playlist_init(path, TEST_PLAYLIST_CAP);
+   TEST_CHECK(playlist);
+   TEST_CHECK(test_playlist_compare(playlist, &model));
+   content_playlist_free(playlist);
+
+   remove(path);
+   return true;
+}
+
+/* Cores stubbed for movies and savestates. Their state is a
+ * buffer of test data, which unserializing copies back. */
+
+#define TEST_STATE_SIZE (64 * 1024)
+
+static uint8_t test_state[TEST_STATE_SIZE];
+static uint8_t test_state_loaded[TEST_STATE_SIZE];
+static size_t test_state_loaded_size;
+
+static size_t test_serialize_size(void)
+{
+   return sizeof(test_state);
+}
+
+static bool test_serialize(void *data, size_t size)
+{
+   if (size != sizeof(test_state))
+      return false;
+   memcpy(data, test_state, size);
+   return true;
+}
+
+static bool test_unserialize(const void *data, size_t size)
+{
+   if (size != sizeof(test_state))
+      return false;
+   memcpy(test_state_loaded, data, size);
+   test_state_loaded_size = size;
+   return true;
+}
+
+static void test_core_init(void)
+{
+   size_t i;
+
+   /* Compressible, as a real state mostly is. */
+   for (i = 0; i < sizeof(test_state); i++)
+      test_state[i] = (i & 0x100) ? (uint8_t)test_rand() : (uint8_t)(i >> 9);
+
+   pretro_serialize_size = test_serialize_size;
+   pretro_serialize      = test_serialize;
+   pretro_unserialize    = test_unserialize;
+}
+
+/* BSV2 movies */
+
+#define TEST_MOVIE_FRAMES  (BSV2_KEYFRAME_INTERVAL * 2 + 100)
+#define TEST_MOVIE_INPUTS  4
+
+/* Held for stretches, like real input, so repeats get used. */
+static int16_t test_movie_input(unsigned frame, unsigned i)
+{
+   return (int16_t)(((frame / 37) * 7 + i * 13) % 5 == 0 ? frame / 37 : i);
+}
+
+static bool test_movie_play(bsv_movie_t *movie, unsigned from)
+{
+   unsigned frame, i;
+
+   for (frame = from; frame < TEST_MOVIE_FRAMES; frame++)
+   {
+      bsv_movie_set_frame_start(movie);
+      for (i = 0; i < TEST_MOVIE_INPUTS; i++)
+      {
+         int16_t input = 0;
+
+         TEST_CHECK(bsv_movie_get_input(movie, &input));
+         TEST_CHECK(input == test_movie_input(frame, i));
+      }
+      bsv_movie_set_frame_end(movie);
+   }
+
+   /* Nothing after the last frame. */
+   bsv_movie_set_frame_start(movie);
+   {
+      int16_t input = 0;
+      TEST_CHECK(!bsv_movie_get_input(movie, &input));
+   }
+   return true;
+}
+
+static bool test_movie_round_trip(void)
+{
+   unsigned frame, i;
+   int64_t keyframe;
+   char path[PATH_MAX_LENGTH];
+   bsv_movie_t *movie = NULL;
+
+   test_path(path, sizeof(path), "regression.bsv");
+   test_core_init();
+
+   movie = bsv_movie_init(path, RARCH_MOVIE_RECORD);
+   TEST_CHECK(movie);
+   for (frame = 0; frame < TEST_MOVIE_FRAMES; frame++)
+   {
+      bsv_movie_set_frame_start(movie);
+      for (i = 0; i < TEST_MOVIE_INPUTS; i++)
+         bsv_movie_set_input(movie, test_movie_input(frame, i));
+      bsv_movie_set_frame_end(movie);
+   }
+   bsv_movie_free(movie);
+
+   memset(test_state_loaded, 0, sizeof(test_state_loaded));
+   movie = bsv_movie_init(path, RARCH_MOVIE_PLAYBACK);
+   TEST_CHECK(movie);
+   TEST_CHECK(!memcmp(test_state_loaded, test_state, sizeof(test_state)));
+   TEST_CHECK(test_movie_play(movie, 0));
+
+   /* Seeking lands on the keyframe before the frame asked for,
+    * and plays on from there. */
+   keyframe = bsv_movie_seek(movie, BSV2_KEYFRAME_INTERVAL + 10);
+   TEST_CHECK(keyframe == BSV2_KEYFRAME_INTERVAL);
+   TEST_CHECK(test_movie_play(movie, (unsigned)keyframe));
+   bsv_movie_free(movie);
+
+   remove(path);
+   return true;
+}
+
+/* Config files */
+
+#define TEST_CONFIG_KEYS 600
+
+/* Moves to other keys every generation, so that values get both
+ * longer and shorter. */
+#define TEST_CONFIG_TAIL(i, generation) \
+   (((i) + (generation)) % 3 ? "" : " with a longer tail added")
+
+static bool test_config_check(config_file_t *conf, unsigned generation)
+{
+   unsigned i;
+
+   for (i = 0; i < TEST_CONFIG_KEYS; i++)
+   {
+      char key[32], expected[64];
+      char *value = NULL;
+      bool equal;
+
+      snprintf(key, sizeof(key), "key_%u", i);
+      snprintf(expected, sizeof(expected), "value %u of %u%s", i,
+            generation, TEST_CONFIG_TAIL(i, generation));
+      TEST_CHECK(config_get_string(conf, key, &value));
+      equal = !strcmp(value, expected);
+      free(value);
+      TEST_CHECK(equal);
+   }
+
+   return true;
+}
+
+static bool test_config_round_trip(void)
+{
+   unsigned i, generation;
+   int int_value;
+   bool bool_value;
+   char *value = NULL;
+   char path[PATH_MAX_LENGTH];
+   config_file_t *conf = config_file_new_from_string(
+         "# comment\n"
+         "plain = 42\n"
+         "quoted = \"with # and spaces\"\n"
+         "flag = \"true\"\n");
+
+   TEST_CHECK(conf);
+   test_path(path, sizeof(path), "regression.cfg");
+
+   /* Every generation overwrites each value, so both the in place
+    * and the grown paths of config_set_string() get written out
+    * and read back. */
+   for (generation = 0; generation < 4; generation++)
+   {
+      for (i = 0; i < TEST_CONFIG_KEYS; i++)
+      {
+         char key[32], val[64];
+
+         snprintf(key, sizeof(key), "key_%u", i);
+         snprintf(val, sizeof(val), "value %u of %u%s", i, generation,
+               TEST_CONFIG_TAIL(i, generation));
+         config_set_string(conf, key, val);
+      }
+      TEST_CHECK(test_config_check(conf, generation));
+
+      TEST_CHECK(config_file_write(conf, path));
+      config_file_free(conf);
+
+      conf = config_file_new(path);
+      TEST_CHECK(conf);
+      TEST_CHECK(test_config_check(conf, generation));
+   }
+
+   TEST_CHECK(config_get_int(conf, "plain", &int_value) && int_value == 42);
+   TEST_CHECK(config_get_bool(conf, "flag", &bool_value) && bool_value);
+   TEST_CHECK(config_get_string(conf, "quoted", &value));
+   bool_value = !strcmp(value, "with # and spaces");
+   free(value);
+   TEST_CHECK(bool_value);
+   TEST_CHECK(!config_entry_exists(conf, "missing"));
+
+   config_file_free(conf);
+   remove(path);
+   return true;
+}
+
+/* Message queue */
+
+#define TEST_MSG_THREADS  4
+#define TEST_MSG_PER_THREAD 256
+
+struct test_msg_producer
+{
+   msg_queue_t *queue;
+   unsigned id;
+};
+
+static void test_msg_producer_thread(void *data)
+{
+   unsigned i;
+   const struct test_msg_producer *producer =
+      (const struct test_msg_producer*)data;
+
+   for (i = 0; i < TEST_MSG_PER_THREAD; i++)
+   {
+      char msg[32];
+
+      snprintf(msg, sizeof(msg), "%u:%u", producer->id, i);
+      msg_queue_push(producer->queue, msg, i % 5, 1);
+   }
+}
+
+static bool test_msg_take(const char *msg, uint8_t *seen)
+{
+   unsigned id, i;
+
+   TEST_CHECK(sscanf(msg, "%u:%u", &id, &i) == 2);
+   TEST_CHECK(id < TEST_MSG_THREADS && i < TEST_MSG_PER_THREAD);
+   TEST_CHECK(!seen[id * TEST_MSG_PER_THREAD + i]);
+   seen[id * TEST_MSG_PER_THREAD + i] = 1;
+   return true;
+}
+
+static bool test_msg_queue_priority(void)
+{
+   unsigned i;
+   const char *msg;
+   msg_queue_t *queue = msg_queue_new(8);
+
+   TEST_CHECK(queue);
+
+   msg_queue_push(queue, "low", 1, 1);
+   msg_queue_push(queue, "high", 3, 2);
+   msg_queue_push(queue, "middle", 2, 1);
+
+   /* Pulled by priority, each as often as its duration says. */
+   TEST_CHECK((msg = msg_queue_pull(queue)) && !strcmp(msg, "high"));
+   TEST_CHECK((msg = msg_queue_pull(queue)) && !strcmp(msg, "high"));
+   TEST_CHECK((msg = msg_queue_pull(queue)) && !strcmp(msg, "middle"));
+   TEST_CHECK((msg = msg_queue_pull(queue)) && !strcmp(msg, "low"));
+   TEST_CHECK(!msg_queue_pull(queue));
+
+   /* Full queues drop what is pushed, and recover once pulled. */
+   for (i = 0; i < 32; i++)
+      msg_queue_push(queue, "fill", 1, 1);
+   for (i = 0; i < 32 && msg_queue_pull(queue); i++);
+   TEST_CHECK(i == 8);
+   msg_queue_push(queue, "again", 1, 1);
+   TEST_CHECK((msg = msg_queue_pull(queue)) && !strcmp(msg, "again"));
+
+   msg_queue_free(queue);
+   return true;
+}
+
+/* Producers on several threads, pulled while they push. The
+ * queue has room for everything, so nothing may go missing. */
+static bool test_msg_queue_threads(void)
+{
+   unsigned i, taken = 0;
+   const char *msg;
+   uint8_t seen[TEST_MSG_THREADS * TEST_MSG_PER_THREAD] = {0};
+   struct test_msg_producer producers[TEST_MSG_THREADS];
+   sthread_t *threads[TEST_MSG_THREADS];
+   msg_queue_t *queue = msg_queue_new(
+         TEST_MSG_THREADS * TEST_MSG_PER_THREAD);
+
+   TEST_CHECK(queue);
+
+   for (i = 0; i < TEST_MSG_THREADS; i++)
+   {
+      producers[i].queue = queue;
+      producers[i].id    = i;
+      threads[i] = sthread_create(test_msg_producer_thread, &producers[i]);
+      TEST_CHECK(threads[i]);
+   }
+
+   while (taken < TEST_MSG_THREADS * TEST_MSG_PER_THREAD / 2)
+   {
+      if ((msg = msg_queue_pull(queue)))
+      {
+         TEST_CHECK(test_msg_take(msg, seen));
+         taken++;
+      }
+   }
+
+   for (i = 0; i < TEST_MSG_THREADS; i++)
+      sthread_join(threads[i]);
+
+   while ((msg = msg_queue_pull(queue)))
+   {
+      TEST_CHECK(test_msg_take(msg, seen));
+      taken++;
+   }
+
+   TEST_CHECK(taken == TEST_MSG_THREADS * TEST_MSG_PER_THREAD);
+   msg_queue_free(queue);
+   return true;
+}
+
+/* Savestates */
+
+static bool test_state_load(const char *path)
+{
+   memset(test_state_loaded, 0, sizeof(test_state_loaded));
+   test_state_loaded_size = 0;
+
+   TEST_CHECK(load_state(path));
+   TEST_CHECK(test_state_loaded_size == sizeof(test_state));
+   TEST_CHECK(!memcmp(test_state_loaded, test_state, sizeof(test_state)));
+   return true;
+}
+
+static bool test_state_round_trip(void)
+{
+   FILE *file;
+   long size;
+   uint8_t magic[4] = {0};
+   char path[PATH_MAX_LENGTH];
+
+   test_path(path, sizeof(path), "regression.state");
+   test_core_init();
+   g_settings.savestate_thumbnail_enable = false;
+   g_settings.block_sram_overwrite       = false;
+
+   /* Compressed states carry the RASZ magic and come out smaller. */
+   g_settings.savestate_compression = true;
+   TEST_CHECK(save_state(path));
+   content_flush_saves();
+
+   file = fopen(path, "rb");
+   TEST_CHECK(file);
+   TEST_CHECK(fread(magic, 1, sizeof(magic), file) == sizeof(magic));
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fclose(file);
+#ifdef HAVE_ZLIB_DEFLATE
+   TEST_CHECK(!memcmp(magic, "RASZ", 4));
+   TEST_CHECK(size > 0 && size < (long)sizeof(test_state));
+#endif
+   TEST_CHECK(test_state_load(path));
+
+   /* A state read ahead loads the same. */
+   content_prefetch_state(path);
+   TEST_CHECK(test_state_load(path));
+
+   /* Uncompressed ones still load. */
+   g_settings.savestate_compression = false;
+   TEST_CHECK(save_state(path));
+   content_flush_saves();
+   TEST_CHECK(test_state_load(path));
+
+   remove(path);
+   return true;
+}
+
+/* Netplay input packets */
+
+#ifdef HAVE_NETPLAY
+static bool test_netplay_packets(void)
+{
+   unsigned frames, i;
+   uint16_t history[NETPLAY_INPUT_HISTORY];
+
+   for (frames = 1; frames < NETPLAY_INPUT_HISTORY * 8; frames++)
+   {
+      uint8_t packet[NETPLAY_MAX_PACKET_SIZE];
+      uint16_t input[NETPLAY_INPUT_HISTORY];
+      uint32_t first = 0;
+      unsigned count, expected;
+      size_t size;
+      uint32_t frame = frames - 1;
+
+      /* Mostly held, sometimes every frame different. */
+      if (frame % 50 < 10 || test_rand() % 16 == 0)
+         history[frame % NETPLAY_INPUT_HISTORY] = (uint16_t)test_rand();
+      else
+         history[frame % NETPLAY_INPUT_HISTORY] =
+            frame ? history[(frame - 1) % NETPLAY_INPUT_HISTORY] : 0;
+
+      size     = netplay_encode_input(history, frames, packet);
+      expected = frames < NETPLAY_INPUT_HISTORY
+         ? frames : NETPLAY_INPUT_HISTORY;
+      TEST_CHECK(size <= sizeof(packet));
+
+      count = netplay_decode_input(packet, size, &first, input);
+      TEST_CHECK(count == expected);
+      TEST_CHECK(first == frames - expected);
+      for (i = 0; i < count; i++)
+         TEST_CHECK(input[i] ==
+               history[(first + i) % NETPLAY_INPUT_HISTORY]);
+
+      /* Cut short or padded, a packet is dropped. */
+      TEST_CHECK(!netplay_decode_input(packet, size - 1, &first, input));
+      TEST_CHECK(!netplay_decode_input(packet, size + 1, &first, input));
+   }
+
+   return true;
+}
+#endif
+
+static const struct test_case test_cases[] = {
+   { "playlist/round-trip", test_playlist_round_trip },
+   { "playlist/broken-size", test_playlist_broken_size },
+   { "movie/bsv2", test_movie_round_trip },
+   { "config/round-trip", test_config_round_trip },
+   { "msg_queue/priority", test_msg_queue_priority },
+   { "msg_queue/threads", test_msg_queue_threads },
+   { "state/compressed", test_state_round_trip },
+#ifdef HAVE_NETPLAY
+   { "netplay/delta-input", test_netplay_packets },
+#endif
+};
+
+static void print_help(const char *argv0)
+{
+   printf("Usage: %s [options]\n", argv0);
+   printf("\t-f/--filter: Only run tests whose name contains this.\n");
+   printf("\t-w/--work-dir: Where temporary files go. Default is \".\".\n");
+   printf("\t-v/--verbose: Log from RetroArch.\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, failed = 0;
+   const char *filter = NULL;
+
+   const struct option opts[] = {
+      { "filter", 1, NULL, 'f' },
+      { "work-dir", 1, NULL, 'w' },
+      { "verbose", 0, NULL, 'v' },
+      { "help", 0, NULL, 'h' },
+      { NULL, 0, NULL, 0 },
+   };
+
+   g_extern.log_file = stderr;
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "f:w:vh", opts, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'f':
+            filter = optarg;
+            break;
+         case 'w':
+            test_work_dir = optarg;
+            break;
+         case 'v':
+            g_extern.verbosity = true;
+            break;
+         case 'h':
+            print_help(argv[0]);
+            return 0;
+         default:
+            print_help(argv[0]);
+            return 1;
+      }
+   }
+
+   for (i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++)
+   {
+      bool ok;
+
+      if (filter && !strstr(test_cases[i].name, filter))
+         continue;
+
+      test_seed = 0x12345678;
+      ok        = test_cases[i].run();
+      printf("%-24s %s\n", test_cases[i].name, ok ? "ok" : "FAILED");
+      if (!ok)
+         failed++;
+   }
+
+   return failed ? 1 : 0;
+}
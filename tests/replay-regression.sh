@@ -0,0 +1,60 @@
+#!/bin/sh
+
+# Replays every BSV movie in a directory headless, as fast as
+# possible, and compares the CRC32 of each frame with the golden
+# hashes of the last recorded run.
+#
+#   tests/replay-regression.sh <core> <movie dir> [content]
+#
+# <movie>.hashes are the golden hashes. They are recorded when
+# missing, so delete one to accept a new result. The hash and time
+# of every frame of the latest run go to <movie>.frames.
+#
+# RETROARCH points to the binary, ./retroarch by default.
+# RETROARCH_ARGS are passed on, e.g. "--appendconfig filter.cfg"
+# to run a video_filter on every frame and see what it costs.
+# Shaders need a GPU video driver, so they are not run here.
+
+if [ $# -lt 2 ]; then
+   echo "Usage: $0 <core> <movie dir> [content]" >&2
+   exit 1
+fi
+
+RETROARCH="${RETROARCH:-./retroarch}"
+CORE="$1"
+DIR="$2"
+CONTENT="$3"
+FAILED=0
+
+for MOVIE in "$DIR"/*.bsv; do
+   [ -f "$MOVIE" ] || continue
+
+   NAME="$(basename "$MOVIE" .bsv)"
+   GOLDEN="${MOVIE%.bsv}.hashes"
+   FRAMES="${MOVIE%.bsv}.frames"
+
+   if [ -f "$GOLDEN" ]; then
+      RESULT=OK
+      HASH_ARGS="--hash-check $GOLDEN --hash-record $FRAMES"
+   else
+      RESULT=RECORDED
+      HASH_ARGS="--hash-record $GOLDEN"
+   fi
+
+   OUTPUT="$("$RETROARCH" --benchmark 0 --bsvplay "$MOVIE" --eof-exit \
+      $HASH_ARGS $RETROARCH_ARGS -L "$CORE" ${CONTENT:+"$CONTENT"} 2>/dev/null)"
+   STATUS=$?
+
+   echo "$OUTPUT" | sed -n "s/^Benchmark: /$NAME: /p"
+
+   # No report means not a single frame ran.
+   if [ $STATUS -ne 0 ] || ! echo "$OUTPUT" | grep -q "^Benchmark: "; then
+      # A broken run is no golden result.
+      [ "$RESULT" = RECORDED ] && rm -f "$GOLDEN"
+      RESULT=FAILED
+      FAILED=1
+   fi
+   echo "$NAME: $RESULT"
+done
+
+exit $FAILED
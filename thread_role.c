@@ -0,0 +1,132 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "thread_role.h"
+#include "general.h"
+
+static const char *thread_role_names[RARCH_THREAD_ROLE_LAST] = {
+   "video",
+   "audio",
+   "autosave",
+   "record",
+   "worker",
+};
+
+/* Windows schedules these tasks ahead of the rest with MMCSS. */
+static const char *thread_role_mmcss[RARCH_THREAD_ROLE_LAST] = {
+   "Games",
+   "Pro Audio",
+   NULL,
+   "Capture",
+   "Games",
+};
+
+const char *rarch_thread_role_name(enum rarch_thread_role role)
+{
+   return thread_role_names[role];
+}
+
+bool rarch_thread_role_parse_affinity(const char *str, uint64_t *cpu_mask)
+{
+   *cpu_mask = 0;
+
+   while (*str)
+   {
+      char *end;
+      unsigned long first, last, cpu;
+
+      first = strtoul(str, &end, 10);
+      if (end == str)
+         return false;
+      last = first;
+      str  = end;
+
+      if (*str == '-')
+      {
+         last = strtoul(++str, &end, 10);
+         if (end == str || last < first)
+            return false;
+         str = end;
+      }
+
+      if (last > 63)
+         return false;
+
+      for (cpu = first; cpu <= last; cpu++)
+         *cpu_mask |= (uint64_t)1 << cpu;
+
+      if (*str == ',')
+         str++;
+      else if (*str)
+         return false;
+   }
+
+   return *cpu_mask != 0;
+}
+
+void rarch_thread_role_apply(enum rarch_thread_role role)
+{
+#ifdef HAVE_THREADS
+   const char *name     = thread_role_names[role];
+   const char *priority = g_settings.thread.priority[role];
+   const char *affinity = g_settings.thread.affinity[role];
+
+   if (*priority && strcmp(priority, "default"))
+   {
+      enum sthread_priority prio = STHREAD_PRIORITY_NORMAL;
+
+      if (!strcmp(priority, "low"))
+         prio = STHREAD_PRIORITY_LOW;
+      else if (!strcmp(priority, "high"))
+         prio = STHREAD_PRIORITY_HIGH;
+      else if (!strcmp(priority, "realtime"))
+         prio = STHREAD_PRIORITY_REALTIME;
+      else if (strcmp(priority, "normal"))
+         RARCH_WARN("[Threads]: Unknown priority \"%s\" for %s.\n",
+               priority, name);
+
+      if (sthread_set_current_priority(prio, thread_role_mmcss[role]))
+         RARCH_LOG("[Threads]: Running %s at %s priority.\n",
+               name, priority);
+      else
+         RARCH_WARN("[Threads]: Could not run %s at %s priority.\n",
+               name, priority);
+   }
+
+   if (*affinity)
+   {
+      uint64_t cpu_mask;
+
+      if (!rarch_thread_role_parse_affinity(affinity, &cpu_mask))
+         RARCH_WARN("[Threads]: Bad CPU list \"%s\" for %s.\n",
+               affinity, name);
+      else if (sthread_set_current_affinity(cpu_mask))
+         RARCH_LOG("[Threads]: Running %s on CPUs %s.\n", name, affinity);
+      else
+         RARCH_WARN("[Threads]: Could not run %s on CPUs %s.\n",
+               name, affinity);
+   }
+#else
+   (void)role;
+#endif
+}
@@ -0,0 +1,72 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_THREAD_ROLE_H
+#define __RARCH_THREAD_ROLE_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What a thread of RetroArch is there for. Each role has its own
+ * thread_<role>_priority and thread_<role>_affinity settings. */
+enum rarch_thread_role
+{
+   RARCH_THREAD_ROLE_VIDEO = 0,
+   RARCH_THREAD_ROLE_AUDIO,
+   RARCH_THREAD_ROLE_AUTOSAVE,
+   RARCH_THREAD_ROLE_RECORD,
+   /* Thread pool workers, running softfilters and the scaler. */
+   RARCH_THREAD_ROLE_WORKER,
+   RARCH_THREAD_ROLE_LAST
+};
+
+/**
+ * rarch_thread_role_name:
+ * @role                 : role.
+ *
+ * Returns: name of @role in settings, e.g. "audio".
+ **/
+const char *rarch_thread_role_name(enum rarch_thread_role role);
+
+/**
+ * rarch_thread_role_parse_affinity:
+ * @str                  : CPUs, e.g. "0,2-3".
+ * @cpu_mask             : set to the CPUs, bit N for CPU N.
+ *
+ * Returns: true (1) if @str lists CPUs 0 to 63 only,
+ * otherwise false (0).
+ **/
+bool rarch_thread_role_parse_affinity(const char *str, uint64_t *cpu_mask);
+
+/**
+ * rarch_thread_role_apply:
+ * @role                 : role of the calling thread.
+ *
+ * Gives the calling thread the priority and affinity set for
+ * @role. Call first thing in the thread. Failing is only logged,
+ * the thread runs on as it was.
+ **/
+void rarch_thread_role_apply(enum rarch_thread_role role);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#!/bin/sh
+
+# Training run for profile-guided builds, run by "make pgo" with a
+# PGO=generate binary. Covers the hot paths of a normal session:
+#
+#  - a headless --benchmark run, for the run loop, core glue
+#    and audio resampling,
+#  - a headless run with rewind on, for rewind.c,
+#  - every BSV movie in PGO_MOVIES, replayed headless,
+#  - a run with PGO_VIDEO_DRIVER, e.g. gl, if set, for the video
+#    driver and shaders. Needs a display.
+#
+#   tools/pgo-train.sh <retroarch> <core> [content]
+#
+# PGO_FRAMES is the number of frames of each run, 20000 by default.
+
+if [ $# -lt 2 ]; then
+   echo "Usage: $0 <retroarch> <core> [content]" >&2
+   exit 1
+fi
+
+RETROARCH="$1"
+CORE="$2"
+CONTENT="$3"
+FRAMES="${PGO_FRAMES:-20000}"
+CONFIG="$(mktemp)"
+FAILED=0
+
+trap 'rm -f "$CONFIG"' EXIT
+
+run() {
+   echo "pgo-train: $*"
+   if ! "$RETROARCH" "$@" -L "$CORE" ${CONTENT:+"$CONTENT"} >/dev/null 2>&1; then
+      echo "pgo-train: run failed." >&2
+      FAILED=1
+   fi
+}
+
+run --benchmark "$FRAMES"
+
+cat > "$CONFIG" <<CFG
+video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+video_vsync = "false"
+audio_sync = "false"
+rewind_enable = "true"
+CFG
+run -c "$CONFIG" --max-frames "$FRAMES"
+
+if [ -n "$PGO_MOVIES" ]; then
+   for MOVIE in "$PGO_MOVIES"/*.bsv; do
+      [ -f "$MOVIE" ] || continue
+      run --benchmark 0 --bsvplay "$MOVIE" --eof-exit
+   done
+fi
+
+if [ -n "$PGO_VIDEO_DRIVER" ]; then
+   cat > "$CONFIG" <<CFG
+video_driver = "$PGO_VIDEO_DRIVER"
+audio_driver = "null"
+video_vsync = "false"
+audio_sync = "false"
+CFG
+   run -c "$CONFIG" --max-frames "$FRAMES"
+fi
+
+exit $FAILED
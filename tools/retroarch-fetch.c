@@ -0,0 +1,203 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Fetches the files of a manifest with the downloader, for
+ * provisioning cores and assets without a frontend running.
+ * Each line of the manifest names one file:
+ *
+ *    <url> <path> [<sha256> [<extract dir>]]
+ *
+ * "-" stands for a missing SHA-256. Empty lines and lines
+ * starting with '#' are skipped. Running it again resumes
+ * whatever was left half done.
+ *
+ * Built with "make fetch" from the top level directory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "../general.h"
+#include "../downloader.h"
+#include "../frontend/frontend_driver.h"
+#include "../frontend/frontend.h"
+
+/* Everything but frontend.c is linked in, which still wants these. */
+void main_exit(args_type() args)
+{
+   (void)args;
+}
+
+void main_exit_save_config(void)
+{
+}
+
+bool main_load_content(int argc, char **argv,
+      args_type() args, environment_get_t environ_get,
+      process_args_t process_args)
+{
+   (void)argc;
+   (void)argv;
+   (void)args;
+   (void)environ_get;
+   (void)process_args;
+   return false;
+}
+
+#define FETCH_LINE_MAX 4096
+
+static void fetch_done(void *userdata, const char *path, bool ok)
+{
+   (void)userdata;
+   printf("%s: %s\n", path, ok ? "ok" : "FAILED");
+   fflush(stdout);
+}
+
+/**
+ * fetch_add_line:
+ * @handle               : downloader handle.
+ * @line                 : manifest line, cut up in place.
+ * @num                  : line number, for errors.
+ *
+ * Returns: true (1) if the line was queued or had nothing
+ * to queue, otherwise false (0).
+ **/
+static bool fetch_add_line(downloader_t *handle, char *line, unsigned num)
+{
+   char *save   = NULL;
+   char *url    = strtok_r(line, " \t\r\n", &save);
+   char *path   = NULL;
+   char *sha256 = NULL;
+   char *dir    = NULL;
+
+   if (!url || *url == '#')
+      return true;
+
+   path   = strtok_r(NULL, " \t\r\n", &save);
+   sha256 = strtok_r(NULL, " \t\r\n", &save);
+   dir    = strtok_r(NULL, " \t\r\n", &save);
+
+   if (!path || strtok_r(NULL, " \t\r\n", &save))
+   {
+      fprintf(stderr, "Line %u: expected <url> <path> "
+            "[<sha256> [<extract dir>]].\n", num);
+      return false;
+   }
+
+   if (sha256 && !strcmp(sha256, "-"))
+      sha256 = NULL;
+
+   if (!downloader_add(handle, url, path, sha256, dir, fetch_done, NULL))
+   {
+      fprintf(stderr, "Line %u: cannot fetch \"%s\".\n", num, url);
+      return false;
+   }
+
+   return true;
+}
+
+static void print_help(const char *argv0)
+{
+   printf("Usage: %s [options] <manifest>\n", argv0);
+   printf("\t<manifest>: File listing what to fetch, \"-\" for stdin.\n");
+   printf("\t-j/--jobs: Files to download at once. Default is 8.\n");
+   printf("\t-v/--verbose: Log from RetroArch.\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned num = 0;
+   unsigned jobs = 0;
+   bool ok = true;
+   char line[FETCH_LINE_MAX];
+   FILE *manifest = NULL;
+   downloader_t *handle = NULL;
+   struct downloader_progress progress;
+
+   const struct option opts[] = {
+      { "jobs", 1, NULL, 'j' },
+      { "verbose", 0, NULL, 'v' },
+      { "help", 0, NULL, 'h' },
+      { NULL, 0, NULL, 0 },
+   };
+
+   g_extern.log_file = stderr;
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "j:vh", opts, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'j':
+            jobs = strtoul(optarg, NULL, 0);
+            break;
+         case 'v':
+            g_extern.verbosity = true;
+            break;
+         case 'h':
+            print_help(argv[0]);
+            return 0;
+         default:
+            print_help(argv[0]);
+            return 1;
+      }
+   }
+
+   if (optind != argc - 1)
+   {
+      print_help(argv[0]);
+      return 1;
+   }
+
+   if (!strcmp(argv[optind], "-"))
+      manifest = stdin;
+   else if (!(manifest = fopen(argv[optind], "r")))
+   {
+      fprintf(stderr, "Cannot open \"%s\".\n", argv[optind]);
+      return 1;
+   }
+
+   handle = downloader_new(jobs);
+   if (!handle)
+   {
+      fprintf(stderr, "Cannot start the downloader.\n");
+      return 1;
+   }
+
+   while (fgets(line, sizeof(line), manifest))
+      if (!fetch_add_line(handle, line, ++num))
+         ok = false;
+
+   if (manifest != stdin)
+      fclose(manifest);
+
+   while (downloader_poll(handle, 100));
+
+   downloader_get_progress(handle, &progress);
+   printf("%u of %u files, %llu bytes downloaded.\n",
+         progress.files_done, progress.files_total,
+         (unsigned long long)progress.bytes);
+
+   if (progress.files_failed)
+      ok = false;
+
+   downloader_free(handle);
+   return ok ? 0 : 1;
+}
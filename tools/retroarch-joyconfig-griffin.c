@@ -14,11 +14,17 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* Keeps the drivers below to what the tool links against. */
+#ifndef IS_JOYCONFIG
+#define IS_JOYCONFIG
+#endif
+
 #include "retroarch-joyconfig.c"
 
 #if defined(__linux) && !defined(ANDROID)
 #include "../input/drivers/linuxraw_input.c"
 #include "../input/drivers_joypad/linuxraw_joypad.c"
+#include "../input/drivers_joypad/hidraw_joypad.c"
 #endif
 
 #if defined(HAVE_DINPUT)